@@ -1,13 +1,24 @@
 # vi:set shiftwidth=4 expandtab:
-# run "ChimeraX --nogui --exit --silent benchmark.py"
+# run "ChimeraX --nogui --exit --silent --script 'benchmark.py [--output results.json] [--count N] [--remote]'"
 #
 # This file is meant to be run weekly, and compared with
 # previous weeks, so changes in performance can daylighted.
 #
+# Each benchmark times one C++ hot path on the fixed files in testdata/,
+# so runs are reproducible without network access.  --remote adds the
+# benchmarks that fetch PDB_MMCIF_IDS and HUGE_MMCIF_ID from the PDB.
+# Results are printed, and written as JSON with --output, giving for each
+# benchmark its times, throughput in items per second and peak resident
+# memory, so regressions show up when comparing releases.
+#
 import gc
+import json
 import os
+import platform
 import socket
 import subprocess
+import sys
+from time import perf_counter
 from chimerax.core.commands import run
 from chimerax.core.logger import PlainTextLog
 from chimerax.core import buildinfo
@@ -16,14 +27,34 @@ from chimerax.core import buildinfo
 PDB_MMCIF_IDS = ["3fx2", "2hmg", "5xnl"]
 HUGE_MMCIF_ID = "3j3q"
 COUNT = 5
-current_memory_usage = None
+TESTDATA = os.path.join(os.path.dirname(os.path.abspath(__file__)), "testdata")
+TRAJECTORY_FRAMES = 50
 
 
 def get_memory_use():
+    """Current memory use in kilobytes."""
     gc.collect()
-    output = subprocess.check_output(['/usr/bin/pmap', str(os.getpid())])
-    usage = output.split()[-1].decode()
-    return usage
+    try:
+        import psutil
+    except ImportError:
+        output = subprocess.check_output(['/usr/bin/pmap', str(os.getpid())])
+        return int(output.split()[-1].decode()[:-1])
+    return psutil.Process().memory_info().rss // 1024
+
+
+def get_peak_memory_use():
+    """Most memory resident at once so far in kilobytes."""
+    try:
+        import resource
+    except ImportError:
+        # Windows
+        try:
+            import psutil
+        except ImportError:
+            return None
+        return psutil.Process().memory_info().peak_wset // 1024
+    peak = resource.getrusage(resource.RUSAGE_SELF).ru_maxrss
+    return peak // 1024 if sys.platform == 'darwin' else peak
 
 
 class NoOutputLog(PlainTextLog):
@@ -39,103 +70,247 @@ session = session  # noqa -- shut up flake8
 session.logger.add_log(NoOutputLog())
 
 
-def time_command(command):
-    from time import time
-    t0 = time()
-    try:
-        run(session, command)
-    except:
-        return 0
-    t1 = time()
-    return t1 - t0
-
-
-def time_commands(cmds):
-    for cmd, description in cmds:
+def testdata(filename):
+    return os.path.join(TESTDATA, filename)
+
+
+def run_steps(steps):
+    """Run a command or Python function, or a list of them."""
+    if steps is None:
+        return
+    for step in (steps if isinstance(steps, (list, tuple)) else [steps]):
+        if callable(step):
+            step()
+        else:
+            run(session, step)
+
+
+def update_graphics():
+    # Compute graphics that are only made when a frame is drawn,
+    # such as ribbons and volume surfaces.
+    session.update_loop.draw_new_frame()
+
+
+class Benchmark:
+    """
+    A timed step with untimed preparation.  setup and cleanup run once,
+    and before and after run around every timed run.  items is a count, or a function called
+    after the first timed run, of the atoms, residues, grid points, ...
+    processed by one run, for reporting throughput.
+    """
+    def __init__(self, name, run, items=None, unit='atoms', setup=None,
+                 before=None, after=None, cleanup=None):
+        self.name = name
+        self.run = run
+        self.items = items
+        self.unit = unit
+        self.setup = setup
+        self.before = before
+        self.after = after
+        self.cleanup = cleanup
+
+    def measure(self, count):
+        result = {'name': self.name, 'unit': self.unit}
         times = []
-        run_command(cmd, times)
-        print_results(description, times)
-        print_increased_memory()
-
-
-def run_command(command, times):
-    t = time_command(command)
-    # session.main_view.check_for_drawing_change()
-    times.append(t)
-
-
-def time_open_close(open_cmd):
-    open_times = []
-    close_times = []
-    for _ in range(COUNT):
-        run_command(open_cmd, open_times)
-        run_command("close", close_times)
-    return open_times, close_times
-
-
-def print_results(command, times):
-    from numpy import std
-    if len(times) >= 3:
-        # throw out high and low
-        times = sorted(times)[1:-1]
-    mean = sum(times) / len(times)
-    var = std(times)
-    if len(times) == 1:
-        print(f"{round(mean, 4)}: {command}")
+        items = None
+        try:
+            run_steps(self.setup)
+            memory_before = get_memory_use()
+            for _ in range(count):
+                run_steps(self.before)
+                t0 = perf_counter()
+                run_steps(self.run)
+                update_graphics()
+                times.append(perf_counter() - t0)
+                if items is None:
+                    items = self.items() if callable(self.items) else self.items
+                run_steps(self.after)
+            result['memory_increase_kb'] = get_memory_use() - memory_before
+            run_steps(self.cleanup)
+        except Exception as e:
+            result['error'] = '%s: %s' % (e.__class__.__name__, e)
+            run(session, 'close')
+        result['times'] = times
+        if times:
+            from numpy import mean, std
+            # throw out high and low
+            kept = sorted(times)[1:-1] if len(times) >= 3 else times
+            result['mean'] = mean(kept)
+            result['stdev'] = std(kept)
+            if items:
+                result['items'] = items
+                result['throughput'] = items / result['mean']
+        result['peak_rss_kb'] = get_peak_memory_use()
+        return result
+
+
+def atom_count():
+    from chimerax.atomic import all_atoms
+    return len(all_atoms(session))
+
+
+def residue_count():
+    from chimerax.atomic import all_residues
+    return len(all_residues(session))
+
+
+def grid_points():
+    from chimerax.map import Volume
+    v = session.models.list(type=Volume)[0]
+    from numpy import prod
+    return int(prod(v.matrix_size()))
+
+
+class ContourLevels:
+    """Alternate between two levels so every run computes a new contour."""
+    def __init__(self, spec):
+        self.spec = spec
+        self.count = 0
+
+    def __call__(self):
+        level = 0.2 if self.count % 2 == 0 else 0.3
+        self.count += 1
+        run(session, 'volume %s level %g style surface' % (self.spec, level))
+
+
+def add_trajectory_frames():
+    from chimerax.atomic import all_atomic_structures
+    s = all_atomic_structures(session)[0]
+    from numpy import random, float64
+    xyz = s.atoms.coords
+    rng = random.default_rng(1)
+    frames = xyz + rng.normal(scale=0.3, size=(TRAJECTORY_FRAMES,) + xyz.shape)
+    s.add_coordsets(frames.astype(float64))
+
+
+def play_trajectory():
+    from chimerax.atomic import all_atomic_structures
+    s = all_atomic_structures(session)[0]
+    for cs_id in s.coordset_ids:
+        s.active_coordset_id = cs_id
+        update_graphics()
+
+
+def open_command(filename, format):
+    return 'open "%s" format %s loginfo false' % (testdata(filename), format)
+
+
+def local_benchmarks():
+    import tempfile
+    session_path = os.path.join(tempfile.mkdtemp(), 'benchmark.cxs')
+    open_1gcf = open_command('1gcf.cif', 'mmcif')
+    benchmarks = []
+    for filename, format in (('3fx2.pdb', 'pdb'), ('1a0m.pdb', 'pdb'),
+                             ('9rsa.cif', 'mmcif'), ('1gcf.cif', 'mmcif'),
+                             ('1vqn.cif', 'mmcif')):
+        benchmarks.append(Benchmark('open %s' % filename, open_command(filename, format),
+                                    items=atom_count, after='close'))
+    # No MMTF file in testdata, an MMTF open benchmark is under --remote.
+    for grid in (1, 0.5, 0.33):
+        benchmarks.append(Benchmark('contour 1gcf molmap grid %g' % grid,
+                                    ContourLevels('#2'), items=grid_points,
+                                    unit='grid points',
+                                    setup=[open_1gcf, 'molmap #1 5 grid %g' % grid],
+                                    cleanup='close'))
+    benchmarks.extend([
+        Benchmark('molmap 1vqn grid 1', 'molmap #1 5 grid 1', items=atom_count,
+                  setup=open_command('1vqn.cif', 'mmcif'), after='close #2', cleanup='close'),
+        Benchmark('measure sasa 1gcf', 'measure sasa #1', items=atom_count,
+                  setup=open_1gcf, cleanup='close'),
+        Benchmark('hbonds 1gcf', 'hbonds #1', items=atom_count,
+                  setup=open_1gcf, after='~hbonds', cleanup='close'),
+        Benchmark('clashes 1gcf', 'clashes #1', items=atom_count,
+                  setup=open_1gcf, after='~clashes', cleanup='close'),
+        Benchmark('cartoon 1vqn', 'cartoon #1', items=residue_count, unit='residues',
+                  setup=[open_command('1vqn.cif', 'mmcif'), '~cartoon #1'],
+                  after='~cartoon #1', cleanup='close'),
+        Benchmark('session save 1vqn', 'save "%s"' % session_path, items=atom_count,
+                  setup=open_command('1vqn.cif', 'mmcif'), cleanup='close'),
+        Benchmark('session restore 1vqn', 'open "%s"' % session_path, items=atom_count,
+                  after='close', cleanup=lambda: os.remove(session_path)),
+        Benchmark('trajectory playback 1gcf', play_trajectory,
+                  items=TRAJECTORY_FRAMES + 1, unit='frames',
+                  setup=[open_1gcf, add_trajectory_frames], cleanup='close'),
+    ])
+    return benchmarks
+
+
+def remote_benchmarks():
+    huge_open_cmd = f"open {HUGE_MMCIF_ID} format mmcif loginfo false"
+    benchmarks = [Benchmark(huge_open_cmd, huge_open_cmd, items=atom_count, after='close')]
+    for pdb_id in PDB_MMCIF_IDS:
+        for format in ('pdb', 'mmcif', 'mmtf'):
+            open_cmd = f"open {pdb_id} format {format} loginfo false"
+            benchmarks.append(Benchmark(open_cmd, open_cmd, items=atom_count, after='close'))
+    for cmd in ('style ball', 'cartoon'):
+        benchmarks.append(Benchmark(f"{cmd} ({HUGE_MMCIF_ID})", cmd, items=atom_count,
+                                    setup=huge_open_cmd, cleanup='close'))
+    return benchmarks
+
+
+def print_result(result):
+    if 'error' in result:
+        print(f"failed: {result['name']}: {result['error']}")
+        return
+    mean = result['mean']
+    if len(result['times']) == 1:
+        line = f"{round(mean, 4)}: {result['name']}"
     else:
-        print(f"{round(mean, 4)} \N{Plus-Minus Sign}"
-              f" {round(var,3)}: {command}")
-
-
-def print_delta_memory(tag, first, second):
-    delta = int(second[:-1]) - int(first[:-1])
-    print(f"{tag}: {delta}{first[-1]}")
-
-
-def print_increased_memory():
-    global current_memory_usage
-    if current_memory_usage is None:
-        current_memory_usage = start_usage
-    usage = get_memory_use()
-    print_delta_memory("Increased memory use", current_memory_usage, usage)
-    current_memory_usage = usage
-
-
-print(f"UCSF ChimeraX version: {buildinfo.version}"
-      f" ({buildinfo.date.split()[0]})")
-print(f"Running benchmark on {socket.gethostname()}")
-
-start_usage = get_memory_use()
-print(f"Starting memory use:  {start_usage}")
-usage0 = start_usage
-
-print("Average time: command")
-
-huge_open_cmd = f"open {HUGE_MMCIF_ID} format mmcif loginfo false"
-open_times, close_times = time_open_close(huge_open_cmd)
-print_results(huge_open_cmd, open_times)
-print_results(f"({HUGE_MMCIF_ID} mmcif) close", close_times)
-print_increased_memory()
-
-for pdb_id in PDB_MMCIF_IDS:
-    open_cmd = f"open {pdb_id} format pdb loginfo false"
-    open_times, close_times = time_open_close(open_cmd)
-    print_results(open_cmd, open_times)
-    print_results(f"({pdb_id} pdb) close", close_times)
-    open_cmd = f"open {pdb_id} format mmcif loginfo false"
-    open_times, close_times = time_open_close(open_cmd)
-    print_results(open_cmd, open_times)
-    print_results(f"({pdb_id} mmcif) close", close_times)
-    print_increased_memory()
-
-run(session, huge_open_cmd)
-mol_cmds = [
-    ("style ball", f"style ball ({HUGE_MMCIF_ID})"),
-    ("cartoon", f"cartoon ({HUGE_MMCIF_ID})"),
-]
-time_commands(mol_cmds)
-
-
-end_usage = get_memory_use()
-print(f"Ending memory use:    {end_usage}")
-print_delta_memory("Total memory increase", start_usage, end_usage)
+        line = f"{round(mean, 4)} \N{Plus-Minus Sign} {round(result['stdev'], 3)}: {result['name']}"
+    if 'throughput' in result:
+        line += f" ({result['throughput']:.4g} {result['unit']}/s)"
+    print(line)
+
+
+def parse_arguments():
+    import argparse
+    parser = argparse.ArgumentParser(prog='benchmark.py')
+    parser.add_argument('--output', help='JSON file to write results to')
+    parser.add_argument('--count', type=int, default=COUNT,
+                        help='times to run each benchmark')
+    parser.add_argument('--remote', action='store_true',
+                        help='also run benchmarks that fetch from the PDB')
+    # When opened as a file instead of with --script, sys.argv holds the
+    # ChimeraX arguments.
+    args = sys.argv[1:] if os.path.basename(sys.argv[0]) == os.path.basename(__file__) else []
+    return parser.parse_args(args)
+
+
+def main():
+    args = parse_arguments()
+    from chimerax.arrays import max_threads
+    report = {
+        'version': buildinfo.version,
+        'build_date': buildinfo.date.split()[0],
+        'host': socket.gethostname(),
+        'platform': platform.platform(),
+        'cpus': os.cpu_count(),
+        'max_threads': max_threads(),
+        'count': args.count,
+        'start_memory_kb': get_memory_use(),
+    }
+    print(f"UCSF ChimeraX version: {report['version']} ({report['build_date']})")
+    print(f"Running benchmark on {report['host']}")
+    print(f"Starting memory use:  {report['start_memory_kb']}K")
+    print("Average time: benchmark")
+
+    benchmarks = local_benchmarks()
+    if args.remote:
+        benchmarks.extend(remote_benchmarks())
+    results = []
+    for b in benchmarks:
+        result = b.measure(args.count)
+        print_result(result)
+        results.append(result)
+    report['benchmarks'] = results
+    report['end_memory_kb'] = get_memory_use()
+    report['peak_rss_kb'] = get_peak_memory_use()
+    print(f"Ending memory use:    {report['end_memory_kb']}K")
+    print(f"Peak memory use:      {report['peak_rss_kb']}K")
+
+    if args.output:
+        with open(args.output, 'w') as f:
+            json.dump(report, f, indent=2, default=float)
+
+
+main()
@@ -137,16 +137,25 @@ def simple_add_hydrogens(session, structures, *, unknowns_info={}, in_isolation=
             simple_add_hydrogens(session, [struct], unknowns_info=unknowns_info,
                 in_isolation=in_isolation, **prot_schemes)
         return
-    from .simple import add_hydrogens
+    from .simple import add_hydrogens, add_hydrogens_in_bulk, needs_alt_locs
     atoms, type_info_for_atom, naming_schemas, idatm_type, hydrogen_totals, his_Ns, \
         coordinations, fake_N, fake_C, fake_5p, fake_3p = \
         _prep_add(session, structures, unknowns_info, template, **prot_schemes)
     _make_shared_data(session, structures, in_isolation)
     from chimerax.atomic import Atom
-    invert_xforms = {}
+    # atoms without alt locs or metal coordination have their hydrogens placed in C++
+    bulk_atoms = []
+    other_atoms = []
     for atom in atoms:
         if atom not in type_info_for_atom:
             continue
+        if coordinations.get(atom) or needs_alt_locs(atom):
+            other_atoms.append(atom)
+        else:
+            bulk_atoms.append(atom)
+    add_hydrogens_in_bulk(bulk_atoms, type_info_for_atom, naming_schemas, hydrogen_totals)
+    invert_xforms = {}
+    for atom in other_atoms:
         bonding_info = type_info_for_atom[atom]
         if Atom._addh_coord == Atom.coord:
             invert = None
@@ -390,7 +399,7 @@ def _make_shared_data(session, protonation_models, in_isolation):
     # since adaptive search tree is static, it will not include
     # hydrogens added after this; they will have to be found by
     # looking off their heavy atoms
-    global search_tree, _radii, _metals, ident_pos_models, _h_coloring, _solvent_atoms
+    global search_tree, _radii, _metals, ident_pos_models, _h_coloring, _solvent_atoms, search_models
     _radii = {}
     search_atoms = []
     metal_atoms = []
@@ -416,7 +425,8 @@ def _make_shared_data(session, protonation_models, in_isolation):
             else:
                 ident_pos_models.setdefault(pm, set()).add(m)
 
-    for m in models:
+    search_models = list(models)
+    for m in search_models:
         if m not in ident_pos_models:
             ident_pos_models[m] = set()
         for a in m.atoms:
@@ -433,8 +443,18 @@ def _make_shared_data(session, protonation_models, in_isolation):
     _solvent_atoms = WeakKeyDictionary()
 
 def _delete_shared_data():
-    global search_tree, _radii, _metals, ident_pos_model, _h_coloring
-    search_tree = radii = _metals = ident_pos_models = _h_coloring = None
+    global search_tree, _radii, _metals, ident_pos_model, _h_coloring, search_models
+    search_tree = radii = _metals = ident_pos_models = _h_coloring = search_models = None
+
+def models_interact(m1, m2):
+    # whether atoms of m2 can crowd hydrogens of m1, as in find_nearest()
+    if m1 == m2:
+        return True
+    if m1.id is None or m2.id is None:
+        return False
+    if len(m2.id) > 1 and m2.id[:-1] == m1.id[:-1]:
+        return False
+    return m2 not in ident_pos_models[m1]
 
 asp_res_names, asp_prot_names = ["ASP", "ASH"], ["OD1", "OD2"]
 glu_res_names, glu_prot_names = ["GLU", "GLH"], ["OE1", "OE2"]
@@ -953,6 +973,37 @@ def new_hydrogen(parent_atom, h_num, total_hydrogens, naming_schema, pos, parent
     new_h.hide = parent_atom.hide
     return new_h
 
+def new_hydrogens(parents, positions, counts, keep, total_hydrogens, naming_schemas):
+    """Add the hydrogens from bond_geom.place_hydrogens(), named, numbered and colored
+       as new_hydrogen() would, with each structure's hydrogens added in one step"""
+    global _serial
+    added = {}
+    pending_names = {}
+    for i, atom in enumerate(parents):
+        if not keep[i].any():
+            continue
+        res = atom.residue
+        struct = atom.structure
+        names = pending_names.setdefault(res, set())
+        def find_atom(name, res=res, names=names):
+            return name in names or res.find_atom(name)
+        naming_schema = (naming_schemas[res], naming_schemas[struct])
+        h_color = determine_h_color(atom)
+        info = added.setdefault(struct, ([], [], [], [], []))
+        for k in range(counts[i]):
+            if not keep[i,k]:
+                continue
+            name = _h_name(atom, k+1, total_hydrogens[atom], naming_schema, find_atom=find_atom)
+            names.add(name)
+            if _serial is None:
+                _serial = max(struct.atoms.serial_numbers) + 1
+            for values, value in zip(info, (atom, name, positions[i,k], _serial, h_color)):
+                values.append(value)
+            _serial += 1
+    from chimerax.atomic import Atoms
+    for struct, (h_parents, names, coords, serials, colors) in added.items():
+        struct.new_hydrogens(Atoms(h_parents), names, coords, serials, colors)
+
 def determine_h_color(parent_atom):
     global _h_coloring, _solvent_atoms
     res = parent_atom.residue
@@ -1026,14 +1077,16 @@ def to_h36(base10, max_digits):
         base36_num = int(base36_num / 36)
     return base36_str
 
-def _h_name(atom, h_num, total_hydrogens, naming_schema):
+def _h_name(atom, h_num, total_hydrogens, naming_schema, find_atom=None):
+    # 'find_atom' can also report names about to be added to the residue
     res_name = atom.residue.name
-    find_atom = atom.residue.find_atom
+    if find_atom is None:
+        find_atom = atom.residue.find_atom
 
     res_schema, pdb_version = naming_schema
     if res_schema == "simple":
         i = 1
-        while atom.residue.find_atom("H%s" % to_h36(i, 3)):
+        while find_atom("H%s" % to_h36(i, 3)):
             i += 1
         return "H%s" % to_h36(i, 3)
     if res_name in naming_exceptions and atom.name in naming_exceptions[res_name]:
@@ -28,16 +28,57 @@ sin5475 = sin(pi * 54.75 / 180.0)
 cos5475 = cos(pi * 54.75 / 180.0)
 
 def add_hydrogens(atom, *args, **kw):
+    _alt_loc_add_hydrogens(atom, _alt_loc_atom(atom), *args, **kw)
+
+def needs_alt_locs(atom):
+    return _alt_loc_atom(atom) is not None
+
+def _alt_loc_atom(atom):
     # determine what alt_loc(s) to add hydrogens to...
-    alt_loc_atom = None
     if len(atom.alt_locs) > 1:
-        alt_loc_atom = atom
-    else:
-        for nb in atom.neighbors:
-            if len(nb.alt_locs) > 1:
-                alt_loc_atom = nb
-                break
-    _alt_loc_add_hydrogens(atom, alt_loc_atom, *args, **kw)
+        return atom
+    for nb in atom.neighbors:
+        if len(nb.alt_locs) > 1:
+            return nb
+    return None
+
+def add_hydrogens_in_bulk(atoms, type_info_for_atom, naming_schemas, hydrogen_totals):
+    # For atoms without alt locs or metal coordination.  Their hydrogen positions are
+    # computed together in C++ from the same rules as _alt_loc_add_hydrogens(), and
+    # each structure's hydrogens are then added in one step.
+    atoms = [a for a in atoms
+        if type_info_for_atom[a].substituents > a.num_explicit_bonds]
+    if not atoms:
+        return
+    from . import cmd
+    from .util import bond_with_H_length
+    from chimerax.atomic import Atom, Atoms, concatenate
+    from chimerax.atomic.bond_geom import place_hydrogens
+    from numpy import array, empty, int32
+    parents = Atoms(atoms)
+    geometries = [type_info_for_atom[a].geometry for a in atoms]
+    substituents = [type_info_for_atom[a].substituents for a in atoms]
+    bond_lengths = [bond_with_H_length(a, g) for a, g in zip(atoms, geometries)]
+    models = cmd.search_models
+    crowd = concatenate([m.atoms for m in models], Atoms)
+    use_scene = Atom._addh_coord == Atom.scene_coord
+    crowd_coords = crowd.scene_coords if use_scene else crowd.coords
+    groups = empty((len(crowd),), int32)
+    start = 0
+    for i, m in enumerate(models):
+        groups[start:start+m.num_atoms] = i
+        start += m.num_atoms
+    interacts = array([[cmd.models_interact(m1, m2) for m2 in models] for m1 in models])
+    positions, counts, keep = place_hydrogens(parents, geometries, substituents, bond_lengths,
+        crowd, crowd_coords, groups, interacts, cmd._metal_dist)
+    if use_scene:
+        astruct = parents.structures._pointers
+        for s in parents.unique_structures:
+            mask = (astruct == s._c_pointer.value)
+            invert = s.scene_position.inverse()
+            positions[mask] = invert.transform_points(positions[mask].reshape((-1,3))).reshape(
+                (-1,4,3))
+    cmd.new_hydrogens(atoms, positions, counts, keep, hydrogen_totals, naming_schemas)
 
 def _alt_loc_add_hydrogens(atom, alt_loc_atom, bonding_info, naming_schema, total_hydrogens,
         idatm_type, invert, coordinations):
@@ -24,15 +24,19 @@
 
 #include <Python.h>
 #include <algorithm>
+#include <atomic>
+#include <limits>
 #include <sstream>
 #include <string>
 #include <map>
+#include <utility>
 #include <vector>
 
 #include <iostream>
 
 #include <align_algs/support.h>
 #include <arrays/pythonarray.h>   // use array_from_python()
+#include <arrays/threadpool.h>    // use Thread_Pool::thread_count(), run()
 #include <pysupport/convert.h>
 
 #ifndef PY_STUPID
@@ -52,6 +56,11 @@ class Evaluator
 public:
 	virtual  ~Evaluator() {}
 	virtual double  score(int i, int j) = 0;
+	// scores of seq1[i] against seq2[j0] through seq2[j1-1], put in row[j0] onward
+	virtual void  score_row(int i, int j0, int j1, double* row) {
+		for (int j = j0; j < j1; ++j)
+			row[j] = score(i, j);
+	}
 };
 
 class SimEvaluator: public Evaluator
@@ -59,6 +68,8 @@ class SimEvaluator: public Evaluator
 	Similarity  _sim_m;
 	char*  _seq1;
 	char*  _seq2;
+	// scores against all of seq2, per seq1 residue type, filled as needed
+	std::vector<double>  _profiles[256];
 public:
 	SimEvaluator(PyObject* py_m, char* seq1, char* seq2) {
 		if (make_matrix(py_m, _sim_m) < 0)
@@ -67,14 +78,26 @@ public:
 		_seq2 = seq2;
 	}
 	double  score(int i, int j)  { return matrix_lookup(_sim_m, _seq1[i], _seq2[j])->second; }
+	void  score_row(int i, int j0, int j1, double* row) {
+		char c1 = _seq1[i];
+		auto& profile = _profiles[static_cast<unsigned char>(c1)];
+		if (profile.empty()) {
+			for (char* c2 = _seq2; *c2 != '\0'; ++c2)
+				profile.push_back(matrix_lookup(_sim_m, c1, *c2)->second);
+		}
+		std::copy(profile.begin() + j0, profile.begin() + j1, row + j0);
+	}
 };
 
 class ScoreEvaluator: public Evaluator
 {
-	double**  _score_m;
+	const double*  _score_m;
+	int64_t  _stride0, _stride1;
 public:
-	ScoreEvaluator(double** score_m): _score_m(score_m) {}
-	double  score(int i, int j)  { return _score_m[i][j]; }
+	ScoreEvaluator(const Numeric_Array& score_m):
+		_score_m(static_cast<const double*>(score_m.values())),
+		_stride0(score_m.stride(0)), _stride1(score_m.stride(1)) {}
+	double  score(int i, int j)  { return _score_m[i*_stride0 + j*_stride1]; }
 };
 
 class FreqEvaluator: public Evaluator
@@ -96,6 +119,11 @@ public:
 	SimpleEvaluator(char* seq1, char* seq2, double match, double mismatch):
 		_seq1(seq1), _seq2(seq2), _match(match), _mismatch(mismatch) {}
 	double  score(int i, int j)  { return (_seq1[i] == _seq2[j]) ? _match : _mismatch; }
+	void  score_row(int i, int j0, int j1, double* row) {
+		char c1 = _seq1[i];
+		for (int j = j0; j < j1; ++j)
+			row[j] = (c1 == _seq2[j]) ? _match : _mismatch;
+	}
 };
 
 class SSEvaluator: public Evaluator
@@ -139,6 +167,27 @@ public:
 	}
 };
 
+// One alignment: everything the dynamic programming needs, set up from the
+// Python arguments, and the result.
+class MatchProblem
+{
+public:
+	size_t  rows, cols;
+	Evaluator*  eval = nullptr;
+	Numeric_Array  score_array;	// keeps score matrix values for a ScoreEvaluator
+	double  gap_open, gap_extend;
+	int  ends_are_gaps;
+	int  band;
+	std::vector<double>  gap_open_1, gap_open_2;
+	bool  has_occ1, has_occ2;
+	std::vector<double>  occ1, occ2;
+
+	double  score;
+	std::vector<std::pair<size_t, size_t>>  matches;	// last match first
+
+	~MatchProblem() { delete eval; }
+};
+
 extern "C" {
 
 static bool
@@ -207,11 +256,12 @@ populate_freqs_dict(FreqDicts& freq_dicts, PyObject* ss_freqs_val, char* ss_type
 }
 
 //
-// match
-//	Compute the best Needleman-Wunsch score and match list
+// parse_match_args
+//	Set up an alignment from the match() arguments.
+//	Returns null with a Python error set if the arguments are bad.
 //
-static PyObject *
-match(PyObject *, PyObject *args)
+static MatchProblem *
+parse_match_args(PyObject *args)
 {
 	char *seq1, *seq2;
 	double score_match, score_mismatch;
@@ -228,14 +278,23 @@ match(PyObject *, PyObject *args)
 	char *ss_types1, *ss_types2;
 	PyObject *ss_freqs_val1, *ss_freqs_val2;
 	PyObject *occupancies_val1, *occupancies_val2;
-	if (!PyArg_ParseTuple(args, PY_STUPID "ssddddpOOOOOpdddOOssOOOO", &seq1, &seq2,
+	int band = 0;
+	if (!PyTuple_Check(args)) {
+		PyErr_SetString(PyExc_TypeError, "match arguments are not a tuple");
+		return nullptr;
+	}
+	if (!PyArg_ParseTuple(args, PY_STUPID "ssddddpOOOOOpdddOOssOOOO|i", &seq1, &seq2,
 			&score_match, &score_mismatch, &gap_open, &gap_extend, &ends_are_gaps,
 			&sim_m, &score_m, &freq_m, &ss_m, &ss_fract,
 			&ss_specific_gaps, &gap_open_helix, &gap_open_strand, &gap_open_other,
 			&gap_freqs1, &gap_freqs2,
 			&ss_types1, &ss_types2, &ss_freqs_val1, &ss_freqs_val2,
-			&occupancies_val1, &occupancies_val2))
+			&occupancies_val1, &occupancies_val2, &band))
+		return nullptr;
+	if (band < 0) {
+		PyErr_SetString(PyExc_ValueError, "band must be non-negative");
 		return nullptr;
+	}
 
 	size_t rows = strlen(seq1) + 1;
 	size_t cols = strlen(seq2) + 1;
@@ -261,7 +320,7 @@ match(PyObject *, PyObject *args)
 			PyErr_SetString(PyExc_ValueError, err_msg.str().c_str());
 			return nullptr;
 		}
-		eval = new ScoreEvaluator(static_cast<double**>(array.values()));
+		eval = new ScoreEvaluator(array);
 	} else if (freq_m != Py_None) {
 		if (!PySequence_Check(freq_m)) {
 			PyErr_SetString(PyExc_ValueError, "Frequency matrix is not a sequence");
@@ -409,163 +468,286 @@ match(PyObject *, PyObject *args)
 		}
 	}
 
+	auto problem = new MatchProblem;
+	problem->rows = rows;
+	problem->cols = cols;
+	problem->eval = eval;
+	problem->score_array = array;
+	problem->gap_open = gap_open;
+	problem->gap_extend = gap_extend;
+	problem->ends_are_gaps = ends_are_gaps;
+	problem->band = band;
+	problem->gap_open_1 = std::move(gap_open_1);
+	problem->gap_open_2 = std::move(gap_open_2);
+	problem->has_occ1 = has_occ1;
+	problem->has_occ2 = has_occ2;
+	problem->occ1 = std::move(occ1);
+	problem->occ2 = std::move(occ2);
+	return problem;
+}
+
+//
+// compute_match
+//	Compute the best Needleman-Wunsch score and match list.
+//	Makes no Python calls, so it can run without the GIL.
+//
+static void
+compute_match(MatchProblem& problem)
+{
+	auto rows = problem.rows, cols = problem.cols;
+	auto eval = problem.eval;
+	auto gap_open = problem.gap_open, gap_extend = problem.gap_extend;
+	auto ends_are_gaps = problem.ends_are_gaps;
+	auto band = problem.band;
+	auto& gap_open_1 = problem.gap_open_1;
+	auto& gap_open_2 = problem.gap_open_2;
+	auto has_occ1 = problem.has_occ1, has_occ2 = problem.has_occ2;
+	auto& occ1 = problem.occ1;
+	auto& occ2 = problem.occ2;
+
 	//
-	// Allocate space for the score matrix and the backtracking matrix
+	// Only two rows of the score matrix are kept.  A gap is scored from the
+	// matrix value where it starts, so that value is remembered per column
+	// (and for the current row) along with the occupancy sum since the start.
+	// The backtracking matrix is one block.
 	//
-	double **m = new double *[rows];
-	int **bt = new int *[rows];
-	for (size_t i = 0; i < rows; ++i) {
-		m[i] = new double[cols];
-		bt[i] = new int[cols];
-		bt[i][0] = 1;
-		if (ends_are_gaps && i > 0)
-			m[i][0] = gap_open + i * gap_extend;
-		else
-			m[i][0] = 0.0;
+	const double unreachable = -std::numeric_limits<double>::infinity();
+	std::vector<double> prev_row(cols, unreachable), cur_row(cols, unreachable);
+	std::vector<double> scores(cols);
+	std::vector<int> bt(rows * cols);
+
+	// With a band, only cells within "band" columns of the diagonal from the
+	// first cell to the last are computed.  Widen it enough that consecutive
+	// rows overlap so there is always a path.
+	auto n1 = rows - 1, n2 = cols - 1;
+	size_t half_width = cols;
+	if (band > 0 && n1 > 0) {
+		half_width = std::max(static_cast<size_t>(band), (n2 + n1 - 1) / n1 + 1);
 	}
-	for (size_t j = 0; j < cols; ++j) {
-		bt[0][j] = 2;
+	auto band_start = [&](size_t r) {
+		size_t center = n1 > 0 ? (r * n2) / n1 : 0;
+		return center > half_width ? center - half_width : 0;
+	};
+	auto band_end = [&](size_t r) {
+		size_t center = n1 > 0 ? (r * n2) / n1 : 0;
+		return std::min(cols - 1, center + half_width);   // inclusive
+	};
+	auto row0_end = band_end(0);
+	for (size_t j = 0; j <= row0_end; ++j) {
 		if (ends_are_gaps && j > 0)
-			m[0][j] = gap_open + j * gap_extend;
+			prev_row[j] = gap_open + j * gap_extend;
 		else
-			m[0][j] = 0.0;
+			prev_row[j] = 0.0;
 	}
 
 	// fill matrix [dynamic programming]
 	std::vector<size_t> col_gap_starts(cols-1, 0); // don't care about column zero
-	double base_col_gap_val, base_row_gap_val, skip;
+	std::vector<double> col_gap_bases(prev_row.begin() + 1, prev_row.end());
+	std::vector<double> col_gap_occs(cols-1, 0.0);
+	size_t prev_start = 0, prev_end = row0_end, cur_start = 0, cur_end = 0;
+	bool is_first_row = true;
 	for (size_t i1 = 0; i1 < rows-1; ++i1) {
-		size_t row_gap_pos = 0;
-		size_t i2_end = cols-1;
-		for (size_t i2 = 0; i2 < i2_end; ++i2) {
-			auto best = m[i1][i2] + eval->score(i1, i2);
+		// clear what this buffer held two rows ago
+		if (!is_first_row) {
+			std::fill(cur_row.begin() + cur_start, cur_row.begin() + cur_end + 1, unreachable);
+		}
+		is_first_row = false;
+		cur_start = band_start(i1+1);
+		cur_end = band_end(i1+1);
+		if (cur_start == 0)
+			cur_row[0] = (ends_are_gaps ? gap_open + (i1+1) * gap_extend : 0.0);
+		size_t j_start = std::max(cur_start, static_cast<size_t>(1));
+		if (j_start > cur_end) {
+			std::swap(prev_row, cur_row);
+			std::swap(prev_start, cur_start);
+			std::swap(prev_end, cur_end);
+			continue;
+		}
+		eval->score_row(i1, j_start - 1, cur_end, scores.data());
+		bool row_gaps = (i1 + 1 < rows-1 || ends_are_gaps);
+		size_t row_gap_pos = j_start - 1;
+		double row_gap_base = cur_row[row_gap_pos], row_gap_occ = 0.0;
+		int* bt_row = bt.data() + (i1+1) * cols;
+		for (size_t i2 = j_start - 1; i2 < cur_end; ++i2) {
+			auto best = prev_row[i2] + scores[i2];
 			int bt_type = 0, skip_size;
-			double col_skip_val, row_skip_val;
-			if (i2 + 1 < cols-1 || ends_are_gaps) {
+			double base_col_gap_val = 0.0, base_row_gap_val = 0.0, skip;
+			bool col_gaps = (i2 + 1 < cols-1 || ends_are_gaps);
+			if (col_gaps) {
 				auto col_gap_pos = col_gap_starts[i2];
 				skip_size = i1 + 1 - col_gap_pos;
+				double col_skip_val;
 				if (has_occ1) {
-					double tot_occ = 0.0;
-					for (auto i = col_gap_pos; i < i1+1; ++i) {
-						tot_occ += occ1[i];
-					}
-					col_skip_val = tot_occ * gap_extend;
+					col_gap_occs[i2] += occ1[i1];
+					col_skip_val = col_gap_occs[i2] * gap_extend;
 				} else {
 					col_skip_val = skip_size * gap_extend;
 				}
-				base_col_gap_val = m[col_gap_pos][i2+1] + col_skip_val;
+				base_col_gap_val = col_gap_bases[i2] + col_skip_val;
 				skip = base_col_gap_val + gap_open_2[i2+1];
 			} else {
 				skip_size = 1;
-				col_skip_val = 0.0;
-				skip = m[i1][i2+1];
+				skip = prev_row[i2+1];
 			}
 			if (skip > best) {
 				best = skip;
 				bt_type = skip_size;
 			}
-			if (i1 + 1 < rows-1 || ends_are_gaps) {
+			if (row_gaps) {
 				skip_size = i2 + 1 - row_gap_pos;
+				double row_skip_val;
 				if (has_occ2) {
-					double tot_occ = 0.0;
-					for (auto i = row_gap_pos; i < i2+1; ++i) {
-						tot_occ += occ2[i];
-					}
-					row_skip_val = tot_occ * gap_extend;
+					row_gap_occ += occ2[i2];
+					row_skip_val = row_gap_occ * gap_extend;
 				} else {
 					row_skip_val = skip_size * gap_extend;
 				}
-				base_row_gap_val = m[i1+1][row_gap_pos] + row_skip_val;
+				base_row_gap_val = row_gap_base + row_skip_val;
 				skip = base_row_gap_val + gap_open_1[i1+1];
 			} else {
 				skip_size = 1;
-				row_skip_val = 0.0;
-				skip = m[i1+1][i2];
+				skip = cur_row[i2];
 			}
 			if (skip > best) {
 				best = skip;
 				bt_type = 0 - skip_size;
 			}
 
-			m[i1+1][i2+1] = best;
-			bt[i1+1][i2+1] = bt_type;
-			if (bt_type >= 0) {
+			cur_row[i2+1] = best;
+			bt_row[i2+1] = bt_type;
+			if (bt_type >= 0 && row_gaps) {
 				// not gapping the row
-				if (best > base_row_gap_val)
+				if (best > base_row_gap_val) {
 					row_gap_pos = i2 + 1;
+					row_gap_base = best;
+					row_gap_occ = 0.0;
+				}
 			}
-			if (bt_type <= 0) {
+			if (bt_type <= 0 && col_gaps) {
 				// not gapping the column
-				if (best > base_col_gap_val)
+				if (best > base_col_gap_val) {
 					col_gap_starts[i2] = i1 + 1;
+					col_gap_bases[i2] = best;
+					col_gap_occs[i2] = 0.0;
+				}
 			}
 		}
+		std::swap(prev_row, cur_row);
+		std::swap(prev_start, cur_start);
+		std::swap(prev_end, cur_end);
 	}
 
-	// create match list
-	bool py_error_happened = false;
-	PyObject* match_list = PyList_New(0);
-	if (match_list == nullptr) {
-		py_error_happened = true;
-	} else {
-		auto i1 = rows - 1;
-		auto i2 = cols - 1;
-		while (i1 > 0 && i2 > 0) {
-			auto bt_type = bt[i1][i2];
-			if (bt_type == 0) {
-				PyObject* tuple = PyTuple_New(2);
-				if (tuple == nullptr) {
-					py_error_happened = true;
-					Py_DECREF(match_list);
-					break;
-				}
-				if (PyList_Append(match_list, tuple) < 0) {
-					py_error_happened = true;
-					Py_DECREF(tuple);
-					Py_DECREF(match_list);
-					break;
-				}
-				PyObject* py_i1 = PyLong_FromSize_t(i1-1);
-				if (py_i1 == nullptr) {
-					py_error_happened = true;
-					Py_DECREF(match_list);
-					break;
-				}
-				PyTuple_SET_ITEM(tuple, 0, py_i1);
-				PyObject* py_i2 = PyLong_FromSize_t(i2-1);
-				if (py_i2 == nullptr) {
-					py_error_happened = true;
-					Py_DECREF(match_list);
-					break;
-				}
-				PyTuple_SET_ITEM(tuple, 1, py_i2);
-				i1--;
-				i2--;
-			} else if (bt_type > 0) {
-				i1 -= bt_type;
-			} else {
-				i2 += bt_type;
-			}
+	// trace back the matches
+	auto& matches = problem.matches;
+	matches.clear();
+	auto i1 = rows - 1;
+	auto i2 = cols - 1;
+	while (i1 > 0 && i2 > 0) {
+		auto bt_type = bt[i1 * cols + i2];
+		if (bt_type == 0) {
+			matches.emplace_back(i1-1, i2-1);
+			i1--;
+			i2--;
+		} else if (bt_type > 0) {
+			i1 -= bt_type;
+		} else {
+			i2 += bt_type;
 		}
 	}
 
-	auto best_score = m[rows-1][cols-1];
+	problem.score = prev_row[cols-1];
+}
 
-	//
-	// Release the score and backtrack matrix memory
-	//
-	for (size_t i = 0; i < rows; ++i) {
-		delete [] m[i];
-		delete [] bt[i];
+//
+// match_result
+//	Python (score, match list) for a computed alignment
+//
+static PyObject *
+match_result(const MatchProblem& problem)
+{
+	PyObject* match_list = PyList_New(problem.matches.size());
+	if (match_list == nullptr)
+		return nullptr;
+	Py_ssize_t i = 0;
+	for (auto& m: problem.matches) {
+		PyObject* tuple = Py_BuildValue(PY_STUPID "nn", static_cast<Py_ssize_t>(m.first),
+			static_cast<Py_ssize_t>(m.second));
+		if (tuple == nullptr) {
+			Py_DECREF(match_list);
+			return nullptr;
+		}
+		PyList_SET_ITEM(match_list, i++, tuple);
 	}
-	delete [] m;
-	delete [] bt;
-	delete eval;
+	return Py_BuildValue(PY_STUPID "fN", problem.score, match_list);
+}
 
-	if (py_error_happened)
+//
+// match
+//	Compute the best Needleman-Wunsch score and match list
+//
+static PyObject *
+match(PyObject *, PyObject *args)
+{
+	MatchProblem* problem = parse_match_args(args);
+	if (problem == nullptr)
+		return nullptr;
+	compute_match(*problem);
+	PyObject* result = match_result(*problem);
+	delete problem;
+	return result;
+}
+
+//
+// match_many
+//	Compute many Needleman-Wunsch alignments in parallel.  Takes a sequence,
+//	each item of which is a tuple of match() arguments, and the number of
+//	threads to use.  Returns a list of match() results.
+//
+static PyObject *
+match_many(PyObject *, PyObject *args)
+{
+	PyObject* py_args_list;
+	int num_threads;
+	if (!PyArg_ParseTuple(args, PY_STUPID "Oi", &py_args_list, &num_threads))
+		return nullptr;
+	PyObject* py_args_seq = PySequence_Fast(py_args_list, "match_many() argument is not a sequence");
+	if (py_args_seq == nullptr)
 		return nullptr;
+	// the argument tuples hold the sequence strings the problems point into
+	std::vector<MatchProblem*> problems;
+	Py_ssize_t num_problems = PySequence_Fast_GET_SIZE(py_args_seq);
+	for (Py_ssize_t i = 0; i < num_problems; ++i) {
+		MatchProblem* problem = parse_match_args(PySequence_Fast_GET_ITEM(py_args_seq, i));
+		if (problem == nullptr) {
+			for (auto p: problems)
+				delete p;
+			Py_DECREF(py_args_seq);
+			return nullptr;
+		}
+		problems.push_back(problem);
+	}
 
-	return Py_BuildValue(PY_STUPID "fO", best_score, match_list);
+	Py_BEGIN_ALLOW_THREADS
+	// alignments differ in size, so threads take the next one when done
+	int nt = Thread_Pool::thread_count(problems.size(), 1, std::max(1, num_threads));
+	std::atomic<size_t> next(0);
+	Thread_Pool::run(nt, [&problems, &next](int) {
+		for (size_t i = next++; i < problems.size(); i = next++)
+			compute_match(*problems[i]);
+	});
+	Py_END_ALLOW_THREADS
+
+	PyObject* results = PyList_New(num_problems);
+	for (Py_ssize_t i = 0; i < num_problems; ++i) {
+		PyObject* result = (results == nullptr ? nullptr : match_result(*problems[i]));
+		if (result == nullptr)
+			Py_CLEAR(results);
+		else
+			PyList_SET_ITEM(results, i, result);
+		delete problems[i];
+	}
+	Py_DECREF(py_args_seq);
+	return results;
 }
 
 }
@@ -574,8 +756,13 @@ static const char* docstr_match =
 "Private function for computing Needleman-Wunsch score and matching.\n"
 "Use the chimerax.seqalign.align_algs.NeedlemanWunsch.nw method, which uses this as a backend.";
 
+static const char* docstr_match_many =
+"Private function for computing many Needleman-Wunsch alignments using multiple threads.\n"
+"Use the chimerax.seqalign.align_algs.NeedlemanWunsch.nw_many method, which uses this as a backend.";
+
 static PyMethodDef nw_methods[] = {
 	{ PY_STUPID "match", match,	METH_VARARGS, PY_STUPID docstr_match	},
+	{ PY_STUPID "match_many", match_many,	METH_VARARGS, PY_STUPID docstr_match_many	},
 	{ nullptr, nullptr, 0, nullptr }
 };
 
@@ -24,10 +24,15 @@
 
 #include <Python.h>
 #include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
 #include <string>
 #include <map>
+#include <vector>
 
 #include "align_algs/support.h"
+#include <arrays/threadpool.h>    // use Thread_Pool::thread_count(), run()
 
 #ifndef PY_STUPID
 // workaround for Python API missing const's.
@@ -42,6 +47,108 @@ using align_algs::make_matrix;
 using align_algs::matrix_lookup;
 using align_algs::Similarity;
 
+//
+// Profile
+//	Similarity scores of each residue of a query sequence against each
+//	residue type that occurs in the sequences it is aligned with
+//
+template <typename T>
+class Profile
+{
+public:
+	std::vector<T>  scores[256];	// indexed by residue type
+};
+
+// Add scores for residue type c2; false with a Python KeyError if a pair has no score
+static bool
+add_profile_type(Profile<double>& profile, const Similarity& matrix, const char* seq1, char c2)
+{
+	auto& scores = profile.scores[static_cast<unsigned char>(c2)];
+	if (!scores.empty() || *seq1 == '\0')
+		return true;
+	for (const char* c1 = seq1; *c1 != '\0'; ++c1) {
+		Similarity::const_iterator it = matrix_lookup(matrix, *c1, c2);
+		if (it == matrix.end()) {
+			char buf[80];
+			(void) sprintf(buf, MissingKey, *c1, c2);
+			PyErr_SetString(PyExc_KeyError, buf);
+			scores.clear();
+			return false;
+		}
+		scores.push_back((*it).second);
+	}
+	return true;
+}
+
+// If all scores and penalties are small integers, the same scores can be computed
+// exactly (and faster) with integer arithmetic
+static bool
+integer_profile(const Profile<double>& profile, size_t len1, double gap_open, double gap_extend,
+	Profile<int>& int_profile)
+{
+	double limit = (std::numeric_limits<int>::max() / 4) / static_cast<double>(len1 + 1);
+	for (double v: { gap_open, gap_extend })
+		if (v != std::floor(v) || std::fabs(v) > limit)
+			return false;
+	for (int c = 0; c < 256; ++c) {
+		for (auto v: profile.scores[c])
+			if (v != std::floor(v) || std::fabs(v) > limit)
+				return false;
+		int_profile.scores[c].assign(profile.scores[c].begin(), profile.scores[c].end());
+	}
+	return true;
+}
+
+//
+// profile_score
+//	Score of the best Smith-Waterman alignment of the profile's query
+//	sequence (of length len1) with seq2.
+//
+//	Gap scores are linear in gap length, so instead of checking every gap
+//	length, the best gap ending at each cell is carried along (Gotoh's
+//	method), needing only one column of the score matrix.
+//
+template <typename T>
+static T
+profile_score(const Profile<T>& profile, size_t len1, const char* seq2, T gap_open, T gap_extend)
+{
+	const T none = std::numeric_limits<T>::lowest() / 2;
+	std::vector<T> H(len1 + 1, 0);		// scores of the previous column
+	std::vector<T> F(len1 + 1, none);	// best gap along seq2 ending in each row
+	T best_score = 0;
+	T gap_start = gap_open + gap_extend;
+	for (const char* c2 = seq2; *c2 != '\0'; ++c2) {
+		const T* scores = profile.scores[static_cast<unsigned char>(*c2)].data();
+		T diag = 0, E = none;		// E is the best gap along seq1
+		for (size_t i = 1; i <= len1; ++i) {
+			T best = diag + scores[i - 1];
+			if (E > best)
+				best = E;
+			if (F[i] > best)
+				best = F[i];
+			if (best < 0)
+				best = 0;
+			diag = H[i];
+			H[i] = best;
+			E = std::max(best - gap_start, E - gap_extend);
+			F[i] = std::max(best - gap_start, F[i] - gap_extend);
+			if (best > best_score)
+				best_score = best;
+		}
+	}
+	return best_score;
+}
+
+static double
+best_score(const Profile<double>& profile, const Profile<int>* int_profile, size_t len1,
+	const char* seq2, double gap_open, double gap_extend)
+{
+	if (int_profile != nullptr)
+		return profile_score<int>(*int_profile, len1, seq2, static_cast<int>(gap_open),
+			static_cast<int>(gap_extend));
+	return profile_score<double>(profile, len1, seq2, gap_open, gap_extend);
+}
+
 //
 // score
 //	Compute the score of the best Smith-Waterman alignment
@@ -70,46 +177,15 @@ score(PyObject *, PyObject *args)
 	Similarity matrix;
 	if (make_matrix(m, matrix) < 0)
 		return nullptr;
-	int rows = strlen(seq1) + 1;
-	int cols = strlen(seq2) + 1;
-	double **H = new double *[rows];
-	for (int i = 0; i < rows; ++i) {
-		H[i] = new double[cols];
-		for (int j = 0; j < cols; ++j)
-			H[i][j] = 0;
-	}
-	double best_score = 0;
-	for (int i = 1; i < rows; ++i) {
-		for (int j = 1; j < cols; ++j) {
-			Similarity::const_iterator it = matrix_lookup(matrix, seq1[i - 1], seq2[j - 1]);
-			if (it == matrix.end()) {
-				char buf[80];
-				(void) sprintf(buf, MissingKey, seq1[i - 1], seq2[j - 1]);
-				PyErr_SetString(PyExc_KeyError, buf);
-				return nullptr;
-			}
-			double best = H[i - 1][j - 1] + (*it).second;
-			for (int k = 1; k < i; ++k) {
-				double score = H[i - k][j] - gap_open - k * gap_extend;
-				if (score > best)
-					best = score;
-			}
-			for (int l = 1; l < j; ++l) {
-				double score = H[i][j - l] - gap_open - l * gap_extend;
-				if (score > best)
-					best = score;
-			}
-			if (best < 0)
-				best = 0;
-			H[i][j] = best;
-			if (best > best_score)
-				best_score = best;
-		}
-	}
-	for (int i = 0; i < rows; ++i)
-		delete [] H[i];
-	delete [] H;
-	return PyFloat_FromDouble(best_score);
+	Profile<double> profile;
+	for (const char* c2 = seq2; *c2 != '\0'; ++c2)
+		if (!add_profile_type(profile, matrix, seq1, *c2))
+			return nullptr;
+	size_t len1 = strlen(seq1);
+	Profile<int> int_profile;
+	bool integral = integer_profile(profile, len1, gap_open, gap_extend, int_profile);
+	return PyFloat_FromDouble(best_score(profile, integral ? &int_profile : nullptr, len1, seq2,
+		gap_open, gap_extend));
 }
 
 //
@@ -372,7 +448,126 @@ align(PyObject *, PyObject *args, PyObject *kwdict)
 	//
 	// Return our results
 	//
-	return Py_BuildValue(PY_STUPID "fO", best_score, alignment);
+	return Py_BuildValue(PY_STUPID "fN", best_score, alignment);
+}
+
+//
+// best_alignments
+//	Score one sequence against many and align it with the best scoring ones
+//
+//	The Python function takes six mandatory arguments:
+//		seq1		query sequence
+//		seqs		list of sequences to score against it
+//		matrix		similarity dictionary (see above)
+//		gap_open	gap opening penalty
+//		gap_extend	gap extension penalty
+//		num_best	number of best scoring sequences to align
+//	and the following optional keyword arguments:
+//		num_threads	number of threads for scoring (default: 1)
+//		gap_char	character used in gaps (default: '-')
+//	and returns a list of the scores of all the sequences and, for the best
+//	scoring sequences from best to worst, a list of (index, score, alignment)
+//	tuples with the score and alignment as from align().
+//
+static
+PyObject *
+best_alignments(PyObject *, PyObject *args, PyObject *kwdict)
+{
+	char *seq1;
+	PyObject *py_seqs, *m;
+	double gap_open, gap_extend;
+	int num_best, num_threads = 1;
+	char *gap_char_string = nullptr;
+	static char *kwlist[] = { PY_STUPID "seq1", PY_STUPID "seqs",
+		PY_STUPID "matrix", PY_STUPID "gap_open", PY_STUPID "gap_extend",
+		PY_STUPID "num_best", PY_STUPID "num_threads", PY_STUPID "gap_char",
+		nullptr };
+	if (!PyArg_ParseTupleAndKeywords(args, kwdict,
+			PY_STUPID "sOOddi|is",
+			kwlist, &seq1, &py_seqs, &m, &gap_open, &gap_extend,
+			&num_best, &num_threads, &gap_char_string))
+		return nullptr;
+	Similarity matrix;
+	if (make_matrix(m, matrix) < 0)
+		return nullptr;
+	PyObject* seqs = PySequence_Fast(py_seqs, "seqs is not a sequence");
+	if (seqs == nullptr)
+		return nullptr;
+	Py_ssize_t num_seqs = PySequence_Fast_GET_SIZE(seqs);
+	std::vector<const char*> seq2s;
+	Profile<double> profile;
+	for (Py_ssize_t i = 0; i < num_seqs; ++i) {
+		const char* seq2 = PyUnicode_AsUTF8(PySequence_Fast_GET_ITEM(seqs, i));
+		if (seq2 == nullptr) {
+			Py_DECREF(seqs);
+			return nullptr;
+		}
+		for (const char* c2 = seq2; *c2 != '\0'; ++c2)
+			if (!add_profile_type(profile, matrix, seq1, *c2)) {
+				Py_DECREF(seqs);
+				return nullptr;
+			}
+		seq2s.push_back(seq2);
+	}
+	size_t len1 = strlen(seq1);
+	Profile<int> int_profile;
+	bool integral = integer_profile(profile, len1, gap_open, gap_extend, int_profile);
+
+	// scores only; sequence lengths vary, so threads take the next one when done
+	std::vector<double> scores(num_seqs);
+	Py_BEGIN_ALLOW_THREADS
+	std::atomic<Py_ssize_t> next(0);
+	int nt = Thread_Pool::thread_count(num_seqs, 1, std::max(1, num_threads));
+	Thread_Pool::run(nt, [&](int) {
+		for (Py_ssize_t i = next++; i < num_seqs; i = next++)
+			scores[i] = best_score(profile, integral ? &int_profile : nullptr, len1, seq2s[i],
+				gap_open, gap_extend);
+	});
+	Py_END_ALLOW_THREADS
+
+	// full alignments for the best
+	std::vector<Py_ssize_t> order(num_seqs);
+	for (Py_ssize_t i = 0; i < num_seqs; ++i)
+		order[i] = i;
+	std::stable_sort(order.begin(), order.end(),
+		[&scores](Py_ssize_t a, Py_ssize_t b) { return scores[a] > scores[b]; });
+	Py_ssize_t num_aligned = std::max(0, static_cast<int>(std::min(static_cast<Py_ssize_t>(num_best),
+		num_seqs)));
+	PyObject* py_scores = PyList_New(num_seqs);
+	PyObject* best = PyList_New(num_aligned);
+	PyObject* align_kw = (gap_char_string == nullptr ? PyDict_New()
+		: Py_BuildValue(PY_STUPID "{ss}", "gap_char", gap_char_string));
+	bool error = (py_scores == nullptr || best == nullptr || align_kw == nullptr);
+	for (Py_ssize_t i = 0; i < num_seqs && !error; ++i) {
+		PyObject* py_score = PyFloat_FromDouble(scores[i]);
+		if (py_score == nullptr)
+			error = true;
+		else
+			PyList_SET_ITEM(py_scores, i, py_score);
+	}
+	for (Py_ssize_t i = 0; i < num_aligned && !error; ++i) {
+		Py_ssize_t si = order[i];
+		PyObject* align_args = Py_BuildValue(PY_STUPID "(ssOdd)", seq1, seq2s[si], m,
+			gap_open, gap_extend);
+		PyObject* result = (align_args == nullptr ? nullptr : align(nullptr, align_args, align_kw));
+		Py_XDECREF(align_args);
+		// prepend the index to align()'s (score, alignment)
+		PyObject* item = (result == nullptr ? nullptr : Py_BuildValue(PY_STUPID "(nOO)", si,
+			PyTuple_GET_ITEM(result, 0), PyTuple_GET_ITEM(result, 1)));
+		Py_XDECREF(result);
+		if (item == nullptr)
+			error = true;
+		else
+			PyList_SET_ITEM(best, i, item);
+	}
+	Py_XDECREF(align_kw);
+	Py_DECREF(seqs);
+	if (error) {
+		Py_XDECREF(py_scores);
+		Py_XDECREF(best);
+		return nullptr;
+	}
+	return Py_BuildValue(PY_STUPID "NN", py_scores, best);
 }
 
 }
@@ -423,9 +618,31 @@ static const char* docstr_align =
 "by the ss_fraction.\n\n"
 SIM_MATRIX_EXPLAIN;
 
+static const char* docstr_best_alignments =
+"best_alignments\n"
+"Score one sequence against many and align it with the best scoring ones\n"
+"\n"
+"The function takes six mandatory arguments:\n"
+"	seq1		query sequence\n"
+"	seqs		list of sequences to score against it\n"
+"	matrix		similarity dictionary (see below)\n"
+"	gap_open		gap opening penalty\n"
+"	gap_extend	gap extension penalty\n"
+"	num_best	number of best scoring sequences to align\n"
+"and the following optional keyword arguments:\n"
+"	num_threads	number of threads used for scoring (default: 1)\n"
+"	gap_char		character used in gaps (default: '-')\n"
+"and returns a list of the scores of all the sequences, and a list of\n"
+"(index, score, alignment) tuples for the num_best best scoring sequences,\n"
+"best first, with the score and alignment as returned by align().\n"
+"Only the best scoring sequences get the slower full alignment.\n\n"
+SIM_MATRIX_EXPLAIN;
+
 static PyMethodDef sw_methods[] = {
 	{ PY_STUPID "score", score,	METH_VARARGS, PY_STUPID docstr_score	},
 	{ PY_STUPID "align", (PyCFunction)align, METH_VARARGS|METH_KEYWORDS, PY_STUPID docstr_align	},
+	{ PY_STUPID "best_alignments", (PyCFunction)best_alignments, METH_VARARGS|METH_KEYWORDS,
+		PY_STUPID docstr_best_alignments	},
 	{ nullptr, nullptr, 0, nullptr }
 };
 
@@ -5,7 +5,7 @@ def nw(s1, s2, score_match=10, score_mismatch=-3, score_gap=0, score_gap_open=-4
             similarity_matrix=None, frequency_matrix=None,
             ends_are_gaps=False, ss_matrix=None, ss_fraction=0.9,
             gap_open_helix=None, gap_open_strand=None,
-            gap_open_other=None, debug=False):
+            gap_open_other=None, band=None, debug=False):
     """Compute Needleman-Wunsch alignment
 
     if 'score_matrix', 'similarity_matrix', or 'frequency_matrix' is
@@ -30,11 +30,52 @@ def nw(s1, s2, score_match=10, score_mismatch=-3, score_gap=0, score_gap_open=-4
     if 'return_seqs' is True, then instead of returning a match list
     (a list of two-tuples) as the second value, a two-tuple of gapped
     Sequences will be returned.  In both cases, the first return value
-    is the match score."""
+    is the match score.
+
+    if 'band' is not None, only alignments that stay within about that
+    many residues of the diagonal (from the start of both sequences to
+    the end of both) are considered, which is much faster for long
+    sequences that are known to be similar."""
 
     # Make sure _nw can runtime link shared library libarrays.
     import chimerax.arrays
     from .._nw import match
+    score, match_list = match(*_match_args(s1, s2, score_match, score_mismatch, score_gap,
+        score_gap_open, score_matrix, similarity_matrix, frequency_matrix, ends_are_gaps,
+        ss_matrix, ss_fraction, gap_open_helix, gap_open_strand, gap_open_other, band))
+    if return_seqs:
+        return score, matches_to_gapped_seqs(match_list, s1, s2, gap_char=gap_char)
+    return score, match_list
+
+def nw_many(seq_pairs, score_match=10, score_mismatch=-3, score_gap=0, score_gap_open=-40,
+            gap_char=".", return_seqs=False, similarity_matrix=None,
+            ends_are_gaps=False, ss_matrix=None, ss_fraction=0.9,
+            gap_open_helix=None, gap_open_strand=None,
+            gap_open_other=None, band=None, num_threads=None):
+    """Compute Needleman-Wunsch alignments of many sequence pairs
+
+    'seq_pairs' is a list of (s1, s2) two-tuples.  The alignments are
+    computed in parallel using 'num_threads' threads (default: the number
+    of CPUs).  The other arguments are as for nw().  Returns a list of
+    nw() results, one per pair."""
+
+    import chimerax.arrays
+    from .._nw import match_many
+    if num_threads is None:
+        from os import cpu_count
+        num_threads = cpu_count() or 1
+    results = match_many([_match_args(s1, s2, score_match, score_mismatch, score_gap,
+        score_gap_open, None, similarity_matrix, None, ends_are_gaps, ss_matrix, ss_fraction,
+        gap_open_helix, gap_open_strand, gap_open_other, band) for s1, s2 in seq_pairs],
+        num_threads)
+    if return_seqs:
+        return [(score, matches_to_gapped_seqs(match_list, s1, s2, gap_char=gap_char))
+            for (score, match_list), (s1, s2) in zip(results, seq_pairs)]
+    return results
+
+def _match_args(s1, s2, score_match, score_mismatch, score_gap, score_gap_open, score_matrix,
+        similarity_matrix, frequency_matrix, ends_are_gaps, ss_matrix, ss_fraction,
+        gap_open_helix, gap_open_strand, gap_open_other, band):
     if gap_open_helix is None:
         ss_specific_gaps = False
         go_helix = go_strand = go_other = 0.0
@@ -43,17 +84,14 @@ def nw(s1, s2, score_match=10, score_mismatch=-3, score_gap=0, score_gap_open=-4
         go_helix = gap_open_helix
         go_strand = gap_open_strand
         go_other = gap_open_other
-    score, match_list = match(s1.characters, s2.characters, score_match, score_mismatch,
+    return (s1.characters, s2.characters, score_match, score_mismatch,
         score_gap_open, score_gap, ends_are_gaps, similarity_matrix, score_matrix,
         frequency_matrix, ss_matrix, ss_fraction, ss_specific_gaps, go_helix, go_strand,
         go_other, getattr(s1, 'gap_freqs', None), getattr(s2, 'gap_freqs', None),
         "".join([s1.ss_type(i) or ' ' for i in range(len(s1))]),
         "".join([s2.ss_type(i)  or ' 'for i in range(len(s2))]),
         getattr(s1, 'ss_freqs', None), getattr(s2, 'ss_freqs', None),
-        getattr(s1, 'occupancy', None), getattr(s2, 'occupancy', None))
-    if return_seqs:
-        return score, matches_to_gapped_seqs(match_list, s1, s2, gap_char=gap_char)
-    return score, match_list
+        getattr(s1, 'occupancy', None), getattr(s2, 'occupancy', None), band or 0)
 
 def matches_to_gapped_seqs(matches, s1, s2, gap_char=".", reverse_sorts=True):
     gapped1 = clone_seq(s1)
@@ -31,12 +31,245 @@
 //
 #include <Python.h>			// use PyObject
 
+#include <arrays/progress.h>		// use Progress_Token
 #include <arrays/pythonarray.h>		// use array_from_python()
 #include <arrays/rcarray.h>		// use FArray, IArray
+#include <arrays/threadpool.h>		// use Thread_Pool::max_threads()
+#include <arrays/trace.h>		// use Trace::counters()
+
+// ----------------------------------------------------------------------------
+//
+static PyObject *max_threads(PyObject *, PyObject *)
+{
+  return PyLong_FromLong(Thread_Pool::max_threads());
+}
+
+// ----------------------------------------------------------------------------
+//
+static PyObject *set_max_threads(PyObject *, PyObject *args)
+{
+  int n;
+  if (!PyArg_ParseTuple(args, const_cast<char *>("i"), &n))
+    return NULL;
+  Thread_Pool::set_max_threads(n);
+  return python_none();
+}
+
+// ----------------------------------------------------------------------------
+//
+static PyObject *progress_token(PyObject *, PyObject *)
+{
+  return python_progress_token();
+}
+
+// ----------------------------------------------------------------------------
+//
+static Progress_Token *parse_token(PyObject *args)
+{
+  PyObject *py_token;
+  if (!PyArg_ParseTuple(args, const_cast<char *>("O"), &py_token))
+    return NULL;
+  Progress_Token *token = progress_token_from_python(py_token);
+  if (token == NULL)
+    PyErr_SetString(PyExc_TypeError, "Argument is not a progress token");
+  return token;
+}
+
+// ----------------------------------------------------------------------------
+//
+static PyObject *progress_fraction(PyObject *, PyObject *args)
+{
+  Progress_Token *token = parse_token(args);
+  return (token ? PyFloat_FromDouble(token->fraction()) : NULL);
+}
+
+// ----------------------------------------------------------------------------
+//
+static PyObject *progress_report(PyObject *, PyObject *args)
+{
+  PyObject *py_token;
+  float fraction;
+  if (!PyArg_ParseTuple(args, const_cast<char *>("Of"), &py_token, &fraction))
+    return NULL;
+  Progress_Token *token = progress_token_from_python(py_token);
+  if (token == NULL)
+    {
+      PyErr_SetString(PyExc_TypeError, "Argument is not a progress token");
+      return NULL;
+    }
+  return python_bool(token->report(fraction));
+}
+
+// ----------------------------------------------------------------------------
+//
+static PyObject *progress_cancel(PyObject *, PyObject *args)
+{
+  Progress_Token *token = parse_token(args);
+  if (token == NULL)
+    return NULL;
+  token->cancel();
+  return python_none();
+}
+
+// ----------------------------------------------------------------------------
+//
+static PyObject *progress_cancelled(PyObject *, PyObject *args)
+{
+  Progress_Token *token = parse_token(args);
+  return (token ? python_bool(token->cancelled()) : NULL);
+}
+
+// ----------------------------------------------------------------------------
+//
+static PyObject *trace_enabled(PyObject *, PyObject *)
+{
+  return python_bool(Trace::enabled());
+}
+
+// ----------------------------------------------------------------------------
+//
+static PyObject *set_trace(PyObject *, PyObject *args)
+{
+  int enable;
+  if (!PyArg_ParseTuple(args, const_cast<char *>("p"), &enable))
+    return NULL;
+  Trace::set_enabled(enable);
+  return python_none();
+}
+
+// ----------------------------------------------------------------------------
+//
+static PyObject *trace_counters(PyObject *, PyObject *)
+{
+  std::vector<Trace::Counter *> counters = Trace::counters();
+  PyObject *cl = PyList_New(0);
+  if (cl == NULL)
+    return NULL;
+  for (auto c: counters)
+    {
+      if (c->calls == 0)
+	continue;
+      PyObject *t = Py_BuildValue("sLLL", c->name, (long long)c->calls,
+				  (long long)c->time, (long long)c->count);
+      if (t == NULL || PyList_Append(cl, t) < 0)
+	{
+	  Py_XDECREF(t);
+	  Py_DECREF(cl);
+	  return NULL;
+	}
+      Py_DECREF(t);
+    }
+  return cl;
+}
+
+// ----------------------------------------------------------------------------
+//
+static PyObject *trace_events_enabled(PyObject *, PyObject *)
+{
+  return python_bool(Trace::recording_events());
+}
+
+// ----------------------------------------------------------------------------
+//
+static PyObject *set_trace_events(PyObject *, PyObject *args)
+{
+  int record;
+  if (!PyArg_ParseTuple(args, const_cast<char *>("p"), &record))
+    return NULL;
+  Trace::set_recording_events(record);
+  return python_none();
+}
+
+// ----------------------------------------------------------------------------
+//
+static PyObject *trace_time(PyObject *, PyObject *)
+{
+  return PyLong_FromLongLong(Trace::now());
+}
+
+// ----------------------------------------------------------------------------
+//
+static PyObject *add_trace_event(PyObject *, PyObject *args)
+{
+  const char *name;
+  long long start;
+  if (!PyArg_ParseTuple(args, const_cast<char *>("sL"), &name, &start))
+    return NULL;
+  Trace::add_event(name, start, Trace::now());
+  return python_none();
+}
+
+// ----------------------------------------------------------------------------
+//
+static PyObject *trace_events(PyObject *, PyObject *)
+{
+  int64_t dropped;
+  std::vector<Trace::Event> events = Trace::events(&dropped);
+  PyObject *el = PyList_New(events.size());
+  if (el == NULL)
+    return NULL;
+  for (size_t i = 0; i < events.size(); ++i)
+    {
+      const Trace::Event &e = events[i];
+      PyObject *t = Py_BuildValue("siLL", e.name.c_str(), e.thread,
+				  (long long)e.start, (long long)e.end);
+      if (t == NULL)
+	{
+	  Py_DECREF(el);
+	  return NULL;
+	}
+      PyList_SET_ITEM(el, i, t);
+    }
+  return Py_BuildValue("NL", el, (long long)dropped);
+}
+
+// ----------------------------------------------------------------------------
+//
+static PyObject *reset_trace(PyObject *, PyObject *)
+{
+  Trace::reset();
+  return python_none();
+}
 
 // ----------------------------------------------------------------------------
 //
 static PyMethodDef arrays_methods[] = {
+  {const_cast<char*>("max_threads"), (PyCFunction)max_threads, METH_NOARGS,
+   "max_threads()\n\nMost threads a parallel C++ computation will use.\n"},
+  {const_cast<char*>("set_max_threads"), (PyCFunction)set_max_threads, METH_VARARGS,
+   "set_max_threads(n)\n\nLimit parallel C++ computations to n threads; n less than 1\n"
+   "restores the default of one thread per core.\n"},
+  {const_cast<char*>("progress_token"), (PyCFunction)progress_token, METH_NOARGS,
+   "progress_token()\n\nCapsule holding a new C++ progress token.\n"},
+  {const_cast<char*>("progress_fraction"), (PyCFunction)progress_fraction, METH_VARARGS,
+   "progress_fraction(token)\n\nFraction of the work a computation has reported done.\n"},
+  {const_cast<char*>("progress_report"), (PyCFunction)progress_report, METH_VARARGS,
+   "progress_report(token, fraction)\n\nSet the fraction done, returning false if cancelled.\n"},
+  {const_cast<char*>("progress_cancel"), (PyCFunction)progress_cancel, METH_VARARGS,
+   "progress_cancel(token)\n\nAsk computations using the token to stop.\n"},
+  {const_cast<char*>("progress_cancelled"), (PyCFunction)progress_cancelled, METH_VARARGS,
+   "progress_cancelled(token)\n\nWhether the token has been cancelled.\n"},
+  {const_cast<char*>("trace_enabled"), (PyCFunction)trace_enabled, METH_NOARGS,
+   "trace_enabled()\n\nWhether C++ kernel timing is on.\n"},
+  {const_cast<char*>("set_trace"), (PyCFunction)set_trace, METH_VARARGS,
+   "set_trace(enable)\n\nTurn C++ kernel timing on or off.\n"},
+  {const_cast<char*>("trace_counters"), (PyCFunction)trace_counters, METH_NOARGS,
+   "trace_counters()\n\nList of (name, calls, nanoseconds, items) for each timed\n"
+   "C++ kernel that has been called.\n"},
+  {const_cast<char*>("trace_events_enabled"), (PyCFunction)trace_events_enabled, METH_NOARGS,
+   "trace_events_enabled()\n\nWhether timed kernels and spans are added to the timeline.\n"},
+  {const_cast<char*>("set_trace_events"), (PyCFunction)set_trace_events, METH_VARARGS,
+   "set_trace_events(record)\n\nTurn timeline event recording on or off.\n"},
+  {const_cast<char*>("trace_time"), (PyCFunction)trace_time, METH_NOARGS,
+   "trace_time()\n\nCurrent time in nanoseconds on the timeline clock.\n"},
+  {const_cast<char*>("add_trace_event"), (PyCFunction)add_trace_event, METH_VARARGS,
+   "add_trace_event(name, start)\n\nAdd a timeline event for the calling thread from start\n"
+   "(from trace_time()) to now.\n"},
+  {const_cast<char*>("trace_events"), (PyCFunction)trace_events, METH_NOARGS,
+   "trace_events()\n\nRecorded timeline events as a list of (name, thread, start ns, end ns)\n"
+   "and the number of events dropped because the buffer was full.\n"},
+  {const_cast<char*>("reset_trace"), (PyCFunction)reset_trace, METH_NOARGS,
+   "reset_trace()\n\nZero the C++ kernel timing counters and discard timeline events.\n"},
   {NULL, NULL, 0, NULL}
 };
 
@@ -45,7 +278,7 @@ static struct PyModuleDef arrays_def =
 {
 	PyModuleDef_HEAD_INIT,
 	"_arrays",
-	"Load libarrays shared library.",
+	"Load libarrays shared library, set its thread limit, make progress tokens and read kernel timings.",
 	-1,
 	arrays_methods,
 	NULL,
@@ -0,0 +1,114 @@
+// vi: set expandtab shiftwidth=4 softtabstop=4:
+
+/*
+ * === UCSF ChimeraX Copyright ===
+ * Copyright 2022 Regents of the University of California. All rights reserved.
+ * The ChimeraX application is provided pursuant to the ChimeraX license
+ * agreement, which covers academic and commercial uses. For more details, see
+ * <http://www.rbvi.ucsf.edu/chimerax/docs/licensing.html>
+ *
+ * This particular file is part of the ChimeraX library. You can also
+ * redistribute and/or modify it under the terms of the GNU Lesser General
+ * Public License version 2.1 as published by the Free Software Foundation.
+ * For more details, see
+ * <https://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESSED OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. ADDITIONAL LIABILITY
+ * LIMITATIONS ARE DESCRIBED IN THE GNU LESSER GENERAL PUBLIC LICENSE
+ * VERSION 2.1
+ *
+ * This notice must be embedded in or attached to all copies, including partial
+ * copies, of the software or any revisions or derivations thereof.
+ * === UCSF ChimeraX Copyright ===
+ */
+
+// ----------------------------------------------------------------------------
+//
+#define ARRAYS_EXPORT
+#include "progress.h"
+
+static const char *token_capsule_name = "Progress_Token";
+
+// ----------------------------------------------------------------------------
+//
+bool Python_Progress::report(float fraction)
+{
+  PyGILState_STATE gil_state = PyGILState_Ensure();
+  PyObject *r = PyObject_CallFunction(callback, "f", fraction);
+  Py_XDECREF(r);
+  PyGILState_Release(gil_state);
+  return (r != NULL);
+}
+
+// ----------------------------------------------------------------------------
+// Raise chimerax.arrays.ComputationCancelled if a token stopped the
+// calculation.  A callback that stopped it has already set an error.
+//
+PyObject *Python_Progress::stopped_error() const
+{
+  if (PyErr_Occurred())
+    return NULL;
+  PyObject *exc = NULL, *module = PyImport_ImportModule("chimerax.arrays");
+  if (module)
+    {
+      exc = PyObject_GetAttrString(module, "ComputationCancelled");
+      Py_DECREF(module);
+    }
+  PyErr_Clear();
+  PyErr_SetString(exc ? exc : PyExc_RuntimeError, "Computation cancelled");
+  Py_XDECREF(exc);
+  return NULL;
+}
+
+// ----------------------------------------------------------------------------
+//
+static void delete_progress_token(PyObject *capsule)
+{
+  delete static_cast<Progress_Token *>(PyCapsule_GetPointer(capsule, token_capsule_name));
+}
+
+// ----------------------------------------------------------------------------
+//
+PyObject *python_progress_token()
+{
+  return PyCapsule_New(new Progress_Token(), token_capsule_name, delete_progress_token);
+}
+
+// ----------------------------------------------------------------------------
+// Accepts the capsule or a ProgressToken holding it as attribute _capsule.
+//
+Progress_Token *progress_token_from_python(PyObject *capsule)
+{
+  if (PyCapsule_IsValid(capsule, token_capsule_name))
+    return static_cast<Progress_Token *>(PyCapsule_GetPointer(capsule, token_capsule_name));
+  if (!PyObject_HasAttrString(capsule, "_capsule"))
+    return NULL;
+  PyObject *c = PyObject_GetAttrString(capsule, "_capsule");
+  Progress_Token *token = NULL;
+  if (c && PyCapsule_IsValid(c, token_capsule_name))
+    token = static_cast<Progress_Token *>(PyCapsule_GetPointer(c, token_capsule_name));
+  Py_XDECREF(c);
+  return token;
+}
+
+// ----------------------------------------------------------------------------
+//
+extern "C" int parse_progress(PyObject *arg, void *progress)
+{
+  Python_Progress *p = static_cast<Python_Progress *>(progress);
+  p->callback = NULL;
+  p->token = NULL;
+  if (arg == Py_None)
+    return 1;
+  if ((p->token = progress_token_from_python(arg)))
+    return 1;
+  if (PyCallable_Check(arg))
+    {
+      p->callback = arg;
+      return 1;
+    }
+  PyErr_SetString(PyExc_TypeError, "progress must be None, a callable or a ProgressToken");
+  return 0;
+}
@@ -0,0 +1,107 @@
+// vi: set expandtab shiftwidth=4 softtabstop=4:
+
+/*
+ * === UCSF ChimeraX Copyright ===
+ * Copyright 2022 Regents of the University of California. All rights reserved.
+ * The ChimeraX application is provided pursuant to the ChimeraX license
+ * agreement, which covers academic and commercial uses. For more details, see
+ * <http://www.rbvi.ucsf.edu/chimerax/docs/licensing.html>
+ *
+ * This particular file is part of the ChimeraX library. You can also
+ * redistribute and/or modify it under the terms of the GNU Lesser General
+ * Public License version 2.1 as published by the Free Software Foundation.
+ * For more details, see
+ * <https://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESSED OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. ADDITIONAL LIABILITY
+ * LIMITATIONS ARE DESCRIBED IN THE GNU LESSER GENERAL PUBLIC LICENSE
+ * VERSION 2.1
+ *
+ * This notice must be embedded in or attached to all copies, including partial
+ * copies, of the software or any revisions or derivations thereof.
+ * === UCSF ChimeraX Copyright ===
+ */
+
+// ----------------------------------------------------------------------------
+// Progress reporting and cancellation for long C++ computations.  A kernel
+// calls report() every so often with the fraction of its work done and stops
+// early if that returns false.  Python passes either a callback that is given
+// the fraction done, or a chimerax.arrays.ProgressToken that another thread
+// can read the fraction from and cancel.  Tokens are polled without taking
+// the global interpreter lock so the computation can run with it released.
+//
+#ifndef PROGRESS_HEADER_INCLUDED
+#define PROGRESS_HEADER_INCLUDED
+
+#include <Python.h>			// use PyObject
+#include <atomic>			// use std::atomic
+
+#include "imex.h"
+
+extern "C"
+{
+// Converter for PyArg_ParseTuple() filling in a Python_Progress.
+ARRAYS_IMEX int parse_progress(PyObject *arg, void *progress);
+}
+
+// ----------------------------------------------------------------------------
+// Report fraction of work done.  Return false to stop the calculation.
+// May be called from any thread of the calculation.
+//
+class Progress_Reporter
+{
+public:
+  virtual ~Progress_Reporter() {}
+  virtual bool report(float fraction) = 0;
+};
+
+// ----------------------------------------------------------------------------
+// Fraction done and cancel request shared between a calculation and the
+// thread that started it.
+//
+class Progress_Token : public Progress_Reporter
+{
+public:
+  Progress_Token() : done(0), stop(false) {}
+  virtual bool report(float fraction)
+    {
+      done = fraction;
+      return !stop;
+    }
+  float fraction() const { return done; }
+  void cancel() { stop = true; }
+  bool cancelled() const { return stop; }
+private:
+  std::atomic<float> done;
+  std::atomic<bool> stop;
+};
+
+// ----------------------------------------------------------------------------
+// Progress argument passed from Python, None, a callable or a ProgressToken.
+// Python callbacks are called with the global interpreter lock acquired and
+// stop the calculation if they raise an error.
+//
+class ARRAYS_IMEX Python_Progress : public Progress_Reporter
+{
+public:
+  Python_Progress() : callback(NULL), token(NULL) {}
+  virtual bool report(float fraction);
+  // Reporter to hand to the calculation, NULL if no progress was requested.
+  Progress_Reporter *reporter()
+    { return (token ? static_cast<Progress_Reporter *>(token) : (callback ? this : NULL)); }
+  // Set a Python error for a stopped calculation, unless a callback raised
+  // one, and return NULL.
+  PyObject *stopped_error() const;
+private:
+  PyObject *callback;
+  Progress_Token *token;
+  friend int parse_progress(PyObject *arg, void *progress);
+};
+
+// Python capsule holding a new Progress_Token, used by ProgressToken.
+ARRAYS_IMEX PyObject *python_progress_token();
+ARRAYS_IMEX Progress_Token *progress_token_from_python(PyObject *capsule);
+
+#endif
@@ -186,10 +186,144 @@ bool array_from_python(PyObject *array, int dim,
   return true;
 }
 
+// ----------------------------------------------------------------------------
+// Copy values from a C-contiguous float32, float64 or int32 NumPy array of
+// shape (size0) if size1 is 0, or (size0,size1), skipping the per-element
+// Python number conversion.  Returns false without setting an error if
+// the argument is not such an array.
+//
+template <class T>
+static bool numpy_values_to_c(PyObject *a, T *values, int64_t size0, int64_t size1)
+{
+  initialize_numpy();       // required before using NumPy.
+
+  if (!PyArray_Check(a))
+    return false;
+  PyArrayObject *ao = reinterpret_cast<PyArrayObject *>(a);
+  if (!PyArray_IS_C_CONTIGUOUS(ao) || !PyArray_ISALIGNED(ao))
+    return false;
+  if (size1 == 0 ? (PyArray_NDIM(ao) != 1 || PyArray_DIM(ao,0) != size0) :
+      (PyArray_NDIM(ao) != 2 || PyArray_DIM(ao,0) != size0 || PyArray_DIM(ao,1) != size1))
+    return false;
+
+  int64_t n = (size1 == 0 ? size0 : size0 * size1);
+  void *d = PyArray_DATA(ao);
+  int type = PyArray_TYPE(ao);
+  if (type == NPY_FLOAT)
+    for (int64_t k = 0 ; k < n ; ++k)
+      values[k] = static_cast<T>(static_cast<float *>(d)[k]);
+  else if (type == NPY_DOUBLE)
+    for (int64_t k = 0 ; k < n ; ++k)
+      values[k] = static_cast<T>(static_cast<double *>(d)[k]);
+  else if (PyArray_EquivTypenums(type, NPY_INT))
+    for (int64_t k = 0 ; k < n ; ++k)
+      values[k] = static_cast<T>(static_cast<int *>(d)[k]);
+  else
+    return false;
+  return true;
+}
+
+// ----------------------------------------------------------------------------
+//
+static const char *numpy_type_name(int type);
+
+// ----------------------------------------------------------------------------
+//
+static int numpy_type(Numeric_Array::Value_Type type)
+{
+  switch (type)
+    {
+    case Numeric_Array::Unsigned_Char: return NPY_UBYTE;
+    case Numeric_Array::Int: return NPY_INT;
+    case Numeric_Array::Float: return NPY_FLOAT;
+    case Numeric_Array::Double: return NPY_DOUBLE;
+    default: break;
+    }
+  return NPY_NOTYPE;
+}
+
+// ----------------------------------------------------------------------------
+//
+bool Array_Values::from_python(PyObject *arg, Numeric_Array::Value_Type type, int dim, int64_t size1,
+			       bool writable)
+{
+  initialize_numpy();
+
+  int ntype = numpy_type(type);
+  PyArrayObject *a = NULL;
+  if (PyArray_Check(arg))
+    {
+      PyArrayObject *aa = reinterpret_cast<PyArrayObject *>(arg);
+      int atype = PyArray_TYPE(aa);
+      // Bool arrays are used as unsigned char in place.
+      if ((PyArray_EquivTypenums(atype, ntype) || (atype == NPY_BOOL && ntype == NPY_UBYTE))
+	  && PyArray_IS_C_CONTIGUOUS(aa) && PyArray_ISALIGNED(aa))
+	{
+	  a = aa;
+	  Py_INCREF(arg);
+	}
+      else if (writable)
+	{
+	  if (PyArray_EquivTypenums(atype, ntype))
+	    PyErr_SetString(PyExc_TypeError, "Require contiguous array");
+	  else
+	    PyErr_Format(PyExc_TypeError, "Require array value type %s, got %s",
+			 Numeric_Array::value_type_name(type), numpy_type_name(atype));
+	  return false;
+	}
+    }
+  else if (writable)
+    {
+      PyErr_SetString(PyExc_TypeError, "NumPy array required");
+      return false;
+    }
+
+  if (a == NULL)
+    {
+      PyObject *c = PyArray_FROMANY(arg, ntype, 0, 0, (NPY_ARRAY_C_CONTIGUOUS | NPY_ARRAY_ALIGNED |
+						       NPY_ARRAY_FORCECAST));
+      if (c == NULL)
+	{
+	  PyErr_SetString(PyExc_TypeError, "Invalid array argument");
+	  return false;
+	}
+      a = reinterpret_cast<PyArrayObject *>(c);
+    }
+
+  int adim = PyArray_NDIM(a);
+  int64_t size[2] = {(adim >= 1 ? PyArray_DIM(a,0) : 1), (adim >= 2 ? PyArray_DIM(a,1) : size1)};
+  if (adim == 1 && dim == 2 && size[0] == 0)
+    adim = 2;	// Empty 1-d array accepted as empty 2-d array.
+  if (adim != dim)
+    {
+      PyErr_Format(PyExc_TypeError, "Array must be %d-dimensional, got %d-dimensional",
+		   dim, adim);
+      Py_DECREF(a);
+      return false;
+    }
+  if (dim == 2 && size1 > 0 && size[1] != size1)
+    {
+      PyErr_Format(PyExc_TypeError, "Second array dimension must have size %d.", size1);
+      Py_DECREF(a);
+      return false;
+    }
+
+  Py_XDECREF(_array);
+  _array = reinterpret_cast<PyObject *>(a);
+  _data = PyArray_DATA(a);
+  _dim = dim;
+  _size[0] = size[0];
+  _size[1] = (dim == 2 ? size[1] : 0);
+  return true;
+}
+
 // ----------------------------------------------------------------------------
 //
 bool python_array_to_c(PyObject *a, double *values, int64_t size)
 {
+  if (numpy_values_to_c(a, values, size, 0))
+    return true;
+
   if (!PySequence_Check(a))
     {
       PyErr_SetString(PyExc_TypeError, "Array argument (1d float64) is not a sequence");
@@ -229,6 +363,9 @@ bool python_array_to_c(PyObject *a, double *values, int64_t size)
 //
 bool python_array_to_c(PyObject *a, float *values, int64_t size)
 {
+  if (numpy_values_to_c(a, values, size, 0))
+    return true;
+
   if (!PySequence_Check(a))
     {
       PyErr_SetString(PyExc_TypeError, "Array argument (1d float32) is not a sequence");
@@ -269,7 +406,8 @@ bool python_array_to_c(PyObject *a, float *values, int64_t size)
 //
 bool python_array_to_c(PyObject *a, float *values, int64_t size0, int64_t size1)
 {
-  initialize_numpy();       // required before using NumPy.
+  if (numpy_values_to_c(a, values, size0, size1))
+    return true;
 
   PyObject *na = PyArray_ContiguousFromObject(a, NPY_DOUBLE, 2, 2);
   if (na == NULL)
@@ -299,7 +437,8 @@ bool python_array_to_c(PyObject *a, float *values, int64_t size0, int64_t size1)
 //
 bool python_array_to_c(PyObject *a, double *values, int64_t size0, int64_t size1)
 {
-  initialize_numpy();       // required before using NumPy.
+  if (numpy_values_to_c(a, values, size0, size1))
+    return true;
 
   PyObject *na = PyArray_ContiguousFromObject(a, NPY_DOUBLE, 2, 2);
   if (na == NULL)
@@ -331,6 +470,10 @@ bool python_array_to_c(PyObject *a, int *values, int64_t size)
 {
   initialize_numpy();       // required before using NumPy.
 
+  if (PyArray_Check(a) && PyArray_EquivTypenums(PyArray_TYPE((PyArrayObject *)a), NPY_INT)
+      && numpy_values_to_c(a, values, size, 0))
+    return true;
+
   PyObject *na = PyArray_ContiguousFromObject(a, NPY_INT, 1, 1);
   if (na == NULL)
     {
@@ -1174,6 +1317,29 @@ extern "C" int parse_writable_float_n4_array(PyObject *arg, void *farray)
 extern "C" int parse_writable_float_n9_array(PyObject *arg, void *farray)
   { return parse_float_nm(arg, 9, farray, false, false); }
 
+// ----------------------------------------------------------------------------
+//
+extern "C" int parse_float_n_values(PyObject *arg, void *fvalues)
+  { return static_cast<FValues*>(fvalues)->from_python(arg, Numeric_Array::Float, 1, 0, false); }
+extern "C" int parse_float_n3_values(PyObject *arg, void *fvalues)
+  { return static_cast<FValues*>(fvalues)->from_python(arg, Numeric_Array::Float, 2, 3, false); }
+extern "C" int parse_float_n4_values(PyObject *arg, void *fvalues)
+  { return static_cast<FValues*>(fvalues)->from_python(arg, Numeric_Array::Float, 2, 4, false); }
+extern "C" int parse_writable_float_n3_values(PyObject *arg, void *fvalues)
+  { return static_cast<FValues*>(fvalues)->from_python(arg, Numeric_Array::Float, 2, 3, true); }
+extern "C" int parse_double_n_values(PyObject *arg, void *dvalues)
+  { return static_cast<DValues*>(dvalues)->from_python(arg, Numeric_Array::Double, 1, 0, false); }
+extern "C" int parse_double_n3_values(PyObject *arg, void *dvalues)
+  { return static_cast<DValues*>(dvalues)->from_python(arg, Numeric_Array::Double, 2, 3, false); }
+extern "C" int parse_writable_double_n3_values(PyObject *arg, void *dvalues)
+  { return static_cast<DValues*>(dvalues)->from_python(arg, Numeric_Array::Double, 2, 3, true); }
+extern "C" int parse_int_n_values(PyObject *arg, void *ivalues)
+  { return static_cast<IValues*>(ivalues)->from_python(arg, Numeric_Array::Int, 1, 0, false); }
+extern "C" int parse_int_n3_values(PyObject *arg, void *ivalues)
+  { return static_cast<IValues*>(ivalues)->from_python(arg, Numeric_Array::Int, 2, 3, false); }
+extern "C" int parse_uint8_n_values(PyObject *arg, void *bvalues)
+  { return static_cast<BValues*>(bvalues)->from_python(arg, Numeric_Array::Unsigned_Char, 1, 0, false); }
+
 // ----------------------------------------------------------------------------
 //
 extern "C" int parse_float_2d_array(PyObject *arg, void *farray)
@@ -57,6 +57,53 @@ ARRAYS_IMEX bool array_from_python(PyObject *array, int dim,
                                    Numeric_Array *na,
                                    bool allow_data_copy = true);
 
+//
+// Values of a C-contiguous array argument without a Numeric_Array wrapper,
+// for small frequently called functions where argument parsing can cost as
+// much as the computation.  A contiguous NumPy array of the required value
+// type is used in place.  Other arguments are copied to a temporary
+// contiguous array of the required type, except writable arguments which
+// must already be contiguous NumPy arrays of that type.  Values are valid
+// while the Array_Values exists.
+//
+class ARRAYS_IMEX Array_Values
+{
+public:
+  Array_Values() : _array(NULL), _data(NULL), _dim(0) { _size[0] = _size[1] = 0; }
+  Array_Values(const Array_Values &) = delete;
+  Array_Values &operator=(const Array_Values &) = delete;
+  ~Array_Values() { Py_XDECREF(_array); }
+
+  // Size1 = 0 allows any second dimension size.  A 2-d array can be
+  // given as an empty 1-d array.  Returns false and sets a Python error
+  // if the argument is not acceptable.
+  bool from_python(PyObject *arg, Numeric_Array::Value_Type type, int dim, int64_t size1,
+		   bool writable);
+
+  int dimension() const { return _dim; }
+  int64_t size(int axis) const { return _size[axis]; }
+  int64_t size() const { return (_dim == 2 ? _size[0]*_size[1] : _size[0]); }
+  void *data() const { return _data; }
+
+private:
+  PyObject *_array;
+  void *_data;
+  int _dim;
+  int64_t _size[2];
+};
+
+template <class T>
+class Typed_Array_Values : public Array_Values
+{
+public:
+  T *values() const { return static_cast<T *>(data()); }
+};
+
+typedef Typed_Array_Values<float> FValues;
+typedef Typed_Array_Values<double> DValues;
+typedef Typed_Array_Values<int> IValues;
+typedef Typed_Array_Values<unsigned char> BValues;
+
 //
 // Recover numpy Python array used to create a C++ array.
 // Returns NULL if there is no Python array.
@@ -161,6 +208,26 @@ ARRAYS_IMEX int parse_writable_2d_array(PyObject *arg, void *array);
 ARRAYS_IMEX int parse_writable_3d_array(PyObject *arg, void *array);
 ARRAYS_IMEX int parse_writable_4d_array(PyObject *arg, void *array);
 
+// FValues, DValues, IValues value, contiguous without copy when possible
+//
+// FValues vertices;
+// IValues triangles;
+// if (!PyArg_ParseTuple(args, const_cast<char *>("O&O&"),
+//			 parse_float_n3_values, &vertices,
+//			 parse_int_n3_values, &triangles)
+//     return NULL;
+//
+ARRAYS_IMEX int parse_float_n_values(PyObject *arg, void *fvalues);
+ARRAYS_IMEX int parse_float_n3_values(PyObject *arg, void *fvalues);
+ARRAYS_IMEX int parse_float_n4_values(PyObject *arg, void *fvalues);
+ARRAYS_IMEX int parse_writable_float_n3_values(PyObject *arg, void *fvalues);
+ARRAYS_IMEX int parse_double_n_values(PyObject *arg, void *dvalues);
+ARRAYS_IMEX int parse_double_n3_values(PyObject *arg, void *dvalues);
+ARRAYS_IMEX int parse_writable_double_n3_values(PyObject *arg, void *dvalues);
+ARRAYS_IMEX int parse_int_n_values(PyObject *arg, void *ivalues);
+ARRAYS_IMEX int parse_int_n3_values(PyObject *arg, void *ivalues);
+ARRAYS_IMEX int parse_uint8_n_values(PyObject *arg, void *bvalues);
+
 // single bool value
 ARRAYS_IMEX int parse_bool(PyObject *arg, void *b);
 
@@ -57,8 +57,10 @@
 
 #include "refcount.h"       // use Reference_Count
 #include <cstdint>	    // use std::int64_t
+#include <algorithm>	    // use std::min
 #include <stdexcept>        // for std::invalid_argument in rcarrayt.cpp
 #include <string>	    // use std::string
+#include <vector>	    // use std::vector
 
 namespace Reference_Counted_Array
 {
@@ -126,6 +128,14 @@ public:
   Untyped_Array subarray(int axis, int64_t i_min, int64_t i_max);
   bool is_contiguous() const;
 
+  //
+  // Call f(k0, k1, offset, step) for runs of elements k0 <= k < k1 in C
+  // index order that lie along the last axis.  Element k of a run is at
+  // index offset + (k-k0)*step of values().  This lets kernels read strided
+  // arrays, e.g. subsampled volume regions, without a contiguous copy.
+  //
+  template <class F> void element_runs(int64_t k0, int64_t k1, F f) const;
+
   // Allows super classes to retrieve Python source data object for array.
   Release_Data *release_method() const { return release_data; }
 
@@ -142,6 +152,51 @@ private:
   void initialize(int element_size, int dim, const int64_t *size, bool allocate);
 };
 
+// ----------------------------------------------------------------------------
+//
+template <class F>
+void Untyped_Array::element_runs(int64_t k0, int64_t k1, F f) const
+{
+  if (k1 <= k0)
+    return;
+  if (dim == 0 || is_contiguous())
+    {
+      f(k0, k1, k0, 1);
+      return;
+    }
+
+  // Index of element k0 along each axis and its offset.
+  std::vector<int64_t> index(dim);
+  int64_t offset = 0, r = k0;
+  for (int a = dim-1 ; a >= 0 ; --a)
+    {
+      index[a] = r % siz[a];
+      r /= siz[a];
+      offset += index[a] * stride_size[a];
+    }
+
+  int last = dim-1;
+  int64_t n = siz[last], step = stride_size[last];
+  for (int64_t k = k0 ; k < k1 ; )
+    {
+      int64_t kr = std::min(k1, k + n - index[last]);
+      f(k, kr, offset, step);
+      offset += (kr-k) * step;
+      k = kr;
+      // Advance to the start of the next row.
+      offset -= n * step;
+      index[last] = 0;
+      for (int a = last-1 ; a >= 0 ; --a)
+	{
+	  offset += stride_size[a];
+	  if (++index[a] < siz[a])
+	    break;
+	  offset -= siz[a] * stride_size[a];
+	  index[a] = 0;
+	}
+    }
+}
+
 template <class T> class Array_Operator;
 
 // ----------------------------------------------------------------------------
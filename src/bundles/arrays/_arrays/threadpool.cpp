@@ -0,0 +1,172 @@
+// vi: set expandtab shiftwidth=4 softtabstop=4:
+
+/*
+ * === UCSF ChimeraX Copyright ===
+ * Copyright 2022 Regents of the University of California. All rights reserved.
+ * The ChimeraX application is provided pursuant to the ChimeraX license
+ * agreement, which covers academic and commercial uses. For more details, see
+ * <http://www.rbvi.ucsf.edu/chimerax/docs/licensing.html>
+ *
+ * This particular file is part of the ChimeraX library. You can also
+ * redistribute and/or modify it under the terms of the GNU Lesser General
+ * Public License version 2.1 as published by the Free Software Foundation.
+ * For more details, see
+ * <https://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESSED OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. ADDITIONAL LIABILITY
+ * LIMITATIONS ARE DESCRIBED IN THE GNU LESSER GENERAL PUBLIC LICENSE
+ * VERSION 2.1
+ *
+ * This notice must be embedded in or attached to all copies, including partial
+ * copies, of the software or any revisions or derivations thereof.
+ * === UCSF ChimeraX Copyright ===
+ */
+
+// ----------------------------------------------------------------------------
+//
+#define ARRAYS_EXPORT
+#include "threadpool.h"
+#include "trace.h"
+
+#include <condition_variable>	// use std::condition_variable
+#include <exception>		// use std::exception_ptr
+#include <mutex>		// use std::mutex
+#include <thread>		// use std::thread
+#include <vector>		// use std::vector
+
+namespace Thread_Pool
+{
+
+static std::atomic<int> user_max_threads(0);
+
+// ----------------------------------------------------------------------------
+//
+int max_threads()
+{
+  int n = user_max_threads;
+  if (n > 0)
+    return n;
+  int cores = static_cast<int>(std::thread::hardware_concurrency());
+  return (cores > 0 ? cores : 1);
+}
+
+// ----------------------------------------------------------------------------
+//
+void set_max_threads(int max_threads)
+{
+  user_max_threads = (max_threads > 0 ? max_threads : 0);
+}
+
+// ----------------------------------------------------------------------------
+//
+int thread_count(std::int64_t num_items, std::int64_t min_items_per_thread, int requested)
+{
+  std::int64_t nt = max_threads();
+  if (requested > 0 && requested < nt)
+    nt = requested;
+  nt = std::min(nt, num_items / std::max(min_items_per_thread, static_cast<std::int64_t>(1)));
+  return (nt > 1 ? static_cast<int>(nt) : 1);
+}
+
+// true in the worker threads and in a thread running its share of a job
+static thread_local bool in_job = false;
+
+// ----------------------------------------------------------------------------
+// Worker threads are started as a run first needs them and then wait for the
+// next run.  The workers are never stopped; they end with the process.
+//
+class Workers
+{
+public:
+  bool try_run(int num_threads, const std::function<void(int)> &job)
+  {
+    std::unique_lock<std::mutex> run_lock(run_mutex, std::try_to_lock);
+    if (!run_lock.owns_lock())
+      return false;
+    std::unique_lock<std::mutex> lock(mutex);
+    while (static_cast<int>(workers.size()) < num_threads - 1)
+      {
+	workers.emplace_back(&Workers::serve, this, static_cast<int>(workers.size()) + 1);
+	workers.back().detach();
+      }
+    this->job = &job;
+    num_wanted = num_running = num_threads - 1;
+    ++generation;
+    lock.unlock();
+    wake.notify_all();
+
+    in_job = true;
+    call_job(job, 0);
+    in_job = false;
+
+    lock.lock();
+    done.wait(lock, [this] { return num_running == 0; });
+    this->job = nullptr;
+    std::exception_ptr job_error = error;
+    error = nullptr;
+    lock.unlock();
+    if (job_error)
+      std::rethrow_exception(job_error);
+    return true;
+  }
+
+private:
+  std::mutex run_mutex, mutex;
+  std::condition_variable wake, done;
+  std::vector<std::thread> workers;
+  const std::function<void(int)> *job = nullptr;
+  std::size_t generation = 0;
+  int num_wanted = 0, num_running = 0;
+  std::exception_ptr error;	// first exception thrown by a job call
+
+  // the threads must all finish before an exception reaches the caller
+  void call_job(const std::function<void(int)> &job, int thread_index)
+  {
+    TRACE_SCOPE("thread_pool.job");
+    try
+      {
+	job(thread_index);
+      }
+    catch (...)
+      {
+	std::lock_guard<std::mutex> lock(mutex);
+	if (!error)
+	  error = std::current_exception();
+      }
+  }
+
+  void serve(int thread_index)
+  {
+    in_job = true;
+    std::size_t seen = 0;
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true)
+      {
+	wake.wait(lock, [&] { return generation != seen; });
+	seen = generation;
+	if (thread_index > num_wanted)
+	  continue;
+	const std::function<void(int)> *run_job = job;
+	lock.unlock();
+	call_job(*run_job, thread_index);
+	lock.lock();
+	if (--num_running == 0)
+	  done.notify_all();
+      }
+  }
+};
+
+// ----------------------------------------------------------------------------
+//
+void run(int num_threads, const std::function<void(int)> &job)
+{
+  static Workers *workers = new Workers;	// never deleted, see Workers
+  if (num_threads > 1 && !in_job && workers->try_run(num_threads, job))
+    return;
+  for (int t = 0; t < num_threads || t == 0; ++t)
+    job(t);
+}
+
+}  // end of namespace Thread_Pool
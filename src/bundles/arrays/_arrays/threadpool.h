@@ -0,0 +1,94 @@
+// vi: set expandtab shiftwidth=4 softtabstop=4:
+
+/*
+ * === UCSF ChimeraX Copyright ===
+ * Copyright 2022 Regents of the University of California. All rights reserved.
+ * The ChimeraX application is provided pursuant to the ChimeraX license
+ * agreement, which covers academic and commercial uses. For more details, see
+ * <http://www.rbvi.ucsf.edu/chimerax/docs/licensing.html>
+ *
+ * This particular file is part of the ChimeraX library. You can also
+ * redistribute and/or modify it under the terms of the GNU Lesser General
+ * Public License version 2.1 as published by the Free Software Foundation.
+ * For more details, see
+ * <https://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESSED OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. ADDITIONAL LIABILITY
+ * LIMITATIONS ARE DESCRIBED IN THE GNU LESSER GENERAL PUBLIC LICENSE
+ * VERSION 2.1
+ *
+ * This notice must be embedded in or attached to all copies, including partial
+ * copies, of the software or any revisions or derivations thereof.
+ * === UCSF ChimeraX Copyright ===
+ */
+
+// ----------------------------------------------------------------------------
+// Process-wide pool of worker threads for the C++ modules.  It lives in the
+// libarrays shared library so that every module linked against libarrays uses
+// the same workers and the same thread limit, instead of each computation
+// starting as many threads as there are cores and the parallel features
+// oversubscribing the machine when they overlap.
+//
+// The pool never touches Python; callers release the global interpreter lock
+// (Py_BEGIN_ALLOW_THREADS) around the computation as before.
+//
+#ifndef THREADPOOL_HEADER_INCLUDED
+#define THREADPOOL_HEADER_INCLUDED
+
+#include <algorithm>	// use std::min, std::max
+#include <atomic>	// use std::atomic
+#include <cstdint>	// use std::int64_t
+#include <functional>	// use std::function
+
+#include "imex.h"
+
+namespace Thread_Pool
+{
+
+//
+// Most threads, counting the calling thread, that a computation may use.
+// Defaults to the number of cores.  A value less than 1 restores the default.
+//
+ARRAYS_IMEX int max_threads();
+ARRAYS_IMEX void set_max_threads(int max_threads);
+
+//
+// Number of threads to use for num_items independent work items, giving each
+// thread at least min_items_per_thread items.  Limited by max_threads() and by
+// 'requested' if that is positive.
+//
+ARRAYS_IMEX int thread_count(std::int64_t num_items, std::int64_t min_items_per_thread = 1,
+			     int requested = 0);
+
+//
+// Call job(t) for t = 0 to num_threads-1 in parallel, the calling thread doing
+// t = 0, and return once all calls have finished.  A run started from within a
+// job, or while another thread's run has the workers, makes the calls one
+// after another in the calling thread, so jobs may nest without deadlocking.
+//
+ARRAYS_IMEX void run(int num_threads, const std::function<void(int)> &job);
+
+//
+// Call f(i0, i1) for ranges i0 to i1-1 covering 0 to n-1, each range having
+// chunk_size items except possibly the last.  Threads take the next range as
+// they finish one, so uneven costs per item still balance across threads.
+//
+template <class F>
+void parallel_for(std::int64_t n, F f, std::int64_t chunk_size = 1, int requested = 0)
+{
+  if (n <= 0)
+    return;
+  chunk_size = std::max(chunk_size, static_cast<std::int64_t>(1));
+  std::int64_t num_chunks = (n + chunk_size - 1) / chunk_size;
+  std::atomic<std::int64_t> next_chunk(0);
+  run(thread_count(num_chunks, 1, requested), [&](int) {
+      for (std::int64_t c = next_chunk++; c < num_chunks; c = next_chunk++)
+	f(c * chunk_size, std::min(n, (c + 1) * chunk_size));
+    });
+}
+
+}  // end of namespace Thread_Pool
+
+#endif
@@ -0,0 +1,121 @@
+// vi: set expandtab shiftwidth=4 softtabstop=4:
+
+/*
+ * === UCSF ChimeraX Copyright ===
+ * Copyright 2022 Regents of the University of California. All rights reserved.
+ * The ChimeraX application is provided pursuant to the ChimeraX license
+ * agreement, which covers academic and commercial uses. For more details, see
+ * <http://www.rbvi.ucsf.edu/chimerax/docs/licensing.html>
+ *
+ * This particular file is part of the ChimeraX library. You can also
+ * redistribute and/or modify it under the terms of the GNU Lesser General
+ * Public License version 2.1 as published by the Free Software Foundation.
+ * For more details, see
+ * <https://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESSED OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. ADDITIONAL LIABILITY
+ * LIMITATIONS ARE DESCRIBED IN THE GNU LESSER GENERAL PUBLIC LICENSE
+ * VERSION 2.1
+ *
+ * This notice must be embedded in or attached to all copies, including partial
+ * copies, of the software or any revisions or derivations thereof.
+ * === UCSF ChimeraX Copyright ===
+ */
+
+#include <cstdlib>			// use getenv()
+#include <cstring>			// use strcmp()
+#include <mutex>			// use std::mutex
+
+#define ARRAYS_EXPORT
+#include "trace.h"
+
+namespace Trace
+{
+
+static bool initially_enabled()
+{
+  const char *e = std::getenv("CHIMERAX_TRACE");
+  return e != nullptr && e[0] != '\0' && std::strcmp(e, "0") != 0;
+}
+
+std::atomic<bool> tracing(initially_enabled()), recording(false);
+
+void set_enabled(bool enable)
+{
+  tracing = enable;
+}
+
+void set_recording_events(bool record)
+{
+  recording = record;
+}
+
+int thread_number()
+{
+  static std::atomic<int> threads_seen(0);
+  thread_local int number = ++threads_seen;
+  return number;
+}
+
+// Function statics so counters in other libraries constructed during static
+// initialization find the registry already made.
+static std::mutex &registry_lock()
+{
+  static std::mutex lock;
+  return lock;
+}
+
+static std::vector<Counter *> &registry()
+{
+  static std::vector<Counter *> counters;
+  return counters;
+}
+
+static const std::size_t max_events = 1000000;
+static std::mutex event_lock;
+static std::vector<Event> recorded_events;
+static int64_t dropped_events = 0;
+
+void add_event(const char *name, int64_t start, int64_t end)
+{
+  int thread = thread_number();
+  std::lock_guard<std::mutex> lock(event_lock);
+  if (recorded_events.size() < max_events)
+    recorded_events.push_back(Event{name, thread, start, end});
+  else
+    dropped_events += 1;
+}
+
+std::vector<Event> events(int64_t *dropped)
+{
+  std::lock_guard<std::mutex> lock(event_lock);
+  if (dropped)
+    *dropped = dropped_events;
+  return recorded_events;
+}
+
+Counter::Counter(const char *name) : name(name), calls(0), time(0), count(0)
+{
+  std::lock_guard<std::mutex> lock(registry_lock());
+  registry().push_back(this);
+}
+
+std::vector<Counter *> counters()
+{
+  std::lock_guard<std::mutex> lock(registry_lock());
+  return registry();
+}
+
+void reset()
+{
+  std::lock_guard<std::mutex> lock(registry_lock());
+  for (auto c: registry())
+    c->reset();
+  std::lock_guard<std::mutex> elock(event_lock);
+  recorded_events.clear();
+  dropped_events = 0;
+}
+
+}  // namespace Trace
@@ -0,0 +1,151 @@
+// vi: set expandtab shiftwidth=4 softtabstop=4:
+
+/*
+ * === UCSF ChimeraX Copyright ===
+ * Copyright 2022 Regents of the University of California. All rights reserved.
+ * The ChimeraX application is provided pursuant to the ChimeraX license
+ * agreement, which covers academic and commercial uses. For more details, see
+ * <http://www.rbvi.ucsf.edu/chimerax/docs/licensing.html>
+ *
+ * This particular file is part of the ChimeraX library. You can also
+ * redistribute and/or modify it under the terms of the GNU Lesser General
+ * Public License version 2.1 as published by the Free Software Foundation.
+ * For more details, see
+ * <https://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESSED OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. ADDITIONAL LIABILITY
+ * LIMITATIONS ARE DESCRIBED IN THE GNU LESSER GENERAL PUBLIC LICENSE
+ * VERSION 2.1
+ *
+ * This notice must be embedded in or attached to all copies, including partial
+ * copies, of the software or any revisions or derivations thereof.
+ * === UCSF ChimeraX Copyright ===
+ */
+
+// ----------------------------------------------------------------------------
+// Counters for timing hot C++ kernels in a released build.  A kernel puts
+// TRACE_SCOPE("module.kernel") at the top of its body.  That makes one static
+// counter per call site which records the number of calls, total time and
+// number of items processed.  The time is only taken while tracing is on,
+// so an annotated kernel costs one relaxed atomic load when tracing is off.
+// Tracing starts off unless the CHIMERAX_TRACE environment variable is set
+// and the counters are read and reset from Python by chimerax.arrays.
+//
+// While event recording is on each timed scope also adds a timeline event
+// with its thread and start and end time, and Python code adds its own spans
+// with the same clock, for saving in Chrome trace format.
+//
+#ifndef TRACE_HEADER_INCLUDED
+#define TRACE_HEADER_INCLUDED
+
+#include <atomic>			// use std::atomic
+#include <chrono>			// use std::chrono::steady_clock
+#include <cstdint>			// use int64_t
+#include <string>			// use std::string
+#include <vector>			// use std::vector
+
+#include "imex.h"
+
+namespace Trace
+{
+
+ARRAYS_IMEX extern std::atomic<bool> tracing, recording;
+inline bool enabled() { return tracing.load(std::memory_order_relaxed); }
+ARRAYS_IMEX void set_enabled(bool enable);
+inline bool recording_events() { return recording.load(std::memory_order_relaxed); }
+ARRAYS_IMEX void set_recording_events(bool record);
+
+// Nanoseconds on the clock used for all events.
+inline int64_t now()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>
+    (std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Small number identifying the calling thread, 1 for the first thread seen.
+ARRAYS_IMEX int thread_number();
+
+struct Event
+{
+  std::string name;
+  int thread;
+  int64_t start, end;		// nanoseconds from now()
+};
+
+// Events are dropped once a million have been recorded, so leaving recording
+// on can't use unbounded memory.
+ARRAYS_IMEX void add_event(const char *name, int64_t start, int64_t end);
+ARRAYS_IMEX std::vector<Event> events(int64_t *dropped = nullptr);
+
+class ARRAYS_IMEX Counter
+{
+public:
+  // Name should be a string literal, counters are never unregistered.
+  Counter(const char *name);
+  void add(int64_t nanoseconds, int64_t items)
+    {
+      calls.fetch_add(1, std::memory_order_relaxed);
+      time.fetch_add(nanoseconds, std::memory_order_relaxed);
+      count.fetch_add(items, std::memory_order_relaxed);
+    }
+  void reset() { calls = 0; time = 0; count = 0; }
+
+  const char *name;
+  std::atomic<int64_t> calls, time, count;
+};
+
+// Counters of all kernels loaded so far, in registration order.
+ARRAYS_IMEX std::vector<Counter *> counters();
+// Zero the counters and discard recorded events.
+ARRAYS_IMEX void reset();
+
+// ----------------------------------------------------------------------------
+// Add the time from construction to destruction to a counter and, if events
+// are being recorded, to the timeline.
+//
+class Scoped_Timer
+{
+public:
+  Scoped_Timer(Counter &counter, int64_t items = 0) :
+    counter(&counter), items(items), count(enabled()), record(recording_events())
+    {
+      if (count || record)
+	start = now();
+    }
+  ~Scoped_Timer()
+    {
+      if (!count && !record)
+	return;
+      int64_t end = now();
+      if (count)
+	counter->add(end - start, items);
+      if (record)
+	add_event(counter->name, start, end);
+    }
+  // Number of items processed, if not known until the kernel finishes.
+  void set_items(int64_t n) { items = n; }
+private:
+  Counter *counter;
+  int64_t items;
+  bool count, record;
+  int64_t start;
+};
+
+}  // namespace Trace
+
+#define TRACE_CONCAT2(a, b) a ## b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT2(a, b)
+
+// Time the rest of the enclosing scope.  TRACE_SCOPE_ITEMS also counts
+// items, and TRACE_TIMER gives a named timer whose item count can be set later.
+#define TRACE_SCOPE(name) TRACE_SCOPE_ITEMS(name, 0)
+#define TRACE_SCOPE_ITEMS(name, items) \
+  static Trace::Counter TRACE_CONCAT(_trace_counter_, __LINE__)(name); \
+  Trace::Scoped_Timer TRACE_CONCAT(_trace_timer_, __LINE__)(TRACE_CONCAT(_trace_counter_, __LINE__), items)
+#define TRACE_TIMER(timer, name) \
+  static Trace::Counter TRACE_CONCAT(_trace_counter_, __LINE__)(name); \
+  Trace::Scoped_Timer timer(TRACE_CONCAT(_trace_counter_, __LINE__))
+
+#endif
@@ -21,9 +21,15 @@
 # This notice must be embedded in or attached to all copies, including partial
 # copies, of the software or any revisions or derivations thereof.
 # === UCSF ChimeraX Copyright ===
-from ._pyarrays import get_lib, get_include, load_libarrays
+from ._pyarrays import get_lib, get_include, load_libarrays, max_threads, set_max_threads
+from ._pyarrays import ProgressToken, ComputationCancelled
+from ._pyarrays import trace_enabled, set_trace, trace_counters, reset_trace
+from ._pyarrays import trace_events_enabled, set_trace_events, trace_span, save_chrome_trace
 
-__all__ = ["get_lib", "get_include", "load_libarrays"]
+__all__ = ["get_lib", "get_include", "load_libarrays", "max_threads", "set_max_threads",
+           "ProgressToken", "ComputationCancelled",
+           "trace_enabled", "set_trace", "trace_counters", "reset_trace",
+           "trace_events_enabled", "set_trace_events", "trace_span", "save_chrome_trace"]
 
 # try:
 #     from chimerax import running_as_application
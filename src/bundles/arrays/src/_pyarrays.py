@@ -38,6 +38,95 @@ if sys.platform.startswith('win'):
     os.add_dll_directory(get_lib())
 
 from . import _arrays
+from ._arrays import max_threads, set_max_threads
+from ._arrays import trace_enabled, set_trace, reset_trace
+from ._arrays import trace_events_enabled, set_trace_events
+
+class ComputationCancelled(RuntimeError):
+    """Raised by a C++ computation stopped by cancelling its ProgressToken."""
+    pass
+
+class ProgressToken:
+    """
+    Progress and cancel request shared with a C++ computation given as its
+    progress argument.  The computation reports the fraction of work done,
+    and stops with ComputationCancelled soon after cancel() is called.
+    Both can be used from any thread while the computation runs.  The token
+    can also be called like a progress callback, for Python code that splits
+    work over several C++ calls.
+    """
+    def __init__(self):
+        self._capsule = _arrays.progress_token()
+
+    @property
+    def fraction(self):
+        """Fraction of the work reported done, 0 to 1."""
+        return _arrays.progress_fraction(self._capsule)
+
+    def __call__(self, fraction):
+        """Set the fraction done, raising ComputationCancelled if cancelled."""
+        if not _arrays.progress_report(self._capsule, fraction):
+            raise ComputationCancelled('Computation cancelled')
+
+    def cancel(self):
+        """Ask the computation to stop."""
+        _arrays.progress_cancel(self._capsule)
+
+    @property
+    def cancelled(self):
+        return _arrays.progress_cancelled(self._capsule)
+
+def trace_counters():
+    """
+    Timings of the C++ kernels annotated with TRACE_SCOPE that have run since
+    tracing was turned on or last reset.  Returns a list of (name, calls,
+    seconds, items) sorted by decreasing time.  Tracing is on at startup if
+    the CHIMERAX_TRACE environment variable is set, or use set_trace(True).
+    """
+    counters = [(name, calls, ns * 1e-9, items)
+                for name, calls, ns, items in _arrays.trace_counters()]
+    counters.sort(key = lambda c: c[2], reverse = True)
+    return counters
+
+class trace_span:
+    """
+    Context manager adding a named span on the calling thread to the timeline
+    of C++ kernel events.  Does nothing unless set_trace_events(True) was
+    called, so it can be left around code that runs often.
+    """
+    __slots__ = ('_name', '_start')
+
+    def __init__(self, name):
+        self._name = name
+        self._start = None
+
+    def __enter__(self):
+        if _arrays.trace_events_enabled():
+            self._start = _arrays.trace_time()
+        return self
+
+    def __exit__(self, *exc_info):
+        if self._start is not None:
+            _arrays.add_trace_event(self._name, self._start)
+            self._start = None
+
+def save_chrome_trace(path):
+    """
+    Write the recorded timeline events to a Chrome trace format JSON file,
+    viewable with Perfetto (ui.perfetto.dev) or chrome://tracing.  Thread 1
+    is the first thread to record an event, normally the main thread.
+    Returns the number of events written and the number dropped because
+    the event buffer filled.
+    """
+    events, dropped = _arrays.trace_events()
+    pid = os.getpid()
+    trace = [{'name': name, 'ph': 'X', 'pid': pid, 'tid': thread,
+              'ts': start / 1000, 'dur': (end - start) / 1000}
+             for name, thread, start, end in events]
+    import json
+    with open(path, 'w') as f:
+        json.dump({'traceEvents': trace, 'displayTimeUnit': 'ms'}, f)
+    return len(events), dropped
 
 def load_libarrays():
     warnings.warn(
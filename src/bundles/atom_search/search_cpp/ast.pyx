@@ -93,6 +93,40 @@ cdef class CyAtomSearchTree:
             return [self.data_lookup[id(a)] for a in leaf_atoms]
         return leaf_atoms
 
+    def search_many(self, targets, double window, *, int num_threads=0):
+        """Search about each of an N x 3 array of points at once, with the same criteria
+        as search().  The points are divided among 'num_threads' threads (by default,
+        one per CPU).
+
+        Returns (offsets, indices) arrays: the atoms found for point i are at positions
+        indices[offsets[i]:offsets[i+1]] (in increasing order) of the atoms given to the
+        tree when it was made.  Offsets and indices are numpy int64 and int32 arrays.
+        """
+        import numpy
+        cdef double[:, ::1] xyz = numpy.ascontiguousarray(targets, dtype=numpy.float64).reshape((-1, 3))
+        cdef size_t num_targets = xyz.shape[0]
+        cdef vector[size_t] offsets
+        cdef vector[size_t] indices
+        cdef long long[::1] offsets_view
+        cdef int[::1] indices_view
+        cdef size_t i
+        if num_targets == 0:
+            return numpy.zeros(1, numpy.int64), numpy.empty(0, numpy.int32)
+        if num_threads <= 0:
+            import os
+            num_threads = os.cpu_count() or 1
+        with nogil:
+            self.cpp_ast.search_many(&xyz[0, 0], num_targets, window, offsets, indices, num_threads)
+        py_offsets = numpy.empty(offsets.size(), numpy.int64)
+        offsets_view = py_offsets
+        for i in range(offsets.size()):
+            offsets_view[i] = offsets[i]
+        py_indices = numpy.empty(indices.size(), numpy.int32)
+        indices_view = py_indices
+        for i in range(indices.size()):
+            indices_view[i] = indices[i]
+        return py_offsets, py_indices
+
     def __dealloc__(self):
         del self.cpp_ast
 
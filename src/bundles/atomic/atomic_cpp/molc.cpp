@@ -37,27 +37,41 @@
 #include <atomstruct/CoordSet.h>
 #include <atomstruct/destruct.h>     // Use DestructionObserver
 #include <atomstruct/MolResId.h>
+#include <atomstruct/hydrogens.h>
 #include <atomstruct/PBGroup.h>
 #include <atomstruct/polymer.h>
 #include <atomstruct/Pseudobond.h>
 #include <atomstruct/PBGroup.h>
 #include <atomstruct/Residue.h>
 #include <atomstruct/Ring.h>
+#include <atomstruct/search.h>
 #include <atomstruct/seq_assoc.h>
 #include <atomstruct/Sequence.h>
+#include <atomstruct/spec_filter.h>
+#include <atomstruct/superpose.h>
+#include <atomstruct/TrajectoryFile.h>
 #include <arrays/pythonarray.h>           // Use python_voidp_array()
+#include <arrays/threadpool.h>            // Use Thread_Pool::parallel_for()
+#include <arrays/trace.h>                 // Use TRACE_SCOPE_ITEMS()
 #include <pysupport/convert.h>     // Use cset_of_chars_to_pyset
 
+#include <algorithm>      // use std::copy(), std::max()
+#include <exception>      // use std::exception_ptr
 #include <functional>
 #include <map>
+#include <mutex>
 #include <regex>
 #include <set>
 #include <sstream>
 #include <stdexcept>
 #include <stdint.h>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 #include <cmath>
+#include <cstdio>       // use snprintf
+#include <cstring>      // use memcpy
 
 #ifndef M_PI
 // not defined on Windows
@@ -346,6 +360,132 @@ extern "C" EXPORT void clear_atom_aniso_u6(void *atoms, size_t n)
     }
 }
 
+// Gather (u11,u22,u33,u12,u13,u23) of all atoms into an N x 6 table, zero
+// for atoms without anisotropic temperature factors.
+extern "C" EXPORT void atom_aniso_u6_table(void *atoms, size_t n, float32_t *aniso_u,
+                                           npy_bool *has_aniso_u)
+{
+    TRACE_SCOPE_ITEMS("molc.atom_aniso_u6_table", n);
+    Atom **a = static_cast<Atom **>(atoms);
+    try {
+        for (size_t i = 0; i != n; ++i) {
+            const std::vector<float> *ai = a[i]->aniso_u();
+            float32_t *ani = aniso_u + 6*i;
+            if (ai) {
+                ani[0] = (*ai)[0]; ani[1] = (*ai)[3]; ani[2] = (*ai)[5];
+                ani[3] = (*ai)[1]; ani[4] = (*ai)[2]; ani[5] = (*ai)[4];
+            } else {
+                for (int c = 0; c < 6; ++c)
+                    ani[c] = 0;
+            }
+            has_aniso_u[i] = (ai != nullptr);
+        }
+    } catch (...) {
+        molc_error();
+    }
+}
+
+// Eigenvalues and eigenvectors (columns of evecs) of a symmetric 3x3 matrix
+// by cyclic Jacobi rotations.
+static void symmetric_eigen_3x3(double m[3][3], double evals[3], double evecs[3][3])
+{
+    for (int i = 0; i < 3; ++i)
+        for (int j = 0; j < 3; ++j)
+            evecs[i][j] = (i == j ? 1 : 0);
+    double scale = m[0][0]*m[0][0] + m[1][1]*m[1][1] + m[2][2]*m[2][2];
+    const int pairs[3][2] = {{0,1}, {0,2}, {1,2}};
+    for (int sweep = 0; sweep < 50; ++sweep) {
+        double off = m[0][1]*m[0][1] + m[0][2]*m[0][2] + m[1][2]*m[1][2];
+        if (off <= 1e-30 * scale || off == 0)
+            break;
+        for (auto &pq: pairs) {
+            int p = pq[0], q = pq[1];
+            double mpq = m[p][q];
+            if (mpq == 0)
+                continue;
+            double theta = (m[q][q] - m[p][p]) / (2*mpq);
+            double t = (theta >= 0 ? 1 : -1) / (std::fabs(theta) + std::sqrt(theta*theta + 1));
+            double c = 1 / std::sqrt(t*t + 1), s = t*c;
+            for (int k = 0; k < 3; ++k) {
+                double mkp = m[k][p], mkq = m[k][q];
+                m[k][p] = c*mkp - s*mkq;
+                m[k][q] = s*mkp + c*mkq;
+            }
+            for (int k = 0; k < 3; ++k) {
+                double mpk = m[p][k], mqk = m[q][k];
+                m[p][k] = c*mpk - s*mqk;
+                m[q][k] = s*mpk + c*mqk;
+            }
+            for (int k = 0; k < 3; ++k) {
+                double vkp = evecs[k][p], vkq = evecs[k][q];
+                evecs[k][p] = c*vkp - s*vkq;
+                evecs[k][q] = s*vkp + c*vkq;
+            }
+        }
+    }
+    for (int i = 0; i < 3; ++i)
+        evals[i] = m[i][i];
+}
+
+static void aniso_u_ellipsoid_placements(Atom **a, int64_t i0, int64_t i1, float scale,
+                                         float32_t *m44)
+{
+    for (int64_t i = i0; i < i1; ++i) {
+        const std::vector<float> *ai = a[i]->aniso_u();
+        if (ai == nullptr)
+            throw std::invalid_argument("Atom has no aniso_u value.");
+        const std::vector<float> &u = *ai;
+        double m[3][3] = {{u[0], u[1], u[2]}, {u[1], u[3], u[4]}, {u[2], u[4], u[5]}};
+        double evals[3], evecs[3][3];
+        symmetric_eigen_3x3(m, evals, evecs);
+        // Keep axes right-handed so triangle winding and normals are unchanged.
+        double det = (evecs[0][0]*(evecs[1][1]*evecs[2][2] - evecs[2][1]*evecs[1][2])
+                      - evecs[0][1]*(evecs[1][0]*evecs[2][2] - evecs[2][0]*evecs[1][2])
+                      + evecs[0][2]*(evecs[1][0]*evecs[2][1] - evecs[2][0]*evecs[1][1]));
+        float32_t *p = m44 + 16*i;
+        for (int c = 0; c < 3; ++c) {
+            double r = scale * std::sqrt(evals[c] > 0 ? evals[c] : 0);
+            if (c == 2 && det < 0)
+                r = -r;
+            // OpenGL column-major, column c is axis c.
+            for (int k = 0; k < 3; ++k)
+                p[4*c+k] = r * evecs[k][c];
+            p[4*c+3] = 0;
+        }
+        const Coord &xyz = a[i]->coord();
+        p[12] = xyz[0]; p[13] = xyz[1]; p[14] = xyz[2]; p[15] = 1;
+    }
+}
+
+// Place a unit sphere at each atom as its thermal ellipsoid.  Axes are the
+// eigenvectors of the aniso U matrix scaled by the square root of the
+// eigenvalues times scale, giving N 4x4 OpenGL matrices.
+extern "C" EXPORT void atom_aniso_u_ellipsoid_placements(void *atoms, size_t n, float32_t scale,
+                                                         float32_t *m44)
+{
+    TRACE_SCOPE_ITEMS("molc.atom_aniso_u_ellipsoid_placements", n);
+    Atom **a = static_cast<Atom **>(atoms);
+    try {
+        std::exception_ptr error;
+        std::mutex error_mutex;
+        Py_BEGIN_ALLOW_THREADS
+        Thread_Pool::parallel_for(n, [&](int64_t i0, int64_t i1) {
+            try {
+                aniso_u_ellipsoid_placements(a, i0, i1, scale, m44);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(error_mutex);
+                if (!error)
+                    error = std::current_exception();
+            }
+        }, 4096);
+        Py_END_ALLOW_THREADS
+        if (error)
+            std::rethrow_exception(error);
+    } catch (...) {
+        molc_error();
+    }
+}
+
 extern "C" EXPORT void atom_occupancy(void *atoms, size_t n, float32_t *occupancies)
 {
     Atom **a = static_cast<Atom **>(atoms);
@@ -474,6 +614,7 @@ extern "C" EXPORT void atom_chain_id(void *atoms, size_t n, pyobject_t *cids)
 
 extern "C" EXPORT void atom_color(void *atoms, size_t n, uint8_t *rgba)
 {
+    TRACE_SCOPE_ITEMS("molc.atom_color", n);
     Atom **a = static_cast<Atom **>(atoms);
     try {
         for (size_t i = 0; i != n; ++i) {
@@ -490,6 +631,7 @@ extern "C" EXPORT void atom_color(void *atoms, size_t n, uint8_t *rgba)
 
 extern "C" EXPORT void set_atom_color(void *atoms, size_t n, uint8_t *rgba)
 {
+    TRACE_SCOPE_ITEMS("molc.set_atom_color", n);
     Atom **a = static_cast<Atom **>(atoms);
     try {
         Rgba c;
@@ -554,6 +696,7 @@ extern "C" EXPORT bool atom_connects_to(pyobject_t atom1, pyobject_t atom2)
 
 extern "C" EXPORT void atom_coord(void *atoms, size_t n, float64_t *xyz)
 {
+    TRACE_SCOPE_ITEMS("molc.atom_coord", n);
     Atom **a = static_cast<Atom **>(atoms);
     try {
         for (size_t i = 0; i != n; ++i) {
@@ -569,6 +712,7 @@ extern "C" EXPORT void atom_coord(void *atoms, size_t n, float64_t *xyz)
 
 extern "C" EXPORT void set_atom_coord(void *atoms, size_t n, float64_t *xyz)
 {
+    TRACE_SCOPE_ITEMS("molc.set_atom_coord", n);
     Atom **a = static_cast<Atom **>(atoms);
     std::unordered_map<Structure*, std::vector<Atom*>> s_map;
     std::unordered_set<Structure*> ribbon_changed;
@@ -586,7 +730,11 @@ extern "C" EXPORT void set_atom_coord(void *atoms, size_t n, float64_t *xyz)
             auto s = s_atoms.first;
             auto &atoms = s_atoms.second;
             auto ct = s->change_tracker();
-            ct->add_modified_set(s, atoms, ChangeTracker::REASON_COORD);
+            if (atoms.size() == s->atoms().size())
+                // all atoms moved (a duplicated atom would only over-report)
+                ct->add_coords_replaced(s);
+            else
+                ct->add_modified_set(s, atoms, ChangeTracker::REASON_COORD);
             ct->add_modified(s, s->active_coord_set(), ChangeTracker::REASON_COORDSET);
             s->set_gc_shape();
         }
@@ -1250,6 +1398,7 @@ extern "C" EXPORT void atom_scene_coord(void *atoms, size_t n, float64_t *xyz)
 // Apply per-structure transform to atom coordinates.
 extern "C" EXPORT void atom_scene_coords(void *atoms, size_t n, void *mols, size_t m, float64_t *mtf, float64_t *xyz)
 {
+    TRACE_SCOPE_ITEMS("molc.atom_scene_coords", n);
     Atom **a = static_cast<Atom **>(atoms);
     Structure **ma = static_cast<Structure **>(mols);
 
@@ -1330,6 +1479,134 @@ extern "C" EXPORT void atom_structure_category(void *atoms, size_t n, pyobject_t
     }
 }
 
+extern "C" EXPORT void atom_structure_category_code(void *atoms, size_t n, uint8_t *codes)
+{
+    // Atom::StructCat values, computed once per structure when out of date.
+    TRACE_SCOPE_ITEMS("molc.atom_structure_category_code", n);
+    Atom **a = static_cast<Atom **>(atoms);
+    try {
+        for (size_t i = 0; i != n; ++i)
+            codes[i] = static_cast<uint8_t>(a[i]->structure_category());
+    } catch (...) {
+        molc_error();
+    }
+}
+
+static std::string _spec_string(PyObject *s)
+{
+    const char *c = PyUnicode_AsUTF8(s);
+    if (c == nullptr)
+        throw std::invalid_argument("Atom spec name is not a string");
+    return c;
+}
+
+static SpecName _spec_name(PyObject *part, bool case_sensitive)
+{
+    PyObject *end = PyTuple_GetItem(part, 1);
+    std::string end_name;
+    if (end != Py_None)
+        end_name = _spec_string(end);
+    return SpecName(_spec_string(PyTuple_GetItem(part, 0)),
+        end == Py_None ? nullptr : &end_name, case_sensitive);
+}
+
+static char _spec_insertion_code(PyObject *ic)
+{
+    std::string s = _spec_string(ic);
+    return s.empty() ? ' ' : s[0];
+}
+
+// Parts are (start, end) name tuples, with end None if not a range.  Residue
+// parts have a third item (start_number, start_ic, is_range, end_number,
+// end_ic) if they parse as residue numbers, with None for "start" or "end".
+// Attribute tests are (name, op, value) with op one of "truth", "not", "=",
+// "!=", "==", "!==", ">=", ">", "<=", "<".  Returns the indices of the
+// attribute tests that must be done in Python.
+extern "C" EXPORT PyObject *atom_spec_filter(void *atoms, size_t n, char level, PyObject *py_parts,
+    PyObject *py_attrs, bool case_sensitive, uint8_t *mask)
+{
+    Atom **a = static_cast<Atom **>(atoms);
+    try {
+        Py_ssize_t np = PySequence_Length(py_parts);
+        if (level == ':') {
+            std::vector<SpecResiduePart> parts;
+            for (Py_ssize_t i = 0; i < np; ++i) {
+                PyObject *part = PySequence_GetItem(py_parts, i);
+                Py_DECREF(part);
+                PyObject *rid = PyTuple_GetItem(part, 2);
+                SpecResidueId id;
+                if (rid != Py_None) {
+                    PyObject *start = PyTuple_GetItem(rid, 0), *end = PyTuple_GetItem(rid, 3);
+                    id = SpecResidueId(start != Py_None,
+                        start == Py_None ? 0 : PyLong_AsLong(start),
+                        _spec_insertion_code(PyTuple_GetItem(rid, 1)),
+                        PyObject_IsTrue(PyTuple_GetItem(rid, 2)),
+                        end != Py_None, end == Py_None ? 0 : PyLong_AsLong(end),
+                        _spec_insertion_code(PyTuple_GetItem(rid, 4)));
+                }
+                parts.push_back(SpecResiduePart{rid != Py_None, id, _spec_name(part, false)});
+            }
+            spec_residue_mask(a, n, parts, mask);
+        } else {
+            std::vector<SpecName> parts;
+            for (Py_ssize_t i = 0; i < np; ++i) {
+                PyObject *part = PySequence_GetItem(py_parts, i);
+                Py_DECREF(part);
+                parts.push_back(_spec_name(part, case_sensitive));
+            }
+            if (level == '/')
+                spec_chain_mask(a, n, parts, mask);
+            else
+                spec_atom_mask(a, n, parts, mask);
+        }
+        if (PyErr_Occurred())
+            return nullptr;
+
+        static const std::map<std::string, SpecAttrTest::Op> ops = {
+            {"truth", SpecAttrTest::TRUTH}, {"not", SpecAttrTest::NOT},
+            {"=", SpecAttrTest::EQ}, {"!=", SpecAttrTest::NE},
+            {"==", SpecAttrTest::EQ_CASE}, {"!==", SpecAttrTest::NE_CASE},
+            {">=", SpecAttrTest::GE}, {">", SpecAttrTest::GT},
+            {"<=", SpecAttrTest::LE}, {"<", SpecAttrTest::LT}};
+        PyObject *python_tests = PyList_New(0);
+        Py_ssize_t na = PySequence_Length(py_attrs);
+        for (Py_ssize_t i = 0; i < na; ++i) {
+            PyObject *attr = PySequence_GetItem(py_attrs, i);
+            Py_DECREF(attr);
+            PyObject *value = PyTuple_GetItem(attr, 2);
+            auto op = ops.find(_spec_string(PyTuple_GetItem(attr, 1)));
+            SpecAttrTest::ValueType vtype = SpecAttrTest::NONE;
+            std::string svalue;
+            double nvalue = 0;
+            if (PyUnicode_Check(value)) {
+                vtype = SpecAttrTest::STRING;
+                svalue = _spec_string(value);
+            } else if (PyLong_Check(value) || PyFloat_Check(value)) {
+                vtype = SpecAttrTest::NUMBER;
+                nvalue = PyFloat_AsDouble(value);
+            }
+            bool native = (op != ops.end() &&
+                (vtype != SpecAttrTest::NONE || value == Py_None));
+            if (native) {
+                SpecAttrTest test(level == ':', _spec_string(PyTuple_GetItem(attr, 0)),
+                    op->second, vtype, svalue, nvalue);
+                native = test.valid();
+                if (native)
+                    spec_attr_mask(a, n, test, mask);
+            }
+            if (!native) {
+                PyObject *index = PyLong_FromSsize_t(i);
+                PyList_Append(python_tests, index);
+                Py_DECREF(index);
+            }
+        }
+        return python_tests;
+    } catch (...) {
+        molc_error();
+    }
+    return nullptr;
+}
+
 extern "C" EXPORT void set_atom_selected(void *atoms, size_t n, npy_bool *sel)
 {
     Atom **a = static_cast<Atom **>(atoms);
@@ -1869,12 +2146,11 @@ extern "C" EXPORT void bond_delete(void *bonds, size_t n)
     }
 }
 
-extern "C" EXPORT void bond_halfbond_cylinder_placements(void *bonds, size_t n, float32_t *m44)
+static void halfbond_cylinder_placements(Bond **b, size_t n, size_t i0, size_t i1, float32_t *m44)
 {
-    Bond **b = static_cast<Bond **>(bonds);
-    try {
-      float32_t *m44b = m44 + 16*n;
-      for (size_t i = 0; i != n; ++i) {
+      float32_t *m44b = m44 + 16*(n+i0);
+      m44 += 16*i0;
+      for (size_t i = i0; i != i1; ++i) {
 	Bond *bd = b[i];
 	Atom *a0 = bd->atoms()[0], *a1 = bd->atoms()[1];
 	const Coord &xyz0 = a0->coord(), &xyz1 = a1->coord();
@@ -1922,6 +2198,54 @@ extern "C" EXPORT void bond_halfbond_cylinder_placements(void *bonds, size_t n,
 	*m44b++ = .25*z0 + .75*z1;
 	*m44b++ = 1;
       }
+}
+
+extern "C" EXPORT void bond_halfbond_cylinder_placements(void *bonds, size_t n, float32_t *m44)
+{
+    // Redone for every coordinate change, e.g. each trajectory frame, so the
+    // bonds are divided among threads.  Only coordinates are read, so no GIL.
+    Bond **b = static_cast<Bond **>(bonds);
+    try {
+        std::exception_ptr error;
+        std::mutex error_mutex;
+        Py_BEGIN_ALLOW_THREADS
+        Thread_Pool::parallel_for(n, [&](int64_t i0, int64_t i1) {
+            try {
+                halfbond_cylinder_placements(b, n, i0, i1, m44);
+            } catch (...) {
+                // e.g. atom without coordinates
+                std::lock_guard<std::mutex> lock(error_mutex);
+                if (!error)
+                    error = std::current_exception();
+            }
+        }, 4096);
+        Py_END_ALLOW_THREADS
+        if (error)
+            std::rethrow_exception(error);
+    } catch (...) {
+        molc_error();
+    }
+}
+
+extern "C" EXPORT void bond_halfbond_cylinders(void *bonds, size_t n, float32_t *ends)
+{
+    TRACE_SCOPE_ITEMS("molc.bond_halfbond_cylinders", n);
+    // Compact form of the halfbond placements expanded by the graphics shader:
+    // (x0, y0, z0, radius, x1, y1, z1, halves shown) for each bond.
+    Bond **b = static_cast<Bond **>(bonds);
+    try {
+        for (size_t i = 0; i != n; ++i) {
+            Bond *bd = b[i];
+            const Coord &xyz0 = bd->atoms()[0]->coord(), &xyz1 = bd->atoms()[1]->coord();
+            *ends++ = xyz0[0];
+            *ends++ = xyz0[1];
+            *ends++ = xyz0[2];
+            *ends++ = bd->radius();
+            *ends++ = xyz1[0];
+            *ends++ = xyz1[1];
+            *ends++ = xyz1[2];
+            *ends++ = 3;
+        }
     } catch (...) {
         molc_error();
     }
@@ -2029,6 +2353,155 @@ extern "C" EXPORT PyObject *pseudobond_half_colors(void *pbonds, size_t n)
     return colors;
 }
 
+extern "C" EXPORT PyObject *pseudobond_cylinder_data(void *pbonds, size_t n, bool coords,
+    bool colors, bool scene_coords)
+{
+    // end point coordinates, radii and half bond colors for drawing
+    // pseudobonds as instanced cylinders, in one pass over the pseudobonds
+    Pseudobond **b = static_cast<Pseudobond **>(pbonds);
+    double *xyz1 = nullptr, *xyz2 = nullptr;
+    float *radii = nullptr;
+    uint8_t *rgba1 = nullptr, *rgba2 = nullptr;
+    PyObject *py_xyz1, *py_xyz2, *py_radii, *py_colors;
+    if (coords) {
+        py_xyz1 = python_double_array(n, 3, &xyz1);
+        py_xyz2 = python_double_array(n, 3, &xyz2);
+        py_radii = python_float_array(n, &radii);
+    } else {
+        py_xyz1 = python_none();
+        py_xyz2 = python_none();
+        py_radii = python_none();
+    }
+    if (colors) {
+        py_colors = python_uint8_array(2*n, 4, &rgba1);
+        rgba2 = rgba1 + 4*n;
+    } else
+        py_colors = python_none();
+    try {
+        for (size_t i = 0; i < n; ++i) {
+            Pseudobond *bond = b[i];
+            const Pseudobond::Atoms &a = bond->atoms();
+            if (coords) {
+                auto c1 = scene_coords ? a[0]->effective_scene_coord() : a[0]->effective_coord();
+                auto c2 = scene_coords ? a[1]->effective_scene_coord() : a[1]->effective_coord();
+                *xyz1++ = c1[0]; *xyz1++ = c1[1]; *xyz1++ = c1[2];
+                *xyz2++ = c2[0]; *xyz2++ = c2[1]; *xyz2++ = c2[2];
+                *radii++ = bond->radius();
+            }
+            if (colors) {
+                const Rgba *c1, *c2;
+                if (bond->halfbond()) {
+                    c1 = &a[0]->color();
+                    c2 = &a[1]->color();
+                } else {
+                    c1 = c2 = &bond->color();
+                }
+                *rgba1++ = c1->r; *rgba1++ = c1->g; *rgba1++ = c1->b; *rgba1++ = c1->a;
+                *rgba2++ = c2->r; *rgba2++ = c2->g; *rgba2++ = c2->b; *rgba2++ = c2->a;
+            }
+        }
+    } catch (...) {
+        molc_error();
+    }
+    return python_tuple(py_xyz1, py_xyz2, py_radii, py_colors);
+}
+
+// Key for a value printed with "%.*f", equal exactly when the printed texts
+// are equal, so measurement labels are only remade when their text changes.
+// Values that print as nan, inf or more than 18 digits get no key.
+static const int64_t NO_TEXT_KEY = INT64_MIN;
+
+static int64_t measurement_text_key(double value, int decimal_places)
+{
+    char text[64];
+    int len = snprintf(text, sizeof(text), "%.*f", decimal_places, value);
+    if (len <= 0 || len >= (int)sizeof(text))
+        return NO_TEXT_KEY;
+    const char *c = text;
+    bool negative = (*c == '-');
+    if (negative)
+        ++c;
+    int64_t key = 0;
+    int digits = 0;
+    for ( ; *c ; ++c) {
+        if (*c == '.')
+            continue;
+        if (*c < '0' || *c > '9' || ++digits > 18)
+            return NO_TEXT_KEY;
+        key = 10*key + (*c - '0');
+    }
+    return negative ? -key - 1 : key;   // "-0.0" differs from "0.0"
+}
+
+template <class Measure>
+static void measurement_text_changes(size_t n, Measure measure, int decimal_places,
+    double *values, int64_t *keys, const int64_t *previous_keys, npy_bool *changed)
+{
+    for (size_t i = 0; i < n; ++i) {
+        double v = measure(i);
+        int64_t key = measurement_text_key(v, decimal_places);
+        values[i] = v;
+        keys[i] = key;
+        changed[i] = (previous_keys == nullptr || key == NO_TEXT_KEY || key != previous_keys[i]);
+    }
+}
+
+static double dihedral_angle(const Coord &p0, const Coord &p1, const Coord &p2, const Coord &p3)
+{
+    // same as chimerax.geometry.dihedral()
+    Coord v10 = p1 - p0, v12 = p1 - p2, v23 = p2 - p3;
+    auto cross = [](const Coord &a, const Coord &b) {
+        return Coord(a[1]*b[2] - a[2]*b[1], a[2]*b[0] - a[0]*b[2], a[0]*b[1] - a[1]*b[0]);
+    };
+    Coord t = cross(v10, v12), u = cross(v23, v12), v = cross(u, t);
+    double w = v[0]*v12[0] + v[1]*v12[1] + v[2]*v12[2];
+    double a = Coord(0,0,0).angle(u, t);
+    return w < 0 ? -a : a;
+}
+
+extern "C" EXPORT void pseudobond_length_text_changes(void *pbonds, size_t n, int decimal_places,
+    double *lengths, int64_t *keys, const int64_t *previous_keys, npy_bool *changed)
+{
+    // Scene lengths, and which differ in printed text from the previous keys.
+    TRACE_SCOPE_ITEMS("molc.pseudobond_length_text_changes", n);
+    Pseudobond **b = static_cast<Pseudobond **>(pbonds);
+    try {
+        auto length = [b](size_t i) {
+            const Pseudobond::Atoms &a = b[i]->atoms();
+            return a[0]->scene_coord().distance(a[1]->scene_coord());
+        };
+        measurement_text_changes(n, length, decimal_places, lengths, keys, previous_keys, changed);
+    } catch (...) {
+        molc_error();
+    }
+}
+
+extern "C" EXPORT void atom_measurement_text_changes(void *atoms, size_t n, int group_size,
+    int decimal_places, double *values, int64_t *keys, const int64_t *previous_keys,
+    npy_bool *changed)
+{
+    // Distances, angles or dihedrals of n consecutive groups of 2, 3 or 4 atoms
+    // in scene coordinates, and which differ in printed text from the previous keys.
+    TRACE_SCOPE_ITEMS("molc.atom_measurement_text_changes", n);
+    Atom **a = static_cast<Atom **>(atoms);
+    try {
+        auto measure = [a, group_size](size_t i) {
+            Atom **g = a + i*group_size;
+            if (group_size == 2)
+                return g[0]->scene_coord().distance(g[1]->scene_coord());
+            if (group_size == 3)
+                return Coord::angle(g[0]->scene_coord(), g[1]->scene_coord(), g[2]->scene_coord());
+            return dihedral_angle(g[0]->scene_coord(), g[1]->scene_coord(),
+                g[2]->scene_coord(), g[3]->scene_coord());
+        };
+        if (group_size < 2 || group_size > 4)
+            throw std::invalid_argument("measurements need groups of 2, 3 or 4 atoms");
+        measurement_text_changes(n, measure, decimal_places, values, keys, previous_keys, changed);
+    } catch (...) {
+        molc_error();
+    }
+}
+
 extern "C" EXPORT void pseudobond_get_session_id(void *ptrs, size_t n, int32_t *ses_ids)
 {
     Pseudobond **pbonds = static_cast<Pseudobond **>(ptrs);
@@ -3013,6 +3486,56 @@ extern "C" EXPORT void residue_num_atoms(void *residues, size_t n, size_t *natom
     }
 }
 
+// A sphere for each residue at the center of its shown atoms, with radius the
+// root mean square distance of those atoms from the center plus an atom radius,
+// colored with their average color.  Residues with no shown atoms get radius
+// zero.  Used to draw huge structures with one bead per residue.
+extern "C" EXPORT void residue_bead_spheres(void *residues, size_t n, float32_t atom_radius,
+                                            float32_t *xyzr, uint8_t *rgba)
+{
+    Residue **r = static_cast<Residue **>(residues);
+    try {
+        TRACE_SCOPE_ITEMS("atomic.residue_bead_spheres", n);
+        Thread_Pool::parallel_for(n, [&](int64_t i0, int64_t i1) {
+            for (int64_t i = i0; i < i1; ++i) {
+                double c[3] = {0, 0, 0}, c2 = 0;
+                unsigned int color[4] = {0, 0, 0, 0};
+                size_t na = 0;
+                for (auto a: r[i]->atoms()) {
+                    if (!a->visible())
+                        continue;
+                    const Coord &xyz = a->coord();
+                    for (int k = 0; k < 3; ++k) {
+                        c[k] += xyz[k];
+                        c2 += xyz[k] * xyz[k];
+                    }
+                    const Rgba &ac = a->color();
+                    color[0] += ac.r; color[1] += ac.g; color[2] += ac.b; color[3] += ac.a;
+                    ++na;
+                }
+                float32_t *s = xyzr + 4*i;
+                uint8_t *rc = rgba + 4*i;
+                if (na == 0) {
+                    s[0] = s[1] = s[2] = s[3] = 0;
+                    rc[0] = rc[1] = rc[2] = rc[3] = 0;
+                    continue;
+                }
+                double r2 = c2 / na;
+                for (int k = 0; k < 3; ++k) {
+                    c[k] /= na;
+                    s[k] = c[k];
+                    r2 -= c[k] * c[k];
+                }
+                s[3] = (r2 > 0 ? sqrt(r2) : 0) + atom_radius;
+                for (int k = 0; k < 4; ++k)
+                    rc[k] = color[k] / na;
+            }
+        }, 256);
+    } catch (...) {
+        molc_error();
+    }
+}
+
 extern "C" EXPORT void residue_number(void *residues, size_t n, int32_t *nums)
 {
     Residue **r = static_cast<Residue **>(residues);
@@ -3663,6 +4186,88 @@ extern "C" EXPORT PyObject *sseq_try_assoc(void *seq_ptr, void *sseq_ptr, size_t
     return tuple;
 }
 
+extern "C" EXPORT PyObject *sseq_best_assocs(PyObject *py_sseqs, PyObject *py_aseqs,
+    PyObject *py_params, PyObject *py_max_errors)
+{
+    try {
+        auto num_sseqs = PyList_GET_SIZE(py_sseqs);
+        if (PyList_GET_SIZE(py_aseqs) != num_sseqs || PyList_GET_SIZE(py_params) != num_sseqs
+        || PyList_GET_SIZE(py_max_errors) != num_sseqs)
+            throw std::logic_error("Sequence, parameter and error lists must be same size"
+                " as structure sequence list");
+        // alignment sequence contents are computed once, here, since
+        // Sequence caches its ungapped contents and so isn't safe to
+        // share between the matching threads
+        std::map<Sequence*, Sequence::Contents> contents;
+        std::vector<StructureSeq*> sseqs;
+        std::vector<std::vector<const Sequence::Contents*>> sseq_aseqs(num_sseqs);
+        std::vector<AssocParams> params(num_sseqs);
+        std::vector<unsigned int> max_errors;
+        for (Py_ssize_t i = 0; i < num_sseqs; ++i) {
+            sseqs.push_back(static_cast<StructureSeq*>(PyLong_AsVoidPtr(PyList_GET_ITEM(py_sseqs, i))));
+            PyObject *aseq_ptrs = PyList_GET_ITEM(py_aseqs, i);
+            for (Py_ssize_t j = 0; j < PyList_GET_SIZE(aseq_ptrs); ++j) {
+                Sequence *aseq = static_cast<Sequence*>(PyLong_AsVoidPtr(PyList_GET_ITEM(aseq_ptrs, j)));
+                auto ci = contents.find(aseq);
+                if (ci == contents.end())
+                    ci = contents.emplace(aseq, assoc_contents(*aseq)).first;
+                sseq_aseqs[i].push_back(&ci->second);
+            }
+            PyObject *py_ap = PyList_GET_ITEM(py_params, i);
+            params[i].est_len = PyLong_AsSize_t(PyTuple_GET_ITEM(py_ap, 0));
+            pysupport::pylist_of_string_to_cvec_of_cvec(PyTuple_GET_ITEM(py_ap, 1),
+                params[i].segments, "segment residue letter");
+            pysupport::pylist_of_int_to_cvec(PyTuple_GET_ITEM(py_ap, 2), params[i].gaps,
+                "estimated gap");
+            max_errors.push_back(PyLong_AsLong(PyList_GET_ITEM(py_max_errors, i)));
+        }
+        if (PyErr_Occurred())
+            return nullptr;
+
+        std::vector<BestAssoc> best(num_sseqs);
+        std::exception_ptr error;
+        std::mutex error_mutex;
+        Py_BEGIN_ALLOW_THREADS
+        Thread_Pool::parallel_for(num_sseqs, [&](int64_t i0, int64_t i1) {
+            for (auto i = i0; i < i1; ++i) {
+                try {
+                    best[i] = best_assoc(sseq_aseqs[i], *sseqs[i], params[i], max_errors[i]);
+                } catch (...) {
+                    std::lock_guard<std::mutex> lock(error_mutex);
+                    if (!error)
+                        error = std::current_exception();
+                }
+            }
+        }, 1);
+        Py_END_ALLOW_THREADS
+        if (error)
+            std::rethrow_exception(error);
+
+        PyObject *results = PyList_New(num_sseqs);
+        if (results == nullptr)
+            return nullptr;
+        for (Py_ssize_t i = 0; i < num_sseqs; ++i) {
+            if (best[i].aseq_index < 0) {
+                Py_INCREF(Py_None);
+                PyList_SET_ITEM(results, i, Py_None);
+                continue;
+            }
+            auto& arv = best[i].retvals;
+            PyObject *map = pysupport::cmap_of_ptr_int_to_pydict(arv.match_map.res_to_pos(),
+                "residue", "associated seq position");
+            PyObject *result = PyTuple_New(3);
+            PyTuple_SET_ITEM(result, 0, PyLong_FromLong(best[i].aseq_index));
+            PyTuple_SET_ITEM(result, 1, map);
+            PyTuple_SET_ITEM(result, 2, PyLong_FromLong(static_cast<long>(arv.num_errors)));
+            PyList_SET_ITEM(results, i, result);
+        }
+        return results;
+    } catch (...) {
+        molc_error();
+        return nullptr;
+    }
+}
+
 // -------------------------------------------------------------------------
 // change tracker functions
 //
@@ -3714,9 +4319,10 @@ static PyObject* changes_as_py_dict(const ChangeTracker::ChangesArray& all_chang
         PyTuple_SET_ITEM(value, 1, ptr_array);
 
         // third tuple item:  list of reasons
-        PyObject* reasons = PyList_New(class_changes.reasons.size());
+        auto reason_names = class_changes.reasons.names();
+        PyObject* reasons = PyList_New(reason_names.size());
         j = 0;
-        for (auto reason: class_changes.reasons)
+        for (auto& reason: reason_names)
             PyList_SetItem(reasons, j++, unicode_from_string(reason));
         PyTuple_SET_ITEM(value, 2, reasons);
 
@@ -3838,12 +4444,10 @@ extern "C" EXPORT PyObject* coordset_xyzs(void *coordset)
     PyObject* ret_val;
     try {
         double *v;
-        ret_val = python_double_array(cs->coords().size(), 3, &v);
-        for (auto xyz: cs->coords()) {
-            *v++ = xyz[0];
-            *v++ = xyz[1];
-            *v++ = xyz[2];
-        }
+        size_t n = cs->coords().size();
+        ret_val = python_double_array(n, 3, &v);
+        if (n > 0)
+            memcpy(v, cs->xyz(), 3 * n * sizeof(double));
     } catch (...) {
         molc_error();
         return nullptr;
@@ -3851,6 +4455,16 @@ extern "C" EXPORT PyObject* coordset_xyzs(void *coordset)
     return ret_val;
 }
 
+extern "C" EXPORT void coordset_set_xyzs(void *coordset, void *xyz, size_t n)
+{
+    CoordSet *cs = static_cast<CoordSet*>(coordset);
+    try {
+        cs->set_coords((double *)xyz, n);
+    } catch (...) {
+        molc_error();
+    }
+}
+
 // -------------------------------------------------------------------------
 // sequence functions
 //
@@ -4399,6 +5013,46 @@ extern "C" EXPORT void structure_add_coordset(void *mol, int id, void *xyz, size
     }
 }
 
+extern "C" EXPORT void structure_add_trajectory_coordsets(void *mol, bool replace, const char *path,
+    void *frame_offsets, size_t n_frames, size_t n_coords, void *axis_offsets, int64_t value_stride,
+    bool double_values, bool byte_swap, double scale, size_t memory_budget)
+{
+    Structure *m = static_cast<Structure *>(mol);
+    int64_t *foffsets = static_cast<int64_t *>(frame_offsets);
+    int64_t *aoffsets = static_cast<int64_t *>(axis_offsets);
+    try {
+        TrajectoryFile::Layout layout;
+        layout.num_coords = n_coords;
+        for (int a = 0; a < 3; ++a)
+            layout.axis_offset[a] = aoffsets[a];
+        layout.value_stride = value_stride;
+        layout.double_values = double_values;
+        layout.byte_swap = byte_swap;
+        layout.scale = scale;
+        auto traj = std::make_shared<TrajectoryFile>(path,
+            std::vector<int64_t>(foffsets, foffsets + n_frames), layout, memory_budget);
+        if (replace)
+            m->clear_coord_sets();
+        for (size_t i = 0; i < n_frames; ++i)
+            m->new_coord_set()->set_trajectory(traj, i);
+        if (replace && n_frames > 0)
+            m->set_active_coord_set(m->coord_sets()[0]);
+    } catch (...) {
+        molc_error();
+    }
+}
+
+extern "C" EXPORT void structure_compress_coordsets(void *mol, int compression)
+{
+    Structure *m = static_cast<Structure *>(mol);
+    try {
+        for (auto cs: m->coord_sets())
+            cs->set_compression(static_cast<CoordSet::Compression>(compression));
+    } catch (...) {
+        molc_error();
+    }
+}
+
 extern "C" EXPORT void structure_remove_coordsets(void *mol)
 {
     Structure *m = static_cast<Structure *>(mol);
@@ -4409,7 +5063,8 @@ extern "C" EXPORT void structure_remove_coordsets(void *mol)
     }
 }
 
-extern "C" EXPORT void structure_add_coordsets(void *mol, bool replace, void *xyz, size_t n_sets, size_t n_coords)
+extern "C" EXPORT void structure_add_coordsets(void *mol, bool replace, void *xyz, size_t n_sets, size_t n_coords,
+    int compression)
 {
     Structure *m = static_cast<Structure *>(mol);
     double* xyzs = (double*)xyz;
@@ -4419,6 +5074,7 @@ extern "C" EXPORT void structure_add_coordsets(void *mol, bool replace, void *xy
         for (size_t i = 0; i < n_sets; ++i) {
             CoordSet *cs = m->new_coord_set();
             cs->set_coords((double *)xyzs, n_coords);
+            cs->set_compression(static_cast<CoordSet::Compression>(compression));
             xyzs += n_coords * 3;
         }
         if (replace)
@@ -4428,6 +5084,100 @@ extern "C" EXPORT void structure_add_coordsets(void *mol, bool replace, void *xy
     }
 }
 
+// Coordsets and coordinate indices of atoms for trajectory analysis.
+static std::vector<const CoordSet*> _structure_frames(Structure *m, const int32_t *cs_ids, size_t ncs)
+{
+    std::vector<const CoordSet*> frames(ncs);
+    for (size_t i = 0; i < ncs; ++i) {
+        frames[i] = m->find_coord_set(cs_ids[i]);
+        if (frames[i] == nullptr) {
+            std::stringstream err_msg;
+            err_msg << "Structure has no coordset with ID " << cs_ids[i];
+            throw std::invalid_argument(err_msg.str());
+        }
+    }
+    return frames;
+}
+
+static std::vector<size_t> _structure_coord_indices(Structure *m, void *atoms, size_t natoms)
+{
+    Atom **a = static_cast<Atom **>(atoms);
+    std::vector<size_t> indices(natoms);
+    for (size_t i = 0; i < natoms; ++i) {
+        if (a[i]->structure() != m)
+            throw std::invalid_argument("Atoms must belong to the structure");
+        indices[i] = a[i]->coord_index();
+    }
+    return indices;
+}
+
+extern "C" EXPORT void structure_coordset_rmsds(void *mol, void *atoms, size_t natoms,
+    int32_t *cs_ids, size_t ncs, double *reference, bool superpose, double *rmsds,
+    double *transforms)
+{
+    Structure *m = static_cast<Structure *>(mol);
+    try {
+        auto frames = _structure_frames(m, cs_ids, ncs);
+        auto indices = _structure_coord_indices(m, atoms, natoms);
+        std::exception_ptr error;
+        Py_BEGIN_ALLOW_THREADS
+        try {
+            coordset_rmsds(frames, indices, reference, superpose, rmsds, transforms);
+        } catch (...) {
+            error = std::current_exception();
+        }
+        Py_END_ALLOW_THREADS
+        if (error)
+            std::rethrow_exception(error);
+    } catch (...) {
+        molc_error();
+    }
+}
+
+extern "C" EXPORT void structure_coordset_rmsf(void *mol, void *atoms, size_t natoms,
+    int32_t *cs_ids, size_t ncs, double *reference, bool superpose, double *rmsf)
+{
+    Structure *m = static_cast<Structure *>(mol);
+    try {
+        auto frames = _structure_frames(m, cs_ids, ncs);
+        auto indices = _structure_coord_indices(m, atoms, natoms);
+        std::exception_ptr error;
+        Py_BEGIN_ALLOW_THREADS
+        try {
+            coordset_rmsf(frames, indices, reference, superpose, rmsf);
+        } catch (...) {
+            error = std::current_exception();
+        }
+        Py_END_ALLOW_THREADS
+        if (error)
+            std::rethrow_exception(error);
+    } catch (...) {
+        molc_error();
+    }
+}
+
+extern "C" EXPORT void structure_coordset_rmsd_matrix(void *mol, void *atoms, size_t natoms,
+    int32_t *cs_ids, size_t ncs, bool superpose, double *matrix)
+{
+    Structure *m = static_cast<Structure *>(mol);
+    try {
+        auto frames = _structure_frames(m, cs_ids, ncs);
+        auto indices = _structure_coord_indices(m, atoms, natoms);
+        std::exception_ptr error;
+        Py_BEGIN_ALLOW_THREADS
+        try {
+            coordset_rmsd_matrix(frames, indices, superpose, matrix);
+        } catch (...) {
+            error = std::current_exception();
+        }
+        Py_END_ALLOW_THREADS
+        if (error)
+            std::rethrow_exception(error);
+    } catch (...) {
+        molc_error();
+    }
+}
+
 extern "C" EXPORT PyObject *structure_ribbon_orient(void *mol, void *residues, size_t n)
 {
     Structure *m = static_cast<Structure *>(mol);
@@ -4462,7 +5212,7 @@ extern "C" EXPORT void structure_coordset_size(void *mols, size_t n, int32_t *co
     try {
       for (size_t i = 0; i != n; ++i) {
         CoordSet *cs = m[i]->active_coord_set();
-        *coordset_size++ = (cs ? cs->coords().size() : 0);
+        *coordset_size++ = (cs ? cs->coords_size() : 0);
       }
     } catch (...) {
         molc_error();
@@ -4717,6 +5467,40 @@ extern "C" EXPORT void structure_renumber_residues(void *structure, PyObject *py
     }
 }
 
+extern "C" EXPORT void structure_set_residue_numbers(void *structure, void *residues, size_t n,
+    int32_t *numbers, const char *insertion_codes, bool check_only)
+{
+    Structure *s = static_cast<Structure *>(structure);
+    Residue **r = static_cast<Residue **>(residues);
+    try {
+        std::vector<Residue*> res_list(r, r + n);
+        std::vector<int> nums(numbers, numbers + n);
+        std::vector<char> codes(insertion_codes, insertion_codes + n);
+        s->renumber_residues(res_list, nums, codes, check_only);
+    } catch (...) {
+        molc_error();
+    }
+}
+
+extern "C" EXPORT void structure_set_residue_chain_ids(void *structure, void *residues, size_t n,
+    PyObject *py_chain_ids, bool check_only)
+{
+    Structure *s = static_cast<Structure *>(structure);
+    Residue **r = static_cast<Residue **>(residues);
+    try {
+        if (static_cast<size_t>(PyList_GET_SIZE(py_chain_ids)) != n)
+            throw std::logic_error("Chain ID list must be same size as residue list");
+        std::vector<Residue*> res_list(r, r + n);
+        std::vector<ChainID> chain_ids;
+        chain_ids.reserve(n);
+        for (size_t i = 0; i < n; ++i)
+            chain_ids.push_back(ChainID(CheckedPyUnicode_AsUTF8(PyList_GET_ITEM(py_chain_ids, i))));
+        s->change_residue_chain_ids(res_list, chain_ids, check_only);
+    } catch (...) {
+        molc_error();
+    }
+}
+
 extern "C" EXPORT void structure_reorder_residues(void *structure, PyObject *py_new_order)
 {
     Structure *s = static_cast<Structure *>(structure);
@@ -4843,7 +5627,7 @@ extern "C" EXPORT size_t structure_session_atom_to_id(void *mol, void* atom)
     Structure *m = static_cast<Structure *>(mol);
     Atom *a = static_cast<Atom *>(atom);
     try {
-        return (*m->session_save_atoms)[a];
+        return m->atom_index(a);
     } catch (...) {
         molc_error();
         return -1;
@@ -4855,7 +5639,7 @@ extern "C" EXPORT size_t structure_session_bond_to_id(void *mol, void* bond)
     Structure *m = static_cast<Structure *>(mol);
     Bond *b = static_cast<Bond *>(bond);
     try {
-        return (*m->session_save_bonds)[b];
+        return m->bond_index(b);
     } catch (...) {
         molc_error();
         return -1;
@@ -4879,7 +5663,7 @@ extern "C" EXPORT size_t structure_session_residue_to_id(void *mol, void* res)
     Structure *m = static_cast<Structure *>(mol);
     Residue *r = static_cast<Residue *>(res);
     try {
-        return (*m->session_save_residues)[r];
+        return m->residue_index(r);
     } catch (...) {
         molc_error();
         return -1;
@@ -5060,6 +5844,25 @@ extern "C" EXPORT PyObject *structure_molecules(void *mol)
     }
 }
 
+extern "C" EXPORT PyObject *structure_memory_usage(void *mol)
+{
+    Structure *s = static_cast<Structure *>(mol);
+    PyObject* usage = NULL;
+    try {
+        usage = PyDict_New();
+        for (auto& cat_bytes: s->memory_usage()) {
+            PyObject* bytes = PyLong_FromSize_t(cat_bytes.second);
+            PyDict_SetItemString(usage, cat_bytes.first.c_str(), bytes);
+            Py_DECREF(bytes);
+        }
+        return usage;
+    } catch (...) {
+        Py_XDECREF(usage);
+        molc_error();
+        return nullptr;
+    }
+}
+
 extern "C" EXPORT PyObject *structure_nonstandard_residue_names(void *mol)
 {
     Structure *m = static_cast<Structure *>(mol);
@@ -5164,6 +5967,242 @@ extern "C" EXPORT PyObject *structure_chain_trace_atoms(void *mol)
     return atom_pairs;
 }
 
+extern "C" EXPORT PyObject *structure_close_atom_pairs(void *mol, double distance)
+{
+    Structure *m = static_cast<Structure *>(mol);
+    PyObject *atom_pairs = nullptr;
+    try {
+        auto pairs = m->cell_list(distance).close_pairs(distance);
+        void **ap0, **ap1;
+        PyObject *a0 = python_voidp_array(pairs.size(), &ap0);
+        PyObject *a1 = python_voidp_array(pairs.size(), &ap1);
+        size_t i = 0;
+        for (auto& p: pairs) {
+            ap0[i] = static_cast<void *>(p.first);
+            ap1[i] = static_cast<void *>(p.second);
+            ++i;
+        }
+        atom_pairs = python_tuple(a0, a1);
+    } catch (...) {
+        molc_error();
+    }
+    return atom_pairs;
+}
+
+// Atoms of each structure within distance of any scene point, using the
+// structure's cached cell list.  Positions are the rigid 3x4 scene transforms
+// of the structures, and the points are moved into each structure's
+// coordinates rather than moving its atoms.  Level ':' expands to whole
+// residues, '/' to whole chains and '#' to the whole structure.  With beyond
+// true the zone is atoms not within distance, and residues or structures with
+// any such atom, or chains with no atom within.  Returns a list giving for
+// each structure bool masks of its atoms and its residues in the zone.
+extern "C" EXPORT PyObject *structure_zone_masks(void *structures, size_t ns, double *positions,
+    double *points, size_t np, double distance, char level, bool beyond)
+{
+    Structure **sa = static_cast<Structure **>(structures);
+    PyObject *masks = nullptr;
+    try {
+        TRACE_SCOPE_ITEMS("atomic.structure_zone_masks", np * ns);
+        masks = PyList_New(ns);
+        std::vector<Coord> local(np);
+        for (size_t si = 0; si < ns; ++si) {
+            const Structure *s = sa[si];
+            const double *p = positions + 12*si;
+            for (size_t i = 0; i < np; ++i) {
+                const double *xyz = points + 3*i;
+                double d0 = xyz[0] - p[3], d1 = xyz[1] - p[7], d2 = xyz[2] - p[11];
+                local[i] = Coord(p[0]*d0 + p[4]*d1 + p[8]*d2,
+                                 p[1]*d0 + p[5]*d1 + p[9]*d2,
+                                 p[2]*d0 + p[6]*d1 + p[10]*d2);
+            }
+            const Structure::Atoms& atoms = s->atoms();
+            const Structure::Residues& residues = s->residues();
+            size_t na = atoms.size(), nr = residues.size();
+            unsigned char *amask, *rmask;
+            PyObject *am = python_bool_array(na, &amask);
+            PyObject *rm = python_bool_array(nr, &rmask);
+            PyList_SET_ITEM(masks, si, python_tuple(am, rm));
+            std::vector<unsigned char> within(na, 0);
+            if (np > 0)
+                s->cell_list_near(std::max(distance, 2.0)).mark_within(local.data(), np,
+                    distance, within.data());
+
+            std::unordered_map<const Residue *, size_t> rindex;
+            rindex.reserve(nr);
+            for (size_t r = 0; r < nr; ++r)
+                rindex[residues[r]] = r;
+            std::vector<size_t> ares(na);
+            for (size_t i = 0; i < na; ++i)
+                ares[i] = rindex[atoms[i]->residue()];
+
+            memset(rmask, 0, nr);
+            if (level == ':') {
+                for (size_t i = 0; i < na; ++i)
+                    if (within[i] != beyond)
+                        rmask[ares[i]] = 1;
+                for (size_t i = 0; i < na; ++i)
+                    amask[i] = rmask[ares[i]];
+                continue;
+            }
+            if (level == '/') {
+                std::vector<const ChainID *> cids;
+                const Residue *last = nullptr;
+                for (size_t i = 0; i < na; ++i) {
+                    const Residue *r = atoms[i]->residue();
+                    if (within[i] && r != last) {
+                        last = r;
+                        const ChainID &cid = r->chain_id();
+                        if (std::find_if(cids.begin(), cids.end(),
+                                [&cid](const ChainID *c) { return *c == cid; }) == cids.end())
+                            cids.push_back(&cid);
+                    }
+                }
+                bool in_chain = false;
+                last = nullptr;
+                for (size_t i = 0; i < na; ++i) {
+                    const Residue *r = atoms[i]->residue();
+                    if (r != last) {
+                        last = r;
+                        const ChainID &cid = r->chain_id();
+                        in_chain = (std::find_if(cids.begin(), cids.end(),
+                                [&cid](const ChainID *c) { return *c == cid; }) != cids.end());
+                    }
+                    amask[i] = (in_chain != beyond);
+                }
+            } else if (level == '#') {
+                bool any = false;
+                for (size_t i = 0; i < na && !any; ++i)
+                    any = (within[i] != beyond);
+                memset(amask, any, na);
+            } else {
+                for (size_t i = 0; i < na; ++i)
+                    amask[i] = (within[i] != beyond);
+            }
+            for (size_t i = 0; i < na; ++i)
+                if (amask[i])
+                    rmask[ares[i]] = 1;
+        }
+    } catch (...) {
+        Py_XDECREF(masks);
+        masks = nullptr;
+        molc_error();
+    }
+    return masks;
+}
+
+extern "C" EXPORT PyObject *structure_atom_display_state(void *mol)
+{
+    Structure *m = static_cast<Structure *>(mol);
+    PyObject *state = nullptr;
+    try {
+        static_assert(sizeof(AtomDisplayState) == 8, "AtomDisplayState not packed in 8 bytes");
+        auto& ds = m->atom_display_state();
+        unsigned char *data;
+        state = python_uint8_array(ds.size(), sizeof(AtomDisplayState), &data);
+        if (ds.size() > 0)
+            memcpy(data, ds.data(), ds.size() * sizeof(AtomDisplayState));
+    } catch (...) {
+        molc_error();
+    }
+    return state;
+}
+
+// Structure-wide atom getters.  These read a range of a structure's atoms directly,
+// so collections spanning whole structures need not pass a pointer array, and
+// coordinates come straight from the active coordinate set.
+static Atom* const*
+structure_atom_range(void *mol, size_t start, size_t n)
+{
+    auto& atoms = static_cast<Structure *>(mol)->atoms();
+    if (start > atoms.size() || n > atoms.size() - start)
+        throw std::out_of_range("Atom range exceeds structure atoms");
+    return atoms.data() + start;
+}
+
+extern "C" EXPORT void structure_atoms_coord(void *mol, size_t start, size_t n, float64_t *xyz)
+{
+    try {
+        Atom* const* a = structure_atom_range(mol, start, n);
+        CoordSet *cs = static_cast<Structure *>(mol)->active_coord_set();
+        if (cs == nullptr && n > 0)
+            throw std::logic_error("no active coordinate set");
+        const Coord* coords = n > 0 ? cs->coords().data() : nullptr;
+        size_t num_coords = n > 0 ? cs->coords().size() : 0;
+        for (size_t i = 0; i != n; ++i) {
+            unsigned int ci = a[i]->coord_index();
+            // alternate locations and unassigned coordinates take the usual route
+            const Coord &c = (ci < num_coords && a[i]->alt_loc() == ' ') ?
+                coords[ci] : a[i]->coord();
+            *xyz++ = c[0];
+            *xyz++ = c[1];
+            *xyz++ = c[2];
+        }
+    } catch (...) {
+        molc_error();
+    }
+}
+
+extern "C" EXPORT void structure_atoms_color(void *mol, size_t start, size_t n, uint8_t *rgba)
+{
+    try {
+        Atom* const* a = structure_atom_range(mol, start, n);
+        for (size_t i = 0; i != n; ++i) {
+            const Rgba &c = a[i]->color();
+            *rgba++ = c.r;
+            *rgba++ = c.g;
+            *rgba++ = c.b;
+            *rgba++ = c.a;
+        }
+    } catch (...) {
+        molc_error();
+    }
+}
+
+extern "C" EXPORT void structure_atoms_display(void *mol, size_t start, size_t n, npy_bool *disp)
+{
+    try {
+        Atom* const* a = structure_atom_range(mol, start, n);
+        for (size_t i = 0; i != n; ++i)
+            disp[i] = a[i]->display();
+    } catch (...) {
+        molc_error();
+    }
+}
+
+extern "C" EXPORT void structure_atoms_draw_mode(void *mol, size_t start, size_t n, uint8_t *modes)
+{
+    try {
+        Atom* const* a = structure_atom_range(mol, start, n);
+        for (size_t i = 0; i != n; ++i)
+            modes[i] = static_cast<uint8_t>(a[i]->draw_mode());
+    } catch (...) {
+        molc_error();
+    }
+}
+
+extern "C" EXPORT void structure_atoms_radius(void *mol, size_t start, size_t n, float32_t *radii)
+{
+    try {
+        Atom* const* a = structure_atom_range(mol, start, n);
+        for (size_t i = 0; i != n; ++i)
+            radii[i] = a[i]->radius();
+    } catch (...) {
+        molc_error();
+    }
+}
+
+extern "C" EXPORT void structure_atoms_selected(void *mol, size_t start, size_t n, npy_bool *sel)
+{
+    try {
+        Atom* const* a = structure_atom_range(mol, start, n);
+        for (size_t i = 0; i != n; ++i)
+            sel[i] = a[i]->selected();
+    } catch (...) {
+        molc_error();
+    }
+}
+
 extern "C" EXPORT void *structure_new(PyObject* logger)
 {
     try {
@@ -5295,6 +6334,60 @@ extern "C" EXPORT PyObject *structure_new_bond(void *mol, void *atom1, void *ato
     }
 }
 
+extern "C" EXPORT PyObject *structure_new_hydrogens(void *mol, void *parents, size_t n,
+    pyobject_t *names, double *coords, int32_t *serial_numbers, uint8_t *colors)
+{
+    Structure *m = static_cast<Structure *>(mol);
+    Atom **p = static_cast<Atom **>(parents);
+    try {
+        std::vector<Atom*> parent_atoms(p, p + n);
+        std::vector<std::string> h_names(n);
+        std::vector<Coord> xyz(n);
+        std::vector<Rgba> rgba(n);
+        for (size_t i = 0; i < n; ++i) {
+            h_names[i] = CheckedPyUnicode_AsUTF8(static_cast<PyObject *>(names[i]));
+            xyz[i].set_xyz(coords[3*i], coords[3*i+1], coords[3*i+2]);
+            rgba[i] = Rgba(colors[4*i], colors[4*i+1], colors[4*i+2], colors[4*i+3]);
+        }
+        auto hyds = m->new_hydrogens(parent_atoms, h_names, xyz.data(), serial_numbers,
+            rgba.data());
+        void **ha;
+        PyObject *h_array = python_voidp_array(hyds.size(), &ha);
+        for (size_t i = 0; i < hyds.size(); ++i)
+            ha[i] = hyds[i];
+        return h_array;
+    } catch (...) {
+        molc_error();
+        return nullptr;
+    }
+}
+
+extern "C" EXPORT void place_hydrogens(void *parents, size_t n, int32_t *geometries,
+    int32_t *substituents, double *bond_lengths, void *crowd_atoms, size_t ncrowd,
+    double *crowd_coords, float *crowd_radii, int32_t *crowd_groups, int32_t num_groups,
+    uint8_t *interacts, double metal_dist, double *positions, int32_t *counts, uint8_t *keep)
+{
+    Atom **p = static_cast<Atom **>(parents);
+    Atom **c = static_cast<Atom **>(crowd_atoms);
+    try {
+        std::vector<Atom*> parent_atoms(p, p + n), crowd(c, c + ncrowd);
+        std::exception_ptr error;
+        Py_BEGIN_ALLOW_THREADS
+        try {
+            place_hydrogens(parent_atoms, geometries, substituents, bond_lengths, crowd,
+                crowd_coords, crowd_radii, crowd_groups, num_groups, interacts, metal_dist,
+                positions, counts, keep);
+        } catch (...) {
+            error = std::current_exception();
+        }
+        Py_END_ALLOW_THREADS
+        if (error)
+            std::rethrow_exception(error);
+    } catch (...) {
+        molc_error();
+    }
+}
+
 extern "C" EXPORT void structure_new_coordset_default(void *mol)
 {
     Structure *m = static_cast<Structure *>(mol);
@@ -5585,13 +6678,13 @@ public:
         return arrays.size();
     }
 private:
-    virtual void  destructors_done(const std::set<void*>& destroyed)
+    virtual void  destructors_done(const std::unordered_set<void*>& destroyed)
     {
         for (auto a: arrays)
             filter_array(a, destroyed);
     }
 
-    void filter_array(PyArrayObject *a, const std::set<void*>& destroyed)
+    void filter_array(PyArrayObject *a, const std::unordered_set<void*>& destroyed)
     {
         // Remove any destroyed pointers from numpy array and shrink the array in place.
         // Numpy array must be contiguous, 1 dimensional array.
@@ -5658,6 +6751,122 @@ extern "C" EXPORT void pointer_array_freed(void *numpy_array)
 
 // -------------------------------------------------------------------------
 // pointer array functions
+//
+// Set operations on pointer arrays use hash sets, and for atoms a bit per
+// coordinate index of each structure, so they take linear time.  Results
+// keep the order of the first array.
+//
+typedef std::unordered_set<const void *> PointerSet;
+
+class Pointer_Hash_Set
+{
+public:
+    Pointer_Hash_Set(size_t n) { _set.reserve(n); }
+    bool insert(const void *p) { return _set.insert(p).second; }
+    bool contains(const void *p) const { return _set.find(p) != _set.end(); }
+private:
+    PointerSet _set;
+};
+
+// Atoms of a structure have distinct coordinate indices, so a set of atoms
+// is a bit array for each structure.  Collections usually hold runs of atoms
+// from one structure so the bits of the last structure used are kept at hand.
+class Atom_Bit_Set
+{
+public:
+    Atom_Bit_Set(size_t) : _last_structure(nullptr), _last_bits(nullptr) {}
+    bool insert(const void *p)
+    {
+        const Atom *a = static_cast<const Atom *>(p);
+        if (!a->has_coord_index())
+            return _unassigned.insert(p).second;
+        unsigned int ci = a->coord_index();
+        std::vector<uint64_t> &b = *bits(a->structure(), true);
+        size_t w = ci >> 6;
+        if (w >= b.size())
+            b.resize(std::max(w + 1, 2 * b.size()), 0);
+        uint64_t bit = (uint64_t)1 << (ci & 63);
+        if (b[w] & bit)
+            return false;
+        b[w] |= bit;
+        return true;
+    }
+    bool contains(const void *p)
+    {
+        const Atom *a = static_cast<const Atom *>(p);
+        if (!a->has_coord_index())
+            return _unassigned.find(p) != _unassigned.end();
+        unsigned int ci = a->coord_index();
+        std::vector<uint64_t> *b = bits(a->structure(), false);
+        size_t w = ci >> 6;
+        return b && w < b->size() && ((*b)[w] >> (ci & 63)) & 1;
+    }
+private:
+    std::vector<uint64_t> *bits(const Structure *s, bool create)
+    {
+        if (s == _last_structure)
+            return _last_bits;
+        auto si = _bits.find(s);
+        if (si == _bits.end()) {
+            if (!create)
+                return nullptr;
+            si = _bits.emplace(s, std::vector<uint64_t>(s->atoms().size() / 64 + 1, 0)).first;
+        }
+        _last_structure = s;
+        return _last_bits = &si->second;
+    }
+    std::unordered_map<const Structure *, std::vector<uint64_t>> _bits;
+    const Structure *_last_structure;
+    std::vector<uint64_t> *_last_bits;
+    PointerSet _unassigned;
+};
+
+template <class Set>
+static void set_mask(void **pa, size_t n, void **pa2, size_t n2, unsigned char *mask)
+{
+    Set s(n2);
+    for (size_t i = 0; i != n2; ++i)
+        s.insert(pa2[i]);
+    for (size_t i = 0; i != n; ++i)
+        mask[i] = (s.contains(pa[i]) ? 1 : 0);
+}
+
+template <class Set>
+static PyObject *set_union(void **pa, size_t n, void **pa2, size_t n2)
+{
+    Set s(n + n2);
+    std::vector<void *> u;
+    u.reserve(n + n2);
+    for (size_t i = 0; i != n; ++i)
+        if (s.insert(pa[i]))
+            u.push_back(pa[i]);
+    for (size_t i = 0; i != n2; ++i)
+        if (s.insert(pa2[i]))
+            u.push_back(pa2[i]);
+    void **up;
+    PyObject *ua = python_voidp_array(u.size(), &up);
+    std::copy(u.begin(), u.end(), up);
+    return ua;
+}
+
+template <class Set>
+static PyObject *set_difference(void **pa, size_t n, void **pa2, size_t n2)
+{
+    // Subtracted pointers are put in the set so a pointer is kept only once.
+    Set s(n + n2);
+    for (size_t i = 0; i != n2; ++i)
+        s.insert(pa2[i]);
+    std::vector<void *> d;
+    d.reserve(n);
+    for (size_t i = 0; i != n; ++i)
+        if (s.insert(pa[i]))
+            d.push_back(pa[i]);
+    void **dp;
+    PyObject *da = python_voidp_array(d.size(), &dp);
+    std::copy(d.begin(), d.end(), dp);
+    return da;
+}
+
 extern "C" EXPORT Py_ssize_t pointer_index(void *pointer_array, size_t n, void *pointer)
 {
     void **pa = static_cast<void **>(pointer_array);
@@ -5677,26 +6886,107 @@ extern "C" EXPORT void pointer_mask(void *pointer_array, size_t n, void *pointer
     void **pa = static_cast<void **>(pointer_array);
     void **pa2 = static_cast<void **>(pointer_array2);
     try {
-        std::set<void *> s;
-        for (size_t i = 0; i != n2; ++i)
-            s.insert(pa2[i]);
-        for (size_t i = 0; i != n; ++i)
-            mask[i] = (s.find(pa[i]) == s.end() ? 0 : 1);
+        set_mask<Pointer_Hash_Set>(pa, n, pa2, n2, mask);
     } catch (...) {
         molc_error();
     }
 }
 
+extern "C" EXPORT void atom_mask(void *atoms, size_t n, void *atoms2, size_t n2, unsigned char *mask)
+{
+    void **pa = static_cast<void **>(atoms);
+    void **pa2 = static_cast<void **>(atoms2);
+    try {
+        TRACE_SCOPE_ITEMS("atomic.atom_mask", n + n2);
+        set_mask<Atom_Bit_Set>(pa, n, pa2, n2, mask);
+    } catch (...) {
+        molc_error();
+    }
+}
+
+extern "C" EXPORT PyObject *pointer_merge(void *pointer_array, size_t n, void *pointer_array2, size_t n2)
+{
+    void **pa = static_cast<void **>(pointer_array);
+    void **pa2 = static_cast<void **>(pointer_array2);
+    try {
+        return set_union<Pointer_Hash_Set>(pa, n, pa2, n2);
+    } catch (...) {
+        molc_error();
+        return nullptr;
+    }
+}
+
+extern "C" EXPORT PyObject *atom_merge(void *atoms, size_t n, void *atoms2, size_t n2)
+{
+    void **pa = static_cast<void **>(atoms);
+    void **pa2 = static_cast<void **>(atoms2);
+    try {
+        TRACE_SCOPE_ITEMS("atomic.atom_merge", n + n2);
+        return set_union<Atom_Bit_Set>(pa, n, pa2, n2);
+    } catch (...) {
+        molc_error();
+        return nullptr;
+    }
+}
+
+extern "C" EXPORT PyObject *pointer_subtract(void *pointer_array, size_t n, void *pointer_array2, size_t n2)
+{
+    void **pa = static_cast<void **>(pointer_array);
+    void **pa2 = static_cast<void **>(pointer_array2);
+    try {
+        return set_difference<Pointer_Hash_Set>(pa, n, pa2, n2);
+    } catch (...) {
+        molc_error();
+        return nullptr;
+    }
+}
+
+extern "C" EXPORT PyObject *atom_subtract(void *atoms, size_t n, void *atoms2, size_t n2)
+{
+    void **pa = static_cast<void **>(atoms);
+    void **pa2 = static_cast<void **>(atoms2);
+    try {
+        TRACE_SCOPE_ITEMS("atomic.atom_subtract", n + n2);
+        return set_difference<Atom_Bit_Set>(pa, n, pa2, n2);
+    } catch (...) {
+        molc_error();
+        return nullptr;
+    }
+}
+
+extern "C" EXPORT PyObject *pointer_unique(void *pointer_array, size_t n)
+{
+    void **pa = static_cast<void **>(pointer_array);
+    try {
+        return set_union<Pointer_Hash_Set>(pa, n, nullptr, 0);
+    } catch (...) {
+        molc_error();
+        return nullptr;
+    }
+}
+
+extern "C" EXPORT PyObject *atom_unique(void *atoms, size_t n)
+{
+    void **pa = static_cast<void **>(atoms);
+    try {
+        return set_union<Atom_Bit_Set>(pa, n, nullptr, 0);
+    } catch (...) {
+        molc_error();
+        return nullptr;
+    }
+}
+
 extern "C" EXPORT void pointer_indices(void *pointer_array, size_t n, void *pointer_array2, size_t n2, int *indices)
 {
     void **pa = static_cast<void **>(pointer_array);
     void **pa2 = static_cast<void **>(pointer_array2);
     try {
-        std::map<void *,int> s;
+        std::unordered_map<const void *,int> s;
+        s.reserve(n2);
         for (size_t i = 0; i != n2; ++i)
             s[pa2[i]] = i;
         for (size_t i = 0; i != n; ++i) {
-            std::map<void *,int>::iterator si = s.find(pa[i]);
+            auto si = s.find(pa[i]);
             indices[i] = (si == s.end() ? -1 : si->second);
         }
     } catch (...) {
@@ -5709,9 +6999,7 @@ extern "C" EXPORT bool pointer_intersects(void *pointer_array, size_t n, void *p
     void **pa = static_cast<void **>(pointer_array);
     void **pa2 = static_cast<void **>(pointer_array2);
     try {
-        std::set<void *> s;
-        for (size_t i = 0; i != n2; ++i)
-            s.insert(pa2[i]);
+        PointerSet s(pa2, pa2 + n2);
         for (size_t i = 0; i != n; ++i)
             if (s.find(pa[i]) != s.end())
                 return true;
@@ -5729,9 +7017,7 @@ extern "C" EXPORT void pointer_intersects_each(void *pointer_arrays, size_t na,
     void ***pas = static_cast<void ***>(pointer_arrays);
     void **pa = static_cast<void **>(pointer_array);
     try {
-        std::set<void *> s;
-        for (size_t i = 0; i != n; ++i)
-            s.insert(pa[i]);
+        PointerSet s(pa, pa + n);
         for (size_t i = 0 ; i != na; ++i) {
             size_t m = sizes[i];
             void **pai = pas[i];
@@ -5747,14 +7033,17 @@ extern "C" EXPORT void pointer_intersects_each(void *pointer_arrays, size_t na,
     }
 }
 
-typedef std::map<void *, int> PointerTable;
+// Maps each pointer to the index of its first occurrence.  Python keeps one
+// table per collection for repeated lookups.
+typedef std::unordered_map<const void *, int> PointerTable;
 extern "C" EXPORT void *pointer_table_create(void *pointer_array, size_t n)
 {
     void **pa = static_cast<void **>(pointer_array);
     PointerTable *t = new PointerTable;
     try {
-      for (int i = n-1; i >= 0; --i)
-	(*t)[pa[i]] = i;
+      t->reserve(n);
+      for (size_t i = 0; i < n; ++i)
+	t->emplace(pa[i], i);
     } catch (...) {
         molc_error();
     }
@@ -5798,6 +7087,18 @@ extern "C" EXPORT void pointer_table_includes_each(void *pointer_table, void *po
     }
 }
 
+extern "C" EXPORT Py_ssize_t pointer_table_index(void *pointer_table, void *pointer)
+{
+    PointerTable *t = static_cast<PointerTable *>(pointer_table);
+    try {
+        PointerTable::iterator ti = t->find(pointer);
+        return (ti == t->end() ? -1 : ti->second);
+    } catch (...) {
+        molc_error();
+        return -1;
+    }
+}
+
 extern "C" EXPORT void pointer_table_indices(void *pointer_table, void *pointer_array, size_t n,
 					     int *indices)
 {
@@ -57,6 +57,8 @@ static struct PyMethodDef ribbons_cpp_methods[] =
    METH_VARARGS|METH_KEYWORDS, NULL},
   {const_cast<char*>("set_atom_tether_positions"), (PyCFunction)set_atom_tether_positions,
    METH_VARARGS|METH_KEYWORDS, NULL},
+  {const_cast<char*>("tether_placements"), (PyCFunction)tether_placements,
+   METH_VARARGS|METH_KEYWORDS, NULL},
   {const_cast<char*>("get_polymer_spline"), (PyCFunction)get_polymer_spline,
    METH_VARARGS|METH_KEYWORDS, NULL},
 
@@ -73,6 +75,8 @@ static struct PyMethodDef ribbons_cpp_methods[] =
    METH_VARARGS|METH_KEYWORDS, NULL},
   {const_cast<char*>("ribbon_extrusions"), (PyCFunction)ribbon_extrusions,
    METH_VARARGS|METH_KEYWORDS, NULL},
+  {const_cast<char*>("ribbon_chain_extrusions"), (PyCFunction)ribbon_chain_extrusions,
+   METH_VARARGS|METH_KEYWORDS, NULL},
   {const_cast<char*>("geometry_new"), (PyCFunction)geometry_new,
    METH_VARARGS|METH_KEYWORDS, NULL},
   {const_cast<char*>("geometry_delete"), (PyCFunction)geometry_delete,
@@ -34,6 +34,7 @@
 #include <Python.h>			// use PyObject
 
 #include <arrays/pythonarray.h>		// use python_float_array
+#include <arrays/trace.h>		// use TRACE_SCOPE_ITEMS
 #include <atomstruct/Atom.h>		// use Atom
 using atomstruct::Atom;
 #include <atomstruct/Coord.h>		// use Coord
@@ -137,9 +138,9 @@ PyObject *cubic_path(PyObject *, PyObject *args, PyObject *keywds)
 
 // -----------------------------------------------------------------------------
 //
-static void spline_path(const double *coeffs, int nseg, const float *normals,
-			const unsigned char *flip, const unsigned char *twist, int ndiv,
-			float *ca, float *ta, float *na)
+void compute_spline_path(const double *coeffs, int nseg, const float *normals,
+			 const unsigned char *flip, const unsigned char *twist, int ndiv,
+			 float *ca, float *ta, float *na)
 {
   int np = ndiv/2;
   cubic_path(coeffs, -0.3, 0, np+1, ca, ta);
@@ -271,8 +272,8 @@ PyObject *spline_path(PyObject *, PyObject *args, PyObject *keywds)
   PyObject *ptangents = python_float_array(num_points, 3, &ta);
   PyObject *pnormals = python_float_array(num_points, 3, &na);
 
-  spline_path(coeffs.values(), nseg, normals.values(), flip.values(), twist.values(), ndiv,
-	      ca, ta, na);
+  compute_spline_path(coeffs.values(), nseg, normals.values(), flip.values(), twist.values(),
+		      ndiv, ca, ta, na);
 
   PyObject *ctn = python_tuple(pcoords, ptangents, pnormals);
   return ctn;
@@ -568,6 +569,43 @@ static void set_atom_ribbon_positions(const Residues &residues,
     }
 }
 
+// -----------------------------------------------------------------------------
+//
+// Atoms positioned on the ribbon spline and their spline parameters, saved so that
+// atoms need not be looked up by name again when only the spline changes.
+//
+class Tether_Placements
+{
+public:
+  std::vector<Atom *> atoms;	// Non-tethered atoms followed by tethered atoms.
+  std::vector<float> offsets;
+  size_t num_non_tether;
+};
+
+static void delete_tether_placements(PyObject *capsule)
+{
+  delete static_cast<Tether_Placements *>(PyCapsule_GetPointer(capsule, "Tether_Placements"));
+}
+
+// -----------------------------------------------------------------------------
+//
+extern "C"
+PyObject *tether_placements(PyObject *, PyObject *args, PyObject *keywds)
+{
+  Residues residues;
+  const char *kwlist[] = {"residues", NULL};
+  if (!PyArg_ParseTupleAndKeywords(args, keywds, const_cast<char *>("O&"),
+				   (char **)kwlist,
+				   parse_residues, &residues))
+    return NULL;
+
+  Tether_Placements *p = new Tether_Placements;
+  atom_spline_positions(residues, _non_tether_positions, p->atoms, p->offsets);
+  p->num_non_tether = p->atoms.size();
+  atom_spline_positions(residues, _tether_positions, p->atoms, p->offsets);
+  return PyCapsule_New(p, "Tether_Placements", delete_tether_placements);
+}
+
 // -----------------------------------------------------------------------------
 //
 extern "C"
@@ -575,17 +613,40 @@ PyObject *set_atom_tether_positions(PyObject *, PyObject *args, PyObject *keywds
 {
   Residues residues;
   DArray coef;
-  const char *kwlist[] = {"residues", "spline_coef", NULL};
-  if (!PyArg_ParseTupleAndKeywords(args, keywds, const_cast<char *>("O&O&"),
+  PyObject *placements = Py_None;
+  const char *kwlist[] = {"residues", "spline_coef", "placements", NULL};
+  if (!PyArg_ParseTupleAndKeywords(args, keywds, const_cast<char *>("O&O&|O"),
 				   (char **)kwlist,
 				   parse_residues, &residues,
-				   parse_contiguous_double_n34_array, &coef))
+				   parse_contiguous_double_n34_array, &coef,
+				   &placements))
     return NULL;
   
-  set_atom_ribbon_positions(residues, _non_tether_positions, coef.values(), coef.size(0));
-  std::vector<Atom *> atoms;
-  set_atom_ribbon_positions(residues, _tether_positions, coef.values(), coef.size(0), &atoms);
-  
+  if (placements == Py_None)
+    {
+      set_atom_ribbon_positions(residues, _non_tether_positions, coef.values(), coef.size(0));
+      std::vector<Atom *> atoms;
+      set_atom_ribbon_positions(residues, _tether_positions, coef.values(), coef.size(0), &atoms);
+      return python_atom_pointers(atoms);
+    }
+
+  Tether_Placements *p = static_cast<Tether_Placements *>
+    (PyCapsule_GetPointer(placements, "Tether_Placements"));
+  if (p == NULL)
+    return NULL;
+  const double *c = coef.values();
+  int num_pts = coef.size(0);
+  atomstruct::Coord xyz;
+  double pos[3];
+  size_t n = p->atoms.size();
+  for (size_t i = 0 ; i < n ; ++i)
+    {
+      spline_position(p->offsets[i], c, num_pts, pos);
+      xyz.set_xyz(pos[0], pos[1], pos[2]);
+      p->atoms[i]->set_ribbon_coord(xyz);
+    }
+
+  std::vector<Atom *> atoms(p->atoms.begin() + p->num_non_tether, p->atoms.end());
   return python_atom_pointers(atoms);
 }
 
@@ -661,6 +722,7 @@ PyObject *get_polymer_spline(PyObject *, PyObject *args, PyObject *keywds)
     bool want_guides = true;
     Residue **res_array = residues.pointers;
     size_t n = residues.count;
+    TRACE_SCOPE_ITEMS("ribbons.get_polymer_spline", n);
 
     // If no ribbon is displayed for any residue, return Nones
     bool any_display = false;
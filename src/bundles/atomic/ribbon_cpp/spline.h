@@ -45,7 +45,15 @@ extern "C"
 
   PyObject *set_atom_tether_positions(PyObject *s, PyObject *args, PyObject *keywds);
 
+  PyObject *tether_placements(PyObject *s, PyObject *args, PyObject *keywds);
+
   PyObject *get_polymer_spline(PyObject *s, PyObject *args, PyObject *keywds);
 }
 
+// Compute a spline path of (nseg+1)*ndiv points into caller allocated arrays.
+// Same as the spline_path() Python function.
+void compute_spline_path(const double *coeffs, int nseg, const float *normals,
+			 const unsigned char *flip, const unsigned char *twist, int ndiv,
+			 float *ca, float *ta, float *na);
+
 #endif
@@ -28,11 +28,16 @@
 #include <numpy/arrayobject.h>
 
 #include <arrays/pythonarray.h>
+#include <arrays/threadpool.h>	// use Thread_Pool::run()
+#include <arrays/trace.h>	// use TRACE_SCOPE()
 
 #include <iostream>
 #include <algorithm>
+#include <atomic>			// use std::atomic
+#include <vector>			// use std::vector
 
 #include "parse.h"		// Use parse_residues()
+#include "spline.h"		// Use compute_spline_path()
 #include "xsection.h"
 
 class Mesh
@@ -49,6 +54,12 @@ public:
     triangles = nullptr;
     num_triangles = 0;
   }
+  Mesh(const Mesh &m) : Mesh(m.num_vertices)
+  {
+    memcpy(vertices, m.vertices, 3*num_vertices*sizeof(float));
+    memcpy(normals, m.normals, 3*num_vertices*sizeof(float));
+    memcpy(allocate_triangles(m.num_triangles), m.triangles, 3*m.num_triangles*sizeof(int));
+  }
   ~Mesh()
   {
     delete [] vertices;
@@ -95,6 +106,29 @@ public:
   {
     this->residue_offset = residue_offset;
   }
+  // Copy the meshes and residue ranges of another geometry to the end of this one,
+  // offsetting the residue indices.
+  void append(const Geometry &g, int residue_offset)
+  {
+    for (auto mi = g.meshes.begin() ; mi != g.meshes.end() ; ++mi)
+      meshes.push_back(new Mesh(**mi));
+    for (size_t i = 0 ; i < g.triangle_ranges.size() ; i += 5)
+      {
+	const int *r = &g.triangle_ranges[i];
+	triangle_ranges.push_back(residue_offset + r[0]);
+	triangle_ranges.push_back(i == 0 ? t_start : t_end + r[1]);
+	triangle_ranges.push_back(t_end + r[2]);
+	triangle_ranges.push_back(i == 0 ? v_start : v_end + r[3]);
+	triangle_ranges.push_back(v_end + r[4]);
+      }
+    if (!g.triangle_ranges.empty())
+      {
+	t_start = t_end + g.t_start;
+	v_start = v_end + g.v_start;
+      }
+    t_end += g.t_end;
+    v_end += g.v_end;
+  }
   int num_ranges() const
     { return triangle_ranges.size()/5; }
   void ranges(int *r) const
@@ -1130,6 +1164,7 @@ extern "C" int parse_rxsection_array(PyObject *arg, void *xsvector)
 extern "C" PyObject *
 ribbon_extrusions(PyObject *, PyObject *args, PyObject *keywds)
 {
+  TRACE_SCOPE("ribbons.ribbon_extrusions");
   FArray centers, tangents, normals;
   IArray ranges;
   int num_res;
@@ -1171,6 +1206,162 @@ ribbon_extrusions(PyObject *, PyObject *args, PyObject *keywds)
   return python_none();
 }
 
+// ----------------------------------------------------------------------------
+//
+static int thread_count(int64_t work, int64_t min_per_thread)
+{
+  return Thread_Pool::thread_count(work, min_per_thread);
+}
+
+// ----------------------------------------------------------------------------
+// Run f(t) for t = 0 to nt-1 on the shared thread pool.  The calling thread does t = 0.
+//
+template <class F>
+static void run_threads(int nt, F f)
+{
+  Thread_Pool::run(nt, f);
+}
+
+// Spline and cross-section parameters for one polymer chain.
+class Ribbon_Chain
+{
+public:
+  Geometry *geometry;
+  int residue_offset;
+  bool compute;			// False if chain geometry is already computed
+  DArray coeffs;
+  FArray normals;
+  Reference_Counted_Array::Array<unsigned char> flip, twist; // boolean
+  int ndiv;
+  IArray ranges;
+  int num_res;
+  RibbonXSections xs_front, xs_back;
+};
+
+static bool parse_ribbon_chain(PyObject *arg, Ribbon_Chain &c)
+{
+  if (!PyTuple_Check(arg))
+    {
+      PyErr_SetString(PyExc_TypeError,
+		      "ribbon_chain_extrusions(): Chains must be tuples");
+      return false;
+    }
+  c.compute = (PyTuple_Size(arg) != 2);
+  if (!c.compute)
+    return PyArg_ParseTuple(arg, const_cast<char *>("O&i"),
+			    parse_geometry_pointer, &c.geometry,
+			    &c.residue_offset);
+  if (!PyArg_ParseTuple(arg, const_cast<char *>("O&iO&O&O&O&iO&iO&O&"),
+			parse_geometry_pointer, &c.geometry,
+			&c.residue_offset,
+			parse_contiguous_double_n34_array, &c.coeffs,
+			parse_float_n3_array, &c.normals,
+			parse_uint8_n_array, &c.flip,
+			parse_uint8_n_array, &c.twist,
+			&c.ndiv,
+			parse_int_n2_array, &c.ranges,
+			&c.num_res,
+			parse_rxsection_array, &c.xs_front,
+			parse_rxsection_array, &c.xs_back))
+    return false;
+
+  if (!c.normals.is_contiguous() || !c.flip.is_contiguous() || !c.twist.is_contiguous() ||
+      !c.ranges.is_contiguous())
+    {
+      PyErr_SetString(PyExc_TypeError,
+		      "ribbon_chain_extrusions(): Normals, flip, twist and ranges arrays must be contiguous");
+      return false;
+    }
+  int nseg = c.coeffs.size(0);
+  if (nseg == 0 || nseg+1 != c.normals.size(0) ||
+      c.flip.size(0) < nseg || c.twist.size(0) < nseg)
+    {
+      PyErr_Format(PyExc_TypeError,
+		   "ribbon_chain_extrusions(): Normals (%s), flip (%s) and twist (%s) arrays do not match coefficients array (%s)",
+		   c.normals.size_string().c_str(), c.flip.size_string().c_str(),
+		   c.twist.size_string().c_str(), c.coeffs.size_string().c_str());
+      return false;
+    }
+  if (c.num_res != nseg+1 || c.ndiv < 1 ||
+      (int)c.xs_front.size() < c.num_res || (int)c.xs_back.size() < c.num_res)
+    {
+      PyErr_Format(PyExc_ValueError,
+		   "ribbon_chain_extrusions(): Residue count %d, divisions %d or cross-section counts (%d, %d) do not match %d spline segments",
+		   c.num_res, c.ndiv, (int)c.xs_front.size(), (int)c.xs_back.size(), nseg);
+      return false;
+    }
+  return true;
+}
+
+// ----------------------------------------------------------------------------
+// The chains are done in parallel, each thread taking the next unstarted chain
+// since chain lengths vary a lot.  Geometry is then combined in chain order so the
+// result is the same as computing each chain's path and extrusions in turn.
+// Chain geometry is kept so that unchanged chains can be reused by the caller.
+//
+extern "C" PyObject *
+ribbon_chain_extrusions(PyObject *, PyObject *args, PyObject *keywds)
+{
+  TRACE_SCOPE("ribbons.ribbon_chain_extrusions");
+  PyObject *chains_py;
+  Geometry *g;
+  const char *kwlist[] = {"chains", "geometry", NULL};
+  if (!PyArg_ParseTupleAndKeywords(args, keywds, const_cast<char *>("OO&"),
+				   (char **)kwlist,
+				   &chains_py,
+				   parse_geometry_pointer, &g))
+    return NULL;
+
+  if (!PySequence_Check(chains_py))
+    {
+      PyErr_SetString(PyExc_TypeError,
+		      "ribbon_chain_extrusions(): Chains must be a list or tuple");
+      return NULL;
+    }
+  Py_ssize_t nc = PySequence_Size(chains_py);
+  std::vector<Ribbon_Chain> chains(nc);
+  int64_t num_points = 0;
+  for (Py_ssize_t i = 0 ; i < nc ; ++i)
+    {
+      PyObject *c = PySequence_GetItem(chains_py, i);
+      bool ok = parse_ribbon_chain(c, chains[i]);
+      Py_XDECREF(c);
+      if (!ok)
+	return NULL;
+      if (chains[i].compute)
+	num_points += static_cast<int64_t>(chains[i].num_res) * chains[i].ndiv;
+    }
+
+  Py_BEGIN_ALLOW_THREADS
+  std::atomic<Py_ssize_t> next_chain(0);
+  int nt = thread_count(num_points, 20000);
+  if (nt > nc)
+    nt = (nc > 0 ? nc : 1);
+  run_threads(nt, [&](int) {
+      std::vector<float> path;
+      for (Py_ssize_t i = next_chain++ ; i < nc ; i = next_chain++)
+	{
+	  Ribbon_Chain &c = chains[i];
+	  if (!c.compute)
+	    continue;
+	  int nseg = c.coeffs.size(0);
+	  int np = (nseg+1) * c.ndiv;
+	  path.resize(9 * static_cast<size_t>(np));
+	  float *ca = path.data(), *ta = ca + 3*np, *na = ta + 3*np;
+	  compute_spline_path(c.coeffs.values(), nseg, c.normals.values(), c.flip.values(),
+			      c.twist.values(), c.ndiv, ca, ta, na);
+	  ribbon_extrusions(ca, ta, na, np, c.ranges.values(), c.ranges.size(0),
+			    c.num_res, c.xs_front, c.xs_back, *c.geometry);
+	}
+    });
+
+  for (auto &c: chains)
+    g->append(*c.geometry, c.residue_offset);
+  Py_END_ALLOW_THREADS
+
+  return python_none();
+}
+
 static bool ribbon_vertex_colors(Residue **residues, int nres, int *triangle_ranges, int nranges,
                                  unsigned char *colors, int ncolors)
 {
@@ -66,6 +66,16 @@ PyObject *rxsection_arrow(PyObject *s, PyObject *args, PyObject *keywds);
 //
 PyObject *ribbon_extrusions(PyObject *s, PyObject *args, PyObject *keywds);
 
+// Compute spline paths and ribbon extrusions for many polymer chains in parallel.
+// Each chain is a tuple (chain_geometry, residue_offset, coeffs, normals, flip_normals,
+// twist, ndiv, ranges, num_res, xs_front, xs_back).  The extrusions are added to the
+// chain geometry and then all chain geometries are copied in order to geometry.
+// A chain given as just (chain_geometry, residue_offset) is copied without computing.
+//
+//  ribbon_chain_extrusions(chains, geometry)
+//
+PyObject *ribbon_chain_extrusions(PyObject *s, PyObject *args, PyObject *keywds);
+
 //
 // Accumulate triangles from multiple extrusions.
 // Also keeps track of triangle and vertex ranges for each residue.
@@ -32,7 +32,8 @@ import chimerax.atomic_lib
 
 from .molobject import Atom, Bond, Chain, CoordSet, Element, Pseudobond, Residue, Sequence, \
     StructureSeq, PseudobondManager, Ring, ChangeTracker, StructureData
-from .molobject import SeqMatchMap, estimate_assoc_params, try_assoc, StructAssocError
+from .molobject import SeqMatchMap, estimate_assoc_params, try_assoc, best_assocs, \
+    StructAssocError
 from .molobject import next_chain_id, chain_id_characters
 # pbgroup must precede molarray since molarray uses interatom_pseudobonds in global scope
 from .pbgroup import PseudobondGroup, all_pseudobond_groups, all_pseudobonds
@@ -45,6 +46,7 @@ from .structure import all_atoms, all_bonds, all_residues, all_atomic_structures
 from .structure import structure_atoms, structure_residues, structure_graphics_updater, level_of_detail
 from .structure import PickedAtom, PickedBond, PickedResidue, PickedPseudobond
 from .structure import uniprot_ids
+from .structure import zone_masks
 from .molsurf import buried_area, MolecularSurface, surfaces_with_atoms
 from .changes import check_for_changes
 from .pdbmatrices import biological_unit_matrices
@@ -152,6 +154,25 @@ class _AtomicBundleAPI(BundleAPI):
         elif mgr.name == "items inspection":
             from .inspectors import item_options
             return item_options(session, name, **kw)
+        elif mgr == session.open_command:
+            from chimerax.open_command import OpenerInfo
+            class Info(OpenerInfo):
+                def open(self, session, path, file_name, **kw):
+                    from .snapshot import open_snapshot
+                    return open_snapshot(session, path)
+            return Info()
+        elif mgr == session.save_command:
+            from chimerax.save_command import SaverInfo
+            class Info(SaverInfo):
+                def save(self, session, path, **kw):
+                    from .snapshot import save_snapshot
+                    save_snapshot(session, path, **kw)
+
+                @property
+                def save_args(self):
+                    from chimerax.core.commands import ModelsArg
+                    return { 'models': ModelsArg }
+            return Info()
         else:
             class_obj = {'atoms': Atom, 'residues': Residue, 'structures': Structure }[name]
             from chimerax.render_by_attr import RenderAttrInfo
@@ -269,3 +269,54 @@ def right_angle(orig):
     if orig[0] == 0.0:
         return tinyarray.array([0.0, 0 - orig[2], orig[1]])
     return tinyarray.array([0.0 - orig[1], orig[0], 0.0])
+
+def place_hydrogens(parents, geometries, substituents, bond_lengths, crowd_atoms, crowd_coords,
+        crowd_groups, interacts, metal_dist, crowd_radii=None):
+    """Hydrogen positions for the 'parents' Atoms, computed in C++ with the rules of the
+       addh command's simple method for atoms without alternate locations or metal
+       coordination.  Each parent has a geometry (as for bond_positions()), a number of
+       substituents including its current bonds, and a bond length for its hydrogens.
+       Positions set by the existing bonds are computed in parallel; rotamer positions
+       and choices among positions avoid the 'crowd_atoms' and the hydrogens placed
+       before them.
+
+       'crowd_atoms' must include the parents and their bond partners, with
+       'crowd_coords' in a common coordinate frame and 'crowd_radii' defaulting to
+       their radii.  Crowding atoms in groups i and j (from 'crowd_groups') only
+       affect each other if interacts[i,j] is true.  A hydrogen pointing at a metal
+       of its structure within 'metal_dist' is left off.
+
+       Returns an N by 4 by 3 array of positions, the number of positions for each
+       parent, and an N by 4 boolean array that is false for positions left off.
+    """
+    from numpy import empty, zeros, ascontiguousarray, int32, float32, float64, uint8
+    n = len(parents)
+    geom = ascontiguousarray(geometries, int32)
+    substs = ascontiguousarray(substituents, int32)
+    lengths = ascontiguousarray(bond_lengths, float64)
+    xyz = ascontiguousarray(crowd_coords, float64)
+    if xyz.shape != (len(crowd_atoms), 3):
+        raise ValueError("Need an N by 3 array of coordinates for %d crowding atoms" % len(crowd_atoms))
+    radii = ascontiguousarray(crowd_atoms.radii if crowd_radii is None else crowd_radii, float32)
+    groups = ascontiguousarray(crowd_groups, int32)
+    inter = ascontiguousarray(interacts, uint8)
+    ngroups = len(inter)
+    if inter.shape != (ngroups, ngroups):
+        raise ValueError("Group interactions must be a square array")
+    if len(groups) > 0 and (groups.min() < 0 or groups.max() >= ngroups):
+        raise ValueError("Crowding atom groups must be less than %d" % ngroups)
+    positions = zeros((n,4,3), float64)
+    counts = empty((n,), int32)
+    keep = zeros((n,4), uint8)
+    from .molobject import c_function
+    from .molc import pointer
+    import ctypes
+    f = c_function('place_hydrogens',
+        args = (ctypes.c_void_p, ctypes.c_size_t, ctypes.c_void_p, ctypes.c_void_p, ctypes.c_void_p,
+                ctypes.c_void_p, ctypes.c_size_t, ctypes.c_void_p, ctypes.c_void_p, ctypes.c_void_p,
+                ctypes.c_int32, ctypes.c_void_p, ctypes.c_double, ctypes.c_void_p, ctypes.c_void_p,
+                ctypes.c_void_p))
+    f(parents._c_pointers, n, pointer(geom), pointer(substs), pointer(lengths),
+      crowd_atoms._c_pointers, len(crowd_atoms), pointer(xyz), pointer(radii), pointer(groups),
+      ngroups, pointer(inter), metal_dist, pointer(positions), pointer(counts), pointer(keep))
+    return positions, counts, keep.astype(bool)
@@ -79,6 +79,16 @@ class Changes:
     def coordset_reasons(self):
         return self._changes["CoordSet"].reasons
 
+    def coords_replaced_structures(self):
+        """Structures whose current coordinates may all have been replaced at once, for
+           example by reading a trajectory frame.  Consumers can refresh these structures
+           in bulk rather than examining modified_atoms().  As with 'active_coordset changed'
+           the result is all modified structures when any had its coordinates replaced."""
+        if 'coords replaced' not in self._changes["Structure"].reasons:
+            from . import Structures
+            return Structures()
+        return self._changes["Structure"].modified
+
     def created_atoms(self, include_new_structures=True):
         return self._created_objects("Atom", include_new_structures)
 
@@ -58,7 +58,7 @@ can be altered is if C++ objects they hold are deleted in which case those objec
 are automatically removed from the collection.  Because they are mutable they
 cannot be used as keys in dictionary or added to sets.
 '''
-from numpy import uint8, int32, uint32, float64, float32, uintp, byte, integer, empty, array
+from numpy import uint8, int32, uint32, int64, float64, float32, uintp, byte, integer, empty, array
 npy_bool = bool
 from .molc import string, cptr, pyobject, set_cvec_pointer, pointer, size_t
 from . import molobject
@@ -98,6 +98,14 @@ def _atoms_pair(p):
 def _pseudobond_group_map(a):
     from . import molobject
     return [molobject._pseudobond_group_map(p) for p in a]
+def _measurement_keys(keys, n):
+    if keys is None:
+        return None
+    from numpy import ascontiguousarray
+    keys = ascontiguousarray(keys, int64)
+    if keys.shape != (n,):
+        raise ValueError('Need %d previous measurement keys, got %s' % (n, keys.shape))
+    return keys
 
 # -----------------------------------------------------------------------------
 #
@@ -110,6 +118,8 @@ class Collection(State):
     Collection is immutable except that deleted items are automatically
     removed.
     '''
+    _set_functions = 'pointer'	# Prefix of C++ merge, subtract, unique functions
+
     def __init__(self, items, object_class):
         import numpy
         if items is None:
@@ -172,12 +182,10 @@ class Collection(State):
                 % (self.__class__.__name__, str(type(i))))
         return v
     def index(self, object):
-        '''Find the position of the first occurence of an object in a collection.'''
-        f = c_function('pointer_index',
-                       args = [ctypes.c_void_p, ctypes.c_size_t, ctypes.c_void_p],
-                       ret = ctypes.c_ssize_t)
-        i = f(self._c_pointers, len(self), object._c_pointer)
-        return i
+        '''Find the position of the first occurence of an object in a collection,
+        or -1 if it is not in the collection.  A lookup table is made by the first call
+        and reused, so finding many objects takes constant time for each.'''
+        return self._lookup_table.index(object)
     def indices(self, objects):
         '''Return int32 array indicating for each element in objects its index of the
         first occurence in the collection, or -1 if it does not occur in the collection.'''
@@ -257,17 +265,24 @@ class Collection(State):
         return objects._lookup_table.includes_each(self)
     def merge(self, objects):
         '''Return a new collection combining this one with the *objects* :class:`.Collection`.
-        All duplicates are removed.'''
-        import numpy
-        return self.__class__(numpy.union1d(self._pointers, objects._pointers))
+        All duplicates are removed.  Objects of this collection come first in their order,
+        followed by those only in *objects*.'''
+        f = c_function(self._set_functions + '_merge',
+                       args = [ctypes.c_void_p, ctypes.c_size_t, ctypes.c_void_p, ctypes.c_size_t],
+                       ret = ctypes.py_object)
+        return self.__class__(f(self._c_pointers, len(self), objects._c_pointers, len(objects)))
     def subtract(self, objects):
         '''Return a new collection subtracting the *objects* :class:`.Collection` from this one.
-        All duplicates are removed.  Currently does not preserve order'''
-        import numpy
-        return self.__class__(numpy.setdiff1d(self._pointers, objects._pointers))
+        All duplicates are removed and order is preserved.'''
+        f = c_function(self._set_functions + '_subtract',
+                       args = [ctypes.c_void_p, ctypes.c_size_t, ctypes.c_void_p, ctypes.c_size_t],
+                       ret = ctypes.py_object)
+        return self.__class__(f(self._c_pointers, len(self), objects._c_pointers, len(objects)))
     def unique(self):
         '''Return a new collection containing the unique elements from this one, preserving order.'''
-        return self.__class__(unique_ordered(self._pointers))
+        f = c_function(self._set_functions + '_unique',
+                       args = [ctypes.c_void_p, ctypes.c_size_t], ret = ctypes.py_object)
+        return self.__class__(f(self._c_pointers, len(self)))
     def instances(self, instantiate=True):
         '''Returns a list of the Python instances.  If 'instantiate' is False, then for
         those items that haven't yet been instantiated, None will be returned.'''
@@ -295,7 +310,7 @@ class Collection(State):
             self.__class__.__name__ + " has not implemented session_save_pointers")
 
 class LookupTable:
-    '''C++ set of pointers for fast lookup.'''
+    '''C++ hash table of pointers to their first index for fast lookup.'''
     def __init__(self, collection):
         self._collection = collection
         self._cpp_table = None		# Pointer to C++ set
@@ -329,6 +344,11 @@ class LookupTable:
                               args = [ctypes.c_void_p, ctypes.c_void_p, ctypes.c_size_t],
                               ret = ctypes.c_bool)
         return incl_any(self._cpp_table_pointer, collection._c_pointers, len(collection))
+
+    def index(self, object):
+        index = c_function('pointer_table_index',
+                           args = [ctypes.c_void_p, ctypes.c_void_p], ret = ctypes.c_ssize_t)
+        return index(self._cpp_table_pointer, object._c_pointer)
     
     def includes_each(self, collection):
         incl_each = c_function('pointer_table_includes_each',
@@ -359,10 +379,10 @@ def concatenate(collections, object_class = None, remove_duplicates = False):
     else:
         import numpy
         p = numpy.concatenate([a._pointers for a in collections])
-        if remove_duplicates:
-            p = unique_ordered(p)    # Preserve order when duplicates are removed.
         cl = collections[0].__class__ if object_class is None else object_class
         c = cl(p)
+        if remove_duplicates:
+            c = c.unique()    # Preserve order when duplicates are removed.
     return c
 
 def unique_ordered(a):
@@ -533,6 +553,23 @@ class Atoms(Collection):
     BBE_MIN = Atom.BBE_MIN
     BBE_RIBBON = Atom.BBE_RIBBON
     BBE_MAX = Atom.BBE_MAX
+    # structure_category_codes values
+    CAT_OTHER, CAT_MAIN, CAT_LIGAND, CAT_IONS, CAT_SOLVENT = range(5)
+
+    # Set operations use a bit per atom of each structure instead of hashing.
+    _set_functions = 'atom'
+
+    def mask(self, objects):
+        '''Return bool array indicating for each atom in current set whether that
+        atom appears in the argument atoms.'''
+        if objects._lookup is not None:
+            return objects._lookup.includes_each(self)
+        f = c_function('atom_mask', args = [ctypes.c_void_p, ctypes.c_size_t,
+                                            ctypes.c_void_p, ctypes.c_size_t, ctypes.c_void_p])
+        n = len(self)
+        mask = empty((n,), npy_bool)
+        f(self._c_pointers, n, objects._c_pointers, len(objects), pointer(mask))
+        return mask
 
     bfactors = cvec_property('atom_bfactor', float32)
     bonds = cvec_property('atom_bonds', cptr, 'num_bonds', astype = _bonds, read_only = True,
@@ -679,6 +716,24 @@ class Atoms(Collection):
         if smask.any():
             r[smask] = self.filter(smask).maximum_bond_radii(bond_radius)
         return r
+    def measurement_text_changes(self, group_size, decimal_places, previous_keys = None):
+        '''Distances, or angles or dihedrals in degrees, in scene coordinates of consecutive
+        groups of group_size (2, 3 or 4) atoms, for updating measurement labels.  Returns
+        a float64 array of values, an int64 array of keys for the values printed with
+        decimal_places digits after the decimal point, and a bool array that is True
+        where the printed text differs from that given by previous_keys from an earlier call
+        (all True if previous_keys is None).'''
+        n = len(self) // group_size
+        values = empty((n,), float64)
+        keys = empty((n,), int64)
+        changed = empty((n,), npy_bool)
+        f = c_function('atom_measurement_text_changes', args = [ctypes.c_void_p, ctypes.c_size_t,
+            ctypes.c_int, ctypes.c_int, ctypes.c_void_p, ctypes.c_void_p, ctypes.c_void_p, ctypes.c_void_p])
+        previous_keys = _measurement_keys(previous_keys, n)
+        f(self._c_pointers, n, group_size, decimal_places, pointer(values), pointer(keys),
+          None if previous_keys is None else pointer(previous_keys), pointer(changed))
+        return values, keys, changed
+
     def maximum_bond_radii(self, default_radius = 0.2):
         "Return maximum bond radius for each atom.  Used for stick style atom display."
         f = c_function('atom_maximum_bond_radius', args = [ctypes.c_void_p, ctypes.c_size_t, ctypes.c_float, ctypes.c_void_p])
@@ -760,6 +815,10 @@ class Atoms(Collection):
         return datoms
     structure_categories = cvec_property('atom_structure_category', string, read_only=True,
         doc="Numpy array of whether atom is ligand, ion, etc.")
+    structure_category_codes = cvec_property('atom_structure_category_code', uint8, read_only=True,
+        doc="Numpy uint8 array of structure categories, faster than structure_categories for"
+        " many atoms.  Values are CAT_OTHER, CAT_MAIN, CAT_LIGAND, CAT_IONS and CAT_SOLVENT."
+        "  Read only.")
     structures = cvec_property('atom_structure', pyobject, astype = AtomicStructures, read_only=True,
         doc="Returns an :class:`AtomicStructure` for each atom. Read only.")
     def transform(self, place):
@@ -868,6 +927,36 @@ class Atoms(Collection):
         f(self._c_pointers, n, pointer(ai))
     aniso_u6 = property(_get_aniso_u6, _set_aniso_u6)
 
+    @property
+    def aniso_u6_table(self):
+        '''Anisotropic temperature factors of all atoms as a tuple of a boolean mask of
+        atoms that have them and an Nx6 numpy float32 array of (u11,u22,u33,u12,u13,u23),
+        zero for atoms without values.  Unlike aniso_u6 this does not raise an error when
+        some atoms lack temperature factors.  Read only.'''
+        f = c_function('atom_aniso_u6_table',
+            args = (ctypes.c_void_p, ctypes.c_size_t, ctypes.c_void_p, ctypes.c_void_p))
+        from numpy import empty, float32
+        n = len(self)
+        ai = empty((n,6), float32)
+        has = empty((n,), npy_bool)
+        f(self._c_pointers, n, pointer(ai), pointer(has))
+        return has, ai
+
+    def aniso_u_ellipsoid_placements(self, scale = 1.0):
+        '''Return Places that map a unit sphere to the thermal ellipsoid of each atom,
+        in structure coordinates.  The ellipsoid axes are the principal axes of the
+        anisotropic temperature factors with lengths scale times the root mean square
+        displacements, so scale 1.5382 gives 50% probability ellipsoids.  Raises a
+        ValueError if any atom has no anisotropic temperature factors.'''
+        f = c_function('atom_aniso_u_ellipsoid_placements',
+            args = (ctypes.c_void_p, ctypes.c_size_t, ctypes.c_float, ctypes.c_void_p))
+        from numpy import empty, float32
+        n = len(self)
+        opengl_array = empty((n,4,4), float32)
+        f(self._c_pointers, n, scale, pointer(opengl_array))
+        from chimerax.geometry import Places
+        return Places(opengl_array = opengl_array)
+
     def residue_sums(self, atom_values):
         '''Compute per-residue sum of atom float values.  Return unique residues and array of residue sums.'''
         f = c_function('atom_residue_sums', args=(ctypes.c_void_p, ctypes.c_int, ctypes.POINTER(ctypes.c_double)),
@@ -1001,6 +1090,21 @@ class Bonds(Collection):
         f(self._c_pointers, n, pointer(opengl_array))
         from chimerax.geometry import Places
         return Places(opengl_array = opengl_array)
+
+    def halfbond_cylinders(self, array = None):
+        '''
+        Return Places for halfbond cylinders specified by an N x 8 float array of
+        bond end points and radii which graphics expands to 2N placements.
+        '''
+        n = len(self)
+        if array is None or len(array) != n:
+            from numpy import empty, float32
+            array = empty((n,8), float32)
+        f = c_function('bond_halfbond_cylinders',
+                       args = [ctypes.c_void_p, ctypes.c_size_t, ctypes.c_void_p])
+        f(self._c_pointers, n, pointer(array))
+        from chimerax.geometry import Places
+        return Places(halfbond_cylinders = array)
         
     @classmethod
     def session_restore_pointers(cls, session, data):
@@ -1126,12 +1230,38 @@ class Pseudobonds(Collection):
         from numpy import sqrt
         return sqrt((v*v).sum(axis=1))
 
+    def length_text_changes(self, decimal_places, previous_keys = None):
+        '''Scene coordinate lengths as a float64 array, int64 keys for the lengths printed with
+        decimal_places digits after the decimal point, and a bool array that is True where
+        the printed text differs from that given by previous_keys from an earlier call (all
+        True if previous_keys is None).  Used to update only distance labels that change.'''
+        n = len(self)
+        lengths = empty((n,), float64)
+        keys = empty((n,), int64)
+        changed = empty((n,), npy_bool)
+        f = c_function('pseudobond_length_text_changes', args = [ctypes.c_void_p, ctypes.c_size_t,
+            ctypes.c_int, ctypes.c_void_p, ctypes.c_void_p, ctypes.c_void_p, ctypes.c_void_p])
+        previous_keys = _measurement_keys(previous_keys, n)
+        f(self._c_pointers, n, decimal_places, pointer(lengths), pointer(keys),
+          None if previous_keys is None else pointer(previous_keys), pointer(changed))
+        return lengths, keys, changed
+
     @property
     def half_colors(self):
         '''2N x 4 RGBA uint8 numpy array of half bond colors.'''
         f = c_function('pseudobond_half_colors', args = [ctypes.c_void_p, ctypes.c_size_t], ret = ctypes.py_object)
         return f(self._c_pointers, len(self))
 
+    def cylinder_data(self, coords = True, colors = True, scene_coordinates = False):
+        '''Return the data for drawing the pseudobonds as cylinders, gathered in one pass:
+        N x 3 float64 end point coordinates for each end, N float32 radii, and 2N x 4 uint8
+        half bond colors.  The coordinates and radii are None if 'coords' is False and the
+        colors None if 'colors' is False.  End points are atom pb_coords, or pb_scene_coords
+        if 'scene_coordinates' is True.'''
+        f = c_function('pseudobond_cylinder_data', args = [ctypes.c_void_p, ctypes.c_size_t,
+            ctypes.c_bool, ctypes.c_bool, ctypes.c_bool], ret = ctypes.py_object)
+        return f(self._c_pointers, len(self), coords, colors, scene_coordinates)
+
     def between_atoms(self, atoms):
         '''Return mask of those pseudobonds which have both ends in the given set of atoms.'''
         a1, a2 = self.atoms
@@ -1402,6 +1532,22 @@ class Residues(Collection):
         seqs = f(self._c_pointers, len(self), pointer(seq_ids))
         return seqs, seq_ids
 
+    def bead_spheres(self, atom_radius = 1.5):
+        '''
+        Return a sphere for each residue at the center of its shown atoms as an Nx4 float32
+        array of center and radius, and the average shown atom color as an Nx4 uint8 array.
+        The radius is the RMS atom distance from the center plus atom_radius, or zero
+        for residues with no shown atoms.
+        '''
+        n = len(self)
+        xyzr = empty((n, 4), float32)
+        colors = empty((n, 4), uint8)
+        f = c_function('residue_bead_spheres',
+                       args = [ctypes.c_void_p, ctypes.c_size_t, ctypes.c_float,
+                               ctypes.c_void_p, ctypes.c_void_p])
+        f(self._c_pointers, n, atom_radius, pointer(xyzr), pointer(colors))
+        return xyzr, colors
+
     def ribbon_clear_hides(self):
         self.clear_hide_bits(Atom.HIDE_RIBBON)
 
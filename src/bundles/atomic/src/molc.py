@@ -284,6 +284,7 @@ numpy_type_to_ctype = {
     numpy.float64: ctypes.c_double,
     numpy.float32: ctypes.c_float,
     numpy.int32: ctypes.c_int,
+    numpy.int64: ctypes.c_int64,
     numpy.uint32: ctypes.c_uint,
     numpy.uint8: ctypes.c_uint8,
     numpy.uintp: ctypes.c_void_p,
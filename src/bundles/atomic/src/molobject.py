@@ -1322,6 +1322,34 @@ def try_assoc(seq, sseq, assoc_params, *, max_errors = 6):
         mmap.match(convert.residue(r), i)
     return mmap, errors
 
+def best_assocs(sseqs, aseq_lists, assoc_params, max_errors):
+    '''For each StructureSeq in 'sseqs', find its best association with the Sequences in
+       the corresponding list in 'aseq_lists', tried in order.  Each sequence must match with
+       fewer errors than the best match so far (at most the corresponding 'max_errors' for
+       the first), the structure sequence is also tried without its gaps, and the search
+       stops at a match without errors.  'assoc_params' are as from
+       :py:func:`estimate_assoc_params`.  The structure sequences are matched in parallel.
+
+       The return value is a list with, for each structure sequence, None if no sequence
+       associated or a 2-tuple of a :py:class:`SeqMatchMap` and the number of errors.
+    '''
+    f = c_function('sseq_best_assocs', args = (ctypes.py_object, ctypes.py_object,
+        ctypes.py_object, ctypes.py_object), ret = ctypes.py_object)
+    results = f([s._c_pointer.value for s in sseqs],
+        [[s._c_pointer.value for s in aseqs] for aseqs in aseq_lists],
+        [tuple(ap) for ap in assoc_params], list(max_errors))
+    assocs = []
+    for sseq, aseqs, result in zip(sseqs, aseq_lists, results):
+        if result is None:
+            assocs.append(None)
+            continue
+        aseq_index, res_to_pos, errors = result
+        mmap = SeqMatchMap(aseqs[aseq_index], sseq)
+        for r, i in res_to_pos.items():
+            mmap.match(convert.residue(r), i)
+        assocs.append((mmap, errors))
+    return assocs
+
 # -----------------------------------------------------------------------------
 #
 class Chain(StructureSeq):
@@ -1437,6 +1465,15 @@ def next_chain_id(cid):
             return cid[:col] + chain_id_characters[next_index] + (chain_id_characters[0] * (len(cid)-col-1))
     return chain_id_characters[0] * (len(cid)+1)
 
+# Values match C++ CoordSet::Compression.
+_coordset_compressions = {None: 0, 'float32': 1, 'int16': 2}
+def _coordset_compression(compression):
+    try:
+        return _coordset_compressions[compression]
+    except KeyError:
+        raise ValueError('Coordset compression must be one of %s, got %s'
+            % (', '.join(str(c) for c in _coordset_compressions), repr(compression)))
+
 # -----------------------------------------------------------------------------
 #
 class StructureData:
@@ -1670,6 +1707,72 @@ class StructureData:
             from .molarray import Atoms
             return (Atoms(ap[0]), Atoms(ap[1]))
 
+    def close_atom_pairs(self, distance):
+        '''Return two :class:`.Atoms` collections of equal length giving each pair of
+           atoms within the given distance of each other, using untransformed coordinates
+           of the active coordinate set.  The spatial grid used for the search is cached
+           and reused until coordinates change.'''
+        f = c_function('structure_close_atom_pairs', args = (ctypes.c_void_p, ctypes.c_double),
+            ret = ctypes.py_object)
+        a0, a1 = f(self._c_pointer, distance)
+        from .molarray import Atoms
+        return Atoms(a0), Atoms(a1)
+
+    # Byte offsets and flag bits of atom_display_state() values
+    ATOM_STATE_COLOR = slice(0, 4)
+    ATOM_STATE_FLAGS = 4
+    ATOM_STATE_DRAW_MODE = 5
+    ATOM_STATE_DISPLAY, ATOM_STATE_SELECTED, ATOM_STATE_VISIBLE = 0x1, 0x2, 0x4
+
+    def atom_display_state(self):
+        '''Return an N by 8 uint8 array of the packed display state of this structure's
+           atoms, in the same order as the atoms attribute.  Bytes 0-3 are the color,
+           byte 4 has display, selected and visible flag bits, byte 5 is the draw mode
+           and bytes 6-7 are the low 16 hide bits.  The state is kept by the structure
+           and only recomputed after one of these atom attributes changes.'''
+        f = c_function('structure_atom_display_state', args = (ctypes.c_void_p,),
+            ret = ctypes.py_object)
+        return f(self._c_pointer)
+
+    def _atoms_range_values(self, func_name, value_type, per_atom, start, count):
+        n = self.num_atoms
+        if count is None:
+            count = n - start
+        if start < 0 or count < 0 or start + count > n:
+            raise ValueError('Atom range %d-%d exceeds %d atoms' % (start, start+count, n))
+        from numpy import empty
+        values = empty((count, per_atom) if per_atom > 1 else (count,), value_type)
+        f = c_function(func_name,
+            args = (ctypes.c_void_p, ctypes.c_size_t, ctypes.c_size_t, ctypes.c_void_p))
+        f(self._c_pointer, start, count, pointer(values))
+        return values
+
+    def atoms_coords(self, start = 0, count = None):
+        '''Coordinates of atoms start through start+count-1 (all remaining atoms if count is
+           None) of this structure, as from Atoms.coords but without passing a pointer
+           array, reading the active coordinate set directly.'''
+        return self._atoms_range_values('structure_atoms_coord', float64, 3, start, count)
+
+    def atoms_colors(self, start = 0, count = None):
+        '''Atom colors for a range of this structure's atoms, like :meth:`atoms_coords`.'''
+        return self._atoms_range_values('structure_atoms_color', uint8, 4, start, count)
+
+    def atoms_displays(self, start = 0, count = None):
+        '''Atom display flags for a range of this structure's atoms, like :meth:`atoms_coords`.'''
+        return self._atoms_range_values('structure_atoms_display', npy_bool, 1, start, count)
+
+    def atoms_draw_modes(self, start = 0, count = None):
+        '''Atom draw modes for a range of this structure's atoms, like :meth:`atoms_coords`.'''
+        return self._atoms_range_values('structure_atoms_draw_mode', uint8, 1, start, count)
+
+    def atoms_radii(self, start = 0, count = None):
+        '''Atom radii for a range of this structure's atoms, like :meth:`atoms_coords`.'''
+        return self._atoms_range_values('structure_atoms_radius', float32, 1, start, count)
+
+    def atoms_selecteds(self, start = 0, count = None):
+        '''Atom selection flags for a range of this structure's atoms, like :meth:`atoms_coords`.'''
+        return self._atoms_range_values('structure_atoms_selected', npy_bool, 1, start, count)
+
     def change_chain_ids(self, chains, chain_ids, *, non_polymeric=True):
         '''Change the chain IDs of the given chains to the corresponding chain ID.  The final ID
            must not conflict with other unchanged chains of the structure.  If 'non_polymeric' is
@@ -1693,8 +1796,10 @@ class StructureData:
                        args = (ctypes.c_void_p, ctypes.c_int, ctypes.c_void_p, ctypes.c_size_t))
         f(self._c_pointer, id, pointer(xyz), len(xyz))
 
-    def add_coordsets(self, xyzs, replace = True):
-        '''Add coordinate sets.  If 'replace' is True, clear out existing coordinate sets first'''
+    def add_coordsets(self, xyzs, replace = True, compression = None):
+        '''Add coordinate sets.  If 'replace' is True, clear out existing coordinate sets first.
+        The new coordinate sets are stored compressed if 'compression' is given,
+        see compress_coordsets().'''
         if len(xyzs.shape) != 3:
             raise ValueError('add_coordsets(): array must be (frames)x(atoms)x3-dimensional')
         if not xyzs.flags.c_contiguous:
@@ -1718,8 +1823,49 @@ class StructureData:
         if xyzs.dtype != float64:
             raise ValueError('add_coordsets(): array must be float64, got %s' % xyzs.dtype.name)
         f = c_function('structure_add_coordsets',
-                       args = (ctypes.c_void_p, ctypes.c_bool, ctypes.c_void_p, ctypes.c_size_t, ctypes.c_size_t))
-        f(self._c_pointer, replace, pointer(xyzs), *xyzs.shape[:2])
+                       args = (ctypes.c_void_p, ctypes.c_bool, ctypes.c_void_p, ctypes.c_size_t, ctypes.c_size_t,
+                               ctypes.c_int))
+        f(self._c_pointer, replace, pointer(xyzs), *xyzs.shape[:2], _coordset_compression(compression))
+
+    def add_trajectory_coordsets(self, path, frame_offsets, num_coords, axis_offsets, value_stride,
+                                 value_type = float32, byte_swap = False, scale = 1.0,
+                                 replace = True, memory_budget = 2**30):
+        '''Add coordinate sets that read their coordinates from a trajectory file when
+        first used so that large trajectories open quickly with limited memory.
+        Frame i starts at byte frame_offsets[i] and its x, y and z values start at
+        axis_offsets bytes from the frame start with value_stride bytes between atoms.
+        Values are float32 or float64 and are multiplied by scale.  At most
+        memory_budget bytes of frames not in use are kept in memory.'''
+        cs_size = self.coordset_size if not replace else self.num_atoms
+        if cs_size > 0 and num_coords != cs_size:
+            raise ValueError('add_trajectory_coordsets(): number of coordinates %d'
+                ' must equal %d' % (num_coords, cs_size))
+        from numpy import array, int64, dtype
+        foffsets = array(frame_offsets, int64)
+        aoffsets = array(axis_offsets, int64)
+        if aoffsets.shape != (3,):
+            raise ValueError('add_trajectory_coordsets(): axis_offsets must have 3 values')
+        vtype = dtype(value_type)
+        if vtype not in (dtype(float32), dtype(float64)):
+            raise ValueError('add_trajectory_coordsets(): value type must be float32 or float64, got %s'
+                % vtype.name)
+        f = c_function('structure_add_trajectory_coordsets',
+                       args = (ctypes.c_void_p, ctypes.c_bool, ctypes.c_char_p, ctypes.c_void_p,
+                               ctypes.c_size_t, ctypes.c_size_t, ctypes.c_void_p, ctypes.c_int64,
+                               ctypes.c_bool, ctypes.c_bool, ctypes.c_double, ctypes.c_size_t))
+        f(self._c_pointer, replace, path.encode('utf-8'), pointer(foffsets), len(foffsets),
+          num_coords, pointer(aoffsets), value_stride, vtype == dtype(float64), byte_swap,
+          scale, memory_budget)
+
+    def compress_coordsets(self, compression = 'float32'):
+        '''Store coordinate sets other than the active one compactly to reduce memory
+        use for long trajectories.  Compression 'float32' keeps single precision
+        coordinates, 'int16' keeps 16-bit fixed point coordinates with a per-frame
+        scale (maximum error 1/131070 of the frame's largest extent), and None
+        restores full double precision storage.  Compressed coordinate sets are
+        expanded automatically while they are in use.'''
+        f = c_function('structure_compress_coordsets', args = (ctypes.c_void_p, ctypes.c_int))
+        f(self._c_pointer, _coordset_compression(compression))
 
     def remove_coordsets(self):
         '''Remove all coordinate sets.'''
@@ -1732,6 +1878,76 @@ class StructureData:
             ret = ctypes.py_object)
         return f(self._c_pointer, cs_id)
 
+    def coordset_rmsds(self, atoms = None, reference = None, coordset_ids = None,
+                       superpose = True, transforms = False):
+        '''Root mean square deviation of each coordinate set from a reference for the
+        given atoms, default all atoms.  The reference is a coordset ID or an N by 3
+        array of coordinates of the atoms, default the active coordset.  Coordset IDs
+        default to all.  If superpose is true each coordset is optimally superposed
+        onto the reference first.  If transforms is true also return a
+        (coordsets)x3x4 array of transforms superposing each coordset onto the
+        reference.  Computed in parallel in C++ without changing the coordsets.'''
+        atoms, ref, cs_ids = self._coordset_analysis_args(atoms, reference, coordset_ids)
+        from numpy import empty
+        rmsds = empty((len(cs_ids),), float64)
+        tf = empty((len(cs_ids),3,4), float64) if transforms else None
+        f = c_function('structure_coordset_rmsds',
+                       args = (ctypes.c_void_p, ctypes.c_void_p, ctypes.c_size_t, ctypes.c_void_p,
+                               ctypes.c_size_t, ctypes.c_void_p, ctypes.c_bool, ctypes.c_void_p,
+                               ctypes.c_void_p))
+        f(self._c_pointer, atoms._c_pointers, len(atoms), pointer(cs_ids), len(cs_ids),
+          pointer(ref), superpose, pointer(rmsds), None if tf is None else pointer(tf))
+        return (rmsds, tf) if transforms else rmsds
+
+    def coordset_rmsf(self, atoms = None, reference = None, coordset_ids = None, superpose = True):
+        '''Root mean square fluctuation of each atom about its mean position over the
+        coordinate sets, with each coordset first superposed onto the reference if
+        superpose is true.  Arguments are as for coordset_rmsds().'''
+        atoms, ref, cs_ids = self._coordset_analysis_args(atoms, reference, coordset_ids)
+        from numpy import empty
+        rmsf = empty((len(atoms),), float64)
+        f = c_function('structure_coordset_rmsf',
+                       args = (ctypes.c_void_p, ctypes.c_void_p, ctypes.c_size_t, ctypes.c_void_p,
+                               ctypes.c_size_t, ctypes.c_void_p, ctypes.c_bool, ctypes.c_void_p))
+        f(self._c_pointer, atoms._c_pointers, len(atoms), pointer(cs_ids), len(cs_ids),
+          pointer(ref), superpose, pointer(rmsf))
+        return rmsf
+
+    def coordset_rmsd_matrix(self, atoms = None, coordset_ids = None, superpose = True):
+        '''Symmetric matrix of root mean square deviations between each pair of
+        coordinate sets for the given atoms, default all atoms, after optimal
+        superposition if superpose is true.  Coordset IDs default to all.'''
+        atoms, ref, cs_ids = self._coordset_analysis_args(atoms, None, coordset_ids)
+        from numpy import empty
+        n = len(cs_ids)
+        matrix = empty((n,n), float64)
+        f = c_function('structure_coordset_rmsd_matrix',
+                       args = (ctypes.c_void_p, ctypes.c_void_p, ctypes.c_size_t, ctypes.c_void_p,
+                               ctypes.c_size_t, ctypes.c_bool, ctypes.c_void_p))
+        f(self._c_pointer, atoms._c_pointers, len(atoms), pointer(cs_ids), n, superpose,
+          pointer(matrix))
+        return matrix
+
+    def _coordset_analysis_args(self, atoms, reference, coordset_ids):
+        if atoms is None:
+            atoms = self.atoms
+        elif len(atoms) > 0:
+            us = atoms.unique_structures
+            if len(us) != 1 or us[0] is not self:
+                raise ValueError('Atoms must all belong to structure %s' % str(self))
+        from numpy import array, ascontiguousarray
+        cs_ids = array(self.coordset_ids if coordset_ids is None else coordset_ids, int32)
+        if reference is None:
+            reference = self.active_coordset_id
+        from numbers import Integral
+        if isinstance(reference, Integral):
+            ref = self.coordset(int(reference)).xyzs[atoms.coord_indices]
+        else:
+            ref = ascontiguousarray(reference, float64)
+            if ref.shape != (len(atoms),3):
+                raise ValueError('Reference coordinates must be a %d by 3 array' % len(atoms))
+        return atoms, ascontiguousarray(ref, float64), cs_ids
+
     def connect_structure(self, *, bond_length_tolerance=0.4, metal_coordination_distance=3.6):
         '''Generate bonds and relevant pseudobonds (missing structure; metal coordination)
         for structure.  Typically used for structures where only the atom positions and not
@@ -1818,6 +2034,29 @@ class StructureData:
                        ret = ctypes.py_object)
         return f(self._c_pointer, atom1._c_pointer, atom2._c_pointer)
 
+    def new_hydrogens(self, parents, names, coords, serial_numbers, colors):
+        '''Add hydrogens bonded to the given parent :class:`.Atoms` in one step and return
+        them as an :class:`.Atoms` collection.  The hydrogens go in their parents' residues with
+        the given names, N by 3 coordinates, serial numbers and N by 4 colors.  They get full
+        occupancy, the bfactor, display, draw mode and hide bits of their parents and bonds
+        like those made by chimerax.atomic.struct_edit.add_bond().  Cross-residue bond
+        maintenance is not needed since each hydrogen is in its parent's residue.
+        '''
+        from numpy import array, ascontiguousarray
+        n = len(parents)
+        names = array(names, object)
+        xyz = ascontiguousarray(coords, float64)
+        serials = ascontiguousarray(serial_numbers, int32)
+        rgba = ascontiguousarray(colors, uint8)
+        if len(names) != n or xyz.shape != (n,3) or len(serials) != n or rgba.shape != (n,4):
+            raise ValueError('Need a name, xyz, serial number and color for each of %d hydrogens' % n)
+        f = c_function('structure_new_hydrogens',
+                       args = (ctypes.c_void_p, ctypes.c_void_p, ctypes.c_size_t, ctypes.c_void_p,
+                               ctypes.c_void_p, ctypes.c_void_p, ctypes.c_void_p),
+                       ret = ctypes.py_object)
+        return convert.atoms(f(self._c_pointer, parents._c_pointers, n, pointer(names),
+                               pointer(xyz), pointer(serials), pointer(rgba)))
+
     def new_coordset(self, index=None, size=None):
         '''Supported API. Create a new empty coordset.  In almost all circumstances one would
             use the add_coordset(s) method instead (to add fully populated coordsets), but in
@@ -1854,6 +2093,15 @@ class StructureData:
                        ret = ctypes.py_object)
         return f(self._c_pointer, residue_name.encode('utf-8'), chain_id.encode('utf-8'), pos, insert.encode('utf-8'), ctypes.c_void_p(0) if precedes is None else precedes._c_pointer)
 
+    def memory_usage(self):
+        '''Return a dictionary of approximate bytes used by this structure's C++ data,
+           keyed by category: "atoms", "bonds", "residues", "coordsets", "alt locs",
+           "rings", "chains", "pseudobonds", and "caches" for data that is rebuilt
+           when needed.  Sizes are from container capacities, so include space
+           reserved for growth.'''
+        f = c_function('structure_memory_usage', args = (ctypes.c_void_p,), ret = ctypes.py_object)
+        return f(self._c_pointer)
+
     @property
     def nonstandard_residue_names(self):
         '''"ligand-y" residue names in this structure'''
@@ -1927,6 +2175,38 @@ class StructureData:
             args = (ctypes.c_void_p, ctypes.py_object, ctypes.c_int))
         f(self._c_pointer, [r._c_pointer.value for r in renumbered], start)
 
+    def set_residue_numbers(self, residues, numbers, insertion_codes = None, *, check_only = False):
+        '''Set the numbers, and insertion codes if given, of many of the structure's
+           :class:`.Residues` at once, with one change notification.  Insertion codes are
+           strings of at most one character, '' or ' ' for none.  Raises ValueError, and
+           changes nothing, if residues would end up with the same chain ID, number and
+           insertion code.  Residue order is not changed.  With 'check_only' only checks for
+           conflicts, for validating changes to several structures before making any.
+        '''
+        n = len(residues)
+        from numpy import array
+        nums = array(numbers, int32)
+        if insertion_codes is None:
+            insertion_codes = residues.insertion_codes
+        codes = ''.join((ic or ' ') for ic in insertion_codes).encode('utf-8')
+        if len(nums) != n or len(codes) != n:
+            raise ValueError('Need one number and one-character insertion code per residue')
+        f = c_function('structure_set_residue_numbers', args = (ctypes.c_void_p, ctypes.c_void_p,
+            ctypes.c_size_t, ctypes.c_void_p, ctypes.c_char_p, ctypes.c_bool))
+        f(self._c_pointer, residues._c_pointers, n, pointer(nums), codes, check_only)
+
+    def set_residue_chain_ids(self, residues, chain_ids, *, check_only = False):
+        '''Set the chain IDs of many of the structure's :class:`.Residues` at once, with one
+           change notification.  Polymeric residues change by changing the ID of their whole
+           chain, so all residues of a chain must get the same ID.  Raises ValueError, and
+           changes nothing, if residues would end up with the same chain ID, number and
+           insertion code or a chain would get the ID of an unchanged chain.  With 'check_only'
+           only checks.
+        '''
+        f = c_function('structure_set_residue_chain_ids', args = (ctypes.c_void_p, ctypes.c_void_p,
+            ctypes.c_size_t, ctypes.py_object, ctypes.c_bool))
+        f(self._c_pointer, residues._c_pointers, len(residues), list(chain_ids), check_only)
+
     def reorder_residues(self, new_order):
         '''Reorder the residues.  Obviously, 'new_order' has to have exactly the same
            residues as the structure currently has.
@@ -2137,6 +2417,17 @@ class CoordSet(State):
         f = c_function('coordset_xyzs', args = (ctypes.c_void_p,), ret = ctypes.py_object)
         return f(self._c_pointer)
 
+    @xyzs.setter
+    def xyzs(self, xyz):
+        "Set all coordinates from an N by 3 array, N being the coordset size"
+        n = self.structure.coordset_size
+        if xyz.shape != (n,3):
+            raise ValueError('CoordSet.xyzs: array must be %d x 3, got %s' % (n, str(xyz.shape)))
+        from numpy import float64, ascontiguousarray
+        xyz = ascontiguousarray(xyz, float64)
+        f = c_function('coordset_set_xyzs', args = (ctypes.c_void_p, ctypes.c_void_p, ctypes.c_size_t))
+        f(self._c_pointer, pointer(xyz), n)
+
     def take_snapshot(self, session, flags):
         data = {'structure': self.structure, 'cs_id': self.id,
                 'custom attrs': self.custom_attrs}
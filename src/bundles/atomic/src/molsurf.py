@@ -112,6 +112,8 @@ class MolecularSurface(Surface):
         self._vertex_to_atom = None
         self._vertex_to_atom_count = None	# Used to check if atoms deleted
         self._max_radius = None
+        self._ses_grids = None		# Distance grids for fast updates after atoms move
+        self._keep_ses_grids = False
         self.clip_cap = True
 
     def delete(self):
@@ -151,6 +153,7 @@ class MolecularSurface(Surface):
 
         if shape_change:
             self._clear_shape()
+            self._ses_grids = None
         elif shown_changed:
             self.triangle_mask = self._calc_triangle_mask()
 
@@ -195,6 +198,13 @@ class MolecularSurface(Surface):
             for s in self.atoms.unique_structures:
                 if s in changed_structures:
                     return True
+        if 'coords replaced' in changes.structure_reasons():
+            # All coordinates replaced at once, e.g. reading a trajectory frame.
+            # Avoid comparing against every modified atom.
+            changed_structures = set(changes.coords_replaced_structures())
+            for s in self.atoms.unique_structures:
+                if s in changed_structures:
+                    return True
         if 'coord changed' in changes.atom_reasons():
             # Atom coordinates changed through Atom or Atoms set_coord()
             if self.atoms.intersects(changes.modified_atoms()):
@@ -219,6 +229,10 @@ class MolecularSurface(Surface):
             self.session.models.close([self])
         else:
             self._clear_shape()
+            # Atoms have moved and will likely move again, as when changing
+            # rotamers, so keep distance grids to only recompute regions
+            # near moved atoms.
+            self._keep_ses_grids = True
             self.calculate_surface_geometry()
         
     @property
@@ -239,19 +253,32 @@ class MolecularSurface(Surface):
         xyz = self.atom_coords()
         res = self.resolution
         from chimerax import surface
+        v2a = None
         if res is None:
             # Compute solvent excluded surface
             r = atoms.radii
             self._max_radius = r.max()
-            va, na, ta = surface.ses_surface_geometry(xyz, r, self.probe_radius, self.grid_spacing)
+            grids = getattr(self, '_ses_grids', None)
+            geom = None if grids is None else surface.ses_surface_update(grids, xyz, r)
+            if geom is None:
+                keep = getattr(self, '_keep_ses_grids', False)
+                geom = surface.ses_surface_geometry(xyz, r, self.probe_radius, self.grid_spacing,
+                                                    vertex_atoms = True, keep_grids = keep)
+                self._ses_grids = geom[4] if keep else None
+            va, na, ta, v2a = geom[:4]
+            if (v2a < 0).any():
+                v2a = None	# Computed with an error message by vertex_to_atom_map()
         else:
             # Compute Gaussian surface
             va, na, ta, level = surface.gaussian_surface(xyz, atoms.element_numbers, res,
                                                          self.level, self.grid_spacing)
             self.gaussian_level = level
 
+        if v2a is not None:
+            self._vertex_to_atom_count = len(atoms)
         if self.sharp_boundaries:
-            v2a = self.vertex_to_atom_map(va)
+            if v2a is None:
+                v2a = self.vertex_to_atom_map(va)
             kw = {'refinement_steps': self._refinement_steps}
             if self.resolution is None:
                 kw['atom_radii'] = atoms.radii
@@ -259,6 +286,8 @@ class MolecularSurface(Surface):
             va, na, ta, tj, v2a = sharp_edge_patches(va, na, ta, v2a, xyz, **kw)
             self._joined_triangles = tj	# With non-duplicate vertices for clip cap calculation
             self._vertex_to_atom = v2a
+        elif v2a is not None:
+            self._vertex_to_atom = v2a
 
         self.set_geometry(va, na, ta)
         self.triangle_mask = self._calc_triangle_mask()
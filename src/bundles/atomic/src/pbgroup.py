@@ -103,6 +103,24 @@ class PseudobondGroup(PseudobondGroupData, Model):
     def atomspec_pseudobonds(self):
         return self.pseudobonds
 
+    def length_text_changes(self, decimal_places, previous = None):
+        '''
+        For updating distance labels.  Returns the current pseudobonds, their scene lengths,
+        int64 keys for the lengths printed with decimal_places digits after the decimal point,
+        and a bool array that is True for pseudobonds whose printed length differs from
+        previous, the (pseudobonds, keys) of an earlier call.  All are marked changed if
+        previous is None or was for different pseudobonds.
+        '''
+        pbs = self.pseudobonds
+        prev_keys = None
+        if previous is not None:
+            prev_pbs, keys = previous
+            # Deleted pseudobonds are removed from prev_pbs but not from keys.
+            if len(keys) == len(pbs) and prev_pbs == pbs:
+                prev_keys = keys
+        lengths, keys, changed = pbs.length_text_changes(decimal_places, prev_keys)
+        return pbs, lengths, keys, changed
+
     def get_selected(self, include_children=False, fully=False):
         if fully:
             if self.pseudobonds.num_selected < self.num_pseudobonds:
@@ -208,7 +226,6 @@ class PseudobondGroup(PseudobondGroupData, Model):
             d = self._pbond_drawing = BondsDrawing('pbonds', PickedPseudobond, PickedPseudobonds)
             self.update_cylinder_sides()
             self.add_drawing(d)
-            d._visible_atoms = None
             changes = self._ALL_CHANGE
         elif self.num_pseudobonds == 0:
             self.remove_drawing(d)
@@ -221,16 +238,18 @@ class PseudobondGroup(PseudobondGroupData, Model):
         if changes & self._DISPLAY_CHANGE or d.visible_bonds is None:
             vpb = self._shown_pbonds(self.pseudobonds)
             d.visible_bonds = vpb
-            d._visible_atoms = vpb.atoms
         
         pbonds = d.visible_bonds
-        bond_atoms = d._visible_atoms
 
-        if changes & self._SHAPE_CHANGE:
-            d.positions = self._update_positions(pbonds, bond_atoms)
-            
-        if changes & self._COLOR_CHANGE:
-            d.colors = pbonds.half_colors
+        shape_change, color_change = changes & self._SHAPE_CHANGE, changes & self._COLOR_CHANGE
+        if shape_change or color_change:
+            axyz0, axyz1, radii, colors = pbonds.cylinder_data(coords = shape_change,
+                colors = color_change, scene_coordinates = self._global_group)
+            if shape_change:
+                d.positions = self._update_positions(axyz0, axyz1, radii,
+                    d.positions.halfbond_cylinder_array())
+            if color_change:
+                d.colors = colors
             
         if changes & self._SELECT_CHANGE:
             from . import structure as s
@@ -249,15 +268,12 @@ class PseudobondGroup(PseudobondGroupData, Model):
         self._graphics_changed |= self._SHAPE_CHANGE
         return True
 
-    def _update_positions(self, pbonds, bond_atoms):
-        ba1, ba2 = bond_atoms
+    def _update_positions(self, axyz0, axyz1, radii, array = None):
         if self._global_group:
             to_pbg = self.scene_position.inverse()
-            axyz0, axyz1 = to_pbg*ba1.pb_scene_coords, to_pbg*ba2.pb_scene_coords
-        else:
-            axyz0, axyz1 = ba1.pb_coords, ba2.pb_coords
+            axyz0, axyz1 = to_pbg*axyz0, to_pbg*axyz1
         from . import structure as s
-        return s._halfbond_cylinder_placements(axyz0, axyz1, pbonds.radii)
+        return s._halfbond_cylinders(axyz0, axyz1, radii, array)
 
     def _shown_pbonds(self, pbonds):
         # Check if models containing end-point have displayed structures.
@@ -42,9 +42,9 @@ from . import _ribbons
 def _make_ribbon_graphics(structure, ribbons_drawing):
     '''Update ribbons drawing.'''
 
-    ribbons_drawing.clear()
-
     if structure.ribbon_display_count == 0:
+        ribbons_drawing.clear()
+        ribbons_drawing._chain_cache = {}
         return
 
     if timing:
@@ -72,6 +72,17 @@ def _make_ribbon_graphics(structure, ribbons_drawing):
     roffset = 0
     tethered_atoms = []
     backbone_atoms = []
+    chains = []		# Spline paths and cross-sections to extrude for each chain
+
+    # Chain ribbons from the last ribbon calculation, for reuse if unchanged.
+    chain_cache = ribbons_drawing._chain_cache
+    ribbons_drawing._chain_cache = new_cache = {}
+    chain_ribbons = []
+    same_triangles = True	# Whether all chains have the same triangles as last time
+    xs_mgr = structure.ribbon_xs_mgr
+    chain_settings = (structure.ribbon_mode_helix, structure.ribbon_mode_strand,
+                      segment_divisions, structure.spline_normals,
+                      xs_mgr, xs_mgr.version)
 
     for rlist, ptype in polymers:
         # Always call get_polymer_spline to make sure hide bits are
@@ -89,7 +100,8 @@ def _make_ribbon_graphics(structure, ribbons_drawing):
 
         # Always update all atom visibility so that undisplaying ribbon
         # will bring back previously hidden backbone atoms
-        residues.atoms.update_ribbon_backbone_atom_visibility()
+        ratoms = residues.atoms
+        ratoms.update_ribbon_backbone_atom_visibility()
 
         if len(atoms) < 2:
             continue
@@ -98,88 +110,114 @@ def _make_ribbon_graphics(structure, ribbons_drawing):
         if displays.sum() == 0:
             continue
 
-        if timing:
-            t0 = time()
+        # Reuse what is unchanged since the last ribbon calculation for this chain.
+        # If only coordinates changed, as in trajectory playback, the residue ranges,
+        # cross-sections, triangles and tether atoms are reused.
+        topology_arrays, coord_arrays = \
+            _ribbon_chain_key_arrays(structure, residues, ratoms, coords, guides, displays)
+        topology_key = chain_settings + _arrays_key(topology_arrays)
+        coord_key = _arrays_key(coord_arrays)
+        cr = chain_cache.get(topology_key)
+        if cr is None:
+            same_triangles = False
+            if timing:
+                t0 = time()
             
-        # Assign a residue class to each residue and compute the
-        # ranges of secondary structures
-        is_helix = residues.is_helix
-        ssids = residues.secondary_structure_ids
-        arc_helix = (structure.ribbon_mode_helix == structure.RIBBON_MODE_ARC)
-        res_class, helix_ranges, sheet_ranges, display_ranges = \
-            _ribbon_ranges(is_helix, residues.is_strand, ssids, displays,
-                           residues.polymer_types, arc_helix)
-
-        if timing:
-            rangestime += time()-t0
-            t0 = time()
-
-        # Assign front and back cross sections for each residue.
-        xs_mgr = structure.ribbon_xs_mgr
-        xs_front, xs_back, smooth_twist = \
-            _ribbon_crosssections(res_class, xs_mgr, is_helix, arc_helix)
+            # Assign a residue class to each residue and compute the
+            # ranges of secondary structures
+            is_helix = residues.is_helix
+            ssids = residues.secondary_structure_ids
+            arc_helix = (structure.ribbon_mode_helix == structure.RIBBON_MODE_ARC)
+            res_class, helix_ranges, sheet_ranges, display_ranges = \
+                _ribbon_ranges(is_helix, residues.is_strand, ssids, displays,
+                               residues.polymer_types, arc_helix)
+
+            if timing:
+                rangestime += time()-t0
+                t0 = time()
+
+            # Assign front and back cross sections for each residue.
+            xs_front, xs_back, smooth_twist = \
+                _ribbon_crosssections(res_class, xs_mgr, is_helix, arc_helix)
+            flip_normals = _ribbon_flip_normals(structure, is_helix)
+
+            if timing:
+                xstime += time()-t0
+
+            cr = _ChainRibbon((arc_helix, helix_ranges, sheet_ranges, display_ranges,
+                               xs_front, xs_back, smooth_twist, flip_normals))
+        chain_ribbons.append(cr)
+        new_cache[topology_key] = cr
+
+        if cr.coord_key == coord_key:
+            chains.append((cr.geometry._geom_cpp, roffset))
+        else:
+            if timing:
+                t0 = time()
 
-        if timing:
-            xstime += time()-t0
-            t0 = time()
+            (arc_helix, helix_ranges, sheet_ranges, display_ranges,
+             xs_front, xs_back, smooth_twist, flip_normals) = cr.topology
             
-        # Perform any smoothing (e.g., strand smoothing
-        # to remove lasagna sheets, pipes and planks
-        # display as cylinders and planes, etc.)
-        _smooth_ribbon(residues, coords, guides, helix_ranges, sheet_ranges,
-                       structure.ribbon_mode_helix, structure.ribbon_mode_strand)
-
-        if timing:
-            smootime += time()-t0
-            t0 = time()
-
-        # Create tube helices.
-        if arc_helix:
-            ribbon_adjusts = residues.ribbon_adjusts
-            for start, end in helix_ranges:
-                if displays[start:end].any():
-                    centers = _arc_helix_geometry(coords, xs_mgr, displays, start, end, geometry)
-                    # Adjust coords so non-tube half of helix ends joins center of cylinder
-                    coords[start:end] = centers
-
-        if timing:
-            tubetime += time()-t0
-            t0 = time()
-
-        # _ss_control_point_display(ribbons_drawing, coords, guides)
-
-        # Create spline path
-        if timing:
-            t1 = time()
-        orients = structure.ribbon_orients(residues)
-        flip_normals = _ribbon_flip_normals(structure, is_helix)
-        ribbon = Ribbon(coords, guides, orients, flip_normals, smooth_twist, segment_divisions,
-                        structure.spline_normals)
-        if timing:
-            spltime += time()-t1
-
-        if timing:
-            t1 = time()
-        path = ribbon.path()
-        # _debug_show_normal_spline(ribbons_drawing, coords, ribbon, num_divisions)
-        if timing:
-            interptime += time()-t1
-
-        if timing:
-            pathtime += time() - t0
-            t0 = time()
+            # Perform any smoothing (e.g., strand smoothing
+            # to remove lasagna sheets, pipes and planks
+            # display as cylinders and planes, etc.)
+            _smooth_ribbon(residues, coords, guides, helix_ranges, sheet_ranges,
+                           structure.ribbon_mode_helix, structure.ribbon_mode_strand)
+
+            if timing:
+                smootime += time()-t0
+                t0 = time()
+
+            # Each chain accumulates its own triangles so chains can be extruded
+            # in parallel and unchanged chains reused.
+            chain_geometry = TriangleAccumulator()
+
+            # Create tube helices.
+            if arc_helix:
+                ribbon_adjusts = residues.ribbon_adjusts
+                for start, end in helix_ranges:
+                    if displays[start:end].any():
+                        centers = _arc_helix_geometry(coords, xs_mgr, displays, start, end,
+                                                      chain_geometry)
+                        # Adjust coords so non-tube half of helix ends joins center of cylinder
+                        coords[start:end] = centers
+
+            if timing:
+                tubetime += time()-t0
+                t0 = time()
+
+            # _ss_control_point_display(ribbons_drawing, coords, guides)
+
+            # Create spline path
+            if timing:
+                t1 = time()
+            orients = topology_arrays[-1]
+            ribbon = Ribbon(coords, guides, orients, flip_normals, smooth_twist, segment_divisions,
+                            structure.spline_normals)
+            if timing:
+                spltime += time()-t1
+
+            # _debug_show_normal_spline(ribbons_drawing, coords, ribbon, num_divisions)
+
+            if timing:
+                pathtime += time() - t0
+                t0 = time()
             
-        # Compute ribbon triangles
-        _ribbon_geometry(path, display_ranges, len(residues), xs_front, xs_back, geometry)
+            # Ribbon path and triangles are computed for all chains together below.
+            chains.append(_ribbon_chain(chain_geometry, roffset, ribbon, display_ranges,
+                                        len(residues), xs_front, xs_back))
+            cr.coord_key, cr.geometry, cr.ribbon = coord_key, chain_geometry, ribbon
 
         if timing:
-            geotime += time() - t0
             t0 = time()
 
         # Get list of tethered atoms and attachment position to ribbon.
         if structure.ribbon_tether_scale > 0:
             min_tether_offset = structure.bond_radius
-            t_atoms, b_atoms = _ribbon_tethers(ribbon, residues, min_tether_offset)
+            if cr.tether_placements is None:
+                cr.tether_placements = _ribbons.tether_placements(residues.pointers)
+            t_atoms, b_atoms = _ribbon_tethers(cr.ribbon, residues, min_tether_offset,
+                                               cr.tether_placements)
             if t_atoms:
                 tethered_atoms.append(t_atoms)
             if b_atoms:
@@ -191,13 +229,34 @@ def _make_ribbon_graphics(structure, ribbons_drawing):
         polyres.append(residues)
 
         roffset += len(residues)
-        geometry.set_range_offset(roffset)
+
+    # Compute spline paths and ribbon triangles for all chains in parallel
+    if timing:
+        t0 = time()
+    _ribbon_chains_geometry(chains, geometry)
+    if timing:
+        geotime += time() - t0
 
     if timing:
         t0 = time()
         
-    # Set ribbon drawing geometry, colors, residue triangle ranges, and tethers
-    if not geometry.empty():
+    # If every chain has the same triangles as last time, in the same order, only
+    # vertex positions and normals change.  Triangles, residue ranges, colors
+    # and highlighting are kept.
+    last_chain_ribbons = ribbons_drawing._chain_ribbons
+    if (same_triangles and not geometry.empty() and ribbons_drawing.triangles is not None
+        and len(chain_ribbons) == len(last_chain_ribbons)
+        and all(cr is lcr for cr, lcr in zip(chain_ribbons, last_chain_ribbons))):
+        va, na, ta = geometry.vertex_normal_triangle_arrays()
+        ribbons_drawing.set_vertices_and_normals(va, na)
+        ribbons_drawing.remove_tethers()
+        ribbons_drawing.set_tethers(tethered_atoms, backbone_atoms,
+                                    structure.ribbon_tether_shape,
+                                    structure.ribbon_tether_scale,
+                                    structure.ribbon_tether_sides)
+    elif not geometry.empty():
+        ribbons_drawing.clear()
+
         # Set drawing geometry
         va, na, ta = geometry.vertex_normal_triangle_arrays()
         ribbons_drawing.set_geometry(va, na, ta)
@@ -216,6 +275,9 @@ def _make_ribbon_graphics(structure, ribbons_drawing):
                                     structure.ribbon_tether_shape,
                                     structure.ribbon_tether_scale,
                                     structure.ribbon_tether_sides)
+    else:
+        ribbons_drawing.clear()
+    ribbons_drawing._chain_ribbons = chain_ribbons
 
     if timing:
         drtime = time() - t0
@@ -446,6 +508,48 @@ def _ribbon_geometry(path, ranges, num_res, xs_front, xs_back, geometry):
     xsb = [xs._xs_pointer for xs in xs_back]
     _ribbons.ribbon_extrusions(centers, tangents, normals, ranges,
                                num_res, xsf, xsb, geometry._geom_cpp)
+
+class _ChainRibbon:
+    '''Ribbon calculation for one chain, kept for reuse when the chain is unchanged.'''
+    def __init__(self, topology):
+        self.topology = topology	# Residue ranges and cross-sections
+        self.coord_key = None		# Coordinates used for geometry and ribbon
+        self.geometry = None		# TriangleAccumulator
+        self.ribbon = None		# Ribbon spline
+        self.tether_placements = None	# Atoms and spline positions for tethers
+
+def _ribbon_chain_key_arrays(structure, residues, atoms, coords, guides, displays):
+    '''
+    Per-residue values that together with the structure ribbon settings
+    determine the ribbon of a chain.  Used to detect unchanged chains.
+    The first set determines the triangles and ends with the orientations,
+    the second set determines the vertex positions.
+    '''
+    topology = (residues.pointers, atoms.pointers, displays,
+                residues.is_helix, residues.is_strand, residues.secondary_structure_ids,
+                residues.polymer_types, residues.ribbon_adjusts,
+                structure.ribbon_orients(residues))
+    return topology, (coords, guides)
+
+def _arrays_key(arrays):
+    return tuple((None if a is None else a.tobytes()) for a in arrays)
+
+def _ribbon_chain(chain_geometry, residue_offset, ribbon, ranges, num_res, xs_front, xs_back):
+    '''Spline path and cross-section parameters for _ribbon_chains_geometry().'''
+    coeff, normals, flip_normals, twist, ndiv = ribbon.path_parameters()
+    xsf = [xs._xs_pointer for xs in xs_front]
+    xsb = [xs._xs_pointer for xs in xs_back]
+    return (chain_geometry._geom_cpp, residue_offset,
+            coeff, normals, flip_normals, twist, ndiv, ranges, num_res, xsf, xsb)
+
+def _ribbon_chains_geometry(chains, geometry):
+    '''
+    Compute spline paths and extrusions for many chains in parallel, adding
+    each chain's triangles to geometry in chain order.  Chains given as just
+    (chain_geometry, residue_offset) were computed before and are copied.
+    '''
+    if chains:
+        _ribbons.ribbon_chain_extrusions(chains, geometry._geom_cpp)
     
 # Compute triangle geometry for ribbon.
 # Only certain ranges of residues are considered, since not all
@@ -586,6 +690,8 @@ class RibbonsDrawing(Drawing):
         self._triangle_ranges_sorted = None	# Sorted ranges for first_intercept() calc
         self._residues = None			# Residues used with _triangle_ranges
         self._residues_count = 0		# For detecting deleted residues
+        self._chain_cache = {}			# Chain ribbons for reuse, see _make_ribbon_graphics()
+        self._chain_ribbons = []		# Chain ribbons in current geometry
         
     def clear(self):
         self.set_geometry(None, None, None)
@@ -593,6 +699,13 @@ class RibbonsDrawing(Drawing):
         self._tethers_drawing = None
         self._triangle_ranges = None
         self._residues = None
+        self._chain_ribbons = []
+
+    def remove_tethers(self):
+        td = self._tethers_drawing
+        if td:
+            self.remove_drawing(td)
+            self._tethers_drawing = None
 
     def compute_ribbons(self, structure):
         if timing:
@@ -778,17 +891,18 @@ def _tether_placements(xyz0, xyz1, radius, shape):
     c0,c1 = (xyz1,xyz0) if shape == StructureData.TETHER_REVERSE_CONE else (xyz0,xyz1)
     return _bond_cylinder_placements(c0, c1, radius)
 
-def _ribbon_tethers(ribbon, residues, min_tether_offset):
+def _ribbon_tethers(ribbon, residues, min_tether_offset, placements = None):
     # Find position of backbone atoms on ribbon for drawing tethers
-    t_atoms = _set_tether_positions(residues, ribbon.segment_coefficients)
+    t_atoms = _set_tether_positions(residues, ribbon.segment_coefficients, placements)
     offsets = t_atoms.coords - t_atoms.ribbon_coords
     tethered = norm(offsets, axis=1) > min_tether_offset
     tethered_atoms = t_atoms.filter(tethered) if any(tethered) else None
     return tethered_atoms, t_atoms
 
-def _set_tether_positions(residues, coef):
+def _set_tether_positions(residues, coef, placements = None):
     # This _ribbons call sets atom.ribbon_coord to the position for each tethered atom.
-    atom_pointers = _ribbons.set_atom_tether_positions(residues.pointers, coef)
+    # Placements from _ribbons.tether_placements() avoid finding the atoms again.
+    atom_pointers = _ribbons.set_atom_tether_positions(residues.pointers, coef, placements)
     from . import Atoms
     atoms = Atoms(atom_pointers)
     return atoms
@@ -1389,10 +1503,14 @@ class Ribbon:
         return normalize_vector_array(array(t))
 
     def path(self):
-        coords, tangents, normals = _spline_path(self._coeff, self._normals, self._flip_normals,
-                                                 self._smooth_twist, self._segment_divisions)
+        coords, tangents, normals = _spline_path(*self.path_parameters())
         return coords, tangents, normals
 
+    def path_parameters(self):
+        '''Spline coefficients, normals, flip, twist and divisions used to compute path.'''
+        return (self._coeff, self._normals, self._flip_normals,
+                self._smooth_twist, self._segment_divisions)
+
     def position(self, seg, t):
         # Compute coordinates for segment seg with parameter t
         return dot(self._coeff[seg], (1.0, t, t*t, t*t*t))
@@ -1819,6 +1937,7 @@ class XSectionManager(State):
         self._xs_sheet_arrow = None
         self._xs_coil = None
         self._xs_nucleic = None
+        self.version = 1		# Incremented when any cross-section changes
 
     def set_structure(self, structure):
         import weakref
@@ -2083,6 +2202,7 @@ class XSectionManager(State):
 
     def _set_gc_ribbon(self):
         # Mark ribbon for rebuild
+        self.version += 1
         s = self.structure()
         if s is not None:
             s._graphics_changed |= s._RIBBON_CHANGE
@@ -2119,6 +2239,7 @@ class XSectionManager(State):
         return xs_mgr
 
     def set_state_from_snapshot(self, session, data):
+        self.version += 1
         for attr in self._SessionAttrs:
             try:
                 setattr(self, attr, data[attr])
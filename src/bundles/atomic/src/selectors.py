@@ -120,10 +120,12 @@ def _add_missing_structure(results, pbs, pbg):
     results.add_model(pbg)
 
 def _structure_category_selector(cat, models, results):
-    from chimerax.atomic import AtomicStructure
+    from chimerax.atomic import AtomicStructure, Atoms
+    code = { 'main': Atoms.CAT_MAIN, 'ligand': Atoms.CAT_LIGAND, 'ions': Atoms.CAT_IONS,
+        'solvent': Atoms.CAT_SOLVENT }[cat]
     for m in models:
         if isinstance(m, AtomicStructure):
-            atoms = m.atoms.filter(m.atoms.structure_categories == cat)
+            atoms = m.atoms.filter(m.atoms.structure_category_codes == code)
             if len(atoms) > 0:
                 results.add_model(m)
                 results.add_atoms(atoms, bonds=True)
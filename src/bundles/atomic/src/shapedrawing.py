@@ -301,6 +301,33 @@ class AtomicShapeDrawing(Drawing, State):
         self.vertex_colors = concat(all_colors)
         self._shapes = all_shapes
 
+    def add_shapes_geometry(self, vertices, normals, triangles, vertex_colors,
+                            triangle_counts, atoms):
+        """Add multiple shapes whose geometry was computed together
+
+        Parameters
+        ----------
+        vertices : :py:class:`numpy.array` of coordinates of all shapes
+        normals : :py:class:`numpy.array` of normals, one per vertex
+        triangles : :py:class:`numpy.array` of vertex indices into all the vertices
+        vertex_colors : :py:class:`numpy.array` of 4 element uint8 colors, one per vertex
+        triangle_counts : sequence of the number of triangles of each shape,
+            the shapes' triangles coming one after another
+        atoms : sequence of :py:class:`~chimerax.atomic.Atoms`, one per shape
+
+        This is :py:meth:`add_shapes` without making and concatenating
+        arrays for each shape.  There must be no initial geometry.
+        """
+        from numpy import cumsum
+        ends = cumsum(triangle_counts).tolist()
+        starts = [0] + ends[:-1]
+        self._shapes = [_AtomicShape(range(start, end), None, a)
+                        for start, end, a in zip(starts, ends, atoms)]
+        if any(a is not None for a in atoms):
+            self._add_handler_if_needed()
+        self.set_geometry(vertices, normals, triangles)
+        self.vertex_colors = vertex_colors
+
     def extend_shape(self, vertices, normals, triangles, color=None):
         """Extend previous shape
 
@@ -0,0 +1,221 @@
+# vim: set expandtab shiftwidth=4 softtabstop=4:
+
+# === UCSF ChimeraX Copyright ===
+# Copyright 2022 Regents of the University of California. All rights reserved.
+# The ChimeraX application is provided pursuant to the ChimeraX license
+# agreement, which covers academic and commercial uses. For more details, see
+# <http://www.rbvi.ucsf.edu/chimerax/docs/licensing.html>
+#
+# This particular file is part of the ChimeraX library. You can also
+# redistribute and/or modify it under the terms of the GNU Lesser General
+# Public License version 2.1 as published by the Free Software Foundation.
+# For more details, see
+# <https://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>
+#
+# THIS SOFTWARE IS PROVIDED "AS IS" WITHOUT WARRANTY OF ANY KIND, EITHER
+# EXPRESSED OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+# OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. ADDITIONAL LIABILITY
+# LIMITATIONS ARE DESCRIBED IN THE GNU LESSER GENERAL PUBLIC LICENSE
+# VERSION 2.1
+#
+# This notice must be embedded in or attached to all copies, including partial
+# copies, of the software or any revisions or derivations thereof.
+# === UCSF ChimeraX Copyright ===
+
+"""
+snapshot: binary structure files for fast reopening
+====================================================
+
+A snapshot holds atomic structures (atoms, bonds, residues, chains,
+coordinate sets, secondary structure and metadata) as the same arrays that
+are saved in a session.  The arrays are stored uncompressed after a small
+header so the file can be memory-mapped read-only and the structure made
+from the arrays in bulk without parsing.  Many processes opening the same
+snapshot share its pages in the operating system file cache.
+
+Snapshots are meant as a fast local cache of files already read, for
+example by batch worker processes that all open the same large structures.
+The format follows the session version of the structure data, so a
+snapshot is only readable by versions of ChimeraX that can restore sessions
+with that structure data.
+"""
+
+SNAPSHOT_MAGIC = b'CXSNAP1\n'
+SNAPSHOT_VERSION = 1
+_ALIGNMENT = 64          # byte alignment of arrays in the file
+_ARRAY_KEY = '__snapshot_array__'
+
+
+def save_snapshot(session, path, *, models=None):
+    '''Save atomic structures to a snapshot file.'''
+    from . import AtomicStructure
+    if models is None:
+        models = session.models.list(type=AtomicStructure)
+    structures = [m for m in models if isinstance(m, AtomicStructure)]
+    if len(structures) == 0:
+        from chimerax.core.errors import UserError
+        raise UserError("No atomic structures to save in snapshot")
+    write_snapshot(path, structures)
+
+
+def open_snapshot(session, path):
+    '''Open a snapshot file, returning a list of models and a status message.'''
+    header = read_snapshot(path)
+    from . import AtomicStructure
+    models = []
+    try:
+        for state in header['structures']:
+            s = AtomicStructure(session, name=state['name'], auto_style=False, log_info=False)
+            models.append(s)
+            restore_structure(s, state)
+    except Exception:
+        for s in models:
+            s.delete()
+        raise
+    natoms = sum(s.num_atoms for s in models)
+    status = "Opened snapshot %s with %d atoms" % (', '.join(s.name for s in models), natoms)
+    return models, status
+
+
+def write_snapshot(path, structures, info=None):
+    '''
+    Write structures to a snapshot file.  Info is a dictionary of simple
+    values saved in the header and returned by read_snapshot(), for example
+    to check that a cached snapshot matches its source file.
+    '''
+    arrays = []
+    states = []
+    for s in structures:
+        s._ses_call("save_setup")
+        try:
+            state = s.save_state(s.session, None).data
+        finally:
+            s._ses_call("save_teardown")
+        states.append({
+            'name': s.name,
+            'version': state['version'],
+            'ints': _replace_arrays(state['ints'], arrays),
+            'floats': _replace_arrays(state['floats'], arrays),
+            'misc': _replace_arrays(state['misc'], arrays),
+        })
+    table = []
+    offset = 0
+    for a in arrays:
+        offset = _aligned(offset)
+        table.append((a.dtype.str, a.shape, offset))
+        offset += a.nbytes
+    header = {
+        'snapshot version': SNAPSHOT_VERSION,
+        'info': {} if info is None else info,
+        'structures': states,
+        'arrays': table,
+    }
+
+    import io
+    from chimerax.core.serialize import msgpack_serialize_stream, msgpack_serialize
+    hbytes = io.BytesIO()
+    msgpack_serialize(msgpack_serialize_stream(hbytes), header)
+    hbytes = hbytes.getvalue()
+
+    from numpy import ascontiguousarray, uint64
+    with open(path, 'wb') as f:
+        f.write(SNAPSHOT_MAGIC)
+        f.write(uint64(len(hbytes)).tobytes())
+        f.write(hbytes)
+        data_start = _aligned(f.tell())
+        for a, (dtype, shape, offset) in zip(arrays, table):
+            f.write(b'\0' * (data_start + offset - f.tell()))
+            f.write(ascontiguousarray(a).data)
+
+
+def read_snapshot(path):
+    '''
+    Read a snapshot header.  The arrays of each structure state are read-only
+    views of the memory-mapped file.
+    '''
+    from numpy import memmap, uint8, frombuffer, uint64
+    m = memmap(path, dtype=uint8, mode='r')
+    from chimerax.core.errors import UserError
+    nmagic = len(SNAPSHOT_MAGIC)
+    if m.size < nmagic + 8 or m[:nmagic].tobytes() != SNAPSHOT_MAGIC:
+        raise UserError("%s is not a ChimeraX structure snapshot" % path)
+    hsize = int(frombuffer(m[nmagic:nmagic+8].tobytes(), uint64)[0])
+    hstart = nmagic + 8
+
+    import io
+    from chimerax.core.serialize import msgpack_deserialize_stream, msgpack_deserialize
+    header = msgpack_deserialize(msgpack_deserialize_stream(
+        io.BytesIO(m[hstart:hstart+hsize].tobytes())))
+    if header.get('snapshot version', 0) > SNAPSHOT_VERSION:
+        raise UserError("Snapshot %s is from a newer version of ChimeraX" % path)
+
+    data_start = _aligned(hstart + hsize)
+    from numpy import dtype as numpy_dtype, prod
+    arrays = []
+    for dtype, shape, offset in header['arrays']:
+        dt = numpy_dtype(dtype)
+        start = data_start + offset
+        nbytes = int(prod(shape, dtype=int)) * dt.itemsize
+        if start + nbytes > m.size:
+            raise UserError("Snapshot %s is truncated" % path)
+        arrays.append(m[start:start+nbytes].view(dt).reshape(shape))
+
+    for state in header['structures']:
+        for key in ('ints', 'floats', 'misc'):
+            state[key] = _restore_arrays(state[key], arrays)
+    return header
+
+
+def restore_structure(s, state):
+    '''Fill an empty structure from one of the states given by read_snapshot().'''
+    # Same as session restore, but without waiting for the end of a session
+    # restore to tear down the pseudobond id maps.
+    from .molobject import c_function
+    import ctypes
+    s._ses_call("restore_setup")
+    try:
+        f = c_function('structure_session_restore',
+            args = (ctypes.c_void_p, ctypes.c_int,
+                    ctypes.py_object, ctypes.py_object, ctypes.py_object))
+        try:
+            f(s._c_pointer, state['version'], tuple(state['ints']), tuple(state['floats']),
+                tuple(state['misc']))
+        except TypeError as e:
+            if "Don't know how to restore new session data" in str(e):
+                from chimerax.core.errors import UserError
+                raise UserError("Snapshot is from a newer version of ChimeraX: %s" % e)
+            raise
+    finally:
+        s._ses_call("restore_teardown")
+
+    s.ribbon_xs_mgr.set_structure(s)
+    # Create Python pseudobond group models so they are added as children.
+    list(s.pbg_map.values())
+    s._graphics_changed |= (s._SHAPE_CHANGE | s._RIBBON_CHANGE | s._RING_CHANGE)
+
+
+def _aligned(offset):
+    return ((offset + _ALIGNMENT - 1) // _ALIGNMENT) * _ALIGNMENT
+
+
+def _replace_arrays(value, arrays):
+    # Replace numpy arrays by their index in the arrays list.
+    from numpy import ndarray
+    if isinstance(value, ndarray) and value.dtype.kind != 'O':
+        arrays.append(value)
+        return {_ARRAY_KEY: len(arrays) - 1}
+    if isinstance(value, (list, tuple)):
+        return type(value)(_replace_arrays(v, arrays) for v in value)
+    if isinstance(value, dict):
+        return {k: _replace_arrays(v, arrays) for k, v in value.items()}
+    return value
+
+
+def _restore_arrays(value, arrays):
+    if isinstance(value, dict):
+        if len(value) == 1 and _ARRAY_KEY in value:
+            return arrays[value[_ARRAY_KEY]]
+        return {k: _restore_arrays(v, arrays) for k, v in value.items()}
+    if isinstance(value, (list, tuple)):
+        return type(value)(_restore_arrays(v, arrays) for v in value)
+    return value
@@ -79,6 +79,7 @@ class Structure(Model, StructureData):
         self._atoms_drawing = None
         self._bonds_drawing = None
         self._chain_trace_pbgroup = None
+        self._residue_beads_drawing = None
         self._ribbons_drawing = None
         self._ring_drawing = None
 
@@ -272,6 +273,63 @@ class Structure(Model, StructureData):
             self.change_tracker.add_modified(self, "position changed")
     positions = property(Model.positions.fget, _structure_set_positions)
 
+    # Symmetric assemblies shown as graphical clones have one copy of the atoms
+    # and a position for each copy.  These methods query copies using their
+    # positions and make atoms for a copy only when it is to be edited.
+    def instance_scene_coords(self, copy_number, atoms = None):
+        '''Scene coordinates of atoms (default all) in the given copy.'''
+        if atoms is None:
+            atoms = self.atoms
+        p = self.positions[copy_number]
+        if self.parent is not None:
+            p = self.parent.scene_position * p
+        return p.transform_points(atoms.coords)
+
+    def instance_contacts(self, distance, atoms = None):
+        '''
+        Find atoms (default all) of pairs of copies placed by this structure's
+        positions that are within distance of each other.  Returns a list of
+        (copy number 1, copy number 2, atoms 1, atoms 2) for contacting copies
+        with atoms 1 the copy 1 atoms near copy 2 and atoms 2 the copy 2
+        atoms near copy 1.  Copy pairs are searched in parallel in C++.
+        '''
+        if atoms is None:
+            atoms = self.atoms
+        positions = self.positions
+        n = len(positions)
+        cpairs = [(c1, c2) for c1 in range(n) for c2 in range(c1+1, n)]
+        if len(cpairs) == 0 or len(atoms) == 0:
+            return []
+        from numpy import float32
+        pa = positions.array()
+        c1, c2 = zip(*cpairs)
+        from chimerax.geometry import find_close_points_copies
+        i1, i2 = find_close_points_copies(atoms.coords.astype(float32),
+                                          pa[list(c1)], pa[list(c2)], distance)
+        return [(c1, c2, atoms.filter(ai1), atoms.filter(ai2))
+                for (c1, c2), ai1, ai2 in zip(cpairs, i1, i2) if len(ai1) > 0]
+
+    def materialize_instance(self, copy_number, name = None):
+        '''
+        Make a new structure with its own atoms for one copy placed by this
+        structure's positions, and remove that position from this structure
+        so the copy can be edited.  Returns the new structure.
+        '''
+        positions = self.positions
+        if len(positions) <= 1:
+            return self
+        if name is None:
+            name = '%s copy %d' % (self.name, copy_number + 1)
+        c = self.copy(name)
+        from chimerax.geometry import Places
+        c.positions = Places([positions[copy_number]])
+        from numpy import ones, bool_
+        keep = ones((len(positions),), bool_)
+        keep[copy_number] = False
+        self.positions = positions.masked(keep)
+        self.session.models.add([c], parent = self.parent)
+        return c
+
     def initial_color(self, bg_color):
         from .colors import structure_color
         id = self.id
@@ -386,6 +444,8 @@ class Structure(Model, StructureData):
         for pbg in self.pbg_map.values():
             pbg._update_graphics(changes)
         self._update_ribbon_graphics(changes)
+        if self._residue_beads_shown and changes & (self._SHAPE_CHANGE | self._COLOR_CHANGE):
+            self._update_residue_beads()
 
     def _update_atom_graphics(self, changes = StructureData._ALL_CHANGE):
 
@@ -400,9 +460,15 @@ class Structure(Model, StructureData):
         if changes & (self._ADDDEL_CHANGE | self._DISPLAY_CHANGE):
             changes |= self._ALL_CHANGE
 
+        # Color, visibility and selection of all atoms in one call.
+        state = None
+        if changes & (self._DISPLAY_CHANGE | self._COLOR_CHANGE | self._SELECT_CHANGE):
+            state = self.atom_display_state()
+
         if changes & self._DISPLAY_CHANGE:
             all_atoms = self.atoms
-            p.visible_atoms = all_atoms[all_atoms.visibles]
+            p.visible_mask = (state[:, self.ATOM_STATE_FLAGS] & self.ATOM_STATE_VISIBLE) != 0
+            p.visible_atoms = all_atoms[p.visible_mask]
 
         atoms = p.visible_atoms
 
@@ -419,11 +485,12 @@ class Structure(Model, StructureData):
 
         if changes & self._COLOR_CHANGE:
             # Set atom colors
-            p.colors = atoms.colors
+            p.colors = state[p.visible_mask, self.ATOM_STATE_COLOR]
 
         if changes & self._SELECT_CHANGE:
             # Set selected
-            p.highlighted_positions = atoms.selected if atoms.num_selected > 0 else None
+            sel = (state[p.visible_mask, self.ATOM_STATE_FLAGS] & self.ATOM_STATE_SELECTED) != 0
+            p.highlighted_positions = sel if sel.any() else None
 
     def _atom_display_radii(self, atoms):
         return atoms.display_radii(self.ball_scale, self.bond_radius)
@@ -437,6 +504,8 @@ class Structure(Model, StructureData):
             changes = self._ALL_CHANGE
             self._bonds_drawing = p = BondsDrawing('bonds', PickedBond, PickedBonds)
             self.add_drawing(p)
+            if self._residue_beads_shown:
+                p.display = False
             # Update level of detail of cylinders
             self._level_of_detail.set_bond_cylinder_geometry(p)
 
@@ -450,7 +519,7 @@ class Structure(Model, StructureData):
         bonds = p.visible_bonds
 
         if changes & self._SHAPE_CHANGE:
-            p.positions = bonds.halfbond_cylinder_placements(p.positions.opengl_matrices())
+            p.positions = bonds.halfbond_cylinders(p.positions.halfbond_cylinder_array())
 
         if changes & self._COLOR_CHANGE:
             p.colors = bonds.half_colors
@@ -514,6 +583,39 @@ class Structure(Model, StructureData):
 
     display = property(_get_display, _set_display)
 
+    @property
+    def _residue_beads_shown(self):
+        bd = self._residue_beads_drawing
+        return bd is not None and bd.display
+
+    def _show_residue_beads(self, show):
+        '''Draw a sphere per residue instead of atoms and bonds.'''
+        if show == self._residue_beads_shown:
+            return
+        bd = self._residue_beads_drawing
+        if show:
+            if bd is None:
+                self._residue_beads_drawing = bd = ResidueBeadsDrawing('residue beads')
+                self.add_drawing(bd)
+            bd.display = True
+            self._update_residue_beads()
+        else:
+            bd.display = False
+        for d in (self._atoms_drawing, self._bonds_drawing):
+            if d is not None:
+                d.display = not show
+
+    def _update_residue_beads(self):
+        bd = self._residue_beads_drawing
+        residues = self.residues
+        xyzr, colors = residues.bead_spheres()
+        shown = xyzr[:,3] > 0
+        bd.residues = residues.filter(shown)
+        from chimerax.geometry import Places
+        bd.positions = Places(shift_and_scale = xyzr[shown])
+        bd.colors = colors[shown]
+        self._level_of_detail.set_atom_sphere_geometry(bd, len(bd.residues))
+
     def _update_level_of_detail(self, total_atoms):
         lod = self._level_of_detail
         bd = self._bonds_drawing
@@ -552,28 +654,36 @@ class Structure(Model, StructureData):
         #   check if all atoms are shown (displayed and not hidden)
         #   if thin, will only use one two-sided fill
         #   if thick, use stick radius to separate fills
-        ring_count = 0
         all_rings = self.rings(all_size_threshold=6)
         # Ring info will change spontaneously when we ask for radii, so remember what we need now
         ring_atoms = [ring.ordered_atoms for ring in all_rings]
-        rings = []
-        for atoms in ring_atoms:
-            residue = atoms[0].residue
-            if not residue.ring_display or not all(atoms.visibles):
-                continue
-            ring_count += 1
-            if residue.thin_rings:
-                offset = 0
-            else:
-                offset = min(self._atom_display_radii(atoms))
-            if len(atoms) < 6:
-                rings.append(self.fill_small_ring(atoms, offset, residue.ring_color))
-            else:
-                rings.append(self.fill_6ring(atoms, offset, residue.ring_color))
+        if not ring_atoms:
+            return
 
-        if ring_count:
-            self._ring_drawing.add_shapes(rings)
-            self._graphics_changed |= self._SHAPE_CHANGE
+        # Find the shown rings and fill them all with one call, since there can be
+        # thousands of nucleotide rings and the per-ring calls dominated the time.
+        from numpy import array, cumsum, int32, float32, logical_and, minimum, repeat
+        from . import concatenate, Atoms
+        atoms = concatenate(ring_atoms, Atoms)
+        sizes = array([len(ra) for ra in ring_atoms], int32)
+        starts = cumsum(sizes) - sizes
+        residues = atoms.residues[starts]
+        shown = residues.ring_displays & logical_and.reduceat(atoms.visibles, starts)
+        if not shown.any():
+            return
+        radii = minimum.reduceat(self._atom_display_radii(atoms), starts)
+        offsets = (radii * ~residues.thin_rings)[shown].astype(float32)
+        shown_atoms = [ra for ra, s in zip(ring_atoms, shown) if s]
+        ring_sizes = sizes[shown]
+        anchors = array([(_ring_anchor(ra) if len(ra) == 6 else 0) for ra in shown_atoms], int32)
+
+        from chimerax.geometry import fill_rings
+        vertices, normals, triangles, vertex_counts, triangle_counts = \
+            fill_rings(concatenate(shown_atoms, Atoms).coords, ring_sizes, offsets, anchors)
+        colors = repeat(residues.ring_colors[shown], vertex_counts, axis=0)
+        self._ring_drawing.add_shapes_geometry(vertices, normals, triangles, colors,
+                                               triangle_counts, shown_atoms)
+        self._graphics_changed |= self._SHAPE_CHANGE
 
     def _res_numbering(self, rn):
         rn_lookup = { 'author': Residue.RN_AUTHOR, 'canonical': Residue.RN_CANONICAL,
@@ -627,33 +737,7 @@ class Structure(Model, StructureData):
         # 6-membered rings
         from chimerax.geometry import fill_6ring
         from .shapedrawing import AtomicShapeInfo
-        # Picking the "best" orientation to show chair/boat configuration is hard
-        # so choose anchor the ring using atom nomenclature.
-        # Find index of atom with lowest element with lowest number (C1 < C6).
-        # Cheat and do lexicographical comparison of name.
-        # TODO: compare speed of algorithms
-        # Algorithm1:
-        # choices = [(a.element.number, a.name, i) for i, a in enumerate(atoms)]
-        # choices.sort()
-        # anchor = choices[0][2]
-        # Algorithm2:
-        # choices = zip(atoms.elements.numbers, atoms.names, range(len(atoms)))
-        # choices.sort()
-        # anchor = choices[0][2]
-        # Algorithm3:
-        anchor = 0
-        anchor_element = atoms[0].element.number
-        anchor_name = atoms[0].name
-        for i, a in enumerate(atoms[1:], 1):
-            e = a.element.number
-            if e > anchor_element:
-                continue
-            if e == anchor_element and a.name >= anchor_name:
-                continue
-            anchor = i
-            anchor_element = e
-            anchor_name = a.name
-        vertices, normals, triangles = fill_6ring(atoms.coords, offset, anchor)
+        vertices, normals, triangles = fill_6ring(atoms.coords, offset, _ring_anchor(atoms))
         return AtomicShapeInfo(vertices, normals, triangles, color, atoms)
 
     def _create_ribbon_graphics(self):
@@ -923,15 +1007,9 @@ class Structure(Model, StructureData):
     def _atomspec_filter_chain(self, atoms, num_atoms, parts, attrs):
         # print("Structure._atomspec_filter_chain", num_atoms, parts, attrs)
         import numpy
-        chain_ids = atoms.residues.chain_ids
-        if not parts:
-            selected = numpy.ones(num_atoms, dtype=numpy.bool_)
-        else:
-            selected = numpy.zeros(num_atoms, dtype=numpy.bool_)
-            for part in parts:
-                choose = part.string_matcher(self.lower_case_chains)
-                s = numpy.vectorize(choose)(chain_ids)
-                selected = numpy.logical_or(selected, s)
+        # Chain attributes are tested in Python below.
+        selected, python_attrs = _atomspec_native_filter('/', atoms, parts, [],
+                                                         self.lower_case_chains)
         if attrs:
             chains = self.chains
             chain_selected = numpy.ones(len(chains), dtype=numpy.bool_)
@@ -959,96 +1037,134 @@ class Structure(Model, StructureData):
 
     def _atomspec_filter_residue(self, atoms, num_atoms, parts, attrs):
         # print("Structure._atomspec_filter_residue", num_atoms, parts, attrs)
-        import numpy
-        if not parts:
-            # No residue specifier, choose everything
-            selected = numpy.ones(num_atoms, dtype=numpy.bool_)
-        else:
-            res_names = numpy.array(atoms.residues.names)
-            res_numbers = atoms.residues.numbers
-            res_ics = atoms.residues.insertion_codes
-            selected = numpy.zeros(num_atoms, dtype=numpy.bool_)
-            for part in parts:
-                choose_id = part.res_id_matcher()
-                if choose_id:
-                    s = numpy.vectorize(choose_id)(res_numbers, res_ics)
-                    if s.any():
-                        selected = numpy.logical_or(selected, s)
-                    else:
-                        choose_id = None
-                        # Try using input as name instead of number
-                if not choose_id:
-                    choose_type = part.string_matcher(False)
-                    s = numpy.vectorize(choose_type)(res_names)
-                    selected = numpy.logical_or(selected, s)
-        if attrs:
-            selected = self._atomspec_attr_filter(atoms.residues, selected, attrs)
+        selected, python_attrs = _atomspec_native_filter(':', atoms, parts, attrs)
+        if python_attrs:
+            selected = self._atomspec_attr_filter(atoms.residues, selected, python_attrs)
         # print("AtomicStructure._atomspec_filter_residue", selected)
         return selected
 
     def _atomspec_filter_atom(self, atoms, num_atoms, parts, attrs):
         # print("Structure._atomspec_filter_atom", num_atoms, parts, attrs)
-        import numpy
-        if not parts:
-            # No name specifier, use everything
-            selected = numpy.ones(num_atoms, dtype=numpy.bool_)
-        else:
-            names = numpy.array(atoms.names)
-            selected = numpy.zeros(num_atoms, dtype=numpy.bool_)
-            for part in parts:
-                choose = part.string_matcher(False)
-                s = numpy.vectorize(choose)(names)
-                selected = numpy.logical_or(selected, s)
-        if attrs:
-            selected = self._atomspec_attr_filter(atoms, selected, attrs)
+        selected, python_attrs = _atomspec_native_filter('@', atoms, parts, attrs)
+        if python_attrs:
+            selected = self._atomspec_attr_filter(atoms, selected, python_attrs)
         # print("AtomicStructure._atomspec_filter_atom", selected)
         return selected
 
     def atomspec_zone(self, session, coords, distance, target_type, operator, results):
-        from chimerax.geometry import find_close_points
-        atoms = self.atoms
-        a, _ = find_close_points(atoms.scene_coords, coords, distance)
-        def not_a():
-            from numpy import ones, bool_
-            mask = ones(len(atoms), dtype=bool_)
-            mask[a] = False
-            return mask
-        expand_by = None
-        if target_type == '@':
-            if '<' in operator:
-                expand_by = atoms.filter(a)
-            else:
-                expand_by = atoms.filter(not_a())
-        elif target_type == ':':
-            if '<' in operator:
-                expand_by = atoms.filter(a).unique_residues.atoms
-            else:
-                expand_by = atoms.filter(not_a()).full_residues.atoms
-        elif target_type == '/':
-            # There is no "full_chain" property for atoms so we have
-            # to do it the hard way
-            from numpy import in1d, invert
-            matched_chain_ids = atoms.filter(a).unique_chain_ids
-            mask = in1d(atoms.chain_ids, matched_chain_ids)
-            if '<' in operator:
-                expand_by = atoms.filter(mask)
-            else:
-                expand_by = atoms.filter(invert(mask))
-        elif target_type == '#':
-            if '<' in operator:
-                expand_by = atoms.filter(a).unique_structures.atoms
-            else:
-                expand_by = atoms.filter(not_a()).full_structures.atoms
-        if expand_by:
-            results.add_atoms(expand_by)
-            results.add_model(self)
+        self.atomspec_zones(session, [self], coords, distance, target_type, operator, results)
+
+    @classmethod
+    def atomspec_zones(cls, session, structures, coords, distance, target_type, operator,
+                       results):
+        # Zones of all structures are found in one C++ call.
+        if target_type not in ('@', ':', '/', '#'):
+            return
+        masks = zone_masks(structures, coords, distance, target_type, '>' in operator)
+        for s, (atom_mask, residue_mask) in zip(structures, masks):
+            if atom_mask.any():
+                results.add_atoms(s.atoms.filter(atom_mask))
+                results.add_model(s)
+
+
+def zone_masks(structures, points, distance, level = '@', beyond = False):
+    """
+    Find atoms of each structure within distance of any of the scene coordinate
+    points, using a cell list cached by each structure.  Level ':' expands the
+    zone to whole residues, '/' to whole chains and '#' to whole structures.
+    With beyond true the zone is the atoms farther than distance, expanded
+    to residues or structures with such an atom, or chains without any atom
+    within distance.  Returns a list of (atom mask, residue mask) bool arrays
+    per structure, in the order of the structure's atoms and residues.
+    """
+    from numpy import array, empty, float64, ascontiguousarray
+    n = len(structures)
+    positions = empty((n, 3, 4), float64)
+    for i, s in enumerate(structures):
+        positions[i] = s.scene_position.matrix
+    from .molc import cptr, pointer
+    sptrs = array([s._c_pointer.value for s in structures], cptr)
+    xyz = ascontiguousarray(points, float64).reshape((-1, 3))
+    import ctypes
+    from .molobject import c_function
+    f = c_function('structure_zone_masks',
+                   args = [ctypes.c_void_p, ctypes.c_size_t, ctypes.c_void_p, ctypes.c_void_p,
+                           ctypes.c_size_t, ctypes.c_double, ctypes.c_char, ctypes.c_bool],
+                   ret = ctypes.py_object)
+    return f(pointer(sptrs), n, pointer(positions), pointer(xyz), len(xyz), distance,
+             level.encode(), beyond)
+
+def _atomspec_native_filter(level, atoms, parts, attrs, case_sensitive=False):
+    """
+    Mask of atoms matching any of the chain, residue or atom parts and all
+    the attribute tests, computed in C++ without making an object per atom.
+    Returns the mask and the attribute tests C++ does not handle, such as
+    custom attributes, to be done in Python.
+    """
+    import numpy
+    mask = numpy.empty(len(atoms), dtype=numpy.bool_)
+    if level == ':':
+        cparts = [(p.start, p.end, p.res_id_range()) for p in parts]
+    else:
+        cparts = [(p.start, p.end) for p in parts]
+    import operator
+    op_names = {operator.truth: 'truth', operator.not_: 'not', operator.eq: '=',
+                operator.ne: '!=', operator.ge: '>=', operator.gt: '>',
+                operator.le: '<=', operator.lt: '<'}
+    cattrs = [(a.name, op_names.get(a.op, a.op), a.value) for a in attrs]
+    import ctypes
+    from .molobject import c_function
+    from .molc import pointer
+    f = c_function('atom_spec_filter',
+                   args = [ctypes.c_void_p, ctypes.c_size_t, ctypes.c_char, ctypes.py_object,
+                           ctypes.py_object, ctypes.c_bool, ctypes.c_void_p],
+                   ret = ctypes.py_object)
+    python_tests = f(atoms._c_pointers, len(atoms), level.encode(), cparts, cattrs,
+                     case_sensitive, pointer(mask))
+    return mask, [attrs[i] for i in python_tests]
+
+def _ring_anchor(atoms):
+    # Picking the "best" orientation to show chair/boat configuration is hard
+    # so choose anchor the ring using atom nomenclature.
+    # Find index of atom with lowest element with lowest number (C1 < C6).
+    # Cheat and do lexicographical comparison of name.
+    choices = zip(atoms.elements.numbers, atoms.names, range(len(atoms)))
+    return min(choices)[2]
+
+
+class ResidueBeadsDrawing(Drawing):
+    '''
+    A sphere per residue drawn in place of the atoms of a huge structure
+    when atoms are too small on screen to make out.
+    '''
+
+    def __init__(self, name):
+        self.residues = None
+        super().__init__(name)
+
+    def first_intercept(self, mxyz1, mxyz2, exclude=None):
+        if not self.display or self.residues is None or (exclude and exclude(self)):
+            return None
+        if len(self.residues) < len(self.positions):
+            # Some residues were deleted since the beads were made.
+            return None
+        xyzr = self.positions.shift_and_scale_array()
+        from chimerax import geometry
+        fmin, rnum = geometry.closest_sphere_intercept(xyzr[:,:3], xyzr[:,3], mxyz1, mxyz2)
+        if fmin is None:
+            return None
+        return PickedResidue(self.residues[rnum], fmin)
 
+# -----------------------------------------------------------------------------
+#
 class AtomsDrawing(Drawing):
     # can't have any child drawings
     # requires self.parent._atom_display_radii()
 
     def __init__(self, name):
         self.visible_atoms = None
+        self.visible_mask = None	# visible_atoms as a mask of all structure atoms
+        self._sphere_tree = None	# (positions, tree) for picking many atoms
         super().__init__(name)
 
     def bounds(self):
@@ -1077,6 +1193,7 @@ class AtomsDrawing(Drawing):
     def add_drawing(self, d):
         raise NotImplemented("AtomsDrawing may not have children")
 
+    _sphere_tree_min_atoms = 20000
     def first_intercept(self, mxyz1, mxyz2, exclude=None):
         if not self.display or self.visible_atoms is None or (exclude and exclude(self)):
             return None
@@ -1085,12 +1202,21 @@ class AtomsDrawing(Drawing):
             # Some atoms were deleted since the last time the graphics was drawn.
             return None
 
-        xyzr = self.positions.shift_and_scale_array()
-        coords, radii = xyzr[:,:3], xyzr[:,3]
-
         # Check for atom sphere intercept
         from chimerax import geometry
-        fmin, anum = geometry.closest_sphere_intercept(coords, radii, mxyz1, mxyz2)
+        positions = self.positions
+        if len(positions) >= self._sphere_tree_min_atoms:
+            # Keep a bounding box tree until the atoms move or change radius.
+            st = self._sphere_tree
+            if st is None or st[0] is not positions:
+                xyzr = positions.shift_and_scale_array()
+                st = self._sphere_tree = (positions,
+                                          geometry.sphere_intercept_tree(xyzr[:,:3], xyzr[:,3]))
+            fmin, anum = geometry.closest_tree_intercept(st[1], mxyz1, mxyz2)
+        else:
+            xyzr = positions.shift_and_scale_array()
+            coords, radii = xyzr[:,:3], xyzr[:,3]
+            fmin, anum = geometry.closest_sphere_intercept(coords, radii, mxyz1, mxyz2)
         if fmin is None:
             return None
 
@@ -1317,11 +1443,12 @@ class AtomicStructure(Structure):
             # 10 residues or less is basically a trivial depiction if ribboned
             if explicit_style or MIN_RIBBON_THRESHOLD < len(ribbonable):
                 atoms.displays = False
-                ligand = atoms.filter(atoms.structure_categories == "ligand").residues
+                cats = atoms.structure_category_codes
+                ligand = atoms.filter(cats == atoms.CAT_LIGAND).residues
                 ribbonable -= ligand
                 metal_atoms = atoms.filter(atoms.elements.is_metal)
                 metal_atoms.draw_modes = Atom.SPHERE_STYLE
-                ions = atoms.filter(atoms.structure_categories == "ions")
+                ions = atoms.filter(cats == atoms.CAT_IONS)
                 lone_ions = ions.filter(ions.residues.num_atoms == 1)
                 lone_ions.draw_modes = Atom.SPHERE_STYLE
                 ligand |= metal_atoms.residues
@@ -1340,7 +1467,7 @@ class AtomicStructure(Structure):
                 if ligand:
                     # show residues interacting with ligand
                     lig_points = ligand.atoms.coords
-                    mol_points = atoms.coords
+                    mol_points = self.atoms_coords()
                     from chimerax.geometry import find_close_points
                     close_indices = find_close_points(lig_points, mol_points, 3.6)[1]
                     display |= atoms.filter(close_indices).residues
@@ -1366,10 +1493,11 @@ class AtomicStructure(Structure):
             residues.ribbon_colors = residues.ring_colors = rcolors
             atoms.colors = acolors
             from .molobject import Atom
-            ligand_atoms = atoms.filter(atoms.structure_categories == "ligand")
+            cats = atoms.structure_category_codes
+            ligand_atoms = atoms.filter(cats == atoms.CAT_LIGAND)
             ligand_atoms.draw_modes = Atom.STICK_STYLE
             ligand_atoms.colors = element_colors(ligand_atoms.element_numbers)
-            solvent_atoms = atoms.filter(atoms.structure_categories == "solvent")
+            solvent_atoms = atoms.filter(cats == atoms.CAT_SOLVENT)
             solvent_atoms.draw_modes = Atom.BALL_STYLE
             solvent_atoms.colors = element_colors(solvent_atoms.element_numbers)
         else:
@@ -1855,6 +1983,7 @@ class StructureGraphicsChangeManager:
         self._handler = t.add_handler('graphics update', self._update_graphics_if_needed)
         self._structures = set()
         self._structures_array = None		# StructureDatas object
+        self._residue_bead_structures = None	# Structures big enough for beads
         self.num_atoms_shown = 0
         self.level_of_detail = LevelOfDetail()
         from chimerax.core.models import MODEL_DISPLAY_CHANGED
@@ -1872,11 +2001,13 @@ class StructureGraphicsChangeManager:
     def add_structure(self, s):
         self._structures.add(s)
         self._structures_array = None
+        self._residue_bead_structures = None
         self.num_atoms_shown = 0	# Make sure new structure gets a level of detail update
 
     def remove_structure(self, s):
         self._structures.remove(s)
         self._structures_array = None
+        self._residue_bead_structures = None
 
     def _model_display_changed(self, tname, model):
         if isinstance(model, Structure) or _has_structure_descendant(model):
@@ -1897,9 +2028,12 @@ class StructureGraphicsChangeManager:
                 if n > 0 and n != self.num_atoms_shown:
                     self.num_atoms_shown = n
                     self.update_level_of_detail()
+                self._residue_bead_structures = None
 
             self._model_display_change = False
 
+        self._update_residue_beads()
+
         # set by changes.py when "selected changed" is in the global Atom reasons,
         # which is the easiest way to detect that there was a selection in a
         # deleted structure; also set by non-atomic models
@@ -1908,6 +2042,31 @@ class StructureGraphicsChangeManager:
             from chimerax.core.selection import SELECTION_CHANGED
             self.session.triggers.activate_trigger(SELECTION_CHANGED, None)
 
+    def _update_residue_beads(self):
+        # Switch huge structures between atoms and residue beads depending
+        # on the size of atoms on screen, checked every frame since it
+        # changes with zooming.
+        lod = self.level_of_detail
+        bs = self._residue_bead_structures
+        if bs is None:
+            self._residue_bead_structures = bs = [
+                m for m in self._structures
+                if m._residue_beads_drawing is not None
+                or m.num_atoms_visible >= lod.residue_beads_min_atoms]
+        if not bs:
+            return
+        view = self.session.main_view
+        for m in bs:
+            if m.deleted:
+                continue
+            show = False
+            if (lod.residue_beads and m.visible
+                and m.num_atoms_visible >= lod.residue_beads_min_atoms):
+                b = m.bounds()
+                if b is not None:
+                    show = lod.atom_pixels(view.pixel_size(b.center())) < lod.residue_beads_atom_pixels
+            m._show_residue_beads(show)
+
     def update_level_of_detail(self):
         n = self.num_atoms_shown
         for m in self._structures:
@@ -1969,6 +2128,7 @@ class LevelOfDetail(State):
         self._atom_max_total_triangles = 5000000
         self._step_factor = 1.2
         self.atom_fixed_triangles = None	# If not None use fixed number of triangles
+        self.atom_sphere_impostors = False	# Ray cast spheres in shader instead of triangles
         self._sphere_geometries = {}	# Map ntri to (va,na,ta)
 
         # Number of triangles used for a bond cylinder.
@@ -1982,6 +2142,13 @@ class LevelOfDetail(State):
         # Number of cylinder sides for pseudobonds
         self._pseudobond_sides = 10
         
+        # Structures with many atoms shown are drawn with a sphere per residue
+        # when atom spheres would be smaller than this many pixels across.
+        self.residue_beads = True
+        self.residue_beads_min_atoms = 1000000
+        self.residue_beads_atom_pixels = 1.0
+        self._atom_diameter = 3.0		# Typical atom sphere diameter
+
         # Number of bands between two residues along the length of a ribbon.
         self._ribbon_min_divisions = 2
         self._ribbon_max_divisions = 20
@@ -2016,12 +2183,25 @@ class LevelOfDetail(State):
         lod.quality = data['quality']
         return lod
 
+    def atom_pixels(self, pixel_size):
+        '''Typical atom sphere diameter in pixels for a given pixel size.'''
+        return self._atom_diameter / pixel_size if pixel_size > 0 else 0
+
     def set_atom_sphere_geometry(self, drawing, natoms = None):
         if natoms == 0:
             return
+        impostors = self.atom_sphere_impostors
+        switch = (impostors != drawing.sphere_impostors)
+        if switch:
+            drawing.sphere_impostors = impostors
+        if impostors:
+            if switch:
+                va, na, ta = self.sphere_impostor_geometry()
+                drawing.set_geometry(va, na, ta)
+            return
         ntri = self.atom_sphere_triangles(natoms)
         ta = drawing.triangles
-        if ta is None or len(ta) != ntri:
+        if ta is None or len(ta) != ntri or switch:
             # Update instanced sphere triangulation
             w = len(ta) if ta is not None else 0
             va, na, ta = self.sphere_geometry(ntri)
@@ -2036,6 +2216,15 @@ class LevelOfDetail(State):
             sg[ntri] = (va,va,ta)
         return sg[ntri]
 
+    def sphere_impostor_geometry(self):
+        # Square the graphics turns to face the camera and ray casts a sphere on.
+        # The shader only uses x and y, z makes the bounds those of the sphere.
+        from numpy import array, float32, int32
+        va = array(((-1,-1,-1),(1,-1,-1),(1,1,1),(-1,1,1)), float32)
+        na = array(((0,0,1),)*4, float32)
+        ta = array(((0,1,2),(0,2,3)), int32)
+        return va, na, ta
+
     def atom_sphere_triangles(self, natoms):
         aft = self.atom_fixed_triangles
         if aft is not None:
@@ -2137,11 +2326,22 @@ class PromoteAtomSelection(SelectionPromotion):
 # -----------------------------------------------------------------------------
 #
 class PickedAtom(Pick):
+    copy_number = None		# Set when the structure has several positions
     def __init__(self, atom, distance):
         Pick.__init__(self, distance)
         self.atom = atom
     def description(self):
+        if self.copy_number is not None and len(self.atom.structure.positions) > 1:
+            return '%s copy %d' % (str(self.atom), self.copy_number + 1)
         return str(self.atom)
+    @property
+    def scene_coord(self):
+        '''Scene coordinates of the picked atom in the picked copy.'''
+        if self.copy_number is None:
+            return self.atom.scene_coord
+        from .molarray import Atoms
+        return self.atom.structure.instance_scene_coords(self.copy_number,
+                                                         Atoms([self.atom]))[0]
     def specifier(self):
         # have to do something fancy for the rare case of duplicate atom specs [#4617]
         residues = self.atom.structure.residues
@@ -2252,9 +2452,13 @@ def _bonds_planes_pick(drawing, planes):
     if drawing is None or not drawing.display:
         return None
 
-    hb_xyz = drawing.positions.array()[:,:,3]	# Half-bond centers
-    n = len(hb_xyz)//2
-    xyz = 0.5*(hb_xyz[:n] + hb_xyz[n:])	# Bond centers
+    hc = drawing.positions.halfbond_cylinder_array()
+    if hc is not None:
+        xyz = 0.5*(hc[:,0:3] + hc[:,4:7])	# Bond centers
+    else:
+        hb_xyz = drawing.positions.array()[:,:,3]	# Half-bond centers
+        n = len(hb_xyz)//2
+        xyz = 0.5*(hb_xyz[:n] + hb_xyz[n:])	# Bond centers
     from chimerax import geometry
     pmask = geometry.points_within_planes(xyz, planes)
     return pmask
@@ -2389,11 +2593,14 @@ class PickedResidues(Pick):
 # -----------------------------------------------------------------------------
 # Return 4x4 matrices taking one prototype cylinder to each bond location.
 #
-def _bond_cylinder_placements(axyz0, axyz1, radii):
+def _bond_cylinder_placements(axyz0, axyz1, radii, parray = None):
 
   n = len(axyz0)
-  from numpy import empty, float32
-  p = empty((n,4,4), float32)
+  if parray is None or len(parray) != n:
+      from numpy import empty, float32
+      p = empty((n,4,4), float32)
+  else:
+      p = parray
 
   from chimerax.geometry import cylinder_rotations
   cylinder_rotations(axyz0, axyz1, radii, p)
@@ -2424,6 +2631,24 @@ def _halfbond_cylinder_placements(axyz0, axyz1, radii, parray = None):
 
   return pl
 
+# -----------------------------------------------------------------------------
+# Return Places for halfbond cylinders in the compact end points and radius
+# form that graphics expands into two placements per bond.
+#
+def _halfbond_cylinders(axyz0, axyz1, radii, array = None):
+
+  n = len(axyz0)
+  if array is None or len(array) != n:
+      from numpy import empty, float32
+      array = empty((n,8), float32)
+  array[:,0:3] = axyz0
+  array[:,3] = radii
+  array[:,4:7] = axyz1
+  array[:,7] = 3
+
+  from chimerax.geometry import Places
+  return Places(halfbond_cylinders = array)
+
 # -----------------------------------------------------------------------------
 # Return height, radius, rotation, and translation for each halfbond cylinder.
 # Each row is [height, radius, *rotationAxis, rotationAngle, *translation]
@@ -58,6 +58,8 @@ Atom::Atom(Structure* as, const char* name, const Element& e):
 {
     change_tracker()->add_created(structure(), this);
     structure()->_structure_cats_dirty = true;
+    structure()->coords_changed();
+    structure()->display_state_changed();
 }
 
 Atom::~Atom()
@@ -72,6 +74,8 @@ Atom::~Atom()
       _ribbon_coord = nullptr;
     }
     DestructionUser(this);
+    structure()->coords_changed();
+    structure()->display_state_changed();
     if (selected()) {
         // so that closing a structure can fire "selection changed" trigger
         change_tracker()->add_modified(nullptr, this, ChangeTracker::REASON_SELECTED);
@@ -163,6 +167,7 @@ Atom::clean_alt_locs()
 
     _alt_loc = ' ';
     _alt_loc_map.clear();
+    structure()->coords_changed();
 }
 
 void
@@ -171,7 +176,7 @@ Atom::clear_aniso_u()
     if (_alt_loc != ' ') {
         _Alt_loc_map::iterator i = _alt_loc_map.find(_alt_loc);
         assert(i != _alt_loc_map.end());
-        if ((*i).second.aniso_u.use_count() > 0) {
+        if ((*i).second.aniso_u) {
             (*i).second.aniso_u.reset();
             change_tracker()->add_modified(structure(), this, ChangeTracker::REASON_ANISO_U);
         }
@@ -189,11 +194,11 @@ Atom::_coordset_set_coord(const Point &coord, CoordSet *cs, bool track_change)
         structure()->set_active_coord_set(cs);
     if (_coord_index == COORD_UNASSIGNED)
         _coord_index = _new_coord(coord);
-    else if (_coord_index >= cs->coords().size()) {
-        if (_coord_index > cs->coords().size()) {
+    else if (_coord_index >= cs->coords_size()) {
+        if (_coord_index > cs->coords_size()) {
             CoordSet *fill_cs = cs;
             while (fill_cs != nullptr) {
-                while (_coord_index > fill_cs->coords().size()) {
+                while (_coord_index > fill_cs->coords_size()) {
                     fill_cs->add_coord(Point());
                 }
                 fill_cs = structure()->find_coord_set(fill_cs->id()-1);
@@ -206,7 +211,7 @@ Atom::_coordset_set_coord(const Point &coord, CoordSet *cs, bool track_change)
         graphics_changes()->set_gc_ring();
     } else {
         //cs->_coords[_coord_index] = coord;
-        cs->_coords[_coord_index].set_xyz(coord[0], coord[1], coord[2]);
+        cs->_writable_coords()[_coord_index].set_xyz(coord[0], coord[1], coord[2]);
         if (track_change) {
             graphics_changes()->set_gc_shape();
             if (in_ribbon())
@@ -228,10 +233,10 @@ Atom::_new_coord(const Point &coord)
     for (auto csi = css.begin(); csi != css.end(); ++csi) {
         CoordSet *cs = *csi;
         if (index == COORD_UNASSIGNED) {
-            index = cs->coords().size();
+            index = cs->coords_size();
             cs->add_coord(coord);
         } else
-            while (index >= cs->coords().size())
+            while (index >= cs->coords_size())
                 cs->add_coord(coord);
     }
     return index;
@@ -905,6 +910,7 @@ Atom::delete_alt_loc(char al)
         } else {
             _alt_loc = (*_alt_loc_map.begin()).first;
         }
+        structure()->coords_changed();
         if (structure()->alt_loc_change_notify())
             graphics_changes()->set_gc_shape();
     }
@@ -1183,7 +1189,8 @@ Atom::session_num_floats(int version) const
 }
 
 void
-Atom::session_restore(int version, int** ints, float** floats, PyObject* misc)
+Atom::session_restore(int version, int** ints, float** floats, PyObject* misc,
+    const std::vector<AtomType>* idatm_types)
 {
     using pysupport::pystring_to_cchar;
 
@@ -1199,18 +1206,30 @@ Atom::session_restore(int version, int** ints, float** floats, PyObject* misc)
     _display = int_ptr[7];
     _hide = int_ptr[8];
     _selected = int_ptr[9];
+    if (version >= 20) {
+        if (idatm_types == nullptr)
+            throw std::invalid_argument("No IDATM type table for atom session info");
+        auto num_types = (int)idatm_types->size();
+        if (int_ptr[10] < 0 || int_ptr[10] >= num_types
+        || int_ptr[11] < 0 || int_ptr[11] >= num_types)
+            throw std::invalid_argument("Atom IDATM type index out of range");
+        _computed_idatm_type = (*idatm_types)[int_ptr[10]];
+        _explicit_idatm_type = (*idatm_types)[int_ptr[11]];
+    }
     int_ptr += SESSION_NUM_INTS(version);
 
     auto& float_ptr = *floats;
     _radius = float_ptr[0];
     float_ptr += SESSION_NUM_FLOATS(version);
 
-    if (!(PyTuple_Check(misc) || PyList_Check(misc)))
-        throw std::invalid_argument("Atom misc info is not a tuple");
-    if (PySequence_Fast_GET_SIZE(misc) != 2)
-        throw std::invalid_argument("Atom misc info wrong size");
-    _computed_idatm_type = pystring_to_cchar(PySequence_Fast_GET_ITEM(misc, 0), "computed IDATM type");
-    _explicit_idatm_type = pystring_to_cchar(PySequence_Fast_GET_ITEM(misc, 1), "explicit IDATM type");
+    if (version < 20) {
+        if (!(PyTuple_Check(misc) || PyList_Check(misc)))
+            throw std::invalid_argument("Atom misc info is not a tuple");
+        if (PySequence_Fast_GET_SIZE(misc) != 2)
+            throw std::invalid_argument("Atom misc info wrong size");
+        _computed_idatm_type = pystring_to_cchar(PySequence_Fast_GET_ITEM(misc, 0), "computed IDATM type");
+        _explicit_idatm_type = pystring_to_cchar(PySequence_Fast_GET_ITEM(misc, 1), "explicit IDATM type");
+    }
 
     if (aniso_u_size > 0) {
         _aniso_u = new std::vector<float>();
@@ -1237,19 +1256,18 @@ Atom::session_restore(int version, int** ints, float** floats, PyObject* misc)
         float_ptr += SESSION_ALTLOC_FLOATS(version);
 
         if (aniso_u_size > 0) {
-            info.aniso_u = std::make_shared<std::vector<float>>();
-            info.aniso_u.get()->reserve(aniso_u_size);
+            info.aniso_u.reset(new std::vector<float>());
+            info.aniso_u->reserve(aniso_u_size);
             for (decltype(aniso_u_size) j = 0; j < aniso_u_size; ++j)
                 info.aniso_u->push_back(*float_ptr++);
-        } else {
-            info.aniso_u = nullptr;
         }
-        _alt_loc_map[alt_loc] = info;
+        _alt_loc_map[alt_loc] = std::move(info);
     }
 }
 
 void
-Atom::session_save(int** ints, float** floats, PyObject* misc) const
+Atom::session_save(int** ints, float** floats,
+    const std::map<AtomType, int>& idatm_type_indices) const
 {
     color().session_save(ints, floats);
     auto& int_ptr = *ints;
@@ -1263,22 +1281,14 @@ Atom::session_save(int** ints, float** floats, PyObject* misc) const
     int_ptr[7] = (int)_display;
     int_ptr[8] = (int)_hide;
     int_ptr[9] = (int)_selected;
+    int_ptr[10] = idatm_type_indices.at(_computed_idatm_type);
+    int_ptr[11] = idatm_type_indices.at(_explicit_idatm_type);
     int_ptr += SESSION_NUM_INTS();
 
     auto& float_ptr = *floats;
     float_ptr[0] = _radius;
     float_ptr += SESSION_NUM_FLOATS();
 
-    using pysupport::cchar_to_pystring;
-    auto py_comp_type = cchar_to_pystring(_computed_idatm_type, "computed IDATM type");
-    if (PyList_Append(misc, py_comp_type) < 0)
-        throw std::runtime_error("Cannot append computed atom type to misc list");
-    Py_DECREF(py_comp_type);
-    auto py_explicit_type = cchar_to_pystring(_explicit_idatm_type, "explicit IDATM type");
-    if (PyList_Append(misc, py_explicit_type) < 0)
-        throw std::runtime_error("Cannot append explicit atom type to misc list");
-    Py_DECREF(py_explicit_type);
-
     if (_aniso_u != nullptr) {
         for (auto v: *_aniso_u) {
             *float_ptr = v;
@@ -1355,6 +1365,7 @@ Atom::set_alt_loc(char alt_loc, bool create, bool _from_residue)
         _Alt_loc_info &info = (*i).second;
         _serial_number = info.serial_number;
         _alt_loc = alt_loc;
+        structure()->coords_changed();
         if (structure()->alt_loc_change_notify()) {
             change_tracker()->add_modified(structure(), this, ChangeTracker::REASON_COORD);
             structure()->change_tracker()->add_modified(structure(), structure(),
@@ -1403,6 +1414,7 @@ Atom::set_color(const Rgba& rgba)
 {
     if (rgba == _rgba)
         return;
+    structure()->display_state_changed();
     graphics_changes()->set_gc_color();
     // Don't include color change in modified list for speed with large structures, ticket #3000.
     change_tracker()->add_modified(structure(), static_cast<Atom*>(nullptr),
@@ -1413,6 +1425,7 @@ Atom::set_color(const Rgba& rgba)
 void
 Atom::set_coord(const Coord& coord, CoordSet* cs, bool track_change)
 {
+    structure()->coords_changed();
     if (track_change) {
         change_tracker()->add_modified(structure(), this, ChangeTracker::REASON_COORD);
         if (structure()->active_coord_set() == cs)
@@ -1447,7 +1460,7 @@ Atom::set_coord_index(unsigned int ci)
     auto cs = structure()->active_coord_set();
     if (cs == nullptr)
         throw std::logic_error("Cannot assign coordinate index with no coordinate sets");
-    if (cs->coords().size() <= ci)
+    if (cs->coords_size() <= ci)
         throw std::logic_error("Coordinate index larger than coordinate set");
     _coord_index = ci;
 }
@@ -1457,6 +1470,7 @@ Atom::set_display(bool d)
 {
     if (d == _display)
         return;
+    structure()->display_state_changed();
     graphics_changes()->set_gc_shape();
     graphics_changes()->set_gc_display();
     graphics_changes()->set_gc_ring();
@@ -1471,6 +1485,7 @@ Atom::set_draw_mode(DrawMode dm)
 {
     if (dm == _draw_mode)
         return;
+    structure()->display_state_changed();
     graphics_changes()->set_gc_shape();
     graphics_changes()->set_gc_display();	// Sphere style can effect if bonds are shown.
     graphics_changes()->set_gc_ring();
@@ -1483,6 +1498,7 @@ Atom::set_hide(int h)
 {
     if (h == _hide)
         return;
+    structure()->display_state_changed();
     graphics_changes()->set_gc_shape();
     graphics_changes()->set_gc_display();
     graphics_changes()->set_gc_ring();
@@ -1537,6 +1553,7 @@ Atom::set_selected(bool s)
 {
     if (s == _selected)
         return;
+    structure()->display_state_changed();
     graphics_changes()->set_gc_select();
     change_tracker()->add_modified(structure(), this, ChangeTracker::REASON_SELECTED);
     _selected = s;
@@ -28,6 +28,7 @@
 #define atomstruct_Atom
 
 #include <algorithm>  // std::find
+#include <cstdint>
 #include <cstring>
 #include <element/Element.h>
 #include <map>
@@ -42,6 +43,7 @@
 #include "ChangeTracker.h"
 #include "Coord.h"
 #include "imex.h"
+#include "ObjectPool.h"
 #include "Point.h"
 #include "Rgba.h"
 #include "session.h"
@@ -89,9 +91,12 @@ public:
     typedef std::map<AtomType, IdatmInfo> IdatmInfoMap;
     typedef std::vector<Atom*>  Neighbors;
     typedef std::vector<const Ring*>  Rings;
-    enum class StructCat { Unassigned, Main, Ligand, Ions, Solvent };
+    // one byte per atom; molc returns these values as a uint8 array
+    enum class StructCat : uint8_t { Unassigned, Main, Ligand, Ions, Solvent };
 
-    static int  SESSION_NUM_INTS(int /*version*/=CURRENT_SESSION_VERSION) { return 10; };
+    static int  SESSION_NUM_INTS(int version=CURRENT_SESSION_VERSION) {
+        return version < 20 ? 10 : 12;
+    };
     static int  SESSION_NUM_FLOATS(int /*version*/=CURRENT_SESSION_VERSION) { return 1; };
     static int  SESSION_ALTLOC_INTS(int /*version*/=CURRENT_SESSION_VERSION) { return 3; };
     static int  SESSION_ALTLOC_FLOATS(int /*version*/=CURRENT_SESSION_VERSION) { return 5; };
@@ -99,28 +104,78 @@ private:
     static const unsigned int  COORD_UNASSIGNED = ~0u;
     Atom(Structure *as, const char* name, const Element& e);
     virtual ~Atom();
+    // allocated from the structure's ObjectPool
+    static void*  operator new(std::size_t size) { return ObjectPool::allocate(nullptr, size); }
+    static void*  operator new(std::size_t size, ObjectPool* pool)
+        { return ObjectPool::allocate(pool, size); }
+    static void  operator delete(void* p) { ObjectPool::deallocate(p); }
+    static void  operator delete(void* p, ObjectPool*) { ObjectPool::deallocate(p); }
 
     char  _alt_loc;
     class _Alt_loc_info {
       public:
         _Alt_loc_info() : bfactor(0.0), serial_number(0) {}
-        ~_Alt_loc_info() { }
 
         std::vector<float> *create_aniso_u() {
-            if (aniso_u.get() == nullptr) {
-                aniso_u = std::make_shared<std::vector<float>>();
-                aniso_u.get()->resize(6);
-            }
+            if (aniso_u.get() == nullptr)
+                aniso_u.reset(new std::vector<float>(6));
             return aniso_u.get();
         }
 
-        std::shared_ptr<std::vector<float>>  aniso_u;
+        std::unique_ptr<std::vector<float>>  aniso_u;
         float  bfactor;
         Point  coord;
         float  occupancy;
         int  serial_number;
     };
-    typedef std::map<unsigned char, _Alt_loc_info>  _Alt_loc_map;
+    // An atom has few alt locs, so they are kept sorted in one vector
+    // rather than a tree with a separate allocation for each alt loc.
+    // Only the parts of the std::map interface that atoms use are provided.
+    class _Alt_loc_map {
+      public:
+        typedef unsigned char  key_type;
+        typedef std::pair<key_type, _Alt_loc_info>  value_type;
+        typedef std::vector<value_type>::iterator  iterator;
+        typedef std::vector<value_type>::const_iterator  const_iterator;
+
+        iterator  begin() { return _entries.begin(); }
+        iterator  end() { return _entries.end(); }
+        const_iterator  begin() const { return _entries.begin(); }
+        const_iterator  end() const { return _entries.end(); }
+        bool  empty() const { return _entries.empty(); }
+        size_t  size() const { return _entries.size(); }
+        size_t  bytes() const { return _entries.capacity() * sizeof(value_type); }
+        void  clear() { std::vector<value_type>().swap(_entries); }
+        void  erase(iterator i) { _entries.erase(i); }
+        iterator  find(key_type al) {
+            auto i = _lower_bound(al);
+            return (i != _entries.end() && i->first == al) ? i : _entries.end();
+        }
+        const_iterator  find(key_type al) const {
+            auto i = const_cast<_Alt_loc_map*>(this)->_lower_bound(al);
+            return (i != _entries.end() && i->first == al) ? i : _entries.end();
+        }
+        _Alt_loc_info&  operator[](key_type al) {
+            auto i = _lower_bound(al);
+            if (i == _entries.end() || i->first != al)
+                i = _entries.emplace(i, al, _Alt_loc_info());
+            return i->second;
+        }
+        bool  same_keys(const _Alt_loc_map& other) const {
+            if (_entries.size() != other._entries.size())
+                return false;
+            for (size_t i = 0; i < _entries.size(); ++i)
+                if (_entries[i].first != other._entries[i].first)
+                    return false;
+            return true;
+        }
+      private:
+        std::vector<value_type>  _entries;
+        iterator  _lower_bound(key_type al) {
+            return std::lower_bound(_entries.begin(), _entries.end(), al,
+                [](const value_type& v, key_type k) { return v.first < k; });
+        }
+    };
     _Alt_loc_map  _alt_loc_map;
     std::vector<float>*  _aniso_u;
     Bonds  _bonds; // _bonds/_neighbors in same order
@@ -146,6 +201,7 @@ private:
     void  _set_structure_category(Atom::StructCat sc) const;
     Structure*  _structure;
     mutable StructCat  _structure_category;
+    mutable unsigned int  _structure_index = 0; // maintained by Structure::atom_index()
     void  _uncache_radius() const { if (_radius < 0.0) _radius = 0.0; }
 public:
     // so that I/O routines can cheaply "change their minds" about element
@@ -171,6 +227,7 @@ public:
     const Coord&  coord(const CoordSet* cs) const;
     const Coord&  coord(char alt_loc) const { return _alt_loc_map.find(alt_loc)->second.coord; }
     unsigned int  coord_index() const { return _coord_index; }
+    bool  has_coord_index() const { return _coord_index != COORD_UNASSIGNED; }
     int  coordination(int value_if_unknown) const;
     float  default_radius() const;
     void  delete_alt_loc(char al);
@@ -179,6 +236,9 @@ public:
     static const IdatmInfoMap&  get_idatm_info_map();
     bool  has_alt_loc(char al) const
       { return _alt_loc_map.find(al) != _alt_loc_map.end(); }
+    // Same as alt_locs() == a->alt_locs() without making sets.
+    bool  has_same_alt_locs(const Atom* a) const
+      { return _alt_loc_map.same_keys(a->_alt_loc_map); }
     bool  has_aniso_u() const { return aniso_u() != nullptr; }
     bool  has_aniso_u(char alt_loc) const { return aniso_u(alt_loc) != nullptr; }
     bool  has_missing_structure_pseudobond() const;
@@ -223,8 +283,12 @@ public:
             + _alt_loc_map.size() * SESSION_ALTLOC_INTS(version);
     }
     int  session_num_floats(int version=CURRENT_SESSION_VERSION) const;
-    void  session_restore(int version, int** ints, float** floats, PyObject* misc);
-    void  session_save(int** ints, float** floats, PyObject* misc) const;
+    // before version 20 the IDATM types are in 'misc', afterwards they are indices into
+    // a per-structure table of types, so that saving doesn't need Python objects per atom
+    void  session_restore(int version, int** ints, float** floats, PyObject* misc,
+        const std::vector<AtomType>* idatm_types = nullptr);
+    void  session_save(int** ints, float** floats,
+        const std::map<AtomType, int>& idatm_type_indices) const;
     void  set_alt_loc(char alt_loc, bool create=false, bool _from_residue=false);
     void  set_aniso_u(float u11, float u12, float u13, float u22, float u23, float u33);
     void  set_bfactor(float);
@@ -305,8 +369,10 @@ Atom::_set_structure_category(Atom::StructCat sc) const
 
 inline void
 Atom::set_computed_idatm_type(const char* it) {
-    if (structure()->_atom_types_notify && !idatm_is_explicit() && _computed_idatm_type != it) {
-        change_tracker()->add_modified(structure(), this, ChangeTracker::REASON_IDATM_TYPE);
+    if (!idatm_is_explicit() && _computed_idatm_type != it) {
+        if (structure()->_atom_types_notify)
+            change_tracker()->add_modified(structure(), this, ChangeTracker::REASON_IDATM_TYPE);
+        structure()->bond_graph_changed();
     }
     _computed_idatm_type =  it;
 }
@@ -317,6 +383,7 @@ Atom::set_element(const Element& e) {
     _element = &e;
     _uncache_radius();
     _structure->_idatm_valid = false;
+    _structure->bond_graph_changed();
 }
 
 inline void
@@ -328,6 +395,7 @@ Atom::set_idatm_type(const char* it) {
     && !(!_explicit_idatm_type.empty() && it == _explicit_idatm_type)) {
         change_tracker()->add_modified(structure(), this, ChangeTracker::REASON_IDATM_TYPE);
         structure()->set_idatm_valid(false);
+        structure()->bond_graph_changed();
     }
     _explicit_idatm_type = it;
 }
@@ -353,6 +421,7 @@ Atom::set_implicit_idatm_type(const char* it) {
         _explicit_idatm_type.clear();
     }
     _computed_idatm_type = it;
+    structure()->bond_graph_changed();
     change_tracker()->add_modified(structure(), this, ChangeTracker::REASON_IDATM_TYPE);
 }
 
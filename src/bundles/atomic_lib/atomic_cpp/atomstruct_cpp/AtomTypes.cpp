@@ -24,6 +24,9 @@
  * === UCSF ChimeraX Copyright ===
  */
 
+#include <algorithm>
+#include <arrays/threadpool.h>    // Uses Thread_Pool::thread_count(), run()
+#include <arrays/trace.h>  // Uses TRACE_SCOPE_ITEMS()
 #include <logger/logger.h>
 #include <map>
 #include <set>
@@ -39,6 +42,7 @@
 #include "PBGroup.h"
 #include "Residue.h"
 #include "tmpl/TAexcept.h"
+#include "tmpl/TemplateCache.h"
 
 namespace atomstruct {
 
@@ -461,12 +465,107 @@ aromatic_geometry(const Ring& r)
     return true;
 }
 
+// Fewest residues per thread for template typing to be done in parallel.
+static const size_t  MIN_THREAD_RESIDUES = 1000;
+
+void
+AtomicStructure::_template_type_residues(Residues::const_iterator start,
+    Residues::const_iterator end, std::vector<_TemplateTyping>::iterator typing)
+{
+    // Template typing of a residue depends only on its name, its atom names,
+    // and which of its atoms are bonded to other residues, so identical
+    // residues (in any structure) are typed from the first one's template lookup.
+    static tmpl::ResidueResultCache<_TemplateTypes> template_types;
+    for (auto ri = start; ri != end; ++ri, ++typing) {
+        Residue* r = *ri;
+        typing->templated = false;
+        typing->all_H = true;
+        try {
+            // Don't template-type residues with unexpected cross-residue 
+            // bonds (e.g. residues bonded to PTD in 3kch)
+
+            if (r->polymer_type() != PT_NONE) {
+                for (auto ra: r->atoms()) {
+                    if (ra->is_backbone(BBE_MIN))
+                        continue;
+                    for (auto nb: ra->neighbors()) {
+                        if (nb->residue() != ra->residue()) {
+                            // cysteine SG cross-residue bond okay...
+                            if (nb->name() == "SG" && ra->name() == "SG"
+                            && (nb->residue()->name() == "CYS" || nb->residue()->name() == "CYX")
+                            && (ra->residue()->name() == "CYS" || ra->residue()->name() == "CYX"))
+                                continue;
+                            throw tmpl::TA_NoTemplate("Non-standard cross-residue bond");
+                        }
+                    }
+                }
+            }
+            const Residue::Atoms& ratoms = r->atoms();
+            auto key = r->connectivity_key();
+            _TemplateTypes cached;
+            if (!template_types.find(key, &cached)) {
+                // untemplated atoms are given an empty type in the cache
+                cached.first = false;
+                try {
+                    auto untemplated_atoms = r->template_assign(
+                        &Atom::set_computed_idatm_type,
+                        "idatm", "templates", "idatmres");
+                    std::set<Atom*> untemplated(untemplated_atoms.begin(), untemplated_atoms.end());
+                    for (auto ra: ratoms)
+                        cached.second.push_back(untemplated.find(ra) == untemplated.end()
+                            ? ra->_computed_idatm_type : AtomType(""));
+                    cached.first = true;
+                    template_types.insert(key, cached);
+                } catch (tmpl::TA_NoTemplate&) {
+                    template_types.insert(key, cached);
+                    throw;
+                }
+            } else if (!cached.first) {
+                throw tmpl::TA_NoTemplate("No idatm template found");
+            } else {
+                for (size_t i = 0; i < ratoms.size(); ++i)
+                    if (!cached.second[i].empty())
+                        ratoms[i]->set_computed_idatm_type(cached.second[i]);
+            }
+            typing->templated = true;
+            auto& types = cached.second;
+            for (size_t i = 0; i < ratoms.size(); ++i) {
+                if (!types[i].empty())
+                    continue;
+                Atom* ra = ratoms[i];
+                if (ra->element().number() == 1) {
+                    // type now so that we needn't (relatively slowly) loop through
+                    // a large number of hydrogens later
+                    bool bonded_to_carbon = false;
+                    for (auto bondee: ra->neighbors()) {
+                        if (bondee->element() == Element::C) {
+                            bonded_to_carbon = true;
+                            break;
+                        }
+                    }
+                    ra->set_computed_idatm_type(bonded_to_carbon ?  "HC" : "H");
+                } else {
+                    typing->untyped.push_back(ra);
+                    typing->all_H = false;
+                }
+            }
+        } catch (tmpl::TA_NoTemplate&) {
+            for (auto ra: r->atoms()) {
+                typing->untyped.push_back(ra);
+                if (ra->element().number() != 1)
+                    typing->all_H = false;
+            }
+        }
+    }
+}
+
 #ifdef REPORT_TIME
 #include <ctime>
 #endif
 void
 AtomicStructure::_compute_atom_types()
 {
+    TRACE_SCOPE_ITEMS("atomstruct.compute_idatm_types", atoms().size());
 #ifdef REPORT_TIME
 clock_t start_t = clock();
 #endif
@@ -563,63 +662,35 @@ t0 = t1;
 
 
     // "pass 0.5": use templates for "infallible" typing of standard
-    // residue types
+    // residue types.  Residues are independent here, so they are typed in
+    // parallel with the results gathered afterward in residue order.
     std::vector<Atom*> untyped_atoms;
     bool all_unassigned_are_H = true;
     std::vector<const Residue*> templated_residues;
-    for (auto& r: residues()) {
-        try {
-            // Don't template-type residues with unexpected cross-residue 
-            // bonds (e.g. residues bonded to PTD in 3kch)
-
-            if (r->polymer_type() != PT_NONE) {
-                for (auto ra: r->atoms()) {
-                    if (ra->is_backbone(BBE_MIN))
-                        continue;
-                    for (auto nb: ra->neighbors()) {
-                        if (nb->residue() != ra->residue()) {
-                            // cysteine SG cross-residue bond okay...
-                            if (nb->name() == "SG" && ra->name() == "SG"
-                            && (nb->residue()->name() == "CYS" || nb->residue()->name() == "CYX")
-                            && (ra->residue()->name() == "CYS" || ra->residue()->name() == "CYX"))
-                                continue;
-                            throw tmpl::TA_NoTemplate("Non-standard cross-residue bond");
-                        }
-                    }
-                }
-            }
-            auto untemplated_atoms = r->template_assign(
-                &Atom::set_computed_idatm_type,
-                "idatm", "templates", "idatmres");
-            templated_residues.push_back(r);
-            if (untemplated_atoms.empty())
-                continue;
-            for (auto ra: untemplated_atoms) {
-                if (ra->element().number() == 1) {
-                    // type now so that we needn't (relatively slowly) loop through
-                    // a large number of hydrogens later
-                    bool bonded_to_carbon = false;
-                    for (auto bondee: ra->neighbors()) {
-                        if (bondee->element() == Element::C) {
-                            bonded_to_carbon = true;
-                            break;
-                        }
-                    }
-                    ra->set_computed_idatm_type(bonded_to_carbon ?  "HC" : "H");
-                } else {
-                    untyped_atoms.push_back(ra);
-                    all_unassigned_are_H = false;
-                }
-            }
-        } catch (tmpl::TA_NoTemplate&) {
-            for (auto ra: r->atoms()) {
-                untyped_atoms.push_back(ra);
-                if (ra->element().number() != 1)
-                    all_unassigned_are_H = false;
-            }
-        } catch (...) {
-            throw;
-        }
+    auto& res = residues();
+    std::vector<_TemplateTyping> typings(res.size());
+    // read the templates now rather than in the first thread to use them
+    tmpl::TemplateCache::template_cache()->preload("idatm", "templates", "idatmres");
+    size_t nr = res.size();
+    int num_threads = Thread_Pool::thread_count(nr, MIN_THREAD_RESIDUES);
+    if (num_threads == 1) {
+        _template_type_residues(res.begin(), res.end(), typings.begin());
+    } else {
+        Thread_Pool::run(num_threads, [&](int t) {
+            size_t rstart = (t * nr) / num_threads, rend = ((t+1) * nr) / num_threads;
+            _template_type_residues(res.begin() + rstart, res.begin() + rend,
+                typings.begin() + rstart);
+        });
+    }
+    for (size_t i = 0; i < res.size(); ++i) {
+        auto& typing = typings[i];
+        if (typing.templated)
+            templated_residues.push_back(res[i]);
+        if (typing.untyped.empty())
+            continue;
+        untyped_atoms.insert(untyped_atoms.end(), typing.untyped.begin(), typing.untyped.end());
+        if (!typing.all_H)
+            all_unassigned_are_H = false;
     }
 #ifdef TIME_PASSES
 t1 = clock();
@@ -39,15 +39,19 @@
 
 #include <logger/logger.h>
 #include <pysupport/convert.h>
+#include <arrays/threadpool.h>  // Uses Thread_Pool::parallel_for()
 
 #include <algorithm>  // for std::find, std::sort, std::remove_if, std::min
 #include <cmath> // std::abs
 #include <iterator>
 #include <map>
+#include <mutex>
 #include "Python.h"
 #include <stdexcept>
 #include <set>
 #include <type_traits> // for std::remove_reference
+#include <unordered_map>
+#include <unordered_set>
 
 namespace atomstruct {
 
@@ -61,194 +65,212 @@ AtomicStructure *AtomicStructure::copy() const
 void
 AtomicStructure::_compute_structure_cats() const
 {
+    // Classify bonded groups of atoms.  Groups are numbered in the order of
+    // their first atom and atoms are looked up by structure index, so nothing
+    // is keyed by atom pointer, and the per-group and per-atom passes run in
+    // parallel.  Residue names are interned so solvent names are found by
+    // pointer hash.
     std::vector<std::vector<Atom*>> bonded;
-    bonded_groups(&bonded, true);
-    std::map<Atom*, std::vector<Atom*>*> group_lookup;
-    std::map<Atom*, Atom*> atom_to_root;
-    for (auto& grp: bonded) {
-        auto root = grp[0];
-        group_lookup[root] = &grp;
-        for (auto a: grp)
-            atom_to_root[a] = root;
-    }
-
-    //segregate into small solvents / other
-    std::vector<Atom*> small_solvents;
-    std::set<Atom*> root_set;
-    for (auto root_grp: group_lookup) {
-        auto root = root_grp.first;
-        auto grp = root_grp.second;
-        if (grp->size() < 4 && Residue::std_solvent_names.find(root->residue()->name())
-        != Residue::std_solvent_names.end())
-            small_solvents.push_back(root);
-        else if (grp->size() == 1 && root->residue()->atoms().size() == 1
-        && root->element().number() > 4 && root->element().number() < 9)
-            small_solvents.push_back(root);
-        else
-            root_set.insert(root);
-    }
-
-    // determine/assign solvent
-    std::map<std::string, std::vector<Atom*>> solvents;
-    solvents["small solvents"] = small_solvents;
-    for (auto root: root_set) {
-        auto grp_size = group_lookup[root]->size();
-        if (grp_size > 10)
-            continue;
-        if (grp_size != root->residue()->atoms().size())
-            continue;
-
-        // potential solvent
-        solvents[root->residue()->name().c_str()].push_back(root);
+    bonded_groups(&bonded, true);   // also brings atom structure indices up to date
+    (void)chains();                 // so Residue::chain() is read-only in threads
+    const int64_t num_groups = bonded.size();
+    const size_t num_atoms = _atoms.size();
+    typedef Atom::StructCat Cat;
+    const Cat UNASSIGNED = Cat::Unassigned;
+
+    std::vector<size_t> atom_group(num_atoms);
+    Thread_Pool::parallel_for(num_groups, [&](int64_t g0, int64_t g1) {
+        for (int64_t g = g0; g < g1; ++g)
+            for (auto a: bonded[g])
+                atom_group[a->_structure_index] = g;
+    }, 4096);
+
+    // segregate into small solvents / potential solvents / other
+    std::unordered_set<ResName> solvent_names(Residue::std_solvent_names.begin(),
+        Residue::std_solvent_names.end());
+    std::vector<Cat> group_cat(num_groups, UNASSIGNED);
+    std::vector<char> potential_solvent(num_groups, 0);
+    Thread_Pool::parallel_for(num_groups, [&](int64_t g0, int64_t g1) {
+        for (int64_t g = g0; g < g1; ++g) {
+            auto& grp = bonded[g];
+            auto root = grp[0];
+            auto res_size = root->residue()->atoms().size();
+            auto en = root->element().number();
+            if (grp.size() < 4 && solvent_names.find(root->residue()->name())
+            != solvent_names.end())
+                group_cat[g] = Cat::Solvent;
+            else if (grp.size() == 1 && res_size == 1 && en > 4 && en < 9)
+                group_cat[g] = Cat::Solvent;
+            else if (grp.size() <= 10 && grp.size() == res_size)
+                potential_solvent[g] = 1;
+        }
+    }, 4096);
+
+    // determine/assign solvent:  the most common residue name of small
+    // one-residue groups, if there are at least 10 and it beats the small
+    // solvents, ties going to the name later in sort order
+    const std::string small_solvents("small solvents");
+    std::unordered_map<ResName, size_t> solvent_counts;
+    size_t num_small_solvents = 0;
+    for (int64_t g = 0; g < num_groups; ++g) {
+        if (group_cat[g] == Cat::Solvent)
+            ++num_small_solvents;
+        else if (potential_solvent[g])
+            ++solvent_counts[bonded[g][0]->residue()->name()];
     }
+    std::map<std::string, size_t> solvents(solvent_counts.begin(), solvent_counts.end());
+    solvents[small_solvents] = num_small_solvents;
     std::string best_solvent_name;
     size_t best_solvent_size = 10;
-    for (auto& sn_roots: solvents) {
-        auto sn = sn_roots.first;
-        auto& roots = sn_roots.second;
-        if (roots.size() < best_solvent_size)
+    for (auto& sn_count: solvents) {
+        if (sn_count.second < best_solvent_size)
             continue;
-        best_solvent_name = sn;
-        best_solvent_size = roots.size();
+        best_solvent_name = sn_count.first;
+        best_solvent_size = sn_count.second;
     }
-    for (auto root: small_solvents)
-        for (auto a: *(group_lookup[root]))
-            a->_set_structure_category(Atom::StructCat::Solvent);
-    if (!best_solvent_name.empty() && best_solvent_name != "small solvents") {
-        for (auto root: solvents[best_solvent_name]) {
-            root_set.erase(root);
-            for (auto a: *(group_lookup[root]))
-                a->_set_structure_category(Atom::StructCat::Solvent);
-        }
+    if (!best_solvent_name.empty() && best_solvent_name != small_solvents) {
+        ResName best_solvent(best_solvent_name);
+        for (int64_t g = 0; g < num_groups; ++g)
+            if (potential_solvent[g] && group_cat[g] == UNASSIGNED
+            && bonded[g][0]->residue()->name() == best_solvent)
+                group_cat[g] = Cat::Solvent;
     }
 
     // assign ions
-    std::set<Atom*> ions;
-    for (auto root: root_set) {
-        if (group_lookup[root]->size() == 1) {
-            if (root->element().number() > 1 && !root->element().is_noble_gas())
-                ions.insert(root);
+    std::vector<char> is_ion(num_groups, 0);
+    std::vector<int64_t> ions;
+    for (int64_t g = 0; g < num_groups; ++g) {
+        if (group_cat[g] != UNASSIGNED || bonded[g].size() != 1)
+            continue;
+        auto root = bonded[g][0];
+        if (root->element().number() > 1 && !root->element().is_noble_gas()) {
+            is_ion[g] = 1;
+            ions.push_back(g);
         }
-            
     }
     // possibly expand ion to remainder of residue (coordination complex)
     //
     // in case a large all-atom one-residue non-structure leaks into here,
     // skip if no bonds
     if (num_bonds() > 0) {
-        std::set<Residue*> checked_residues;
-        auto ions_copy = ions;
-        for (auto root: ions_copy) {
-            if (group_lookup[root]->size() == root->residue()->atoms().size())
-                continue;
-            if (checked_residues.find(root->residue()) != checked_residues.end())
+        std::unordered_set<Residue*> checked_residues;
+        std::vector<int64_t> expanded;
+        for (auto g: ions) {
+            auto r = bonded[g][0]->residue();
+            if (r->atoms().size() == 1 || !checked_residues.insert(r).second)
                 continue;
-            checked_residues.insert(root->residue());
-            std::set<Atom*> seen_roots = { root };
-            for (auto a: root->residue()->atoms()) {
-                auto rt = atom_to_root[a];
-                if (seen_roots.find(rt) != seen_roots.end())
-                    continue;
-                seen_roots.insert(rt);
-            }
             // add segments of less than 5 heavy atoms
-            for (auto rt: seen_roots) {
-                if (ions.find(rt) != ions.end())
+            for (auto a: r->atoms()) {
+                auto rg = atom_group[a->_structure_index];
+                if (is_ion[rg])
                     continue;
                 int num_heavys = 0;
-                for (auto a: *(group_lookup[rt])) {
-                    if (a->element().number() > 1) {
-                        ++num_heavys;
-                        if (num_heavys > 4)
-                            break;
-                    }
+                for (auto ga: bonded[rg]) {
+                    if (ga->element().number() > 1 && ++num_heavys > 4)
+                        break;
+                }
+                if (num_heavys < 5) {
+                    is_ion[rg] = 1;
+                    expanded.push_back(rg);
                 }
-                if (num_heavys < 5)
-                    ions.insert(rt);
             }
         }
+        ions.insert(ions.end(), expanded.begin(), expanded.end());
     }
-    for (auto root: ions) {
-        root_set.erase(root);
-        for (auto a: *(group_lookup[root]))
-            a->_set_structure_category(Atom::StructCat::Ions);
-    }
-
-    if (root_set.empty()) {
-        _structure_cats_dirty = false;
-        return;
-    }
+    for (auto g: ions)
+        group_cat[g] = Cat::Ions;
 
     // assign ligand
 
     // find longest chain
-    std::vector<Atom*>* longest = nullptr;
-    for (auto root: root_set) {
-        auto grp = group_lookup[root];
-        if (longest == nullptr || grp->size() > longest->size())
-            longest = grp;
+    size_t longest = 0;
+    bool any_remaining = false;
+    for (int64_t g = 0; g < num_groups; ++g) {
+        if (group_cat[g] == UNASSIGNED) {
+            any_remaining = true;
+            longest = std::max(longest, bonded[g].size());
+        }
     }
-    
-    std::vector<Atom*> ligands;
-    // CDL has 256 atoms
-    auto ligand_cutoff = std::min(longest->size()/4, (size_t)256);
-    for (auto root: root_set) {
-        auto grp = group_lookup[root];
-        if (grp->size() <= ligand_cutoff) {
-            // fewer than 10 residues?
+
+    // Per-atom categories by structure index, the remainder "main" with
+    // bound ligands (residues not in the chains of their group) as "ligand".
+    std::vector<Cat> atom_cat(num_atoms);
+    if (any_remaining) {
+        // CDL has 256 atoms
+        auto ligand_cutoff = std::min(longest/4, (size_t)256);
+        Thread_Pool::parallel_for(num_groups, [&](int64_t g0, int64_t g1) {
             std::set<Residue*> residues;
-            for (auto a: *grp) {
-                residues.insert(a->residue());
-            }
-            if (residues.size() < 10) {
-                // ensure it isn't part of a longer chain,
-                // some of which is missing...
-                bool long_chain = true;
-                if (root->residue()->chain() == nullptr)
-                    long_chain = false;
-                else if (root->residue()->chain()->residues().size() < 10)
-                    long_chain = false;
-                if (!long_chain)
-                    ligands.push_back(root);
+            for (int64_t g = g0; g < g1; ++g) {
+                if (group_cat[g] != UNASSIGNED)
+                    continue;
+                auto& grp = bonded[g];
+                if (grp.size() <= ligand_cutoff) {
+                    // fewer than 10 residues?
+                    residues.clear();
+                    for (auto a: grp) {
+                        residues.insert(a->residue());
+                        if (residues.size() >= 10)
+                            break;
+                    }
+                    if (residues.size() < 10) {
+                        // ensure it isn't part of a longer chain,
+                        // some of which is missing...
+                        auto chain = grp[0]->residue()->chain();
+                        if (chain == nullptr || chain->residues().size() < 10) {
+                            group_cat[g] = Cat::Ligand;
+                            continue;
+                        }
+                    }
+                }
+                group_cat[g] = Cat::Main;
             }
-        }
-    }
-    for (auto root: ligands) {
-        root_set.erase(root);
-        for (auto a: *(group_lookup[root]))
-            a->_set_structure_category(Atom::StructCat::Ligand);
+        }, 256);
     }
-
-    // remainder in "main" category
-    for (auto root: root_set) {
-        std::set<Residue*> root_residues;
-        auto grp = group_lookup[root];
-        for (auto a: *grp) {
-            a->_set_structure_category(Atom::StructCat::Main);
-            root_residues.insert(a->residue());
-        }
-        // try to reclassify bound ligands as ligand
-        std::set<Chain*> root_chains;
-        for (auto r: root_residues)
-            if (r->chain() != nullptr)
-                root_chains.insert(r->chain());
-        std::set<Residue*> seq_residues;
-        for (auto chain: root_chains) {
-            for (auto r: chain->residues()) {
-                if (r != nullptr)
-                    seq_residues.insert(r);
+    std::vector<Residue*> bound;
+    std::mutex bound_mutex;
+    Thread_Pool::parallel_for(num_groups, [&](int64_t g0, int64_t g1) {
+        for (int64_t g = g0; g < g1; ++g) {
+            auto cat = group_cat[g];
+            bool in_chain = false;
+            for (auto a: bonded[g]) {
+                atom_cat[a->_structure_index] = cat;
+                if (cat == Cat::Main && !in_chain && a->residue()->chain() != nullptr)
+                    in_chain = true;
             }
+            if (!in_chain)
+                continue;
+            std::lock_guard<std::mutex> lock(bound_mutex);
+            for (auto a: bonded[g])
+                if (a->residue()->chain() == nullptr
+                && (bound.empty() || bound.back() != a->residue()))
+                    bound.push_back(a->residue());
         }
-        if (seq_residues.empty())
-            continue;
-        std::vector<Residue*> bound;
-        std::set_difference(root_residues.begin(), root_residues.end(),
-            seq_residues.begin(), seq_residues.end(), std::inserter(bound, bound.end()));
-        for (auto br: bound) {
-            for (auto a: br->atoms())
-                a->_set_structure_category(Atom::StructCat::Ligand);
+    }, 256);
+    for (auto r: bound)
+        for (auto a: r->atoms())
+            atom_cat[a->_structure_index] = Cat::Ligand;
+
+    // set categories, tracking changes afterward since the change tracker
+    // is not thread-safe
+    std::vector<char> changed(num_atoms, 0);
+    Thread_Pool::parallel_for(num_atoms, [&](int64_t i0, int64_t i1) {
+        for (int64_t i = i0; i < i1; ++i) {
+            Atom* a = _atoms[i];
+            if (a->_structure_category != atom_cat[i]) {
+                a->_structure_category = atom_cat[i];
+                changed[i] = 1;
+            }
         }
-    }
+    }, 65536);
+    std::vector<Atom*> changed_atoms;
+    for (size_t i = 0; i < num_atoms; ++i)
+        if (changed[i])
+            changed_atoms.push_back(_atoms[i]);
+    auto self = const_cast<AtomicStructure*>(this);
+    if (changed_atoms.size() == num_atoms && num_atoms > 0)
+        _change_tracker->add_modified_all<Atom>(self, ChangeTracker::REASON_STRUCTURE_CATEGORY);
+    else if (!changed_atoms.empty())
+        _change_tracker->add_modified_set(self, changed_atoms, ChangeTracker::REASON_STRUCTURE_CATEGORY);
     _structure_cats_dirty = false;
 }
 
@@ -319,7 +341,6 @@ AtomicStructure::_make_chains() const
         id_to_polys[PolyKey(polymer[0]->chain_id(),polymer_type.second)].push_back(polymer);
     }
 
-    std::map<Residue*, int> res_to_index; // fill in on demand
     for (auto key_polys: id_to_polys) {
         auto id_type = key_polys.first;
         auto chain_id = id_type.first;
@@ -334,17 +355,9 @@ AtomicStructure::_make_chains() const
             res_list.insert(res_list.end(), polymer.begin(), polymer.end());
             if (chain_polys.size() > i+1) {
                 // possibly add in the residues between the polymers
-                if (res_to_index.size() == 0) {
-                    // fill in res_to_index
-                    auto ri = residues().begin();
-                    int index = 0;
-                    auto end = residues().end();
-                    while (ri != end)
-                        res_to_index[*ri++] = index++;
-                }
                 auto last_res = polymer.back();
                 auto start_next_poly = chain_polys[i+1].front();
-                auto next_res_i = res_to_index[last_res] + 1;
+                auto next_res_i = residue_index(last_res) + 1;
                 auto next_res = residues()[next_res_i];
                 while (next_res != start_next_poly) {
                     if (last_res->connects_to(next_res) && next_res->chain_id() == chain_id)
@@ -522,32 +535,39 @@ AtomicStructure::polymers(AtomicStructure::PolymerMissingStructure missing_struc
     // a change in chain ID
 
     // connected polymeric residues have to be adjacent in the residue list,
-    // so make an index map
-    int i = 0;
-    std::map<const Residue*, int> res_lookup;
-    for (auto r: _residues) {
-        res_lookup[r] = i++;
-    }
-
-    // Find all polymeric connections and make a map
-    // keyed on residue with value of whether that residue
-    // is connected to the next one
-    std::map<Residue*, bool> connected;
-    for (auto b: bonds()) {
-        Atom* start = b->polymeric_start_atom();
-        if (start != nullptr) {
-            Residue* sr = start->residue();
-            Residue* nr = b->other_atom(start)->residue();
-            if (res_lookup[sr] + 1 == res_lookup[nr]
-            && (!consider_chain_ids || sr->chain_id() == nr->chain_id()))
-                // If consider_chain_ids is true,
-                // if an artificial linker is used to join
-                // otherwise unconnected amino acid chains,
-                // they all can have different chain IDs,
-                // and should be treated as separate chains (2atp)
-                connected[sr] = true;
+    // so compare residue indices
+    auto res_lookup = [this](const Residue* r) { return (int)residue_index(r); };
+
+    // Find all polymeric connections and note for each residue
+    // whether it is connected to the next one.  Bonds are checked in
+    // parallel, so first do the lazy setup that the checks rely on.
+    if (_residue_indices_dirty)
+        _index_residues();
+    Sequence::rname3to1("ALA");
+    const Bonds& bs = bonds();
+    std::vector<int> bond_start_res(bs.size(), -1);
+    Thread_Pool::parallel_for(bs.size(), [&](int64_t b0, int64_t b1) {
+        for (int64_t bi = b0; bi < b1; ++bi) {
+            Bond* b = bs[bi];
+            Atom* start = b->polymeric_start_atom();
+            if (start != nullptr) {
+                Residue* sr = start->residue();
+                Residue* nr = b->other_atom(start)->residue();
+                if (res_lookup(sr) + 1 == res_lookup(nr)
+                && (!consider_chain_ids || sr->chain_id() == nr->chain_id()))
+                    // If consider_chain_ids is true,
+                    // if an artificial linker is used to join
+                    // otherwise unconnected amino acid chains,
+                    // they all can have different chain IDs,
+                    // and should be treated as separate chains (2atp)
+                    bond_start_res[bi] = res_lookup(sr);
+            }
         }
-    }
+    }, 16384);
+    std::vector<char> connected(_residues.size(), 0);
+    for (auto ri: bond_start_res)
+        if (ri >= 0)
+            connected[ri] = 1;
 
     if (missing_structure_treatment != PMS_NEVER_CONNECTS) {
         // go through missing-structure pseudobonds
@@ -578,14 +598,10 @@ AtomicStructure::polymers(AtomicStructure::PolymerMissingStructure missing_struc
                     if (pa1->coord().sqdistance(pa2->coord()) > distsq_cutoff)
                         continue;
                 }
-                int index1 = res_lookup[r1], index2 = res_lookup[r2];
+                int index1 = res_lookup(r1), index2 = res_lookup(r2);
                 if (abs(index1 - index2) == 1
                 && r1->chain_id() == r2->chain_id()) {
-                    if (index1 < index2) {
-                        connected[r1] = true;
-                    } else {
-                        connected[r2] = true;
-                    }
+                    connected[std::min(index1, index2)] = 1;
                 }
             }
         }
@@ -596,10 +612,9 @@ AtomicStructure::polymers(AtomicStructure::PolymerMissingStructure missing_struc
     Chain::Residues chain;
     bool in_chain = false;
     PolymerType pt = PT_NONE;
-    for (auto& upr: _residues) {
-        Residue* r = upr;
-        auto connection = connected.find(r);
-        if (connection == connected.end()) {
+    for (size_t ri = 0; ri < _residues.size(); ++ri) {
+        Residue* r = _residues[ri];
+        if (!connected[ri]) {
             if (in_chain) {
                 chain.push_back(r);
                 if (pt == PT_NONE) {
@@ -27,6 +27,10 @@
 #ifndef atomstruct_AtomicStructure
 #define atomstruct_AtomicStructure
 
+#include <memory>
+#include <utility>
+#include <vector>
+
 #include "Structure.h"
 
 namespace atomstruct {
@@ -37,14 +41,28 @@ class ATOMSTRUCT_IMEX AtomicStructure: public Structure {
     friend class Residue; // for _polymers_computed
     friend class StructureSeq; // for remove_chain()
 private:
+    // per-residue results of template-based atom typing
+    struct _TemplateTyping {
+        bool  templated;
+        bool  all_H;  // all untyped atoms are hydrogens
+        std::vector<Atom*>  untyped;
+    };
+    typedef std::pair<bool, std::vector<AtomType>>  _TemplateTypes;
+    std::unique_ptr<CompSSCandidates>  _ss_candidates;
     void  _compute_atom_types();
     void  _compute_structure_cats() const;
     void  _make_chains() const;
+    void  _template_type_residues(Residues::const_iterator start, Residues::const_iterator end,
+        std::vector<_TemplateTyping>::iterator typing);
 public:
     AtomicStructure(PyObject* logger = nullptr) : Structure(logger) {}
 
     void  compute_secondary_structure(float energy_cutoff = -0.5, int min_helix_length = 3,
-        int min_strand_length = 3, bool = false, CompSSInfo* = nullptr);
+        int min_strand_length = 3, bool = false, CompSSInfo* = nullptr,
+        float reuse_tolerance = 0.0);
+    void  compute_frames_secondary_structure(const std::vector<CoordSet*>& frames,
+        unsigned char* ss_codes, float energy_cutoff = -0.5, int min_helix_length = 3,
+        int min_strand_length = 3, int num_threads = 1);
     AtomicStructure*  copy() const;
     void  normalize_ss_ids();
     std::vector<std::pair<Chain::Residues,PolymerType>>  polymers(
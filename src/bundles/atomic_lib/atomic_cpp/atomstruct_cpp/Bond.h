@@ -34,6 +34,7 @@
 #include "destruct.h"
 #include "Connection.h"
 #include "imex.h"
+#include "ObjectPool.h"
 #include "session.h"
 
 namespace atomstruct {
@@ -57,10 +58,17 @@ private:
     const char*  err_msg_loop() const
         { return "Can't bond an atom to itself"; }
     mutable Rings  _rings;
+    mutable unsigned int  _structure_index = 0; // maintained by Structure::bond_index()
 
     static int  SESSION_NUM_INTS(int /*version*/=CURRENT_SESSION_VERSION) { return 0; }
     static int  SESSION_NUM_FLOATS(int /*version*/=CURRENT_SESSION_VERSION) { return 0; }
 public:
+    // allocated from the structure's ObjectPool
+    static void*  operator new(std::size_t size) { return ObjectPool::allocate(nullptr, size); }
+    static void*  operator new(std::size_t size, ObjectPool* pool)
+        { return ObjectPool::allocate(pool, size); }
+    static void  operator delete(void* p) { ObjectPool::deallocate(p); }
+    static void  operator delete(void* p, ObjectPool*) { ObjectPool::deallocate(p); }
     virtual ~Bond() {
         DestructionUser(this);
         change_tracker()->add_deleted(structure(), this);
@@ -0,0 +1,115 @@
+// vi: set expandtab ts=4 sw=4:
+
+/*
+ * === UCSF ChimeraX Copyright ===
+ * Copyright 2022 Regents of the University of California. All rights reserved.
+ * The ChimeraX application is provided pursuant to the ChimeraX license
+ * agreement, which covers academic and commercial uses. For more details, see
+ * <http://www.rbvi.ucsf.edu/chimerax/docs/licensing.html>
+ *
+ * This particular file is part of the ChimeraX library. You can also
+ * redistribute and/or modify it under the terms of the GNU Lesser General
+ * Public License version 2.1 as published by the Free Software Foundation.
+ * For more details, see
+ * <https://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESSED OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. ADDITIONAL LIABILITY
+ * LIMITATIONS ARE DESCRIBED IN THE GNU LESSER GENERAL PUBLIC LICENSE
+ * VERSION 2.1
+ *
+ * This notice must be embedded in or attached to all copies, including partial
+ * copies, of the software or any revisions or derivations thereof.
+ * === UCSF ChimeraX Copyright ===
+ */
+
+#include <algorithm>  // std::find
+#include <unordered_map>
+
+#define ATOMSTRUCT_EXPORT
+#include "Atom.h"
+#include "Bond.h"
+#include "BondGraph.h"
+#include "Structure.h"
+
+namespace atomstruct {
+
+void
+BondGraph::build(const Structure* s, bool idatm_types)
+{
+    auto& atoms = s->atoms();
+    auto& bonds = s->bonds();
+    size_t na = atoms.size(), nb = bonds.size();
+    std::vector<uint32_t> a1(nb), a2(nb);
+    _offsets.assign(na + 1, 0);
+    for (size_t bi = 0; bi < nb; ++bi) {
+        auto& ba = bonds[bi]->atoms();
+        a1[bi] = s->atom_index(ba[0]);
+        a2[bi] = s->atom_index(ba[1]);
+        ++_offsets[a1[bi] + 1];
+        ++_offsets[a2[bi] + 1];
+    }
+    for (size_t i = 0; i < na; ++i)
+        _offsets[i+1] += _offsets[i];
+    // fill in bond order so each atom's neighbors are in the same order as Atom::bonds()
+    // when the bonds were made in order
+    std::vector<uint32_t> fill(_offsets.begin(), _offsets.end() - 1);
+    _neighbors.resize(2 * nb);
+    _bonds.resize(2 * nb);
+    for (size_t bi = 0; bi < nb; ++bi) {
+        uint32_t f1 = fill[a1[bi]]++, f2 = fill[a2[bi]]++;
+        _neighbors[f1] = a2[bi];
+        _bonds[f1] = bi;
+        _neighbors[f2] = a1[bi];
+        _bonds[f2] = bi;
+    }
+
+    _elements.resize(na);
+    for (size_t i = 0; i < na; ++i)
+        _elements[i] = atoms[i]->element().number();
+
+    _idatm.clear();
+    _idatm_types.clear();
+    if (idatm_types) {
+        const_cast<Structure*>(s)->ready_idatm_types();
+        std::unordered_map<AtomType, uint16_t> codes;
+        _idatm.resize(na);
+        for (size_t i = 0; i < na; ++i) {
+            auto& t = atoms[i]->idatm_type();
+            auto ci = codes.find(t);
+            if (ci == codes.end()) {
+                ci = codes.emplace(t, _idatm_types.size()).first;
+                _idatm_types.push_back(t);
+            }
+            _idatm[i] = ci->second;
+        }
+    }
+}
+
+bool
+BondGraph::within_bonds(size_t a1, size_t a2, int max_bonds) const
+{
+    if (a1 == a2)
+        return true;
+    // breadth-first from a1, stamping visited atoms in a small list since
+    // max_bonds is typically only a few bonds
+    std::vector<uint32_t> seen = { static_cast<uint32_t>(a1) }, front = seen, next;
+    for (int d = 0; d < max_bonds && !front.empty(); ++d) {
+        next.clear();
+        for (auto a: front) {
+            for (auto n = neighbors_begin(a), end = neighbors_end(a); n != end; ++n) {
+                if (*n == a2)
+                    return true;
+                if (std::find(seen.begin(), seen.end(), *n) == seen.end()) {
+                    seen.push_back(*n);
+                    next.push_back(*n);
+                }
+            }
+        }
+        front.swap(next);
+    }
+    return false;
+}
+
+}  // namespace atomstruct
@@ -0,0 +1,93 @@
+// vi: set expandtab ts=4 sw=4:
+
+/*
+ * === UCSF ChimeraX Copyright ===
+ * Copyright 2022 Regents of the University of California. All rights reserved.
+ * The ChimeraX application is provided pursuant to the ChimeraX license
+ * agreement, which covers academic and commercial uses. For more details, see
+ * <http://www.rbvi.ucsf.edu/chimerax/docs/licensing.html>
+ *
+ * This particular file is part of the ChimeraX library. You can also
+ * redistribute and/or modify it under the terms of the GNU Lesser General
+ * Public License version 2.1 as published by the Free Software Foundation.
+ * For more details, see
+ * <https://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESSED OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. ADDITIONAL LIABILITY
+ * LIMITATIONS ARE DESCRIBED IN THE GNU LESSER GENERAL PUBLIC LICENSE
+ * VERSION 2.1
+ *
+ * This notice must be embedded in or attached to all copies, including partial
+ * copies, of the software or any revisions or derivations thereof.
+ * === UCSF ChimeraX Copyright ===
+ */
+
+#ifndef atomstruct_BondGraph
+#define atomstruct_BondGraph
+
+#include <cstdint>
+#include <vector>
+
+#include "imex.h"
+#include "string_types.h"
+
+namespace atomstruct {
+
+class Structure;
+
+class ATOMSTRUCT_IMEX BondGraph {
+    // BondGraph is a compressed sparse row copy of a structure's bonds, for graph
+    // algorithms that would otherwise chase Atom::bonds() and Atom::neighbors()
+    // through pointers.  Atoms and bonds are numbered by their indices in
+    // Structure::atoms() and Structure::bonds().  The arrays are plain vectors so
+    // a kernel can copy them to worker threads.  A cached graph for a structure
+    // is available from Structure::bond_graph(), which rebuilds it after atoms
+    // or bonds are added or deleted, or elements or IDATM types change.
+private:
+    std::vector<uint32_t>  _offsets;    // atom i neighbors are [_offsets[i], _offsets[i+1])
+    std::vector<uint32_t>  _neighbors;  // neighbor atom indices
+    std::vector<uint32_t>  _bonds;      // bond indices, parallel to _neighbors
+    std::vector<uint8_t>  _elements;    // atomic numbers
+    std::vector<uint16_t>  _idatm;      // indices into _idatm_types
+    std::vector<AtomType>  _idatm_types;
+
+public:
+    BondGraph() {}
+    // IDATM types are only computed and copied if asked for, since computing them
+    // is much slower than copying the bonds
+    BondGraph(const Structure* s, bool idatm_types = false) { build(s, idatm_types); }
+    void  build(const Structure* s, bool idatm_types = false);
+    bool  has_idatm_types() const { return _idatm.size() == _elements.size(); }
+
+    size_t  num_atoms() const { return _elements.size(); }
+    size_t  num_bonds() const { return _neighbors.size() / 2; }
+    uint32_t  degree(size_t a) const { return _offsets[a+1] - _offsets[a]; }
+    const uint32_t*  neighbors_begin(size_t a) const { return _neighbors.data() + _offsets[a]; }
+    const uint32_t*  neighbors_end(size_t a) const { return _neighbors.data() + _offsets[a+1]; }
+    const uint32_t*  bonds_begin(size_t a) const { return _bonds.data() + _offsets[a]; }
+    uint8_t  element(size_t a) const { return _elements[a]; }
+    // small integer IDATM code, valid if has_idatm_types()
+    uint16_t  idatm_code(size_t a) const { return _idatm[a]; }
+    const AtomType&  idatm_type(size_t a) const { return _idatm_types[_idatm[a]]; }
+    const std::vector<AtomType>&  idatm_types() const { return _idatm_types; }
+
+    const std::vector<uint32_t>&  offsets() const { return _offsets; }
+    const std::vector<uint32_t>&  neighbors() const { return _neighbors; }
+    const std::vector<uint32_t>&  bond_indices() const { return _bonds; }
+    const std::vector<uint8_t>&  elements() const { return _elements; }
+    const std::vector<uint16_t>&  idatm_codes() const { return _idatm; }
+
+    // whether atoms a1 and a2 are at most max_bonds bonds apart
+    bool  within_bonds(size_t a1, size_t a2, int max_bonds) const;
+    size_t  memory_usage() const {
+        return sizeof(BondGraph) + (_offsets.capacity() + _neighbors.capacity()
+            + _bonds.capacity()) * sizeof(uint32_t) + _elements.capacity()
+            + _idatm.capacity() * sizeof(uint16_t) + _idatm_types.capacity() * sizeof(AtomType);
+    }
+};
+
+}  // namespace atomstruct
+
+#endif  // atomstruct_BondGraph
@@ -26,9 +26,16 @@
 
 #define ATOMSTRUCT_EXPORT
 #define PYINSTANCE_EXPORT
+#include "Atom.h"
+#include "Bond.h"
 #include "ChangeTracker.h"
+#include "CoordSet.h"
+#include "Residue.h"
+#include "Structure.h"
 #include <pyinstance/PythonInstance.instantiate.h>
 
+#include <unordered_map>
+
 template class pyinstance::PythonInstance<atomstruct::ChangeTracker>;
 
 namespace atomstruct {
@@ -42,6 +49,7 @@ const std::string ChangeTracker::REASON_CHAIN_ID("chain_id changed");
 const std::string ChangeTracker::REASON_COLOR("color changed");
 const std::string ChangeTracker::REASON_COORD("coord changed");
 const std::string ChangeTracker::REASON_COORDSET("coordset changed");
+const std::string ChangeTracker::REASON_COORDS_REPLACED("coords replaced");
 const std::string ChangeTracker::REASON_DISPLAY("display changed");
 const std::string ChangeTracker::REASON_DRAW_MODE("draw_mode changed");
 const std::string ChangeTracker::REASON_ELEMENT("element changed");
@@ -72,6 +80,140 @@ const std::string ChangeTracker::REASON_STRUCTURE_CATEGORY("structure_category c
 const std::string ChangeTracker::REASON_SS_ID("ss_id changed");
 const std::string ChangeTracker::REASON_SS_TYPE("ss_type changed");
 
+namespace {
+
+class ReasonRegistry {
+    static const int  MAX_BITS = 64;
+    std::vector<std::string>  _names;
+    // the REASON_ constants are found by address, other reasons by name
+    std::unordered_map<const std::string*, int>  _by_address;
+    std::unordered_map<std::string, int>  _by_name;
+
+    int  _add(const std::string& name) {
+        auto bit = static_cast<int>(_names.size());
+        _names.push_back(name);
+        _by_name[name] = bit;
+        return bit;
+    }
+public:
+    ReasonRegistry() {
+        for (auto reason: {
+        &ChangeTracker::REASON_ACTIVE_COORD_SET,
+        &ChangeTracker::REASON_ALT_LOC,
+        &ChangeTracker::REASON_ANISO_U,
+        &ChangeTracker::REASON_BALL_SCALE,
+        &ChangeTracker::REASON_BFACTOR,
+        &ChangeTracker::REASON_CHAIN_ID,
+        &ChangeTracker::REASON_COLOR,
+        &ChangeTracker::REASON_COORD,
+        &ChangeTracker::REASON_COORDSET,
+        &ChangeTracker::REASON_COORDS_REPLACED,
+        &ChangeTracker::REASON_DISPLAY,
+        &ChangeTracker::REASON_DRAW_MODE,
+        &ChangeTracker::REASON_ELEMENT,
+        &ChangeTracker::REASON_HALFBOND,
+        &ChangeTracker::REASON_HIDE,
+        &ChangeTracker::REASON_IDATM_TYPE,
+        &ChangeTracker::REASON_INSERTION_CODE,
+        &ChangeTracker::REASON_NAME,
+        &ChangeTracker::REASON_NUMBER,
+        &ChangeTracker::REASON_OCCUPANCY,
+        &ChangeTracker::REASON_RADIUS,
+        &ChangeTracker::REASON_RESIDUES,
+        &ChangeTracker::REASON_RIBBON_ADJUST,
+        &ChangeTracker::REASON_RIBBON_COLOR,
+        &ChangeTracker::REASON_RIBBON_DISPLAY,
+        &ChangeTracker::REASON_RIBBON_HIDE_BACKBONE,
+        &ChangeTracker::REASON_RIBBON_TETHER,
+        &ChangeTracker::REASON_RIBBON_ORIENTATION,
+        &ChangeTracker::REASON_RIBBON_MODE,
+        &ChangeTracker::REASON_RING_COLOR,
+        &ChangeTracker::REASON_RING_DISPLAY,
+        &ChangeTracker::REASON_RING_MODE,
+        &ChangeTracker::REASON_SCENE_COORD,
+        &ChangeTracker::REASON_SELECTED,
+        &ChangeTracker::REASON_SEQUENCE,
+        &ChangeTracker::REASON_SERIAL_NUMBER,
+        &ChangeTracker::REASON_STRUCTURE_CATEGORY,
+        &ChangeTracker::REASON_SS_ID,
+        &ChangeTracker::REASON_SS_TYPE }) {
+            auto i = _by_name.find(*reason);
+            _by_address[reason] = (i == _by_name.end()) ? _add(*reason) : i->second;
+        }
+    }
+    int  bit(const std::string& reason) {
+        auto ai = _by_address.find(&reason);
+        if (ai != _by_address.end())
+            return ai->second;
+        auto ni = _by_name.find(reason);
+        if (ni != _by_name.end())
+            return ni->second;
+        if (_names.size() == MAX_BITS)
+            return -1;
+        return _add(reason);
+    }
+    const std::string&  name(int bit) const { return _names[bit]; }
+};
+
+ReasonRegistry&
+reason_registry()
+{
+    static ReasonRegistry registry;
+    return registry;
+}
+
+template <class Container>
+void
+fill_all_modified(Changes& changes, const Container& items)
+{
+    if (!changes.all_modified)
+        return;
+    changes.modified.reserve(items.size());
+    for (auto item: items)
+        if (!changes.created.contains(item))
+            changes.modified.insert(item);
+    changes.all_modified = false;
+}
+
+}  // namespace
+
+int
+ChangeReasons::reason_bit(const std::string& reason)
+{
+    return reason_registry().bit(reason);
+}
+
+const std::string&
+ChangeReasons::reason_name(int bit)
+{
+    return reason_registry().name(bit);
+}
+
+std::vector<std::string>
+ChangeReasons::names() const
+{
+    std::vector<std::string> result;
+    for (int bit = 0; bit < 64; ++bit)
+        if (_bits & ((std::uint64_t)1 << bit))
+            result.push_back(reason_name(bit));
+    result.insert(result.end(), _other.begin(), _other.end());
+    return result;
+}
+
+void
+ChangeTracker::_resolve_all_modified() const
+{
+    for (auto& s_changes: _structure_type_changes) {
+        auto s = s_changes.first;
+        auto& changes = s_changes.second;
+        // indices as per _ptr_to_type()
+        fill_all_modified(changes[0], s->atoms());
+        fill_all_modified(changes[1], s->bonds());
+        fill_all_modified(changes[3], s->residues());
+        fill_all_modified(changes[7], s->coord_sets());
+    }
+}
+
 DiscardingChangeTracker  dct;
 
 DiscardingChangeTracker*
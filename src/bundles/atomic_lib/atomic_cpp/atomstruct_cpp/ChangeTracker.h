@@ -29,9 +29,13 @@
 
 #include <algorithm>
 #include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
 #include <map>
 #include <pyinstance/PythonInstance.declare.h>
 #include <set>
+#include <stdexcept>
 #include <string>
 #include <vector>
 
@@ -53,16 +57,149 @@ class Structure;
 
 namespace atomstruct {
 
+// Open-addressing hash set of pointers.  Node-based sets allocate for every
+// insertion, which dominates the cost of changing a million atoms at once.
+class PtrSet {
+    std::vector<const void*>  _slots; // empty, or a power-of-two size
+    std::size_t  _size = 0;
+    std::size_t  _used = 0; // filled slots, including tombstones
+    int  _shift = 64;
+
+    static const void*  _tombstone() { return reinterpret_cast<const void*>(1); }
+    static bool  _occupied(const void* p) { return p != nullptr && p != _tombstone(); }
+    std::size_t  _slot(const void* ptr) const {
+        return (reinterpret_cast<std::uint64_t>(ptr) * 11400714819323198485ull) >> _shift;
+    }
+    std::size_t  _find(const void* ptr) const {
+        std::size_t mask = _slots.size() - 1;
+        for (std::size_t i = _slot(ptr); ; i = (i + 1) & mask) {
+            if (_slots[i] == ptr || _slots[i] == nullptr)
+                return i;
+        }
+    }
+    void  _rehash(std::size_t num_slots) {
+        std::vector<const void*> old_slots(num_slots, nullptr);
+        old_slots.swap(_slots);
+        _shift = 64;
+        for (std::size_t n = num_slots; n > 1; n >>= 1)
+            --_shift;
+        _used = _size;
+        for (auto p: old_slots)
+            if (_occupied(p))
+                _slots[_find(p)] = p;
+    }
+
+public:
+    class const_iterator {
+        const void* const*  _p;
+        const void* const*  _end;
+        void  _skip() { while (_p != _end && !_occupied(*_p)) ++_p; }
+    public:
+        typedef std::forward_iterator_tag  iterator_category;
+        typedef const void*  value_type;
+        typedef std::ptrdiff_t  difference_type;
+        typedef const void* const*  pointer;
+        typedef const void*  reference;
+
+        const_iterator(const void* const* p, const void* const* end): _p(p), _end(end) { _skip(); }
+        const void*  operator*() const { return *_p; }
+        const_iterator&  operator++() { ++_p; _skip(); return *this; }
+        bool  operator!=(const const_iterator& other) const { return _p != other._p; }
+        bool  operator==(const const_iterator& other) const { return _p == other._p; }
+    };
+
+    const_iterator  begin() const {
+        return const_iterator(_slots.data(), _slots.data() + _slots.size());
+    }
+    void  clear() {
+        // keep the table for the next round of changes if it was well used
+        if (_slots.size() > 1024 && _size * 8 < _slots.size()) {
+            std::vector<const void*>().swap(_slots);
+            _shift = 64;
+        } else
+            std::fill(_slots.begin(), _slots.end(), nullptr);
+        _size = _used = 0;
+    }
+    bool  contains(const void* ptr) const {
+        return _size > 0 && _slots[_find(ptr)] == ptr;
+    }
+    bool  empty() const { return _size == 0; }
+    const_iterator  end() const {
+        return const_iterator(_slots.data() + _slots.size(), _slots.data() + _slots.size());
+    }
+    void  erase(const void* ptr) {
+        if (_size == 0)
+            return;
+        auto i = _find(ptr);
+        if (_slots[i] == ptr) {
+            _slots[i] = _tombstone();
+            --_size;
+        }
+    }
+    void  insert(const void* ptr) {
+        if (4 * (_used + 1) > 3 * _slots.size())
+            // grow, or just sweep out tombstones if they are most of the table
+            _rehash(_slots.empty() ? 16 : (2 * _size > _used ? 2 * _slots.size() : _slots.size()));
+        auto i = _find(ptr);
+        if (_slots[i] == ptr)
+            return;
+        _slots[i] = ptr;
+        ++_size;
+        ++_used;
+    }
+    void  reserve(std::size_t n) {
+        std::size_t num_slots = std::max(_slots.size(), (std::size_t)16);
+        while (3 * num_slots < 4 * n)
+            num_slots *= 2;
+        if (num_slots != _slots.size())
+            _rehash(num_slots);
+    }
+    std::size_t  size() const { return _size; }
+};
+
+// Change reasons interned as bit flags.  The first 64 distinct reason strings
+// get a bit; any beyond that are kept by name.
+class ATOMSTRUCT_IMEX ChangeReasons {
+    std::uint64_t  _bits = 0;
+    std::set<std::string>  _other;
+public:
+    static int  reason_bit(const std::string& reason); // -1 if out of bits
+    static const std::string&  reason_name(int bit);
+
+    void  clear() { _bits = 0; _other.clear(); }
+    bool  empty() const { return _bits == 0 && _other.empty(); }
+    void  insert(const std::string& reason) {
+        auto bit = reason_bit(reason);
+        if (bit < 0)
+            _other.insert(reason);
+        else
+            _bits |= (std::uint64_t)1 << bit;
+    }
+    void  merge(const ChangeReasons& other) {
+        _bits |= other._bits;
+        _other.insert(other._other.begin(), other._other.end());
+    }
+    std::vector<std::string>  names() const;
+    std::size_t  size() const { return names().size(); }
+};
+
 class ATOMSTRUCT_IMEX Changes {
 public:
-    // plain "set" (rather than "unordered_set") empirically faster to add_created() and clear()
-    std::set<const void*>  created; // use set so that deletions can be easily found
-    std::set<const void*>  modified;
-    std::set<std::string>   reasons;
+    PtrSet  created; // use set so that deletions can be easily found
+    PtrSet  modified;
+    ChangeReasons  reasons;
     long  num_deleted = 0;
+    // all objects of this type in the structure are modified; the modified set is
+    // filled in when the changes are reported, so bulk changes are constant time
+    bool  all_modified = false;
 
-    bool  changed() const { return !(created.empty() && modified.empty() && reasons.empty() && num_deleted==0); }
-    void  clear() { created.clear(); modified.clear(); reasons.clear(); num_deleted=0; }
+    bool  changed() const {
+        return !(created.empty() && modified.empty() && reasons.empty() && num_deleted==0
+            && !all_modified);
+    }
+    void  clear() {
+        created.clear(); modified.clear(); reasons.clear(); num_deleted=0; all_modified=false;
+    }
 };
 
 class ATOMSTRUCT_IMEX ChangeTracker: public pyinstance::PythonInstance<ChangeTracker> {
@@ -81,6 +218,17 @@ protected:
     mutable ChangesArray  _global_type_changes;
     mutable std::map<Structure*, ChangesArray>  _structure_type_changes;
     std::set<Structure*> _dead_structures;
+    // changes typically come in long runs for one structure
+    Structure*  _last_structure = nullptr;
+    ChangesArray*  _last_changes = nullptr;
+    ChangesArray&  _changes(Structure* s) {
+        if (s != _last_structure) {
+            _last_changes = &_structure_type_changes[s];
+            _last_structure = s;
+        }
+        return *_last_changes;
+    }
+    void  _resolve_all_modified() const;
     bool  _structure_okay(Structure* s) {
         return s != nullptr && _dead_structures.find(s) == _dead_structures.end();
     }
@@ -98,6 +246,7 @@ public:
     static const std::string  REASON_COLOR;
     static const std::string  REASON_COORD;
     static const std::string  REASON_COORDSET;
+    static const std::string  REASON_COORDS_REPLACED;
     static const std::string  REASON_DISPLAY;
     static const std::string  REASON_DRAW_MODE;
     static const std::string  REASON_ELEMENT;
@@ -133,7 +282,7 @@ public:
         if (_discarding)
             return;
         if (_structure_okay(s)) {
-            auto& s_changes = _structure_type_changes[s][_ptr_to_type(ptr)];
+            auto& s_changes = _changes(s)[_ptr_to_type(ptr)];
             s_changes.created.insert(ptr);
         } else if (s == nullptr)
             _global_type_changes[_ptr_to_type(ptr)].created.insert(ptr);
@@ -146,7 +295,7 @@ public:
         if (_discarding)
             return;
         if (_structure_okay(s)) {
-            auto& s_changes = _structure_type_changes[s]
+            auto& s_changes = _changes(s)
                 [_ptr_to_type(static_cast<typename std::set<C*>::value_type>(nullptr))];
             // looping through and inserting individually empirically faster than the commented-out
             //   single call below, possibly due to the generic nature of that call
@@ -161,19 +310,30 @@ public:
         }
     }
 
+    // make room for n more created objects of type C in one step before
+    // creating many of them
+    template<class C>
+    void  reserve_created(Structure* s, std::size_t n) {
+        if (_discarding || !_structure_okay(s))
+            return;
+        auto& created = _changes(s)[_ptr_to_type(static_cast<C*>(nullptr))].created;
+        created.reserve(created.size() + n);
+    }
+
     template<class C>
     void  add_modified(Structure* s, C* ptr, const std::string& reason) {
         if (_discarding)
             return;
         if (_structure_okay(s)) {
-            auto& s_changes = _structure_type_changes[s][_ptr_to_type(ptr)];
+            auto& s_changes = _changes(s)[_ptr_to_type(ptr)];
             if (ptr == nullptr) {
                 // If ptr is null the object is not included in the modified list.
                 // This is to improve speed with large structures, see ticket #3000.
                 s_changes.reasons.insert(reason);
-            } else if (s_changes.created.find(static_cast<const void*>(ptr)) == s_changes.created.end()) {
+            } else if (!s_changes.created.contains(ptr)) {
                 // newly created objects don't also go in modified set
-                s_changes.modified.insert(ptr);
+                if (!s_changes.all_modified)
+                    s_changes.modified.insert(ptr);
                 s_changes.reasons.insert(reason);
             }
         } else if (s == nullptr) {
@@ -188,10 +348,11 @@ public:
         if (_discarding)
             return;
         if (_structure_okay(s)) {
-            auto& s_changes = _structure_type_changes[s][_ptr_to_type(ptr)];
-            if (s_changes.created.find(static_cast<const void*>(ptr)) == s_changes.created.end()) {
+            auto& s_changes = _changes(s)[_ptr_to_type(ptr)];
+            if (!s_changes.created.contains(ptr)) {
                 // newly created objects don't also go in modified set
-                s_changes.modified.insert(ptr);
+                if (!s_changes.all_modified)
+                    s_changes.modified.insert(ptr);
                 s_changes.reasons.insert(reason);
                 s_changes.reasons.insert(reason2);
             }
@@ -210,9 +371,11 @@ public:
         if (s == static_cast<void*>(ptr)) {
             _structure_type_changes.erase(s);
             _dead_structures.insert(s);
+            if (_last_structure == s)
+                _last_structure = nullptr;
         }
         if (_structure_okay(s)) {
-            auto& s_changes = _structure_type_changes[s][_ptr_to_type(ptr)];
+            auto& s_changes = _changes(s)[_ptr_to_type(ptr)];
             ++s_changes.num_deleted;
             s_changes.created.erase(ptr);
             s_changes.modified.erase(ptr);
@@ -229,16 +392,19 @@ public:
         if (_discarding)
             return;
         if (_structure_okay(s)) {
-            auto& s_changes = _structure_type_changes[s][
+            auto& s_changes = _changes(s)[
                 _ptr_to_type(static_cast<typename std::set<C*>::value_type>(nullptr))];
             auto& s_created = s_changes.created;
             auto& s_modified = s_changes.modified;
-            if (s_created.size()) {
+            if (s_changes.all_modified) {
+                // already covered
+            } else if (s_created.size()) {
                 for (auto ptr: ptrs) {
-                    if (s_created.find(static_cast<const void*>(ptr)) == s_created.end())
+                    if (!s_created.contains(ptr))
                         s_modified.insert(ptr);
                 }
             } else {
+                s_modified.reserve(s_modified.size() + ptrs.size());
                 for (auto ptr: ptrs)
                     s_modified.insert(ptr);
             }
@@ -250,10 +416,11 @@ public:
             auto& g_modified = g_changes.modified;
             if (g_created.size()) {
                 for (auto ptr: ptrs) {
-                    if (g_created.find(static_cast<const void*>(ptr)) == g_created.end())
+                    if (!g_created.contains(ptr))
                         g_modified.insert(ptr);
                 }
             } else {
+                g_modified.reserve(g_modified.size() + ptrs.size());
                 for (auto ptr: ptrs)
                     g_modified.insert(ptr);
             }
@@ -261,6 +428,32 @@ public:
         }
     }
 
+    // Mark every atom, bond, residue or coordinate set (depending on C) of the
+    // structure as modified, in constant time
+    template<class C>
+    void  add_modified_all(Structure* s, const std::string& reason) {
+        if (_discarding || !_structure_okay(s))
+            return;
+        auto type = _ptr_to_type(static_cast<C*>(nullptr));
+        if (type != 0 && type != 1 && type != 3 && type != 7)
+            throw std::invalid_argument("add_modified_all() only supports atoms, bonds,"
+                " residues and coordinate sets");
+        auto& s_changes = _changes(s)[type];
+        s_changes.all_modified = true;
+        s_changes.modified.clear();
+        s_changes.reasons.insert(reason);
+    }
+
+    // All of a structure's current coordinates were replaced at once (e.g. a trajectory
+    // frame was read into them).  Recorded as a structure-level change so consumers
+    // can refresh in bulk, and as every atom modified for those that look per atom.
+    void  add_coords_replaced(Structure* s) {
+        if (_discarding || !_structure_okay(s))
+            return;
+        add_modified_all<Atom>(s, REASON_COORD);
+        add_modified(s, s, REASON_COORDS_REPLACED);
+    }
+
     bool  changed() const {
         for (auto& s_changes: _structure_type_changes) {
             auto& structure_changes = s_changes.second;
@@ -277,8 +470,10 @@ public:
         for (auto& changes: _global_type_changes) changes.clear();
         _structure_type_changes.clear();
         _dead_structures.clear();
+        _last_structure = nullptr;
     }
     const ChangesArray&  get_global_changes() const {
+        _resolve_all_modified();
         // global type changes only initially holds the non-structure-associated changes
         // (global pseudobonds and groups); supplement with structure changes
         for (auto& s_changes: _structure_type_changes) {
@@ -290,14 +485,14 @@ public:
                     target.created.insert(ptr);
                 for (auto ptr: source.modified)
                     target.modified.insert(ptr);
-                for (auto &reason: source.reasons)
-                    target.reasons.insert(reason);
+                target.reasons.merge(source.reasons);
                 target.num_deleted += source.num_deleted;
             }
         }
         return _global_type_changes;
     }
     const std::map<Structure*, ChangesArray>&  get_structure_changes() const {
+        _resolve_all_modified();
         return _structure_type_changes;
     }
     const std::string  python_class_names[_num_types] = {
@@ -28,8 +28,11 @@
 #include <exception>
 #include <list>
 #include <map>
+#include <set>
 #include <string>
+#include <unordered_map>
 
+#include <arrays/threadpool.h>    // Uses Thread_Pool::thread_count(), run()
 #include <logger/logger.h>
 
 #define ATOMSTRUCT_EXPORT
@@ -38,6 +41,7 @@
 #include "AtomicStructure.h"
 #include "CompSS.h"
 #include "Coord.h"
+#include "CoordSet.h"
 #include "Residue.h"
 #include "search.h"
 
@@ -120,10 +124,20 @@ struct KsdsspParams {
     std::vector<Residue *>  residues;
     bool  report;
 	CompSSInfo*	ss_info;
-	AtomSearchTree* search_tree;
-	std::map<Atom*, std::vector<Residue*>::size_type> search_lookup;
+	std::vector<std::pair<std::size_t, std::size_t>>* candidate_pairs;
+	std::vector<std::pair<int, int>> hbond_list; // hbonded residue pairs, either direction
+	bool  threaded = true;
+	// if ss_codes is set, secondary structure types are recorded in it at the
+	// residue_indices positions instead of being assigned to the residues
+	unsigned char*  ss_codes = nullptr;
+	const std::vector<std::size_t>*  residue_indices = nullptr;
 };
 
+// Backbone N-N distance beyond which residues cannot be hydrogen bonded
+static const double HBOND_SEARCH_DIST = 10.0;
+// Fewest residue pairs per thread for hydrogen bond energies
+static const std::size_t MIN_THREAD_PAIRS = 20000;
+
 //
 // Find the imide hydrogen position if it is missing
 //
@@ -216,8 +230,6 @@ hbonded_to(KsdsspCoords *c1, KsdsspCoords *other_crds, float hbond_cutoff)
 static void
 find_hbonds(KsdsspParams& params)
 {
-	// it's okay for loop vars to be unsigned here, since we don't subtract from them
-    auto num_res = params.residues.size();
     std::vector<bool> is_pro;
     // mark prolines
     for (auto r: params.residues) {
@@ -230,24 +242,92 @@ find_hbonds(KsdsspParams& params)
         Atom *cd = r->find_atom("CD");
         is_pro.push_back(cd && std::find(nnb.begin(), nnb.end(), cd) != nnb.end());
     }
-    for (decltype(num_res) i = 0; i < num_res; ++i) {
-        KsdsspCoords *crds1 = params.coords[i];
-		for (auto near: params.search_tree->search(*(crds1->n), 10.0)) {
-			auto near_index = params.search_lookup[near];
-			if (near_index <= i+1)
-				continue;
-            KsdsspCoords *crds2 = params.coords[near_index];
+    // energies for each candidate pair are independent, so compute them in
+    // threads and then fill in the (bit-packed, not thread-safe) hbonds table
+    auto& pairs = *params.candidate_pairs;
+    std::vector<char> hbonded(2 * pairs.size());
+    auto pair_hbonds = [&params, &pairs, &is_pro, &hbonded](std::size_t start, std::size_t end) {
+        for (auto p = start; p < end; ++p) {
+            KsdsspCoords *crds1 = params.coords[pairs[p].first];
+            KsdsspCoords *crds2 = params.coords[pairs[p].second];
             // proline backbone nitrogen cannot donate
-            if (is_pro[near_index])
-                params.hbonds[i][near_index] = false;
-            else
-                params.hbonds[i][near_index] = hbonded_to(crds1, crds2, params.hbond_cutoff);
-            if (is_pro[i])
-                params.hbonds[near_index][i] = false;
-            else
-                params.hbonds[near_index][i] = hbonded_to(crds2, crds1, params.hbond_cutoff);
+            hbonded[2*p] = !is_pro[pairs[p].second]
+                && hbonded_to(crds1, crds2, params.hbond_cutoff);
+            hbonded[2*p+1] = !is_pro[pairs[p].first]
+                && hbonded_to(crds2, crds1, params.hbond_cutoff);
+        }
+    };
+    std::size_t np = pairs.size();
+    int num_threads = params.threaded ? Thread_Pool::thread_count(np, MIN_THREAD_PAIRS) : 1;
+    if (num_threads == 1)
+        pair_hbonds(0, np);
+    else
+        Thread_Pool::run(num_threads, [&](int t) {
+            pair_hbonds((t * np) / num_threads, ((t+1) * np) / num_threads);
+        });
+    for (std::size_t p = 0; p < pairs.size(); ++p) {
+        auto i = pairs[p].first, j = pairs[p].second;
+        params.hbonds[i][j] = hbonded[2*p];
+        params.hbonds[j][i] = hbonded[2*p+1];
+        if (hbonded[2*p] || hbonded[2*p+1])
+            params.hbond_list.push_back(std::make_pair((int)i, (int)j));
+    }
+}
+
+//
+// Find residue pairs whose backbone nitrogens are within a distance
+//
+static void
+close_n_pairs(const std::vector<Atom*>& ns, const std::vector<Coord>& n_coords, double dist,
+    std::vector<std::pair<std::size_t, std::size_t>>* pairs)
+{
+    std::unordered_map<Atom*, std::size_t> n_index;
+    for (std::size_t i = 0; i < ns.size(); ++i)
+        n_index[ns[i]] = i;
+    AtomCellList cells(ns, n_coords, dist);
+    for (auto& ap: cells.close_pairs(dist)) {
+        auto i = n_index[ap.first], j = n_index[ap.second];
+        if (i > j)
+            std::swap(i, j);
+        // adjacent residues aren't considered
+        if (j <= i+1)
+            continue;
+        pairs->push_back(std::make_pair(i, j));
+    }
+    std::sort(pairs->begin(), pairs->end());
+}
+
+//
+// Find residue pairs whose backbone nitrogens are close enough to be hydrogen
+// bonded, reusing the previous pairs if no nitrogen has moved more than the
+// tolerance since then
+//
+static void
+find_candidate_pairs(const std::vector<Atom*>& ns, float reuse_tolerance,
+    std::unique_ptr<CompSSCandidates>& cands)
+{
+    if (reuse_tolerance > 0 && cands && cands->tolerance == reuse_tolerance
+    && cands->n_atoms == ns) {
+        bool moved = false;
+        Real tol2 = reuse_tolerance * reuse_tolerance;
+        for (std::size_t i = 0; i < ns.size(); ++i) {
+            if (ns[i]->coord().sqdistance(cands->n_coords[i]) > tol2) {
+                moved = true;
+                break;
+            }
         }
+        if (!moved)
+            return;
     }
+
+    // all pairs within the search distance now are within this distance
+    // of each other until some nitrogen moves farther than the tolerance
+    cands.reset(new CompSSCandidates);
+    cands->n_atoms = ns;
+    cands->tolerance = reuse_tolerance;
+    for (auto n: ns)
+        cands->n_coords.push_back(n->coord());
+    close_n_pairs(ns, cands->n_coords, HBOND_SEARCH_DIST + 2 * reuse_tolerance, &cands->pairs);
 }
 
 //
@@ -460,28 +540,38 @@ find_bridges(KsdsspParams& params)
     for (auto& br: bridge)
         br.resize(max);
 
-    decltype(max) i;
-    for (i = 0; i < max-1; ++i) {
-		// we're looking for hbonds involving adjacent residues, so loosen search criteria
-		for (auto near: params.search_tree->search(*(params.coords[i]->n), 20.0)) {
-			int near_index = params.search_lookup[near];
-			if (near_index <= i)
-				continue;
-            if ((i > 0 && params.hbonds[i-1][near_index] && params.hbonds[near_index][i+1])
-            || (near_index < max-1 && params.hbonds[near_index-1][i] && params.hbonds[i][near_index+1])) {
-                bridge[i][near_index] = 'P';
-                params.rflags[params.residues[i]] |= DSSP_PBRIDGE;
-                params.rflags[params.residues[near_index]] |= DSSP_PBRIDGE;
-            }
-            else if ((params.hbonds[i][near_index] && params.hbonds[near_index][i])
-            || (i > 0 && near_index < max-1 && params.hbonds[i-1][near_index+1] && params.hbonds[near_index-1][i+1]))
-            {
-                bridge[i][near_index] = 'A';
-                params.rflags[params.residues[i]] |= DSSP_ABRIDGE;
-                params.rflags[params.residues[near_index]] |= DSSP_ABRIDGE;
+    // every bridge has an hbond between residues adjacent to (or the same as)
+    // the bridge partners, so look only near hbonded pairs
+    std::set<std::pair<int, int>> near_pairs;
+    for (auto& hb: params.hbond_list) {
+        for (int di = -1; di <= 1; ++di) {
+            for (int dj = -1; dj <= 1; ++dj) {
+                int a = hb.first + di, b = hb.second + dj;
+                if (a > b)
+                    std::swap(a, b);
+                if (a >= 0 && a < b && a < max-1 && b < max)
+                    near_pairs.insert(std::make_pair(a, b));
             }
         }
     }
+    decltype(max) i;
+    for (auto& near_pair: near_pairs) {
+        i = near_pair.first;
+        int near_index = near_pair.second;
+        if ((i > 0 && params.hbonds[i-1][near_index] && params.hbonds[near_index][i+1])
+        || (near_index < max-1 && params.hbonds[near_index-1][i] && params.hbonds[i][near_index+1])) {
+            bridge[i][near_index] = 'P';
+            params.rflags[params.residues[i]] |= DSSP_PBRIDGE;
+            params.rflags[params.residues[near_index]] |= DSSP_PBRIDGE;
+        }
+        else if ((params.hbonds[i][near_index] && params.hbonds[near_index][i])
+        || (i > 0 && near_index < max-1 && params.hbonds[i-1][near_index+1] && params.hbonds[near_index-1][i+1]))
+        {
+            bridge[i][near_index] = 'A';
+            params.rflags[params.residues[i]] |= DSSP_ABRIDGE;
+            params.rflags[params.residues[near_index]] |= DSSP_ABRIDGE;
+        }
+    }
 
     // Now we loop through and find the ladders
     decltype(i) k;
@@ -854,6 +944,10 @@ compute_chain(KsdsspParams& params)
         if (start_end.first > last)
             ++id;
         for (int i = start_end.first; i <= start_end.second; ++i) {
+            if (params.ss_codes != nullptr) {
+                params.ss_codes[(*params.residue_indices)[i]] = Residue::SS_STRAND;
+                continue;
+            }
             Residue *r = params.residues[i];
             r->set_is_strand(true);
             r->set_ss_id(id);
@@ -865,6 +959,10 @@ compute_chain(KsdsspParams& params)
     for (auto start_end: params.helices) {
         id++;
         for (int i = start_end.first; i <= start_end.second; ++i) {
+            if (params.ss_codes != nullptr) {
+                params.ss_codes[(*params.residue_indices)[i]] = Residue::SS_HELIX;
+                continue;
+            }
             Residue *r = params.residues[i];
             r->set_is_helix(true);
             r->set_ss_id(id);
@@ -880,7 +978,8 @@ compute_chain(KsdsspParams& params)
 
 void
 AtomicStructure::compute_secondary_structure(float energy_cutoff,
-    int min_helix_length, int min_strand_length, bool report, CompSSInfo* ss_info)
+    int min_helix_length, int min_strand_length, bool report, CompSSInfo* ss_info,
+    float reuse_tolerance)
 {
     // initialize
     KsdsspParams params;
@@ -913,7 +1012,6 @@ AtomicStructure::compute_secondary_structure(float energy_cutoff,
             
 
 			ns.push_back(n);
-			params.search_lookup[n] = params.residues.size();
             params.residues.push_back(r);
             KsdsspCoords *crds = new KsdsspCoords;
             params.coords.push_back(crds);
@@ -929,9 +1027,11 @@ AtomicStructure::compute_secondary_structure(float energy_cutoff,
             else
                 crds->h = nullptr;
         }
-		AtomSearchTree ast(ns, false, 10.0);
-		params.search_tree = &ast;
+		find_candidate_pairs(ns, reuse_tolerance, _ss_candidates);
+		params.candidate_pairs = &_ss_candidates->pairs;
         compute_chain(params);
+        if (reuse_tolerance <= 0)
+            _ss_candidates.reset();
         set_ss_assigned(true);
         ss_ids_normalized = false;
         for (auto crd: params.coords)
@@ -955,4 +1055,121 @@ AtomicStructure::compute_secondary_structure(float energy_cutoff,
     }
 }
 
+// Backbone atoms of the residues that can be assigned secondary structure
+struct KsdsspBackbone {
+    std::vector<Residue *>  residues;
+    std::vector<std::size_t>  residue_indices; // in structure residues
+    std::vector<Atom *>  c, n, ca, o, h; // h entries may be null
+};
+
+static const int BACKBONE_COORDS = 5; // c, n, ca, o, h per residue
+
+//
+// Compute secondary structure from one frame of backbone coordinates
+// without changing the residues
+//
+static void
+compute_frame(const KsdsspBackbone& bb, const Coord* xyz, float energy_cutoff,
+    int min_helix_length, int min_strand_length, unsigned char* ss_codes)
+{
+    KsdsspParams params;
+    params.hbond_cutoff = energy_cutoff;
+    params.min_helix_length = min_helix_length;
+    params.min_strand_length = min_strand_length;
+    params.report = false;
+    params.ss_info = nullptr;
+    params.threaded = false;
+    params.ss_codes = ss_codes;
+    params.residue_indices = &bb.residue_indices;
+    params.residues = bb.residues;
+    auto num_res = bb.residues.size();
+    std::vector<KsdsspCoords> crds(num_res);
+    std::vector<Coord> n_coords;
+    for (std::size_t i = 0; i < num_res; ++i) {
+        const Coord* rxyz = xyz + BACKBONE_COORDS * i;
+        crds[i].c = rxyz;
+        crds[i].n = rxyz + 1;
+        crds[i].ca = rxyz + 2;
+        crds[i].o = rxyz + 3;
+        crds[i].h = bb.h[i] ? rxyz + 4 : nullptr;
+        params.coords.push_back(&crds[i]);
+        n_coords.push_back(rxyz[1]);
+    }
+    std::vector<std::pair<std::size_t, std::size_t>> pairs;
+    close_n_pairs(bb.n, n_coords, HBOND_SEARCH_DIST, &pairs);
+    params.candidate_pairs = &pairs;
+    try {
+        compute_chain(params);
+    } catch (bad_coords_error&) {
+        // leave frame as all coil
+        for (auto ri: bb.residue_indices)
+            ss_codes[ri] = Residue::SS_COIL;
+    }
+    for (auto ih: params.imide_Hs)
+        delete ih;
+}
+
+void
+AtomicStructure::compute_frames_secondary_structure(const std::vector<CoordSet*>& frames,
+    unsigned char* ss_codes, float energy_cutoff, int min_helix_length,
+    int min_strand_length, int num_threads)
+{
+    // ss_codes is frames x residues, set to Residue::SSType values
+    KsdsspBackbone bb;
+    auto& res = residues();
+    for (std::size_t ri = 0; ri < res.size(); ++ri) {
+        Residue *r = res[ri];
+        Atom *c = r->find_atom("C");
+        Atom *n = r->find_atom("N");
+        Atom *ca = r->find_atom("CA");
+        Atom *o = r->find_atom("O");
+        if (!c || !n || !ca || !o)
+            continue;
+        bb.residues.push_back(r);
+        bb.residue_indices.push_back(ri);
+        bb.c.push_back(c);
+        bb.n.push_back(n);
+        bb.ca.push_back(ca);
+        bb.o.push_back(o);
+        bb.h.push_back(r->find_atom("H"));
+    }
+    std::size_t num_frames = frames.size(), num_res = res.size(), num_bb = bb.residues.size();
+    std::fill(ss_codes, ss_codes + num_frames * num_res, (unsigned char)Residue::SS_COIL);
+    if (num_threads < 1)
+        num_threads = 1;
+
+    // Coordinates are copied a few frames per thread at a time, serially since
+    // coordinate sets may decompress or read from a trajectory file when accessed.
+    std::size_t chunk = 4 * num_threads;
+    std::vector<Coord> xyz(chunk * BACKBONE_COORDS * num_bb);
+    for (std::size_t f0 = 0; f0 < num_frames; f0 += chunk) {
+        std::size_t nf = std::min(chunk, num_frames - f0);
+        for (std::size_t f = 0; f < nf; ++f) {
+            CoordSet* cs = frames[f0 + f];
+            Coord* fxyz = &xyz[f * BACKBONE_COORDS * num_bb];
+            for (std::size_t i = 0; i < num_bb; ++i) {
+                Coord* rxyz = fxyz + BACKBONE_COORDS * i;
+                rxyz[0] = bb.c[i]->coord(cs);
+                rxyz[1] = bb.n[i]->coord(cs);
+                rxyz[2] = bb.ca[i]->coord(cs);
+                rxyz[3] = bb.o[i]->coord(cs);
+                if (bb.h[i])
+                    rxyz[4] = bb.h[i]->coord(cs);
+            }
+            if (cs != active_coord_set())
+                cs->release_expanded();
+        }
+        auto compute_frames = [&, f0, nf](std::size_t start, std::size_t step) {
+            for (std::size_t f = start; f < nf; f += step)
+                compute_frame(bb, &xyz[f * BACKBONE_COORDS * num_bb], energy_cutoff,
+                    min_helix_length, min_strand_length, ss_codes + (f0 + f) * num_res);
+        };
+        int nt = Thread_Pool::thread_count(nf, 1, num_threads);
+        if (nt <= 1)
+            compute_frames(0, 1);
+        else
+            Thread_Pool::run(nt, [&](int t) { compute_frames(t, nt); });
+    }
+}
+
 }  // namespace atomstruct
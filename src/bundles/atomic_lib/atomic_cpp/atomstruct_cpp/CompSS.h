@@ -30,10 +30,12 @@
 #include <vector>
 #include <utility> // std::pair
 
+#include "Coord.h"
 #include "imex.h"
 
 namespace atomstruct {
 
+class Atom;
 class Residue;
 
 class ATOMSTRUCT_IMEX CompSSInfo
@@ -46,6 +48,18 @@ public:
         // helix ends, helix type using same characters as "dssp report true" (G, H, I)
 };
 
+// Pairs of backbone nitrogens close enough that their residues might be
+// hydrogen bonded, kept so that secondary structure for slightly moved
+// coordinates (e.g. the next trajectory frame) needn't search for them again
+class ATOMSTRUCT_IMEX CompSSCandidates
+{
+public:
+    std::vector<Atom*> n_atoms;
+    std::vector<Coord> n_coords; // when pairs were found
+    float tolerance; // pairs found within search distance plus twice this
+    std::vector<std::pair<std::size_t, std::size_t>> pairs; // indices into n_atoms, first < second
+};
+
 }  // namespace atomstruct
 
 #endif  // atomstruct_CompSS
@@ -24,6 +24,10 @@
  * === UCSF ChimeraX Copyright ===
  */
 
+#include <algorithm>  // for std::max
+#include <cmath>  // for std::lround
+#include <cstring>  // for memcpy
+#include <stdexcept>  // for std::out_of_range
 #include <utility>  // for pair
 
 #define ATOMSTRUCT_EXPORT
@@ -33,6 +37,7 @@
 #include "CoordSet.h"
 #include "destruct.h"
 #include "Structure.h"
+#include "TrajectoryFile.h"
 
 #include <pyinstance/PythonInstance.instantiate.h>
 template class pyinstance::PythonInstance<atomstruct::CoordSet>;
@@ -54,25 +59,205 @@ CoordSet::CoordSet(Structure* as, int cs_id, int size):
 
 CoordSet::~CoordSet()
 {
+    if (_trajectory)
+        _trajectory->unloaded(this);
     if (DestructionCoordinator::destruction_parent() != _structure)
         _structure->pb_mgr().remove_cs(this);
     _structure->change_tracker()->add_deleted(_structure, this);
 }
 
+CoordSet&
+CoordSet::operator=(const CoordSet& source)
+{
+    if (this != &source) {
+        if (_trajectory)
+            _trajectory->unloaded(this);
+        _bfactor_map = source._bfactor_map; _occupancy_map = source._occupancy_map;
+        _compression = source._compression;
+        _xyz_float32 = source._xyz_float32; _xyz_int16 = source._xyz_int16;
+        for (int a = 0; a < 3; ++a)
+            _int16_origin[a] = source._int16_origin[a];
+        _int16_scale = source._int16_scale;
+        _compressed_size = source._compressed_size;
+        _compressed_stale = source._compressed_stale;
+        _trajectory = source._trajectory;
+        _trajectory_frame = source._trajectory_frame;
+        if (_trajectory) {
+            // Share the file rather than the expanded frame.
+            Coords().swap(_coords);
+            _expanded = false;
+        } else {
+            _coords = source._coords;
+            _expanded = source._expanded;
+        }
+    }
+    return *this;
+}
+
 void
 CoordSet::set_coords(Real *xyz, size_t n)
 {
-    size_t nc = _coords.size();
-    size_t c = 0;
-    for (size_t i = 0 ; i < nc ; ++i, c += 3)
-        _coords[i].set_xyz(xyz[c], xyz[c+1], xyz[c+2]);
-    for (size_t i = nc ; i < n ; ++i, c += 3)
-        add_coord(Coord(xyz[c], xyz[c+1], xyz[c+2]));
+    Coords& coords = _writable_coords();
+    if (n > coords.size())
+        coords.resize(n);
+    if (n > 0)
+        std::memcpy(&coords[0][0], xyz, 3 * n * sizeof(Real));
 
     _structure->change_tracker()->add_modified(_structure, this, ChangeTracker::REASON_COORDSET);
-    if (_structure->active_coord_set() == this)
+    if (_structure->active_coord_set() == this) {
         _structure->change_tracker()->add_modified(_structure, _structure,
             ChangeTracker::REASON_SCENE_COORD);
+        if (n >= _structure->atoms().size())
+            _structure->change_tracker()->add_modified(_structure, _structure,
+                ChangeTracker::REASON_COORDS_REPLACED);
+    }
+}
+
+void
+CoordSet::set_compression(Compression c)
+{
+    if (c == _compression || _trajectory)
+        return;
+    _expand();
+    _compression = c;
+    _xyz_float32.clear(); _xyz_float32.shrink_to_fit();
+    _xyz_int16.clear(); _xyz_int16.shrink_to_fit();
+    _compressed_stale = true;
+    if (_structure->active_coord_set() != this)
+        release_expanded();
+}
+
+void
+CoordSet::release_expanded()
+{
+    if (_trajectory) {
+        if (_expanded) {
+            Coords().swap(_coords);
+            _expanded = false;
+            _trajectory->unloaded(this);
+        }
+        return;
+    }
+    if (_compression == COMPRESS_NONE || !_expanded)
+        return;
+    if (_compressed_stale)
+        _compress();
+    Coords().swap(_coords);
+    _expanded = false;
+}
+
+void
+CoordSet::set_trajectory(const std::shared_ptr<TrajectoryFile>& trajectory, size_t frame)
+{
+    if (_trajectory)
+        _trajectory->unloaded(this);
+    set_compression(COMPRESS_NONE);
+    _trajectory = trajectory;
+    _trajectory_frame = frame;
+    _compressed_size = trajectory->num_coords();
+    Coords().swap(_coords);
+    _expanded = false;
+}
+
+void
+CoordSet::copy_xyz(const std::vector<size_t>& indices, Real* xyz) const
+{
+    Coords expanded;
+    const Coords* coords = &_coords;
+    if (!_expanded) {
+        if (_trajectory)
+            _trajectory->read_frame_uncached(_trajectory_frame, expanded);
+        else
+            _decompress(expanded);
+        coords = &expanded;
+    }
+    size_t n = coords->size();
+    for (auto i: indices) {
+        if (i >= n)
+            throw std::out_of_range("Coordinate index out of range for coordset");
+        const Coord& c = (*coords)[i];
+        *xyz++ = c[0]; *xyz++ = c[1]; *xyz++ = c[2];
+    }
+}
+
+void
+CoordSet::_coords_changed()
+{
+    if (_structure->active_coord_set() == this)
+        _structure->coords_changed();
+}
+
+void
+CoordSet::_detach_trajectory()
+{
+    _trajectory->unloaded(this);
+    _trajectory.reset();
+}
+
+void
+CoordSet::_expand() const
+{
+    if (_expanded)
+        return;
+    _decompress(_coords);
+    _expanded = true;
+    if (_trajectory)
+        _trajectory->loaded(const_cast<CoordSet*>(this));
+}
+
+void
+CoordSet::_compress()
+{
+    size_t n = _coords.size();
+    _compressed_size = n;
+    _compressed_stale = false;
+    if (_compression == COMPRESS_FLOAT32) {
+        _xyz_float32.resize(3 * n);
+        float* xyz = _xyz_float32.data();
+        for (auto& c: _coords) {
+            *xyz++ = c[0]; *xyz++ = c[1]; *xyz++ = c[2];
+        }
+    } else if (_compression == COMPRESS_INT16) {
+        // Fixed point with one scale for all axes, like XTC precision.
+        Real xyz_max[3];
+        for (int a = 0; a < 3; ++a)
+            _int16_origin[a] = xyz_max[a] = (n > 0 ? _coords[0][a] : 0.0);
+        for (auto& c: _coords)
+            for (int a = 0; a < 3; ++a) {
+                if (c[a] < _int16_origin[a]) _int16_origin[a] = c[a];
+                if (c[a] > xyz_max[a]) xyz_max[a] = c[a];
+            }
+        Real range = std::max(xyz_max[0] - _int16_origin[0],
+            std::max(xyz_max[1] - _int16_origin[1], xyz_max[2] - _int16_origin[2]));
+        _int16_scale = (range > 0 ? range / 65535 : 1.0);
+        _xyz_int16.resize(3 * n);
+        uint16_t* q = _xyz_int16.data();
+        for (auto& c: _coords)
+            for (int a = 0; a < 3; ++a)
+                *q++ = static_cast<uint16_t>(std::lround((c[a] - _int16_origin[a]) / _int16_scale));
+    }
+}
+
+void
+CoordSet::_decompress(Coords& coords) const
+{
+    if (_trajectory) {
+        _trajectory->read_frame(_trajectory_frame, coords);
+        return;
+    }
+    size_t n = _compressed_size;
+    coords.resize(n);
+    if (_compression == COMPRESS_FLOAT32) {
+        const float* xyz = _xyz_float32.data();
+        for (size_t i = 0; i < n; ++i, xyz += 3)
+            coords[i].set_xyz(xyz[0], xyz[1], xyz[2]);
+    } else if (_compression == COMPRESS_INT16) {
+        const uint16_t* q = _xyz_int16.data();
+        const Real* o = _int16_origin;
+        Real s = _int16_scale;
+        for (size_t i = 0; i < n; ++i, q += 3)
+            coords[i].set_xyz(o[0] + s*q[0], o[1] + s*q[1], o[2] + s*q[2]);
+    }
 }
 
 float
@@ -112,8 +297,9 @@ CoordSet::session_restore(int /*version*/, int** ints, float** floats)
     }
 
     auto num_coords = *int_ptr++;
+    Coords& coords = _writable_coords();
     for (decltype(num_coords)i = 0; i < num_coords; ++i) {
-        _coords.emplace_back(float_ptr[0], float_ptr[1], float_ptr[2]);
+        coords.emplace_back(float_ptr[0], float_ptr[1], float_ptr[2]);
         float_ptr += 3;
     }
 }
@@ -123,12 +309,12 @@ CoordSet::session_save(int** ints, float** floats) const
 {
     auto& int_ptr = *ints;
     auto& float_ptr = *floats;
-    auto& atom_map = *structure()->session_save_atoms;
+    auto s = structure();
 
     int_ptr[0] = _bfactor_map.size();
     int_ptr++;
     for (auto atom_bf : _bfactor_map) {
-        int_ptr[0] = atom_map[atom_bf.first];
+        int_ptr[0] = s->atom_index(atom_bf.first);
         float_ptr[0]  = atom_bf.second;
         int_ptr++; float_ptr++;
     }
@@ -136,14 +322,21 @@ CoordSet::session_save(int** ints, float** floats) const
     int_ptr[0] = _occupancy_map.size();
     int_ptr++;
     for (auto atom_occ : _occupancy_map) {
-        int_ptr[0] = atom_map[atom_occ.first];
+        int_ptr[0] = s->atom_index(atom_occ.first);
         float_ptr[0]  = atom_occ.second;
         int_ptr++; float_ptr++;
     }
 
-    int_ptr[0] = _coords.size();
+    // Don't leave compressed coordsets expanded after saving.
+    Coords expanded;
+    const Coords* coords = &_coords;
+    if (!_expanded) {
+        _decompress(expanded);
+        coords = &expanded;
+    }
+    int_ptr[0] = coords->size();
     int_ptr++;
-    for (auto crd: _coords) {
+    for (auto& crd: *coords) {
         float_ptr[0] = crd[0];
         float_ptr[1] = crd[1];
         float_ptr[2] = crd[2];
@@ -154,9 +347,10 @@ CoordSet::session_save(int** ints, float** floats) const
 void
 CoordSet::xform(PositionMatrix mat)
 {
-    size_t nc = _coords.size();
+    Coords& coords = _writable_coords();
+    size_t nc = coords.size();
     for (size_t i = 0 ; i < nc ; ++i)
-        _coords[i].xform(mat);
+        coords[i].xform(mat);
 }
 
 }  // namespace atomstruct
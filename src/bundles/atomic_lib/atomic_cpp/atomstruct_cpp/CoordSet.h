@@ -27,7 +27,9 @@
 #ifndef atomstruct_CoordSet
 #define atomstruct_CoordSet
 
+#include <memory>
 #include <pyinstance/PythonInstance.declare.h>
+#include <stdint.h>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -38,51 +40,99 @@
 
 namespace atomstruct {
 
+static_assert(sizeof(Coord) == 3 * sizeof(Real), "Coord must be 3 contiguous Reals");
+
+class TrajectoryFile;
+
 class ATOMSTRUCT_IMEX CoordSet: public pyinstance::PythonInstance<CoordSet> {
     friend class Atom;
     friend class Structure;
 
 public:
     typedef std::vector<Coord>  Coords;
+    // Compressed coordsets (e.g. long trajectories) keep float32 or 16-bit
+    // fixed point coordinates and only expand them while in use.  Coordsets
+    // with a trajectory file instead read their frame from the file.
+    enum Compression { COMPRESS_NONE, COMPRESS_FLOAT32, COMPRESS_INT16 };
 
 private:
-    Coords  _coords;
+    mutable Coords  _coords;
     int  _cs_id;
     std::unordered_map<const Atom *, float>  _bfactor_map;
     std::unordered_map<const Atom *, float>  _occupancy_map;
     Structure*  _structure;
+    Compression  _compression = COMPRESS_NONE;
+    std::vector<float>  _xyz_float32;
+    std::vector<uint16_t>  _xyz_int16;
+    Real  _int16_origin[3] = {0.0, 0.0, 0.0};
+    Real  _int16_scale = 1.0;
+    size_t  _compressed_size = 0;
+    mutable bool  _expanded = true;
+    bool  _compressed_stale = false;    // expanded coords changed since compression
+    std::shared_ptr<TrajectoryFile>  _trajectory;
+    size_t  _trajectory_frame = 0;
     CoordSet(Structure* as, int cs_id);
     CoordSet(Structure* as, int cs_id, int size);
+    void  _compress();
+    void  _decompress(Coords& coords) const;
+    void  _coords_changed();
+    void  _detach_trajectory();
+    void  _expand() const;
+    Coords&  _writable_coords() {
+        _expand();
+        _coords_changed();
+        if (_trajectory) _detach_trajectory();  // modified frame is kept in memory
+        _compressed_stale = true;
+        return _coords;
+    }
 
 public:
-    CoordSet& operator=(const CoordSet& source) {
-        if (this != &source) {
-            _coords = source._coords;
-            _bfactor_map = source._bfactor_map; _occupancy_map = source._occupancy_map;
-        }
-        return *this;
-    }
-    void  add_coord(const Point& coord) { _coords.push_back(coord); }
+    CoordSet& operator=(const CoordSet& source);
+    void  add_coord(const Point& coord) { _writable_coords().push_back(coord); }
     void  add_coords(const CoordSet* coords) {
-        _coords.insert(_coords.end(), coords->coords().begin(), coords->coords().end());
+        const Coords& c = coords->coords();
+        Coords& wc = _writable_coords();
+        wc.insert(wc.end(), c.begin(), c.end());
     }
-    const Coords &  coords() const { return _coords; }
+    const Coords &  coords() const { _expand(); return _coords; }
+    // Number of coordinates without expanding a compressed coordset.
+    size_t  coords_size() const { return _expanded ? _coords.size() : _compressed_size; }
+    // Coordinates as a contiguous N by 3 array, invalidated if coordinates are added.
+    const Real*  xyz() const { _expand(); return _coords.empty() ? nullptr : &_coords[0][0]; }
     void set_coords(Real* xyz, size_t n);
+    // Copy the coordinates with the given indices into an n by 3 array without
+    // expanding a compressed or trajectory coordset, so several threads can
+    // read different coordsets at once.
+    void  copy_xyz(const std::vector<size_t>& indices, Real* xyz) const;
+    Compression  compression() const { return _compression; }
+    void  set_compression(Compression c);
+    // Free the expanded coordinates of a compressed or trajectory coordset.
+    void  release_expanded();
+    const std::shared_ptr<TrajectoryFile>&  trajectory() const { return _trajectory; }
+    size_t  trajectory_frame() const { return _trajectory_frame; }
+    // Read coordinates from a trajectory file frame when first used.
+    void  set_trajectory(const std::shared_ptr<TrajectoryFile>& trajectory, size_t frame);
     virtual  ~CoordSet();
     float  get_bfactor(const Atom*) const;
     float  get_occupancy(const Atom*) const;
-    void  fill(const CoordSet* source) { _coords = source->_coords; }
+    void  fill(const CoordSet* source) { _writable_coords() = source->coords(); }
     int  id() const { return _cs_id; }
     int  session_num_floats(int /*version*/=CURRENT_SESSION_VERSION) const {
-        return _bfactor_map.size() + _occupancy_map.size() + 3 * _coords.size();
+        return _bfactor_map.size() + _occupancy_map.size() + 3 * coords_size();
     }
     int  session_num_ints(int /*version*/=CURRENT_SESSION_VERSION) const {
         return _bfactor_map.size() + _occupancy_map.size() + 3;
     }
     void  session_restore(int version, int** ints, float** floats);
     void  session_save(int** ints, float** floats) const;
-    void  set_bfactor(const Atom* a, float val) { _bfactor_map[a] = val; }
-    void  set_occupancy(const Atom* a, float val) { _occupancy_map[a] = val; }
+    // Default values are not stored so frames without per-atom values
+    // don't each hold a map entry for every atom.
+    void  set_bfactor(const Atom* a, float val) {
+        if (val == 0.0) _bfactor_map.erase(a); else _bfactor_map[a] = val;
+    }
+    void  set_occupancy(const Atom* a, float val) {
+        if (val == 1.0) _occupancy_map.erase(a); else _occupancy_map[a] = val;
+    }
     Structure*  structure() const { return _structure; }
     void  xform(PositionMatrix);
 };
@@ -0,0 +1,128 @@
+// vi: set expandtab ts=4 sw=4:
+
+/*
+ * === UCSF ChimeraX Copyright ===
+ * Copyright 2022 Regents of the University of California. All rights reserved.
+ * The ChimeraX application is provided pursuant to the ChimeraX license
+ * agreement, which covers academic and commercial uses. For more details, see
+ * <http://www.rbvi.ucsf.edu/chimerax/docs/licensing.html>
+ *
+ * This particular file is part of the ChimeraX library. You can also
+ * redistribute and/or modify it under the terms of the GNU Lesser General
+ * Public License version 2.1 as published by the Free Software Foundation.
+ * For more details, see
+ * <https://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESSED OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. ADDITIONAL LIABILITY
+ * LIMITATIONS ARE DESCRIBED IN THE GNU LESSER GENERAL PUBLIC LICENSE
+ * VERSION 2.1
+ *
+ * This notice must be embedded in or attached to all copies, including partial
+ * copies, of the software or any revisions or derivations thereof.
+ * === UCSF ChimeraX Copyright ===
+ */
+
+#ifndef atomstruct_ObjectPool
+#define atomstruct_ObjectPool
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+namespace atomstruct {
+
+// Slab allocator for a structure's atoms, bonds and residues.  Objects are
+// carved out of large blocks so that reading a huge structure doesn't make
+// a heap allocation per object, objects made together sit together in memory,
+// and freed slots are reused.  Every slot starts with a header pointing to its
+// pool (null for objects allocated individually) so that the class operator
+// delete can return the slot.  The owning structure orphans the pool when it
+// is destroyed; the blocks are then released together once the last object
+// is gone.
+class ObjectPool {
+    static const std::size_t  HEADER_SIZE = alignof(std::max_align_t) > sizeof(void*) ?
+        alignof(std::max_align_t) : sizeof(void*);
+    static const std::size_t  SLOTS_PER_BLOCK = 4096;
+
+    std::size_t  _object_size;
+    std::size_t  _slot_size;
+    std::vector<char*>  _blocks;
+    std::size_t  _block_used = SLOTS_PER_BLOCK;
+    void*  _free_slots = nullptr; // singly linked through the slots
+    std::size_t  _in_use = 0;
+    bool  _orphaned = false;
+
+    ~ObjectPool() {
+        for (auto block: _blocks)
+            std::free(block);
+    }
+    void*  _slot() {
+        if (_free_slots != nullptr) {
+            void* slot = _free_slots;
+            _free_slots = *static_cast<void**>(slot);
+            return slot;
+        }
+        if (_block_used == SLOTS_PER_BLOCK) {
+            char* block = static_cast<char*>(std::malloc(SLOTS_PER_BLOCK * _slot_size));
+            if (block == nullptr)
+                throw std::bad_alloc();
+            _blocks.push_back(block);
+            _block_used = 0;
+        }
+        return _blocks.back() + _slot_size * _block_used++;
+    }
+    void  _release(void* slot) {
+        *static_cast<void**>(slot) = _free_slots;
+        _free_slots = slot;
+        if (--_in_use == 0 && _orphaned)
+            delete this;
+    }
+
+public:
+    ObjectPool(std::size_t object_size): _object_size(object_size),
+        _slot_size((HEADER_SIZE + object_size + HEADER_SIZE - 1) / HEADER_SIZE * HEADER_SIZE) {}
+    ObjectPool(const ObjectPool&) = delete;
+    ObjectPool&  operator=(const ObjectPool&) = delete;
+    // bytes of the blocks allocated so far, including free slots
+    std::size_t  reserved_bytes() const { return _blocks.size() * SLOTS_PER_BLOCK * _slot_size; }
+
+    // class operator new/delete implementations
+    static void*  allocate(ObjectPool* pool, std::size_t size) {
+        char* slot;
+        if (pool == nullptr || size > pool->_object_size) {
+            slot = static_cast<char*>(std::malloc(HEADER_SIZE + size));
+            if (slot == nullptr)
+                throw std::bad_alloc();
+            pool = nullptr;
+        } else {
+            slot = static_cast<char*>(pool->_slot());
+            ++pool->_in_use;
+        }
+        *reinterpret_cast<ObjectPool**>(slot) = pool;
+        return slot + HEADER_SIZE;
+    }
+    static void  deallocate(void* p) {
+        if (p == nullptr)
+            return;
+        char* slot = static_cast<char*>(p) - HEADER_SIZE;
+        ObjectPool* pool = *reinterpret_cast<ObjectPool**>(slot);
+        if (pool == nullptr)
+            std::free(slot);
+        else
+            pool->_release(slot);
+    }
+
+    // called by the owner instead of deleting the pool
+    void  orphan() {
+        _orphaned = true;
+        if (_in_use == 0)
+            delete this;
+    }
+};
+
+}  // namespace atomstruct
+
+#endif  // atomstruct_ObjectPool
@@ -40,7 +40,7 @@ template class pyinstance::PythonInstance<atomstruct::PBGroup>;
 namespace atomstruct {
 
 PBGroup::PBGroup(const std::string& cat, BaseManager* manager):
-    _category(cat), _destruction_relevant(true), _manager(manager), _proxy(nullptr)
+    DestructionObserver(DESTROYED_ATOMS), _category(cat), _destruction_relevant(true), _manager(manager), _proxy(nullptr)
 { }
 
 void
@@ -52,29 +52,28 @@ StructurePBGroupBase::_check_structure(Atom* a1, Atom* a2)
 }
 
 void
-PBGroup::_check_destroyed_atoms(PBGroup::Pseudobonds& pbonds, const std::set<void*>& destroyed)
+PBGroup::_check_destroyed_atoms(PBGroup::Pseudobonds& pbonds, const std::unordered_set<void*>& destroyed)
 {
-    PBGroup::Pseudobonds remaining;
-    for (auto pb: pbonds) {
+    // erase in place rather than building a set of the (typically many more)
+    // remaining pseudobonds
+    bool removed = false;
+    for (auto pbi = pbonds.begin(); pbi != pbonds.end();) {
+        auto pb = *pbi;
         auto& pb_atoms = pb->atoms();
         if (destroyed.find(static_cast<void*>(pb_atoms[0])) != destroyed.end()
         || destroyed.find(static_cast<void*>(pb_atoms[1])) != destroyed.end()) {
+            pbi = pbonds.erase(pbi);
             delete pb;
-        } else {
-            remaining.insert(pb);
-        }
+            removed = true;
+        } else
+            ++pbi;
     }
-    if (remaining.size() == 0) {
-        pbonds.clear();
-        set_gc_shape();
-    } else if (remaining.size() != pbonds.size()) {
-        pbonds.swap(remaining);
+    if (removed || pbonds.empty())
         set_gc_shape();
-    }
 }
 
 void
-CS_PBGroup::check_destroyed_atoms(const std::set<void*>& destroyed)
+CS_PBGroup::check_destroyed_atoms(const std::unordered_set<void*>& destroyed)
 {
     auto db = DestructionBatcher(this);
     for (auto& cs_pbs: _pbonds)
@@ -82,7 +81,7 @@ CS_PBGroup::check_destroyed_atoms(const std::set<void*>& destroyed)
 }
 
 void
-StructurePBGroup::check_destroyed_atoms(const std::set<void*>& destroyed)
+StructurePBGroup::check_destroyed_atoms(const std::unordered_set<void*>& destroyed)
 {
     auto db = DestructionBatcher(this);
     _check_destroyed_atoms(_pbonds, destroyed);
@@ -122,6 +121,15 @@ CS_PBGroup::~CS_PBGroup()
         for (auto pb: name_pbs.second)
             delete pb;
     }
+    if (_pb_pool != nullptr)
+        _pb_pool->orphan();
+}
+
+StructurePBGroup::~StructurePBGroup()
+{
+    dtor_code();
+    if (_pb_pool != nullptr)
+        _pb_pool->orphan();
 }
 
 void
@@ -208,7 +216,9 @@ Pseudobond*
 CS_PBGroup::new_pseudobond(Atom* a1, Atom* a2, CoordSet* cs)
 {
     _check_structure(a1, a2);
-    Pseudobond* pb = static_cast<Pseudobond*>(new CS_Pseudobond(a1, a2, this, cs));
+    if (_pb_pool == nullptr)
+        _pb_pool = new ObjectPool(sizeof(CS_Pseudobond));
+    Pseudobond* pb = static_cast<Pseudobond*>(new (_pb_pool) CS_Pseudobond(a1, a2, this, cs));
     pb->set_color(color());
     pb->set_halfbond(halfbond());
     pb->set_radius(radius());
@@ -229,7 +239,9 @@ Pseudobond*
 StructurePBGroup::new_pseudobond(Atom* a1, Atom* a2)
 {
     _check_structure(a1, a2);
-    Pseudobond* pb = new Pseudobond(a1, a2, this);
+    if (_pb_pool == nullptr)
+        _pb_pool = new ObjectPool(sizeof(Pseudobond));
+    Pseudobond* pb = new (_pb_pool) Pseudobond(a1, a2, this);
     pb->finish_construction();
     pb->set_color(color());
     pb->set_halfbond(halfbond());
@@ -295,7 +307,7 @@ StructurePBGroupBase::session_note_pb_ctor_info(Pseudobond* pb, int** ints) cons
             int_ptr[0] = s_id;
             int_ptr++;
         }
-        int_ptr[0] = (*(s->session_save_atoms))[a];
+        int_ptr[0] = s->atom_index(a);
         int_ptr++;
     }
 }
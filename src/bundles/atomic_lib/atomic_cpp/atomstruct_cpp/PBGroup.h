@@ -32,6 +32,7 @@
 #include <stdexcept>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #include "ChangeTracker.h"
@@ -53,6 +54,7 @@ namespace atomstruct {
 
 class Atom;
 class CoordSet;
+class ObjectPool;
 class Pseudobond;
 class Proxy_PBGroup;
 class Structure;
@@ -84,7 +86,7 @@ protected:
     // make the code easily available to derived classes...
     void  dtor_code();
 
-    void _check_destroyed_atoms(PBGroup::Pseudobonds& pbonds, const std::set<void*>& destroyed);
+    void _check_destroyed_atoms(PBGroup::Pseudobonds& pbonds, const std::unordered_set<void*>& destroyed);
     void delete_pbs_check(const std::set<Pseudobond*>& pbs) const;
 public:
     virtual void  clear() = 0;
@@ -94,10 +96,10 @@ public:
         _manager->change_category(this->_proxy, category); // may throw invalid_argument
         _category = category;
     }
-    virtual void  check_destroyed_atoms(const std::set<void*>& destroyed) = 0;
+    virtual void  check_destroyed_atoms(const std::unordered_set<void*>& destroyed) = 0;
     virtual void  delete_pseudobond(Pseudobond* pb) = 0;
     virtual void  delete_pseudobonds(const std::set<Pseudobond*>& pbs) = 0;
-    virtual void  destructors_done(const std::set<void*>& destroyed) {
+    virtual void  destructors_done(const std::unordered_set<void*>& destroyed) {
         if (!_destruction_relevant)
             return;
         check_destroyed_atoms(destroyed);
@@ -167,12 +169,13 @@ public:
 private:
     friend class Proxy_PBGroup;
     Pseudobonds  _pbonds;
+    ObjectPool*  _pb_pool = nullptr;
 protected:
     StructurePBGroup(const std::string& cat, Structure* as, BaseManager* manager):
         StructurePBGroupBase(cat, as, manager) {}
-    ~StructurePBGroup() { dtor_code(); }
+    ~StructurePBGroup();
 public:
-    void  check_destroyed_atoms(const std::set<void*>& destroyed);
+    void  check_destroyed_atoms(const std::unordered_set<void*>& destroyed);
     void  clear();
     void  delete_pseudobond(Pseudobond* pb);
     void  delete_pseudobonds(const std::set<Pseudobond*>& pbs);
@@ -197,6 +200,7 @@ public:
 private:
     friend class Proxy_PBGroup;
     mutable std::unordered_map<const CoordSet*, Pseudobonds>  _pbonds;
+    ObjectPool*  _pb_pool = nullptr;
     void  change_cs(const CoordSet* cs);
     void  remove_cs(const CoordSet* cs);
 protected:
@@ -204,7 +208,7 @@ protected:
         StructurePBGroupBase(cat, as, manager) {}
     ~CS_PBGroup();
 public:
-    void  check_destroyed_atoms(const std::set<void*>& destroyed);
+    void  check_destroyed_atoms(const std::unordered_set<void*>& destroyed);
     void  clear();
     void  delete_pseudobond(Pseudobond* pb);
     void  delete_pseudobonds(const std::set<Pseudobond*>& pbs);
@@ -283,7 +287,7 @@ public:
             return static_cast<StructurePBGroup*>(_proxied)->change_category(category);
         return static_cast<CS_PBGroup*>(_proxied)->change_category(category);
     }
-    void  check_destroyed_atoms(const std::set<void*>& destroyed) {
+    void  check_destroyed_atoms(const std::unordered_set<void*>& destroyed) {
         if (_group_type == AS_PBManager::GRP_NORMAL)
             static_cast<StructurePBGroup*>(_proxied)->check_destroyed_atoms(destroyed);
         static_cast<CS_PBGroup*>(_proxied)->check_destroyed_atoms(destroyed);
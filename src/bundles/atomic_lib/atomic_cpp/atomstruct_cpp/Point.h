@@ -36,6 +36,8 @@
 
 namespace atomstruct {
     
+// Point has no virtual methods so that a vector of Points is a contiguous
+// array of x,y,z values that can be copied in bulk (see CoordSet::xyz()).
 class ATOMSTRUCT_IMEX Point {
     Real  _xyz[3];
 public:
@@ -48,7 +50,6 @@ public:
     Point() {
         _xyz[0] = _xyz[1] = _xyz[2] = 0.0;
     }
-    virtual  ~Point() {}
     Real  angle(const Point& pt1, const Point& pt3) const;
     static Real  angle(const Point& pt1, const Point& pt2, const Point& pt3) {
         return pt2.angle(pt1, pt3);
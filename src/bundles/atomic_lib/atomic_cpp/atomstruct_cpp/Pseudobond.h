@@ -31,6 +31,7 @@
 
 #include "Connection.h"
 #include "imex.h"
+#include "ObjectPool.h"
 #include "session.h"
 
 // "forward declare" PyObject, which is a typedef of a struct,
@@ -70,6 +71,12 @@ protected:
     const char*  err_msg_not_end() const
         { return "Atom given to other_end() not in pseudobond!"; }
 public:
+    // allocated from the group's ObjectPool
+    static void*  operator new(std::size_t size) { return ObjectPool::allocate(nullptr, size); }
+    static void*  operator new(std::size_t size, ObjectPool* pool)
+        { return ObjectPool::allocate(pool, size); }
+    static void  operator delete(void* p) { ObjectPool::deallocate(p); }
+    static void  operator delete(void* p, ObjectPool*) { ObjectPool::deallocate(p); }
     ChangeTracker*  change_tracker() const;
     void  copy_style(const Pseudobond*);
     GraphicsChanges*  graphics_changes() const;
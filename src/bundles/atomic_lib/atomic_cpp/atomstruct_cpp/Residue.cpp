@@ -28,6 +28,7 @@
 #include <cctype>  // for islower
 #include <set>
 #include <sstream>
+#include <unordered_map>
 #include <utility>  // for pair
 
 #define ATOMSTRUCT_EXPORT
@@ -180,6 +181,40 @@ Residue::bonds_between(const Residue* other_res, bool just_first) const
     return tweeners;
 }
 
+std::string
+Residue::connectivity_key() const
+{
+    // Atoms are identified by their order in the residue; atoms bonded to other
+    // residues are marked with '+', so the key also determines which atoms are terminal.
+    std::unordered_map<const Atom*, size_t> index;
+    for (size_t i = 0; i < _atoms.size(); ++i)
+        index[_atoms[i]] = i;
+    std::string key(_name.c_str());
+    std::string bonds;
+    for (size_t i = 0; i < _atoms.size(); ++i) {
+        Atom* a = _atoms[i];
+        key += '\001';
+        key += a->name().c_str();
+        bool external = false;
+        for (auto nb: a->neighbors()) {
+            auto ii = index.find(nb);
+            if (ii == index.end())
+                external = true;
+            else if (ii->second > i) {
+                bonds += std::to_string(i);
+                bonds += '-';
+                bonds += std::to_string(ii->second);
+                bonds += ',';
+            }
+        }
+        if (external)
+            key += '+';
+    }
+    key += '\002';
+    key += bonds;
+    return key;
+}
+
 bool
 Residue::connects_to(const Residue* other_res, bool check_pseudobonds) const
 {
@@ -233,7 +268,7 @@ Residue::delete_alt_loc(char alt_loc)
         if (a->has_alt_loc(alt_loc)) {
             have_alt_loc = true;
             for (auto nb: a->neighbors()) {
-                if (nb->residue() != this && nb->alt_locs() == a->alt_locs())
+                if (nb->residue() != this && nb->has_same_alt_locs(a))
                     nb_res.insert(nb->residue());
             }
             a->delete_alt_loc(alt_loc);
@@ -346,6 +381,19 @@ Residue::remove_atom(Atom* a)
     _atoms.erase(std::find(_atoms.begin(), _atoms.end(), a));
 }
 
+void
+Residue::remove_atoms(const std::unordered_set<Atom*>& atoms)
+{
+    // one compaction pass rather than an erase per atom
+    auto new_end = std::remove_if(_atoms.begin(), _atoms.end(),
+        [&atoms](Atom* a) {
+            bool rm = atoms.find(a) != atoms.end();
+            if (rm) a->_residue = nullptr;
+            return rm;
+        });
+    _atoms.erase(new_end, _atoms.end());
+}
+
 void
 Residue::session_restore(int version, int** ints, float** floats)
 {
@@ -440,9 +488,8 @@ Residue::session_save(int** ints, float** floats) const
     float_ptr[0] = _ribbon_adjust;
     float_ptr += SESSION_NUM_FLOATS();
 
-    auto& atom_map = *structure()->session_save_atoms;
     for (auto a: atoms()) {
-        *int_ptr++ = atom_map[a];
+        *int_ptr++ = structure()->atom_index(a);
     }
 
 }
@@ -459,7 +506,7 @@ Residue::set_alt_loc(char alt_loc)
             a->set_alt_loc(alt_loc, false, true);
             have_alt_loc = true;
             for (auto nb: a->neighbors()) {
-                if (nb->residue() != this && nb->alt_locs() == a->alt_locs())
+                if (nb->residue() != this && nb->has_same_alt_locs(a))
                     nb_res.insert(nb->residue());
             }
         }
@@ -483,6 +530,7 @@ Residue::set_chain_id(ChainID chain_id)
         if (_chain != nullptr)
             throw std::logic_error("Cannot set polymeric chain ID directly from Residue; must use Chain");
         _chain_id = chain_id;
+        _structure->residue_lookup_changed();
         if (!structure()->lower_case_chains) {
             for (auto c: chain_id) {
                 if (std::islower(c)) {
@@ -495,10 +543,21 @@ Residue::set_chain_id(ChainID chain_id)
     }
 }
 
+void
+Residue::set_insertion_code(char insertion_code)
+{
+    if (insertion_code != _insertion_code) {
+        _insertion_code = insertion_code;
+        _structure->residue_lookup_changed();
+        change_tracker()->add_modified(structure(), this, ChangeTracker::REASON_INSERTION_CODE);
+    }
+}
+
 void
 Residue::set_number(int number) {
     if (number != _number) {
         _number = number;
+        _structure->residue_lookup_changed();
         _numberings[structure()->res_numbering()] = number;
         change_tracker()->add_modified(structure(), this, ChangeTracker::REASON_NUMBER);
     }
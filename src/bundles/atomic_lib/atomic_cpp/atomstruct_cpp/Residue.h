@@ -31,11 +31,13 @@
 #include <pyinstance/PythonInstance.declare.h>
 #include <set>
 #include <string>
+#include <unordered_set>
 #include <vector>
 
 #include "backbone.h"
 #include "ChangeTracker.h"
 #include "imex.h"
+#include "ObjectPool.h"
 #include "polymer.h"
 #include "Real.h"
 #include "res_numbering.h"
@@ -63,6 +65,12 @@ private:
     friend class Structure;
     Residue(Structure *as, const ResName& name, const ChainID& chain, int pos, char insert);
     virtual  ~Residue();
+    // allocated from the structure's ObjectPool
+    static void*  operator new(std::size_t size) { return ObjectPool::allocate(nullptr, size); }
+    static void*  operator new(std::size_t size, ObjectPool* pool)
+        { return ObjectPool::allocate(pool, size); }
+    static void  operator delete(void* p) { ObjectPool::deallocate(p); }
+    static void  operator delete(void* p, ObjectPool*) { ObjectPool::deallocate(p); }
 
     friend class StructureSeq;
     void  set_chain(Chain* chain) {
@@ -93,6 +101,7 @@ private:
     int  _ss_id;
     SSType _ss_type;
     Structure *  _structure;
+    mutable unsigned int  _structure_index = 0; // maintained by Structure::residue_index()
     bool  _ring_display;
     bool  _rings_are_thin;
     Rgba  _ring_rgba;
@@ -104,6 +113,8 @@ public:
     Chain*  chain() const;
     const ChainID&  chain_id() const;
     bool  connects_to(const Residue* other_res, bool check_pseudobonds=false) const;
+    // residue name, atom names and bonds, for caching per-residue results
+    std::string  connectivity_key() const;
     void  clean_alt_locs();
     int  count_atom(const AtomName&) const;
     void  delete_alt_loc(char al);
@@ -124,6 +135,7 @@ public:
     int  number() const { return _number; }
     Atom*  principal_atom() const;
     void  remove_atom(Atom*);
+    void  remove_atoms(const std::unordered_set<Atom*>& atoms);
     int  session_num_floats(int version=CURRENT_SESSION_VERSION) const {
         return SESSION_NUM_FLOATS(version) + Rgba::session_num_floats();
     }
@@ -134,12 +146,7 @@ public:
     void  session_save(int**, float**) const;
     void  set_alt_loc(char alt_loc);
     void  set_chain_id(ChainID chain_id);
-    void  set_insertion_code(char insertion_code) {
-        if (insertion_code != _insertion_code) {
-            _insertion_code = insertion_code;
-            change_tracker()->add_modified(structure(), this, ChangeTracker::REASON_INSERTION_CODE);
-        }
-    }
+    void  set_insertion_code(char insertion_code);
     void  set_is_helix(bool ih);
     void  set_is_strand(bool is);
     void  set_ss_id(int ssid);
@@ -24,26 +24,77 @@
  * === UCSF ChimeraX Copyright ===
  */
 
+#include <algorithm>
 #include <list>
 #include <iterator>
 #include <map>
 #include <set>
+#include <string>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
+
+#include <arrays/threadpool.h>    // Uses Thread_Pool::parallel_for()
+
 #define MAP map
 #define SET set
 
 #define ATOMSTRUCT_EXPORT
 #define PYINSTANCE_EXPORT
 #include "Bond.h"
+#include "destruct.h"
 #include "Structure.h"
 #include "Residue.h"
+#include "tmpl/TemplateCache.h"
 
 namespace atomstruct {
 
 static Ring::Bonds::iterator contains_exactly_one(
         const Ring &ring, Ring::Bonds *bond_set);
 
+// Intraresidue rings as bonds given by pairs of atom indices within the residue,
+// for reuse with other residues having the same Residue::connectivity_key().
+typedef std::vector<std::vector<std::pair<size_t,size_t>>> IndexRings;
+static tmpl::ResidueResultCache<IndexRings> residue_rings_cache;
+
+static IndexRings
+index_rings(const Residue* res, const Structure::Rings& rings)
+{
+    std::unordered_map<const Atom*, size_t> index;
+    auto& atoms = res->atoms();
+    for (size_t i = 0; i < atoms.size(); ++i)
+        index[atoms[i]] = i;
+    IndexRings irings;
+    for (auto& r: rings) {
+        irings.emplace_back();
+        for (auto b: r.bonds())
+            irings.back().push_back(std::make_pair(index[b->atoms()[0]], index[b->atoms()[1]]));
+    }
+    return irings;
+}
+
+static void
+add_index_rings(const Residue* res, const IndexRings& irings, Structure::Rings* rings)
+{
+    auto& atoms = res->atoms();
+    for (auto& ir: irings) {
+        Ring::Bonds ring_bonds;
+        for (auto& ij: ir) {
+            Atom* a1 = atoms[ij.first];
+            Atom* a2 = atoms[ij.second];
+            auto bi = a1->bonds().begin();
+            for (auto nb: a1->neighbors()) {
+                if (nb == a2) {
+                    ring_bonds.insert(*bi);
+                    break;
+                }
+                ++bi;
+            }
+        }
+        rings->insert(Ring(ring_bonds));
+    }
+}
+
 
 // find all rings
 //  if 'cross_residues', look for rings that cross residue boundaries
@@ -87,9 +138,69 @@ Structure::_temporary_per_residue_rings(Rings& rings, unsigned int all_size_thre
     Ring::_temporary_rings = false;
 }
 
+// Rings are discarded a residue at a time when bonds change and re-perceived
+// only for those residues on the next rings() call.  That requires the rings to
+// be intraresidue; otherwise everything is recomputed.
+void
+Structure::_discard_residue_rings(const Residue* r) const
+{
+    if (_recompute_rings)
+        return;
+    if (r == nullptr || _rings_last_cross_residues || _rings_last_ignore != nullptr) {
+        _recompute_rings = true;
+        return;
+    }
+    std::set<const Ring*> discards;
+    for (auto a: r->atoms())
+        discards.insert(a->_rings.begin(), a->_rings.end());
+    for (auto ring: discards) {
+        for (auto a: ring->atoms())
+            a->_rings.erase(std::remove(a->_rings.begin(), a->_rings.end(), ring), a->_rings.end());
+        for (auto b: ring->bonds())
+            b->_rings.erase(std::remove(b->_rings.begin(), b->_rings.end(), ring), b->_rings.end());
+        _rings.erase(_rings.find(*ring));
+    }
+    _rings_dirty_residues.insert(r);
+}
+
+// Account for the rings affected by creating or deleting a bond
+void
+Structure::_discard_rings(const Bond* b) const
+{
+    if (_recompute_rings)
+        return;
+    auto r1 = b->atoms()[0]->residue();
+    auto r2 = b->atoms()[1]->residue();
+    if (r1 == r2)
+        _discard_residue_rings(r1);
+    else if (_rings_last_cross_residues)
+        _recompute_rings = true;
+}
+
+void
+Structure::_update_dirty_rings() const
+{
+    auto db = DestructionBatcher(const_cast<Structure*>(this));
+    Rings new_rings;
+    // residues deleted since their rings were discarded are skipped since
+    // only residues still in the structure are considered
+    _per_residue_rings(_rings_last_all_size_threshold, nullptr, &new_rings, &_rings_dirty_residues);
+    _rings_dirty_residues.clear();
+    for (auto& nr: new_rings) {
+        auto ins = _rings.insert(nr);
+        if (!ins.second)
+            continue;
+        const Ring& r = *ins.first;
+        for (auto a: r.atoms())
+            a->_rings.push_back(&r);
+        for (auto b: r.bonds())
+            b->_rings.push_back(&r);
+    }
+}
+
 void
 Structure::_per_residue_rings(unsigned int all_size_threshold, std::set<const Residue *>* ignore,
-    Structure::Rings* rings) const
+    Structure::Rings* rings, const std::set<const Residue *>* only) const
 {
     if (rings == nullptr)
         rings = &_rings;
@@ -101,11 +212,24 @@ Structure::_per_residue_rings(unsigned int all_size_threshold, std::set<const Re
     for (auto& res: residues()) {
         if (ignore != nullptr && ignore->find(res) != ignore->end())
             continue;
+        if (only != nullptr && only->find(res) == only->end())
+            continue;
 
         // very big residues cause fits; just skip them
         if (res->atoms().size() > 2500)
             continue;
 
+        // rings depend only on intraresidue bonds, so identical residues
+        // (typically standard residues) reuse previously found rings
+        std::string cache_key = res->connectivity_key();
+        cache_key += '\003';
+        cache_key += std::to_string(all_size_threshold);
+        IndexRings cached_rings;
+        if (residue_rings_cache.find(cache_key, &cached_rings)) {
+            add_index_rings(res, cached_rings, rings);
+            continue;
+        }
+
         std::MAP<Bond*, bool> traversed;
         std::MAP<Atom*, bool> visited;
         // rcb2fr:  ring closure bond to fundamental ring map
@@ -215,8 +339,10 @@ Structure::_per_residue_rings(unsigned int all_size_threshold, std::set<const Re
                 }
             }
         }
-        if (basis.size() == 0)
+        if (basis.size() == 0) {
+            residue_rings_cache.insert(cache_key, cached_rings);
             continue;
+        }
 
         // grow rings from ring closure bonds that are no bigger than the
         // smaller of: that bond's fundamental ring or largest basis ring
@@ -444,6 +570,7 @@ Structure::_per_residue_rings(unsigned int all_size_threshold, std::set<const Re
             }
         }
         rings->insert(msr.begin(), msr.end());
+        residue_rings_cache.insert(cache_key, index_rings(res, msr));
     }
     if (all_size_threshold > 0) {
         // return _all_ rings at most the given size
@@ -557,124 +684,156 @@ Structure::_per_residue_rings(unsigned int all_size_threshold, std::set<const Re
     }
 }
 
-void
-Structure::_per_structure_rings(unsigned int all_size_threshold, std::set<const Residue *>* ignore) const
-{
-    // set_symmetric_difference only works on sorted ranges, so use
-    // std::set instead of std::unordered_set
-    typedef std::set<Bond*> SpanningBonds;
-    typedef std::MAP<Atom*, SpanningBonds > Atom2SpanningBonds;
-    std::MAP<Bond*, bool> traversed;
-    std::MAP<Atom*, bool> visited;
+// Rings of one connected component, which are found independently of the
+// other components.
+struct RingSystem {
+    Structure::Rings  fundamental;
     // rcb2fr:  ring closure bond to fundamental ring map
-    std::MAP<Bond *, Ring> rcb2fr;
-    std::vector<Rings> fundamentals;
-
-    // trace spanning tree and find fundamental rings
-    // look for an atom not yet in the spanning tree;
-    // keep a list of fundamental rings per spanning tree to
-    // optimize the ring summing step to follow
-    for (auto& uat: atoms()) {
-        Atom* at = uat;
-        if (visited.find(at) != visited.end())
-            continue;
-        if (ignore != nullptr && ignore->find(at->residue()) != ignore->end())
-            continue;
-        
-        Atom2SpanningBonds spanning_bonds;
-        spanning_bonds[at] = SpanningBonds();
-        std::list<Atom *> leaves;
-        leaves.push_back(at);
-        Rings fundamental;
-
-        while (leaves.size() > 0) {
-            Atom *node = leaves.front();
-            leaves.pop_front();
-            if (ignore != nullptr
-            && ignore->find(node->residue()) != ignore->end())
+    std::MAP<Bond *, Ring>  rcb2fr;
+    Structure::Rings  rings;
+};
+
+// Ring systems with more ring closure bonds than this only grow rings from
+// each ring closure bond until the smallest ring through it is found.
+static const size_t large_ring_system = 1000;
+// At most this many rings per ring system are found by the all-rings-up-to-
+// a-size summing.  A carbon nanotube or framework can otherwise spend
+// minutes enumerating rings.
+static const size_t max_all_size_rings = 100000;
+
+// whether the bonds form a single ring that is not bridged
+static bool
+is_single_ring(const Ring::Bonds& bonds)
+{
+    Bond *cur_bond = *bonds.begin();
+    Atom *start_atom = cur_bond->atoms()[0];
+    Ring::Bonds::size_type num_bonds = 1;
+    Atom *cur_atom = cur_bond->atoms()[1];
+    while (cur_atom != start_atom) {
+        Bond *next_bond = nullptr;
+        int in_ring = 0;
+        for (auto b: cur_atom->bonds()) {
+            if (bonds.find(b) == bonds.end())
                 continue;
-            visited[node] = true;
+            ++in_ring;
+            if (b != cur_bond)
+                next_bond = b;
+        }
+        if (in_ring != 2)
+            return false;
+        cur_bond = next_bond;
+        num_bonds++;
+        cur_atom = cur_bond->other_atom(cur_atom);
+    }
+    return num_bonds == bonds.size();
+}
 
-            auto bi = node->bonds().begin();
-            auto ni = node->neighbors().begin();
-            for (; bi != node->bonds().end(); ++bi, ++ni) {
-                Bond* b = *bi;
-                if (traversed[b])
-                    continue;
-                traversed[b] = true;
+// add to 'rings' (the minimal rings of one ring system) all rings at most the
+// given size, by summing rings until no new rings result
+static void
+add_all_size_rings(Structure::Rings& rings, unsigned int all_size_threshold)
+{
+    typedef Structure::Rings Rings;
+    Rings meets_size_criteria;
+    for (auto& r: rings) {
+        if (r.bonds().size() <= all_size_threshold)
+            meets_size_criteria.insert(r);
+    }
+    meets_size_criteria.swap(rings);
+
+    // the sum of two rings with no bond in common is not a ring, so only
+    // sum rings with the rings sharing one of their bonds
+    std::MAP<Bond *, std::vector<const Ring *>> bond_rings;
+    std::vector<const Ring *> new_added;
+    for (auto& r: rings) {
+        for (auto b: r.bonds())
+            bond_rings[b].push_back(&r);
+        new_added.push_back(&r);
+    }
 
-                Atom *next = *ni;
-                if (ignore != nullptr && ignore->find(next->residue()) != ignore->end())
+    // first time through, sum rings with themselves; on following
+    // passes, only sum rings with newly added rings
+    bool first_pass = true;
+    while (new_added.size() > 0 && rings.size() < max_all_size_rings) {
+        Rings additional;
+        for (auto r2: new_added) {
+            std::set<const Ring *> sharing;
+            for (auto b: r2->bonds())
+                sharing.insert(bond_rings[b].begin(), bond_rings[b].end());
+            for (auto r1: sharing) {
+                if (r1 == r2 || (first_pass && !(*r1 < *r2)))
+                    continue;
+                Ring::Bonds sum;
+                std::set_symmetric_difference(
+                  r1->bonds().begin(), r1->bonds().end(),
+                  r2->bonds().begin(), r2->bonds().end(),
+                  std::insert_iterator<Ring::Bonds>(sum, sum.begin()));
+                if (sum.size() == 0 || sum.size() > all_size_threshold)
                     continue;
 
-                if (!visited[next]) {
-                    // not yet visited
-                    visited[next] = true;
-                    spanning_bonds[next] = spanning_bonds[node];
-                    (void)spanning_bonds[next].insert(b);
-                    leaves.push_back(next);
+                Ring candidate(sum);
+                if (rings.find(candidate) != rings.end()
+                || additional.find(candidate) != additional.end())
+                    // not new
                     continue;
-                }
 
-                // else:
-                // visited; fundamental ring
-                //
-                // do an "exclusive or" of the spanning
-                // bonds of the two ends of the ring
-                // closure bond to find the ring bonds
-                // (and add the ring closure bond)
-                Ring::Bonds ring_bonds;
-                SpanningBonds &sb_node = spanning_bonds[node];
-                SpanningBonds &sb_next = spanning_bonds[next];
-                std::set_symmetric_difference(
-                  sb_node.begin(), sb_node.end(),
-                  sb_next.begin(), sb_next.end(),
-                  std::insert_iterator<Ring::Bonds>(
-                  ring_bonds, ring_bonds.begin()));
-                (void)ring_bonds.insert(b);
-                Ring r(ring_bonds);
-                (void)fundamental.insert(r);
-                (void)rcb2fr.insert(std::MAP<Bond *, Ring>::value_type(b,r));
+                // make sure new "ring" is not disjoint, and is not bridged
+                if (!is_single_ring(sum))
+                    continue;
+                additional.insert(candidate);
             }
         }
-        fundamentals.push_back(fundamental);
+        new_added.clear();
+        for (auto& r: additional) {
+            if (rings.size() >= max_all_size_rings)
+                break;
+            auto& added = *rings.insert(r).first;
+            for (auto b: added.bonds())
+                bond_rings[b].push_back(&added);
+            new_added.push_back(&added);
+        }
+        first_pass = false;
     }
+}
 
+// minimal rings of one ring system, plus all rings up to 'all_size_threshold'
+// if it is non-zero
+static void
+ring_system_rings(RingSystem& system, unsigned int all_size_threshold,
+    std::set<const Residue *>* ignore)
+{
+    typedef Structure::Rings Rings;
     // "ring sum" pairs of fundamental rings; keep smallest two
+    const Rings& fundamental = system.fundamental;
+    const std::MAP<Bond *, Ring>& rcb2fr = system.rcb2fr;
     Rings basis;
     std::set<Bond *> sum;
-    for (auto& fundamental: fundamentals) {
-        if (fundamental.size() == 1) {
-            basis.insert(*fundamental.begin());
-            continue;
-        }
-        for (auto fi1 = fundamental.begin(); fi1 != fundamental.end(); ++fi1) {
-            const Ring& r1 = *fi1;
-            Rings::const_iterator fi2 = fi1;
-            for (fi2++; fi2 != fundamental.end(); ++fi2) {
-                const Ring &r2 = *fi2;
-                const Ring *larger = r1.bonds().size() >
-                  r2.bonds().size() ? &r1 : &r2;
-                sum.clear();
-                std::set_symmetric_difference(
-                  r1.bonds().begin(), r1.bonds().end(),
-                  r2.bonds().begin(), r2.bonds().end(),
-                  std::insert_iterator<std::set<Bond *>>(sum, sum.begin()));
-                
-                if (sum.size() < larger->bonds().size()) {
-                    (void)basis.insert(Ring(sum));
-                    (void)basis.insert(larger == &r1 ?  r2 : r1);
-                } else {
-                    (void)basis.insert(r1);
-                    (void)basis.insert(r2);
-                }
+    if (fundamental.size() == 1)
+        basis.insert(*fundamental.begin());
+    for (auto fi1 = fundamental.begin(); fi1 != fundamental.end(); ++fi1) {
+        const Ring& r1 = *fi1;
+        Rings::const_iterator fi2 = fi1;
+        for (fi2++; fi2 != fundamental.end(); ++fi2) {
+            const Ring &r2 = *fi2;
+            const Ring *larger = r1.bonds().size() >
+              r2.bonds().size() ? &r1 : &r2;
+            sum.clear();
+            std::set_symmetric_difference(
+              r1.bonds().begin(), r1.bonds().end(),
+              r2.bonds().begin(), r2.bonds().end(),
+              std::insert_iterator<std::set<Bond *>>(sum, sum.begin()));
+            
+            if (sum.size() < larger->bonds().size()) {
+                (void)basis.insert(Ring(sum));
+                (void)basis.insert(larger == &r1 ?  r2 : r1);
+            } else {
+                (void)basis.insert(r1);
+                (void)basis.insert(r2);
             }
         }
     }
-    if (basis.size() == 0) {
-        _rings.clear();
+    if (basis.size() == 0)
         return;
-    }
 
     // grow rings from ring closure bonds that are no bigger than the
     // smaller of: that bond's fundamental ring or largest basis ring
@@ -686,6 +845,10 @@ Structure::_per_structure_rings(unsigned int all_size_threshold, std::set<const
     if (all_size_threshold && largest_basis > all_size_threshold)
         largest_basis = all_size_threshold;
 
+    // in a large ring system (fullerene, nanotube, framework) growing every
+    // ring closure bond out to its fundamental ring size visits most of the
+    // system each time, so stop at the smallest rings through the bond
+    bool large_system = rcb2fr.size() > large_ring_system;
     for (auto rcb_fr: rcb2fr) {
         Bond *rcb = rcb_fr.first; // ring closure bond
         const Ring &fr = rcb_fr.second; // corresponding fundamental ring 
@@ -705,6 +868,7 @@ Structure::_per_structure_rings(unsigned int all_size_threshold, std::set<const
         above_bonds[1][rcb->atoms()[1]].insert(rcb);
         leaf_atoms[0].insert(rcb->atoms()[0]);
         leaf_atoms[1].insert(rcb->atoms()[1]);
+        bool found = false;
         for (Ring::Bonds::size_type size = 2; size <= limit_size; ++size) {
             int side = size % 2;
             int opp_side = (side + 1) % 2;
@@ -749,11 +913,14 @@ Structure::_per_structure_rings(unsigned int all_size_threshold, std::set<const
                         continue;
                     (void)ring_bonds.insert(rcb);
                     (void)basis.insert(Ring(ring_bonds));
+                    found = true;
                 }
             }
 
             leaves.swap(new_leaves);
             above.swap(new_above);
+            if (found && large_system)
+                break;
         }
     }
 
@@ -898,120 +1065,120 @@ Structure::_per_structure_rings(unsigned int all_size_threshold, std::set<const
             msr.insert(r);
         }
     }
-    msr.swap(_rings);
+    system.rings.swap(msr);
+    if (all_size_threshold > 0)
+        // return _all_ rings at most the given size
+        add_all_size_rings(system.rings, all_size_threshold);
+}
 
-    if (all_size_threshold > 0) {
-        // return _all_ at least the given size
+void
+Structure::_per_structure_rings(unsigned int all_size_threshold, std::set<const Residue *>* ignore) const
+{
+    // set_symmetric_difference only works on sorted ranges, so use
+    // std::set instead of std::unordered_set
+    typedef std::set<Bond*> SpanningBonds;
+    typedef std::MAP<Atom*, SpanningBonds > Atom2SpanningBonds;
+    std::MAP<Bond*, bool> traversed;
+    std::MAP<Atom*, bool> visited;
+    std::vector<RingSystem> systems;
 
-        // to optimize the cross_residue==false case, sort
-        // rings by residue...
+    // the many rings made and discarded along the way are temporary, so they
+    // can be destroyed on other threads without destruction notifications
+    bool temporary = Ring::_temporary_rings;
+    Ring::_temporary_rings = true;
 
-        Rings meets_size_criteria;
-        for (auto& r: _rings) {
-            if (r.bonds().size() <= all_size_threshold)
-                meets_size_criteria.insert(r);
-        }
-        meets_size_criteria.swap(_rings);
+    // trace spanning tree and find fundamental rings
+    // look for an atom not yet in the spanning tree;
+    // keep the fundamental rings per spanning tree, since the rings
+    // of each connected component can be found independently
+    for (auto& uat: atoms()) {
+        Atom* at = uat;
+        if (visited.find(at) != visited.end())
+            continue;
+        if (ignore != nullptr && ignore->find(at->residue()) != ignore->end())
+            continue;
+        
+        Atom2SpanningBonds spanning_bonds;
+        spanning_bonds[at] = SpanningBonds();
+        std::list<Atom *> leaves;
+        leaves.push_back(at);
+        RingSystem system;
 
-        std::MAP<Residue *, Rings> ring_lists;
-        ring_lists[residues()[0]] = _rings;
+        while (leaves.size() > 0) {
+            Atom *node = leaves.front();
+            leaves.pop_front();
+            if (ignore != nullptr
+            && ignore->find(node->residue()) != ignore->end())
+                continue;
+            visited[node] = true;
 
-        bool rings_added = true;
-        Rings new_added;
-        while (rings_added) {
-            rings_added = false;
-            Rings all_additional;
-            for (auto r1res_rli: ring_lists) {
-                Rings rs = r1res_rli.second;
-                Rings additional;
-                Residue *r1res;
-                for (Rings::const_iterator r1i = rs.begin();
-                r1i != rs.end(); ++r1i) {
-                    const Ring &r1 = *r1i;
-                    r1res = (*r1.bonds().begin())->atoms()[0]->residue();
-                          // more efficient to access
-                          // bonds in rings than atoms
-                    Rings::const_iterator r2i, end;
-                    if (new_added.size() == 0) {
-                        // first time through,
-                        // sum rings with themselves
-                        r2i = r1i;
-                        r2i++;
-                        end = rs.end();
-                    } else {
-                        // on following passes, only
-                        // sum rings with newly added
-                        // rings
-                        r2i = new_added.begin();
-                        end = new_added.end();
-                    }
-                    for (; r2i != end; ++r2i) {
-                        const Ring &r2 = *r2i;
-                        Ring::Bonds sum;
-                        std::set_symmetric_difference(
-                          r1.bonds().begin(),
-                          r1.bonds().end(),
-                          r2.bonds().begin(),
-                          r2.bonds().end(),
-                          std::insert_iterator<
-                          Ring::Bonds>(
-                          sum, sum.begin()));
-                        
-                        if (sum.size() == 0 ||
-                          sum.size() > all_size_threshold
-                          || sum.size() ==
-                          r1.bonds().size()
-                          + r2.bonds().size())
-                            continue;
-                        
-                        Ring candidate(sum);
-                        if (rs.find(candidate) != rs.end())
-                            // not new
-                            continue;
+            auto bi = node->bonds().begin();
+            auto ni = node->neighbors().begin();
+            for (; bi != node->bonds().end(); ++bi, ++ni) {
+                Bond* b = *bi;
+                if (traversed[b])
+                    continue;
+                traversed[b] = true;
 
-                        // make sure new "ring" is not
-                        // disjoint, and is not bridged
-                        Bond *cur_bond = *candidate.bonds().begin();
-                        Atom *start_atom = cur_bond->atoms()[0];
-                        unsigned num_bonds = 1;
-                        Atom *cur_atom = cur_bond->atoms()[1];
-                        while (cur_atom != start_atom) {
-                            Ring::Bonds intersection;
-                            std::SET<Bond *> atom_bonds;
-                            for (auto b: cur_atom->bonds()) {
-                                atom_bonds.insert(b);
-                            }
-                            std::set_intersection(atom_bonds.begin(),
-                              atom_bonds.end(), sum.begin(), sum.end(),
-                              std::insert_iterator <Ring::Bonds>(intersection,
-                              intersection.begin()));
-                            if (intersection.size() != 2)
-                                break;
-                            for (auto b: intersection) {
-                                if (b == cur_bond)
-                                    continue;
-                                cur_bond = b;
-                                num_bonds++;
-                                cur_atom = cur_bond->other_atom(cur_atom);
-                                break;
-                            }
-                        }
-                        if (cur_atom != start_atom || num_bonds != sum.size())
-                            continue;
+                Atom *next = *ni;
+                if (ignore != nullptr && ignore->find(next->residue()) != ignore->end())
+                    continue;
 
-                        additional.insert(candidate);
-                        rings_added = true;
-                    }
+                if (!visited[next]) {
+                    // not yet visited
+                    visited[next] = true;
+                    spanning_bonds[next] = spanning_bonds[node];
+                    (void)spanning_bonds[next].insert(b);
+                    leaves.push_back(next);
+                    continue;
                 }
-                rs.insert(additional.begin(), additional.end());
-                ring_lists[r1res] = rs;
-                all_additional.insert(additional.begin(), additional.end());
 
+                // else:
+                // visited; fundamental ring
+                //
+                // do an "exclusive or" of the spanning
+                // bonds of the two ends of the ring
+                // closure bond to find the ring bonds
+                // (and add the ring closure bond)
+                Ring::Bonds ring_bonds;
+                SpanningBonds &sb_node = spanning_bonds[node];
+                SpanningBonds &sb_next = spanning_bonds[next];
+                std::set_symmetric_difference(
+                  sb_node.begin(), sb_node.end(),
+                  sb_next.begin(), sb_next.end(),
+                  std::insert_iterator<Ring::Bonds>(
+                  ring_bonds, ring_bonds.begin()));
+                (void)ring_bonds.insert(b);
+                Ring r(ring_bonds);
+                (void)system.fundamental.insert(r);
+                (void)system.rcb2fr.insert(std::MAP<Bond *, Ring>::value_type(b,r));
             }
-            for (auto aa: all_additional) {
-                _rings.insert(aa);
-            }
-            new_added.swap(all_additional);
+        }
+        if (system.fundamental.size() > 0)
+            systems.push_back(std::move(system));
+    }
+
+    // ring systems are independent, so find their rings in parallel,
+    // largest systems first so they don't finish last
+    std::sort(systems.begin(), systems.end(),
+        [](const RingSystem& s1, const RingSystem& s2) {
+            return s1.rcb2fr.size() > s2.rcb2fr.size(); });
+    try {
+        Thread_Pool::parallel_for(systems.size(), [&](int64_t s0, int64_t s1) {
+            for (int64_t si = s0; si < s1; ++si)
+                ring_system_rings(systems[si], all_size_threshold, ignore);
+        });
+    } catch (...) {
+        Ring::_temporary_rings = temporary;
+        throw;
+    }
+    Ring::_temporary_rings = temporary;
+
+    _rings.clear();
+    for (auto& system: systems) {
+        for (auto& r: system.rings) {
+            Ring::Bonds ring_bonds = r.bonds();
+            _rings.emplace(ring_bonds);
         }
     }
 }
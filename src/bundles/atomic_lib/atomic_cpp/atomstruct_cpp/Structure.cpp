@@ -25,12 +25,17 @@
  */
 
 #include <algorithm>
+#include <atomic>
 #include <cctype>
 #include <set>
+#include <sstream>
+#include <unordered_map>
+#include <unordered_set>
 
 #include <logger/logger.h>
 #include <pysupport/convert.h>
 #include <arrays/pythonarray.h>   // Uses python_int_array(), python_float_array()
+#include <arrays/threadpool.h>    // Uses Thread_Pool::parallel_for(), run()
 
 #include "Python.h"
 
@@ -39,6 +44,7 @@
 #include "Atom.h"
 #include "backbone.h"
 #include "Bond.h"
+#include "BondGraph.h"
 #include "CoordSet.h"
 #include "destruct.h"
 #include "polymer.h"
@@ -47,6 +53,7 @@
 #include "PBGroup.h"
 #include "Pseudobond.h"
 #include "Residue.h"
+#include "search.h"
 
 #include <pyinstance/PythonInstance.instantiate.h>
 template class pyinstance::PythonInstance<atomstruct::Structure>;
@@ -60,6 +67,8 @@ const char*  Structure::PBG_HYDROGEN_BONDS = "hydrogen bonds";
 Structure::Structure(PyObject* logger):
     _active_coord_set(nullptr), _chains(nullptr),
     _change_tracker(DiscardingChangeTracker::discarding_change_tracker()),
+    _atom_pool(new ObjectPool(sizeof(Atom))), _bond_pool(new ObjectPool(sizeof(Bond))),
+    _residue_pool(new ObjectPool(sizeof(Residue))),
     _idatm_valid(false), _logger(logger),
     _pb_mgr(this), _polymers_computed(false), _recompute_rings(true),
     _ss_assigned(false), _structure_cats_dirty(true),
@@ -115,9 +124,15 @@ Structure::~Structure() {
         delete r;
     for (auto cs: _coord_sets)
         delete cs;
+    delete _cell_list;
+    delete _bond_graph;
+    // pools release their memory once any objects still referenced elsewhere are gone
+    _atom_pool->orphan();
+    _bond_pool->orphan();
+    _residue_pool->orphan();
 }
 
-std::map<Residue *, char>
+std::unordered_map<Residue *, char>
 Structure::best_alt_locs() const
 {
     // check the common case of all blank alt locs first...
@@ -129,7 +144,7 @@ Structure::best_alt_locs() const
             break;
         }
     }
-    std::map<Residue *, char> best_locs;
+    std::unordered_map<Residue *, char> best_locs;
     if (all_blank) {
         return best_locs;
     }
@@ -138,26 +153,30 @@ Structure::best_alt_locs() const
     //   related alt locs
     // use the alt loc with the highest average occupancy; if tied,
     //  the lowest bfactors; if tied, first alphabetically
-    std::set<Residue *> seen;
+    std::unordered_set<Residue *> seen;
     for (auto ri = _residues.begin(); ri != _residues.end(); ++ri) {
         Residue *r = *ri;
         if (seen.find(r) != seen.end())
             continue;
         seen.insert(r);
-        std::set<Residue *> res_group;
-        std::set<char> alt_loc_set;
+        std::vector<Residue *> res_group;
+        const Atom *alt_loc_atom = nullptr;
         for (auto ai = r->_atoms.begin(); ai != r->_atoms.end(); ++ai) {
             Atom *a = *ai;
-            alt_loc_set = a->alt_locs();
-            if (!alt_loc_set.empty())
+            if (!a->_alt_loc_map.empty()) {
+                alt_loc_atom = a;
                 break;
+            }
         }
         // if residue has no altlocs, skip it
-        if (alt_loc_set.empty())
+        if (alt_loc_atom == nullptr)
             continue;
+        std::vector<char> alt_loc_set;
+        for (auto& al_info: alt_loc_atom->_alt_loc_map)
+            alt_loc_set.push_back(al_info.first);
         // for this residue and neighbors linked through alt loc,
         // collate occupancy/bfactor info
-        res_group.insert(r);
+        res_group.push_back(r);
         std::vector<Residue *> todo;
         todo.push_back(r);
         std::map<char, int> occurances;
@@ -176,18 +195,18 @@ Structure::best_alt_locs() const
                         break;
                     }
                     occurances[alt_loc] += 1;
-                    Atom::_Alt_loc_info &info = a->_alt_loc_map[alt_loc];
+                    const Atom::_Alt_loc_info &info = a->_alt_loc_map.find(alt_loc)->second;
                     occupancies[alt_loc] += info.occupancy;
                     bfactors[alt_loc] += info.bfactor;
                 }
                 if (check_neighbors) {
                     for (auto nb: a->neighbors()) {
                         Residue *nr = nb->residue();
-                        if (nr != cr && nb->alt_locs() == alt_loc_set
+                        if (nr != cr && nb->has_same_alt_locs(alt_loc_atom)
                         && seen.find(nr) == seen.end()) {
                             seen.insert(nr);
                             todo.push_back(nr);
-                            res_group.insert(nr);
+                            res_group.push_back(nr);
                         }
                     }
                 }
@@ -196,9 +215,8 @@ Structure::best_alt_locs() const
         // go through the occupancy/bfactor info and decide on
         // the best alt loc
         char best_loc = '\0';
-        std::vector<char> alphabetic_alt_locs(alt_loc_set.begin(),
-            alt_loc_set.end());
-        std::sort(alphabetic_alt_locs.begin(), alphabetic_alt_locs.end());
+        // alt locs are kept sorted
+        const std::vector<char>& alphabetic_alt_locs = alt_loc_set;
         float best_occupancies = 0.0, best_bfactors = 0.0;
         for (auto ali = alphabetic_alt_locs.begin();
         ali != alphabetic_alt_locs.end(); ++ali) {
@@ -233,12 +251,58 @@ Structure::best_alt_locs() const
     return best_locs;
 }
 
+// Lock-free union-find for joining atoms from several threads.  Each set's
+// root is its lowest index, since a root is only ever linked under a lower one.
+class Atom_Union_Find
+{
+public:
+    Atom_Union_Find(size_t n) : _parent(n)
+        { for (size_t i = 0; i < n; ++i) _parent[i].store(i, std::memory_order_relaxed); }
+    size_t  find(size_t i) {
+        while (true) {
+            size_t p = _parent[i].load(std::memory_order_relaxed);
+            if (p == i)
+                return i;
+            size_t gp = _parent[p].load(std::memory_order_relaxed);
+            if (gp != p)
+                _parent[i].compare_exchange_weak(p, gp, std::memory_order_relaxed);  // path halving
+            i = gp;
+        }
+    }
+    void  join(size_t i, size_t j) {
+        while (true) {
+            i = find(i);
+            j = find(j);
+            if (i == j)
+                return;
+            if (i < j)
+                std::swap(i, j);
+            size_t expected = i;
+            if (_parent[i].compare_exchange_strong(expected, j, std::memory_order_relaxed))
+                return;
+        }
+    }
+private:
+    std::vector<std::atomic<size_t>>  _parent;
+};
+
 void
 Structure::bonded_groups(std::vector<std::vector<Atom*>>* groups,
     bool consider_missing_structure) const
 {
-    // find connected atomic structures, considering missing-structure pseudobonds
-    std::map<Atom*, std::vector<Atom*>> pb_connections;
+    // find connected atomic structures, considering missing-structure pseudobonds;
+    // groups are in the order of their first atom, and atoms in structure order
+    if (_atom_indices_dirty)
+        _index_atoms();
+    size_t n = _atoms.size();
+    Atom_Union_Find sets(n);
+    const Bonds& bonds = _bonds;
+    Thread_Pool::parallel_for(bonds.size(), [&](int64_t b0, int64_t b1) {
+        for (int64_t bi = b0; bi < b1; ++bi) {
+            auto& ba = bonds[bi]->atoms();
+            sets.join(ba[0]->_structure_index, ba[1]->_structure_index);
+        }
+    }, 65536);
     if (consider_missing_structure) {
         auto pbg = const_cast<Structure*>(this)->_pb_mgr.get_group(PBG_MISSING_STRUCTURE,
             AS_PBManager::GRP_NONE);
@@ -246,35 +310,84 @@ Structure::bonded_groups(std::vector<std::vector<Atom*>>* groups,
             for (auto& pb: pbg->pseudobonds()) {
                 auto a1 = pb->atoms()[0];
                 auto a2 = pb->atoms()[1];
-                pb_connections[a1].push_back(a2);
-                pb_connections[a2].push_back(a1);
+                sets.join(a1->_structure_index, a2->_structure_index);
             }
         }
     }
-    std::set<Atom*> seen;
-    for (auto a: atoms()) {
-        if (seen.find(a) != seen.end())
-            continue;
-        groups->emplace_back();
-        std::vector<Atom*>& bonded = groups->back();
-        std::set<Atom*> pending;
-        pending.insert(a);
-        while (pending.size() > 0) {
-            Atom* pa = *(pending.begin());
-            pending.erase(pa);
-            if (seen.find(pa) != seen.end())
-                continue;
-            seen.insert(pa);
-            bonded.push_back(pa);
-            if (pb_connections.find(pa) != pb_connections.end()) {
-                for (auto conn: pb_connections[pa]) {
-                    pending.insert(conn);
-                }
-            }
-            for (auto nb: pa->neighbors())
-                pending.insert(nb);
+    std::vector<size_t> root_group(n, n);
+    for (size_t i = 0; i < n; ++i) {
+        size_t root = sets.find(i);
+        if (root == i) {
+            root_group[i] = groups->size();
+            groups->emplace_back();
         }
+        (*groups)[root_group[root]].push_back(_atoms[i]);
+    }
+}
+
+const std::vector<AtomDisplayState>&
+Structure::atom_display_state() const
+{
+    if (_display_state_built == _display_state_generation && _display_state.size() == _atoms.size())
+        return _display_state;
+    _display_state.resize(_atoms.size());
+    auto ds = _display_state.data();
+    for (auto a: _atoms) {
+        auto& rgba = a->color();
+        ds->r = rgba.r;
+        ds->g = rgba.g;
+        ds->b = rgba.b;
+        ds->a = rgba.a;
+        ds->flags = (a->display() ? AtomDisplayState::DISPLAY : 0)
+            | (a->selected() ? AtomDisplayState::SELECTED : 0)
+            | (a->visible() ? AtomDisplayState::VISIBLE : 0);
+        ds->draw_mode = static_cast<unsigned char>(a->draw_mode());
+        ds->hide = static_cast<unsigned short>(a->hide());
+        ++ds;
+    }
+    _display_state_built = _display_state_generation;
+    return _display_state;
+}
+
+const AtomCellList&
+Structure::cell_list(double cell_size) const
+{
+    if (_cell_list != nullptr && (_cell_list_generation != _coord_generation
+    || _cell_list->requested_cell_size() != cell_size || _cell_list->size() != _atoms.size())) {
+        delete _cell_list;
+        _cell_list = nullptr;
+    }
+    if (_cell_list == nullptr) {
+        _cell_list = new AtomCellList(_atoms, cell_size);
+        _cell_list_generation = _coord_generation;
+    }
+    return *_cell_list;
+}
+
+const AtomCellList&
+Structure::cell_list_near(double cell_size) const
+{
+    if (_cell_list != nullptr && _cell_list_generation == _coord_generation
+    && _cell_list->size() == _atoms.size()) {
+        double cs = _cell_list->requested_cell_size();
+        if (cs >= 0.5 * cell_size && cs <= 2 * cell_size)
+            return *_cell_list;
     }
+    return cell_list(cell_size);
+}
+
+const BondGraph&
+Structure::bond_graph(bool idatm_types) const
+{
+    if (_bond_graph == nullptr)
+        _bond_graph = new BondGraph();
+    else if (_bond_graph_built == _bond_graph_generation
+    && (!idatm_types || _bond_graph->has_idatm_types()))
+        return *_bond_graph;
+    _bond_graph->build(this, idatm_types);
+    // computing IDATM types while building can change the generation
+    _bond_graph_built = _bond_graph_generation;
+    return *_bond_graph;
 }
 
 void
@@ -321,7 +434,7 @@ Structure::change_chain_ids(const std::vector<StructureSeq*> changing_chains,
 
 static void
 _copy_pseudobonds(Proxy_PBGroup* pbgc, const Proxy_PBGroup::Pseudobonds& pbs,
-    std::map<Atom*, Atom*>& amap, CoordSet* cs = nullptr)
+    std::unordered_map<Atom*, Atom*>& amap, CoordSet* cs = nullptr)
 {
     for (auto pb: pbs) {
         const Connection::Atoms &a = pb->atoms();
@@ -377,7 +490,13 @@ void Structure::_copy(Structure* s, PositionMatrix coord_adjust,
                 s->_position[i][j] = _position[i][j];
     }
 
-    std::map<Residue*, Residue*> rmap;
+    // copies of big structures are common (morphs, model series), so size everything
+    // up front and use hashed maps from original to copy
+    s->_residues.reserve(s->_residues.size() + _residues.size());
+    s->_atoms.reserve(s->_atoms.size() + _atoms.size());
+    s->_bonds.reserve(s->_bonds.size() + _bonds.size());
+    std::unordered_map<Residue*, Residue*> rmap;
+    rmap.reserve(_residues.size());
     for (auto r: residues()) {
         ChainID cid;
         if (chain_id_map == nullptr)
@@ -409,6 +528,7 @@ void Structure::_copy(Structure* s, PositionMatrix coord_adjust,
         cr->_alt_loc = r->_alt_loc;
         cr->_ribbon_hide_backbone = r->_ribbon_hide_backbone;
         cr->_ribbon_adjust = r->_ribbon_adjust;
+        cr->_atoms.reserve(r->_atoms.size());
         rmap[r] = cr;
     }
     std::map<CoordSet*, CoordSet*> cs_map;
@@ -423,7 +543,7 @@ void Structure::_copy(Structure* s, PositionMatrix coord_adjust,
         }
         s->set_active_coord_set(cs_map[active_coord_set()]);
     } else {
-        coord_base = s->active_coord_set()->coords().size();
+        coord_base = s->active_coord_set()->coords_size();
         if (s->coord_sets().size() != coord_sets().size()) {
             // copy just the current coord set onto the current one, and prune others from combination
             auto active = s->active_coord_set();
@@ -439,12 +559,15 @@ void Structure::_copy(Structure* s, PositionMatrix coord_adjust,
                 auto s_cs = s->coord_sets()[i];
                 auto c_cs = coord_sets()[i];
                 if (coord_adjust != nullptr) {
-                    // c_cs.xform() would overwrite coords rather than produce a new copy
-                    CoordSet::Coords tmp = c_cs->coords();
-                    size_t nc = tmp.size();
-                    for (size_t i = 0 ; i < nc ; ++i)
-                        tmp[i].xform(coord_adjust);
-                    s_cs->_coords.insert(s_cs->_coords.end(), tmp.begin(), tmp.end());
+                    // c_cs.xform() would overwrite coords rather than produce a new copy,
+                    // so append and transform the appended coords in place
+                    auto& c_coords = c_cs->coords();
+                    auto& s_coords = s_cs->_writable_coords();
+                    size_t base = s_coords.size();
+                    s_coords.insert(s_coords.end(), c_coords.begin(), c_coords.end());
+                    size_t nc = s_coords.size();
+                    for (size_t i = base ; i < nc ; ++i)
+                        s_coords[i].xform(coord_adjust);
                 } else {
                     s_cs->add_coords(c_cs);
                 }
@@ -461,9 +584,12 @@ void Structure::_copy(Structure* s, PositionMatrix coord_adjust,
     }
 
     set_alt_loc_change_notify(false);
-    std::map<Atom*, Atom*> amap;
+    std::unordered_map<Atom*, Atom*> amap;
+    amap.reserve(_atoms.size());
     for (auto a: atoms()) {
         Atom* ca = s->new_atom(a->name().c_str(), a->element());
+        ca->_bonds.reserve(a->_bonds.size());
+        ca->_neighbors.reserve(a->_neighbors.size());
         Residue *cr = rmap[a->residue()];
         cr->add_atom(ca, true);	// Must set residue before setting alt locs
         ca->_coord_index = coord_base + a->coord_index();
@@ -578,6 +704,42 @@ Structure::combine_sym_atoms()
         delete_atoms(extras);
 }
 
+void
+Structure::add_atom(Atom* a)
+{
+    a->_structure_index = _atoms.size();
+    _atoms.emplace_back(a);
+    ++_bond_graph_generation;
+    set_gc_shape();
+    set_gc_adddel();
+}
+
+void
+Structure::add_bond(Bond* b)
+{
+    b->_structure_index = _bonds.size();
+    _bonds.emplace_back(b);
+    ++_bond_graph_generation;
+    set_gc_shape();
+    set_gc_adddel();
+}
+
+size_t
+Structure::atom_index(const Atom* a) const
+{
+    if (_atom_indices_dirty)
+        _index_atoms();
+    return a->_structure_index;
+}
+
+size_t
+Structure::bond_index(const Bond* b) const
+{
+    if (_bond_indices_dirty)
+        _index_bonds();
+    return b->_structure_index;
+}
+
 Structure*
 Structure::copy() const
 {
@@ -602,7 +764,7 @@ Structure::_delete_atom(Atom* a)
     // need to insert missing-structure pseudobond. "adjacent" considers missing-structure
     // pseudobonds
     if (a->_rings.size() > 0)
-        _recompute_rings = true;
+        _discard_residue_rings(a->residue());
     if (a->is_backbone(BBE_MIN)) {
         std::vector<Atom*> missing_partners;
         auto pbg = _pb_mgr.get_group(PBG_MISSING_STRUCTURE, AS_PBManager::GRP_NONE);
@@ -651,12 +813,15 @@ Structure::_delete_atom(Atom* a)
         typename Bonds::iterator bi = std::find_if(_bonds.begin(), _bonds.end(),
             [&b](Bond* ub) { return ub == b; });
         _bonds.erase(bi);
+        _bond_indices_dirty = true;
         delete b;
     }
     a->residue()->remove_atom(a);
     typename Atoms::iterator i = std::find_if(_atoms.begin(), _atoms.end(),
         [&a](Atom* ua) { return ua == a; });
     _atoms.erase(i);
+    _atom_indices_dirty = true;
+    ++_bond_graph_generation;
     set_gc_shape();
     set_gc_adddel();
     _idatm_valid = false;
@@ -684,7 +849,7 @@ Structure::delete_atom(Atom* a)
 }
 
 static Atom*
-_find_attachment_atom(Residue* r, const std::set<Atom*>& atoms, std::set<Atom*>& bond_losers,
+_find_attachment_atom(Residue* r, const std::unordered_set<Atom*>& atoms, std::set<Atom*>& bond_losers,
     std::set<Atom*>& begin_missing_structure_atoms, std::set<Atom*>& end_missing_structure_atoms,
     bool left_side)
 {
@@ -737,7 +902,7 @@ _find_attachment_atom(Residue* r, const std::set<Atom*>& atoms, std::set<Atom*>&
 }
 
 void
-Structure::_delete_atoms(const std::set<Atom*>& atoms, bool verify)
+Structure::_delete_atoms(const std::unordered_set<Atom*>& atoms, bool verify)
 {
     if (verify)
         for (auto a: atoms)
@@ -771,22 +936,21 @@ Structure::_delete_atoms(const std::set<Atom*>& atoms, bool verify)
     _get_interres_connectivity(begin_ri_lookup, begin_ir_lookup, begin_res_connects_to_next,
         begin_left_missing_structure_atoms, begin_right_missing_structure_atoms);
 
-    std::map<Residue*, std::vector<Atom*>> res_del_atoms;
+    // hashed sets and single compaction passes throughout, since deleting
+    // most of a very large structure is common (e.g. "delete solvent")
+    std::unordered_map<Residue*, Atoms::size_type> res_del_counts;
     for (auto a: atoms) {
-        res_del_atoms[a->residue()].push_back(a);
+        ++res_del_counts[a->residue()];
         if (a->element().number() == 1)
             --_num_hyds;
     }
-    std::set<Residue*> res_removals;
-    for (auto& r_atoms: res_del_atoms) {
-        auto r = r_atoms.first;
-        auto& dels = r_atoms.second;
-        if (dels.size() == r->atoms().size()) {
+    std::unordered_set<Residue*> res_removals;
+    for (auto& r_count: res_del_counts) {
+        auto r = r_count.first;
+        if (r_count.second == r->atoms().size())
             res_removals.insert(r);
-        } else {
-            for (auto a: dels)
-                r->remove_atom(a);
-        }
+        else
+            r->remove_atoms(atoms);
     }
     if (res_removals.size() > 0) {
         if (_chains != nullptr) {
@@ -812,26 +976,38 @@ Structure::_delete_atoms(const std::set<Atom*>& atoms, bool verify)
                 return rm;
             });
         _residues.erase(new_end, _residues.end());
+        _residue_indices_dirty = true;
+        residue_lookup_changed();
     }
     // since the Bond destructor uses info (namely structure()) from its Atoms,
     // delete the bonds first (not willing to add a Structure pointer [and its
     // memory use] to Bond at this point)
-    std::set<Bond*> del_bonds;
+    std::unordered_set<Bond*> del_bonds;
     std::set<Atom*> bond_losers;
     for (auto a: atoms) {
         if (a->_rings.size() > 0)
-            _recompute_rings = true;
+            _discard_residue_rings(a->residue());
         for (auto b: a->bonds()) {
-            del_bonds.insert(b);
             auto oa = b->other_atom(a);
             if (atoms.find(oa) == atoms.end()) {
                 oa->remove_bond(b);
                 bond_losers.insert(oa);
+                del_bonds.insert(b);
+            } else if (a < oa) {
+                // both ends deleted; record the bond from only one of them
+                del_bonds.insert(b);
             }
         }
     }
-    for (auto b: del_bonds)
-        delete b;
+
+    auto new_b_end = std::remove_if(_bonds.begin(), _bonds.end(),
+        [&del_bonds](Bond* b) {
+            bool rm = del_bonds.find(b) != del_bonds.end();
+            if (rm) delete b;
+            return rm;
+        });
+    _bonds.erase(new_b_end, _bonds.end());
+    _bond_indices_dirty = true;
 
     // remove_if doesn't swap the removed items into the end of the vector,
     // so can't just go through the tail of the vector and delete things,
@@ -843,13 +1019,9 @@ Structure::_delete_atoms(const std::set<Atom*>& atoms, bool verify)
             return rm;
         });
     _atoms.erase(new_a_end, _atoms.end());
+    _atom_indices_dirty = true;
+    ++_bond_graph_generation;
 
-    auto new_b_end = std::remove_if(_bonds.begin(), _bonds.end(),
-        [&del_bonds](Bond* b) {
-            return del_bonds.find(b) != del_bonds.end();
-        });
-    _bonds.erase(new_b_end, _bonds.end());
-    
     _get_interres_connectivity(end_ri_lookup, end_ir_lookup, end_res_connects_to_next,
         end_left_missing_structure_atoms, end_right_missing_structure_atoms, &atoms);
     // for residues that don't connect to the next now but did before,
@@ -1005,7 +1177,7 @@ Structure::_get_interres_connectivity(std::map<Residue*, int>& res_lookup,
     std::map<Residue*, bool>& res_connects_to_next,
     std::set<Atom*>& left_missing_structure_atoms,
     std::set<Atom*>& right_missing_structure_atoms,
-    const std::set<Atom*>* deleted_atoms) const
+    const std::unordered_set<Atom*>* deleted_atoms) const
 {
     int i = 0;
     Residue *prev_r = nullptr;
@@ -1054,7 +1226,7 @@ Structure::delete_atoms(const std::vector<Atom*>& atoms)
 {
     auto db = DestructionBatcher(this);
     // construct set first to ensure uniqueness before tests...
-    auto del_atoms_set = std::set<Atom*>(atoms.begin(), atoms.end());
+    auto del_atoms_set = std::unordered_set<Atom*>(atoms.begin(), atoms.end());
     _delete_atoms(del_atoms_set);
 }
 
@@ -1078,19 +1250,21 @@ Structure::delete_bond(Bond *b)
     for (auto a: b->atoms())
         a->remove_bond(b);
     _bonds.erase(i);
+    _bond_indices_dirty = true;
+    ++_bond_graph_generation;
     set_gc_shape();
     set_gc_adddel();
     _structure_cats_dirty = true;
     _idatm_valid = false;
     if (b->_rings.size() > 0)
-        _recompute_rings = true;
+        _discard_rings(b);
     delete b;
 }
 
 void
 Structure::_delete_residue(Residue* r)
 {
-    auto del_atoms_set = std::set<Atom*>(r->atoms().begin(), r->atoms().end());
+    auto del_atoms_set = std::unordered_set<Atom*>(r->atoms().begin(), r->atoms().end());
     _delete_atoms(del_atoms_set, false);
 }
 
@@ -1124,18 +1298,21 @@ Structure::find_coord_set(int id) const
 Residue *
 Structure::find_residue(const ChainID &chain_id, int num, char insert) const
 {
-    for (auto ri = _residues.begin(); ri != _residues.end(); ++ri) {
-        Residue *r = *ri;
-        if (r->number() == num && r->chain_id() == chain_id
-        && r->insertion_code() == insert)
-            return r;
-    }
-    return nullptr;
+    if (!_residue_lookup_valid)
+        _index_residue_lookup();
+    auto i = _residue_lookup.find(_ResidueKey{chain_id, num, insert});
+    return i == _residue_lookup.end() ? nullptr : i->second;
 }
 
 Residue *
 Structure::find_residue(const ChainID& chain_id, int num, char insert, ResName& name) const
 {
+    Residue *first = find_residue(chain_id, num, insert);
+    if (first == nullptr || first->name() == name)
+        return first;
+    if (_residue_lookup_duplicates.find(_ResidueKey{chain_id, num, insert})
+    == _residue_lookup_duplicates.end())
+        return nullptr;
     for (auto ri = _residues.begin(); ri != _residues.end(); ++ri) {
         Residue *r = *ri;
         if (r->number() == num && r->name() == name && r->chain_id() == chain_id
@@ -1153,10 +1330,92 @@ Structure::_make_chains() const
     _chains_made = true;
 }
 
+// Estimated container sizes:  vectors by capacity, and tree and hash nodes
+// as their value plus the per-node pointers of the usual implementations.
+template <class V>
+static size_t
+vector_bytes(const V& v) { return v.capacity() * sizeof(typename V::value_type); }
+
+template <class M>
+static size_t
+tree_bytes(const M& m) { return m.size() * (4 * sizeof(void*) + sizeof(typename M::value_type)); }
+
+template <class M>
+static size_t
+hash_bytes(const M& m)
+{
+    return m.size() * (2 * sizeof(void*) + sizeof(typename M::value_type))
+        + m.bucket_count() * sizeof(void*);
+}
+
+std::map<std::string, size_t>
+Structure::memory_usage() const
+{
+    std::map<std::string, size_t> usage;
+    size_t& atoms = usage["atoms"];
+    size_t& alt_locs = usage["alt locs"];
+    atoms = _atom_pool->reserved_bytes() + vector_bytes(_atoms);
+    alt_locs = 0;
+    for (auto a: _atoms) {
+        atoms += vector_bytes(a->_bonds) + vector_bytes(a->_neighbors) + vector_bytes(a->_rings);
+        alt_locs += a->_alt_loc_map.bytes();
+        for (auto& alt_info: a->_alt_loc_map)
+            if (alt_info.second.aniso_u)
+                alt_locs += sizeof(std::vector<float>) + vector_bytes(*alt_info.second.aniso_u);
+        if (a->_aniso_u != nullptr)
+            atoms += sizeof(std::vector<float>) + vector_bytes(*a->_aniso_u);
+    }
+
+    size_t& bonds = usage["bonds"];
+    bonds = _bond_pool->reserved_bytes() + vector_bytes(_bonds);
+    for (auto b: _bonds)
+        bonds += vector_bytes(b->_rings);
+
+    size_t& residues = usage["residues"];
+    residues = _residue_pool->reserved_bytes() + vector_bytes(_residues);
+    for (auto r: _residues)
+        residues += vector_bytes(r->_atoms);
+    residues += hash_bytes(_residue_lookup) + hash_bytes(_residue_lookup_duplicates);
+
+    size_t& coordsets = usage["coordsets"];
+    coordsets = vector_bytes(_coord_sets);
+    for (auto cs: _coord_sets)
+        coordsets += sizeof(CoordSet) + vector_bytes(cs->_coords) + vector_bytes(cs->_xyz_float32)
+            + vector_bytes(cs->_xyz_int16) + hash_bytes(cs->_bfactor_map)
+            + hash_bytes(cs->_occupancy_map);
+
+    size_t& rings = usage["rings"];
+    rings = tree_bytes(_rings) + tree_bytes(_rings_dirty_residues);
+    for (auto& ring: _rings)
+        rings += tree_bytes(ring._bonds) + tree_bytes(ring._atoms);
+
+    size_t& chains = usage["chains"];
+    chains = 0;
+    if (_chains != nullptr) {
+        chains = sizeof(Chains) + vector_bytes(*_chains);
+        for (auto ch: *_chains)
+            chains += sizeof(Chain) + vector_bytes(ch->_residues) + tree_bytes(ch->_res_map)
+                + vector_bytes(ch->contents());
+    }
+
+    size_t& pseudobonds = usage["pseudobonds"];
+    pseudobonds = 0;
+    for (auto& name_grp: _pb_mgr.group_map()) {
+        auto& pbonds = name_grp.second->pseudobonds();
+        pseudobonds += tree_bytes(pbonds) + pbonds.size() * sizeof(Pseudobond);
+    }
+
+    // caches that are rebuilt when needed, so can be freed
+    usage["caches"] = vector_bytes(_display_state)
+        + (_cell_list == nullptr ? 0 : _cell_list->memory_usage())
+        + (_bond_graph == nullptr ? 0 : _bond_graph->memory_usage());
+    return usage;
+}
+
 Atom *
 Structure::new_atom(const char* name, const Element& e)
 {
-    Atom *a = new Atom(this, name, e);
+    Atom *a = new (_atom_pool) Atom(this, name, e);
     add_atom(a);
     if (e.number() == 1)
         ++_num_hyds;
@@ -1164,6 +1423,48 @@ Structure::new_atom(const char* name, const Element& e)
     return a;
 }
 
+std::vector<Atom*>
+Structure::new_hydrogens(const std::vector<Atom*>& parents, const std::vector<std::string>& names,
+    const Coord* coords, const int* serial_numbers, const Rgba* colors)
+{
+    size_t n = parents.size();
+    for (auto p: parents)
+        if (p->structure() != this)
+            throw std::invalid_argument("Hydrogen parent atoms must be in the structure");
+    change_tracker()->reserve_created<Atom>(this, n);
+    change_tracker()->reserve_created<Bond>(this, n);
+    _atoms.reserve(_atoms.size() + n);
+    _bonds.reserve(_bonds.size() + n);
+    const Element& hydrogen = Element::get_element(1);
+    CoordSet* cs = _coord_sets.empty() ? nullptr : _coord_sets[0];
+    std::vector<Atom*> hyds;
+    hyds.reserve(n);
+    for (size_t i = 0; i < n; ++i) {
+        Atom* parent = parents[i];
+        Atom* h = new_atom(names[i].c_str(), hydrogen);
+        parent->residue()->add_atom(h);
+        h->set_coord(coords[i], cs);
+        h->set_serial_number(serial_numbers[i]);
+        h->set_occupancy(1.0);
+        h->set_bfactor(parent->bfactor());
+        h->set_display(parent->display());
+        h->set_draw_mode(parent->draw_mode());
+        h->set_hide(parent->hide());
+        h->set_color(colors[i]);
+        // as struct_edit.add_bond(), the bond is a half bond if the parent's
+        // first bond is, else takes that bond's color
+        const auto& parent_bonds = parent->bonds();
+        bool halfbond = parent_bonds.empty() ? true : parent_bonds[0]->halfbond();
+        Rgba bond_color = parent_bonds.empty() ? h->color() : parent_bonds[0]->color();
+        Bond* b = new_bond(h, parent);
+        b->set_halfbond(halfbond);
+        if (!halfbond)
+            b->set_color(bond_color);
+        hyds.push_back(h);
+    }
+    return hyds;
+}
+
 static bool
 backbone_increases(Atom* a1, Atom* a2, const std::vector<AtomName>* names)
 {
@@ -1197,9 +1498,10 @@ follow_backbone(Atom* bb1, Atom* bb2, Atom* goal, std::set<Atom*>& seen)
 Bond *
 Structure::_new_bond(Atom *a1, Atom *a2, bool bond_only)
 {
-    Bond *b = new Bond(this, a1, a2, bond_only);
+    Bond *b = new (_bond_pool) Bond(this, a1, a2, bond_only);
     b->finish_construction(); // virtual calls work now
     add_bond(b);
+    _discard_rings(b);
     if (bond_only)
         return b;
     _idatm_valid = false;
@@ -1288,6 +1590,8 @@ Structure::_coord_set_insert(Structure::CoordSets &coord_sets, CoordSet* cs, int
         } else if (index == (*csi)->id()) {
             auto pos = csi - coord_sets.begin();
             bool update_active = (*csi == active_coord_set());
+            if (update_active)
+                _active_coord_set = nullptr;
             delete *csi;
             coord_sets[pos] = cs;
             if (update_active)
@@ -1302,7 +1606,7 @@ CoordSet*
 Structure::new_coord_set(int index)
 {
     if (!_coord_sets.empty())
-        return new_coord_set(index, _coord_sets.back()->coords().size());
+        return new_coord_set(index, _coord_sets.back()->coords_size());
     CoordSet* cs = new CoordSet(this, index);
     _coord_set_insert(_coord_sets, cs, index);
     return cs;
@@ -1323,8 +1627,16 @@ Structure::new_residue(const ResName& name, const ChainID& chain,
     if (chain.size() == 0)
         throw std::invalid_argument("Chain ID cannot be the empty string");
     if (neighbor == nullptr) {
-        _residues.emplace_back(new Residue(this, name, chain, pos, insert));
-        return _residues.back();
+        _residues.emplace_back(new (_residue_pool) Residue(this, name, chain, pos, insert));
+        Residue *r = _residues.back();
+        r->_structure_index = _residues.size() - 1;
+        if (_residue_lookup_valid) {
+            // appended residues come last, so can only add a duplicate key
+            _ResidueKey key{chain, pos, insert};
+            if (!_residue_lookup.emplace(key, r).second)
+                _residue_lookup_duplicates.insert(key);
+        }
+        return r;
     }
     auto ri = std::find_if(_residues.begin(), _residues.end(),
                 [&neighbor](Residue* vr) { return vr == neighbor; });
@@ -1332,11 +1644,54 @@ Structure::new_residue(const ResName& name, const ChainID& chain,
         throw std::out_of_range("Waypoint residue not in residue list");
     if (after)
         ++ri;
-    Residue *r = new Residue(this, name, chain, pos, insert);
+    Residue *r = new (_residue_pool) Residue(this, name, chain, pos, insert);
     _residues.insert(ri, r);
+    _residue_indices_dirty = true;
+    residue_lookup_changed();
     return r;
 }
 
+void
+Structure::_index_atoms() const
+{
+    unsigned int i = 0;
+    for (auto a: _atoms)
+        a->_structure_index = i++;
+    _atom_indices_dirty = false;
+}
+
+void
+Structure::_index_bonds() const
+{
+    unsigned int i = 0;
+    for (auto b: _bonds)
+        b->_structure_index = i++;
+    _bond_indices_dirty = false;
+}
+
+void
+Structure::_index_residue_lookup() const
+{
+    _residue_lookup.clear();
+    _residue_lookup_duplicates.clear();
+    _residue_lookup.reserve(_residues.size());
+    for (auto r: _residues) {
+        _ResidueKey key{r->chain_id(), r->number(), r->insertion_code()};
+        if (!_residue_lookup.emplace(key, r).second)
+            _residue_lookup_duplicates.insert(key);
+    }
+    _residue_lookup_valid = true;
+}
+
+void
+Structure::_index_residues() const
+{
+    unsigned int i = 0;
+    for (auto r: _residues)
+        r->_structure_index = i++;
+    _residue_indices_dirty = false;
+}
+
 std::set<ResName>
 Structure::nonstd_res_names() const
 {
@@ -1370,10 +1725,188 @@ Structure::renumber_residues(const std::vector<Residue*>& res_list, int start)
         if (r->number() >= start && r->number() < start + static_cast<int>(res_list.size()))
             throw std::logic_error("Renumbering residies will conflict with other existing residues");
     }
-    int num = start;
-    for (auto r: res_list) {
-        r->set_insertion_code(' ');
-        r->set_number(num++);
+    std::vector<int> numbers(res_list.size());
+    for (size_t i = 0; i < numbers.size(); ++i)
+        numbers[i] = start + static_cast<int>(i);
+    _set_residue_numbers(res_list, numbers, std::vector<char>(res_list.size(), ' '));
+}
+
+namespace {
+
+struct Residue_Key {
+    ChainID  chain_id;
+    int  number;
+    char  insertion_code;
+    bool  operator==(const Residue_Key& k) const {
+        return chain_id == k.chain_id && number == k.number && insertion_code == k.insertion_code;
+    }
+};
+
+struct Residue_Key_Hash {
+    size_t  operator()(const Residue_Key& k) const {
+        return k.chain_id.hash() ^ (std::hash<int>()(k.number) * 31 + k.insertion_code);
+    }
+};
+
+}  // namespace
+
+void
+Structure::_check_residue_keys(const std::vector<Residue*>& res_list,
+    const std::vector<ChainID>& chain_ids, const std::vector<int>& numbers,
+    const std::vector<char>& insertion_codes, const char* change) const
+{
+    // the proposed chain ID / number / insertion code of each changed residue
+    // must be distinct and not match any unchanged residue
+    std::unordered_set<const Residue*> changing(res_list.begin(), res_list.end());
+    std::unordered_map<Residue_Key, const Residue*, Residue_Key_Hash> proposed;
+    proposed.reserve(res_list.size());
+    for (size_t i = 0; i < res_list.size(); ++i) {
+        Residue_Key key = { chain_ids[i], numbers[i], insertion_codes[i] };
+        auto r_ins = proposed.emplace(key, res_list[i]);
+        if (!r_ins.second) {
+            std::stringstream err_msg;
+            err_msg << "Proposed " << change << " would give " << r_ins.first->second->str()
+                << " and " << res_list[i]->str() << " the same chain ID, number and insertion code";
+            throw std::logic_error(err_msg.str());
+        }
+    }
+    for (auto r: residues()) {
+        if (changing.find(r) != changing.end())
+            continue;
+        Residue_Key key = { r->chain_id(), r->number(), r->insertion_code() };
+        if (proposed.find(key) != proposed.end()) {
+            std::stringstream err_msg;
+            err_msg << "Proposed " << change << " conflicts with existing residue " << r->str();
+            throw std::logic_error(err_msg.str());
+        }
+    }
+}
+
+void
+Structure::_set_residue_numbers(const std::vector<Residue*>& res_list,
+    const std::vector<int>& numbers, const std::vector<char>& insertion_codes)
+{
+    std::vector<Residue*> number_changed, code_changed;
+    for (size_t i = 0; i < res_list.size(); ++i) {
+        Residue* r = res_list[i];
+        if (r->_insertion_code != insertion_codes[i]) {
+            r->_insertion_code = insertion_codes[i];
+            code_changed.push_back(r);
+        }
+        if (r->_number != numbers[i]) {
+            r->_number = numbers[i];
+            r->_numberings[_res_numbering] = numbers[i];
+            number_changed.push_back(r);
+        }
+    }
+    if (number_changed.empty() && code_changed.empty())
+        return;
+    residue_lookup_changed();
+    if (!number_changed.empty())
+        _change_tracker->add_modified_set(this, number_changed, ChangeTracker::REASON_NUMBER);
+    if (!code_changed.empty())
+        _change_tracker->add_modified_set(this, code_changed, ChangeTracker::REASON_INSERTION_CODE);
+}
+
+void
+Structure::renumber_residues(const std::vector<Residue*>& res_list, const std::vector<int>& numbers,
+    const std::vector<char>& insertion_codes, bool check_only)
+{
+    if (numbers.size() != res_list.size() || insertion_codes.size() != res_list.size())
+        throw std::logic_error("Need one number and insertion code per renumbered residue");
+    std::vector<ChainID> chain_ids;
+    chain_ids.reserve(res_list.size());
+    for (auto r: res_list)
+        chain_ids.push_back(r->chain_id());
+    _check_residue_keys(res_list, chain_ids, numbers, insertion_codes, "renumbering");
+    if (!check_only)
+        _set_residue_numbers(res_list, numbers, insertion_codes);
+}
+
+void
+Structure::change_residue_chain_ids(const std::vector<Residue*>& res_list,
+    const std::vector<ChainID>& chain_ids, bool check_only)
+{
+    if (chain_ids.size() != res_list.size())
+        throw std::logic_error("Need one chain ID per residue");
+
+    // Polymeric residues change with their whole chain, so the residues
+    // changing are the non-polymeric ones given plus all residues of the
+    // chains of the polymeric ones.
+    std::vector<Chain*> changed_chains;
+    std::unordered_map<Chain*, ChainID> chain_remapping;
+    std::vector<Residue*> changing, nonpolymeric;
+    std::vector<ChainID> changing_ids;
+    for (size_t i = 0; i < res_list.size(); ++i) {
+        Residue* r = res_list[i];
+        auto& id = chain_ids[i];
+        if (r->chain_id() == id)
+            continue;
+        auto chain = r->chain();
+        if (chain == nullptr) {
+            changing.push_back(r);
+            changing_ids.push_back(id);
+            nonpolymeric.push_back(r);
+            continue;
+        }
+        auto c_ins = chain_remapping.emplace(chain, id);
+        if (c_ins.second) {
+            changed_chains.push_back(chain);
+            for (auto cr: chain->residues()) {
+                if (cr != nullptr) {
+                    changing.push_back(cr);
+                    changing_ids.push_back(id);
+                }
+            }
+        } else if (c_ins.first->second != id) {
+            std::stringstream err_msg;
+            err_msg << "Cannot give residues of chain " << chain->chain_id()
+                << " two different chain IDs (" << c_ins.first->second << ", " << id << ")";
+            throw std::logic_error(err_msg.str());
+        }
+    }
+    if (changing.empty())
+        return;
+    std::vector<int> numbers;
+    std::vector<char> insertion_codes;
+    numbers.reserve(changing.size());
+    insertion_codes.reserve(changing.size());
+    for (auto r: changing) {
+        numbers.push_back(r->number());
+        insertion_codes.push_back(r->insertion_code());
+    }
+    _check_residue_keys(changing, changing_ids, numbers, insertion_codes, "chain ID change");
+    // Chains can trade IDs with each other but not take the ID of an
+    // unchanged chain or of another changed chain.
+    std::unordered_set<ChainID> other_chain_ids;
+    for (auto chain: chains())
+        if (chain_remapping.find(chain) == chain_remapping.end())
+            other_chain_ids.insert(chain->chain_id());
+    for (auto& chain_id: chain_remapping) {
+        if (!other_chain_ids.insert(chain_id.second).second) {
+            std::stringstream err_msg;
+            err_msg << "New chain ID '" << chain_id.second << "' already assigned to another chain";
+            throw std::logic_error(err_msg.str());
+        }
+    }
+    if (check_only)
+        return;
+
+    for (auto chain: changed_chains)
+        static_cast<StructureSeq*>(chain)->set_chain_id(chain_remapping[chain]);
+    for (size_t i = 0; i < nonpolymeric.size(); ++i) {
+        Residue* r = nonpolymeric[i];
+        r->_chain_id = changing_ids[i];
+        if (!lower_case_chains)
+            for (auto c: r->_chain_id)
+                if (std::islower(c)) {
+                    lower_case_chains = true;
+                    break;
+                }
+    }
+    if (!nonpolymeric.empty()) {
+        residue_lookup_changed();
+        _change_tracker->add_modified_set(this, nonpolymeric, ChangeTracker::REASON_CHAIN_ID);
     }
 }
 
@@ -1392,6 +1925,8 @@ Structure::reorder_residues(const Structure::Residues& new_order)
                 " in new residue order");
     }
     _residues = new_order;
+    _residue_indices_dirty = true;
+    residue_lookup_changed();
 }
 
 const Structure::Rings&
@@ -1399,11 +1934,14 @@ Structure::rings(bool cross_residues, unsigned int all_size_threshold,
     std::set<const Residue *>* ignore) const
 {
     if (_rings_cached(cross_residues, all_size_threshold, ignore)) {
+        if (!_rings_dirty_residues.empty())
+            _update_dirty_rings();
         return _rings;
     }
 
     auto db = DestructionBatcher(const_cast<Structure*>(this));
     _recompute_rings = false;
+    _rings_dirty_residues.clear();
     _rings_last_cross_residues = cross_residues;
     _rings_last_all_size_threshold = all_size_threshold;
     _rings_last_ignore = ignore;
@@ -1532,13 +2070,14 @@ Structure::session_info(PyObject* ints, PyObject* floats, PyObject* misc) const
 
     // atoms
     // We need to remember names and elements ourself for constructing the atoms.
-    // Make a list of num_atom+1 items, the first of which will be the list of
-    //   names and the remainder of which will be empty lists which will be handed
-    //   off individually to the atoms.
+    // The misc info is a two-item list: the atom names and the table of IDATM types
+    //   that the atoms' int data index into.  That way there are no per-atom Python
+    //   objects beyond the names, and the atoms' numeric data can be filled in
+    //   by several threads.
     int num_atoms = atoms().size();
     int num_ints = num_atoms; // list of elements
     int num_floats = 0;
-    PyObject* atoms_misc = PyList_New(num_atoms+1);
+    PyObject* atoms_misc = PyList_New(2);
     if (atoms_misc == nullptr)
         throw std::runtime_error("Cannot create Python list for atom misc info");
     if (PyList_Append(misc, atoms_misc) < 0)
@@ -1548,19 +2087,36 @@ Structure::session_info(PyObject* ints, PyObject* floats, PyObject* misc) const
     if (atom_names == nullptr)
         throw std::runtime_error("Cannot create Python list for atom names");
     PyList_SET_ITEM(atoms_misc, 0, atom_names);
+    std::map<AtomType, int> idatm_type_indices;
+    std::vector<const AtomType*> idatm_types;
+    std::vector<int> atom_int_offsets, atom_float_offsets;
+    atom_int_offsets.reserve(num_atoms);
+    atom_float_offsets.reserve(num_atoms);
     int i = 0;
     for (auto a: atoms()) {
+        atom_int_offsets.push_back(num_ints);
+        atom_float_offsets.push_back(num_floats);
         num_ints += a->session_num_ints();
         num_floats += a->session_num_floats();
+        for (auto idatm_type: { &a->_computed_idatm_type, &a->_explicit_idatm_type }) {
+            if (idatm_type_indices.find(*idatm_type) == idatm_type_indices.end()) {
+                idatm_type_indices[*idatm_type] = idatm_types.size();
+                idatm_types.push_back(idatm_type);
+            }
+        }
 
         // remember name
         PyList_SET_ITEM(atom_names, i++, cchar_to_pystring(a->name(), "atom name"));
     }
+    PyObject* py_idatm_types = PyList_New(idatm_types.size());
+    if (py_idatm_types == nullptr)
+        throw std::runtime_error("Cannot create Python list for IDATM types");
+    PyList_SET_ITEM(atoms_misc, 1, py_idatm_types);
+    i = 0;
+    for (auto idatm_type: idatm_types)
+        PyList_SET_ITEM(py_idatm_types, i++, cchar_to_pystring(*idatm_type, "IDATM type"));
     int* atom_ints;
     PyObject* atom_npy_ints = python_int_array(num_ints, &atom_ints);
-    for (auto a: atoms()) {
-        *atom_ints++ = a->element().number();
-    }
     if (PyList_Append(ints, atom_npy_ints) < 0)
         throw std::runtime_error("Couldn't append atom ints to int list");
     Py_DECREF(atom_npy_ints);
@@ -1569,13 +2125,24 @@ Structure::session_info(PyObject* ints, PyObject* floats, PyObject* misc) const
     if (PyList_Append(floats, atom_npy_floats) < 0)
         throw std::runtime_error("Couldn't append atom floats to float list");
     Py_DECREF(atom_npy_floats);
-    i = 1;
-    for (auto a: atoms()) {
-        PyObject* empty_list = PyList_New(0);
-        if (empty_list == nullptr)
-            throw std::runtime_error("Cannot create Python list for individual atom misc info");
-        PyList_SET_ITEM(atoms_misc, i++, empty_list);
-        a->session_save(&atom_ints, &atom_floats, empty_list);
+    // each atom's data goes at a known offset, so fill it in parallel
+    auto save_atoms = [&](int start, int end) {
+        for (int ai = start; ai < end; ++ai) {
+            Atom* a = _atoms[ai];
+            atom_ints[ai] = a->element().number();
+            int* a_ints = atom_ints + atom_int_offsets[ai];
+            float* a_floats = atom_floats + atom_float_offsets[ai];
+            a->session_save(&a_ints, &a_floats, idatm_type_indices);
+        }
+    };
+    int num_threads = Thread_Pool::thread_count(num_atoms, 50000);
+    if (num_threads <= 1) {
+        save_atoms(0, num_atoms);
+    } else {
+        int per_thread = (num_atoms + num_threads - 1) / num_threads;
+        Thread_Pool::run(num_threads, [&](int t) {
+            save_atoms(t * per_thread, std::min(num_atoms, (t+1) * per_thread));
+        });
     }
 
     // bonds
@@ -1595,8 +2162,8 @@ Structure::session_info(PyObject* ints, PyObject* floats, PyObject* misc) const
     PyObject* bond_npy_ints = python_int_array(num_ints, &bond_ints);
     *bond_ints++ = num_bonds;
     for (auto b: bonds()) {
-        *bond_ints++ = (*session_save_atoms)[b->atoms()[0]];
-        *bond_ints++ = (*session_save_atoms)[b->atoms()[1]];
+        *bond_ints++ = atom_index(b->atoms()[0]);
+        *bond_ints++ = atom_index(b->atoms()[1]);
     }
     if (PyList_Append(ints, bond_npy_ints) < 0)
         throw std::runtime_error("Couldn't append bond ints to int list");
@@ -1888,8 +2455,15 @@ Structure::session_restore(int version, PyObject* ints, PyObject* floats, PyObje
         throw std::invalid_argument("atom names missing");
     std::vector<AtomName> atom_names;
     pysequence_of_string_to_cvec(PySequence_Fast_GET_ITEM(atoms_misc, 0), atom_names, "atom name");
-    if ((decltype(atom_names)::size_type)(PySequence_Fast_GET_SIZE(atoms_misc)) != atom_names.size() + 1)
-        throw std::invalid_argument("bad atom misc info");
+    std::vector<AtomType> idatm_types;
+    if (version < 20) {
+        if ((decltype(atom_names)::size_type)(PySequence_Fast_GET_SIZE(atoms_misc)) != atom_names.size() + 1)
+            throw std::invalid_argument("bad atom misc info");
+    } else {
+        if (PySequence_Fast_GET_SIZE(atoms_misc) != 2)
+            throw std::invalid_argument("bad atom misc info");
+        pysequence_of_string_to_cvec(PySequence_Fast_GET_ITEM(atoms_misc, 1), idatm_types, "IDATM type");
+    }
     PyObject* atom_ints = PyTuple_GET_ITEM(ints, 1);
     iarray = Numeric_Array();
     if (!array_from_python(atom_ints, 1, Numeric_Array::Int, &iarray, false))
@@ -1907,7 +2481,10 @@ Structure::session_restore(int version, PyObject* ints, PyObject* floats, PyObje
     int i = 1; // atom names are in slot zero
     for (auto aname: atom_names) {
         auto a = new_atom(aname.c_str(), Element::get_element(*element_ints++));
-        a->session_restore(version, &int_array, &float_array, PySequence_Fast_GET_ITEM(atoms_misc, i++));
+        if (version < 20)
+            a->session_restore(version, &int_array, &float_array, PySequence_Fast_GET_ITEM(atoms_misc, i++));
+        else
+            a->session_restore(version, &int_array, &float_array, nullptr, &idatm_types);
     }
 
     // bonds
@@ -2060,18 +2637,6 @@ Structure::session_save_setup() const
 {
     size_t index = 0;
 
-    session_save_atoms = new std::unordered_map<const Atom*, size_t>;
-    for (auto a: atoms()) {
-        (*session_save_atoms)[a] = index++;
-    }
-
-    index = 0;
-    session_save_bonds = new std::unordered_map<const Bond*, size_t>;
-    for (auto b: bonds()) {
-        (*session_save_bonds)[b] = index++;
-    }
-
-    index = 0;
     session_save_chains = new std::unordered_map<const Chain*, size_t>;
     for (auto c: chains()) {
         (*session_save_chains)[c] = index++;
@@ -2083,27 +2648,26 @@ Structure::session_save_setup() const
         (*session_save_crdsets)[cs] = index++;
     }
 
-    index = 0;
-    session_save_residues = new std::unordered_map<const Residue*, size_t>;
-    for (auto r: residues()) {
-        (*session_save_residues)[r] = index++;
-    }
-
     _pb_mgr.session_save_setup();
 }
 
 void
 Structure::session_save_teardown() const
 {
-    delete session_save_atoms;
-    delete session_save_bonds;
     delete session_save_chains;
     delete session_save_crdsets;
-    delete session_save_residues;
 
     _pb_mgr.session_save_teardown();
 }
 
+size_t
+Structure::residue_index(const Residue* r) const
+{
+    if (_residue_indices_dirty)
+        _index_residues();
+    return r->_structure_index;
+}
+
 void
 Structure::set_active_coord_set(CoordSet *cs)
 {
@@ -2120,7 +2684,10 @@ Structure::set_active_coord_set(CoordSet *cs)
         new_active = cs;
     }
     if (_active_coord_set != new_active) {
+        if (_active_coord_set != nullptr)
+            _active_coord_set->release_expanded();
         _active_coord_set = new_active;
+        coords_changed();
         pb_mgr().change_cs(new_active);
         if (active_coord_set_change_notify()) {
             set_gc_shape();
@@ -2230,6 +2797,7 @@ Structure::set_res_numbering(ResNumbering rn)
     if (rn == _res_numbering)
         return;
     _res_numbering = rn;
+    residue_lookup_changed();
     for (auto r: residues()) {
         auto new_number = r->_numberings[rn];
         if (new_number != r->number()) {
@@ -2242,7 +2810,7 @@ Structure::set_res_numbering(ResNumbering rn)
 void
 Structure::use_best_alt_locs()
 {
-    std::map<Residue *, char> alt_loc_map = best_alt_locs();
+    auto alt_loc_map = best_alt_locs();
     for (auto almi = alt_loc_map.begin(); almi != alt_loc_map.end(); ++almi) {
         (*almi).first->set_alt_loc((*almi).second);
     }
@@ -41,6 +41,7 @@
 #include "ChangeTracker.h"
 #include "CompSS.h"
 #include "destruct.h"
+#include "ObjectPool.h"
 #include "PBManager.h"
 #include "polymer.h"
 #include "Real.h"
@@ -106,6 +107,22 @@ public:
 // add any) so that they can be treated identically in the Python
 // layer.  Some atomic-structure-specific methods will have no-op
 // implementations in Structure and real implementations in AtomicStructure.
+class AtomCellList;
+class BondGraph;
+
+// Per-atom display state packed into 8 bytes, for graphics updates that
+// need all of an atom's color and visibility at once.
+struct AtomDisplayState {
+    static const unsigned char  DISPLAY = 0x1;
+    static const unsigned char  SELECTED = 0x2;
+    static const unsigned char  VISIBLE = 0x4;
+
+    Rgba::Channel  r, g, b, a;
+    unsigned char  flags;
+    unsigned char  draw_mode;
+    unsigned short  hide; // low 16 hide bits
+};
+
 class ATOMSTRUCT_IMEX Structure: public GraphicsChanges,
         public pyinstance::PythonInstance<Structure> {
     friend class Atom; // for IDATM stuff and structure categories
@@ -143,11 +160,47 @@ protected:
     mutable bool  _ss_change_notify = true;
     bool  _atom_types_notify = true;
     Atoms  _atoms;
+    // whether the atoms', bonds' and residues' indices into the vectors above need
+    // recomputing; appends keep them current, other changes just mark them dirty
+    mutable bool  _atom_indices_dirty = false;
+    mutable bool  _bond_indices_dirty = false;
+    mutable bool  _residue_indices_dirty = false;
+    // (chain ID, number, insertion code) -> first residue in residue order having
+    // them, for find_residue(); built on first use and discarded by changes
+    struct _ResidueKey {
+        ChainID  chain_id;
+        int  number;
+        char  insert;
+        bool  operator==(const _ResidueKey& k) const
+            { return number == k.number && insert == k.insert && chain_id == k.chain_id; }
+    };
+    struct _ResidueKeyHash {
+        size_t  operator()(const _ResidueKey& k) const {
+            return std::hash<ChainID>()(k.chain_id) * 31
+                + std::hash<int>()(k.number) * 127 + static_cast<unsigned char>(k.insert);
+        }
+    };
+    mutable std::unordered_map<_ResidueKey, Residue*, _ResidueKeyHash>  _residue_lookup;
+    // keys shared by more than one residue
+    mutable std::unordered_set<_ResidueKey, _ResidueKeyHash>  _residue_lookup_duplicates;
+    mutable bool  _residue_lookup_valid = false;
     float  _ball_scale = 0.25;
     Bonds  _bonds;
+    mutable BondGraph*  _bond_graph = nullptr;
+    mutable unsigned long  _bond_graph_built = 0;
+    unsigned long  _bond_graph_generation = 1;
+    mutable AtomCellList*  _cell_list = nullptr;
+    mutable unsigned long  _cell_list_generation = 0;
     mutable Chains*  _chains;
     mutable bool  _chains_made = false;
     ChangeTracker*  _change_tracker;
+    unsigned long  _coord_generation = 1;
+    ObjectPool*  _atom_pool;
+    ObjectPool*  _bond_pool;
+    ObjectPool*  _residue_pool;
+    mutable std::vector<AtomDisplayState>  _display_state;
+    unsigned long  _display_state_generation = 1;
+    mutable unsigned long  _display_state_built = 0;
     CoordSets  _coord_sets;
     bool  _copying_or_restoring = false;
     bool  _display = true;
@@ -174,14 +227,16 @@ protected:
     int  _ribbon_tether_sides = 4;
     int _ring_display_count = 0;
     mutable Rings  _rings;
+    // residues whose rings were discarded by bond changes and need re-perception
+    mutable std::set<const Residue *>  _rings_dirty_residues;
     mutable unsigned int  _rings_last_all_size_threshold;
     mutable bool  _rings_last_cross_residues;
     mutable std::set<const Residue *>*  _rings_last_ignore;
     bool  _ss_assigned;
     mutable bool  _structure_cats_dirty;
 
-    void  add_bond(Bond* b) { _bonds.emplace_back(b); set_gc_shape(); set_gc_adddel(); }
-    void  add_atom(Atom* a) { _atoms.emplace_back(a); set_gc_shape(); set_gc_adddel(); }
+    void  add_bond(Bond* b);
+    void  add_atom(Atom* a);
     void  _calculate_rings(bool cross_residue, unsigned int all_size_threshold,
             std::set<const Residue *>* ignore) const;
     virtual void  _compute_atom_types() {}
@@ -191,8 +246,18 @@ protected:
     void  _copy(Structure* s, PositionMatrix coord_adjust = nullptr,
         std::map<ChainID, ChainID>* chain_id_map = nullptr) const;
     void  _delete_atom(Atom* a);
-    void  _delete_atoms(const std::set<Atom*>& atoms, bool verify=false);
+    void  _delete_atoms(const std::unordered_set<Atom*>& atoms, bool verify=false);
     void  _delete_residue(Residue* r);
+    void  _index_atoms() const;
+    void  _check_residue_keys(const std::vector<Residue*>&, const std::vector<ChainID>&,
+        const std::vector<int>&, const std::vector<char>&, const char*) const;
+    void  _set_residue_numbers(const std::vector<Residue*>&, const std::vector<int>&,
+        const std::vector<char>&);
+    void  _index_bonds() const;
+    void  _index_residues() const;
+    void  _index_residue_lookup() const;
+    void  _discard_residue_rings(const Residue* r) const;
+    void  _discard_rings(const Bond* b) const;
     void  _fast_calculate_rings(std::set<const Residue *>* ignore) const;
     bool  _fast_ring_calc_available(bool cross_residue,
             unsigned int all_size_threshold,
@@ -203,7 +268,7 @@ protected:
             std::map<Residue*, bool>& res_connects_to_next,
             std::set<Atom*>& left_missing_structure_atoms,
             std::set<Atom*>& right_missing_structure_atoms,
-            const std::set<Atom*>* deleted_atoms = nullptr) const;
+            const std::unordered_set<Atom*>* deleted_atoms = nullptr) const;
     virtual void  _make_chains() const;
     Bond*  _new_bond(Atom* a1, Atom* a2, bool bond_only);
     Chain*  _new_chain(const ChainID& chain_id, PolymerType pt = PT_NONE) const {
@@ -212,7 +277,7 @@ protected:
         return chain;
     }
     void  _per_residue_rings(unsigned int all_size_threshold, std::set<const Residue *>* ignore,
-        Rings* rings = nullptr) const;
+        Rings* rings = nullptr, const std::set<const Residue *>* only = nullptr) const;
     void  _per_structure_rings(unsigned int all_size_threshold, std::set<const Residue *>* ignore) const;
     void  remove_chain(Chain* chain) {
         _chains->erase(std::find(_chains->begin(), _chains->end(), chain));
@@ -231,6 +296,7 @@ protected:
     }
     void  _temporary_per_residue_rings(Rings& rings, unsigned int all_size_threshold,
         std::set<const Residue *>* ignore) const;
+    void  _update_dirty_rings() const;
 
 public:
     Structure(PyObject* logger = nullptr);
@@ -238,31 +304,63 @@ public:
 
     bool  active_coord_set_change_notify() const { return _active_coord_set_change_notify; }
     CoordSet*  active_coord_set() const { return _active_coord_set; };
+    // Cell list of atom coordinates for distance searches, cached until atom
+    // coordinates change or a different cell size is requested.
+    const AtomCellList&  cell_list(double cell_size) const;
+    // Cached cell list if its cells are within a factor of two of cell_size,
+    // so searches at varying distances share one list, otherwise cell_list().
+    const AtomCellList&  cell_list_near(double cell_size) const;
+    // Count of changes to the coordinates returned by Atom::coord().
+    unsigned long  coord_generation() const { return _coord_generation; }
+    void  coords_changed() { ++_coord_generation; }
+    // Packed display state of all atoms, in atoms() order, rebuilt only after
+    // an atom's color, display, hide bits, selection or draw mode changes.
+    const std::vector<AtomDisplayState>&  atom_display_state() const;
+    void  display_state_changed() { ++_display_state_generation; }
     bool  alt_loc_change_notify() const { return _alt_loc_change_notify; }
     bool  ss_change_notify() const { return _ss_change_notify; }
     bool  asterisks_translated;
     const Atoms&  atoms() const { return _atoms; }
+    // Dense indices into atoms(), bonds() and residues(), for use as array
+    // indices instead of building pointer-keyed maps
+    size_t  atom_index(const Atom* a) const;
+    size_t  bond_index(const Bond* b) const;
+    size_t  residue_index(const Residue* r) const;
     float  ball_scale() const { return _ball_scale; }
-    std::map<Residue *, char>  best_alt_locs() const;
+    std::unordered_map<Residue *, char>  best_alt_locs() const;
     void  bonded_groups(std::vector<std::vector<Atom*>>* groups,
         bool consider_missing_structure) const;
+    // Compressed sparse row copy of the bonds, rebuilt only after atoms or bonds
+    // are added or deleted, or an element or IDATM type changes.
+    const BondGraph&  bond_graph(bool idatm_types = false) const;
+    void  bond_graph_changed() { ++_bond_graph_generation; }
     const Bonds&  bonds() const { return _bonds; }
     const Chains&  chains() const { if (!_chains_made) _make_chains(); return *_chains; }
     bool  chains_made() const { return _chains_made; }
     void  change_chain_ids(const std::vector<StructureSeq*>, const std::vector<ChainID>,
         bool /*non-polymeric*/=true);
+    // Give each residue a chain ID, changing polymeric residues by changing their whole
+    // chain, with one change notification.  Throws std::logic_error, without changing
+    // anything, if residues would end up with the same chain ID, number and insertion code.
+    // With check_only, only checks.
+    void  change_residue_chain_ids(const std::vector<Residue*>&, const std::vector<ChainID>&,
+        bool check_only = false);
     ChangeTracker*  change_tracker() { return _change_tracker; }
     void  clear_coord_sets();
     void  combine(Structure* s, std::map<ChainID, ChainID>* chain_id_map,
         PositionMatrix coord_adjust=nullptr) const { _copy(s, coord_adjust, chain_id_map); }
     void  combine_sym_atoms();
     virtual void  compute_secondary_structure(float = -0.5, int = 3, int = 3,
-        bool = false, CompSSInfo* = nullptr) {}
+        bool = false, CompSSInfo* = nullptr, float = 0.0) {}
+    virtual void  compute_frames_secondary_structure(const std::vector<CoordSet*>&,
+        unsigned char*, float = -0.5, int = 3, int = 3, int = 1) {}
     const CoordSets&  coord_sets() const { return _coord_sets; }
     virtual Structure*  copy() const;
     void  delete_alt_locs();
     void  delete_atom(Atom* a);
-    void  delete_atoms(const std::set<Atom*>& atoms) { _delete_atoms(atoms); }
+    void  delete_atoms(const std::set<Atom*>& atoms) {
+        _delete_atoms(std::unordered_set<Atom*>(atoms.begin(), atoms.end()));
+    }
     void  delete_atoms(const std::vector<Atom*>& atoms);
     void  delete_bond(Bond* b);
     void  delete_residue(Residue* r);
@@ -274,6 +372,14 @@ public:
     Residue*  find_residue(const ChainID& chain_id, int pos, char insert) const;
     Residue*  find_residue(const ChainID& chain_id, int pos, char insert,
         ResName& name) const;
+    // called when a residue's chain ID, number or insertion code changes
+    void  residue_lookup_changed() {
+        if (_residue_lookup_valid) {
+            _residue_lookup_valid = false;
+            _residue_lookup.clear();
+            _residue_lookup_duplicates.clear();
+        }
+    }
     bool  idatm_failed() { ready_idatm_types(); return _idatm_failed; }
     bool  idatm_valid() const { return _idatm_valid; }
     const InputSeqInfo&  input_seq_info() const { return _input_seq_info; }
@@ -281,9 +387,19 @@ public:
     bool  is_traj;
     PyObject*  logger() const { return _logger; }
     bool  lower_case_chains;
+    // Approximate bytes held by the structure, by category ("atoms", "bonds",
+    // "coordsets", "alt locs", "rings", ...), from container capacities and
+    // estimated map and set node sizes.
+    std::map<std::string, size_t>  memory_usage() const;
     std::map<std::string, std::vector<std::string>> metadata;
     Atom*  new_atom(const char* name, const Element& e);
     Bond*  new_bond(Atom* a1, Atom* a2) { return _new_bond(a1, a2, false); }
+    // Hydrogens bonded to the parent atoms, as the addh command makes them: with
+    // the given names, coordinates (in the first coordinate set), serial numbers
+    // and colors, full occupancy, and the B-factor and display of their parents.
+    std::vector<Atom*>  new_hydrogens(const std::vector<Atom*>& parents,
+        const std::vector<std::string>& names, const Coord* coords, const int* serial_numbers,
+        const Rgba* colors);
     CoordSet*  new_coord_set();
     CoordSet*  new_coord_set(int index);
     CoordSet*  new_coord_set(int index, int size);
@@ -314,6 +430,12 @@ public:
     const PositionMatrix&  position() const { return _position; }
     void  ready_idatm_types() { if (!_idatm_valid) _compute_idatm_types(); }
     void  renumber_residues(const std::vector<Residue*>& res_list, int start);
+    // Set numbers and insertion codes of many residues in one pass with one change
+    // notification.  Throws std::logic_error, without changing anything, if residues
+    // would end up with the same chain ID, number and insertion code.  With check_only,
+    // only checks.
+    void  renumber_residues(const std::vector<Residue*>& res_list, const std::vector<int>& numbers,
+        const std::vector<char>& insertion_codes, bool check_only = false);
     void  reorder_residues(const Residues&); 
     ResNumbering  res_numbering() const { return _res_numbering; }
     bool  res_numbering_valid(ResNumbering rn) const { return _res_numbering_valid[rn]; }
@@ -325,11 +447,9 @@ public:
     void  session_restore(int version, PyObject* ints, PyObject* floats, PyObject* misc);
     void  session_restore_setup() const { _pb_mgr.session_restore_setup();}
     void  session_restore_teardown() const { _pb_mgr.session_restore_teardown();}
-    mutable std::unordered_map<const Atom*, size_t>  *session_save_atoms;
-    mutable std::unordered_map<const Bond*, size_t>  *session_save_bonds;
+    // atoms, bonds and residues are saved by their index (atom_index() etc.)
     mutable std::unordered_map<const Chain*, size_t>  *session_save_chains;
     mutable std::unordered_map<const CoordSet*, size_t>  *session_save_crdsets;
-    mutable std::unordered_map<const Residue*, size_t>  *session_save_residues;
     void  session_save_setup() const;
     void  session_save_teardown() const;
     void  set_active_coord_set_change_notify(bool cn) { _active_coord_set_change_notify = cn; }
@@ -477,6 +597,7 @@ Structure::clear_coord_sets() {
         delete cs;
     _coord_sets.clear();
     _active_coord_set = nullptr;
+    coords_changed();
 }
 
 } //  namespace atomstruct
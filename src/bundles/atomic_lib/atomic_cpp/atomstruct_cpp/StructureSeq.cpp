@@ -43,7 +43,7 @@ namespace atomstruct {
 
 StructureSeq::StructureSeq(const ChainID& chain_id, Structure* s, PolymerType pt):
     Sequence(std::string("chain ") + (chain_id == " " ? "(blank)" : chain_id.c_str())),
-    _chain_id(chain_id), _from_seqres(false), _is_chain(false), _polymer_type(pt), _structure(s)
+    DestructionObserver(DESTROYED_RESIDUES), _chain_id(chain_id), _from_seqres(false), _is_chain(false), _polymer_type(pt), _structure(s)
 {
     if (!s->lower_case_chains) {
         for (auto c: chain_id) {
@@ -131,7 +131,7 @@ StructureSeq::demote_to_structure_sequence()
 }
 
 void
-StructureSeq::destructors_done(const std::set<void*>& destroyed)
+StructureSeq::destructors_done(const std::unordered_set<void*>& destroyed)
 {
     if (is_chain())
         // Chains keep their residue lists up to date "by hand"
@@ -369,16 +369,15 @@ StructureSeq::session_save(int** ints, float** floats) const
     int_ptr[4] = _is_chain;
     int_ptr += SESSION_NUM_INTS();
 
-    auto& ses_res = *_structure->session_save_residues;
     for (auto r_pos: _res_map) {
-        *int_ptr++ = ses_res[r_pos.first];
+        *int_ptr++ = _structure->residue_index(r_pos.first);
         *int_ptr++ = r_pos.second;
     }
     for (auto r: _residues) {
         if (r == nullptr)
             *int_ptr++ = -1;
         else
-            *int_ptr++ = ses_res[r];
+            *int_ptr++ = _structure->residue_index(r);
     }
 }
 
@@ -435,6 +434,8 @@ StructureSeq::set_chain_id(ChainID chain_id)
             set_name(new_name);
         }
         _chain_id = chain_id;
+        if (is_chain())
+            _structure->residue_lookup_changed();
         if (!structure()->lower_case_chains) {
             for (auto c: chain_id) {
                 if (std::islower(c)) {
@@ -446,10 +447,13 @@ StructureSeq::set_chain_id(ChainID chain_id)
         if (is_chain()) {
             _structure->change_tracker()->add_modified(_structure, dynamic_cast<Chain*>(this),
                 ChangeTracker::REASON_CHAIN_ID);
+            std::vector<Residue*> existing;
+            existing.reserve(residues().size());
             for (auto r: residues())
                 if (r != nullptr)
-                    _structure->change_tracker()->add_modified(_structure, r,
-                        ChangeTracker::REASON_CHAIN_ID);
+                    existing.push_back(r);
+            _structure->change_tracker()->add_modified_set(_structure, existing,
+                ChangeTracker::REASON_CHAIN_ID);
         }
     }
 }
@@ -29,6 +29,7 @@
 
 #include <map>
 #include <set>
+#include <unordered_set>
 #include <string>
 #include <vector>
 
@@ -95,7 +96,7 @@ public:
     const Contents&  characters() const { return _contents; }
     Contents::const_iterator  end() const { return Sequence::end(); }
     const std::string&  description() const { return _description; }
-    virtual void  destructors_done(const std::set<void*>& destroyed);
+    virtual void  destructors_done(const std::unordered_set<void*>& destroyed);
     // is character sequence derived from SEQRES records (or equivalent)?
     bool  from_seqres() const { return _from_seqres; }
     Contents::const_reference  front() const { return Sequence::front(); }
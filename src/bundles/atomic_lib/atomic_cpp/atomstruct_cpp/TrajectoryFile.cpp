@@ -0,0 +1,162 @@
+// vi: set expandtab ts=4 sw=4:
+
+/*
+ * === UCSF ChimeraX Copyright ===
+ * Copyright 2022 Regents of the University of California. All rights reserved.
+ * The ChimeraX application is provided pursuant to the ChimeraX license
+ * agreement, which covers academic and commercial uses. For more details, see
+ * <http://www.rbvi.ucsf.edu/chimerax/docs/licensing.html>
+ *
+ * This particular file is part of the ChimeraX library. You can also
+ * redistribute and/or modify it under the terms of the GNU Lesser General
+ * Public License version 2.1 as published by the Free Software Foundation.
+ * For more details, see
+ * <https://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESSED OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. ADDITIONAL LIABILITY
+ * LIMITATIONS ARE DESCRIBED IN THE GNU LESSER GENERAL PUBLIC LICENSE
+ * VERSION 2.1
+ *
+ * This notice must be embedded in or attached to all copies, including partial
+ * copies, of the software or any revisions or derivations thereof.
+ * === UCSF ChimeraX Copyright ===
+ */
+
+#include <algorithm>    // for std::max, std::min
+#include <cstring>      // for memcpy
+#include <fstream>
+#include <stdexcept>
+
+#define ATOMSTRUCT_EXPORT
+#include "Atom.h"
+#include "CoordSet.h"
+#include "Structure.h"
+#include "TrajectoryFile.h"
+
+namespace atomstruct {
+
+TrajectoryFile::TrajectoryFile(const std::string& path, const std::vector<int64_t>& frame_offsets,
+    const Layout& layout, size_t memory_budget): _path(path), _frame_offsets(frame_offsets),
+    _layout(layout), _memory_budget(memory_budget), _prefetch_frame(0)
+{
+}
+
+TrajectoryFile::~TrajectoryFile()
+{
+    if (_prefetch.valid())
+        _prefetch.wait();
+}
+
+template <typename T>
+static T
+swapped_value(const char* v, bool byte_swap)
+{
+    char b[sizeof(T)];
+    if (byte_swap)
+        for (size_t i = 0; i < sizeof(T); ++i)
+            b[i] = v[sizeof(T)-1-i];
+    else
+        memcpy(b, v, sizeof(T));
+    T value;
+    memcpy(&value, b, sizeof(T));
+    return value;
+}
+
+void
+TrajectoryFile::_read_frame(size_t frame, Coords& coords) const
+{
+    const Layout& l = _layout;
+    size_t n = l.num_coords;
+    coords.resize(n);
+    if (n == 0)
+        return;
+
+    // Read the span of the frame holding all coordinate values with one read.
+    int64_t vsize = (l.double_values ? 8 : 4);
+    int64_t start = std::min(l.axis_offset[0], std::min(l.axis_offset[1], l.axis_offset[2]));
+    int64_t end = std::max(l.axis_offset[0], std::max(l.axis_offset[1], l.axis_offset[2]))
+        + (n-1) * l.value_stride + vsize;
+    std::vector<char> buf(end - start);
+    std::ifstream f(_path, std::ios::binary);
+    if (!f)
+        throw std::runtime_error("Could not open trajectory file " + _path);
+    f.seekg(_frame_offsets[frame] + start);
+    f.read(buf.data(), buf.size());
+    if (!f)
+        throw std::runtime_error("Could not read frame of trajectory file " + _path);
+
+    for (int a = 0; a < 3; ++a) {
+        const char* v = buf.data() + (l.axis_offset[a] - start);
+        for (size_t i = 0; i < n; ++i, v += l.value_stride)
+            coords[i][a] = l.scale * (l.double_values ? swapped_value<double>(v, l.byte_swap)
+                : swapped_value<float>(v, l.byte_swap));
+    }
+}
+
+void
+TrajectoryFile::_start_prefetch(size_t frame)
+{
+    _prefetch_frame = frame;
+    _prefetch = std::async(std::launch::async, [this, frame] {
+        Coords coords;
+        try {
+            _read_frame(frame, coords);
+        } catch (...) {
+            coords.clear();     // the frame is read again when needed, reporting the error
+        }
+        std::lock_guard<std::mutex> lock(_prefetch_lock);
+        _prefetched.swap(coords);
+    });
+}
+
+void
+TrajectoryFile::read_frame(size_t frame, Coords& coords)
+{
+    if (frame >= num_frames())
+        throw std::out_of_range("Trajectory frame index out of range");
+    bool have = false;
+    if (_prefetch.valid()) {
+        _prefetch.wait();
+        if (_prefetch_frame == frame) {
+            std::lock_guard<std::mutex> lock(_prefetch_lock);
+            if (_prefetched.size() == num_coords()) {
+                coords.swap(_prefetched);
+                have = true;
+            }
+        }
+        _prefetch = std::future<void>();
+    }
+    if (!have)
+        _read_frame(frame, coords);
+    if (frame + 1 < num_frames())
+        _start_prefetch(frame + 1);
+}
+
+void
+TrajectoryFile::loaded(CoordSet* cs)
+{
+    _loaded.remove(cs);
+    _loaded.push_front(cs);
+    set_memory_budget(_memory_budget);
+}
+
+void
+TrajectoryFile::set_memory_budget(size_t bytes)
+{
+    _memory_budget = bytes;
+    // Always keep the two most recently used frames since callers may be
+    // using both, e.g. copying one coordset to another.
+    size_t frame_bytes = std::max<size_t>(1, num_coords() * sizeof(Coord));
+    size_t max_loaded = std::max<size_t>(2, bytes / frame_bytes);
+    while (_loaded.size() > max_loaded) {
+        auto oldest = std::find_if(_loaded.rbegin(), _loaded.rend(), [](CoordSet* cs) {
+            return cs->structure()->active_coord_set() != cs; });
+        if (oldest == _loaded.rend() || std::distance(oldest, _loaded.rend()) <= 2)
+            break;
+        (*oldest)->release_expanded();    // removes it from _loaded
+    }
+}
+
+}  // namespace atomstruct
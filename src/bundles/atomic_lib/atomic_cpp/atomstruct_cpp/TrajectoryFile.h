@@ -0,0 +1,98 @@
+// vi: set expandtab ts=4 sw=4:
+
+/*
+ * === UCSF ChimeraX Copyright ===
+ * Copyright 2022 Regents of the University of California. All rights reserved.
+ * The ChimeraX application is provided pursuant to the ChimeraX license
+ * agreement, which covers academic and commercial uses. For more details, see
+ * <http://www.rbvi.ucsf.edu/chimerax/docs/licensing.html>
+ *
+ * This particular file is part of the ChimeraX library. You can also
+ * redistribute and/or modify it under the terms of the GNU Lesser General
+ * Public License version 2.1 as published by the Free Software Foundation.
+ * For more details, see
+ * <https://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESSED OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. ADDITIONAL LIABILITY
+ * LIMITATIONS ARE DESCRIBED IN THE GNU LESSER GENERAL PUBLIC LICENSE
+ * VERSION 2.1
+ *
+ * This notice must be embedded in or attached to all copies, including partial
+ * copies, of the software or any revisions or derivations thereof.
+ * === UCSF ChimeraX Copyright ===
+ */
+
+#ifndef atomstruct_TrajectoryFile
+#define atomstruct_TrajectoryFile
+
+#include <future>
+#include <list>
+#include <mutex>
+#include <stdexcept>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "Coord.h"
+#include "imex.h"
+
+namespace atomstruct {
+
+class CoordSet;
+
+// Coordinates of trajectory frames read from a file when a coordset is first
+// used.  Expanded frames are kept in a least recently used list limited by a
+// memory budget, and the frame after the last one read is prefetched in a
+// separate thread to speed up playback.
+class ATOMSTRUCT_IMEX TrajectoryFile {
+public:
+    typedef std::vector<Coord>  Coords;
+    // Placement of coordinate values within a frame.
+    struct Layout {
+        size_t  num_coords;
+        int64_t  axis_offset[3];    // bytes from frame start to first x, y and z values
+        int64_t  value_stride;      // bytes between values of successive atoms for one axis
+        bool  double_values;        // float64 values, otherwise float32
+        bool  byte_swap;
+        Real  scale;                // multiplies values, e.g. nanometers to Angstroms
+    };
+
+private:
+    std::string  _path;
+    std::vector<int64_t>  _frame_offsets;
+    Layout  _layout;
+    size_t  _memory_budget;
+    std::list<CoordSet*>  _loaded;      // most recently used first
+    std::mutex  _prefetch_lock;
+    std::future<void>  _prefetch;
+    size_t  _prefetch_frame;
+    Coords  _prefetched;
+    void  _read_frame(size_t frame, Coords& coords) const;
+    void  _start_prefetch(size_t frame);
+
+public:
+    TrajectoryFile(const std::string& path, const std::vector<int64_t>& frame_offsets,
+        const Layout& layout, size_t memory_budget);
+    ~TrajectoryFile();
+    size_t  num_coords() const { return _layout.num_coords; }
+    size_t  num_frames() const { return _frame_offsets.size(); }
+    const std::string&  path() const { return _path; }
+    void  read_frame(size_t frame, Coords& coords);
+    // Read a frame without prefetching, safe to call from several threads.
+    void  read_frame_uncached(size_t frame, Coords& coords) const {
+        if (frame >= num_frames())
+            throw std::out_of_range("Trajectory frame index out of range");
+        _read_frame(frame, coords);
+    }
+    // Least recently used bookkeeping called by CoordSet.
+    void  loaded(CoordSet* cs);
+    void  unloaded(CoordSet* cs) { _loaded.remove(cs); }
+    size_t  memory_budget() const { return _memory_budget; }
+    void  set_memory_budget(size_t bytes);
+};
+
+}  // namespace atomstruct
+
+#endif  // atomstruct_TrajectoryFile
@@ -33,7 +33,8 @@ namespace atomstruct {
 ATOMSTRUCT_IMEX void*  DestructionCoordinator::_destruction_batcher = nullptr;
 ATOMSTRUCT_IMEX void*  DestructionCoordinator::_destruction_parent = nullptr;
 ATOMSTRUCT_IMEX std::set<DestructionObserver*>  DestructionCoordinator::_observers;
-ATOMSTRUCT_IMEX std::set<void*>  DestructionCoordinator::_destroyed;
+ATOMSTRUCT_IMEX std::unordered_set<void*>  DestructionCoordinator::_destroyed;
+ATOMSTRUCT_IMEX int  DestructionCoordinator::_destroyed_types = 0;
 ATOMSTRUCT_IMEX int DestructionCoordinator::_num_notifications_off = 0;
 
 }  // namespace atomstruct
@@ -28,18 +28,48 @@
 #define atomstruct_destruct
 
 #include <set>
+#include <unordered_set>
 
 #include "imex.h"
 
 namespace atomstruct {
 
+class Atom;
+class Chain;
+class Connection;
+class Residue;
+class Structure;
+
+// Kinds of destroyed objects, so that observers only hear about the ones
+// they care about
+enum DestroyedType {
+    DESTROYED_ATOMS = 1,
+    DESTROYED_BONDS = 2, // bonds and pseudobonds
+    DESTROYED_RESIDUES = 4,
+    DESTROYED_CHAINS = 8,
+    DESTROYED_STRUCTURES = 16,
+    DESTROYED_OTHER = 32,
+    DESTROYED_ANY = 63
+};
+
+inline int  destroyed_type(const Atom*) { return DESTROYED_ATOMS; }
+inline int  destroyed_type(const Chain*) { return DESTROYED_CHAINS; }
+inline int  destroyed_type(const Connection*) { return DESTROYED_BONDS; }
+inline int  destroyed_type(const Residue*) { return DESTROYED_RESIDUES; }
+inline int  destroyed_type(const Structure*) { return DESTROYED_STRUCTURES; }
+inline int  destroyed_type(const void*) { return DESTROYED_OTHER; }
+
 class ATOMSTRUCT_IMEX DestructionObserver {
 // Base class for classes that are interested in getting only one
 // notification once a releted set of destructors have executed
+// 'interest' is a mask of DestroyedType values; the observer is
+// skipped if nothing of those types was destroyed
+    int  _destruction_interest;
 public:
-    DestructionObserver();
+    DestructionObserver(int interest = DESTROYED_ANY);
     virtual ~DestructionObserver();
-    virtual void  destructors_done(const std::set<void*>& destroyed) = 0;
+    int  destruction_interest() const { return _destruction_interest; }
+    virtual void  destructors_done(const std::unordered_set<void*>& destroyed) = 0;
 };
 
 class ATOMSTRUCT_IMEX DestructionCoordinator {
@@ -51,7 +81,8 @@ class ATOMSTRUCT_IMEX DestructionCoordinator {
     static void*  _destruction_batcher;
     static void*  _destruction_parent;
     static std::set<DestructionObserver*>  _observers;
-    static std::set<void*>  _destroyed;
+    static std::unordered_set<void*>  _destroyed;
+    static int  _destroyed_types;
     static int _num_notifications_off;
 public:
     static void  deregister_observer(DestructionObserver* d_o) {
@@ -71,9 +102,13 @@ public:
             // the observers destroy anything
             decltype(_destroyed) destroyed_copy;
             destroyed_copy.swap(_destroyed);
+            int destroyed_types = _destroyed_types;
+            _destroyed_types = 0;
             if (destroyed_copy.size() > 0) {
                 auto observers_copy = _observers;
                 for (auto o: observers_copy) {
+                    if ((o->destruction_interest() & destroyed_types) == 0)
+                        continue;
                     if (_observers.find(o) != _observers.end())
                         o->destructors_done(destroyed_copy);
                 }
@@ -81,7 +116,8 @@ public:
         } else if (_destruction_parent == instance)
             _destruction_parent = nullptr;
     }
-    static void  initiating_destruction(void* instance, bool batcher = false) {
+    static void  initiating_destruction(void* instance, bool batcher = false,
+            int destroyed_type = DESTROYED_OTHER) {
         if (batcher) {
             if (_destruction_batcher == nullptr
             && _destruction_parent == nullptr)
@@ -89,8 +125,10 @@ public:
         } else {
             if (_destruction_parent == nullptr)
                 _destruction_parent = instance;
-            if (_num_notifications_off == 0)
+            if (_num_notifications_off == 0) {
                 _destroyed.insert(instance);
+                _destroyed_types |= destroyed_type;
+            }
         }
     }
     static void  notifications_off() { _num_notifications_off++; }
@@ -119,15 +157,18 @@ class ATOMSTRUCT_IMEX DestructionUser {
 // scope exits); adds itself to the list of things that got destroyed
     void*  _instance;
 public:
-    DestructionUser(void* instance): _instance(instance) {
-        DestructionCoordinator::initiating_destruction(_instance);
+    template <class T>
+    DestructionUser(T* instance): _instance(static_cast<void*>(instance)) {
+        DestructionCoordinator::initiating_destruction(_instance, false,
+            destroyed_type(instance));
     }
     virtual ~DestructionUser() {
         DestructionCoordinator::finalizing_destruction(_instance);
     }
 };
 
-inline DestructionObserver::DestructionObserver()
+inline DestructionObserver::DestructionObserver(int interest):
+    _destruction_interest(interest)
 {
     DestructionCoordinator::register_observer(this);
 }
@@ -0,0 +1,713 @@
+// vi: set expandtab ts=4 sw=4:
+
+/*
+ * === UCSF ChimeraX Copyright ===
+ * Copyright 2022 Regents of the University of California. All rights reserved.
+ * The ChimeraX application is provided pursuant to the ChimeraX license
+ * agreement, which covers academic and commercial uses. For more details, see
+ * <http://www.rbvi.ucsf.edu/chimerax/docs/licensing.html>
+ *
+ * This particular file is part of the ChimeraX library. You can also
+ * redistribute and/or modify it under the terms of the GNU Lesser General
+ * Public License version 2.1 as published by the Free Software Foundation.
+ * For more details, see
+ * <https://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESSED OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. ADDITIONAL LIABILITY
+ * LIMITATIONS ARE DESCRIBED IN THE GNU LESSER GENERAL PUBLIC LICENSE
+ * VERSION 2.1
+ *
+ * This notice must be embedded in or attached to all copies, including partial
+ * copies, of the software or any revisions or derivations thereof.
+ * === UCSF ChimeraX Copyright ===
+ */
+
+#include <algorithm>        // for std::find, std::stable_sort
+#include <cmath>            // for std::sin, std::cos, std::sqrt
+#include <exception>        // for std::exception_ptr
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>          // for std::pair
+#include <vector>
+
+#include <arrays/threadpool.h>    // Uses Thread_Pool::parallel_for()
+
+#define ATOMSTRUCT_EXPORT
+#include "Atom.h"
+#include "PBGroup.h"
+#include "Pseudobond.h"
+#include "Structure.h"
+#include "hydrogens.h"
+#include "search.h"
+
+namespace atomstruct {
+
+static inline Real
+dot(const Coord& u, const Coord& v)
+{
+    return u[0]*v[0] + u[1]*v[1] + u[2]*v[2];
+}
+
+static inline Coord
+cross(const Coord& u, const Coord& v)
+{
+    return Coord(u[1]*v[2] - u[2]*v[1], u[2]*v[0] - u[0]*v[2], u[0]*v[1] - u[1]*v[0]);
+}
+
+static inline Coord
+normalized(const Coord& v)
+{
+    Real len = v.length();
+    return len == 0.0 ? v : v * (1.0 / len);
+}
+
+static inline bool
+same_xyz(const Coord& u, const Coord& v)
+{
+    return u[0] == v[0] && u[1] == v[1] && u[2] == v[2];
+}
+
+static const Real  DEGREES = M_PI / 180.0;
+static const Real  SIN5475 = std::sin(54.75 * DEGREES);
+static const Real  COS5475 = std::cos(54.75 * DEGREES);
+static const Real  COS705 = std::cos(70.5 * DEGREES);
+static const Real  SIN705 = std::sqrt(1.0 - COS705 * COS705);
+
+static Coord
+single_pos(const Coord& bondee, Real bond_len, const Coord* toward, const Coord* away)
+{
+    if (toward != nullptr)
+        return bondee + normalized(*toward - bondee) * bond_len;
+    if (away != nullptr)
+        return bondee + normalized(bondee - *away) * bond_len;
+    return bondee + Coord(bond_len, 0.0, 0.0);
+}
+
+static Coord
+right_angle(const Coord& orig)
+{
+    if (orig[0] == 0.0)
+        return Coord(0.0, -orig[2], orig[1]);
+    return Coord(-orig[1], orig[0], 0.0);
+}
+
+// Position 'degrees' from the bond to bond_pos.  With coplanar points it is
+// in their plane, the average of the two results if there are two, otherwise
+// in the plane chimerax.geometry.z_align() gives.
+static Coord
+angle_pos(const Coord& atom_pos, const Coord& bond_pos, Real bond_length, Real degrees,
+    const std::vector<Coord>* coplanar)
+{
+    Real ys = bond_length * std::sin(degrees * DEGREES);
+    Real zs = bond_length * std::cos(degrees * DEGREES);
+    if (coplanar == nullptr || coplanar->empty()) {
+        Coord v = bond_pos - atom_pos;
+        Real a = v[0], b = v[1], c = v[2];
+        Real l = a*a + c*c, d = l + b*b;
+        if (d < 1e-10)
+            throw std::invalid_argument("z_align endpoints must be distinct");
+        l = std::sqrt(l);
+        d = std::sqrt(d);
+        Coord y_axis = (l < 1e-10 ? Coord(0.0, l/d, -b/d) : Coord(-(a*b)/(l*d), l/d, -(b*c)/(l*d)));
+        return atom_pos + y_axis * ys + v * (zs / d);
+    }
+    if (coplanar->size() > 2)
+        throw std::invalid_argument("More than 2 coplanar positions specified!");
+    // the up vector is negated for the second coplanar position
+    Coord z_axis = normalized(bond_pos - atom_pos);
+    Coord points[2];
+    for (size_t i = 0; i < coplanar->size(); ++i) {
+        Coord up = (*coplanar)[i] - atom_pos;
+        if (i > 0)
+            up = up * -1.0;
+        Coord y_axis = normalized(cross(z_axis, normalized(cross(up, z_axis))));
+        points[i] = atom_pos + y_axis * ys + z_axis * zs;
+    }
+    if (coplanar->size() == 1)
+        return points[0];
+    Coord v = points[0] + (points[1] - points[0]) * 0.5 - atom_pos;
+    return atom_pos + v * (bond_length / v.length());
+}
+
+// Of two positions, the one closer to 'toward' or farther from 'away'.
+static Coord
+choose_pos(const Coord& pos, const Coord& other_pos, const Coord* toward, const Coord* away)
+{
+    const Coord& ref = (toward != nullptr ? *toward : *away);
+    Real d1 = pos.sqdistance(ref), d2 = other_pos.sqdistance(ref);
+    if (toward != nullptr)
+        return d2 < d1 ? other_pos : pos;
+    return d2 > d1 ? other_pos : pos;
+}
+
+static void
+linear_pos(const Coord& bondee, std::vector<Coord>& cur_bonded, Real bond_len,
+    const Coord* toward, const Coord* away, std::vector<Coord>& new_bonded)
+{
+    if (cur_bonded.empty()) {
+        Coord ninety;
+        if (away != nullptr) {
+            // need 90 angle, rather than directly away
+            // (since otherwise second added position will then be
+            // directly towards)
+            ninety = bondee + right_angle(*away - bondee);
+            away = &ninety;
+        }
+        Coord pos = single_pos(bondee, bond_len, toward, away);
+        new_bonded.push_back(pos);
+        cur_bonded.push_back(pos);
+    }
+    if (cur_bonded.size() == 1)
+        new_bonded.push_back(bondee + normalized(bondee - cur_bonded[0]) * bond_len);
+}
+
+static void
+planar_pos(const Coord& bondee, std::vector<Coord>& cur_bonded, Real bond_len,
+    const std::vector<Coord>* coplanar, const Coord* toward, const Coord* away,
+    const Coord* toward2, const Coord* away2, std::vector<Coord>& new_bonded)
+{
+    if (cur_bonded.empty()) {
+        Coord pos = single_pos(bondee, bond_len, toward, away);
+        toward = away = nullptr;
+        new_bonded.push_back(pos);
+        cur_bonded.push_back(pos);
+    }
+    if (cur_bonded.size() == 1) {
+        // add at 120 degree angle, co-planar if required
+        std::vector<Coord> implied;
+        if (coplanar == nullptr) {
+            if (toward != nullptr || toward2 != nullptr) {
+                implied.push_back(toward != nullptr ? *toward : *toward2);
+                coplanar = &implied;
+            } else if (away != nullptr || away2 != nullptr) {
+                implied.push_back(bondee + right_angle((away != nullptr ? *away : *away2) - bondee));
+                coplanar = &implied;
+            }
+        }
+        Coord pos = angle_pos(bondee, cur_bonded[0], bond_len, 120.0, coplanar);
+        new_bonded.push_back(pos);
+        cur_bonded.push_back(pos);
+    }
+    if (cur_bonded.size() == 2) {
+        // position along anti-bisector of current bonds
+        Coord v1 = normalized(cur_bonded[0] - bondee);
+        Coord v2 = normalized(cur_bonded[1] - bondee);
+        new_bonded.push_back(bondee + normalized((v1 + v2) * -1.0) * bond_len);
+    }
+}
+
+static void
+tetra_pos(const Coord& bondee, std::vector<Coord>& cur_bonded, Real bond_len,
+    const Coord* toward, const Coord* away, const Coord* toward2, const Coord* away2,
+    std::vector<Coord>& new_bonded)
+{
+    if (cur_bonded.empty()) {
+        Coord pos = single_pos(bondee, bond_len, toward, away);
+        toward = toward2;
+        away = away2;
+        new_bonded.push_back(pos);
+        cur_bonded.push_back(pos);
+    }
+    bool orient = (toward != nullptr || away != nullptr);
+    if (cur_bonded.size() == 1) {
+        // add at 109.5 degree angle
+        std::vector<Coord> coplanar;
+        if (orient) {
+            const Coord& ref = (toward != nullptr ? *toward : *away);
+            Real a = Point::angle(bondee, cur_bonded[0], ref);
+            if (a != 0.0 && a != 180.0)
+                coplanar.push_back(ref);
+        }
+        Coord pos = angle_pos(bondee, cur_bonded[0], bond_len, 109.5, &coplanar);
+        if (orient) {
+            // find the other 109.5 position in the toward/away
+            // plane and the closer/farther position as appropriate
+            Coord old_v = normalized(bondee - cur_bonded[0]);
+            Coord new_v = pos - bondee;
+            Coord midpoint = bondee + old_v * (new_v.length() * COS705);
+            pos = choose_pos(pos, pos + (midpoint - pos) * 2.0, toward, away);
+        }
+        new_bonded.push_back(pos);
+        cur_bonded.push_back(pos);
+    }
+    if (cur_bonded.size() == 2) {
+        // add along anti-bisector of current bonds and raised up
+        // 54.75 degrees from plane of those bonds (half of 109.5)
+        Coord v1 = normalized(cur_bonded[0] - bondee);
+        Coord v2 = normalized(cur_bonded[1] - bondee);
+        Coord anti_bi = normalized((v1 + v2) * -1.0);
+        // in order to stabilize the third and fourth tetrahedral
+        // positions, cross the longer vector by the shorter
+        Coord cross_v = normalized(dot(v1, v1) > dot(v2, v2) ? cross(v1, v2) : cross(v2, v1));
+        anti_bi = anti_bi * (COS5475 * bond_len);
+        cross_v = cross_v * (SIN5475 * bond_len);
+        Coord pos = bondee + anti_bi + cross_v;
+        if (orient)
+            pos = choose_pos(pos, bondee + anti_bi - cross_v, toward, away);
+        new_bonded.push_back(pos);
+        cur_bonded.push_back(pos);
+    }
+    if (cur_bonded.size() == 3) {
+        // normal of the plane through the unit bond vectors, on the
+        // same side of the plane as bondee
+        Coord u0 = bondee + normalized(cur_bonded[0] - bondee);
+        Coord u1 = bondee + normalized(cur_bonded[1] - bondee);
+        Coord u2 = bondee + normalized(cur_bonded[2] - bondee);
+        Coord normal = normalized(cross(u1 - u0, u2 - u0));
+        if (dot(normal, bondee - u0) < 0.0)
+            normal = normal * -1.0;
+        new_bonded.push_back(bondee + normal * bond_len);
+    }
+}
+
+std::vector<Coord>
+bond_positions(const Coord& bondee, int geometry, Real bond_len, const std::vector<Coord>& bonded,
+    const std::vector<Coord>* coplanar, const Coord* toward, const Coord* away,
+    const Coord* toward2, const Coord* away2)
+{
+    if ((toward != nullptr && away != nullptr) || (toward2 != nullptr && away2 != nullptr))
+        throw std::invalid_argument(
+            "Cannot specify both toward and away, or both toward2 and away2");
+    std::vector<Coord> new_bonded, cur_bonded(bonded);
+    switch (geometry) {
+    case Atom::Single:
+        if (bonded.empty())
+            new_bonded.push_back(single_pos(bondee, bond_len, toward, away));
+        break;
+    case Atom::Linear:
+        if (bonded.size() <= 1)
+            linear_pos(bondee, cur_bonded, bond_len, toward, away, new_bonded);
+        break;
+    case Atom::Planar:
+        if (bonded.size() <= 2)
+            planar_pos(bondee, cur_bonded, bond_len, coplanar, toward, away, toward2, away2,
+                new_bonded);
+        break;
+    case Atom::Tetrahedral:
+        if (bonded.size() <= 3)
+            tetra_pos(bondee, cur_bonded, bond_len, toward, away, toward2, away2, new_bonded);
+        break;
+    default:
+        throw std::invalid_argument("Unknown geometry type");
+    }
+    return new_bonded;
+}
+
+namespace {
+
+// Search distance and hydrogen radius of addh's find_nearest().
+const Real  CHECK_DIST = 3.5;
+const Real  H_RADIUS = 1.0;
+const int  MAX_HYDROGENS = 4;
+
+// Nearest crowding atom or placed hydrogen, with its distance less its radius.
+struct Nearest {
+    bool  found = false;
+    Coord  pos;
+    Real  dist = 0.0;
+    const Atom*  atom = nullptr;        // crowding atom,
+    const Real*  hydrogen = nullptr;    // or placed hydrogen
+    void  consider(const Coord& c, Real d, const Atom* a, const Real* h) {
+        if (found && d >= dist)
+            return;
+        found = true;
+        pos = c;
+        dist = d;
+        atom = a;
+        hydrogen = h;
+    }
+};
+
+struct Site {
+    Atom*  atom;
+    size_t  index;                  // in crowding atoms
+    Coord  center;
+    int  geometry;
+    Real  bond_length;
+    int  needed;
+    std::vector<Coord>  bonded;
+    bool  has_coplanar = false;
+    std::vector<Coord>  coplanar;
+    bool  search = false;           // position depends on surroundings
+};
+
+class Placement {
+public:
+    Placement(size_t num_parents, const std::vector<Atom*>& crowd_atoms,
+        const Real* crowd_coords, const float* crowd_radii, const int* crowd_groups,
+        int num_groups, const unsigned char* interacts, Real metal_dist, Real* positions,
+        int* counts, unsigned char* keep);
+    void  set_up(Site& site, Atom* parent, int geometry, int substituents, Real bond_length,
+        std::unordered_map<Structure*, std::unordered_map<const Atom*, int>>& missing) const;
+    void  place(size_t p, const Site& site, std::vector<size_t>& found);
+    void  set_parent(size_t crowd_index, size_t p) { _site[crowd_index] = p; }
+    void  set_placed(size_t p) { _placed[p] = 1; }
+
+private:
+    const std::vector<Atom*>&  _atoms;
+    std::vector<Coord>  _coords;
+    const float*  _radii;
+    const int*  _groups;
+    int  _num_groups;
+    const unsigned char*  _interacts;
+    Real  _metal_dist;
+    AtomCellList  _cells;
+    std::unordered_map<const Atom*, size_t>  _index;
+    std::vector<long>  _site;           // parent number of each crowding atom, -1 if none
+    std::vector<unsigned char>  _placed;
+    Real*  _positions;
+    int*  _counts;
+    unsigned char*  _keep;
+
+    size_t  _crowd_index(const Atom* a) const {
+        auto i = _index.find(a);
+        if (i == _index.end())
+            throw std::invalid_argument("Hydrogen parent atoms and their bond partners"
+                " must be among the crowding atoms");
+        return i->second;
+    }
+    bool  _sees(const Site& site, size_t j) const {
+        return _interacts[_groups[site.index] * _num_groups + _groups[j]] != 0;
+    }
+    template <class F> void  _for_placed(size_t j, F f) const {
+        long p = _site[j];
+        if (p < 0 || !_placed[p])
+            return;
+        for (int k = 0; k < _counts[p]; ++k)
+            if (_keep[MAX_HYDROGENS*p + k])
+                f(_positions + 3*(MAX_HYDROGENS*p + k));
+    }
+    bool  _metal_clash(const Coord& metal_pos, const Coord& pos, const Site& site) const;
+    bool  _blocked_by_metal(const Coord& pos, const Site& site, std::vector<size_t>& found) const;
+    Nearest  _nearest(const Coord& pos, const Site& site, const std::vector<Coord>& exclude,
+        bool avoid_metals, std::vector<size_t>& found) const;
+    Nearest  _rotamer_nearest(const Site& site, const Nearest& neighbor,
+        std::vector<size_t>& found) const;
+};
+
+Placement::Placement(size_t num_parents, const std::vector<Atom*>& crowd_atoms,
+    const Real* crowd_coords, const float* crowd_radii, const int* crowd_groups,
+    int num_groups, const unsigned char* interacts, Real metal_dist, Real* positions,
+    int* counts, unsigned char* keep):
+    _atoms(crowd_atoms), _radii(crowd_radii), _groups(crowd_groups), _num_groups(num_groups),
+    _interacts(interacts), _metal_dist(metal_dist),
+    _cells(crowd_atoms, std::vector<Coord>(reinterpret_cast<const Coord*>(crowd_coords),
+        reinterpret_cast<const Coord*>(crowd_coords) + crowd_atoms.size()), CHECK_DIST),
+    _site(crowd_atoms.size(), -1), _placed(num_parents, 0), _positions(positions), _counts(counts), _keep(keep)
+{
+    _coords.reserve(crowd_atoms.size());
+    _index.reserve(crowd_atoms.size());
+    for (size_t i = 0; i < crowd_atoms.size(); ++i) {
+        _coords.emplace_back(crowd_coords[3*i], crowd_coords[3*i+1], crowd_coords[3*i+2]);
+        _index[crowd_atoms[i]] = i;
+    }
+}
+
+// As simple.py in addh: the hydrogens needed, the bonded positions, and for a
+// trigonal atom with one bond, the positions to stay coplanar with.
+void
+Placement::set_up(Site& site, Atom* parent, int geometry, int substituents, Real bond_length,
+    std::unordered_map<Structure*, std::unordered_map<const Atom*, int>>& missing) const
+{
+    site.atom = parent;
+    site.index = _crowd_index(parent);
+    site.center = _coords[site.index];
+    site.geometry = geometry;
+    site.bond_length = bond_length;
+    // Missing-structure pseudobonds count as bonds (Atom::num_explicit_bonds()),
+    // counted once per structure instead of once per atom.
+    Structure* s = parent->structure();
+    auto mi = missing.find(s);
+    if (mi == missing.end()) {
+        auto& counts = missing[s];
+        auto pbg = s->pb_mgr().get_group(Structure::PBG_MISSING_STRUCTURE, AS_PBManager::GRP_NONE);
+        if (pbg != nullptr)
+            for (auto pb: pbg->pseudobonds())
+                for (auto a: pb->atoms())
+                    counts[a] += 1;
+        mi = missing.find(s);
+    }
+    auto ci = mi->second.find(parent);
+    int explicit_bonds = parent->bonds().size() + (ci == mi->second.end() ? 0 : ci->second);
+    site.needed = substituents - explicit_bonds;
+    if (site.needed <= 0)
+        return;
+
+    const auto& nbs = parent->neighbors();
+    for (auto nb: nbs)
+        site.bonded.push_back(_coords[_crowd_index(nb)]);
+    if (geometry == Atom::Planar && nbs.size() == 1) {
+        std::vector<Coord> grand_bonded;
+        for (auto gnb: nbs[0]->neighbors())
+            if (gnb != parent)
+                grand_bonded.push_back(_coords[_crowd_index(gnb)]);
+        if (grand_bonded.size() < 3) {
+            site.has_coplanar = true;
+            site.coplanar.swap(grand_bonded);
+        }
+    }
+
+    // Whether the nearest atom orients the positions, or the roomiest
+    // positions are to be picked.
+    size_t nb = nbs.size();
+    int positions = 0;
+    bool oriented = false;
+    switch (geometry) {
+    case Atom::Single:
+        positions = (nb == 0 ? 1 : 0);
+        oriented = (nb == 0);
+        break;
+    case Atom::Linear:
+        positions = (nb > 1 ? 0 : 2 - nb);
+        oriented = (nb == 0);
+        break;
+    case Atom::Planar:
+        positions = (nb > 2 ? 0 : 3 - nb);
+        oriented = (nb == 0 || (nb == 1 && !site.has_coplanar));
+        break;
+    case Atom::Tetrahedral:
+        positions = (nb > 3 ? 0 : 4 - nb);
+        oriented = (nb <= 2);
+        break;
+    }
+    site.search = (oriented || positions > site.needed);
+}
+
+bool
+Placement::_metal_clash(const Coord& metal_pos, const Coord& pos, const Site& site) const
+{
+    if (site.atom->element().valence() < 5 && site.geometry != Atom::Linear)
+        // non-sp1 carbons, et al, can't coordinate metals
+        return false;
+    if (metal_pos.distance(pos) > _metal_dist - 1.25)
+        // default metal distance is 2.7 + putative S-H bond length of 1.25
+        return false;
+    // 135.0 is not strict enough (see :1004.a in 1nyr)
+    return Point::angle(site.center, pos, metal_pos) > 120.0;
+}
+
+// As new_hydrogen() in addh, a hydrogen pointing at a nearby metal of its
+// structure is left off.
+bool
+Placement::_blocked_by_metal(const Coord& pos, const Site& site, std::vector<size_t>& found) const
+{
+    if (_metal_dist <= 0.0)
+        return false;
+    _cells.search_indices(pos, _metal_dist, found);
+    for (auto j: found) {
+        const Atom* metal = _atoms[j];
+        if (metal->element().is_metal() && metal->structure() == site.atom->structure()
+                && _metal_clash(_coords[j], pos, site))
+            return true;
+    }
+    return false;
+}
+
+// As find_nearest() in addh.  Crowding atoms and their hydrogens at the
+// position of the parent or of an excluded point are skipped.
+Nearest
+Placement::_nearest(const Coord& pos, const Site& site, const std::vector<Coord>& exclude,
+    bool avoid_metals, std::vector<size_t>& found) const
+{
+    auto excluded = [&](const Coord& c) {
+        if (same_xyz(c, site.center))
+            return true;
+        for (auto& e: exclude)
+            if (same_xyz(c, e))
+                return true;
+        return false;
+    };
+    Nearest near;
+    const auto& nbs = site.atom->neighbors();
+    _cells.search_indices(pos, CHECK_DIST, found);
+    for (auto j: found) {
+        const Coord& c = _coords[j];
+        if (excluded(c) || !_sees(site, j))
+            continue;
+        const Atom* a = _atoms[j];
+        if (std::find(nbs.begin(), nbs.end(), a) == nbs.end()) {
+            if (avoid_metals && a->element().is_metal()
+                    && a->structure() == site.atom->structure() && _metal_clash(c, pos, site)) {
+                near.found = true;
+                near.pos = c;
+                near.dist = 0.0;
+                near.atom = a;
+                near.hydrogen = nullptr;
+                return near;
+            }
+            near.consider(c, pos.distance(c) - _radii[j], a, nullptr);
+        }
+        for (auto h: a->neighbors()) {
+            if (h->element().number() != 1)
+                continue;
+            auto hi = _index.find(h);
+            if (hi == _index.end() || excluded(_coords[hi->second]))
+                continue;
+            const Coord& hc = _coords[hi->second];
+            near.consider(hc, pos.distance(hc) - H_RADIUS, h, nullptr);
+        }
+        _for_placed(j, [&](const Real* h) {
+            Coord hc(h[0], h[1], h[2]);
+            if (!excluded(hc))
+                near.consider(hc, pos.distance(hc) - H_RADIUS, nullptr, h);
+        });
+    }
+    return near;
+}
+
+// As find_rotamer_nearest() in addh, the atom approaching nearest to the
+// circle of methyl-type hydrogen positions about the bond to the neighbor.
+Nearest
+Placement::_rotamer_nearest(const Site& site, const Nearest& neighbor,
+    std::vector<size_t>& found) const
+{
+    const Coord& at_pos = site.center;
+    Coord v = at_pos - neighbor.pos;
+    v = v * (COS705 * site.bond_length / v.length());
+    Coord center = at_pos + v;
+    Coord normal = normalized(v);
+    Real radius = SIN705 * site.bond_length;
+
+    Nearest near;
+    auto consider = [&](const Coord& c, Real c_radius, const Atom* a, const Real* h) {
+        // project into plane, then find nearest approach of circle
+        Coord cv = c - normal * dot(c - center, normal) - center;
+        if (cv[0] == 0.0 && cv[1] == 0.0 && cv[2] == 0.0)
+            return;
+        Coord app = center + cv * (radius / cv.length());
+        near.consider(c, c.distance(app) - c_radius, a, h);
+    };
+    _cells.search_indices(center, CHECK_DIST + radius, found);
+    for (auto j: found) {
+        const Coord& c = _coords[j];
+        // exclude atoms from identical-copy structure also...
+        if (same_xyz(c, at_pos) || same_xyz(c, neighbor.pos) || !_sees(site, j))
+            continue;
+        const Atom* a = _atoms[j];
+        consider(c, _radii[j], a, nullptr);
+        for (auto h: a->neighbors()) {
+            if (h->element().number() != 1 || h == neighbor.atom)
+                continue;
+            auto hi = _index.find(h);
+            if (hi != _index.end())
+                consider(_coords[hi->second], H_RADIUS, h, nullptr);
+        }
+        _for_placed(j, [&](const Real* h) {
+            if (h != neighbor.hydrogen)
+                consider(Coord(h[0], h[1], h[2]), H_RADIUS, nullptr, h);
+        });
+    }
+    return near;
+}
+
+// Hydrogen positions of a parent as _alt_loc_add_hydrogens() in addh's
+// simple.py computes them for a single location without metal coordination.
+void
+Placement::place(size_t p, const Site& site, std::vector<size_t>& found)
+{
+    _counts[p] = 0;
+    if (site.needed <= 0)
+        return;
+
+    Nearest away, away2;
+    if (site.search) {
+        const auto& nbs = site.atom->neighbors();
+        if (site.geometry == Atom::Tetrahedral && nbs.empty()) {
+            away = _nearest(site.center, site, site.bonded, false, found);
+            if (away.found)
+                away2 = _rotamer_nearest(site, away, found);
+        } else if (site.geometry == Atom::Tetrahedral && nbs.size() == 1) {
+            Nearest neighbor;
+            neighbor.found = true;
+            neighbor.pos = site.bonded[0];
+            neighbor.atom = nbs[0];
+            away = _rotamer_nearest(site, neighbor, found);
+        } else
+            away = _nearest(site.center, site, site.bonded, false, found);
+    }
+    auto positions = bond_positions(site.center, site.geometry, site.bond_length, site.bonded,
+        site.has_coplanar ? &site.coplanar : nullptr, nullptr, away.found ? &away.pos : nullptr,
+        nullptr, away2.found ? &away2.pos : nullptr);
+
+    if ((int)positions.size() > site.needed) {
+        // as roomiest() in addh, keep the positions farthest from other atoms
+        std::vector<std::pair<Real, size_t>> room;
+        for (size_t i = 0; i < positions.size(); ++i) {
+            Nearest near = _nearest(positions[i], site, std::vector<Coord>(), true, found);
+            room.emplace_back(near.found ? near.dist : CHECK_DIST, i);
+        }
+        std::stable_sort(room.begin(), room.end(),
+            [](const std::pair<Real, size_t>& r1, const std::pair<Real, size_t>& r2) {
+                return r1.first > r2.first; });
+        std::vector<Coord> roomiest;
+        for (int i = 0; i < site.needed; ++i)
+            roomiest.push_back(positions[room[i].second]);
+        positions.swap(roomiest);
+    }
+
+    int n = std::min((int)positions.size(), MAX_HYDROGENS);
+    for (int k = 0; k < n; ++k) {
+        Real* xyz = _positions + 3*(MAX_HYDROGENS*p + k);
+        for (int a = 0; a < 3; ++a)
+            xyz[a] = positions[k][a];
+        _keep[MAX_HYDROGENS*p + k] = !_blocked_by_metal(positions[k], site, found);
+    }
+    _counts[p] = n;
+}
+
+}  // namespace
+
+void
+place_hydrogens(const std::vector<Atom*>& parents, const int* geometries,
+    const int* substituents, const Real* bond_lengths,
+    const std::vector<Atom*>& crowd_atoms, const Real* crowd_coords, const float* crowd_radii,
+    const int* crowd_groups, int num_groups, const unsigned char* interacts, Real metal_dist,
+    Real* positions, int* counts, unsigned char* keep)
+{
+    size_t n = parents.size();
+    Placement placement(n, crowd_atoms, crowd_coords, crowd_radii, crowd_groups, num_groups,
+        interacts, metal_dist, positions, counts, keep);
+    std::vector<Site> sites(n);
+    std::unordered_map<Structure*, std::unordered_map<const Atom*, int>> missing;
+    for (size_t p = 0; p < n; ++p) {
+        placement.set_up(sites[p], parents[p], geometries[p], substituents[p], bond_lengths[p],
+            missing);
+        placement.set_parent(sites[p].index, p);
+        counts[p] = 0;
+    }
+
+    // Positions that need no search do not depend on each other.
+    std::exception_ptr error;
+    std::mutex error_mutex;
+    Thread_Pool::parallel_for(n, [&](int64_t p0, int64_t p1) {
+        try {
+            std::vector<size_t> found;
+            for (int64_t p = p0; p < p1; ++p)
+                if (!sites[p].search)
+                    placement.place(p, sites[p], found);
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(error_mutex);
+            if (!error)
+                error = std::current_exception();
+        }
+    }, 256);
+    if (error)
+        std::rethrow_exception(error);
+    for (size_t p = 0; p < n; ++p)
+        if (!sites[p].search)
+            placement.set_placed(p);
+
+    // The rest avoid the hydrogens placed so far, one parent after another
+    // in the given order.
+    std::vector<size_t> found;
+    for (size_t p = 0; p < n; ++p)
+        if (sites[p].search) {
+            placement.place(p, sites[p], found);
+            placement.set_placed(p);
+        }
+}
+
+}  // namespace atomstruct
@@ -0,0 +1,77 @@
+// vi: set expandtab ts=4 sw=4:
+
+/*
+ * === UCSF ChimeraX Copyright ===
+ * Copyright 2022 Regents of the University of California. All rights reserved.
+ * The ChimeraX application is provided pursuant to the ChimeraX license
+ * agreement, which covers academic and commercial uses. For more details, see
+ * <http://www.rbvi.ucsf.edu/chimerax/docs/licensing.html>
+ *
+ * This particular file is part of the ChimeraX library. You can also
+ * redistribute and/or modify it under the terms of the GNU Lesser General
+ * Public License version 2.1 as published by the Free Software Foundation.
+ * For more details, see
+ * <https://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESSED OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. ADDITIONAL LIABILITY
+ * LIMITATIONS ARE DESCRIBED IN THE GNU LESSER GENERAL PUBLIC LICENSE
+ * VERSION 2.1
+ *
+ * This notice must be embedded in or attached to all copies, including partial
+ * copies, of the software or any revisions or derivations thereof.
+ * === UCSF ChimeraX Copyright ===
+ */
+
+#ifndef atomstruct_hydrogens
+#define atomstruct_hydrogens
+
+#include <vector>
+
+#include "imex.h"
+#include "Coord.h"
+#include "Real.h"
+
+namespace atomstruct {
+
+class Atom;
+
+// Possible positions of substituents bonded to an atom at 'center' with the
+// given geometry (IdatmGeometry value) and bond length, given the positions
+// of its current bond partners.  These are the rules of bond_positions() in
+// chimerax.atomic.bond_geom: a planar center is made coplanar with the one or
+// two 'coplanar' points, and a rotamer is turned to put one position near
+// 'toward' or all positions far from 'away', with 'toward2' or 'away2'
+// settling what is left.  Null points are not used.
+ATOMSTRUCT_IMEX std::vector<Coord>  bond_positions(const Coord& center, int geometry,
+    Real bond_length, const std::vector<Coord>& bonded, const std::vector<Coord>* coplanar,
+    const Coord* toward = nullptr, const Coord* away = nullptr,
+    const Coord* toward2 = nullptr, const Coord* away2 = nullptr);
+
+// Hydrogen positions for the "simple" method of the addh command, for parent
+// atoms without alternate locations or metal coordination.  Each parent gets
+// the substituent count minus its bonds of hydrogens, at the given bond
+// length.  Positions that are fully set by the existing bonds are computed
+// in parallel.  Rotamers and parents with a choice of positions then look for
+// the least crowded positions one parent at a time, seeing the hydrogens
+// already placed.
+//
+// Crowding atoms and their coordinates are in one frame (scene or
+// untransformed) and must include the parents and their bond partners.
+// Crowding atoms in groups i and j only see each other if
+// interacts[i*num_groups+j], which keeps unopened and sibling models apart.
+// A hydrogen closer than metal_dist to a metal of its structure and pointing
+// at it is dropped, as metal coordination takes its place.
+//
+// Up to 4 positions for each parent are set in positions (4 by 3 for each
+// parent), their number in counts, and keep is false for dropped positions.
+ATOMSTRUCT_IMEX void  place_hydrogens(const std::vector<Atom*>& parents,
+    const int* geometries, const int* substituents, const Real* bond_lengths,
+    const std::vector<Atom*>& crowd_atoms, const Real* crowd_coords, const float* crowd_radii,
+    const int* crowd_groups, int num_groups, const unsigned char* interacts, Real metal_dist,
+    Real* positions, int* counts, unsigned char* keep);
+
+}  // namespace atomstruct
+
+#endif  // atomstruct_hydrogens
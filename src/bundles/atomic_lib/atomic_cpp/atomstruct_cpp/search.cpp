@@ -25,16 +25,24 @@
  */
 
 #include <algorithm>  // std::sort, mix/max_element
+#include <atomic>
+#include <cmath>  // std::floor
 #include <utility>  // std::make_pair
 
+#include <arrays/threadpool.h>  // Uses Thread_Pool::run()
+
 #define ATOMSTRUCT_EXPORT
 #include "search.h"
 
 namespace atomstruct {
 
 AtomSearchTree::AtomSearchTree(const std::vector<Atom*>& atoms, bool transformed, double sep_val):
-    _atoms(atoms), _sep_val(sep_val), _transformed(transformed)
+    DestructionObserver(DESTROYED_ATOMS), _atoms(atoms), _sep_val(sep_val),
+    _transformed(transformed)
 {
+    _atom_index.reserve(atoms.size());
+    for (size_t i = 0; i < atoms.size(); ++i)
+        _atom_index.emplace(atoms[i], i);
     init_root();
 }
 
@@ -45,7 +53,7 @@ AtomSearchTree::~AtomSearchTree()
 }
 
 void
-AtomSearchTree::destructors_done(const std::set<void*>& destroyed)
+AtomSearchTree::destructors_done(const std::unordered_set<void*>& destroyed)
 {
     std::vector<Atom*> survivors;
     for (auto a: _atoms)
@@ -94,6 +102,32 @@ AtomSearchTree::search(const Coord &target, double window)
     return ret_val;
 }
 
+void
+AtomSearchTree::search_many(const double* targets, size_t num_targets, double window,
+    std::vector<size_t>& offsets, std::vector<size_t>& indices, int num_threads)
+{
+    std::vector<std::vector<size_t>> found(num_targets);
+    std::atomic<size_t> next(0);
+    Thread_Pool::run(Thread_Pool::thread_count(num_targets, 1, std::max(num_threads, 1)), [&](int) {
+        for (size_t t = next++; t < num_targets; t = next++) {
+            auto p = targets + 3*t;
+            auto& hits = found[t];
+            for (auto a: search(Coord(p[0], p[1], p[2]), window))
+                hits.push_back(_atom_index.find(a)->second);
+            std::sort(hits.begin(), hits.end());
+        }
+    });
+
+    offsets.assign(1, 0);
+    offsets.reserve(num_targets + 1);
+    for (auto& hits: found)
+        offsets.push_back(offsets.back() + hits.size());
+    indices.clear();
+    indices.reserve(offsets.back());
+    for (auto& hits: found)
+        indices.insert(indices.end(), hits.begin(), hits.end());
+}
+
 void
 AtomSearchTree::init_root()
 {
@@ -306,4 +340,222 @@ _Node::search(const Coord& target, double window_sq, double* diffs_sq)
     return leaves;
 }
 
+// Limit grid size for widely separated atoms by using larger cells.
+static const size_t  MAX_CELLS_PER_ATOM = 8;
+
+AtomCellList::AtomCellList(const std::vector<Atom*>& atoms, double cell_size):
+    _cell_size(cell_size > 0 ? cell_size : 1.0), _requested_cell_size(cell_size)
+{
+    std::vector<Coord> coords;
+    coords.reserve(atoms.size());
+    for (auto a: atoms)
+        coords.push_back(a->coord());
+    _build(atoms, coords);
+}
+
+AtomCellList::AtomCellList(const std::vector<Atom*>& atoms, const std::vector<Coord>& coords,
+        double cell_size):
+    _cell_size(cell_size > 0 ? cell_size : 1.0), _requested_cell_size(cell_size)
+{
+    _build(atoms, coords);
+}
+
+void
+AtomCellList::_build(const std::vector<Atom*>& atoms, const std::vector<Coord>& coords)
+{
+    size_t n = atoms.size();
+    double xyz_max[3] = {0, 0, 0};
+    for (int a = 0; a < 3; ++a)
+        _origin[a] = 0;
+    for (size_t i = 0; i < n; ++i) {
+        const Coord& c = coords[i];
+        for (int a = 0; a < 3; ++a) {
+            if (i == 0 || c[a] < _origin[a]) _origin[a] = c[a];
+            if (i == 0 || c[a] > xyz_max[a]) xyz_max[a] = c[a];
+        }
+    }
+    size_t max_cells = std::max<size_t>(64, MAX_CELLS_PER_ATOM * n);
+    while (true) {
+        size_t ncells = 1;
+        for (int a = 0; a < 3; ++a) {
+            _grid_size[a] = 1 + (int)((xyz_max[a] - _origin[a]) / _cell_size);
+            ncells *= _grid_size[a];
+        }
+        if (ncells <= max_cells)
+            break;
+        _cell_size *= 2;
+    }
+
+    // Counting sort of atoms into cells.
+    size_t ncells = (size_t)_grid_size[0] * _grid_size[1] * _grid_size[2];
+    std::vector<long> atom_cell(n);
+    _cell_start.assign(ncells + 1, 0);
+    int ijk[3];
+    for (size_t i = 0; i < n; ++i) {
+        atom_cell[i] = _cell_index(coords[i], ijk);
+        _cell_start[atom_cell[i] + 1] += 1;
+    }
+    for (size_t c = 0; c < ncells; ++c)
+        _cell_start[c+1] += _cell_start[c];
+    std::vector<size_t> fill(_cell_start.begin(), _cell_start.end() - 1);
+    _cell_atoms.resize(n);
+    _cell_coords.resize(n);
+    _cell_order.resize(n);
+    for (size_t i = 0; i < n; ++i) {
+        size_t j = fill[atom_cell[i]]++;
+        _cell_atoms[j] = atoms[i];
+        _cell_coords[j] = coords[i];
+        _cell_order[j] = i;
+    }
+}
+
+long
+AtomCellList::_cell_index(const Coord& c, int* ijk) const
+{
+    for (int a = 0; a < 3; ++a) {
+        int i = (int)std::floor((c[a] - _origin[a]) / _cell_size);
+        ijk[a] = (i < 0 ? 0 : (i >= _grid_size[a] ? _grid_size[a] - 1 : i));
+    }
+    return ((long)ijk[2] * _grid_size[1] + ijk[1]) * _grid_size[0] + ijk[0];
+}
+
+std::vector<Atom*>
+AtomCellList::search(const Coord& target, double distance) const
+{
+    std::vector<Atom*> found;
+    int cmin[3], cmax[3];
+    if (!_cell_range(target, distance, cmin, cmax))
+        return found;
+    double d2 = distance * distance;
+    for (int k = cmin[2]; k <= cmax[2]; ++k)
+        for (int j = cmin[1]; j <= cmax[1]; ++j) {
+            long row = ((long)k * _grid_size[1] + j) * _grid_size[0];
+            size_t end = _cell_start[row + cmax[0] + 1];
+            for (size_t i = _cell_start[row + cmin[0]]; i < end; ++i) {
+                const Coord& c = _cell_coords[i];
+                double dx = c[0] - target[0], dy = c[1] - target[1], dz = c[2] - target[2];
+                if (dx*dx + dy*dy + dz*dz <= d2)
+                    found.push_back(_cell_atoms[i]);
+            }
+        }
+    return found;
+}
+
+void
+AtomCellList::search_indices(const Coord& target, double distance, std::vector<size_t>& found) const
+{
+    found.clear();
+    int cmin[3], cmax[3];
+    if (!_cell_range(target, distance, cmin, cmax))
+        return;
+    double d2 = distance * distance;
+    for (int k = cmin[2]; k <= cmax[2]; ++k)
+        for (int j = cmin[1]; j <= cmax[1]; ++j) {
+            long row = ((long)k * _grid_size[1] + j) * _grid_size[0];
+            size_t end = _cell_start[row + cmax[0] + 1];
+            for (size_t i = _cell_start[row + cmin[0]]; i < end; ++i) {
+                const Coord& c = _cell_coords[i];
+                double dx = c[0] - target[0], dy = c[1] - target[1], dz = c[2] - target[2];
+                if (dx*dx + dy*dy + dz*dz <= d2)
+                    found.push_back(_cell_order[i]);
+            }
+        }
+}
+
+size_t
+AtomCellList::mark_within(const Coord* points, size_t num_points, double distance,
+    unsigned char* mark) const
+{
+    size_t marked = 0;
+    double d2 = distance * distance;
+    int cmin[3], cmax[3];
+    for (size_t p = 0; p < num_points; ++p) {
+        const Coord& target = points[p];
+        if (!_cell_range(target, distance, cmin, cmax))
+            continue;
+        for (int k = cmin[2]; k <= cmax[2]; ++k)
+            for (int j = cmin[1]; j <= cmax[1]; ++j) {
+                long row = ((long)k * _grid_size[1] + j) * _grid_size[0];
+                size_t end = _cell_start[row + cmax[0] + 1];
+                for (size_t i = _cell_start[row + cmin[0]]; i < end; ++i) {
+                    unsigned char& m = mark[_cell_order[i]];
+                    if (m)
+                        continue;
+                    const Coord& c = _cell_coords[i];
+                    double dx = c[0] - target[0], dy = c[1] - target[1], dz = c[2] - target[2];
+                    if (dx*dx + dy*dy + dz*dz <= d2) {
+                        m = 1;
+                        ++marked;
+                    }
+                }
+            }
+    }
+    return marked;
+}
+
+// Range of cells overlapping a cube of half-width distance about a point,
+// false if the cube misses the grid.
+bool
+AtomCellList::_cell_range(const Coord& target, double distance, int* cmin, int* cmax) const
+{
+    if (_cell_atoms.empty())
+        return false;
+    for (int a = 0; a < 3; ++a) {
+        double lo = std::floor((target[a] - distance - _origin[a]) / _cell_size);
+        double hi = std::floor((target[a] + distance - _origin[a]) / _cell_size);
+        if (hi < 0 || lo >= _grid_size[a])
+            return false;
+        cmin[a] = (lo < 0 ? 0 : (int)lo);
+        cmax[a] = (hi >= _grid_size[a] ? _grid_size[a] - 1 : (int)hi);
+    }
+    return true;
+}
+
+std::vector<std::pair<Atom*, Atom*>>
+AtomCellList::close_pairs(double distance) const
+{
+    // Compare each cell with itself and the 13 neighbor cells with larger index
+    // when cells are at least as large as the distance, otherwise search about
+    // each atom.
+    std::vector<std::pair<Atom*, Atom*>> pairs;
+    size_t n = _cell_atoms.size();
+    double d2 = distance * distance;
+    if (distance > _cell_size) {
+        for (size_t i = 0; i < n; ++i)
+            for (auto a: search(_cell_coords[i], distance))
+                if (_cell_atoms[i] < a)
+                    pairs.push_back(std::make_pair(_cell_atoms[i], a));
+        return pairs;
+    }
+    int gx = _grid_size[0], gy = _grid_size[1], gz = _grid_size[2];
+    for (int k = 0; k < gz; ++k)
+      for (int j = 0; j < gy; ++j)
+        for (int i = 0; i < gx; ++i) {
+            long c = ((long)k * gy + j) * gx + i;
+            size_t s0 = _cell_start[c], e0 = _cell_start[c+1];
+            if (s0 == e0)
+                continue;
+            for (int dk = 0; dk <= 1; ++dk)
+              for (int dj = (dk == 0 ? 0 : -1); dj <= 1; ++dj)
+                for (int di = (dk == 0 && dj == 0 ? 0 : -1); di <= 1; ++di) {
+                    int ni = i + di, nj = j + dj, nk = k + dk;
+                    if (ni < 0 || ni >= gx || nj < 0 || nj >= gy || nk >= gz)
+                        continue;
+                    long nc = ((long)nk * gy + nj) * gx + ni;
+                    bool same = (nc == c);
+                    size_t s1 = _cell_start[nc], e1 = _cell_start[nc+1];
+                    for (size_t p = s0; p < e0; ++p) {
+                        const Coord& cp = _cell_coords[p];
+                        for (size_t q = (same ? p + 1 : s1); q < e1; ++q) {
+                            const Coord& cq = _cell_coords[q];
+                            double dx = cp[0] - cq[0], dy = cp[1] - cq[1], dz = cp[2] - cq[2];
+                            if (dx*dx + dy*dy + dz*dz <= d2)
+                                pairs.push_back(std::make_pair(_cell_atoms[p], _cell_atoms[q]));
+                        }
+                    }
+                }
+        }
+    return pairs;
+}
+
 }  // namespace atomstruct
@@ -29,6 +29,7 @@
 
 #include "imex.h"
 
+#include <unordered_map>
 #include <vector>
 
 #include "Python.h"
@@ -75,6 +76,7 @@ class ATOMSTRUCT_IMEX AtomSearchTree: public DestructionObserver {
     // is not supported.
 private:
     std::vector<Atom*>  _atoms;
+    std::unordered_map<Atom*, size_t>  _atom_index; // position in the constructor's atoms
     double  _sep_val;
     bool  _transformed;
 
@@ -83,12 +85,64 @@ private:
 public:
     AtomSearchTree(const std::vector<Atom*>& atoms, bool transformed, double sep_val);
     virtual ~AtomSearchTree();
-    virtual void  destructors_done(const std::set<void*>& destroyed);
+    virtual void  destructors_done(const std::unordered_set<void*>& destroyed);
     std::vector<Atom*>  search(Atom*, double);
     std::vector<Atom*>  search(const Coord&, double);
+    // Search about each of num_targets xyz points at once, dividing them among threads.
+    // The atoms found for target t are indices[offsets[t]] to indices[offsets[t+1]-1],
+    // in increasing order, as positions in the atoms the tree was made from.
+    void  search_many(const double* targets, size_t num_targets, double window,
+        std::vector<size_t>& offsets, std::vector<size_t>& indices, int num_threads = 1);
     _Node  *root;
 };
 
+class ATOMSTRUCT_IMEX AtomCellList {
+    // AtomCellList is a uniform grid of cubic cells over atom coordinates
+    // (untransformed).  Atoms within a distance of a point are found by
+    // checking only the cells overlapping a cube of that size around the point.
+    // Atoms and their coordinates are stored contiguously in cell order.
+    // A cached list for a structure is available from Structure::cell_list(),
+    // which rebuilds it when coordinates change.
+private:
+    double  _cell_size;
+    double  _requested_cell_size;
+    double  _origin[3];
+    int  _grid_size[3];
+    std::vector<size_t>  _cell_start;   // cell c atoms are [_cell_start[c], _cell_start[c+1])
+    std::vector<Atom*>  _cell_atoms;
+    std::vector<Coord>  _cell_coords;
+    std::vector<size_t>  _cell_order;   // position of each cell atom in the constructor's atoms
+
+    void  _build(const std::vector<Atom*>& atoms, const std::vector<Coord>& coords);
+    long  _cell_index(const Coord& c, int* ijk) const;
+    bool  _cell_range(const Coord& c, double distance, int* cmin, int* cmax) const;
+
+public:
+    AtomCellList(const std::vector<Atom*>& atoms, double cell_size);
+    // use the given coordinates instead of the atoms' current coordinates
+    AtomCellList(const std::vector<Atom*>& atoms, const std::vector<Coord>& coords,
+        double cell_size);
+    double  cell_size() const { return _cell_size; }
+    double  requested_cell_size() const { return _requested_cell_size; }
+    size_t  size() const { return _cell_atoms.size(); }
+    size_t  memory_usage() const {
+        return sizeof(AtomCellList) + _cell_start.capacity() * sizeof(size_t)
+            + _cell_atoms.capacity() * sizeof(Atom*) + _cell_coords.capacity() * sizeof(Coord)
+            + _cell_order.capacity() * sizeof(size_t);
+    }
+    // atoms within distance of a point, which includes the atom itself if searching about an atom
+    std::vector<Atom*>  search(const Coord&, double distance) const;
+    std::vector<Atom*>  search(const Atom* a, double distance) const { return search(a->coord(), distance); }
+    // as search(), but giving positions in the constructor's atoms; found is cleared first
+    void  search_indices(const Coord&, double distance, std::vector<size_t>& found) const;
+    // set mark[i] for atoms within distance of any of the points, where i is the position
+    // in the constructor's atoms, and return the number of atoms newly marked
+    size_t  mark_within(const Coord* points, size_t num_points, double distance,
+        unsigned char* mark) const;
+    // pairs of different atoms within distance, each pair once
+    std::vector<std::pair<Atom*, Atom*>>  close_pairs(double distance) const;
+};
+
 }  // namespace atomstruct
 
 #endif  // atomstruct_search
@@ -25,6 +25,7 @@
  */
 
 #include <algorithm>  // std::find_if_not, std::min
+#include <array>
 #include <cctype>  // std::islower
 #include <cmath>  // std::abs
 
@@ -163,71 +164,116 @@ estimate_assoc_params(StructureSeq& sseq)
     return ap;
 }
 
-static unsigned int
-_constrained(const Sequence::Contents& aseq, AssocParams& cm_ap,
+// Places structure segments [s0, s1) in the alignment sequence window
+// [w0, w1) with the fewest mismatches, leaving at least one position between
+// consecutive segments.  The longest segment is placed first and the segments
+// to either side of it are then placed in the space remaining on that side.
+// Different placements of a segment leave many of the same subproblems for
+// the segments beyond its neighbors, so subproblem results are remembered
+// instead of being recomputed, and windows are index ranges into the one
+// alignment sequence rather than copies of it.
+class ConstrainedMatcher {
+    typedef std::array<unsigned int, 5>  Key;  // s0, s1, w0, w1, max_errors
+    struct Match {
+        unsigned int  errors;
+        std::vector<int>  offsets;
+    };
+
+    const Sequence::Contents&  _aseq;
+    const std::vector<Sequence::Contents>&  _segments;
+    const std::vector<int>&  _gaps;  // gaps[s] precedes segment s
+    std::vector<bool>  _all_unknown;
+    std::map<Key, Match>  _memo;
+
+    unsigned int  _match(unsigned int s0, unsigned int s1, unsigned int w0, unsigned int w1,
+        std::vector<int>& offsets, unsigned int max_errors);
+public:
+    ConstrainedMatcher(const Sequence::Contents& aseq,
+            const std::vector<Sequence::Contents>& segments, const std::vector<int>& gaps):
+            _aseq(aseq), _segments(segments), _gaps(gaps) {
+        for (auto& seg: segments)
+            _all_unknown.push_back(std::find_if_not(seg.begin(), seg.end(),
+                [](char c){return c == 'X' || c == '?';}) == seg.end());
+    }
+
+    // returns the number of errors, or max_errors+1 if the segments won't fit,
+    // in which case 'offsets' is left as is
+    unsigned int  match(unsigned int s0, unsigned int s1, unsigned int w0, unsigned int w1,
+            std::vector<int>& offsets, unsigned int max_errors) {
+        Key key = {s0, s1, w0, w1, max_errors};
+        auto mi = _memo.find(key);
+        if (mi == _memo.end()) {
+            Match m;
+            m.errors = _match(s0, s1, w0, w1, m.offsets, max_errors);
+            mi = _memo.emplace(key, std::move(m)).first;
+        }
+        if (mi->second.errors <= max_errors)
+            offsets = mi->second.offsets;
+        return mi->second.errors;
+    }
+};
+
+unsigned int
+ConstrainedMatcher::_match(unsigned int s0, unsigned int s1, unsigned int w0, unsigned int w1,
     std::vector<int>& offsets, unsigned int max_errors)
 {
     // find the biggest segment, (but non-all-X/? segments win over
     // all-X/? segments)
+    unsigned int num_segs = s1 - s0;
     unsigned int longest;
     bool longest_found = false;
-    int seg_num = -1;
     unsigned int bsi;
-    for (auto seg: cm_ap.segments) {
-        seg_num++;
-        if (std::find_if_not(seg.begin(), seg.end(),
-                [](char c){return c == 'X' || c == '?';}) == seg.end()) {
+    for (unsigned int si = 0; si < num_segs; ++si) {
+        if (_all_unknown[s0+si])
             continue;
-        }
-        if (!longest_found || seg.size() > longest) {
-            bsi = seg_num;
-            longest = seg.size();
+        auto size = _segments[s0+si].size();
+        if (!longest_found || size > longest) {
+            bsi = si;
+            longest = size;
             longest_found = true;
         }
     }
     if (!longest_found) {
         // all segments are all-X/?
-        seg_num = -1;
-        for (auto seg: cm_ap.segments) {
-            seg_num++;
-            if (!longest_found || seg.size() > longest) {
-                bsi = seg_num;
-                longest = seg.size();
+        for (unsigned int si = 0; si < num_segs; ++si) {
+            auto size = _segments[s0+si].size();
+            if (!longest_found || size > longest) {
+                bsi = si;
+                longest = size;
                 longest_found = true;
             }
         }
     }
 
-    auto bsi_iter = cm_ap.segments.begin() + bsi;
+    Sequence::Contents::size_type win_size = w1 - w0;
     unsigned int left_space = 0;
-    for (auto seg_i = cm_ap.segments.begin(); seg_i != bsi_iter; ++seg_i) {
-        left_space += seg_i->size() + 1;
-    }
+    for (unsigned int si = 0; si < bsi; ++si)
+        left_space += _segments[s0+si].size() + 1;
     unsigned int right_space = 0;
-    for (auto seg_i = bsi_iter+1; seg_i != cm_ap.segments.end(); ++seg_i) {
-        right_space += seg_i->size() + 1;
-    }
-    if (aseq.size() - left_space - right_space < longest)
+    for (unsigned int si = bsi+1; si < num_segs; ++si)
+        right_space += _segments[s0+si].size() + 1;
+    if (win_size - left_space - right_space < longest)
         return max_errors+1;
 
     std::vector<unsigned int> err_list;
-    auto seq = cm_ap.segments[bsi];
+    const Sequence::Contents& seq = _segments[s0+bsi];
+    const char* aseq = _aseq.data() + w0;
     int min_offset = -1;
     unsigned int min_errs;
     bool min_errs_found = false;
     unsigned int min_gap_errs;
     int target_left_gap, target_right_gap;
     if (bsi == 0) {
-        target_left_gap = cm_ap.gaps[0];
+        target_left_gap = _gaps[s0];
     } else {
         target_left_gap = -1;
     }
-    if (bsi == cm_ap.segments.size()-1) {
-        target_right_gap = cm_ap.gaps[bsi+1];
+    if (bsi == num_segs-1) {
+        target_right_gap = _gaps[s0+bsi+1];
     } else {
         target_right_gap = -1;
     }
-    int offset_end = aseq.size() - right_space - longest + 1;
+    int offset_end = win_size - right_space - longest + 1;
     for (int offset = left_space; offset < offset_end; ++offset) {
         unsigned int errors = 0;
         for (unsigned int i = 0; i < longest; ++i) {
@@ -245,7 +291,7 @@ _constrained(const Sequence::Contents& aseq, AssocParams& cm_ap,
                 gap_errs += std::abs((int)((offset+1) - target_left_gap));
             }
             if (target_right_gap >= 0) {
-                gap_errs += std::abs((int)(1 + (aseq.size() - (offset+longest))
+                gap_errs += std::abs((int)(1 + (win_size - (offset+longest))
                     - target_right_gap));
             }
             if (!min_errs_found || errors < min_errs
@@ -263,21 +309,14 @@ _constrained(const Sequence::Contents& aseq, AssocParams& cm_ap,
     // leave gaps to left and right
     std::vector<int> left_offsets, right_offsets;
     unsigned int left_errors = 0, right_errors = 0;
-    AssocParams left_ap(0, cm_ap.segments.cbegin(),
-            cm_ap.segments.cbegin()+bsi,
-            cm_ap.gaps.cbegin(), cm_ap.gaps.cbegin()+bsi+1);
-    AssocParams right_ap(0, cm_ap.segments.begin()+bsi+1,
-            cm_ap.segments.end(), cm_ap.gaps.begin()+bsi+1, cm_ap.gaps.end());
+    unsigned int left_s1 = s0 + bsi, right_s0 = s0 + bsi + 1;
     if (bsi > 0) {
-        Sequence::Contents left_aseq(aseq.begin(), aseq.begin()+min_offset-1);
-        left_errors = _constrained(left_aseq, left_ap, left_offsets,
+        left_errors = match(s0, left_s1, w0, w0 + min_offset - 1, left_offsets,
             max_errors - min_errs);
     }
-    if (left_errors + min_errs <= max_errors && bsi+1 < cm_ap.segments.size()) {
-        Sequence::Contents right_aseq(aseq.begin() + min_offset + longest + 1,
-            aseq.end());
-        right_errors = _constrained(right_aseq, right_ap, right_offsets,
-            max_errors - min_errs - left_errors);
+    if (left_errors + min_errs <= max_errors && right_s0 < s1) {
+        right_errors = match(right_s0, s1, w0 + min_offset + longest + 1, w1,
+            right_offsets, max_errors - min_errs - left_errors);
     }
     unsigned int tot_errs = min_errs + left_errors + right_errors;
     struct OffsetInfo {
@@ -299,8 +338,7 @@ _constrained(const Sequence::Contents& aseq, AssocParams& cm_ap,
             continue;
 
         if (bsi > 0) {
-            Sequence::Contents left_aseq(aseq.begin(), aseq.begin()+offset-1);
-            left_errors = _constrained(left_aseq, left_ap, left_offsets,
+            left_errors = match(s0, left_s1, w0, w0 + offset - 1, left_offsets,
                 std::min(tot_errs, max_errors) - base_errs);
         } else {
             left_offsets.clear();
@@ -310,9 +348,8 @@ _constrained(const Sequence::Contents& aseq, AssocParams& cm_ap,
         if (left_errors + base_errs > max_errors)
             continue;
 
-        if (bsi+1 < cm_ap.segments.size()) {
-            Sequence::Contents right_aseq(aseq.begin()+offset+longest+1, aseq.end());
-            right_errors = _constrained(right_aseq, right_ap, right_offsets,
+        if (right_s0 < s1) {
+            right_errors = match(right_s0, s1, w0 + offset + longest + 1, w1, right_offsets,
                 std::min(tot_errs, max_errors) - base_errs - left_errors);
         } else {
             right_offsets.clear();
@@ -340,30 +377,31 @@ _constrained(const Sequence::Contents& aseq, AssocParams& cm_ap,
     return tot_errs;
 }
 
-AssocRetvals
-constrained_match(const Sequence::Contents& aseq, const StructureSeq& mseq,
-    const AssocParams& ap, unsigned int max_errors)
+static AssocRetvals
+constrained_match(const Sequence::Contents& aseq, Residue* const* residues,
+    std::size_t num_residues, const AssocParams& ap, unsigned int max_errors)
 {
     // all the segments should fit in aseq
-    AssocParams cm_ap = ap;
-    cm_ap.gaps.insert(cm_ap.gaps.begin(), -1);
-    cm_ap.gaps.push_back(-1);
+    std::vector<int> gaps = ap.gaps;
+    gaps.insert(gaps.begin(), -1);
+    gaps.push_back(-1);
     std::vector<int> offsets;
-    unsigned int errors = _constrained(aseq, cm_ap, offsets, max_errors);
+    ConstrainedMatcher matcher(aseq, ap.segments, gaps);
+    unsigned int errors = matcher.match(0, ap.segments.size(), 0, aseq.size(), offsets,
+        max_errors);
     if (errors > max_errors)
         throw SA_AssocFailure("bad assoc");
     if (offsets.size() != ap.segments.size())
         throw std::logic_error("Internal match problem: #segments != #offsets");
     AssocRetvals ret;
     unsigned int res_offset = 0;
-    auto num_mseq_res = mseq.residues().size();
     for (unsigned int si = 0; si < ap.segments.size(); ++si) {
         int offset = offsets[si];
         const Sequence::Contents& segment = ap.segments[si];
         for (unsigned int i = 0; i < segment.size(); ++i) {
-            Residue* r = mseq.residues()[res_offset+i];
-            if (res_offset+i >= num_mseq_res)
+            if (res_offset+i >= num_residues)
                 break;
+            Residue* r = residues[res_offset+i];
             if (r != nullptr) {
                 ret.match_map[r] = offset+i;
                 ret.match_map[offset+i] = r;
@@ -375,9 +413,9 @@ constrained_match(const Sequence::Contents& aseq, const StructureSeq& mseq,
     return ret;
 }
 
-AssocRetvals
-gapped_match(const Sequence::Contents& aseq, const StructureSeq& mseq,
-    const AssocParams& ap, unsigned int max_errors)
+static AssocRetvals
+gapped_match(const Sequence::Contents& aseq, Residue* const* residues,
+    std::size_t num_residues, const AssocParams& ap, unsigned int max_errors)
 {
     Sequence::Contents gapped = ap.segments[0];
     for (unsigned int i = 1; i < ap.segments.size(); ++i) {
@@ -388,7 +426,7 @@ gapped_match(const Sequence::Contents& aseq, const StructureSeq& mseq,
 
     // to avoid matching completely in gaps, need to establish 
     // a minimum number of matches
-    unsigned int min_matches = std::min(aseq.size(), mseq.size()) / 2;
+    unsigned int min_matches = std::min(aseq.size(), num_residues) / 2;
     int best_score = 0, best_offset;
     unsigned int tot_errs = max_errors + 1;
     int o_end = ap.est_len - aseq.size() + 1;
@@ -434,15 +472,14 @@ gapped_match(const Sequence::Contents& aseq, const StructureSeq& mseq,
 
     AssocRetvals ret;
     ret.num_errors = tot_errs;
-    auto num_mseq_res = mseq.residues().size();
-    int mseq_index = 0;
+    std::size_t mseq_index = 0;
     for (int i = 0; i < best_offset + (int)aseq.size(); ++i) {
         if (i >= (int)gapped.size())
             break;
         if (gapped[i] == '.')
             continue;
         if (i >= best_offset) {
-            auto res = mseq.residues()[mseq_index];
+            auto res = residues[mseq_index];
             if (res != nullptr) {
                 int aseq_index = i - best_offset;
                 ret.match_map[res] = aseq_index;
@@ -450,15 +487,23 @@ gapped_match(const Sequence::Contents& aseq, const StructureSeq& mseq,
             }
         }
         ++mseq_index;
-        if (mseq_index >= num_mseq_res)
+        if (mseq_index >= num_residues)
             break;
     }
     return ret;
 }
 
-AssocRetvals
-try_assoc(const Sequence& align_seq, const StructureSeq& mseq,
-    const AssocParams &ap, unsigned int max_errors)
+static AssocRetvals
+match(const Sequence::Contents& aseq, Residue* const* residues, std::size_t num_residues,
+    const AssocParams& ap, unsigned int max_errors)
+{
+    if (aseq.size() >= ap.est_len)
+        return constrained_match(aseq, residues, num_residues, ap, max_errors);
+    return gapped_match(aseq, residues, num_residues, ap, max_errors);
+}
+
+Sequence::Contents
+assoc_contents(const Sequence& align_seq)
 {
     int lower_to_upper = 'A' - 'a';
     Sequence::Contents aseq;
@@ -468,42 +513,48 @@ try_assoc(const Sequence& align_seq, const StructureSeq& mseq,
         } else
             aseq.push_back(c);
     }
+    return aseq;
+}
 
+static AssocRetvals
+try_assoc_contents(const Sequence::Contents& aseq, const StructureSeq& mseq,
+    const AssocParams &ap, unsigned int max_errors)
+{
+    auto residues = mseq.residues().data();
+    auto num_residues = mseq.residues().size();
     bool assoc_failure = false;
     AssocRetvals retvals;
     try {
-        if (aseq.size() >= ap.est_len)
-            retvals = constrained_match(aseq, mseq, ap, max_errors);
-        else
-            retvals = gapped_match(aseq, mseq, ap, max_errors);
+        retvals = match(aseq, residues, num_residues, ap, max_errors);
     } catch (SA_AssocFailure&) {
         assoc_failure = true;
     }
-    retvals.match_map.aseq = &align_seq;
-    retvals.match_map.mseq = &mseq;
 
     if (!assoc_failure && retvals.num_errors == 0)
         return retvals;
 
     // prune off 'X/?' residues and see how that works...
-    if (mseq.front() != 'X' && mseq.back() != 'X' && mseq.front() != '?' && mseq.back() != '?') {
+    // (the pruned structure sequence is just a subrange of this one)
+    auto& chars = mseq.characters();
+    auto unknown = [](char c) { return c == 'X' || c == '?'; };
+    if (chars.empty() || (!unknown(chars.front()) && !unknown(chars.back()))) {
         if (assoc_failure)
             throw SA_AssocFailure("bad assoc");
         return retvals;
     }
-    StructureSeq no_X = mseq;
     auto no_X_ap = AssocParams(ap.est_len, ap.segments.begin(),
         ap.segments.end(), ap.gaps.begin(), ap.gaps.end());
-    while (no_X.size() > 0 && (no_X.front() == 'X' || no_X.front() == '?')) {
-        no_X.pop_front();
+    std::size_t front_loss = 0;
+    while (front_loss < chars.size() && unknown(chars[front_loss])) {
+        ++front_loss;
         --no_X_ap.est_len;
     }
-    if (no_X.size() == 0) {
+    if (front_loss == chars.size()) {
         if (assoc_failure)
             throw SA_AssocFailure("bad assoc");
         return retvals;
     }
-    unsigned int offset = mseq.size() - no_X.size();
+    unsigned int offset = front_loss;
     while (offset > 0 && offset >= no_X_ap.segments.front().size()) {
         offset -= no_X_ap.segments.front().size();
         no_X_ap.segments.erase(no_X_ap.segments.begin());
@@ -513,11 +564,11 @@ try_assoc(const Sequence& align_seq, const StructureSeq& mseq,
     while (offset-- > 0)
         no_X_ap.segments.front().erase(no_X_ap.segments.front().begin());
     unsigned int tail_loss = 0;
-    while (no_X.back() == 'X' || no_X.back() == '?') {
-        no_X.pop_back();
+    while (unknown(chars[chars.size() - 1 - tail_loss])) {
         --no_X_ap.est_len;
         ++tail_loss;
     }
+    std::size_t no_X_size = chars.size() - front_loss - tail_loss;
     while (tail_loss > 0 && tail_loss >= no_X_ap.segments.back().size()) {
         tail_loss -= no_X_ap.segments.back().size();
         no_X_ap.segments.pop_back();
@@ -528,10 +579,7 @@ try_assoc(const Sequence& align_seq, const StructureSeq& mseq,
         no_X_ap.segments.back().pop_back();
     AssocRetvals no_X_retvals;
     try {
-        if (aseq.size() >= no_X_ap.est_len)
-            no_X_retvals = constrained_match(aseq, no_X, no_X_ap, max_errors);
-        else
-            no_X_retvals = gapped_match(aseq, no_X, no_X_ap, max_errors);
+        no_X_retvals = match(aseq, residues + front_loss, no_X_size, no_X_ap, max_errors);
     } catch (SA_AssocFailure&) {
         if (assoc_failure)
             throw;
@@ -542,4 +590,61 @@ try_assoc(const Sequence& align_seq, const StructureSeq& mseq,
     return retvals;
 }
 
+AssocRetvals
+try_assoc(const Sequence& align_seq, const StructureSeq& mseq,
+    const AssocParams &ap, unsigned int max_errors)
+{
+    AssocRetvals retvals = try_assoc_contents(assoc_contents(align_seq), mseq, ap, max_errors);
+    retvals.match_map.aseq = &align_seq;
+    retvals.match_map.mseq = &mseq;
+    return retvals;
+}
+
+BestAssoc
+best_assoc(const std::vector<const Sequence::Contents*>& aseqs, const StructureSeq& mseq,
+    const AssocParams& ap, unsigned int max_errors)
+{
+    // the structure sequence taken as one segment, in case the alignment
+    // sequence was derived from the structure
+    AssocParams smooshed;
+    smooshed.est_len = mseq.size();
+    smooshed.segments.emplace_back(mseq.begin(), mseq.end());
+
+    BestAssoc best;
+    for (unsigned int i = 0; i < aseqs.size(); ++i) {
+        const Sequence::Contents& aseq = *aseqs[i];
+        unsigned int try_errors = best.aseq_index < 0 ? max_errors : best.retvals.num_errors - 1;
+        AssocRetvals retvals;
+        bool with_gaps = true;
+        try {
+            retvals = try_assoc_contents(aseq, mseq, ap, try_errors);
+        } catch (SA_AssocFailure&) {
+            with_gaps = false;
+        }
+        if (!with_gaps) {
+            if (ap.gaps.empty())
+                continue;
+            try {
+                retvals = try_assoc_contents(aseq, mseq, smooshed, try_errors);
+            } catch (SA_AssocFailure&) {
+                continue;
+            }
+        } else if (retvals.num_errors > 0 && !ap.gaps.empty()) {
+            // that worked but had errors; see if smooshing the structure
+            // sequence together works better
+            try {
+                retvals = try_assoc_contents(aseq, mseq, smooshed, retvals.num_errors - 1);
+            } catch (SA_AssocFailure&) {
+            }
+        }
+        best.aseq_index = i;
+        best.retvals = std::move(retvals);
+        best.retvals.match_map.aseq = nullptr;
+        best.retvals.match_map.mseq = &mseq;
+        if (best.retvals.num_errors == 0)
+            break;
+    }
+    return best;
+}
+
 }  // namespace atomstruct
@@ -81,6 +81,24 @@ struct AssocRetvals {
 AssocRetvals  ATOMSTRUCT_IMEX try_assoc(const Sequence& aseq, const StructureSeq& mseq,
     const AssocParams& ap, unsigned int max_errors = 6);
 
+// alignment sequence characters as the matching compares them: ungapped and
+// upper case
+Sequence::Contents  ATOMSTRUCT_IMEX assoc_contents(const Sequence& aseq);
+
+// The search the sequence viewer makes when associating a chain: try each
+// alignment sequence in turn, allowing fewer errors than the best match so
+// far and also trying the chain without its structure gaps, until a match has
+// no errors.  The alignment sequences are given as assoc_contents() so that
+// several chains can be matched against the same sequences concurrently.
+// The match map's aseq is left null.
+struct BestAssoc {
+    int  aseq_index = -1;  // -1 if no sequence matched
+    AssocRetvals  retvals;
+};
+
+BestAssoc  ATOMSTRUCT_IMEX best_assoc(const std::vector<const Sequence::Contents*>& aseqs,
+    const StructureSeq& mseq, const AssocParams& ap, unsigned int max_errors);
+
 // thrown when seq-structure association fails
 class ATOMSTRUCT_IMEX SA_AssocFailure : public std::runtime_error {
 public:
@@ -33,6 +33,6 @@
 // Each class's SESSION_NUM... methods yield the number of those types that don't vary on
 // a per-instance basis and are directly saved/restored by that class and not by a contained
 // class such as Rgba.
-#define CURRENT_SESSION_VERSION 19
+#define CURRENT_SESSION_VERSION 20
 
 #endif  // atomstruct_session
@@ -0,0 +1,437 @@
+// vi: set expandtab ts=4 sw=4:
+
+/*
+ * === UCSF ChimeraX Copyright ===
+ * Copyright 2022 Regents of the University of California. All rights reserved.
+ * The ChimeraX application is provided pursuant to the ChimeraX license
+ * agreement, which covers academic and commercial uses. For more details, see
+ * <http://www.rbvi.ucsf.edu/chimerax/docs/licensing.html>
+ *
+ * This particular file is part of the ChimeraX library. You can also
+ * redistribute and/or modify it under the terms of the GNU Lesser General
+ * Public License version 2.1 as published by the Free Software Foundation.
+ * For more details, see
+ * <https://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESSED OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. ADDITIONAL LIABILITY
+ * LIMITATIONS ARE DESCRIBED IN THE GNU LESSER GENERAL PUBLIC LICENSE
+ * VERSION 2.1
+ *
+ * This notice must be embedded in or attached to all copies, including partial
+ * copies, of the software or any revisions or derivations thereof.
+ * === UCSF ChimeraX Copyright ===
+ */
+
+#include <cctype>       // for std::tolower
+#include <cstring>      // for std::strcmp
+#include <unordered_map>
+
+#define ATOMSTRUCT_EXPORT
+#include "Atom.h"
+#include "Residue.h"
+#include "spec_filter.h"
+
+namespace atomstruct {
+
+static std::string
+lower_case(const std::string& s)
+{
+    std::string lc(s);
+    for (auto& c: lc)
+        c = std::tolower(static_cast<unsigned char>(c));
+    return lc;
+}
+
+// Match a [seq] character class starting at p.  Returns the character
+// after the closing bracket, or nullptr if there is no closing bracket and
+// so the bracket is an ordinary character.
+static const char*
+char_class(const char* p, char c, bool* matched)
+{
+    const char* q = p + 1;
+    bool negate = (*q == '!');
+    if (negate)
+        ++q;
+    if (*q == ']')
+        ++q;
+    while (*q && *q != ']')
+        ++q;
+    if (*q == '\0')
+        return nullptr;
+    const char* s = p + (negate ? 2 : 1);
+    bool in = false;
+    for (; s < q; ++s) {
+        if (s + 2 < q && s[1] == '-') {
+            if (s[0] <= c && c <= s[2])
+                in = true;
+            s += 2;
+        } else if (*s == c)
+            in = true;
+    }
+    *matched = (in != negate);
+    return q + 1;
+}
+
+bool
+wildcard_match(const char* pattern, const char* name)
+{
+    for (const char* p = pattern; *p; ++p) {
+        if (*p == '*') {
+            while (p[1] == '*')
+                ++p;
+            if (p[1] == '\0')
+                return true;
+            for (const char* s = name; *s; ++s)
+                if (wildcard_match(p + 1, s))
+                    return true;
+            return false;
+        }
+        if (*name == '\0')
+            return false;
+        if (*p == '[') {
+            bool matched;
+            const char* next = char_class(p, *name, &matched);
+            if (next != nullptr) {
+                if (!matched)
+                    return false;
+                p = next - 1;
+                ++name;
+                continue;
+            }
+        }
+        if (*p != '?' && *p != *name)
+            return false;
+        ++name;
+    }
+    return *name == '\0';
+}
+
+// ----------------------------------------------------------------------------
+SpecName::SpecName(const std::string& start, const std::string* end, bool case_sensitive):
+    _start(case_sensitive ? start : lower_case(start)), _range(end != nullptr),
+    _case_sensitive(case_sensitive)
+{
+    if (_range)
+        _end = case_sensitive ? *end : lower_case(*end);
+    // Wildcards are not allowed in ranges.
+    _wildcard = !_range && _start.find_first_of("*?[") != std::string::npos;
+}
+
+bool
+SpecName::matches(const std::string& name) const
+{
+    if (!_case_sensitive) {
+        std::string lc = lower_case(name);
+        if (_range)
+            return lc >= _start && lc <= _end;
+        return _wildcard ? wildcard_match(_start.c_str(), lc.c_str()) : lc == _start;
+    }
+    if (_range)
+        return name >= _start && name <= _end;
+    return _wildcard ? wildcard_match(_start.c_str(), name.c_str()) : name == _start;
+}
+
+// ----------------------------------------------------------------------------
+static int
+ic_order(char ic)
+{
+    return (ic == ' ' || ic == '\0') ? -1 : static_cast<unsigned char>(ic);
+}
+
+SpecResidueId::SpecResidueId(bool has_start, int start_num, char start_ic, bool range,
+        bool has_end, int end_num, char end_ic):
+    _range(range), _has_start(has_start), _has_end(has_end),
+    _start_num(start_num), _end_num(end_num),
+    _start_ic(ic_order(start_ic)), _end_ic(ic_order(end_ic))
+{
+}
+
+bool
+SpecResidueId::matches(int number, char insertion_code) const
+{
+    int ic = ic_order(insertion_code);
+    if (!_range)
+        return _has_start && number == _start_num && ic == _start_ic;
+    if (_has_start && (number < _start_num || (number == _start_num && ic < _start_ic)))
+        return false;
+    if (_has_end && (number > _end_num || (number == _end_num && ic > _end_ic)))
+        return false;
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+namespace {
+
+enum Attr { A_NAME, A_ELEMENT, A_IDATM_TYPE, A_STRUCTURE_CATEGORY, A_SERIAL_NUMBER,
+    A_BFACTOR, A_OCCUPANCY, A_RADIUS, A_DISPLAY, A_HIDE, A_SELECTED, A_VISIBLE,
+    A_DRAW_MODE, A_NUM_BONDS, R_NAME, R_CHAIN_ID, R_NUMBER, R_SS_TYPE, R_SS_ID,
+    R_IS_HELIX, R_IS_STRAND, R_RIBBON_DISPLAY, R_POLYMER_TYPE, NUM_ATTRS };
+
+struct AttrInfo {
+    const char*  name;
+    bool  residue;
+    bool  is_string;
+};
+
+// Names as in the Python Atom and Residue classes.
+const AttrInfo attr_info[NUM_ATTRS] = {
+    {"name", false, true}, {"element", false, true}, {"idatm_type", false, true},
+    {"structure_category", false, true}, {"serial_number", false, false},
+    {"bfactor", false, false}, {"occupancy", false, false}, {"radius", false, false},
+    {"display", false, false}, {"hide", false, false}, {"selected", false, false},
+    {"visible", false, false}, {"draw_mode", false, false}, {"num_bonds", false, false},
+    {"name", true, true}, {"chain_id", true, true}, {"number", true, false},
+    {"ss_type", true, false}, {"ss_id", true, false}, {"is_helix", true, false},
+    {"is_strand", true, false}, {"ribbon_display", true, false},
+    {"polymer_type", true, false},
+};
+
+const char*
+structure_category_name(Atom::StructCat cat)
+{
+    switch (cat) {
+        case Atom::StructCat::Main: return "main";
+        case Atom::StructCat::Solvent: return "solvent";
+        case Atom::StructCat::Ligand: return "ligand";
+        case Atom::StructCat::Ions: return "ions";
+        default: return "other";
+    }
+}
+
+std::string
+string_attr(const Atom* a, int attr)
+{
+    switch (attr) {
+        case A_NAME: return a->name().str();
+        case A_ELEMENT: return a->element().name();
+        case A_IDATM_TYPE: return a->idatm_type().c_str();
+        case A_STRUCTURE_CATEGORY: return structure_category_name(a->structure_category());
+        case R_NAME: return a->residue()->name().str();
+        case R_CHAIN_ID: return a->residue()->chain_id().str();
+    }
+    return std::string();
+}
+
+double
+number_attr(const Atom* a, int attr)
+{
+    const Residue* r = a->residue();
+    switch (attr) {
+        case A_ELEMENT: return a->element().number();
+        case A_SERIAL_NUMBER: return a->serial_number();
+        case A_BFACTOR: return a->bfactor();
+        case A_OCCUPANCY: return a->occupancy();
+        case A_RADIUS: return a->radius();
+        case A_DISPLAY: return a->display();
+        case A_HIDE: return a->hide();
+        case A_SELECTED: return a->selected();
+        case A_VISIBLE: return a->visible();
+        case A_DRAW_MODE: return a->draw_mode();
+        case A_NUM_BONDS: return a->bonds().size();
+        case R_NUMBER: return r->number();
+        case R_SS_TYPE: return r->ss_type();
+        case R_SS_ID: return r->ss_id();
+        case R_IS_HELIX: return r->is_helix();
+        case R_IS_STRAND: return r->is_strand();
+        case R_RIBBON_DISPLAY: return r->ribbon_display();
+        case R_POLYMER_TYPE: return r->polymer_type();
+    }
+    return 0;
+}
+
+}  // namespace
+
+// The Python tests being replaced are:  attribute truth for no value, string
+// comparison of str(value) if the value is a string (case insensitive with
+// wildcards for = and !=), and otherwise Python comparison of the attribute
+// value.  Combinations Python would treat differently, like comparing a
+// string attribute to a number, are left to Python.
+SpecAttrTest::SpecAttrTest(bool residue_attr, const std::string& name, Op op,
+        ValueType vtype, const std::string& svalue, double nvalue):
+    _attr(-1), _op(op), _vtype(vtype), _svalue(svalue), _nvalue(nvalue), _wildcard(false)
+{
+    int attr = -1;
+    for (int i = 0; i < NUM_ATTRS; ++i)
+        if (attr_info[i].residue == residue_attr && name == attr_info[i].name) {
+            attr = i;
+            break;
+        }
+    if (attr < 0)
+        return;
+    bool equality = (op == EQ || op == NE || op == EQ_CASE || op == NE_CASE);
+    bool valid;
+    if (attr == A_ELEMENT)
+        // Element objects are always true and only compare equal to names or numbers.
+        valid = (vtype == STRING && equality) || (vtype == NUMBER && (op == EQ || op == NE));
+    else if (vtype == NONE)
+        valid = (op == TRUTH || op == NOT);
+    else if (attr_info[attr].is_string)
+        valid = (vtype == STRING);
+    else
+        valid = (vtype == NUMBER && op != EQ_CASE && op != NE_CASE);
+    if (!valid)
+        return;
+    _attr = attr;
+    if (vtype == STRING && equality) {
+        _wildcard = (svalue.find_first_of("*?[") != std::string::npos);
+        if (op == EQ || op == NE)
+            _svalue = lower_case(svalue);
+    }
+}
+
+bool
+SpecAttrTest::_compare_string(const std::string& s) const
+{
+    switch (_op) {
+        case EQ: case NE: case EQ_CASE: case NE_CASE: {
+            std::string v = (_op == EQ || _op == NE) ? lower_case(s) : s;
+            bool m = _wildcard ? wildcard_match(_svalue.c_str(), v.c_str()) : v == _svalue;
+            return (_op == NE || _op == NE_CASE) ? !m : m;
+        }
+        case GE: return s >= _svalue;
+        case GT: return s > _svalue;
+        case LE: return s <= _svalue;
+        case LT: return s < _svalue;
+        case TRUTH: return !s.empty();
+        case NOT: return s.empty();
+    }
+    return false;
+}
+
+bool
+SpecAttrTest::_compare_number(double v) const
+{
+    switch (_op) {
+        case EQ: return v == _nvalue;
+        case NE: return v != _nvalue;
+        case GE: return v >= _nvalue;
+        case GT: return v > _nvalue;
+        case LE: return v <= _nvalue;
+        case LT: return v < _nvalue;
+        case TRUTH: return v != 0;
+        case NOT: return v == 0;
+        default: return false;
+    }
+}
+
+bool
+SpecAttrTest::residue_attr() const
+{
+    return _attr >= 0 && attr_info[_attr].residue;
+}
+
+bool
+SpecAttrTest::matches(const Atom* a) const
+{
+    if (_attr < 0)
+        return false;
+    if (attr_info[_attr].is_string && _vtype != NUMBER)
+        return _compare_string(string_attr(a, _attr));
+    return _compare_number(number_attr(a, _attr));
+}
+
+// ----------------------------------------------------------------------------
+// Names are interned strings so a match is looked up by string address
+// after the first time a name is seen.
+template <class Name>
+static void
+name_mask(Atom** atoms, size_t n, const std::vector<SpecName>& parts, unsigned char* mask,
+    Name name)
+{
+    if (parts.empty()) {
+        for (size_t i = 0; i < n; ++i)
+            mask[i] = 1;
+        return;
+    }
+    std::unordered_map<const std::string*, bool> matched;
+    for (size_t i = 0; i < n; ++i) {
+        const std::string& s = name(atoms[i]);
+        auto mi = matched.find(&s);
+        if (mi == matched.end()) {
+            bool m = false;
+            for (auto& part: parts)
+                if (part.matches(s)) {
+                    m = true;
+                    break;
+                }
+            mi = matched.emplace(&s, m).first;
+        }
+        mask[i] = mi->second;
+    }
+}
+
+void
+spec_chain_mask(Atom** atoms, size_t n, const std::vector<SpecName>& parts, unsigned char* mask)
+{
+    name_mask(atoms, n, parts, mask,
+        [](const Atom* a) -> const std::string& { return a->residue()->chain_id().str(); });
+}
+
+void
+spec_atom_mask(Atom** atoms, size_t n, const std::vector<SpecName>& parts, unsigned char* mask)
+{
+    name_mask(atoms, n, parts, mask,
+        [](const Atom* a) -> const std::string& { return a->name().str(); });
+}
+
+void
+spec_residue_mask(Atom** atoms, size_t n, const std::vector<SpecResiduePart>& parts,
+    unsigned char* mask)
+{
+    if (parts.empty()) {
+        for (size_t i = 0; i < n; ++i)
+            mask[i] = 1;
+        return;
+    }
+    for (size_t i = 0; i < n; ++i)
+        mask[i] = 0;
+    std::vector<unsigned char> part_mask(n);
+    for (auto& part: parts) {
+        bool any = false;
+        if (part.has_id) {
+            for (size_t i = 0; i < n; ++i) {
+                const Residue* r = atoms[i]->residue();
+                bool m = part.id.matches(r->number(), r->insertion_code());
+                part_mask[i] = m;
+                any = any || m;
+            }
+        }
+        if (!any) {
+            // Not a residue number or no residue has that number, try as a name.
+            std::vector<SpecName> name_part(1, part.name);
+            name_mask(atoms, n, name_part, part_mask.data(),
+                [](const Atom* a) -> const std::string& { return a->residue()->name().str(); });
+        }
+        for (size_t i = 0; i < n; ++i)
+            mask[i] |= part_mask[i];
+    }
+}
+
+void
+spec_attr_mask(Atom** atoms, size_t n, const SpecAttrTest& test, unsigned char* mask)
+{
+    // Atoms of a residue are usually adjacent, test each residue once.
+    bool per_residue = test.residue_attr();
+    const Residue* last = nullptr;
+    bool last_matched = false;
+    for (size_t i = 0; i < n; ++i) {
+        if (!mask[i])
+            continue;
+        bool m;
+        if (per_residue) {
+            const Residue* r = atoms[i]->residue();
+            if (r != last) {
+                last = r;
+                last_matched = test.matches(atoms[i]);
+            }
+            m = last_matched;
+        } else
+            m = test.matches(atoms[i]);
+        if (!m)
+            mask[i] = 0;
+    }
+}
+
+}  // namespace atomstruct
@@ -0,0 +1,116 @@
+// vi: set expandtab ts=4 sw=4:
+
+/*
+ * === UCSF ChimeraX Copyright ===
+ * Copyright 2022 Regents of the University of California. All rights reserved.
+ * The ChimeraX application is provided pursuant to the ChimeraX license
+ * agreement, which covers academic and commercial uses. For more details, see
+ * <http://www.rbvi.ucsf.edu/chimerax/docs/licensing.html>
+ *
+ * This particular file is part of the ChimeraX library. You can also
+ * redistribute and/or modify it under the terms of the GNU Lesser General
+ * Public License version 2.1 as published by the Free Software Foundation.
+ * For more details, see
+ * <https://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESSED OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. ADDITIONAL LIABILITY
+ * LIMITATIONS ARE DESCRIBED IN THE GNU LESSER GENERAL PUBLIC LICENSE
+ * VERSION 2.1
+ *
+ * This notice must be embedded in or attached to all copies, including partial
+ * copies, of the software or any revisions or derivations thereof.
+ * === UCSF ChimeraX Copyright ===
+ */
+
+#ifndef atomstruct_spec_filter
+#define atomstruct_spec_filter
+
+#include <string>
+#include <vector>
+
+#include "imex.h"
+
+namespace atomstruct {
+
+class Atom;
+
+// Native evaluation of the simple terms of an atom specifier, chain ids,
+// residue numbers and names, atom names and attribute tests of atoms and
+// residues, as masks over arrays of atoms.  Names are interned, so each
+// distinct name is matched against a pattern only once.
+
+// Python fnmatch style pattern:  * ? [seq] [!seq]
+ATOMSTRUCT_IMEX bool  wildcard_match(const char* pattern, const char* name);
+
+// A name, wildcard pattern or inclusive range of names from a part list.
+// Case insensitive matching is done on lower case ASCII.
+class ATOMSTRUCT_IMEX SpecName {
+    std::string  _start, _end;
+    bool  _range, _wildcard, _case_sensitive;
+public:
+    SpecName(const std::string& start, const std::string* end, bool case_sensitive);
+    bool  matches(const std::string& name) const;
+};
+
+// A residue number with insertion code, or a range of them.  A blank
+// insertion code sorts before any other.  A missing start or end means the
+// range is open at that end.
+class ATOMSTRUCT_IMEX SpecResidueId {
+    bool  _range, _has_start, _has_end;
+    int  _start_num, _end_num;
+    int  _start_ic, _end_ic;
+public:
+    SpecResidueId() {}
+    SpecResidueId(bool has_start, int start_num, char start_ic, bool range,
+        bool has_end, int end_num, char end_ic);
+    bool  matches(int number, char insertion_code) const;
+};
+
+// A residue part is tried as a residue number and if it selects none of the
+// atoms then as a residue name.
+struct ATOMSTRUCT_IMEX SpecResiduePart {
+    bool  has_id;
+    SpecResidueId  id;
+    SpecName  name;
+};
+
+// Attribute test "name op value" of an atom or of the residue of an atom.
+// Only built-in attributes with a value of matching type are handled,
+// valid() is false for others and those are tested in Python.
+class ATOMSTRUCT_IMEX SpecAttrTest {
+public:
+    enum Op { TRUTH, NOT, EQ, NE, EQ_CASE, NE_CASE, GE, GT, LE, LT };
+    enum ValueType { NONE, STRING, NUMBER };
+    SpecAttrTest(bool residue_attr, const std::string& name, Op op, ValueType vtype,
+        const std::string& svalue, double nvalue);
+    bool  valid() const { return _attr >= 0; }
+    bool  residue_attr() const;
+    bool  matches(const Atom* a) const;
+private:
+    int  _attr;
+    Op  _op;
+    ValueType  _vtype;
+    std::string  _svalue;
+    double  _nvalue;
+    bool  _wildcard;
+    bool  _compare_string(const std::string& s) const;
+    bool  _compare_number(double v) const;
+};
+
+// Set the mask for atoms with a chain id, residue or atom name matching any
+// part, or for all atoms if there are no parts.
+ATOMSTRUCT_IMEX void  spec_chain_mask(Atom** atoms, size_t n,
+    const std::vector<SpecName>& parts, unsigned char* mask);
+ATOMSTRUCT_IMEX void  spec_residue_mask(Atom** atoms, size_t n,
+    const std::vector<SpecResiduePart>& parts, unsigned char* mask);
+ATOMSTRUCT_IMEX void  spec_atom_mask(Atom** atoms, size_t n,
+    const std::vector<SpecName>& parts, unsigned char* mask);
+// Clear the mask for atoms failing the attribute test.
+ATOMSTRUCT_IMEX void  spec_attr_mask(Atom** atoms, size_t n, const SpecAttrTest& test,
+    unsigned char* mask);
+
+}  // namespace atomstruct
+
+#endif  // atomstruct_spec_filter
@@ -0,0 +1,70 @@
+// vi: set expandtab ts=4 sw=4:
+
+/*
+ * === UCSF ChimeraX Copyright ===
+ * Copyright 2022 Regents of the University of California. All rights reserved.
+ * The ChimeraX application is provided pursuant to the ChimeraX license
+ * agreement, which covers academic and commercial uses. For more details, see
+ * <http://www.rbvi.ucsf.edu/chimerax/docs/licensing.html>
+ *
+ * This particular file is part of the ChimeraX library. You can also
+ * redistribute and/or modify it under the terms of the GNU Lesser General
+ * Public License version 2.1 as published by the Free Software Foundation.
+ * For more details, see
+ * <https://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESSED OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. ADDITIONAL LIABILITY
+ * LIMITATIONS ARE DESCRIBED IN THE GNU LESSER GENERAL PUBLIC LICENSE
+ * VERSION 2.1
+ *
+ * This notice must be embedded in or attached to all copies, including partial
+ * copies, of the software or any revisions or derivations thereof.
+ * === UCSF ChimeraX Copyright ===
+ */
+
+#include <mutex>
+#include <unordered_set>
+
+// get the symbols exported on Windows
+#define ATOMSTRUCT_EXPORT
+#include "string_types.h"
+
+namespace atomstruct {
+
+// Function statics rather than globals, since names are interned by the
+// static initializers of other files.  Node addresses in an unordered_set
+// don't change on rehash, so pointers to the strings stay valid.
+static std::unordered_set<std::string>&
+interned_strings()
+{
+    static std::unordered_set<std::string>  strings;
+    return strings;
+}
+
+static std::mutex&
+interned_strings_mutex()
+{
+    static std::mutex  mutex;
+    return mutex;
+}
+
+const std::string*
+InternedString::_intern(const char* s, std::size_t len)
+{
+    if (len == 0)
+        return nullptr;
+    std::string key(s, len);
+    std::lock_guard<std::mutex>  lock(interned_strings_mutex());
+    return &*interned_strings().insert(std::move(key)).first;
+}
+
+const std::string&
+InternedString::_empty()
+{
+    static const std::string  empty;
+    return empty;
+}
+
+}  // namespace atomstruct
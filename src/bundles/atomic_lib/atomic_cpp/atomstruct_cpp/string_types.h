@@ -27,24 +27,116 @@
 #ifndef atomstruct_string_types
 #define atomstruct_string_types
 
+#include <cstddef>		// use std::size_t
+#include <functional>		// use std::hash
+#include <ostream>		// use std::ostream
 #include <string>		// use std::string
 #include <chutil/CString.h>
 
+#include "imex.h"
+
 namespace atomstruct {
 
 using chutil::CString;
 
+// Names that repeat over and over in a structure (atom, residue and chain
+// names) are interned:  each distinct string is stored once in a global
+// table that is never shrunk, and an InternedString just points at it.
+// That makes a name 8 bytes instead of 32, and copying, equality and
+// hashing are pointer operations.  Ordering is by string value, so sorted
+// containers keep their old order.  Interning takes a lock, but reading
+// an interned name does not, so names can be used freely from threads.
+class ATOMSTRUCT_IMEX InternedString {
+    const std::string*  _str;   // null for the empty string
+
+    static const std::string*  _intern(const char* s, std::size_t len);
+    static const std::string&  _empty();
+public:
+    typedef std::string::const_iterator  const_iterator;
+    typedef std::string::size_type  size_type;
+    static const size_type  npos = std::string::npos;
+
+    InternedString(): _str(nullptr) {}
+    InternedString(const std::string& s): _str(_intern(s.data(), s.size())) {}
+    InternedString(const char* s): _str(_intern(s, std::char_traits<char>::length(s))) {}
+    InternedString(const char* s, std::size_t len): _str(_intern(s, len)) {}
+
+    const std::string&  str() const { return _str == nullptr ? _empty() : *_str; }
+    operator const std::string&() const { return str(); }
+
+    const char*  c_str() const { return str().c_str(); }
+    const char*  data() const { return str().data(); }
+    size_type  size() const { return _str == nullptr ? 0 : _str->size(); }
+    size_type  length() const { return size(); }
+    bool  empty() const { return _str == nullptr; }
+    void  clear() { _str = nullptr; }
+    char  operator[](size_type i) const { return str()[i]; }
+    char  front() const { return str().front(); }
+    char  back() const { return str().back(); }
+    const_iterator  begin() const { return str().begin(); }
+    const_iterator  end() const { return str().end(); }
+    std::string  substr(size_type pos = 0, size_type n = npos) const {
+        return str().substr(pos, n);
+    }
+    size_type  find(char c, size_type pos = 0) const { return str().find(c, pos); }
+    size_type  find(const char* s, size_type pos = 0) const { return str().find(s, pos); }
+    size_type  find(const std::string& s, size_type pos = 0) const {
+        return str().find(s, pos);
+    }
+    int  compare(const std::string& s) const { return str().compare(s); }
+    InternedString&  operator+=(const std::string& s) { return *this = str() + s; }
+    InternedString&  operator+=(char c) { return *this = str() + c; }
+
+    // identical strings always have the same address
+    bool  operator==(const InternedString& other) const { return _str == other._str; }
+    bool  operator!=(const InternedString& other) const { return _str != other._str; }
+    bool  operator<(const InternedString& other) const {
+        return _str != other._str && str() < other.str();
+    }
+    bool  operator>(const InternedString& other) const { return other < *this; }
+    bool  operator<=(const InternedString& other) const { return !(other < *this); }
+    bool  operator>=(const InternedString& other) const { return !(*this < other); }
+    std::size_t  hash() const { return std::hash<const std::string*>()(_str); }
+};
+
+inline bool operator==(const InternedString& a, const std::string& b) { return a.str() == b; }
+inline bool operator==(const std::string& a, const InternedString& b) { return a == b.str(); }
+inline bool operator==(const InternedString& a, const char* b) { return a.str() == b; }
+inline bool operator==(const char* a, const InternedString& b) { return a == b.str(); }
+inline bool operator!=(const InternedString& a, const std::string& b) { return a.str() != b; }
+inline bool operator!=(const std::string& a, const InternedString& b) { return a != b.str(); }
+inline bool operator!=(const InternedString& a, const char* b) { return a.str() != b; }
+inline bool operator!=(const char* a, const InternedString& b) { return a != b.str(); }
+inline bool operator<(const InternedString& a, const std::string& b) { return a.str() < b; }
+inline bool operator<(const std::string& a, const InternedString& b) { return a < b.str(); }
+inline std::string operator+(const InternedString& a, const std::string& b) { return a.str() + b; }
+inline std::string operator+(const std::string& a, const InternedString& b) { return a + b.str(); }
+inline std::string operator+(const InternedString& a, const char* b) { return a.str() + b; }
+inline std::string operator+(const char* a, const InternedString& b) { return a + b.str(); }
+inline std::string operator+(const InternedString& a, char b) { return a.str() + b; }
+inline std::string operator+(char a, const InternedString& b) { return a + b.str(); }
+inline std::ostream& operator<<(std::ostream& os, const InternedString& s) { return os << s.str(); }
+
 // len param includes null
 #if 0
 typedef CString<5, 'A', 't', 'o', 'm', ' ', 'N', 'a', 'm', 'e'>  AtomName; // if changed to string,
 #else
-typedef std::string AtomName;
+typedef InternedString AtomName;
 #endif
 // pdb reader's canonicalize_atom_name needs to be changed accordingly
 typedef CString<5, 'A', 't', 'o', 'm', ' ', 'T', 'y', 'p', 'e'>  AtomType;
-typedef std::string ChainID;
-typedef std::string ResName;
+typedef InternedString ChainID;
+typedef InternedString ResName;
 
 }  // namespace atomstruct
 
+namespace std {
+
+template <> struct hash<atomstruct::InternedString>
+{
+    size_t operator()(const atomstruct::InternedString& s) const { return s.hash(); }
+};
+
+}  // namespace std
+
 #endif  // atomstruct_string_types
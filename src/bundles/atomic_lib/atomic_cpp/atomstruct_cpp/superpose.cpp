@@ -0,0 +1,347 @@
+// vi: set expandtab ts=4 sw=4:
+
+/*
+ * === UCSF ChimeraX Copyright ===
+ * Copyright 2022 Regents of the University of California. All rights reserved.
+ * The ChimeraX application is provided pursuant to the ChimeraX license
+ * agreement, which covers academic and commercial uses. For more details, see
+ * <http://www.rbvi.ucsf.edu/chimerax/docs/licensing.html>
+ *
+ * This particular file is part of the ChimeraX library. You can also
+ * redistribute and/or modify it under the terms of the GNU Lesser General
+ * Public License version 2.1 as published by the Free Software Foundation.
+ * For more details, see
+ * <https://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESSED OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. ADDITIONAL LIABILITY
+ * LIMITATIONS ARE DESCRIBED IN THE GNU LESSER GENERAL PUBLIC LICENSE
+ * VERSION 2.1
+ *
+ * This notice must be embedded in or attached to all copies, including partial
+ * copies, of the software or any revisions or derivations thereof.
+ * === UCSF ChimeraX Copyright ===
+ */
+
+#include <algorithm>    // for std::fill
+#include <cmath>        // for std::sqrt, std::fabs
+#include <exception>    // for std::exception_ptr
+#include <mutex>
+#include <vector>
+
+#include <arrays/threadpool.h>    // Uses Thread_Pool::parallel_for()
+
+#define ATOMSTRUCT_EXPORT
+#include "Atom.h"
+#include "CoordSet.h"
+#include "superpose.h"
+
+namespace atomstruct {
+
+Real
+qcp_rmsd(const Real* a, Real ga, const Real* b, Real gb, size_t n, Real* rotation)
+{
+    if (n == 0) {
+        if (rotation) {
+            std::fill(rotation, rotation + 9, 0.0);
+            rotation[0] = rotation[4] = rotation[8] = 1.0;
+        }
+        return 0.0;
+    }
+
+    // Inner product matrix, separate sums so the loop vectorizes.
+    Real sxx = 0, sxy = 0, sxz = 0, syx = 0, syy = 0, syz = 0, szx = 0, szy = 0, szz = 0;
+    for (size_t i = 0; i < n; ++i) {
+        const Real *p = a + 3*i, *q = b + 3*i;
+        sxx += p[0]*q[0]; sxy += p[0]*q[1]; sxz += p[0]*q[2];
+        syx += p[1]*q[0]; syy += p[1]*q[1]; syz += p[1]*q[2];
+        szx += p[2]*q[0]; szy += p[2]*q[1]; szz += p[2]*q[2];
+    }
+    Real e0 = 0.5 * (ga + gb);
+
+    // Coefficients of the characteristic polynomial of the key matrix.
+    Real sxx2 = sxx*sxx, syy2 = syy*syy, szz2 = szz*szz;
+    Real sxy2 = sxy*sxy, syz2 = syz*syz, sxz2 = sxz*sxz;
+    Real syx2 = syx*syx, szy2 = szy*szy, szx2 = szx*szx;
+    Real syzszymsyyszz2 = 2.0 * (syz*szy - syy*szz);
+    Real sxx2syy2szz2syz2szy2 = syy2 + szz2 - sxx2 + syz2 + szy2;
+    Real c2 = -2.0 * (sxx2 + syy2 + szz2 + sxy2 + syx2 + sxz2 + szx2 + syz2 + szy2);
+    Real c1 = 8.0 * (sxx*syz*szy + syy*szx*sxz + szz*sxy*syx
+        - sxx*syy*szz - syz*szx*sxy - szy*syx*sxz);
+    Real sxzpszx = sxz + szx, syzpszy = syz + szy, sxypsyx = sxy + syx;
+    Real syzmszy = syz - szy, sxzmszx = sxz - szx, sxymsyx = sxy - syx;
+    Real sxxpsyy = sxx + syy, sxxmsyy = sxx - syy;
+    Real sxy2sxz2syx2szx2 = sxy2 + sxz2 - syx2 - szx2;
+    Real c0 = sxy2sxz2syx2szx2 * sxy2sxz2syx2szx2
+        + (sxx2syy2szz2syz2szy2 + syzszymsyyszz2) * (sxx2syy2szz2syz2szy2 - syzszymsyyszz2)
+        + (-sxzpszx*syzmszy + sxymsyx*(sxxmsyy - szz)) * (-sxzmszx*syzpszy + sxymsyx*(sxxmsyy + szz))
+        + (-sxzpszx*syzpszy - sxypsyx*(sxxpsyy - szz)) * (-sxzmszx*syzmszy - sxypsyx*(sxxpsyy + szz))
+        + (sxypsyx*syzpszy + sxzpszx*(sxxmsyy + szz)) * (-sxymsyx*syzmszy + sxzpszx*(sxxpsyy + szz))
+        + (sxypsyx*syzmszy + sxzmszx*(sxxmsyy - szz)) * (-sxymsyx*syzpszy + sxzmszx*(sxxpsyy - szz));
+
+    // Newton iteration for the largest eigenvalue starting from its upper bound.
+    Real lambda = e0;
+    for (int i = 0; i < 50; ++i) {
+        Real old = lambda;
+        Real x2 = lambda * lambda;
+        Real bb = (x2 + c2) * lambda;
+        Real aa = bb + c1;
+        Real denom = 2.0 * x2 * lambda + bb + aa;
+        if (denom == 0.0)
+            break;
+        lambda -= (aa * lambda + c0) / denom;
+        if (std::fabs(lambda - old) < std::fabs(1e-11 * lambda))
+            break;
+    }
+    Real rmsd = std::sqrt(std::fabs(2.0 * (e0 - lambda) / n));
+    if (rotation == nullptr)
+        return rmsd;
+
+    // Eigenvector from a column of the adjoint of the shifted key matrix,
+    // trying other columns if one is degenerate.
+    Real a11 = sxxpsyy + szz - lambda, a12 = syzmszy, a13 = -sxzmszx, a14 = sxymsyx;
+    Real a21 = syzmszy, a22 = sxxmsyy - szz - lambda, a23 = sxypsyx, a24 = sxzpszx;
+    Real a31 = a13, a32 = a23, a33 = syy - sxx - szz - lambda, a34 = syzpszy;
+    Real a41 = a14, a42 = a24, a43 = a34, a44 = szz - sxxpsyy - lambda;
+    Real a3344_4334 = a33*a44 - a43*a34, a3244_4234 = a32*a44 - a42*a34;
+    Real a3243_4233 = a32*a43 - a42*a33, a3143_4133 = a31*a43 - a41*a33;
+    Real a3144_4134 = a31*a44 - a41*a34, a3142_4132 = a31*a42 - a41*a32;
+    Real q1 = a22*a3344_4334 - a23*a3244_4234 + a24*a3243_4233;
+    Real q2 = -a21*a3344_4334 + a23*a3144_4134 - a24*a3143_4133;
+    Real q3 = a21*a3244_4234 - a22*a3144_4134 + a24*a3142_4132;
+    Real q4 = -a21*a3243_4233 + a22*a3143_4133 - a23*a3142_4132;
+    Real qsqr = q1*q1 + q2*q2 + q3*q3 + q4*q4;
+    const Real evecprec = 1e-6;
+    if (qsqr < evecprec) {
+        q1 = a12*a3344_4334 - a13*a3244_4234 + a14*a3243_4233;
+        q2 = -a11*a3344_4334 + a13*a3144_4134 - a14*a3143_4133;
+        q3 = a11*a3244_4234 - a12*a3144_4134 + a14*a3142_4132;
+        q4 = -a11*a3243_4233 + a12*a3143_4133 - a13*a3142_4132;
+        qsqr = q1*q1 + q2*q2 + q3*q3 + q4*q4;
+        if (qsqr < evecprec) {
+            Real a1324_1423 = a13*a24 - a14*a23, a1224_1422 = a12*a24 - a14*a22;
+            Real a1223_1322 = a12*a23 - a13*a22, a1124_1421 = a11*a24 - a14*a21;
+            Real a1123_1321 = a11*a23 - a13*a21, a1122_1221 = a11*a22 - a12*a21;
+            q1 = a42*a1324_1423 - a43*a1224_1422 + a44*a1223_1322;
+            q2 = -a41*a1324_1423 + a43*a1124_1421 - a44*a1123_1321;
+            q3 = a41*a1224_1422 - a42*a1124_1421 + a44*a1122_1221;
+            q4 = -a41*a1223_1322 + a42*a1123_1321 - a43*a1122_1221;
+            qsqr = q1*q1 + q2*q2 + q3*q3 + q4*q4;
+            if (qsqr < evecprec) {
+                q1 = a32*a1324_1423 - a33*a1224_1422 + a34*a1223_1322;
+                q2 = -a31*a1324_1423 + a33*a1124_1421 - a34*a1123_1321;
+                q3 = a31*a1224_1422 - a32*a1124_1421 + a34*a1122_1221;
+                q4 = -a31*a1223_1322 + a32*a1123_1321 - a33*a1122_1221;
+                qsqr = q1*q1 + q2*q2 + q3*q3 + q4*q4;
+                if (qsqr < evecprec) {
+                    // Coordinates are already superposed.
+                    std::fill(rotation, rotation + 9, 0.0);
+                    rotation[0] = rotation[4] = rotation[8] = 1.0;
+                    return rmsd;
+                }
+            }
+        }
+    }
+    Real norm = std::sqrt(qsqr);
+    q1 /= norm; q2 /= norm; q3 /= norm; q4 /= norm;
+    Real qa2 = q1*q1, x2 = q2*q2, y2 = q3*q3, z2 = q4*q4;
+    Real xy = q2*q3, az = q1*q4, zx = q4*q2, ay = q1*q3, yz = q3*q4, ax = q1*q2;
+    Real* r = rotation;
+    r[0] = qa2 + x2 - y2 - z2; r[1] = 2*(xy + az);        r[2] = 2*(zx - ay);
+    r[3] = 2*(xy - az);        r[4] = qa2 - x2 + y2 - z2; r[5] = 2*(yz + ax);
+    r[6] = 2*(zx + ay);        r[7] = 2*(yz - ax);        r[8] = qa2 - x2 - y2 + z2;
+    return rmsd;
+}
+
+// Move n by 3 coordinates to be centered at the origin, returning the sum of
+// squared centered coordinates.
+static Real
+center(Real* xyz, size_t n, Real* centroid)
+{
+    Real c[3] = {0, 0, 0};
+    for (size_t i = 0; i < n; ++i)
+        for (int a = 0; a < 3; ++a)
+            c[a] += xyz[3*i+a];
+    for (int a = 0; a < 3; ++a)
+        c[a] = (n > 0 ? c[a] / n : 0);
+    Real g = 0;
+    for (size_t i = 0; i < n; ++i)
+        for (int a = 0; a < 3; ++a) {
+            Real x = (xyz[3*i+a] -= c[a]);
+            g += x*x;
+        }
+    if (centroid)
+        for (int a = 0; a < 3; ++a)
+            centroid[a] = c[a];
+    return g;
+}
+
+static Real
+plain_rmsd(const Real* a, const Real* b, size_t n)
+{
+    Real d2 = 0;
+    for (size_t i = 0; i < 3*n; ++i) {
+        Real d = a[i] - b[i];
+        d2 += d*d;
+    }
+    return (n > 0 ? std::sqrt(d2 / n) : 0.0);
+}
+
+// Keep the first exception thrown by a worker thread, such as a trajectory
+// file read error, to rethrow in the calling thread.
+class First_Error {
+public:
+    template <class F> void  guard(F f) {
+        try {
+            f();
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (!_error)
+                _error = std::current_exception();
+        }
+    }
+    void  rethrow() { if (_error) std::rethrow_exception(_error); }
+private:
+    std::exception_ptr  _error;
+    std::mutex  _mutex;
+};
+
+// Centered reference coordinates shared by all frames.
+struct Reference {
+    std::vector<Real> xyz;
+    Real centroid[3], g;
+    Reference(const Real* ref, size_t n, bool superpose) : xyz(ref, ref + 3*n), g(0) {
+        centroid[0] = centroid[1] = centroid[2] = 0;
+        if (superpose)
+            g = center(xyz.data(), n, centroid);
+    }
+};
+
+// Superpose frame coordinates onto the reference in place if superpose is
+// true, setting the 3x4 transform if not null, and return the RMSD.
+static Real
+fit_frame(Real* xyz, size_t n, const Reference& ref, bool superpose, Real* transform)
+{
+    if (!superpose) {
+        if (transform) {
+            std::fill(transform, transform + 12, 0.0);
+            transform[0] = transform[5] = transform[10] = 1.0;
+        }
+        return plain_rmsd(ref.xyz.data(), xyz, n);
+    }
+    Real c[3], r[9];
+    Real g = center(xyz, n, c);
+    Real rmsd = qcp_rmsd(ref.xyz.data(), ref.g, xyz, g, n, r);
+    for (size_t i = 0; i < n; ++i) {
+        Real* p = xyz + 3*i;
+        Real x = p[0], y = p[1], z = p[2];
+        for (int a = 0; a < 3; ++a)
+            p[a] = r[3*a]*x + r[3*a+1]*y + r[3*a+2]*z + ref.centroid[a];
+    }
+    if (transform)
+        for (int a = 0; a < 3; ++a) {
+            for (int b = 0; b < 3; ++b)
+                transform[4*a+b] = r[3*a+b];
+            transform[4*a+3] = ref.centroid[a]
+                - (r[3*a]*c[0] + r[3*a+1]*c[1] + r[3*a+2]*c[2]);
+        }
+    return rmsd;
+}
+
+void
+coordset_rmsds(const std::vector<const CoordSet*>& frames, const std::vector<size_t>& indices,
+    const Real* reference, bool superpose, Real* rmsds, Real* transforms)
+{
+    size_t n = indices.size();
+    Reference ref(reference, n, superpose);
+    First_Error error;
+    Thread_Pool::parallel_for(frames.size(), [&](int64_t f0, int64_t f1) {
+        error.guard([&] {
+            std::vector<Real> xyz(3*n);
+            for (int64_t f = f0; f < f1; ++f) {
+                frames[f]->copy_xyz(indices, xyz.data());
+                rmsds[f] = fit_frame(xyz.data(), n, ref, superpose,
+                    transforms ? transforms + 12*f : nullptr);
+            }
+        });
+    }, 4);
+    error.rethrow();
+}
+
+void
+coordset_rmsf(const std::vector<const CoordSet*>& frames, const std::vector<size_t>& indices,
+    const Real* reference, bool superpose, Real* rmsf)
+{
+    // Each thread sums positions and squared positions for its frames.
+    size_t n = indices.size();
+    int64_t nf = frames.size();
+    Reference ref(reference, n, superpose);
+    int nt = Thread_Pool::thread_count(nf, 4);
+    std::vector<std::vector<Real>> sums(nt, std::vector<Real>(3*n, 0.0)), sums2 = sums;
+    First_Error error;
+    Thread_Pool::run(nt, [&](int t) {
+        error.guard([&] {
+            std::vector<Real> xyz(3*n), &s = sums[t], &s2 = sums2[t];
+            for (int64_t f = (nf*t)/nt; f < (nf*(t+1))/nt; ++f) {
+                frames[f]->copy_xyz(indices, xyz.data());
+                fit_frame(xyz.data(), n, ref, superpose, nullptr);
+                for (size_t i = 0; i < 3*n; ++i) {
+                    s[i] += xyz[i];
+                    s2[i] += xyz[i]*xyz[i];
+                }
+            }
+        });
+    });
+    error.rethrow();
+    for (size_t i = 0; i < n; ++i) {
+        Real v = 0;
+        for (int a = 0; a < 3; ++a) {
+            Real s = 0, s2 = 0;
+            for (int t = 0; t < nt; ++t) {
+                s += sums[t][3*i+a];
+                s2 += sums2[t][3*i+a];
+            }
+            Real mean = (nf > 0 ? s / nf : 0);
+            v += (nf > 0 ? s2 / nf : 0) - mean*mean;
+        }
+        rmsf[i] = std::sqrt(std::max<Real>(v, 0.0));
+    }
+}
+
+void
+coordset_rmsd_matrix(const std::vector<const CoordSet*>& frames, const std::vector<size_t>& indices,
+    bool superpose, Real* matrix)
+{
+    // Expand all frames once, centered if superposing.
+    size_t n = indices.size();
+    int64_t nf = frames.size();
+    std::vector<Real> xyz(3*n*nf), g(nf, 0.0);
+    First_Error error;
+    Thread_Pool::parallel_for(nf, [&](int64_t f0, int64_t f1) {
+        error.guard([&] {
+            for (int64_t f = f0; f < f1; ++f) {
+                Real* fxyz = xyz.data() + 3*n*f;
+                frames[f]->copy_xyz(indices, fxyz);
+                if (superpose)
+                    g[f] = center(fxyz, n, nullptr);
+            }
+        });
+    }, 4);
+    error.rethrow();
+
+    // Rows have decreasing numbers of pairs, so hand them out one at a time.
+    Thread_Pool::parallel_for(nf, [&](int64_t i0, int64_t i1) {
+        for (int64_t i = i0; i < i1; ++i) {
+            const Real* a = xyz.data() + 3*n*i;
+            matrix[nf*i+i] = 0;
+            for (int64_t j = i+1; j < nf; ++j) {
+                const Real* b = xyz.data() + 3*n*j;
+                Real d = (superpose ? qcp_rmsd(a, g[i], b, g[j], n) : plain_rmsd(a, b, n));
+                matrix[nf*i+j] = matrix[nf*j+i] = d;
+            }
+        }
+    });
+}
+
+}  // namespace atomstruct
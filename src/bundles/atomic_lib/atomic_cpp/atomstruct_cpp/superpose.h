@@ -0,0 +1,72 @@
+// vi: set expandtab ts=4 sw=4:
+
+/*
+ * === UCSF ChimeraX Copyright ===
+ * Copyright 2022 Regents of the University of California. All rights reserved.
+ * The ChimeraX application is provided pursuant to the ChimeraX license
+ * agreement, which covers academic and commercial uses. For more details, see
+ * <http://www.rbvi.ucsf.edu/chimerax/docs/licensing.html>
+ *
+ * This particular file is part of the ChimeraX library. You can also
+ * redistribute and/or modify it under the terms of the GNU Lesser General
+ * Public License version 2.1 as published by the Free Software Foundation.
+ * For more details, see
+ * <https://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESSED OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. ADDITIONAL LIABILITY
+ * LIMITATIONS ARE DESCRIBED IN THE GNU LESSER GENERAL PUBLIC LICENSE
+ * VERSION 2.1
+ *
+ * This notice must be embedded in or attached to all copies, including partial
+ * copies, of the software or any revisions or derivations thereof.
+ * === UCSF ChimeraX Copyright ===
+ */
+
+#ifndef atomstruct_superpose
+#define atomstruct_superpose
+
+#include <vector>
+
+#include "imex.h"
+#include "Real.h"
+
+namespace atomstruct {
+
+class CoordSet;
+
+// Least squares superposition by the quaternion characteristic polynomial
+// (QCP) method of Theobald (2005) and Liu, Agrafiotis and Theobald (2010).
+// The largest eigenvalue of the 4x4 key matrix is found by Newton iteration
+// instead of diagonalizing, so the RMSD costs little more than the 3x3
+// inner product matrix.
+//
+// The n by 3 arrays a and b must be centered at the origin, and ga and gb are
+// the sums of their squared coordinates.  If rotation is not null, the 3x3
+// row major rotation taking b onto a is set.
+ATOMSTRUCT_IMEX Real  qcp_rmsd(const Real* a, Real ga, const Real* b, Real gb, size_t n,
+    Real* rotation = nullptr);
+
+// Trajectory analysis over coordsets of one structure using the coordinates
+// with the given indices.  Frames are handled in parallel and compressed or
+// trajectory file coordsets are expanded one frame at a time per thread
+// without being kept expanded.
+//
+// RMSD of each frame to the n by 3 reference coordinates, after optimal
+// superposition if superpose is true.  If transforms is not null, a 3x4 row
+// major matrix per frame moving the frame onto the reference is set.
+ATOMSTRUCT_IMEX void  coordset_rmsds(const std::vector<const CoordSet*>& frames,
+    const std::vector<size_t>& indices, const Real* reference, bool superpose,
+    Real* rmsds, Real* transforms = nullptr);
+// Root mean square fluctuation of each coordinate about its mean position,
+// with each frame first superposed onto the reference if superpose is true.
+ATOMSTRUCT_IMEX void  coordset_rmsf(const std::vector<const CoordSet*>& frames,
+    const std::vector<size_t>& indices, const Real* reference, bool superpose, Real* rmsf);
+// Symmetric matrix of RMSD between each pair of frames.
+ATOMSTRUCT_IMEX void  coordset_rmsd_matrix(const std::vector<const CoordSet*>& frames,
+    const std::vector<size_t>& indices, bool superpose, Real* matrix);
+
+}  // namespace atomstruct
+
+#endif  // atomstruct_superpose
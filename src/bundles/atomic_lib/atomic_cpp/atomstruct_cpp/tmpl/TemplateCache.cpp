@@ -50,22 +50,20 @@ using atomstruct::ResName;
 
 using namespace ioutil;
 
-TemplateCache *TemplateCache::_instance = nullptr;
 std::string TemplateCache::_template_dir;
 std::string TemplateCache::_user_template_dir;
 
 TemplateCache *
 TemplateCache::template_cache()
 {
-    if (_instance == nullptr) {
-        _instance = new TemplateCache;
-    }
-    return _instance;
+    // initialization of a function static is thread-safe
+    static TemplateCache *instance = new TemplateCache;
+    return instance;
 }
 
-TemplateCache::AtomMap *
-TemplateCache::res_template(ResName res_name, const char *app,
-            const char *template_dir, const char *extension)
+TemplateCache::ResMap &
+TemplateCache::template_type(const char *app, const char *template_dir,
+            const char *extension)
 {
     std::string key;
     key = app;
@@ -73,11 +71,42 @@ TemplateCache::res_template(ResName res_name, const char *app,
     key += template_dir;
     key += '\001';
     key += extension;
-    if (cache.find(key) == cache.end()) {
-        // haven't looked this kind of template type up before
-        cache_template_type(key, app, template_dir, extension);
+    for (auto tt = _types.load(std::memory_order_acquire); tt != nullptr; tt = tt->next)
+        if (tt->key == key)
+            return tt->res_map;
+
+    // haven't looked this kind of template type up before;
+    // read it while holding the lock so it is read only once
+    std::lock_guard<std::mutex> lock(_read_mutex);
+    TemplateType *head = _types.load(std::memory_order_acquire);
+    for (auto tt = head; tt != nullptr; tt = tt->next)
+        if (tt->key == key)
+            return tt->res_map;
+    TemplateType *tt = new TemplateType;
+    tt->key = key;
+    try {
+        cache_template_type(tt->res_map, app, template_dir, extension);
+    } catch (...) {
+        delete tt;
+        throw;
     }
-    ResMap &rm = cache[key];
+    tt->next = head;
+    _types.store(tt, std::memory_order_release);
+    return tt->res_map;
+}
+
+void
+TemplateCache::preload(const char *app, const char *template_dir,
+            const char *extension)
+{
+    (void) template_type(app, template_dir, extension);
+}
+
+TemplateCache::AtomMap *
+TemplateCache::res_template(ResName res_name, const char *app,
+            const char *template_dir, const char *extension)
+{
+    ResMap &rm = template_type(app, template_dir, extension);
     ResMap::iterator rmi = rm.find(res_name);
     if (rmi == rm.end()) {
         std::ostringstream os;
@@ -109,12 +138,9 @@ path_join(std::initializer_list<std::string> path_components)
 }
 
 void
-TemplateCache::cache_template_type(std::string &key, const char *app,
+TemplateCache::cache_template_type(ResMap &res_map, const char *app,
             const char *template_dir, const char *extension)
 {
-    ResMap res_map;
-    cache[key] = res_map;
-
     std::vector<std::string> search_dirs = { _user_template_dir, _template_dir };
     for (auto search_dir: search_dirs) {
         std::string t_dir = path_join({ search_dir, app, template_dir });
@@ -175,7 +201,6 @@ TemplateCache::cache_template_type(std::string &key, const char *app,
         }
         closedir(tmpls);
     }
-    cache[key] = res_map;
 }
 
 
@@ -234,16 +259,19 @@ TemplateCache::parse_template_file(std::ifstream &template_file, std::string &pa
 
 TemplateCache::~TemplateCache()
 {
-    for (std::map<std::string, ResMap>::iterator ci = cache.begin();
-    ci != cache.end(); ++ci) {
-        for (ResMap::iterator rmi = (*ci).second.begin();
-        rmi != (*ci).second.end(); ++rmi) {
+    TemplateType *tt = _types.load();
+    while (tt != nullptr) {
+        for (ResMap::iterator rmi = tt->res_map.begin();
+        rmi != tt->res_map.end(); ++rmi) {
             for (AtomMap::iterator ami = (*rmi).second.begin();
             ami != (*rmi).second.end(); ++ami) {
                 // free ConditionalTemplate pointers
                 delete (*ami).second.second;
             }
         }
+        TemplateType *next = tt->next;
+        delete tt;
+        tt = next;
     }
 }
 
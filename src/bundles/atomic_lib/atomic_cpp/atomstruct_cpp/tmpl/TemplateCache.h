@@ -27,9 +27,12 @@
 #ifndef templates_TemplateCache
 #define templates_TemplateCache
 
+#include <atomic>
 #include <vector>
 #include <map>
+#include <mutex>
 #include <string>
+#include <unordered_map>
 #include "../imex.h"
 #include "../string_types.h"
 
@@ -61,8 +64,14 @@ public:
         // atom name -> AtomMappings
     typedef std::map<ResName, AtomMap> ResMap;
         // res name -> AtomMap
+    // Safe to use from multiple threads.  The template files of a type
+    // are read once on first use and the templates are not changed after
+    // that, so looking them up takes no lock.
     AtomMap *res_template(ResName res_name, const char *app,
             const char *template_dir, const char *extension);
+    // Read the templates of a type now if not already read, so threads
+    // using them later don't wait for the files to be read.
+    void preload(const char *app, const char *template_dir, const char *extension);
     static void set_templates_dir(const std::string& template_dir) { _template_dir = template_dir; }
     static void set_user_templates_dir(const std::string& template_dir) { _user_template_dir = template_dir; }
     virtual ~TemplateCache();
@@ -72,12 +81,47 @@ protected:
 private:
     static std::string _template_dir;
     static std::string _user_template_dir;
-    std::map<std::string, ResMap> cache;
-        // searchpath/extension -> resMap
-    void cache_template_type(std::string &key, const char *app,
+    struct TemplateType {
+        std::string key;        // app/searchpath/extension
+        ResMap res_map;
+        TemplateType *next;
+    };
+    std::atomic<TemplateType *> _types{nullptr};
+        // template types read so far, newest first, each published complete
+    std::mutex _read_mutex;
+    ResMap &template_type(const char *app, const char *template_dir,
+            const char *extension);
+    void cache_template_type(ResMap &res_map, const char *app,
             const char *template_dir, const char *extension);
     AtomMap parse_template_file(std::ifstream &, std::string &);
-    static TemplateCache *_instance;
+};
+
+// Process-wide cache of results computed for a residue (e.g. IDATM types,
+// rings) keyed by atomstruct::Residue::connectivity_key(), so that the many
+// identical standard residues in the structures of a session are computed once.
+// Safe to use from multiple threads.  Stops adding results once full so that
+// unusual residues can't grow it without bound.
+template <class Result>
+class ResidueResultCache {
+    std::unordered_map<std::string, Result>  _cache;
+    size_t  _max_size;
+    mutable std::mutex  _mutex;
+public:
+    ResidueResultCache(size_t max_size = 20000): _max_size(max_size) {}
+    void  clear() { std::lock_guard<std::mutex> lock(_mutex); _cache.clear(); }
+    bool  find(const std::string& key, Result* result) const {
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto ci = _cache.find(key);
+        if (ci == _cache.end())
+            return false;
+        *result = ci->second;
+        return true;
+    }
+    void  insert(const std::string& key, const Result& result) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_cache.size() < _max_size)
+            _cache.emplace(key, result);
+    }
 };
 
 #endif  // templates_TemplateCache
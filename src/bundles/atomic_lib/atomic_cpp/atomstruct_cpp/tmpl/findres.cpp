@@ -25,6 +25,8 @@
  */
 
 #define ATOMSTRUCT_EXPORT
+#include <mutex>
+
 #include "residues.h"
 #include "resinternal.h"
 
@@ -41,6 +43,7 @@ extern void    restmpl_init_ions(ResInitMap *);
 
 static Molecule    *start_mol = NULL, *middle_mol, *end_mol;
 static ResInitMap    resmap;
+static std::mutex    template_mutex;  // templates are made on first use
 
 void
 restmpl_init()
@@ -74,6 +77,7 @@ find_template_residue(const ResName& name, bool start, bool end)
     bool new_r = false;
     ResName mapped_name = name;
 
+    std::lock_guard<std::mutex> lock(template_mutex);
     if (start_mol == NULL)
         restmpl_init();
 
@@ -38,6 +38,7 @@ namespace tmpl {
 
 using atomstruct::ResName;
 
+// Safe to call from multiple threads.
 ATOMSTRUCT_IMEX extern const Residue *
     find_template_residue(const ResName& name, bool start, bool end);
 
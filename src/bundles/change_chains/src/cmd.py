@@ -59,44 +59,25 @@ def cmd_change_chains(session, residues, from_ids, to_ids=None):
             else:
                 chain_mapping[from_id] = to_id
 
-    # verify no conflicts before making actual changes
+    # verify no conflicts before making actual changes, checking in C++ for all
+    # structures before changing any
     change_info = []
-    if to_ids is None:
-        remapped_chain_id = from_ids[0]
     for s, s_residues in residues.by_structure:
-        proposed_changes = set()
-        changed_residues = set()
-        for r in s_residues:
-            if to_ids is None:
-                if r.chain_id == remapped_chain_id:
-                    continue
-            else:
-                try:
-                    remapped_chain_id = chain_mapping[r.chain_id]
-                except KeyError:
-                    continue
-            change = (remapped_chain_id, r.number, r.insertion_code)
-            if change in proposed_changes:
-                raise UserError("Proposed chain ID change would produce multiple residues with the same"
-                    "chain-ID/number/insertion-code combo (%s/%d/%s)" % change)
-            proposed_changes.add((remapped_chain_id, r.number, r.insertion_code))
-            changed_residues.add(r)
-            change_info.append((r, remapped_chain_id))
-        # check for conflicts
-        for r in s.residues:
-            if r in changed_residues:
-                continue
-            if (r.chain_id, r.number, r.insertion_code) in proposed_changes:
-                from chimerax.core.errors import UserError
-                raise UserError("Proposed chainID change conflicts with existing residue %s" % r)
-    # apply changes
-    for r, cid in change_info:
-        if r.chain_id != cid:
-            if r.chain:
-                r.chain.chain_id = cid
-            else:
-                r.chain_id = cid
-    session.logger.info("Chain IDs of %d residues changed" % len(change_info))
+        if to_ids is None:
+            s_ids = [from_ids[0]] * len(s_residues)
+        else:
+            s_ids = [chain_mapping.get(cid, cid) for cid in s_residues.chain_ids]
+        try:
+            s.set_residue_chain_ids(s_residues, s_ids, check_only=True)
+        except ValueError as e:
+            raise UserError(str(e))
+        change_info.append((s, s_residues, s_ids))
+    # apply changes, one bulk update per structure
+    num_changed = 0
+    for s, s_residues, s_ids in change_info:
+        num_changed += (s_residues.chain_ids != s_ids).sum()
+        s.set_residue_chain_ids(s_residues, s_ids)
+    session.logger.info("Chain IDs of %d residues changed" % num_changed)
 
 def cmd_change_glys(session, chains=None):
     from chimerax.core.errors import UserError
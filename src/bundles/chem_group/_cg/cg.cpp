@@ -25,17 +25,16 @@
 #include <Python.h>
 #include <algorithm>  // std::find, std::min
 #include <arrays/pythonarray.h>	// use python_voidp_array
+#include <arrays/threadpool.h>	// use Thread_Pool::parallel_for
 #include <atomstruct/Atom.h>
 #include <atomstruct/AtomicStructure.h>
 #include <cstring>
 #include <element/Element.h>
 #include <functional>
 #include <map>
-#include <mutex>
 #include <pysupport/convert.h>
 #include <set>
 #include <sstream>
-#include <thread>
 #include <typeinfo>
 #include <vector>
 
@@ -756,54 +755,102 @@ make_condition(PyObject* group_rep)
 	return cond;
 }
 
-static void
-initiate_find_group(CG_Condition* group_rep, std::vector<long>* group_principals,
-	AtomicStructure::Atoms::const_iterator start, AtomicStructure::Atoms::const_iterator end,
-	std::vector<Group>* groups, std::mutex* groups_mutex)
+typedef AtomicStructure::Atoms::const_iterator Atoms_Iter;
+
+// finder(start, end, groups) appends the groups it finds for pattern i among
+// the atoms [start, end) to groups[i]
+typedef std::function<void(Atoms_Iter, Atoms_Iter, std::vector<Group>*)> Chunk_Finder;
+
+static const size_t  ATOMS_PER_CHUNK = 64;
+
+// Threads claim small chunks of atoms as they go (Thread_Pool::parallel_for)
+// rather than each getting one fixed share of the atoms, so that a thread
+// whose share happens to hold the expensive atoms (e.g. those of a large
+// ligand) doesn't leave the others idle.  A chunk's groups are kept separately
+// and the chunks joined in atom order, so the results don't depend on the
+// number of threads and no locking is needed.
+static std::vector<std::vector<Group>>
+find_in_chunks(const AtomicStructure::Atoms& atoms, unsigned int num_cpus,
+	size_t num_patterns, const Chunk_Finder& finder)
 {
-	for (auto i = start; i != end; ++i) {
-		auto a = *i;
+	size_t num_chunks = (atoms.size() + ATOMS_PER_CHUNK - 1) / ATOMS_PER_CHUNK;
+	std::vector<std::vector<Group>> chunk_groups(num_chunks * num_patterns);
+	Thread_Pool::parallel_for(atoms.size(), [&](int64_t i0, int64_t i1) {
+			finder(atoms.begin() + i0, atoms.begin() + i1,
+				&chunk_groups[(i0 / ATOMS_PER_CHUNK) * num_patterns]);
+		}, ATOMS_PER_CHUNK, num_cpus > 1 ? num_cpus : 1);
+
+	std::vector<std::vector<Group>> groups(num_patterns);
+	for (size_t p = 0; p < num_patterns; ++p) {
+		size_t num_groups = 0;
+		for (size_t c = 0; c < num_chunks; ++c)
+			num_groups += chunk_groups[c * num_patterns + p].size();
+		groups[p].reserve(num_groups);
+		for (size_t c = 0; c < num_chunks; ++c)
+			for (auto& grp: chunk_groups[c * num_patterns + p])
+				groups[p].emplace_back(std::move(grp));
+	}
+	return groups;
+}
+
+static std::vector<Group>
+find_in_chunks(const AtomicStructure::Atoms& atoms, unsigned int num_cpus, const Chunk_Finder& finder)
+{
+	return std::move(find_in_chunks(atoms, num_cpus, 1, finder)[0]);
+}
 
-		for (auto raw_group: group_rep->trace_group(a)) {
-			// check rings, reduce to principals, and add group with locking
-			std::map<long, const Atom*> ring_atom_map;
-			Group pruned;
-			bool rings_okay = true;
-			auto group_size = raw_group.size();
-			for (Group::size_type i = 0; i < group_size; ++i) {
-				auto principal = (*group_principals)[i];
-				auto group_atom = raw_group[i];
-				if (principal != 0) {
-					if (group_atom == nullptr) {
-						// missing-structure can't actually be part of returned
-						// group; disallow/abort by setting rings_okay false
+static void
+add_traced_groups(CG_Condition* group_rep, const std::vector<long>& group_principals,
+	const Atom* a, std::vector<Group>* groups)
+{
+	for (auto raw_group: group_rep->trace_group(a)) {
+		// check rings, reduce to principals, and add group
+		std::map<long, const Atom*> ring_atom_map;
+		Group pruned;
+		bool rings_okay = true;
+		auto group_size = raw_group.size();
+		for (Group::size_type i = 0; i < group_size; ++i) {
+			auto principal = group_principals[i];
+			auto group_atom = raw_group[i];
+			if (principal != 0) {
+				if (group_atom == nullptr) {
+					// missing-structure can't actually be part of returned
+					// group; disallow/abort by setting rings_okay false
+					rings_okay = false;
+					break;
+				}
+				if (ring_atom_map.find(principal) != ring_atom_map.end()) {
+					if (ring_atom_map[principal] != group_atom) {
 						rings_okay = false;
 						break;
 					}
-					if (ring_atom_map.find(principal) != ring_atom_map.end()) {
-						if (ring_atom_map[principal] != group_atom) {
-							rings_okay = false;
-							break;
-						}
-						// don't add a second instance of this atom
-						continue;
-					}
-					if (principal != 1)
-						ring_atom_map[principal] = group_atom;
-					pruned.push_back(group_atom);
+					// don't add a second instance of this atom
+					continue;
 				}
+				if (principal != 1)
+					ring_atom_map[principal] = group_atom;
+				pruned.push_back(group_atom);
 			}
-			if (rings_okay) {
-				groups_mutex->lock();
-				groups->emplace_back();
-				auto& back = groups->back();
-				back.swap(pruned);
-				groups_mutex->unlock();
-			}
+		}
+		if (rings_okay) {
+			groups->emplace_back();
+			auto& back = groups->back();
+			back.swap(pruned);
 		}
 	}
 }
 
+static void
+initiate_find_group(const std::vector<CG_Condition*>& group_reps,
+	const std::vector<std::vector<long>>& group_principals,
+	Atoms_Iter start, Atoms_Iter end, std::vector<Group>* groups)
+{
+	// try every pattern on an atom while it's at hand
+	for (auto i = start; i != end; ++i)
+		for (size_t g = 0; g < group_reps.size(); ++g)
+			add_traced_groups(group_reps[g], group_principals[g], *i, groups + g);
+}
+
 static Group
 find_aro_amine(const Atom* a, unsigned int order)
 {
@@ -842,7 +889,7 @@ static void
 initiate_find_aro_amines(AtomicStructure::Atoms::const_iterator start,
 	AtomicStructure::Atoms::const_iterator end,
 	unsigned int order, std::set<const Atom*>* aro_ring_npls,
-	std::vector<Group>* groups, std::mutex* groups_mutex)
+	std::vector<Group>* groups)
 {
 	for (auto i = start; i != end; ++i) {
 		auto a = *i;
@@ -851,12 +898,9 @@ initiate_find_aro_amines(AtomicStructure::Atoms::const_iterator start,
 
 		auto amine = find_aro_amine(a, order);
 		if (amine.size() > 0) {
-			// add group with locking
-			groups_mutex->lock();
 			groups->emplace_back();
 			auto& back = groups->back();
 			back.swap(amine);
-			groups_mutex->unlock();
 		}
 	}
 }
@@ -1066,7 +1110,7 @@ find_nonring_ether(const Atom* a)
 static void
 initiate_find_ring_planar_NHR2(AtomicStructure::Atoms::const_iterator start,
 	AtomicStructure::Atoms::const_iterator end, unsigned int ring_size,
-	bool aromatic_only, std::vector<Group>* groups, std::mutex* groups_mutex)
+	bool aromatic_only, std::vector<Group>* groups)
 {
 	for (auto i = start; i != end; ++i) {
 		auto a = *i;
@@ -1079,26 +1123,20 @@ initiate_find_ring_planar_NHR2(AtomicStructure::Atoms::const_iterator start,
 
 		auto nhr2 = find_ring_planar_NHR2(a, ring_size, aromatic_only);
 		if (nhr2.size() > 0) {
-			// add group with locking
-			groups_mutex->lock();
 			groups->emplace_back();
 			auto& back = groups->back();
 			back.swap(nhr2);
-			groups_mutex->unlock();
 
 			// if ring has multiple nitrogens and implicit hydrogens,
 			// then even the N2 nitrogens may be donors...
 			for (auto ra: a->rings()[0]->atoms()) {
 				if (ra->idatm_type() == "N2") {
-					// add group with locking
-					groups_mutex->lock();
 					groups->emplace_back();
 					auto& back = groups->back();
-					back.reserve(3); // vector modification empirically not thread safe
+					back.reserve(3);
 					back.push_back(ra);
 					back.push_back(ra->neighbors()[0]);
 					back.push_back(ra->neighbors()[1]);
-					groups_mutex->unlock();
 				}
 			}
 		}
@@ -1108,7 +1146,7 @@ initiate_find_ring_planar_NHR2(AtomicStructure::Atoms::const_iterator start,
 static void
 initiate_find_5ring_planar_NR2(AtomicStructure::Atoms::const_iterator start,
 	AtomicStructure::Atoms::const_iterator end,
-	bool symmetric, std::vector<Group>* groups, std::mutex* groups_mutex)
+	bool symmetric, std::vector<Group>* groups)
 {
 	for (auto i = start; i != end; ++i) {
 		auto a = *i;
@@ -1122,12 +1160,9 @@ initiate_find_5ring_planar_NR2(AtomicStructure::Atoms::const_iterator start,
 
 		auto nr2 = find_5ring_planar_NR2(a, symmetric);
 		if (nr2.size() > 0) {
-			// add group with locking
-			groups_mutex->lock();
 			groups->emplace_back();
 			auto& back = groups->back();
 			back.swap(nr2);
-			groups_mutex->unlock();
 		}
 	}
 }
@@ -1135,7 +1170,7 @@ initiate_find_5ring_planar_NR2(AtomicStructure::Atoms::const_iterator start,
 static void
 initiate_find_6ring_planar_NR2(AtomicStructure::Atoms::const_iterator start,
 	AtomicStructure::Atoms::const_iterator end,
-	bool symmetric, std::vector<Group>* groups, std::mutex* groups_mutex)
+	bool symmetric, std::vector<Group>* groups)
 {
 	for (auto i = start; i != end; ++i) {
 		auto a = *i;
@@ -1148,12 +1183,9 @@ initiate_find_6ring_planar_NR2(AtomicStructure::Atoms::const_iterator start,
 
 		auto nr2 = find_6ring_planar_NR2(a, symmetric);
 		if (nr2.size() > 0) {
-			// add group with locking
-			groups_mutex->lock();
 			groups->emplace_back();
 			auto& back = groups->back();
 			back.swap(nr2);
-			groups_mutex->unlock();
 		}
 	}
 }
@@ -1161,7 +1193,7 @@ initiate_find_6ring_planar_NR2(AtomicStructure::Atoms::const_iterator start,
 static void
 initiate_find_5ring_OR2(AtomicStructure::Atoms::const_iterator start,
 	AtomicStructure::Atoms::const_iterator end,
-	std::vector<Group>* groups, std::mutex* groups_mutex)
+	std::vector<Group>* groups)
 {
 	auto& O = Element::get_element("O");
 	for (auto i = start; i != end; ++i) {
@@ -1177,15 +1209,12 @@ initiate_find_5ring_OR2(AtomicStructure::Atoms::const_iterator start,
 			if (ring->size() != 5)
 				continue;
 
-			// add group with locking
-			groups_mutex->lock();
 			groups->emplace_back();
 			auto& back = groups->back();
-			back.reserve(3); // vector modification empirically not thread safe
+			back.reserve(3);
 			back.push_back(a);
 			for (auto nb: a->neighbors())
 				back.push_back(nb);
-			groups_mutex->unlock();
 		}
 	}
 }
@@ -1193,7 +1222,7 @@ initiate_find_5ring_OR2(AtomicStructure::Atoms::const_iterator start,
 static void
 initiate_find_nonring_ether(AtomicStructure::Atoms::const_iterator start,
 	AtomicStructure::Atoms::const_iterator end,
-	std::vector<Group>* groups, std::mutex* groups_mutex)
+	std::vector<Group>* groups)
 {
 	for (auto i = start; i != end; ++i) {
 		auto a = *i;
@@ -1206,12 +1235,9 @@ initiate_find_nonring_ether(AtomicStructure::Atoms::const_iterator start,
 
 		auto ether = find_nonring_ether(a);
 		if (ether.size() > 0) {
-			// add group with locking
-			groups_mutex->lock();
 			groups->emplace_back();
 			auto& back = groups->back();
 			back.swap(ether);
-			groups_mutex->unlock();
 		}
 	}
 }
@@ -1219,7 +1245,7 @@ initiate_find_nonring_ether(AtomicStructure::Atoms::const_iterator start,
 static void
 initiate_find_nonring_NR2(AtomicStructure::Atoms::const_iterator start,
 	AtomicStructure::Atoms::const_iterator end,
-	std::vector<Group>* groups, std::mutex* groups_mutex)
+	std::vector<Group>* groups)
 {
 	for (auto i = start; i != end; ++i) {
 		auto a = *i;
@@ -1232,12 +1258,9 @@ initiate_find_nonring_NR2(AtomicStructure::Atoms::const_iterator start,
 
 		auto nr2 = find_nonring_NR2(a);
 		if (nr2.size() > 0) {
-			// add group with locking
-			groups_mutex->lock();
 			groups->emplace_back();
 			auto& back = groups->back();
 			back.swap(nr2);
-			groups_mutex->unlock();
 		}
 	}
 }
@@ -1286,6 +1309,46 @@ make_group_list(std::vector<Group>& groups, bool return_collection)
 	return py_grp_list;
 }
 
+static bool
+check_ring_atom_class(int arg_number)
+{
+	if (!PyType_Check(py_ring_atom_class)) {
+		PyErr_Format(PyExc_TypeError, "Argument %d must be a class (RingAtom)", arg_number);
+		return false;
+	}
+	auto type_name = ((PyTypeObject*)py_ring_atom_class)->tp_name;
+	auto subloc = strstr(type_name, "RingAtom");
+	if (subloc == nullptr || (strlen(type_name) - (subloc - type_name) != strlen("RingAtom"))) {
+		PyErr_Format(PyExc_TypeError, "Argument %d is not the RingAtom class", arg_number);
+		return false;
+	}
+	return true;
+}
+
+static bool
+add_pattern(PyObject* py_group_rep, PyObject* py_group_principals,
+	std::vector<CG_Condition*>& group_reps, std::vector<std::vector<long>>& group_principals)
+{
+	if (!PyList_Check(py_group_principals)) {
+		PyErr_SetString(PyExc_TypeError, "group_principals must be a list!");
+		return false;
+	}
+	std::vector<long>  principals;
+	try {
+		pysupport::pylist_of_int_to_cvec(py_group_principals, principals, "group principal");
+	} catch (pysupport::PySupportError& pse) {
+		PyErr_SetString(PyExc_TypeError, pse.what());
+		return false;
+	}
+
+	auto group_rep = make_condition(py_group_rep);
+	if (group_rep == nullptr)
+		return false;
+	group_reps.push_back(group_rep);
+	group_principals.push_back(std::move(principals));
+	return true;
+}
+
 extern "C" {
 
 #ifndef PY_STUPID
@@ -1310,66 +1373,91 @@ find_group(PyObject *, PyObject *args)
 		return nullptr;
 	}
 	auto s = static_cast<AtomicStructure*>(PyLong_AsVoidPtr(py_struct_ptr));
-	if (!PyList_Check(py_group_principals)) {
-		PyErr_SetString(PyExc_TypeError, "group_principals must be a list!");
+	if (!check_ring_atom_class(4))
 		return nullptr;
-	}
-	if (!PyType_Check(py_ring_atom_class)) {
-		PyErr_SetString(PyExc_TypeError, "4th argument must be a class (RingAtom)");
-		return nullptr;
-	}
-	auto type_name = ((PyTypeObject*)py_ring_atom_class)->tp_name;
-	auto subloc = strstr(type_name, "RingAtom");
-	if (subloc == nullptr || (strlen(type_name) - (subloc - type_name) != strlen("RingAtom"))) {
-		PyErr_SetString(PyExc_TypeError, "4th argument is not the RingAtom class");
+
+	std::vector<CG_Condition*>  group_reps;
+	std::vector<std::vector<long>>  group_principals;
+	if (!add_pattern(py_group_rep, py_group_principals, group_reps, group_principals))
 		return nullptr;
-	}
 
+	// prevent racing/hanging thread-based IDATM computations
+	s->ready_idatm_types();
+	auto& atoms = s->atoms();
 
-	std::vector<long>  group_principals;
-	try {
-		pysupport::pylist_of_int_to_cvec(py_group_principals, group_principals, "group principal");
-	} catch (pysupport::PySupportError& pse) {
-		PyErr_SetString(PyExc_TypeError, pse.what());
+	auto groups = find_in_chunks(atoms, num_cpus,
+		[&](Atoms_Iter start, Atoms_Iter end, std::vector<Group>* groups) {
+			initiate_find_group(group_reps, group_principals, start, end, groups);
+		});
+
+	delete group_reps[0];
+
+	return make_group_list(groups, return_collection);
+}
+
+static
+PyObject *
+find_groups(PyObject *, PyObject *args)
+{
+	PyObject*  py_struct_ptr;
+	PyObject*  py_patterns;
+	unsigned int  num_cpus;
+	int	return_collection;
+	if (!PyArg_ParseTuple(args, PY_STUPID "OOOIp", &py_struct_ptr, &py_patterns,
+			&py_ring_atom_class, &num_cpus, &return_collection))
+		return nullptr;
+	if (!PyLong_Check(py_struct_ptr)) {
+		PyErr_SetString(PyExc_TypeError, "Structure pointer value must be int!");
 		return nullptr;
 	}
+	auto s = static_cast<AtomicStructure*>(PyLong_AsVoidPtr(py_struct_ptr));
+	if (!PyList_Check(py_patterns)) {
+		PyErr_SetString(PyExc_TypeError, "patterns must be a list!");
+		return nullptr;
+	}
+	if (!check_ring_atom_class(3))
+		return nullptr;
 
-	auto group_rep = make_condition(py_group_rep);
-	if (group_rep == nullptr)
+	std::vector<CG_Condition*>  group_reps;
+	std::vector<std::vector<long>>  group_principals;
+	auto num_patterns = PyList_GET_SIZE(py_patterns);
+	for (Py_ssize_t i = 0; i < num_patterns; ++i) {
+		PyObject* pattern = PyList_GET_ITEM(py_patterns, i);
+		if (!PyTuple_Check(pattern) || PyTuple_GET_SIZE(pattern) != 2) {
+			PyErr_SetString(PyExc_TypeError,
+				"each pattern must be a (group representation, principals) tuple");
+		} else if (add_pattern(PyTuple_GET_ITEM(pattern, 0), PyTuple_GET_ITEM(pattern, 1),
+				group_reps, group_principals))
+			continue;
+		for (auto group_rep: group_reps)
+			delete group_rep;
 		return nullptr;
+	}
 
 	// prevent racing/hanging thread-based IDATM computations
 	s->ready_idatm_types();
 	auto& atoms = s->atoms();
 
-	std::vector<Group> groups;
-	std::mutex groups_mtx;
-
-	size_t num_threads = num_cpus > 1 ? num_cpus : 1;
-	// divvy up the atoms among the threads;
-	// letting the threads take atoms from a global pool
-	// results in too much lock contention since many
-	// of the atoms fail to form a group quickly
-	num_threads = std::min(num_threads, atoms.size());
-	if (num_threads > 0) {
-		float per_thread = atoms.size() / (float) num_threads;
-		auto start = atoms.begin();
-		std::vector<std::thread> threads;
-		for (size_t i = 0; i < num_threads; ++i) {
-			decltype(start) end = atoms.begin() + (int)((i+1) * per_thread + 0.5);
-			if (i == num_threads - 1) // an overabundance of caution
-				end = atoms.end();
-			threads.push_back(std::thread(initiate_find_group, group_rep, &group_principals,
-				start, end, &groups, &groups_mtx));
-			start = end;
-		}
-		for (auto& th: threads)
-			th.join();
-	}
+	auto groups = find_in_chunks(atoms, num_cpus, group_reps.size(),
+		[&](Atoms_Iter start, Atoms_Iter end, std::vector<Group>* groups) {
+			initiate_find_group(group_reps, group_principals, start, end, groups);
+		});
 
-	delete group_rep;
+	for (auto group_rep: group_reps)
+		delete group_rep;
 
-	return make_group_list(groups, return_collection);
+	PyObject* py_results = PyList_New(num_patterns);
+	if (py_results == nullptr)
+		return nullptr;
+	for (Py_ssize_t i = 0; i < num_patterns; ++i) {
+		PyObject* py_groups = make_group_list(groups[i], return_collection);
+		if (py_groups == nullptr) {
+			Py_DECREF(py_results);
+			return nullptr;
+		}
+		PyList_SET_ITEM(py_results, i, py_groups);
+	}
+	return py_results;
 }
 
 static
@@ -1401,30 +1489,10 @@ find_aro_amines(PyObject *, PyObject *args)
 	}
 
 	auto& atoms = s->atoms();
-	std::vector<Group> groups;
-	std::mutex groups_mtx;
-
-	size_t num_threads = num_cpus > 1 ? num_cpus : 1;
-	// divvy up the atoms among the threads;
-	// letting the threads take atoms from a global pool
-	// results in too much lock contention since many
-	// of the atoms fail to form a group quickly
-	num_threads = std::min(num_threads, atoms.size());
-	if (num_threads > 0) {
-		float per_thread = atoms.size() / (float) num_threads;
-		auto start = atoms.begin();
-		std::vector<std::thread> threads;
-		for (size_t i = 0; i < num_threads; ++i) {
-			decltype(start) end = atoms.begin() + (int)((i+1) * per_thread + 0.5);
-			if (i == num_threads - 1) // an overabundance of caution
-				end = atoms.end();
-			threads.push_back(std::thread(initiate_find_aro_amines, start, end,
-				order, &aro_ring_npls, &groups, &groups_mtx));
-			start = end;
-		}
-		for (auto& th: threads)
-			th.join();
-	}
+	auto groups = find_in_chunks(atoms, num_cpus,
+		[&](Atoms_Iter start, Atoms_Iter end, std::vector<Group>* groups) {
+			initiate_find_aro_amines(start, end, order, &aro_ring_npls, groups);
+		});
 
 	return make_group_list(groups, return_collection);
 }
@@ -1475,30 +1543,10 @@ find_ring_planar_NHR2(PyObject *, PyObject *args)
 	(void)s->rings();
 
 	auto& atoms = s->atoms();
-	std::vector<Group> groups;
-	std::mutex groups_mtx;
-
-	size_t num_threads = num_cpus > 1 ? num_cpus : 1;
-	// divvy up the atoms among the threads;
-	// letting the threads take atoms from a global pool
-	// results in too much lock contention since many
-	// of the atoms fail to form a group quickly
-	num_threads = std::min(num_threads, atoms.size());
-	if (num_threads > 0) {
-		float per_thread = atoms.size() / (float) num_threads;
-		auto start = atoms.begin();
-		std::vector<std::thread> threads;
-		for (size_t i = 0; i < num_threads; ++i) {
-			decltype(start) end = atoms.begin() + (int)((i+1) * per_thread + 0.5);
-			if (i == num_threads - 1) // an overabundance of caution
-				end = atoms.end();
-			threads.push_back(std::thread(initiate_find_ring_planar_NHR2, start, end,
-				ring_size, (bool)aromatic_only, &groups, &groups_mtx));
-			start = end;
-		}
-		for (auto& th: threads)
-			th.join();
-	}
+	auto groups = find_in_chunks(atoms, num_cpus,
+		[&](Atoms_Iter start, Atoms_Iter end, std::vector<Group>* groups) {
+			initiate_find_ring_planar_NHR2(start, end, ring_size, (bool)aromatic_only, groups);
+		});
 
 	return make_group_list(groups, return_collection);
 }
@@ -1525,30 +1573,10 @@ find_5ring_planar_NR2(PyObject *, PyObject *args)
 	(void)s->rings();
 
 	auto& atoms = s->atoms();
-	std::vector<Group> groups;
-	std::mutex groups_mtx;
-
-	size_t num_threads = num_cpus > 1 ? num_cpus : 1;
-	// divvy up the atoms among the threads;
-	// letting the threads take atoms from a global pool
-	// results in too much lock contention since many
-	// of the atoms fail to form a group quickly
-	num_threads = std::min(num_threads, atoms.size());
-	if (num_threads > 0) {
-		float per_thread = atoms.size() / (float) num_threads;
-		auto start = atoms.begin();
-		std::vector<std::thread> threads;
-		for (size_t i = 0; i < num_threads; ++i) {
-			decltype(start) end = atoms.begin() + (int)((i+1) * per_thread + 0.5);
-			if (i == num_threads - 1) // an overabundance of caution
-				end = atoms.end();
-			threads.push_back(std::thread(initiate_find_5ring_planar_NR2,
-				start, end, (bool)symmetric, &groups, &groups_mtx));
-			start = end;
-		}
-		for (auto& th: threads)
-			th.join();
-	}
+	auto groups = find_in_chunks(atoms, num_cpus,
+		[&](Atoms_Iter start, Atoms_Iter end, std::vector<Group>* groups) {
+			initiate_find_5ring_planar_NR2(start, end, (bool)symmetric, groups);
+		});
 
 	return make_group_list(groups, return_collection);
 }
@@ -1575,30 +1603,10 @@ find_6ring_planar_NR2(PyObject *, PyObject *args)
 	(void)s->rings();
 
 	auto& atoms = s->atoms();
-	std::vector<Group> groups;
-	std::mutex groups_mtx;
-
-	size_t num_threads = num_cpus > 1 ? num_cpus : 1;
-	// divvy up the atoms among the threads;
-	// letting the threads take atoms from a global pool
-	// results in too much lock contention since many
-	// of the atoms fail to form a group quickly
-	num_threads = std::min(num_threads, atoms.size());
-	if (num_threads > 0) {
-		float per_thread = atoms.size() / (float) num_threads;
-		auto start = atoms.begin();
-		std::vector<std::thread> threads;
-		for (size_t i = 0; i < num_threads; ++i) {
-			decltype(start) end = atoms.begin() + (int)((i+1) * per_thread + 0.5);
-			if (i == num_threads - 1) // an overabundance of caution
-				end = atoms.end();
-			threads.push_back(std::thread(initiate_find_6ring_planar_NR2,
-				start, end, (bool)symmetric, &groups, &groups_mtx));
-			start = end;
-		}
-		for (auto& th: threads)
-			th.join();
-	}
+	auto groups = find_in_chunks(atoms, num_cpus,
+		[&](Atoms_Iter start, Atoms_Iter end, std::vector<Group>* groups) {
+			initiate_find_6ring_planar_NR2(start, end, (bool)symmetric, groups);
+		});
 
 	return make_group_list(groups, return_collection);
 }
@@ -1623,30 +1631,10 @@ find_5ring_OR2(PyObject *, PyObject *args)
 	(void)s->rings();
 
 	auto& atoms = s->atoms();
-	std::vector<Group> groups;
-	std::mutex groups_mtx;
-
-	size_t num_threads = num_cpus > 1 ? num_cpus : 1;
-	// divvy up the atoms among the threads;
-	// letting the threads take atoms from a global pool
-	// results in too much lock contention since many
-	// of the atoms fail to form a group quickly
-	num_threads = std::min(num_threads, atoms.size());
-	if (num_threads > 0) {
-		float per_thread = atoms.size() / (float) num_threads;
-		auto start = atoms.begin();
-		std::vector<std::thread> threads;
-		for (size_t i = 0; i < num_threads; ++i) {
-			decltype(start) end = atoms.begin() + (int)((i+1) * per_thread + 0.5);
-			if (i == num_threads - 1) // an overabundance of caution
-				end = atoms.end();
-			threads.push_back(std::thread(initiate_find_5ring_OR2,
-				start, end, &groups, &groups_mtx));
-			start = end;
-		}
-		for (auto& th: threads)
-			th.join();
-	}
+	auto groups = find_in_chunks(atoms, num_cpus,
+		[&](Atoms_Iter start, Atoms_Iter end, std::vector<Group>* groups) {
+			initiate_find_5ring_OR2(start, end, groups);
+		});
 
 	return make_group_list(groups, return_collection);
 }
@@ -1671,30 +1659,10 @@ find_nonring_NR2(PyObject *, PyObject *args)
 	(void)s->rings();
 
 	auto& atoms = s->atoms();
-	std::vector<Group> groups;
-	std::mutex groups_mtx;
-
-	size_t num_threads = num_cpus > 1 ? num_cpus : 1;
-	// divvy up the atoms among the threads;
-	// letting the threads take atoms from a global pool
-	// results in too much lock contention since many
-	// of the atoms fail to form a group quickly
-	num_threads = std::min(num_threads, atoms.size());
-	if (num_threads > 0) {
-		float per_thread = atoms.size() / (float) num_threads;
-		auto start = atoms.begin();
-		std::vector<std::thread> threads;
-		for (size_t i = 0; i < num_threads; ++i) {
-			decltype(start) end = atoms.begin() + (int)((i+1) * per_thread + 0.5);
-			if (i == num_threads - 1) // an overabundance of caution
-				end = atoms.end();
-			threads.push_back(std::thread(initiate_find_nonring_NR2,
-				start, end, &groups, &groups_mtx));
-			start = end;
-		}
-		for (auto& th: threads)
-			th.join();
-	}
+	auto groups = find_in_chunks(atoms, num_cpus,
+		[&](Atoms_Iter start, Atoms_Iter end, std::vector<Group>* groups) {
+			initiate_find_nonring_NR2(start, end, groups);
+		});
 
 	return make_group_list(groups, return_collection);
 }
@@ -1719,30 +1687,10 @@ find_nonring_ether(PyObject *, PyObject *args)
 	(void)s->rings();
 
 	auto& atoms = s->atoms();
-	std::vector<Group> groups;
-	std::mutex groups_mtx;
-
-	size_t num_threads = num_cpus > 1 ? num_cpus : 1;
-	// divvy up the atoms among the threads;
-	// letting the threads take atoms from a global pool
-	// results in too much lock contention since many
-	// of the atoms fail to form a group quickly
-	num_threads = std::min(num_threads, atoms.size());
-	if (num_threads > 0) {
-		float per_thread = atoms.size() / (float) num_threads;
-		auto start = atoms.begin();
-		std::vector<std::thread> threads;
-		for (size_t i = 0; i < num_threads; ++i) {
-			decltype(start) end = atoms.begin() + (int)((i+1) * per_thread + 0.5);
-			if (i == num_threads - 1) // an overabundance of caution
-				end = atoms.end();
-			threads.push_back(std::thread(initiate_find_nonring_ether,
-				start, end, &groups, &groups_mtx));
-			start = end;
-		}
-		for (auto& th: threads)
-			th.join();
-	}
+	auto groups = find_in_chunks(atoms, num_cpus,
+		[&](Atoms_Iter start, Atoms_Iter end, std::vector<Group>* groups) {
+			initiate_find_nonring_ether(start, end, groups);
+		});
 
 	return make_group_list(groups, return_collection);
 }
@@ -1752,6 +1700,10 @@ find_nonring_ether(PyObject *, PyObject *args)
 static const char* docstr_find_group = "find_group\n"
 "Find a chemical group (documented in Python layer)";
 
+static const char* docstr_find_groups = "find_groups\n"
+"Find several chemical groups in one pass over the atoms; returns a list of results,\n"
+"one per (group representation, principals) pattern (documented in Python layer)";
+
 static const char* docstr_find_aro_amines = "find_aro_amines\n"
 "Find aromatic amines; used internally by find_group";
 
@@ -1778,6 +1730,7 @@ static const char* docstr_find_nonring_ether = "find_nonring_ether\n"
 
 static PyMethodDef cg_methods[] = {
 	{ PY_STUPID "find_group", find_group,	METH_VARARGS, PY_STUPID docstr_find_group	},
+	{ PY_STUPID "find_groups", find_groups,	METH_VARARGS, PY_STUPID docstr_find_groups	},
 	{ PY_STUPID "find_aro_amines", find_aro_amines,	METH_VARARGS, PY_STUPID docstr_find_aro_amines	},
 	{ PY_STUPID "find_aromatics", find_aromatics,	METH_VARARGS, PY_STUPID docstr_find_aromatics	},
 	{ PY_STUPID "find_ring_planar_NHR2", find_ring_planar_NHR2,	METH_VARARGS, PY_STUPID docstr_find_ring_planar_NHR2	},
@@ -215,8 +215,7 @@ for group_name in list(group_info.keys()):
         group_info["sulph" + group_name[4:]] = group_info[group_name]
 group_info["aromatic"] = group_info["aromatic ring"]
 
-def find_group(group_desc, structures, return_collection=False):
-    
+def _group_pattern(group_desc):
     if isinstance(group_desc, str):
         try:
             group_formula, group_rep, group_principals = group_info[group_desc]
@@ -224,6 +223,11 @@ def find_group(group_desc, structures, return_collection=False):
             raise KeyError("No known chemical group named '%s'" % group_desc)
     else:
         group_rep, group_principals = group_desc
+    return group_rep, group_principals
+
+def find_group(group_desc, structures, return_collection=False):
+    
+    group_rep, group_principals = _group_pattern(group_desc)
     
     if callable(group_rep):
         return group_rep(structures, return_collection)
@@ -233,6 +237,48 @@ def find_group(group_desc, structures, return_collection=False):
     return call_c_plus_plus(fg, structures, return_collection,
         group_rep, group_principals, RingAtom)
 
+def find_groups(group_descs, structures, return_collection=False):
+    """Same as [find_group(gd, structures, return_collection) for gd in group_descs],
+       but all the pattern-based groups are matched in one pass over each structure's atoms
+    """
+    patterns = [_group_pattern(group_desc) for group_desc in group_descs]
+    results = [None] * len(patterns)
+    traced = []
+    for i, (group_rep, group_principals) in enumerate(patterns):
+        if callable(group_rep):
+            results[i] = group_rep(structures, return_collection)
+        else:
+            traced.append(i)
+    if not traced:
+        return results
+
+    import os
+    num_cpus = os.cpu_count()
+    if num_cpus is None:
+        num_cpus = 1
+    from ._chem_group import find_groups as fg
+    from chimerax.atomic import AtomicStructure
+    found = [[] for i in traced]
+    for structure in structures:
+        if not isinstance(structure, AtomicStructure):
+            continue
+        for groups, grps in zip(found, fg(structure.cpp_pointer,
+                [tuple(patterns[i]) for i in traced], RingAtom, num_cpus, return_collection)):
+            if return_collection:
+                groups.append(grps)
+            else:
+                groups.extend(grps)
+    for i, groups in zip(traced, found):
+        if return_collection:
+            from chimerax.atomic import Atoms
+            if groups:
+                import numpy
+                groups = Atoms(numpy.concatenate(groups))
+            else:
+                groups = Atoms()
+        results[i] = groups
+    return results
+
 def register_selectors(logger):
     def select(results, models, group):
         from .chem_group import find_group
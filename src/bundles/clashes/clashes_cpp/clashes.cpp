@@ -0,0 +1,650 @@
+// vi: set expandtab ts=4 sw=4:
+
+/*
+ * === UCSF ChimeraX Copyright ===
+ * Copyright 2022 Regents of the University of California. All rights reserved.
+ * The ChimeraX application is provided pursuant to the ChimeraX license
+ * agreement, which covers academic and commercial uses. For more details, see
+ * <http://www.rbvi.ucsf.edu/chimerax/docs/licensing.html>
+ *
+ * This particular file is part of the ChimeraX library. You can also
+ * redistribute and/or modify it under the terms of the GNU Lesser General
+ * Public License version 2.1 as published by the Free Software Foundation.
+ * For more details, see
+ * <https://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESSED OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. ADDITIONAL LIABILITY
+ * LIMITATIONS ARE DESCRIBED IN THE GNU LESSER GENERAL PUBLIC LICENSE
+ * VERSION 2.1
+ *
+ * This notice must be embedded in or attached to all copies, including partial
+ * copies, of the software or any revisions or derivations thereof.
+ * === UCSF ChimeraX Copyright ===
+ */
+
+#include <Python.h>
+#include <algorithm>    // std::min, std::max, std::sort
+#include <atomic>
+#include <cmath>
+#include <cstdlib>      // std::abs
+#include <unordered_map>
+#include <utility>      // std::make_pair
+#include <vector>
+
+#include <arrays/pythonarray.h>		// use parse_double_n3_array, ...
+#include <arrays/threadpool.h>		// use Thread_Pool::run
+
+// Uniform grid of cells holding point indices, for finding all points within
+// a distance of a query point without a tree walk per query.
+class Cell_List
+{
+    const double* _xyz;
+    double _cell_size;
+    std::unordered_map<int64_t, std::vector<int>> _cells;
+
+    int64_t _key(int64_t i, int64_t j, int64_t k) const {
+        return ((i & 0x1fffff) << 42) | ((j & 0x1fffff) << 21) | (k & 0x1fffff);
+    }
+    int64_t _index(double x) const { return (int64_t)std::floor(x / _cell_size); }
+public:
+    // points are indices into the xyz array
+    Cell_List(const double* xyz, const int* points, int n, double cell_size):
+            _xyz(xyz), _cell_size(cell_size) {
+        for (int i = 0; i < n; ++i) {
+            const double* p = xyz + 3*points[i];
+            _cells[_key(_index(p[0]), _index(p[1]), _index(p[2]))].push_back(points[i]);
+        }
+    }
+    // points within distance r of p
+    void  within(const double* p, double r, std::vector<int>& found) const {
+        found.clear();
+        if (_cells.empty())
+            return;
+        double r2 = r * r;
+        int64_t i0 = _index(p[0]-r), i1 = _index(p[0]+r);
+        int64_t j0 = _index(p[1]-r), j1 = _index(p[1]+r);
+        int64_t k0 = _index(p[2]-r), k1 = _index(p[2]+r);
+        for (int64_t i = i0; i <= i1; ++i)
+            for (int64_t j = j0; j <= j1; ++j)
+                for (int64_t k = k0; k <= k1; ++k) {
+                    auto ci = _cells.find(_key(i, j, k));
+                    if (ci == _cells.end())
+                        continue;
+                    for (auto a: ci->second) {
+                        const double* q = _xyz + 3*a;
+                        double dx = q[0]-p[0], dy = q[1]-p[1], dz = q[2]-p[2];
+                        if (dx*dx + dy*dy + dz*dz <= r2)
+                            found.push_back(a);
+                    }
+                }
+    }
+};
+
+// Bonds as compressed sparse rows: the neighbors of atom a are
+// nbrs[start[a]] to nbrs[start[a+1]-1], in bond order.
+class Bond_Graph
+{
+public:
+    std::vector<int> start, nbrs;
+
+    Bond_Graph(int num_atoms, const int* bonds, int num_bonds):
+            start(num_atoms+1, 0), nbrs(2*num_bonds) {
+        for (int b = 0; b < 2*num_bonds; ++b)
+            start[bonds[b]+1] += 1;
+        for (int a = 0; a < num_atoms; ++a)
+            start[a+1] += start[a];
+        std::vector<int> fill(start.begin(), start.end()-1);
+        for (int b = 0; b < num_bonds; ++b) {
+            int a1 = bonds[2*b], a2 = bonds[2*b+1];
+            nbrs[fill[a1]++] = a2;
+            nbrs[fill[a2]++] = a1;
+        }
+    }
+    int  num_neighbors(int a) const { return start[a+1] - start[a]; }
+
+    // connected component number of each atom
+    std::vector<int>  fragments() const {
+        int n = start.size() - 1;
+        std::vector<int> frag(n, -1), stack;
+        for (int a = 0; a < n; ++a) {
+            if (frag[a] >= 0)
+                continue;
+            frag[a] = a;
+            stack.push_back(a);
+            while (!stack.empty()) {
+                int c = stack.back();
+                stack.pop_back();
+                for (int k = start[c]; k < start[c+1]; ++k)
+                    if (frag[nbrs[k]] < 0) {
+                        frag[nbrs[k]] = a;
+                        stack.push_back(nbrs[k]);
+                    }
+            }
+        }
+        return frag;
+    }
+};
+
+// Donors are hydrogens bonded to N, O or S, and N, O or S atoms with a bonded
+// or implicit hydrogen; acceptors have fewer substituents than their geometry
+// allows.  Substituents and geometry are from the IDATM type info, -1 if the
+// type is unknown.
+static void
+hbond_roles(const Bond_Graph& g, const unsigned char* elements, const int* substituents,
+    const int* geometries, int n, std::vector<unsigned char>& donor,
+    std::vector<unsigned char>& acceptor)
+{
+    auto negative = [](int e) { return e == 7 || e == 8 || e == 16; };
+    donor.assign(n, 0);
+    acceptor.assign(n, 0);
+    for (int a = 0; a < n; ++a) {
+        int e = elements[a];
+        if (e == 1)
+            donor[a] = g.num_neighbors(a) > 0 && negative(elements[g.nbrs[g.start[a]]]);
+        else if (negative(e)) {
+            if (substituents[a] >= 0 && g.num_neighbors(a) < substituents[a])
+                // implicit hydrogen
+                donor[a] = 1;
+            for (int k = g.start[a]; k < g.start[a+1] && !donor[a]; ++k)
+                if (elements[g.nbrs[k]] == 1)
+                    donor[a] = 1;
+        }
+        acceptor[a] = substituents[a] >= 0 && substituents[a] < geometries[a];
+    }
+}
+
+class Contact
+{
+public:
+    int a1, a2;
+    double clash;
+
+    Contact(int a1, int a2, double clash): a1(std::min(a1, a2)), a2(std::max(a1, a2)),
+        clash(clash) {}
+    bool  operator<(const Contact& other) const {
+        return a1 < other.a1 || (a1 == other.a1 && a2 < other.a2);
+    }
+    bool  operator==(const Contact& other) const { return a1 == other.a1 && a2 == other.a2; }
+};
+
+// All the inputs to a clash/contact search, as raw per-atom arrays
+class Contact_Finder
+{
+public:
+    int n;
+    const double *xyz, *radii;
+    const int *test, *search, *bonds;
+    int num_test, num_search, num_bonds, bond_separation;
+    const int *residues, *chains, *chain_positions, *structures;
+    int res_separation, num_structures;
+    const unsigned char *structure_pairs, *elements;
+    const int *substituents, *geometries;
+    double cutoff_pad, clash_threshold, hbond_allowance, distance_only;
+    bool intra_res, intra_mol;
+
+    std::vector<Contact>  find(int num_threads) const {
+        std::vector<Contact> contacts;
+        Bond_Graph graph(n, bonds, num_bonds);
+        std::vector<int> frag;
+        if (!intra_mol)
+            frag = graph.fragments();
+        std::vector<unsigned char> donor, acceptor;
+        bool use_hbonds = hbond_allowance != 0 && distance_only <= 0;
+        if (use_hbonds)
+            hbond_roles(graph, elements, substituents, geometries, n, donor, acceptor);
+
+        double max_cutoff = distance_only;
+        if (distance_only <= 0)
+            for (int i = 0; i < num_test; ++i)
+                max_cutoff = std::max(max_cutoff, radii[test[i]] + cutoff_pad);
+        Cell_List cells(xyz, search, num_search, max_cutoff > 0 ? max_cutoff : 1);
+
+        std::atomic<int> next(0);
+        int num_workers = Thread_Pool::thread_count(num_test, 1, std::max(1, num_threads));
+        std::vector<std::vector<Contact>> found_contacts(num_workers);
+        Thread_Pool::run(num_workers, [&](int thread_index) {
+            auto found = &found_contacts[thread_index];
+            // atoms within bond_separation bonds are stamped with the test atom's turn
+            std::vector<int> stamp(n, -1), nearby, expand, next_expand;
+            for (int t = next++; t < num_test; t = next++) {
+                int a = test[t];
+                double cutoff = (distance_only > 0 ? distance_only : radii[a] + cutoff_pad);
+                const double* pa = xyz + 3*a;
+                cells.within(pa, cutoff, nearby);
+                if (nearby.empty())
+                    continue;
+                stamp[a] = t;
+                expand.assign(1, a);
+                for (int s = 0; s < bond_separation && !expand.empty(); ++s) {
+                    next_expand.clear();
+                    for (auto e: expand)
+                        for (int k = graph.start[e]; k < graph.start[e+1]; ++k) {
+                            int nb = graph.nbrs[k];
+                            if (stamp[nb] != t) {
+                                stamp[nb] = t;
+                                next_expand.push_back(nb);
+                            }
+                        }
+                    expand.swap(next_expand);
+                }
+                for (auto b: nearby) {
+                    if (stamp[b] == t)
+                        continue;
+                    if (!intra_res && residues[a] == residues[b])
+                        continue;
+                    if (!intra_mol && frag[a] == frag[b])
+                        continue;
+                    if (!structure_pairs[structures[a] * num_structures + structures[b]])
+                        continue;
+                    if (res_separation >= 0 && chains[a] >= 0 && chains[a] == chains[b]
+                    && std::abs(chain_positions[a] - chain_positions[b]) < res_separation)
+                        continue;
+                    const double* pb = xyz + 3*b;
+                    double dx = pa[0]-pb[0], dy = pa[1]-pb[1], dz = pa[2]-pb[2];
+                    double d = std::sqrt(dx*dx + dy*dy + dz*dz), clash;
+                    if (distance_only > 0) {
+                        clash = distance_only - d;
+                        if (clash < 0.0)
+                            continue;
+                    } else {
+                        clash = radii[a] + radii[b] - d;
+                        if (use_hbonds && ((donor[a] && acceptor[b]) || (donor[b] && acceptor[a])))
+                            clash -= hbond_allowance;
+                        if (clash < clash_threshold)
+                            continue;
+                    }
+                    found->push_back(Contact(a, b, clash));
+                }
+            }
+        });
+        for (auto& found: found_contacts)
+            contacts.insert(contacts.end(), found.begin(), found.end());
+        // pairs of test atoms can be found from either end
+        std::sort(contacts.begin(), contacts.end());
+        contacts.erase(std::unique(contacts.begin(), contacts.end()), contacts.end());
+        return contacts;
+    }
+};
+
+static PyObject*
+find_contacts(PyObject*, PyObject* args, PyObject* keywds)
+{
+    DArray coords, radii;
+    IArray test_atoms, search_atoms, bonds, residues, chains, chain_positions, structures,
+        substituents, geometries;
+    BArray structure_pairs, elements;
+    int bond_separation, res_separation = -1, intra_res = 0, intra_mol = 1, num_threads = 1;
+    double cutoff_pad, clash_threshold, hbond_allowance = 0, distance_only = 0;
+    const char *kwlist[] = {"coords", "radii", "test_atoms", "search_atoms", "bonds",
+        "bond_separation", "residues", "chains", "chain_positions", "structures",
+        "structure_pairs", "elements", "substituents", "geometries", "cutoff_pad",
+        "clash_threshold", "hbond_allowance", "distance_only", "res_separation",
+        "intra_res", "intra_mol", "num_threads", NULL};
+    if (!PyArg_ParseTupleAndKeywords(args, keywds,
+                   const_cast<char *>("O&O&O&O&O&iO&O&O&O&O&O&O&O&dd|ddippi"), (char **)kwlist,
+                   parse_double_n3_array, &coords,
+                   parse_double_n_array, &radii,
+                   parse_int_n_array, &test_atoms,
+                   parse_int_n_array, &search_atoms,
+                   parse_int_n2_array, &bonds,
+                   &bond_separation,
+                   parse_int_n_array, &residues,
+                   parse_int_n_array, &chains,
+                   parse_int_n_array, &chain_positions,
+                   parse_int_n_array, &structures,
+                   parse_uint8_n_array, &structure_pairs,
+                   parse_uint8_n_array, &elements,
+                   parse_int_n_array, &substituents,
+                   parse_int_n_array, &geometries,
+                   &cutoff_pad, &clash_threshold, &hbond_allowance, &distance_only,
+                   &res_separation, &intra_res, &intra_mol, &num_threads))
+        return nullptr;
+    int n = coords.size(0);
+    if (radii.size() != n || residues.size() != n || chains.size() != n
+    || chain_positions.size() != n || structures.size() != n || elements.size() != n
+    || substituents.size() != n || geometries.size() != n)
+        return PyErr_Format(PyExc_ValueError, "Per-atom arrays must all have %d values", n);
+
+    DArray xyz_contig = coords.contiguous_array(), rad_contig = radii.contiguous_array();
+    IArray t_contig = test_atoms.contiguous_array(), s_contig = search_atoms.contiguous_array(),
+        b_contig = bonds.contiguous_array(), r_contig = residues.contiguous_array(),
+        c_contig = chains.contiguous_array(), cp_contig = chain_positions.contiguous_array(),
+        st_contig = structures.contiguous_array(), sub_contig = substituents.contiguous_array(),
+        g_contig = geometries.contiguous_array();
+    BArray sp_contig = structure_pairs.contiguous_array(), e_contig = elements.contiguous_array();
+    const double *xyz = xyz_contig.values(), *rad = rad_contig.values();
+    const int *test = t_contig.values(), *search = s_contig.values(),
+        *res = r_contig.values(), *chain = c_contig.values(), *chain_pos = cp_contig.values(),
+        *struc = st_contig.values();
+    const unsigned char *struc_pairs = sp_contig.values(), *elem = e_contig.values();
+    int num_test = test_atoms.size(), num_search = search_atoms.size(),
+        num_structures = (int)std::lround(std::sqrt((double)structure_pairs.size()));
+    const int* bond_atoms = b_contig.values();
+    for (auto indices: {std::make_pair(test, num_test), std::make_pair(search, num_search),
+            std::make_pair(bond_atoms, 2 * (int)bonds.size(0))})
+        for (int i = 0; i < indices.second; ++i)
+            if (indices.first[i] < 0 || indices.first[i] >= n)
+                return PyErr_Format(PyExc_ValueError, "Atom index %d out of range", indices.first[i]);
+    for (int a = 0; a < n; ++a)
+        if (struc[a] < 0 || struc[a] >= num_structures)
+            return PyErr_Format(PyExc_ValueError, "Structure index %d out of range", struc[a]);
+
+    Contact_Finder finder;
+    finder.n = n;
+    finder.xyz = xyz;
+    finder.radii = rad;
+    finder.test = test;
+    finder.num_test = num_test;
+    finder.search = search;
+    finder.num_search = num_search;
+    finder.bonds = bond_atoms;
+    finder.num_bonds = bonds.size(0);
+    finder.bond_separation = bond_separation;
+    finder.residues = res;
+    finder.chains = chain;
+    finder.chain_positions = chain_pos;
+    finder.res_separation = res_separation;
+    finder.structures = struc;
+    finder.structure_pairs = struc_pairs;
+    finder.num_structures = num_structures;
+    finder.elements = elem;
+    finder.substituents = sub_contig.values();
+    finder.geometries = g_contig.values();
+    finder.cutoff_pad = cutoff_pad;
+    finder.clash_threshold = clash_threshold;
+    finder.hbond_allowance = hbond_allowance;
+    finder.distance_only = distance_only;
+    finder.intra_res = intra_res;
+    finder.intra_mol = intra_mol;
+
+    std::vector<Contact> contacts;
+    Py_BEGIN_ALLOW_THREADS
+    contacts = finder.find(num_threads);
+    Py_END_ALLOW_THREADS
+
+    int* pairs;
+    double* clashes;
+    PyObject* py_pairs = python_int_array(contacts.size(), 2, &pairs);
+    if (py_pairs == nullptr)
+        return nullptr;
+    PyObject* py_clashes = python_double_array(contacts.size(), &clashes);
+    if (py_clashes == nullptr) {
+        Py_DECREF(py_pairs);
+        return nullptr;
+    }
+    for (auto& c: contacts) {
+        *pairs++ = c.a1;
+        *pairs++ = c.a2;
+        *clashes++ = c.clash;
+    }
+    return python_tuple(py_pairs, py_clashes);
+}
+
+static const char* docstr_find_contacts =
+"find_contacts(coords, radii, test_atoms, search_atoms, bonds, bond_separation, residues,\n"
+"    chains, chain_positions, structures, structure_pairs, elements, substituents,\n"
+"    geometries, cutoff_pad, clash_threshold, hbond_allowance = 0, distance_only = 0,\n"
+"    res_separation = -1, intra_res = False, intra_mol = True, num_threads = 1)\n"
+"\n"
+"Find clashes/contacts between test atoms and search atoms, given as indices into\n"
+"the per-atom arrays.  A search atom is a candidate if its distance from the test\n"
+"atom is within the test atom radius plus cutoff_pad (or distance_only, if positive).\n"
+"Atoms within bond_separation bonds of each other (bonds is an N by 2 array of atom\n"
+"indices) are excluded, as are pairs in the same residue unless intra_res, pairs in\n"
+"the same covalently connected fragment unless intra_mol, pairs whose structure\n"
+"indices have a zero entry in the flattened square structure_pairs matrix, and\n"
+"pairs fewer than res_separation residues apart (if non-negative) in the same chain\n"
+"(chain -1 means no chain).  The clash value is the sum of the radii minus the\n"
+"distance, reduced by hbond_allowance for donor/acceptor pairs, and must be at\n"
+"least clash_threshold.  With distance_only, it is distance_only minus the distance\n"
+"and must not be negative.  Substituents and geometries are the IDATM type info\n"
+"values, -1 for unknown types.  The test atoms are divided among num_threads\n"
+"threads.  Returns an N by 2 int32 array of atom index pairs, each pair once with\n"
+"the lower index first, and an array of the corresponding clash values.";
+
+static PyObject*
+hbond_atom_roles(PyObject*, PyObject* args, PyObject* keywds)
+{
+    IArray bonds, substituents, geometries;
+    BArray elements;
+    const char *kwlist[] = {"elements", "bonds", "substituents", "geometries", NULL};
+    if (!PyArg_ParseTupleAndKeywords(args, keywds, const_cast<char *>("O&O&O&O&"), (char **)kwlist,
+                   parse_uint8_n_array, &elements,
+                   parse_int_n2_array, &bonds,
+                   parse_int_n_array, &substituents,
+                   parse_int_n_array, &geometries))
+        return nullptr;
+    int n = elements.size();
+    if (substituents.size() != n || geometries.size() != n)
+        return PyErr_Format(PyExc_ValueError, "Per-atom arrays must all have %d values", n);
+    IArray b_contig = bonds.contiguous_array(), sub_contig = substituents.contiguous_array(),
+        g_contig = geometries.contiguous_array();
+    BArray e_contig = elements.contiguous_array();
+    const int* bond_atoms = b_contig.values();
+    int num_bonds = bonds.size(0);
+    for (int i = 0; i < 2*num_bonds; ++i)
+        if (bond_atoms[i] < 0 || bond_atoms[i] >= n)
+            return PyErr_Format(PyExc_ValueError, "Atom index %d out of range", bond_atoms[i]);
+
+    Bond_Graph graph(n, bond_atoms, num_bonds);
+    std::vector<unsigned char> donor, acceptor;
+    hbond_roles(graph, e_contig.values(), sub_contig.values(), g_contig.values(), n,
+        donor, acceptor);
+
+    unsigned char *d, *a;
+    PyObject* py_donors = python_bool_array(n, &d);
+    if (py_donors == nullptr)
+        return nullptr;
+    PyObject* py_acceptors = python_bool_array(n, &a);
+    if (py_acceptors == nullptr) {
+        Py_DECREF(py_donors);
+        return nullptr;
+    }
+    std::copy(donor.begin(), donor.end(), d);
+    std::copy(acceptor.begin(), acceptor.end(), a);
+    return python_tuple(py_donors, py_acceptors);
+}
+
+static const char* docstr_hbond_atom_roles =
+"hbond_atom_roles(elements, bonds, substituents, geometries)\n"
+"\n"
+"Hydrogen bond donor and acceptor flags of atoms as used by find_contacts(), given\n"
+"their element numbers, an N by 2 array of bonded atom indices and the IDATM type\n"
+"info substituents and geometries (-1 for unknown types).  Returns two bool arrays.";
+
+// All the inputs for scoring many alternative atom sets, such as the rotamers of
+// residues, against fixed environment atoms.
+class Set_Scorer
+{
+public:
+    int num_env, num_set_atoms, num_sets;
+    const double *env_xyz, *env_radii, *set_xyz, *set_radii;
+    const int *env_residues, *env_structures, *set_residues, *set_structures, *sets;
+    const unsigned char *env_donors, *env_acceptors, *set_donors, *set_acceptors;
+    double cutoff_pad, clash_threshold, hbond_allowance;
+    bool count, same_structure;
+
+    std::vector<double>  scores(int num_threads) const {
+        std::vector<double> scores(num_sets, 0.0);
+        if (num_env == 0 || num_set_atoms == 0)
+            return scores;
+        double max_cutoff = 0;
+        for (int i = 0; i < num_set_atoms; ++i)
+            max_cutoff = std::max(max_cutoff, set_radii[i] + cutoff_pad);
+        // the environment is the same for every set, so its cells are made once
+        std::vector<int> env_atoms(num_env);
+        for (int i = 0; i < num_env; ++i)
+            env_atoms[i] = i;
+        Cell_List cells(env_xyz, env_atoms.data(), num_env, max_cutoff > 0 ? max_cutoff : 1);
+        bool use_hbonds = hbond_allowance != 0;
+
+        std::atomic<int> next(0);
+        int num_workers = Thread_Pool::thread_count(num_set_atoms, 1, std::max(1, num_threads));
+        std::vector<std::vector<double>> set_scores(num_workers);
+        Thread_Pool::run(num_workers, [&](int thread_index) {
+            auto& ss = set_scores[thread_index];
+            ss.assign(num_sets, 0.0);
+            std::vector<int> nearby;
+            for (int a = next++; a < num_set_atoms; a = next++) {
+                const double* pa = set_xyz + 3*a;
+                cells.within(pa, set_radii[a] + cutoff_pad, nearby);
+                for (auto b: nearby) {
+                    // a set does not clash with the residue it replaces
+                    if (env_residues[b] == set_residues[a])
+                        continue;
+                    if (same_structure && env_structures[b] != set_structures[a])
+                        continue;
+                    const double* pb = env_xyz + 3*b;
+                    double dx = pa[0]-pb[0], dy = pa[1]-pb[1], dz = pa[2]-pb[2];
+                    double clash = set_radii[a] + env_radii[b] - std::sqrt(dx*dx + dy*dy + dz*dz);
+                    if (use_hbonds && ((set_donors[a] && env_acceptors[b])
+                    || (env_donors[b] && set_acceptors[a])))
+                        clash -= hbond_allowance;
+                    if (clash < clash_threshold)
+                        continue;
+                    ss[sets[a]] += (count ? 1 : clash);
+                }
+            }
+        });
+        for (auto& ss: set_scores)
+            for (int s = 0; s < num_sets; ++s)
+                scores[s] += ss[s];
+        return scores;
+    }
+};
+
+static PyObject*
+set_clash_scores(PyObject*, PyObject* args, PyObject* keywds)
+{
+    DArray env_coords, env_radii, set_coords, set_radii;
+    IArray env_residues, env_structures, set_residues, set_structures, sets;
+    BArray env_donors, env_acceptors, set_donors, set_acceptors;
+    int num_sets, count = 0, same_structure = 0, num_threads = 1;
+    double cutoff_pad, clash_threshold, hbond_allowance = 0;
+    const char *kwlist[] = {"env_coords", "env_radii", "env_residues", "env_structures",
+        "env_donors", "env_acceptors", "set_coords", "set_radii", "set_residues",
+        "set_structures", "set_donors", "set_acceptors", "sets", "num_sets", "cutoff_pad",
+        "clash_threshold", "hbond_allowance", "count", "same_structure", "num_threads", NULL};
+    if (!PyArg_ParseTupleAndKeywords(args, keywds,
+                   const_cast<char *>("O&O&O&O&O&O&O&O&O&O&O&O&O&idd|dppi"), (char **)kwlist,
+                   parse_double_n3_array, &env_coords,
+                   parse_double_n_array, &env_radii,
+                   parse_int_n_array, &env_residues,
+                   parse_int_n_array, &env_structures,
+                   parse_uint8_n_array, &env_donors,
+                   parse_uint8_n_array, &env_acceptors,
+                   parse_double_n3_array, &set_coords,
+                   parse_double_n_array, &set_radii,
+                   parse_int_n_array, &set_residues,
+                   parse_int_n_array, &set_structures,
+                   parse_uint8_n_array, &set_donors,
+                   parse_uint8_n_array, &set_acceptors,
+                   parse_int_n_array, &sets,
+                   &num_sets, &cutoff_pad, &clash_threshold, &hbond_allowance,
+                   &count, &same_structure, &num_threads))
+        return nullptr;
+    int ne = env_coords.size(0), ns = set_coords.size(0);
+    if (env_radii.size() != ne || env_residues.size() != ne || env_structures.size() != ne
+    || env_donors.size() != ne || env_acceptors.size() != ne)
+        return PyErr_Format(PyExc_ValueError, "Environment arrays must all have %d values", ne);
+    if (set_radii.size() != ns || set_residues.size() != ns || set_structures.size() != ns
+    || set_donors.size() != ns || set_acceptors.size() != ns || sets.size() != ns)
+        return PyErr_Format(PyExc_ValueError, "Set atom arrays must all have %d values", ns);
+
+    DArray exyz = env_coords.contiguous_array(), erad = env_radii.contiguous_array(),
+        sxyz = set_coords.contiguous_array(), srad = set_radii.contiguous_array();
+    IArray eres = env_residues.contiguous_array(), estr = env_structures.contiguous_array(),
+        sres = set_residues.contiguous_array(), sstr = set_structures.contiguous_array(),
+        set_contig = sets.contiguous_array();
+    BArray edon = env_donors.contiguous_array(), eacc = env_acceptors.contiguous_array(),
+        sdon = set_donors.contiguous_array(), sacc = set_acceptors.contiguous_array();
+    const int* set_index = set_contig.values();
+    for (int i = 0; i < ns; ++i)
+        if (set_index[i] < 0 || set_index[i] >= num_sets)
+            return PyErr_Format(PyExc_ValueError, "Set index %d out of range", set_index[i]);
+
+    Set_Scorer scorer;
+    scorer.num_env = ne;
+    scorer.num_set_atoms = ns;
+    scorer.num_sets = num_sets;
+    scorer.env_xyz = exyz.values();
+    scorer.env_radii = erad.values();
+    scorer.env_residues = eres.values();
+    scorer.env_structures = estr.values();
+    scorer.env_donors = edon.values();
+    scorer.env_acceptors = eacc.values();
+    scorer.set_xyz = sxyz.values();
+    scorer.set_radii = srad.values();
+    scorer.set_residues = sres.values();
+    scorer.set_structures = sstr.values();
+    scorer.set_donors = sdon.values();
+    scorer.set_acceptors = sacc.values();
+    scorer.sets = set_index;
+    scorer.cutoff_pad = cutoff_pad;
+    scorer.clash_threshold = clash_threshold;
+    scorer.hbond_allowance = hbond_allowance;
+    scorer.count = count;
+    scorer.same_structure = same_structure;
+
+    std::vector<double> scores;
+    Py_BEGIN_ALLOW_THREADS
+    scores = scorer.scores(num_threads);
+    Py_END_ALLOW_THREADS
+
+    double* values;
+    PyObject* py_scores = python_double_array(num_sets, &values);
+    if (py_scores == nullptr)
+        return nullptr;
+    std::copy(scores.begin(), scores.end(), values);
+    return py_scores;
+}
+
+static const char* docstr_set_clash_scores =
+"set_clash_scores(env_coords, env_radii, env_residues, env_structures, env_donors,\n"
+"    env_acceptors, set_coords, set_radii, set_residues, set_structures, set_donors,\n"
+"    set_acceptors, sets, num_sets, cutoff_pad, clash_threshold, hbond_allowance = 0,\n"
+"    count = False, same_structure = False, num_threads = 1)\n"
+"\n"
+"Score the clashes of alternative atom sets, such as rotamers, with fixed environment\n"
+"atoms.  Each set atom belongs to set number sets[i] and replaces residue number\n"
+"set_residues[i], whose environment atoms it is not compared with.  Candidate pairs\n"
+"and clash values are as for find_contacts(), with no bonds between set and\n"
+"environment atoms.  If same_structure is true, only environment atoms with the\n"
+"same structure index are considered.  A set's score is the sum of its clash\n"
+"values, or the number of clashes if count is true.  The environment is put in\n"
+"cells once and the set atoms are divided among num_threads threads.  Returns an\n"
+"array of num_sets scores.";
+
+static struct PyMethodDef clashes_methods[] =
+{
+  {const_cast<char*>("find_contacts"), (PyCFunction)find_contacts,
+    METH_VARARGS|METH_KEYWORDS, docstr_find_contacts},
+  {const_cast<char*>("hbond_atom_roles"), (PyCFunction)hbond_atom_roles,
+    METH_VARARGS|METH_KEYWORDS, docstr_hbond_atom_roles},
+  {const_cast<char*>("set_clash_scores"), (PyCFunction)set_clash_scores,
+    METH_VARARGS|METH_KEYWORDS, docstr_set_clash_scores},
+  {nullptr, nullptr, 0, nullptr}
+};
+
+static struct PyModuleDef clashes_def = {
+        PyModuleDef_HEAD_INIT,
+        "_clashes",
+        "Find atomic clashes and contacts",
+        -1,
+        clashes_methods,
+        nullptr,
+        nullptr,
+        nullptr,
+        nullptr
+};
+
+// ----------------------------------------------------------------------------
+// Initialization routine called by python when module is dynamically loaded.
+//
+PyMODINIT_FUNC
+PyInit__clashes()
+{
+    return PyModule_Create(&clashes_def);
+}
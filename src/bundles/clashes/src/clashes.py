@@ -120,115 +120,127 @@ def find_clashes(session, test_atoms,
         test_atoms = test_atoms.filter(test_atoms.structures.visibles == True)
         search_atoms = search_atoms.filter(search_atoms.structures.visibles == True)
 
+    clashes = {}
+    if not test_atoms or not search_atoms:
+        return clashes
+    # the native contact search works on indices into the atoms of all the involved structures,
+    # so that bond separations can be traced through atoms outside the test/search sets
+    from chimerax.atomic import concatenate, structure_atoms, Residues
+    import numpy
+    universe = structure_atoms(concatenate([test_atoms, search_atoms]).unique_structures)
+    coords = universe.scene_coords if use_scene_coords else universe.coords
+    bonds = universe.intra_bonds
+    b1, b2 = bonds.atoms
+    bond_indices = numpy.stack((universe.indices(b1), universe.indices(b2)), axis=1)
+
+    residues = universe.unique_residues
+    res_indices = residues.indices(universe.residues)
+    res_chains = numpy.full(len(residues), -1, numpy.int32)
+    res_chain_pos = numpy.zeros(len(residues), numpy.int32)
     if res_separation is not None:
-        chain_pos = {}
+        num_chains = 0
         for s in test_atoms.unique_structures:
             for c in s.chains:
-                for i, r in enumerate(c.residues):
-                    if r:
-                        chain_pos[r] = i
-    from chimerax.atom_search import AtomSearchTree
-    tree = AtomSearchTree(search_atoms, scene_coords=inter_model)
-    clashes = {}
-    from chimerax.geometry import distance
-    intra_mol_map = {}
-    for a in test_atoms:
-        if distance_only:
-            cutoff = distance_only
-        else:
-            cutoff = a.radius + assumed_max_vdw - clash_threshold
-        crd = a.scene_coord if use_scene_coords else a.coord
-        nearby = tree.search(crd, cutoff)
-        if not nearby:
-            continue
-        need_expansion = [a]
-        exclusions = set(need_expansion)
-        for i in range(bond_separation):
-            next_need = []
-            for expand in need_expansion:
-                for n in expand.neighbors:
-                    if n in exclusions:
-                        continue
-                    exclusions.add(n)
-                    next_need.append(n)
-            need_expansion = next_need
-        if not intra_mol and a not in intra_mol_map:
-            connected = set([a])
-            to_do = list(a.neighbors)
-            while to_do:
-                conn = to_do.pop()
-                connected.add(conn)
-                for nb in conn.neighbors:
-                    if nb not in connected:
-                        to_do.append(nb)
-            for ca in connected:
-                intra_mol_map[ca] = connected
-        for nb in nearby:
-            if nb in exclusions:
-                continue
-            if not intra_res and a.residue == nb.residue:
-                continue
-            if not intra_mol and nb in intra_mol_map[a]:
-                continue
-            if not inter_model and a.structure != nb.structure:
-                continue
-            if not intra_model and a.structure == nb.structure:
-                continue
-            if a in clashes and nb in clashes[a]:
-                continue
-            if res_separation is not None:
-                if a.residue.chain is not None and a.residue.chain == nb.residue.chain:
-                    if abs(chain_pos[a.residue] - chain_pos[nb.residue]) < res_separation:
-                        continue
-            if not inter_submodel \
-            and a.structure.id and nb.structure.id \
-            and a.structure.id[0] == nb.structure.id[0] \
-            and a.structure.id[:-1] == nb.structure.id[:-1] \
-            and a.structure.id[1:] != nb.structure.id[1:]:
-                continue
-            if use_scene_coords:
-                a_crd, nb_crd = a.scene_coord, nb.scene_coord
-            else:
-                a_crd, nb_crd = a.coord, nb.coord
-            if distance_only:
-                clash = distance_only - distance(a_crd, nb_crd)
+                chain_residues = c.residues
+                positions = [i for i, r in enumerate(chain_residues) if r]
+                indices = residues.indices(Residues([chain_residues[i] for i in positions]))
+                res_chains[indices] = num_chains
+                res_chain_pos[indices] = positions
+                num_chains += 1
+
+    structures = universe.unique_structures
+    ns = len(structures)
+    structure_pairs = numpy.empty((ns, ns), numpy.uint8)
+    for i1, s1 in enumerate(structures):
+        for i2, s2 in enumerate(structures):
+            if s1 == s2:
+                ok = intra_model
             else:
-                clash = a.radius + nb.radius - distance(a_crd, nb_crd)
-            if hbond_allowance and not distance_only:
-                if (_donor(a) and _acceptor(nb)) or (_donor(nb) and _acceptor(a)):
-                    clash -= hbond_allowance
-            if distance_only:
-                if clash < 0.0:
-                    continue
-            elif clash < clash_threshold:
-                continue
-            clashes.setdefault(a, {})[nb] = clash
-            clashes.setdefault(nb, {})[a] = clash
+                ok = inter_model and (inter_submodel or not (s1.id and s2.id
+                    and s1.id[0] == s2.id[0] and s1.id[:-1] == s2.id[:-1] and s1.id[1:] != s2.id[1:]))
+            structure_pairs[i1, i2] = ok
+
+    substituents, geometries = _type_info_arrays(universe)
+
+    from ._clashes import find_contacts
+    import os
+    pairs, clash_vals = find_contacts(coords, universe.radii.astype(numpy.float64),
+        universe.indices(test_atoms), universe.indices(search_atoms), bond_indices, bond_separation,
+        res_indices, res_chains[res_indices], res_chain_pos[res_indices],
+        structures.indices(universe.structures), structure_pairs.ravel(),
+        universe.element_numbers, substituents, geometries,
+        assumed_max_vdw - clash_threshold, clash_threshold,
+        hbond_allowance=hbond_allowance, distance_only=(distance_only or 0.0),
+        res_separation=(-1 if res_separation is None else res_separation),
+        intra_res=intra_res, intra_mol=intra_mol, num_threads=(os.cpu_count() or 1))
+    for a, nb, clash in zip(universe[pairs[:,0]], universe[pairs[:,1]], clash_vals):
+        clashes.setdefault(a, {})[nb] = clash
+        clashes.setdefault(nb, {})[a] = clash
     return clashes
 
-from chimerax.atomic import Element
-hyd = Element.get_element(1)
-negative = set([Element.get_element(sym) for sym in ["N", "O", "S"]])
-from chimerax.atomic.idatm import type_info
-def _donor(a):
-    if a.element == hyd:
-        if a.num_bonds > 0 and a.neighbors[0].element in negative:
-            return True
-    elif a.element in negative:
-        try:
-            if a.num_bonds < type_info[a.idatm_type].substituents:
-                # implicit hydrogen
-                return True
-        except KeyError:
-            pass
-        for nb in a.neighbors:
-            if nb.element == hyd:
-                return True
-    return False
-
-def _acceptor(a):
-    try:
-        info = type_info[a.idatm_type]
-    except KeyError:
-        return False
-    return info.substituents < info.geometry
+def clash_scores(env_atoms, atom_sets, replaced_residues, *,
+        assumed_max_vdw=2.1,
+        clash_threshold=defaults["clash_threshold"],
+        count=False,
+        hbond_allowance=defaults["clash_hbond_allowance"],
+        same_structure=False):
+    """Score clashes of many alternative atom sets, such as rotamers, with fixed atoms
+
+       'atom_sets' is a list of Atoms collections, each standing in for the residue at the
+       same position in 'replaced_residues'.  Clash values between set atoms and 'env_atoms'
+       are as for find_clashes(), using scene coordinates.  Clashes with the atoms of the
+       replaced residue are ignored, as are clashes with other structures than that residue's
+       if 'same_structure' is True.  The environment atoms are put in a grid once and all the
+       sets are scored together in C++.
+
+       Returns an array of the sum of each set's clash values, or of its number of clashes
+       if 'count' is True.
+    """
+    import numpy
+    num_sets = len(atom_sets)
+    if num_sets == 0 or len(env_atoms) == 0:
+        return numpy.zeros(num_sets, numpy.float64)
+    from chimerax.atomic import concatenate, Atoms, Residues, Structures
+    set_atoms = concatenate(atom_sets, Atoms)
+    sets = numpy.repeat(numpy.arange(num_sets, dtype=numpy.int32), [len(a) for a in atom_sets])
+    env_residues = env_atoms.unique_residues
+    env_structures = env_atoms.unique_structures
+    replaced = Residues(replaced_residues)
+    set_residues = env_residues.indices(replaced)[sets]
+    set_structures = env_structures.indices(replaced.structures)[sets]
+    env_donors, env_acceptors = _hbond_roles(env_atoms)
+    set_donors, set_acceptors = _hbond_roles(set_atoms)
+
+    from ._clashes import set_clash_scores
+    import os
+    return set_clash_scores(env_atoms.scene_coords, env_atoms.radii.astype(numpy.float64),
+        env_residues.indices(env_atoms.residues), env_structures.indices(env_atoms.structures),
+        env_donors, env_acceptors, set_atoms.scene_coords, set_atoms.radii.astype(numpy.float64),
+        set_residues, set_structures, set_donors, set_acceptors, sets, num_sets,
+        assumed_max_vdw - clash_threshold, clash_threshold, hbond_allowance=hbond_allowance,
+        count=count, same_structure=same_structure, num_threads=(os.cpu_count() or 1))
+
+def _hbond_roles(atoms):
+    # donor/acceptor flags as find_contacts() assigns them, from the bonds of the whole structures
+    from chimerax.atomic import structure_atoms
+    import numpy
+    universe = structure_atoms(atoms.unique_structures)
+    b1, b2 = universe.intra_bonds.atoms
+    bond_indices = numpy.stack((universe.indices(b1), universe.indices(b2)), axis=1)
+    substituents, geometries = _type_info_arrays(universe)
+    from ._clashes import hbond_atom_roles
+    donors, acceptors = hbond_atom_roles(universe.element_numbers, bond_indices,
+        substituents, geometries)
+    indices = universe.indices(atoms)
+    return donors[indices], acceptors[indices]
+
+def _type_info_arrays(atoms):
+    # IDATM substituents and geometries for each atom, -1 for unknown types
+    from chimerax.atomic.idatm import type_info
+    import numpy
+    idatm_types, type_indices = numpy.unique(atoms.idatm_types, return_inverse=True)
+    substituents = numpy.array([type_info[t].substituents if t in type_info else -1
+        for t in idatm_types], numpy.int32)[type_indices]
+    geometries = numpy.array([type_info[t].geometry if t in type_info else -1
+        for t in idatm_types], numpy.int32)[type_indices]
+    return substituents, geometries
@@ -26,8 +26,11 @@
 
 #include <Python.h>
 #include <algorithm>
-#include <list>
+#include <exception>
 #include <set>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
 #include <atomstruct/Atom.h>
 #include <atomstruct/AtomicStructure.h>
@@ -59,39 +62,82 @@ connect_structure(AtomicStructure* s, float bond_len_tolerance, float metal_coor
 	// correct in multiple coordinate sets
 	const float search_dist = std::max((float)(3.0 + bond_len_tolerance), metal_coord_dist);
 	float search_val = search_dist + bond_len_tolerance;
-	AtomSearchTree  tree(s->atoms(), false, search_val);
-	std::list<std::pair<float,std::pair<Atom*,Atom*>>> possible_bonds;
-	std::set<Atom*> processed;
+	const AtomCellList&  cells = s->cell_list(search_val);
+	typedef std::pair<float,std::pair<Atom*,Atom*>> PossibleBond;
+	typedef std::vector<std::pair<Atom*,Atom*>> AtomPairs;
+	const auto& atoms = s->atoms();
+	// each pair is considered once, from the atom that comes first
+	std::unordered_map<const Atom*, size_t> atom_index;
+	atom_index.reserve(atoms.size());
+	for (size_t i = 0; i < atoms.size(); ++i)
+		atom_index[atoms[i]] = i;
 	bool check_prebonded = s->bonds().size() > 0;
-	for (auto a: s->atoms()) {
-		processed.insert(a);
-		for (auto oa: tree.search(a, search_val)) {
-			if (processed.find(oa) != processed.end())
-				continue;
-			if (check_prebonded && a->connects_to(oa))
-				continue;
-			// if it's a metal-coordination interaction, set up the
-			// pseudobond now and skip it as a covalent bond
-			if (a->element().is_metal() != oa->element().is_metal()) {
-				Atom* nonmetal = a->element().is_metal() ? oa : a;
-				if (nonmetal->element().valence() >= 5) {
-					if (a->coord().distance(oa->coord()) < metal_coord_dist) {
-						auto pbg = s->pb_mgr().get_group(s->PBG_METAL_COORDINATION,
-							AS_PBManager::GRP_PER_CS);
-						pbg->new_pseudobond(a, oa);
+
+	// Find the candidate pairs on several threads, without changing the
+	// structure; bonds and pseudobonds are added afterward on this thread
+	size_t num_threads = std::min((size_t)std::thread::hardware_concurrency(),
+		atoms.size() / 10000 + 1);
+	if (num_threads < 1)
+		num_threads = 1;
+	std::vector<std::vector<PossibleBond>> thread_bonds(num_threads);
+	std::vector<AtomPairs> thread_metal_pairs(num_threads);
+	std::vector<std::exception_ptr> exceptions(num_threads);
+	auto find_pairs = [&](size_t t) {
+		try {
+			size_t begin = atoms.size() * t / num_threads;
+			size_t end = atoms.size() * (t + 1) / num_threads;
+			auto& possible_bonds = thread_bonds[t];
+			auto& metal_pairs = thread_metal_pairs[t];
+			for (size_t i = begin; i < end; ++i) {
+				Atom* a = atoms[i];
+				for (auto oa: cells.search(a, search_val)) {
+					if (atom_index.at(oa) <= i)
+						continue;
+					if (check_prebonded && a->connects_to(oa))
+						continue;
+					// if it's a metal-coordination interaction, set up the
+					// pseudobond and skip it as a covalent bond
+					if (a->element().is_metal() != oa->element().is_metal()) {
+						Atom* nonmetal = a->element().is_metal() ? oa : a;
+						if (nonmetal->element().valence() >= 5) {
+							if (a->coord().distance(oa->coord()) < metal_coord_dist)
+								metal_pairs.emplace_back(a, oa);
+							continue;
+						}
+
+					}
+					float bond_len = Element::bond_length(a->element(), oa->element());
+					float dist = a->coord().distance(oa->coord());
+					if (dist <= bond_len + bond_len_tolerance) {
+						possible_bonds.push_back(std::make_pair(dist - bond_len, std::make_pair(a, oa)));
 					}
-					continue;
 				}
-
-			}
-			float bond_len = Element::bond_length(a->element(), oa->element());
-			float dist = a->coord().distance(oa->coord());
-			if (dist <= bond_len + bond_len_tolerance) {
-				possible_bonds.push_back(std::make_pair(dist - bond_len, std::make_pair(a, oa)));
 			}
+		} catch (...) {
+			exceptions[t] = std::current_exception();
+		}
+	};
+	std::vector<std::thread> threads;
+	for (size_t t = 1; t < num_threads; ++t)
+		threads.emplace_back(find_pairs, t);
+	find_pairs(0);
+	for (auto& th: threads)
+		th.join();
+	for (auto& e: exceptions)
+		if (e)
+			std::rethrow_exception(e);
+
+	for (auto& metal_pairs: thread_metal_pairs) {
+		for (auto& atoms: metal_pairs) {
+			auto pbg = s->pb_mgr().get_group(s->PBG_METAL_COORDINATION,
+				AS_PBManager::GRP_PER_CS);
+			pbg->new_pseudobond(atoms.first, atoms.second);
 		}
 	}
-	possible_bonds.sort();
+	std::vector<PossibleBond> possible_bonds;
+	for (auto& bonds: thread_bonds)
+		possible_bonds.insert(possible_bonds.end(), bonds.begin(), bonds.end());
+	std::sort(possible_bonds.begin(), possible_bonds.end());
 
 	// add bonds between non-saturated atoms
 	for (auto& val_atoms: possible_bonds) {
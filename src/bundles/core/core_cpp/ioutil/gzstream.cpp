@@ -0,0 +1,382 @@
+// vi: set expandtab shiftwidth=4 softtabstop=4:
+
+/*
+ * === UCSF ChimeraX Copyright ===
+ * Copyright 2022 Regents of the University of California. All rights reserved.
+ * The ChimeraX application is provided pursuant to the ChimeraX license
+ * agreement, which covers academic and commercial uses. For more details, see
+ * <http://www.rbvi.ucsf.edu/chimerax/docs/licensing.html>
+ *
+ * This particular file is part of the ChimeraX library. You can also
+ * redistribute and/or modify it under the terms of the GNU Lesser General
+ * Public License version 2.1 as published by the Free Software Foundation.
+ * For more details, see
+ * <https://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESSED OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. ADDITIONAL LIABILITY
+ * LIMITATIONS ARE DESCRIBED IN THE GNU LESSER GENERAL PUBLIC LICENSE
+ * VERSION 2.1
+ *
+ * This notice must be embedded in or attached to all copies, including partial
+ * copies, of the software or any revisions or derivations thereof.
+ * === UCSF ChimeraX Copyright ===
+ */
+
+#include "gzstream.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include <zlib.h>
+#ifdef _WIN32
+# define WIN32_LEAN_AND_MEAN
+# include <windows.h>
+#endif
+
+namespace {
+
+const size_t READ_SIZE = 1 << 22;	// compressed bytes read at a time
+const size_t BLOCK_SIZE = 1 << 22;	// decompressed bytes in a block
+const size_t MAX_QUEUED = 4;		// blocks decompressed ahead of reader
+const size_t MAX_BGZF_MEMBER = 1 << 16;
+const size_t BGZF_BATCH = 256;		// bgzf members decompressed together
+
+FILE *
+open_file(const char *filename)
+{
+#ifdef _WIN32
+    int len = MultiByteToWideChar(CP_UTF8, 0, filename, -1, NULL, 0);
+    std::vector<wchar_t> wfilename(len > 0 ? len : 1);
+    MultiByteToWideChar(CP_UTF8, 0, filename, -1, &wfilename[0], len);
+    return _wfopen(&wfilename[0], L"rb");
+#else
+    return fopen(filename, "rb");
+#endif
+}
+
+std::runtime_error
+zlib_error(const char *what, const z_stream &zs)
+{
+    std::string msg = "gzip decompression failed ";
+    msg += what;
+    if (zs.msg != NULL) {
+        msg += ": ";
+        msg += zs.msg;
+    }
+    return std::runtime_error(msg);
+}
+
+// Size of the bgzf member (a gzip member whose header gives its compressed
+// size) starting at data, or 0 if it is not a bgzf member.
+size_t
+bgzf_member_size(const unsigned char *data, size_t size)
+{
+    // header is ID1 ID2 CM FLG MTIME(4) XFL OS XLEN(2) and then the extra
+    // subfields, one of which is 'B' 'C' SLEN=2 BSIZE(2)
+    if (size < 12 || data[0] != 31 || data[1] != 139 || data[2] != 8 || !(data[3] & 4))
+        return 0;
+    size_t end = 12 + (data[10] | (data[11] << 8));
+    if (end > size)
+        return 0;
+    for (size_t pos = 12; pos + 4 <= end; ) {
+        size_t slen = data[pos+2] | (data[pos+3] << 8);
+        if (data[pos] == 'B' && data[pos+1] == 'C' && slen == 2 && pos + 6 <= end) {
+            size_t member_size = (data[pos+4] | (data[pos+5] << 8)) + 1;
+            // at least the header and the CRC and size trailer
+            return member_size >= end + 8 ? member_size : 0;
+        }
+        pos += 4 + slen;
+    }
+    return 0;
+}
+
+// decompress one whole gzip member whose decompressed size is known
+void
+inflate_member(const unsigned char *data, size_t size, char *out, size_t out_size)
+{
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    if (inflateInit2(&zs, 15 + 16) != Z_OK)
+        throw zlib_error("initializing", zs);
+    char empty;
+    zs.next_in = const_cast<Bytef *>(data);
+    zs.avail_in = size;
+    zs.next_out = reinterpret_cast<Bytef *>(out_size > 0 ? out : &empty);
+    zs.avail_out = out_size > 0 ? out_size : 1;
+    uInt avail_out = zs.avail_out;
+    int status = inflate(&zs, Z_FINISH);
+    if (status != Z_STREAM_END || avail_out - zs.avail_out != out_size) {
+        std::runtime_error err = zlib_error("in bgzf member", zs);
+        inflateEnd(&zs);
+        throw err;
+    }
+    inflateEnd(&zs);
+}
+
+} // namespace
+
+namespace ioutil {
+
+struct gzip_reader::producer {
+    FILE *f = nullptr;
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::deque<std::string> blocks;
+    bool done = false, stop = false;
+    std::exception_ptr error;
+
+    // compressed data, used up to in_pos
+    std::vector<unsigned char> in;
+    size_t in_pos = 0;
+    bool in_eof = false;
+
+    size_t available() const { return in.size() - in_pos; }
+    void fill(size_t want);
+    bool put(std::string &&block);
+    bool inflate_stream();
+    bool inflate_bgzf();
+    void run();
+};
+
+// read until 'want' compressed bytes are available or the end of the file
+void
+gzip_reader::producer::fill(size_t want)
+{
+    if (in_pos > 0) {
+        in.erase(in.begin(), in.begin() + in_pos);
+        in_pos = 0;
+    }
+    while (!in_eof && in.size() < want) {
+        size_t size = in.size();
+        in.resize(size + READ_SIZE);
+        size_t num_read = fread(&in[size], 1, READ_SIZE, f);
+        in.resize(size + num_read);
+        if (num_read < READ_SIZE) {
+            if (ferror(f))
+                throw std::runtime_error("error reading gzip file");
+            in_eof = true;
+        }
+    }
+}
+
+// wait for room and queue a block; false if the reader was destroyed
+bool
+gzip_reader::producer::put(std::string &&block)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    changed.wait(lock, [this] { return blocks.size() < MAX_QUEUED || stop; });
+    if (stop)
+        return false;
+    blocks.push_back(std::move(block));
+    changed.notify_all();
+    return true;
+}
+
+// decompress the gzip member at the start of the input a block at a time
+bool
+gzip_reader::producer::inflate_stream()
+{
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    if (inflateInit2(&zs, 15 + 16) != Z_OK)
+        throw zlib_error("initializing", zs);
+    std::string block(BLOCK_SIZE, '\0');
+    size_t out_size = 0;
+    try {
+        int status = Z_OK;
+        while (status != Z_STREAM_END) {
+            if (available() == 0) {
+                fill(READ_SIZE);
+                if (available() == 0)
+                    throw std::runtime_error("gzip file is truncated");
+            }
+            zs.next_in = &in[in_pos];
+            zs.avail_in = available();
+            zs.next_out = reinterpret_cast<Bytef *>(&block[out_size]);
+            zs.avail_out = BLOCK_SIZE - out_size;
+            status = inflate(&zs, Z_NO_FLUSH);
+            if (status != Z_OK && status != Z_STREAM_END)
+                throw zlib_error("", zs);
+            in_pos = in.size() - zs.avail_in;
+            out_size = BLOCK_SIZE - zs.avail_out;
+            if (out_size == BLOCK_SIZE) {
+                if (!put(std::move(block))) {
+                    inflateEnd(&zs);
+                    return false;
+                }
+                block.assign(BLOCK_SIZE, '\0');
+                out_size = 0;
+            }
+        }
+    } catch (...) {
+        inflateEnd(&zs);
+        throw;
+    }
+    inflateEnd(&zs);
+    block.resize(out_size);
+    return out_size == 0 || put(std::move(block));
+}
+
+// decompress a batch of bgzf members on several threads
+bool
+gzip_reader::producer::inflate_bgzf()
+{
+    fill(BGZF_BATCH * MAX_BGZF_MEMBER);
+    std::vector<size_t> starts, sizes, out_starts;
+    size_t pos = in_pos, total = 0;
+    while (starts.size() < BGZF_BATCH && pos < in.size()) {
+        size_t avail = in.size() - pos;
+        size_t size = bgzf_member_size(&in[pos], avail);
+        if (size == 0 || size > avail)
+            break;
+        // decompressed size is the last 4 bytes
+        const unsigned char *isize = &in[pos + size - 4];
+        starts.push_back(pos);
+        sizes.push_back(size);
+        out_starts.push_back(total);
+        total += isize[0] | (isize[1] << 8) | (isize[2] << 16) | ((size_t)isize[3] << 24);
+        pos += size;
+    }
+    if (starts.empty())
+        // memory holds several whole members unless the file ends
+        throw std::runtime_error("gzip file is truncated");
+    out_starts.push_back(total);
+
+    std::string out(total, '\0');
+    size_t num_members = starts.size();
+    size_t num_threads = std::min((size_t)std::thread::hardware_concurrency(), num_members);
+    if (num_threads < 1)
+        num_threads = 1;
+    std::atomic<size_t> next(0);
+    std::vector<std::exception_ptr> exceptions(num_threads);
+    auto inflate_members = [&](size_t t) {
+        try {
+            for (size_t m = next++; m < num_members; m = next++)
+                inflate_member(&in[starts[m]], sizes[m], &out[0] + out_starts[m],
+                    out_starts[m+1] - out_starts[m]);
+        } catch (...) {
+            exceptions[t] = std::current_exception();
+        }
+    };
+    std::vector<std::thread> threads;
+    for (size_t t = 1; t < num_threads; ++t)
+        threads.emplace_back(inflate_members, t);
+    inflate_members(0);
+    for (auto &th: threads)
+        th.join();
+    for (auto &e: exceptions)
+        if (e)
+            std::rethrow_exception(e);
+    in_pos = pos;
+    return total == 0 || put(std::move(out));
+}
+
+void
+gzip_reader::producer::run()
+{
+    std::exception_ptr err;
+    try {
+        for (bool first = true; ; first = false) {
+            fill(MAX_BGZF_MEMBER);
+            if (available() == 0)
+                break;
+            const unsigned char *data = &in[in_pos];
+            if (available() < 2 || data[0] != 31 || data[1] != 139) {
+                if (first)
+                    throw std::runtime_error("not a gzip file");
+                // like gzip, ignore trailing padding
+                break;
+            }
+            bool more = bgzf_member_size(data, available()) > 0 ? inflate_bgzf() : inflate_stream();
+            if (!more)
+                break;
+        }
+    } catch (...) {
+        err = std::current_exception();
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    error = err;
+    done = true;
+    changed.notify_all();
+}
+
+gzip_reader::gzip_reader(const char *filename): p(new producer)
+{
+    p->f = open_file(filename);
+    if (p->f == nullptr) {
+        std::string msg = std::string("Cannot open ") + filename + ": " + strerror(errno);
+        delete p;
+        throw std::runtime_error(msg);
+    }
+    p->thread = std::thread(&producer::run, p);
+}
+
+gzip_reader::~gzip_reader()
+{
+    {
+        std::lock_guard<std::mutex> lock(p->mutex);
+        p->stop = true;
+        p->changed.notify_all();
+    }
+    p->thread.join();
+    fclose(p->f);
+    delete p;
+}
+
+bool
+gzip_reader::read(std::string &data)
+{
+    std::unique_lock<std::mutex> lock(p->mutex);
+    p->changed.wait(lock, [this] { return !p->blocks.empty() || p->done; });
+    if (!p->blocks.empty()) {
+        if (data.empty())
+            data.swap(p->blocks.front());
+        else
+            data.append(p->blocks.front());
+        p->blocks.pop_front();
+        p->changed.notify_all();
+        return true;
+    }
+    if (p->error) {
+        std::exception_ptr e = p->error;
+        p->error = nullptr;
+        std::rethrow_exception(e);
+    }
+    return false;
+}
+
+bool
+is_gzip_file(const char *filename)
+{
+    FILE *f = open_file(filename);
+    if (f == nullptr)
+        return false;
+    unsigned char magic[2];
+    bool gzip = fread(magic, 1, 2, f) == 2 && magic[0] == 31 && magic[1] == 139;
+    fclose(f);
+    return gzip;
+}
+
+std::string
+read_gzip_file(const char *filename)
+{
+    gzip_reader reader(filename);
+    std::string data;
+    while (reader.read(data))
+        continue;
+    return data;
+}
+
+} // namespace ioutil
@@ -0,0 +1,60 @@
+// vi: set expandtab shiftwidth=4 softtabstop=4:
+
+/*
+ * === UCSF ChimeraX Copyright ===
+ * Copyright 2022 Regents of the University of California. All rights reserved.
+ * The ChimeraX application is provided pursuant to the ChimeraX license
+ * agreement, which covers academic and commercial uses. For more details, see
+ * <http://www.rbvi.ucsf.edu/chimerax/docs/licensing.html>
+ *
+ * This particular file is part of the ChimeraX library. You can also
+ * redistribute and/or modify it under the terms of the GNU Lesser General
+ * Public License version 2.1 as published by the Free Software Foundation.
+ * For more details, see
+ * <https://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESSED OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. ADDITIONAL LIABILITY
+ * LIMITATIONS ARE DESCRIBED IN THE GNU LESSER GENERAL PUBLIC LICENSE
+ * VERSION 2.1
+ *
+ * This notice must be embedded in or attached to all copies, including partial
+ * copies, of the software or any revisions or derivations thereof.
+ * === UCSF ChimeraX Copyright ===
+ */
+
+#ifndef ioutil_gzstream_h
+# define ioutil_gzstream_h
+
+# include <string>
+
+namespace ioutil {
+
+// whether the file starts with the gzip magic number
+bool is_gzip_file(const char *filename);
+
+// Decompresses a gzip file on a background thread a block at a time, so
+// reading and decompressing overlap with the caller parsing the blocks
+// already read.  Files in the bgzf format written by bgzip, gzip members
+// that each give their compressed size, have batches of members
+// decompressed on several threads.  Errors are thrown as std::runtime_error.
+class gzip_reader {
+public:
+    explicit gzip_reader(const char *filename);
+    ~gzip_reader();
+    // append the next block of decompressed data; false at the end of the file
+    bool read(std::string &data);
+private:
+    gzip_reader(const gzip_reader &) = delete;
+    gzip_reader &operator=(const gzip_reader &) = delete;
+    struct producer;
+    producer *p;
+};
+
+// whole decompressed contents of a gzip file
+std::string read_gzip_file(const char *filename);
+
+} // namespace ioutil
+
+#endif
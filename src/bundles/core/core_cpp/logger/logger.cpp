@@ -26,8 +26,11 @@
 
 #include <cctype>
 #include <iostream>
+#include <map>
 #include <stdexcept>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "Python.h"
 #define LOGGER_EXPORT
@@ -65,13 +68,14 @@ py_exception_msg()
     return std::string(utf8_val);
 }
 
-void  _log(PyObject* logger, std::stringstream& msg, _LogLevel level, bool is_html)
+static void
+send(PyObject* logger, const std::string& msg, _LogLevel level, bool is_html)
 {
     if (logger == nullptr || logger == Py_None) {
         if (level == _LogLevel::ERROR)
-            std::cerr << msg.str() << "\n";
+            std::cerr << msg << "\n";
         else
-            std::cout << msg.str() << "\n";
+            std::cout << msg << "\n";
     } else {
         // Python logging
         AcquireGIL gil;   // guarantee that we can call Python functions
@@ -96,7 +100,7 @@ void  _log(PyObject* logger, std::stringstream& msg, _LogLevel level, bool is_ht
             throw std::invalid_argument(err_msg.str());
         }
         std::string sanitized_string;
-        for (auto c: msg.str()) {
+        for (auto c: msg) {
             if (std::isprint(c) || std::isspace(c))
                 sanitized_string.push_back(c);
             else
@@ -145,4 +149,113 @@ void  _log(PyObject* logger, std::stringstream& msg, _LogLevel level, bool is_ht
     }
 }
 
+// innermost BufferedLog of the calling thread
+static thread_local BufferedLog* buffered_log = nullptr;
+
+struct BufferedLog::Messages {
+    PyObject*  logger;
+    std::size_t  max_similar, max_messages;
+    struct Message {
+        _LogLevel  level;
+        bool  is_html;
+        std::string  text;
+    };
+    std::vector<Message>  shown;
+    // similar messages: level and first part of message -> number logged
+    std::map<std::pair<_LogLevel, std::string>, std::size_t>  similar;
+    std::size_t  not_shown = 0;
+};
+
+BufferedLog::BufferedLog(PyObject* logger, std::size_t max_similar, std::size_t max_messages):
+    _messages(new Messages), _outer(buffered_log)
+{
+    _messages->logger = logger;
+    _messages->max_similar = max_similar;
+    _messages->max_messages = max_messages;
+    buffered_log = this;
+}
+
+BufferedLog::~BufferedLog()
+{
+    try {
+        flush();
+    } catch (...) {
+        // can't report a failure to log from a destructor
+    }
+    buffered_log = _outer;
+    delete _messages;
+}
+
+void
+BufferedLog::flush()
+{
+    Messages* m = _messages;
+    std::vector<Messages::Message> shown;
+    shown.swap(m->shown);
+    for (auto& sim: m->similar) {
+        if (sim.second <= m->max_similar)
+            continue;
+        std::stringstream count_msg;
+        count_msg << (sim.second - m->max_similar) << " more messages like \""
+            << sim.first.second << "...\"";
+        shown.push_back(Messages::Message{sim.first.first, false, count_msg.str()});
+    }
+    m->similar.clear();
+    if (m->not_shown > 0) {
+        std::stringstream count_msg;
+        count_msg << m->not_shown << " more messages not shown";
+        shown.push_back(Messages::Message{_LogLevel::WARNING, false, count_msg.str()});
+        m->not_shown = 0;
+    }
+    if (shown.size() == 0)
+        return;
+
+    // a Python error being raised when the reader gave up must survive
+    // the logging calls
+    bool is_python = m->logger != nullptr && m->logger != Py_None;
+    PyObject *err_type = nullptr, *err_val = nullptr, *err_trace = nullptr;
+    AcquireGIL gil;
+    if (is_python)
+        PyErr_Fetch(&err_type, &err_val, &err_trace);
+    try {
+        for (std::size_t i = 0; i < shown.size(); ) {
+            auto& first = shown[i];
+            std::string text = first.text;
+            for (++i; i < shown.size() && shown[i].level == first.level
+            && shown[i].is_html == first.is_html; ++i)
+                text += (first.is_html ? "<br>\n" : "\n") + shown[i].text;
+            send(m->logger, text, first.level, first.is_html);
+        }
+    } catch (...) {
+        if (is_python)
+            PyErr_Restore(err_type, err_val, err_trace);
+        throw;
+    }
+    if (is_python)
+        PyErr_Restore(err_type, err_val, err_trace);
+}
+
+void  _log(PyObject* logger, std::stringstream& msg, _LogLevel level, bool is_html,
+    std::string::size_type similar_length)
+{
+    BufferedLog* bl = buffered_log;
+    while (bl != nullptr && bl->_messages->logger != logger)
+        bl = bl->_outer;
+    if (bl == nullptr) {
+        send(logger, msg.str(), level, is_html);
+        return;
+    }
+
+    auto m = bl->_messages;
+    std::string text = msg.str();
+    auto& count = m->similar[std::make_pair(level, text.substr(0, similar_length))];
+    if (++count > m->max_similar)
+        return;
+    if (m->shown.size() >= m->max_messages) {
+        ++m->not_shown;
+        return;
+    }
+    m->shown.push_back(BufferedLog::Messages::Message{level, is_html, text});
+}
+
 } // namespace logger
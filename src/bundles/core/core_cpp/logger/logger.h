@@ -27,6 +27,7 @@
 #ifndef cpp_logger_Logger
 #define cpp_logger_Logger
 
+#include <cstddef>
 #include <sstream>
 #include <string>
 
@@ -49,51 +50,47 @@ namespace logger {
 #endif
 enum class _LogLevel { INFO, WARNING, ERROR };
 
-void  _log(PyObject* logger, std::stringstream& msg, _LogLevel level, bool is_html=false);
+// 'similar_length' is the length of the first part of the message, which
+// is the same for similar messages
+void  _log(PyObject* logger, std::stringstream& msg, _LogLevel level, bool is_html=false,
+    std::string::size_type similar_length=std::string::npos);
+
+inline void  _format(std::stringstream&) {}
 template<typename T, typename... Args>
-void  _log(PyObject* logger, std::stringstream& msg, _LogLevel level,
-    T value, Args... args)
+void  _format(std::stringstream& msg, T value, Args... args)
 {
     msg << value;
-    _log(logger, msg, level, args...);
+    _format(msg, args...);
 }
 
-// 'logger' arg can be nullptr
-
 template<typename T, typename... Args>
-void  info(PyObject* logger, T value, Args... args)
+void  _log(PyObject* logger, _LogLevel level, bool is_html, T value, Args... args)
 {
     std::stringstream msg;
     msg << value;
-    _log(logger, msg, _LogLevel::INFO, args...);
+    std::string::size_type similar_length = msg.str().size();
+    _format(msg, args...);
+    _log(logger, msg, level, is_html, similar_length);
 }
 
+// 'logger' arg can be nullptr
+
 template<typename T, typename... Args>
-void  warning(PyObject* logger, T value, Args... args)
+void  info(PyObject* logger, T value, Args... args)
 {
-    std::stringstream msg;
-    msg << value;
-    _log(logger, msg, _LogLevel::WARNING, args...);
+    _log(logger, _LogLevel::INFO, false, value, args...);
 }
 
 template<typename T, typename... Args>
-void  error(PyObject* logger, T value, Args... args)
+void  warning(PyObject* logger, T value, Args... args)
 {
-    std::stringstream msg;
-    msg << value;
-    _log(logger, msg, _LogLevel::ERROR, args...);
-}
-
-inline void  _html_log(PyObject* logger, std::stringstream& msg, _LogLevel level) {
-    _log(logger, msg, level, true);
+    _log(logger, _LogLevel::WARNING, false, value, args...);
 }
 
 template<typename T, typename... Args>
-void  _html_log(PyObject* logger, std::stringstream& msg, _LogLevel level,
-    T value, Args... args)
+void  error(PyObject* logger, T value, Args... args)
 {
-    msg << value;
-    _html_log(logger, msg, level, args...);
+    _log(logger, _LogLevel::ERROR, false, value, args...);
 }
 
 // 'logger' arg can be nullptr
@@ -101,27 +98,49 @@ void  _html_log(PyObject* logger, std::stringstream& msg, _LogLevel level,
 template<typename T, typename... Args>
 void  html_info(PyObject* logger, T value, Args... args)
 {
-    std::stringstream msg;
-    msg << value;
-    _html_log(logger, msg, _LogLevel::INFO, args...);
+    _log(logger, _LogLevel::INFO, true, value, args...);
 }
 
 template<typename T, typename... Args>
 void  html_warning(PyObject* logger, T value, Args... args)
 {
-    std::stringstream msg;
-    msg << value;
-    _html_log(logger, msg, _LogLevel::WARNING, args...);
+    _log(logger, _LogLevel::WARNING, true, value, args...);
 }
 
 template<typename T, typename... Args>
 void  html_error(PyObject* logger, T value, Args... args)
 {
-    std::stringstream msg;
-    msg << value;
-    _html_log(logger, msg, _LogLevel::ERROR, args...);
+    _log(logger, _LogLevel::ERROR, true, value, args...);
 }
 
+// Hold the messages the calling thread logs to 'logger' while a BufferedLog
+// for it exists, and send them to the logger when the BufferedLog is destroyed
+// or flush() is called, with consecutive messages of the same level and kind
+// joined into one logger call.  A reader making one per file logs its
+// warnings in a few Python calls instead of one per problem found.
+//
+// Messages that start with the same first argument (usually the literal text
+// of the message) are similar.  Only 'max_similar' of them are shown, followed
+// by a count of the rest, and at most 'max_messages' messages are shown in all.
+//
+// Since this library is linked statically, only messages logged by code in
+// the same shared library as the BufferedLog are held.
+class BufferedLog {
+public:
+    BufferedLog(PyObject* logger, std::size_t max_similar = 10,
+        std::size_t max_messages = 1000);
+    ~BufferedLog();
+    void  flush();
+private:
+    BufferedLog(const BufferedLog&) = delete;
+    BufferedLog&  operator=(const BufferedLog&) = delete;
+    friend void  _log(PyObject*, std::stringstream&, _LogLevel, bool,
+        std::string::size_type);
+    struct Messages;
+    Messages*  _messages;
+    BufferedLog*  _outer;
+};
+
 } //  namespace logger
 
 #endif  // cpp_logger_Logger
@@ -116,7 +116,8 @@ def _encode_ndarray(o):
         b'kind': kind,
         b'dtype': dtype,
         b'shape': list(o.shape),
-        b'data': o.tobytes()
+        # Contiguous arrays are packed from their buffer without a copy.
+        b'data': o.data if o.flags.c_contiguous else o.tobytes()
     }
 
 
@@ -153,7 +153,8 @@ cdef dict _encode_ndarray(object o):
         b'kind': kind,
         b'dtype': dtype,
         b'shape': list(o.shape),
-        b'data': o.tobytes()
+        # Contiguous arrays are packed from their buffer without a copy.
+        b'data': o.data if o.flags.c_contiguous else o.tobytes()
     }
 
 
@@ -773,7 +773,7 @@ class _Part:
                         elif not ic and start_ic:
                             return False
                         else:
-                            return ic <= start_ic
+                            return start_ic <= ic
             else:
                 # :N-M
                 def matcher(seq, ic):
@@ -783,13 +783,24 @@ class _Part:
                         return True
                     elif seq == start_seq:
                         if not ic and not start_ic:
-                            return True
+                            after_start = True
                         elif ic and not start_ic:
-                            return True
+                            after_start = True
                         elif not ic and start_ic:
+                            after_start = False
+                        else:
+                            after_start = start_ic <= ic
+                        if not after_start or seq < end_seq:
+                            return after_start
+                        # seq == start_seq == end_seq, also check end
+                        if not ic and not end_ic:
+                            return True
+                        elif ic and not end_ic:
                             return False
+                        elif not ic and end_ic:
+                            return True
                         else:
-                            return start_ic <= ic
+                            return ic <= end_ic
                     else:   # seq == end_seq
                         if not ic and not end_ic:
                             return True
@@ -801,6 +812,19 @@ class _Part:
                             return ic <= end_ic
         return matcher
 
+    def res_id_range(self):
+        # Residue id range as (start_seq, start_ic, is_range, end_seq, end_ic)
+        # for matching in C++, with None for "start" or "end" sequence numbers,
+        # or None if the part is not a residue id.
+        try:
+            start_seq, start_ic = self._parse_as_res_id(self.start, True)
+            if self.end is None:
+                return (start_seq, start_ic or "", False, None, "")
+            end_seq, end_ic = self._parse_as_res_id(self.end, False)
+        except (ValueError, IndexError):
+            return None
+        return (start_seq, start_ic or "", True, end_seq, end_ic or "")
+
     def _parse_as_res_id(self, n, at_start):
         if at_start:
             if n.lower() == "start":
@@ -857,12 +881,13 @@ class _AttrTest:
         import operator
         attr_name = self.name
         if self.value is None:
+            invert = (self.op == operator.not_)
             def matcher(obj):
                 try:
                     v = getattr(obj, attr_name)
                 except AttributeError:
                     return False
-                return bool(v)
+                return not v if invert else bool(v)
         elif (self.op in (operator.eq, operator.ne, "==", "!==") and
                 isinstance(self.value, str)):
             # Equality-comparison operators for strings handle wildcards
@@ -973,9 +998,19 @@ class _ZoneSelector:
         if my_results.num_atoms > 0:
             # expand my_results before combining with results
             coords = my_results.atoms.scene_coords
+            # Models with an atomspec_zones class method, such as atomic
+            # structures, find the zones of all their models in one call.
+            batched = {}
             for m in session.models.list():
-                m.atomspec_zone(session, coords, self.distance,
-                                self.target_type, self.operator, zone_results)
+                zones = getattr(m, 'atomspec_zones', None)
+                if zones is None:
+                    m.atomspec_zone(session, coords, self.distance,
+                                    self.target_type, self.operator, zone_results)
+                else:
+                    batched.setdefault(zones, []).append(m)
+            for zones, zmodels in batched.items():
+                zones(session, zmodels, coords, self.distance,
+                      self.target_type, self.operator, zone_results)
         results.combine(zone_results)
         if '<' in self.operator:
             results.combine(my_results)
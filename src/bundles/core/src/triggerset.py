@@ -130,6 +130,27 @@ def set_exception_reporter(f):
     return old
 
 
+_timeline_span = None
+
+
+def set_timeline_span(span):
+    """Record trigger activations on a timeline.
+
+    span is called with a name and returns a context manager timing
+    the activation, or is None to stop recording.
+    """
+    global _timeline_span
+    _timeline_span = span
+
+
+def timeline_span(name):
+    """Context manager timing a named span if a timeline is being recorded."""
+    if _timeline_span is None:
+        from contextlib import nullcontext
+        return nullcontext()
+    return _timeline_span(name)
+
+
 class _TriggerHandler:
     """Describes callback routine registered with _Trigger"""
 
@@ -390,7 +411,11 @@ class TriggerSet:
             if not absent_okay:
                 raise
         else:
-            trigger.activate(data)
+            if _timeline_span is None:
+                trigger.activate(data)
+            else:
+                with _timeline_span('trigger ' + name):
+                    trigger.activate(data)
 
     @contextmanager
     def block_trigger(self, name):
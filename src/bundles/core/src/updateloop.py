@@ -41,6 +41,9 @@ class UpdateLoop:
         self._last_timer_start_time = self._last_timer_finish_time = 0
         self._timer = None
 
+        # Deferrable per-frame work run within the frame time.
+        self.frame_jobs = FrameScheduler(self)
+
     def draw_new_frame(self):
         '''
         Draw the scene if it has changed or camera or rendering options have changed.
@@ -60,18 +63,21 @@ class UpdateLoop:
         view = session.main_view
         self.block_redraw()
         from time import time
+        from .triggerset import timeline_span
         try:
-            t0 = time()
+            frame_start = t0 = time()
             session.triggers.activate_trigger('new frame', self)
             self.last_new_frame_time = time() - t0
             from chimerax import atomic
             t0 = time()
-            atomic.check_for_changes(session)
+            with timeline_span('check for changes'):
+                atomic.check_for_changes(session)
             self.last_atomic_check_for_changes_time = time() - t0
             from chimerax import surface
             t0 = time()
             surface.update_clip_caps(view)
             self.last_clip_time = time() - t0
+            self.frame_jobs.run(frame_start)
             t0 = time()
             changed = view.check_for_drawing_change()
             self.last_drawing_change_time = time() - t0
@@ -81,7 +87,8 @@ class UpdateLoop:
                     if ((session.ui.is_gui and session.ui.main_window.graphics_window.is_drawable)
                         or getattr(view.camera, 'always_draw', False)):
                         t0 = time()
-                        view.draw(check_for_changes = False)
+                        with timeline_span('draw'):
+                            view.draw(check_for_changes = False)
                         self.last_draw_time = time() - t0
                         drew = True
                 except OpenGLVersionError as e:
@@ -157,6 +164,7 @@ class UpdateLoop:
         if t:
             t.stop()
             self._timer = None
+        self.frame_jobs.clear()
         self.block_redraw()
 
     def update_graphics_now(self):
@@ -167,3 +175,170 @@ class UpdateLoop:
         surface level change.  After each mouse event this is called to force a redraw.
         '''
         self.draw_new_frame()
+
+
+class FrameJob:
+    '''
+    Incremental work that can be spread over several frames, such as updating
+    labels or surfaces after coordinates change.  Subclasses define step() to
+    do part of the work, returning True when the job is finished.  If
+    threaded is true, compute() instead runs in a worker thread, typically
+    calling C++ code that releases the Python global interpreter lock,
+    and finish(result) then runs in the main thread, returning True when
+    done or False to compute again.
+
+    The cost is the estimated seconds for one step, and is replaced by the
+    measured step times as the job runs.  Jobs with lower priority values
+    run first.
+    '''
+    name = 'frame job'
+    threaded = False
+
+    def __init__(self, cost = 0.001, priority = 0):
+        self.cost = cost
+        self.priority = priority
+
+    def step(self):
+        return True
+
+    def compute(self):
+        return None
+
+    def finish(self, result):
+        return True
+
+    def cancel(self):
+        pass
+
+
+class FrameScheduler:
+    '''
+    Runs FrameJob steps after the scene changes are checked and before each
+    frame is drawn, for up to frame_time_fraction of the redraw interval
+    counting from the start of the frame.  Jobs run in priority order, each
+    step only if its estimated cost fits the time left, except that at least
+    one step is run each frame so slow jobs still progress.  At most
+    max_job_threads threaded jobs compute at once.  Each usually calls C++
+    code that already uses the shared thread pool limited by
+    chimerax.arrays.max_threads(), so more job threads would just compete
+    for the same cores.  Without a graphical user interface frames may never
+    be drawn, so jobs are run to completion when added.
+    '''
+    max_job_threads = 2
+
+    def __init__(self, update_loop):
+        self._update_loop = update_loop
+        self._jobs = []
+        self._running = {}		# Threaded job -> Future
+        self._executor = None
+        self.frame_time_fraction = 0.5
+        self.last_run_time = 0
+        self.last_deferred_count = 0
+
+    def add_job(self, job):
+        if job in self._jobs:
+            return
+        if not self._update_loop.session.ui.is_gui:
+            self._run_to_completion(job)
+            return
+        self._jobs.append(job)
+        self._jobs.sort(key = lambda j: j.priority)	# Stable, earlier jobs first.
+
+    def remove_job(self, job):
+        if job in self._jobs:
+            self._jobs.remove(job)
+            future = self._running.pop(job, None)
+            if future is not None:
+                future.cancel()
+            job.cancel()
+
+    def has_job(self, job):
+        return job in self._jobs
+
+    @property
+    def jobs(self):
+        return tuple(self._jobs)
+
+    def clear(self):
+        for job in tuple(self._jobs):
+            self.remove_job(job)
+        e = self._executor
+        if e:
+            e.shutdown(wait = False, cancel_futures = True)
+            self._executor = None
+
+    def run(self, frame_start):
+        if not self._jobs:
+            self.last_run_time = 0
+            self.last_deferred_count = 0
+            return
+        from time import time
+        t0 = time()
+        end = frame_start + self.frame_time_fraction * self._update_loop.redraw_interval / 1000
+        ran_step = False
+        deferred = 0
+        for job in tuple(self._jobs):
+            if job not in self._jobs:
+                continue	# Removed by another job.
+            if job.threaded:
+                ready = self._threaded_ready(job)
+                if ready is None:
+                    continue	# Still computing.
+            else:
+                ready = False
+            if ran_step and time() + job.cost > end:
+                deferred += 1
+                continue
+            done = self._run_step(job, ready)
+            ran_step = True
+            if done:
+                self._jobs.remove(job)
+        self.last_run_time = time() - t0
+        self.last_deferred_count = deferred
+
+    def _threaded_ready(self, job):
+        future = self._running.get(job)
+        if future is None:
+            self._running[job] = self._thread_executor().submit(job.compute)
+            return None
+        return future if future.done() else None
+
+    def _run_step(self, job, future):
+        from time import time
+        from .triggerset import timeline_span
+        t0 = time()
+        try:
+            with timeline_span(job.name):
+                if future:
+                    del self._running[job]
+                    done = job.finish(future.result())
+                else:
+                    done = job.step()
+        except Exception:
+            # Drop the failing job so the error is not reported every frame.
+            self._running.pop(job, None)
+            self._update_loop.session.logger.report_exception(
+                'Error in frame job %s' % job.name)
+            return True
+        # Running average of step times.
+        job.cost = 0.75 * job.cost + 0.25 * (time() - t0)
+        return done
+
+    def _run_to_completion(self, job):
+        try:
+            if job.threaded:
+                while not job.finish(job.compute()):
+                    pass
+            else:
+                while not job.step():
+                    pass
+        except Exception:
+            self._update_loop.session.logger.report_exception(
+                'Error in frame job %s' % job.name)
+
+    def _thread_executor(self):
+        if self._executor is None:
+            from concurrent.futures import ThreadPoolExecutor
+            self._executor = ThreadPoolExecutor(max_workers = self.max_job_threads,
+                                                thread_name_prefix = 'frame job')
+        return self._executor
@@ -27,33 +27,246 @@
 #include <Python.h>
 #include <algorithm>    // std::min
 #include <math.h>
-#include <thread>
 #include <vector>
 
 #include <arrays/pythonarray.h>		// use parse_float_n3_array, ...
+#include <arrays/threadpool.h>		// use Thread_Pool::run
 
+// Atom coordinates and charges in separate arrays so the loop over atoms
+// for a block of target points vectorizes.
+class Charges {
+public:
+    std::vector<float> x, y, z, q;
+
+    Charges(const float* coords, const float* charges, int64_t num_atoms):
+        x(num_atoms), y(num_atoms), z(num_atoms), q(charges, charges + num_atoms) {
+        for (int64_t j = 0; j < num_atoms; ++j) {
+            x[j] = coords[3*j];
+            y[j] = coords[3*j+1];
+            z[j] = coords[3*j+2];
+        }
+    }
+    int64_t size() const { return q.size(); }
+};
+
+// Sum of charge / distance (or distance squared if dist_dep) at up to BLOCK
+// target points for atoms j0 to j1-1.  Each target's sum is accumulated in
+// atom order, the same as one target at a time.
+static const int BLOCK = 8;
 static void
-initiate_compute_esp(float* target_points, float* values, int64_t num_points, float* atom_coords,
-        float* charges, int64_t num_atoms, bool dist_dep, float dielectric)
+block_esp(const float* target_points, int nt, const Charges& c, int64_t j0, int64_t j1,
+        bool dist_dep, float* esp)
+{
+    float tx[BLOCK], ty[BLOCK], tz[BLOCK], e[BLOCK];
+    for (int k = 0; k < BLOCK; ++k) {
+        int kt = (k < nt ? k : nt-1);
+        tx[k] = target_points[3*kt];
+        ty[k] = target_points[3*kt+1];
+        tz[k] = target_points[3*kt+2];
+        e[k] = 0.0;
+    }
+    const float *x = c.x.data(), *y = c.y.data(), *z = c.z.data(), *q = c.q.data();
+    for (int64_t j = j0; j < j1; ++j) {
+        float ax = x[j], ay = y[j], az = z[j], aq = q[j];
+        if (dist_dep) {
+            for (int k = 0; k < BLOCK; ++k) {
+                float dx = ax - tx[k], dy = ay - ty[k], dz = az - tz[k];
+                e[k] += aq / (dx*dx + dy*dy + dz*dz);
+            }
+        } else {
+            for (int k = 0; k < BLOCK; ++k) {
+                float dx = ax - tx[k], dy = ay - ty[k], dz = az - tz[k];
+                e[k] += aq / sqrtf(dx*dx + dy*dy + dz*dz);
+            }
+        }
+    }
+    for (int k = 0; k < nt; ++k)
+        esp[k] = e[k];
+}
+
+static void
+initiate_compute_esp(const float* target_points, float* values, int64_t num_points,
+        const Charges& charges, bool dist_dep, float dielectric)
 {
     float conv_factor = 331.62 / dielectric;
-    for (int64_t i = 0; i < num_points; ++i, ++values, target_points+=3) {
-        float tx = *target_points;
-        float ty = *(target_points + 1);
-        float tz = *(target_points + 2);
-        float esp = 0.0;
-        auto cur_charge = charges;
-        auto cur_coord = atom_coords;
-        for (int j = 0; j < num_atoms; ++j, ++cur_charge, cur_coord+=3) {
-            float dx = *cur_coord - tx;
-            float dy = *(cur_coord + 1) - ty;
-            float dz = *(cur_coord + 2) - tz;
-            float dval = dx*dx + dy*dy + dz*dz;
-            if (!dist_dep)
-                dval = sqrt(dval);
-            esp += *cur_charge / dval;
+    float esp[BLOCK];
+    for (int64_t i = 0; i < num_points; i += BLOCK) {
+        int nt = (int)std::min((int64_t)BLOCK, num_points - i);
+        block_esp(target_points + 3*i, nt, charges, 0, charges.size(), dist_dep, esp);
+        for (int k = 0; k < nt; ++k)
+            values[i+k] = esp[k] * conv_factor;
+    }
+}
+
+// Binary tree of atom clusters.  Distant clusters contribute through a Taylor
+// expansion about the cluster center up to second order (charge, dipole and
+// second moments of the charge distribution).  Atoms are reordered so each
+// cluster is a contiguous range.
+class Charge_Tree {
+public:
+    struct Node {
+        double center[3], radius;
+        double charge, dipole[3], moment[6];  // moment xx, yy, zz, xy, xz, yz
+        int64_t start, end;             // atom range
+        int64_t child[2];               // child nodes, -1 for a leaf
+    };
+    Charges atoms;
+    std::vector<Node> nodes;
+
+    Charge_Tree(const float* coords, const float* charges, int64_t num_atoms):
+            atoms(coords, charges, num_atoms) {
+        std::vector<int64_t> order(num_atoms);
+        for (int64_t j = 0; j < num_atoms; ++j)
+            order[j] = j;
+        nodes.reserve(2 * (num_atoms / LEAF_SIZE + 1));
+        _split(order, 0, num_atoms, coords);
+        Charges sorted = atoms;
+        for (int64_t j = 0; j < num_atoms; ++j) {
+            int64_t o = order[j];
+            sorted.x[j] = atoms.x[o];
+            sorted.y[j] = atoms.y[o];
+            sorted.z[j] = atoms.z[o];
+            sorted.q[j] = atoms.q[o];
         }
-        *values = esp * conv_factor;
+        atoms = std::move(sorted);
+        for (auto& n: nodes)
+            _set_moments(n);
+    }
+
+    // Potential sums at a block of target points, with cluster expansions used
+    // when cluster radius / distance < theta.
+    void esp(const float* target_points, int nt, double theta, bool dist_dep,
+            float* esp) const {
+        double sums[BLOCK];
+        for (int k = 0; k < nt; ++k)
+            sums[k] = 0;
+        if (nodes.empty()) {
+            for (int k = 0; k < nt; ++k)
+                esp[k] = 0;
+            return;
+        }
+        float leaf_esp[BLOCK];
+        std::vector<int64_t> stack;
+        stack.push_back(0);
+        double theta2 = theta * theta;
+        while (!stack.empty()) {
+            const Node& n = nodes[stack.back()];
+            stack.pop_back();
+            bool all_far = true;
+            for (int k = 0; k < nt && all_far; ++k) {
+                const float* t = target_points + 3*k;
+                double dx = n.center[0] - t[0], dy = n.center[1] - t[1], dz = n.center[2] - t[2];
+                if (n.radius * n.radius >= theta2 * (dx*dx + dy*dy + dz*dz))
+                    all_far = false;
+            }
+            if (all_far) {
+                for (int k = 0; k < nt; ++k)
+                    sums[k] += _expansion(n, target_points + 3*k, dist_dep);
+            } else if (n.child[0] < 0) {
+                block_esp(target_points, nt, atoms, n.start, n.end, dist_dep, leaf_esp);
+                for (int k = 0; k < nt; ++k)
+                    sums[k] += leaf_esp[k];
+            } else {
+                stack.push_back(n.child[1]);
+                stack.push_back(n.child[0]);
+            }
+        }
+        for (int k = 0; k < nt; ++k)
+            esp[k] = sums[k];
+    }
+
+private:
+    static const int64_t LEAF_SIZE = 32;
+
+    // Split atoms at the median along the longest axis of their bounding box.
+    int64_t _split(std::vector<int64_t>& order, int64_t start, int64_t end, const float* coords) {
+        int64_t ni = nodes.size();
+        nodes.push_back(Node());
+        nodes[ni].start = start;
+        nodes[ni].end = end;
+        nodes[ni].child[0] = nodes[ni].child[1] = -1;
+        if (end - start <= LEAF_SIZE)
+            return ni;
+        float xmin[3], xmax[3];
+        for (int a = 0; a < 3; ++a)
+            xmin[a] = xmax[a] = coords[3*order[start]+a];
+        for (int64_t j = start+1; j < end; ++j)
+            for (int a = 0; a < 3; ++a) {
+                float v = coords[3*order[j]+a];
+                if (v < xmin[a]) xmin[a] = v;
+                else if (v > xmax[a]) xmax[a] = v;
+            }
+        int axis = 0;
+        for (int a = 1; a < 3; ++a)
+            if (xmax[a] - xmin[a] > xmax[axis] - xmin[axis])
+                axis = a;
+        int64_t mid = (start + end) / 2;
+        std::nth_element(order.begin() + start, order.begin() + mid, order.begin() + end,
+            [coords, axis](int64_t a, int64_t b) { return coords[3*a+axis] < coords[3*b+axis]; });
+        int64_t c0 = _split(order, start, mid, coords);
+        int64_t c1 = _split(order, mid, end, coords);
+        nodes[ni].child[0] = c0;
+        nodes[ni].child[1] = c1;
+        return ni;
+    }
+
+    void _set_moments(Node& n) const {
+        double c[3] = {0, 0, 0};
+        int64_t na = n.end - n.start;
+        for (int64_t j = n.start; j < n.end; ++j) {
+            c[0] += atoms.x[j];
+            c[1] += atoms.y[j];
+            c[2] += atoms.z[j];
+        }
+        for (int a = 0; a < 3; ++a)
+            n.center[a] = c[a] / na;
+        n.radius = n.charge = 0;
+        for (int a = 0; a < 3; ++a)
+            n.dipole[a] = 0;
+        for (int a = 0; a < 6; ++a)
+            n.moment[a] = 0;
+        for (int64_t j = n.start; j < n.end; ++j) {
+            double sx = atoms.x[j] - n.center[0], sy = atoms.y[j] - n.center[1],
+                sz = atoms.z[j] - n.center[2], q = atoms.q[j];
+            double r2 = sx*sx + sy*sy + sz*sz;
+            if (r2 > n.radius)
+                n.radius = r2;
+            n.charge += q;
+            n.dipole[0] += q*sx; n.dipole[1] += q*sy; n.dipole[2] += q*sz;
+            n.moment[0] += q*sx*sx; n.moment[1] += q*sy*sy; n.moment[2] += q*sz*sz;
+            n.moment[3] += q*sx*sy; n.moment[4] += q*sx*sz; n.moment[5] += q*sy*sz;
+        }
+        n.radius = sqrt(n.radius);
+    }
+
+    // Second order Taylor expansion of sum q / r^p over the cluster atoms, p = 1
+    // or 2 (dist_dep), about the cluster center.
+    static double _expansion(const Node& n, const float* t, bool dist_dep) {
+        double dx = n.center[0] - t[0], dy = n.center[1] - t[1], dz = n.center[2] - t[2];
+        double r2 = dx*dx + dy*dy + dz*dz;
+        double p = (dist_dep ? 2 : 1);
+        double f = (dist_dep ? 1 / r2 : 1 / sqrt(r2));     // r^-p
+        double g = f / r2;                                  // r^-(p+2)
+        const double* m = n.moment;
+        double dd = dx*n.dipole[0] + dy*n.dipole[1] + dz*n.dipole[2];
+        double dmd = dx*dx*m[0] + dy*dy*m[1] + dz*dz*m[2]
+            + 2 * (dx*dy*m[3] + dx*dz*m[4] + dy*dz*m[5]);
+        double trace = m[0] + m[1] + m[2];
+        return n.charge * f - p * g * dd + 0.5 * p * g * ((p + 2) * dmd / r2 - trace);
+    }
+};
+
+static void
+initiate_compute_esp_approx(const float* target_points, float* values, int64_t num_points,
+        const Charge_Tree& tree, double theta, bool dist_dep, float dielectric)
+{
+    float conv_factor = 331.62 / dielectric;
+    float esp[BLOCK];
+    for (int64_t i = 0; i < num_points; i += BLOCK) {
+        int nt = (int)std::min((int64_t)BLOCK, num_points - i);
+        tree.esp(target_points + 3*i, nt, theta, dist_dep, esp);
+        for (int k = 0; k < nt; ++k)
+            values[i+k] = esp[k] * conv_factor;
     }
 }
 
@@ -62,69 +275,179 @@ potential_at_points(PyObject*, PyObject* args)
 {
     FArray target_points, atom_coords, charges, values;
     int py_dist_dep, num_cpus;
-    float dielectric;
-    if (!PyArg_ParseTuple(args, const_cast<char *>("O&O&O&pfi"),
+    float dielectric, tolerance = 0;
+    if (!PyArg_ParseTuple(args, const_cast<char *>("O&O&O&pfi|f"),
                    parse_float_n3_array, &target_points,
                    parse_float_n3_array, &atom_coords,
                    parse_float_n_array, &charges,
-                   &py_dist_dep, &dielectric, &num_cpus))
+                   &py_dist_dep, &dielectric, &num_cpus, &tolerance))
         return NULL;
     if (atom_coords.size(0) != charges.size())
         return PyErr_Format(PyExc_ValueError, "Number of atoms (%d) differs from number of charges (%d)",
             atom_coords.size(0), charges.size());
+    if (tolerance < 0 || tolerance >= 1)
+        return PyErr_Format(PyExc_ValueError, "Tolerance (%g) must be at least 0 and less than 1",
+            tolerance);
     bool dist_dep = (py_dist_dep != 0);
 
     FArray tp_contig = target_points.contiguous_array();
     float *tp_array = tp_contig.values();
+    FArray ac_contig = atom_coords.contiguous_array();
+    FArray ch_contig = charges.contiguous_array();
 
     int64_t n = target_points.size(0);
 
     parse_writable_float_n_array(python_float_array(n), &values);
 
     Py_BEGIN_ALLOW_THREADS
-    int64_t num_threads = num_cpus > 1 ? num_cpus : 1;
-    // divvy up atoms evenly among the threads;
-    // since we anticipate computations taking approximately the same time for every atom, no need
+    auto num_atoms = atom_coords.size(0);
+    const float *coord_ptr = ac_contig.values(), *charges_ptr = ch_contig.values();
+    // A cluster of radius a at distance d from a target point contributes an error of
+    // about tolerance times the potential of its absolute charges when (a/d)^3 = tolerance.
+    double theta = cbrt(tolerance);
+    Charge_Tree* tree = (tolerance > 0 ? new Charge_Tree(coord_ptr, charges_ptr, num_atoms) : nullptr);
+    Charges* soa = (tree ? nullptr : new Charges(coord_ptr, charges_ptr, num_atoms));
+
+    // divvy up target points evenly among the threads;
+    // since we anticipate computations taking approximately the same time for every point, no need
     // to deal with the lock contention inherent with the threads grabbing from a global pool
-    num_threads = std::min(num_threads, n);
-    std::vector<std::thread> threads;
-    auto tp_ptr = tp_array;
+    int num_threads = Thread_Pool::thread_count(n, 1, num_cpus > 1 ? num_cpus : 1);
     auto value_ptr = values.values();
-    auto coord_ptr = atom_coords.values();
-    auto charges_ptr = charges.values();
-    auto num_atoms = atom_coords.size(0);
-    auto unallocated = n;
-    while (num_threads-- > 0) {
-        decltype(n) per_thread = unallocated / (num_threads + 1);
-        if (per_thread * (num_threads + 1) == unallocated) {
-            // we can assign this value evenly to all remaining threads
-            while (num_threads-- >= 0) {
-                threads.push_back(std::thread(initiate_compute_esp, tp_ptr, value_ptr, per_thread,
-                    coord_ptr, charges_ptr, num_atoms, dist_dep, dielectric));
-                tp_ptr += 3 * per_thread;
-                value_ptr += per_thread;
+    Thread_Pool::run(num_threads, [&](int t) {
+        int64_t i0 = (n * t) / num_threads, i1 = (n * (t+1)) / num_threads;
+        if (tree)
+            initiate_compute_esp_approx(tp_array + 3*i0, value_ptr + i0,
+                i1 - i0, *tree, theta, dist_dep, dielectric);
+        else
+            initiate_compute_esp(tp_array + 3*i0, value_ptr + i0,
+                i1 - i0, *soa, dist_dep, dielectric);
+    });
+    delete tree;
+    delete soa;
+    Py_END_ALLOW_THREADS
+
+    PyObject *py_values = array_python_source(values, false);
+    return py_values;
+}
+
+// Potential on grid planes k0 to k1-1 of a z, y, x indexed contiguous array.
+// Along each row y and z are fixed, so the atom's y, z distance squared is
+// computed once per row and the loop over the row's x positions vectorizes.
+static void
+initiate_compute_esp_grid(float* values, const int64_t* size, const float* origin,
+        const float* step, int64_t k0, int64_t k1, const Charges& c, const Charge_Tree* tree,
+        double theta, bool dist_dep, float dielectric)
+{
+    float conv_factor = 331.62 / dielectric;
+    int64_t nx = size[2], ny = size[1], na = c.size();
+    std::vector<float> x(nx), e(nx), dz2(na);
+    for (int64_t i = 0; i < nx; ++i)
+        x[i] = origin[0] + i * step[0];
+    const float *ax = c.x.data(), *ay = c.y.data(), *az = c.z.data(), *aq = c.q.data();
+    float points[3*BLOCK];
+    for (int64_t k = k0; k < k1; ++k) {
+        float tz = origin[2] + k * step[2];
+        if (!tree)
+            for (int64_t j = 0; j < na; ++j)
+                dz2[j] = (az[j] - tz) * (az[j] - tz);
+        for (int64_t r = 0; r < ny; ++r) {
+            float ty = origin[1] + r * step[1];
+            float* row = values + (k * ny + r) * nx;
+            if (tree) {
+                for (int64_t i = 0; i < nx; i += BLOCK) {
+                    int nt = (int)std::min((int64_t)BLOCK, nx - i);
+                    for (int b = 0; b < nt; ++b) {
+                        points[3*b] = x[i+b];
+                        points[3*b+1] = ty;
+                        points[3*b+2] = tz;
+                    }
+                    tree->esp(points, nt, theta, dist_dep, row + i);
+                }
+            } else {
+                float* ep = e.data();
+                const float* xp = x.data();
+                for (int64_t i = 0; i < nx; ++i)
+                    ep[i] = 0;
+                for (int64_t j = 0; j < na; ++j) {
+                    float dy = ay[j] - ty, dyz2 = dy*dy + dz2[j], xj = ax[j], q = aq[j];
+                    if (dist_dep)
+                        for (int64_t i = 0; i < nx; ++i) {
+                            float dx = xj - xp[i];
+                            ep[i] += q / (dx*dx + dyz2);
+                        }
+                    else
+                        for (int64_t i = 0; i < nx; ++i) {
+                            float dx = xj - xp[i];
+                            ep[i] += q / sqrtf(dx*dx + dyz2);
+                        }
+                }
+                for (int64_t i = 0; i < nx; ++i)
+                    row[i] = ep[i];
             }
-        } else {
-            // round up; assign to this thread; continue
-            per_thread++;
-            threads.push_back(std::thread(initiate_compute_esp, tp_ptr, value_ptr, per_thread,
-                coord_ptr, charges_ptr, num_atoms, dist_dep, dielectric));
-            tp_ptr += 3 * per_thread;
-            value_ptr += per_thread;
-            unallocated -= per_thread;
+            for (int64_t i = 0; i < nx; ++i)
+                row[i] *= conv_factor;
         }
     }
-    for (auto& th: threads)
-        th.join();
+}
+
+static PyObject*
+potential_on_grid(PyObject*, PyObject* args)
+{
+    FArray values, atom_coords, charges;
+    float origin[3], step[3];
+    int py_dist_dep, num_cpus;
+    float dielectric, tolerance = 0;
+    if (!PyArg_ParseTuple(args, const_cast<char *>("O&O&O&O&O&pfi|f"),
+                   parse_writable_float_3d_array, &values,
+                   parse_float_3_array, &origin[0],
+                   parse_float_3_array, &step[0],
+                   parse_float_n3_array, &atom_coords,
+                   parse_float_n_array, &charges,
+                   &py_dist_dep, &dielectric, &num_cpus, &tolerance))
+        return NULL;
+    if (atom_coords.size(0) != charges.size())
+        return PyErr_Format(PyExc_ValueError, "Number of atoms (%d) differs from number of charges (%d)",
+            atom_coords.size(0), charges.size());
+    if (tolerance < 0 || tolerance >= 1)
+        return PyErr_Format(PyExc_ValueError, "Tolerance (%g) must be at least 0 and less than 1",
+            tolerance);
+    if (!values.is_contiguous())
+        return PyErr_Format(PyExc_TypeError, "Grid values array must be contiguous");
+    bool dist_dep = (py_dist_dep != 0);
+
+    FArray ac_contig = atom_coords.contiguous_array();
+    FArray ch_contig = charges.contiguous_array();
+
+    Py_BEGIN_ALLOW_THREADS
+    auto num_atoms = atom_coords.size(0);
+    const float *coord_ptr = ac_contig.values(), *charges_ptr = ch_contig.values();
+    double theta = cbrt(tolerance);
+    Charge_Tree* tree = (tolerance > 0 ? new Charge_Tree(coord_ptr, charges_ptr, num_atoms) : nullptr);
+    Charges* soa = (tree ? nullptr : new Charges(coord_ptr, charges_ptr, num_atoms));
+    const Charges& atoms = (tree ? tree->atoms : *soa);
+
+    // divvy up z planes evenly among the threads
+    const int64_t* size = values.sizes();
+    int64_t nz = size[0];
+    int num_threads = Thread_Pool::thread_count(nz, 1, num_cpus > 1 ? num_cpus : 1);
+    auto value_ptr = values.values();
+    Thread_Pool::run(num_threads, [&](int t) {
+        int64_t k0 = (nz * t) / num_threads, k1 = (nz * (t+1)) / num_threads;
+        initiate_compute_esp_grid(value_ptr, size, origin, step,
+            k0, k1, atoms, tree, theta, dist_dep, dielectric);
+    });
+    delete tree;
+    delete soa;
     Py_END_ALLOW_THREADS
 
-    PyObject *py_values = array_python_source(values, false);
-    return py_values;
+    Py_INCREF(Py_None);
+    return Py_None;
 }
 
 static struct PyMethodDef esp_methods[] =
 {
   {const_cast<char*>("potential_at_points"), potential_at_points, METH_VARARGS, NULL},
+  {const_cast<char*>("potential_on_grid"), potential_on_grid, METH_VARARGS, NULL},
   {nullptr, nullptr, 0, nullptr}
 };
 
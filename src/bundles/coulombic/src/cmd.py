@@ -27,7 +27,9 @@ from chimerax.add_charge import ChargeMethodArg
 
 def cmd_coulombic(session, atoms, *, surfaces=None, his_scheme=None, offset=1.4, gspacing=None,
         gpadding=None, map=None, palette=None, range=None, dist_dep=True, dielectric=4.0,
-        charge_method=ChargeMethodArg.default_value, key=False):
+        charge_method=ChargeMethodArg.default_value, key=False, tolerance=0.0):
+    if tolerance < 0.0 or tolerance >= 1.0:
+        raise UserError("Tolerance must be at least 0 and less than 1")
     session.logger.status("Computing Coulombic potential%s" % (" map" if map else ""))
     if palette is None:
         from chimerax.core.colors import BuiltinColormaps
@@ -126,10 +128,10 @@ def cmd_coulombic(session, atoms, *, surfaces=None, his_scheme=None, offset=1.4,
                     if getattr(cs, 'is_clip_cap', False)]:
                 clip_surface.auto_recolor_vertices = lambda *args, ses=session, s=clip_surface, \
                     charged_atoms=charged_atoms, dist_dep=dist_dep, dielectric=dielectric, \
-                    cmap=cmap, f=color_vertices: f(ses, s, 0.0, charged_atoms, dist_dep, dielectric,
-                    cmap, log=False)
+                    cmap=cmap, tolerance=tolerance, f=color_vertices: f(ses, s, 0.0, charged_atoms,
+                    dist_dep, dielectric, cmap, log=False, tolerance=tolerance)
             color_vertices(session, target_surface, offset, charged_atoms, dist_dep, dielectric, cmap,
-                undo_info=(undo_owners, undo_old_vals, undo_new_vals))
+                undo_info=(undo_owners, undo_old_vals, undo_new_vals), tolerance=tolerance)
     undo_state.add(undo_owners, "vertex_colors", undo_old_vals, undo_new_vals, option="S")
     session.undo.register(undo_state)
     if key:
@@ -149,7 +151,7 @@ def cmd_coulombic(session, atoms, *, surfaces=None, his_scheme=None, offset=1.4,
         gpadding = 5.0
     import numpy, os
     import chimerax.arrays # Make sure _esp can runtime link shared library libarrays.
-    from ._esp import potential_at_points
+    from ._esp import potential_on_grid
     from chimerax.map import volume_from_grid_data
     from chimerax.map_data import ArrayGridData
     cpu_count = os.cpu_count()
@@ -157,15 +159,12 @@ def cmd_coulombic(session, atoms, *, surfaces=None, his_scheme=None, offset=1.4,
         coords = atoms.coords
         min_xyz = numpy.min(coords, axis=0) - [gpadding+gspacing/2.0]*3
         max_xyz = numpy.max(coords, axis=0) + [gpadding+gspacing/2.0]*3
-        x_range = numpy.arange(min_xyz[0], max_xyz[0], gspacing)
-        y_range = numpy.arange(min_xyz[1], max_xyz[1], gspacing)
-        z_range = numpy.arange(min_xyz[2], max_xyz[2], gspacing)
-        grid_vertices = numpy.array([(x,y,z) for x in x_range for y in y_range for z in z_range])
-        grid_potentials = potential_at_points(grid_vertices,
+        grid_size = [len(numpy.arange(min_xyz[a], max_xyz[a], gspacing)) for a in (2,1,0)]
+        grid_potentials = numpy.empty(grid_size, numpy.float32)
+        potential_on_grid(grid_potentials, min_xyz, [gspacing]*3,
             atoms.coords, numpy.array([a.charge for a in atoms], dtype=numpy.double),
-            dist_dep, dielectric, 1 if cpu_count is None else cpu_count)
-        grid_potentials.shape = (len(x_range), len(y_range), len(z_range))
-        agd = ArrayGridData(grid_potentials.transpose(), min_xyz, [gspacing]*3)
+            dist_dep, dielectric, 1 if cpu_count is None else cpu_count, tolerance)
+        agd = ArrayGridData(grid_potentials, min_xyz, [gspacing]*3)
         agd.polar_values = True
         v = volume_from_grid_data(agd, session, open_model=False)
         v.set_parameters(surface_levels=[-10, 10],
@@ -177,7 +176,7 @@ def cmd_coulombic(session, atoms, *, surfaces=None, his_scheme=None, offset=1.4,
     session.logger.status("Finished computing Coulombic potential grids")
 
 def color_vertices(session, surface, offset, charged_atoms, dist_dep, dielectric, cmap, *, log=True,
-        undo_info=None):
+        undo_info=None, tolerance=0.0):
     if surface.vertices is None:
         return
     if undo_info:
@@ -198,7 +197,7 @@ def color_vertices(session, surface, offset, charged_atoms, dist_dep, dielectric
     cpu_count = os.cpu_count()
     vertex_values = potential_at_points(surface.scene_position.transform_points(target_points),
         charged_atoms.scene_coords, numpy.array([a.charge for a in charged_atoms], dtype=numpy.double),
-        dist_dep, dielectric, 1 if cpu_count is None else cpu_count)
+        dist_dep, dielectric, 1 if cpu_count is None else cpu_count, tolerance)
     rgba = cmap.interpolated_rgba(vertex_values)
     from numpy import uint8, amin, mean, amax
     rgba8 = (255*rgba).astype(uint8)
@@ -229,6 +228,7 @@ def register_command(logger):
             ('dielectric', FloatArg),
             ('charge_method', ChargeMethodArg),
             ('key', BoolArg),
+            ('tolerance', FloatArg),
         ],
         synopsis = 'Color surfaces by coulombic potential'
     )
@@ -390,11 +390,16 @@ def residue_xyzr(rtflist):
 #
 def residue_contacts(clist, distance):
 
+    if len(clist) == 0:
+        return []
+    alist = clist[0][0][0].structure.atoms
+    pairs = asu_pair_contacts(alist, [equiv_asu_pairs[0] for a1,a2,equiv_asu_pairs in clist],
+                              distance, pairs = True)[2]
+    residues = alist.residues
     rclose = {}
-    for atoms1, atoms2, equiv_asu_pairs in clist:
+    for (atoms1, atoms2, equiv_asu_pairs), (ai1, ai2, d) in zip(clist, pairs):
         asu1, asu2 = equiv_asu_pairs[0]
-        apairs = close_atom_pairs(atoms1, asu1, atoms2, asu2, distance)
-        rpairs = close_residue_pairs(apairs)
+        rpairs = close_residue_pairs(residues, ai1, ai2, d)
         for r1,r2,d in rpairs:
             if (r1,asu1) in rclose:
                 rclose[(r1,asu1)].append((r2,asu2,d))
@@ -405,38 +410,35 @@ def residue_contacts(clist, distance):
     return rc
 
 # -----------------------------------------------------------------------------
+# Find close atoms between each pair of asymmetric units in one C++ call
+# that searches the pairs in parallel.
 #
-def close_atom_pairs(atoms1, asu1, atoms2, asu2, distance):
-
-    xyz1 = atoms1.coords
-    asu1.transform.transform_points(xyz1, in_place=True)
-    xyz2 = atoms2.coords
-    asu2.transform.transform_points(xyz2, in_place=True)
-
-    close = []
-    import  numpy
-    dist = numpy.zeros((len(atoms2),), numpy.float32)
-    from chimerax.geometry import distances_from_origin
-    for i1, a1 in enumerate(atoms1):
-        distances_from_origin(xyz2, xyz1[i1,:], dist)
-        for i2, a2 in enumerate(atoms2):
-            if dist[i2] <= distance:
-                close.append((a1, a2, dist[i2]))
+def asu_pair_contacts(atoms, asu_pairs, distance, pairs = False):
 
-    return close
+    from numpy import float32, float64, array
+    xyz = atoms.coords.astype(float32)
+    tf1 = array([asu1.transform.matrix for asu1, asu2 in asu_pairs], float64).reshape((-1,3,4))
+    tf2 = array([asu2.transform.matrix for asu1, asu2 in asu_pairs], float64).reshape((-1,3,4))
+    from chimerax.geometry import find_close_points_copies
+    return find_close_points_copies(xyz, tf1, tf2, distance, pairs = pairs)
 
 # -----------------------------------------------------------------------------
+# Minimum distance for each pair of residues with close atoms, given atom
+# index pairs and their distances.
 #
-def close_residue_pairs(apairs):
+def close_residue_pairs(residues, ai1, ai2, distances):
 
-    rdist = {}
-    for a1, a2, dist in apairs:
-        rp = (a1.residue, a2.residue)
-        if rp in rdist:
-            rdist[rp] = min(rdist[rp], dist)
-        else:
-            rdist[rp] = dist
-    rpairs = [(rp[0], rp[1], d) for rp, d in rdist.items()]
+    if len(distances) == 0:
+        return []
+    ures = residues.unique()
+    ri = ures.indices(residues)
+    r1, r2 = ri[ai1], ri[ai2]
+    from numpy import int64, lexsort, concatenate
+    key = r1.astype(int64) * len(ures) + r2
+    order = lexsort((distances, key))
+    skey = key[order]
+    first = concatenate(((True,), skey[1:] != skey[:-1]))
+    rpairs = [(ures[r1[i]], ures[r2[i]], distances[i]) for i in order[first]]
     return rpairs
 
 # -----------------------------------------------------------------------------
@@ -455,19 +457,14 @@ def asymmetric_unit_contacts(molecule, distance, intra_biounit,
                                           shift_tolerance)
     
     alist = molecule.atoms
-    from numpy import float32
-    xyz = alist.coords.astype(float32)
+    i1, i2 = asu_pair_contacts(alist, [equiv_asu_pairs[0] for equiv_asu_pairs in uplist],
+                               distance)
 
     catoms = []
-    for equiv_asu_pairs in uplist:
-        asu1, asu2 = equiv_asu_pairs[0]
-        t1 = asu1.transform.matrix
-        t2 = asu2.transform.matrix
-        from chimerax.geometry import find_close_points_sets
-        i1, i2 = find_close_points_sets([(xyz, t1)], [(xyz, t2)], distance)
-        if len(i1[0]) > 0:
-            atoms1 = alist.filter(i1[0])
-            atoms2 = alist.filter(i2[0])
+    for equiv_asu_pairs, ai1, ai2 in zip(uplist, i1, i2):
+        if len(ai1) > 0:
+            atoms1 = alist.filter(ai1)
+            atoms2 = alist.filter(ai2)
             catoms.append((atoms1, atoms2, equiv_asu_pairs))
 
     return catoms
@@ -82,7 +82,7 @@ class DICOM:
         dfiles = []
         for path in paths:
             if os.path.isfile(path):
-                dfiles.append(SeriesFile(dcmread(path)))
+                dfiles.append(SeriesFile(_read_dicom_file(path)))
             elif os.path.isdir(path):
                 dfiles.extend(self._find_dicom_files_in_directory_recursively(path))
         dfiles = self.filter_unreadable(dfiles)
@@ -109,13 +109,13 @@ class DICOM:
     def _find_dicom_files_in_directory_recursively(self, path):
         dfiles = []
         for root, dirs, files in os.walk(path):
-            for f in files:
-                if f in ('.DS_Store', 'Thumbs.db', 'desktop.ini', 'LICENSE') or any(f.startswith(s) for s in ['._']):
-                    continue
-                try:
-                    dfiles.append(SeriesFile(dcmread(os.path.join(root, f))))
-                except InvalidDicomError:
+            files = [f for f in files
+                     if f not in ('.DS_Store', 'Thumbs.db', 'desktop.ini', 'LICENSE') and not f.startswith('._')]
+            for f, data in zip(files, _read_dicom_files([os.path.join(root, f) for f in files])):
+                if data is None:
                     self.session.logger.info('Pydicom could not read invalid or non-DICOM file %s; skipping.' % f)
+                else:
+                    dfiles.append(SeriesFile(data))
         for d in dirs:
             dfiles.extend(self._find_dicom_files_in_directory_recursively(d))
         return dfiles
@@ -166,6 +166,30 @@ class DICOM:
         return False
 
 
+# Pixel data is read from the file when the volume is first displayed instead
+# of when the headers are read.
+_DEFER_SIZE = '1 KB'
+
+def _read_dicom_file(path):
+    return dcmread(path, defer_size=_DEFER_SIZE)
+
+def _read_dicom_files(paths):
+    """Read DICOM file headers in parallel threads, giving None for files that
+    are not DICOM.  Series with thousands of slice files, particularly on network
+    file systems, mostly wait for file reads, which release the Python global
+    interpreter lock."""
+    def read(path):
+        try:
+            return _read_dicom_file(path)
+        except InvalidDicomError:
+            return None
+    if len(paths) <= 1:
+        return [read(path) for path in paths]
+    from concurrent.futures import ThreadPoolExecutor
+    with ThreadPoolExecutor(max_workers=min(len(paths), 4 * (os.cpu_count() or 1))) as e:
+        return list(e.map(read, paths))
+
+
 class DICOMMapFormat(MapFileFormat, DICOM):
     def __init__(self):
         MapFileFormat.__init__(
@@ -440,7 +440,8 @@ class DicomData:
         if any([f.SOPClassUID == pydicom.uid.RTStructureSetStorage for f in files]):
             self.image_series = False
             self.contour_series = True
-        if not any([f.get("PixelData") for f in files]):
+        # Check for the element without reading deferred pixel data.
+        if not any(["PixelData" in f.data for f in files]):
             self.image_series = False
         if self.transfer_syntax is None and hasattr(self.sample_file.file_meta, 'TransferSyntaxUID'):
             self.transfer_syntax = self.sample_file.file_meta.TransferSyntaxUID
@@ -809,11 +810,10 @@ class DicomData:
             a = self.read_frames(time, channel)
             array[:] = a[k0: k0 + ksz:kstep, j0:j0 + jsz:jstep, i0:i0 + isz:istep]
         else:
-            for k in range(k0, k0 + ksz, kstep):
-                if progress:
-                    progress.plane((k - k0) // kstep)
+            def read_plane(k):
                 p = self.read_plane(k, time, channel, rescale=False)
                 array[(k - k0) // kstep, :, :] = p[j0: j0 + jsz: jstep, i0:i0 + isz:istep]
+            _read_planes_in_threads(read_plane, range(k0, k0 + ksz, kstep), progress)
         if self.rescale_slope != 1:
             array *= self.rescale_slope
         if self.rescale_intercept != 0:
@@ -878,6 +878,27 @@ class DicomData:
         return self.dicom_series.modality
 
 
+def _read_planes_in_threads(read_plane, planes, progress=None):
+    """Read and decode each slice file into its plane of a preallocated array in parallel.
+    File reads and the compressed pixel data decoders release the Python global
+    interpreter lock.  Progress is reported from the calling thread."""
+    import os
+    threads = min(len(planes), os.cpu_count() or 1)
+    if threads <= 1:
+        for i, k in enumerate(planes):
+            if progress:
+                progress.plane(i)
+            read_plane(k)
+        return
+    from concurrent.futures import ThreadPoolExecutor, as_completed
+    with ThreadPoolExecutor(max_workers=threads) as e:
+        futures = [e.submit(read_plane, k) for k in planes]
+        for i, f in enumerate(as_completed(futures)):
+            f.result()  # Raise errors from the threads
+            if progress:
+                progress.plane(i)
+
+
 class SeriesFile:
     def __init__(self, data):
         self.data = data
@@ -31,6 +31,8 @@ class DistancesMonitor(StateManager):
         self.monitored_groups = set()
         self.update_callbacks = {}
         self._distances_shown = True
+        self._length_keys = {}	# group -> (pseudobonds, text keys) of labeled distances
+        self._label_job = None
         from chimerax.atomic import get_triggers
         triggers = get_triggers()
         triggers.add_handler("changes", self._changes_handler)
@@ -87,6 +89,7 @@ class DistancesMonitor(StateManager):
 
     def remove_group(self, group):
         self.monitored_groups.discard(group)
+        self._length_keys.pop(group, None)
         if group in self.update_callbacks:
             # can't check if there were pseudobonds since group may be already deleted
             self.update_callbacks[group]()
@@ -111,6 +114,7 @@ class DistancesMonitor(StateManager):
                 if mg.deleted:
                     self.remove_group(mg)
         existing_pbs = {}
+        new_pbs = []
         for pb in changes.created_pseudobonds():
             if pb in self._already_restored:
                 continue
@@ -123,50 +127,100 @@ class DistancesMonitor(StateManager):
                     if pb not in existing_pbs[pbg]:
                         # prevent showing labels on pseudobonds in non-current coordinate sets
                         continue
-                self._update_distances(pseudobonds=[pb])
+                new_pbs.append(pb)
+        if new_pbs:
+            self._update_distances(pseudobonds=new_pbs)
         self._already_restored.clear()
-        if "position changed" in changes.structure_reasons() \
-        or len(changes.modified_coordsets()) > 0:
-            self._update_distances()
-        if "active_coordset changed" in changes.structure_reasons():
+        reasons = changes.structure_reasons()
+        if "active_coordset changed" in reasons:
+            # Updates every group now, so moved atoms need no deferred update too.
             self._update_distances(coordset_changed=True)
+        elif "position changed" in reasons or len(changes.modified_coordsets()) > 0:
+            self._schedule_label_update()
 
-    def _update_distances(self, pseudobonds=None, *, coordset_changed=False):
+    def _schedule_label_update(self):
+        # Label text for moved atoms is updated as a frame job, one group per step,
+        # so many monitored distances do not hold up drawing the frame.
+        job = self._label_job
+        if job is None:
+            # Initial cost estimate for one group, replaced by measured times.
+            n = max((g.num_pseudobonds for g in self.monitored_groups if not g.deleted), default=0)
+            self._label_job = job = _LabelUpdateJob(self, cost=1e-6 * n)
+        job.groups.update(self.monitored_groups)
+        self.session.update_loop.frame_jobs.add_job(job)
+
+    def _update_distances(self, pseudobonds=None, *, coordset_changed=False, only_changed=False,
+                          groups=None, run_callbacks=True):
+        # With only_changed, or for a new coordinate set of a group whose pseudobonds
+        # are the same in all coordinate sets, only labels whose text changed are
+        # updated, so trajectory playback with many distances stays fast.
+        # Returns the groups whose labels were updated.  Without run_callbacks the
+        # caller runs their update callbacks.
         if pseudobonds is None:
-            pseudobonds = [pb for mg in self.monitored_groups for pb in mg.pseudobonds]
+            by_group = { mg: None for mg in (self.monitored_groups if groups is None else groups) }
             set_color = coordset_changed
         else:
+            by_group = {}
+            for pb in pseudobonds:
+                by_group.setdefault(pb.group, []).append(pb)
             set_color = True
-        by_group = {}
-        for pb in pseudobonds:
-            by_group.setdefault(pb.group, []).append(pb)
 
         from chimerax.label.label3d import labels_model, PseudobondLabel
+        updated = []
         for grp, pbs in by_group.items():
-            if coordset_changed:
-                lm = labels_model(grp, create=False)
-                if lm:
-                    lm.delete()
+            per_coordset = (grp.group_type == grp.GROUP_TYPE_COORD_SET)
+            if pbs is None:
+                incremental = only_changed or (coordset_changed and not per_coordset)
+                previous = self._length_keys.get(grp) if incremental else None
+                if previous is not None:
+                    lm = labels_model(grp, create=False)
+                    if lm is None or lm.label_count() != len(previous[1]):
+                        previous = None
+                pbs, lengths, keys, changed = grp.length_text_changes(self.decimal_places, previous)
+                self._length_keys[grp] = (pbs, keys)
+                if previous is not None:
+                    if not changed.any():
+                        continue
+                    pbs, lengths = pbs.filter(changed), lengths[changed]
+                    label_settings = {}
+                else:
+                    if coordset_changed and per_coordset:
+                        lm = labels_model(grp, create=False)
+                        if lm:
+                            lm.delete()
+                    label_settings = { 'color': grp.color } if set_color else {}
+            else:
+                from chimerax.atomic import Pseudobonds
+                pbs = Pseudobonds(pbs)
+                lengths = pbs.lengths
+                label_settings = { 'color': grp.color }
             lm = labels_model(grp, create=True)
-            label_settings = { 'color': grp.color } if set_color else {}
+            if not self.distances_shown:
+                label_settings['text'] = ""
+            lm.add_labels(pbs, PseudobondLabel, self.session.main_view, settings=label_settings)
             if self.distances_shown:
                 fmt = self.distance_format
-                for pb in pbs:
-                    label_settings['text'] = fmt % pb.length
-                    lm.add_labels([pb], PseudobondLabel, self.session.main_view,
-                        settings=label_settings)
-            else:
-                label_settings['text'] = ""
-                lm.add_labels(pbs, PseudobondLabel, self.session.main_view,
-                    settings=label_settings)
-            if grp in self.update_callbacks:
-                self.update_callbacks[grp]()
+                for label, length in zip(lm.labels(pbs), lengths):
+                    label.text = fmt % length
+                lm.update_labels()
+            updated.append(grp)
+            if run_callbacks:
+                self._run_update_callback(grp)
+        return updated
+
+    def _run_update_callback(self, grp):
+        if grp in self.update_callbacks:
+            self.update_callbacks[grp]()
 
     # session methods
     def reset_state(self, session):
         self.monitored_groups.clear()
         self.update_callbacks.clear()
         self._distances_shown = True
+        self._length_keys.clear()
+        if self._label_job:
+            session.update_loop.frame_jobs.remove_job(self._label_job)
+            self._label_job.groups.clear()
 
     @staticmethod
     def restore_snapshot(session, data):
@@ -189,3 +243,34 @@ class DistancesMonitor(StateManager):
         self._distances_shown = data['distances shown']
         for grp in data['monitored groups']:
             self.add_group(grp, session_restore=True)
+
+
+from chimerax.core.updateloop import FrameJob
+class _LabelUpdateJob(FrameJob):
+    name = 'distance labels'
+
+    def __init__(self, monitor, cost):
+        super().__init__(cost=cost)
+        self.monitor = monitor
+        self.groups = set()
+        self._updated = set()	# Groups whose update callbacks run when the job finishes
+
+    def step(self):
+        mon = self.monitor
+        while self.groups:
+            grp = self.groups.pop()
+            if grp in mon.monitored_groups and not grp.deleted:
+                self._updated.update(mon._update_distances(only_changed=True, groups=[grp],
+                                                           run_callbacks=False))
+                break
+        if self.groups:
+            return False
+        updated, self._updated = self._updated, set()
+        for grp in updated:
+            if grp in mon.monitored_groups and not grp.deleted:
+                mon._run_update_callback(grp)
+        return True
+
+    def cancel(self):
+        self.groups.clear()
+        self._updated.clear()
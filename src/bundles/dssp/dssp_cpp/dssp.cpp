@@ -30,11 +30,14 @@
 #include <map>
 #include <memory>
 #include <string>
+#include <vector>
 
+#include <arrays/pythonarray.h>	// use python_uint8_array()
 #include <logger/logger.h>
 
 #include <atomstruct/Atom.h>
 #include <atomstruct/Coord.h>
+#include <atomstruct/CoordSet.h>
 #include <atomstruct/Residue.h>
 #include <atomstruct/Structure.h>
 
@@ -61,10 +64,27 @@
 //        minimum helix length (int)
 //        minimum strand length (int)
 //        whether to report summary of dssp computation [ladders, etc.] (bool)
+//    and optionally:
+//        whether to return computed values (bool)
+//        distance backbone atoms may move before residue pairs are searched
+//          for again, for repeated computation over trajectory frames (float)
+//
+//
+// compute_ss_frames
+//    Compute DSSP secondary structure for several coordinate sets of a
+//    structure, in parallel, without assigning it to the residues
+//
+//    The Python function takes two mandatory arguments:
+//        pointer to a Structure (int)
+//        coordinate set ids (sequence of int)
+//    and optionally the energy cutoff, minimum helix and strand lengths, and
+//    number of threads.  It returns a frames by residues uint8 array of
+//    Residue::SSType values (0 coil, 1 helix, 2 strand).
 //
 extern "C" {
 
 using atomstruct::CompSSInfo;
+using atomstruct::CoordSet;
 using atomstruct::Residue;
 using atomstruct::Structure;
 
@@ -83,13 +103,15 @@ compute_ss(PyObject *, PyObject *args, PyObject* keywds)
     int min_helix_length = 3, min_strand_length = 3;
     int report = false;
     int return_values = false;
+    double reuse_tolerance = 0.0;
     std::unique_ptr<CompSSInfo> ss_data;
     static const char* kwlist[] = {
-        "", "energy_cutoff", "min_helix_len", "min_strand_len", "report", "return_values", nullptr };
+        "", "energy_cutoff", "min_helix_len", "min_strand_len", "report", "return_values",
+        "reuse_tolerance", nullptr };
     if (!PyArg_ParseTupleAndKeywords(
-             args, keywds, PY_STUPID "O|diipp", (char**) kwlist,
+             args, keywds, PY_STUPID "O|diippd", (char**) kwlist,
              &ptr, &energy_cutoff, &min_helix_length, &min_strand_length,
-             &report, &return_values))
+             &report, &return_values, &reuse_tolerance))
         return nullptr;
     // convert first arg to Structure*
     if (!PyLong_Check(ptr)) {
@@ -101,7 +123,8 @@ compute_ss(PyObject *, PyObject *args, PyObject* keywds)
         ss_data = std::unique_ptr<CompSSInfo>(new CompSSInfo);
     try {
         mol->compute_secondary_structure(static_cast<float>(energy_cutoff), min_helix_length,
-                min_strand_length, static_cast<bool>(report), ss_data.get());
+                min_strand_length, static_cast<bool>(report), ss_data.get(),
+                static_cast<float>(reuse_tolerance));
     } catch (std::exception& e) {
         PyErr_SetString(PyExc_RuntimeError, e.what());
             return nullptr;
@@ -167,8 +190,79 @@ compute_ss(PyObject *, PyObject *args, PyObject* keywds)
     }
 }
 
+static
+PyObject *
+compute_ss_frames(PyObject *, PyObject *args, PyObject* keywds)
+{
+    PyObject* ptr;
+    PyObject* cs_ids;
+    double energy_cutoff = -0.5;
+    int min_helix_length = 3, min_strand_length = 3;
+    int num_threads = 1;
+    static const char* kwlist[] = {
+        "", "", "energy_cutoff", "min_helix_len", "min_strand_len", "threads", nullptr };
+    if (!PyArg_ParseTupleAndKeywords(
+             args, keywds, PY_STUPID "OO|diii", (char**) kwlist,
+             &ptr, &cs_ids, &energy_cutoff, &min_helix_length, &min_strand_length,
+             &num_threads))
+        return nullptr;
+    if (!PyLong_Check(ptr)) {
+        PyErr_SetString(PyExc_TypeError, "First arg not an int (structure pointer)");
+        return nullptr;
+    }
+    Structure* mol = static_cast<Structure*>(PyLong_AsVoidPtr(ptr));
+    PyObject* ids = PySequence_Fast(cs_ids, "Second arg not a sequence of coordset ids");
+    if (ids == nullptr)
+        return nullptr;
+    std::vector<CoordSet*> frames;
+    auto num_ids = PySequence_Fast_GET_SIZE(ids);
+    for (Py_ssize_t i = 0; i < num_ids; ++i) {
+        long id = PyLong_AsLong(PySequence_Fast_GET_ITEM(ids, i));
+        if (id == -1 && PyErr_Occurred()) {
+            Py_DECREF(ids);
+            return nullptr;
+        }
+        CoordSet* cs = mol->find_coord_set(id);
+        if (cs == nullptr) {
+            Py_DECREF(ids);
+            PyErr_Format(PyExc_ValueError, "No coordset with id %ld", id);
+            return nullptr;
+        }
+        frames.push_back(cs);
+    }
+    Py_DECREF(ids);
+    unsigned char* ss_codes;
+    PyObject* codes = python_uint8_array(frames.size(), mol->residues().size(), &ss_codes);
+    if (codes == nullptr)
+        return nullptr;
+    try {
+        mol->compute_frames_secondary_structure(frames, ss_codes,
+                static_cast<float>(energy_cutoff), min_helix_length, min_strand_length,
+                num_threads);
+    } catch (std::exception& e) {
+        Py_DECREF(codes);
+        PyErr_SetString(PyExc_RuntimeError, e.what());
+        return nullptr;
+    }
+    return codes;
 }
 
+}
+
+static const char* docstr_compute_ss_frames =
+"compute_ss_frames\n"
+"Compute Kabsch & Sander DSSP secondary structure for several coordinate sets\n"
+"without assigning it to residues.  Returns a frames by residues uint8 array\n"
+"with values 0 = coil, 1 = helix, 2 = strand.\n"
+"\n"
+"The arguments are:\n"
+"    mol_ptr        pointer to Structure (required)\n"
+"    coordset_ids   sequence of coordinate set ids (required)\n"
+"    energy_cutoff  hbond energy cutoff (default -0.5)\n"
+"    min_helix_len  minimum helix length (default 3)\n"
+"    min_strand_len minimum strand length (default 3)\n"
+"    threads        number of frames to compute in parallel (default 1)\n";
+
 static const char* docstr_compute_ss =
 "compute_ss\n"
 "Compute/assign Kabsch & Sander DSSP secondary structure\n"
@@ -179,10 +273,12 @@ static const char* docstr_compute_ss =
 "    min_helix_len  minimum helix length (default 3)\n"
 "    min_strand_len minimum strand length (default 3)\n"
 "    report         whether to log computed values (default false)\n"
-"    return_values  whether to return computed values (default false)\n";
+"    return_values  whether to return computed values (default false)\n"
+"    reuse_tolerance reuse hbond search until backbone moves this far (default 0)\n";
 
 static PyMethodDef dssp_methods[] = {
     { PY_STUPID "compute_ss", (PyCFunction) compute_ss, METH_VARARGS|METH_KEYWORDS, PY_STUPID docstr_compute_ss },
+    { PY_STUPID "compute_ss_frames", (PyCFunction) compute_ss_frames, METH_VARARGS|METH_KEYWORDS, PY_STUPID docstr_compute_ss_frames },
     { nullptr, nullptr, 0, nullptr }
 };
 
@@ -25,7 +25,7 @@
 # ensure atomic_libs C++ shared libs are linkable by us
 import chimerax.atomic_lib
 
-from ._dssp import compute_ss as _compute_ss
+from ._dssp import compute_ss as _compute_ss, compute_ss_frames as _compute_ss_frames
 
 from chimerax.core.toolshed import BundleAPI
 
@@ -46,6 +46,10 @@ def compute_ss(structure, **kw):
         whether to log computed values (default false).
     return_values : bool, optional
         whether to return computed values (default false).
+    reuse_tolerance : float, optional
+        if positive, the residue pairs searched for hydrogen bonds are kept and
+        reused by later calls until some backbone nitrogen moves more than this
+        distance, making repeated calls over trajectory frames faster (default 0).
 
     Returns
     -------
@@ -60,6 +64,38 @@ def compute_ss(structure, **kw):
     """
     return _compute_ss(structure._c_pointer.value, **kw)
 
+def compute_ss_frames(structure, coordset_ids, **kw):
+    """Compute secondary structure for several coordinate sets using DSSP
+
+    The frames are computed in parallel and the residues' secondary structure
+    assignments are not changed.
+
+    Parameters
+    ----------
+    structure : :py:class:`~chimerax.atomic.AtomicStructure`
+        The structure to use.
+    coordset_ids : sequence of int
+        The coordinate set ids of the frames to compute.
+    energy_cutoff : float, optional
+        hbond energy cutoff (default -0.5).
+    min_helix_len : int, optional
+        minimum helix length (default 3).
+    min_strand_len : int, optional
+        minimum strand length (default 3).
+    threads : int, optional
+        number of frames to compute in parallel (default number of CPUs).
+
+    Returns
+    -------
+    numpy uint8 array
+        Frames by residues array of secondary structure types, with 0 for coil,
+        1 for helix and 2 for strand.  Residues lacking backbone atoms are coil.
+    """
+    if 'threads' not in kw:
+        import os
+        kw['threads'] = os.cpu_count() or 1
+    return _compute_ss_frames(structure._c_pointer.value, coordset_ids, **kw)
+
 class _DsspBundle(BundleAPI):
     pass
 
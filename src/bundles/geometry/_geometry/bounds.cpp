@@ -28,10 +28,13 @@
 // Computations involving bounds
 //
 #include <Python.h>			// use PyObject
+#include <algorithm>			// use std::min, std::max
+#include <math.h>			// use sqrt()
 #include <vector>			// use std::vector
 
 #include <arrays/pythonarray.h>		// use parse_float_n3_array, ...
 #include <arrays/rcarray.h>		// use FArray
+#include <arrays/threadpool.h>		// use Thread_Pool::run()
 #include "bounds.h"
 
 // -----------------------------------------------------------------------------
@@ -80,7 +83,9 @@ PyObject *sphere_axes_bounds(PyObject *, PyObject *args, PyObject *keywds)
 
   float *axes_bounds;
   PyObject *bounds = python_float_array(axes.size(0), 2, &axes_bounds);
+  Py_BEGIN_ALLOW_THREADS
   axes_sphere_bounds(centers, radii, axes, axes_bounds);
+  Py_END_ALLOW_THREADS
   return bounds;
 }
 
@@ -140,7 +145,9 @@ PyObject *spheres_in_bounds(PyObject *, PyObject *args, PyObject *keywds)
 			axes.size_string(0).c_str(), axes_bounds.size_string(0).c_str());
 
   std::vector<int> in;
+  Py_BEGIN_ALLOW_THREADS
   spheres_in_axes_bounds(centers, radii, axes, axes_bounds, padding, in);
+  Py_END_ALLOW_THREADS
   PyObject *sib = c_array_to_python(in);
   return sib;
 }
@@ -190,24 +197,24 @@ PyObject *bounds_overlap(PyObject *, PyObject *args, PyObject *keywds)
 //
 static void sphere_bounding_box(const FArray &centers, const FArray &radii, float *xyz_min, float *xyz_max)
 {
-  int64_t n = centers.size(0);
-  int64_t cs0 = centers.stride(0), cs1 = centers.stride(1), rs = radii.stride(0);
-  float *ca = centers.values(), *ra = radii.values();
+  // Contiguous arrays and branchless min/max let the compiler vectorize the loop.
+  FArray cc = centers.contiguous_array(), rc = radii.contiguous_array();
+  int64_t n = cc.size(0);
+  const float *ca = cc.values(), *ra = rc.values();
   float xmin = 0, ymin = 0, zmin = 0, xmax = 0, ymax = 0, zmax = 0;
-  for (int64_t i = 0 ; i < n ; ++i, ca += cs0, ra += rs)
+  if (n > 0)
     {
-      float x = ca[0], y = ca[cs1], z = ca[2*cs1], r = *ra;
-      if (i == 0)
-	{ xmin = x-r; xmax = x+r; ymin = y-r; ymax = y+r; zmin = z-r; zmax = z+r; }
-      else
-	{
-	  if (x-r < xmin) xmin = x-r;
-	  else if (x+r > xmax) xmax = x+r;
-	  if (y-r < ymin) ymin = y-r;
-	  else if (y+r > ymax) ymax = y+r;
-	  if (z-r < zmin) zmin = z-r;
-	  else if (z+r > zmax) zmax = z+r;
-	}
+      xmin = xmax = ca[0]; ymin = ymax = ca[1]; zmin = zmax = ca[2];
+      xmin -= ra[0]; ymin -= ra[0]; zmin -= ra[0];
+      xmax += ra[0]; ymax += ra[0]; zmax += ra[0];
+    }
+  for (int64_t i = 1 ; i < n ; ++i)
+    {
+      const float *c = ca + 3*i;
+      float x = c[0], y = c[1], z = c[2], r = ra[i];
+      xmin = std::min(xmin, x-r); xmax = std::max(xmax, x+r);
+      ymin = std::min(ymin, y-r); ymax = std::max(ymax, y+r);
+      zmin = std::min(zmin, z-r); zmax = std::max(zmax, z+r);
     }
   xyz_min[0] = xmin; xyz_min[1] = ymin; xyz_min[2] = zmin;
   xyz_max[0] = xmax; xyz_max[1] = ymax; xyz_max[2] = zmax;
@@ -232,22 +239,22 @@ PyObject *sphere_bounds(PyObject *, PyObject *args, PyObject *keywds)
 
   float *xyz_bounds;
   PyObject *bounds = python_float_array(2, 3, &xyz_bounds);
+  Py_BEGIN_ALLOW_THREADS
   sphere_bounding_box(centers, radii, xyz_bounds, xyz_bounds+3);
+  Py_END_ALLOW_THREADS
   return bounds;
 }
 
 // -----------------------------------------------------------------------------
 //
-static void points_within_planes(const FArray &points, const FArray &planes, unsigned char *pmask)
+static void points_within_planes(const FValues &points, const FValues &planes, unsigned char *pmask)
 {
-  float *p = points.values(), *pl = planes.values();
+  const float *p = points.values(), *pl = planes.values();
   int64_t n = points.size(0), np = planes.size(0), j;
-  int64_t ps0 = points.stride(0), ps1 = points.stride(1);
-  int64_t pls0 = planes.stride(0), pls1 = planes.stride(1);
-  for (int64_t i = 0 ; i < n ; ++i)
+  for (int64_t i = 0 ; i < n ; ++i, p += 3)
     {
       for (j = 0 ; j < np ; ++j)
-	if (p[i*ps0]*pl[j*pls0] + p[i*ps0+ps1]*pl[j*pls0+pls1] + p[i*ps0+2*pls1]*pl[j*pls0+2*pls1] + pl[j*pls0+3*pls1] < 0)
+	if (p[0]*pl[4*j] + p[1]*pl[4*j+1] + p[2]*pl[4*j+2] + pl[4*j+3] < 0)
 	    break;
       pmask[i] = (j < np ? 0 : 1);
     }
@@ -258,42 +265,36 @@ static void points_within_planes(const FArray &points, const FArray &planes, uns
 extern "C"
 PyObject *points_within_planes(PyObject *, PyObject *args, PyObject *keywds)
 {
-  FArray points, planes;
+  FValues points, planes;
   const char *kwlist[] = {"points", "planes", NULL};
   if (!PyArg_ParseTupleAndKeywords(args, keywds, const_cast<char *>("O&O&"),
 				   (char **)kwlist,
-				   parse_float_n3_array, &points,
-				   parse_float_n4_array, &planes))
+				   parse_float_n3_values, &points,
+				   parse_float_n4_values, &planes))
     return NULL;
 
   unsigned char *pmask;
   PyObject *pm = python_bool_array(points.size(0), &pmask);
+  Py_BEGIN_ALLOW_THREADS
   points_within_planes(points, planes, pmask);
+  Py_END_ALLOW_THREADS
   return pm;
 }
 
 // -----------------------------------------------------------------------------
 //
-static void points_bounding_box(const FArray &points, float *xyz_min, float *xyz_max)
+static void points_bounding_box(const float *pa, int64_t n, float *xyz_min, float *xyz_max)
 {
-  int64_t n = points.size(0);
-  int64_t ps0 = points.stride(0), ps1 = points.stride(1);
-  float *pa = points.values();
   float xmin = 0, ymin = 0, zmin = 0, xmax = 0, ymax = 0, zmax = 0;
-  for (int64_t i = 0 ; i < n ; ++i, pa += ps0)
+  if (n > 0)
+    { xmin = xmax = pa[0]; ymin = ymax = pa[1]; zmin = zmax = pa[2]; }
+  for (int64_t i = 1 ; i < n ; ++i)
     {
-      float x = pa[0], y = pa[ps1], z = pa[2*ps1];
-      if (i == 0)
-	{ xmin = xmax = x; ymin = ymax = y; zmin = zmax = z; }
-      else
-	{
-	  if (x < xmin) xmin = x;
-	  else if (x > xmax) xmax = x;
-	  if (y < ymin) ymin = y;
-	  else if (y > ymax) ymax = y;
-	  if (z < zmin) zmin = z;
-	  else if (z > zmax) zmax = z;
-	}
+      const float *p = pa + 3*i;
+      float x = p[0], y = p[1], z = p[2];
+      xmin = std::min(xmin, x); xmax = std::max(xmax, x);
+      ymin = std::min(ymin, y); ymax = std::max(ymax, y);
+      zmin = std::min(zmin, z); zmax = std::max(zmax, z);
     }
   xyz_min[0] = xmin; xyz_min[1] = ymin; xyz_min[2] = zmin;
   xyz_max[0] = xmax; xyz_max[1] = ymax; xyz_max[2] = zmax;
@@ -304,60 +305,100 @@ static void points_bounding_box(const FArray &points, float *xyz_min, float *xyz
 extern "C"
 PyObject *point_bounds(PyObject *, PyObject *args, PyObject *keywds)
 {
-  FArray points;
+  FValues points;
   const char *kwlist[] = {"points", NULL};
   if (!PyArg_ParseTupleAndKeywords(args, keywds, const_cast<char *>("O&"),
 				   (char **)kwlist,
-				   parse_float_n3_array, &points))
+				   parse_float_n3_values, &points))
     return NULL;
 
   float *xyz_bounds;
   PyObject *bounds = python_float_array(2, 3, &xyz_bounds);
-  points_bounding_box(points, xyz_bounds, xyz_bounds+3);
+  Py_BEGIN_ALLOW_THREADS
+  points_bounding_box(points.values(), points.size(0), xyz_bounds, xyz_bounds+3);
+  Py_END_ALLOW_THREADS
   return bounds;
 }
 
 // -----------------------------------------------------------------------------
 //
-static void point_copies_bounding_box(const FArray &points, const FArray &positions,
-				      float *xyz_min, float *xyz_max)
+// Bounds of points placed at positions j0 through j1-1.  Points and
+// positions are contiguous.
+//
+static void point_copies_bounding_box(const float *pa, int64_t n, const float *poa,
+				      int64_t j0, int64_t j1, float *xyz_min, float *xyz_max)
 {
-  int64_t n = points.size(0), m = positions.size(0);
-  int64_t ps0 = points.stride(0), ps1 = points.stride(1);
-  int64_t pos0 = positions.stride(0), pos1 = positions.stride(1), pos2 = positions.stride(2);
-  float *pa0 = points.values(), *poa = positions.values();
   float xmin = 0, ymin = 0, zmin = 0, xmax = 0, ymax = 0, zmax = 0;
-  for (int64_t j = 0 ; j < m ; ++j, poa += pos0)
+  for (int64_t j = j0 ; j < j1 ; ++j)
     {
-      int64_t k0 = 0, k1 = pos2, k2 = 2*pos2, k3 = 3*pos2;
-      float *poa0 = poa, *poa1 = poa + pos1, *poa2 = poa + 2*pos1;
-      float p00 = poa0[k0], p01 = poa0[k1], p02 = poa0[k2], p03 = poa0[k3];
-      float p10 = poa1[k0], p11 = poa1[k1], p12 = poa1[k2], p13 = poa1[k3];
-      float p20 = poa2[k0], p21 = poa2[k1], p22 = poa2[k2], p23 = poa2[k3];
-      float *pa = pa0;
-      for (int64_t i = 0 ; i < n ; ++i, pa += ps0)
+      const float *po = poa + 12*j;
+      float p00 = po[0], p01 = po[1], p02 = po[2], p03 = po[3];
+      float p10 = po[4], p11 = po[5], p12 = po[6], p13 = po[7];
+      float p20 = po[8], p21 = po[9], p22 = po[10], p23 = po[11];
+      if (j == j0)
 	{
-	  float x0 = pa[0], y0 = pa[ps1], z0 = pa[2*ps1];
+	  xmin = xmax = p00*pa[0] + p01*pa[1] + p02*pa[2] + p03;
+	  ymin = ymax = p10*pa[0] + p11*pa[1] + p12*pa[2] + p13;
+	  zmin = zmax = p20*pa[0] + p21*pa[1] + p22*pa[2] + p23;
+	}
+      for (int64_t i = 0 ; i < n ; ++i)
+	{
+	  const float *p = pa + 3*i;
+	  float x0 = p[0], y0 = p[1], z0 = p[2];
 	  float x = p00*x0 + p01*y0 + p02*z0 + p03;
 	  float y = p10*x0 + p11*y0 + p12*z0 + p13;
 	  float z = p20*x0 + p21*y0 + p22*z0 + p23;
-	  if (j == 0 && i == 0)
-	    { xmin = xmax = x; ymin = ymax = y; zmin = zmax = z; }
-	  else
-	    {
-	      if (x < xmin) xmin = x;
-	      else if (x > xmax) xmax = x;
-	      if (y < ymin) ymin = y;
-	      else if (y > ymax) ymax = y;
-	      if (z < zmin) zmin = z;
-	      else if (z > zmax) zmax = z;
-	    }
+	  xmin = std::min(xmin, x); xmax = std::max(xmax, x);
+	  ymin = std::min(ymin, y); ymax = std::max(ymax, y);
+	  zmin = std::min(zmin, z); zmax = std::max(zmax, z);
 	}
     }
   xyz_min[0] = xmin; xyz_min[1] = ymin; xyz_min[2] = zmin;
   xyz_max[0] = xmax; xyz_max[1] = ymax; xyz_max[2] = zmax;
 }
 
+// -----------------------------------------------------------------------------
+// Many copies of many points are split over threads.
+//
+static void point_copies_bounding_box(const FArray &points, const FArray &positions,
+				      float *xyz_min, float *xyz_max)
+{
+  FArray pc = points.contiguous_array(), poc = positions.contiguous_array();
+  int64_t n = pc.size(0), m = poc.size(0);
+  const float *pa = pc.values(), *poa = poc.values();
+  if (n == 0 || m == 0)
+    {
+      for (int a = 0 ; a < 3 ; ++a)
+	xyz_min[a] = xyz_max[a] = 0;
+      return;
+    }
+
+  int64_t min_points_per_thread = 1000000;
+  int64_t nt = std::min(static_cast<int64_t>(Thread_Pool::thread_count(m)),
+			(n * m + min_points_per_thread - 1) / min_points_per_thread);
+  if (nt <= 1)
+    {
+      point_copies_bounding_box(pa, n, poa, 0, m, xyz_min, xyz_max);
+      return;
+    }
+
+  std::vector<float> tbounds(6*nt);
+  Thread_Pool::run(nt, [=, &tbounds](int t) {
+      point_copies_bounding_box(pa, n, poa, m*t/nt, m*(t+1)/nt, &tbounds[6*t], &tbounds[6*t+3]);
+    });
+
+  for (int a = 0 ; a < 3 ; ++a)
+    {
+      xyz_min[a] = tbounds[a];
+      xyz_max[a] = tbounds[3+a];
+      for (int64_t t = 1 ; t < nt ; ++t)
+	{
+	  xyz_min[a] = std::min(xyz_min[a], tbounds[6*t+a]);
+	  xyz_max[a] = std::max(xyz_max[a], tbounds[6*t+3+a]);
+	}
+    }
+}
+
 // -----------------------------------------------------------------------------
 //
 extern "C"
@@ -380,6 +421,72 @@ PyObject *point_copies_bounds(PyObject *, PyObject *args, PyObject *keywds)
 
   float *xyz_bounds;
   PyObject *bounds = python_float_array(2, 3, &xyz_bounds);
+  Py_BEGIN_ALLOW_THREADS
   point_copies_bounding_box(points, positions, xyz_bounds, xyz_bounds+3);
+  Py_END_ALLOW_THREADS
   return bounds;
 }
+
+// -----------------------------------------------------------------------------
+// A copy is within the planes unless its bounding sphere is entirely on the
+// negative side of some plane.  The sphere radius is scaled by the largest
+// axis scaling of the position.
+//
+static void copies_within_planes(const float *center, float radius, const FArray &positions,
+				 const FArray &planes, unsigned char *cmask)
+{
+  FArray poc = positions.contiguous_array(), plc = planes.contiguous_array();
+  int64_t m = poc.size(0), np = plc.size(0);
+  const float *poa = poc.values(), *pl = plc.values();
+  float x0 = center[0], y0 = center[1], z0 = center[2];
+  for (int64_t j = 0 ; j < m ; ++j)
+    {
+      const float *p = poa + 12*j;
+      float x = p[0]*x0 + p[1]*y0 + p[2]*z0 + p[3];
+      float y = p[4]*x0 + p[5]*y0 + p[6]*z0 + p[7];
+      float z = p[8]*x0 + p[9]*y0 + p[10]*z0 + p[11];
+      float s2 = 0;
+      for (int a = 0 ; a < 3 ; ++a)
+	s2 = std::max(s2, p[a]*p[a] + p[4+a]*p[4+a] + p[8+a]*p[8+a]);
+      float r = radius * sqrt(s2);
+      int64_t k;
+      for (k = 0 ; k < np ; ++k)
+	{
+	  const float *q = pl + 4*k;
+	  if (x*q[0] + y*q[1] + z*q[2] + q[3] < -r)
+	    break;
+	}
+      cmask[j] = (k < np ? 0 : 1);
+    }
+}
+
+// -----------------------------------------------------------------------------
+//
+extern "C"
+PyObject *copies_within_planes(PyObject *, PyObject *args, PyObject *keywds)
+{
+  float center[3], radius;
+  FArray positions, planes;
+  const char *kwlist[] = {"center", "radius", "positions", "planes", NULL};
+  if (!PyArg_ParseTupleAndKeywords(args, keywds, const_cast<char *>("O&fO&O&"),
+				   (char **)kwlist,
+				   parse_float_3_array, &center[0],
+				   &radius,
+				   parse_float_array, &positions,
+				   parse_float_n4_array, &planes))
+    return NULL;
+
+  if (positions.dimension() != 3)
+    return PyErr_Format(PyExc_ValueError, "Positions array is not 3 dimensional, got %d",
+			positions.dimension());
+  if (positions.size(1) != 3 || positions.size(2) != 4)
+    return PyErr_Format(PyExc_ValueError, "Positions array is not of size Nx3x4, got %s",
+			positions.size_string().c_str());
+
+  unsigned char *cmask;
+  PyObject *cm = python_bool_array(positions.size(0), &cmask);
+  Py_BEGIN_ALLOW_THREADS
+  copies_within_planes(center, radius, positions, planes, cmask);
+  Py_END_ALLOW_THREADS
+  return cm;
+}
@@ -50,6 +50,9 @@ PyObject *spheres_in_bounds(PyObject *, PyObject *args, PyObject *keywds);
 PyObject *bounds_overlap(PyObject *, PyObject *args, PyObject *keywds);
 // points_within_planes(points, planes) -> point mask
 PyObject *points_within_planes(PyObject *, PyObject *args, PyObject *keywds);
+// copies_within_planes(center, radius, positions, planes) -> position mask for
+//   bounding sphere copies not entirely outside any plane.
+PyObject *copies_within_planes(PyObject *, PyObject *args, PyObject *keywds);
 }
 
 #endif
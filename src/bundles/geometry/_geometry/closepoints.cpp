@@ -27,14 +27,18 @@
 //
 #include <Python.h>			// use PyTuple*(), ...
 #include <cstdint>			// use std::int64_t
+#include <algorithm>			// use std::min
+#include <atomic>			// use std::atomic
 #include <iostream>			// use std:cerr for debugging
 #include <map>				// use map
+#include <unordered_map>		// use std::unordered_map
 #include <vector>			// use vector
 
 #include <math.h>			// use floor()
 
 #include <arrays/pythonarray.h>		// use float_2d_array_values()
 #include <arrays/rcarray.h>		// use FArray
+#include <arrays/threadpool.h>		// use Thread_Pool::run()
 #include "closepoints.h"
 
 using std::vector;
@@ -79,7 +83,182 @@ void find_close_points(Close_Points_Method m,
 		       const vector<Transformed_Points> &p2,
 		       float distance,
 		       vector<Index_List> *i1,
-		       vector<Index_List> *i2);
+		       vector<Index_List> *i2,
+		       vector<int> *set_pairs = NULL);
+
+// ----------------------------------------------------------------------------
+// Cell list of points kept between calls, for finding points close to many
+// batches of query points without rebinning the indexed points each time.
+//
+class Close_Points_Index
+{
+ public:
+  Close_Points_Index(const float *xyz, Index n, float cell_size, const float *xform);
+  Index size() const { return _xyz.size()/3; }
+  // Indices of query points anywhere within distance d of an indexed point,
+  // indexed points within distance d of a query point, and the closest
+  // indexed point for each query point in i1.
+  void find_close_points(const float *xyz, Index n, float d,
+			 Index_List *i1, Index_List *i2, Index_List *nearest1) const;
+  // Every query point and indexed point pair within distance d, with
+  // distances, searching on the calling thread.
+  void close_pairs(const float *xyz, Index n, float d,
+		   Index_List *query, Index_List *indexed, vector<float> *distances) const;
+ private:
+  vector<float> _xyz;
+  float _cell_size;
+  std::unordered_map<std::int64_t, Index_List> _cells;
+
+  static std::int64_t cell_key(int i, int j, int k)
+    { return ((static_cast<std::int64_t>(i) & 0x1fffff) << 42) |
+	((static_cast<std::int64_t>(j) & 0x1fffff) << 21) |
+	(static_cast<std::int64_t>(k) & 0x1fffff); }
+  int cell_index(float x) const
+    { return static_cast<int>(floor(x / _cell_size)); }
+  void search(const float *xyz, Index start, Index end, float d,
+	      Index_List *i1, Index_List *i2, Index_List *nearest1) const;
+};
+
+// ----------------------------------------------------------------------------
+// The optional 3 by 4 transform is applied to the indexed points.
+//
+Close_Points_Index::Close_Points_Index(const float *xyz, Index n, float cell_size,
+				       const float *xform)
+  : _xyz(xyz, xyz + 3*n), _cell_size(cell_size > 0 ? cell_size : 1)
+{
+  if (xform)
+    for (Index p = 0 ; p < 3*n ; p += 3)
+      {
+	float x = xyz[p], y = xyz[p+1], z = xyz[p+2];
+	for (int a = 0 ; a < 3 ; ++a)
+	  _xyz[p+a] = (xform[4*a]*x + xform[4*a+1]*y + xform[4*a+2]*z
+		       + xform[4*a+3]);
+      }
+  for (Index p = 0 ; p < n ; ++p)
+    {
+      const float *c = &_xyz[3*p];
+      _cells[cell_key(cell_index(c[0]), cell_index(c[1]), cell_index(c[2]))].push_back(p);
+    }
+}
+
+// ----------------------------------------------------------------------------
+// Query points are split into chunks searched on separate threads.
+//
+void Close_Points_Index::find_close_points(const float *xyz, Index n, float d,
+					   Index_List *i1, Index_List *i2,
+					   Index_List *nearest1) const
+{
+  Index chunk = 4096;
+  int nt = Thread_Pool::thread_count((n + chunk - 1) / chunk);
+  if (nt <= 1)
+    {
+      search(xyz, 0, n, d, i1, i2, nearest1);
+    }
+  else
+    {
+      vector<Index_List> ti1(nt), ti2(nt), tnear(nt);
+      Thread_Pool::run(nt, [&](int t) {
+	  search(xyz, n * t / nt, n * (t+1) / nt, d,
+		 &ti1[t], &ti2[t], (nearest1 ? &tnear[t] : NULL));
+	});
+      for (int t = 0 ; t < nt ; ++t)
+	{
+	  i1->insert(i1->end(), ti1[t].begin(), ti1[t].end());
+	  i2->insert(i2->end(), ti2[t].begin(), ti2[t].end());
+	  if (nearest1)
+	    nearest1->insert(nearest1->end(), tnear[t].begin(), tnear[t].end());
+	}
+    }
+
+  // Report each indexed point once, in increasing order.
+  vector<bool> close(size(), false);
+  for (auto p: *i2)
+    close[p] = true;
+  i2->clear();
+  for (Index p = 0 ; p < size() ; ++p)
+    if (close[p])
+      i2->push_back(p);
+}
+
+// ----------------------------------------------------------------------------
+//
+void Close_Points_Index::search(const float *xyz, Index start, Index end, float d,
+				Index_List *i1, Index_List *i2, Index_List *nearest1) const
+{
+  float d2_limit = d * d;
+  for (Index q = start ; q < end ; ++q)
+    {
+      float x = xyz[3*q], y = xyz[3*q+1], z = xyz[3*q+2];
+      int i0 = cell_index(x-d), i1c = cell_index(x+d);
+      int j0 = cell_index(y-d), j1c = cell_index(y+d);
+      int k0 = cell_index(z-d), k1c = cell_index(z+d);
+      Index closest = -1;
+      float closest_d2 = 0;
+      for (int i = i0 ; i <= i1c ; ++i)
+	for (int j = j0 ; j <= j1c ; ++j)
+	  for (int k = k0 ; k <= k1c ; ++k)
+	    {
+	      auto c = _cells.find(cell_key(i, j, k));
+	      if (c == _cells.end())
+		continue;
+	      for (auto p: c->second)
+		{
+		  const float *pxyz = &_xyz[3*p];
+		  float dx = pxyz[0] - x, dy = pxyz[1] - y, dz = pxyz[2] - z;
+		  float d2 = dx*dx + dy*dy + dz*dz;
+		  if (d2 > d2_limit)
+		    continue;
+		  i2->push_back(p);
+		  if (closest == -1 || d2 < closest_d2 || (d2 == closest_d2 && p < closest))
+		    {
+		      closest = p;
+		      closest_d2 = d2;
+		    }
+		}
+	    }
+      if (closest != -1)
+	{
+	  i1->push_back(q);
+	  if (nearest1)
+	    nearest1->push_back(closest);
+	}
+    }
+}
+
+// ----------------------------------------------------------------------------
+//
+void Close_Points_Index::close_pairs(const float *xyz, Index n, float d,
+				     Index_List *query, Index_List *indexed,
+				     vector<float> *distances) const
+{
+  float d2_limit = d * d;
+  for (Index q = 0 ; q < n ; ++q)
+    {
+      float x = xyz[3*q], y = xyz[3*q+1], z = xyz[3*q+2];
+      int i0 = cell_index(x-d), i1 = cell_index(x+d);
+      int j0 = cell_index(y-d), j1 = cell_index(y+d);
+      int k0 = cell_index(z-d), k1 = cell_index(z+d);
+      for (int i = i0 ; i <= i1 ; ++i)
+	for (int j = j0 ; j <= j1 ; ++j)
+	  for (int k = k0 ; k <= k1 ; ++k)
+	    {
+	      auto c = _cells.find(cell_key(i, j, k));
+	      if (c == _cells.end())
+		continue;
+	      for (auto p: c->second)
+		{
+		  const float *pxyz = &_xyz[3*p];
+		  float dx = pxyz[0] - x, dy = pxyz[1] - y, dz = pxyz[2] - z;
+		  float d2 = dx*dx + dy*dy + dz*dz;
+		  if (d2 > d2_limit)
+		    continue;
+		  query->push_back(q);
+		  indexed->push_back(p);
+		  distances->push_back(sqrt(d2));
+		}
+	    }
+    }
+}
 
 // ----------------------------------------------------------------------------
 //
@@ -1018,19 +1197,51 @@ void Point_List::restrict_to_box(const Box &box)
   this->bbox_valid = false;
 }
 
+// ----------------------------------------------------------------------------
+// Pair of point sets with close bounding boxes and the close points found.
+//
+class Set_Pair
+{
+ public:
+  Index k1, k2;
+  Point_List *pl1, *pl2;
+  Index_List i1, i2;
+};
+
+// ----------------------------------------------------------------------------
+//
+static void find_set_pair_close_points(Close_Points_Method m, vector<Set_Pair> *pairs,
+				       std::atomic<size_t> *next, float distance)
+{
+  size_t np = pairs->size();
+  for (size_t p = (*next)++ ; p < np ; p = (*next)++)
+    {
+      Set_Pair &sp = (*pairs)[p];
+      // Make copy of point lists because box filtering methods
+      // reduce point list to sublist.
+      Point_List pl1c(*sp.pl1);
+      Point_List pl2c(*sp.pl2);
+      Index_Set is1(&sp.i1, pl1c.index_range()), is2(&sp.i2, pl2c.index_range());
+      find_close_points(m, pl1c, pl2c, distance, is1, is2, NULL);
+    }
+}
+
 // ----------------------------------------------------------------------------
 // Find contacts between one group of point sets, and another group of
-// point sets.
+// point sets.  Set pairs with close bounding boxes are found first since
+// the bounding box cache is not thread safe, then the close points for
+// those pairs are found in parallel.  If set_pairs is given the pairs of
+// set indices (k1, k2) having close points are added to it.
 //
 void find_close_points(Close_Points_Method m,
 		       const vector<Transformed_Points> &p1,
 		       const vector<Transformed_Points> &p2,
 		       float distance,
-		       vector<Index_List> *i1, vector<Index_List> *i2)
+		       vector<Index_List> *i1, vector<Index_List> *i2,
+		       vector<int> *set_pairs)
 {
-  typedef map<int, Index_Set *> ISTable;
-  ISTable is1, is2;
   BBox_Cache bbox_cache;
+  vector<Set_Pair> pairs;
   Index n1 = p1.size(), n2 = p2.size();
   for (Index k1 = 0 ; k1 < n1 ; ++k1)
     {
@@ -1056,23 +1267,43 @@ void find_close_points(Close_Points_Method m,
 		  if (! boxes_are_close(bbox1, bbox2, distance))
 		    continue;
 		}
+	      Set_Pair sp;
+	      sp.k1 = k1;
+	      sp.k2 = k2;
+	      sp.pl1 = pl1;
+	      sp.pl2 = pl2;
+	      pairs.push_back(sp);
+	    }
+	}
+    }
 
-	      if (static_cast<int>((*i1)[k1].size()) == tp1.n && 
-		  static_cast<int>((*i2)[k2].size()) == tp2.n)
-		// Optimization for d >> size of individual point lists.
-		continue;
+  // Pairs take very different times so threads take the next pair as they finish.
+  std::atomic<size_t> next(0);
+  Thread_Pool::run(Thread_Pool::thread_count(pairs.size()), [&](int) {
+      find_set_pair_close_points(m, &pairs, &next, distance);
+    });
 
-	      // Make copy of point lists because box filtering methods
-	      // reduce point list to sublist.
-	      Point_List pl1c(*pl1);
-	      Point_List pl2c(*pl2);
-	      if (is1.find(k1) == is1.end())
-		is1[k1] = new Index_Set(&(*i1)[k1], pl1c.index_range());
-	      if (is2.find(k2) == is2.end())
-		is2[k2] = new Index_Set(&(*i2)[k2], pl2c.index_range());
-	      find_close_points(m, pl1c, pl2c, distance, *is1[k1], *is2[k2],
-				NULL);
-	    }
+  // Merge close points in pair order so that index order does not depend
+  // on the thread timing.
+  typedef map<Index, Index_Set *> ISTable;
+  ISTable is1, is2;
+  for (auto &sp: pairs)
+    {
+      if (sp.i1.empty())
+	continue;
+      if (is1.find(sp.k1) == is1.end())
+	is1[sp.k1] = new Index_Set(&(*i1)[sp.k1], p1[sp.k1].n);
+      if (is2.find(sp.k2) == is2.end())
+	is2[sp.k2] = new Index_Set(&(*i2)[sp.k2], p2[sp.k2].n);
+      Index_Set *s1 = is1[sp.k1], *s2 = is2[sp.k2];
+      for (auto i: sp.i1)
+	s1->add_index(i);
+      for (auto i: sp.i2)
+	s2->add_index(i);
+      if (set_pairs)
+	{
+	  set_pairs->push_back(sp.k1);
+	  set_pairs->push_back(sp.k2);
 	}
     }
 
@@ -1324,11 +1555,13 @@ extern "C" PyObject *find_close_points(PyObject *, PyObject *args, PyObject *key
   FArray cxyz1 = xyz1.contiguous_array(), cxyz2 = xyz2.contiguous_array();
   float *scales = NULL;
   Index_List i1, i2;
+  Py_BEGIN_ALLOW_THREADS
   find_close_points(CP_BOXES,
 		    cxyz1.values(), cxyz1.size(0),
 		    cxyz2.values(), cxyz2.size(0),
 		    static_cast<float>(d), scales,
 		    &i1, &i2);
+  Py_END_ALLOW_THREADS
 
   return python_tuple(c_array_to_python(i1), c_array_to_python(i2));
 }
@@ -1407,6 +1640,316 @@ extern "C" PyObject *find_closest_points(PyObject *, PyObject *args, PyObject *k
   		      c_array_to_python(nearest1));
 }
 
+// ----------------------------------------------------------------------------
+//
+static void delete_close_points_index(PyObject *capsule)
+{
+  delete static_cast<Close_Points_Index *>(PyCapsule_GetPointer(capsule, "Close_Points_Index"));
+}
+
+// ----------------------------------------------------------------------------
+//
+const char *close_points_index_doc =
+  "close_points_index(xyz, cell_size [, transform]) -> index\n"
+  "\n"
+  "Make a spatial index of points for use with close_points_index_search().\n"
+  "Use the ClosePointsIndex class instead of calling this directly.\n"
+  "Implemented in C++.\n"
+  "\n"
+  "Parameters\n"
+  "----------\n"
+  "xyz : n by 3 float array\n"
+  "cell_size : float\n"
+  "  Size of index cells, about the distance that will be searched.\n"
+  "transform : 3 by 4 float array\n"
+  "  Optional transform applied to the points.\n";
+
+// ----------------------------------------------------------------------------
+//
+extern "C" PyObject *close_points_index(PyObject *, PyObject *args, PyObject *keywds)
+{
+  FArray xyz;
+  double cell_size;
+  PyObject *py_xform = Py_None;
+  const char *kwlist[] = {"xyz", "cell_size", "transform", NULL};
+  if (!PyArg_ParseTupleAndKeywords(args, keywds, const_cast<char *>("O&d|O"),
+				   (char **)kwlist,
+				   parse_float_n3_array, &xyz,
+				   &cell_size, &py_xform))
+    return NULL;
+
+  float xf[3][4];
+  if (py_xform != Py_None)
+    try
+      {
+	python_array_to_c(py_xform, &xf[0][0], 3, 4);
+      }
+    catch (std::runtime_error &e)
+      {
+	PyErr_SetString(PyExc_TypeError, e.what());
+	return NULL;
+      }
+
+  FArray cxyz = xyz.contiguous_array();
+  Close_Points_Index *index;
+  Py_BEGIN_ALLOW_THREADS
+  index = new Close_Points_Index(cxyz.values(), cxyz.size(0),
+				 static_cast<float>(cell_size),
+				 (py_xform == Py_None ? NULL : &xf[0][0]));
+  Py_END_ALLOW_THREADS
+  return PyCapsule_New(index, "Close_Points_Index", delete_close_points_index);
+}
+
+// ----------------------------------------------------------------------------
+//
+const char *close_points_index_search_doc =
+  "close_points_index_search(index, xyz, max_distance) -> i1, i2, near1\n"
+  "\n"
+  "Find points close to an index made by close_points_index().\n"
+  "Results are like find_closest_points() with xyz2 the indexed points.\n"
+  "Implemented in C++.\n";
+
+// ----------------------------------------------------------------------------
+//
+extern "C" PyObject *close_points_index_search(PyObject *, PyObject *args, PyObject *keywds)
+{
+  PyObject *py_index;
+  FArray xyz;
+  double d;
+  const char *kwlist[] = {"index", "xyz", "max_distance", NULL};
+  if (!PyArg_ParseTupleAndKeywords(args, keywds, const_cast<char *>("OO&d"),
+				   (char **)kwlist,
+				   &py_index,
+				   parse_float_n3_array, &xyz,
+				   &d))
+    return NULL;
+
+  Close_Points_Index *index = static_cast<Close_Points_Index *>
+    (PyCapsule_GetPointer(py_index, "Close_Points_Index"));
+  if (index == NULL)
+    return NULL;
+
+  FArray cxyz = xyz.contiguous_array();
+  Index_List i1, i2, nearest1;
+  Py_BEGIN_ALLOW_THREADS
+  index->find_close_points(cxyz.values(), cxyz.size(0), static_cast<float>(d),
+			   &i1, &i2, &nearest1);
+  Py_END_ALLOW_THREADS
+
+  return python_tuple(c_array_to_python(i1), c_array_to_python(i2),
+  		      c_array_to_python(nearest1));
+}
+
+// ----------------------------------------------------------------------------
+// Close points between two copies of one point set, each placed by a 3 by 4
+// transform.  Pair indices are into the untransformed point set.
+//
+class Copy_Contacts
+{
+ public:
+  Index_List i1, i2;			// Close points of copy 1 and of copy 2
+  Index_List pair1, pair2;		// Close point pairs, if requested
+  vector<float> distances;
+};
+
+// ----------------------------------------------------------------------------
+// Inverse of a 3 by 4 affine transform.
+//
+static void invert_transform(const double *tf, double inv[3][4])
+{
+  const double *r0 = tf, *r1 = tf + 4, *r2 = tf + 8;
+  double c[3][3] = {{r1[1]*r2[2]-r1[2]*r2[1], r0[2]*r2[1]-r0[1]*r2[2], r0[1]*r1[2]-r0[2]*r1[1]},
+		    {r1[2]*r2[0]-r1[0]*r2[2], r0[0]*r2[2]-r0[2]*r2[0], r0[2]*r1[0]-r0[0]*r1[2]},
+		    {r1[0]*r2[1]-r1[1]*r2[0], r0[1]*r2[0]-r0[0]*r2[1], r0[0]*r1[1]-r0[1]*r1[0]}};
+  double det = r0[0]*c[0][0] + r0[1]*c[1][0] + r0[2]*c[2][0];
+  for (int i = 0 ; i < 3 ; ++i)
+    {
+      for (int j = 0 ; j < 3 ; ++j)
+	inv[i][j] = c[i][j] / det;
+      inv[i][3] = -(inv[i][0]*tf[3] + inv[i][1]*tf[7] + inv[i][2]*tf[11]);
+    }
+}
+
+// ----------------------------------------------------------------------------
+// Copy 2 is moved into the frame of copy 1 so the untransformed points, binned
+// once, are searched for all pairs of copies.  Only copy 2 points within the
+// padded bounding box of the points are searched, so distant copies cost
+// one pass over the points.
+//
+static void copy_contacts(const Close_Points_Index &index, const float *xyz, Index n,
+			  const float *box_min, const float *box_max,
+			  const double *tf1, const double *tf2, float d,
+			  bool pairs, Copy_Contacts *c)
+{
+  double inv1[3][4], rel[3][4];
+  invert_transform(tf1, inv1);
+  for (int i = 0 ; i < 3 ; ++i)
+    for (int j = 0 ; j < 4 ; ++j)
+      rel[i][j] = (inv1[i][0]*tf2[j] + inv1[i][1]*tf2[4+j] + inv1[i][2]*tf2[8+j]
+		   + (j == 3 ? inv1[i][3] : 0));
+
+  // Skip copies whose moved bounding box misses the padded box.
+  for (int a = 0 ; a < 3 ; ++a)
+    {
+      double lo = rel[a][3], hi = rel[a][3];
+      for (int b = 0 ; b < 3 ; ++b)
+	{
+	  double r0 = rel[a][b]*box_min[b], r1 = rel[a][b]*box_max[b];
+	  lo += std::min(r0, r1);
+	  hi += std::max(r0, r1);
+	}
+      if (hi < box_min[a] - d || lo > box_max[a] + d)
+	return;
+    }
+
+  vector<float> q;
+  Index_List qindex;
+  for (Index p = 0 ; p < n ; ++p)
+    {
+      const float *pxyz = xyz + 3*p;
+      float t[3];
+      bool inside = true;
+      for (int a = 0 ; a < 3 && inside ; ++a)
+	{
+	  t[a] = rel[a][0]*pxyz[0] + rel[a][1]*pxyz[1] + rel[a][2]*pxyz[2] + rel[a][3];
+	  inside = (t[a] >= box_min[a] - d && t[a] <= box_max[a] + d);
+	}
+      if (inside)
+	{
+	  q.insert(q.end(), t, t+3);
+	  qindex.push_back(p);
+	}
+    }
+  if (qindex.empty())
+    return;
+
+  Index_List qi, pi;
+  vector<float> dist;
+  index.close_pairs(q.data(), qindex.size(), d, &qi, &pi, &dist);
+
+  vector<bool> close1(n, false), close2(n, false);
+  for (size_t k = 0 ; k < qi.size() ; ++k)
+    {
+      close1[pi[k]] = true;
+      close2[qindex[qi[k]]] = true;
+    }
+  for (Index p = 0 ; p < n ; ++p)
+    {
+      if (close1[p])
+	c->i1.push_back(p);
+      if (close2[p])
+	c->i2.push_back(p);
+    }
+  if (pairs)
+    {
+      c->pair1.swap(pi);
+      for (auto k: qi)
+	c->pair2.push_back(qindex[k]);
+      c->distances.swap(dist);
+    }
+}
+
+// ----------------------------------------------------------------------------
+//
+const char *find_close_points_copies_doc =
+  "find_close_points_copies(xyz, transforms1, transforms2, max_distance, pairs = False) -> i1, i2\n"
+  "\n"
+  "Find close points between pairs of copies of one set of points, such as\n"
+  "symmetry copies of a crystal asymmetric unit.  Copy pair k places the\n"
+  "points with transforms1[k] and transforms2[k].  The points are binned once\n"
+  "and copy pairs are searched in parallel, skipping pairs whose bounding\n"
+  "boxes are farther apart than the maximum distance.\n"
+  "Implemented in C++.\n"
+  "\n"
+  "Parameters\n"
+  "----------\n"
+  "xyz : n by 3 float array\n"
+  "transforms1, transforms2 : m by 3 by 4 float64 arrays\n"
+  "max_distance : float\n"
+  "pairs : bool\n"
+  "  Whether to also return every close point pair.\n"
+  "\n"
+  "Returns\n"
+  "-------\n"
+  "i1, i2 : tuples of numpy int arrays\n"
+  "  For each copy pair the indices of points of the first copy near the\n"
+  "  second copy, and of points of the second copy near the first.\n"
+  "pairs : tuple of (p1, p2, distances)\n"
+  "  Returned as a third value only if the pairs argument is true.\n"
+  "  For each copy pair the point indices of the first and second copy\n"
+  "  for each close pair, and their distances as a float32 array.\n";
+
+// ----------------------------------------------------------------------------
+//
+extern "C" PyObject *find_close_points_copies(PyObject *, PyObject *args, PyObject *keywds)
+{
+  FArray xyz;
+  DArray tf1, tf2;
+  double d;
+  int return_pairs = 0;
+  const char *kwlist[] = {"xyz", "transforms1", "transforms2", "max_distance", "pairs", NULL};
+  if (!PyArg_ParseTupleAndKeywords(args, keywds, const_cast<char *>("O&O&O&d|p"),
+				   (char **)kwlist,
+				   parse_float_n3_array, &xyz,
+				   parse_contiguous_double_n34_array, &tf1,
+				   parse_contiguous_double_n34_array, &tf2,
+				   &d, &return_pairs))
+    return NULL;
+  if (tf1.size(0) != tf2.size(0))
+    {
+      PyErr_SetString(PyExc_TypeError,
+		      "find_close_points_copies(): transform arrays have different sizes");
+      return NULL;
+    }
+
+  FArray cxyz = xyz.contiguous_array();
+  const float *xa = cxyz.values();
+  Index n = cxyz.size(0), m = tf1.size(0);
+  vector<Copy_Contacts> contacts(m);
+  Py_BEGIN_ALLOW_THREADS
+  if (n > 0 && m > 0)
+    {
+      float box_min[3], box_max[3];
+      for (int a = 0 ; a < 3 ; ++a)
+	box_min[a] = box_max[a] = xa[a];
+      for (Index p = 0 ; p < 3*n ; p += 3)
+	for (int a = 0 ; a < 3 ; ++a)
+	  {
+	    box_min[a] = std::min(box_min[a], xa[p+a]);
+	    box_max[a] = std::max(box_max[a], xa[p+a]);
+	  }
+      float fd = static_cast<float>(d);
+      Close_Points_Index index(xa, n, fd, NULL);
+      const double *t1 = tf1.values(), *t2 = tf2.values();
+      std::atomic<Index> next(0);
+      Thread_Pool::run(Thread_Pool::thread_count(m), [&](int) {
+	  for (Index k = next++ ; k < m ; k = next++)
+	    copy_contacts(index, xa, n, box_min, box_max, t1 + 12*k, t2 + 12*k, fd,
+			  return_pairs, &contacts[k]);
+	});
+    }
+  Py_END_ALLOW_THREADS
+
+  PyObject *i1 = PyTuple_New(m), *i2 = PyTuple_New(m);
+  for (Index k = 0 ; k < m ; ++k)
+    {
+      PyTuple_SetItem(i1, k, c_array_to_python(contacts[k].i1));
+      PyTuple_SetItem(i2, k, c_array_to_python(contacts[k].i2));
+    }
+  if (!return_pairs)
+    return python_tuple(i1, i2);
+
+  PyObject *pairs = PyTuple_New(m);
+  for (Index k = 0 ; k < m ; ++k)
+    {
+      Copy_Contacts &c = contacts[k];
+      PyTuple_SetItem(pairs, k, python_tuple(c_array_to_python(c.pair1),
+					     c_array_to_python(c.pair2),
+					     c_array_to_python(c.distances)));
+    }
+  return python_tuple(i1, i2, pairs);
+}
+
 // ----------------------------------------------------------------------------
 //
 static bool transformed_points(PyObject *py_tp, Transformed_Points *tp)
@@ -1524,7 +2067,11 @@ const char *find_close_points_sets_doc =
   "  Two tuples of arrays of indices with lengths matching\n"
   "  the lengths of the tp1 and tp2 arguments. Each index array list\n"
   "  indices into the corresponding transformed point array for points\n"
-  "  that have some nearby point in the other set.\n";
+  "  that have some nearby point in the other set.\n"
+  "set_pairs : n by 2 numpy int32 array\n"
+  "  Returned as a third value only if the set_pairs argument is true.\n"
+  "  Pairs of indices into tp1 and tp2 for sets that have close points.\n"
+  "  Set pairs are searched in parallel using multiple threads.\n";
 
 // ----------------------------------------------------------------------------
 //
@@ -1532,11 +2079,12 @@ extern "C" PyObject *find_close_points_sets(PyObject *, PyObject *args, PyObject
 {
   PyObject *py_tp1, *py_tp2;
   double d;
-  const char *kwlist[] = {"tp1", "tp2", "max_distance", NULL};
+  int return_set_pairs = 0;
+  const char *kwlist[] = {"tp1", "tp2", "max_distance", "set_pairs", NULL};
 
-  if (!PyArg_ParseTupleAndKeywords(args, keywds, const_cast<char *>("OOd"),
+  if (!PyArg_ParseTupleAndKeywords(args, keywds, const_cast<char *>("OOd|p"),
 				   (char **)kwlist,
-				   &py_tp1, &py_tp2, &d))
+				   &py_tp1, &py_tp2, &d, &return_set_pairs))
     return NULL;
 
   vector<Transformed_Points> p1, p2;
@@ -1546,9 +2094,14 @@ extern "C" PyObject *find_close_points_sets(PyObject *, PyObject *args, PyObject
 
   Index n1 = p1.size(), n2 = p2.size();
   vector<Index_List> i1(n1), i2(n2);
+  vector<int> set_pairs;
   Py_BEGIN_ALLOW_THREADS
-  find_close_points(CP_BOXES, p1, p2, static_cast<float>(d), &i1, &i2);
+  find_close_points(CP_BOXES, p1, p2, static_cast<float>(d), &i1, &i2,
+		    (return_set_pairs ? &set_pairs : NULL));
   Py_END_ALLOW_THREADS
 
+  if (return_set_pairs)
+    return python_tuple(index_lists(i1), index_lists(i2),
+			c_array_to_python(set_pairs, set_pairs.size()/2, 2));
   return python_tuple(index_lists(i1), index_lists(i2));
 }
@@ -44,6 +44,18 @@ extern const char *find_closest_points_doc;
 // find_close_points_sets(tp1, tp2, max_dist) -> (indices1, indices2) with tp1 = [(transform1, xyz1), ...]
 extern "C" PyObject *find_close_points_sets(PyObject *, PyObject *args, PyObject *keywds);
 extern const char *find_close_points_sets_doc;
+
+// close_points_index(xyz, cell_size, transform) -> index used by close_points_index_search()
+extern "C" PyObject *close_points_index(PyObject *, PyObject *args, PyObject *keywds);
+extern const char *close_points_index_doc;
+
+// close_points_index_search(index, xyz1, max_dist) -> (indices1, indices2, nearest1)
+extern "C" PyObject *close_points_index_search(PyObject *, PyObject *args, PyObject *keywds);
+extern const char *close_points_index_search_doc;
+
+// find_close_points_copies(xyz, transforms1, transforms2, max_dist) -> (indices1, indices2)
+extern "C" PyObject *find_close_points_copies(PyObject *, PyObject *args, PyObject *keywds);
+extern const char *find_close_points_copies_doc;
 }
 
 #endif
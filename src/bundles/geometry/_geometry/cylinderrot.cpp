@@ -32,57 +32,107 @@
 
 #include <arrays/pythonarray.h>		// use array_from_python()
 #include <arrays/rcarray.h>		// use call_template_function()
+#include <arrays/threadpool.h>		// use Thread_Pool::parallel_for()
 
 #ifndef M_PI
 # define M_PI		3.14159265358979323846
 #endif
 
 // -----------------------------------------------------------------------------
+// Set the 4x4 rotation and scale, without translation, taking the unit
+// cylinder along z to one cylinder.  Returns the rotation matrix through
+// rot44, and rot44b also gets a copy if it is not null.
 //
-static void cylinder_rotations(float *axyz0, float *axyz1, int n, float *radii,
-			       float *rot44)
+inline void cylinder_rotation(const float *xyz0, const float *xyz1, float r,
+			      float *rot44, float *rot44b = NULL)
 {
-  for (int i = 0 ; i < n ; ++i, axyz0 += 3, axyz1 += 3)
-    {
-      float vx = axyz1[0] - axyz0[0];
-      float vy = axyz1[1] - axyz0[1];
-      float vz = axyz1[2] - axyz0[2];
-      float h = sqrtf(vx*vx + vy*vy + vz*vz);
-      if (h == 0)
-	{ vx = vy = 0 ; vz = 1; }
-      else
-	{ vx /= h; vy /= h; vz /= h; }
-
-      float r = *radii++;
-      float sx = r, sy = r, sz = h;
-      
-      // Avoid degenerate vz = -1 case.
-      if (vz < 0)
-	{ vx = -vx; vy = -vy; vz = -vz; sx = -r; sz = -h; }
-
-      float c1 = 1.0/(1+vz);
-      float vxx = c1*vx*vx, vyy = c1*vy*vy, vxy = c1*vx*vy;
-
-      *rot44++ = sx*(vyy + vz);
-      *rot44++ = -sx*vxy;
-      *rot44++ = -sx*vx;
-      *rot44++ = 0;
-
-      *rot44++ = -sy*vxy;
-      *rot44++ = sy*(vxx + vz);
-      *rot44++ = -sy*vy;
-      *rot44++ = 0;
+  float vx = xyz1[0] - xyz0[0];
+  float vy = xyz1[1] - xyz0[1];
+  float vz = xyz1[2] - xyz0[2];
+  float h = sqrtf(vx*vx + vy*vy + vz*vz);
+  if (h == 0)
+    { vx = vy = 0 ; vz = 1; }
+  else
+    { vx /= h; vy /= h; vz /= h; }
+
+  float sx = r, sy = r, sz = h;
+
+  // Avoid degenerate vz = -1 case.
+  if (vz < 0)
+    { vx = -vx; vy = -vy; vz = -vz; sx = -r; sz = -h; }
+
+  float c1 = 1.0/(1+vz);
+  float vxx = c1*vx*vx, vyy = c1*vy*vy, vxy = c1*vx*vy;
+
+  float m[12] = {sx*(vyy + vz), -sx*vxy, -sx*vx, 0,
+		 -sy*vxy, sy*(vxx + vz), -sy*vy, 0,
+		 sz*vx, sz*vy, sz*vz, 0};
+  for (int j = 0 ; j < 12 ; ++j)
+    rot44[j] = m[j];
+  if (rot44b)
+    for (int j = 0 ; j < 12 ; ++j)
+      rot44b[j] = m[j];
+}
 
-      *rot44++ = sz*vx;
-      *rot44++ = sz*vy;
-      *rot44++ = sz*vz;
-      *rot44++ = 0;
+// -----------------------------------------------------------------------------
+// Cylinders i0 to i1-1 are written to matrix rows changed[i] if changed is
+// not null, otherwise to row i.
+//
+static void cylinder_rotations(const float *axyz0, const float *axyz1, int64_t i0, int64_t i1,
+			       const float *radii, const int *changed, float *rot44)
+{
+  for (int64_t i = i0 ; i < i1 ; ++i)
+    {
+      float *m = rot44 + 16*(changed ? changed[i] : i);
+      cylinder_rotation(axyz0 + 3*i, axyz1 + 3*i, radii[i], m);
+      m[12] = m[13] = m[14] = 0;
+      m[15] = 1;
+    }
+}
 
-      *rot44++ = 0;
-      *rot44++ = 0;
-      *rot44++ = 0;
-      *rot44++ = 1;
+// -----------------------------------------------------------------------------
+// Check that cylinders and changed matrix indices are valid.
+//
+static bool check_cylinder_arrays(const FArray &xyz0, const FArray &xyz1, const FArray &radii,
+				  const FArray &rot44, int64_t num_matrices,
+				  const IArray &changed, bool has_changed)
+{
+  int64_t n = xyz0.size(0);
+  if (xyz1.size(0) != n || radii.size(0) != n)
+    {
+      PyErr_Format(PyExc_ValueError,
+		   "Cylinder end-point and radii arrays must have same size, got sizes %s %s %s",
+		   xyz0.size_string(0).c_str(), xyz1.size_string(0).c_str(),
+		   radii.size_string(0).c_str());
+      return false;
+    }
+  if (!xyz0.is_contiguous() || !xyz1.is_contiguous() || !radii.is_contiguous()
+      || !rot44.is_contiguous())
+    {
+      PyErr_Format(PyExc_ValueError,
+		   "Cylinder end point, radii or rotation array not contiguous.");
+      return false;
+    }
+  if (has_changed)
+    {
+      if (changed.size(0) != n || !changed.is_contiguous())
+	{
+	  PyErr_Format(PyExc_ValueError,
+		       "Changed cylinder indices must be contiguous with one per cylinder, got %s for %s cylinders",
+		       changed.size_string(0).c_str(), xyz0.size_string(0).c_str());
+	  return false;
+	}
+      const int *c = changed.values();
+      for (int64_t i = 0 ; i < n ; ++i)
+	if (c[i] < 0 || c[i] >= num_matrices)
+	  {
+	    PyErr_Format(PyExc_ValueError,
+			 "Changed cylinder index %d out of range 0 to %lld",
+			 c[i], (long long)(num_matrices - 1));
+	    return false;
+	  }
     }
+  return true;
 }
 
 // -----------------------------------------------------------------------------
@@ -91,87 +141,69 @@ extern "C"
 PyObject *cylinder_rotations(PyObject *, PyObject *args, PyObject *keywds)
 {
   FArray xyz0, xyz1, radii, rot44;
-  const char *kwlist[] = {"xyz0", "xyz1", "radii", "rot44", NULL};
-  if (!PyArg_ParseTupleAndKeywords(args, keywds, const_cast<char *>("O&O&O&O&"),
+  IArray changed;
+  PyObject *py_changed = Py_None;
+  const char *kwlist[] = {"xyz0", "xyz1", "radii", "rot44", "changed", NULL};
+  if (!PyArg_ParseTupleAndKeywords(args, keywds, const_cast<char *>("O&O&O&O&|O"),
 				   (char **)kwlist,
 				   parse_float_n3_array, &xyz0,
 				   parse_float_n3_array, &xyz1,
 				   parse_float_n_array, &radii,
-				   parse_writable_float_3d_array, &rot44))
+				   parse_writable_float_3d_array, &rot44,
+				   &py_changed))
+    return NULL;
+  bool has_changed = (py_changed != Py_None);
+  if (has_changed && !parse_int_n_array(py_changed, &changed))
     return NULL;
 
   int64_t n = xyz0.size(0);
-  if (xyz1.size(0) != n || radii.size(0) != n)
-    return PyErr_Format(PyExc_ValueError,
-			"Cylinder end-point and radii arrays must have same size, got sizes %s %s %s",
-			xyz0.size_string(0).c_str(), xyz1.size_string(0).c_str(),
-			radii.size_string(0).c_str());
-  if (rot44.size(0) != n || rot44.size(1) != 4 || rot44.size(2) != 4)
+  int64_t nm = (has_changed ? rot44.size(0) : n);
+  if (rot44.size(0) != nm || rot44.size(1) != 4 || rot44.size(2) != 4)
     return PyErr_Format(PyExc_ValueError,
 			"Cylinder rotations wrong size, got (%s), expected (%s,4,4)",
 			rot44.size_string().c_str(), xyz0.size_string(0).c_str());
-  if (!xyz0.is_contiguous() || !xyz1.is_contiguous() || !radii.is_contiguous()
-      || !rot44.is_contiguous())
-    return PyErr_Format(PyExc_ValueError,
-			"Cylinder end point, radii or rotation array not contiguous.");
+  if (!check_cylinder_arrays(xyz0, xyz1, radii, rot44, nm, changed, has_changed))
+    return NULL;
 
-  cylinder_rotations(xyz0.values(), xyz1.values(), n, radii.values(), rot44.values());
+  const float *a0 = xyz0.values(), *a1 = xyz1.values(), *r = radii.values();
+  const int *c = (has_changed ? changed.values() : NULL);
+  float *m = rot44.values();
+  Py_BEGIN_ALLOW_THREADS
+  Thread_Pool::parallel_for(n, [=](int64_t i0, int64_t i1) {
+      cylinder_rotations(a0, a1, i0, i1, r, c, m);
+    }, 4096);
+  Py_END_ALLOW_THREADS
 
   return python_none();
 }
 
 // -----------------------------------------------------------------------------
+// The matrices for the second halves are written to rot44 rows offset by nm,
+// the number of bonds in the matrix array.
 //
-static void half_cylinder_rotations(float *axyz0, float *axyz1, int64_t n, float *radii,
-				    float *rot44)
+static void half_cylinder_rotations(const float *axyz0, const float *axyz1,
+				    int64_t i0, int64_t i1, const float *radii,
+				    const int *changed, int64_t nm, float *rot44)
 {
-  float *rot44b = rot44 + 16*n;
-  for (int64_t i = 0 ; i < n ; ++i, axyz0 += 3, axyz1 += 3)
+  for (int64_t i = i0 ; i < i1 ; ++i)
     {
-      float x0 = axyz0[0], x1 = axyz1[0];
-      float y0 = axyz0[1], y1 = axyz1[1];
-      float z0 = axyz0[2], z1 = axyz1[2];
-      float vx = x1-x0, vy = y1-y0, vz = z1-z0;
-      float h = sqrtf(vx*vx + vy*vy + vz*vz);
-      if (h == 0)
-	{ vx = vy = 0 ; vz = 1; }
-      else
-	{ vx /= h; vy /= h; vz /= h; }
-
-      float r = *radii++;
-      float sx = r, sy = r, sz = h;
-
-      // Avoid degenerate vz = -1 case.
-      if (vz < 0)
-	{ vx = -vx; vy = -vy; vz = -vz; sx = -r; sz = -h; }
-
-      float c1 = 1.0/(1+vz);
-      float vxx = c1*vx*vx, vyy = c1*vy*vy, vxy = c1*vx*vy;
-
-      *rot44++ = *rot44b++ = sx*(vyy + vz);
-      *rot44++ = *rot44b++ = -sx*vxy;
-      *rot44++ = *rot44b++ = -sx*vx;
-      *rot44++ = *rot44b++ = 0;
-
-      *rot44++ = *rot44b++ = -sy*vxy;
-      *rot44++ = *rot44b++ = sy*(vxx + vz);
-      *rot44++ = *rot44b++ = -sy*vy;
-      *rot44++ = *rot44b++ = 0;
-
-      *rot44++ = *rot44b++ = sz*vx;
-      *rot44++ = *rot44b++ = sz*vy;
-      *rot44++ = *rot44b++ = sz*vz;
-      *rot44++ = *rot44b++ = 0;
-
-      *rot44++ = .75*x0 + .25*x1;
-      *rot44++ = .75*y0 + .25*y1;
-      *rot44++ = .75*z0 + .25*z1;
-      *rot44++ = 1;
-
-      *rot44b++ = .25*x0 + .75*x1;
-      *rot44b++ = .25*y0 + .75*y1;
-      *rot44b++ = .25*z0 + .75*z1;
-      *rot44b++ = 1;
+      const float *xyz0 = axyz0 + 3*i, *xyz1 = axyz1 + 3*i;
+      int64_t mi = (changed ? changed[i] : i);
+      float *m = rot44 + 16*mi, *mb = rot44 + 16*(nm + mi);
+      cylinder_rotation(xyz0, xyz1, radii[i], m, mb);
+
+      float x0 = xyz0[0], x1 = xyz1[0];
+      float y0 = xyz0[1], y1 = xyz1[1];
+      float z0 = xyz0[2], z1 = xyz1[2];
+      m[12] = .75*x0 + .25*x1;
+      m[13] = .75*y0 + .25*y1;
+      m[14] = .75*z0 + .25*z1;
+      m[15] = 1;
+
+      mb[12] = .25*x0 + .75*x1;
+      mb[13] = .25*y0 + .75*y1;
+      mb[14] = .25*z0 + .75*z1;
+      mb[15] = 1;
     }
 }
 
@@ -181,31 +213,38 @@ extern "C"
 PyObject *half_cylinder_rotations(PyObject *, PyObject *args, PyObject *keywds)
 {
   FArray xyz0, xyz1, radii, rot44;
-  const char *kwlist[] = {"xyz0", "xyz1", "radii", "rot44", NULL};
-  if (!PyArg_ParseTupleAndKeywords(args, keywds, const_cast<char *>("O&O&O&O&"),
+  IArray changed;
+  PyObject *py_changed = Py_None;
+  const char *kwlist[] = {"xyz0", "xyz1", "radii", "rot44", "changed", NULL};
+  if (!PyArg_ParseTupleAndKeywords(args, keywds, const_cast<char *>("O&O&O&O&|O"),
 				   (char **)kwlist,
 				   parse_float_n3_array, &xyz0,
 				   parse_float_n3_array, &xyz1,
 				   parse_float_n_array, &radii,
-				   parse_writable_float_3d_array, &rot44))
+				   parse_writable_float_3d_array, &rot44,
+				   &py_changed))
+    return NULL;
+  bool has_changed = (py_changed != Py_None);
+  if (has_changed && !parse_int_n_array(py_changed, &changed))
     return NULL;
 
   int64_t n = xyz0.size(0);
-  if (xyz1.size(0) != n || radii.size(0) != n)
-    return PyErr_Format(PyExc_ValueError,
-			"Cylinder end-point and radii arrays must have same size, got sizes %s %s %s",
-			xyz0.size_string(0).c_str(), xyz1.size_string(0).c_str(),
-			radii.size_string(0).c_str());
-  if (rot44.size(0) != 2*n || rot44.size(1) != 4 || rot44.size(2) != 4)
+  int64_t nm = (has_changed ? rot44.size(0) / 2 : n);
+  if (rot44.size(0) != 2*nm || rot44.size(1) != 4 || rot44.size(2) != 4)
     return PyErr_Format(PyExc_ValueError,
 			"Cylinder rotations wrong size, got (%s), expected (2*%s,4,4)",
 			rot44.size_string().c_str(), xyz0.size_string(0).c_str());
-  if (!xyz0.is_contiguous() || !xyz1.is_contiguous() || !radii.is_contiguous()
-      || !rot44.is_contiguous())
-    return PyErr_Format(PyExc_ValueError,
-			"Cylinder end point, radii or rotation array not contiguous.");
+  if (!check_cylinder_arrays(xyz0, xyz1, radii, rot44, nm, changed, has_changed))
+    return NULL;
 
-  half_cylinder_rotations(xyz0.values(), xyz1.values(), n, radii.values(), rot44.values());
+  const float *a0 = xyz0.values(), *a1 = xyz1.values(), *r = radii.values();
+  const int *c = (has_changed ? changed.values() : NULL);
+  float *m = rot44.values();
+  Py_BEGIN_ALLOW_THREADS
+  Thread_Pool::parallel_for(n, [=](int64_t i0, int64_t i1) {
+      half_cylinder_rotations(a0, a1, i0, i1, r, c, nm, m);
+    }, 4096);
+  Py_END_ALLOW_THREADS
 
   return python_none();
 }
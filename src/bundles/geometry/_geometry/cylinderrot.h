@@ -35,9 +35,12 @@
 
 extern "C"
 {
-// cylinder_rotations(xyz0, xyz1, radii, rot44)
+// Matrices are written to the caller's rot44 array.  If the optional changed
+// index array is given, cylinder i sets only matrix changed[i] and other
+// matrices are left as they were, so moving a few bonds updates only those.
+// cylinder_rotations(xyz0, xyz1, radii, rot44, changed = None)
 PyObject *cylinder_rotations(PyObject *, PyObject *args, PyObject *keywds);
-// half_cylinder_rotations(xyz0, xyz1, radii, rot44)
+// half_cylinder_rotations(xyz0, xyz1, radii, rot44, changed = None)
 PyObject *half_cylinder_rotations(PyObject *, PyObject *args, PyObject *keywds);
 // cylinder_rotations_x3d(xyz0, xyz1, radii, float [n * 9])
 PyObject *cylinder_rotations_x3d(PyObject *, PyObject *args, PyObject *keywds);
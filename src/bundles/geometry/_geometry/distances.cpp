@@ -26,24 +26,45 @@
 
 // ----------------------------------------------------------------------------
 //
-#include <math.h>			// use sqrt()
+#include <math.h>			// use sqrtf()
+#include <algorithm>			// use std::min, std::max
+#include <mutex>			// use std::mutex
+#include <vector>			// use std::vector
+
+#include <arrays/threadpool.h>		// use Thread_Pool::run()
 #include "distances.h"
 
 namespace Distances
 {
 
+// ----------------------------------------------------------------------------
+// Call f(start, end) on ranges of n items using the shared thread pool when
+// there are enough items to be worth using threads.
+//
+template <class F>
+static void split_over_threads(int64_t n, int64_t min_per_thread, F f)
+{
+  int nt = Thread_Pool::thread_count(n, min_per_thread);
+  Thread_Pool::run(nt, [&](int t) { f(n*t/nt, n*(t+1)/nt); });
+}
+
+// Loops below use float square roots and no branches so the compiler vectorizes them.
+static const int64_t min_points_per_thread = 1000000;
+
 // ----------------------------------------------------------------------------
 //
 void distances_from_origin(float points[][3], int n, float origin[3],
 			   float distances[])
 {
   float x0 = origin[0], y0 = origin[1], z0 = origin[2];
-  for (int k = 0 ; k < n ; ++k)
-    {
-      float *p = points[k];
-      float dx = p[0] - x0, dy = p[1] - y0, dz = p[2] - z0;
-      distances[k] = static_cast<float>(sqrt(dx*dx + dy*dy + dz*dz));
-    }
+  split_over_threads(n, min_points_per_thread, [=](int64_t k0, int64_t k1) {
+      for (int64_t k = k0 ; k < k1 ; ++k)
+	{
+	  float *p = points[k];
+	  float dx = p[0] - x0, dy = p[1] - y0, dz = p[2] - z0;
+	  distances[k] = sqrtf(dx*dx + dy*dy + dz*dz);
+	}
+    });
 }
 
 // ----------------------------------------------------------------------------
@@ -54,18 +75,19 @@ void distances_perpendicular_to_axis(float points[][3], int n,
 {
   float x0 = origin[0], y0 = origin[1], z0 = origin[2];
   float ax = axis[0], ay = axis[1], az = axis[2];
-  float norm = static_cast<float>(sqrt(ax*ax + ay*ay + az*az));
+  float norm = sqrtf(ax*ax + ay*ay + az*az);
   if (norm != 0)
-    { ax /= norm; ay /= norm ; ax /= norm; }
-  for (int k = 0 ; k < n ; ++k)
-    {
-      float *p = points[k];
-      float dx = p[0] - x0, dy = p[1] - y0, dz = p[2] - z0;
-      float da = dx*ax + dy*ay + dz*az;
-      float d2 = dx*dx + dy*dy + dz*dz - da*da;
-      if (d2 < 0) d2 = 0;
-      distances[k] = static_cast<float>(sqrt(d2));
-    }
+    { ax /= norm; ay /= norm ; az /= norm; }
+  split_over_threads(n, min_points_per_thread, [=](int64_t k0, int64_t k1) {
+      for (int64_t k = k0 ; k < k1 ; ++k)
+	{
+	  float *p = points[k];
+	  float dx = p[0] - x0, dy = p[1] - y0, dz = p[2] - z0;
+	  float da = dx*ax + dy*ay + dz*az;
+	  float d2 = std::max(dx*dx + dy*dy + dz*dz - da*da, 0.0f);
+	  distances[k] = sqrtf(d2);
+	}
+    });
 }
 
 // ----------------------------------------------------------------------------
@@ -76,15 +98,17 @@ void distances_parallel_to_axis(float points[][3], int n,
 {
   float x0 = origin[0], y0 = origin[1], z0 = origin[2];
   float ax = axis[0], ay = axis[1], az = axis[2];
-  float norm = static_cast<float>(sqrt(ax*ax + ay*ay + az*az));
+  float norm = sqrtf(ax*ax + ay*ay + az*az);
   if (norm != 0)
-    { ax /= norm; ay /= norm ; ax /= norm; }
-  for (int k = 0 ; k < n ; ++k)
-    {
-      float *p = points[k];
-      float dx = p[0] - x0, dy = p[1] - y0, dz = p[2] - z0;
-      distances[k] = dx*ax + dy*ay + dz*az;
-    }
+    { ax /= norm; ay /= norm ; az /= norm; }
+  split_over_threads(n, min_points_per_thread, [=](int64_t k0, int64_t k1) {
+      for (int64_t k = k0 ; k < k1 ; ++k)
+	{
+	  float *p = points[k];
+	  float dx = p[0] - x0, dy = p[1] - y0, dz = p[2] - z0;
+	  distances[k] = dx*ax + dy*ay + dz*az;
+	}
+    });
 }
 
 // Return max(|Tp|)
@@ -94,19 +118,51 @@ float maximum_norm(float points[][3], int n, float t[3][4])
   float t10 = t[1][0], t11 = t[1][1], t12 = t[1][2], t13 = t[1][3];
   float t20 = t[2][0], t21 = t[2][1], t22 = t[2][2], t23 = t[2][3];
   float d2max = 0;
-  for (int k = 0 ; k < n ; ++k)
-    {
-      float *p = points[k];
-      float x = p[0], y = p[1], z = p[2];
-      float tpx = t00*x + t01*y + t02*z + t03;
-      float tpy = t10*x + t11*y + t12*z + t13;
-      float tpz = t20*x + t21*y + t22*z + t23;
-      float d2 = tpx*tpx + tpy*tpy + tpz*tpz;
-      if (d2 > d2max)
-	d2max = d2;
-    }
-  float d = sqrt(d2max);
+  std::mutex d2max_lock;
+  split_over_threads(n, min_points_per_thread, [&](int64_t k0, int64_t k1) {
+      float dm = 0;
+      for (int64_t k = k0 ; k < k1 ; ++k)
+	{
+	  float *p = points[k];
+	  float x = p[0], y = p[1], z = p[2];
+	  float tpx = t00*x + t01*y + t02*z + t03;
+	  float tpy = t10*x + t11*y + t12*z + t13;
+	  float tpz = t20*x + t21*y + t22*z + t23;
+	  dm = std::max(dm, tpx*tpx + tpy*tpy + tpz*tpz);
+	}
+      std::lock_guard<std::mutex> lock(d2max_lock);
+      d2max = std::max(d2max, dm);
+    });
+  float d = sqrtf(d2max);
   return d;
 }
 
+// ----------------------------------------------------------------------------
+// Root mean square distance between every coordinate set in coords1 and
+// every coordinate set in coords2 without any alignment.  Each set has n
+// points.  Rows of the m1 by m2 result are computed on separate threads.
+//
+void rmsd_matrix(const float *coords1, int64_t m1, const float *coords2, int64_t m2,
+		 int64_t n, float *rmsds)
+{
+  split_over_threads(m1, std::max(static_cast<int64_t>(1), min_points_per_thread / std::max(n*m2, static_cast<int64_t>(1))),
+		     [=](int64_t i0, int64_t i1) {
+      for (int64_t i = i0 ; i < i1 ; ++i)
+	{
+	  const float *c1 = coords1 + 3*n*i;
+	  for (int64_t j = 0 ; j < m2 ; ++j)
+	    {
+	      const float *c2 = coords2 + 3*n*j;
+	      float sum = 0;
+	      for (int64_t k = 0 ; k < 3*n ; ++k)
+		{
+		  float d = c1[k] - c2[k];
+		  sum += d*d;
+		}
+	      rmsds[i*m2+j] = (n > 0 ? sqrtf(sum / n) : 0);
+	    }
+	}
+    });
+}
+
 }  // end of namespace Distances
@@ -30,6 +30,8 @@
 #ifndef DISTANCES_HEADER_INCLUDED
 #define DISTANCES_HEADER_INCLUDED
 
+#include <cstdint>			// use int64_t
+
 namespace Distances
 {
 
@@ -44,6 +46,9 @@ void distances_parallel_to_axis(float points[][3], int n,
 
 float maximum_norm(float points[][3], int n, float tf[3][4]);
 
+void rmsd_matrix(const float *coords1, int64_t m1, const float *coords2, int64_t m2,
+		 int64_t n, float *rmsds);
+
 }  // end of namespace Distances
 
 #endif
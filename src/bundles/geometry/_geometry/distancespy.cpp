@@ -136,3 +136,35 @@ extern "C" PyObject *py_maximum_norm(PyObject *, PyObject *args,
   PyObject *npy = PyFloat_FromDouble(n);
   return npy;
 }
+
+// ----------------------------------------------------------------------------
+//
+extern "C" PyObject *py_rmsd_matrix(PyObject *, PyObject *args,
+				    PyObject *keywds)
+{
+  FArray coords1, coords2;
+  const char *kwlist[] = {"coords1", "coords2", NULL};
+  if (!PyArg_ParseTupleAndKeywords(args, keywds, const_cast<char *>("O&O&"),
+				   (char **)kwlist,
+				   parse_float_array, &coords1,
+				   parse_float_array, &coords2))
+    return NULL;
+
+  if (coords1.dimension() != 3 || coords2.dimension() != 3)
+    return PyErr_Format(PyExc_ValueError, "Coordinate arrays must be 3 dimensional, got %d and %d",
+			coords1.dimension(), coords2.dimension());
+  int64_t n = coords1.size(1);
+  if (coords1.size(2) != 3 || coords2.size(1) != n || coords2.size(2) != 3)
+    return PyErr_Format(PyExc_ValueError, "Coordinate arrays must be of size MxNx3 with the same N, got %s and %s",
+			coords1.size_string().c_str(), coords2.size_string().c_str());
+
+  FArray c1 = coords1.contiguous_array(), c2 = coords2.contiguous_array();
+  int64_t m1 = c1.size(0), m2 = c2.size(0);
+  float *rmsds;
+  PyObject *rmsds_py = python_float_array(m1, m2, &rmsds);
+  Py_BEGIN_ALLOW_THREADS
+    Distances::rmsd_matrix(c1.values(), m1, c2.values(), m2, n, rmsds);
+  Py_END_ALLOW_THREADS
+
+  return rmsds_py;
+}
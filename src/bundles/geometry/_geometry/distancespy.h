@@ -35,6 +35,7 @@ PyObject *py_distances_from_origin(PyObject *, PyObject *args);
 PyObject *py_distances_perpendicular_to_axis(PyObject *, PyObject *args);
 PyObject *py_distances_parallel_to_axis(PyObject *, PyObject *args);
 PyObject *py_maximum_norm(PyObject *, PyObject *args, PyObject *keywds);
+PyObject *py_rmsd_matrix(PyObject *, PyObject *args, PyObject *keywds);
 
 }
 
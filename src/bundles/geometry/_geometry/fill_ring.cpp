@@ -3,8 +3,10 @@
 #define PY_SSIZE_T_CLEAN
 #include "fill_ring.h"
 #include <math.h>
+#include <algorithm>			// use std::copy()
 #include <arrays/pythonarray.h>		// use float_2d_array_values()
 #include <arrays/rcarray.h>		// use FArray
+#include <arrays/threadpool.h>		// use Thread_Pool::parallel_for()
 
 namespace {
 
@@ -574,3 +576,141 @@ fill_6ring(PyObject *, PyObject *args, PyObject *keywds)
 	c_array_to_python(static_cast<const float*>(&normals[0]), normals.size() / 3, 3),
 	c_array_to_python(static_cast<const int*>(&triangles[0]), triangles.size() / 3, 3)
     );}
+
+const char *fill_rings_doc = 
+  "fill_rings(vertices, ring_sizes, offsets, anchor_corners)\n"
+  "  -> vertices, normals, triangles, ring_vertex_counts, ring_triangle_counts\n"
+  "\n"
+  //"Supported API\n"
+  "Construct geometry to fill many 3, 4, 5 or 6 member rings in one call,\n"
+  "with the rings divided among threads.  Each ring gets the same geometry\n"
+  "as from fill_small_ring() or fill_6ring().\n"
+  "Implemented in C++.\n"
+  "\n"
+  "Parameters\n"
+  "----------\n"
+  "vertices : n by 3 float array\n"
+  "  x,y,z coordinates of the vertices of all the rings, one ring after another.\n"
+  "ring_sizes : int array\n"
+  "  number of vertices in each ring.\n"
+  "offsets : float array\n"
+  "  symmetric offset of triangles for each ring.\n"
+  "anchor_corners : int array\n"
+  "  anchor corner for each 6 member ring, ignored for smaller rings.\n"
+  "\n"
+  "Returns\n"
+  "-------\n"
+  "vertices : n by 3 float array\n"
+  "  vertex x,y,z coordinates.\n"
+  "normals : n by 3 float array\n"
+  "  x,y,z normals for each vertex.\n"
+  "triangles : m by 3 int array\n"
+  "  vertex indices specifying 3 vertices for each triangle.\n"
+  "ring_vertex_counts : int array\n"
+  "  number of vertices made for each ring, which come in ring order.\n"
+  "ring_triangle_counts : int array\n"
+  "  number of triangles made for each ring, which come in ring order.\n";
+
+PyObject *
+fill_rings(PyObject *, PyObject *args, PyObject *keywds)
+{
+    FArray vertices_in, offsets;
+    IArray ring_sizes, anchor_corners;
+    const char *kwlist[] = {"vertices", "ring_sizes", "offsets", "anchor_corners", NULL};
+    if (!PyArg_ParseTupleAndKeywords(
+	    args, keywds, const_cast<char *>("O&O&O&O&"), (char **) kwlist,
+	    parse_float_n3_array, &vertices_in,
+	    parse_int_n_array, &ring_sizes,
+	    parse_float_n_array, &offsets,
+	    parse_int_n_array, &anchor_corners))
+	return NULL;
+    int64_t num_rings = ring_sizes.size();
+    if (offsets.size() != num_rings || anchor_corners.size() != num_rings) {
+	PyErr_Format(PyExc_ValueError, "Expecting %lld offsets and anchor corners, got %lld and %lld",
+		     (long long)num_rings, (long long)offsets.size(), (long long)anchor_corners.size());
+	return NULL;
+    }
+    FArray cvertices_in = vertices_in.contiguous_array();
+    IArray csizes = ring_sizes.contiguous_array();
+    FArray coffsets = offsets.contiguous_array();
+    IArray canchors = anchor_corners.contiguous_array();
+    const int *sizes = csizes.values(), *anchors = canchors.values();
+    const float *ring_offsets = coffsets.values();
+
+    // index of first vertex of each ring
+    std::vector<int64_t> first(num_rings);
+    int64_t num_vertices_in = 0;
+    for (int64_t r = 0; r < num_rings; ++r) {
+	int n = sizes[r];
+	if (n < 3 || n > 6) {
+	    PyErr_Format(PyExc_ValueError, "Ring %lld has %d vertices, only 3 to 6 allowed",
+			 (long long)r, n);
+	    return NULL;
+	}
+	if (n == 6 && (anchors[r] < 0 || anchors[r] > 5)) {
+	    PyErr_Format(PyExc_ValueError, "Ring %lld anchor corner %d is not between 0 and 5",
+			 (long long)r, anchors[r]);
+	    return NULL;
+	}
+	first[r] = num_vertices_in;
+	num_vertices_in += n;
+    }
+    if (num_vertices_in != cvertices_in.size(0)) {
+	PyErr_Format(PyExc_ValueError, "Ring sizes total %lld vertices, got %lld",
+		     (long long)num_vertices_in, (long long)cvertices_in.size(0));
+	return NULL;
+    }
+
+    std::vector<VertexList> ring_vertices(num_rings), ring_normals(num_rings);
+    std::vector<IndexList> ring_triangles(num_rings);
+    Py_BEGIN_ALLOW_THREADS
+    const Vector *pts = reinterpret_cast<const Vector*>(cvertices_in.values());
+    // rings are tiny, so hand them to threads in batches
+    Thread_Pool::parallel_for(num_rings, [&](int64_t r0, int64_t r1) {
+	for (int64_t r = r0; r < r1; ++r) {
+	    if (sizes[r] == 6)
+		fill_6ring(pts + first[r], ring_offsets[r], anchors[r],
+			   &ring_vertices[r], &ring_normals[r], &ring_triangles[r]);
+	    else
+		fill_small_ring(pts + first[r], sizes[r], ring_offsets[r],
+				&ring_vertices[r], &ring_normals[r], &ring_triangles[r]);
+	}
+    }, 256);
+    Py_END_ALLOW_THREADS
+
+    int64_t num_vertices = 0, num_triangles = 0;
+    for (int64_t r = 0; r < num_rings; ++r) {
+	num_vertices += ring_vertices[r].size() / 3;
+	num_triangles += ring_triangles[r].size() / 3;
+    }
+    float *vertices, *normals;
+    int *triangles, *vertex_counts, *triangle_counts;
+    PyObject *py_vertices = python_float_array(num_vertices, 3, &vertices);
+    PyObject *py_normals = python_float_array(num_vertices, 3, &normals);
+    PyObject *py_triangles = python_int_array(num_triangles, 3, &triangles);
+    PyObject *py_vertex_counts = python_int_array(num_rings, &vertex_counts);
+    PyObject *py_triangle_counts = python_int_array(num_rings, &triangle_counts);
+    if (!py_vertices || !py_normals || !py_triangles || !py_vertex_counts || !py_triangle_counts) {
+	Py_XDECREF(py_vertices);
+	Py_XDECREF(py_normals);
+	Py_XDECREF(py_triangles);
+	Py_XDECREF(py_vertex_counts);
+	Py_XDECREF(py_triangle_counts);
+	return NULL;
+    }
+    int base = 0;
+    for (int64_t r = 0; r < num_rings; ++r) {
+	const VertexList &rv = ring_vertices[r], &rn = ring_normals[r];
+	const IndexList &rt = ring_triangles[r];
+	vertices = std::copy(rv.begin(), rv.end(), vertices);
+	normals = std::copy(rn.begin(), rn.end(), normals);
+	for (auto t: rt)
+	    *triangles++ = base + t;
+	vertex_counts[r] = rv.size() / 3;
+	triangle_counts[r] = rt.size() / 3;
+	base += vertex_counts[r];
+    }
+
+    return python_tuple(py_vertices, py_normals, py_triangles,
+			py_vertex_counts, py_triangle_counts);
+}
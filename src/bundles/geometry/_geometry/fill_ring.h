@@ -45,6 +45,12 @@ extern const char *fill_small_ring_doc;
 PyObject *fill_6ring(PyObject *s, PyObject *args, PyObject *keywds);
 extern const char *fill_6ring_doc;
 
+// return geometry of many 3 to 6 member rings
+//   fill_rings(float varray[n,3], int ring_sizes[r], float offsets[r], int anchor_corners[r])
+//     -> vertices, normals, triangles, ring_vertex_counts, ring_triangle_counts
+PyObject *fill_rings(PyObject *s, PyObject *args, PyObject *keywds);
+extern const char *fill_rings_doc;
+
 }
 
 #endif
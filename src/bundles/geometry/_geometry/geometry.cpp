@@ -33,10 +33,11 @@
 #include "distancespy.h"		// use py_distances_from_origin, ...
 #include "intercept.h"			// use closest_geometry_intercept
 #include "spline.h"			// use natural_cubic_spline
+#include "superpose.h"			// use iterative_align_points, ...
 #include "transform.h"			// use affine_transform_vertices, ...
 #include "vector_ops.h"			// use inner_product_64
 #include "matrix.h"		        // defines look_at
-#include "fill_ring.h"		        // defines fill_small_ring and fill_6ring
+#include "fill_ring.h"		        // defines fill_small_ring, fill_6ring, fill_rings
 
 namespace Geometry_Cpp
 {
@@ -54,6 +55,7 @@ static struct PyMethodDef geometry_cpp_methods[] =
   {const_cast<char*>("spheres_in_bounds"), (PyCFunction)spheres_in_bounds, METH_VARARGS|METH_KEYWORDS, NULL},
   {const_cast<char*>("bounds_overlap"), (PyCFunction)bounds_overlap, METH_VARARGS|METH_KEYWORDS, NULL},
   {const_cast<char*>("points_within_planes"), (PyCFunction)points_within_planes, METH_VARARGS|METH_KEYWORDS, NULL},
+  {const_cast<char*>("copies_within_planes"), (PyCFunction)copies_within_planes, METH_VARARGS|METH_KEYWORDS, NULL},
 
   /* closepoints.h */
   {const_cast<char*>("find_close_points"), (PyCFunction)find_close_points,
@@ -62,6 +64,12 @@ static struct PyMethodDef geometry_cpp_methods[] =
    METH_VARARGS|METH_KEYWORDS, find_closest_points_doc},
   {const_cast<char*>("find_close_points_sets"), (PyCFunction)find_close_points_sets,
    METH_VARARGS|METH_KEYWORDS, find_close_points_sets_doc},
+  {const_cast<char*>("close_points_index"), (PyCFunction)close_points_index,
+   METH_VARARGS|METH_KEYWORDS, close_points_index_doc},
+  {const_cast<char*>("close_points_index_search"), (PyCFunction)close_points_index_search,
+   METH_VARARGS|METH_KEYWORDS, close_points_index_search_doc},
+  {const_cast<char*>("find_close_points_copies"), (PyCFunction)find_close_points_copies,
+   METH_VARARGS|METH_KEYWORDS, find_close_points_copies_doc},
 
   /* cylinderrot.h */
   {const_cast<char*>("cylinder_rotations"), (PyCFunction)cylinder_rotations, METH_VARARGS|METH_KEYWORDS, NULL},
@@ -73,6 +81,7 @@ static struct PyMethodDef geometry_cpp_methods[] =
   {const_cast<char*>("distances_perpendicular_to_axis"), py_distances_perpendicular_to_axis, METH_VARARGS, NULL},
   {const_cast<char*>("distances_parallel_to_axis"), py_distances_parallel_to_axis, METH_VARARGS, NULL},
   {const_cast<char*>("maximum_norm"), (PyCFunction)py_maximum_norm, METH_VARARGS|METH_KEYWORDS, NULL},
+  {const_cast<char*>("rmsd_matrix"), (PyCFunction)py_rmsd_matrix, METH_VARARGS|METH_KEYWORDS, NULL},
 
   /* intercept.h */
   {const_cast<char*>("closest_triangle_intercept"), (PyCFunction)closest_triangle_intercept,
@@ -83,6 +92,14 @@ static struct PyMethodDef geometry_cpp_methods[] =
    METH_VARARGS|METH_KEYWORDS, segment_intercepts_spheres_doc},
   {const_cast<char*>("closest_cylinder_intercept"), (PyCFunction)closest_cylinder_intercept,
    METH_VARARGS|METH_KEYWORDS, closest_cylinder_intercept_doc},
+  {const_cast<char*>("triangle_intercept_tree"), (PyCFunction)triangle_intercept_tree,
+   METH_VARARGS|METH_KEYWORDS, triangle_intercept_tree_doc},
+  {const_cast<char*>("sphere_intercept_tree"), (PyCFunction)sphere_intercept_tree,
+   METH_VARARGS|METH_KEYWORDS, sphere_intercept_tree_doc},
+  {const_cast<char*>("closest_tree_intercept"), (PyCFunction)closest_tree_intercept,
+   METH_VARARGS|METH_KEYWORDS, closest_tree_intercept_doc},
+  {const_cast<char*>("closest_tree_intercepts"), (PyCFunction)closest_tree_intercepts,
+   METH_VARARGS|METH_KEYWORDS, closest_tree_intercepts_doc},
 
   /* matrix.h */
   {const_cast<char*>("look_at"), (PyCFunction)look_at, METH_VARARGS, NULL},
@@ -109,23 +126,33 @@ static struct PyMethodDef geometry_cpp_methods[] =
   {const_cast<char*>("natural_cubic_spline"), (PyCFunction)natural_cubic_spline,
    METH_VARARGS|METH_KEYWORDS, natural_cubic_spline_doc},
 
+  /* superpose.h */
+  {const_cast<char*>("iterative_align_points"), (PyCFunction)iterative_align_points,
+   METH_VARARGS|METH_KEYWORDS, iterative_align_points_doc},
+  {const_cast<char*>("iterative_align_point_sets"), (PyCFunction)iterative_align_point_sets,
+   METH_VARARGS|METH_KEYWORDS, iterative_align_point_sets_doc},
+
   /* transform.h */
   {const_cast<char*>("scale_and_shift_vertices"), scale_and_shift_vertices, METH_VARARGS, NULL},
   {const_cast<char*>("scale_vertices"), scale_vertices, METH_VARARGS, NULL},
   {const_cast<char*>("shift_vertices"), shift_vertices, METH_VARARGS, NULL},
   {const_cast<char*>("affine_transform_vertices"), affine_transform_vertices, METH_VARARGS, NULL},
   {const_cast<char*>("affine_transform_normals"), affine_transform_normals, METH_VARARGS, NULL},
+  {const_cast<char*>("affine_transform_copies"), (PyCFunction)affine_transform_copies,
+   METH_VARARGS|METH_KEYWORDS, NULL},
 
   /* vector_ops.h */
   {const_cast<char*>("inner_product_64"), (PyCFunction)inner_product_64,
    METH_VARARGS|METH_KEYWORDS, inner_product_64_doc},
 
   /* fill_ring.h */
-  // defines fill_small_ring and fill_6ring
+  // defines fill_small_ring, fill_6ring and fill_rings
   {const_cast<char*>("fill_small_ring"), (PyCFunction)fill_small_ring,
    METH_VARARGS|METH_KEYWORDS, fill_small_ring_doc},
   {const_cast<char*>("fill_6ring"), (PyCFunction)fill_6ring,
    METH_VARARGS|METH_KEYWORDS, fill_6ring_doc},
+  {const_cast<char*>("fill_rings"), (PyCFunction)fill_rings,
+   METH_VARARGS|METH_KEYWORDS, fill_rings_doc},
 
   {NULL, NULL, 0, NULL}
 };
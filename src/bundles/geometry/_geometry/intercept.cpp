@@ -27,6 +27,9 @@
 // ----------------------------------------------------------------------------
 //
 #include <Python.h>			// use PyObject
+#include <algorithm>			// use std::nth_element, std::swap
+#include <math.h>			// use sqrt(), fabs()
+#include <vector>			// use std::vector
 
 #include <arrays/pythonarray.h>		// use array_from_python()
 #include <arrays/rcarray.h>		// use FArray, IArray
@@ -86,14 +89,14 @@ const char *closest_triangle_intercept_doc =
 extern "C"
 PyObject *closest_triangle_intercept(PyObject *, PyObject *args, PyObject *keywds)
 {
-  FArray vertices;
-  IArray triangles;
+  FValues vertices;
+  IValues triangles;
   float xyz1[3], xyz2[3];
   const char *kwlist[] = {"vertices", "triangles", "xyz1", "xyz2", NULL};
   if (!PyArg_ParseTupleAndKeywords(args, keywds, const_cast<char *>("O&O&O&O&"),
 				   (char **)kwlist,
-				   parse_float_n3_array, &vertices,
-				   parse_int_n3_array, &triangles,
+				   parse_float_n3_values, &vertices,
+				   parse_int_n3_values, &triangles,
 				   parse_float_3_array, &xyz1,
 				   parse_float_3_array, &xyz2))
     return NULL;
@@ -101,8 +104,12 @@ PyObject *closest_triangle_intercept(PyObject *, PyObject *args, PyObject *keywd
   float fmin;
   int64_t tmin;
   PyObject *py_fmin, *py_tmin;
-  if (closest_triangle_intercept(vertices.values(), triangles.values(), triangles.size(0),
-				 xyz1, xyz2, &fmin, &tmin))
+  bool hit;
+  Py_BEGIN_ALLOW_THREADS
+  hit = closest_triangle_intercept(vertices.values(), triangles.values(), triangles.size(0),
+				   xyz1, xyz2, &fmin, &tmin);
+  Py_END_ALLOW_THREADS
+  if (hit)
     {
       py_fmin = PyFloat_FromDouble(fmin);
       py_tmin = PyLong_FromLong(tmin);
@@ -248,9 +255,13 @@ PyObject *closest_sphere_intercept(PyObject *, PyObject *args, PyObject *keywds)
   float fmin;
   int64_t s;
   PyObject *py_fmin, *py_snum;
-  if (closest_sphere_intercept(centers.values(), centers.size(0), centers.stride(0), centers.stride(1),
-			       radii.values(), radii.stride(0),
-			       xyz1, xyz2, &fmin, &s))
+  bool hit;
+  Py_BEGIN_ALLOW_THREADS
+  hit = closest_sphere_intercept(centers.values(), centers.size(0), centers.stride(0), centers.stride(1),
+				 radii.values(), radii.stride(0),
+				 xyz1, xyz2, &fmin, &s);
+  Py_END_ALLOW_THREADS
+  if (hit)
     {
       py_fmin = PyFloat_FromDouble(fmin);
       py_snum = PyLong_FromLong(s);
@@ -352,8 +363,10 @@ PyObject *segment_intercepts_spheres(PyObject *, PyObject *args, PyObject *keywd
   int64_t n = centers.size(0);
   unsigned char *intercept;
   PyObject *ipy = python_bool_array(n, &intercept);
+  Py_BEGIN_ALLOW_THREADS
   segment_intercepts_spheres(centers.values(), n, centers.stride(0), centers.stride(1),
 			     radius, xyz1, xyz2, intercept);
+  Py_END_ALLOW_THREADS
   return ipy;
 }
 
@@ -453,10 +466,14 @@ PyObject *closest_cylinder_intercept(PyObject *, PyObject *args, PyObject *keywd
   float fmin;
   int64_t c;
   PyObject *py_fmin, *py_cnum;
-  if (closest_cylinder_intercept(base1.values(), base1.size(0), base1.stride(0), base1.stride(1),
-				 base2.values(), base1.stride(0), base1.stride(1),
-				 radii.values(), radii.stride(0),
-				 xyz1, xyz2, &fmin, &c))
+  bool hit;
+  Py_BEGIN_ALLOW_THREADS
+  hit = closest_cylinder_intercept(base1.values(), base1.size(0), base1.stride(0), base1.stride(1),
+				   base2.values(), base1.stride(0), base1.stride(1),
+				   radii.values(), radii.stride(0),
+				   xyz1, xyz2, &fmin, &c);
+  Py_END_ALLOW_THREADS
+  if (hit)
     {
       py_fmin = PyFloat_FromDouble(fmin);
       py_cnum = PyLong_FromLong(c);
@@ -548,3 +565,461 @@ static bool closest_cylinder_intercept(const float *base1, int64_t n, int64_t b1
   *cnum = cc;
   return true;
 }
+
+// ----------------------------------------------------------------------------
+// Bounding volume hierarchy of triangles or spheres for picking.  Each node
+// has an axis aligned box containing a contiguous range of primitives in the
+// sorted primitive order.  Picking a large surface or many atoms repeatedly,
+// for instance hovering the mouse, then only tests primitives in boxes the
+// segment passes through.
+//
+class Intercept_Tree
+{
+public:
+  // Triangles as 3 vertex indices, or spheres.
+  Intercept_Tree(const float *varray, const int *tarray, int64_t nt);
+  Intercept_Tree(const float *centers, const float *radii, int64_t n);
+  bool closest_intercept(const float *xyz1, const float *xyz2, float *fmin, int64_t *num) const;
+
+private:
+  class Node
+  {
+  public:
+    float xmin[3], xmax[3];
+    int64_t start, count;	// Primitive range for leaves, count 0 for interior.
+    int64_t child1, child2;
+  };
+  static const int64_t leaf_size = 8;
+  bool triangles;
+  std::vector<float> xyz;	// 9 floats per triangle, or 4 (center, radius) per sphere.
+  std::vector<int64_t> order;	// Primitive numbers in node order.
+  std::vector<Node> nodes;
+
+  void build(std::vector<float> &boxes);
+  int64_t build_node(std::vector<float> &boxes, std::vector<float> &centers,
+		     int64_t start, int64_t end);
+};
+
+// ----------------------------------------------------------------------------
+//
+Intercept_Tree::Intercept_Tree(const float *varray, const int *tarray, int64_t nt)
+  : triangles(true), xyz(9*nt)
+{
+  std::vector<float> boxes(6*nt);
+  for (int64_t t = 0 ; t < nt ; ++t)
+    {
+      float *txyz = &xyz[9*t], *b = &boxes[6*t];
+      for (int c = 0 ; c < 3 ; ++c)
+	{
+	  const float *v = varray + 3*tarray[3*t+c];
+	  for (int a = 0 ; a < 3 ; ++a)
+	    {
+	      float x = v[a];
+	      txyz[3*c+a] = x;
+	      if (c == 0 || x < b[a]) b[a] = x;
+	      if (c == 0 || x > b[3+a]) b[3+a] = x;
+	    }
+	}
+    }
+  build(boxes);
+}
+
+// ----------------------------------------------------------------------------
+//
+Intercept_Tree::Intercept_Tree(const float *centers, const float *radii, int64_t n)
+  : triangles(false), xyz(4*n)
+{
+  std::vector<float> boxes(6*n);
+  for (int64_t s = 0 ; s < n ; ++s)
+    {
+      float r = radii[s], *b = &boxes[6*s];
+      for (int a = 0 ; a < 3 ; ++a)
+	{
+	  float x = centers[3*s+a];
+	  xyz[4*s+a] = x;
+	  b[a] = x - r;
+	  b[3+a] = x + r;
+	}
+      xyz[4*s+3] = r;
+    }
+  build(boxes);
+}
+
+// ----------------------------------------------------------------------------
+// Boxes are padded slightly so that rounding errors in intercept
+// calculations do not put intercepts just outside the box.
+//
+void Intercept_Tree::build(std::vector<float> &boxes)
+{
+  int64_t n = boxes.size()/6;
+  std::vector<float> centers(3*n);
+  for (int64_t p = 0 ; p < n ; ++p)
+    {
+      float *b = &boxes[6*p];
+      for (int a = 0 ; a < 3 ; ++a)
+	{
+	  float pad = 1e-5f * (fabs(b[a]) + fabs(b[3+a]) + (b[3+a]-b[a])) + 1e-30f;
+	  b[a] -= pad;
+	  b[3+a] += pad;
+	  centers[3*p+a] = 0.5f*(b[a] + b[3+a]);
+	}
+    }
+  order.resize(n);
+  for (int64_t p = 0 ; p < n ; ++p)
+    order[p] = p;
+  if (n > 0)
+    build_node(boxes, centers, 0, n);
+}
+
+// ----------------------------------------------------------------------------
+// Split primitives at the median center along the longest axis of the box.
+//
+int64_t Intercept_Tree::build_node(std::vector<float> &boxes, std::vector<float> &centers,
+				   int64_t start, int64_t end)
+{
+  int64_t ni = nodes.size();
+  nodes.push_back(Node());
+  Node node;
+  for (int64_t i = start ; i < end ; ++i)
+    {
+      const float *b = &boxes[6*order[i]];
+      for (int a = 0 ; a < 3 ; ++a)
+	{
+	  if (i == start || b[a] < node.xmin[a]) node.xmin[a] = b[a];
+	  if (i == start || b[3+a] > node.xmax[a]) node.xmax[a] = b[3+a];
+	}
+    }
+  node.start = start;
+  node.count = end - start;
+  node.child1 = node.child2 = -1;
+  if (end - start > leaf_size)
+    {
+      int axis = 0;
+      for (int a = 1 ; a < 3 ; ++a)
+	if (node.xmax[a]-node.xmin[a] > node.xmax[axis]-node.xmin[axis])
+	  axis = a;
+      int64_t mid = (start + end) / 2;
+      std::nth_element(order.begin() + start, order.begin() + mid, order.begin() + end,
+		       [&centers, axis](int64_t p1, int64_t p2)
+		       { return centers[3*p1+axis] < centers[3*p2+axis]; });
+      node.count = 0;
+      node.child1 = build_node(boxes, centers, start, mid);
+      node.child2 = build_node(boxes, centers, mid, end);
+    }
+  nodes[ni] = node;
+  return ni;
+}
+
+// ----------------------------------------------------------------------------
+// Fraction along segment where it enters a box, or -1 if it misses.
+//
+static float segment_box_entry(const float *xyz1, const float *dxyz,
+			       const float *xmin, const float *xmax)
+{
+  float f0 = 0, f1 = 1;
+  for (int a = 0 ; a < 3 ; ++a)
+    {
+      float d = dxyz[a], x = xyz1[a];
+      if (d == 0)
+	{
+	  if (x < xmin[a] || x > xmax[a])
+	    return -1;
+	}
+      else
+	{
+	  float fa = (xmin[a] - x) / d, fb = (xmax[a] - x) / d;
+	  if (fa > fb)
+	    std::swap(fa, fb);
+	  if (fa > f0) f0 = fa;
+	  if (fb < f1) f1 = fb;
+	  if (f0 > f1)
+	    return -1;
+	}
+    }
+  return f0;
+}
+
+// ----------------------------------------------------------------------------
+// Gives the same result as closest_triangle_intercept() or
+// closest_sphere_intercept() with ties going to the lowest primitive number.
+//
+bool Intercept_Tree::closest_intercept(const float *xyz1, const float *xyz2,
+				       float *fmin, int64_t *num) const
+{
+  if (nodes.empty())
+    return false;
+
+  float dxyz[3] = {xyz2[0]-xyz1[0], xyz2[1]-xyz1[1], xyz2[2]-xyz1[2]};
+  float x1 = xyz1[0], y1 = xyz1[1], z1 = xyz1[2];
+  float d = sqrt(dxyz[0]*dxyz[0] + dxyz[1]*dxyz[1] + dxyz[2]*dxyz[2]);
+  if (!triangles && d == 0)
+    return false;
+  float dx = dxyz[0]/d, dy = dxyz[1]/d, dz = dxyz[2]/d;
+
+  // Triangle fractions are in [0,1], sphere distances along the segment can be
+  // negative if xyz1 is inside the sphere, in which case the box contains xyz1.
+  float best = (triangles ? -1 : 2*d);
+  int64_t best_num = -1;
+  std::vector<int64_t> stack;
+  stack.push_back(0);
+  while (!stack.empty())
+    {
+      const Node &node = nodes[stack.back()];
+      stack.pop_back();
+      float f = segment_box_entry(xyz1, dxyz, node.xmin, node.xmax);
+      if (f < 0 || (best_num >= 0 && (triangles ? f : f*d) > std::max(best, 0.0f)))
+	continue;
+      if (node.count == 0)
+	{
+	  stack.push_back(node.child2);
+	  stack.push_back(node.child1);
+	  continue;
+	}
+      for (int64_t i = node.start ; i < node.start + node.count ; ++i)
+	{
+	  int64_t p = order[i];
+	  if (triangles)
+	    {
+	      const float *t = &xyz[9*p];
+	      float ft;
+	      if (triangle_intercept(t, t+3, t+6, xyz1, xyz2, &ft) &&
+		  (best_num < 0 || ft < best || (ft == best && p < best_num)))
+		{
+		  best = ft;
+		  best_num = p;
+		}
+	    }
+	  else
+	    {
+	      const float *s = &xyz[4*p];
+	      float x = s[0], y = s[1], z = s[2], r = s[3];
+	      float pr = (x-x1)*dx + (y-y1)*dy + (z-z1)*dz;
+	      if (pr >= 0 && pr <= d + r && pr < best + r)
+		{
+		  float xp = x-(x1+pr*dx), yp = y-(y1+pr*dy), zp = z-(z1+pr*dz);	// perp vector
+		  float a2 = r*r - (xp*xp + yp*yp + zp*zp);
+		  if (a2 > 0)
+		    {
+		      float a = sqrt(a2);
+		      if (pr-a < best || (pr-a == best && p < best_num))
+			{
+			  best = pr-a;
+			  best_num = p;
+			}
+		    }
+		}
+	    }
+	}
+    }
+
+  if (best_num < 0 || (!triangles && best > d))
+    return false;
+  *fmin = (triangles ? best : best/d);
+  *num = best_num;
+  return true;
+}
+
+// ----------------------------------------------------------------------------
+//
+static void delete_intercept_tree(PyObject *capsule)
+{
+  delete static_cast<Intercept_Tree *>(PyCapsule_GetPointer(capsule, "Intercept_Tree"));
+}
+
+const char *triangle_intercept_tree_doc =
+  "triangle_intercept_tree(vertices, triangles) -> tree\n"
+  "\n"
+  "Make a bounding box hierarchy for finding triangle intercepts with\n"
+  "closest_tree_intercept().  The coordinates are copied, so the tree must\n"
+  "be remade when the triangles change.  Implemented in C++.\n"
+  "\n"
+  "Parameters\n"
+  "----------\n"
+  "vertices : n by 3 float array\n"
+  "  triangle vertex x,y,z coordinates.\n"
+  "triangles : m by 3 int array\n"
+  "  vertex indices specifying 3 vertices for each triangle.\n";
+
+// ----------------------------------------------------------------------------
+//
+extern "C"
+PyObject *triangle_intercept_tree(PyObject *, PyObject *args, PyObject *keywds)
+{
+  FArray vertices;
+  IArray triangles;
+  const char *kwlist[] = {"vertices", "triangles", NULL};
+  if (!PyArg_ParseTupleAndKeywords(args, keywds, const_cast<char *>("O&O&"),
+				   (char **)kwlist,
+				   parse_float_n3_array, &vertices,
+				   parse_int_n3_array, &triangles))
+    return NULL;
+
+  FArray va = vertices.contiguous_array();
+  IArray ta = triangles.contiguous_array();
+  int64_t nv = va.size(0), nt = ta.size(0);
+  const int *t = ta.values();
+  for (int64_t i = 0 ; i < 3*nt ; ++i)
+    if (t[i] < 0 || t[i] >= nv)
+      {
+	PyErr_SetString(PyExc_ValueError,
+			"triangle_intercept_tree(): triangle vertex index out of range");
+	return NULL;
+      }
+
+  Intercept_Tree *tree;
+  Py_BEGIN_ALLOW_THREADS
+  tree = new Intercept_Tree(va.values(), t, nt);
+  Py_END_ALLOW_THREADS
+  return PyCapsule_New(tree, "Intercept_Tree", delete_intercept_tree);
+}
+
+const char *sphere_intercept_tree_doc =
+  "sphere_intercept_tree(centers, radii) -> tree\n"
+  "\n"
+  "Make a bounding box hierarchy for finding sphere intercepts with\n"
+  "closest_tree_intercept().  The coordinates are copied, so the tree must\n"
+  "be remade when the spheres change.  Implemented in C++.\n"
+  "\n"
+  "Parameters\n"
+  "----------\n"
+  "centers : n by 3 float array\n"
+  "  x,y,z sphere center coordinates.\n"
+  "radii : length n float array\n"
+  "  sphere radii.\n";
+
+// ----------------------------------------------------------------------------
+//
+extern "C"
+PyObject *sphere_intercept_tree(PyObject *, PyObject *args, PyObject *keywds)
+{
+  FArray centers, radii;
+  const char *kwlist[] = {"centers", "radii", NULL};
+  if (!PyArg_ParseTupleAndKeywords(args, keywds, const_cast<char *>("O&O&"),
+				   (char **)kwlist,
+				   parse_float_n3_array, &centers,
+				   parse_float_n_array, &radii))
+    return NULL;
+
+  if (radii.size(0) != centers.size(0))
+    {
+      PyErr_SetString(PyExc_ValueError,
+		      "sphere_intercept_tree(): radii and center arrays must have same size");
+      return NULL;
+    }
+
+  FArray ca = centers.contiguous_array(), ra = radii.contiguous_array();
+  Intercept_Tree *tree;
+  Py_BEGIN_ALLOW_THREADS
+  tree = new Intercept_Tree(ca.values(), ra.values(), ca.size(0));
+  Py_END_ALLOW_THREADS
+  return PyCapsule_New(tree, "Intercept_Tree", delete_intercept_tree);
+}
+
+const char *closest_tree_intercept_doc =
+  "closest_tree_intercept(tree, xyz1, xyz2) -> f, num\n"
+  "\n"
+  "Find first triangle or sphere intercept along line segment from xyz1 to xyz2\n"
+  "using a tree from triangle_intercept_tree() or sphere_intercept_tree().\n"
+  "Results are the same as closest_triangle_intercept() or\n"
+  "closest_sphere_intercept().  Implemented in C++.\n"
+  "\n"
+  "Returns\n"
+  "-------\n"
+  "f : float\n"
+  "  fraction of distance from xyz1 to xyz2.  None if no intercept.\n"
+  "num : int\n"
+  "  triangle or sphere number, or None if no intercept.\n";
+
+// ----------------------------------------------------------------------------
+//
+extern "C"
+PyObject *closest_tree_intercept(PyObject *, PyObject *args, PyObject *keywds)
+{
+  PyObject *py_tree;
+  float xyz1[3], xyz2[3];
+  const char *kwlist[] = {"tree", "xyz1", "xyz2", NULL};
+  if (!PyArg_ParseTupleAndKeywords(args, keywds, const_cast<char *>("OO&O&"),
+				   (char **)kwlist,
+				   &py_tree,
+				   parse_float_3_array, &xyz1,
+				   parse_float_3_array, &xyz2))
+    return NULL;
+
+  Intercept_Tree *tree = static_cast<Intercept_Tree *>(PyCapsule_GetPointer(py_tree, "Intercept_Tree"));
+  if (tree == NULL)
+    return NULL;
+
+  float fmin;
+  int64_t num;
+  PyObject *py_fmin, *py_num;
+  if (tree->closest_intercept(xyz1, xyz2, &fmin, &num))
+    {
+      py_fmin = PyFloat_FromDouble(fmin);
+      py_num = PyLong_FromLong(num);
+    }
+  else
+    {
+      py_fmin = python_none();
+      py_num = python_none();
+    }
+  return python_tuple(py_fmin, py_num);
+}
+
+const char *closest_tree_intercepts_doc =
+  "closest_tree_intercepts(tree, xyz1, xyz2) -> f, num\n"
+  "\n"
+  "Find first intercepts for many line segments using a tree from\n"
+  "triangle_intercept_tree() or sphere_intercept_tree().  Implemented in C++.\n"
+  "\n"
+  "Parameters\n"
+  "----------\n"
+  "xyz1, xyz2 : n by 3 float arrays\n"
+  "  x,y,z coordinates of line segment endpoints.\n"
+  "\n"
+  "Returns\n"
+  "-------\n"
+  "f : float array\n"
+  "  fraction of distance from xyz1 to xyz2, -1 for segments with no intercept.\n"
+  "num : int array\n"
+  "  triangle or sphere number, -1 for segments with no intercept.\n";
+
+// ----------------------------------------------------------------------------
+//
+extern "C"
+PyObject *closest_tree_intercepts(PyObject *, PyObject *args, PyObject *keywds)
+{
+  PyObject *py_tree;
+  FArray xyz1, xyz2;
+  const char *kwlist[] = {"tree", "xyz1", "xyz2", NULL};
+  if (!PyArg_ParseTupleAndKeywords(args, keywds, const_cast<char *>("OO&O&"),
+				   (char **)kwlist,
+				   &py_tree,
+				   parse_float_n3_array, &xyz1,
+				   parse_float_n3_array, &xyz2))
+    return NULL;
+
+  Intercept_Tree *tree = static_cast<Intercept_Tree *>(PyCapsule_GetPointer(py_tree, "Intercept_Tree"));
+  if (tree == NULL)
+    return NULL;
+  if (xyz1.size(0) != xyz2.size(0))
+    {
+      PyErr_SetString(PyExc_ValueError,
+		      "closest_tree_intercepts(): xyz1 and xyz2 arrays must have same size");
+      return NULL;
+    }
+
+  FArray p1 = xyz1.contiguous_array(), p2 = xyz2.contiguous_array();
+  int64_t n = p1.size(0);
+  std::vector<float> f(n, -1);
+  std::vector<int64_t> num(n, -1);
+  const float *v1 = p1.values(), *v2 = p2.values();
+  Py_BEGIN_ALLOW_THREADS
+  for (int64_t i = 0 ; i < n ; ++i)
+    if (!tree->closest_intercept(v1 + 3*i, v2 + 3*i, &f[i], &num[i]))
+      {
+	f[i] = -1;
+	num[i] = -1;
+      }
+  Py_END_ALLOW_THREADS
+  return python_tuple(c_array_to_python(f), c_array_to_python(num));
+}
@@ -57,6 +57,20 @@ extern const char *segment_intercepts_spheres_doc;
 PyObject *closest_cylinder_intercept(PyObject *s, PyObject *args, PyObject *keywds);
 extern const char *closest_cylinder_intercept_doc;
 
+// Bounding box trees of triangles or spheres for quickly finding intercepts.
+//   triangle_intercept_tree(float varray[n,3], int tarray[m,3]) -> tree
+//   sphere_intercept_tree(float centers[n,3], float radii[n]) -> tree
+//   closest_tree_intercept(tree, float xyz1[3], float xyz2[3]) -> (float fmin, int num)
+//   closest_tree_intercepts(tree, float xyz1[k,3], float xyz2[k,3]) -> (float fmin[k], int num[k])
+PyObject *triangle_intercept_tree(PyObject *s, PyObject *args, PyObject *keywds);
+extern const char *triangle_intercept_tree_doc;
+PyObject *sphere_intercept_tree(PyObject *s, PyObject *args, PyObject *keywds);
+extern const char *sphere_intercept_tree_doc;
+PyObject *closest_tree_intercept(PyObject *s, PyObject *args, PyObject *keywds);
+extern const char *closest_tree_intercept_doc;
+PyObject *closest_tree_intercepts(PyObject *s, PyObject *args, PyObject *keywds);
+extern const char *closest_tree_intercepts_doc;
+
 }
 
 #endif
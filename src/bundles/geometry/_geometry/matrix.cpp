@@ -31,8 +31,12 @@
 #include <cmath>            // sqrt
 
 #include <arrays/pythonarray.h>		// use array_from_python()
+#include <arrays/threadpool.h>		// use Thread_Pool::parallel_for()
 #include "matrix.h"
 
+// Matrix lists are split over threads in chunks of this many matrices.
+static const int64_t matrix_chunk_size = 16384;
+
 inline void normalize(double *xyz)
 {
     double len = sqrt(xyz[0]*xyz[0] + xyz[1]*xyz[1] + xyz[2]*xyz[2]);
@@ -153,12 +157,25 @@ extern "C" PyObject *multiply_matrices(PyObject *, PyObject *args, PyObject *key
 }
 
 // ----------------------------------------------------------------------------
+// Products r = m1[i1] * m2[i2] with i2 varying fastest.  Either result array
+// can be null.  The OpenGL result gets each product as a 4x4 float matrix
+// as from opengl_matrices() without making the double array.
 //
-static void multiply_matrix_lists(double *m1, int n1, double *m2, int n2, double *r)
+static void opengl_matrix(double *m, float *r);
+static void multiply_matrix_lists(double *m1, int n1, double *m2, int n2, double *r,
+				  float *r44 = NULL)
 {
-  for (int i1 = 0 ; i1 < n1 ; ++i1)
-    for (int i2 = 0 ; i2 < n2 ; ++i2)
-      multiply_matrices(m1 + 12*i1, m2 + 12*i2, r + 12*n2*i1 + 12*i2);
+  int64_t n = static_cast<int64_t>(n1) * n2;
+  Thread_Pool::parallel_for(n, [=](int64_t i0, int64_t i1) {
+      double p[12];
+      for (int64_t i = i0 ; i < i1 ; ++i)
+	{
+	  double *ri = (r ? r + 12*i : p);
+	  multiply_matrices(m1 + 12*(i / n2), m2 + 12*(i % n2), ri);
+	  if (r44)
+	    opengl_matrix(ri, r44 + 16*i);
+	}
+    }, matrix_chunk_size);
 }
 
 // ----------------------------------------------------------------------------
@@ -167,27 +184,46 @@ extern "C" PyObject *multiply_matrix_lists(PyObject *, PyObject *args, PyObject
 {
   DArray m1, m2;
   int n1, n2;
-  PyObject *py_result = NULL;
-  const char *kwlist[] = {"matrices1", "n1", "matrices2", "n2", "result", NULL};
+  PyObject *py_result = NULL, *py_opengl_result = NULL;
+  const char *kwlist[] = {"matrices1", "n1", "matrices2", "n2", "result", "opengl_result", NULL};
 
-  if (!PyArg_ParseTupleAndKeywords(args, keywds, const_cast<char *>("O&iO&i|O"),
+  if (!PyArg_ParseTupleAndKeywords(args, keywds, const_cast<char *>("O&iO&i|OO"),
 				   (char **)kwlist,
 				   parse_contiguous_double_n34_array, &m1,
 				   &n1,
 				   parse_contiguous_double_n34_array, &m2,
 				   &n2,
-				   &py_result))
+				   &py_result, &py_opengl_result))
     return NULL;
+  if (py_result == Py_None)
+    py_result = NULL;
+  if (py_opengl_result == Py_None)
+    py_opengl_result = NULL;
 
-  if (py_result == NULL)
+  float *r44 = NULL;
+  if (py_opengl_result)
     {
-      double *r;
-      py_result = python_double_array(n1*n2, 3, 4, &r);
-      multiply_matrix_lists(m1.values(), n1, m2.values(), n2, r);
+      FArray opengl_result;
+      if (!parse_contiguous_float_n44_array(py_opengl_result, &opengl_result))
+	return NULL;
+      if (opengl_result.size(0) != n1*n2)
+	{
+	  PyErr_Format(PyExc_TypeError,
+		       "Require OpenGL result array size %d x 4 x 4, got %s by 4 by 4",
+		       n1*n2, opengl_result.size_string(0).c_str());
+	  return NULL;
+	}
+      r44 = opengl_result.values();
     }
+
+  double *r;
+  DArray result;
+  if (py_result == NULL && py_opengl_result == NULL)
+    py_result = python_double_array(n1*n2, 3, 4, &r);
+  else if (py_result == NULL)
+    r = NULL;
   else
     {
-      DArray result;
       if (!parse_contiguous_double_n34_array(py_result, &result))
 	return NULL;
       if (result.size(0) != n1*n2)
@@ -197,10 +233,20 @@ extern "C" PyObject *multiply_matrix_lists(PyObject *, PyObject *args, PyObject
 		       n1*n2, result.size_string(0).c_str());
 	  return NULL;
 	}
-      multiply_matrix_lists(m1.values(), n1, m2.values(), n2, result.values());
+      r = result.values();
       Py_INCREF(py_result);
     }
 
+  double *v1 = m1.values(), *v2 = m2.values();
+  Py_BEGIN_ALLOW_THREADS
+  multiply_matrix_lists(v1, n1, v2, n2, r, r44);
+  Py_END_ALLOW_THREADS
+
+  if (py_result == NULL)
+    {
+      Py_INCREF(py_opengl_result);
+      return py_opengl_result;
+    }
   return py_result;
 }
 
@@ -268,8 +314,10 @@ extern "C" PyObject *opengl_matrix(PyObject *, PyObject *args, PyObject *keywds)
 //
 static void opengl_matrices(double *m34, int64_t n, float *m44)
 {
-  for (int64_t i = 0 ; i < n ; ++i)
-    opengl_matrix(m34 + 12*i, m44 + 16*i);
+  Thread_Pool::parallel_for(n, [=](int64_t i0, int64_t i1) {
+      for (int64_t i = i0 ; i < i1 ; ++i)
+	opengl_matrix(m34 + 12*i, m44 + 16*i);
+    }, matrix_chunk_size);
 }
 
 // ----------------------------------------------------------------------------
@@ -292,7 +340,10 @@ extern "C" PyObject *opengl_matrices(PyObject *, PyObject *args, PyObject *keywd
     {
       float *r;
       py_result = python_float_array(n, 4, 4, &r);
-      opengl_matrices(m.values(), n, r);
+      double *m34 = m.values();
+      Py_BEGIN_ALLOW_THREADS
+      opengl_matrices(m34, n, r);
+      Py_END_ALLOW_THREADS
     }
   else
     {
@@ -306,7 +357,11 @@ extern "C" PyObject *opengl_matrices(PyObject *, PyObject *args, PyObject *keywd
 		       n, result.size_string(0).c_str());
 	  return NULL;
 	}
-      opengl_matrices(m.values(), n, result.values());
+      double *m34 = m.values();
+      float *r = result.values();
+      Py_BEGIN_ALLOW_THREADS
+      opengl_matrices(m34, n, r);
+      Py_END_ALLOW_THREADS
       Py_INCREF(py_result);
     }
 
@@ -0,0 +1,421 @@
+// vi: set expandtab shiftwidth=4 softtabstop=4:
+
+/*
+ * === UCSF ChimeraX Copyright ===
+ * Copyright 2022 Regents of the University of California. All rights reserved.
+ * The ChimeraX application is provided pursuant to the ChimeraX license
+ * agreement, which covers academic and commercial uses. For more details, see
+ * <http://www.rbvi.ucsf.edu/chimerax/docs/licensing.html>
+ *
+ * This particular file is part of the ChimeraX library. You can also
+ * redistribute and/or modify it under the terms of the GNU Lesser General
+ * Public License version 2.1 as published by the Free Software Foundation.
+ * For more details, see
+ * <https://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESSED OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. ADDITIONAL LIABILITY
+ * LIMITATIONS ARE DESCRIBED IN THE GNU LESSER GENERAL PUBLIC LICENSE
+ * VERSION 2.1
+ *
+ * This notice must be embedded in or attached to all copies, including partial
+ * copies, of the software or any revisions or derivations thereof.
+ * === UCSF ChimeraX Copyright ===
+ */
+
+// ----------------------------------------------------------------------------
+
+// ----------------------------------------------------------------------------
+// Iterative superposition as used by the align and matchmaker commands.
+// Each pass aligns the current pairs and, unless all pairs are within the
+// cutoff distance, keeps the closest pairs, culling 10% or half the pairs
+// beyond the cutoff, whichever is fewer.  The whole loop runs without Python
+// and many point set pairs are aligned on separate threads.
+//
+#include <Python.h>			// use PyObject
+
+#include <math.h>			// use sqrt()
+#include <algorithm>			// use std::stable_sort, std::max
+#include <atomic>			// use std::atomic
+#include <numeric>			// use std::iota
+#include <vector>			// use std::vector
+
+#include <arrays/pythonarray.h>		// use parse_double_n3_array(), ...
+#include <arrays/rcarray.h>		// use DArray
+#include <arrays/threadpool.h>		// use Thread_Pool::run()
+#include "superpose.h"
+
+using std::vector;
+
+namespace Superpose
+{
+
+// ----------------------------------------------------------------------------
+//
+class Alignment
+{
+public:
+  Alignment() : rms(0), full_rms(0), failed(false) {}
+  double tf[3][4];
+  double rms, full_rms;		// RMS of kept pairs and of all pairs
+  vector<int> indices;		// Kept pairs, closest first
+  bool failed;			// Fewer than 3 pairs left after pruning
+};
+
+// ----------------------------------------------------------------------------
+// Eigenvector of the largest eigenvalue of a symmetric 4x4 matrix by Jacobi
+// rotations.  The matrix is overwritten.  Ties go to the last component so a
+// zero matrix gives the identity quaternion (0,0,0,1).
+//
+static void largest_eigenvector(double a[4][4], double ev[4])
+{
+  double v[4][4] = {{1,0,0,0},{0,1,0,0},{0,0,1,0},{0,0,0,1}};
+  for (int sweep = 0 ; sweep < 50 ; ++sweep)
+    {
+      double off = 0, diag = 0;
+      for (int p = 0 ; p < 4 ; ++p)
+	{
+	  diag += a[p][p]*a[p][p];
+	  for (int q = p+1 ; q < 4 ; ++q)
+	    off += a[p][q]*a[p][q];
+	}
+      if (off <= 1e-30 * diag || off == 0)
+	break;
+      for (int p = 0 ; p < 3 ; ++p)
+	for (int q = p+1 ; q < 4 ; ++q)
+	  {
+	    double apq = a[p][q];
+	    if (apq == 0)
+	      continue;
+	    double theta = (a[q][q] - a[p][p]) / (2*apq);
+	    double t = (theta >= 0 ? 1 : -1) / (fabs(theta) + sqrt(theta*theta + 1));
+	    double c = 1 / sqrt(t*t + 1), s = t*c;
+	    for (int k = 0 ; k < 4 ; ++k)
+	      {
+		double akp = a[k][p], akq = a[k][q];
+		a[k][p] = c*akp - s*akq;
+		a[k][q] = s*akp + c*akq;
+	      }
+	    for (int k = 0 ; k < 4 ; ++k)
+	      {
+		double apk = a[p][k], aqk = a[q][k];
+		a[p][k] = c*apk - s*aqk;
+		a[q][k] = s*apk + c*aqk;
+	      }
+	    for (int k = 0 ; k < 4 ; ++k)
+	      {
+		double vkp = v[k][p], vkq = v[k][q];
+		v[k][p] = c*vkp - s*vkq;
+		v[k][q] = s*vkp + c*vkq;
+	      }
+	  }
+    }
+  int m = 3;
+  for (int k = 2 ; k >= 0 ; --k)
+    if (a[k][k] > a[m][m])
+      m = k;
+  for (int k = 0 ; k < 4 ; ++k)
+    ev[k] = v[k][m];
+}
+
+// ----------------------------------------------------------------------------
+// Rotation and translation taking the indexed points onto the indexed
+// reference points minimizing the sum of squared distances.  It uses the
+// quaternion method of chimerax.geometry.align_points().
+//
+static void align_indexed_points(const double *xyz, const double *ref,
+				 const vector<int> &indices, double tf[3][4])
+{
+  size_t n = indices.size();
+  double c[3] = {0,0,0}, rc[3] = {0,0,0};
+  for (int i : indices)
+    for (int a = 0 ; a < 3 ; ++a)
+      {
+	c[a] += xyz[3*i+a];
+	rc[a] += ref[3*i+a];
+      }
+  for (int a = 0 ; a < 3 ; ++a)
+    {
+      c[a] /= n;
+      rc[a] /= n;
+    }
+
+  double s[3][3] = {{0,0,0},{0,0,0},{0,0,0}};
+  for (int i : indices)
+    {
+      const double *p = xyz + 3*i, *r = ref + 3*i;
+      double d[3] = {p[0]-c[0], p[1]-c[1], p[2]-c[2]};
+      double e[3] = {r[0]-rc[0], r[1]-rc[1], r[2]-rc[2]};
+      for (int a = 0 ; a < 3 ; ++a)
+	for (int b = 0 ; b < 3 ; ++b)
+	  s[a][b] += d[a]*e[b];
+    }
+
+  double tr = s[0][0] + s[1][1] + s[2][2];
+  double m[4][4];
+  for (int a = 0 ; a < 3 ; ++a)
+    for (int b = 0 ; b < 3 ; ++b)
+      m[a][b] = s[a][b] + s[b][a] - (a == b ? 2*tr : 0);
+  m[3][0] = m[0][3] = s[1][2] - s[2][1];
+  m[3][1] = m[1][3] = s[2][0] - s[0][2];
+  m[3][2] = m[2][3] = s[0][1] - s[1][0];
+  m[3][3] = 0;
+
+  double q[4] = {0,0,0,1};
+  if (n > 1)
+    largest_eigenvector(m, q);
+  double l = q[0], mm = q[1], nn = q[2], w = q[3];
+  double r[3][3] =
+    {{l*l - mm*mm - nn*nn + w*w, 2*(l*mm - nn*w), 2*(l*nn + mm*w)},
+     {2*(l*mm + nn*w), -l*l + mm*mm - nn*nn + w*w, 2*(mm*nn - l*w)},
+     {2*(l*nn - mm*w), 2*(mm*nn + l*w), -l*l - mm*mm + nn*nn + w*w}};
+  for (int a = 0 ; a < 3 ; ++a)
+    {
+      for (int b = 0 ; b < 3 ; ++b)
+	tf[a][b] = r[a][b];
+      tf[a][3] = rc[a] - (r[a][0]*c[0] + r[a][1]*c[1] + r[a][2]*c[2]);
+    }
+}
+
+// ----------------------------------------------------------------------------
+//
+static double distance_squared(const double tf[3][4], const double *p, const double *r)
+{
+  double d2 = 0;
+  for (int a = 0 ; a < 3 ; ++a)
+    {
+      double d = tf[a][0]*p[0] + tf[a][1]*p[1] + tf[a][2]*p[2] + tf[a][3] - r[a];
+      d2 += d*d;
+    }
+  return d2;
+}
+
+// ----------------------------------------------------------------------------
+// Align n point pairs.  A negative cutoff distance aligns all pairs once.
+//
+static void iterative_align(const double *xyz, const double *ref, int n,
+			    double cutoff_distance, Alignment &al)
+{
+  vector<int> &indices = al.indices;
+  indices.resize(n);
+  std::iota(indices.begin(), indices.end(), 0);
+  double cutoff2 = cutoff_distance * cutoff_distance;
+  vector<double> d2(n);
+  vector<int> order(n);
+  while (true)
+    {
+      align_indexed_points(xyz, ref, indices, al.tf);
+      int m = indices.size();
+      double sum = 0, d2max = 0;
+      int within = 0;
+      for (int k = 0 ; k < m ; ++k)
+	{
+	  int i = indices[k];
+	  double dk = distance_squared(al.tf, xyz + 3*i, ref + 3*i);
+	  d2[k] = dk;
+	  sum += dk;
+	  d2max = std::max(d2max, dk);
+	  if (dk <= cutoff2)
+	    within += 1;
+	}
+      if (cutoff_distance < 0 || d2max <= cutoff2)
+	{
+	  al.rms = (m > 0 ? sqrt(sum / m) : 0);
+	  break;
+	}
+
+      // Keep the closest pairs.
+      int keep = std::max(static_cast<int>(m * 0.9), (within + m) / 2);
+      if (keep < 3)
+	{
+	  al.failed = true;
+	  return;
+	}
+      order.resize(m);
+      std::iota(order.begin(), order.end(), 0);
+      std::stable_sort(order.begin(), order.end(),
+		       [&d2](int k1, int k2) { return d2[k1] < d2[k2]; });
+      vector<int> survivors(keep);
+      for (int k = 0 ; k < keep ; ++k)
+	survivors[k] = indices[order[k]];
+      indices.swap(survivors);
+    }
+
+  double full = 0;
+  for (int i = 0 ; i < n ; ++i)
+    full += distance_squared(al.tf, xyz + 3*i, ref + 3*i);
+  al.full_rms = (n > 0 ? sqrt(full / n) : 0);
+}
+
+// ----------------------------------------------------------------------------
+//
+static bool parse_point_pairs(PyObject *py_xyz, PyObject *py_ref, DArray *xyz, DArray *ref)
+{
+  if (!parse_double_n3_array(py_xyz, xyz) || !parse_double_n3_array(py_ref, ref))
+    return false;
+  if (xyz->size(0) != ref->size(0))
+    {
+      PyErr_Format(PyExc_ValueError, "Point arrays must have the same size, got %s and %s",
+		   xyz->size_string().c_str(), ref->size_string().c_str());
+      return false;
+    }
+  if (xyz->size(0) == 0)
+    {
+      PyErr_SetString(PyExc_ValueError, "No points to align");
+      return false;
+    }
+  *xyz = xyz->contiguous_array();
+  *ref = ref->contiguous_array();
+  return true;
+}
+
+// ----------------------------------------------------------------------------
+//
+static PyObject *alignment_to_python(const Alignment &al)
+{
+  if (al.failed)
+    return python_none();
+  double *tf;
+  PyObject *py_tf = python_double_array(3, 4, &tf);
+  for (int a = 0 ; a < 3 ; ++a)
+    for (int b = 0 ; b < 4 ; ++b)
+      tf[4*a+b] = al.tf[a][b];
+  return python_tuple(py_tf, PyFloat_FromDouble(al.rms), c_array_to_python(al.indices),
+		      PyFloat_FromDouble(al.full_rms));
+}
+
+// ----------------------------------------------------------------------------
+//
+static double cutoff_argument(PyObject *py_cutoff)
+{
+  return (py_cutoff == Py_None ? -1 : PyFloat_AsDouble(py_cutoff));
+}
+
+}  // end of namespace Superpose
+
+using namespace Superpose;
+
+// ----------------------------------------------------------------------------
+//
+const char *iterative_align_points_doc =
+  "iterative_align_points(xyz, ref_xyz, cutoff_distance) -> tf, rms, indices, full_rms\n"
+  "\n"
+  "Supported API\n"
+  "Align points onto paired reference points minimizing the sum of squared\n"
+  "distances, then repeatedly drop the most distant pairs and realign until\n"
+  "all remaining pairs are within the cutoff distance.  Each pass drops 10%\n"
+  "of the pairs, or half the pairs beyond the cutoff, whichever is fewer.\n"
+  "Implemented in C++.\n"
+  "\n"
+  "Parameters\n"
+  "----------\n"
+  "xyz : n by 3 float64 array\n"
+  "ref_xyz : n by 3 float64 array\n"
+  "cutoff_distance : float or None\n"
+  "  None aligns all pairs without pruning.\n"
+  "\n"
+  "Returns\n"
+  "-------\n"
+  "tf : 3 by 4 float64 array\n"
+  "  transformation taking xyz onto ref_xyz.\n"
+  "rms : float\n"
+  "  root mean square distance of the kept pairs.\n"
+  "indices : int32 array\n"
+  "  indices of the kept pairs, closest first.\n"
+  "full_rms : float\n"
+  "  root mean square distance of all pairs.\n"
+  "None is returned if pruning leaves fewer than 3 pairs.\n";
+
+extern "C" PyObject *iterative_align_points(PyObject *, PyObject *args, PyObject *keywds)
+{
+  PyObject *py_xyz, *py_ref, *py_cutoff = Py_None;
+  const char *kwlist[] = {"xyz", "ref_xyz", "cutoff_distance", NULL};
+  if (!PyArg_ParseTupleAndKeywords(args, keywds, const_cast<char *>("OO|O"),
+				   (char **)kwlist, &py_xyz, &py_ref, &py_cutoff))
+    return NULL;
+
+  DArray xyz, ref;
+  if (!parse_point_pairs(py_xyz, py_ref, &xyz, &ref))
+    return NULL;
+  double cutoff = cutoff_argument(py_cutoff);
+  if (PyErr_Occurred())
+    return NULL;
+
+  Alignment al;
+  Py_BEGIN_ALLOW_THREADS
+    iterative_align(xyz.values(), ref.values(), xyz.size(0), cutoff, al);
+  Py_END_ALLOW_THREADS
+
+  return alignment_to_python(al);
+}
+
+// ----------------------------------------------------------------------------
+//
+const char *iterative_align_point_sets_doc =
+  "iterative_align_point_sets(xyz_sets, ref_xyz_sets, cutoff_distance) -> list of results\n"
+  "\n"
+  "Supported API\n"
+  "Align many pairs of point sets as iterative_align_points() does, computing\n"
+  "the pairs in parallel threads.  The result for each pair is a tuple\n"
+  "(tf, rms, indices, full_rms), or None if pruning left fewer than 3 pairs.\n"
+  "Implemented in C++.\n"
+  "\n"
+  "Parameters\n"
+  "----------\n"
+  "xyz_sets : sequence of n by 3 float64 arrays\n"
+  "ref_xyz_sets : sequence of n by 3 float64 arrays\n"
+  "  paired with xyz_sets, each the same size as its xyz set.\n"
+  "cutoff_distance : float or None\n";
+
+extern "C" PyObject *iterative_align_point_sets(PyObject *, PyObject *args, PyObject *keywds)
+{
+  PyObject *py_xyz_sets, *py_ref_sets, *py_cutoff = Py_None;
+  const char *kwlist[] = {"xyz_sets", "ref_xyz_sets", "cutoff_distance", NULL};
+  if (!PyArg_ParseTupleAndKeywords(args, keywds, const_cast<char *>("OO|O"),
+				   (char **)kwlist, &py_xyz_sets, &py_ref_sets, &py_cutoff))
+    return NULL;
+
+  if (!PySequence_Check(py_xyz_sets) || !PySequence_Check(py_ref_sets))
+    {
+      PyErr_SetString(PyExc_TypeError, "Point set arguments must be sequences");
+      return NULL;
+    }
+  Py_ssize_t ns = PySequence_Length(py_xyz_sets);
+  if (PySequence_Length(py_ref_sets) != ns)
+    {
+      PyErr_Format(PyExc_ValueError, "Got %zd point sets and %zd reference point sets",
+		   ns, PySequence_Length(py_ref_sets));
+      return NULL;
+    }
+  double cutoff = cutoff_argument(py_cutoff);
+  if (PyErr_Occurred())
+    return NULL;
+
+  vector<DArray> xyz(ns), ref(ns);
+  for (Py_ssize_t s = 0 ; s < ns ; ++s)
+    {
+      PyObject *py_xyz = PySequence_GetItem(py_xyz_sets, s);
+      PyObject *py_ref = PySequence_GetItem(py_ref_sets, s);
+      bool ok = (py_xyz && py_ref && parse_point_pairs(py_xyz, py_ref, &xyz[s], &ref[s]));
+      Py_XDECREF(py_xyz);
+      Py_XDECREF(py_ref);
+      if (!ok)
+	return NULL;
+    }
+
+  // Sets take very different times so threads take the next set as they finish.
+  vector<Alignment> al(ns);
+  Py_BEGIN_ALLOW_THREADS
+  std::atomic<Py_ssize_t> next(0);
+  Thread_Pool::run(Thread_Pool::thread_count(ns), [&](int) {
+      for (Py_ssize_t s = next++ ; s < ns ; s = next++)
+	iterative_align(xyz[s].values(), ref[s].values(), xyz[s].size(0), cutoff, al[s]);
+    });
+  Py_END_ALLOW_THREADS
+
+  PyObject *results = PyList_New(ns);
+  for (Py_ssize_t s = 0 ; s < ns ; ++s)
+    PyList_SetItem(results, s, alignment_to_python(al[s]));
+  return results;
+}
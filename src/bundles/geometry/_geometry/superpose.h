@@ -0,0 +1,47 @@
+/*
+ * === UCSF ChimeraX Copyright ===
+ * Copyright 2022 Regents of the University of California. All rights reserved.
+ * The ChimeraX application is provided pursuant to the ChimeraX license
+ * agreement, which covers academic and commercial uses. For more details, see
+ * <http://www.rbvi.ucsf.edu/chimerax/docs/licensing.html>
+ *
+ * This particular file is part of the ChimeraX library. You can also
+ * redistribute and/or modify it under the terms of the GNU Lesser General
+ * Public License version 2.1 as published by the Free Software Foundation.
+ * For more details, see
+ * <https://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESSED OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. ADDITIONAL LIABILITY
+ * LIMITATIONS ARE DESCRIBED IN THE GNU LESSER GENERAL PUBLIC LICENSE
+ * VERSION 2.1
+ *
+ * This notice must be embedded in or attached to all copies, including partial
+ * copies, of the software or any revisions or derivations thereof.
+ * === UCSF ChimeraX Copyright ===
+ */
+
+// ----------------------------------------------------------------------------
+
+// ----------------------------------------------------------------------------
+// Least squares superposition of paired points, iteratively dropping the
+// most distant pairs until all remaining pairs are within a cutoff distance.
+//
+#ifndef SUPERPOSE_HEADER_INCLUDED
+#define SUPERPOSE_HEADER_INCLUDED
+
+#include <Python.h>			// use PyObject
+
+extern "C"
+{
+// iterative_align_points(xyz, ref_xyz, cutoff_distance) -> (tf, rms, indices, full_rms) or None
+PyObject *iterative_align_points(PyObject *, PyObject *args, PyObject *keywds);
+extern const char *iterative_align_points_doc;
+
+// iterative_align_point_sets(xyz_sets, ref_xyz_sets, cutoff_distance) -> list of results
+PyObject *iterative_align_point_sets(PyObject *, PyObject *args, PyObject *keywds);
+extern const char *iterative_align_point_sets_doc;
+}
+
+#endif
@@ -28,10 +28,12 @@
 // Transform points with shift, scale and linear operations.
 //
 #include <Python.h>			// use PyObject
-#include <math.h>			// use sqrtf()
+#include <algorithm>			// use std::max()
+#include <cmath>			// use std::sqrt()
 
 #include <arrays/pythonarray.h>		// use array_from_python()
 #include <arrays/rcarray.h>		// use call_template_function()
+#include <arrays/threadpool.h>		// use Thread_Pool::parallel_for()
 #include "transform.h"
 
 // ----------------------------------------------------------------------------
@@ -121,47 +123,59 @@ extern "C" PyObject *shift_vertices(PyObject *, PyObject *args)
 }
 
 // ----------------------------------------------------------------------------
+// Points are split over threads only for very large arrays since the loop
+// is limited by memory bandwidth.
 //
-static void affine_transform_vertices(FArray &vertex_positions, float tf[3][4])
+static const int64_t transform_chunk_size = (1 << 21);
+
+// ----------------------------------------------------------------------------
+// Transform n points with strides s0 between points and s1 between
+// components, writing to out with the same strides (out can equal xyz).
+// The packed xyz case is a separate loop with no strides so the compiler
+// vectorizes it.
+//
+template <class T>
+static void affine_transform_points(const T *xyz, int64_t n, int64_t s0, int64_t s1,
+				    const T tf[3][4], T *out)
 {
-  float *xyz = vertex_positions.values();
-  int64_t n = vertex_positions.size(0);
-  int64_t s0 = vertex_positions.stride(0), s1 = vertex_positions.stride(1);
-  float t00 = tf[0][0], t01 = tf[0][1], t02 = tf[0][2], t03 = tf[0][3];
-  float t10 = tf[1][0], t11 = tf[1][1], t12 = tf[1][2], t13 = tf[1][3];
-  float t20 = tf[2][0], t21 = tf[2][1], t22 = tf[2][2], t23 = tf[2][3];
+  T t00 = tf[0][0], t01 = tf[0][1], t02 = tf[0][2], t03 = tf[0][3];
+  T t10 = tf[1][0], t11 = tf[1][1], t12 = tf[1][2], t13 = tf[1][3];
+  T t20 = tf[2][0], t21 = tf[2][1], t22 = tf[2][2], t23 = tf[2][3];
+  if (s0 == 3 && s1 == 1)
+    {
+      int64_t n3 = 3*n;
+      for (int64_t k = 0 ; k < n3 ; k += 3)
+	{
+	  T x = xyz[k], y = xyz[k+1], z = xyz[k+2];
+	  out[k] = t00*x + t01*y + t02*z + t03;
+	  out[k+1] = t10*x + t11*y + t12*z + t13;
+	  out[k+2] = t20*x + t21*y + t22*z + t23;
+	}
+      return;
+    }
   for (int64_t k = 0 ; k < n ; ++k)
     {
-      float *px = xyz + s0*k;
-      float *py = px + s1;
-      float *pz = py + s1;
-      float x = *px, y = *py, z = *pz;
-      *px = t00*x + t01*y + t02*z + t03;
-      *py = t10*x + t11*y + t12*z + t13;
-      *pz = t20*x + t21*y + t22*z + t23;
+      const T *p = xyz + s0*k;
+      T *po = out + s0*k;
+      T x = p[0], y = p[s1], z = p[2*s1];
+      po[0] = t00*x + t01*y + t02*z + t03;
+      po[s1] = t10*x + t11*y + t12*z + t13;
+      po[2*s1] = t20*x + t21*y + t22*z + t23;
     }
 }
 
 // ----------------------------------------------------------------------------
 //
-static void affine_transform_vertices(DArray &vertex_positions, double tf[3][4])
+template <class T>
+static void affine_transform_vertices(Reference_Counted_Array::Array<T> &vertex_positions,
+				      T tf[3][4])
 {
-  double *xyz = vertex_positions.values();
+  T *xyz = vertex_positions.values();
   int64_t n = vertex_positions.size(0);
   int64_t s0 = vertex_positions.stride(0), s1 = vertex_positions.stride(1);
-  double t00 = tf[0][0], t01 = tf[0][1], t02 = tf[0][2], t03 = tf[0][3];
-  double t10 = tf[1][0], t11 = tf[1][1], t12 = tf[1][2], t13 = tf[1][3];
-  double t20 = tf[2][0], t21 = tf[2][1], t22 = tf[2][2], t23 = tf[2][3];
-  for (int64_t k = 0 ; k < n ; ++k)
-    {
-      double *px = xyz + s0*k;
-      double *py = px + s1;
-      double *pz = py + s1;
-      double x = *px, y = *py, z = *pz;
-      *px = t00*x + t01*y + t02*z + t03;
-      *py = t10*x + t11*y + t12*z + t13;
-      *pz = t20*x + t21*y + t22*z + t23;
-    }
+  Thread_Pool::parallel_for(n, [=](int64_t i0, int64_t i1) {
+      affine_transform_points<T>(xyz + s0*i0, i1-i0, s0, s1, tf, xyz + s0*i0);
+    }, transform_chunk_size);
 }
 
 // ----------------------------------------------------------------------------
@@ -175,13 +189,19 @@ extern "C" PyObject *affine_transform_vertices(PyObject *, PyObject *args)
   if (PyArg_ParseTuple(args, const_cast<char *>("O&O&"),
 		       parse_writable_float_n3_array, &varray,
 		       parse_float_3x4_array, tf))
-    affine_transform_vertices(varray, tf);
+    {
+      Py_BEGIN_ALLOW_THREADS
+      affine_transform_vertices(varray, tf);
+      Py_END_ALLOW_THREADS
+    }
   else if (PyArg_ParseTuple(args, const_cast<char *>("O&O&"),
 			    parse_writable_double_n3_array, &v64array,
 			    parse_double_3x4_array, tf64))
     {
       PyErr_Clear();
+      Py_BEGIN_ALLOW_THREADS
       affine_transform_vertices(v64array, tf64);
+      Py_END_ALLOW_THREADS
     }
   else
     return NULL;
@@ -191,95 +211,73 @@ extern "C" PyObject *affine_transform_vertices(PyObject *, PyObject *args)
 }
 
 // ----------------------------------------------------------------------------
+// Inverse transpose of a 3x3 matrix, for transforming normals.
 //
-static void affine_transform_normals(FArray &vertex_positions, float tf[3][3])
+template <class T>
+static void inverse_transpose(const T tf[3][3], T r[3][3])
 {
-  float *xyz = vertex_positions.values();
-  int64_t n = vertex_positions.size(0);
-  int64_t s0 = vertex_positions.stride(0), s1 = vertex_positions.stride(1);
-
-  float t00 = tf[0][0], t01 = tf[0][1], t02 = tf[0][2];
-  float t10 = tf[1][0], t11 = tf[1][1], t12 = tf[1][2];
-  float t20 = tf[2][0], t21 = tf[2][1], t22 = tf[2][2];
-
-  float r00 = t11 * t22 - t12 * t21;
-  float r10 = t21 * t02 - t22 * t01;
-  float r20 = t01 * t12 - t02 * t11;
-  float r01 = t12 * t20 - t10 * t22;
-  float r11 = t22 * t00 - t20 * t02;
-  float r21 = t02 * t10 - t00 * t12;
-  float r02 = t10 * t21 - t11 * t20;
-  float r12 = t20 * t01 - t21 * t00;
-  float r22 = t00 * t11 - t01 * t10;
-  float det = t00 * r00 + t01 * r01 + t02 * r02;
-  r00 /= det; r01 /= det; r02 /= det;
-  r10 /= det; r11 /= det; r12 /= det;
-  r20 /= det; r21 /= det; r22 /= det;
+  T t00 = tf[0][0], t01 = tf[0][1], t02 = tf[0][2];
+  T t10 = tf[1][0], t11 = tf[1][1], t12 = tf[1][2];
+  T t20 = tf[2][0], t21 = tf[2][1], t22 = tf[2][2];
+
+  r[0][0] = t11 * t22 - t12 * t21;
+  r[1][0] = t21 * t02 - t22 * t01;
+  r[2][0] = t01 * t12 - t02 * t11;
+  r[0][1] = t12 * t20 - t10 * t22;
+  r[1][1] = t22 * t00 - t20 * t02;
+  r[2][1] = t02 * t10 - t00 * t12;
+  r[0][2] = t10 * t21 - t11 * t20;
+  r[1][2] = t20 * t01 - t21 * t00;
+  r[2][2] = t00 * t11 - t01 * t10;
+  T det = t00 * r[0][0] + t01 * r[0][1] + t02 * r[0][2];
+  for (int i = 0 ; i < 3 ; ++i)
+    for (int j = 0 ; j < 3 ; ++j)
+      r[i][j] /= det;
+}
 
+// ----------------------------------------------------------------------------
+// Multiply n vectors by a 3x3 matrix and normalize them.
+//
+template <class T>
+static void transform_and_normalize(T *xyz, int64_t n, int64_t s0, int64_t s1,
+				    const T r[3][3])
+{
+  T r00 = r[0][0], r01 = r[0][1], r02 = r[0][2];
+  T r10 = r[1][0], r11 = r[1][1], r12 = r[1][2];
+  T r20 = r[2][0], r21 = r[2][1], r22 = r[2][2];
   for (int64_t k = 0 ; k < n ; ++k)
     {
-      float *px = xyz + s0*k;
-      float *py = px + s1;
-      float *pz = py + s1;
-      float x = *px, y = *py, z = *pz;
-      *px = r00*x + r01*y + r02*z;
-      *py = r10*x + r11*y + r12*z;
-      *pz = r20*x + r21*y + r22*z;
-
-      float len = sqrtf(*px * *px + *py * *py + *pz * *pz);
+      T *px = xyz + s0*k;
+      T *py = px + s1;
+      T *pz = py + s1;
+      T x = *px, y = *py, z = *pz;
+      T nx = r00*x + r01*y + r02*z;
+      T ny = r10*x + r11*y + r12*z;
+      T nz = r20*x + r21*y + r22*z;
+
+      T len = std::sqrt(nx*nx + ny*ny + nz*nz);
       if (len != 0)
-	{
-	  *px /= len;
-	  *py /= len;
-	  *pz /= len;
-	}
+	{ nx /= len; ny /= len; nz /= len; }
+      *px = nx;
+      *py = ny;
+      *pz = nz;
     }
 }
 
 // ----------------------------------------------------------------------------
 //
-static void affine_transform_normals(DArray &vertex_positions, double tf[3][3])
+template <class T>
+static void affine_transform_normals(Reference_Counted_Array::Array<T> &vertex_positions,
+				     T tf[3][3])
 {
-  double *xyz = vertex_positions.values();
+  T *xyz = vertex_positions.values();
   int64_t n = vertex_positions.size(0);
   int64_t s0 = vertex_positions.stride(0), s1 = vertex_positions.stride(1);
-
-  double t00 = tf[0][0], t01 = tf[0][1], t02 = tf[0][2];
-  double t10 = tf[1][0], t11 = tf[1][1], t12 = tf[1][2];
-  double t20 = tf[2][0], t21 = tf[2][1], t22 = tf[2][2];
-
-  double r00 = t11 * t22 - t12 * t21;
-  double r10 = t21 * t02 - t22 * t01;
-  double r20 = t01 * t12 - t02 * t11;
-  double r01 = t12 * t20 - t10 * t22;
-  double r11 = t22 * t00 - t20 * t02;
-  double r21 = t02 * t10 - t00 * t12;
-  double r02 = t10 * t21 - t11 * t20;
-  double r12 = t20 * t01 - t21 * t00;
-  double r22 = t00 * t11 - t01 * t10;
-  double det = t00 * r00 + t01 * r01 + t02 * r02;
-  r00 /= det; r01 /= det; r02 /= det;
-  r10 /= det; r11 /= det; r12 /= det;
-  r20 /= det; r21 /= det; r22 /= det;
-
-  for (int64_t k = 0 ; k < n ; ++k)
-    {
-      double *px = xyz + s0*k;
-      double *py = px + s1;
-      double *pz = py + s1;
-      double x = *px, y = *py, z = *pz;
-      *px = r00*x + r01*y + r02*z;
-      *py = r10*x + r11*y + r12*z;
-      *pz = r20*x + r21*y + r22*z;
-
-      double len = sqrt(*px * *px + *py * *py + *pz * *pz);
-      if (len != 0)
-	{
-	  *px /= len;
-	  *py /= len;
-	  *pz /= len;
-	}
-    }
+  T r[3][3];
+  inverse_transpose(tf, r);
+  Thread_Pool::parallel_for(n, [=, &r](int64_t i0, int64_t i1) {
+      transform_and_normalize<T>(xyz + s0*i0, i1-i0, s0, s1, r);
+    }, transform_chunk_size);
 }
 
 // ----------------------------------------------------------------------------
@@ -293,13 +291,19 @@ extern "C" PyObject *affine_transform_normals(PyObject *, PyObject *args)
   if (PyArg_ParseTuple(args, const_cast<char *>("O&O&"),
 		       parse_writable_float_n3_array, &varray,
 		       parse_float_3x3_array, tf))
-    affine_transform_normals(varray, tf);
+    {
+      Py_BEGIN_ALLOW_THREADS
+      affine_transform_normals(varray, tf);
+      Py_END_ALLOW_THREADS
+    }
   else if (PyArg_ParseTuple(args, const_cast<char *>("O&O&"),
 			    parse_writable_double_n3_array, &v64array,
 			    parse_double_3x3_array, tf64))
     {
       PyErr_Clear();
+      Py_BEGIN_ALLOW_THREADS
       affine_transform_normals(v64array, tf64);
+      Py_END_ALLOW_THREADS
     }
   else
     return NULL;
@@ -307,3 +311,61 @@ extern "C" PyObject *affine_transform_normals(PyObject *, PyObject *args)
 
   return python_none();
 }
+
+// ----------------------------------------------------------------------------
+// Write each of the K positions applied to the n points to consecutive
+// blocks of n points in out.  Copies are split over threads when there are
+// many points in all.
+//
+static void affine_transform_copies(const FArray &points, const FArray &positions,
+				    bool translate, float *out)
+{
+  int64_t n = points.size(0), k = positions.size(0);
+  const float *xyz = points.values(), *p = positions.values();
+  int64_t chunk = std::max(static_cast<int64_t>(1), transform_chunk_size / std::max(n, static_cast<int64_t>(1)));
+  Thread_Pool::parallel_for(k, [=](int64_t c0, int64_t c1) {
+      for (int64_t c = c0 ; c < c1 ; ++c)
+	{
+	  float tf[3][4];
+	  const float *pc = p + 12*c;
+	  for (int i = 0 ; i < 3 ; ++i)
+	    for (int j = 0 ; j < 4 ; ++j)
+	      tf[i][j] = (j == 3 && !translate ? 0 : pc[4*i+j]);
+	  affine_transform_points<float>(xyz, n, 3, 1, tf, out + 3*n*c);
+	}
+    }, chunk);
+}
+
+// ----------------------------------------------------------------------------
+//
+extern "C" PyObject *affine_transform_copies(PyObject *, PyObject *args, PyObject *keywds)
+{
+  FArray points, positions, out;
+  int translate = 1;
+  const char *kwlist[] = {"points", "positions", "out", "translate", NULL};
+  if (!PyArg_ParseTupleAndKeywords(args, keywds, const_cast<char *>("O&O&O&|p"),
+				   (char **)kwlist,
+				   parse_float_n3_array, &points,
+				   parse_float_array, &positions,
+				   parse_writable_float_n3_array, &out,
+				   &translate))
+    return NULL;
+
+  if (positions.dimension() != 3 || positions.size(1) != 3 || positions.size(2) != 4)
+    return PyErr_Format(PyExc_ValueError, "Positions array is not of size Nx3x4, got %s",
+			positions.size_string().c_str());
+  if (out.size(0) != positions.size(0) * points.size(0))
+    return PyErr_Format(PyExc_ValueError,
+			"Output array must have %lld points, one copy of %lld points for each of %lld positions, got %lld",
+			(long long)(positions.size(0) * points.size(0)), (long long)points.size(0),
+			(long long)positions.size(0), (long long)out.size(0));
+  if (!out.is_contiguous())
+    return PyErr_Format(PyExc_ValueError, "Output array is not contiguous");
+  FArray cpoints = points.contiguous_array(), cpositions = positions.contiguous_array();
+
+  Py_BEGIN_ALLOW_THREADS
+  affine_transform_copies(cpoints, cpositions, translate, out.values());
+  Py_END_ALLOW_THREADS
+
+  return python_none();
+}
@@ -34,6 +34,8 @@ PyObject *scale_vertices(PyObject *, PyObject *args);
 PyObject *shift_vertices(PyObject *, PyObject *args);
 PyObject *affine_transform_vertices(PyObject *, PyObject *args);
 PyObject *affine_transform_normals(PyObject *, PyObject *args);
+// affine_transform_copies(points, positions, out, translate = True)
+PyObject *affine_transform_copies(PyObject *, PyObject *args, PyObject *keywds);
 
 }
 
@@ -86,7 +86,9 @@ extern "C" PyObject *inner_product_64(PyObject *, PyObject *args, PyObject *keyw
     }
 
   double sum = 0;
+  Py_BEGIN_ALLOW_THREADS
   call_template_function(inner, m1.value_type(), (m1, m2, &sum));
+  Py_END_ALLOW_THREADS
 
   return PyFloat_FromDouble(sum);
 }
@@ -42,12 +42,19 @@ from .bounds import copies_bounding_box, copy_tree_bounds, clip_bounds
 from ._geometry import natural_cubic_spline
 from ._geometry import sphere_axes_bounds, spheres_in_bounds, bounds_overlap
 from ._geometry import find_close_points, find_closest_points, find_close_points_sets
+from ._geometry import find_close_points_copies
+from .closepoints import ClosePointsIndex
 from ._geometry import closest_sphere_intercept, closest_cylinder_intercept, closest_triangle_intercept
-from ._geometry import segment_intercepts_spheres, points_within_planes
+from ._geometry import triangle_intercept_tree, sphere_intercept_tree
+from ._geometry import closest_tree_intercept, closest_tree_intercepts
+from ._geometry import segment_intercepts_spheres, points_within_planes, copies_within_planes
 from ._geometry import cylinder_rotations, half_cylinder_rotations, cylinder_rotations_x3d
 from ._geometry import distances_from_origin, distances_parallel_to_axis, distances_perpendicular_to_axis
-from ._geometry import fill_small_ring, fill_6ring
+from ._geometry import rmsd_matrix
+from ._geometry import affine_transform_copies
+from ._geometry import fill_small_ring, fill_6ring, fill_rings
 from .align import align_points
+from ._geometry import iterative_align_points, iterative_align_point_sets
 from .symmetry import cyclic_symmetry_matrices
 from .symmetry import dihedral_symmetry_matrices
 from .symmetry import tetrahedral_symmetry_matrices, tetrahedral_orientations
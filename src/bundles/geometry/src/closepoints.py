@@ -0,0 +1,50 @@
+# === UCSF ChimeraX Copyright ===
+# Copyright 2016 Regents of the University of California.
+# All rights reserved.  This software provided pursuant to a
+# license agreement containing restrictions on its disclosure,
+# duplication and use.  For details see:
+# http://www.rbvi.ucsf.edu/chimerax/docs/licensing.html
+# This notice must be embedded in or attached to all copies,
+# including partial copies, of the software or any revisions
+# or derivations thereof.
+# === UCSF ChimeraX Copyright ===
+
+class ClosePointsIndex:
+    '''
+    Supported API.
+    Spatial index of a fixed set of points for repeatedly finding the points
+    within a distance of other sets of points.  The points are binned once
+    when the index is made, so many searches, for instance one per frame of a
+    trajectory, avoid rebinning them as :py:func:`.find_closest_points` does.
+    Searches release the Python global interpreter lock and use multiple
+    threads for large sets of query points.
+
+    Parameters
+    ----------
+    xyz : numpy float n by 3 array
+      Points to index.  They are copied so later changes to the array have no effect.
+    cell_size : float
+      Size of index bins, best near the distance that will be searched.
+    transform : :py:class:`.Place`
+      Optional transform applied to the points.
+    '''
+    def __init__(self, xyz, cell_size, transform = None):
+        from numpy import float32
+        xyz = xyz.astype(float32, copy = False)
+        tf = None if transform is None or transform.is_identity() else transform.matrix.astype(float32)
+        from ._geometry import close_points_index
+        self._index = close_points_index(xyz, cell_size, tf)
+        self.size = len(xyz)
+
+    def search(self, xyz, max_distance):
+        '''
+        Find query points within max_distance of indexed points.  Returns
+        index arrays i1, i2, near1 like :py:func:`.find_closest_points` where
+        i1 are query points with a close indexed point, i2 are indexed points
+        close to some query point, and near1 is the closest indexed point for
+        each query point in i1.
+        '''
+        from numpy import float32
+        xyz = xyz.astype(float32, copy = False)
+        from ._geometry import close_points_index_search
+        return close_points_index_search(self._index, xyz, max_distance)
@@ -647,14 +647,20 @@ class Places:
     primarily to allow efficient handling of large numbers of positions.
     '''
     def __init__(self, places=None, place_array=None, shift_and_scale=None,
-                 opengl_array=None):
+                 opengl_array=None, halfbond_cylinders=None):
         '''
         Supported API. 
         Places can be specified as a list of Place instances, or a numpy N x 3 x 4 array,
         or a shift and scale N x 4 array, or a 4 x 4 numpy array (opengl format).
+        Half bond cylinders are given as an N x 8 float32 array, each row
+        (x0, y0, z0, radius, x1, y1, z1, halves), describing the 2N placements of the
+        unit cylinders for the two halves of N bonds, first halves followed by second
+        halves.  Halves is a bit mask of which halves are drawn (1 = first, 2 = second)
+        and is normally 3.  Graphics expands these on the GPU, so only 32 bytes per bond
+        are sent instead of two 64 byte matrices.
         '''
         if (place_array is not None or shift_and_scale is not None
-                or opengl_array is not None):
+                or opengl_array is not None or halfbond_cylinders is not None):
             pl = None
         elif places is None:
             pl = [Place()]
@@ -664,6 +670,7 @@ class Places:
         self._place_array = place_array
         self._opengl_array = opengl_array
         self._shift_and_scale = shift_and_scale
+        self._halfbond_cylinders = halfbond_cylinders
 
         # Check that arrays are the right type.
         if place_array is not None:
@@ -672,6 +679,8 @@ class Places:
             self._check_array('opengl_array', opengl_array)
         if shift_and_scale is not None:
             self._check_array('shift_and_scale', shift_and_scale)
+        if halfbond_cylinders is not None:
+            self._check_array('halfbond_cylinders', halfbond_cylinders)
 
     def _check_array(self, name, array, double = False, contiguous = True):
         from numpy import ndarray, float32, float64
@@ -694,9 +703,9 @@ class Places:
                                   (0, s[3], 0, s[1]),
                                   (0, 0, s[3], s[2])))
                            for s in self._shift_and_scale)
-            elif self._opengl_array is not None:
+            elif self._opengl_array is not None or self._halfbond_cylinders is not None:
                 pl = tuple(Place(m.transpose()[:3, :])
-                           for m in self._opengl_array)
+                           for m in self.opengl_matrices())
             else:
                 pl = []
             self._place_list = pl
@@ -716,8 +725,8 @@ class Places:
                 pa[:] = 0
                 pa[:,:,3] = sas[:,:3]
                 pa[:,0,0] = pa[:,1,1] = pa[:,2,2] = sas[:,3]
-            elif self._opengl_array is not None:
-                pa[:] = self._opengl_array.transpose((0,2,1))[:,:3,:]
+            elif self._opengl_array is not None or self._halfbond_cylinders is not None:
+                pa[:] = self.opengl_matrices().transpose((0,2,1))[:,:3,:]
             self._place_array = pa
         return pa
 
@@ -733,6 +742,9 @@ class Places:
         sas = self._shift_and_scale
         if not sas is None:
             p = Places(shift_and_scale = sas[mask])
+        elif self._halfbond_cylinders is not None:
+            # a mask can select single halves of bonds
+            p = Places(opengl_array = self.opengl_matrices()[mask])
         else:
             oa = self._opengl_array
             if oa is None:
@@ -749,6 +761,14 @@ class Places:
         '''
         return self._shift_and_scale
 
+    def halfbond_cylinder_array(self):
+        '''
+        Supported API.
+        Only valid if this Places was specified using a half bond cylinders array,
+        otherwise None is returned.
+        '''
+        return self._halfbond_cylinders
+
     def opengl_matrices(self):
         '''
         Supported API.
@@ -756,7 +776,14 @@ class Places:
         '''
         m = self._opengl_array
         if m is None:
-            m = _geometry.opengl_matrices(self.array(), len(self))
+            hc = self._halfbond_cylinders
+            if hc is not None:
+                from numpy import empty, float32
+                m = empty((2*len(hc),4,4), float32)
+                _geometry.half_cylinder_rotations(hc[:,:3].copy(), hc[:,4:7].copy(),
+                                                  hc[:,3].copy(), m)
+            else:
+                m = _geometry.opengl_matrices(self.array(), len(self))
             self._opengl_array = m
         return m
 
@@ -776,6 +803,8 @@ class Places:
             n = len(self._shift_and_scale)
         elif self._opengl_array is not None:
             n = len(self._opengl_array)
+        elif self._halfbond_cylinders is not None:
+            n = 2*len(self._halfbond_cylinders)
         return n
 
     def __iter__(self):
@@ -856,14 +885,24 @@ class Places:
         self._place_list = None
         self._opengl_array = None
         self._shift_and_scale = None
+        self._halfbond_cylinders = None
 
-    def _matrices_changed(self):
+    def _matrices_changed(self, opengl_updated = False):
         self._place_list = None
         self._shift_and_scale = None
+        self._halfbond_cylinders = None
         oa = self._opengl_array
-        if oa is not None:
+        if oa is not None and not opengl_updated:
             _geometry.opengl_matrices(self.array(), len(self), oa)
 
+    def _set_products(self, m1, n1, m2, n2):
+        # Set matrices to products, also updating the OpenGL matrices
+        # in the same pass if they are in use.
+        self._resize(n1*n2)
+        oa = self._opengl_array
+        _geometry.multiply_matrix_lists(m1, n1, m2, n2, self.array(), oa)
+        self._matrices_changed(opengl_updated = True)
+
     
 def multiply_transforms(tf1, tf2, result = None):
     '''
@@ -882,20 +921,11 @@ def multiply_transforms(tf1, tf2, result = None):
         _geometry.multiply_matrices(tf1._matrix, tf2._matrix, result._matrix)
         result._reuse()
     elif isinstance(tf1, Places) and isinstance(tf2, Place):
-        n = len(tf1)
-        result._resize(n)
-        _geometry.multiply_matrix_lists(tf1.array(), n, tf2._matrix.reshape((1,3,4)), 1, result.array())
-        result._matrices_changed()
+        result._set_products(tf1.array(), len(tf1), tf2._matrix.reshape((1,3,4)), 1)
     elif isinstance(tf1, Place) and isinstance(tf2, Places):
-        n = len(tf2)
-        result._resize(n)
-        _geometry.multiply_matrix_lists(tf1._matrix.reshape((1,3,4)), 1, tf2.array(), n, result.array())
-        result._matrices_changed()
+        result._set_products(tf1._matrix.reshape((1,3,4)), 1, tf2.array(), len(tf2))
     elif isinstance(tf1, Places) and isinstance(tf2, Places):
-        n1, n2 = len(tf1), len(tf2)
-        result._resize(n1*n2)
-        _geometry.multiply_matrix_lists(tf1.array(), n1, tf2.array(), n2, result.array())
-        result._matrices_changed()
+        result._set_products(tf1.array(), len(tf1), tf2.array(), len(tf2))
     else:
         raise ValueError('Arguments must be Place or Places.  Got %s and %s.'
                          % (str(type(tf1)), str(type(tf2))))
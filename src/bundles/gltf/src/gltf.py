@@ -1028,15 +1028,20 @@ def _split_multitexture_geometry(va, na, vc, tc, ta, ntex):
 # -----------------------------------------------------------------------------
 #
 def combine_instance_geometry(va, na, vc, tc, ta, places, instance_colors):
-    v = []
-    n = []
+    # Transform vertices and normals for all instances in one call.
+    from numpy import empty, float32
+    from chimerax.geometry import affine_transform_copies
+    pa = places.array()
+    cva = empty((len(places)*len(va),3), float32)
+    affine_transform_copies(va, pa, cva)
+    cna = empty((len(places)*len(na),3), float32)
+    affine_transform_copies(na, pa, cna, translate = False)
+
     c = []
     u = []
     t = []
     offset = 0
-    for i,p in enumerate(places):
-        v.append(p*va)
-        n.append(p.transform_vectors(na))
+    for i in range(len(places)):
         if vc is None:
             ivc = single_vertex_color(len(va), instance_colors[i])
             c.append(ivc)
@@ -1050,7 +1055,7 @@ def combine_instance_geometry(va, na, vc, tc, ta, places, instance_colors):
     from numpy import concatenate
     ctc = concatenate(u) if tc else None
 
-    cva, cna, cca, cta = concatenate(v), concatenate(n), concatenate(c), concatenate(t)
+    cca, cta = concatenate(c), concatenate(t)
 
     # Instanced geometry often is scaled so normals need renormalizing.
     from chimerax.geometry import normalize_vectors
@@ -29,25 +29,53 @@
 //
 #include <Python.h>			// use PyObject
 #include <math.h>			// use ceil, floor
+#include <algorithm>			// use std::min
+#include <vector>			// use std::vector
 
 #include <arrays/pythonarray.h>		// use array_from_python()
 #include <arrays/rcarray.h>		// use Numeric_Array, Array<T>
+#include <arrays/threadpool.h>		// use Thread_Pool::thread_count(), run()
+
+// ----------------------------------------------------------------------------
+//
+static int thread_count(int64_t work, int64_t min_per_thread)
+{
+  return Thread_Pool::thread_count(work, min_per_thread);
+}
+
+// ----------------------------------------------------------------------------
+// Run f(i0, i1, t) over nt blocks of range 0 to n with shared pool threads.
+// The calling thread does the first block.  Blocks start at multiples of 4.
+//
+template <class F>
+static void run_threads(int64_t n, int nt, F f)
+{
+  Thread_Pool::run(nt, [&](int t) {
+      f((t == 0 ? 0 : 4*((n/4*t)/nt)), (t+1 < nt ? 4*((n/4*(t+1))/nt) : n), t);
+    });
+}
+
+// ----------------------------------------------------------------------------
+// Round towards bgcolor.  Casting to an integer truncates, which is floor for
+// the non-negative values of unsigned char colors, and avoids math library
+// calls so the loop is much faster.
+//
+template<class T> static inline T floor_color(float x) { return static_cast<T>(floor(x)); }
+template<class T> static inline T ceil_color(float x) { return static_cast<T>(ceil(x)); }
+template<> inline unsigned char floor_color<unsigned char>(float x)
+  { return static_cast<unsigned char>(static_cast<int>(x)); }
+template<> inline unsigned char ceil_color<unsigned char>(float x)
+  { int i = static_cast<int>(x); return static_cast<unsigned char>(i + (i < x ? 1 : 0)); }
 
 // ----------------------------------------------------------------------------
 //
 template<class T>
-static void blend_colors(float f, const Reference_Counted_Array::Array<T> &m1,
-			 const Reference_Counted_Array::Array<T> &m2,
-			 const Reference_Counted_Array::Array<T> &bgcolor,
-			 float alpha,
-			 const Reference_Counted_Array::Array<T> &m,
-			 int64_t *count)
-			   
+static int64_t blend_colors(float f, const T *v1, const T *v2, const T *bg, T a,
+			    T *v, int64_t k0, int64_t k1)
 {
-  int64_t n = m.size(), c = 0;
-  T *v1 = m1.values(), *v2 = m2.values(), *v = m.values(), *bg = bgcolor.values();
-  T bg0 = bg[0], bg1 = bg[1], bg2 = bg[2], a = static_cast<T>(floor(alpha));;
-  for (int k = 0 ; k < n ; k += 4)
+  int64_t c = 0;
+  T bg0 = bg[0], bg1 = bg[1], bg2 = bg[2];
+  for (int64_t k = k0 ; k < k1 ; k += 4)
     {
       if (v1[k] != bg0 || v1[k+1] != bg1 || v1[k+2] != bg2)
 	{ v[k] = v1[k]; v[k+1] = v1[k+1]; v[k+2] = v1[k+2]; }
@@ -57,17 +85,44 @@ static void blend_colors(float f, const Reference_Counted_Array::Array<T> &m1,
 	  float f1 = f*(static_cast<float>(v2[k+1])-bg1);
 	  float f2 = f*(static_cast<float>(v2[k+2])-bg2);
 	  // Round integral types towards bgcolor.
-	  v[k] = (f0 >= 0 ? static_cast<T>(floor(bg0+f0)) : static_cast<T>(ceil(f0+bg0)));
-	  v[k+1] = (f1 >= 0 ? static_cast<T>(floor(bg1+f1)) : static_cast<T>(ceil(f1+bg1)));
-	  v[k+2] = (f2 >= 0 ? static_cast<T>(floor(bg2+f2)) : static_cast<T>(ceil(f2+bg2)));
+	  v[k] = (f0 >= 0 ? floor_color<T>(bg0+f0) : ceil_color<T>(f0+bg0));
+	  v[k+1] = (f1 >= 0 ? floor_color<T>(bg1+f1) : ceil_color<T>(f1+bg1));
+	  v[k+2] = (f2 >= 0 ? floor_color<T>(bg2+f2) : ceil_color<T>(f2+bg2));
 	  if (f0 != 0 || f1 != 0 || f2 != 0)
 	    c += 1;
 	}
       v[k+3] = a;
     }
-  *count = c;
+  return c;
 }
 
+// ----------------------------------------------------------------------------
+// Blocks of pixels are blended in parallel.
+//
+template<class T>
+static void blend_colors(float f, const Reference_Counted_Array::Array<T> &m1,
+			 const Reference_Counted_Array::Array<T> &m2,
+			 const Reference_Counted_Array::Array<T> &bgcolor,
+			 float alpha,
+			 const Reference_Counted_Array::Array<T> &m,
+			 int64_t *count)
+			   
+{
+  int64_t n = m.size();
+  const T *v1 = m1.values(), *v2 = m2.values(), *bg = bgcolor.values();
+  T *v = m.values(), a = static_cast<T>(floor(alpha));
+  int nt = thread_count(n, 1000000);
+  std::vector<int64_t> counts(nt);
+  Py_BEGIN_ALLOW_THREADS
+  run_threads(n, nt, [&](int64_t k0, int64_t k1, int t) {
+      counts[t] = blend_colors(f, v1, v2, bg, a, v, k0, k1);
+    });
+  Py_END_ALLOW_THREADS
+  int64_t c = 0;
+  for (auto tc: counts)
+    c += tc;
+  *count = c;
+}
 // ----------------------------------------------------------------------------
 //
 extern "C" PyObject *blur_blend_images(PyObject *, PyObject *args, PyObject *keywds)
@@ -118,6 +173,29 @@ extern "C" PyObject *blur_blend_images(PyObject *, PyObject *args, PyObject *key
 
 // ----------------------------------------------------------------------------
 //
+template<class T>
+static void add_images(const unsigned char *v8, T *sum, int64_t n)
+{
+  int nt = thread_count(n, 1000000);
+  run_threads(n, nt, [v8, sum](int64_t i0, int64_t i1, int) {
+      for (int64_t i = i0 ; i < i1 ; ++i)
+	sum[i] += v8[i];
+    });
+}
+
+// ----------------------------------------------------------------------------
+//
+static bool accumulation_type(const Reference_Counted_Array::Numeric_Array &a)
+{
+  Reference_Counted_Array::Numeric_Array::Value_Type t = a.value_type();
+  return (t == Reference_Counted_Array::Numeric_Array::Unsigned_Int ||
+	  t == Reference_Counted_Array::Numeric_Array::Float);
+}
+
+// ----------------------------------------------------------------------------
+// The sum array can be uint32 or float32.  A float32 sum can be kept between
+// supersampled images so that a large array is not allocated for each image.
+//
 extern "C" PyObject *accumulate_images(PyObject *, PyObject *args, PyObject *keywds)
 {
   Reference_Counted_Array::Numeric_Array rgba8, rgba32;
@@ -133,9 +211,9 @@ extern "C" PyObject *accumulate_images(PyObject *, PyObject *args, PyObject *key
       return NULL;
     }
   if (rgba8.value_type() != Reference_Counted_Array::Numeric_Array::Unsigned_Char ||
-      rgba32.value_type() !=  Reference_Counted_Array::Numeric_Array::Unsigned_Int)
+      !accumulation_type(rgba32))
     {
-      PyErr_SetString(PyExc_TypeError, "accumulate_images: arrays must have value type uint8 and uint32");
+      PyErr_SetString(PyExc_TypeError, "accumulate_images: arrays must have value type uint8 and uint32 or float32");
       return NULL;
     }
   if (rgba8.size() != rgba32.size())
@@ -145,10 +223,83 @@ extern "C" PyObject *accumulate_images(PyObject *, PyObject *args, PyObject *key
     }
 
   unsigned char *v8 = static_cast<unsigned char *>(rgba8.values());
-  unsigned int *v32 = static_cast<unsigned int *>(rgba32.values());
   int64_t n = rgba8.size();
-  for (int64_t i = 0 ; i < n ; ++i)
-    v32[i] += v8[i];
+  bool float_sum = (rgba32.value_type() == Reference_Counted_Array::Numeric_Array::Float);
+  void *v32 = rgba32.values();
+  Py_BEGIN_ALLOW_THREADS
+  if (float_sum)
+    add_images(v8, static_cast<float *>(v32), n);
+  else
+    add_images(v8, static_cast<unsigned int *>(v32), n);
+  Py_END_ALLOW_THREADS
+
+  return python_none();
+}
+
+// ----------------------------------------------------------------------------
+// Divide float sums in 32-bit precision and truncate like numpy
+// (sum / count).astype(uint8) does.
+//
+static inline unsigned char average_color(float sum, float count)
+  { return static_cast<unsigned char>(sum / count); }
+static inline unsigned char average_color(unsigned int sum, unsigned int count)
+  { return static_cast<unsigned char>(sum / count); }
+
+template<class T>
+static void average_images(const T *sum, int64_t count, unsigned char *v8, int64_t n)
+{
+  int nt = thread_count(n, 1000000);
+  T c = static_cast<T>(count);
+  run_threads(n, nt, [sum, c, v8](int64_t i0, int64_t i1, int) {
+      for (int64_t i = i0 ; i < i1 ; ++i)
+	v8[i] = average_color(sum[i], c);
+    });
+}
+
+// ----------------------------------------------------------------------------
+//
+extern "C" PyObject *average_images(PyObject *, PyObject *args, PyObject *keywds)
+{
+  Reference_Counted_Array::Numeric_Array rgba32, rgba8;
+  int count;
+  const char *kwlist[] = {"rgba32", "count", "rgba8", NULL};
+  if (!PyArg_ParseTupleAndKeywords(args, keywds,
+				   const_cast<char *>("O&iO&"), (char **)kwlist,
+				   parse_3d_array, &rgba32, &count, parse_3d_array, &rgba8))
+    return NULL;
+
+  if (!rgba8.is_contiguous() || !rgba32.is_contiguous())
+    {
+      PyErr_SetString(PyExc_TypeError, "average_images: arrays must be contiguous");
+      return NULL;
+    }
+  if (rgba8.value_type() != Reference_Counted_Array::Numeric_Array::Unsigned_Char ||
+      !accumulation_type(rgba32))
+    {
+      PyErr_SetString(PyExc_TypeError, "average_images: arrays must have value type uint8 and uint32 or float32");
+      return NULL;
+    }
+  if (rgba8.size() != rgba32.size())
+    {
+      PyErr_SetString(PyExc_TypeError, "average_images: arrays must have same size");
+      return NULL;
+    }
+  if (count <= 0)
+    {
+      PyErr_SetString(PyExc_ValueError, "average_images: count must be positive");
+      return NULL;
+    }
+
+  unsigned char *v8 = static_cast<unsigned char *>(rgba8.values());
+  int64_t n = rgba8.size();
+  bool float_sum = (rgba32.value_type() == Reference_Counted_Array::Numeric_Array::Float);
+  void *v32 = rgba32.values();
+  Py_BEGIN_ALLOW_THREADS
+  if (float_sum)
+    average_images(static_cast<float *>(v32), count, v8, n);
+  else
+    average_images(static_cast<unsigned int *>(v32), count, v8, n);
+  Py_END_ALLOW_THREADS
 
   return python_none();
 }
@@ -37,7 +37,10 @@ extern "C"
 
 // void blur_blend_images(float f, PyObject *rgba1, PyObject *rgba2, PyObject *bgcolor, float alpha, PyObject *rgba);
 PyObject *blur_blend_images(PyObject *s, PyObject *args, PyObject *keywds);
+// void accumulate_images(PyObject *rgba8, PyObject *rgba32);
 PyObject *accumulate_images(PyObject *s, PyObject *args, PyObject *keywds);
+// void average_images(PyObject *rgba32, int count, PyObject *rgba8);
+PyObject *average_images(PyObject *s, PyObject *args, PyObject *keywds);
 
 }
 
@@ -44,6 +44,8 @@ static struct PyMethodDef graphics_cpp_methods[] =
    METH_VARARGS|METH_KEYWORDS, NULL},
   {const_cast<char*>("accumulate_images"), (PyCFunction)accumulate_images,
    METH_VARARGS|METH_KEYWORDS, NULL},
+  {const_cast<char*>("average_images"), (PyCFunction)average_images,
+   METH_VARARGS|METH_KEYWORDS, NULL},
 
   /* count.h */
   {const_cast<char*>("count_value"), (PyCFunction)count_value,
@@ -60,6 +62,8 @@ static struct PyMethodDef graphics_cpp_methods[] =
   /* mesh_edges.h */
   {const_cast<char*>("masked_edges"), (PyCFunction)masked_edges,
    METH_VARARGS|METH_KEYWORDS, NULL},
+  {const_cast<char*>("mesh_edge_index"), (PyCFunction)mesh_edge_index,
+   METH_VARARGS|METH_KEYWORDS, NULL},
 
   {NULL, NULL, 0, NULL}
 };
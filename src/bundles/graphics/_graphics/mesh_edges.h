@@ -32,6 +32,7 @@
 extern "C" {
 
 PyObject *masked_edges(PyObject *s, PyObject *args, PyObject *keywds);
+PyObject *mesh_edge_index(PyObject *s, PyObject *args, PyObject *keywds);
 
 }
 
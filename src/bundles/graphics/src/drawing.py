@@ -92,6 +92,9 @@ class Drawing:
         self._child_drawings = []
 
         self._cached_geometry_bounds = None	# Triangles, positions not included. Local coords.
+        self._cached_intercept_tree = None	# Bounding box tree for picking large geometry.
+        self._cached_cap_state = None		# Plane intersection state for clip caps.
+        self._cached_edge_index = None		# Numbered triangle edges for masking mesh edges.
         self._cached_position_bounds = None	# Triangles including positions, children not included. Scene coords.
 
         # Geometry and colors
@@ -187,6 +190,14 @@ class Drawing:
         Whether to draw on top of everything else.  Used for text labels.
         '''
 
+        self.sphere_impostors = False
+        '''
+        Whether instances positioned by shift and scale are drawn as spheres
+        ray cast in the fragment shader, using the geometry as a square with
+        corners (+/-1, +/-1, 0) turned to face the camera.  Sphere centers
+        and radii are the instance shifts and scales.
+        '''
+
         # OpenGL drawing
         self._draw_shape = None
         self._draw_highlight = None
@@ -257,6 +268,10 @@ class Drawing:
             if sc:
                 self._cached_geometry_bounds = None
                 self._cached_position_bounds = None
+                self._cached_intercept_tree = None
+                self._cached_cap_state = None
+                if key == '_triangles':
+                    self._cached_edge_index = None
             else:
                 sc = key in ('_displayed_positions', '_positions')
                 if sc:
@@ -713,6 +728,15 @@ class Drawing:
         if art:
             art()
 
+    def set_vertices_and_normals(self, vertices, normals):
+        '''
+        Change the vertex positions and normals keeping the same triangles,
+        vertex colors and masks.  The number of vertices must not change.
+        '''
+        self._vertices = vertices
+        self._normals = normals
+        self.redraw_needed(shape_changed=True)
+
     def empty_drawing(self):
         '''Does this drawing have no geometry? Does not consider child
         drawings.'''
@@ -884,6 +908,10 @@ class Drawing:
                 sopt |= Render.SHADER_TEXTURE_3D_AMBIENT
             if self.positions.shift_and_scale_array() is not None:
                 sopt |= Render.SHADER_SHIFT_AND_SCALE
+                if self.sphere_impostors:
+                    sopt |= Render.SHADER_SPHERE_IMPOSTORS
+            elif self.positions.halfbond_cylinder_array() is not None:
+                sopt |= Render.SHADER_INSTANCING | Render.SHADER_HALFBOND_CYLINDERS
             elif len(self.positions) > 1:
                 sopt |= Render.SHADER_INSTANCING
             if not self.accept_shadow:
@@ -906,7 +934,8 @@ class Drawing:
     _effects_shader = set(
         ('use_lighting', '_vertex_colors', '_colors', 'texture',
          'ambient_texture', '_positions',
-         'allow_depth_cue', 'allow_clipping', 'accept_shadow', 'accept_multishadow'))
+         'allow_depth_cue', 'allow_clipping', 'accept_shadow', 'accept_multishadow',
+         'sphere_impostors'))
 
     # Update the contents of vertex, element and instance buffers if associated
     #  arrays have changed.
@@ -929,12 +958,13 @@ class Drawing:
             em = self._edge_mask
             tm = self._triangle_mask
             tmsel = self.highlighted_displayed_triangles_mask
-            ds.update_element_buffer(ta, style, tm, em)
+            ei = self._mesh_edge_index(ta) if style == self.Mesh else None
+            ds.update_element_buffer(ta, style, tm, em, ei)
             if tmsel is tm:
                 # Avoid slow recomputation of mesh edges. Ticket #6243
                 dss.copy_elements(ds)
             else:
-                dss.update_element_buffer(ta, style, tmsel, em)
+                dss.update_element_buffer(ta, style, tmsel, em, ei)
 
         # Update instancing buffers
         p = self.positions
@@ -1097,7 +1127,7 @@ class Drawing:
             # TODO: Intercept only for triangles, not lines or points.
             return None
         p = None
-        from chimerax.geometry import closest_triangle_intercept
+        closest_triangle_intercept = self._triangle_intercept_function(va, ta)
         if self.positions.is_identity():
             fmin, tmin = closest_triangle_intercept(va, ta, mxyz1, mxyz2)
             if fmin is not None:
@@ -1111,6 +1141,21 @@ class Drawing:
                     p = PickedTriangle(fmin, tmin, i, self)
         return p
 
+    _intercept_tree_min_triangles = 20000
+    def _triangle_intercept_function(self, va, ta):
+        # Large surfaces are picked using a bounding box tree that is kept
+        # until the geometry changes.  The tree takes about as long to make
+        # as 10 linear searches, so it pays off for mouse hover picking.
+        from chimerax.geometry import closest_triangle_intercept
+        if len(ta) < self._intercept_tree_min_triangles:
+            return closest_triangle_intercept
+        tree = self._cached_intercept_tree
+        if tree is None:
+            from chimerax.geometry import triangle_intercept_tree
+            self._cached_intercept_tree = tree = triangle_intercept_tree(va, ta)
+        from chimerax.geometry import closest_tree_intercept
+        return lambda va, ta, xyz1, xyz2: closest_tree_intercept(tree, xyz1, xyz2)
+
     def bounds_intercept_copies(self, bounds, mxyz1, mxyz2):
         '''
         Return indices of positions where line segment intercepts displayed bounds.
@@ -1375,6 +1420,9 @@ class Drawing:
                 mask['triangle_mask'] = tm
             if em is not None:
                 mask['edge_mask'] = em
+            ei = self._mesh_edge_index(ta)
+            if ei is not None:
+                mask['edge_index'] = ei
             from ._graphics import masked_edges
             edges = masked_edges(ta, **mask)
         elif ta.shape[1] == 2:
@@ -1385,6 +1433,23 @@ class Drawing:
 
         return edges
 
+    _edge_index_min_triangles = 100000
+    def _mesh_edge_index(self, ta):
+        # Mesh edges of large surfaces are found from a numbering of all the
+        # triangle edges so that changing the triangle or edge mask does not
+        # sort the edges again.  The numbering is made the second time edges
+        # are needed for the same triangles and kept until they change.
+        if ta is None or ta.shape[1] != 3 or len(ta) < self._edge_index_min_triangles:
+            return None
+        ei = self._cached_edge_index
+        if ei is None or ei[0] is not ta:
+            self._cached_edge_index = (ta, None)
+            return None
+        if ei[1] is None:
+            from ._graphics import mesh_edge_index
+            self._cached_edge_index = ei = (ta, mesh_edge_index(ta))
+        return ei[1]
+
     def x3d_needs(self, x3d_scene):
         if not self.display:
             return
@@ -1701,6 +1766,7 @@ class _DrawShape:
         # Arrays derived from positions, colors and geometry
         self.instance_shift_and_scale = None   # N by 4 array, (x, y, z, scale)
         self.instance_matrices = None	    # matrices for displayed instances
+        self.instance_halfbond_cylinders = None # N by 2 by 4 array, bond end points
         self.instance_colors = None
         self.elements = None                # Triangles after mask applied
         self._masked_edges = None
@@ -1728,6 +1794,7 @@ class _DrawShape:
         self._masked_edges = None
         self.instance_shift_and_scale = None
         self.instance_matrices = None
+        self.instance_halfbond_cylinders = None
         self.instance_colors = None
         if self.element_buffer:
             self.element_buffer.delete_buffer()
@@ -1781,9 +1848,10 @@ class _DrawShape:
         eb.buffer_attribute_name = 'elements'
         return eb
 
-    def update_element_buffer(self, triangles, style, triangle_mask, edge_mask):
+    def update_element_buffer(self, triangles, style, triangle_mask, edge_mask,
+                              edge_index = None):
 
-        e = self.masked_elements(triangles, style, triangle_mask, edge_mask)
+        e = self.masked_elements(triangles, style, triangle_mask, edge_mask, edge_index)
         self.set_elements(e)
 
     def copy_elements(self, draw_shape):
@@ -1804,7 +1872,7 @@ class _DrawShape:
         if eb:
             self.buffer_needs_update(eb)
 
-    def masked_elements(self, triangles, style, tmask, edge_mask):
+    def masked_elements(self, triangles, style, tmask, edge_mask, edge_index = None):
 
         ta = triangles
         if ta is None:
@@ -1818,6 +1886,8 @@ class _DrawShape:
                 pass    # Triangles array already contains edges.
             elif edge_mask is None:
                 kw = {} if tmask is None else {'triangle_mask': tmask}
+                if edge_index is not None:
+                    kw['edge_index'] = edge_index
                 ta = masked_edges(ta, **kw)
             else:
                 # TODO: Need to reset masked_edges if edge_mask changed.
@@ -1829,6 +1899,8 @@ class _DrawShape:
                         kw['edge_mask'] = edge_mask
                     if tmask is not None:
                         kw['triangle_mask'] = tmask
+                    if edge_index is not None:
+                        kw['edge_index'] = edge_index
                     self._masked_edges = me = masked_edges(ta, **kw)
                     self._edge_mask, self._tri_mask = edge_mask, tmask
                 ta = me
@@ -1845,6 +1917,7 @@ class _DrawShape:
         ibufs = (
             ('instance_shift_and_scale', opengl.INSTANCE_SHIFT_AND_SCALE_BUFFER),
             ('instance_matrices', opengl.INSTANCE_MATRIX_BUFFER),
+            ('instance_halfbond_cylinders', opengl.INSTANCE_HALFBOND_CYLINDER_BUFFER),
             ('instance_colors', opengl.INSTANCE_COLOR_BUFFER),
         )
         ib = []
@@ -1866,6 +1939,12 @@ class _DrawShape:
             self.buffer_needs_update(b)
 
     def update_instance_arrays(self, positions, colors, position_mask):
+        hc = positions.halfbond_cylinder_array()
+        if hc is not None:
+            self._update_halfbond_cylinder_arrays(hc, colors, position_mask)
+            return
+        self.instance_halfbond_cylinders = None
+
         sas = positions.shift_and_scale_array()
         np = len(positions)
         im = positions.opengl_matrices() if sas is None and np > 1 else None
@@ -1885,10 +1964,36 @@ class _DrawShape:
         self.instance_shift_and_scale = sas
         self.instance_colors = ic
 
+    def _update_halfbond_cylinder_arrays(self, hc, colors, position_mask):
+        # Placements 0..N-1 are first halves and N..2N-1 second halves.  The
+        # shader draws the two halves of a bond as consecutive instances so
+        # colors are interleaved.  Bonds with one half masked keep both
+        # instances with the masked half flagged hidden.
+        n = len(hc)
+        import numpy
+        ic = colors
+        if len(ic) != 2*n:
+            ic = numpy.resize(ic, (2*n,4))
+        ic = ic.reshape((2,n,4))
+        pm = position_mask
+        if pm is not None:
+            m1, m2 = pm[:n], pm[n:]
+            keep = m1 | m2
+            hc = hc[keep]
+            hc[:,7] = m1[keep] + 2*m2[keep]
+            ic = ic[:,keep,:]
+        self.instance_halfbond_cylinders = hc.reshape((len(hc),2,4))
+        self.instance_colors = ic.transpose((1,0,2)).reshape((2*len(hc),4))
+        self.instance_matrices = None
+        self.instance_shift_and_scale = None
+
     def instance_count(self):
         im = self.instance_matrices
         isas = self.instance_colors
-        if im is not None:
+        ihc = self.instance_halfbond_cylinders
+        if ihc is not None:
+            ninst = 2*len(ihc)
+        elif im is not None:
             ninst = len(im)
         elif isas is not None:
             ninst = len(isas)
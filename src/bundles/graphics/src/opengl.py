@@ -672,6 +672,7 @@ class Render:
         # Enable only shader geometry, no colors or lighting.
         if depth_only:
             d = ~(self.SHADER_INSTANCING | self.SHADER_SHIFT_AND_SCALE |
+                  self.SHADER_HALFBOND_CYLINDERS | self.SHADER_SPHERE_IMPOSTORS |
                   self.SHADER_TRANSPARENT_ONLY | self.SHADER_OPAQUE_ONLY |
                   self.SHADER_CLIP_PLANES)
         else:
@@ -691,7 +692,8 @@ class Render:
         SHADER_SHIFT_AND_SCALE, SHADER_INSTANCING, SHADER_TEXTURE_OUTLINE,
         SHADER_DEPTH_OUTLINE, SHADER_VERTEX_COLORS,
         SHADER_TRANSPARENT_ONLY, SHADER_OPAQUE_ONLY, SHADER_STEREO_360
-        SHADER_CLIP_PLANES, SHADER_ALL_WHITE
+        SHADER_CLIP_PLANES, SHADER_ALL_WHITE, SHADER_HALFBOND_CYLINDERS,
+        SHADER_SPHERE_IMPOSTORS
         '''
         options |= self.enable_capabilities
         options &= ~self.disable_capabilities
@@ -2069,6 +2071,8 @@ shader_options = (
     'SHADER_NO_CLIP_PLANES',
     'SHADER_ALPHA_DEPTH',
     'SHADER_ALL_WHITE',
+    'SHADER_HALFBOND_CYLINDERS',
+    'SHADER_SPHERE_IMPOSTORS',
 )
 for i, sopt in enumerate(shader_options):
     setattr(Render, sopt, 1 << i)
@@ -2487,7 +2491,8 @@ class Bindings:
     shader variable ids.
     '''
     attribute_id = {'position': 0, 'tex_coord': 1, 'normal': 2, 'vcolor': 3,
-                    'instance_shift_and_scale': 4, 'instance_placement': 5}
+                    'instance_shift_and_scale': 4, 'instance_placement': 5,
+                    'instance_halfbond_cylinder': 9}
 
     def __init__(self, name, opengl_context):
         self._name = name # Used for debugging
@@ -2565,7 +2570,7 @@ class Bindings:
         if nattr == 1:
             GL.glVertexAttribPointer(attr_id, ncomp, gtype, normalize, 0, None)
             GL.glEnableVertexAttribArray(attr_id)
-            GL.glVertexAttribDivisor(attr_id, 1 if buffer.instance_buffer else 0)
+            GL.glVertexAttribDivisor(attr_id, buffer.instance_divisor if buffer.instance_buffer else 0)
             self._bound_attr_ids[buffer] = [attr_id]
             self._bound_attr_buffers[attr_id] = buffer
         else:
@@ -2581,7 +2586,7 @@ class Bindings:
                 a_id = attr_id + a
                 GL.glVertexAttribPointer(a_id, ncomp, gtype, normalize, stride, p)
                 GL.glEnableVertexAttribArray(a_id)
-                GL.glVertexAttribDivisor(a_id, 1 if buffer.instance_buffer else 0)
+                GL.glVertexAttribDivisor(a_id, buffer.instance_divisor if buffer.instance_buffer else 0)
                 bab[a_id] = buffer
             self._bound_attr_ids[buffer] = [attr_id + a for a in range(nattr)]
         GL.glBindBuffer(btype, 0)
@@ -2601,16 +2606,18 @@ class BufferType:
     '''
     Describes a shader variable and the vertex buffer object value type
     required and what rendering capabilities are required to use this
-    shader variable.
+    shader variable.  Instance buffers advance one value every
+    instance_divisor instances.
     '''
     def __init__(self, shader_variable_name, buffer_type=GL_ARRAY_BUFFER,
                  value_type=float32, normalize=False, instance_buffer=False,
-                 requires_capabilities=()):
+                 instance_divisor=1, requires_capabilities=()):
         self.shader_variable_name = shader_variable_name
         self.buffer_type = buffer_type
         self.value_type = value_type
         self.normalize = normalize
         self.instance_buffer = instance_buffer
+        self.instance_divisor = instance_divisor
 
         # Requires at least one of these:
         self.requires_capabilities = requires_capabilities
@@ -2626,6 +2633,9 @@ INSTANCE_SHIFT_AND_SCALE_BUFFER = BufferType(
     'instance_shift_and_scale', instance_buffer=True)
 INSTANCE_MATRIX_BUFFER = BufferType(
     'instance_placement', instance_buffer=True)
+# Two bond end points and radius shared by the two half bond instances.
+INSTANCE_HALFBOND_CYLINDER_BUFFER = BufferType(
+    'instance_halfbond_cylinder', instance_buffer=True, instance_divisor=2)
 INSTANCE_COLOR_BUFFER = BufferType(
     'vcolor', instance_buffer=True, value_type=uint8, normalize=True,
     requires_capabilities=Render.SHADER_VERTEX_COLORS)
@@ -2661,6 +2671,7 @@ class Buffer:
         self.buffer_type = t.buffer_type
         self.normalize = t.normalize
         self.instance_buffer = t.instance_buffer
+        self.instance_divisor = t.instance_divisor
         self.requires_capabilities = t.requires_capabilities
 
         self._deleted_buffer = False
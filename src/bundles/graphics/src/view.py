@@ -55,6 +55,9 @@ class View:
         if trigger_set:
             self.drawing.set_redraw_callback(dm)
 
+        # Sum of supersampled images, kept when recording movie frames
+        self._supersample_sum = None
+
     def set_default_parameters(self):
         # Lights and material properties
         from .opengl import Lighting, Material, Silhouette
@@ -490,24 +493,25 @@ class View:
         # the on-screen sizes.  This is used for 2d label sizing.
         r.image_save = True
             
-        if supersample is None:
+        if not supersample:
             self.draw(c, drawings, swap_buffers = False)
             rgba = r.frame_buffer_image(w, h)
         else:
-            from numpy import zeros, float32, uint8
-            srgba = zeros((h, w, 4), float32)
+            srgba = self._supersample_sum_array(w, h)
+            from ._graphics import accumulate_images, average_images
             n = supersample
             s = 1.0 / n
             s0 = -0.5 + 0.5 * s
+            rgba = None
             for i in range(n):
                 for j in range(n):
                     c.set_fixed_pixel_shift((s0 + i * s, s0 + j * s))
                     self.draw(c, drawings, swap_buffers = False)
-                    srgba += r.frame_buffer_image(w, h)
+                    rgba = r.frame_buffer_image(w, h, rgba)
+                    accumulate_images(rgba, srgba)
             c.set_fixed_pixel_shift((0, 0))
-            srgba /= n * n
             # third index 0, 1, 2, 3 is r, g, b, a
-            rgba = srgba.astype(uint8)
+            average_images(srgba, n * n, rgba)
         r.pop_framebuffer()
         fb.delete()
 
@@ -515,6 +519,25 @@ class View:
 
         return rgba
 
+    def _supersample_sum_array(self, w, h):
+        # The float32 sum of supersampled images is 16 bytes per pixel, so
+        # it is only kept when images of the same size are made one after
+        # another, as when recording a movie, to avoid making one per frame.
+        ss = self._supersample_sum
+        if ss is not None and ss[0] == (w, h):
+            a = ss[1]
+            if a is None:
+                from numpy import zeros, float32
+                a = zeros((h, w, 4), float32)
+                self._supersample_sum = ((w, h), a)
+            else:
+                a.fill(0)
+        else:
+            from numpy import zeros, float32
+            a = zeros((h, w, 4), float32)
+            self._supersample_sum = ((w, h), None)
+        return a
+
     def frame_buffer_rgba(self):
         '''
         Return a numpy array of R, G, B, A values of the currently
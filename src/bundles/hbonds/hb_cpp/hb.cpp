@@ -0,0 +1,172 @@
+// vi: set expandtab ts=4 sw=4:
+
+/*
+ * === UCSF ChimeraX Copyright ===
+ * Copyright 2022 Regents of the University of California. All rights reserved.
+ * The ChimeraX application is provided pursuant to the ChimeraX license
+ * agreement, which covers academic and commercial uses. For more details, see
+ * <http://www.rbvi.ucsf.edu/chimerax/docs/licensing.html>
+ *
+ * This particular file is part of the ChimeraX library. You can also
+ * redistribute and/or modify it under the terms of the GNU Lesser General
+ * Public License version 2.1 as published by the Free Software Foundation.
+ * For more details, see
+ * <https://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESSED OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. ADDITIONAL LIABILITY
+ * LIMITATIONS ARE DESCRIBED IN THE GNU LESSER GENERAL PUBLIC LICENSE
+ * VERSION 2.1
+ *
+ * This notice must be embedded in or attached to all copies, including partial
+ * copies, of the software or any revisions or derivations thereof.
+ * === UCSF ChimeraX Copyright ===
+ */
+
+#include <Python.h>
+#include <algorithm>    // std::min, std::max, std::sort
+#include <atomic>
+#include <cmath>
+#include <unordered_map>
+#include <vector>
+
+#include <arrays/pythonarray.h>		// use parse_double_n3_array, ...
+#include <arrays/threadpool.h>		// use Thread_Pool::run
+
+// Uniform grid of cells holding point indices, for finding all points within
+// a distance of a query point without a tree walk per query.
+class Cell_List
+{
+    const double* _xyz;
+    double _cell_size;
+    std::unordered_map<int64_t, std::vector<int>> _cells;
+
+    int64_t _key(int64_t i, int64_t j, int64_t k) const {
+        return ((i & 0x1fffff) << 42) | ((j & 0x1fffff) << 21) | (k & 0x1fffff);
+    }
+    int64_t _index(double x) const { return (int64_t)std::floor(x / _cell_size); }
+public:
+    Cell_List(const double* xyz, int n, double cell_size): _xyz(xyz), _cell_size(cell_size) {
+        for (int a = 0; a < n; ++a) {
+            const double* p = xyz + 3*a;
+            _cells[_key(_index(p[0]), _index(p[1]), _index(p[2]))].push_back(a);
+        }
+    }
+    // indices of points within distance r of p, in increasing order
+    void  within(const double* p, double r, std::vector<int>& found) const {
+        found.clear();
+        if (_cells.empty())
+            return;
+        double r2 = r * r;
+        int64_t i0 = _index(p[0]-r), i1 = _index(p[0]+r);
+        int64_t j0 = _index(p[1]-r), j1 = _index(p[1]+r);
+        int64_t k0 = _index(p[2]-r), k1 = _index(p[2]+r);
+        for (int64_t i = i0; i <= i1; ++i)
+            for (int64_t j = j0; j <= j1; ++j)
+                for (int64_t k = k0; k <= k1; ++k) {
+                    auto ci = _cells.find(_key(i, j, k));
+                    if (ci == _cells.end())
+                        continue;
+                    for (auto a: ci->second) {
+                        const double* q = _xyz + 3*a;
+                        double dx = q[0]-p[0], dy = q[1]-p[1], dz = q[2]-p[2];
+                        if (dx*dx + dy*dy + dz*dz <= r2)
+                            found.push_back(a);
+                    }
+                }
+        std::sort(found.begin(), found.end());
+    }
+};
+
+static PyObject*
+donor_acceptor_pairs(PyObject*, PyObject* args)
+{
+    DArray donor_coords, donor_radii, acceptor_coords;
+    int num_threads = 1;
+    if (!PyArg_ParseTuple(args, const_cast<char *>("O&O&O&|i"),
+                   parse_double_n3_array, &donor_coords,
+                   parse_double_n_array, &donor_radii,
+                   parse_double_n3_array, &acceptor_coords,
+                   &num_threads))
+        return nullptr;
+    if (donor_coords.size(0) != donor_radii.size())
+        return PyErr_Format(PyExc_ValueError, "Number of donors (%d) differs from number of"
+            " donor distances (%d)", donor_coords.size(0), donor_radii.size());
+
+    DArray dc_contig = donor_coords.contiguous_array();
+    DArray dr_contig = donor_radii.contiguous_array();
+    DArray ac_contig = acceptor_coords.contiguous_array();
+    int num_donors = donor_coords.size(0), num_acceptors = acceptor_coords.size(0);
+    std::vector<std::vector<int>> donor_hits(num_donors);
+
+    Py_BEGIN_ALLOW_THREADS
+    const double *dxyz = dc_contig.values(), *dr = dr_contig.values(),
+        *axyz = ac_contig.values();
+    // cells about the size of a typical search radius keep the number of cells
+    // visited per donor small without many empty cells
+    double cell_size = 0;
+    for (int d = 0; d < num_donors; ++d)
+        cell_size = std::max(cell_size, dr[d]);
+    Cell_List cells(axyz, num_acceptors, cell_size > 0 ? cell_size : 1);
+
+    std::atomic<int> next(0);
+    Thread_Pool::run(Thread_Pool::thread_count(num_donors, 1, std::max(num_threads, 1)), [&](int) {
+        std::vector<int> found;
+        for (int d = next++; d < num_donors; d = next++) {
+            cells.within(dxyz + 3*d, dr[d], found);
+            donor_hits[d] = found;
+        }
+    });
+    Py_END_ALLOW_THREADS
+
+    int64_t num_pairs = 0;
+    for (auto& hits: donor_hits)
+        num_pairs += hits.size();
+    int* pairs;
+    PyObject* py_pairs = python_int_array(num_pairs, 2, &pairs);
+    if (py_pairs == nullptr)
+        return nullptr;
+    for (int d = 0; d < num_donors; ++d)
+        for (auto a: donor_hits[d]) {
+            *pairs++ = d;
+            *pairs++ = a;
+        }
+    return py_pairs;
+}
+
+static const char* docstr_donor_acceptor_pairs =
+"donor_acceptor_pairs(donor_coords, donor_distances, acceptor_coords, num_threads = 1)\n"
+"\n"
+"Find every acceptor within the corresponding donor distance of each donor\n"
+"using a cell list of the acceptor coordinates, with the donors divided among\n"
+"num_threads threads.  Returns an N by 2 int32 array of (donor index, acceptor\n"
+"index) pairs, ordered by donor and then acceptor index.";
+
+static struct PyMethodDef hbonds_methods[] =
+{
+  {const_cast<char*>("donor_acceptor_pairs"), donor_acceptor_pairs, METH_VARARGS,
+    docstr_donor_acceptor_pairs},
+  {nullptr, nullptr, 0, nullptr}
+};
+
+static struct PyModuleDef hbonds_def = {
+        PyModuleDef_HEAD_INIT,
+        "_hbonds",
+        "Find hydrogen bond donor/acceptor candidates",
+        -1,
+        hbonds_methods,
+        nullptr,
+        nullptr,
+        nullptr,
+        nullptr
+};
+
+// ----------------------------------------------------------------------------
+// Initialization routine called by python when module is dynamically loaded.
+//
+PyMODINIT_FUNC
+PyInit__hbonds()
+{
+    return PyModule_Create(&hbonds_def);
+}
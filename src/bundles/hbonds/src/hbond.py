@@ -27,7 +27,7 @@ verbose = False
 from .acceptor_geom import acc_syn_anti, acc_phi_psi, acc_theta_tau, acc_generic
 from .donor_geom import don_theta_tau, don_upsilon_tau, don_generic, don_water
 from .common_geom import ConnectivityError, AtomTypeError
-from chimerax.chem_group import find_group
+from chimerax.chem_group import find_groups
 from chimerax.geometry import distance_squared
 from .hydpos import hyd_positions
 from chimerax.atomic.idatm import type_info, tetrahedral, planar, linear, single
@@ -478,9 +478,16 @@ def find_hbonds(session, structures, *, inter_model=True, intra_model=True, dono
             'S': gen_don_S_params
         }
 
-        from chimerax.atom_search import AtomSearchTree
+        from ._hbonds import donor_acceptor_pairs
+        import numpy, os
+        num_threads = os.cpu_count() or 1
+        scene_coords = (Atom._hb_coord == Atom.scene_coord)
+        def hb_coords(atoms):
+            if not isinstance(atoms, Atoms):
+                atoms = Atoms(atoms)
+            return atoms.scene_coords if scene_coords else atoms.coords
         metal_coord = {}
-        acc_trees = {}
+        acc_info = {}
         hbonds = []
         has_sulfur = {}
         for structure in structures:
@@ -511,14 +518,14 @@ def find_hbonds(session, structures, *, inter_model=True, intra_model=True, dono
                 #xyz.append([c[0], c[1], c[2]])
                 if acc_atom.element == Element.get_element('S'):
                     has_sulfur[structure] = True
-            if status:
-                session.logger.status("Building search tree of acceptor atoms", blank_after=0)
-            acc_tree = acc_trees[structure] = AtomSearchTree(acc_atoms, data=acc_data, sep_val=3.0,
-                scene_coords=(Atom._hb_coord == Atom.scene_coord))
+            acc_coords = hb_coords(acc_atoms)
+            acc_info[structure] = (acc_atoms, acc_data, acc_coords)
             metals = structure.atoms.filter(structure.atoms.elements.is_metal)
-            for metal in metals:
-                for acc_atom, geom_func, args in acc_tree.search(metal._hb_coord, 4.0):
-                    metal_coord.setdefault(acc_atom, []).append(metal)
+            if metals:
+                metal_pairs = donor_acceptor_pairs(hb_coords(metals),
+                    numpy.full(len(metals), 4.0), acc_coords, num_threads)
+                for mi, ai in metal_pairs:
+                    metal_coord.setdefault(acc_atoms[ai], []).append(metals[mi])
 
         if process_key not in processed_donor_params:
             # find max donor distances before they get squared..
@@ -579,26 +586,39 @@ def find_hbonds(session, structures, *, inter_model=True, intra_model=True, dono
             if status:
                 session.logger.status("Matching donors in model '%s' to acceptors" % structure.name,
                     blank_after=0)
+            # find the acceptors within range of every donor at once; the pairs come back
+            # ordered by donor, so each donor's candidates are a slice between 'starts'
+            don_coords = hb_coords(don_atoms)
+            test_dists = numpy.array([data[3] for data in don_data], numpy.float64)
+            candidates = {}
+            for acc_structure in structures:
+                if acc_structure == structure and not intra_model or acc_structure != structure and not inter_model:
+                    continue
+                if not inter_submodel \
+                and acc_structure.id and structure.id \
+                and acc_structure.id[0] == structure.id[0] \
+                and acc_structure.id[:-1] == structure.id[:-1] \
+                and acc_structure.id[1:] != structure.id[1:]:
+                    continue
+                if has_sulfur[acc_structure]:
+                    from .common_geom import SULFUR_COMP
+                    tds = test_dists + SULFUR_COMP
+                else:
+                    tds = test_dists
+                acc_atoms, acc_data, acc_coords = acc_info[acc_structure]
+                pairs = donor_acceptor_pairs(don_coords, tds, acc_coords, num_threads)
+                starts = numpy.searchsorted(pairs[:,0], numpy.arange(len(don_atoms)+1))
+                candidates[acc_structure] = (acc_data, pairs[:,1], starts)
             for i in range(len(don_atoms)):
                 donor_atom = don_atoms[i]
                 geom_type, tau_sym, arg_list, test_dist = don_data[i]
-                donor_hyds = hyd_positions(donor_atom)
-                coord = donor_atom._hb_coord
-                for acc_structure in structures:
-                    if acc_structure == structure and not intra_model or acc_structure != structure and not inter_model:
-                        continue
-                    if not inter_submodel \
-                    and acc_structure.id and structure.id \
-                    and acc_structure.id[0] == structure.id[0] \
-                    and acc_structure.id[:-1] == structure.id[:-1] \
-                    and acc_structure.id[1:] != structure.id[1:]:
+                donor_hyds = None
+                for acc_structure, (acc_data, acc_indices, starts) in candidates.items():
+                    if starts[i] == starts[i+1]:
                         continue
-                    if has_sulfur[acc_structure]:
-                        from .common_geom import SULFUR_COMP
-                        td = test_dist + SULFUR_COMP
-                    else:
-                        td = test_dist
-                    accs = acc_trees[acc_structure].search(coord, td)
+                    accs = [acc_data[ai] for ai in acc_indices[starts[i]:starts[i+1]]]
+                    if donor_hyds is None:
+                        donor_hyds = hyd_positions(donor_atom)
                     if verbose:
                         session.logger.info("Found %d possible acceptors for donor %s:"
                             % (len(accs), donor_atom))
@@ -765,9 +785,9 @@ def _find_acceptors(structure, a_params, limited_acceptors, generic_acc_info):
     acc_atoms = []
     acc_data = []
     std_acceptors = {}
-    for ap in a_params:
+    all_groups = find_groups([ap[0] for ap in a_params], [structure])
+    for ap, groups in zip(a_params, all_groups):
         group_key, acc_indices, geom_func, arg_list = ap
-        groups = find_group(group_key, [structure])
         for group in groups:
             for i in range(len(acc_indices)):
                 acc_atom = group[acc_indices[i]]
@@ -868,11 +888,12 @@ def _find_donors(structure, d_params, limited_donors, generic_don_info):
     don_atoms = []
     don_data = []
     std_donors = {}
+    keyed_groups = iter(find_groups([dp[0] for dp in d_params if dp[0]], [structure]))
     for dp in d_params:
         group_key, donorIndex, geom_type, tau_sym, arg_list, test_dist = dp
 
         if group_key:
-            groups = find_group(group_key, [structure])
+            groups = next(keyed_groups)
         else:
             # generic donors
             groups = []
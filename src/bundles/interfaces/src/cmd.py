@@ -251,80 +251,53 @@ def short_chain_names(names):
     return sn
 
 def buried_areas(sphere_groups, probe_radius, min_area = 1):
-    # Multi-threaded calculation of all pairwise buried areas.
-    s = [(g, g.radii + probe_radius) for g in sphere_groups]
-    s.sort(key = lambda v: len(v[1]), reverse = True)   # Biggest first for threading.
-    
-    # Compute area of each atom set.
-    from chimerax.surface import spheres_surface_area
-    from chimerax.core.threadq import apply_to_list
-    def area(g, r):
-        g.area = spheres_surface_area(g.centers,r).sum()
-    apply_to_list(area, s)
-
-    # Optimize buried area calculations using bounds of each atom set.
-    naxes = 64
-    from chimerax.geometry.sphere import sphere_points
-    axes = sphere_points(naxes)
-    from chimerax.geometry import sphere_axes_bounds
-    bounds = [sphere_axes_bounds(g.centers, r, axes) for g, r in s]
-
-    # Compute buried areas between all pairs.
+    # Compute areas of all chains and all pairwise buried areas in one
+    # multi-threaded calculation that only recomputes areas of spheres
+    # touching another chain.
+    n = len(sphere_groups)
+    if n == 0:
+        return []
+    from numpy import concatenate, repeat, arange, int32
+    centers = concatenate([g.centers for g in sphere_groups])
+    radii = concatenate([g.radii for g in sphere_groups]) + probe_radius
+    sizes = [len(g.centers) for g in sphere_groups]
+    groups = repeat(arange(n, dtype = int32), sizes)
+    from chimerax.surface import buried_areas_of_sphere_groups
+    areas, bsphere, bgroup, barea = buried_areas_of_sphere_groups(centers, radii, groups)
+
+    # Index of first sphere of each group.
+    offsets = concatenate(((0,), sizes)).cumsum()
+    for gi, g in enumerate(sphere_groups):
+        g.area = areas[offsets[gi]:offsets[gi+1]].sum()
+
+    # Burials are ordered by sphere so group by (sphere group, other group).
+    from collections import defaultdict
+    burials = defaultdict(list)
+    sgroup = groups[bsphere]
+    for b, (gi, gj) in enumerate(zip(sgroup, bgroup)):
+        burials[(gi, gj)].append(b)
+
+    from numpy import array
     buried = []
-    n = len(s)
-    pairs = []
-    from chimerax.geometry import bounds_overlap
-    for i in range(n):
-        for j in range(i+1,n):
-            if bounds_overlap(bounds[i], bounds[j], 0):
-                pairs.append((i,j))
-
-    # Do multi-threaded buried area calculation.
-    def barea(i, j, s = s, bounds = bounds, axes = axes, probe_radius = probe_radius):
-        g1, r1 = s[i]
-        g2, r2 = s[j]
-        c = optimized_buried_area(g1.centers, r1, bounds[i], g2.centers, r2, bounds[j],
-                                   axes, probe_radius)
-        if c:
-            c.group1, c.group2 = g1, g2
-        return c
-    bareas = apply_to_list(barea, pairs)
-
-    # Apply minimum area threshold.
-    buried = [c for c in bareas if c and c.buried_area >= min_area]
-
-    # Sort to get predictable order since multithreaded calculation gives unpredictable ordering.
+    pairs = set((min(gi,gj), max(gi,gj)) for gi, gj in burials.keys())
+    for gi, gj in sorted(pairs):
+        b1 = array(burials.get((gi,gj), []), int32)
+        b2 = array(burials.get((gj,gi), []), int32)
+        ba = 0.5 * (barea[b1].sum() + barea[b2].sum())
+        if ba < min_area:
+            continue
+        s1, s2 = bsphere[b1], bsphere[b2]
+        a1, a2 = areas[s1], areas[s2]
+        a12 = concatenate((a1 - barea[b1], a2 - barea[b2]))
+        c = Contact(ba, a1, a2, a12, s1 - offsets[gi], s2 - offsets[gj])
+        c.group1, c.group2 = sphere_groups[gi], sphere_groups[gj]
+        buried.append(c)
+
+    # Sort to get predictable order.
     buried.sort(key = lambda c: c.buried_area, reverse = True)
 
     return buried
 
-# Consider only spheres in each set overlapping bounds of other set.
-def optimized_buried_area(xyz1, r1, b1, xyz2, r2, b2, axes, probe_radius):
-
-    # Check for no contact using bounding planes.
-    # And find subsets of spheres that may be in contact to speed up area calculation.
-    from chimerax.geometry import spheres_in_bounds
-    i1 = spheres_in_bounds(xyz1, r1, axes, b2, 0)
-    i2 = spheres_in_bounds(xyz2, r2, axes, b1, 0)
-    if len(i1) == 0 or len(i2) == 0:
-        return None
-
-    # Compute areas for spheres near contact interface.
-    xyz1, r1 = xyz1[i1], r1[i1]
-    from chimerax.surface import spheres_surface_area
-    a1 = spheres_surface_area(xyz1, r1)
-    xyz2, r2 = xyz2[i2], r2[i2]
-    a2 = spheres_surface_area(xyz2, r2)
-
-    # Compute exposed areas for combined spheres.
-    from numpy import concatenate
-    xyz12, r12 = concatenate((xyz1,xyz2)), concatenate((r1,r2))
-    a12 = spheres_surface_area(xyz12, r12)
-
-    ba = 0.5 * (a1.sum() + a2.sum() - a12.sum())
-    c = Contact(ba, a1, a2, a12, i1, i2)
-    return c
-
 from .graph import Edge
 class Contact(Edge):
     def __init__(self, buried_area, area1, area2, area12, i1, i2):
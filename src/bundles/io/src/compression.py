@@ -59,6 +59,8 @@ def handle_compression(name, path, **kw):
     # since these return the fileno of the compressed file, mark them as compression
     # streams so that the PDB reader knows not to try to use the fileno!
     stream.from_compressed_source = True
+    # and give the path so that readers can decompress it themselves
+    stream.compressed_path = path
     return stream
 
 def remove_compression_suffix(file_name):
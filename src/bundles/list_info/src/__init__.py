@@ -38,6 +38,9 @@ class _InfoAPI(BundleAPI):
         register("info bounds",
                  cmd.info_bounds_desc,
                  cmd.info_bounds, logger=logger)
+        register("info memory",
+                 cmd.info_memory_desc,
+                 cmd.info_memory, logger=logger)
         register("info models",
                  cmd.info_models_desc,
                  cmd.info_models, logger=logger)
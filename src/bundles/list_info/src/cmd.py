@@ -141,6 +141,43 @@ info_bounds_desc = CmdDesc(optional=[('models', ModelsArg)],
                            synopsis='Report scene bounding boxes for models')
 
 
+def info_memory(session, models=None, *, return_json=False, save_file=None):
+    '''
+    Report approximate memory used by models, by category.  Structures report the
+    C++ data for atoms, bonds, residues, coordinate sets, alternate locations, rings,
+    chains, pseudobonds and caches, maps report their in-memory data, and all models
+    report graphics arrays.  Sizes include space reserved for growth.
+
+    :param models: A list of models, default all models
+
+    If :code:`return_json` is :code:`True`, the returned JSON will be an object with
+    model atom specifiers as names and values that are objects mapping category
+    to number of bytes.
+    '''
+    if models is None:
+        models = session.models.list()
+    from .util import memory_usage, bytes_description
+    usage = {}
+    lines = []
+    total = 0
+    for m in sorted(models, key = lambda m: m.id):
+        musage = usage[m.atomspec] = memory_usage(m)
+        mtotal = sum(musage.values())
+        total += mtotal
+        cats = ', '.join('%s %s' % (cat, bytes_description(nbytes))
+                         for cat, nbytes in sorted(musage.items(), key = lambda cn: -cn[1]) if nbytes)
+        lines.append('#%s, %s, %s: %s' % (m.id_string, m.name, bytes_description(mtotal), cats))
+    lines.append('%d models, total %s' % (len(models), bytes_description(total)))
+    output(session.logger, save_file, '\n'.join(lines))
+    if return_json:
+        from chimerax.core.commands import JSONResult, ArrayJSONEncoder
+        return JSONResult(ArrayJSONEncoder().encode(usage), None)
+
+info_memory_desc = CmdDesc(optional=[('models', ModelsArg)],
+                           keyword=[('save_file', SaveFileNameArg)],
+                           synopsis='Report memory used by models')
+
+
 def info_models(session, atoms=None, type_=None, attribute="name", *, return_json=False, save_file=None):
     '''
     If 'return_json' is True, the returned JSON will be a list of JSON objects, one per model.  Each object
@@ -347,6 +347,35 @@ from chimerax.core.tasks import Task
 from contextlib import contextmanager
 
 @contextmanager
+def memory_usage(m):
+    '''Dictionary of approximate bytes used by a model by category, from the model's
+       memory_usage() method if it has one, plus "graphics" for the geometry, color and
+       instance arrays of the model and its child drawings that are not models.'''
+    usage = m.memory_usage() if hasattr(m, 'memory_usage') else {}
+    usage['graphics'] = _graphics_bytes(m)
+    return usage
+
+def _graphics_bytes(d):
+    from chimerax.core.models import Model
+    nbytes = 0
+    for a in (d.vertices, d.normals, d.triangles, d.vertex_colors, d.texture_coordinates):
+        if a is not None:
+            nbytes += a.nbytes
+    npos = len(d.positions)
+    if npos > 1:
+        nbytes += npos * (12 * 8 + 4)	# 3 by 4 float64 matrix and rgba8 color per instance
+    for c in d.child_drawings():
+        if not isinstance(c, Model):
+            nbytes += _graphics_bytes(c)
+    return nbytes
+
+def bytes_description(nbytes):
+    for unit in ('bytes', 'Kbytes', 'Mbytes'):
+        if nbytes < 1024:
+            return '%.4g %s' % (nbytes, unit)
+        nbytes /= 1024
+    return '%.4g Gbytes' % nbytes
+
 def closing(thing):
     try:
         yield thing
@@ -28,6 +28,7 @@
 // Triangulate plane intersection with a box.
 //
 #include <Python.h>			// use PyObject
+#include <math.h>			// use floor(), ceil()
 
 #include <arrays/pythonarray.h>		// use array_from_python()
 #include <arrays/rcarray.h>		// Numeric_Array
@@ -377,8 +378,24 @@ static void box_cuts(const float *corners, const float *axis,
 {
   float cdepths[8];
   corner_depths(corners, axis, cdepths);
+
+  // Only planes between the minimum and maximum corner depths cut the box.
+  int i_begin = 0, i_end = num_cuts;
+  if (spacing > 0)
+    {
+      float dmin = cdepths[0], dmax = cdepths[0];
+      for (int c = 1 ; c < 8 ; ++c)
+	{
+	  if (cdepths[c] < dmin) dmin = cdepths[c];
+	  if (cdepths[c] > dmax) dmax = cdepths[c];
+	}
+      double ib = floor((dmin - offset) / spacing), ie = ceil((dmax - offset) / spacing) + 1;
+      if (ib > i_begin) i_begin = (ib < num_cuts ? static_cast<int>(ib) : num_cuts);
+      if (ie < i_end) i_end = (ie > i_begin ? static_cast<int>(ie) : i_begin);
+    }
+
   int ntri = 0, nvert = 0;
-  for (int i = 0 ; i < num_cuts ; ++i)
+  for (int i = i_begin ; i < i_end ; ++i)
     {
       float depth = offset + i*spacing;
       int n = box_cut(corners, cdepths, depth, nvert,
@@ -393,6 +410,21 @@ static void box_cuts(const float *corners, const float *axis,
   *nv = nvert;
 }
 
+// -----------------------------------------------------------------------------
+// Apply a 3 by 4 transform to vertices to get texture coordinates.
+//
+static void texture_coordinates(const float *vertices, int nv, float tf[3][4],
+				float *texcoords)
+{
+  for (int v = 0 ; v < nv ; ++v)
+    {
+      const float *x = vertices + 3*v;
+      float *t = texcoords + 3*v;
+      for (int a = 0 ; a < 3 ; ++a)
+	t[a] = tf[a][0]*x[0] + tf[a][1]*x[1] + tf[a][2]*x[2] + tf[a][3];
+    }
+}
+
 // -----------------------------------------------------------------------------
 //
 static void offset_range(const float *corners, const float *axis,
@@ -446,15 +478,22 @@ box_cuts(PyObject *, PyObject *args, PyObject *keywds)
   IArray triangles;
   float axis[3], offset, spacing;
   int num_cuts;
+  PyObject *texture_transform = NULL;
   const char *kwlist[] = {"corners", "axis", "offset", "spacing", "num_cuts",
-                          "vertices", "triangles", NULL};
-  if (!PyArg_ParseTupleAndKeywords(args, keywds, const_cast<char *>("O&O&ffi|O&O&"),
+                          "vertices", "triangles", "texture_transform", NULL};
+  if (!PyArg_ParseTupleAndKeywords(args, keywds, const_cast<char *>("O&O&ffi|O&O&$O"),
 				   (char **)kwlist,
 				   parse_float_n3_array, &carray,
 				   parse_float_3_array, &axis[0],
                                    &offset, &spacing, &num_cuts,
                                    parse_writable_float_n3_array, &vertices,
-                                   parse_writable_int_n3_array, &triangles))
+                                   parse_writable_int_n3_array, &triangles,
+				   &texture_transform))
+    return NULL;
+
+  float tex_tf[3][4];
+  bool texcoords = (texture_transform != NULL && texture_transform != Py_None);
+  if (texcoords && !parse_float_3x4_array(texture_transform, &tex_tf[0][0]))
     return NULL;
 
   if (carray.size(0) != 8)
@@ -493,6 +532,16 @@ box_cuts(PyObject *, PyObject *args, PyObject *keywds)
   int nv, nt;
   box_cuts(corners.values(), axis, offset, spacing, num_cuts, va, &nv, ta, &nt);
 
+  // Compute texture coordinates in the same pass to avoid a separate
+  // Python transform of the vertices for each view direction.
+  PyObject *tc = NULL;
+  if (texcoords)
+    {
+      float *tca;
+      tc = python_float_array(nv, 3, &tca);
+      texture_coordinates(va, nv, tex_tf, tca);
+    }
+
   // Return vertex array with correct size.
   PyObject *v;
   if (alloc_vertices)
@@ -519,5 +568,8 @@ box_cuts(PyObject *, PyObject *args, PyObject *keywds)
       t = resized_2d_array(tpy, nt, 3);
     }
 
+  if (tc)
+    return python_tuple(v, t, tc);
+
   return python_tuple(v, t);
 }
@@ -19,7 +19,10 @@ extern "C"
 // Returned vertex array must be at least size 7*3*num_cuts and
 // triangle array must be at least size 6*3*num_cuts.
 // Returns correctly sized vertex and triangle arrays that share memory
-// with input vertex and triangle arrays if provided.
+// with input vertex and triangle arrays if provided.  If a 3 by 4
+// texture_transform is given then texture coordinates, the transformed
+// vertices, are also returned.  Only planes that can intersect the box
+// are triangulated.
 //
 // void box_cuts(const float corners[8][3], const float axis[3],
 //               float offset, float spacing, int num_cuts,
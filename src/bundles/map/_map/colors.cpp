@@ -77,7 +77,9 @@ copy_la_to_rgba(PyObject *, PyObject *args, PyObject *keywds)
 		   la.size(0), rgba.size(0));
       return NULL;
     }
+  Py_BEGIN_ALLOW_THREADS
   copy_la_to_rgba(la, color, rgba);
+  Py_END_ALLOW_THREADS
 
   return python_none();
 }
@@ -124,7 +126,9 @@ blend_la_to_rgba(PyObject *, PyObject *args, PyObject *keywds)
 		   la.size(0), rgba.size(0));
       return NULL;
     }
+  Py_BEGIN_ALLOW_THREADS
   blend_la_to_rgba(la, color, rgba);
+  Py_END_ALLOW_THREADS
 
   return python_none();
 }
@@ -169,7 +173,9 @@ copy_l_to_rgba(PyObject *, PyObject *args, PyObject *keywds)
 		   l.size(0), rgba.size(0));
       return NULL;
     }
+  Py_BEGIN_ALLOW_THREADS
   copy_l_to_rgba(l, color, rgba);
+  Py_END_ALLOW_THREADS
 
   return python_none();
 }
@@ -216,7 +222,9 @@ blend_l_to_rgba(PyObject *, PyObject *args, PyObject *keywds)
 		   l.size(0), rgba.size(0));
       return NULL;
     }
+  Py_BEGIN_ALLOW_THREADS
   blend_l_to_rgba(l, color, rgba);
+  Py_END_ALLOW_THREADS
 
   return python_none();
 }
@@ -260,7 +268,9 @@ blend_rgb_to_rgba(PyObject *, PyObject *args, PyObject *keywds)
 		   rgb.size(0), rgba.size(0));
       return NULL;
     }
+  Py_BEGIN_ALLOW_THREADS
   blend_rgb_to_rgba(rgb, rgba);
+  Py_END_ALLOW_THREADS
 
   return python_none();
 }
@@ -303,7 +313,9 @@ blend_rgba(PyObject *, PyObject *args, PyObject *keywds)
 		   rgba1.size(0), rgba2.size(0));
       return NULL;
     }
+  Py_BEGIN_ALLOW_THREADS
   blend_rgba(rgba1, rgba2);
+  Py_END_ALLOW_THREADS
 
   return python_none();
 }
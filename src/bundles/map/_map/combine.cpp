@@ -29,21 +29,64 @@
 //
 #include <Python.h>			// use PyObject
 
+#include <algorithm>			// use std::max
+
 #include <arrays/pythonarray.h>		// use array_from_python()
 #include <arrays/rcarray.h>		// use Numeric_Array, Array<T>
+#include <arrays/threadpool.h>		// use Thread_Pool::run()
+
+// ----------------------------------------------------------------------------
+// Arrays smaller than this are combined in one thread since starting work on
+// other threads costs about as much as combining a few hundred thousand values.
+//
+const int64_t MIN_THREAD_ELEMENTS = 1 << 18;
+
+// ----------------------------------------------------------------------------
+// Simple loop with no branches so the compiler can vectorize it.  The result
+// can be the same array as v1 or v2 to combine in place.
+//
+template<class T, class S>
+static void lin_combine_range(float f1, const T *v1, float f2, const S *v2, T *v,
+			      int64_t k0, int64_t k1)
+{
+  for (int64_t k = k0 ; k < k1 ; ++k)
+    v[k] = static_cast<T>(f1*v1[k]+f2*v2[k]);
+}
+
+// ----------------------------------------------------------------------------
+// Second array can have a different value type than the first array and
+// result, for example adding interpolated float values to an integer map
+// without making a converted copy.
+//
+template<class T>
+class Lin_Combine
+{
+public:
+  template<class S>
+  static void combine(float f1, const Reference_Counted_Array::Array<T> &m1,
+		      float f2, const Reference_Counted_Array::Array<S> &m2,
+		      const Reference_Counted_Array::Array<T> &m, int threads)
+  {
+    int64_t n = m.size();
+    const T *v1 = m1.values();
+    const S *v2 = m2.values();
+    T *v = m.values();
+    int64_t nt = Thread_Pool::thread_count(n, MIN_THREAD_ELEMENTS, std::max(threads, 1));
+    Thread_Pool::run(nt, [=](int t) {
+	lin_combine_range(f1, v1, f2, v2, v, (t*n)/nt, ((t+1)*n)/nt);
+      });
+  }
+};
 
 // ----------------------------------------------------------------------------
 //
 template<class T>
 static void lin_combine(float f1, const Reference_Counted_Array::Array<T> &m1,
-			float f2, const Reference_Counted_Array::Array<T> &m2,
-			const Reference_Counted_Array::Array<T> &m)
-			   
+			float f2, const Reference_Counted_Array::Numeric_Array &m2,
+			const Reference_Counted_Array::Array<T> &m, int threads)
 {
-  int64_t n = m.size();
-  T *v1 = m1.values(), *v2 = m2.values(), *v = m.values();
-  for (int64_t k = 0 ; k < n ; ++k)
-	 v[k] = static_cast<T>(f1*v1[k]+f2*v2[k]);
+  call_template_function(Lin_Combine<T>::template combine, m2.value_type(),
+			 (f1, m1, f2, m2, m, threads));
 }
 
 // ----------------------------------------------------------------------------
@@ -53,11 +96,12 @@ extern "C" PyObject *linear_combination(PyObject *, PyObject *args, PyObject *ke
 {
   Reference_Counted_Array::Numeric_Array m1, m2, m;
   float f1, f2;
-  const char *kwlist[] = {"f1", "m1", "f2", "m2", "result", NULL};
+  int threads = 1;
+  const char *kwlist[] = {"f1", "m1", "f2", "m2", "result", "threads", NULL};
   if (!PyArg_ParseTupleAndKeywords(args, keywds,
-				   const_cast<char *>("fO&fO&O&"), (char **)kwlist,
+				   const_cast<char *>("fO&fO&O&|i"), (char **)kwlist,
 				   &f1, parse_3d_array, &m1, &f2, parse_3d_array, &m2,
-				   parse_3d_array, &m))
+				   parse_writable_3d_array, &m, &threads))
     return NULL;
 
   if (!m1.is_contiguous() || !m2.is_contiguous() || !m.is_contiguous())
@@ -66,14 +110,22 @@ extern "C" PyObject *linear_combination(PyObject *, PyObject *args, PyObject *ke
 		      "linear_combination: arrays must be contiguous");
       return NULL;
     }
-  if (m1.value_type() != m.value_type() || m2.value_type() != m.value_type())
+  if (m1.value_type() != m.value_type())
+    {
+      PyErr_SetString(PyExc_TypeError,
+		      "linear_combination: first array and result must have same value type");
+      return NULL;
+    }
+  if (m1.size() != m.size() || m2.size() != m.size())
     {
       PyErr_SetString(PyExc_TypeError,
-		      "linear_combination: arrays must have same value type");
+		      "linear_combination: arrays must have same size");
       return NULL;
     }
 
-  call_template_function(lin_combine, m.value_type(), (f1, m1, f2, m2, m));
+  Py_BEGIN_ALLOW_THREADS
+  call_template_function(lin_combine, m.value_type(), (f1, m1, f2, m2, m, threads));
+  Py_END_ALLOW_THREADS
 
   return python_none();
 }
@@ -35,8 +35,10 @@
 extern "C"
 {
 
-// m = f1*m1 + f2*m2.  Requires 3-d contiguous arrays of same type.
-// void linear_combination(float f1, PyObject *m1, float f2, PyObject *m2, PyObject *m);
+// m = f1*m1 + f2*m2.  Requires 3-d contiguous arrays with m1 and m of same
+// type.  The result m can be m1 or m2 to combine in place.
+// void linear_combination(float f1, PyObject *m1, float f2, PyObject *m2, PyObject *m,
+//                         int threads = 1);
 PyObject *linear_combination(PyObject *s, PyObject *args, PyObject *keywds);
 
 }
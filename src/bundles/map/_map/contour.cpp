@@ -29,7 +29,11 @@
 // Uses the marching cubes algorithm.
 //
 #include <math.h>		// use sqrt()
+#include <algorithm>		// use std::max
+#include <new>			// use std::bad_alloc
+#include <vector>		// use std::vector
 
+#include <arrays/threadpool.h>	// use Thread_Pool::run()
 #include "contourdata.h"	// use cube_edges, triangle_table
 
 namespace Contour_Calculation
@@ -62,7 +66,8 @@ public:
       if (ae == bsize || alsize == 0) next_block();
       a[ae++] = e;
     }
-  void array(T *carray);  // Contiguous array.
+  // Contiguous array, optionally freeing blocks as they are copied.
+  void array(T *carray, BIndex start = 0, bool release = false);
   void reset() // Does not deallocate memory.
     { ae = anxt = afsize = 0; a = (alist ? alist[0] : a); }
 private:
@@ -75,6 +80,7 @@ private:
   T *a;		// last block in use.
   T **alist;	// pointers to allocated blocks.
   void next_block();
+  void free_blocks();
 };
 
 // ----------------------------------------------------------------------------
@@ -90,10 +96,20 @@ template <class T> Block_Array<T>::Block_Array(BIndex block_size)
 // ----------------------------------------------------------------------------
 //
   template <class T> Block_Array<T>::~Block_Array()
+{
+  free_blocks();
+}
+
+// ----------------------------------------------------------------------------
+//
+template <class T> void Block_Array<T>::free_blocks()
 {
   for (BIndex k = 0 ; k < ale ; ++k)
     delete [] alist[k];
   delete [] alist;
+  this->ae = this->anxt = this->ale = this->alsize = this->afsize = 0;
+  this->a = NULL;
+  this->alist = NULL;
 }
 
 // ----------------------------------------------------------------------------
@@ -125,17 +141,30 @@ template <class T> void Block_Array<T>::next_block()
 
 // ----------------------------------------------------------------------------
 //
-template <class T> void Block_Array<T>::array(T *carray)
+// Copy elements starting at index start to a contiguous array.  If release
+// is true each block is freed after it is copied so peak memory use is not
+// doubled, and the array is empty afterwards.
+//
+template <class T> void Block_Array<T>::array(T *carray, BIndex start, bool release)
 {
   BIndex k = 0;
   for (BIndex i = 0 ; i+1 < anxt ; ++i)
 	{
 	  T *b = alist[i];
 	  for (BIndex j = 0 ; j < bsize ; ++j, ++k)
-	    carray[k] = b[j];
+	    if (k >= start)
+	      carray[k-start] = b[j];
+	  if (release)
+	    {
+	      delete [] b;
+	      alist[i] = NULL;
+	    }
 	}
   for (BIndex j = 0 ; j < ae ; ++j, ++k)
-    carray[k] = a[j];
+    if (k >= start)
+      carray[k-start] = a[j];
+  if (release)
+    free_blocks();
 }
 
 // ----------------------------------------------------------------------------
@@ -244,28 +273,167 @@ private:
   }
 };
 
+// ----------------------------------------------------------------------------
+//
+inline AIndex block_count(AIndex size, AIndex block_size)
+  { return (size + block_size - 1) / block_size; }
+
+// ----------------------------------------------------------------------------
+// Compute minimum and maximum grid values for cubic blocks of grid points
+// used to skip regions that cannot contain the surface.  Block (b0,b1,b2)
+// contains points b*block_size <= k < (b+1)*block_size along each axis and
+// its bounds include the adjacent grid points one step outside the block so
+// that all edges from points in the block are covered.  The min_max array
+// has size 2*n0*n1*n2 where nk is the number of blocks along axis k, with
+// the minimum and maximum for block (b0,b1,b2) at index 2*(b0+n0*(b1+n1*b2)).
+// If a block contains a NaN value its min and max are set to NaN so it is
+// never skipped.
+//
+template <class Data_Type>
+void block_bounds(const Data_Type *grid, const AIndex size[3],
+		  const GIndex stride[3], AIndex block_size, Data_Type *min_max)
+{
+  AIndex nb0 = block_count(size[0], block_size),
+    nb1 = block_count(size[1], block_size),
+    nb2 = block_count(size[2], block_size);
+  Data_Type *mm = min_max;
+  for (AIndex b2 = 0 ; b2 < nb2 ; ++b2)
+    for (AIndex b1 = 0 ; b1 < nb1 ; ++b1)
+      for (AIndex b0 = 0 ; b0 < nb0 ; ++b0, mm += 2)
+	{
+	  AIndex b[3] = {b0, b1, b2}, kmin[3], kmax[3];
+	  for (int a = 0 ; a < 3 ; ++a)
+	    {
+	      AIndex k = b[a]*block_size;
+	      kmin[a] = (k > 0 ? k-1 : 0);
+	      kmax[a] = (k + block_size + 1 < size[a] ? k + block_size + 1 : size[a]);
+	    }
+	  Data_Type vmin = grid[stride[0]*(GIndex)kmin[0] + stride[1]*(GIndex)kmin[1]
+				+ stride[2]*(GIndex)kmin[2]];
+	  Data_Type vmax = vmin;
+	  for (AIndex k2 = kmin[2] ; k2 < kmax[2] ; ++k2)
+	    for (AIndex k1 = kmin[1] ; k1 < kmax[1] ; ++k1)
+	      {
+		const Data_Type *g = grid + stride[2]*(GIndex)k2 + stride[1]*(GIndex)k1;
+		for (AIndex k0 = kmin[0] ; k0 < kmax[0] ; ++k0)
+		  {
+		    Data_Type v = g[stride[0]*(GIndex)k0];
+		    if (v < vmin)
+		      vmin = v;
+		    else if (v > vmax)
+		      vmax = v;
+		    else if (v != v)
+		      vmin = vmax = v;	// NaN
+		  }
+	      }
+	  mm[0] = vmin;
+	  mm[1] = vmax;
+	}
+}
+
+// ----------------------------------------------------------------------------
+// Normal at a surface vertex is the negative of symmetric difference data
+// gradient.
+//
+template <class Data_Type>
+void grid_normal(const Data_Type *grid, const AIndex size[3], const GIndex stride[3],
+		 const float x[3], float *normal)
+{
+  float g[3];
+  for (int a = 0 ; a < 3 ; ++a)
+    g[a] = (x[a] == 0 ? 1 : (x[a] == size[a]-1 ? -1 : 0));
+  if (g[0] == 0 && g[1] == 0 && g[2] == 0)
+    {
+      AIndex i[3] = {(AIndex)x[0], (AIndex)x[1], (AIndex)x[2]};
+      const Data_Type *ga = grid + stride[0]*(GIndex)i[0]+stride[1]*(GIndex)i[1]+stride[2]*(GIndex)i[2];
+      const Data_Type *gb = ga;
+      AIndex off[3] = {0,0,0};
+      float fb = 0;
+      for (int a = 0 ; a < 3 ; ++a)
+	if ((fb = x[a]-i[a]) > 0) { off[a] = 1; gb = ga + stride[a]; break; }
+      float fa = 1-fb;
+      for (int a = 0 ; a < 3 ; ++a)
+	{
+	  GIndex s = stride[a];
+	  AIndex ia = i[a], ib = ia + off[a];
+	  g[a] = (fa*(ia == 0 ?
+		      2*((float)ga[s]-ga[0]) : (float)ga[s]-*(ga-s))
+		  + fb*(ib == 0 ? 2*((float)gb[s]-gb[0]) :
+			ib == size[a]-1 ? 2*((float)gb[0]-*(gb-s))
+			: (float)gb[s]-*(gb-s)));
+	}
+      float norm = sqrt(g[0]*g[0] + g[1]*g[1] + g[2]*g[2]);
+      if (norm > 0)
+	{ g[0] /= norm; g[1] /= norm; g[2] /= norm;}
+    }
+  normal[0] = -g[0]; normal[1] = -g[1]; normal[2] = -g[2];
+}
+
 // ----------------------------------------------------------------------------
 //
 template <class Data_Type>
 class CSurface : public Contour_Surface
 {
 public:
+  // Only z planes k2_begin <= k2 < k2_end are contoured.  If k2_begin > 0
+  // the preceding plane is also processed to get the same cell and vertex
+  // ordering as when contouring the full grid, and the vertices for that
+  // plane are counted as ghost vertices.  This allows contouring z slabs
+  // in parallel and joining them to give output identical to contouring
+  // the full grid.
+  //
+  // If bounds is not NULL it gives minimum and maximum values for blocks of
+  // grid points as computed by block_bounds() and blocks that cannot
+  // contain the surface are skipped.
+  //
+  // The surface is calculated by compute_surfaces().
   CSurface(const Data_Type *grid, const AIndex size[3], const GIndex stride[3],
-	   float threshold, bool cap_faces, BIndex block_size)
+	   float threshold, bool cap_faces, BIndex block_size,
+	   AIndex k2_begin, AIndex k2_end,
+	   const Data_Type *bounds = NULL, AIndex bounds_block_size = 0)
     : grid(grid), threshold(threshold), cap_faces(cap_faces),
+      k2_begin(k2_begin), k2_end(k2_end), ghost_vertices(0),
+      bounds(bounds), bsize(bounds_block_size), gcp0(NULL), gcp1(NULL),
       vxyz(3*block_size), tvi(3*block_size)
     {
       for (int a = 0 ; a < 3 ; ++a)
-	{ this->size[a] = size[a]; this->stride[a] = stride[a]; }
-      compute_surface();
+	{
+	  this->size[a] = size[a]; this->stride[a] = stride[a];
+	  this->bcount[a] = (bounds ? block_count(size[a], bsize) : 0);
+	}
     }
-  virtual ~CSurface() {}
+  virtual ~CSurface() { end_planes(); }
 
   virtual VIndex vertex_count() { return vxyz.size()/3; }
   virtual TIndex triangle_count() { return tvi.size()/3; }
   virtual void geometry(float *vertex_xyz, VIndex *triangle_vertex_indices)
     { vxyz.array(vertex_xyz); tvi.array(triangle_vertex_indices); }
-  virtual void normals(float *normals);
+  virtual void normals(float *normals) { normals_from(0, normals); }
+  virtual void plane_ends(VIndex *vertex_ends, TIndex *triangle_ends)
+    { shifted_plane_ends(vertex_ends, triangle_ends, 0, 0); }
+  virtual void take_geometry(float *vertex_xyz, VIndex *triangle_vertex_indices,
+			     float *normals)
+    {
+      if (normals)
+	normals_from(0, normals);
+      non_ghost_geometry(vertex_xyz, triangle_vertex_indices, 0, true);
+    }
+
+  VIndex ghost_vertex_count() { return ghost_vertices; }
+  void non_ghost_geometry(float *vertex_xyz, VIndex *triangle_vertex_indices,
+			  VIndex voffset, bool release = false);
+  void normals_from(VIndex vstart, float *normals);
+  void shifted_plane_ends(VIndex *vertex_ends, TIndex *triangle_ends,
+			  VIndex voffset, TIndex toffset);
+
+  // Plane by plane calculation used by compute_surfaces().
+  AIndex first_plane() { return (k2_begin > 0 ? k2_begin-1 : 0); } // Includes ghost plane.
+  AIndex end_plane() { return k2_end; }
+  AIndex plane_rows() { return size[1]; }
+  void start_planes();
+  void mark_row_edge_cuts(AIndex k1, AIndex k2);
+  void finish_plane(AIndex k2);
+  void end_planes();
 
 private:
   const Data_Type *grid;
@@ -273,12 +441,21 @@ private:
   GIndex stride[3];
   float threshold;
   bool cap_faces;
+  AIndex k2_begin, k2_end;
+  VIndex ghost_vertices;
+  const Data_Type *bounds;	// Min and max value for blocks of grid points.
+  AIndex bsize, bcount[3];	// Bounds block size and number of blocks.
+  Grid_Cell_List *gcp0, *gcp1;	// Cells for two planes being triangulated.
+  std::vector<VIndex> vplane_end;	// Vertex count after each plane.
+  std::vector<TIndex> tplane_end;	// Triangle count after each plane.
   Block_Array<float> vxyz;
   Block_Array<VIndex> tvi;
 
-  void compute_surface();
-  void mark_plane_edge_cuts(Grid_Cell_List &gp0, Grid_Cell_List &gp1, AIndex k2);
-  void mark_interior_edge_cuts(AIndex k1, AIndex k2,
+  bool active_run(AIndex k0, AIndex k1, AIndex k2, AIndex *k0_begin, AIndex *k0_end);
+  bool block_active(AIndex b0, AIndex b1, AIndex b2);
+  void mark_row_edge_cuts(AIndex k0_begin, AIndex k0_end, AIndex k1, AIndex k2,
+			  Grid_Cell_List &gp0, Grid_Cell_List &gp1);
+  void mark_interior_edge_cuts(AIndex k0_begin, AIndex k0_end, AIndex k1, AIndex k2,
 			       Grid_Cell_List &gp0, Grid_Cell_List &gp1);
   void mark_boundary_edge_cuts(AIndex k0, AIndex k1, AIndex k2,
 			       Grid_Cell_List &gp0, Grid_Cell_List &gp1);
@@ -322,51 +499,187 @@ private:
 //
 //	grid[i0*stride[0] + i1*stride[1] + i2*stride[2]]
 //
+// If grid point value is above threshold check if 6 connected edges
+// cross contour surface and make vertex, add vertex to 4 bordering
+// grid cells, triangulate grid cells between two z grid planes.
+//
+// Surfaces for several thresholds with the same grid and z range are
+// calculated together one grid row at a time so the grid values are
+// read from memory once for all thresholds.
+//
 template <class Data_Type>
-void CSurface<Data_Type>::compute_surface()
+void compute_surfaces(CSurface<Data_Type> **surfs, int n)
 {
-  //
-  // If grid point value is above threshold check if 6 connected edges
-  // cross contour surface and make vertex, add vertex to 4 bordering
-  // grid cells, triangulate grid cells between two z grid planes.
-  //
-  Grid_Cell_List gcp0(size[0]-1, size[1]-1), gcp1(size[0]-1, size[1]-1);
-  for (AIndex k2 = 0 ; k2 < size[2] ; ++k2)
+  if (n == 0)
+    return;
+
+  for (int s = 0 ; s < n ; ++s)
+    surfs[s]->start_planes();
+
+  CSurface<Data_Type> *cs0 = surfs[0];
+  AIndex k1_size = cs0->plane_rows();
+  for (AIndex k2 = cs0->first_plane() ; k2 < cs0->end_plane() ; ++k2)
     {
-      Grid_Cell_List &gp0 = (k2%2 ? gcp1 : gcp0), &gp1 = (k2%2 ? gcp0 : gcp1);
-      mark_plane_edge_cuts(gp0, gp1, k2);
+      for (AIndex k1 = 0 ; k1 < k1_size ; ++k1)
+	for (int s = 0 ; s < n ; ++s)
+	  surfs[s]->mark_row_edge_cuts(k1, k2);
+      for (int s = 0 ; s < n ; ++s)
+	surfs[s]->finish_plane(k2);
+    }
+
+  for (int s = 0 ; s < n ; ++s)
+    surfs[s]->end_planes();
+}
 
+// ----------------------------------------------------------------------------
+//
+template <class Data_Type>
+void CSurface<Data_Type>::start_planes()
+{
+  end_planes();
+  this->gcp0 = new Grid_Cell_List(size[0]-1, size[1]-1);
+  this->gcp1 = new Grid_Cell_List(size[0]-1, size[1]-1);
+}
+
+// ----------------------------------------------------------------------------
+//
+template <class Data_Type>
+void CSurface<Data_Type>::finish_plane(AIndex k2)
+{
+  Grid_Cell_List &gp0 = (k2%2 ? *gcp1 : *gcp0);
+  if (k2 < k2_begin)
+    ghost_vertices = vertex_count();
+  else
+    {
       if (k2 > 0)
 	make_triangles(gp0, k2);	// Create triangles for cell plane.
+      vplane_end.push_back(vertex_count());
+      tplane_end.push_back(triangle_count());
+    }
+
+  gp0.finished_plane();
+}
+
+// ----------------------------------------------------------------------------
+// Free cell lists, only needed while calculating.
+//
+template <class Data_Type>
+void CSurface<Data_Type>::end_planes()
+{
+  delete gcp0;
+  delete gcp1;
+  this->gcp0 = this->gcp1 = NULL;
+}
 
-      gp0.finished_plane();
+// ----------------------------------------------------------------------------
+// Copy vertices excluding ghost vertices and offset triangle vertex indices
+// so ghost vertices refer to the preceding slab vertices.
+//
+template <class Data_Type>
+void CSurface<Data_Type>::non_ghost_geometry(float *vertex_xyz,
+					     VIndex *triangle_vertex_indices,
+					     VIndex voffset, bool release)
+{
+  BIndex n = tvi.size();
+  vxyz.array(vertex_xyz, 3*ghost_vertices, release);
+  tvi.array(triangle_vertex_indices, 0, release);
+  VIndex shift = voffset - ghost_vertices;
+  if (shift != 0)
+    for (BIndex i = 0 ; i < n ; ++i)
+      triangle_vertex_indices[i] += shift;
+}
+
+// ----------------------------------------------------------------------------
+//
+template <class Data_Type>
+void CSurface<Data_Type>::mark_row_edge_cuts(AIndex k1, AIndex k2)
+{
+  Grid_Cell_List &gp0 = (k2%2 ? *gcp1 : *gcp0), &gp1 = (k2%2 ? *gcp0 : *gcp1);
+  AIndex k0_begin, k0_end;
+  for (AIndex k0 = 0 ; active_run(k0, k1, k2, &k0_begin, &k0_end) ; k0 = k0_end)
+    mark_row_edge_cuts(k0_begin, k0_end, k1, k2, gp0, gp1);
+}
+
+// ----------------------------------------------------------------------------
+// Find the next range of grid points along axis 0 starting at or after k0
+// that could have edge cuts.  Without block bounds this is the rest of the row.
+//
+template <class Data_Type>
+inline bool CSurface<Data_Type>::active_run(AIndex k0, AIndex k1, AIndex k2,
+					    AIndex *k0_begin, AIndex *k0_end)
+{
+  AIndex k0_size = size[0];
+  if (k0 >= k0_size)
+    return false;
+
+  if (bounds == NULL)
+    {
+      *k0_begin = k0;
+      *k0_end = k0_size;
+      return true;
     }
+
+  AIndex b0 = k0/bsize, b1 = k1/bsize, b2 = k2/bsize, nb0 = bcount[0];
+  while (b0 < nb0 && !block_active(b0, b1, b2))
+    b0 += 1;
+  if (b0 == nb0)
+    return false;
+  *k0_begin = (b0*bsize > k0 ? b0*bsize : k0);
+  while (b0 < nb0 && block_active(b0, b1, b2))
+    b0 += 1;
+  *k0_end = (b0 == nb0 ? k0_size : b0*bsize);
+  return true;
 }
 
 // ----------------------------------------------------------------------------
+// A block cannot have edge cuts if all values are below threshold or all are
+// above threshold.  Blocks on the grid boundary with all values above
+// threshold still need capping vertices.  Threshold comparisons are done the
+// same way as in mark_interior_edge_cuts() so the surface is unchanged.
 //
 template <class Data_Type>
-void CSurface<Data_Type>::mark_plane_edge_cuts(Grid_Cell_List &gp0,
-					       Grid_Cell_List &gp1,
-					       AIndex k2)
+inline bool CSurface<Data_Type>::block_active(AIndex b0, AIndex b1, AIndex b2)
+{
+  const Data_Type *mm = bounds + 2*(b0 + (GIndex)bcount[0]*(b1 + (GIndex)bcount[1]*b2));
+  float vmax = mm[1] - threshold;
+  if (vmax < 0)
+    return false;
+  float vmin = mm[0] - threshold;
+  if (vmin >= 0)
+    return (cap_faces &&
+	    (b0 == 0 || b0+1 == bcount[0] ||
+	     b1 == 0 || b1+1 == bcount[1] ||
+	     b2 == 0 || b2+1 == bcount[2]));
+  return true;
+}
+
+// ----------------------------------------------------------------------------
+//
+template <class Data_Type>
+inline void CSurface<Data_Type>::mark_row_edge_cuts(AIndex k0_begin, AIndex k0_end,
+						    AIndex k1, AIndex k2,
+						    Grid_Cell_List &gp0,
+						    Grid_Cell_List &gp1)
 {
   AIndex k0_size = size[0], k1_size = size[1], k2_size = size[2];
 
-  for (AIndex k1 = 0 ; k1 < k1_size ; ++k1)
+  if (k1 == 0 || k1+1 == k1_size || k2 == 0 || k2+1 == k2_size)
+    for (AIndex k0 = k0_begin ; k0 < k0_end ; ++k0)
+      mark_boundary_edge_cuts(k0, k1, k2, gp0, gp1);
+  else
     {
-      if (k1 == 0 || k1+1 == k1_size || k2 == 0 || k2+1 == k2_size)
-	for (AIndex k0 = 0 ; k0 < k0_size ; ++k0)
-	  mark_boundary_edge_cuts(k0, k1, k2, gp0, gp1);
-      else
+      AIndex k0_max = (k0_size > 0 ? k0_size-1 : 0);
+      if (k0_begin == 0)
 	{
-	  if (k0_size > 0)
-	    mark_boundary_edge_cuts(0, k1, k2, gp0, gp1);
-
-	  mark_interior_edge_cuts(k1, k2, gp0, gp1);
-	  
-	  if (k0_size > 1)
-	    mark_boundary_edge_cuts(k0_size-1, k1, k2, gp0, gp1);
+	  mark_boundary_edge_cuts(0, k1, k2, gp0, gp1);
+	  k0_begin = 1;
 	}
+
+      mark_interior_edge_cuts(k0_begin, (k0_end < k0_max ? k0_end : k0_max),
+			      k1, k2, gp0, gp1);
+
+      if (k0_end == k0_size && k0_size > 1)
+	mark_boundary_edge_cuts(k0_size-1, k1, k2, gp0, gp1);
     }
 }
 
@@ -376,15 +689,15 @@ void CSurface<Data_Type>::mark_plane_edge_cuts(Grid_Cell_List &gp0,
 // This allows faster processing since boundary checking is not needed.
 //
 template <class Data_Type>
-inline void CSurface<Data_Type>::mark_interior_edge_cuts(AIndex k1, AIndex k2,
+inline void CSurface<Data_Type>::mark_interior_edge_cuts(AIndex k0_begin, AIndex k0_end,
+							 AIndex k1, AIndex k2,
 							 Grid_Cell_List &gp0,
 							 Grid_Cell_List &gp1)
 {
   GIndex step0 = stride[0], step1 = stride[1], step2 = stride[2];
-  AIndex k0_max = (size[0] > 0 ? size[0]-1 : 0);
 
-  const Data_Type *g = grid + step2*(GIndex)k2 + step1*(GIndex)k1 + step0;
-  for (AIndex k0 = 1 ; k0 < k0_max ; ++k0, g += step0)
+  const Data_Type *g = grid + step2*(GIndex)k2 + step1*(GIndex)k1 + step0*(GIndex)k0_begin;
+  for (AIndex k0 = k0_begin ; k0 < k0_end ; ++k0, g += step0)
     {
       float v0 = *g - threshold;
       if (!(v0 < 0))
@@ -674,57 +987,395 @@ void CSurface<Data_Type>::make_triangles(Grid_Cell_List &gp0, AIndex k2)
     }
 }
 
+// ----------------------------------------------------------------------------
+// Plane ends for z planes k2_begin <= k2 < k2_end with vertex numbering
+// offset so ghost vertices are from the preceding slab.
+//
+template <class Data_Type>
+void CSurface<Data_Type>::shifted_plane_ends(VIndex *vertex_ends, TIndex *triangle_ends,
+					     VIndex voffset, TIndex toffset)
+{
+  VIndex vshift = voffset - ghost_vertices;
+  AIndex n = static_cast<AIndex>(vplane_end.size());
+  for (AIndex i = 0 ; i < n ; ++i)
+    {
+      vertex_ends[k2_begin+i] = vplane_end[i] + vshift;
+      triangle_ends[k2_begin+i] = tplane_end[i] + toffset;
+    }
+}
+
 // ----------------------------------------------------------------------------
 // Normals are negative of symmetric difference data gradient.
 //
 template <class Data_Type>
-void CSurface<Data_Type>::normals(float *normals)
+void CSurface<Data_Type>::normals_from(VIndex vstart, float *normals)
 {
   int64_t n3 = 3*vertex_count();
-  for (int64_t v = 0 ; v < n3 ; v += 3)
+  normals -= 3*(int64_t)vstart;
+  for (int64_t v = 3*(int64_t)vstart ; v < n3 ; v += 3)
     {  
       float x[3] = {vxyz.element(v), vxyz.element(v+1), vxyz.element(v+2)};
-      float g[3];
-      for (int a = 0 ; a < 3 ; ++a)
-	g[a] = (x[a] == 0 ? 1 : (x[a] == size[a]-1 ? -1 : 0));
-      if (g[0] == 0 && g[1] == 0 && g[2] == 0)
+      grid_normal(grid, size, stride, x, normals + v);
+    }
+}
+
+
+// ----------------------------------------------------------------------------
+// Surface computed in z slabs by separate threads.  The slab surfaces are
+// joined so the vertex and triangle arrays are identical to those from
+// contouring the full grid in a single thread.
+//
+template <class Data_Type>
+class Slab_Surface : public Contour_Surface
+{
+public:
+  // Takes ownership of the slab surfaces which must be in z order.
+  Slab_Surface(const std::vector<CSurface<Data_Type> *> &slabs) : slabs(slabs) {}
+  virtual ~Slab_Surface()
+    {
+      for (size_t s = 0 ; s < slabs.size() ; ++s)
+	delete slabs[s];
+    }
+
+  virtual VIndex vertex_count()
+    {
+      VIndex vc = 0;
+      for (size_t s = 0 ; s < slabs.size() ; ++s)
+	vc += slabs[s]->vertex_count() - slabs[s]->ghost_vertex_count();
+      return vc;
+    }
+  virtual TIndex triangle_count()
+    {
+      TIndex tc = 0;
+      for (size_t s = 0 ; s < slabs.size() ; ++s)
+	tc += slabs[s]->triangle_count();
+      return tc;
+    }
+  virtual void geometry(float *vertex_xyz, VIndex *triangle_vertex_indices)
+    { copy_geometry(vertex_xyz, triangle_vertex_indices, NULL, false); }
+  virtual void normals(float *normals);
+  virtual void plane_ends(VIndex *vertex_ends, TIndex *triangle_ends);
+  virtual void take_geometry(float *vertex_xyz, VIndex *triangle_vertex_indices,
+			     float *normals)
+    { copy_geometry(vertex_xyz, triangle_vertex_indices, normals, true); }
+
+private:
+  std::vector<CSurface<Data_Type> *> slabs;
+  void copy_geometry(float *vertex_xyz, VIndex *triangle_vertex_indices,
+		     float *normals, bool release);
+};
+
+// ----------------------------------------------------------------------------
+//
+// Copy geometry and optionally normals.  If release is true the slab
+// storage is freed as it is copied.
+//
+template <class Data_Type>
+void Slab_Surface<Data_Type>::copy_geometry(float *vertex_xyz,
+					    VIndex *triangle_vertex_indices,
+					    float *normals, bool release)
+{
+  VIndex voffset = 0;
+  TIndex toffset = 0;
+  for (size_t s = 0 ; s < slabs.size() ; ++s)
+    {
+      CSurface<Data_Type> *cs = slabs[s];
+      VIndex g = cs->ghost_vertex_count(), vc = cs->vertex_count() - g;
+      TIndex tc = cs->triangle_count();
+      if (normals)
+	cs->normals_from(g, normals + 3*(int64_t)voffset);
+      cs->non_ghost_geometry(vertex_xyz + 3*(int64_t)voffset,
+			     triangle_vertex_indices + 3*toffset, voffset, release);
+      voffset += vc;
+      toffset += tc;
+    }
+}
+
+// ----------------------------------------------------------------------------
+//
+template <class Data_Type>
+void Slab_Surface<Data_Type>::normals(float *normals)
+{
+  VIndex voffset = 0;
+  for (size_t s = 0 ; s < slabs.size() ; ++s)
+    {
+      CSurface<Data_Type> *cs = slabs[s];
+      VIndex g = cs->ghost_vertex_count();
+      cs->normals_from(g, normals + 3*(int64_t)voffset);
+      voffset += cs->vertex_count() - g;
+    }
+}
+
+// ----------------------------------------------------------------------------
+//
+template <class Data_Type>
+void Slab_Surface<Data_Type>::plane_ends(VIndex *vertex_ends, TIndex *triangle_ends)
+{
+  VIndex voffset = 0;
+  TIndex toffset = 0;
+  for (size_t s = 0 ; s < slabs.size() ; ++s)
+    {
+      CSurface<Data_Type> *cs = slabs[s];
+      cs->shifted_plane_ends(vertex_ends, triangle_ends, voffset, toffset);
+      voffset += cs->vertex_count() - cs->ghost_vertex_count();
+      toffset += cs->triangle_count();
+    }
+}
+
+// ----------------------------------------------------------------------------
+// Compute surfaces for all thresholds for one z slab.  Surfaces are set to
+// NULL if memory runs out.
+//
+template <class Data_Type>
+void contour_slab(CSurface<Data_Type> **cs, const Data_Type *grid,
+		  const AIndex *size, const GIndex *stride,
+		  const float *thresholds, int nthresholds,
+		  bool cap_faces, BIndex block_size,
+		  AIndex k2_begin, AIndex k2_end,
+		  const Data_Type *bounds, AIndex bounds_block_size)
+{
+  for (int t = 0 ; t < nthresholds ; ++t)
+    cs[t] = NULL;
+  try
+    {
+      for (int t = 0 ; t < nthresholds ; ++t)
+	cs[t] = new CSurface<Data_Type>(grid, size, stride, thresholds[t],
+					cap_faces, block_size, k2_begin, k2_end,
+					bounds, bounds_block_size);
+      compute_surfaces(cs, nthresholds);
+    }
+  catch (std::bad_alloc&)
+    {
+      for (int t = 0 ; t < nthresholds ; ++t)
 	{
-	  AIndex i[3] = {(AIndex)x[0], (AIndex)x[1], (AIndex)x[2]};
-	  const Data_Type *ga = grid + stride[0]*(GIndex)i[0]+stride[1]*(GIndex)i[1]+stride[2]*(GIndex)i[2];
-	  const Data_Type *gb = ga;
-	  AIndex off[3] = {0,0,0};
-	  float fb = 0;
-	  for (int a = 0 ; a < 3 ; ++a)
-	    if ((fb = x[a]-i[a]) > 0) { off[a] = 1; gb = ga + stride[a]; break; }
-	  float fa = 1-fb;
-	  for (int a = 0 ; a < 3 ; ++a)
-	    {
-	      GIndex s = stride[a];
-	      AIndex ia = i[a], ib = ia + off[a];
-	      g[a] = (fa*(ia == 0 ?
-			  2*((float)ga[s]-ga[0]) : (float)ga[s]-*(ga-s))
-		      + fb*(ib == 0 ? 2*((float)gb[s]-gb[0]) :
-			    ib == size[a]-1 ? 2*((float)gb[0]-*(gb-s))
-			    : (float)gb[s]-*(gb-s)));
-	    }
-	  float norm = sqrt(g[0]*g[0] + g[1]*g[1] + g[2]*g[2]);
-	  if (norm > 0)
-	    { g[0] /= norm; g[1] /= norm; g[2] /= norm;}
+	  delete cs[t];
+	  cs[t] = NULL;	// Reported after all slabs finish.
 	}
-      normals[v] = -g[0]; normals[v+1] = -g[1]; normals[v+2] = -g[2];
     }
 }
 
+// ----------------------------------------------------------------------------
+// If threads > 1 the grid is split into z slabs contoured in parallel by the
+// shared thread pool, using at most Thread_Pool::max_threads() slabs.
+// If bounds is not NULL it holds block minimum and maximum values computed
+// by block_bounds() used to skip blocks that cannot contain the surface.
+//
+template <class Data_Type>
+void surfaces(const Data_Type *grid, const AIndex size[3],
+	      const GIndex stride[3], const float *thresholds, int nthresholds,
+	      bool cap_faces, Contour_Surface **surfs, int threads,
+	      const Data_Type *bounds, AIndex bounds_block_size)
+{
+  // Use at least 2 planes per slab.
+  int nslabs = Thread_Pool::thread_count(size[2], 2, std::max(threads, 1));
+
+  std::vector<CSurface<Data_Type> *> slab_surfs(nslabs*nthresholds, NULL);
+  if (nslabs == 1)
+    contour_slab(&slab_surfs[0], grid, size, stride, thresholds, nthresholds,
+		 cap_faces, CONTOUR_ARRAY_BLOCK_SIZE, 0, size[2],
+		 bounds, bounds_block_size);
+  else
+    {
+      // Use smaller vertex blocks to limit memory use with many threads.
+      BIndex block_size = CONTOUR_ARRAY_BLOCK_SIZE / nslabs;
+      if (block_size < 65536)
+	block_size = 65536;
+
+      AIndex k2_size = size[2];
+      Thread_Pool::run(nslabs, [&](int s) {
+	  AIndex k2_begin = (AIndex)(((int64_t)k2_size * s) / nslabs);
+	  AIndex k2_end = (AIndex)(((int64_t)k2_size * (s+1)) / nslabs);
+	  contour_slab(&slab_surfs[s*nthresholds], grid, size, stride,
+		       thresholds, nthresholds, cap_faces,
+		       block_size, k2_begin, k2_end,
+		       bounds, bounds_block_size);
+	});
+    }
+
+  size_t ns = slab_surfs.size();
+  for (size_t i = 0 ; i < ns ; ++i)
+    if (slab_surfs[i] == NULL)
+      {
+	for (size_t j = 0 ; j < ns ; ++j)
+	  delete slab_surfs[j];
+	throw std::bad_alloc();
+      }
+
+  for (int t = 0 ; t < nthresholds ; ++t)
+    if (nslabs == 1)
+      surfs[t] = slab_surfs[t];
+    else
+      {
+	std::vector<CSurface<Data_Type> *> slabs;
+	for (int s = 0 ; s < nslabs ; ++s)
+	  slabs.push_back(slab_surfs[s*nthresholds + t]);
+	surfs[t] = new Slab_Surface<Data_Type>(slabs);
+      }
+}
+
 // ----------------------------------------------------------------------------
 //
 template <class Data_Type>
 Contour_Surface *surface(const Data_Type *grid, const AIndex size[3],
-			 const GIndex stride[3], float threshold, bool cap_faces)
+			 const GIndex stride[3], float threshold, bool cap_faces,
+			 int threads, const Data_Type *bounds,
+			 AIndex bounds_block_size)
 {
-  CSurface<Data_Type> *cs = new CSurface<Data_Type>(grid, size, stride,
-						    threshold, cap_faces,
-						    CONTOUR_ARRAY_BLOCK_SIZE);
+  Contour_Surface *cs;
+  surfaces(grid, size, stride, &threshold, 1, cap_faces, &cs, threads,
+	   bounds, bounds_block_size);
   return cs;
 }
 
+// ----------------------------------------------------------------------------
+// Surface with geometry for changed z planes recomputed and the rest copied
+// from a previous surface.
+//
+// Vertices created for z plane k depend on grid planes k-1, k, k+1 and
+// their normals on planes k-2 through k+2.  Triangles for the cells between
+// planes k-1 and k use vertices from those two planes.  So if planes k2_min
+// through k2_max change then planes k2_min-2 through k2_max+2 are recontoured.
+// The last recontoured plane has the same vertices as before, so triangles
+// after it only need their vertex indices shifted.
+//
+template <class Data_Type>
+class Spliced_Surface : public Contour_Surface
+{
+public:
+  Spliced_Surface(const Data_Type *grid, const AIndex size[3], const GIndex stride[3],
+		  const Surface_Arrays &previous, CSurface<Data_Type> *middle,
+		  AIndex k2_begin, AIndex k2_end)
+    : grid(grid), prev(previous), middle(middle), k2_begin(k2_begin), k2_end(k2_end)
+    {
+      for (int a = 0 ; a < 3 ; ++a)
+	{ this->size[a] = size[a]; this->stride[a] = stride[a]; }
+      vbegin = (k2_begin > 0 ? prev.vertex_plane_ends[k2_begin-1] : 0);
+      tbegin = (k2_begin > 0 ? prev.triangle_plane_ends[k2_begin-1] : 0);
+      vend = (k2_end > 0 ? prev.vertex_plane_ends[k2_end-1] : 0);
+      tend = (k2_end > 0 ? prev.triangle_plane_ends[k2_end-1] : 0);
+      vmiddle = middle->vertex_count() - middle->ghost_vertex_count();
+      vshift = vbegin + vmiddle - vend;
+    }
+  virtual ~Spliced_Surface() { delete middle; }
+
+  virtual VIndex vertex_count()
+    { return prev.vertex_count + vshift; }
+  virtual TIndex triangle_count()
+    { return tbegin + middle->triangle_count() + (prev.triangle_count - tend); }
+  virtual void geometry(float *vertex_xyz, VIndex *triangle_vertex_indices);
+  virtual void normals(float *normals);
+  virtual void plane_ends(VIndex *vertex_ends, TIndex *triangle_ends);
+
+private:
+  const Data_Type *grid;
+  AIndex size[3];
+  GIndex stride[3];
+  Surface_Arrays prev;
+  CSurface<Data_Type> *middle;	// Recontoured planes.
+  AIndex k2_begin, k2_end;	// Recontoured z planes.
+  VIndex vbegin, vend, vmiddle, vshift;
+  TIndex tbegin, tend;
+};
+
+// ----------------------------------------------------------------------------
+//
+template <class Data_Type>
+void Spliced_Surface<Data_Type>::geometry(float *vertex_xyz,
+					  VIndex *triangle_vertex_indices)
+{
+  VIndex vcount = prev.vertex_count;
+  TIndex tmiddle = middle->triangle_count();
+  const float *pv = prev.vertex_xyz;
+  const VIndex *pt = prev.triangle_vertex_indices;
+  for (int64_t i = 0 ; i < 3*(int64_t)vbegin ; ++i)
+    vertex_xyz[i] = pv[i];
+  for (int64_t i = 0 ; i < 3*tbegin ; ++i)
+    triangle_vertex_indices[i] = pt[i];
+  middle->non_ghost_geometry(vertex_xyz + 3*(int64_t)vbegin,
+			     triangle_vertex_indices + 3*tbegin, vbegin);
+  float *v = vertex_xyz + 3*(int64_t)(vbegin + vmiddle);
+  for (int64_t i = 3*(int64_t)vend ; i < 3*(int64_t)vcount ; ++i)
+    *v++ = pv[i];
+  VIndex *t = triangle_vertex_indices + 3*(tbegin + tmiddle);
+  for (int64_t i = 3*tend ; i < 3*prev.triangle_count ; ++i)
+    *t++ = pt[i] + vshift;
+}
+
+// ----------------------------------------------------------------------------
+//
+template <class Data_Type>
+void Spliced_Surface<Data_Type>::normals(float *normals)
+{
+  VIndex vcount = prev.vertex_count;
+  const float *pn = prev.normals;
+  if (pn)
+    for (int64_t i = 0 ; i < 3*(int64_t)vbegin ; ++i)
+      normals[i] = pn[i];
+  else
+    for (VIndex i = 0 ; i < vbegin ; ++i)
+      grid_normal(grid, size, stride, prev.vertex_xyz + 3*(int64_t)i, normals + 3*(int64_t)i);
+
+  middle->normals_from(middle->ghost_vertex_count(), normals + 3*(int64_t)vbegin);
+
+  float *n = normals + 3*(int64_t)(vbegin + vmiddle);
+  if (pn)
+    for (int64_t i = 3*(int64_t)vend ; i < 3*(int64_t)vcount ; ++i)
+      *n++ = pn[i];
+  else
+    for (VIndex i = vend ; i < vcount ; ++i, n += 3)
+      grid_normal(grid, size, stride, prev.vertex_xyz + 3*(int64_t)i, n);
+}
+
+// ----------------------------------------------------------------------------
+//
+template <class Data_Type>
+void Spliced_Surface<Data_Type>::plane_ends(VIndex *vertex_ends, TIndex *triangle_ends)
+{
+  AIndex k2_size = size[2];
+  TIndex tshift = tbegin + middle->triangle_count() - tend;
+  for (AIndex k2 = 0 ; k2 < k2_begin ; ++k2)
+    {
+      vertex_ends[k2] = prev.vertex_plane_ends[k2];
+      triangle_ends[k2] = prev.triangle_plane_ends[k2];
+    }
+  middle->shifted_plane_ends(vertex_ends, triangle_ends, vbegin, tbegin);
+  for (AIndex k2 = k2_end ; k2 < k2_size ; ++k2)
+    {
+      vertex_ends[k2] = prev.vertex_plane_ends[k2] + vshift;
+      triangle_ends[k2] = prev.triangle_plane_ends[k2] + tshift;
+    }
+}
+
+// ----------------------------------------------------------------------------
+//
+template <class Data_Type>
+Contour_Surface *surface_update(const Data_Type *grid,
+				const AIndex size[3], const GIndex stride[3],
+				float threshold, bool cap_faces,
+				AIndex k2_min, AIndex k2_max,
+				const Surface_Arrays &previous)
+{
+  AIndex k2_size = size[2], k2_begin = 0, k2_end = 0;	// Recontoured planes.
+  if (k2_min <= k2_max && k2_min < k2_size)
+    {
+      k2_begin = (k2_min >= 2 ? k2_min-2 : 0);
+      k2_end = (k2_max + 3 < k2_size ? k2_max + 3 : k2_size);
+    }
+
+  CSurface<Data_Type> *cs = new CSurface<Data_Type>(grid, size, stride, threshold,
+						    cap_faces, CONTOUR_ARRAY_BLOCK_SIZE,
+						    k2_begin, k2_end);
+  try
+    {
+      compute_surfaces(&cs, 1);
+    }
+  catch (std::bad_alloc&)
+    {
+      delete cs;
+      throw;
+    }
+  return new Spliced_Surface<Data_Type>(grid, size, stride, previous, cs,
+					k2_begin, k2_end);
+}
+
 } // end of namespace Contour_Calculation
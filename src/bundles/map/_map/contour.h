@@ -41,6 +41,14 @@
 //
 // Returned vertex and triangle arrays should be freed with free_surface().
 //
+// If threads > 1 the grid is split into z slabs that are contoured in
+// parallel giving the same vertex and triangle arrays as a single thread.
+//
+// Optional block bounds from block_bounds() allow skipping regions of the
+// grid that cannot contain the surface, also giving identical results.
+//
+
+#include <cstddef>		// use NULL
 
 #include "index_types.h"	// Use GIndex, AIndex, VIndex, TIndex
 
@@ -55,12 +63,78 @@ class Contour_Surface
   virtual TIndex triangle_count() = 0;
   virtual void geometry(float *vertex_xyz, VIndex *triangle_vertex_indices) = 0;
   virtual void normals(float *normals) = 0;
+  // Vertex and triangle counts after each z grid plane, arrays of size[2].
+  virtual void plane_ends(VIndex *vertex_ends, TIndex *triangle_ends) = 0;
+  // Copy geometry and normals (if not NULL) to caller allocated arrays
+  // sized from vertex_count() and triangle_count() freeing internal storage
+  // as it is copied to avoid doubling peak memory use.  The surface has no
+  // geometry afterwards.
+  virtual void take_geometry(float *vertex_xyz, VIndex *triangle_vertex_indices,
+			     float *normals)
+    {
+      if (normals)
+	this->normals(normals);
+      geometry(vertex_xyz, triangle_vertex_indices);
+    }
 };
 
 template <class Data_Type>
 Contour_Surface *surface(const Data_Type *grid,
 			 const AIndex size[3], const GIndex stride[3],
-			 float threshold, bool cap_faces);
+			 float threshold, bool cap_faces, int threads = 1,
+			 const Data_Type *bounds = NULL, AIndex bounds_block_size = 0);
+
+//
+// Compute surfaces for several thresholds reading the grid once.  The
+// surfs array of length nthresholds is filled with the surfaces.
+//
+template <class Data_Type>
+void surfaces(const Data_Type *grid,
+	      const AIndex size[3], const GIndex stride[3],
+	      const float *thresholds, int nthresholds, bool cap_faces,
+	      Contour_Surface **surfs, int threads = 1,
+	      const Data_Type *bounds = NULL, AIndex bounds_block_size = 0);
+
+//
+// Previously computed surface geometry used to update a surface after grid
+// values change.  Normals can be NULL.  The plane end arrays of length
+// size[2] are from Contour_Surface::plane_ends().
+//
+class Surface_Arrays
+{
+ public:
+  VIndex vertex_count;
+  TIndex triangle_count;
+  const float *vertex_xyz, *normals;
+  const VIndex *triangle_vertex_indices;
+  const VIndex *vertex_plane_ends;
+  const TIndex *triangle_plane_ends;
+};
+
+//
+// Update a surface when grid values have changed only in z planes
+// k2_min <= k2 <= k2_max.  Only the planes near the change are contoured
+// and the rest of the geometry is copied from the previous surface which
+// must have been computed with the same threshold and cap_faces setting.
+// The result is identical to contouring the full grid.  The previous
+// arrays must remain valid until the returned surface geometry is copied.
+//
+template <class Data_Type>
+Contour_Surface *surface_update(const Data_Type *grid,
+				const AIndex size[3], const GIndex stride[3],
+				float threshold, bool cap_faces,
+				AIndex k2_min, AIndex k2_max,
+				const Surface_Arrays &previous);
+
+//
+// Minimum and maximum values for blocks of grid points.  Can be computed
+// once for a grid and passed to surface() for each threshold to skip blocks
+// that cannot contain the surface.  The min_max array has size 2*n0*n1*n2
+// where nk = ceil(size[k]/block_size).
+//
+template <class Data_Type>
+void block_bounds(const Data_Type *grid, const AIndex size[3],
+		  const GIndex stride[3], AIndex block_size, Data_Type *min_max);
 }
 
 #include "contour.cpp"	// template implementation
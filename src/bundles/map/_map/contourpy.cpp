@@ -29,19 +29,27 @@
 //
 #include <Python.h>			// use PyObject
 
+#include <string>			// use std::to_string()
+#include <vector>			// use std::vector
+
 // #include <iostream>			// use std:cerr for debugging
 
 #include "contour.h"			// use surface()
+#include "squaremesh.h"			// use principle_plane_edge_mask()
 #include <arrays/pythonarray.h>		// use array_from_python()
 #include <arrays/rcarray.h>		// use call_template_function()
+#include <arrays/trace.h>		// use TRACE_SCOPE()
 
 using namespace Contour_Calculation;
 
 // ----------------------------------------------------------------------------
 //
 template <class T>
-void contour_surface(const Reference_Counted_Array::Array<T> &data,
-		     float threshold, bool cap_faces, Contour_Surface **cs)
+void contour_surfaces(const Reference_Counted_Array::Array<T> &data,
+		      const float *thresholds, int nthresholds,
+		      bool cap_faces, int threads,
+		      const Reference_Counted_Array::Array<T> &bounds,
+		      int block_size, Contour_Surface **cs)
 {
   // contouring calculation requires contiguous array
   // put sizes in x, y, z order
@@ -49,60 +57,481 @@ void contour_surface(const Reference_Counted_Array::Array<T> &data,
 		    static_cast<AIndex>(data.size(1)),
 		    static_cast<AIndex>(data.size(0))};
   GIndex stride[3] = {data.stride(2), data.stride(1), data.stride(0)};
-  *cs = surface(data.values(), size, stride, threshold, cap_faces);
+  const T *bvalues = (bounds.dimension() == 4 ? bounds.values() : NULL);
+  surfaces(data.values(), size, stride, thresholds, nthresholds, cap_faces,
+	   cs, threads, bvalues, static_cast<AIndex>(block_size));
+}
+
+// ----------------------------------------------------------------------------
+// Check block bounds array has shape matching data and block size.
+//
+static bool check_block_bounds(const Numeric_Array &data, const Numeric_Array &bounds,
+			       int block_size)
+{
+  if (block_size <= 0)
+    {
+      PyErr_Format(PyExc_ValueError, "Block size must be positive, got %d", block_size);
+      return false;
+    }
+  if (!bounds.is_contiguous())
+    {
+      PyErr_SetString(PyExc_TypeError, "Block bounds array must be contiguous");
+      return false;
+    }
+  for (int a = 0 ; a < 3 ; ++a)
+    {
+      int64_t nb = (data.size(a) + block_size - 1) / block_size;
+      if (bounds.size(a) != nb)
+	{
+	  PyErr_Format(PyExc_TypeError,
+		       "Block bounds array size %s along axis %d does not match data size %s and block size %d",
+		       std::to_string(bounds.size(a)).c_str(), a,
+		       std::to_string(data.size(a)).c_str(), block_size);
+	  return false;
+	}
+    }
+  if (bounds.size(3) != 2)
+    {
+      PyErr_SetString(PyExc_TypeError, "Block bounds array last dimension must be 2 (min, max)");
+      return false;
+    }
+  return true;
+}
+
+// ----------------------------------------------------------------------------
+// Optional caller allocated arrays to hold the surface geometry so repeated
+// contouring can reuse memory instead of allocating new arrays each time.
+//
+class Output_Buffers
+{
+public:
+  Output_Buffers() : vertices(NULL), triangles(NULL), normals(NULL) {}
+  PyObject *vertices, *triangles, *normals;
+};
+
+// ----------------------------------------------------------------------------
+// If buffer is a contiguous writable array of shape (N,3) with N >= n return
+// a view of its first n rows, otherwise allocate a new array.  Returns NULL
+// and sets a Python error if the buffer has the wrong type.
+//
+static PyObject *output_float_n3_array(PyObject *buffer, int64_t n, float **values)
+{
+  if (buffer == NULL || buffer == Py_None)
+    return python_float_array(n, 3, values);
+
+  FArray b;
+  if (!parse_writable_float_n3_array(buffer, &b))
+    return NULL;
+  if (!b.is_contiguous())
+    {
+      PyErr_SetString(PyExc_TypeError, "Output buffer must be a contiguous array");
+      return NULL;
+    }
+  if (b.size(0) < n)
+    return python_float_array(n, 3, values);
+  *values = b.values();
+  return PySequence_GetSlice(buffer, 0, static_cast<Py_ssize_t>(n));
+}
+
+// ----------------------------------------------------------------------------
+//
+static PyObject *output_int_n3_array(PyObject *buffer, int64_t n, int **values)
+{
+  if (buffer == NULL || buffer == Py_None)
+    return python_int_array(n, 3, values);
+
+  IArray b;
+  if (!parse_writable_int_n3_array(buffer, &b))
+    return NULL;
+  if (!b.is_contiguous())
+    {
+      PyErr_SetString(PyExc_TypeError, "Output buffer must be a contiguous array");
+      return NULL;
+    }
+  if (b.size(0) < n)
+    return python_int_array(n, 3, values);
+  *values = b.values();
+  return PySequence_GetSlice(buffer, 0, static_cast<Py_ssize_t>(n));
+}
+
+// ----------------------------------------------------------------------------
+// Check if an output buffer overlaps an input array.
+//
+static bool buffer_overlaps(PyObject *buffer, const void *values, int64_t bytes)
+{
+  if (buffer == NULL || buffer == Py_None || values == NULL)
+    return false;
+  Py_buffer view;
+  if (PyObject_GetBuffer(buffer, &view, PyBUF_ANY_CONTIGUOUS) != 0)
+    {
+      PyErr_Clear();
+      return false;
+    }
+  const char *b = static_cast<const char *>(view.buf), *v = static_cast<const char *>(values);
+  bool overlap = (b < v + bytes && v < b + view.len);
+  PyBuffer_Release(&view);
+  return overlap;
+}
+
+// ----------------------------------------------------------------------------
+// Return vertex, triangle and optionally normal arrays and delete surface.
+// If planes > 0 also return vertex and triangle counts after each z plane
+// as needed for updating the surface with contour_surface_update().
+// If edge_mask is true also return the square mesh edge mask computed by
+// principle_plane_edge_mask() while the new geometry is still in cache.
+// Surface storage is freed as it is copied to the output arrays so peak
+// memory use is about the size of one copy of the geometry.
+//
+static PyObject *surface_geometry(Contour_Surface *cs, bool return_normals,
+				  int64_t planes = 0,
+				  const Output_Buffers &buffers = Output_Buffers(),
+				  bool edge_mask = false)
+{
+  float *vxyz, *nxyz = NULL;
+  int *tvi;
+  VIndex vc = cs->vertex_count();
+  TIndex tc = cs->triangle_count();
+  PyObject *vertex_xyz = output_float_n3_array(buffers.vertices, vc, &vxyz);
+  PyObject *normals = (return_normals && vertex_xyz ?
+		       output_float_n3_array(buffers.normals, vc, &nxyz) : NULL);
+  PyObject *tv_indices = (vertex_xyz && (normals || !return_normals) ?
+			  output_int_n3_array(buffers.triangles, tc, &tvi) : NULL);
+  if (tv_indices == NULL)
+    {
+      Py_XDECREF(vertex_xyz);
+      Py_XDECREF(normals);
+      delete cs;
+      return NULL;
+    }
+  int *vends, *tends;
+  PyObject *vertex_ends = (planes > 0 ? python_int_array(planes, &vends) : NULL);
+  PyObject *triangle_ends = (planes > 0 ? python_int_array(planes, &tends) : NULL);
+  unsigned char *emask = NULL;
+  PyObject *edges = (edge_mask ? python_uint8_array(tc, &emask) : NULL);
+
+  Py_BEGIN_ALLOW_THREADS
+  // Plane ends use the surface vertex counts so get them before taking geometry.
+  if (planes > 0)
+    {
+      std::vector<TIndex> te(planes);
+      cs->plane_ends(reinterpret_cast<VIndex *>(vends), te.data());
+      for (int64_t k = 0 ; k < planes ; ++k)
+	tends[k] = static_cast<int>(te[k]);
+    }
+  cs->take_geometry(vxyz, reinterpret_cast<VIndex *>(tvi), nxyz);
+
+  delete cs;
+  if (emask)
+    principle_plane_edge_mask(vxyz, reinterpret_cast<VIndex *>(tvi), tc, emask);
+  Py_END_ALLOW_THREADS
+
+  std::vector<PyObject *> items = {vertex_xyz, tv_indices};
+  if (return_normals)
+    items.push_back(normals);
+  if (planes > 0)
+    {
+      items.push_back(vertex_ends);
+      items.push_back(triangle_ends);
+    }
+  if (edges)
+    items.push_back(edges);
+  PyObject *geom = PyTuple_New(items.size());
+  for (size_t i = 0 ; i < items.size() ; ++i)
+    PyTuple_SET_ITEM(geom, i, items[i]);
+  return geom;
 }
 
 // ----------------------------------------------------------------------------
 //
 static PyObject *surface_py2(PyObject *, PyObject *args, PyObject *keywds)
 {
-  PyObject *py_data;
+  PyObject *py_data, *py_bounds = NULL;
   float threshold;
-  int cap_faces = 1, return_normals = 0;
-  const char *kwlist[] = {"data", "threshold", "cap_faces", "calculate_normals", NULL};
-  if (!PyArg_ParseTupleAndKeywords(args, keywds, const_cast<char *>("Of|pp"),
+  int cap_faces = 1, return_normals = 0, threads = 1, block_size = 8, plane_ends = 0;
+  int edge_mask = 0;
+  Output_Buffers buffers;
+  const char *kwlist[] = {"data", "threshold", "cap_faces", "calculate_normals",
+			  "threads", "block_bounds", "block_size", "plane_ends",
+			  "vertex_buffer", "triangle_buffer", "normal_buffer",
+			  "edge_mask", NULL};
+  if (!PyArg_ParseTupleAndKeywords(args, keywds, const_cast<char *>("Of|ppiOipOOOp"),
 				   (char **)kwlist,
 				   &py_data, &threshold, &cap_faces,
-				   &return_normals))
+				   &return_normals, &threads,
+				   &py_bounds, &block_size, &plane_ends,
+				   &buffers.vertices, &buffers.triangles,
+				   &buffers.normals, &edge_mask))
     return NULL;
   
   Numeric_Array data;
   if (!array_from_python(py_data, 3, &data))
     return NULL;
 
+  Numeric_Array bounds;
+  if (py_bounds && py_bounds != Py_None)
+    {
+      if (!array_from_python(py_bounds, 4, data.value_type(), &bounds, false) ||
+	  !check_block_bounds(data, bounds, block_size))
+	return NULL;
+    }
+
   Contour_Surface *cs;
   Py_BEGIN_ALLOW_THREADS
-  call_template_function(contour_surface, data.value_type(),
-  			 (data, threshold, cap_faces, &cs));
+  call_template_function(contour_surfaces, data.value_type(),
+  			 (data, &threshold, 1, cap_faces, threads, bounds, block_size, &cs));
+  Py_END_ALLOW_THREADS
+
+  return surface_geometry(cs, return_normals, (plane_ends ? data.size(0) : 0),
+			  buffers, edge_mask);
+}
+
+// ----------------------------------------------------------------------------
+//
+extern "C" PyObject *surface_py(PyObject *s, PyObject *args, PyObject *keywds)
+{
+  TRACE_SCOPE("map.contour_surface");
+  try
+    {
+      return surface_py2(s, args, keywds);
+    }
+  catch (std::bad_alloc&)
+    {
+      PyErr_SetString(PyExc_MemoryError, "Out of memory");
+      return NULL;
+    }
+}
+
+// ----------------------------------------------------------------------------
+//
+template <class T>
+void compute_block_bounds(const Reference_Counted_Array::Array<T> &data, int block_size,
+			  const Reference_Counted_Array::Array<T> &bounds)
+{
+  AIndex size[3] = {static_cast<AIndex>(data.size(2)),
+		    static_cast<AIndex>(data.size(1)),
+		    static_cast<AIndex>(data.size(0))};
+  GIndex stride[3] = {data.stride(2), data.stride(1), data.stride(0)};
+  Contour_Calculation::block_bounds(data.values(), size, stride,
+				    static_cast<AIndex>(block_size), bounds.values());
+}
+
+// ----------------------------------------------------------------------------
+// Compute minimum and maximum data values for blocks of grid points.
+// The bounds array must have the same value type as data and have shape
+// (n0,n1,n2,2) where nk = ceil(data.shape[k]/block_size).
+//
+extern "C" PyObject *contour_block_bounds(PyObject *, PyObject *args, PyObject *keywds)
+{
+  Numeric_Array data, bounds;
+  int block_size = 8;
+  const char *kwlist[] = {"data", "bounds", "block_size", NULL};
+  if (!PyArg_ParseTupleAndKeywords(args, keywds, const_cast<char *>("O&O&|i"),
+				   (char **)kwlist,
+				   parse_3d_array, &data,
+				   parse_writable_4d_array, &bounds,
+				   &block_size))
+    return NULL;
+
+  if (bounds.value_type() != data.value_type())
+    {
+      PyErr_SetString(PyExc_TypeError,
+		      "contour_block_bounds: bounds array must have same value type as data");
+      return NULL;
+    }
+  if (!check_block_bounds(data, bounds, block_size))
+    return NULL;
+
+  Py_BEGIN_ALLOW_THREADS
+  call_template_function(compute_block_bounds, data.value_type(), (data, block_size, bounds));
   Py_END_ALLOW_THREADS
 
-  float *vxyz, *nxyz;
-  VIndex *tvi;
-  PyObject *vertex_xyz = python_float_array(cs->vertex_count(), 3, &vxyz);
-  PyObject *normals = (return_normals ? python_float_array(cs->vertex_count(), 3, &nxyz) : NULL);
-  PyObject *tv_indices = python_int_array(cs->triangle_count(), 3, &tvi);
+  return python_none();
+}
+
+// ----------------------------------------------------------------------------
+// Compute surfaces for several thresholds reading the grid once.
+//
+static PyObject *surfaces_py2(PyObject *, PyObject *args, PyObject *keywds)
+{
+  PyObject *py_data, *py_bounds = NULL;
+  FArray thresholds;
+  int cap_faces = 1, return_normals = 0, threads = 1, block_size = 8;
+  const char *kwlist[] = {"data", "thresholds", "cap_faces", "calculate_normals",
+			  "threads", "block_bounds", "block_size", NULL};
+  if (!PyArg_ParseTupleAndKeywords(args, keywds, const_cast<char *>("OO&|ppiOi"),
+				   (char **)kwlist,
+				   &py_data, parse_float_n_array, &thresholds,
+				   &cap_faces, &return_normals, &threads,
+				   &py_bounds, &block_size))
+    return NULL;
+
+  Numeric_Array data;
+  if (!array_from_python(py_data, 3, &data))
+    return NULL;
+
+  Numeric_Array bounds;
+  if (py_bounds && py_bounds != Py_None)
+    {
+      if (!array_from_python(py_bounds, 4, data.value_type(), &bounds, false) ||
+	  !check_block_bounds(data, bounds, block_size))
+	return NULL;
+    }
 
+  FArray tc = thresholds.contiguous_array();
+  int n = static_cast<int>(tc.size());
+  std::vector<Contour_Surface *> cs(n);
   Py_BEGIN_ALLOW_THREADS
-  cs->geometry(vxyz, reinterpret_cast<VIndex *>(tvi));
+  call_template_function(contour_surfaces, data.value_type(),
+  			 (data, tc.values(), n, cap_faces, threads, bounds, block_size,
+			  cs.data()));
+  Py_END_ALLOW_THREADS
+
+  PyObject *geom = PyList_New(n);
+  for (int i = 0 ; i < n ; ++i)
+    PyList_SET_ITEM(geom, i, surface_geometry(cs[i], return_normals));
+  return geom;
+}
+
+// ----------------------------------------------------------------------------
+//
+extern "C" PyObject *surfaces_py(PyObject *s, PyObject *args, PyObject *keywds)
+{
+  try
+    {
+      return surfaces_py2(s, args, keywds);
+    }
+  catch (std::bad_alloc&)
+    {
+      PyErr_SetString(PyExc_MemoryError, "Out of memory");
+      return NULL;
+    }
+}
+
+// ----------------------------------------------------------------------------
+//
+template <class T>
+void contour_update(const Reference_Counted_Array::Array<T> &data,
+		    float threshold, bool cap_faces, int k2_min, int k2_max,
+		    const Surface_Arrays &previous, Contour_Surface **cs)
+{
+  AIndex size[3] = {static_cast<AIndex>(data.size(2)),
+		    static_cast<AIndex>(data.size(1)),
+		    static_cast<AIndex>(data.size(0))};
+  GIndex stride[3] = {data.stride(2), data.stride(1), data.stride(0)};
+  *cs = surface_update(data.values(), size, stride, threshold, cap_faces,
+		       static_cast<AIndex>(k2_min), static_cast<AIndex>(k2_max),
+		       previous);
+}
+
+// ----------------------------------------------------------------------------
+// Update a surface after data values changed in the grid index box ijk_min
+// to ijk_max.  Only grid planes near the change along the slowest varying
+// data axis are recontoured.  The previous geometry must be unmodified
+// output from contour_surface() with plane_ends = True and the same
+// threshold and cap_faces values.
+//
+static PyObject *surface_update_py2(PyObject *, PyObject *args, PyObject *keywds)
+{
+  PyObject *py_data, *py_normals = NULL;
+  float threshold;
+  FArray vertices, normals;
+  IArray triangles, vertex_ends, triangle_ends;
+  int ijk_min[3], ijk_max[3];
+  int cap_faces = 1;
+  Output_Buffers buffers;
+  const char *kwlist[] = {"data", "threshold", "vertices", "triangles",
+			  "vertex_plane_ends", "triangle_plane_ends",
+			  "ijk_min", "ijk_max", "normals", "cap_faces",
+			  "vertex_buffer", "triangle_buffer", "normal_buffer", NULL};
+  if (!PyArg_ParseTupleAndKeywords(args, keywds, const_cast<char *>("OfO&O&O&O&O&O&|OpOOO"),
+				   (char **)kwlist,
+				   &py_data, &threshold,
+				   parse_float_n3_array, &vertices,
+				   parse_int_n3_array, &triangles,
+				   parse_int_n_array, &vertex_ends,
+				   parse_int_n_array, &triangle_ends,
+				   parse_int_3_array, &ijk_min[0],
+				   parse_int_3_array, &ijk_max[0],
+				   &py_normals, &cap_faces,
+				   &buffers.vertices, &buffers.triangles,
+				   &buffers.normals))
+    return NULL;
+
+  Numeric_Array data;
+  if (!array_from_python(py_data, 3, &data))
+    return NULL;
+
+  bool return_normals = (py_normals && py_normals != Py_None);
   if (return_normals)
-      cs->normals(nxyz);
+    {
+      if (!parse_float_n3_array(py_normals, &normals))
+	return NULL;
+      if (normals.size(0) != vertices.size(0))
+	{
+	  PyErr_SetString(PyExc_TypeError, "contour_surface_update: normals and vertices arrays have different sizes");
+	  return NULL;
+	}
+    }
 
-  delete cs;
+  int64_t planes = data.size(0);
+  if (vertex_ends.size(0) != planes || triangle_ends.size(0) != planes)
+    {
+      PyErr_SetString(PyExc_TypeError, "contour_surface_update: plane end arrays must have size equal to data.shape[0]");
+      return NULL;
+    }
+
+  FArray vc = vertices.contiguous_array(), nc = normals.contiguous_array();
+  IArray tc = triangles.contiguous_array();
+  IArray vec = vertex_ends.contiguous_array(), tec = triangle_ends.contiguous_array();
+  std::vector<TIndex> te(planes);
+  for (int64_t k = 0 ; k < planes ; ++k)
+    te[k] = tec.values()[k];
+  if (planes > 0 && (vec.values()[planes-1] != vc.size(0) || te[planes-1] != tc.size(0)))
+    {
+      PyErr_SetString(PyExc_TypeError, "contour_surface_update: plane ends do not match vertex and triangle arrays");
+      return NULL;
+    }
+
+  Surface_Arrays previous;
+  previous.vertex_count = static_cast<VIndex>(vc.size(0));
+  previous.triangle_count = tc.size(0);
+  previous.vertex_xyz = vc.values();
+  previous.normals = (return_normals ? nc.values() : NULL);
+  previous.triangle_vertex_indices = reinterpret_cast<const VIndex *>(tc.values());
+  previous.vertex_plane_ends = reinterpret_cast<const VIndex *>(vec.values());
+  previous.triangle_plane_ends = te.data();
+
+  // Previous geometry is read while the new geometry is written.
+  PyObject *out[3] = {buffers.vertices, buffers.triangles, buffers.normals};
+  for (int b = 0 ; b < 3 ; ++b)
+    if (buffer_overlaps(out[b], vc.values(), 12*vc.size(0)) ||
+	buffer_overlaps(out[b], tc.values(), 12*tc.size(0)) ||
+	buffer_overlaps(out[b], previous.normals, 12*vc.size(0)))
+      {
+	PyErr_SetString(PyExc_ValueError, "contour_surface_update: output buffers cannot share memory with the previous surface arrays");
+	return NULL;
+      }
+
+  int k2_min = (ijk_min[2] > 0 ? ijk_min[2] : 0), k2_max = ijk_max[2];
+  if (k2_max < k2_min)
+    { k2_min = 1; k2_max = 0; }	// No planes changed.
+
+  Contour_Surface *cs;
+  Py_BEGIN_ALLOW_THREADS
+  call_template_function(contour_update, data.value_type(),
+  			 (data, threshold, cap_faces, k2_min, k2_max, previous, &cs));
   Py_END_ALLOW_THREADS
 
-  PyObject *geom = (return_normals ?
-		    python_tuple(vertex_xyz, tv_indices, normals) :
-		    python_tuple(vertex_xyz, tv_indices));
-  return geom;
+  return surface_geometry(cs, return_normals, planes, buffers);
 }
 
 // ----------------------------------------------------------------------------
 //
-extern "C" PyObject *surface_py(PyObject *s, PyObject *args, PyObject *keywds)
+extern "C" PyObject *surface_update_py(PyObject *s, PyObject *args, PyObject *keywds)
 {
   try
     {
-      return surface_py2(s, args, keywds);
+      return surface_update_py2(s, args, keywds);
     }
   catch (std::bad_alloc&)
     {
@@ -30,7 +30,10 @@
 extern "C" {
 
 PyObject *surface_py(PyObject *s, PyObject *args, PyObject *keywds);
+PyObject *surfaces_py(PyObject *s, PyObject *args, PyObject *keywds);
+PyObject *surface_update_py(PyObject *s, PyObject *args, PyObject *keywds);
 PyObject *reverse_triangle_vertex_order(PyObject *, PyObject *args);
+PyObject *contour_block_bounds(PyObject *, PyObject *args, PyObject *keywds);
 
 }
 
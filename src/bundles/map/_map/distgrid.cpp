@@ -31,9 +31,17 @@
 //
 #include <Python.h>			// use PyObject
 #include <math.h>			// use ceil(), floor(), sqrt()
+#include <string.h>			// use strcmp()
+
+#include <algorithm>			// use std::max
+#include <vector>			// use std::vector
 
 #include <arrays/pythonarray.h>		// use array_from_python()
 #include <arrays/rcarray.h>		// use FArray
+#include <arrays/threadpool.h>		// use Thread_Pool::run()
+#include <arrays/trace.h>		// use TRACE_SCOPE_ITEMS()
+
+#include "distgrid.h"
 
 // -----------------------------------------------------------------------------
 //
@@ -47,9 +55,12 @@ static inline int clamp(int x, int limit)
 }
 
 // -----------------------------------------------------------------------------
+// Compute distances for grid planes k0 to k1-1.  Each thread fills its own
+// slab of planes, skipping spheres that do not reach the slab.
 //
-static void sphere_surface_distance(const FArray &centers, const FArray &radii,
-				    float maxrange, FArray &matrix)
+static void sphere_surface_distance_planes(const FArray &centers, const FArray &radii,
+					   float maxrange, FArray &matrix,
+					   int k0, int k1)
 {
   const int64_t *msize = matrix.sizes();
   int64_t n = centers.size(0);
@@ -73,7 +84,9 @@ static void sphere_surface_distance(const FArray &centers, const FArray &radii,
 	  ijk_min[p] = clamp((int)ceil(x-(r+maxrange)), msize[2-p]);
 	  ijk_max[p] = clamp((int)floor(x+(r+maxrange)), msize[2-p]);
 	}
-      for (int k = ijk_min[2] ; k <= ijk_max[2] ; ++k)
+      int kmin = (ijk_min[2] > k0 ? ijk_min[2] : k0);
+      int kmax = (ijk_max[2] < k1-1 ? ijk_max[2] : k1-1);
+      for (int k = kmin ; k <= kmax ; ++k)
 	{
 	  float dk = (k-cijk[2]);
 	  float k2 = dk*dk;
@@ -95,6 +108,182 @@ static void sphere_surface_distance(const FArray &centers, const FArray &radii,
     }
 }
 
+// -----------------------------------------------------------------------------
+// Run function f(k0, k1, t) for ranges of planes on shared pool threads t,
+// with t less than threads.
+//
+template <class Plane_Range_Function>
+static void thread_planes(int64_t nplanes, int threads, Plane_Range_Function f)
+{
+  int64_t nt = Thread_Pool::thread_count(nplanes, 1, std::max(threads, 1));
+  Thread_Pool::run(nt, [&](int t) { f((t*nplanes)/nt, ((t+1)*nplanes)/nt, t); });
+}
+
+// -----------------------------------------------------------------------------
+// Set grid values to the distance to the closest sphere surface if smaller
+// than the current value, checking each sphere over a box of grid points.
+//
+void sphere_surface_distance(const FArray &centers, const FArray &radii,
+			     float maxrange, FArray &matrix, int threads)
+{
+  thread_planes(matrix.size(0), threads,
+		[&](int64_t k0, int64_t k1, int64_t)
+		{ sphere_surface_distance_planes(centers, radii, maxrange, matrix,
+						 static_cast<int>(k0), static_cast<int>(k1)); });
+}
+
+// -----------------------------------------------------------------------------
+// Nearest sphere at each grid point found by propagating sphere indices
+// between neighbor grid points in sweeps along each axis, so the cost does
+// not depend on sphere radius.  The distance at each point is computed
+// exactly from the propagated sphere.
+//
+class Sphere_Sweep
+{
+public:
+  Sphere_Sweep(const FArray &centers, const FArray &radii, const int64_t *msize) :
+    ca(centers.values()), cs0(centers.stride(0)), cs1(centers.stride(1)),
+    ra(radii.values()), rs0(radii.stride(0)), n(centers.size(0))
+  {
+    for (int a = 0 ; a < 3 ; ++a)
+      size[a] = msize[a];
+    int64_t gs = size[0]*size[1]*size[2];
+    nearest.resize(gs, -1);
+    distance.resize(gs);
+  }
+
+  // Distance from grid point (k,j,i) to surface of sphere c.
+  float sphere_distance(int64_t k, int64_t j, int64_t i, int c) const
+  {
+    const float *x = ca + cs0*c;
+    float di = i - x[0], dj = j - x[cs1], dk = k - x[2*cs1];
+    return sqrt(di*di + dj*dj + dk*dk) - ra[c*rs0];
+  }
+
+  // Grid points near each sphere center start with the nearest of those spheres.
+  void seed()
+  {
+    for (int c = 0 ; c < n ; ++c)
+      {
+	if (ra[c*rs0] == 0)
+	  continue;
+	const float *x = ca + cs0*c;
+	int64_t ijk[3];
+	for (int a = 0 ; a < 3 ; ++a)
+	  ijk[a] = clamp((int)floor(x[a*cs1] + 0.5), size[2-a]);
+	for (int64_t k = ijk[2]-1 ; k <= ijk[2]+1 ; ++k)
+	  for (int64_t j = ijk[1]-1 ; j <= ijk[1]+1 ; ++j)
+	    for (int64_t i = ijk[0]-1 ; i <= ijk[0]+1 ; ++i)
+	      if (k >= 0 && k < size[0] && j >= 0 && j < size[1] && i >= 0 && i < size[2])
+		{
+		  int64_t g = (k*size[1] + j)*size[2] + i;
+		  float d = sphere_distance(k, j, i, c);
+		  if (nearest[g] < 0 || d < distance[g])
+		    {
+		      nearest[g] = c;
+		      distance[g] = d;
+		    }
+		}
+      }
+  }
+
+  // Sweep lines along one axis in both directions for lines l0 to l1-1.
+  // Returns true if any grid point changed nearest sphere.
+  bool sweep_lines(int axis, int64_t l0, int64_t l1)
+  {
+    int64_t st[3] = {size[1]*size[2], size[2], 1};
+    int a1 = (axis+1)%3, a2 = (axis+2)%3;
+    int64_t len = size[axis], step = st[axis];
+    bool changed = false;
+    for (int64_t l = l0 ; l < l1 ; ++l)
+      {
+	int64_t ijk[3];
+	ijk[axis] = 0;
+	ijk[a1] = l / size[a2];
+	ijk[a2] = l % size[a2];
+	int64_t g0 = ijk[0]*st[0] + ijk[1]*st[1] + ijk[2]*st[2];
+	for (int dir = 0 ; dir < 2 ; ++dir)
+	  for (int64_t s = 1 ; s < len ; ++s)
+	    {
+	      int64_t p = (dir == 0 ? s : len-1-s), pprev = (dir == 0 ? p-1 : p+1);
+	      int c = nearest[g0 + pprev*step];
+	      int64_t g = g0 + p*step;
+	      if (c < 0 || c == nearest[g])
+		continue;
+	      ijk[axis] = p;
+	      float d = sphere_distance(ijk[0], ijk[1], ijk[2], c);
+	      if (nearest[g] < 0 || d < distance[g])
+		{
+		  nearest[g] = c;
+		  distance[g] = d;
+		  changed = true;
+		}
+	    }
+      }
+    return changed;
+  }
+
+  std::vector<int> nearest;
+  std::vector<float> distance;
+  int64_t size[3];
+
+private:
+  const float *ca;
+  int64_t cs0, cs1;
+  const float *ra;
+  int64_t rs0, n;
+};
+
+const int MAX_SWEEPS = 4;
+
+// -----------------------------------------------------------------------------
+// Same result as sphere_surface_distance() for grid points within maxrange of
+// a sphere surface when the matrix starts with values of at most maxrange.
+//
+static void sphere_surface_distance_sweep(const FArray &centers, const FArray &radii,
+					  float maxrange, FArray &matrix, int threads)
+{
+  Sphere_Sweep ss(centers, radii, matrix.sizes());
+  ss.seed();
+  const int64_t *size = ss.size;
+  for (int sweep = 0 ; sweep < MAX_SWEEPS ; ++sweep)
+    {
+      bool changed = false;
+      for (int axis = 2 ; axis >= 0 ; --axis)
+	{
+	  int64_t nlines = (size[0]*size[1]*size[2]) / size[axis];
+	  std::vector<char> tchanged(threads > 1 ? threads : 1, 0);
+	  thread_planes(nlines, threads,
+			[&ss, axis, &tchanged](int64_t l0, int64_t l1, int64_t t)
+			{ if (ss.sweep_lines(axis, l0, l1)) tchanged[t] = 1; });
+	  for (auto c : tchanged)
+	    if (c)
+	      changed = true;
+	}
+      if (!changed)
+	break;
+    }
+
+  float *ma = matrix.values();
+  int64_t ms0 = matrix.stride(0), ms1 = matrix.stride(1), ms2 = matrix.stride(2);
+  thread_planes(size[0], threads,
+		[&](int64_t k0, int64_t k1, int64_t)
+		{
+		  for (int64_t k = k0 ; k < k1 ; ++k)
+		    for (int64_t j = 0 ; j < size[1] ; ++j)
+		      for (int64_t i = 0 ; i < size[2] ; ++i)
+			{
+			  int64_t g = (k*size[1] + j)*size[2] + i;
+			  if (ss.nearest[g] < 0)
+			    continue;
+			  float d = ss.distance[g];
+			  float *mijk = ma + (k*ms0+j*ms1+i*ms2);
+			  if (d <= maxrange && d < *mijk)
+			    *mijk = d;
+			}
+		});
+}
+
 // ----------------------------------------------------------------------------
 //
 extern "C" PyObject *py_sphere_surface_distance(PyObject *, PyObject *args,
@@ -102,15 +291,27 @@ extern "C" PyObject *py_sphere_surface_distance(PyObject *, PyObject *args,
 {
   FArray centers, radii, matrix;
   float maxrange;
-  const char *kwlist[] = {"centers", "radii", "maxrange", "matrix", NULL};
+  int threads = 1;
+  const char *method = "stamp";
+  const char *kwlist[] = {"centers", "radii", "maxrange", "matrix", "threads",
+			  "method", NULL};
   if (!PyArg_ParseTupleAndKeywords(args, keywds,
-				   const_cast<char *>("O&O&fO&"), (char **)kwlist,
+				   const_cast<char *>("O&O&fO&|is"), (char **)kwlist,
 				   parse_float_n3_array, &centers,
 				   parse_float_n_array, &radii,
 				   &maxrange,
-				   parse_writable_float_3d_array, &matrix))
+				   parse_writable_float_3d_array, &matrix,
+				   &threads, &method))
     return NULL;
 
+  bool sweep = (strcmp(method, "sweep") == 0);
+  if (!sweep && strcmp(method, "stamp") != 0)
+    {
+      PyErr_Format(PyExc_ValueError,
+		   "Method must be 'stamp' or 'sweep', got '%s'", method);
+      return NULL;
+    }
+
   if (radii.size(0) != centers.size(0))
     {
       PyErr_SetString(PyExc_TypeError,
@@ -119,7 +320,11 @@ extern "C" PyObject *py_sphere_surface_distance(PyObject *, PyObject *args,
     }
 
   Py_BEGIN_ALLOW_THREADS
-  sphere_surface_distance(centers, radii, maxrange, matrix);
+  TRACE_SCOPE_ITEMS("map.sphere_surface_distance", centers.size(0));
+  if (sweep)
+    sphere_surface_distance_sweep(centers, radii, maxrange, matrix, threads);
+  else
+    sphere_surface_distance(centers, radii, maxrange, matrix, threads);
   Py_END_ALLOW_THREADS
 
   return python_none();
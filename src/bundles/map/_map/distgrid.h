@@ -29,6 +29,14 @@
 
 #include <Python.h>			// use PyObject
 
+#include <arrays/rcarray.h>		// use FArray
+
+// Set matrix values to the distance from the closest sphere surface if that
+// is smaller than the current value, out to maxrange from each sphere.
+// Centers and radii are in grid index units.
+void sphere_surface_distance(const FArray &centers, const FArray &radii,
+			     float maxrange, FArray &matrix, int threads);
+
 extern "C"
 {
 PyObject *py_sphere_surface_distance(PyObject *s, PyObject *args, PyObject *keywds);
@@ -28,9 +28,11 @@
 //
 #include <Python.h>			// use PyObject	
 #include <math.h>			// use fmod()
+#include <vector>			// use std::vector
 
 #include <arrays/pythonarray.h>		// use array_from_python(), ...
 #include <arrays/rcarray.h>		// use Array<T>, Numeric_Array
+#include <arrays/threadpool.h>		// use Thread_Pool::parallel_for()
 using Reference_Counted_Array::Numeric_Array;
 
 namespace Map_Cpp
@@ -72,45 +74,42 @@ bool interpolate(const T *ia,
 }
 
 // ----------------------------------------------------------------------------
+// Output planes k0 to k1-1.  Each symmetry has been combined with the output
+// to input index transform so each grid point needs one transform per symmetry.
 //
 template <class T>
-void extend_map(const Reference_Counted_Array::Array<T> &in, int cell_size[3],
-		const FArray &syms, FArray &out, float out_to_in_tf[3][4],
-		int64_t *nmiss, float *dmax)
+void extend_planes(const Reference_Counted_Array::Array<T> &in, int cell_size[3],
+		   const std::vector<float> &out_to_sym, FArray &out,
+		   int64_t k0, int64_t k1, int64_t *nmiss, float *dmax)
 {
   int64_t kinsz = in.size(0), jinsz = in.size(1), iinsz = in.size(2);
   int64_t kinst = in.stride(0), jinst = in.stride(1), iinst = in.stride(2);
   const T *ia = in.values();
 
-  int64_t ksz = out.size(0), jsz = out.size(1), isz = out.size(2);
+  int64_t jsz = out.size(1), isz = out.size(2);
   int64_t kst = out.stride(0), jst = out.stride(1), ist = out.stride(2);
   float *oa = out.values();
 
   int csi = cell_size[0], csj = cell_size[1], csk = cell_size[2];
 
-  int64_t nsym = syms.size(0);
-  float *sa = syms.values();
-
-  float *oi = &out_to_in_tf[0][0];
+  int64_t nsym = out_to_sym.size() / 12;
+  const float *sa = out_to_sym.data();
 
   *nmiss = 0;
   *dmax = 0;
 
-  for (int64_t k = 0 ; k < ksz ; ++k)
+  for (int64_t k = k0 ; k < k1 ; ++k)
     for (int64_t j = 0 ; j < jsz ; ++j)
       for (int64_t i = 0 ; i < isz ; ++i)
 	{
-	  float ini = oi[0]*i + oi[1]*j + oi[2]*k + oi[3];
-	  float inj = oi[4]*i + oi[5]*j + oi[6]*k + oi[7];
-	  float ink = oi[8]*i + oi[9]*j + oi[10]*k + oi[11];
 	  int inside = 0;
 	  float vsum = 0, vmin = 0, vmax = 0;
 	  for (int64_t s = 0 ; s < nsym ; ++s)
 	    {
-	      float *sym = &sa[s*12];
-	      float si = sym[0]*ini + sym[1]*inj + sym[2]*ink + sym[3];
-	      float sj = sym[4]*ini + sym[5]*inj + sym[6]*ink + sym[7];
-	      float sk = sym[8]*ini + sym[9]*inj + sym[10]*ink + sym[11];
+	      const float *sym = &sa[s*12];
+	      float si = sym[0]*i + sym[1]*j + sym[2]*k + sym[3];
+	      float sj = sym[4]*i + sym[5]*j + sym[6]*k + sym[7];
+	      float sk = sym[8]*i + sym[9]*j + sym[10]*k + sym[11];
 	      float usi = wrap(si, csi);
 	      float usj = wrap(sj, csj);
 	      float usk = wrap(sk, csk);
@@ -146,6 +145,51 @@ void extend_map(const Reference_Counted_Array::Array<T> &in, int cell_size[3],
 	}		 
 }
 
+// ----------------------------------------------------------------------------
+// Output planes are computed in parallel.
+//
+template <class T>
+void extend_map(const Reference_Counted_Array::Array<T> &in, int cell_size[3],
+		const FArray &syms, FArray &out, float out_to_in_tf[3][4],
+		int64_t *nmiss, float *dmax)
+{
+  // Combine each symmetry with the output to input transform.
+  int64_t nsym = syms.size(0);
+  const float *sa = syms.values();
+  std::vector<float> out_to_sym(12*nsym);
+  for (int64_t s = 0 ; s < nsym ; ++s)
+    {
+      const float *sym = sa + 12*s;
+      float *st = &out_to_sym[12*s];
+      for (int r = 0 ; r < 3 ; ++r)
+	for (int c = 0 ; c < 4 ; ++c)
+	  {
+	    double v = (c == 3 ? sym[4*r+3] : 0);
+	    for (int a = 0 ; a < 3 ; ++a)
+	      v += (double)sym[4*r+a] * out_to_in_tf[a][c];
+	    st[4*r+c] = (float)v;
+	  }
+    }
+
+  int64_t ksz = out.size(0);
+  std::vector<int64_t> plane_nmiss(ksz, 0);
+  std::vector<float> plane_dmax(ksz, 0);
+  Thread_Pool::parallel_for(ksz, [&](int64_t k0, int64_t k1) {
+      for (int64_t k = k0 ; k < k1 ; ++k)
+	extend_planes(in, cell_size, out_to_sym, out, k, k+1,
+		      &plane_nmiss[k], &plane_dmax[k]);
+    });
+
+  *nmiss = 0;
+  *dmax = 0;
+  for (int64_t k = 0 ; k < ksz ; ++k)
+    {
+      *nmiss += plane_nmiss[k];
+      if (plane_dmax[k] > *dmax)
+	*dmax = plane_dmax[k];
+    }
+}
+
 // ----------------------------------------------------------------------------
 //
 extern "C" PyObject *
@@ -187,8 +231,10 @@ extend_crystal_map(PyObject *, PyObject *args, PyObject *keywds)
 
   int64_t nmiss;
   float dmax;
+  Py_BEGIN_ALLOW_THREADS
   call_template_function(extend_map, in.value_type(),
   			 (in, csize, syms, out, oitf, &nmiss, &dmax));
+  Py_END_ALLOW_THREADS
 
   PyObject *py_nmiss = PyLong_FromLong(nmiss);
   PyObject *py_dmax = PyFloat_FromDouble(dmax);
@@ -0,0 +1,618 @@
+/*
+ * === UCSF ChimeraX Copyright ===
+ * Copyright 2022 Regents of the University of California. All rights reserved.
+ * The ChimeraX application is provided pursuant to the ChimeraX license
+ * agreement, which covers academic and commercial uses. For more details, see
+ * <http://www.rbvi.ucsf.edu/chimerax/docs/licensing.html>
+ *
+ * This particular file is part of the ChimeraX library. You can also
+ * redistribute and/or modify it under the terms of the GNU Lesser General
+ * Public License version 2.1 as published by the Free Software Foundation.
+ * For more details, see
+ * <https://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESSED OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. ADDITIONAL LIABILITY
+ * LIMITATIONS ARE DESCRIBED IN THE GNU LESSER GENERAL PUBLIC LICENSE
+ * VERSION 2.1
+ *
+ * This notice must be embedded in or attached to all copies, including partial
+ * copies, of the software or any revisions or derivations thereof.
+ * === UCSF ChimeraX Copyright ===
+ */
+
+// ----------------------------------------------------------------------------
+// Gaussian and median filtering of 3-d arrays without the Fourier transforms
+// and array copies of the numpy versions.
+//
+#include <Python.h>			// use PyObject
+#include <math.h>			// use exp(), sqrt()
+
+#include <algorithm>			// use std::min, std::max, std::sort
+#include <limits>			// use std::numeric_limits
+#include <type_traits>			// use std::is_integral
+#include <vector>			// use std::vector
+
+#include <arrays/pythonarray.h>		// use array_from_python()
+#include <arrays/rcarray.h>		// use Numeric_Array, Array<T>
+#include <arrays/threadpool.h>		// use Thread_Pool::thread_count(), run(), parallel_for()
+
+namespace Map_Cpp
+{
+// ----------------------------------------------------------------------------
+// Lines along the filtered axis are copied to a buffer in blocks of this many
+// neighboring lines so reading and writing the array uses whole cache lines
+// and the convolution loop over a block vectorizes.
+//
+const int64_t LINE_BLOCK = 16;
+
+// The recursive filter approximates a Gaussian to about 1% for standard
+// deviations of 3 grid points or more and is worse for narrower Gaussians.
+const float RECURSIVE_MIN_SDEV = 3;
+
+// ----------------------------------------------------------------------------
+// Filter for one axis.  Lines have pad zeros before and after them so the
+// result matches zero values beyond the array edges.  The truncated
+// Gaussian kernel is applied directly, or a recursive filter (Young and
+// van Vliet, Signal Processing 44:139, 1995) takes a fixed number of
+// operations per value whatever the width.
+//
+class Axis_Filter
+{
+public:
+  Axis_Filter(int64_t size, float sdev, float cutoff, bool recursive);
+  // Buffer holds (n+2*pad)*LINE_BLOCK values, result n*LINE_BLOCK values.
+  void filter(const float *buf, float *result, int64_t n, double *work) const;
+
+  int64_t pad;
+  bool recursive;
+private:
+  std::vector<float> weights;	// Kernel from center outward
+  double bscale, a1, a2, a3;	// Recursive filter coefficients
+};
+
+// ----------------------------------------------------------------------------
+//
+Axis_Filter::Axis_Filter(int64_t size, float sdev, float cutoff, bool recursive) :
+  recursive(recursive && sdev >= RECURSIVE_MIN_SDEV)
+{
+  if (this->recursive)
+    {
+      // Pad ends of line far enough that the forward pass has decayed.
+      pad = static_cast<int64_t>((cutoff > 0 ? cutoff : 5) * sdev + 1);
+      double s = sdev;
+      double q = (s >= 2.5 ? 0.98711*s - 0.96330 : 3.97156 - 4.14554*sqrt(1 - 0.26891*s));
+      double q2 = q*q, q3 = q2*q;
+      double b0 = 1.57825 + 2.44413*q + 1.4281*q2 + 0.422205*q3;
+      a1 = (2.44413*q + 2.85619*q2 + 1.26661*q3) / b0;
+      a2 = -(1.4281*q2 + 1.26661*q3) / b0;
+      a3 = 0.422205*q3 / b0;
+      bscale = 1 - (a1 + a2 + a3);
+      return;
+    }
+
+  int64_t hw = size/2;
+  if (cutoff > 0 && static_cast<int64_t>(cutoff*sdev+1) < hw)
+    hw = static_cast<int64_t>(cutoff*sdev+1);
+  pad = hw;
+  weights.resize(hw+1);
+  double sum = 0;
+  for (int64_t q = 0 ; q <= hw ; ++q)
+    {
+      double u = q / sdev;
+      weights[q] = exp(-0.5*u*u);
+      sum += (q == 0 ? weights[q] : 2*weights[q]);
+    }
+  for (int64_t q = 0 ; q <= hw ; ++q)
+    weights[q] /= sum;
+}
+
+// ----------------------------------------------------------------------------
+//
+void Axis_Filter::filter(const float *buf, float *result, int64_t n, double *work) const
+{
+  const int64_t B = LINE_BLOCK;
+  const float *c = buf + pad*B;
+  if (!recursive)
+    {
+      int64_t hw = weights.size() - 1;
+      const float *w = weights.data();
+      for (int64_t p = 0 ; p < n ; ++p)
+	{
+	  float *r = result + p*B;
+	  const float *cp = c + p*B;
+	  for (int64_t b = 0 ; b < B ; ++b)
+	    r[b] = w[0]*cp[b];
+	  for (int64_t q = 1 ; q <= hw ; ++q)
+	    {
+	      const float *lo = cp - q*B, *hi = cp + q*B;
+	      float wq = w[q];
+	      for (int64_t b = 0 ; b < B ; ++b)
+		r[b] += wq*(lo[b] + hi[b]);
+	    }
+	}
+      return;
+    }
+
+  // Forward pass from line start through the trailing zeros, then backward
+  // pass in place, starting with zero values before and after.
+  int64_t m = n + pad;
+  double zero[LINE_BLOCK] = {0};
+  for (int64_t p = 0 ; p < m ; ++p)
+    {
+      double *w = work + p*B;
+      const double *w1 = (p >= 1 ? w - B : zero), *w2 = (p >= 2 ? w - 2*B : zero),
+	*w3 = (p >= 3 ? w - 3*B : zero);
+      const float *x = c + p*B;
+      for (int64_t b = 0 ; b < B ; ++b)
+	w[b] = bscale*x[b] + a1*w1[b] + a2*w2[b] + a3*w3[b];
+    }
+  for (int64_t p = m-1 ; p >= 0 ; --p)
+    {
+      double *y = work + p*B;
+      const double *y1 = (p+1 < m ? y + B : zero), *y2 = (p+2 < m ? y + 2*B : zero),
+	*y3 = (p+3 < m ? y + 3*B : zero);
+      for (int64_t b = 0 ; b < B ; ++b)
+	y[b] = bscale*y[b] + a1*y1[b] + a2*y2[b] + a3*y3[b];
+    }
+  for (int64_t i = 0 ; i < n*B ; ++i)
+    result[i] = static_cast<float>(work[i]);
+}
+
+// ----------------------------------------------------------------------------
+// Filter lines along axis for index u0 through u1-1 of the slower of the
+// other two axes.  The result can be the input array.
+//
+template<class T>
+static void filter_lines(const T *in, const int64_t *in_strides,
+			 float *out, const int64_t *out_strides, const int64_t *size,
+			 int axis, const Axis_Filter &f, int64_t u0, int64_t u1)
+{
+  int ua = (axis == 0 ? 1 : 0), va = (axis == 2 ? 1 : 2);
+  int64_t n = size[axis], nv = size[va];
+  int64_t ia = in_strides[axis], iu = in_strides[ua], iv = in_strides[va];
+  int64_t oa = out_strides[axis], ou = out_strides[ua], ov = out_strides[va];
+  const int64_t B = LINE_BLOCK;
+  int64_t pad = f.pad;
+  std::vector<float> buf((n+2*pad)*B, 0), res(n*B);
+  std::vector<double> work(f.recursive ? (n+pad)*B : 0);
+  float *bp = buf.data() + pad*B;
+  for (int64_t u = u0 ; u < u1 ; ++u)
+    for (int64_t v0 = 0 ; v0 < nv ; v0 += B)
+      {
+	int64_t nb = std::min(B, nv - v0);
+	const T *ib = in + u*iu + v0*iv;
+	if (ia <= iv)
+	  for (int64_t b = 0 ; b < nb ; ++b)
+	    for (int64_t p = 0 ; p < n ; ++p)
+	      bp[p*B+b] = static_cast<float>(ib[b*iv + p*ia]);
+	else
+	  for (int64_t p = 0 ; p < n ; ++p)
+	    for (int64_t b = 0 ; b < nb ; ++b)
+	      bp[p*B+b] = static_cast<float>(ib[b*iv + p*ia]);
+
+	f.filter(buf.data(), res.data(), n, work.data());
+
+	float *ob = out + u*ou + v0*ov;
+	if (oa <= ov)
+	  for (int64_t b = 0 ; b < nb ; ++b)
+	    for (int64_t p = 0 ; p < n ; ++p)
+	      ob[b*ov + p*oa] = res[p*B+b];
+	else
+	  for (int64_t p = 0 ; p < n ; ++p)
+	    for (int64_t b = 0 ; b < nb ; ++b)
+	      ob[b*ov + p*oa] = res[p*B+b];
+      }
+}
+
+// ----------------------------------------------------------------------------
+// Lines are divided among shared pool threads in chunks by their index on
+// the slower other axis.
+//
+template<class T>
+static void filter_axis(const T *in, const int64_t *in_strides,
+			float *out, const int64_t *out_strides, const int64_t *size,
+			int axis, const Axis_Filter &f, int threads)
+{
+  int64_t nu = size[axis == 0 ? 1 : 0];
+  int nt = Thread_Pool::thread_count(nu, 1, std::max(threads, 1));
+  if (nt <= 1)
+    {
+      filter_lines(in, in_strides, out, out_strides, size, axis, f, 0, nu);
+      return;
+    }
+  int64_t chunk = std::max(static_cast<int64_t>(1), nu / (4*nt));
+  Thread_Pool::parallel_for(nu, [&](int64_t u0, int64_t u1) {
+      filter_lines(in, in_strides, out, out_strides, size, axis, f, u0, u1);
+    }, chunk, nt);
+}
+
+// ----------------------------------------------------------------------------
+// The first axis filtered reads the input array and later axes filter the
+// float result in place.
+//
+template<class T>
+static void gaussian_filter(const Reference_Counted_Array::Array<T> &m,
+			    const float sdev[3], float cutoff, bool recursive,
+			    FArray &r, int threads)
+{
+  int64_t size[3] = {m.size(0), m.size(1), m.size(2)};
+  int64_t in_strides[3] = {m.stride(0), m.stride(1), m.stride(2)};
+  int64_t out_strides[3] = {r.stride(0), r.stride(1), r.stride(2)};
+  bool first = true;
+  for (int axis = 2 ; axis >= 0 ; --axis)
+    {
+      float sd = sdev[2-axis];	// Axes i,j,k are 2,1,0.
+      if (size[axis] <= 1 || sd <= 0)
+	continue;
+      Axis_Filter f(size[axis], sd, cutoff, recursive);
+      if (first)
+	filter_axis(m.values(), in_strides, r.values(), out_strides, size, axis, f, threads);
+      else
+	filter_axis(r.values(), out_strides, r.values(), out_strides, size, axis, f, threads);
+      first = false;
+    }
+
+  if (first && static_cast<void *>(m.values()) != static_cast<void *>(r.values()))
+    {
+      // No axis filtered, copy values.
+      const T *mv = m.values();
+      float *rv = r.values();
+      for (int64_t k = 0 ; k < size[0] ; ++k)
+	for (int64_t j = 0 ; j < size[1] ; ++j)
+	  for (int64_t i = 0 ; i < size[2] ; ++i)
+	    rv[k*out_strides[0]+j*out_strides[1]+i*out_strides[2]] =
+	      static_cast<float>(mv[k*in_strides[0]+j*in_strides[1]+i*in_strides[2]]);
+    }
+}
+
+// ----------------------------------------------------------------------------
+//
+extern "C" PyObject *
+gaussian_filter_array(PyObject *, PyObject *args, PyObject *keywds)
+{
+  Numeric_Array array;
+  float sdev[3], cutoff = 5;
+  FArray result;
+  int recursive = 0, threads = 1;
+  const char *kwlist[] = {"array", "sdev", "result", "cutoff", "recursive", "threads", NULL};
+  if (!PyArg_ParseTupleAndKeywords(args, keywds, const_cast<char *>("O&O&O&|fii"),
+				   (char **)kwlist,
+				   parse_3d_array, &array,
+				   parse_float_3_array, &sdev[0],
+				   parse_writable_float_3d_array, &result,
+				   &cutoff, &recursive, &threads))
+    return NULL;
+
+  if (result.size(0) != array.size(0) ||
+      result.size(1) != array.size(1) ||
+      result.size(2) != array.size(2))
+    {
+      PyErr_Format(PyExc_TypeError, "result array size (%d %d %d) must equal array size (%d %d %d)",
+		   result.size(0), result.size(1), result.size(2),
+		   array.size(0), array.size(1), array.size(2));
+      return NULL;
+    }
+  if (sdev[0] < 0 || sdev[1] < 0 || sdev[2] < 0)
+    {
+      PyErr_Format(PyExc_ValueError, "standard deviations must be >= 0, got %g %g %g",
+		   sdev[0], sdev[1], sdev[2]);
+      return NULL;
+    }
+
+  Py_BEGIN_ALLOW_THREADS
+  call_template_function(gaussian_filter, array.value_type(),
+			 (array, sdev, cutoff, recursive, result, threads));
+  Py_END_ALLOW_THREADS
+  return python_none();
+}
+
+// ----------------------------------------------------------------------------
+// Median filter output planes k0 to k1-1.  Input planes are copied to a ring
+// of 2*hk+1 contiguous planes as the window moves along the first axis.  To
+// filter in place the input planes bordering the slab, which other threads
+// overwrite, are saved before any thread starts filtering.
+//
+// The window values are kept sorted as the window moves along a row, except
+// for 8 and 16-bit integer values, where a histogram is kept and the median
+// bin found by moving from the previous median.
+//
+template<class T>
+class Median_Slab
+{
+public:
+  Median_Slab(const Reference_Counted_Array::Array<T> &m,
+	      const Reference_Counted_Array::Array<T> &r,
+	      const int bin_size[3], int64_t k0, int64_t k1, bool in_place);
+  void save_halo();
+  void filter();
+private:
+  void load_plane(int64_t k);
+  void zero_planes(int64_t ka, int64_t kb);
+  void filter_plane(int64_t k);
+  void sorted_row_median(const T **rows, T *out);
+  void histogram_row_median(const T **rows, T *out);
+  int64_t bin(T v) const
+    { return static_cast<int64_t>(v) - static_cast<int64_t>(std::numeric_limits<T>::min()); }
+
+  const T *mv;
+  T *rv;
+  int64_t ks, js, is, ps;
+  int64_t ms0, ms1, ms2, rs0, rs1, rs2;
+  int64_t hi, hj, hk, k0, k1;
+  bool in_place;
+  std::vector<T> ring, halo, window;
+  std::vector<int> histogram;
+  int64_t median_bin;
+};
+
+// ----------------------------------------------------------------------------
+//
+template<class T>
+Median_Slab<T>::Median_Slab(const Reference_Counted_Array::Array<T> &m,
+			    const Reference_Counted_Array::Array<T> &r,
+			    const int bin_size[3], int64_t k0, int64_t k1, bool in_place) :
+  mv(m.values()), rv(r.values()),
+  ks(m.size(0)), js(m.size(1)), is(m.size(2)), ps(m.size(1)*m.size(2)),
+  ms0(m.stride(0)), ms1(m.stride(1)), ms2(m.stride(2)),
+  rs0(r.stride(0)), rs1(r.stride(1)), rs2(r.stride(2)),
+  hi((bin_size[0]-1)/2), hj((bin_size[1]-1)/2), hk((bin_size[2]-1)/2),
+  k0(k0), k1(k1), in_place(in_place), median_bin(0)
+{
+}
+
+// ----------------------------------------------------------------------------
+//
+template<class T>
+void Median_Slab<T>::save_halo()
+{
+  if (!in_place)
+    return;
+  int64_t lo = std::max(static_cast<int64_t>(0), k0-hk), hi1 = std::min(ks, k1+hk);
+  halo.resize(((k0-lo) + (hi1-k1))*ps);
+  T *h = halo.data();
+  for (int64_t k = lo ; k < hi1 ; ++k)
+    {
+      if (k == k0)
+	k = k1;
+      if (k >= hi1)
+	break;
+      for (int64_t j = 0 ; j < js ; ++j)
+	for (int64_t i = 0 ; i < is ; ++i)
+	  *h++ = mv[k*ms0+j*ms1+i*ms2];
+    }
+}
+
+// ----------------------------------------------------------------------------
+//
+template<class T>
+void Median_Slab<T>::load_plane(int64_t k)
+{
+  T *p = ring.data() + (k % (2*hk+1))*ps;
+  if (in_place && (k < k0 || k >= k1))
+    {
+      int64_t lo = std::max(static_cast<int64_t>(0), k0-hk);
+      int64_t hp = (k < k0 ? k-lo : (k0-lo) + (k-k1));
+      std::copy(halo.begin() + hp*ps, halo.begin() + (hp+1)*ps, p);
+      return;
+    }
+  for (int64_t j = 0 ; j < js ; ++j)
+    for (int64_t i = 0 ; i < is ; ++i)
+      *p++ = mv[k*ms0+j*ms1+i*ms2];
+}
+
+// ----------------------------------------------------------------------------
+//
+template<class T>
+void Median_Slab<T>::zero_planes(int64_t ka, int64_t kb)
+{
+  for (int64_t k = ka ; k < kb ; ++k)
+    for (int64_t j = 0 ; j < js ; ++j)
+      for (int64_t i = 0 ; i < is ; ++i)
+	rv[k*rs0+j*rs1+i*rs2] = 0;
+}
+
+// ----------------------------------------------------------------------------
+//
+template<class T>
+void Median_Slab<T>::filter()
+{
+  int64_t kc0 = std::max(k0, hk), kc1 = std::min(k1, ks-hk);
+  if (kc0 >= kc1)
+    {
+      zero_planes(k0, k1);
+      return;
+    }
+  ring.resize((2*hk+1)*ps);
+  for (int64_t k = kc0-hk ; k < kc0+hk ; ++k)
+    load_plane(k);
+  zero_planes(k0, kc0);
+  for (int64_t k = kc0 ; k < kc1 ; ++k)
+    {
+      load_plane(k+hk);
+      filter_plane(k);
+    }
+  zero_planes(kc1, k1);
+}
+
+// ----------------------------------------------------------------------------
+//
+template<class T>
+void Median_Slab<T>::filter_plane(int64_t k)
+{
+  int64_t nr = 2*hk+1, sj = 2*hj+1;
+  std::vector<const T *> rows(nr*sj);
+  std::vector<T> out(is);
+  for (int64_t j = 0 ; j < js ; ++j)
+    {
+      T *r = rv + k*rs0 + j*rs1;
+      if (j < hj || j >= js-hj || is < 2*hi+1)
+	{
+	  for (int64_t i = 0 ; i < is ; ++i)
+	    r[i*rs2] = 0;
+	  continue;
+	}
+      for (int64_t dk = -hk ; dk <= hk ; ++dk)
+	for (int64_t dj = -hj ; dj <= hj ; ++dj)
+	  rows[(dk+hk)*sj + dj+hj] = ring.data() + ((k+dk) % nr)*ps + (j+dj)*is;
+      if (std::is_integral<T>::value && sizeof(T) <= 2)
+	histogram_row_median(rows.data(), out.data());
+      else
+	sorted_row_median(rows.data(), out.data());
+      for (int64_t i = 0 ; i < hi ; ++i)
+	r[i*rs2] = r[(is-1-i)*rs2] = 0;
+      for (int64_t i = hi ; i < is-hi ; ++i)
+	r[i*rs2] = out[i];
+    }
+}
+
+// ----------------------------------------------------------------------------
+// Replacing a leaving value by an entering value moves the entering value
+// only as far as needed to keep the window sorted.
+//
+template<class T>
+void Median_Slab<T>::sorted_row_median(const T **rows, T *out)
+{
+  int64_t nrows = (2*hk+1)*(2*hj+1), si = 2*hi+1;
+  std::vector<T> &w = window;
+  w.clear();
+  for (int64_t r = 0 ; r < nrows ; ++r)
+    w.insert(w.end(), rows[r], rows[r] + si);
+  std::sort(w.begin(), w.end());
+  int64_t nw = w.size(), mid = nw/2;
+  for (int64_t i = hi ; i < is-hi ; ++i)
+    {
+      out[i] = w[mid];
+      if (i+1 >= is-hi)
+	break;
+      for (int64_t r = 0 ; r < nrows ; ++r)
+	{
+	  T old_value = rows[r][i-hi], new_value = rows[r][i+hi+1];
+	  int64_t p = std::lower_bound(w.begin(), w.end(), old_value) - w.begin();
+	  if (p >= nw)
+	    p = nw-1;
+	  w[p] = new_value;
+	  for ( ; p > 0 && new_value < w[p-1] ; --p)
+	    std::swap(w[p], w[p-1]);
+	  for ( ; p+1 < nw && w[p+1] < new_value ; ++p)
+	    std::swap(w[p], w[p+1]);
+	}
+    }
+}
+
+// ----------------------------------------------------------------------------
+// The median bin is the one where the number of window values in lower bins,
+// lt, is at most half the window size and lt plus the bin count is greater.
+//
+template<class T>
+void Median_Slab<T>::histogram_row_median(const T **rows, T *out)
+{
+  int64_t nrows = (2*hk+1)*(2*hj+1), si = 2*hi+1;
+  std::vector<int> &h = histogram;
+  if (h.empty())
+    h.resize(static_cast<size_t>(1) << (sizeof(T) == 1 ? 8 : 16), 0);
+  int64_t mid = nrows*si/2, med = median_bin, lt = 0;
+  for (int64_t r = 0 ; r < nrows ; ++r)
+    for (int64_t c = 0 ; c < si ; ++c)
+      {
+	int64_t b = bin(rows[r][c]);
+	h[b] += 1;
+	if (b < med)
+	  lt += 1;
+      }
+  T vmin = std::numeric_limits<T>::min();
+  for (int64_t i = hi ; ; ++i)
+    {
+      while (lt > mid)
+	lt -= h[--med];
+      while (lt + h[med] <= mid)
+	lt += h[med++];
+      out[i] = static_cast<T>(med + vmin);
+      if (i+1 >= is-hi)
+	break;
+      for (int64_t r = 0 ; r < nrows ; ++r)
+	{
+	  int64_t bo = bin(rows[r][i-hi]), bn = bin(rows[r][i+hi+1]);
+	  h[bo] -= 1;
+	  h[bn] += 1;
+	  lt += (bn < med) - (bo < med);
+	}
+    }
+  median_bin = med;
+
+  // Empty the histogram for the next row.
+  for (int64_t r = 0 ; r < nrows ; ++r)
+    for (int64_t c = is-si ; c < is ; ++c)
+      h[bin(rows[r][c])] -= 1;
+}
+
+// ----------------------------------------------------------------------------
+// Planes are divided into slabs filtered by shared pool threads.
+//
+template<class T>
+static void median_filter(const Reference_Counted_Array::Array<T> &m,
+			  const Reference_Counted_Array::Array<T> &r,
+			  const int bin_size[3], int threads)
+{
+  bool in_place = (m.values() == r.values());
+  int64_t ks = m.size(0);
+  int nt = Thread_Pool::thread_count(ks, 1, std::max(threads, 1));
+  std::vector<Median_Slab<T>> slabs;
+  for (int t = 0 ; t < nt ; ++t)
+    slabs.push_back(Median_Slab<T>(m, r, bin_size, (t*ks)/nt, ((t+1)*ks)/nt, in_place));
+  if (nt == 1)
+    {
+      slabs[0].filter();
+      return;
+    }
+  Thread_Pool::run(nt, [&](int t) { slabs[t].save_halo(); });
+  Thread_Pool::run(nt, [&](int t) { slabs[t].filter(); });
+}
+
+// ----------------------------------------------------------------------------
+//
+extern "C" PyObject *
+median_filter_array(PyObject *, PyObject *args, PyObject *keywds)
+{
+  Numeric_Array array, result;
+  int bin_size[3], threads = 1;
+  const char *kwlist[] = {"array", "bin_size", "result", "threads", NULL};
+  if (!PyArg_ParseTupleAndKeywords(args, keywds, const_cast<char *>("O&O&O&|i"),
+				   (char **)kwlist,
+				   parse_3d_array, &array,
+				   parse_int_3_array, &bin_size[0],
+				   parse_writable_3d_array, &result,
+				   &threads))
+    return NULL;
+
+  if (array.value_type() != result.value_type())
+    {
+      PyErr_Format(PyExc_TypeError, "result array must have same value type as array");
+      return NULL;
+    }
+  if (result.size(0) != array.size(0) ||
+      result.size(1) != array.size(1) ||
+      result.size(2) != array.size(2))
+    {
+      PyErr_Format(PyExc_TypeError, "result array size (%d %d %d) must equal array size (%d %d %d)",
+		   result.size(0), result.size(1), result.size(2),
+		   array.size(0), array.size(1), array.size(2));
+      return NULL;
+    }
+  for (int a = 0 ; a < 3 ; ++a)
+    if (bin_size[a] < 1 || bin_size[a] % 2 == 0)
+      {
+	PyErr_Format(PyExc_ValueError, "bin sizes must be odd and positive, got %d %d %d",
+		     bin_size[0], bin_size[1], bin_size[2]);
+	return NULL;
+      }
+
+  Py_BEGIN_ALLOW_THREADS
+  call_template_function(median_filter, array.value_type(),
+			 (array, result, bin_size, threads));
+  Py_END_ALLOW_THREADS
+  return python_none();
+}
+
+}	// end of namespace Map_Cpp
@@ -0,0 +1,60 @@
+/*
+ * === UCSF ChimeraX Copyright ===
+ * Copyright 2022 Regents of the University of California. All rights reserved.
+ * The ChimeraX application is provided pursuant to the ChimeraX license
+ * agreement, which covers academic and commercial uses. For more details, see
+ * <http://www.rbvi.ucsf.edu/chimerax/docs/licensing.html>
+ *
+ * This particular file is part of the ChimeraX library. You can also
+ * redistribute and/or modify it under the terms of the GNU Lesser General
+ * Public License version 2.1 as published by the Free Software Foundation.
+ * For more details, see
+ * <https://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESSED OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. ADDITIONAL LIABILITY
+ * LIMITATIONS ARE DESCRIBED IN THE GNU LESSER GENERAL PUBLIC LICENSE
+ * VERSION 2.1
+ *
+ * This notice must be embedded in or attached to all copies, including partial
+ * copies, of the software or any revisions or derivations thereof.
+ * === UCSF ChimeraX Copyright ===
+ */
+
+// ----------------------------------------------------------------------------
+// Gaussian and median filtering of 3-d arrays.
+//
+#ifndef FILTERS_HEADER_INCLUDED
+#define FILTERS_HEADER_INCLUDED
+
+#include <Python.h>			// use PyObject
+
+namespace Map_Cpp
+{
+//
+// Convolve a 3-d array of any value type with a Gaussian, one axis at a time,
+// writing a float32 result array of the same size.  The result can be the
+// input array to filter a float32 array in place.  Standard deviations are
+// in grid index units in i,j,k order and an axis with zero standard deviation
+// or size 1 is not filtered.  Values beyond the array edges are zero and the
+// Gaussian is truncated at cutoff standard deviations, or half the axis size
+// if cutoff is 0.  With recursive true, axes with standard deviation at
+// least 3 use an approximate recursive filter (about 1% error) whose cost
+// does not depend on the width.
+//
+// gaussian_filter_array(array, sdev, result, cutoff = 5, recursive = False, threads = 1)
+extern "C" PyObject *gaussian_filter_array(PyObject *, PyObject *args, PyObject *keywds);
+
+//
+// Replace each value by the median over a box of bin_size (i,j,k order, odd
+// sizes) grid points centered on it.  The result array must have the value
+// type and size of the input array, and can be the input array to filter in
+// place.  Result values within half a bin of the array edges are zero.
+//
+// median_filter_array(array, bin_size, result, threads = 1)
+extern "C" PyObject *median_filter_array(PyObject *, PyObject *args, PyObject *keywds);
+
+}	// end of namespace Map_Cpp
+
+#endif
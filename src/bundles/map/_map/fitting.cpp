@@ -28,7 +28,12 @@
 //
 #include <math.h>			// use sqrt()
 
+#include <algorithm>			// use std::max
+#include <vector>			// use std::vector
+
+#include <arrays/threadpool.h>		// use Thread_Pool::run()
 #include "fitting.h"
+#include "interpolate.h"		// use interpolate_volume_data()
 
 namespace Fitting
 {
@@ -203,5 +208,322 @@ void correlation_torque2(float point_weights[], int64_t n,
   torque_ret[2] = t2;
 }
 
+typedef double Transform[3][4];
+
+// r = a * b, r can be the same as a or b.
+static void multiply(const Transform a, const Transform b, Transform r)
+{
+  Transform m;
+  for (int i = 0 ; i < 3 ; ++i)
+    for (int j = 0 ; j < 4 ; ++j)
+      m[i][j] = a[i][0]*b[0][j] + a[i][1]*b[1][j] + a[i][2]*b[2][j] + (j == 3 ? a[i][3] : 0);
+  for (int i = 0 ; i < 3 ; ++i)
+    for (int j = 0 ; j < 4 ; ++j)
+      r[i][j] = m[i][j];
+}
+
+static void identity(Transform r)
+{
+  for (int i = 0 ; i < 3 ; ++i)
+    for (int j = 0 ; j < 4 ; ++j)
+      r[i][j] = (i == j ? 1 : 0);
+}
+
+static void translation(const double t[3], Transform r)
+{
+  identity(r);
+  r[0][3] = t[0]; r[1][3] = t[1]; r[2][3] = t[2];
+}
+
+// Rotation about an axis through center, angle in degrees.
+// Same as chimerax.geometry.matrix.rotation_transform().
+static void rotation(const double axis[3], double angle, const double center[3],
+		     Transform r)
+{
+  double a = angle * M_PI / 180.0, sa = sin(a), ca = cos(a), k = 1 - ca;
+  double ax = axis[0], ay = axis[1], az = axis[2];
+  r[0][0] = 1 + k*(ax*ax-1); r[0][1] = -az*sa + k*ax*ay; r[0][2] = ay*sa + k*ax*az;
+  r[1][0] = az*sa + k*ax*ay; r[1][1] = 1 + k*(ay*ay-1); r[1][2] = -ax*sa + k*ay*az;
+  r[2][0] = -ay*sa + k*ax*az; r[2][1] = ax*sa + k*ay*az; r[2][2] = 1 + k*(az*az-1);
+  for (int i = 0 ; i < 3 ; ++i)
+    r[i][3] = center[i] - (r[i][0]*center[0] + r[i][1]*center[1] + r[i][2]*center[2]);
+}
+
+static void float_transform(const Transform t, float f[3][4])
+{
+  for (int i = 0 ; i < 3 ; ++i)
+    for (int j = 0 ; j < 4 ; ++j)
+      f[i][j] = static_cast<float>(t[i][j]);
+}
+
+// Maximum length of tf * p, using the translation column if affine is true.
+static double maximum_norm(float points[][3], int64_t n, const Transform tf, bool affine)
+{
+  double m2 = 0;
+  double t0 = (affine ? tf[0][3] : 0), t1 = (affine ? tf[1][3] : 0), t2 = (affine ? tf[2][3] : 0);
+  for (int64_t k = 0 ; k < n ; ++k)
+    {
+      double x = points[k][0], y = points[k][1], z = points[k][2];
+      double u0 = tf[0][0]*x + tf[0][1]*y + tf[0][2]*z + t0;
+      double u1 = tf[1][0]*x + tf[1][1]*y + tf[1][2]*z + t1;
+      double u2 = tf[2][0]*x + tf[2][1]*y + tf[2][2]*z + t2;
+      double d2 = u0*u0 + u1*u1 + u2*u2;
+      if (d2 > m2)
+	m2 = d2;
+    }
+  return sqrt(m2);
+}
+
+// Gradient ascent for one starting placement holding its own value and
+// gradient buffers so that several can run in parallel threads.
+class Fit_Optimizer
+{
+public:
+  Fit_Optimizer(float points[][3], int64_t n, float point_weights[],
+		const Reference_Counted_Array::Numeric_Array &data,
+		const Fit_Options &options, int threads) :
+    points(points), n(n), point_weights(point_weights), data(data),
+    options(options), threads(threads), values(n), gradients(3*n)
+  {
+    double c[3] = {0, 0, 0};
+    for (int64_t k = 0 ; k < n ; ++k)
+      for (int a = 0 ; a < 3 ; ++a)
+	c[a] += points[k][a];
+    for (int a = 0 ; a < 3 ; ++a)
+      center[a] = (n > 0 ? c[a] / n : 0);
+    about_mean = (options.metric == CORRELATION_ABOUT_MEAN);
+    if (about_mean)
+      {
+	double wm = 0;
+	for (int64_t k = 0 ; k < n ; ++k)
+	  wm += point_weights[k];
+	if (n > 0)
+	  wm /= n;
+	weights.resize(n);
+	for (int64_t k = 0 ; k < n ; ++k)
+	  weights[k] = point_weights[k] - static_cast<float>(wm);
+      }
+  }
+
+  // Same as Python chimerax.map_fit.fitmap.locate_maximum().
+  int locate_maximum(const Transform xyz_to_ijk, Transform move_tf)
+  {
+    const int segment_steps = 4;
+    const double cut_step_size_threshold = .25, step_cut_factor = .5, step_grow_factor = 1.2;
+    double ijk_step_size = options.ijk_step_size_max;
+    identity(move_tf);
+    int step = 0;
+    while (step < options.max_steps && ijk_step_size > options.ijk_step_size_min)
+      {
+	Transform tf, seg_tf, step_tf, stf;
+	multiply(xyz_to_ijk, move_tf, tf);
+	identity(seg_tf);
+	for (int s = 0 ; s < segment_steps ; ++s)
+	  {
+	    bool translate = options.optimize_translation;
+	    if (!options.optimize_rotation)
+	      { if (!translate) break; }
+	    else if (translate)
+	      translate = (s % 2 == 0);
+	    multiply(tf, seg_tf, stf);
+	    if (translate)
+	      translation_step(stf, ijk_step_size, step_tf);
+	    else
+	      rotation_step(stf, ijk_step_size, step_tf);
+	    multiply(seg_tf, step_tf, seg_tf);
+	  }
+	step += segment_steps;
+	// Maximum ijk motion of points.
+	Transform diff_tf;
+	multiply(tf, seg_tf, diff_tf);
+	for (int i = 0 ; i < 3 ; ++i)
+	  for (int j = 0 ; j < 4 ; ++j)
+	    diff_tf[i][j] -= tf[i][j];
+	double mm = maximum_norm(points, n, diff_tf, true);
+	double mmcut = cut_step_size_threshold * segment_steps * ijk_step_size;
+	if (mm < mmcut)
+	  ijk_step_size *= step_cut_factor;
+	else
+	  {
+	    ijk_step_size *= step_grow_factor;
+	    if (ijk_step_size > options.ijk_step_size_max)
+	      ijk_step_size = options.ijk_step_size_max;
+	  }
+	multiply(move_tf, seg_tf, move_tf);
+      }
+    return step;
+  }
+
+  // Average map value for sum product metric, otherwise correlation
+  // of point weights and map values.
+  double score(const Transform xyz_to_ijk)
+  {
+    std::vector<int> outside;
+    interpolate_values(xyz_to_ijk, outside);
+    if (options.metric == SUM_PRODUCT)
+      {
+	double s = 0;
+	for (int64_t k = 0 ; k < n ; ++k)
+	  s += values[k];
+	int64_t ni = n - outside.size();
+	return (ni > 0 ? s / ni : 0);
+      }
+    double olap = 0, n1 = 0, n2 = 0, s1 = 0, s2 = 0;
+    for (int64_t k = 0 ; k < n ; ++k)
+      {
+	double w = point_weights[k], v = values[k];
+	olap += w*v; n1 += w*w; n2 += v*v; s1 += w; s2 += v;
+      }
+    if (options.metric == CORRELATION)
+      {
+	double d = sqrt(n1*n2);
+	return (d > 0 ? olap / d : 0);
+      }
+    double m1 = s1/n, m2 = s2/n;
+    double d2 = (n1 - n*m1*m1)*(n2 - n*m2*m2);
+    double d = (d2 > 0 ? sqrt(d2) : 0);
+    return (d > 0 ? (olap - n*m1*m2) / d : 0);
+  }
+
+private:
+  float (*points)[3];
+  int64_t n;
+  float *point_weights;
+  std::vector<float> weights;	// Mean subtracted weights.
+  const Reference_Counted_Array::Numeric_Array &data;
+  const Fit_Options &options;
+  int threads;
+  bool about_mean;
+  double center[3];
+  std::vector<float> values, gradients;
+
+  float *fit_weights()
+    { return (about_mean ? weights.data() : point_weights); }
+  float (*gradient_array())[3]
+    { return reinterpret_cast<float(*)[3]>(gradients.data()); }
+
+  void interpolate_values(const Transform xyz_to_ijk, std::vector<int> &outside)
+  {
+    float tf[3][4];
+    float_transform(xyz_to_ijk, tf);
+    Interpolate::interpolate_volume_data(points, n, tf, data, Interpolate::INTERP_LINEAR,
+					 values.data(), outside, threads);
+  }
+
+  void interpolate_values_and_gradients(const Transform xyz_to_ijk)
+  {
+    float tf[3][4];
+    float_transform(xyz_to_ijk, tf);
+    std::vector<int> outside;
+    if (options.metric != SUM_PRODUCT)
+      Interpolate::interpolate_volume_data(points, n, tf, data, Interpolate::INTERP_LINEAR,
+					   values.data(), outside, threads);
+    outside.clear();
+    Interpolate::interpolate_volume_gradient(points, n, tf, data, Interpolate::INTERP_LINEAR,
+					     gradient_array(), outside, threads);
+  }
+
+  void translation_step(const Transform xyz_to_ijk, double ijk_step_size, Transform step_tf)
+  {
+    interpolate_values_and_gradients(xyz_to_ijk);
+    double g[3] = {0, 0, 0};
+    float (*ga)[3] = gradient_array();
+    if (options.metric == SUM_PRODUCT)
+      for (int64_t k = 0 ; k < n ; ++k)
+	{
+	  double w = (point_weights ? point_weights[k] : 1.0);
+	  g[0] += w*ga[k][0]; g[1] += w*ga[k][1]; g[2] += w*ga[k][2];
+	}
+    else
+      {
+	float cg[3];
+	correlation_gradient(fit_weights(), n, values.data(), ga, about_mean, cg);
+	g[0] = cg[0]; g[1] = cg[1]; g[2] = cg[2];
+      }
+    double gijk[3];
+    for (int i = 0 ; i < 3 ; ++i)
+      gijk[i] = xyz_to_ijk[i][0]*g[0] + xyz_to_ijk[i][1]*g[1] + xyz_to_ijk[i][2]*g[2];
+    double gn = sqrt(gijk[0]*gijk[0] + gijk[1]*gijk[1] + gijk[2]*gijk[2]);
+    double delta[3] = {0, 0, 0};
+    if (gn > 0)
+      for (int a = 0 ; a < 3 ; ++a)
+	delta[a] = g[a] * (ijk_step_size / gn);
+    translation(delta, step_tf);
+  }
+
+  void rotation_step(const Transform xyz_to_ijk, double ijk_step_size, Transform step_tf)
+  {
+    interpolate_values_and_gradients(xyz_to_ijk);
+    float c[3] = {static_cast<float>(center[0]), static_cast<float>(center[1]),
+		  static_cast<float>(center[2])};
+    float t[3];
+    if (options.metric == SUM_PRODUCT)
+      torque(points, n, point_weights, gradient_array(), c, t);
+    else
+      correlation_torque(points, n, fit_weights(), values.data(), gradient_array(),
+			 c, about_mean, t);
+    double axis[3] = {t[0], t[1], t[2]};
+    double na = sqrt(axis[0]*axis[0] + axis[1]*axis[1] + axis[2]*axis[2]);
+    if (n == 1 || na == 0)
+      {
+	identity(step_tf);
+	return;
+      }
+    for (int a = 0 ; a < 3 ; ++a)
+      axis[a] /= na;
+    // Angle such that largest ijk motion of a point equals step size.
+    // Motion of point p is xyz_to_ijk * (axis x (p - center)).
+    double ax0 = axis[0], ax1 = axis[1], ax2 = axis[2];
+    double cp[3][3] = {{0, -ax2, ax1}, {ax2, 0, -ax0}, {-ax1, ax0, 0}};
+    Transform mtf;
+    for (int i = 0 ; i < 3 ; ++i)
+      {
+	for (int j = 0 ; j < 3 ; ++j)
+	  mtf[i][j] = (xyz_to_ijk[i][0]*cp[0][j] + xyz_to_ijk[i][1]*cp[1][j]
+		       + xyz_to_ijk[i][2]*cp[2][j]);
+	mtf[i][3] = -(mtf[i][0]*center[0] + mtf[i][1]*center[1] + mtf[i][2]*center[2]);
+      }
+    double av = maximum_norm(points, n, mtf, true);
+    double angle = (av > 0 ? (ijk_step_size / av) * 180.0 / M_PI : 0);
+    rotation(axis, angle, center, step_tf);
+  }
+};
+
+// Each thread optimizes a range of starting placements.
+static void locate_maxima_range(float points[][3], int64_t n, float point_weights[],
+				const Reference_Counted_Array::Numeric_Array &data,
+				double start_transforms[][3][4], int64_t s0, int64_t s1,
+				const Fit_Options &options,
+				double move_transforms[][3][4], int *steps, double *scores,
+				int threads)
+{
+  Fit_Optimizer fit(points, n, point_weights, data, options, threads);
+  for (int64_t s = s0 ; s < s1 ; ++s)
+    {
+      steps[s] = fit.locate_maximum(start_transforms[s], move_transforms[s]);
+      Transform tf;
+      multiply(start_transforms[s], move_transforms[s], tf);
+      scores[s] = fit.score(tf);
+    }
+}
+
+void locate_maxima(float points[][3], int64_t n, float point_weights[],
+		   const Reference_Counted_Array::Numeric_Array &data,
+		   double start_transforms[][3][4], int64_t nstart,
+		   const Fit_Options &options,
+		   double move_transforms[][3][4], int *steps, double *scores,
+		   int threads)
+{
+  // With one placement the interpolation uses the threads instead.
+  // Interpolation inside a pool job runs in that job's thread.
+  int threads1 = std::max(threads, 1);
+  int64_t nt = Thread_Pool::thread_count(nstart, 1, threads1);
+  int ithreads = (nt > 1 ? 1 : threads1);
+  Thread_Pool::run(nt, [&](int t) {
+      locate_maxima_range(points, n, point_weights, data, start_transforms,
+			  (t*nstart)/nt, ((t+1)*nstart)/nt,
+			  options, move_transforms, steps, scores, ithreads);
+    });
+}
 
 }  // end of namespace Fitting
@@ -32,6 +32,8 @@
 
 #include <cstdint>	// use std::int64_t
 
+#include <arrays/rcarray.h>	// use Numeric_Array
+
 namespace Fitting
 {
 void correlation_gradient(float point_weights[], int64_t n,
@@ -47,7 +49,31 @@ void correlation_torque(float points[][3], int64_t n, float point_weights[],
 void correlation_torque2(float point_weights[], int64_t n,
 			 float values[], float rxg[][3],
 			 bool about_mean, float *torque_ret);
-	     
+
+enum Fit_Metric {SUM_PRODUCT, CORRELATION, CORRELATION_ABOUT_MEAN};
+
+// Parameters of the gradient ascent optimization, same as Python
+// chimerax.map_fit.fitmap.locate_maximum().
+class Fit_Options
+{
+ public:
+  Fit_Options() : max_steps(2000), ijk_step_size_min(0.01), ijk_step_size_max(0.5),
+    optimize_translation(true), optimize_rotation(true), metric(SUM_PRODUCT) {}
+  int max_steps;
+  double ijk_step_size_min, ijk_step_size_max;
+  bool optimize_translation, optimize_rotation;
+  Fit_Metric metric;
+};
+
+// Optimize many starting placements of points in a map in parallel.
+// Point weights can be NULL for the sum product metric.
+void locate_maxima(float points[][3], int64_t n, float point_weights[],
+		   const Reference_Counted_Array::Numeric_Array &data,
+		   double start_transforms[][3][4], int64_t nstart,
+		   const Fit_Options &options,
+		   double move_transforms[][3][4], int *steps, double *scores,
+		   int threads = 1);
+
 
 }  // end of namespace Fitting
 
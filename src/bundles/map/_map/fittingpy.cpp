@@ -28,6 +28,7 @@
 // Python interface to fitting correlation optimization routines.
 //
 #include <Python.h>			// use PyObject
+#include <string.h>			// use strcmp()
 
 #include "fitting.h"			// use Fitting::*
 #include <arrays/pythonarray.h>		// use array_from_python()
@@ -198,3 +199,100 @@ extern "C" PyObject *py_correlation_torque2(PyObject *, PyObject *args,
   PyObject *torpy = c_array_to_python(tor, 3);
   return torpy;
 }
+
+// ----------------------------------------------------------------------------
+//
+static int parse_fit_metric(PyObject *arg, void *m)
+{
+  const char *mname = PyUnicode_AsUTF8(arg);
+  if (mname == NULL)
+    return 0;
+
+  Fitting::Fit_Metric metric;
+  if (strcmp(mname, "sum product") == 0)
+    metric = Fitting::SUM_PRODUCT;
+  else if (strcmp(mname, "correlation") == 0)
+    metric = Fitting::CORRELATION;
+  else if (strcmp(mname, "correlation about mean") == 0)
+    metric = Fitting::CORRELATION_ABOUT_MEAN;
+  else
+    {
+      PyErr_Format(PyExc_TypeError, "Metric must be 'sum product', 'correlation' or 'correlation about mean', got %s", mname);
+      return 0;
+    }
+  *static_cast<Fitting::Fit_Metric *>(m) = metric;
+  return 1;
+}
+
+// ----------------------------------------------------------------------------
+// Optimize many starting placements.  Transforms map points to array
+// indices.  Returns optimizing transforms to apply to the points before
+// each starting transform, number of steps taken, and metric values.
+//
+extern "C" PyObject *py_locate_maxima(PyObject *, PyObject *args,
+				      PyObject *keywds)
+{
+  FArray points, point_weights;
+  PyObject *pyw;
+  Numeric_Array data;
+  DArray transforms;
+  Fitting::Fit_Options opt;
+  int threads = 1;
+  const char *kwlist[] = {"points", "point_weights", "array", "transforms",
+			  "max_steps", "ijk_step_size_min", "ijk_step_size_max",
+			  "optimize_translation", "optimize_rotation", "metric",
+			  "threads", NULL};
+  if (!PyArg_ParseTupleAndKeywords(args, keywds,
+				   const_cast<char *>("O&OO&O&|iddO&O&O&i"),
+				   (char **)kwlist,
+				   parse_float_n3_array, &points,
+				   &pyw,
+				   parse_3d_array, &data,
+				   parse_contiguous_double_n34_array, &transforms,
+				   &opt.max_steps,
+				   &opt.ijk_step_size_min,
+				   &opt.ijk_step_size_max,
+				   parse_bool, &opt.optimize_translation,
+				   parse_bool, &opt.optimize_rotation,
+				   parse_fit_metric, &opt.metric,
+				   &threads))
+    return NULL;
+
+  float *w;
+  if (pyw == Py_None)
+    w = NULL;
+  else if (parse_float_n_array(pyw, &point_weights) &&
+	   check_array_size(point_weights, points.size(0), true))
+    w = point_weights.values();
+  else
+    return NULL;
+
+  int64_t n = points.size(0);
+  if (n == 0)
+    {
+      PyErr_SetString(PyExc_ValueError, "locate_maxima(): No points");
+      return NULL;
+    }
+  if (w == NULL && opt.metric != Fitting::SUM_PRODUCT)
+    {
+      PyErr_SetString(PyExc_ValueError, "locate_maxima(): Correlation metric requires point weights");
+      return NULL;
+    }
+
+  int64_t nt = transforms.size(0);
+  double *mt, *scores;
+  int *steps;
+  PyObject *py_mt = python_double_array(nt, 3, 4, &mt);
+  PyObject *py_steps = python_int_array(nt, &steps);
+  PyObject *py_scores = python_double_array(nt, &scores);
+
+  FArray pcontig = points.contiguous_array();
+  float (*p)[3] = reinterpret_cast<float(*)[3]>(pcontig.values());
+  double (*st)[3][4] = reinterpret_cast<double(*)[3][4]>(transforms.values());
+  double (*m)[3][4] = reinterpret_cast<double(*)[3][4]>(mt);
+  Py_BEGIN_ALLOW_THREADS
+  Fitting::locate_maxima(p, n, w, data, st, nt, opt, m, steps, scores, threads);
+  Py_END_ALLOW_THREADS
+
+  return python_tuple(py_mt, py_steps, py_scores);
+}
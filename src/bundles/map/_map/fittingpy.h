@@ -36,6 +36,7 @@ PyObject *py_torque(PyObject *, PyObject *args, PyObject *keywds);
 PyObject *py_torques(PyObject *, PyObject *args, PyObject *keywds);
 PyObject *py_correlation_torque(PyObject *, PyObject *args, PyObject *keywds);
 PyObject *py_correlation_torque2(PyObject *, PyObject *args, PyObject *keywds);
+PyObject *py_locate_maxima(PyObject *, PyObject *args, PyObject *keywds);
 
 }
 
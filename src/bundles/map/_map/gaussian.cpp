@@ -31,8 +31,13 @@
 #include <Python.h>			// use PyObject
 #include <math.h>			// use ceil(), floor(), exp()
 
+#include <algorithm>			// use std::max
+#include <vector>			// use std::vector
+
+#include <arrays/progress.h>		// use Progress_Reporter, Python_Progress
 #include <arrays/pythonarray.h>		// use array_from_python()
 #include <arrays/rcarray.h>		// use FArray
+#include <arrays/threadpool.h>		// use Thread_Pool::run()
 
 // -----------------------------------------------------------------------------
 //
@@ -45,11 +50,101 @@ static inline int clamp(int x, int limit)
   return x;
 }
 
+// ----------------------------------------------------------------------------
+// Centers are added in chunks with progress reported after each chunk.
+//
+const int64_t CENTER_CHUNK = 100000;
+
+// ----------------------------------------------------------------------------
+// Add values for each center to a grid using several shared pool threads.  Each thread
+// owns a disjoint slab of grid planes along the slowest varying axis so no
+// two threads write the same grid point.  The centers touching each slab are
+// added in center order so values are summed in the same order as a single
+// thread computes them.  Slab boundaries are chosen to give each thread
+// about the same number of center planes.
+//
+// Function planes(c, &k0, &k1) gives the plane range touched by center c and
+// returns false if it touches none.  Function add(c, k0, k1) adds values for
+// center c to planes k0 through k1.  Returns false if cancelled by the
+// progress reporter.
+//
+template <class Center_Planes, class Add_Center>
+static bool add_centers(int64_t n, int ksize, Center_Planes planes, Add_Center add,
+			int threads, Progress_Reporter *progress)
+{
+  if (n == 0 || ksize <= 0)
+    return true;
+
+  // Plane range for each center, empty if k0 > k1.
+  std::vector<int> kr(2*n);
+  std::vector<int64_t> work(ksize+1, 0);
+  for (int64_t c = 0 ; c < n ; ++c)
+    {
+      int k0 = 1, k1 = 0;
+      if (planes(c, k0, k1))
+	{
+	  work[k0] += 1;
+	  work[k1+1] -= 1;
+	}
+      else
+	{ k0 = 1; k1 = 0; }
+      kr[2*c] = k0;
+      kr[2*c+1] = k1;
+    }
+
+  // Divide planes into slabs with about equal numbers of center planes.
+  int nt = Thread_Pool::thread_count(ksize, 1, std::max(threads, 1));
+  if (n < 2*nt)
+    nt = 1;
+  std::vector<int> slab_end;
+  if (nt > 1)
+    {
+      int64_t total = 0;
+      for (int k = 0 ; k < ksize ; ++k)
+	{
+	  work[k+1] += work[k];
+	  total += work[k];
+	}
+      int64_t sum = 0;
+      for (int k = 0 ; k < ksize && (int)slab_end.size() < nt-1 ; ++k)
+	{
+	  sum += work[k];
+	  if (sum * nt >= total * (int64_t)(slab_end.size()+1))
+	    slab_end.push_back(k+1);
+	}
+    }
+  slab_end.push_back(ksize);
+  nt = slab_end.size();
+
+  for (int64_t c0 = 0 ; c0 < n ; c0 += CENTER_CHUNK)
+    {
+      int64_t c1 = (c0 + CENTER_CHUNK < n ? c0 + CENTER_CHUNK : n);
+      auto add_slab = [&](int kstart, int kend)
+	{
+	  for (int64_t c = c0 ; c < c1 ; ++c)
+	    {
+	      int k0 = kr[2*c], k1 = kr[2*c+1];
+	      if (k0 < kstart)
+		k0 = kstart;
+	      if (k1 >= kend)
+		k1 = kend-1;
+	      if (k0 <= k1)
+		add(c, k0, k1);
+	    }
+	};
+      Thread_Pool::run(nt, [&](int t) { add_slab((t == 0 ? 0 : slab_end[t-1]), slab_end[t]); });
+      if (progress && !progress->report(static_cast<float>(c1) / n))
+	return false;
+    }
+  return true;
+}
+
 // -----------------------------------------------------------------------------
 //
-static void sum_of_gaussians(const FArray &centers, const FArray &coef,
+static bool sum_of_gaussians(const FArray &centers, const FArray &coef,
 			     const FArray &sdev, float maxrange,
-			     FArray &matrix)
+			     FArray &matrix, int threads = 1,
+			     Progress_Reporter *progress = NULL)
 {
   const int64_t *msize = matrix.sizes();
   int64_t n = centers.size(0);
@@ -59,13 +154,13 @@ static void sum_of_gaussians(const FArray &centers, const FArray &coef,
   int64_t cfs0 = coef.stride(0), ss0 = sdev.stride(0), ss1 = sdev.stride(1);
   float *ma = matrix.values();
   int64_t ms0 = matrix.stride(0), ms1 = matrix.stride(1), ms2 = matrix.stride(2);
-  for (int64_t c = 0 ; c < n ; ++c)
+  auto center_box = [=](int64_t c, float cijk[3], float sd[3],
+			int ijk_min[3], int ijk_max[3])
     {
-      float sd[3] = {sa[c*ss0], sa[c*ss0 + ss1], sa[c*ss0 + 2*ss1]};
+      for (int p = 0 ; p < 3 ; ++p)
+	sd[p] = sa[c*ss0 + p*ss1];
       if (sd[0] == 0 || sd[1] == 0 || sd[2] == 0)
-	continue;
-      float cijk[3];
-      int ijk_min[3], ijk_max[3];
+	return false;
       for (int p = 0 ; p < 3 ; ++p)
 	{
 	  float x = ca[cs0*c+cs1*p];
@@ -73,8 +168,25 @@ static void sum_of_gaussians(const FArray &centers, const FArray &coef,
 	  ijk_min[p] = clamp((int)ceil(x-maxrange*sd[p]), msize[2-p]);
 	  ijk_max[p] = clamp((int)floor(x+maxrange*sd[p]), msize[2-p]);
 	}
+      return true;
+    };
+  auto center_planes = [&](int64_t c, int &k0, int &k1)
+    {
+      float cijk[3], sd[3];
+      int ijk_min[3], ijk_max[3];
+      if (!center_box(c, cijk, sd, ijk_min, ijk_max))
+	return false;
+      k0 = ijk_min[2];
+      k1 = ijk_max[2];
+      return true;
+    };
+  auto add_center = [=](int64_t c, int kmin, int kmax)
+    {
+      float cijk[3], sd[3];
+      int ijk_min[3], ijk_max[3];
+      center_box(c, cijk, sd, ijk_min, ijk_max);
       float cf = cfa[c*cfs0];
-      for (int k = ijk_min[2] ; k <= ijk_max[2] ; ++k)
+      for (int k = kmin ; k <= kmax ; ++k)
 	{
 	  float dk = (k-cijk[2])/sd[2];
 	  float k2 = dk*dk;
@@ -90,7 +202,8 @@ static void sum_of_gaussians(const FArray &centers, const FArray &coef,
 		}
 	    }
 	}
-    }
+    };
+  return add_centers(n, (int)msize[0], center_planes, add_center, threads, progress);
 }
 
 // ----------------------------------------------------------------------------
@@ -100,14 +213,18 @@ extern "C" PyObject *py_sum_of_gaussians(PyObject *, PyObject *args,
 {
   FArray centers, coef, sdev, matrix;
   float maxrange;
-  const char *kwlist[] = {"centers", "coef", "sdev", "maxrange", "matrix", NULL};
+  int threads = 1;
+  Python_Progress progress;
+  const char *kwlist[] = {"centers", "coef", "sdev", "maxrange", "matrix",
+			  "threads", "progress", NULL};
   if (!PyArg_ParseTupleAndKeywords(args, keywds,
-				   const_cast<char *>("O&O&O&fO&"), (char **)kwlist,
+				   const_cast<char *>("O&O&O&fO&|iO&"), (char **)kwlist,
 				   parse_float_n3_array, &centers,
 				   parse_float_n_array, &coef,
 				   parse_float_n3_array, &sdev,
 				   &maxrange,
-				   parse_writable_float_3d_array, &matrix))
+				   parse_writable_float_3d_array, &matrix,
+				   &threads, parse_progress, &progress))
     return NULL;
 
   if (coef.size(0) != centers.size(0) || sdev.size(0) != centers.size(0))
@@ -117,17 +234,23 @@ extern "C" PyObject *py_sum_of_gaussians(PyObject *, PyObject *args,
       return NULL;
     }
 
+  bool completed;
   Py_BEGIN_ALLOW_THREADS
-  sum_of_gaussians(centers, coef, sdev, maxrange, matrix);
+  completed = sum_of_gaussians(centers, coef, sdev, maxrange, matrix,
+			       threads, progress.reporter());
   Py_END_ALLOW_THREADS
 
+  if (!completed)
+    return progress.stopped_error();
+
   return python_none();
 }
 
 // -----------------------------------------------------------------------------
 //
-static void sum_of_balls(const FArray &centers, const FArray &radii,
-			 float sdev, float maxrange, FArray &matrix)
+static bool sum_of_balls(const FArray &centers, const FArray &radii,
+			 float sdev, float maxrange, FArray &matrix,
+			 int threads = 1, Progress_Reporter *progress = NULL)
 {
   const int64_t *msize = matrix.sizes();
   int64_t n = centers.size(0);
@@ -137,12 +260,9 @@ static void sum_of_balls(const FArray &centers, const FArray &radii,
   int64_t rs0 = radii.stride(0);
   float *ma = matrix.values();
   int64_t ms0 = matrix.stride(0), ms1 = matrix.stride(1), ms2 = matrix.stride(2);
-  for (int64_t c = 0 ; c < n ; ++c)
+  auto center_box = [=](int64_t c, float cijk[3], int ijk_min[3], int ijk_max[3])
     {
-      float cijk[3];
-      int ijk_min[3], ijk_max[3];
       float r = ra[rs0*c];
-      float r2 = r*r;
       for (int p = 0 ; p < 3 ; ++p)
 	{
 	  float x = ca[cs0*c+cs1*p];
@@ -150,7 +270,24 @@ static void sum_of_balls(const FArray &centers, const FArray &radii,
 	  ijk_min[p] = clamp((int)ceil(x-r-maxrange*sdev), msize[2-p]);
 	  ijk_max[p] = clamp((int)floor(x+r+maxrange*sdev), msize[2-p]);
 	}
-      for (int k = ijk_min[2] ; k <= ijk_max[2] ; ++k)
+    };
+  auto center_planes = [&](int64_t c, int &k0, int &k1)
+    {
+      float cijk[3];
+      int ijk_min[3], ijk_max[3];
+      center_box(c, cijk, ijk_min, ijk_max);
+      k0 = ijk_min[2];
+      k1 = ijk_max[2];
+      return true;
+    };
+  auto add_center = [=](int64_t c, int kmin, int kmax)
+    {
+      float cijk[3];
+      int ijk_min[3], ijk_max[3];
+      center_box(c, cijk, ijk_min, ijk_max);
+      float r = ra[rs0*c];
+      float r2 = r*r;
+      for (int k = kmin ; k <= kmax ; ++k)
 	{
 	  float dk = (k-cijk[2]);
 	  float k2 = dk*dk;
@@ -172,7 +309,8 @@ static void sum_of_balls(const FArray &centers, const FArray &radii,
 		}
 	    }
 	}
-    }
+    };
+  return add_centers(n, (int)msize[0], center_planes, add_center, threads, progress);
 }
 
 // ----------------------------------------------------------------------------
@@ -181,13 +319,17 @@ extern "C" PyObject *py_sum_of_balls(PyObject *, PyObject *args, PyObject *keywd
 {
   FArray centers, radii, matrix;
   float sdev, maxrange;
-  const char *kwlist[] = {"centers", "radii", "sdev", "maxrange", "matrix", NULL};
+  int threads = 1;
+  Python_Progress progress;
+  const char *kwlist[] = {"centers", "radii", "sdev", "maxrange", "matrix",
+			  "threads", "progress", NULL};
   if (!PyArg_ParseTupleAndKeywords(args, keywds,
-				   const_cast<char *>("O&O&ffO&"), (char **)kwlist,
+				   const_cast<char *>("O&O&ffO&|iO&"), (char **)kwlist,
 				   parse_float_n3_array, &centers,
 				   parse_float_n_array, &radii,
 				   &sdev, &maxrange,
-				   parse_writable_float_3d_array, &matrix))
+				   parse_writable_float_3d_array, &matrix,
+				   &threads, parse_progress, &progress))
     return NULL;
 
   if (radii.size(0) != centers.size(0))
@@ -197,10 +339,15 @@ extern "C" PyObject *py_sum_of_balls(PyObject *, PyObject *args, PyObject *keywd
       return NULL;
     }
 
+  bool completed;
   Py_BEGIN_ALLOW_THREADS
-  sum_of_balls(centers, radii, sdev, maxrange, matrix);
+  completed = sum_of_balls(centers, radii, sdev, maxrange, matrix,
+			   threads, progress.reporter());
   Py_END_ALLOW_THREADS
 
+  if (!completed)
+    return progress.stopped_error();
+
   return python_none();
 }
 
@@ -29,75 +29,152 @@
 //
 #include <Python.h>			// use PyObject
 #include <cfloat>			// use DBL_MAX, DBL_MIN
+#include <math.h>			// use sqrt()
+
+#include <algorithm>			// use std::min, std::max
+
+#include <vector>			// use std::vector
 
 #include <arrays/pythonarray.h>		// use array_from_python()
 #include <arrays/rcarray.h>		// use Numeric_Array, Array<T>
+#include <arrays/threadpool.h>		// use Thread_Pool::run()
 
 #define NO_PAD_VALUE	1e-111
 
 namespace Map_Cpp
 {
 
+// ----------------------------------------------------------------------------
+// Arrays with fewer elements than this are scanned with one thread.
+//
+const int64_t MIN_THREAD_ELEMENTS = (1 << 20);
+
+// ----------------------------------------------------------------------------
+// View a 1, 2 or 3 dimensional array as 3 dimensional.
+//
+class Array_Loop
+{
+public:
+  template<class T>
+  Array_Loop(const Reference_Counted_Array::Array<T> &seq)
+  {
+    m0 = m1 = m2 = 1;
+    s0 = s1 = s2 = 0;
+    int dim = seq.dimension();
+    if (dim == 1)
+      { m2 = seq.size(0); s2 = seq.stride(0); }
+    else if (dim == 2)
+      { s1 = seq.stride(0); s2 = seq.stride(1);
+	m1 = seq.size(0); m2 = seq.size(1); }
+    else if (dim == 3)
+      { s0 = seq.stride(0); s1 = seq.stride(1); s2 = seq.stride(2);
+	m0 = seq.size(0); m1 = seq.size(1); m2 = seq.size(2); }
+  }
+  int64_t m0, m1, m2;
+  int64_t s0, s1, s2;
+};
+
+// ----------------------------------------------------------------------------
+// Scan array elements with several shared pool threads, each handling a range of
+// planes along the first axis.  The scan function is called with the plane
+// range and a thread index and results from each thread are combined by the
+// caller.  Returns the number of threads used.
+//
+template<class Scan>
+static int thread_planes(const Array_Loop &a, int threads, Scan scan)
+{
+  int64_t n = a.m0 * a.m1 * a.m2;
+  int nt = (n >= MIN_THREAD_ELEMENTS ?
+	    Thread_Pool::thread_count(a.m0, 1, std::max(threads, 1)) : 1);
+  Thread_Pool::run(nt, [&](int t) { scan((t*a.m0)/nt, ((t+1)*a.m0)/nt, t); });
+  return nt;
+}
+
+// ----------------------------------------------------------------------------
+// Minimum, maximum, sum and sum of squares of array elements excluding
+// elements equal to the pad value.
+//
+class Value_Stats
+{
+public:
+  Value_Stats() : minimum(DBL_MAX), maximum(-DBL_MAX), sum(0), sum2(0), count(0) {}
+  void add(const Value_Stats &vs)
+  {
+    if (vs.minimum < minimum) minimum = vs.minimum;
+    if (vs.maximum > maximum) maximum = vs.maximum;
+    sum += vs.sum;
+    sum2 += vs.sum2;
+    count += vs.count;
+  }
+  double minimum, maximum, sum, sum2;
+  int64_t count;
+};
+
+// ----------------------------------------------------------------------------
+//
+template<class T>
+static void value_stats(const Reference_Counted_Array::Array<T> &seq,
+			double ignore_pad_value, bool sums, int threads,
+			Value_Stats *stats)
+{
+  T *data = seq.values();
+  Array_Loop a(seq);
+  std::vector<Value_Stats> tstats(threads > 1 ? threads : 1);
+  bool pad = (ignore_pad_value != NO_PAD_VALUE);
+  auto scan = [&](int64_t i0_begin, int64_t i0_end, int t)
+    {
+      double minimum = DBL_MAX, maximum = -DBL_MAX, sum = 0, sum2 = 0;
+      int64_t count = 0;
+      int64_t m1 = a.m1, m2 = a.m2, s1 = a.s1, s2 = a.s2;
+      for (int64_t i0 = i0_begin ; i0 < i0_end ; ++i0)
+	for (int64_t i1 = 0 ; i1 < m1 ; ++i1)
+	  {
+	    const T *row = data + i0*a.s0 + i1*s1;
+	    for (int64_t i2 = 0 ; i2 < m2 ; ++i2)
+	      {
+		double v = static_cast<double> (row[i2*s2]);
+		if (pad && v == ignore_pad_value)
+		  continue;
+		if (v > maximum)
+		  maximum = v;
+		if (v < minimum)
+		  minimum = v;
+		if (sums)
+		  {
+		    sum += v;
+		    sum2 += v*v;
+		    count += 1;
+		  }
+	      }
+	  }
+      Value_Stats &ts = tstats[t];
+      ts.minimum = minimum;
+      ts.maximum = maximum;
+      ts.sum = sum;
+      ts.sum2 = sum2;
+      ts.count = count;
+    };
+  int nt = thread_planes(a, threads, scan);
+  for (int t = 0 ; t < nt ; ++t)
+    stats->add(tstats[t]);
+}
+
 // ----------------------------------------------------------------------------
 // Return minimum and maximum values of array elements.
 //
 template<class T>
 static void min_and_max(const Reference_Counted_Array::Array<T> &seq,
-			double *min, double *max, double ignore_pad_value)
+			double *min, double *max, double ignore_pad_value,
+			int threads)
 {
   int64_t n = seq.size();
   if (n == 0)
     { *min = *max = 0; return; }
 
-  T *data = seq.values();
-  double minimum = DBL_MAX;
-  double maximum = -DBL_MAX;
-
-  int dim = seq.dimension();
-  int64_t m0 = 1, m1 = 1, m2 = 1;
-  int64_t s0 = 0, s1 = 0, s2 = 0;
-  if (dim == 1)
-    { m2 = seq.size(0); s2 = seq.stride(0); }
-  else if (dim == 2)
-    { s1 = seq.stride(0); s2 = seq.stride(1);
-      m1 = seq.size(0); m2 = seq.size(1); }
-  else if (dim == 3)
-    { s0 = seq.stride(0); s1 = seq.stride(1); s2 = seq.stride(2);
-      m0 = seq.size(0); m1 = seq.size(1); m2 = seq.size(2); }
-
-  if (ignore_pad_value == NO_PAD_VALUE)
-    {
-      int64_t i = 0;
-      for (int64_t i0 = 0 ; i0 < m0 ; ++i0, i += s0 - m1*s1)
-        for (int64_t i1 = 0 ; i1 < m1 ; ++i1, i += s1 - m2*s2)
-          for (int64_t i2 = 0 ; i2 < m2 ; ++i2, i += s2)
-            {
-              double v = static_cast<double> (data[i]);
-              if (v > maximum)
-                maximum = v;
-              else if (v < minimum)
-                minimum = v;
-            }
-    }
-  else
-    {
-      int64_t i = 0;
-      for (int64_t i0 = 0 ; i0 < m0 ; ++i0, i += s0 - m1*s1)
-        for (int64_t i1 = 0 ; i1 < m1 ; ++i1, i += s1 - m2*s2)
-          for (int64_t i2 = 0 ; i2 < m2 ; ++i2, i += s2)
-            {
-              double v = static_cast<double> (data[i]);
-              if (v == ignore_pad_value)
-                continue;
-              if (v > maximum)
-                maximum = v;
-              else if (v < minimum)
-                minimum = v;
-            }
-    }
-
-  *min = minimum;
-  *max = maximum;
+  Value_Stats vs;
+  value_stats(seq, ignore_pad_value, false, threads, &vs);
+  *min = vs.minimum;
+  *max = vs.maximum;
 }
 
 // ----------------------------------------------------------------------------
@@ -108,11 +185,12 @@ minimum_and_maximum(PyObject *, PyObject *args, PyObject *keywds)
 {
   Numeric_Array seq;
   double ignore_pad_value = NO_PAD_VALUE;
-  const char *kwlist[] = {"array", "ignore_pad_value", NULL};
-  if (!PyArg_ParseTupleAndKeywords(args, keywds, const_cast<char *>("O&|$d"),
+  int threads = 1;
+  const char *kwlist[] = {"array", "ignore_pad_value", "threads", NULL};
+  if (!PyArg_ParseTupleAndKeywords(args, keywds, const_cast<char *>("O&|$di"),
 				   (char **)kwlist,
 				   parse_array, &seq,
-                                   &ignore_pad_value))
+                                   &ignore_pad_value, &threads))
     return NULL;
 
   if (seq.dimension() < 0 || seq.dimension() > 3)
@@ -123,22 +201,66 @@ minimum_and_maximum(PyObject *, PyObject *args, PyObject *keywds)
     }
 
   double min, max;
-  call_template_function(min_and_max, seq.value_type(), (seq, &min, &max, ignore_pad_value));
+  Py_BEGIN_ALLOW_THREADS
+  call_template_function(min_and_max, seq.value_type(),
+			 (seq, &min, &max, ignore_pad_value, threads));
+  Py_END_ALLOW_THREADS
 
   return python_tuple(PyFloat_FromDouble(min), PyFloat_FromDouble(max));
 }
 
 // ----------------------------------------------------------------------------
-// Return a Numeric array of integers that counts the number of data values
-// in a series of bins.
+// Return minimum, maximum, mean, root mean square and count of array elements
+// in one pass over the array.
 //
-template<class T>
-static void bin_counts(const Reference_Counted_Array::Array<T> &seq,
-		       float min, float max, IArray &counts, double ignore_pad_value)
+extern "C" PyObject *
+array_statistics(PyObject *, PyObject *args, PyObject *keywds)
 {
-  int64_t bins = counts.size();
-  int *c = counts.values();
+  Numeric_Array seq;
+  double ignore_pad_value = NO_PAD_VALUE;
+  int threads = 1;
+  const char *kwlist[] = {"array", "ignore_pad_value", "threads", NULL};
+  if (!PyArg_ParseTupleAndKeywords(args, keywds, const_cast<char *>("O&|$di"),
+				   (char **)kwlist,
+				   parse_array, &seq,
+                                   &ignore_pad_value, &threads))
+    return NULL;
+
+  if (seq.dimension() < 1 || seq.dimension() > 3)
+    {
+      PyErr_SetString(PyExc_TypeError,
+		      "array_statistics(): array must be 1, 2, or 3 dimensional");
+      return NULL;
+    }
 
+  Value_Stats vs;
+  Py_BEGIN_ALLOW_THREADS
+  call_template_function(value_stats, seq.value_type(),
+			 (seq, ignore_pad_value, true, threads, &vs));
+  Py_END_ALLOW_THREADS
+
+  double mean = 0, rms = 0;
+  if (vs.count > 0)
+    {
+      mean = vs.sum / vs.count;
+      rms = sqrt(vs.sum2 / vs.count);
+    }
+  else
+    vs.minimum = vs.maximum = 0;
+  return python_tuple(PyFloat_FromDouble(vs.minimum), PyFloat_FromDouble(vs.maximum),
+		      PyFloat_FromDouble(mean), PyFloat_FromDouble(rms),
+		      PyLong_FromLongLong(vs.count));
+}
+
+// ----------------------------------------------------------------------------
+// Add the number of data values in each of a series of bins to counts.
+// Each thread counts into its own bins which are then summed.
+//
+template<class T, class C>
+static void bin_values(const Reference_Counted_Array::Array<T> &seq,
+		       float min, float max, C *c, int64_t bins,
+		       double ignore_pad_value, int threads)
+{
   float range = max - min;
   if (range == 0)
     return;
@@ -146,47 +268,52 @@ static void bin_counts(const Reference_Counted_Array::Array<T> &seq,
   T *data = seq.values();
   float scale = bins / range;
 
-  int dim = seq.dimension();
-  int64_t m0 = 1, m1 = 1, m2 = 1;
-  int64_t s0 = 0, s1 = 0, s2 = 0;
-  if (dim == 1)
-    { m2 = seq.size(0); s2 = seq.stride(0); }
-  else if (dim == 2)
-    { s1 = seq.stride(0); s2 = seq.stride(1);
-      m1 = seq.size(0); m2 = seq.size(1); }
-  else if (dim == 3)
-    { s0 = seq.stride(0); s1 = seq.stride(1); s2 = seq.stride(2);
-      m0 = seq.size(0); m1 = seq.size(1); m2 = seq.size(2); }
-
-  if (ignore_pad_value == NO_PAD_VALUE)
+  Array_Loop a(seq);
+  int tmax = (threads > 1 ? threads : 1);
+  std::vector<std::vector<C> > tcounts(tmax);
+  bool pad = (ignore_pad_value != NO_PAD_VALUE);
+  auto scan = [&](int64_t i0_begin, int64_t i0_end, int t)
     {
-      int64_t i = 0;
-      for (int64_t i0 = 0 ; i0 < m0 ; ++i0, i += s0 - m1*s1)
-        for (int64_t i1 = 0 ; i1 < m1 ; ++i1, i += s1 - m2*s2)
-          for (int64_t i2 = 0 ; i2 < m2 ; ++i2, i += s2)
-            {
-              int64_t b = static_cast<int> (scale * (data[i] - min));
-              if (b >= 0 && b < bins)
-                c[b] += 1;
-            }
-    }
-  else
+      std::vector<C> &tc = tcounts[t];
+      tc.assign(bins, 0);
+      C *cb = tc.data();
+      int64_t m1 = a.m1, m2 = a.m2, s1 = a.s1, s2 = a.s2;
+      for (int64_t i0 = i0_begin ; i0 < i0_end ; ++i0)
+	for (int64_t i1 = 0 ; i1 < m1 ; ++i1)
+	  {
+	    const T *row = data + i0*a.s0 + i1*s1;
+	    for (int64_t i2 = 0 ; i2 < m2 ; ++i2)
+	      {
+		T v = row[i2*s2];
+		if (pad && static_cast<double> (v) == ignore_pad_value)
+		  continue;
+		int64_t b = static_cast<int> (scale * (v - min));
+		if (b >= 0 && b < bins)
+		  cb[b] += 1;
+	      }
+	  }
+    };
+  int nt = thread_planes(a, threads, scan);
+  for (int t = 0 ; t < nt ; ++t)
     {
-      int64_t i = 0;
-      for (int64_t i0 = 0 ; i0 < m0 ; ++i0, i += s0 - m1*s1)
-        for (int64_t i1 = 0 ; i1 < m1 ; ++i1, i += s1 - m2*s2)
-          for (int64_t i2 = 0 ; i2 < m2 ; ++i2, i += s2)
-            {
-              double v = static_cast<double> (data[i]);
-              if (v == NO_PAD_VALUE)
-                continue;
-              int64_t b = static_cast<int> (scale * (v - min));
-              if (b >= 0 && b < bins)
-                c[b] += 1;
-            }
+      const C *cb = tcounts[t].data();
+      for (int64_t b = 0 ; b < bins ; ++b)
+	c[b] += cb[b];
     }
 }
 
+// ----------------------------------------------------------------------------
+// Return a Numeric array of integers that counts the number of data values
+// in a series of bins.
+//
+template<class T>
+static void bin_counts(const Reference_Counted_Array::Array<T> &seq,
+		       float min, float max, IArray &counts, double ignore_pad_value,
+		       int threads)
+{
+  bin_values(seq, min, max, counts.values(), counts.size(), ignore_pad_value, threads);
+}
+
 // ----------------------------------------------------------------------------
 // Return a Numeric array of integers that counts the number of data values
 // in a series of bins.
@@ -198,13 +325,15 @@ bin_counts(PyObject *, PyObject *args, PyObject *keywds)
   IArray counts;
   float min, max;
   double ignore_pad_value = NO_PAD_VALUE;
-  const char *kwlist[] = {"array", "min", "max", "counts", "ignore_pad_value", NULL};
-  if (!PyArg_ParseTupleAndKeywords(args, keywds, const_cast<char *>("O&ffO&|$d"),
+  int threads = 1;
+  const char *kwlist[] = {"array", "min", "max", "counts", "ignore_pad_value",
+			  "threads", NULL};
+  if (!PyArg_ParseTupleAndKeywords(args, keywds, const_cast<char *>("O&ffO&|$di"),
 				   (char **)kwlist,
 				   parse_array, &seq,
 				   &min, &max,
 				   parse_writable_int_n_array, &counts,
-                                   &ignore_pad_value))
+                                   &ignore_pad_value, &threads))
     return NULL;
 
   if (seq.dimension() < 1 || seq.dimension() > 3)
@@ -221,7 +350,10 @@ bin_counts(PyObject *, PyObject *args, PyObject *keywds)
       return NULL;
     }
 
-  call_template_function(bin_counts, seq.value_type(), (seq, min, max, counts, ignore_pad_value));
+  Py_BEGIN_ALLOW_THREADS
+  call_template_function(bin_counts, seq.value_type(),
+			 (seq, min, max, counts, ignore_pad_value, threads));
+  Py_END_ALLOW_THREADS
 
   return python_none();
 }
@@ -232,57 +364,10 @@ bin_counts(PyObject *, PyObject *args, PyObject *keywds)
 //
 template<class T>
 static void bin_counts_float64(const Reference_Counted_Array::Array<T> &seq,
-			       float min, float max, DArray &counts, double ignore_pad_value)
+			       float min, float max, DArray &counts, double ignore_pad_value,
+			       int threads)
 {
-  int64_t bins = counts.size();
-  double *c = counts.values();
-
-  float range = max - min;
-  if (range == 0)
-    return;
-
-  T *data = seq.values();
-  float scale = bins / range;
-
-  int dim = seq.dimension();
-  int64_t m0 = 1, m1 = 1, m2 = 1;
-  int64_t s0 = 0, s1 = 0, s2 = 0;
-  if (dim == 1)
-    { m2 = seq.size(0); s2 = seq.stride(0); }
-  else if (dim == 2)
-    { s1 = seq.stride(0); s2 = seq.stride(1);
-      m1 = seq.size(0); m2 = seq.size(1); }
-  else if (dim == 3)
-    { s0 = seq.stride(0); s1 = seq.stride(1); s2 = seq.stride(2);
-      m0 = seq.size(0); m1 = seq.size(1); m2 = seq.size(2); }
-
-  if (ignore_pad_value == NO_PAD_VALUE)
-    {
-      int64_t i = 0;
-      for (int64_t i0 = 0 ; i0 < m0 ; ++i0, i += s0 - m1*s1)
-        for (int64_t i1 = 0 ; i1 < m1 ; ++i1, i += s1 - m2*s2)
-          for (int64_t i2 = 0 ; i2 < m2 ; ++i2, i += s2)
-            {
-              int64_t b = static_cast<int> (scale * (data[i] - min));
-              if (b >= 0 && b < bins)
-                c[b] += 1;
-            }
-    }
-  else
-    {
-      int64_t i = 0;
-      for (int64_t i0 = 0 ; i0 < m0 ; ++i0, i += s0 - m1*s1)
-        for (int64_t i1 = 0 ; i1 < m1 ; ++i1, i += s1 - m2*s2)
-          for (int64_t i2 = 0 ; i2 < m2 ; ++i2, i += s2)
-            {
-              double v = static_cast<double> (data[i]);
-              if (v == NO_PAD_VALUE)
-                continue;
-              int64_t b = static_cast<int> (scale * (v - min));
-              if (b >= 0 && b < bins)
-                c[b] += 1;
-            }
-    }
+  bin_values(seq, min, max, counts.values(), counts.size(), ignore_pad_value, threads);
 }
 
 // ----------------------------------------------------------------------------
@@ -296,13 +381,15 @@ bin_counts_float64(PyObject *, PyObject *args, PyObject *keywds)
   DArray counts;
   float min, max;
   double ignore_pad_value = NO_PAD_VALUE;
-  const char *kwlist[] = {"array", "min", "max", "counts", "ignore_pad_value", NULL};
-  if (!PyArg_ParseTupleAndKeywords(args, keywds, const_cast<char *>("O&ffO&|$d"),
+  int threads = 1;
+  const char *kwlist[] = {"array", "min", "max", "counts", "ignore_pad_value",
+			  "threads", NULL};
+  if (!PyArg_ParseTupleAndKeywords(args, keywds, const_cast<char *>("O&ffO&|$di"),
 				   (char **)kwlist,
 				   parse_array, &seq,
 				   &min, &max,
 				   parse_writable_double_n_array, &counts,
-                                   &ignore_pad_value))
+                                   &ignore_pad_value, &threads))
     return NULL;
 
   if (seq.dimension() < 1 || seq.dimension() > 3)
@@ -319,7 +406,10 @@ bin_counts_float64(PyObject *, PyObject *args, PyObject *keywds)
       return NULL;
     }
 
-  call_template_function(bin_counts_float64, seq.value_type(), (seq, min, max, counts, ignore_pad_value));
+  Py_BEGIN_ALLOW_THREADS
+  call_template_function(bin_counts_float64, seq.value_type(),
+			 (seq, min, max, counts, ignore_pad_value, threads));
+  Py_END_ALLOW_THREADS
 
   return python_none();
 }
@@ -359,7 +449,9 @@ high_count_py(PyObject *, PyObject *args, PyObject *keywds)
     return NULL;
 
   int64_t n = 0;
+  Py_BEGIN_ALLOW_THREADS
   call_template_function(high_count, d.value_type(), (d, level, &n));
+  Py_END_ALLOW_THREADS
   return PyLong_FromLong(n);
 }
 
@@ -397,11 +489,108 @@ high_indices_py(PyObject *, PyObject *args, PyObject *keywds)
     return NULL;
 
   int64_t n = 0;
+  Py_BEGIN_ALLOW_THREADS
   call_template_function(high_count, d.value_type(), (d, level, &n));
+  Py_END_ALLOW_THREADS
   int *ijk;
   PyObject *indices = python_int_array(n, 3, &ijk);
+  if (indices == NULL)
+    return NULL;
+  Py_BEGIN_ALLOW_THREADS
   call_template_function(high_indices, d.value_type(), (d, level, ijk));
+  Py_END_ALLOW_THREADS
   return indices;
 }
 
+// ----------------------------------------------------------------------------
+// Mark bricks of size brick_size^3 that contain any value not equal to the
+// background value.  Scanning a brick stops at the first such value.
+// Each thread handles a range of brick planes along the first axis.
+//
+template<class T>
+static void occupied_bricks(const Reference_Counted_Array::Array<T> &d,
+			    int brick_size, double background, int threads,
+			    int64_t nb0, int64_t nb1, int64_t nb2,
+			    unsigned char *occupied)
+{
+  T *data = d.values();
+  int64_t s0 = d.stride(0), s1 = d.stride(1), s2 = d.stride(2);
+  int64_t m0 = d.size(0), m1 = d.size(1), m2 = d.size(2);
+  T bg = static_cast<T> (background);
+  int64_t bs = brick_size;
+  auto scan = [&](int64_t b0_begin, int64_t b0_end)
+    {
+      for (int64_t b0 = b0_begin ; b0 < b0_end ; ++b0)
+	for (int64_t b1 = 0 ; b1 < nb1 ; ++b1)
+	  for (int64_t b2 = 0 ; b2 < nb2 ; ++b2)
+	    {
+	      int64_t i0e = std::min(m0, (b0+1)*bs), i1e = std::min(m1, (b1+1)*bs),
+		i2e = std::min(m2, (b2+1)*bs);
+	      bool found = false;
+	      for (int64_t i0 = b0*bs ; i0 < i0e && !found ; ++i0)
+		for (int64_t i1 = b1*bs ; i1 < i1e && !found ; ++i1)
+		  {
+		    const T *row = data + i0*s0 + i1*s1;
+		    for (int64_t i2 = b2*bs ; i2 < i2e ; ++i2)
+		      if (row[i2*s2] != bg)
+			{ found = true; break; }
+		  }
+	      occupied[(b0*nb1 + b1)*nb2 + b2] = (found ? 1 : 0);
+	    }
+    };
+
+  int64_t nt = (m0*m1*m2 >= MIN_THREAD_ELEMENTS ?
+		Thread_Pool::thread_count(nb0, 1, std::max(threads, 1)) : 1);
+  Thread_Pool::run(nt, [&](int t) { scan((t*nb0)/nt, ((t+1)*nb0)/nt); });
+}
+
+// ----------------------------------------------------------------------------
+// Return brick indices (n by 3 array, x,y,z order) of bricks that contain
+// values different from the background value.
+//
+extern "C" PyObject *
+occupied_bricks_py(PyObject *, PyObject *args, PyObject *keywds)
+{
+  Numeric_Array d;
+  int brick_size = 32;
+  double background = 0;
+  int threads = 1;
+  const char *kwlist[] = {"array", "brick_size", "background", "threads", NULL};
+  if (!PyArg_ParseTupleAndKeywords(args, keywds, const_cast<char *>("O&|i$di"),
+				   (char **)kwlist,
+				   parse_3d_array, &d,
+				   &brick_size, &background, &threads))
+    return NULL;
+
+  if (brick_size <= 0)
+    {
+      PyErr_SetString(PyExc_ValueError,
+		      "occupied_bricks(): brick size must be positive");
+      return NULL;
+    }
+
+  int64_t nb0 = (d.size(0) + brick_size - 1) / brick_size,
+    nb1 = (d.size(1) + brick_size - 1) / brick_size,
+    nb2 = (d.size(2) + brick_size - 1) / brick_size;
+  std::vector<unsigned char> occupied(nb0*nb1*nb2, 0);
+  Py_BEGIN_ALLOW_THREADS
+  call_template_function(occupied_bricks, d.value_type(),
+			 (d, brick_size, background, threads, nb0, nb1, nb2,
+			  occupied.data()));
+  Py_END_ALLOW_THREADS
+
+  int64_t n = 0;
+  for (unsigned char o : occupied)
+    n += o;
+  int *ijk;
+  PyObject *bricks = python_int_array(n, 3, &ijk);
+  int64_t c = 0;
+  for (int64_t b0 = 0 ; b0 < nb0 ; ++b0)
+    for (int64_t b1 = 0 ; b1 < nb1 ; ++b1)
+      for (int64_t b2 = 0 ; b2 < nb2 ; ++b2)
+	if (occupied[(b0*nb1 + b1)*nb2 + b2])
+	  { ijk[c] = b2; ijk[c+1] = b1; ijk[c+2] = b0; c += 3; }
+  return bricks;
+}
+
 } // namespace Map_Cpp
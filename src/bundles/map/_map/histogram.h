@@ -32,10 +32,12 @@
 extern "C" {
 
 PyObject *minimum_and_maximum(PyObject *s, PyObject *args, PyObject *keywds);
+PyObject *array_statistics(PyObject *s, PyObject *args, PyObject *keywds);
 PyObject *bin_counts(PyObject *s, PyObject *args, PyObject *keywds);
 PyObject *bin_counts_float64(PyObject *s, PyObject *args, PyObject *keywds);
 PyObject *high_count_py(PyObject *s, PyObject *args, PyObject *keywds);
 PyObject *high_indices_py(PyObject *s, PyObject *args, PyObject *keywds);
+PyObject *occupied_bricks_py(PyObject *s, PyObject *args, PyObject *keywds);
 
 }
 
@@ -27,154 +27,467 @@
 // ----------------------------------------------------------------------------
 //
 #include <math.h>			// use floor()
+#include <algorithm>			// use std::lower_bound(), std::max()
+#include <atomic>			// use std::atomic
 #include <vector>			// use std::vector
 
 #include "interpolate.h"
 #include <arrays/rcarray.h>		// use Array<T>, Numeric_Array
+#include <arrays/threadpool.h>		// use Thread_Pool::parallel_for(), run()
 
 namespace Interpolate
 {
 
 // ----------------------------------------------------------------------------
+// Points are processed in batches, first computing grid cells for all points
+// in the batch with no branches so the compiler can vectorize the coordinate
+// transform, then looking up the data values.
 //
-inline bool data_cell(float xyz[3], float vtransform[3][4], int dsize[3],
-		      int bijk[3], float fijk[3], int edge_pad)
+const int CELL_BATCH = 8;
+
+// ----------------------------------------------------------------------------
+// Grid cell base index and fractional position in the cell for a batch of
+// points.
+//
+class Cell_Batch
 {
+public:
+  int bijk[3][CELL_BATCH];
+  float fijk[3][CELL_BATCH];
+  int inside[CELL_BATCH];
+};
+
+// ----------------------------------------------------------------------------
+//
+inline void data_cells(float vertices[][3], int count, float vtransform[3][4],
+		       int dsize[3], int edge_pad, Cell_Batch &cb)
+{
+  for (int p = 0 ; p < count ; ++p)
+    cb.inside[p] = 1;
   for (int a = 0 ; a < 3 ; ++a)
     {
-      float ia = (vtransform[a][0]*xyz[0] + vtransform[a][1]*xyz[1] +
-		  vtransform[a][2]*xyz[2] + vtransform[a][3]);
-      float fia = floor(ia);
-      int bia = static_cast<int>(fia);
-      //
-      // Would be better to test bounds with ia instead of bia because
-      // if ia exceeds range of int then bia may wrap back into range.
-      // But I observed case on Linux/Pentium4 where ia ~= 80, fia >= int(80),
-      // but not ia >= int(80).
-      //
-      if (bia < edge_pad || bia >= dsize[a]-edge_pad-1)
-	return false;
-      bijk[a] = bia;
-      fijk[a] = ia - fia;
+      float t0 = vtransform[a][0], t1 = vtransform[a][1], t2 = vtransform[a][2],
+	t3 = vtransform[a][3];
+      int bmin = edge_pad, bmax = dsize[a]-edge_pad-1;
+      int *bi = cb.bijk[a], *in = cb.inside;
+      float *fi = cb.fijk[a];
+      for (int p = 0 ; p < count ; ++p)
+	{
+	  float *xyz = vertices[p];
+	  float ia = t0*xyz[0] + t1*xyz[1] + t2*xyz[2] + t3;
+	  float fia = floor(ia);
+	  int bia = static_cast<int>(fia);
+	  //
+	  // Would be better to test bounds with ia instead of bia because
+	  // if ia exceeds range of int then bia may wrap back into range.
+	  // But I observed case on Linux/Pentium4 where ia ~= 80, fia >= int(80),
+	  // but not ia >= int(80).
+	  //
+	  in[p] &= (bia >= bmin && bia < bmax);
+	  bi[p] = bia;
+	  fi[p] = ia - fia;
+	}
     }
-  return true;
 }
 
 // ----------------------------------------------------------------------------
+// Split points into ranges computed by shared pool threads.  Outside point
+// indices from each range are appended in point order.  Only large point
+// sets are split since starting work on other threads costs about as much
+// as interpolating tens of thousands of points.
+//
+const int64_t MIN_THREAD_POINTS = 50000;
+
+template <class Range_Function>
+static void thread_point_ranges(int64_t n, int threads, std::vector<int> &outside,
+				Range_Function f)
+{
+  int nt = Thread_Pool::thread_count(n, MIN_THREAD_POINTS, std::max(threads, 1));
+  if (nt <= 1)
+    {
+      f(0, n, outside);
+      return;
+    }
+
+  // A std::bad_alloc in any range is rethrown by Thread_Pool::run().
+  std::vector<std::vector<int> > tout(nt);
+  Thread_Pool::run(nt, [&](int t) { f((t*n)/nt, ((t+1)*n)/nt, tout[t]); });
+  for (int t = 0 ; t < nt ; ++t)
+    outside.insert(outside.end(), tout[t].begin(), tout[t].end());
+}
+
+// ----------------------------------------------------------------------------
+// Value for a point of a cell batch that is inside the data.
 //
 template <class T>
-static void interpolate_volume(float vertices[][3], int64_t n,
-			       float vtransform[3][4],
-			       const Reference_Counted_Array::Array<T> &data,
-			       Interpolation_Method method,
-			       float *values, std::vector<int> &outside)
+inline float cell_value(const Cell_Batch &cb, int p, const T *d,
+			int64_t si, int64_t sj, int64_t sk, Interpolation_Method method)
+{
+  int64_t offset = cb.bijk[0][p]*si + cb.bijk[1][p]*sj + cb.bijk[2][p]*sk;
+  const T *dc = d + offset;
+  if (method == INTERP_LINEAR)
+    {
+      float fi1 = cb.fijk[0][p], fj1 = cb.fijk[1][p], fk1 = cb.fijk[2][p];
+      float fi0 = 1 - fi1, fj0 = 1 - fj1, fk0 = 1 - fk1;
+      return (fk0*(fj0*(fi0 * dc[0] + fi1 * dc[si]) +
+		   fj1*(fi0 * dc[sj] + fi1 * dc[si+sj])) +
+	      fk1*(fj0*(fi0 * dc[sk] + fi1 * dc[si+sk]) +
+		   fj1*(fi0 * dc[sj+sk] + fi1 * dc[si+sj+sk])));
+    }
+  return dc[(cb.fijk[0][p]>=0.5 ? si : 0) +
+	    (cb.fijk[1][p]>=0.5 ? sj : 0) +
+	    (cb.fijk[2][p]>=0.5 ? sk : 0)];
+}
+
+// ----------------------------------------------------------------------------
+//
+template <class T>
+static void interpolate_volume_range(float vertices[][3], int64_t mstart, int64_t mend,
+				     float vtransform[3][4],
+				     const Reference_Counted_Array::Array<T> &data,
+				     Interpolation_Method method,
+				     float *values, std::vector<int> &outside)
 {
   int dsize[3] = {(int)data.size(2), (int)data.size(1), (int)data.size(0)};
   int64_t si = data.stride(2), sj = data.stride(1), sk = data.stride(0);
   T *d = data.values();
-  int bijk[3];
-  float fijk[3];
-  for (int64_t m = 0 ; m < n ; ++m)
+  Cell_Batch cb;
+  for (int64_t m0 = mstart ; m0 < mend ; m0 += CELL_BATCH)
     {
-      float *xyz = vertices[m];
-      if (!data_cell(xyz, vtransform, dsize, bijk, fijk, 0))
-	{
-	  values[m] = 0;
-	  outside.push_back(m);
-	  continue;
-	}
-      int64_t offset = bijk[0]*si + bijk[1]*sj + bijk[2]*sk;
-      T *dc = d + offset;
-      if (method == INTERP_LINEAR)
+      int count = static_cast<int>(mend - m0 < CELL_BATCH ? mend - m0 : CELL_BATCH);
+      data_cells(vertices + m0, count, vtransform, dsize, 0, cb);
+      for (int p = 0 ; p < count ; ++p)
 	{
-	  float fi1 = fijk[0], fj1 = fijk[1], fk1 = fijk[2];
-	  float fi0 = 1 - fi1, fj0 = 1 - fj1, fk0 = 1 - fk1;
-	  values[m] = (fk0*(fj0*(fi0 * dc[0] + fi1 * dc[si]) +
-			    fj1*(fi0 * dc[sj] + fi1 * dc[si+sj])) +
-		       fk1*(fj0*(fi0 * dc[sk] + fi1 * dc[si+sk]) +
-			    fj1*(fi0 * dc[sj+sk] + fi1 * dc[si+sj+sk])));
+	  int64_t m = m0 + p;
+	  if (!cb.inside[p])
+	    {
+	      values[m] = 0;
+	      outside.push_back(m);
+	      continue;
+	    }
+	  values[m] = cell_value(cb, p, d, si, sj, sk, method);
 	}
-      else
-	values[m] = dc[(fijk[0]>=0.5 ? si : 0) +
-		       (fijk[1]>=0.5 ? sj : 0) +
-		       (fijk[2]>=0.5 ? sk : 0)];
     }
 }
 
+// ----------------------------------------------------------------------------
+//
+template <class T>
+static void interpolate_volume(float vertices[][3], int64_t n,
+			       float vtransform[3][4],
+			       const Reference_Counted_Array::Array<T> &data,
+			       Interpolation_Method method,
+			       float *values, std::vector<int> &outside,
+			       int threads)
+{
+  thread_point_ranges(n, threads, outside,
+		      [&](int64_t m0, int64_t m1, std::vector<int> &out)
+		      { interpolate_volume_range(vertices, m0, m1, vtransform, data,
+						 method, values, out); });
+}
+
 // ----------------------------------------------------------------------------
 //
 void interpolate_volume_data(float vertices[][3], int64_t n,
 			     float vtransform[3][4],
 			     const Reference_Counted_Array::Numeric_Array &data,
 			     Interpolation_Method method,
-			     float *values, std::vector<int> &outside)
+			     float *values, std::vector<int> &outside,
+			     int threads)
 {
   call_template_function(interpolate_volume, data.value_type(),
   			 (vertices, n, vtransform, data, method,
-			  values, outside));
+			  values, outside, threads));
 }
 
 // ----------------------------------------------------------------------------
+// Grid points of a row are made one cell batch at a time, so no array of
+// all grid points is needed.  Returns the number of points outside the data.
 //
 template <class T>
-static void interpolate_gradient(float vertices[][3], int64_t n,
-				 float vtransform[3][4],
-				 const Reference_Counted_Array::Array<T> &data,
-				 Interpolation_Method method,
-				 float gradients[][3],
-				 std::vector<int> &outside)
+static int64_t interpolate_grid_planes(float gtransform[3][4],
+				       const Reference_Counted_Array::Array<T> &data,
+				       Interpolation_Method method, const FArray &values,
+				       int64_t k0, int64_t k1)
+{
+  int dsize[3] = {(int)data.size(2), (int)data.size(1), (int)data.size(0)};
+  int64_t si = data.stride(2), sj = data.stride(1), sk = data.stride(0);
+  const T *d = data.values();
+  int64_t gisize = values.size(2), gjsize = values.size(1);
+  int64_t vs0 = values.stride(0), vs1 = values.stride(1), vs2 = values.stride(2);
+  float *v = values.values();
+  float gijk[CELL_BATCH][3];
+  Cell_Batch cb;
+  int64_t outside = 0;
+  for (int64_t k = k0 ; k < k1 ; ++k)
+    for (int64_t j = 0 ; j < gjsize ; ++j)
+      {
+	float *vrow = v + k*vs0 + j*vs1;
+	for (int64_t i0 = 0 ; i0 < gisize ; i0 += CELL_BATCH)
+	  {
+	    int count = static_cast<int>(gisize - i0 < CELL_BATCH ? gisize - i0 : CELL_BATCH);
+	    for (int p = 0 ; p < count ; ++p)
+	      {
+		gijk[p][0] = i0 + p;
+		gijk[p][1] = j;
+		gijk[p][2] = k;
+	      }
+	    data_cells(gijk, count, gtransform, dsize, 0, cb);
+	    for (int p = 0 ; p < count ; ++p)
+	      if (cb.inside[p])
+		vrow[(i0+p)*vs2] = cell_value(cb, p, d, si, sj, sk, method);
+	      else
+		{
+		  vrow[(i0+p)*vs2] = 0;
+		  outside += 1;
+		}
+	  }
+      }
+  return outside;
+}
+
+// ----------------------------------------------------------------------------
+// Threads take slabs of grid planes with at least MIN_THREAD_POINTS points.
+//
+template <class T>
+static void interpolate_grid(float gtransform[3][4],
+			     const Reference_Counted_Array::Array<T> &data,
+			     Interpolation_Method method, const FArray &values,
+			     int threads, int64_t &outside)
+{
+  int64_t ksize = values.size(0), plane = values.size(1) * values.size(2);
+  int64_t slab = (plane > 0 ? (MIN_THREAD_POINTS + plane - 1) / plane : ksize);
+  std::atomic<int64_t> out(0);
+  Thread_Pool::parallel_for(ksize, [&](int64_t k0, int64_t k1) {
+      out += interpolate_grid_planes(gtransform, data, method, values, k0, k1);
+    }, slab, threads);
+  outside = out;
+}
+
+// ----------------------------------------------------------------------------
+//
+int64_t interpolate_volume_on_grid(float gtransform[3][4],
+				   const Reference_Counted_Array::Numeric_Array &data,
+				   Interpolation_Method method, const FArray &values,
+				   int threads)
+{
+  int64_t outside = 0;
+  call_template_function(interpolate_grid, data.value_type(),
+			 (gtransform, data, method, values, threads, outside));
+  return outside;
+}
+
+// ----------------------------------------------------------------------------
+// Number of points interpolated between checks of the early stopping bound.
+//
+const int64_t FIT_BOUND_CHECK_POINTS = 4096;
+
+// ----------------------------------------------------------------------------
+// Largest average map value possible if the r remaining points are inside
+// the map with values at most vmax.
+//
+static double average_map_value_bound(const Fit_Sums &sums, int64_t r, double vmax)
+{
+  double a = (sums.inside > 0 ? sums.sv / sums.inside : vmax);
+  if (r > 0)
+    {
+      double ar = (sums.sv + r*vmax) / (sums.inside + r);
+      if (ar > a)
+	a = ar;
+    }
+  return a;
+}
+
+// ----------------------------------------------------------------------------
+// Largest correlation swv/sqrt(sww*svv) possible given the sums so far.  The
+// remaining points have weights with squares summing to wwr and add q to svv
+// with 0 <= q <= qmax.  By Cauchy-Schwarz they add at most sqrt(wwr*q) to swv.
+//
+static double correlation_bound(const Fit_Sums &sums, double wwtotal, double wwr,
+				double qmax)
+{
+  if (wwtotal <= 0)
+    return 0;
+  double a = sums.swv, b = sqrt(wwr), c = sums.svv;
+  double qlist[3] = {0, qmax, -1};
+  if (a > 0 && c > 0)
+    {
+      double qs = b*c/a;		// Maximum of (a+b*sqrt(q))/sqrt(c+q)
+      qs *= qs;
+      if (qs < qmax)
+	qlist[2] = qs;
+    }
+  double cmax = -1;
+  for (int i = 0 ; i < 3 ; ++i)
+    {
+      double q = qlist[i];
+      if (q < 0 || c + q <= 0)
+	continue;
+      double cq = (a + b*sqrt(q)) / sqrt(wwtotal*(c + q));
+      if (cq > cmax)
+	cmax = cq;
+    }
+  return (cmax > -1 ? cmax : 0);
+}
+
+// ----------------------------------------------------------------------------
+//
+template <class T>
+static void interpolate_fit(float vertices[][3], int64_t n, float *weights,
+			    float vtransform[3][4],
+			    const Reference_Counted_Array::Array<T> &data,
+			    Interpolation_Method method, Fit_Sums &sums,
+			    Fit_Bound_Metric bound_metric, double bound,
+			    double max_abs_value)
+{
+  double wwtotal = 0;
+  if (weights && bound_metric == BOUND_CORRELATION)
+    for (int64_t m = 0 ; m < n ; ++m)
+      wwtotal += static_cast<double>(weights[m])*weights[m];
+
+  int64_t bsize = (n < FIT_BOUND_CHECK_POINTS ? n : FIT_BOUND_CHECK_POINTS);
+  std::vector<float> values(bsize);
+  std::vector<int> outside;
+  for (int64_t m0 = 0 ; m0 < n ; m0 += bsize)
+    {
+      int64_t m1 = (m0 + bsize < n ? m0 + bsize : n);
+      outside.clear();
+      interpolate_volume_range(vertices + m0, 0, m1-m0, vtransform, data, method,
+			       values.data(), outside);
+      sums.inside += (m1 - m0) - outside.size();
+      double sv = 0, svv = 0, sw = 0, sww = 0, swv = 0;
+      const float *v = values.data();
+      if (weights)
+	{
+	  const float *w = weights + m0;
+	  for (int64_t i = 0 ; i < m1-m0 ; ++i)
+	    {
+	      double vi = v[i], wi = w[i];
+	      sv += vi; svv += vi*vi; sw += wi; sww += wi*wi; swv += wi*vi;
+	    }
+	}
+      else
+	for (int64_t i = 0 ; i < m1-m0 ; ++i)
+	  sv += v[i];
+      sums.sv += sv; sums.svv += svv; sums.sw += sw; sums.sww += sww; sums.swv += swv;
+
+      int64_t r = n - m1;
+      if (r == 0)
+	break;
+      double best;
+      if (bound_metric == BOUND_AVERAGE_MAP_VALUE)
+	best = average_map_value_bound(sums, r, max_abs_value);
+      else if (bound_metric == BOUND_CORRELATION && weights)
+	best = correlation_bound(sums, wwtotal, wwtotal - sums.sww,
+				 r*max_abs_value*max_abs_value);
+      else
+	continue;
+      if (best < bound)
+	{
+	  sums.stopped = true;
+	  break;
+	}
+    }
+}
+
+// ----------------------------------------------------------------------------
+//
+void interpolate_fit_sums(float vertices[][3], int64_t n, float *weights,
+			  float vtransform[3][4],
+			  const Reference_Counted_Array::Numeric_Array &data,
+			  Interpolation_Method method, Fit_Sums &sums,
+			  Fit_Bound_Metric bound_metric, double bound,
+			  double max_abs_value)
+{
+  call_template_function(interpolate_fit, data.value_type(),
+  			 (vertices, n, weights, vtransform, data, method, sums,
+			  bound_metric, bound, max_abs_value));
+}
+
+// ----------------------------------------------------------------------------
+//
+template <class T>
+static void interpolate_gradient_range(float vertices[][3], int64_t mstart, int64_t mend,
+				       float vtransform[3][4],
+				       const Reference_Counted_Array::Array<T> &data,
+				       Interpolation_Method method,
+				       float gradients[][3],
+				       std::vector<int> &outside)
 {
   int dsize[3] = {(int)data.size(2), (int)data.size(1), (int)data.size(0)};
   int64_t stride[3] = {data.stride(2), data.stride(1), data.stride(0)};
   T *d = data.values();
-  int bijk[3];
-  float fijk[3];
-  for (int64_t m = 0 ; m < n ; ++m)
+  Cell_Batch cb;
+  for (int64_t m0 = mstart ; m0 < mend ; m0 += CELL_BATCH)
     {
-      float *xyz = vertices[m];
-      float *grad = gradients[m];
-      if (!data_cell(xyz, vtransform, dsize, bijk, fijk, 1))
+      int count = static_cast<int>(mend - m0 < CELL_BATCH ? mend - m0 : CELL_BATCH);
+      data_cells(vertices + m0, count, vtransform, dsize, 1, cb);
+      for (int p = 0 ; p < count ; ++p)
 	{
-	  grad[0] = grad[1] = grad[2] = 0;
-	  outside.push_back(m);
-	  continue;
-	}
-      int64_t offset = bijk[0]*stride[0] + bijk[1]*stride[1] + bijk[2]*stride[2];
-      T *dc = d + offset;
-      float gijk[3] = {0, 0, 0};
-      if (method == INTERP_LINEAR)    // Average gradients at 8 cell corners.
-	for (int oi = 0 ; oi < 2 ; ++oi)
-	  {
-	    float wi = (oi ? fijk[0] : 1-fijk[0]);
-	    for (int oj = 0 ; oj < 2 ; ++oj)
+	  int64_t m = m0 + p;
+	  float *grad = gradients[m];
+	  if (!cb.inside[p])
+	    {
+	      grad[0] = grad[1] = grad[2] = 0;
+	      outside.push_back(m);
+	      continue;
+	    }
+	  float fijk[3] = {cb.fijk[0][p], cb.fijk[1][p], cb.fijk[2][p]};
+	  int64_t offset = (cb.bijk[0][p]*stride[0] + cb.bijk[1][p]*stride[1] +
+			    cb.bijk[2][p]*stride[2]);
+	  T *dc = d + offset;
+	  float gijk[3] = {0, 0, 0};
+	  if (method == INTERP_LINEAR)    // Average gradients at 8 cell corners.
+	    for (int oi = 0 ; oi < 2 ; ++oi)
 	      {
-		float wij = wi * (oj ? fijk[1] : 1-fijk[1]);
-		for (int ok = 0 ; ok < 2 ; ++ok)
+		float wi = (oi ? fijk[0] : 1-fijk[0]);
+		for (int oj = 0 ; oj < 2 ; ++oj)
 		  {
-		    float wijk = .5 * wij * (ok ? fijk[2] : 1-fijk[2]);
-		    int64_t oijk = oi*stride[0] + oj*stride[1] + ok*stride[2];
-		    T *dijk = dc + oijk;
-		    for (int a = 0 ; a < 3 ; ++a)
-		      gijk[a] += wijk * (*(dijk+stride[a]) - *(dijk-stride[a]));
+		    float wij = wi * (oj ? fijk[1] : 1-fijk[1]);
+		    for (int ok = 0 ; ok < 2 ; ++ok)
+		      {
+			float wijk = .5 * wij * (ok ? fijk[2] : 1-fijk[2]);
+			int64_t oijk = oi*stride[0] + oj*stride[1] + ok*stride[2];
+			T *dijk = dc + oijk;
+			for (int a = 0 ; a < 3 ; ++a)
+			  gijk[a] += wijk * (*(dijk+stride[a]) - *(dijk-stride[a]));
+		      }
 		  }
 	      }
-	  }
-      else	// Nearest grid point
-	{
-	  T *dijk = &dc[(fijk[0]>=0.5 ? stride[0] : 0) +
-			(fijk[1]>=0.5 ? stride[1] : 0) +
-			(fijk[2]>=0.5 ? stride[2] : 0)];
+	  else	// Nearest grid point
+	    {
+	      T *dijk = &dc[(fijk[0]>=0.5 ? stride[0] : 0) +
+			    (fijk[1]>=0.5 ? stride[1] : 0) +
+			    (fijk[2]>=0.5 ? stride[2] : 0)];
+	      for (int a = 0 ; a < 3 ; ++a)
+		gijk[a] = *(dijk+stride[a]) - *(dijk-stride[a]);
+	    }
+	  // Transform discrete gradients to vertex coordinate system.
 	  for (int a = 0 ; a < 3 ; ++a)
-	    gijk[a] = *(dijk+stride[a]) - *(dijk-stride[a]);
+	    grad[a] = (gijk[0]*vtransform[0][a] +
+		       gijk[1]*vtransform[1][a] +
+		       gijk[2]*vtransform[2][a]);
 	}
-      // Transform discrete gradients to vertex coordinate system.
-      for (int a = 0 ; a < 3 ; ++a)
-	grad[a] = (gijk[0]*vtransform[0][a] +
-		   gijk[1]*vtransform[1][a] +
-		   gijk[2]*vtransform[2][a]);
     }
 }
 
+// ----------------------------------------------------------------------------
+//
+template <class T>
+static void interpolate_gradient(float vertices[][3], int64_t n,
+				 float vtransform[3][4],
+				 const Reference_Counted_Array::Array<T> &data,
+				 Interpolation_Method method,
+				 float gradients[][3],
+				 std::vector<int> &outside,
+				 int threads)
+{
+  thread_point_ranges(n, threads, outside,
+		      [&](int64_t m0, int64_t m1, std::vector<int> &out)
+		      { interpolate_gradient_range(vertices, m0, m1, vtransform, data,
+						   method, gradients, out); });
+}
+
 // ----------------------------------------------------------------------------
 //
 void interpolate_volume_gradient(float vertices[][3], int64_t n,
@@ -182,14 +495,20 @@ void interpolate_volume_gradient(float vertices[][3], int64_t n,
 				 const Reference_Counted_Array::Numeric_Array &data,
 				 Interpolation_Method method,
 				 float gradients[][3],
-				 std::vector<int> &outside)
+				 std::vector<int> &outside,
+				 int threads)
 {
   call_template_function(interpolate_gradient, data.value_type(),
   			 (vertices, n, vtransform, data, method,
-			  gradients, outside));
+			  gradients, outside, threads));
 }
     
+// Vertices colored per thread pool task.
+const int64_t COLOR_CHUNK = 65536;
+
 // ----------------------------------------------------------------------------
+// Color data values must be increasing.  The colormap interval is found by
+// binary search so colormaps with many values stay fast.
 //
 void interpolate_colormap(float values[], int64_t n,
 			  float color_data_values[], int m,
@@ -198,7 +517,8 @@ void interpolate_colormap(float values[], int64_t n,
 			  float rgba_below_value_range[4],
 			  float rgba[][4])
 {
-  for (int64_t k = 0 ; k < n ; ++k)
+  Thread_Pool::parallel_for(n, [=](int64_t k0, int64_t k1) {
+  for (int64_t k = k0 ; k < k1 ; ++k)
     {
       float v = values[k];
       float *rgbak = rgba[k];
@@ -210,9 +530,10 @@ void interpolate_colormap(float values[], int64_t n,
 	  rgbak[a] = rgba_above_value_range[a];
       else
 	{
-	  int j = 1;
-	  while (v > color_data_values[j])
-	    j += 1;
+	  // First j >= 1 with v <= color_data_values[j].
+	  int j = (m == 1 ? 1 :
+		   std::lower_bound(color_data_values + 1, color_data_values + m - 1, v)
+		   - color_data_values);
 	  float v0 = color_data_values[j-1], v1 = color_data_values[j];
 	  float f1 = (v1 > v0 ? (v - v0) / (v1 - v0) : 0);
 	  float f0 = 1 - f1;
@@ -221,6 +542,7 @@ void interpolate_colormap(float values[], int64_t n,
             rgbak[a] = f0*c0[a]+f1*c1[a];
 	}
     }
+  }, COLOR_CHUNK);
 }
             
 // ----------------------------------------------------------------------------
@@ -229,12 +551,14 @@ void set_outside_volume_colors(int *outside, int64_t n,
 			       float rgba_outside_volume[4],
 			       float rgba[][4])
 {
-  for (int64_t k = 0 ; k < n ; ++k)
-    {
-      float *rgbak = rgba[outside[k]];
-      for (int a = 0 ; a < 4 ; ++a)
-	rgbak[a] = rgba_outside_volume[a];
-    }
+  Thread_Pool::parallel_for(n, [=](int64_t k0, int64_t k1) {
+      for (int64_t k = k0 ; k < k1 ; ++k)
+	{
+	  float *rgbak = rgba[outside[k]];
+	  for (int a = 0 ; a < 4 ; ++a)
+	    rgbak[a] = rgba_outside_volume[a];
+	}
+    }, COLOR_CHUNK);
 }
 
 }  // end of namespace interpolate
@@ -43,14 +43,47 @@ void interpolate_volume_data(float vertices[][3], int64_t n,
 			     float vtransform[3][4],
 			     const Reference_Counted_Array::Numeric_Array &data,
 			     Interpolation_Method method,
-			     float *values, std::vector<int> &outside);
+			     float *values, std::vector<int> &outside,
+			     int threads = 1);
+
+// Interpolate at every point of a 3-d grid, gtransform taking grid indices
+// to data indices, setting values outside the data to zero.  Returns the
+// number of grid points outside the data.
+int64_t interpolate_volume_on_grid(float gtransform[3][4],
+				   const Reference_Counted_Array::Numeric_Array &data,
+				   Interpolation_Method method, const FArray &values,
+				   int threads = 1);
 
 void interpolate_volume_gradient(float vertices[][3], int64_t n,
 				 float vtransform[3][4],
 				 const Reference_Counted_Array::Numeric_Array &data,
 				 Interpolation_Method method,
 				 float gradients[][3],
-				 std::vector<int> &outside);
+				 std::vector<int> &outside,
+				 int threads = 1);
+
+// Sums over points of interpolated map values v and point weights w used
+// to compute average map value, overlap and correlations.
+class Fit_Sums
+{
+ public:
+  Fit_Sums() : inside(0), sv(0), svv(0), sw(0), sww(0), swv(0), stopped(false) {}
+  int64_t inside;
+  double sv, svv, sw, sww, swv;
+  bool stopped;		// Score could not exceed bound so sums are partial.
+};
+
+enum Fit_Bound_Metric {BOUND_NONE, BOUND_AVERAGE_MAP_VALUE, BOUND_CORRELATION};
+
+// Weights can be NULL if only average map value is needed.  If a bound
+// metric is given, stop when the metric cannot exceed the bound value
+// assuming no map value has magnitude exceeding max_abs_value.
+void interpolate_fit_sums(float vertices[][3], int64_t n, float *weights,
+			  float vtransform[3][4],
+			  const Reference_Counted_Array::Numeric_Array &data,
+			  Interpolation_Method method, Fit_Sums &sums,
+			  Fit_Bound_Metric bound_metric = BOUND_NONE,
+			  double bound = 0, double max_abs_value = 0);
 
 void interpolate_colormap(float values[], int64_t n,
 			  float color_data_values[], int m,
@@ -28,6 +28,8 @@
 // Python interface to interpolation routines.
 //
 #include <Python.h>			// use PyObject
+#include <math.h>			// use sqrt()
+#include <string.h>			// use strcmp()
 
 #include <vector>			// use std::vector
 
@@ -50,16 +52,18 @@ extern "C" PyObject *interpolate_volume_data(PyObject *, PyObject *args,
   float vtransform[3][4];
   Numeric_Array data;
   Interpolate::Interpolation_Method method;
+  int threads = 1;
   const char *kwlist[] = {"points", "transform", "array",
-			  "method", "values", NULL};
+			  "method", "values", "threads", NULL};
   if (!PyArg_ParseTupleAndKeywords(args, keywds,
-				   const_cast<char *>("O&O&O&O&|O&"),
+				   const_cast<char *>("O&O&O&O&|O&i"),
 				   (char **)kwlist,
 				   parse_float_n3_array, &vertices,
 				   parse_float_3x4_array, &(vtransform[0][0]),
 				   parse_3d_array, &data,
 				   parse_interpolation_method, &method,
-				   parse_writable_float_n_array, &values) ||
+				   parse_writable_float_n_array, &values,
+				   &threads) ||
       (values.dimension() == 1 && !check_array_size(values, vertices.size(0), true)))
     return NULL;
 
@@ -76,7 +80,7 @@ extern "C" PyObject *interpolate_volume_data(PyObject *, PyObject *args,
 
   Py_BEGIN_ALLOW_THREADS
     Interpolate::interpolate_volume_data(varray, n, vtransform, data, method,
-					 values.values(), outside);
+					 values.values(), outside, threads);
   Py_END_ALLOW_THREADS
 
   int *osp = (outside.size() == 0 ? NULL : &outside.front());
@@ -87,6 +91,36 @@ extern "C" PyObject *interpolate_volume_data(PyObject *, PyObject *args,
   return result;
 }
 
+// ----------------------------------------------------------------------------
+//
+extern "C" PyObject *interpolate_volume_on_grid(PyObject *, PyObject *args,
+						PyObject *keywds)
+{
+  float gtransform[3][4];
+  Numeric_Array data;
+  Interpolate::Interpolation_Method method;
+  FArray values;
+  int threads = 1;
+  const char *kwlist[] = {"transform", "array", "method", "values", "threads", NULL};
+  if (!PyArg_ParseTupleAndKeywords(args, keywds,
+				   const_cast<char *>("O&O&O&O&|i"),
+				   (char **)kwlist,
+				   parse_float_3x4_array, &(gtransform[0][0]),
+				   parse_3d_array, &data,
+				   parse_interpolation_method, &method,
+				   parse_writable_float_3d_array, &values,
+				   &threads))
+    return NULL;
+
+  int64_t outside;
+  Py_BEGIN_ALLOW_THREADS
+    outside = Interpolate::interpolate_volume_on_grid(gtransform, data, method,
+						      values, threads);
+  Py_END_ALLOW_THREADS
+
+  return PyLong_FromLongLong(outside);
+}
+
 // ----------------------------------------------------------------------------
 //
 extern "C" PyObject *interpolate_volume_gradient(PyObject *, PyObject *args,
@@ -96,16 +130,18 @@ extern "C" PyObject *interpolate_volume_gradient(PyObject *, PyObject *args,
   float vtransform[3][4];
   Numeric_Array data;
   Interpolate::Interpolation_Method method;
+  int threads = 1;
   const char *kwlist[] = {"points", "transform", "array",
-			  "method", "gradients", NULL};
+			  "method", "gradients", "threads", NULL};
   if (!PyArg_ParseTupleAndKeywords(args, keywds,
-				   const_cast<char *>("O&O&O&O&|O&"),
+				   const_cast<char *>("O&O&O&O&|O&i"),
 				   (char **)kwlist,
 				   parse_float_n3_array, &vertices,
 				   parse_float_3x4_array, &(vtransform[0][0]),
 				   parse_3d_array, &data,
 				   parse_interpolation_method, &method,
-				   parse_writable_float_n3_array, &gradients) ||
+				   parse_writable_float_n3_array, &gradients,
+				   &threads) ||
       (gradients.dimension() == 2 && !check_array_size(gradients, vertices.size(0), 3, true)))
     return NULL;
 
@@ -123,8 +159,7 @@ extern "C" PyObject *interpolate_volume_gradient(PyObject *, PyObject *args,
 
   Py_BEGIN_ALLOW_THREADS
     Interpolate::interpolate_volume_gradient(varray, n, vtransform, data, method,
-					     grad, outside);
-
+					     grad, outside, threads);
   Py_END_ALLOW_THREADS
 
   int *osp = (outside.size() == 0 ? NULL : &outside.front());
@@ -135,6 +170,88 @@ extern "C" PyObject *interpolate_volume_gradient(PyObject *, PyObject *args,
   return result;
 }
 
+// ----------------------------------------------------------------------------
+// Compute average map value, points inside map, and if weights are given
+// the overlap, correlation and correlation about mean all in one pass.  If a
+// stop metric is given return None as soon as it cannot exceed stop_below.
+//
+extern "C" PyObject *interpolate_fit_statistics(PyObject *, PyObject *args,
+						PyObject *keywds)
+{
+  FArray vertices, weights;
+  float vtransform[3][4];
+  Numeric_Array data;
+  Interpolate::Interpolation_Method method = Interpolate::INTERP_LINEAR;
+  PyObject *py_weights = Py_None;
+  const char *stop_metric = NULL;
+  double stop_below = 0, max_abs_value = 0;
+  const char *kwlist[] = {"points", "transform", "array", "weights", "method",
+			  "stop_metric", "stop_below", "maximum_abs_value", NULL};
+  if (!PyArg_ParseTupleAndKeywords(args, keywds,
+				   const_cast<char *>("O&O&O&|OO&zdd"),
+				   (char **)kwlist,
+				   parse_float_n3_array, &vertices,
+				   parse_float_3x4_array, &(vtransform[0][0]),
+				   parse_3d_array, &data,
+				   &py_weights,
+				   parse_interpolation_method, &method,
+				   &stop_metric, &stop_below, &max_abs_value))
+    return NULL;
+
+  int64_t n = vertices.size(0);
+  float *w = NULL;
+  if (py_weights != Py_None)
+    {
+      if (!parse_float_n_array(py_weights, &weights) ||
+	  !check_array_size(weights, n))
+	return NULL;
+      weights = weights.contiguous_array();
+      w = weights.values();
+    }
+
+  Interpolate::Fit_Bound_Metric bound_metric = Interpolate::BOUND_NONE;
+  if (stop_metric == NULL)
+    bound_metric = Interpolate::BOUND_NONE;
+  else if (strcmp(stop_metric, "average map value") == 0)
+    bound_metric = Interpolate::BOUND_AVERAGE_MAP_VALUE;
+  else if (strcmp(stop_metric, "correlation") == 0 && w)
+    bound_metric = Interpolate::BOUND_CORRELATION;
+  else
+    {
+      PyErr_Format(PyExc_ValueError, "Stop metric must be 'average map value' or 'correlation' with weights, got %s", stop_metric);
+      return NULL;
+    }
+
+  FArray vcontig = vertices.contiguous_array();
+  float (*varray)[3] = reinterpret_cast<float(*)[3]>(vcontig.values());
+
+  Interpolate::Fit_Sums sums;
+  Py_BEGIN_ALLOW_THREADS
+    Interpolate::interpolate_fit_sums(varray, n, w, vtransform, data, method, sums,
+				      bound_metric, stop_below, max_abs_value);
+  Py_END_ALLOW_THREADS
+
+  if (sums.stopped)
+    return python_none();
+
+  double amv = (sums.inside > 0 ? sums.sv / sums.inside : 0);
+  PyObject *py_amv = PyFloat_FromDouble(amv);
+  PyObject *py_inside = PyLong_FromLongLong(sums.inside);
+  if (w == NULL)
+    return python_tuple(py_amv, py_inside, python_none(), python_none(), python_none());
+
+  // Same as Python chimerax.map_fit.fitmap.overlap_and_correlation().
+  double olap = sums.swv;
+  double d = sqrt(sums.sww * sums.svv);
+  double cor = (d > 0 ? olap / d : 0);
+  double m1 = (n > 0 ? sums.sw / n : 0), m2 = (n > 0 ? sums.sv / n : 0);
+  double d2 = (sums.sww - n*m1*m1)*(sums.svv - n*m2*m2);
+  double dm = (d2 > 0 ? sqrt(d2) : 0);
+  double corm = (dm > 0 ? (olap - n*m1*m2) / dm : 0);
+  return python_tuple(py_amv, py_inside, PyFloat_FromDouble(olap),
+		      PyFloat_FromDouble(cor), PyFloat_FromDouble(corm));
+}
+
 // ----------------------------------------------------------------------------
 //
 static int parse_interpolation_method(PyObject *arg, void *m)
@@ -33,6 +33,11 @@ extern "C" {
 
 PyObject *interpolate_volume_data(PyObject *, PyObject *args);
 PyObject *interpolate_volume_gradient(PyObject *, PyObject *args);
+// Interpolate map values at all points of a grid, writing a float32 3-d array.
+// The transform takes grid indices to array indices, returns number outside.
+// interpolate_volume_on_grid(transform, array, method, values, threads = 1) -> int
+PyObject *interpolate_volume_on_grid(PyObject *, PyObject *args, PyObject *keywds);
+PyObject *interpolate_fit_statistics(PyObject *, PyObject *args, PyObject *keywds);
 PyObject *interpolate_colormap(PyObject *, PyObject *args);
 PyObject *set_outside_volume_colors(PyObject *, PyObject *args);
 
@@ -23,63 +23,165 @@
  */
 
 // ----------------------------------------------------------------------------
-// Compute linear combination of matrices.  5x faster than numpy.
+// Compute local correlation of two maps over cubic windows.
 //
 #include <Python.h>			// use PyObject
+#include <math.h>			// use sqrt()
+
+#include <algorithm>			// use std::max
+#include <vector>			// use std::vector
 
 #include <arrays/pythonarray.h>		// use array_from_python()
 #include <arrays/rcarray.h>		// use Numeric_Array, Array<T>
+#include <arrays/threadpool.h>		// use Thread_Pool::run()
 
 namespace Map_Cpp
 {
 // ----------------------------------------------------------------------------
+// Number of sums (x, y, x*x, y*y, x*y) needed for the correlation.
+//
+const int NSUMS = 5;
+
+// Variances smaller than this fraction of the sum of squares are zero.
+const double VARIANCE_TOLERANCE = 1e-10;
+
+// ----------------------------------------------------------------------------
+// Compute sums of x, y, x*x, y*y and x*y over w by w windows in plane i0
+// using a summed-area table so the cost does not depend on window size.
+// The sat array holds (s1+1)*(s2+1)*NSUMS values and wsums holds
+// (s1-w+1)*(s2-w+1)*NSUMS values.
 //
 template<class T>
-static void local_corr(const Reference_Counted_Array::Array<T> &m1,
-		       const Reference_Counted_Array::Array<T> &m2,
-		       int64_t window_size, bool subtract_mean, FArray &mc)
+static void plane_window_sums(const T *v1, const T *v2, int64_t i0,
+			      int64_t s1, int64_t s2,
+			      int64_t st0, int64_t st1, int64_t st2,
+			      int64_t w, double *sat, double *wsums)
+{
+  int64_t r = NSUMS*(s2+1);	// Summed-area table row size
+  for (int64_t i = 0 ; i < r ; ++i)
+    sat[i] = 0;
+  for (int64_t i1 = 0 ; i1 < s1 ; ++i1)
+    {
+      double rsum[NSUMS] = {0, 0, 0, 0, 0};
+      const double *sp = sat + i1*r;		// Previous row
+      double *sr = sat + (i1+1)*r;
+      for (int q = 0 ; q < NSUMS ; ++q)
+	sr[q] = 0;
+      int64_t j = i0*st0 + i1*st1;
+      for (int64_t i2 = 0 ; i2 < s2 ; ++i2, j += st2)
+	{
+	  double x = static_cast<double> (v1[j]);
+	  double y = static_cast<double> (v2[j]);
+	  rsum[0] += x;
+	  rsum[1] += y;
+	  rsum[2] += x*x;
+	  rsum[3] += y*y;
+	  rsum[4] += x*y;
+	  int64_t o = NSUMS*(i2+1);
+	  for (int q = 0 ; q < NSUMS ; ++q)
+	    sr[o+q] = sp[o+q] + rsum[q];
+	}
+    }
+
+  int64_t n1 = s1-w+1, n2 = s2-w+1;
+  for (int64_t j1 = 0 ; j1 < n1 ; ++j1)
+    {
+      const double *a = sat + j1*r, *b = sat + (j1+w)*r;
+      double *ws = wsums + NSUMS*j1*n2;
+      for (int64_t j2 = 0 ; j2 < n2 ; ++j2)
+	{
+	  int64_t o0 = NSUMS*j2, o1 = NSUMS*(j2+w);
+	  for (int q = 0 ; q < NSUMS ; ++q)
+	    ws[NSUMS*j2+q] = b[o1+q] - b[o0+q] - a[o1+q] + a[o0+q];
+	}
+    }
+}
+
+// ----------------------------------------------------------------------------
+// Compute correlations for output planes k0 to k1-1.  Window sums along the
+// first axis are kept as a running sum, adding the entering plane and
+// subtracting the leaving plane.
+//
+template<class T>
+static void local_corr_planes(const Reference_Counted_Array::Array<T> &m1,
+			      const Reference_Counted_Array::Array<T> &m2,
+			      int64_t w, bool subtract_mean, FArray &mc,
+			      int64_t k0, int64_t k1)
 {
-  int64_t w = window_size;
   int64_t n = w*w*w;
-  int64_t s0 = m1.size(0), s1 = m1.size(1), s2 = m1.size(2);
+  int64_t s1 = m1.size(1), s2 = m1.size(2);
   int64_t st0 = m1.stride(0), st1 = m1.stride(1), st2 = m1.stride(2);
-  T *v1 = m1.values(), *v2 = m2.values();
+  const T *v1 = m1.values(), *v2 = m2.values();
   float *vc = mc.values();
   int64_t cs0 = mc.stride(0), cs1 = mc.stride(1), cs2 = mc.stride(2);
-  for (int64_t i0 = 0 ; i0 < s0-w+1 ; ++i0)
-    for (int64_t i1 = 0 ; i1 < s1-w+1 ; ++i1)
-      for (int64_t i2 = 0 ; i2 < s2-w+1 ; ++i2)
+  int64_t n1 = s1-w+1, n2 = s2-w+1, np = NSUMS*n1*n2;
+  std::vector<double> sat(NSUMS*(s1+1)*(s2+1)), wsums(np), psums(np, 0.0);
+  for (int64_t i0 = k0 ; i0 < k1 ; ++i0)
+    {
+      if (i0 == k0)
+	for (int64_t p = k0 ; p < k0+w ; ++p)
+	  {
+	    plane_window_sums(v1, v2, p, s1, s2, st0, st1, st2, w, sat.data(), wsums.data());
+	    for (int64_t i = 0 ; i < np ; ++i)
+	      psums[i] += wsums[i];
+	  }
+      else
 	{
-	  int64_t i = i2*st2 + i1*st1 + i0*st0;
-	  double v1v1 = 0, v2v2 = 0, v1v2 = 0, v1sum = 0, v2sum = 0;
-	  for (int64_t o0 = 0 ; o0 < w ; ++o0)
-	    for (int64_t o1 = 0 ; o1 < w ; ++o1) {
-	      int64_t j = i + o1*st1 + o0*st0;
-	      for (int64_t o2 = 0 ; o2 < w ; ++o2, j += st2) {
-		double v1j = static_cast<double> (v1[j]);
-		double v2j = static_cast<double> (v2[j]);
-		v1sum += v1j;
-		v2sum += v2j;
-		v1v1 += v1j*v1j;
-		v2v2 += v2j*v2j;
-		v1v2 += v1j*v2j;
-	      }
-	    }
-	  double vn, vip;
-	  if (subtract_mean)
-	    {
-	      double vn2 = (v1v1 - v1sum*v1sum/n)*(v2v2 - v2sum*v2sum/n);
-	      vn = (vn2 >= 0 ? sqrt(vn2) : 0);
-	      vip = v1v2 - v1sum*v2sum/n;
-	    }
-	  else
-	    {
-	      vn = sqrt(v1v1*v2v2);
-	      vip = v1v2;
-	    }
-	  int64_t k = i2*cs2 + i1*cs1 + i0*cs0;
-	  vc[k] = (vn > 0 ? vip / vn : 0);
+	  plane_window_sums(v1, v2, i0+w-1, s1, s2, st0, st1, st2, w, sat.data(), wsums.data());
+	  for (int64_t i = 0 ; i < np ; ++i)
+	    psums[i] += wsums[i];
+	  plane_window_sums(v1, v2, i0-1, s1, s2, st0, st1, st2, w, sat.data(), wsums.data());
+	  for (int64_t i = 0 ; i < np ; ++i)
+	    psums[i] -= wsums[i];
 	}
+
+      for (int64_t i1 = 0 ; i1 < n1 ; ++i1)
+	for (int64_t i2 = 0 ; i2 < n2 ; ++i2)
+	  {
+	    const double *ps = &psums[NSUMS*(i1*n2+i2)];
+	    double v1sum = ps[0], v2sum = ps[1], v1v1 = ps[2], v2v2 = ps[3], v1v2 = ps[4];
+	    double vn, vip;
+	    if (subtract_mean)
+	      {
+		// Differenced sums have rounding error relative to the sum of
+		// squares so treat tiny variances as zero.
+		double var1 = v1v1 - v1sum*v1sum/n, var2 = v2v2 - v2sum*v2sum/n;
+		if (var1 <= VARIANCE_TOLERANCE*v1v1)
+		  var1 = 0;
+		if (var2 <= VARIANCE_TOLERANCE*v2v2)
+		  var2 = 0;
+		double vn2 = var1*var2;
+		vn = (vn2 >= 0 ? sqrt(vn2) : 0);
+		vip = v1v2 - v1sum*v2sum/n;
+	      }
+	    else
+	      {
+		double vn2 = v1v1*v2v2;
+		vn = (vn2 >= 0 ? sqrt(vn2) : 0);
+		vip = v1v2;
+	      }
+	    int64_t k = i2*cs2 + i1*cs1 + i0*cs0;
+	    vc[k] = (vn > 0 ? vip / vn : 0);
+	  }
+    }
+}
+
+// ----------------------------------------------------------------------------
+// Output planes are divided into slabs computed by shared pool threads.
+//
+template<class T>
+static void local_corr(const Reference_Counted_Array::Array<T> &m1,
+		       const Reference_Counted_Array::Array<T> &m2,
+		       int64_t window_size, bool subtract_mean, FArray &mc,
+		       int threads)
+{
+  int64_t w = window_size;
+  int64_t nk = m1.size(0)-w+1;
+  // Each slab starts by summing w planes so use slabs of at least w planes.
+  int64_t nt = Thread_Pool::thread_count(nk, w, std::max(threads, 1));
+  Thread_Pool::run(nt, [&](int t) {
+      local_corr_planes(m1, m2, w, subtract_mean, mc, (t*nk)/nt, ((t+1)*nk)/nt);
+    });
 }
 
 // ----------------------------------------------------------------------------
@@ -88,16 +190,18 @@ extern "C" PyObject *
 local_correlation(PyObject *, PyObject *args, PyObject *keywds)
 {
   Numeric_Array map1, map2;
-  int window_size, subtract_mean;
+  int window_size, subtract_mean, threads = 1;
   FArray mapc;
-  const char *kwlist[] = {"map1", "map2", "window_size", "subtract_mean", "mapc", NULL};
-  if (!PyArg_ParseTupleAndKeywords(args, keywds, const_cast<char *>("O&O&iiO&"),
+  const char *kwlist[] = {"map1", "map2", "window_size", "subtract_mean", "mapc",
+			  "threads", NULL};
+  if (!PyArg_ParseTupleAndKeywords(args, keywds, const_cast<char *>("O&O&iiO&|i"),
 				   (char **)kwlist,
 				   parse_3d_array, &map1,
 				   parse_3d_array, &map2,
 				   &window_size,
 				   &subtract_mean,
-				   parse_writable_float_3d_array, &mapc))
+				   parse_writable_float_3d_array, &mapc,
+				   &threads))
     return NULL;
 
   if (!map1.is_contiguous() || !map2.is_contiguous() || !mapc.is_contiguous())
@@ -142,8 +246,10 @@ local_correlation(PyObject *, PyObject *args, PyObject *keywds)
       return NULL;
     }
 
+  Py_BEGIN_ALLOW_THREADS
   call_template_function(local_corr, map1.value_type(),
-			 (map1, map2, window_size, subtract_mean, mapc));
+			 (map1, map2, window_size, subtract_mean, mapc, threads));
+  Py_END_ALLOW_THREADS
   return python_none();
 }
 
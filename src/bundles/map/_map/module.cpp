@@ -32,6 +32,7 @@
 #include "combine.h"			// use linear_combination
 #include "contourpy.h"			// use surface_py, ...
 #include "extendmap.h"			// use extend_crystal_map
+#include "filters.h"			// use gaussian_filter_array, median_filter_array
 #include "fittingpy.h"			// use py_correlation_gradient, ...
 #include "distgrid.h"			// use py_sphere_surface_distance
 #include "gaussian.h"			// use py_sum_of_gaussians
@@ -40,6 +41,8 @@
 #include "localcorr.h"			// use local_correlation
 #include "moments.h"			// use moments_py, affine_scale_py
 #include "occupancy.h"			// use fill_occupancy_map
+#include "pyramid.h"			// use downsample_average
+#include "sesurface.h"			// use py_ses_surface, py_ses_surface_update
 #include "squaremesh.h"			// use principle_plane_edges
 #include "transfer.h"			// use data_to_rgba,...
 
@@ -77,8 +80,14 @@ static struct PyMethodDef map_cpp_methods[] =
   /* contourpy.h */
   {const_cast<char*>("contour_surface"), (PyCFunction)surface_py,
    METH_VARARGS|METH_KEYWORDS, NULL},
+  {const_cast<char*>("contour_surfaces"), (PyCFunction)surfaces_py,
+   METH_VARARGS|METH_KEYWORDS, NULL},
+  {const_cast<char*>("contour_surface_update"), (PyCFunction)surface_update_py,
+   METH_VARARGS|METH_KEYWORDS, NULL},
   {const_cast<char*>("reverse_triangle_vertex_order"),
    reverse_triangle_vertex_order, METH_VARARGS, NULL},
+  {const_cast<char*>("contour_block_bounds"), (PyCFunction)contour_block_bounds,
+   METH_VARARGS|METH_KEYWORDS, NULL},
 
   /* distgrid.h */
   {const_cast<char*>("sphere_surface_distance"), (PyCFunction)py_sphere_surface_distance,
@@ -88,12 +97,20 @@ static struct PyMethodDef map_cpp_methods[] =
   {const_cast<char*>("extend_crystal_map"), (PyCFunction)extend_crystal_map,
    METH_VARARGS|METH_KEYWORDS, NULL},
 
+  /* fittingpy.h */
+  /* filters.h */
+  {const_cast<char*>("gaussian_filter_array"), (PyCFunction)gaussian_filter_array,
+   METH_VARARGS|METH_KEYWORDS, NULL},
+  {const_cast<char*>("median_filter_array"), (PyCFunction)median_filter_array,
+   METH_VARARGS|METH_KEYWORDS, NULL},
+
   /* fittingpy.h */
   {const_cast<char*>("correlation_gradient"), (PyCFunction)py_correlation_gradient, METH_VARARGS|METH_KEYWORDS, NULL},
   {const_cast<char*>("torque"), (PyCFunction)py_torque, METH_VARARGS|METH_KEYWORDS, NULL},
   {const_cast<char*>("torques"), (PyCFunction)py_torques, METH_VARARGS|METH_KEYWORDS, NULL},
   {const_cast<char*>("correlation_torque"), (PyCFunction)py_correlation_torque, METH_VARARGS|METH_KEYWORDS, NULL},
   {const_cast<char*>("correlation_torque2"), (PyCFunction)py_correlation_torque2, METH_VARARGS|METH_KEYWORDS, NULL},
+  {const_cast<char*>("locate_maxima"), (PyCFunction)py_locate_maxima, METH_VARARGS|METH_KEYWORDS, NULL},
 
   /* gaussian.h */
   {const_cast<char*>("sum_of_gaussians"), (PyCFunction)py_sum_of_gaussians,
@@ -106,6 +123,8 @@ static struct PyMethodDef map_cpp_methods[] =
   /* histogram.h */
   {const_cast<char*>("minimum_and_maximum"), (PyCFunction)minimum_and_maximum,
    METH_VARARGS|METH_KEYWORDS, NULL},
+  {const_cast<char*>("array_statistics"), (PyCFunction)array_statistics,
+   METH_VARARGS|METH_KEYWORDS, NULL},
   {const_cast<char*>("bin_counts"), (PyCFunction)bin_counts,
    METH_VARARGS|METH_KEYWORDS, NULL},
   {const_cast<char*>("bin_counts_float64"), (PyCFunction)bin_counts_float64,
@@ -114,10 +133,14 @@ static struct PyMethodDef map_cpp_methods[] =
    METH_VARARGS|METH_KEYWORDS, NULL},
   {const_cast<char*>("high_indices"), (PyCFunction)high_indices_py,
    METH_VARARGS|METH_KEYWORDS, NULL},
+  {const_cast<char*>("occupied_bricks"), (PyCFunction)occupied_bricks_py,
+   METH_VARARGS|METH_KEYWORDS, NULL},
 
   /* interpolatepy.h */
   {const_cast<char*>("interpolate_volume_data"), interpolate_volume_data, METH_VARARGS|METH_KEYWORDS, NULL},
   {const_cast<char*>("interpolate_volume_gradient"), interpolate_volume_gradient, METH_VARARGS|METH_KEYWORDS, NULL},
+  {const_cast<char*>("interpolate_volume_on_grid"), (PyCFunction)interpolate_volume_on_grid, METH_VARARGS|METH_KEYWORDS, NULL},
+  {const_cast<char*>("interpolate_fit_statistics"), (PyCFunction)interpolate_fit_statistics, METH_VARARGS|METH_KEYWORDS, NULL},
   {const_cast<char*>("interpolate_colormap"), interpolate_colormap, METH_VARARGS, NULL},
   {const_cast<char*>("set_outside_volume_colors"), set_outside_volume_colors, METH_VARARGS, NULL},
 
@@ -132,6 +155,16 @@ static struct PyMethodDef map_cpp_methods[] =
   {const_cast<char*>("fill_occupancy_map"), (PyCFunction)fill_occupancy_map,
    METH_VARARGS|METH_KEYWORDS, NULL},
 
+  /* pyramid.h */
+  {const_cast<char*>("downsample_average"), (PyCFunction)downsample_average,
+   METH_VARARGS|METH_KEYWORDS, NULL},
+
+  /* sesurface.h */
+  {const_cast<char*>("ses_surface"), (PyCFunction)py_ses_surface,
+   METH_VARARGS|METH_KEYWORDS, NULL},
+  {const_cast<char*>("ses_surface_update"), (PyCFunction)py_ses_surface_update,
+   METH_VARARGS|METH_KEYWORDS, NULL},
+
   /* squaremesh.h */
   {const_cast<char*>("principle_plane_edges"), (PyCFunction)principle_plane_edges,
    METH_VARARGS|METH_KEYWORDS, NULL},
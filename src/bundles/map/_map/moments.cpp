@@ -29,8 +29,12 @@
 //
 #include <Python.h>				// use PyObject
 
+#include <algorithm>				// use std::min, std::max
+#include <vector>				// use std::vector
+
 #include <arrays/rcarray.h>			// Use Numeric_Array
 #include <arrays/pythonarray.h>			// use parse_*()
+#include <arrays/threadpool.h>			// use Thread_Pool::run()
 
 using namespace Reference_Counted_Array;
 
@@ -38,79 +42,138 @@ namespace Map_Cpp
 {
 
 // ----------------------------------------------------------------------------
+// Sums of v, i*v and i*j*v over array index positions i.
 //
-template <class T>
-void moments(const T *data, const int64_t *size,
-	     double mo2[3][3], double mo1[3], double *mo0)
+class Moment_Sums
 {
-  int64_t s0 = size[0], s1 = size[1], s2 = size[2];
-  int64_t st0 = s1*s2, st1 = s2;
+public:
+  Moment_Sums() : m(0), m0(0), m1(0), m2(0), m00(0), m01(0), m02(0), m11(0), m12(0), m22(0) {}
+  void add(const Moment_Sums &s)
+  {
+    m += s.m; m0 += s.m0; m1 += s.m1; m2 += s.m2;
+    m00 += s.m00; m01 += s.m01; m02 += s.m02; m11 += s.m11; m12 += s.m12; m22 += s.m22;
+  }
+  double m, m0, m1, m2, m00, m01, m02, m11, m12, m22;
+};
 
-  double m = 0, m0 = 0, m1 = 0, m2 = 0, m00 = 0, m01 = 0, m02 = 0, m11 = 0, m12 = 0, m22 = 0;
+// ----------------------------------------------------------------------------
+// Planes are divided among shared pool threads, each summing into its own Moment_Sums
+// or writing its own planes.  Small arrays use one thread.
+//
+const int64_t MIN_THREAD_ELEMENTS = 1 << 20;
 
-  for (int64_t i0 = 0 ; i0 < s0 ; ++i0)
-    for (int64_t i1 = 0 ; i1 < s1 ; ++i1)
-      for (int64_t i2 = 0 ; i2 < s2 ; ++i2)
-	{
-	  int64_t i = i0*st0 + i1*st1 + i2;
-	  T v = data[i];
-	  m00 += i0*i0*v;
-	  m11 += i1*i1*v;
-	  m22 += i2*i2*v;
-	  m01 += i0*i1*v;
-	  m02 += i0*i2*v;
-	  m12 += i1*i2*v;
-	  m0 += i0*v;
-	  m1 += i1*v;
-	  m2 += i2*v;
-	  m += v;
-	}
-  mo2[0][0] = m00; mo2[1][1] = m11; mo2[2][2] = m22;
-  mo2[0][1] = mo2[1][0] = m01;
-  mo2[0][2] = mo2[2][0] = m02;
-  mo2[1][2] = mo2[2][1] = m12;
-  mo1[0] = m0; mo1[1] = m1; mo1[2] = m2;
-  *mo0 = m;
+template <class Plane_Range_Function>
+static void thread_planes(const int64_t *size, int threads, Plane_Range_Function f)
+{
+  int64_t s0 = size[0];
+  int64_t nt = std::min(static_cast<int64_t>(Thread_Pool::thread_count(size[0]*size[1]*size[2],
+								       MIN_THREAD_ELEMENTS,
+								       std::max(threads, 1))),
+			std::max(s0, static_cast<int64_t>(1)));
+  Thread_Pool::run(nt, [&](int t) { f((t*s0)/nt, ((t+1)*s0)/nt, t); });
 }
 
 // ----------------------------------------------------------------------------
+// Sum rows first so the inner loop is three vectorizable sums, then shift
+// the row index sums by the origin.
 //
 template <class T>
-void affine_scale(T *data, const int64_t *size, double c, double *u, bool invert)
+static void moments_planes(const Array<T> &data, const int64_t origin[3],
+			   int64_t k0, int64_t k1, Moment_Sums &ms)
 {
-  int64_t s0 = size[0], s1 = size[1], s2 = size[2];
-  int64_t st0 = s1*s2, st1 = s2;
-  double u0 = u[0], u1 = u[1], u2 = u[2];
-
-  if (invert)
+  int64_t s1 = data.size(1), s2 = data.size(2);
+  int64_t st0 = data.stride(0), st1 = data.stride(1), st2 = data.stride(2);
+  const T *d = data.values();
+  double o2 = origin[2];
+  for (int64_t i0 = k0 ; i0 < k1 ; ++i0)
     {
-      for (int64_t i0 = 0 ; i0 < s0 ; ++i0)
-	for (int64_t i1 = 0 ; i1 < s1 ; ++i1)
+      double g0 = i0 + origin[0];
+      for (int64_t i1 = 0 ; i1 < s1 ; ++i1)
+	{
+	  double g1 = i1 + origin[1];
+	  const T *row = d + i0*st0 + i1*st1;
+	  double r = 0, r2 = 0, r22 = 0;
 	  for (int64_t i2 = 0 ; i2 < s2 ; ++i2)
 	    {
-	      int64_t i = i0*st0 + i1*st1 + i2;
-	      data[i] /= c + u0*i0 + u1*i1 + u2*i2;
+	      double v = row[i2*st2];
+	      r += v;
+	      r2 += i2*v;
+	      r22 += double(i2)*i2*v;
 	    }
+	  double c2 = r2 + o2*r, c22 = r22 + 2*o2*r2 + o2*o2*r;
+	  ms.m += r;
+	  ms.m0 += g0*r;
+	  ms.m1 += g1*r;
+	  ms.m2 += c2;
+	  ms.m00 += g0*g0*r;
+	  ms.m11 += g1*g1*r;
+	  ms.m22 += c22;
+	  ms.m01 += g0*g1*r;
+	  ms.m02 += g0*c2;
+	  ms.m12 += g1*c2;
+	}
     }
-  else
-    {
-      for (int64_t i0 = 0 ; i0 < s0 ; ++i0)
-	for (int64_t i1 = 0 ; i1 < s1 ; ++i1)
+}
+
+// ----------------------------------------------------------------------------
+// Index positions are offset by origin so that sub-blocks of a large array
+// can be summed separately and the results added.
+//
+template <class T>
+void moments(const Array<T> &data, const int64_t origin[3], int threads,
+	     double mo2[3][3], double mo1[3], double *mo0)
+{
+  std::vector<Moment_Sums> tsums(threads > 1 ? threads : 1);
+  thread_planes(data.sizes(), threads,
+		[&data, origin, &tsums](int64_t k0, int64_t k1, int64_t t)
+		{ moments_planes(data, origin, k0, k1, tsums[t]); });
+  Moment_Sums ms;
+  for (auto &ts: tsums)
+    ms.add(ts);
+
+  mo2[0][0] = ms.m00; mo2[1][1] = ms.m11; mo2[2][2] = ms.m22;
+  mo2[0][1] = mo2[1][0] = ms.m01;
+  mo2[0][2] = mo2[2][0] = ms.m02;
+  mo2[1][2] = mo2[2][1] = ms.m12;
+  mo1[0] = ms.m0; mo1[1] = ms.m1; mo1[2] = ms.m2;
+  *mo0 = ms.m;
+}
+
+// ----------------------------------------------------------------------------
+//
+template <class T>
+static void affine_scale_planes(const Array<T> &data, const int64_t origin[3],
+				double c, const double *u, bool invert,
+				int64_t k0, int64_t k1)
+{
+  int64_t s1 = data.size(1), s2 = data.size(2);
+  int64_t st0 = data.stride(0), st1 = data.stride(1), st2 = data.stride(2);
+  T *d = data.values();
+  double u0 = u[0], u1 = u[1], u2 = u[2];
+  for (int64_t i0 = k0 ; i0 < k1 ; ++i0)
+    for (int64_t i1 = 0 ; i1 < s1 ; ++i1)
+      {
+	T *row = d + i0*st0 + i1*st1;
+	double cr = c + u0*(i0+origin[0]) + u1*(i1+origin[1]) + u2*origin[2];
+	if (invert)
 	  for (int64_t i2 = 0 ; i2 < s2 ; ++i2)
-	    {
-	      int64_t i = i0*st0 + i1*st1 + i2;
-	      data[i] *= c + u0*i0 + u1*i1 + u2*i2;
-	    }
-    }
+	    row[i2*st2] /= cr + u2*i2;
+	else
+	  for (int64_t i2 = 0 ; i2 < s2 ; ++i2)
+	    row[i2*st2] *= cr + u2*i2;
+      }
 }
 
 // ----------------------------------------------------------------------------
+// Scales the array in place, including non-contiguous arrays.
 //
 template <class T>
-void moments(const Array<T> &data, double m2[3][3], double m1[3], double *m0)
+void affine_scale(const Array<T> &data, const int64_t origin[3], double c,
+		  double u[3], bool invert, int threads)
 {
-  const Array<T> dc = data.contiguous_array();
-  moments(dc.values(), data.sizes(), m2, m1, m0);
+  thread_planes(data.sizes(), threads,
+		[&data, origin, c, u, invert](int64_t k0, int64_t k1, int64_t)
+		{ affine_scale_planes(data, origin, c, u, invert, k0, k1); });
 }
 
 // ----------------------------------------------------------------------------
@@ -118,15 +181,22 @@ void moments(const Array<T> &data, double m2[3][3], double m1[3], double *m0)
 extern "C" PyObject *moments_py(PyObject *, PyObject *args, PyObject *keywds)
 {
   Numeric_Array data;
-  const char *kwlist[] = {"data", NULL};
-  if (!PyArg_ParseTupleAndKeywords(args, keywds, const_cast<char *>("O&"),
+  int origin[3] = {0, 0, 0};
+  int threads = 1;
+  const char *kwlist[] = {"data", "origin", "threads", NULL};
+  if (!PyArg_ParseTupleAndKeywords(args, keywds, const_cast<char *>("O&|O&i"),
 				   (char **)kwlist,
-				   parse_3d_array, &data))
+				   parse_3d_array, &data,
+				   parse_int_3_array, &origin[0],
+				   &threads))
     return NULL;
 
+  int64_t orig[3] = {origin[0], origin[1], origin[2]};
   double m2[3][3], m1[3], m0;
+  Py_BEGIN_ALLOW_THREADS
   call_template_function(moments, data.value_type(),
-			 (data, m2, m1, &m0));
+			 (data, orig, threads, m2, m1, &m0));
+  Py_END_ALLOW_THREADS
 
   PyObject *m2_py = c_array_to_python(&(m2[0][0]), 3, 3);
   PyObject *m1_py = c_array_to_python(&(m1[0]), 3);
@@ -136,15 +206,6 @@ extern "C" PyObject *moments_py(PyObject *, PyObject *args, PyObject *keywds)
   return t;
 }
 
-// ----------------------------------------------------------------------------
-//
-template <class T>
-void affine_scale(const Array<T> &data, double c, double u[3], bool invert)
-{
-  Array<T> dc = data.contiguous_array();
-  affine_scale(dc.values(), data.sizes(), c, &u[0], invert);
-}
-
 // ----------------------------------------------------------------------------
 //
 extern "C" PyObject *affine_scale_py(PyObject *, PyObject *args, PyObject *keywds)
@@ -152,16 +213,23 @@ extern "C" PyObject *affine_scale_py(PyObject *, PyObject *args, PyObject *keywd
   Numeric_Array data;
   double c, u[3];
   bool invert = false;
-  const char *kwlist[] = {"data", "c", "u", "invert", NULL};
-  if (!PyArg_ParseTupleAndKeywords(args, keywds, const_cast<char *>("O&dO&|O&"),
+  int origin[3] = {0, 0, 0};
+  int threads = 1;
+  const char *kwlist[] = {"data", "c", "u", "invert", "origin", "threads", NULL};
+  if (!PyArg_ParseTupleAndKeywords(args, keywds, const_cast<char *>("O&dO&|O&O&i"),
 				   (char **)kwlist,
-				   parse_3d_array, &data, &c,
+				   parse_writable_3d_array, &data, &c,
 				   parse_double_3_array, &u[0],
-				   parse_bool, &invert))
+				   parse_bool, &invert,
+				   parse_int_3_array, &origin[0],
+				   &threads))
     return NULL;
 
+  int64_t orig[3] = {origin[0], origin[1], origin[2]};
+  Py_BEGIN_ALLOW_THREADS
   call_template_function(affine_scale, data.value_type(),
-  			 (data, c, u, invert));
+  			 (data, orig, c, u, invert, threads));
+  Py_END_ALLOW_THREADS
 
   return python_none();
 }
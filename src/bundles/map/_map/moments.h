@@ -34,11 +34,13 @@ namespace Map_Cpp
 
 extern "C"
 {
-  // moments_py(array_3d) -> m33, m3, m0
+  // moments_py(array_3d, origin = (0,0,0), threads = 1) -> m33, m3, m0
+  //  Array indices are offset by origin so moments of sub-blocks can be added.
   PyObject *moments_py(PyObject *, PyObject *args, PyObject *keywds);
-  // affine_scale_py(array_3d, c, u[3], invert)
+  // affine_scale_py(array_3d, c, u[3], invert, origin = (0,0,0), threads = 1)
   //  a -> a * (c+u*(i,j,k)) if invert false
   //  a -> a / (c+u*(i,j,k)) if invert true
+  //  with (i,j,k) offset by origin
   PyObject *affine_scale_py(PyObject *, PyObject *args, PyObject *keywds);  
 }
  
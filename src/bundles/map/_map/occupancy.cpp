@@ -29,19 +29,28 @@
 //
 #include <Python.h>			// use PyObject
 
+#include <algorithm>			// use std::min()
+#include <vector>			// use std::vector
+
 #include <arrays/pythonarray.h>		// use parse_float_n3_array(), ...
 #include <arrays/rcarray.h>		// use FArray
+#include <arrays/threadpool.h>		// use Thread_Pool::parallel_for()
 
 namespace Map_Cpp
 {
 
+// Fewer points are binned in one thread.
+static const int64_t min_threaded_points = 100000;
+
 // ----------------------------------------------------------------------------
+// Add points with the given indices to grid planes kmin to kmax-1.  Points
+// are added in index order so sums match adding all points in one thread.
 //
-static void fill_occupancy_map(const FArray &xyz_list,
-			       float xyz_origin[3], float xyz_step[3],
-			       FArray &grid)
+static void fill_occupancy_planes(const FArray &xyz_list,
+				  float xyz_origin[3], float xyz_step[3],
+				  FArray &grid, const int64_t *points, int64_t n,
+				  int64_t kmin, int64_t kmax)
 {
-  int64_t n = xyz_list.size(0);
   float x0 = xyz_origin[0], y0 = xyz_origin[1], z0 = xyz_origin[2];
   float xs = xyz_step[0], ys = xyz_step[1], zs = xyz_step[2];
   int64_t s0 = xyz_list.stride(0), s1 = xyz_list.stride(1);
@@ -49,8 +58,9 @@ static void fill_occupancy_map(const FArray &xyz_list,
   int64_t sk = grid.stride(0), sj = grid.stride(1), si = grid.stride(2);
   int64_t szk = grid.size(0), szj = grid.size(1), szi = grid.size(2);
   float *g = grid.values();
-  for (int64_t m = 0 ; m < n ; ++m)
+  for (int64_t p = 0 ; p < n ; ++p)
     {
+      int64_t m = (points ? points[p] : p);
       float x = xyz[s0*m], y = xyz[s0*m+s1], z = xyz[s0*m+2*s1];
       float ri = (x-x0)/xs, rj = (y-y0)/ys, rk = (z-z0)/zs;
       int i = static_cast<int>(ri);
@@ -62,18 +72,87 @@ static void fill_occupancy_map(const FArray &xyz_list,
 	{
 	  float fi = ri-i, fj = rj-j, fk = rk-k;
 	  int64_t base = k*sk + j*sj + i*si;
-	  g[base] += (1-fk)*(1-fj)*(1-fi);
-	  g[base + si] += (1-fk)*(1-fj)*fi;
-	  g[base + sj] += (1-fk)*fj*(1-fi);
-	  g[base + sj + si] += (1-fk)*fj*fi;
-	  g[base + sk] += fk*(1-fj)*(1-fi);
-	  g[base + sk + si] += fk*(1-fj)*fi;
-	  g[base + sk + sj] += fk*fj*(1-fi);
-	  g[base + sk + sj + si] += fk*fj*fi;
+	  if (k >= kmin && k < kmax)
+	    {
+	      g[base] += (1-fk)*(1-fj)*(1-fi);
+	      g[base + si] += (1-fk)*(1-fj)*fi;
+	      g[base + sj] += (1-fk)*fj*(1-fi);
+	      g[base + sj + si] += (1-fk)*fj*fi;
+	    }
+	  if (k+1 >= kmin && k+1 < kmax)
+	    {
+	      g[base + sk] += fk*(1-fj)*(1-fi);
+	      g[base + sk + si] += fk*(1-fj)*fi;
+	      g[base + sk + sj] += fk*fj*(1-fi);
+	      g[base + sk + sj + si] += fk*fj*fi;
+	    }
 	}
     }
 }
 
+// ----------------------------------------------------------------------------
+// Each thread owns a slab of grid planes and adds just the points touching
+// those planes, so no two threads write the same grid value.
+//
+static void fill_occupancy_map(const FArray &xyz_list,
+			       float xyz_origin[3], float xyz_step[3],
+			       FArray &grid)
+{
+  int64_t n = xyz_list.size(0), szk = grid.size(0);
+  int nt = Thread_Pool::thread_count(n, min_threaded_points);
+  if (nt <= 1 || szk < 2)
+    {
+      fill_occupancy_planes(xyz_list, xyz_origin, xyz_step, grid, NULL, n, 0, szk);
+      return;
+    }
+
+  // Find the lower grid plane of each point.
+  std::vector<int> kp(n);
+  float z0 = xyz_origin[2], zs = xyz_step[2];
+  int64_t s0 = xyz_list.stride(0), s1 = xyz_list.stride(1);
+  const float *xyz = xyz_list.values();
+  Thread_Pool::parallel_for(n, [&](int64_t m0, int64_t m1) {
+      for (int64_t m = m0 ; m < m1 ; ++m)
+	kp[m] = static_cast<int>((xyz[s0*m+2*s1]-z0)/zs);
+    }, min_threaded_points);
+
+  // List points for each slab of planes in point order.  A point touches
+  // planes k and k+1 which can be in adjacent slabs.
+  int64_t slab_planes = std::max((int64_t)1, szk / (4*nt));
+  int64_t nslabs = (szk + slab_planes - 1) / slab_planes;
+  std::vector<int64_t> start(nslabs+1, 0);
+  for (int64_t m = 0 ; m < n ; ++m)
+    {
+      int64_t k = kp[m];
+      if (k < 0 || k+1 >= szk)
+	continue;
+      int64_t s = k / slab_planes, s1 = (k+1) / slab_planes;
+      start[s+1] += 1;
+      if (s1 != s)
+	start[s1+1] += 1;
+    }
+  for (int64_t s = 0 ; s < nslabs ; ++s)
+    start[s+1] += start[s];
+  std::vector<int64_t> points(start[nslabs]), fill(start.begin(), start.end()-1);
+  for (int64_t m = 0 ; m < n ; ++m)
+    {
+      int64_t k = kp[m];
+      if (k < 0 || k+1 >= szk)
+	continue;
+      int64_t s = k / slab_planes, s1 = (k+1) / slab_planes;
+      points[fill[s]++] = m;
+      if (s1 != s)
+	points[fill[s1]++] = m;
+    }
+
+  Thread_Pool::parallel_for(nslabs, [&](int64_t sl0, int64_t sl1) {
+      for (int64_t s = sl0 ; s < sl1 ; ++s)
+	fill_occupancy_planes(xyz_list, xyz_origin, xyz_step, grid,
+			      points.data() + start[s], start[s+1] - start[s],
+			      s*slab_planes, std::min(szk, (s+1)*slab_planes));
+    });
+}
+
 // ----------------------------------------------------------------------------
 //
 extern "C" PyObject *fill_occupancy_map(PyObject *, PyObject *args, PyObject *keywds)
@@ -89,7 +168,9 @@ extern "C" PyObject *fill_occupancy_map(PyObject *, PyObject *args, PyObject *ke
 				   parse_writable_float_3d_array, &map))
     return NULL;
 
+  Py_BEGIN_ALLOW_THREADS
   fill_occupancy_map(points, origin, step, map);
+  Py_END_ALLOW_THREADS
 
   return python_none();
 }
@@ -0,0 +1,150 @@
+// vi: set expandtab shiftwidth=4 softtabstop=4:
+
+/*
+ * === UCSF ChimeraX Copyright ===
+ * Copyright 2022 Regents of the University of California. All rights reserved.
+ * The ChimeraX application is provided pursuant to the ChimeraX license
+ * agreement, which covers academic and commercial uses. For more details, see
+ * <http://www.rbvi.ucsf.edu/chimerax/docs/licensing.html>
+ *
+ * This particular file is part of the ChimeraX library. You can also
+ * redistribute and/or modify it under the terms of the GNU Lesser General
+ * Public License version 2.1 as published by the Free Software Foundation.
+ * For more details, see
+ * <https://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESSED OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. ADDITIONAL LIABILITY
+ * LIMITATIONS ARE DESCRIBED IN THE GNU LESSER GENERAL PUBLIC LICENSE
+ * VERSION 2.1
+ *
+ * This notice must be embedded in or attached to all copies, including partial
+ * copies, of the software or any revisions or derivations thereof.
+ * === UCSF ChimeraX Copyright ===
+ */
+
+// ----------------------------------------------------------------------------
+// Averaged 2x downsampling of volume data for multiresolution display.
+//
+#include <Python.h>				// use PyObject
+
+#include <algorithm>				// use std::min, std::max
+#include <vector>				// use std::vector
+
+#include <arrays/rcarray.h>			// Use Numeric_Array
+#include <arrays/pythonarray.h>			// use parse_*()
+#include <arrays/threadpool.h>			// use Thread_Pool::run()
+
+#include "pyramid.h"
+
+using namespace Reference_Counted_Array;
+
+namespace Map_Cpp
+{
+
+// ----------------------------------------------------------------------------
+// Result planes are divided among shared pool threads.  Small arrays use one thread.
+//
+const int64_t MIN_THREAD_ELEMENTS = 1 << 20;
+
+template <class Plane_Range_Function>
+static void thread_planes(int64_t planes, int64_t elements, int threads,
+			  Plane_Range_Function f)
+{
+  int64_t nt = std::min(static_cast<int64_t>(Thread_Pool::thread_count(elements, MIN_THREAD_ELEMENTS,
+								       std::max(threads, 1))),
+			std::max(planes, static_cast<int64_t>(1)));
+  Thread_Pool::run(nt, [&](int t) { f((t*planes)/nt, ((t+1)*planes)/nt); });
+}
+
+// ----------------------------------------------------------------------------
+// Each result row sums up to 4 array rows into a row buffer, adding pairs
+// of adjacent values, then divides by the number of values summed.
+//
+template <class T>
+static void downsample_planes(const Array<T> &data, const Array<T> &result,
+			      int64_t k0, int64_t k1)
+{
+  int64_t m0 = data.size(0), m1 = data.size(1), m2 = data.size(2);
+  int64_t ds0 = data.stride(0), ds1 = data.stride(1), ds2 = data.stride(2);
+  int64_t r1 = result.size(1), r2 = result.size(2);
+  int64_t rs0 = result.stride(0), rs1 = result.stride(1), rs2 = result.stride(2);
+  const T *d = data.values();
+  T *r = result.values();
+  int64_t pairs = m2/2;		// Result values with 2 array values along axis 2.
+  bool odd = (m2 % 2 == 1);
+  std::vector<float> sum(r2);
+  for (int64_t k = k0 ; k < k1 ; ++k)
+    for (int64_t j = 0 ; j < r1 ; ++j)
+      {
+	for (int64_t i = 0 ; i < r2 ; ++i)
+	  sum[i] = 0;
+	int rows = 0;
+	for (int64_t i0 = 2*k ; i0 < 2*k+2 && i0 < m0 ; ++i0)
+	  for (int64_t i1 = 2*j ; i1 < 2*j+2 && i1 < m1 ; ++i1, ++rows)
+	    {
+	      const T *row = d + i0*ds0 + i1*ds1;
+	      for (int64_t i = 0 ; i < pairs ; ++i)
+		sum[i] += static_cast<float>(row[2*i*ds2]) + static_cast<float>(row[(2*i+1)*ds2]);
+	      if (odd)
+		sum[pairs] += static_cast<float>(row[2*pairs*ds2]);
+	    }
+	T *rrow = r + k*rs0 + j*rs1;
+	float f = 1.0f / (2*rows);
+	for (int64_t i = 0 ; i < pairs ; ++i)
+	  rrow[i*rs2] = static_cast<T>(f * sum[i]);
+	if (odd)
+	  rrow[pairs*rs2] = static_cast<T>(2 * f * sum[pairs]);
+      }
+}
+
+// ----------------------------------------------------------------------------
+//
+template <class T>
+static void downsample(const Array<T> &data, const Numeric_Array &result, int threads)
+{
+  Array<T> r(result);
+  thread_planes(r.size(0), data.size(), threads,
+		[&data, &r](int64_t k0, int64_t k1)
+		{ downsample_planes(data, r, k0, k1); });
+}
+
+// ----------------------------------------------------------------------------
+//
+extern "C" PyObject *downsample_average(PyObject *, PyObject *args, PyObject *keywds)
+{
+  Numeric_Array data, result;
+  int threads = 1;
+  const char *kwlist[] = {"array", "result", "threads", NULL};
+  if (!PyArg_ParseTupleAndKeywords(args, keywds, const_cast<char *>("O&O&|i"),
+				   (char **)kwlist,
+				   parse_3d_array, &data,
+				   parse_writable_3d_array, &result,
+				   &threads))
+    return NULL;
+
+  if (result.value_type() != data.value_type())
+    {
+      PyErr_SetString(PyExc_TypeError,
+		      "downsample_average(): result array must have same value type as array");
+      return NULL;
+    }
+  for (int a = 0 ; a < 3 ; ++a)
+    if (result.size(a) != (data.size(a)+1)/2)
+      {
+	PyErr_Format(PyExc_ValueError,
+		     "downsample_average(): result axis %d size %lld must be half array size %lld rounded up",
+		     a, (long long)result.size(a), (long long)data.size(a));
+	return NULL;
+      }
+
+  Py_BEGIN_ALLOW_THREADS
+  call_template_function(downsample, data.value_type(),
+			 (data, result, threads));
+  Py_END_ALLOW_THREADS
+
+  return python_none();
+}
+
+} // end of namespace Map_Cpp
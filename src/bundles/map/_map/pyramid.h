@@ -0,0 +1,49 @@
+// vi: set expandtab shiftwidth=4 softtabstop=4:
+
+/*
+ * === UCSF ChimeraX Copyright ===
+ * Copyright 2022 Regents of the University of California. All rights reserved.
+ * The ChimeraX application is provided pursuant to the ChimeraX license
+ * agreement, which covers academic and commercial uses. For more details, see
+ * <http://www.rbvi.ucsf.edu/chimerax/docs/licensing.html>
+ *
+ * This particular file is part of the ChimeraX library. You can also
+ * redistribute and/or modify it under the terms of the GNU Lesser General
+ * Public License version 2.1 as published by the Free Software Foundation.
+ * For more details, see
+ * <https://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESSED OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. ADDITIONAL LIABILITY
+ * LIMITATIONS ARE DESCRIBED IN THE GNU LESSER GENERAL PUBLIC LICENSE
+ * VERSION 2.1
+ *
+ * This notice must be embedded in or attached to all copies, including partial
+ * copies, of the software or any revisions or derivations thereof.
+ * === UCSF ChimeraX Copyright ===
+ */
+
+// ----------------------------------------------------------------------------
+// Averaged 2x downsampling of volume data for multiresolution display.
+//
+#ifndef PYRAMID_HEADER_INCLUDED
+#define PYRAMID_HEADER_INCLUDED
+
+#include <Python.h>			// use PyObject
+
+namespace Map_Cpp
+{
+
+extern "C"
+{
+  // downsample_average(array_3d, result_3d, threads = 1)
+  //  Each result value is the average of a 2x2x2 cell of array values,
+  //  fewer at the high edges when an axis size is odd.  The result must have
+  //  size (n+1)//2 along each axis and the same value type as the array.
+  PyObject *downsample_average(PyObject *, PyObject *args, PyObject *keywds);
+}
+
+} // end of namespace Map_Cpp
+
+#endif
@@ -0,0 +1,716 @@
+// vi: set expandtab shiftwidth=4 softtabstop=4:
+
+/*
+ * === UCSF ChimeraX Copyright ===
+ * Copyright 2022 Regents of the University of California. All rights reserved.
+ * The ChimeraX application is provided pursuant to the ChimeraX license
+ * agreement, which covers academic and commercial uses. For more details, see
+ * <http://www.rbvi.ucsf.edu/chimerax/docs/licensing.html>
+ *
+ * This particular file is part of the ChimeraX library. You can also
+ * redistribute and/or modify it under the terms of the GNU Lesser General
+ * Public License version 2.1 as published by the Free Software Foundation.
+ * For more details, see
+ * <https://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESSED OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. ADDITIONAL LIABILITY
+ * LIMITATIONS ARE DESCRIBED IN THE GNU LESSER GENERAL PUBLIC LICENSE
+ * VERSION 2.1
+ *
+ * This notice must be embedded in or attached to all copies, including partial
+ * copies, of the software or any revisions or derivations thereof.
+ * === UCSF ChimeraX Copyright ===
+ */
+
+// ----------------------------------------------------------------------------
+// Compute a solvent excluded molecular surface in one call.  Atom spheres
+// enlarged by the probe radius give a distance grid that is contoured for the
+// solvent accessible surface.  Probe spheres at those vertices give a second
+// distance grid contoured for the solvent excluded surface.  Pieces far from
+// the atoms are dropped and each vertex is assigned its closest atom.  This is
+// the calculation done in Python by ses_surface_geometry() but without making
+// Python arrays between steps and without holding the global interpreter lock,
+// so surfaces for separate chains can be computed in parallel threads.  All
+// threading inside uses the shared thread pool, so a chain whose call finds the
+// pool busy with another chain computes serially rather than adding threads.
+//
+// The distance grids and unclipped surfaces can be kept so that after a few
+// atoms move only the grid planes within reach of those atoms are recomputed
+// and recontoured, as for interactive side chain changes.
+//
+#include <Python.h>			// use PyObject
+#include <math.h>			// use ceil(), floor(), sqrt()
+
+#include <algorithm>			// use std::min(), std::max()
+#include <memory>			// use std::unique_ptr
+#include <new>				// use std::bad_alloc
+#include <vector>			// use std::vector
+
+#include <arrays/pythonarray.h>		// use parse_float_n3_array(), c_array_to_python()
+#include <arrays/rcarray.h>		// use FArray
+#include <arrays/threadpool.h>		// use Thread_Pool::thread_count(), run()
+#include <arrays/trace.h>		// use TRACE_SCOPE_ITEMS()
+
+#include "contour.h"			// use surface(), block_bounds()
+#include "distgrid.h"			// use sphere_surface_distance()
+#include "sesurface.h"
+
+using namespace Contour_Calculation;
+
+class Surface_Geometry
+{
+public:
+  std::vector<float> vertices, normals;
+  std::vector<int> triangles;
+  int64_t vertex_count() const { return vertices.size() / 3; }
+};
+
+// Distance grid in grid index units and its zero contour surface, with vertex
+// and triangle counts after each z plane for contour_surface_update().
+class Contoured_Grid
+{
+public:
+  FArray grid;
+  Surface_Geometry surface;
+  std::vector<VIndex> vertex_ends;
+  std::vector<TIndex> triangle_ends;
+};
+
+// Spheres and grids from a surface calculation, kept for updating the
+// surface after atoms move.
+class SES_Grids
+{
+public:
+  std::vector<float> xyz, radii;
+  float probe_radius, grid_spacing, max_radius;
+  bool sas;
+  float origin[3];
+  int64_t size[3];		// Grid size in z, y, x order
+  Contoured_Grid sas_grid, ses_grid;
+  bool valid = false;
+
+  int64_t atom_count() const { return radii.size(); }
+};
+
+const float MAX_INDEX_RANGE = 2;	// Grid distances are computed out to this range
+
+// -----------------------------------------------------------------------------
+// Run function f(i0, i1) for ranges of n items in shared pool threads.
+//
+template <class Range_Function>
+static void thread_ranges(int64_t n, int threads, Range_Function f)
+{
+  int nt = Thread_Pool::thread_count(n, 10000, std::max(threads, 1));
+  if (nt <= 1)
+    {
+      f(0, n);
+      return;
+    }
+  Thread_Pool::run(nt, [&](int t) { f((t*n)/nt, ((t+1)*n)/nt); });
+}
+
+// -----------------------------------------------------------------------------
+// Contour a distance grid at zero.  Beyond the maximum range every grid value
+// is the same so blocks of the grid away from the spheres are skipped.
+//
+const AIndex BOUNDS_BLOCK_SIZE = 8;
+
+static void grid_size(const FArray &matrix, AIndex size[3], GIndex stride[3])
+{
+  for (int a = 0 ; a < 3 ; ++a)
+    {
+      size[a] = static_cast<AIndex>(matrix.size(2-a));
+      stride[a] = matrix.stride(2-a);
+    }
+}
+
+static void take_surface(Contour_Surface *surf, Contoured_Grid &cg)
+{
+  std::unique_ptr<Contour_Surface> cs(surf);
+  VIndex vc = cs->vertex_count();
+  TIndex tc = cs->triangle_count();
+  int64_t planes = cg.grid.size(0);
+  cg.vertex_ends.resize(planes);
+  cg.triangle_ends.resize(planes);
+  cs->plane_ends(cg.vertex_ends.data(), cg.triangle_ends.data());
+  Surface_Geometry &g = cg.surface;
+  g.vertices.resize(3*static_cast<int64_t>(vc));
+  g.normals.resize(3*static_cast<int64_t>(vc));
+  g.triangles.resize(3*tc);
+  cs->take_geometry(g.vertices.data(), g.triangles.data(), g.normals.data());
+}
+
+static void contour_distance_grid(Contoured_Grid &cg, int threads)
+{
+  AIndex size[3];
+  GIndex stride[3];
+  grid_size(cg.grid, size, stride);
+  int64_t nb = 2;
+  for (int a = 0 ; a < 3 ; ++a)
+    nb *= block_count(size[a], BOUNDS_BLOCK_SIZE);
+  std::vector<float> bounds(nb);
+  const float *grid = cg.grid.values();
+  block_bounds(grid, size, stride, BOUNDS_BLOCK_SIZE, bounds.data());
+  take_surface(surface(grid, size, stride, 0.0f, false, threads,
+		       bounds.data(), BOUNDS_BLOCK_SIZE), cg);
+}
+
+// -----------------------------------------------------------------------------
+// Recontour after grid values changed in z planes k0 to k1, copying the rest
+// of the surface.
+//
+static void recontour_planes(Contoured_Grid &cg, int64_t k0, int64_t k1)
+{
+  AIndex size[3];
+  GIndex stride[3];
+  grid_size(cg.grid, size, stride);
+  const Surface_Geometry &g = cg.surface;
+  Surface_Arrays previous;
+  previous.vertex_count = static_cast<VIndex>(g.vertex_count());
+  previous.triangle_count = g.triangles.size() / 3;
+  previous.vertex_xyz = g.vertices.data();
+  previous.normals = g.normals.data();
+  previous.triangle_vertex_indices = g.triangles.data();
+  previous.vertex_plane_ends = cg.vertex_ends.data();
+  previous.triangle_plane_ends = cg.triangle_ends.data();
+  Contour_Surface *cs = surface_update(cg.grid.values(), size, stride, 0.0f, false,
+				       static_cast<AIndex>(k0), static_cast<AIndex>(k1),
+				       previous);
+  // The previous arrays are read until the new geometry is taken.
+  Contoured_Grid updated;
+  updated.grid = cg.grid;
+  take_surface(cs, updated);
+  cg.surface = std::move(updated.surface);
+  cg.vertex_ends = std::move(updated.vertex_ends);
+  cg.triangle_ends = std::move(updated.triangle_ends);
+}
+
+// -----------------------------------------------------------------------------
+// Set grid z planes k0 to k1 to the distance from the given spheres, which
+// are in grid index units.  Only spheres reaching those planes are used and
+// the values are the same as computing the whole grid.
+//
+static void sphere_distance_planes(FArray &grid, int64_t k0, int64_t k1,
+				   const float *centers, const float *radii, int64_t n,
+				   int threads)
+{
+  std::vector<float> c, r;
+  for (int64_t i = 0 ; i < n ; ++i)
+    {
+      float z = centers[3*i+2], reach = radii[i] + MAX_INDEX_RANGE;
+      if (z + reach >= k0 && z - reach <= k1)
+	{
+	  c.insert(c.end(), {centers[3*i], centers[3*i+1], z - k0});
+	  r.push_back(radii[i]);
+	}
+    }
+  int64_t m = r.size(), csize[2] = {m, 3};
+  FArray ca(2, csize), ra(1, &m);
+  std::copy(c.begin(), c.end(), ca.values());
+  std::copy(r.begin(), r.end(), ra.values());
+
+  int64_t ssize[3] = {k1-k0+1, grid.size(1), grid.size(2)};
+  FArray slab(3, ssize);
+  int64_t plane = ssize[1]*ssize[2];
+  std::fill(slab.values(), slab.values() + ssize[0]*plane, MAX_INDEX_RANGE);
+  sphere_surface_distance(ca, ra, MAX_INDEX_RANGE, slab, threads);
+  std::copy(slab.values(), slab.values() + ssize[0]*plane, grid.values() + k0*plane);
+}
+
+// -----------------------------------------------------------------------------
+// Atoms binned in cubic cells at least as large as the search distances so
+// only the cells neighboring a point need to be checked.
+//
+class Atom_Bins
+{
+public:
+  Atom_Bins(const float *xyz, const float *radii, int64_t n, float cell_size) :
+    xyz(xyz), radii(radii), cell_size(cell_size)
+  {
+    for (int a = 0 ; a < 3 ; ++a)
+      {
+	float xmin = xyz[a], xmax = xyz[a];
+	for (int64_t i = 1 ; i < n ; ++i)
+	  {
+	    float x = xyz[3*i+a];
+	    xmin = std::min(xmin, x);
+	    xmax = std::max(xmax, x);
+	  }
+	origin[a] = xmin;
+	size[a] = static_cast<int64_t>(floor((xmax - xmin) / cell_size)) + 1;
+      }
+    cell_start.assign(size[0]*size[1]*size[2] + 1, 0);
+    std::vector<int64_t> cell(n);
+    for (int64_t i = 0 ; i < n ; ++i)
+      {
+	int64_t c = 0;
+	for (int a = 2 ; a >= 0 ; --a)
+	  c = c*size[a] + static_cast<int64_t>(floor((xyz[3*i+a] - origin[a]) / cell_size));
+	cell[i] = c;
+	cell_start[c+1] += 1;
+      }
+    for (size_t c = 1 ; c < cell_start.size() ; ++c)
+      cell_start[c] += cell_start[c-1];
+    std::vector<int64_t> fill(cell_start.begin(), cell_start.end()-1);
+    cell_atoms.resize(n);
+    for (int64_t i = 0 ; i < n ; ++i)
+      cell_atoms[fill[cell[i]]++] = static_cast<int>(i);
+  }
+
+  // Closest atom within max_distance of point p, or -1.  If scaled is true
+  // the atom with smallest distance divided by radius is chosen.
+  int closest_atom(const float *p, float max_distance, bool scaled) const
+  {
+    int64_t cmin[3], cmax[3];
+    for (int a = 0 ; a < 3 ; ++a)
+      {
+	float x = (p[a] - origin[a]) / cell_size;
+	cmin[a] = std::max(static_cast<int64_t>(floor(x)) - 1, static_cast<int64_t>(0));
+	cmax[a] = std::min(static_cast<int64_t>(floor(x)) + 1, size[a] - 1);
+	if (cmin[a] > cmax[a])
+	  return -1;
+      }
+    float d2max = max_distance * max_distance, best = 0;
+    int closest = -1;
+    for (int64_t k = cmin[2] ; k <= cmax[2] ; ++k)
+      for (int64_t j = cmin[1] ; j <= cmax[1] ; ++j)
+	{
+	  int64_t c0 = (k*size[1] + j)*size[0];
+	  for (int64_t ai = cell_start[c0+cmin[0]] ; ai < cell_start[c0+cmax[0]+1] ; ++ai)
+	    {
+	      int i = cell_atoms[ai];
+	      const float *x = xyz + 3*i;
+	      float dx = p[0]-x[0], dy = p[1]-x[1], dz = p[2]-x[2];
+	      float d2 = dx*dx + dy*dy + dz*dz;
+	      if (d2 > d2max)
+		continue;
+	      float r = radii[i];
+	      float score = (scaled ? (r > 0 ? d2 / (r*r) : d2 * 1e10f) : d2);
+	      if (closest < 0 || score < best)
+		{
+		  closest = i;
+		  best = score;
+		}
+	    }
+	}
+    return closest;
+  }
+
+  const float *atom_xyz(int i) const { return xyz + 3*i; }
+
+private:
+  const float *xyz, *radii;
+  float cell_size;
+  float origin[3];
+  int64_t size[3];
+  std::vector<int64_t> cell_start;	// cell c atoms are [cell_start[c], cell_start[c+1])
+  std::vector<int> cell_atoms;
+};
+
+// -----------------------------------------------------------------------------
+// Find connected pieces of the surface and drop the ones whose lowest numbered
+// vertex is more than 1.5 probe radii from the closest atom sphere surface.
+// These are probe-sized bubbles inside the molecule.
+//
+static int vertex_root(std::vector<int> &parent, int v)
+{
+  while (parent[v] != v)
+    {
+      parent[v] = parent[parent[v]];
+      v = parent[v];
+    }
+  return v;
+}
+
+static void remove_distant_pieces(Surface_Geometry &g, const Atom_Bins &atoms,
+				  const float *radii, float probe_radius, float max_radius)
+{
+  int64_t nv = g.vertex_count(), nt = g.triangles.size() / 3;
+  std::vector<int> parent(nv);
+  for (int64_t v = 0 ; v < nv ; ++v)
+    parent[v] = static_cast<int>(v);
+  const int *ta = g.triangles.data();
+  for (int64_t t = 0 ; t < 3*nt ; t += 3)
+    for (int e = 1 ; e < 3 ; ++e)
+      {
+	int r0 = vertex_root(parent, ta[t]), r1 = vertex_root(parent, ta[t+e]);
+	if (r0 != r1)
+	  parent[std::max(r0, r1)] = std::min(r0, r1);	// Root is lowest vertex of piece
+      }
+
+  std::vector<char> keep(nv, 0);
+  const float *va = g.vertices.data();
+  float search = 1.5f*probe_radius + max_radius;
+  for (int64_t v = 0 ; v < nv ; ++v)
+    if (vertex_root(parent, v) == v)
+      {
+	const float *p = va + 3*v;
+	int a = atoms.closest_atom(p, search, false);
+	if (a >= 0)
+	  {
+	    const float *x = atoms.atom_xyz(a);
+	    float dx = p[0]-x[0], dy = p[1]-x[1], dz = p[2]-x[2];
+	    keep[v] = (sqrt(dx*dx + dy*dy + dz*dz) - radii[a] < 1.5f*probe_radius);
+	  }
+      }
+
+  std::vector<int> vmap(nv, -1);
+  int64_t kv = 0;
+  for (int64_t v = 0 ; v < nv ; ++v)
+    if (keep[vertex_root(parent, v)])
+      {
+	for (int a = 0 ; a < 3 ; ++a)
+	  {
+	    g.vertices[3*kv+a] = g.vertices[3*v+a];
+	    g.normals[3*kv+a] = g.normals[3*v+a];
+	  }
+	vmap[v] = static_cast<int>(kv++);
+      }
+  g.vertices.resize(3*kv);
+  g.normals.resize(3*kv);
+  int64_t kt = 0;
+  for (int64_t t = 0 ; t < 3*nt ; t += 3)
+    if (vmap[g.triangles[t]] >= 0)
+      {
+	for (int e = 0 ; e < 3 ; ++e)
+	  g.triangles[kt+e] = vmap[g.triangles[t+e]];
+	kt += 3;
+      }
+  g.triangles.resize(kt);
+}
+
+// -----------------------------------------------------------------------------
+// Spheres for the solvent accessible grid in grid index units.
+//
+static void atom_spheres(const SES_Grids &s, std::vector<float> &ijk, std::vector<float> &ri)
+{
+  int64_t n = s.atom_count();
+  ijk.resize(3*n);
+  ri.resize(n);
+  for (int64_t i = 0 ; i < n ; ++i)
+    {
+      for (int a = 0 ; a < 3 ; ++a)
+	ijk[3*i+a] = (s.xyz[3*i+a] - s.origin[a]) / s.grid_spacing;
+      ri[i] = (s.radii[i] + s.probe_radius) / s.grid_spacing;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Compute the distance grids and contour surfaces.  If the grids are not
+// being kept the solvent excluded calculation reuses the first grid.
+//
+static void ses_grids(SES_Grids &s, bool keep_grids, int threads)
+{
+  int64_t n = s.atom_count();
+  const float *xyz = s.xyz.data();
+  float xmin[3], xmax[3];
+  for (int a = 0 ; a < 3 ; ++a)
+    xmin[a] = xmax[a] = xyz[a];
+  s.max_radius = 0;
+  for (int64_t i = 0 ; i < n ; ++i)
+    {
+      for (int a = 0 ; a < 3 ; ++a)
+	{
+	  xmin[a] = std::min(xmin[a], xyz[3*i+a]);
+	  xmax[a] = std::max(xmax[a], xyz[3*i+a]);
+	}
+      s.max_radius = std::max(s.max_radius, s.radii[i]);
+    }
+  float sp = s.grid_spacing, pad = 2*s.probe_radius + s.max_radius + sp;
+  for (int a = 0 ; a < 3 ; ++a)
+    {
+      s.origin[a] = xmin[a] - pad;
+      s.size[2-a] = static_cast<int64_t>(ceil((xmax[a] - xmin[a] + 2*pad) / sp));
+    }
+
+  // Distance map from surface of spheres in grid index units, positive outside.
+  s.sas_grid.grid = FArray(3, s.size);
+  float *ma = s.sas_grid.grid.values();
+  int64_t msize = s.sas_grid.grid.size();
+  std::fill(ma, ma + msize, MAX_INDEX_RANGE);
+  std::vector<float> ijk, ri;
+  atom_spheres(s, ijk, ri);
+  int64_t csize[2] = {n, 3};
+  FArray ca(2, csize), ra(1, &n);
+  std::copy(ijk.begin(), ijk.end(), ca.values());
+  std::copy(ri.begin(), ri.end(), ra.values());
+  sphere_surface_distance(ca, ra, MAX_INDEX_RANGE, s.sas_grid.grid, threads);
+  contour_distance_grid(s.sas_grid, threads);
+  if (s.sas)
+    return;
+
+  // Solvent excluded surface distance map using solvent accessible
+  // surface vertices as probe sphere centers.
+  if (keep_grids)
+    s.ses_grid.grid = FArray(3, s.size);
+  else
+    s.ses_grid.grid = s.sas_grid.grid;
+  float *sa = s.ses_grid.grid.values();
+  std::fill(sa, sa + msize, MAX_INDEX_RANGE);
+  const Surface_Geometry &sas = s.sas_grid.surface;
+  int64_t psize[2] = {sas.vertex_count(), 3};
+  FArray pxyz(2, psize), pr(1, psize);
+  std::copy(sas.vertices.begin(), sas.vertices.end(), pxyz.values());
+  std::fill(pr.values(), pr.values() + psize[0], s.probe_radius / sp);
+  sphere_surface_distance(pxyz, pr, MAX_INDEX_RANGE, s.ses_grid.grid, threads);
+  contour_distance_grid(s.ses_grid, threads);
+  if (!keep_grids)
+    {
+      s.sas_grid = Contoured_Grid();
+      s.ses_grid.grid = FArray();
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Update the grids and surfaces for new atom coordinates, recomputing only
+// grid planes within reach of atoms that moved.  Returns false if the atoms
+// changed too much for that, moving outside the grid or changing most planes,
+// or if atom radii changed.
+//
+static bool update_ses_grids(SES_Grids &s, const float *xyz, const float *radii, int64_t n,
+			     int threads)
+{
+  if (!s.valid || n != s.atom_count() || !std::equal(radii, radii + n, s.radii.begin()))
+    return false;
+
+  float sp = s.grid_spacing, pad = 2*s.probe_radius + s.max_radius + sp;
+  float zmin = 0, zmax = -1;
+  for (int64_t i = 0 ; i < n ; ++i)
+    {
+      const float *x = xyz + 3*i, *x0 = s.xyz.data() + 3*i;
+      if (x[0] == x0[0] && x[1] == x0[1] && x[2] == x0[2])
+	continue;
+      for (int a = 0 ; a < 3 ; ++a)
+	if (x[a] < s.origin[a] + pad || x[a] > s.origin[a] + s.size[2-a]*sp - pad)
+	  return false;
+      float reach = (s.radii[i] + s.probe_radius) / sp + MAX_INDEX_RANGE;
+      for (float z : {x0[2], x[2]})
+	{
+	  float k = (z - s.origin[2]) / sp;
+	  if (zmax < zmin)
+	    { zmin = k - reach; zmax = k + reach; }
+	  else
+	    { zmin = std::min(zmin, k - reach); zmax = std::max(zmax, k + reach); }
+	}
+    }
+  if (zmax < zmin)
+    return true;	// No atoms moved.
+
+  int64_t nz = s.size[0];
+  int64_t k0 = std::max(static_cast<int64_t>(floor(zmin)), static_cast<int64_t>(0));
+  int64_t k1 = std::min(static_cast<int64_t>(ceil(zmax)), nz-1);
+  int64_t pk = static_cast<int64_t>(ceil(s.probe_radius / sp + MAX_INDEX_RANGE)) + 1;
+  int64_t sk0 = std::max(k0 - pk, static_cast<int64_t>(0)), sk1 = std::min(k1 + pk, nz-1);
+  if (2*(sk1 - sk0 + 1) > nz)
+    return false;	// Full calculation is about as fast.
+
+  s.valid = false;	// Until the update finishes
+  std::copy(xyz, xyz + 3*n, s.xyz.begin());
+  std::vector<float> ijk, ri;
+  atom_spheres(s, ijk, ri);
+  sphere_distance_planes(s.sas_grid.grid, k0, k1, ijk.data(), ri.data(), n, threads);
+  recontour_planes(s.sas_grid, k0, k1);
+
+  if (!s.sas)
+    {
+      // Solvent accessible vertices changed only within one plane of the
+      // changed grid planes, and their probe spheres reach pk planes.
+      const Surface_Geometry &sas = s.sas_grid.surface;
+      int64_t nv = sas.vertex_count();
+      std::vector<float> pr(nv, s.probe_radius / sp);
+      sphere_distance_planes(s.ses_grid.grid, sk0, sk1, sas.vertices.data(), pr.data(), nv,
+			     threads);
+      recontour_planes(s.ses_grid, sk0, sk1);
+    }
+  s.valid = true;
+  return true;
+}
+
+// -----------------------------------------------------------------------------
+// Surface in atom coordinates with distant pieces removed and the closest
+// atom for each vertex.
+//
+static void surface_geometry(const SES_Grids &s, int threads,
+			     Surface_Geometry &g, std::vector<int> &vertex_atoms)
+{
+  g = (s.sas ? s.sas_grid.surface : s.ses_grid.surface);
+
+  // Grid index to atom coordinates.
+  float *va = g.vertices.data();
+  int64_t nv = g.vertex_count();
+  for (int64_t v = 0 ; v < nv ; ++v)
+    for (int a = 0 ; a < 3 ; ++a)
+      va[3*v+a] = s.origin[a] + s.grid_spacing*va[3*v+a];
+
+  const float *xyz = s.xyz.data(), *radii = s.radii.data();
+  float piece_distance = 1.5f*s.probe_radius + s.max_radius;
+  float vertex_distance = 1.1f*(s.probe_radius + s.max_radius + s.grid_spacing);
+  Atom_Bins atoms(xyz, radii, s.atom_count(), std::max(piece_distance, vertex_distance));
+  if (!s.sas)
+    remove_distant_pieces(g, atoms, radii, s.probe_radius, s.max_radius);
+
+  // Closest atom to each vertex, scaled by atom radius as MolecularSurface
+  // vertex_to_atom_map() does.  Vertices with no atom in range get -1.
+  nv = g.vertex_count();
+  vertex_atoms.resize(nv);
+  const float *cva = g.vertices.data();
+  int *v2a = vertex_atoms.data();
+  thread_ranges(nv, threads,
+		[&](int64_t v0, int64_t v1)
+		{
+		  for (int64_t v = v0 ; v < v1 ; ++v)
+		    v2a[v] = atoms.closest_atom(cva + 3*v, vertex_distance, true);
+		});
+}
+
+// ----------------------------------------------------------------------------
+//
+static PyObject *surface_tuple(const Surface_Geometry &g, const std::vector<int> &vertex_atoms,
+			       PyObject *grids = NULL)
+{
+  int64_t nv = g.vertex_count(), nt = g.triangles.size() / 3;
+  PyObject *geom = PyTuple_New(grids ? 5 : 4);
+  PyTuple_SET_ITEM(geom, 0, c_array_to_python(g.vertices, nv, 3));
+  PyTuple_SET_ITEM(geom, 1, c_array_to_python(g.normals, nv, 3));
+  PyTuple_SET_ITEM(geom, 2, c_array_to_python(g.triangles, nt, 3));
+  PyTuple_SET_ITEM(geom, 3, c_array_to_python(vertex_atoms));
+  if (grids)
+    PyTuple_SET_ITEM(geom, 4, grids);
+  return geom;
+}
+
+// ----------------------------------------------------------------------------
+//
+static void delete_ses_grids(PyObject *capsule)
+{
+  delete static_cast<SES_Grids *>(PyCapsule_GetPointer(capsule, "SES_Grids"));
+}
+
+// ----------------------------------------------------------------------------
+//
+extern "C" PyObject *py_ses_surface(PyObject *, PyObject *args, PyObject *keywds)
+{
+  FArray centers, radii;
+  float probe_radius = 1.4, grid_spacing = 0.5;
+  int sas = 0, keep_grids = 0, threads = 1;
+  const char *kwlist[] = {"centers", "radii", "probe_radius", "grid_spacing",
+			  "sas", "keep_grids", "threads", NULL};
+  if (!PyArg_ParseTupleAndKeywords(args, keywds,
+				   const_cast<char *>("O&O&|ffppi"), (char **)kwlist,
+				   parse_float_n3_array, &centers,
+				   parse_float_n_array, &radii,
+				   &probe_radius, &grid_spacing, &sas, &keep_grids,
+				   &threads))
+    return NULL;
+
+  int64_t n = centers.size(0);
+  if (radii.size(0) != n)
+    {
+      PyErr_SetString(PyExc_TypeError,
+		      "Lengths of centers and radii arrays don't match.");
+      return NULL;
+    }
+  if (n == 0)
+    {
+      PyErr_SetString(PyExc_ValueError, "No spheres to compute surface for.");
+      return NULL;
+    }
+  if (grid_spacing <= 0)
+    {
+      PyErr_Format(PyExc_ValueError, "Grid spacing must be positive, got %g", grid_spacing);
+      return NULL;
+    }
+
+  FArray cc = centers.contiguous_array(), cr = radii.contiguous_array();
+  SES_Grids *s = new SES_Grids();
+  s->xyz.assign(cc.values(), cc.values() + 3*n);
+  s->radii.assign(cr.values(), cr.values() + n);
+  s->probe_radius = probe_radius;
+  s->grid_spacing = grid_spacing;
+  s->sas = sas;
+  Surface_Geometry g;
+  std::vector<int> vertex_atoms;
+  bool out_of_memory = false;
+  Py_BEGIN_ALLOW_THREADS
+  TRACE_SCOPE_ITEMS("map.ses_surface", n);
+  try
+    {
+      ses_grids(*s, keep_grids, threads);
+      s->valid = true;
+      surface_geometry(*s, threads, g, vertex_atoms);
+    }
+  catch (std::bad_alloc&)
+    {
+      out_of_memory = true;
+    }
+  Py_END_ALLOW_THREADS
+
+  if (out_of_memory || !keep_grids)
+    delete s;
+  if (out_of_memory)
+    {
+      PyErr_SetString(PyExc_MemoryError,
+		      "Surface calculation out of memory allocating the distance grid");
+      return NULL;
+    }
+
+  PyObject *grids = (keep_grids ? PyCapsule_New(s, "SES_Grids", delete_ses_grids) : NULL);
+  return surface_tuple(g, vertex_atoms, grids);
+}
+
+// ----------------------------------------------------------------------------
+//
+extern "C" PyObject *py_ses_surface_update(PyObject *, PyObject *args, PyObject *keywds)
+{
+  PyObject *py_grids;
+  FArray centers, radii;
+  int threads = 1;
+  const char *kwlist[] = {"grids", "centers", "radii", "threads", NULL};
+  if (!PyArg_ParseTupleAndKeywords(args, keywds,
+				   const_cast<char *>("OO&O&|i"), (char **)kwlist,
+				   &py_grids,
+				   parse_float_n3_array, &centers,
+				   parse_float_n_array, &radii,
+				   &threads))
+    return NULL;
+  if (radii.size(0) != centers.size(0))
+    {
+      PyErr_SetString(PyExc_TypeError,
+		      "Lengths of centers and radii arrays don't match.");
+      return NULL;
+    }
+
+  SES_Grids *s = static_cast<SES_Grids *>(PyCapsule_GetPointer(py_grids, "SES_Grids"));
+  if (s == NULL)
+    return NULL;
+
+  FArray cc = centers.contiguous_array(), cr = radii.contiguous_array();
+  Surface_Geometry g;
+  std::vector<int> vertex_atoms;
+  bool updated = false, out_of_memory = false;
+  Py_BEGIN_ALLOW_THREADS
+  TRACE_SCOPE_ITEMS("map.ses_surface_update", cc.size(0));
+  try
+    {
+      updated = update_ses_grids(*s, cc.values(), cr.values(), cc.size(0), threads);
+      if (updated)
+	surface_geometry(*s, threads, g, vertex_atoms);
+    }
+  catch (std::bad_alloc&)
+    {
+      out_of_memory = true;
+    }
+  Py_END_ALLOW_THREADS
+
+  if (out_of_memory)
+    {
+      PyErr_SetString(PyExc_MemoryError, "Out of memory updating surface");
+      return NULL;
+    }
+  if (!updated)
+    return python_none();
+
+  return surface_tuple(g, vertex_atoms);
+}
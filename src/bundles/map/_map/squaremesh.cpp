@@ -36,38 +36,66 @@
 
 #include <arrays/pythonarray.h>		// use array_from_python()
 #include <arrays/rcarray.h>		// use FArray, IArray
+#include <arrays/threadpool.h>		// use Thread_Pool::parallel_for()
 
 #include "index_types.h"		// Use VIndex, TIndex
+#include "squaremesh.h"
+
+// Triangles per thread pool task.
+static const int64_t edge_chunk_size = 65536;
 
 // ----------------------------------------------------------------------------
+// Edge tests combine with bit operations instead of branches so the loop
+// can vectorize.
 //
-static void principle_plane_edges(const FArray &varray, const IArray &tarray,
+static void principle_plane_edges(const float *va, int64_t vs0, int64_t vs1,
+				  const VIndex *ta, int64_t ts0, int64_t ts1,
+				  TIndex tstart, TIndex tend,
 				  unsigned char *e, int64_t estride)
 {
-  int edge_01_mask = 1, edge_12_mask = 2, edge_20_mask = 4;
-
-  VIndex *ta = tarray.values();
-  TIndex ts0 = tarray.stride(0), ts1 = tarray.stride(1);
-  float *va = varray.values();
-  VIndex vs0 = varray.stride(0), vs1 = varray.stride(1);
-  VIndex yo = vs1, zo = 2*vs1;
-  TIndex n = tarray.size(0);
-  for (TIndex t = 0 ; t < n ; ++t)
+  int64_t yo = vs1, zo = 2*vs1;
+  for (TIndex t = tstart ; t < tend ; ++t)
     {
-      TIndex t0 = ts0 * t;
+      int64_t t0 = ts0 * t;
       VIndex i0 = ta[t0], i1 = ta[t0+ts1], i2 = ta[t0+2*ts1];
-      float *v0 = &va[vs0*i0], *v1 = &va[vs0*i1], *v2 = &va[vs0*i2];
-      int emask = 0;
-      if (v0[0] == v1[0] || v0[yo] == v1[yo] || v0[zo] == v1[zo])
-	emask |= edge_01_mask;
-      if (v1[0] == v2[0] || v1[yo] == v2[yo] || v1[zo] == v2[zo])
-	emask |= edge_12_mask;
-      if (v2[0] == v0[0] || v2[yo] == v0[yo] || v2[zo] == v0[zo])
-	emask |= edge_20_mask;
-      e[t*estride] = emask;
+      const float *v0 = &va[vs0*i0], *v1 = &va[vs0*i1], *v2 = &va[vs0*i2];
+      int e01 = (v0[0] == v1[0]) | (v0[yo] == v1[yo]) | (v0[zo] == v1[zo]);
+      int e12 = (v1[0] == v2[0]) | (v1[yo] == v2[yo]) | (v1[zo] == v2[zo]);
+      int e20 = (v2[0] == v0[0]) | (v2[yo] == v0[yo]) | (v2[zo] == v0[zo]);
+      e[t*estride] = static_cast<unsigned char>(e01 | (e12 << 1) | (e20 << 2));
     }
 }
 
+// ----------------------------------------------------------------------------
+//
+static void principle_plane_edges(const float *va, int64_t vs0, int64_t vs1,
+				  const VIndex *ta, int64_t ts0, int64_t ts1, TIndex n,
+				  unsigned char *e, int64_t estride)
+{
+  Thread_Pool::parallel_for(n, [=](int64_t t0, int64_t t1) {
+      principle_plane_edges(va, vs0, vs1, ta, ts0, ts1, t0, t1, e, estride);
+    }, edge_chunk_size);
+}
+
+// ----------------------------------------------------------------------------
+//
+void principle_plane_edge_mask(const float *vertices, const VIndex *triangles, TIndex n,
+				unsigned char *edge_mask)
+{
+  principle_plane_edges(vertices, 3, 1, triangles, 3, 1, n, edge_mask, 1);
+}
+
+// ----------------------------------------------------------------------------
+//
+static void principle_plane_edges(const FArray &varray, const IArray &tarray,
+				  unsigned char *e, int64_t estride)
+{
+  principle_plane_edges(varray.values(), varray.stride(0), varray.stride(1),
+			reinterpret_cast<const VIndex *>(tarray.values()),
+			tarray.stride(0), tarray.stride(1), tarray.size(0),
+			e, estride);
+}
+
 // ----------------------------------------------------------------------------
 //
 extern "C" PyObject *
@@ -91,7 +119,9 @@ principle_plane_edges(PyObject *, PyObject *args, PyObject *keywds)
       return NULL;
     }
 
+  Py_BEGIN_ALLOW_THREADS
   principle_plane_edges(varray, tarray, static_cast<unsigned char *>(barray.values()), barray.stride(0));
+  Py_END_ALLOW_THREADS
 
   return python_none();
 }
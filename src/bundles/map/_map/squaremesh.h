@@ -29,6 +29,12 @@
 
 #include <Python.h>			// use PyObject
 
+#include "index_types.h"		// Use VIndex, TIndex
+
+// Edge mask for contiguous vertex and triangle arrays, computed in parallel.
+void principle_plane_edge_mask(const float *vertices, const VIndex *triangles, TIndex n,
+				unsigned char *edge_mask);
+
 extern "C" {
 
 PyObject *principle_plane_edges(PyObject *s, PyObject *args, PyObject *keywds);
@@ -30,8 +30,12 @@
 
 // #include <iostream>			// use std::cerr for debugging
 
+#include <algorithm>			// use std::max
+#include <vector>			// use std::vector
+
 #include <arrays/pythonarray.h>		// use array_from_python(), ...
 #include <arrays/rcarray.h>		// use Array<T>, Numeric_Array
+#include <arrays/threadpool.h>		// use Thread_Pool::run()
 using Reference_Counted_Array::Numeric_Array;
 
 namespace Map_Cpp
@@ -69,6 +73,23 @@ static void resample_colormap(float bcf1, float bcl21,
 			      float bcf2, float bcl2, Color_Float_Array &cmap2,
 			      int64_t bins, int64_t bin_step, bool blend);
 
+// ----------------------------------------------------------------------------
+// Color arrays with fewer elements per thread than this are computed with
+// fewer threads since thread startup would take more time than it saves.
+//
+const int64_t MIN_THREAD_ELEMENTS = (1 << 18);
+
+// ----------------------------------------------------------------------------
+// Call f(k0, k1) for consecutive ranges of n array elements with a shared
+// pool thread for each range.
+//
+template <class Range_Function>
+static void thread_element_ranges(int64_t n, int threads, Range_Function f)
+{
+  int nt = Thread_Pool::thread_count(n, MIN_THREAD_ELEMENTS, std::max(threads, 1));
+  Thread_Pool::run(nt, [&](int t) { f((t*n)/nt, ((t+1)*n)/nt); });
+}
+
 // ----------------------------------------------------------------------------
 //
 inline
@@ -123,41 +144,74 @@ static bool transfer_function_value(const Transfer_Function &transfer_func,
 }
 
 // ----------------------------------------------------------------------------
-// RGBA array must be contiguous.
+// Convert a float color component to 8-bit.
+//
+inline unsigned char color_uint8(float c)
+{
+  if (c > 1) c = 1;
+  else if (c < 0) c = 0;
+  return (unsigned char)(255*c);
+}
+
+// ----------------------------------------------------------------------------
+// RGBA array must be contiguous.  It can have float or uint8 values.
+// The data array can be strided, e.g. a subsampled region, and is not copied.
 //
 template <class T>
 static void data_to_rgba(const Reference_Counted_Array::Array<T> &data,
 			 const Transfer_Function &transfer_func,
 			 int extend_left, int extend_right,
-			 RGBA_Float_Array &rgba, bool blend)
+			 Numeric_Array &rgba, bool blend, int threads)
 {
-  Reference_Counted_Array::Array<T> cdata = data.contiguous_array();
-
-  int64_t n = cdata.size();
-  T *d = cdata.values();
-  float *rgba_values = rgba.values();
-  float r = 0, g = 0, b = 0, a = 0;		// Avoid compiler warnings.
-  for (int64_t k = 0 ; k < n ; ++k)
-    if (transfer_function_value(transfer_func, (float)d[k],
-				extend_left, extend_right,
-				&r, &g, &b, &a))
-      {
-	float *rgbak = rgba_values + 4*k;
-	if (blend)
-	  {
-	    rgbak[0] += r;
-	    rgbak[1] += g;
-	    rgbak[2] += b;
-	    rgbak[3] = 1 - (1-a) * (1-rgbak[3]);
-	  }
-	else
+  int64_t n = data.size();
+  const T *d = data.values();
+  bool uint8 = (rgba.value_type() == Numeric_Array::Unsigned_Char);
+  float *rgba_values = (uint8 ? NULL : static_cast<float *>(rgba.values()));
+  unsigned char *rgba_uint8 = (uint8 ? static_cast<unsigned char *>(rgba.values()) : NULL);
+  auto color_run = [&](int64_t r0, int64_t r1, int64_t offset, int64_t step)
+    {
+      float r = 0, g = 0, b = 0, a = 0;		// Avoid compiler warnings.
+      const T *dr = d + offset - r0*step;
+      for (int64_t k = r0 ; k < r1 ; ++k)
+	if (transfer_function_value(transfer_func, (float)dr[k*step],
+				    extend_left, extend_right,
+				    &r, &g, &b, &a))
 	  {
-	    rgbak[0] = r;
-	    rgbak[1] = g;
-	    rgbak[2] = b;
-	    rgbak[3] = a;
+	    if (uint8)
+	      {
+		unsigned char *rgbak = rgba_uint8 + 4*k;
+		if (blend)
+		  {
+		    r += rgbak[0]/255.0f;
+		    g += rgbak[1]/255.0f;
+		    b += rgbak[2]/255.0f;
+		    a = 1 - (1-a) * (1-rgbak[3]/255.0f);
+		  }
+		rgbak[0] = color_uint8(r);
+		rgbak[1] = color_uint8(g);
+		rgbak[2] = color_uint8(b);
+		rgbak[3] = color_uint8(a);
+		continue;
+	      }
+	    float *rgbak = rgba_values + 4*k;
+	    if (blend)
+	      {
+		rgbak[0] += r;
+		rgbak[1] += g;
+		rgbak[2] += b;
+		rgbak[3] = 1 - (1-a) * (1-rgbak[3]);
+	      }
+	    else
+	      {
+		rgbak[0] = r;
+		rgbak[1] = g;
+		rgbak[2] = b;
+		rgbak[3] = a;
+	      }
 	  }
-      }
+    };
+  auto colors = [&](int64_t k0, int64_t k1) { data.element_runs(k0, k1, color_run); };
+  thread_element_ranges(n, threads, colors);
 }
 
 // ----------------------------------------------------------------------------
@@ -167,66 +221,79 @@ extern "C" PyObject *data_to_rgba(PyObject *, PyObject *args, PyObject *keywds)
   Numeric_Array data, nrgba;
   Transfer_Function transfer_func;
   int extend_left, extend_right;
-  int iblend;
-  const char *kwlist[] = {"data", "transfer_function", "extend_left", "extend_right", "rgba", "blend", NULL};
-  if (!PyArg_ParseTupleAndKeywords(args, keywds, const_cast<char *>("O&O&iiO&i"),
+  int iblend, threads = 1;
+  const char *kwlist[] = {"data", "transfer_function", "extend_left", "extend_right", "rgba", "blend",
+			  "threads", NULL};
+  if (!PyArg_ParseTupleAndKeywords(args, keywds, const_cast<char *>("O&O&iiO&i|i"),
 				   (char **)kwlist,
 				   parse_3d_array, &data,
 				   parse_transfer_function, &transfer_func,
 				   &extend_left, &extend_right,
 				   parse_writable_4d_array, &nrgba,
-				   &iblend))
+				   &iblend, &threads))
     return NULL;
   bool blend = (iblend != 0);
 
-  RGBA_Float_Array rgba = nrgba;
-  if (!check_color_array_size(rgba, data, 4))
+  if (nrgba.value_type() != Numeric_Array::Float &&
+      nrgba.value_type() != Numeric_Array::Unsigned_Char)
+    {
+      PyErr_SetString(PyExc_TypeError, "RGBA array type must be float32 or uint8");
+      return NULL;
+    }
+  if (!check_color_array_size(nrgba, data, 4))
     return NULL;
 
+  Py_BEGIN_ALLOW_THREADS
   call_template_function(data_to_rgba, data.value_type(),
-			 (data, transfer_func, extend_left, extend_right, rgba, blend));
+			 (data, transfer_func, extend_left, extend_right, nrgba, blend, threads));
+  Py_END_ALLOW_THREADS
 
   return python_none();
 }
 
 // ----------------------------------------------------------------------------
-// RGBA and colormap arrays must be contiguous.
+// RGBA and colormap arrays must be contiguous.  Data can be strided.
 //
 template <class T>
 static void data_to_colormap_colors(const Reference_Counted_Array::Array<T> &data,
 				    float bcf, float bcl,
 				    const Color_Float_Array &colormap,
-				    Color_Float_Array &colors, bool blend)
+				    Color_Float_Array &colors, bool blend,
+				    int threads)
 {
   if (bcl - bcf <= 0)
     return;
 
-  Reference_Counted_Array::Array<T> cdata = data.contiguous_array();
   const Color_Float_Array &ccolormap = colormap.contiguous_array();
 
-  int64_t n = cdata.size();
-  T *d = cdata.values();
+  int64_t n = data.size();
+  const T *d = data.values();
   int64_t nc = ccolormap.size(0);
   int ncc = ccolormap.size(1), nca = ncc-1;
   float *cmap = ccolormap.values();
   float *color_values = colors.values();
-  if (blend)
+  auto colors_run = [&](int64_t r0, int64_t r1, int64_t offset, int64_t step)
     {
-      float *cmk = new float[ncc];
-      for (int64_t k = 0 ; k < n ; ++k)
-	if (colormap_value((float)d[k], bcf, bcl, cmap, nc, ncc, cmk))
-	  {
-	    float *ck = color_values + ncc*k;
-	    for (int64_t c = 0 ; c < nca ; ++c)
-	      ck[c] += cmk[c];	// color channel (r,g,b, or l)
-	    if (ncc > 1)
-	      ck[nca] = 1 - (1-cmk[nca]) * (1-ck[nca]); // Alpha
-	  }
-      delete [] cmk;
-    }
-  else
-    for (int64_t k = 0 ; k < n ; ++k)
-      colormap_value((float)d[k], bcf, bcl, cmap, nc, ncc, color_values+ncc*k);
+      const T *dr = d + offset - r0*step;
+      if (blend)
+	{
+	  std::vector<float> cmk(ncc);
+	  for (int64_t k = r0 ; k < r1 ; ++k)
+	    if (colormap_value((float)dr[k*step], bcf, bcl, cmap, nc, ncc, cmk.data()))
+	      {
+		float *ck = color_values + ncc*k;
+		for (int64_t c = 0 ; c < nca ; ++c)
+		  ck[c] += cmk[c];	// color channel (r,g,b, or l)
+		if (ncc > 1)
+		  ck[nca] = 1 - (1-cmk[nca]) * (1-ck[nca]); // Alpha
+	      }
+	}
+      else
+	for (int64_t k = r0 ; k < r1 ; ++k)
+	  colormap_value((float)dr[k*step], bcf, bcl, cmap, nc, ncc, color_values+ncc*k);
+    };
+  auto colors_range = [&](int64_t k0, int64_t k1) { data.element_runs(k0, k1, colors_run); };
+  thread_element_ranges(n, threads, colors_range);
 }
 
 // ----------------------------------------------------------------------------
@@ -255,22 +322,24 @@ data_to_colormap_colors(PyObject *, PyObject *args, PyObject *keywds)
   Numeric_Array data;
   Color_Float_Array cmap, colors;
   float bcf, bcl;
-  int iblend;
+  int iblend, threads = 1;
   const char *kwlist[] = {"data", "dmin", "dmax", "colormap", "colors",
-			  "blend", NULL};
-  if (!PyArg_ParseTupleAndKeywords(args, keywds, const_cast<char *>("O&ffO&O&i"),
+			  "blend", "threads", NULL};
+  if (!PyArg_ParseTupleAndKeywords(args, keywds, const_cast<char *>("O&ffO&O&i|i"),
 				   (char **)kwlist,
 				   parse_3d_array, &data,
 				   &bcf, &bcl,
 				   parse_float_colormap, &cmap,
 				   parse_writable_4d_array, &colors,
-				   &iblend) ||
+				   &iblend, &threads) ||
       !check_color_array_size(colors, data, cmap.size(1)))
     return NULL;
   bool blend = (iblend != 0);
 
+  Py_BEGIN_ALLOW_THREADS
   call_template_function(data_to_colormap_colors, data.value_type(),
-			 (data, bcf, bcl, cmap, colors, blend));
+			 (data, bcf, bcl, cmap, colors, blend, threads));
+  Py_END_ALLOW_THREADS
 
   return python_none();
 }
@@ -313,21 +382,13 @@ static bool check_color_array_size(const Reference_Counted_Array::Untyped_Array
 }
 
 // ----------------------------------------------------------------------------
-// Color and colormap arrays must be contiguous.
+// Color n data values writing to a contiguous color array.
 //
 template <class T>
-static void data_to_colors(const Reference_Counted_Array::Array<T> &data,
-			   float dmin, float dmax, const Color_Array &colormap,
-			   bool extend_left, bool extend_right, Color_Array &colors)
+static void values_to_colors(const T *d, int64_t n,
+			     float dmin, float dmax, const Color_Array &ccolormap,
+			     bool extend_left, bool extend_right, void *color_values)
 {
-  if (dmax - dmin <= 0)
-    return;
-
-  Reference_Counted_Array::Array<T> cdata = data.contiguous_array();
-  const Color_Array &ccolormap = colormap.contiguous_array();
-
-  int64_t n = cdata.size();
-  T *d = cdata.values();
   int64_t nc = ccolormap.size(0);
   if (nc == 0)
     extend_left = extend_right = false;
@@ -340,7 +401,7 @@ static void data_to_colors(const Reference_Counted_Array::Array<T> &data,
       unsigned int *cmap = (unsigned int *) ccolormap.values();
       unsigned int c0 = (extend_left ? cmap[0] : 0);
       unsigned int c1 = (extend_right ? cmap[nc-1] : 0);
-      unsigned int *cv = (unsigned int *)colors.values();
+      unsigned int *cv = (unsigned int *)color_values;
       if (data_is_index)
 	{
 	  // Optimize common case where data value = color map index.
@@ -365,7 +426,7 @@ static void data_to_colors(const Reference_Counted_Array::Array<T> &data,
       unsigned short *cmap = (unsigned short *) ccolormap.values();
       unsigned short c0 = (extend_left ? cmap[0] : 0);
       unsigned short c1 = (extend_right ? cmap[nc-1] : 0);
-      unsigned short *cv = (unsigned short *)colors.values();
+      unsigned short *cv = (unsigned short *)color_values;
       if (data_is_index)
 	{
 	  // Optimize common case where data value = color map index.
@@ -390,7 +451,7 @@ static void data_to_colors(const Reference_Counted_Array::Array<T> &data,
       unsigned char *cmap = (unsigned char *) ccolormap.values();
       unsigned char c0 = (extend_left ? cmap[0] : 0);
       unsigned char c1 = (extend_right ? cmap[nc-1] : 0);
-      unsigned char *cv = (unsigned char *)colors.values();
+      unsigned char *cv = (unsigned char *)color_values;
       if (data_is_index)
 	{
 	  // Optimize common case where data value = color map index.
@@ -414,7 +475,7 @@ static void data_to_colors(const Reference_Counted_Array::Array<T> &data,
       char *cmap = (char *) ccolormap.values();
       char *c0 = (extend_left ? cmap : (char *)0);
       char *c1 = (extend_right ? cmap + (nc-1)*ncb : (char *)0);
-      char *cv = (char *)colors.values();
+      char *cv = (char *)color_values;
       for (int64_t k = 0 ; k < n ; ++k)
 	{
 	  int64_t i = (int64_t)(data_is_index ? d[k] : (d[k]-dmin)*scale);
@@ -435,6 +496,45 @@ static void data_to_colors(const Reference_Counted_Array::Array<T> &data,
     }
 }
 
+// ----------------------------------------------------------------------------
+// Color and colormap arrays must be contiguous.  Data can be strided.
+//
+template <class T>
+static void data_to_colors(const Reference_Counted_Array::Array<T> &data,
+			   float dmin, float dmax, const Color_Array &colormap,
+			   bool extend_left, bool extend_right, Color_Array &colors,
+			   int threads)
+{
+  if (dmax - dmin <= 0)
+    return;
+
+  const Color_Array &ccolormap = colormap.contiguous_array();
+
+  int64_t n = data.size();
+  const T *d = data.values();
+  int64_t ncb = ccolormap.size(1) * ccolormap.element_size();
+  char *cv = (char *)colors.values();
+  auto colors_range = [&](int64_t k0, int64_t k1)
+    {
+      // Strided rows are gathered one at a time for the contiguous loops.
+      std::vector<T> row;
+      data.element_runs(k0, k1, [&](int64_t r0, int64_t r1, int64_t offset, int64_t step)
+	{
+	  const T *dr = d + offset;
+	  if (step != 1)
+	    {
+	      row.resize(r1-r0);
+	      for (int64_t k = 0 ; k < r1-r0 ; ++k)
+		row[k] = dr[k*step];
+	      dr = row.data();
+	    }
+	  values_to_colors(dr, r1 - r0, dmin, dmax, ccolormap,
+			   extend_left, extend_right, cv + ncb*r0);
+	});
+    };
+  thread_element_ranges(n, threads, colors_range);
+}
+
 // ----------------------------------------------------------------------------
 //
 extern "C" PyObject *
@@ -443,18 +543,18 @@ data_to_colors(PyObject *, PyObject *args, PyObject *keywds)
   Numeric_Array data;
   Color_Array cmap;
   float dmin, dmax;
-  int i_extend_left, i_extend_right;
+  int i_extend_left, i_extend_right, threads = 1;
   PyObject *py_colors;
   const char *kwlist[] = {"data", "dmin", "dmax", "colormap", "extend_left", "extend_right",
-			  "colors", NULL};
-  if (!PyArg_ParseTupleAndKeywords(args, keywds, const_cast<char *>("O&ffO&iiO"),
+			  "colors", "threads", NULL};
+  if (!PyArg_ParseTupleAndKeywords(args, keywds, const_cast<char *>("O&ffO&iiO|i"),
 				   (char **)kwlist,
 				   parse_array, &data,
 				   &dmin, &dmax,
 				   parse_colormap, &cmap,
 				   &i_extend_left,
 				   &i_extend_right,
-				   &py_colors))
+				   &py_colors, &threads))
     return NULL;
 
   int d = data.dimension();
@@ -470,8 +570,10 @@ data_to_colors(PyObject *, PyObject *args, PyObject *keywds)
 
   bool extend_left = (i_extend_left != 0), extend_right = (i_extend_right != 0);
 
+  Py_BEGIN_ALLOW_THREADS
   call_template_function(data_to_colors, data.value_type(),
-			 (data, dmin, dmax, cmap, extend_left, extend_right, colors));
+			 (data, dmin, dmax, cmap, extend_left, extend_right, colors, threads));
+  Py_END_ALLOW_THREADS
 
   return python_none();
 }
@@ -519,6 +621,7 @@ colors_float_to_uint(PyObject *, PyObject *args, PyObject *keywds)
 
   float *f = colors_float.values();
   int64_t n = colors_float.size();
+  Py_BEGIN_ALLOW_THREADS
   if (t == colors_uint.Unsigned_Char)
     {
       unsigned char *i8 = (unsigned char *)colors_uint.values();
@@ -541,6 +644,7 @@ colors_float_to_uint(PyObject *, PyObject *args, PyObject *keywds)
 	  i16[k] = (unsigned short)(65535*c);
 	}
     }
+  Py_END_ALLOW_THREADS
 
   return python_none();
 }
@@ -659,17 +763,21 @@ indices_to_colors(PyObject *, PyObject *args, PyObject *keywds)
   Index_Array ci = indices.contiguous_array();
   int64_t n = ci.size(), nc = cmap.size(1)*cmap.element_size();
   Index_Array::Value_Type it = indices.value_type();
+  if (it != ci.Unsigned_Char && it != ci.Signed_Char && it != ci.Char &&
+      it != ci.Unsigned_Short_Int && it != ci.Short_Int &&
+      it != ci.Unsigned_Int && it != ci.Int)
+    {
+      PyErr_SetString(PyExc_TypeError, "Index array type is not 8, 16, or 32-bit integers");
+      return NULL;
+    }
+  Py_BEGIN_ALLOW_THREADS
   if (it == ci.Unsigned_Char || it == ci.Signed_Char || it == ci.Char)
     index_colors((unsigned char *)ci.values(), n, cmapv, nc, ca, modulate);
   else if (it == ci.Unsigned_Short_Int || it == ci.Short_Int)
     index_colors((unsigned short *)ci.values(), n, cmapv, nc, ca, modulate);
-  else if (it == ci.Unsigned_Int || it == ci.Int)
-    index_colors((unsigned int *)ci.values(), n, cmapv, nc, ca, modulate);
   else
-    {
-      PyErr_SetString(PyExc_TypeError, "Index array type is not 8, 16, or 32-bit integers");
-      return NULL;
-    }
+    index_colors((unsigned int *)ci.values(), n, cmapv, nc, ca, modulate);
+  Py_END_ALLOW_THREADS
 
   return python_none();
 }
@@ -717,38 +825,40 @@ void data_to_index(const Reference_Counted_Array::Array<T> &data,
   float br = bins / range;
   I bmax = (I) (bins-1);
 
-  Reference_Counted_Array::Array<T> cdata = data.contiguous_array();
-
-  int64_t n = cdata.size();
-  T *d = cdata.values();
-  I b;
-  if (bin_step == 1 && !add)	// Optimize most common case.
-    for (int64_t k = 0 ; k < n ; ++k)
-      {
-	float v = d[k] - bcf;
-	if (v < 0) b = 0;
-	else
+  int64_t n = data.size();
+  const T *d = data.values();
+  data.element_runs(0, n, [&](int64_t r0, int64_t r1, int64_t offset, int64_t step)
+    {
+      const T *dr = d + offset - r0*step;
+      I b;
+      if (bin_step == 1 && !add)	// Optimize most common case.
+	for (int64_t k = r0 ; k < r1 ; ++k)
 	  {
-	    b = (I) (br * v);
-	    if (b > bmax) b = bmax;
+	    float v = dr[k*step] - bcf;
+	    if (v < 0) b = 0;
+	    else
+	      {
+		b = (I) (br * v);
+		if (b > bmax) b = bmax;
+	      }
+	    indices[k] = b;
 	  }
-	indices[k] = b;
-      }
-  else
-    for (int64_t k = 0 ; k < n ; ++k)
-      {
-	float v = d[k] - bcf;
-	if (v < 0) b = 0;
-	else
+      else
+	for (int64_t k = r0 ; k < r1 ; ++k)
 	  {
-	    b = (I) (br * v);
-	    if (b > bmax) b = bmax;
+	    float v = dr[k*step] - bcf;
+	    if (v < 0) b = 0;
+	    else
+	      {
+		b = (I) (br * v);
+		if (b > bmax) b = bmax;
+	      }
+	    if (add)
+	      indices[k] += (I) (b * bin_step);
+	    else
+	      indices[k] = (I) (b * bin_step);
 	  }
-	if (add)
-	  indices[k] += (I) (b * bin_step);
-	else
-	  indices[k] = (I) (b * bin_step);
-      }
+    });
 }
 
 }
@@ -817,8 +927,10 @@ data_to_bin_index(PyObject *, PyObject *args, PyObject *keywds)
       return NULL;
     }
 
+  Py_BEGIN_ALLOW_THREADS
   call_template_function(data_to_bin_index, data.value_type(),
 			 (data, bcf, bcl, bins, bin_step, index_values, add));
+  Py_END_ALLOW_THREADS
 
   return python_none();
 }
@@ -42,11 +42,13 @@ from .volume import VolumeSurface, VolumeImage
 # Make sure _map can runtime link shared library libarrays.
 import chimerax.arrays
 
-from ._map import contour_surface, sphere_surface_distance
+from ._map import contour_surface, contour_surfaces, contour_surface_update
+from ._map import sphere_surface_distance, ses_surface, ses_surface_update
 from ._map import interpolate_colormap, set_outside_volume_colors
 from ._map import extend_crystal_map
 from ._map import moments, affine_scale
 from ._map import local_correlation
+from ._map import gaussian_filter_array, median_filter_array
 from ._map import linear_combination
 from ._map import covariance_sum
 from ._map import offset_range, box_cuts
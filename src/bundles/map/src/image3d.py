@@ -244,8 +244,11 @@ class Image3d(Model):
     return self._rendering_options.blend_on_gpu
 
   # ---------------------------------------------------------------------------
+  # If a colors array is given the plane colors are written into it.  It must
+  # be contiguous with the plane size and color type.
   #
-  def _color_plane(self, plane, axis, color_3d=False, require_color=False):
+  def _color_plane(self, plane, axis, color_3d=False, require_color=False,
+                   colors=None):
 
     m = self._matrix_plane(plane, axis)
     if self._rendering_options.colormap_on_gpu and not require_color:
@@ -253,17 +256,20 @@ class Image3d(Model):
 
     if self.segment_colors is not None:
       cmap = self.segment_colors
-      colors = self._color_array(cmap.dtype, tuple(m.shape) + (cmap.shape[1],))
+      if colors is None:
+        colors = self._color_array(cmap.dtype, tuple(m.shape) + (cmap.shape[1],))
       from ._map import indices_to_colors
       indices_to_colors(m, cmap, colors)
     else:
       cmap, cmap_range = self._color_table() if color_3d else self._color_table(axis)
       dmin, dmax = cmap_range
 
-      colors = self._color_array(cmap.dtype, tuple(m.shape) + (cmap.shape[1],))
+      if colors is None:
+        colors = self._color_array(cmap.dtype, tuple(m.shape) + (cmap.shape[1],))
       cm = self._colormap
       from . import _map
-      _map.data_to_colors(m, dmin, dmax, cmap, cm.extend_left, cm.extend_right, colors)
+      _map.data_to_colors(m, dmin, dmax, cmap, cm.extend_left, cm.extend_right, colors,
+                          threads = _color_threads())
     
     if self.mask_colors is not None:
       region = self._plane_region(plane, axis)
@@ -1259,8 +1265,8 @@ class Texture3dPlanes(PlanesDrawing):
 
     # Triangulate planes intersecting with volume box
     from . import box_cuts
-    va, ta = box_cuts(self._corners, axis, start, spacing, count)
-    tc = self._vertex_to_texcoord * va
+    va, ta, tc = box_cuts(self._corners, axis, start, spacing, count,
+                          texture_transform = self._vertex_to_texcoord.matrix)
     
     return va, tc, ta
 
@@ -1296,8 +1302,13 @@ class Texture3dPlanes(PlanesDrawing):
     from numpy import empty
     td = empty((sz,) + tuple(p.shape), p.dtype)
     td[0,:] = p
+    # Color planes directly into the 3d texture array to avoid copying.
+    direct = not ir._use_gpu_colormap and not isinstance(ir, BlendedImage)
     for i in range(1,sz):
-      td[i,:] = ir._color_plane(k0+i*kstep, z_axis, color_3d=True)
+      if direct:
+        ir._color_plane(k0+i*kstep, z_axis, color_3d=True, colors=td[i])
+      else:
+        td[i,:] = ir._color_plane(k0+i*kstep, z_axis, color_3d=True)
     return td
 
   def _fill_texture_blend(self, texture):
@@ -1606,6 +1617,14 @@ def _luminance_transfer_function(tf):
 
   return ltf, lcolor
 
+# -----------------------------------------------------------------------------
+# Threads used by C++ routines that color image planes.
+#
+def _color_threads():
+  import os
+  cpu_count = os.cpu_count()
+  return 1 if cpu_count is None else cpu_count
+
 # -----------------------------------------------------------------------------
 #
 def _colinear(vlist, tolerance = 0.99):
@@ -37,6 +37,72 @@ def volume_center_of_mass(v, level = None, step = None, subregion = None):
     return center
 
 
+# -----------------------------------------------------------------------------
+# Accumulate second, first and zeroth moments of map values over array
+# index positions from sub-blocks of a map so that maps larger than memory
+# can be measured.  Blocks can be added from several threads at once.
+# Index origins are in numpy array order (k,j,i).
+#
+class BlockMoments:
+
+    def __init__(self):
+        from numpy import zeros, float64
+        self._m2 = zeros((3,3), float64)
+        self._m1 = zeros((3,), float64)
+        self._m0 = 0.0
+        from threading import Lock
+        self._lock = Lock()
+
+    def add_block(self, array, origin = (0,0,0), threads = 1):
+        from ._map import moments
+        m2, m1, m0 = moments(array, origin = origin, threads = threads)
+        with self._lock:
+            self._m2 += m2
+            self._m1 += m1
+            self._m0 += m0
+
+    # Return accumulated moments m2 (3x3), m1 (3), m0 same as _map.moments().
+    def moments(self):
+        with self._lock:
+            return self._m2.copy(), self._m1.copy(), self._m0
+
+# -----------------------------------------------------------------------------
+# Compute moments of a map reading blocks one at a time so the full map
+# need not fit in memory.  Blocks are read in order, since file readers
+# are not thread safe, and summed in parallel threads while the next blocks
+# are read.  Moments are in step grid array indices.
+#
+def volume_moments(v, block_size = 256, step = 1, threads = None):
+
+    if threads is None:
+        import os
+        threads = os.cpu_count() or 1
+    # Block origins must be multiples of step to stay on the step grid.
+    bs = max(step, (block_size // step) * step)
+    d = v.data
+    isz, jsz, ksz = d.size
+    bm = BlockMoments()
+    from concurrent.futures import ThreadPoolExecutor, wait, FIRST_COMPLETED
+    with ThreadPoolExecutor(max_workers = threads) as e:
+        pending = set()
+        for k in range(0, ksz, bs):
+            for j in range(0, jsz, bs):
+                for i in range(0, isz, bs):
+                    ijk = (i,j,k)
+                    size = tuple(min(bs, s-o) for s, o in zip(d.size, ijk))
+                    m = d.matrix(ijk_origin = ijk, ijk_size = size,
+                                 ijk_step = (step,step,step))
+                    if len(pending) >= threads:
+                        # Limit memory use to a few blocks.
+                        done, pending = wait(pending, return_when = FIRST_COMPLETED)
+                        for f in done:
+                            f.result()
+                    pending.add(e.submit(bm.add_block, m,
+                                         (k//step, j//step, i//step)))
+        for f in pending:
+            f.result()
+    return bm.moments()
+
 # -----------------------------------------------------------------------------
 # Compute center of mass of a map for the region above a specifie contour level.
 #
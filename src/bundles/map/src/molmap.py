@@ -156,9 +156,10 @@ def make_molecule_map(atoms, resolution, step, pad, on_grid, cutoff_range,
                       display_threshold, model_id,
                       replace, show_dialog, name, session, open_model = True):
 
+    progress = _status_progress(session, len(atoms) * (1 if transforms is None else len(transforms)))
     grid = molecule_grid_data(atoms, resolution, step, pad, on_grid,
                               cutoff_range, sigma_factor, balls,
-                              transforms, name)
+                              transforms, name, progress)
 
     if replace:
         from .volume import volume_list
@@ -186,7 +187,7 @@ def make_molecule_map(atoms, resolution, step, pad, on_grid, cutoff_range,
 #
 def molecule_grid_data(atoms, resolution, step, pad, on_grid,
                        cutoff_range, sigma_factor, balls = False,
-                       transforms = None, name = 'molmap'):
+                       transforms = None, name = 'molmap', progress = None):
 
     if len(atoms.unique_structures) == 1 and not on_grid:
         xyz = atoms.coords
@@ -213,10 +214,12 @@ def molecule_grid_data(atoms, resolution, step, pad, on_grid,
     sdev = resolution * sigma_factor
     if balls:
         radii = atoms.radii
-        add_balls(grid, xyz, radii, sdev, cutoff_range, transforms)
+        add_balls(grid, xyz, radii, sdev, cutoff_range, transforms,
+                  progress = progress)
     else:
         weights = atoms.element_numbers
-        add_gaussians(grid, xyz, weights, sdev, cutoff_range, transforms)
+        add_gaussians(grid, xyz, weights, sdev, cutoff_range, transforms,
+                      progress = progress)
 
     return grid
 
@@ -238,7 +241,7 @@ def bounding_grid(xyz, step, pad, transforms = None):
 # -----------------------------------------------------------------------------
 #
 def add_gaussians(grid, xyz, weights, sdev, cutoff_range, transforms = None,
-                  normalize = True):
+                  normalize = True, progress = None):
 
     from numpy import zeros, float32, empty
     sdevs = zeros((len(xyz),3), float32)
@@ -251,10 +254,12 @@ def add_gaussians(grid, xyz, weights, sdev, cutoff_range, transforms = None,
     from ._map import sum_of_gaussians
     ijk = empty(xyz.shape, float32)
     matrix = grid.matrix()
-    for tf in transforms:
+    threads = _thread_count()
+    for t, tf in enumerate(transforms):
         ijk[:] = xyz
         (grid.xyz_to_ijk_transform * tf).transform_points(ijk, in_place = True)
-        sum_of_gaussians(ijk, weights, sdevs, cutoff_range, matrix)
+        sum_of_gaussians(ijk, weights, sdevs, cutoff_range, matrix, threads = threads,
+                         progress = _transform_progress(progress, t, len(transforms)))
 
     if normalize:
         from math import pow, pi
@@ -263,7 +268,8 @@ def add_gaussians(grid, xyz, weights, sdev, cutoff_range, transforms = None,
 
 # -----------------------------------------------------------------------------
 #
-def add_balls(grid, xyz, radii, sdev, cutoff_range, transforms = None):
+def add_balls(grid, xyz, radii, sdev, cutoff_range, transforms = None,
+              progress = None):
 
     if transforms is None or len(transforms) == 0:
         from chimerax.geometry import Places
@@ -273,7 +279,36 @@ def add_balls(grid, xyz, radii, sdev, cutoff_range, transforms = None):
     r = (radii - sdev) / grid.step[0]
     matrix = grid.matrix()
     from ._map import sum_of_balls
-    for tf in transforms:
+    threads = _thread_count()
+    for t, tf in enumerate(transforms):
         ijk[:] = xyz
         (grid.xyz_to_ijk_transform * tf).transform_points(ijk, in_place = True)
-        sum_of_balls(ijk, r, sdev, cutoff_range, matrix)
+        sum_of_balls(ijk, r, sdev, cutoff_range, matrix, threads = threads,
+                     progress = _transform_progress(progress, t, len(transforms)))
+
+# -----------------------------------------------------------------------------
+#
+def _thread_count():
+    import os
+    cpu_count = os.cpu_count()
+    return 1 if cpu_count is None else cpu_count
+
+# -----------------------------------------------------------------------------
+# Report percent of atoms added to the map on the status line for large maps.
+#
+def _status_progress(session, atom_count, min_atoms = 1000000):
+    if atom_count < min_atoms:
+        return None
+    def report_progress(fraction, log = session.logger):
+        log.status('Computing molmap, %.0f%% done' % (100*fraction))
+    return report_progress
+
+# -----------------------------------------------------------------------------
+# Progress for one symmetry copy reported as fraction of all copies.
+#
+def _transform_progress(progress, t, n):
+    if progress is None:
+        return None
+    def report_progress(fraction):
+        progress((t + fraction) / n)
+    return report_progress
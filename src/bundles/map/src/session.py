@@ -318,27 +318,20 @@ def state_from_grid_data(data, session_path = None, include_maps = False):
   if not dt.path or include_maps:
     s['size'] = dt.size
     s['value_type'] = str(dt.value_type)
-    compress_maps = False  # No advantage since session is compressed.  Ticket #4002
-    bytes = dt.matrix().tobytes()
+    # The array is written from the matrix buffer without copying it.
+    from numpy import ascontiguousarray
+    m = ascontiguousarray(dt.matrix())
+    buf = memoryview(m.reshape(-1)).cast('B')
 
-    MAX_MSGPACK_OBJECT_SIZE = 2**32-1
-    if len(bytes) > MAX_MSGPACK_OBJECT_SIZE:
-      from chimerax.core.errors import UserError
-      raise UserError('ChimeraX session files cannot include maps over 4 Gbytes in size.\n\n' +
-                      'You tried to save map "%s"' % dt.name +
-                      ', size %d,%d,%d' % tuple(dt.size) +
-                      ', type %s.  ' % str(dt.value_type) +
-                      'Instead save the map in a map file (e.g. *.mrc, *.cmap) ' +
-                      'then save the session file and it will reference the ' +
-                      'map file instead of including the map data in the session file.')
-      
-    if compress_maps:
-      from gzip import compress
-      s['array_compression'] = 'gzip'
-      s['array'] = compress(bytes)
-    else:
+    if session_map_compression is None and len(buf) <= MAX_MSGPACK_OBJECT_SIZE:
+      # Readable by ChimeraX versions before array chunks were supported.
       s['array_compression'] = 'none'
-      s['array'] = bytes
+      s['array'] = buf
+    else:
+      s['version'] = 2
+      s['array_compression'] = session_map_compression or 'none'
+      s['array_chunk_size'] = SESSION_MAP_CHUNK_SIZE
+      s['array_chunks'] = _array_chunks(buf, session_map_compression)
     save_position = True
   else:
     save_position = False
@@ -373,11 +366,83 @@ def state_from_grid_data(data, session_path = None, include_maps = False):
 
   return s
 
+# ---------------------------------------------------------------------------
+# Maps included in sessions are not compressed by default since the session
+# file is compressed.  Ticket #4002.  Can be set to 'zstd' (needs the
+# imagecodecs package) or 'gzip' to compress each chunk of the map array.
+#
+session_map_compression = None
+MAX_MSGPACK_OBJECT_SIZE = 2**32-1
+SESSION_MAP_CHUNK_SIZE = 2**26		# Bytes
+
+# ---------------------------------------------------------------------------
+# Split array bytes into chunks that are under the msgpack object size limit
+# so maps over 4 Gbytes can be saved.  Uncompressed chunks are views of the
+# buffer.  Compressed chunks are made in parallel threads, the compression code
+# releases the Python global interpreter lock.
+#
+def _array_chunks(buf, compression = None, chunk_size = SESSION_MAP_CHUNK_SIZE):
+  chunks = [buf[i:i+chunk_size] for i in range(0, len(buf), chunk_size)]
+  if compression is None:
+    return chunks
+  compress = _chunk_codec(compression, encode = True)
+  return _map_threaded(compress, chunks)
+
+# ---------------------------------------------------------------------------
+# Decompress chunks directly into the restored array in parallel threads so
+# only one copy of the map is made.
+#
+def _array_from_chunks(chunks, compression, shape, value_type, chunk_size):
+  from numpy import empty, dtype, frombuffer, uint8
+  a = empty(shape, dtype(value_type))
+  abytes = a.reshape(-1).view(uint8)
+  decompress = None if compression == 'none' else _chunk_codec(compression, encode = False)
+  def copy_chunk(offset_chunk):
+    offset, chunk = offset_chunk
+    b = frombuffer(chunk if decompress is None else decompress(chunk), uint8)
+    abytes[offset:offset+len(b)] = b
+  offsets = range(0, len(abytes), chunk_size)
+  _map_threaded(copy_chunk, list(zip(offsets, chunks)))
+  return a
+
+# ---------------------------------------------------------------------------
+#
+def _chunk_codec(compression, encode):
+  if compression == 'gzip':
+    import zlib
+    return (lambda data: zlib.compress(data, 1)) if encode else zlib.decompress
+  elif compression == 'zstd':
+    try:
+      import imagecodecs
+    except ImportError:
+      from chimerax.core.errors import UserError
+      raise UserError('Map zstd compression in sessions requires the imagecodecs package')
+    return imagecodecs.zstd_encode if encode else imagecodecs.zstd_decode
+  raise ValueError('Unknown session map compression "%s"' % compression)
+
+# ---------------------------------------------------------------------------
+#
+def _map_threaded(func, items, threads = None):
+  if threads is None:
+    import os
+    threads = os.cpu_count() or 1
+  threads = min(threads, len(items))
+  if threads <= 1:
+    return [func(item) for item in items]
+  from concurrent.futures import ThreadPoolExecutor
+  with ThreadPoolExecutor(max_workers = threads) as e:
+    return list(e.map(func, items))
+
 # ---------------------------------------------------------------------------
 #
 def grid_data_from_state(s, gdcache, session, file_paths):
 
-  if 'array' in s:
+  if 'array_chunks' in s:
+    array = _array_from_chunks(s['array_chunks'], s['array_compression'],
+                               s['size'][::-1], s['value_type'], s['array_chunk_size'])
+    from chimerax.map_data import ArrayGridData
+    dlist = [ArrayGridData(array)]
+  elif 'array' in s:
     compression = s.get('array_compression')
     if compression == 'none':
       bytes = s['array']
@@ -73,7 +73,9 @@ class Volume(Model):
     self.message_cb = session.logger.status
 
     self.matrix_stats = None
+    self._matrix_stats_cache = {}	# Statistics for recently displayed regions.
     self._matrix_id = 1          # Incremented when shape or values change.
+    self._contour_block_bounds = None	# Block value ranges to speed up contouring.
 
     rlist = Region_List()
     ijk_min, ijk_max = self.region[:2]
@@ -560,6 +562,7 @@ class Volume(Model):
   def matrix_changed(self):
 
     self.matrix_stats = None
+    self._contour_block_bounds = None
     self._matrix_id += 1
     self._drawings_need_update()
 
@@ -1259,6 +1262,18 @@ class Volume(Model):
     m = self.matrix(read_matrix, step, full_region(self.data.size)[:2])
     return m
 
+  # ---------------------------------------------------------------------------
+  #
+  def memory_usage(self):
+    '''
+    Return a dictionary of approximate bytes used by this map, keyed by
+    category.  "map data" is the in-memory or cached matrices of the map's
+    data, including subsampled and subregion copies, which are shared by
+    maps using the same data.  Contour surfaces are VolumeSurface models
+    holding their own graphics arrays.
+    '''
+    return {'map data': self.data.memory_usage()}
+
   # ---------------------------------------------------------------------------
   # Region includes ijk_min and ijk_max points.
   #
@@ -1398,6 +1413,7 @@ class Volume(Model):
 
     if type == 'values changed':
       self.data.clear_cache()
+      self._matrix_stats_cache.clear()
       self.matrix_changed()
       if self._image:
         self._image.map_values_changed()
@@ -1523,6 +1539,15 @@ class Volume(Model):
       log = self.session.logger
       log.info('Minimum RMS scale factor for "%s" above level %.5g is %.5g\n'
                % (v.name_with_id(), level, scale))
+    if (operation in ('add', 'subtract') and m.flags.c_contiguous
+        and values.flags.c_contiguous):
+      # Scale and add in place with threads, without temporary arrays.
+      f = scale if operation == 'add' else -scale
+      from ._map import linear_combination
+      import os
+      linear_combination(1, m, f, values, m, threads = os.cpu_count() or 1)
+      d.values_changed()
+      return
     if scale != 1:
       if const_values:
         # Copy array only if scaling and the values come from another map
@@ -1564,25 +1589,16 @@ class Volume(Model):
         # Load just the small subregion of self that covers the grid in case
         # the vgrid is small and map self is huge (e.g. does not fit in memory).
         subregion = self._covering_subregion(vgrid)
-      size_limit = 2 ** 22          # 4 Mvoxels
       isize, jsize, ksize = vgrid.matrix_size(step = 1, subregion = 'all')
-      shape = (ksize, jsize, isize)
-      if isize*jsize*ksize > size_limit:
-        # Calculate plane by plane to save memory with grid point array
-        from numpy import empty, single as floatc
-        values = empty(shape, floatc)
-        for z in range(ksize):
-          points = vgrid.grid_points(self.model_transform().inverse(), z)
-          values1d = self.interpolated_values(points, None,
-                                              subregion = subregion,
-                                              step = step)
-          values[z,:,:] = values1d.reshape((jsize, isize))
-      else:
-        points = vgrid.grid_points(self.model_transform().inverse())
-        values1d = self.interpolated_values(points, None,
-                                            subregion = subregion,
-                                            step = step)
-        values = values1d.reshape(shape)
+      from numpy import empty, single as floatc
+      values = empty((ksize, jsize, isize), floatc)
+      # Grid points are computed in C++ as they are interpolated, so no
+      # array of grid point coordinates is made.
+      matrix, s2m_transform = self.matrix_and_transform(None, subregion, step)
+      g2s_transform = (self.model_transform().inverse() * vgrid.model_transform()
+                       * vgrid.data.ijk_to_xyz_transform)
+      from chimerax.map_data import interpolate_volume_on_grid
+      interpolate_volume_on_grid(s2m_transform * g2s_transform, matrix, values)
 
     return values, same
 
@@ -1723,6 +1739,27 @@ class Volume(Model):
     mv.copy_settings_from(self, copy_region = False, copy_zone = False)
     return mv
 
+  # ---------------------------------------------------------------------------
+  # Minimum and maximum values for blocks of grid points used to skip regions
+  # that cannot contain the contour surface.  Cached until the matrix changes
+  # so contouring at new thresholds does not recompute it.
+  #
+  def contour_block_bounds(self, matrix, block_size = 8):
+
+    shape = tuple((s + block_size - 1) // block_size for s in matrix.shape) + (2,)
+    cbb = self._contour_block_bounds
+    if cbb is not None:
+      matrix_id, bounds = cbb
+      if matrix_id == self._matrix_id and bounds.shape == shape and bounds.dtype == matrix.dtype:
+        return bounds
+
+    from numpy import empty
+    bounds = empty(shape, matrix.dtype)
+    from ._map import contour_block_bounds
+    contour_block_bounds(matrix, bounds, block_size)
+    self._contour_block_bounds = (self._matrix_id, bounds)
+    return bounds
+
   # ---------------------------------------------------------------------------
   #
   def matrix_value_statistics(self, read_matrix = True):
@@ -1731,6 +1768,13 @@ class Volume(Model):
     if ms:
       return ms
 
+    # Reuse statistics if the same region was shown before with the data unchanged.
+    key = self._matrix_stats_key()
+    ms = self._matrix_stats_cache.get(key)
+    if ms:
+      self.matrix_stats = ms
+      return ms
+
     matrices = self.displayed_matrices(read_matrix)
     if len(matrices) == 0:
       return None
@@ -1745,8 +1789,26 @@ class Volume(Model):
     if nvox >= min_status_message_voxels:
       self.message('')
 
+    cache = self._matrix_stats_cache
+    if len(cache) >= 8:
+      del cache[next(iter(cache))]	# Remove oldest
+    cache[key] = ms
+
     return ms
 
+  # ---------------------------------------------------------------------------
+  # Parameters that determine which matrices displayed_matrices() returns.
+  #
+  def _matrix_stats_key(self):
+    ijk_min, ijk_max, ijk_step = self.region
+    key = (tuple(ijk_min), tuple(ijk_max), tuple(ijk_step), self.image_shown)
+    if self.image_shown:
+      ro = self.rendering_options
+      key += (ro.image_mode,)
+      if ro.image_mode == 'orthoplanes':
+        key += (tuple(ro.orthoplanes_shown), tuple(self.matrix_index(ro.orthoplane_positions)))
+    return key
+
   # ---------------------------------------------------------------------------
   #
   def displayed_matrices(self, read_matrix = True):
@@ -2017,6 +2079,7 @@ class VolumeSurface(Surface):
     self._min_status_message_voxels = 2**24	# Show status messages only on big surface calculations
     self._use_thread = False			# Whether to compute next surface in thread
     self._surf_calc_thread = None
+    self._prefetched_geometry = None		# Surface computed before it is shown
     self.clip_cap = True			# Cap surface when clipped
 
   def delete(self):
@@ -2107,6 +2170,9 @@ class VolumeSurface(Surface):
       self._set_appearance(rendering_options, clear_vertex_colors = False)
       return
 
+    if self._use_prefetched_geometry(rendering_options):
+      return
+
     v = self.volume
     matrix = v.matrix()
     level = self.level
@@ -2192,6 +2258,36 @@ class VolumeSurface(Surface):
       v.message('Calculated %s surface, level %.3g, with %d triangles'
                    % (v.data.name, level, len(ta)), blank_after = 3.0)
 
+  # ---------------------------------------------------------------------------
+  # Compute the surface for the given matrix ahead of display, for instance
+  # in a thread while another map of a series is shown.  The contour settings
+  # are from contour_settings() when the matrix was read.  The next surface
+  # update uses the result if the settings have not changed.  Returns bytes
+  # used by the surface arrays.
+  #
+  def prefetch_geometry(self, matrix, contour_settings, rendering_options):
+    geom = self._calculate_contour_surface(matrix, contour_settings['level'],
+                                           rendering_options)
+    self._prefetched_geometry = (contour_settings, geom)
+    return sum(a.nbytes for a in geom if a is not None)
+
+  # ---------------------------------------------------------------------------
+  #
+  def _use_prefetched_geometry(self, rendering_options):
+    pg = self._prefetched_geometry
+    if pg is None:
+      return False
+    self._prefetched_geometry = None
+    contour_settings, geom = pg
+    if contour_settings != self._contour_settings:
+      return False
+
+    # Don't use thread calculation started earlier.
+    self._surf_calc_thread = None
+    self._set_surface(*geom)
+    self._set_appearance(rendering_options)
+    return True
+
   # ---------------------------------------------------------------------------
   #
   def _calculate_contour_surface_threaded(self, matrix, level, rendering_options):
@@ -2208,29 +2304,49 @@ class VolumeSurface(Surface):
     if plane_axis:
       for a in plane_axis:
         matrix = matrix.repeat(2, axis = a)
+      block_bounds = None
+    else:
+      block_bounds = self.volume.contour_block_bounds(matrix)
+
+    # Square mesh edges can be found during contouring unless the
+    # triangles are later subdivided or flattened to a plane.
+    ro = rendering_options
+    edge_mask = ro.square_mesh and not ro.subdivide_surface and not plane_axis
 
     from ._map import contour_surface
-    varray, tarray, narray = contour_surface(matrix, level,
-                                             cap_faces = rendering_options.cap_faces,
-                                             calculate_normals = True)
+    geom = contour_surface(matrix, level,
+                           cap_faces = rendering_options.cap_faces,
+                           calculate_normals = True,
+                           block_bounds = block_bounds,
+                           edge_mask = edge_mask)
+    if edge_mask:
+      varray, tarray, narray, hidden_edges = geom
+    else:
+      varray, tarray, narray = geom
+      hidden_edges = None
 
     if plane_axis:
       for a in plane_axis:
         varray[:,2-a] = 0
 
     va, na, ta, hidden_edges = self._adjust_surface_geometry(varray, narray, tarray,
-                                                             rendering_options, level)
+                                                             rendering_options, level,
+                                                             hidden_edges)
 
     return va, na, ta, hidden_edges
 
   # ---------------------------------------------------------------------------
   #
-  def _adjust_surface_geometry(self, varray, narray, tarray, rendering_options, level):
+  def _adjust_surface_geometry(self, varray, narray, tarray, rendering_options, level,
+                               hidden_edges = None):
 
     ro = rendering_options
     if ro.flip_normals and level < 0:
       from chimerax.surface import invert_vertex_normals
       invert_vertex_normals(narray, tarray)
+      if hidden_edges is not None:
+        # Inversion swaps triangle edges 01 and 12, mask bits 1 and 2.
+        hidden_edges[:] = (hidden_edges & 4) | ((hidden_edges & 1) << 1) | ((hidden_edges & 2) >> 1)
 
     # Preserve triangle vertex traversal direction about normal.
     v = self.volume
@@ -2238,25 +2354,29 @@ class VolumeSurface(Surface):
     if transform.determinant() < 0:
       from ._map import reverse_triangle_vertex_order
       reverse_triangle_vertex_order(tarray)
+      if hidden_edges is not None:
+        # Reversal swaps triangle edges 01 and 20, mask bits 1 and 4.
+        hidden_edges[:] = (hidden_edges & 2) | ((hidden_edges & 1) << 2) | ((hidden_edges & 4) >> 2)
 
     if ro.subdivide_surface:
       from chimerax.surface import subdivide_triangles
       for i in range(ro.subdivision_levels):
         varray, tarray, narray = subdivide_triangles(varray, tarray, narray)
 
-    if ro.square_mesh:
+    if not ro.square_mesh:
+      hidden_edges = None
+    elif hidden_edges is None or ro.subdivide_surface:
       from numpy import empty, uint8
       hidden_edges = empty((len(tarray),), uint8)
       from . import _map
       _map.principle_plane_edges(varray, tarray, hidden_edges)
-    else:
-      hidden_edges = None
 
     if ro.surface_smoothing:
       sf, si = ro.smoothing_factor, ro.smoothing_iterations
-      from chimerax.surface import smooth_vertex_positions
-      smooth_vertex_positions(varray, tarray, sf, si)
-      smooth_vertex_positions(narray, tarray, sf, si)
+      from chimerax.surface import smooth_vertex_positions, vertex_adjacency
+      adj = vertex_adjacency(tarray, len(varray))
+      smooth_vertex_positions(varray, tarray, sf, si, adjacency = adj)
+      smooth_vertex_positions(narray, tarray, sf, si, adjacency = adj)
 
     # Transform vertices and normals from index coordinates to model coordinates
     transform.transform_points(varray, in_place = True)
@@ -2309,6 +2429,16 @@ class VolumeSurface(Surface):
   # ---------------------------------------------------------------------------
   #
   def _geometry_changed(self, rendering_options):
+    contour_settings = self.contour_settings(rendering_options)
+    changed = (self._contour_settings != contour_settings)
+    if changed:
+      self._contour_settings = contour_settings
+    return changed
+
+  # ---------------------------------------------------------------------------
+  # Settings that determine the surface geometry.
+  #
+  def contour_settings(self, rendering_options):
     v = self.volume
     ro = rendering_options
     contour_settings = {'level': self.level,
@@ -2323,10 +2453,7 @@ class VolumeSurface(Surface):
                         'cap_faces': ro.cap_faces,
                         'flip_normals': ro.flip_normals,
                         }
-    changed = (self._contour_settings != contour_settings)
-    if changed:
-      self._contour_settings = contour_settings
-    return changed
+    return contour_settings
 
   # State save/restore in ChimeraX
   def take_snapshot(self, session, flags):
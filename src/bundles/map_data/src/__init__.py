@@ -28,7 +28,9 @@
 
 from .griddata import GridData, GridSubregion
 from .arraygrid import ArrayGridData
+from .bricked import BrickedGridData, bricked_grid_data
 from .subsample import SubsampledGrid
+from .pyramid import multiresolution_grid
 from .fileformats import file_formats, MapFileFormat, electrostatics_types, FileFormatError
 from .fileformats import open_file, FileFormatError, UnknownFileType, save_grid_data
 from .progress import ProgressReporter
@@ -38,6 +40,8 @@ from .readarray import allocate_array
 # Routines to find tri-linear interpolated values of a 3d array.
 #
 from .arrays import interpolate_volume_data, interpolate_volume_gradient
+from .arrays import interpolate_volume_on_grid
+from .arrays import interpolate_fit_statistics
 
 from .arrays import MatrixValueStatistics, invert_matrix
 from .arrays import grid_indices, zone_masked_grid_data, zone_mask
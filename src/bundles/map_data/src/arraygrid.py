@@ -96,3 +96,9 @@ class ArrayGridData(GridData):
 
       m = self.matrix_slice(self.array, ijk_origin, ijk_size, ijk_step)
       return m
+
+  # ---------------------------------------------------------------------------
+  #
+  def memory_usage(self):
+
+    return self.array.nbytes
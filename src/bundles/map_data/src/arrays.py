@@ -31,9 +31,22 @@ def interpolate_volume_data(vertices, vertex_transform, array,
   kw = {} if values is None else {'values': values}
   from chimerax.map._map import interpolate_volume_data
   values, outside = interpolate_volume_data(vertices, vertex_transform.matrix,
-                                              array, method, **kw)
+                                              array, method, threads = _thread_count(), **kw)
   return values, outside
     
+# -----------------------------------------------------------------------------
+# Interpolate at every point of a grid, with grid_to_array_transform taking
+# grid indices to array indices, without making an array of the grid points.
+# Values is a 3-d float32 array with the grid size, and values outside the
+# array are set to zero.  Returns the number of grid points outside.
+#
+def interpolate_volume_on_grid(grid_to_array_transform, array, values,
+                               method = 'linear'):
+
+  from chimerax.map._map import interpolate_volume_on_grid
+  return interpolate_volume_on_grid(grid_to_array_transform.matrix, array, method,
+                                    values, threads = _thread_count())
+
 # -----------------------------------------------------------------------------
 # Method can be linear or nearest.
 #
@@ -43,11 +56,36 @@ def interpolate_volume_gradient(vertices, v2m_transform, array,
   kw = {} if gradients is None else {'gradients': gradients}
   from chimerax.map._map import interpolate_volume_gradient
   gradients, outside = interpolate_volume_gradient(vertices, v2m_transform.matrix,
-                                                   array, method, **kw)
+                                                   array, method, threads = _thread_count(), **kw)
   return gradients, outside
 
 # -----------------------------------------------------------------------------
-# Minimum, maximum, and sampled matrix values.
+# Average map value and number of points inside the map, and if weights
+# are given the overlap, correlation and correlation about mean, computed in
+# one pass.  If stop_metric is 'average map value' or 'correlation' then None
+# is returned as soon as that metric cannot exceed stop_below, assuming no map
+# value magnitude exceeds maximum_abs_value.
+#
+def interpolate_fit_statistics(vertices, vertex_transform, array, weights = None,
+                               method = 'linear', stop_metric = None,
+                               stop_below = 0, maximum_abs_value = 0):
+
+  from chimerax.map._map import interpolate_fit_statistics
+  return interpolate_fit_statistics(vertices, vertex_transform.matrix, array,
+                                    weights, method, stop_metric = stop_metric,
+                                    stop_below = stop_below,
+                                    maximum_abs_value = maximum_abs_value)
+
+# -----------------------------------------------------------------------------
+# Threads used by C++ routines.  Small point sets use only one thread.
+#
+def _thread_count():
+  import os
+  cpu_count = os.cpu_count()
+  return 1 if cpu_count is None else cpu_count
+
+# -----------------------------------------------------------------------------
+# Minimum, maximum, mean, RMS, and binned matrix values.
 #
 class MatrixValueStatistics:
 
@@ -55,21 +93,28 @@ class MatrixValueStatistics:
 
     matrices = matrix if isinstance(matrix, (list, tuple)) else [matrix]
 
-    # Determine minimum and maximum data values.
+    # Determine minimum, maximum, mean and rms data values in one pass.
     from chimerax.map import _map
-    if ignore_pad_value is None:
-      mm = [_map.minimum_and_maximum(m) for m in matrices]
-    else:
-      mm = [_map.minimum_and_maximum(m, ignore_pad_value=ignore_pad_value)
-            for m in matrices]
+    kw = {'threads': _thread_count()}
     if ignore_pad_value is not None:
-      for (mn,mx),m in zip(mm, matrices):
-        if mn > mx:
+      kw['ignore_pad_value'] = ignore_pad_value
+    stats = [_map.array_statistics(m, **kw) for m in matrices]
+    if ignore_pad_value is not None:
+      for (mn,mx,mean,rms,count),m in zip(stats, matrices):
+        if count == 0:
           raise ValueError(f'Computing histogram of matrix {m.shape} '
                            f'that contains only the pad value {ignore_pad_value}')
         
-    self.minimum = min(mn for mn,mx in mm)
-    self.maximum = max(mx for mn,mx in mm)
+    self.minimum = min(st[0] for st in stats)
+    self.maximum = max(st[1] for st in stats)
+    count = sum(st[4] for st in stats)
+    self.count = count
+    if count > 0:
+      self.mean = sum(st[2]*st[4] for st in stats) / count
+      from math import sqrt
+      self.rms = sqrt(sum(st[3]*st[3]*st[4] for st in stats) / count)
+    else:
+      self.mean = self.rms = 0
 
     # Determine center values for first and last bins, and bin size.
     fbc, lbc, bsize = self.bin_range(bins)
@@ -82,18 +127,21 @@ class MatrixValueStatistics:
     #  parsing does not support 64-bit int.
     from numpy import zeros, float64
     counts = zeros((bins,), float64)
-    if ignore_pad_value is None:
-      for m in matrices:
-        _map.bin_counts_float64(m, bins_start, bins_end, counts)
-    else:
-      for m in matrices:
-        _map.bin_counts_float64(m, bins_start, bins_end, counts,
-                                ignore_pad_value=ignore_pad_value)
+    for m in matrices:
+      _map.bin_counts_float64(m, bins_start, bins_end, counts, **kw)
     self.counts = counts
     self.bins = bins
     self.ccounts = None         # Cumulative counts
     self.cmass = None           # Cumulative mass
 
+  # ---------------------------------------------------------------------------
+  # Standard deviation from mean.
+  #
+  @property
+  def sd(self):
+    from math import sqrt
+    return sqrt(max(0, self.rms*self.rms - self.mean*self.mean))
+
   # ---------------------------------------------------------------------------
   # Return center positions of first and last bin, and bin size.
   #
@@ -0,0 +1,182 @@
+# vim: set expandtab shiftwidth=4 softtabstop=4:
+
+# === UCSF ChimeraX Copyright ===
+# Copyright 2022 Regents of the University of California. All rights reserved.
+# The ChimeraX application is provided pursuant to the ChimeraX license
+# agreement, which covers academic and commercial uses. For more details, see
+# <http://www.rbvi.ucsf.edu/chimerax/docs/licensing.html>
+#
+# This particular file is part of the ChimeraX library. You can also
+# redistribute and/or modify it under the terms of the GNU Lesser General
+# Public License version 2.1 as published by the Free Software Foundation.
+# For more details, see
+# <https://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>
+#
+# THIS SOFTWARE IS PROVIDED "AS IS" WITHOUT WARRANTY OF ANY KIND, EITHER
+# EXPRESSED OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+# OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. ADDITIONAL LIABILITY
+# LIMITATIONS ARE DESCRIBED IN THE GNU LESSER GENERAL PUBLIC LICENSE
+# VERSION 2.1
+#
+# This notice must be embedded in or attached to all copies, including partial
+# copies, of the software or any revisions or derivations thereof.
+# === UCSF ChimeraX Copyright ===
+
+# -----------------------------------------------------------------------------
+# BrickedGridData holds sparse volume data, such as masks and segmentations,
+# as cubic bricks keeping only bricks that contain a value different from
+# the background value.
+#
+from . import GridData
+
+# -----------------------------------------------------------------------------
+#
+class BrickedGridData(GridData):
+  '''
+  Supported API.  Sparse grid data stored as cubic bricks of size brick_size
+  along each axis.  Only bricks containing non-background values are kept
+  in memory.  Requested subregions are assembled from the stored bricks with
+  empty bricks filled with the background value.
+
+  Attributes
+  ----------
+  bricks : dict
+      Maps brick index (bi,bj,bk) in x,y,z order to a 3D numpy array
+      with indices in z,y,x order.  Edge bricks may be smaller than brick_size.
+  brick_size : int
+      Number of grid points along each axis of a brick.
+  background : number
+      Value of all grid points not in a stored brick.
+  '''
+
+  def __init__(self, size, value_type, bricks, brick_size = 32, background = 0,
+               origin = (0,0,0), step = (1,1,1),
+               cell_angles = (90,90,90),
+               rotation = ((1,0,0),(0,1,0),(0,0,1)),
+               symmetries = (), name = ''):
+
+      self.bricks = bricks
+      self.brick_size = brick_size
+      self.background = background
+
+      GridData.__init__(self, size, value_type,
+                        origin, step, cell_angles = cell_angles,
+                        rotation = rotation, symmetries = symmetries,
+                        name = name)
+
+      self.writable = False
+
+  # ---------------------------------------------------------------------------
+  #
+  def read_matrix(self, ijk_origin, ijk_size, ijk_step, progress):
+
+    from .readarray import allocate_array
+    m = allocate_array(ijk_size, self.value_type, ijk_step, progress)
+    m[:] = self.background
+
+    bs = self.brick_size
+    for bijk in self.brick_indices(ijk_origin, ijk_size):
+      b = self.bricks.get(bijk)
+      if b is None:
+        continue
+      # Copy grid points of this brick that lie on the subsampled region grid.
+      src = []
+      dest = []
+      for a in (2,1,0):
+        o, s, st = ijk_origin[a], ijk_size[a], ijk_step[a]
+        b0 = bijk[a]*bs
+        i0 = max(o, b0)
+        i0 += (o - i0) % st		# First point on step grid.
+        i1 = min(o+s, b0 + b.shape[2-a])
+        if i0 >= i1:
+          break
+        src.append(slice(i0-b0, i1-b0, st))
+        d0 = (i0-o)//st
+        dest.append(slice(d0, d0 + (i1-i0+st-1)//st))
+      else:
+        m[tuple(dest)] = b[tuple(src)]
+
+    return m
+
+  # ---------------------------------------------------------------------------
+  # Indices of stored bricks that intersect a grid region.
+  #
+  def brick_indices(self, ijk_origin = (0,0,0), ijk_size = None):
+
+    if ijk_size is None:
+      ijk_size = self.size
+    bs = self.brick_size
+    bmin = [o//bs for o in ijk_origin]
+    bmax = [(o+s-1)//bs for o,s in zip(ijk_origin, ijk_size)]
+    if len(self.bricks) < (bmax[0]-bmin[0]+1)*(bmax[1]-bmin[1]+1)*(bmax[2]-bmin[2]+1):
+      bijk = [b for b in self.bricks.keys()
+              if all(bmin[a] <= b[a] <= bmax[a] for a in (0,1,2))]
+    else:
+      bijk = [(bi,bj,bk) for bk in range(bmin[2], bmax[2]+1)
+              for bj in range(bmin[1], bmax[1]+1)
+              for bi in range(bmin[0], bmax[0]+1)
+              if (bi,bj,bk) in self.bricks]
+    return bijk
+
+  # ---------------------------------------------------------------------------
+  #
+  def stored_fraction(self):
+    '''Fraction of grid points held in stored bricks.'''
+    n = sum(b.size for b in self.bricks.values())
+    return n / self.voxel_count()
+
+  # ---------------------------------------------------------------------------
+  #
+  def value_statistics(self):
+    '''
+    Return minimum, maximum, mean, rms and count of all grid values
+    scanning only stored bricks.
+    '''
+    from chimerax.map._map import array_statistics
+    from .arrays import _thread_count
+    kw = {'threads': _thread_count()}
+    stats = [array_statistics(b, **kw) for b in self.bricks.values()]
+    count = self.voxel_count()
+    nbg = count - sum(c for mn,mx,mean,rms,c in stats)
+    bg = float(self.background)
+    if nbg > 0:
+      stats.append((bg, bg, bg, abs(bg), nbg))
+    if count == 0:
+      return (0, 0, 0, 0, 0)
+    vmin = min(s[0] for s in stats)
+    vmax = max(s[1] for s in stats)
+    mean = sum(s[2]*s[4] for s in stats) / count
+    from math import sqrt
+    rms = sqrt(sum(s[3]*s[3]*s[4] for s in stats) / count)
+    return (vmin, vmax, mean, rms, count)
+
+# -----------------------------------------------------------------------------
+# Create a BrickedGridData from another GridData reading slabs of brick_size
+# planes so that the full dense array is never held in memory.
+#
+def bricked_grid_data(grid_data, brick_size = 32, background = 0, progress = None):
+  '''
+  Supported API.  Copy grid data into bricked storage keeping only bricks
+  that contain values different from the background value.
+  '''
+  from chimerax.map._map import occupied_bricks
+  from .arrays import _thread_count
+  threads = _thread_count()
+  d = grid_data
+  isz, jsz, ksz = d.size
+  bs = brick_size
+  bricks = {}
+  for k0 in range(0, ksz, bs):
+    slab = d.matrix((0,0,k0), (isz,jsz,min(bs,ksz-k0)), progress = progress)
+    bk0 = k0//bs
+    for bi,bj,bk in occupied_bricks(slab, bs, background = background,
+                                    threads = threads):
+      i0, j0 = bi*bs, bj*bs
+      bricks[(int(bi),int(bj),int(bk)+bk0)] = slab[:,j0:j0+bs,i0:i0+bs].copy()
+
+  bg = BrickedGridData(d.size, d.value_type, bricks, brick_size, background,
+                       origin = d.origin, step = d.step,
+                       cell_angles = d.cell_angles, rotation = d.rotation,
+                       symmetries = d.symmetries, name = d.name)
+  bg.rgba = d.rgba
+  return bg
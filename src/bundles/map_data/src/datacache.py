@@ -24,7 +24,9 @@
 
 # -----------------------------------------------------------------------------
 # Maintain a cache of data objects using a limited amount of memory.
-# The least recently accessed data is released first.
+# The least recently accessed data is released first.  Data can be cached
+# and looked up from several threads, for instance when map series frames
+# are read ahead of display in a background thread.
 #
 
 # -----------------------------------------------------------------------------
@@ -38,82 +40,90 @@ class Data_Cache:
     self.time = 1
     self.data = {}
     self.groups = {}
+    from threading import RLock
+    self._lock = RLock()
 
   # ---------------------------------------------------------------------------
   #
   def cache_data(self, key, value, size, description, groups = []):
 
-    self.remove_key(key)
-    d = Cached_Data(key, value, size, description,
-                    self.time_stamp(), groups)
-    self.data[key] = d
+    with self._lock:
+      self.remove_key(key)
+      d = Cached_Data(key, value, size, description,
+                      self.time_stamp(), groups)
+      self.data[key] = d
 
-    for g in groups:
-      gtable = self.groups
-      if not g in gtable:
-        gtable[g] = []
-      gtable[g].append(d)
+      for g in groups:
+        gtable = self.groups
+        if not g in gtable:
+          gtable[g] = []
+        gtable[g].append(d)
 
-    self.used = self.used + size
-    self.reduce_use()
+      self.used = self.used + size
+      self.reduce_use()
 
   # ---------------------------------------------------------------------------
   #
   def lookup_data(self, key):
 
-    data = self.data
-    if key in data:
-      d = data[key]
-      d.last_access = self.time_stamp()
-      v = d.value
-    else:
-      v = None
-    self.reduce_use()
+    with self._lock:
+      data = self.data
+      if key in data:
+        d = data[key]
+        d.last_access = self.time_stamp()
+        v = d.value
+      else:
+        v = None
+      self.reduce_use()
     return v
 
   # ---------------------------------------------------------------------------
   #
   def remove_key(self, key):
 
-    data = self.data
-    if key in data:
-      self.remove_data(data[key])
-    self.reduce_use()
+    with self._lock:
+      data = self.data
+      if key in data:
+        self.remove_data(data[key])
+      self.reduce_use()
 
   # ---------------------------------------------------------------------------
   #
   def group_keys_and_data(self, group):
 
-    groups = self.groups
-    if not group in groups:
-      return []
+    with self._lock:
+      groups = self.groups
+      if not group in groups:
+        return []
 
-    kd = [(d.key, d.value) for d in groups[group]]
+      kd = [(d.key, d.value) for d in groups[group]]
     return kd
 
   # ---------------------------------------------------------------------------
   #
   def resize(self, size):
 
-    self.size = size
-    self.reduce_use()
+    with self._lock:
+      self.size = size
+      self.reduce_use()
 
   # ---------------------------------------------------------------------------
   #
   def reduce_use(self):
 
-    if self.used <= self.size:
-      return
-
-    data = self.data
-    dlist = list(data.values())
-    dlist.sort(key = lambda d: d.last_access)
-    import sys
-    for d in dlist:
-      if sys.getrefcount(d.value) == 2:
-        self.remove_data(d)
-        if self.used <= self.size:
-          break
+    with self._lock:
+      if self.used <= self.size:
+        return
+
+      data = self.data
+      dlist = list(data.values())
+      dlist.sort(key = lambda d: d.last_access)
+      import sys
+      for d in dlist:
+        if sys.getrefcount(d.value) == 2:
+          self.remove_data(d)
+          if self.used <= self.size:
+            break
 
   # ---------------------------------------------------------------------------
   #
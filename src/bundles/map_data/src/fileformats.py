@@ -90,6 +90,7 @@ file_formats = [
   MapFileFormat('SPIDER volume data', 'spider', ['spider'], ['spi','vol']),
   MapFileFormat('TOM toolbox EM density map', 'tom_em', ['tom_em'], ['em']),
   MapFileFormat('UHBD grid, binary', 'uhbd', ['uhbd'], ['grd']),
+  MapFileFormat('Zarr map', 'zarr', ['zarr'], ['zarr'], allow_directory = True),
   ]
   
 # -----------------------------------------------------------------------------
@@ -508,6 +508,17 @@ class GridData:
     for k,d in dcache.group_keys_and_data(self):
       dcache.remove_key(k)
 
+  # ---------------------------------------------------------------------------
+  # Bytes of this data's matrices held in memory, full and subsampled or
+  # subregion copies in the data cache.
+  #
+  def memory_usage(self):
+
+    dcache = self.data_cache
+    if dcache is None:
+      return 0
+    return sum(m.nbytes for k,m in dcache.group_keys_and_data(self))
+
   # ---------------------------------------------------------------------------
   #
   def add_change_callback(self, cb):
@@ -629,6 +640,12 @@ class GridSubregion(GridData):
 
     self.full_data.clear_cache()
 
+  # ---------------------------------------------------------------------------
+  #
+  def memory_usage(self):
+
+    return self.full_data.memory_usage()
+
 # -----------------------------------------------------------------------------
 #
 def norm(v):
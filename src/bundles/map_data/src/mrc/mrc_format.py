@@ -53,6 +53,7 @@ class MRC_Data:
     
     self.data_offset = file.tell()
     file.close()
+    self.memory_map = None      # numpy memmap created when first needed.
     
     # Axes permutation.
     # Names c,r,s refer to fast, medium, slow file matrix axes.
@@ -290,9 +291,37 @@ class MRC_Data:
                         progress)
     if not matrix is None:
       matrix = self.permute_matrix_to_xyz_axis_order(matrix)
-    
+
     return matrix
 
+  # ---------------------------------------------------------------------------
+  # Returns a strided view of a memory map of the file for a submatrix with
+  # zyx index order, or None if the file can't be memory mapped.
+  #
+  def memory_mapped_matrix(self, ijk_origin, ijk_size, ijk_step):
+
+    mm = self.memory_map
+    if mm is None:
+      from ..readarray import memory_mapped_array
+      mm = memory_mapped_array(self.path, self.data_offset, self.matrix_size,
+                               self.element_type, self.swap_bytes)
+      if mm is None:
+        return None
+      self.memory_map = mm
+
+    m = self.permute_matrix_to_xyz_axis_order(mm)
+    i1, j1, k1 = ijk_origin
+    i2, j2, k2 = [i+s for i,s in zip(ijk_origin, ijk_size)]
+    istep, jstep, kstep = ijk_step
+    return m[k1:k2:kstep, j1:j2:jstep, i1:i2:istep]
+
+  # ---------------------------------------------------------------------------
+  #
+  def set_element_type(self, element_type):
+
+    self.element_type = element_type
+    self.memory_map = None
+
   # ---------------------------------------------------------------------------
   #
   def permute_matrix_to_xyz_axis_order(self, matrix):
@@ -14,6 +14,12 @@
 #
 from .. import GridData
 
+# -----------------------------------------------------------------------------
+# Maps with at least this many bytes are memory mapped instead of read into
+# arrays so only the pages of the displayed subregion are read from the file.
+#
+MEMORY_MAP_MIN_BYTES = 2**30
+
 # -----------------------------------------------------------------------------
 #
 class MRCGrid(GridData):
@@ -42,11 +48,22 @@ class MRCGrid(GridData):
     syms = d.symmetry_matrices()
     if syms:
       self.symmetries = syms
+
+    from numpy import prod, dtype
+    nbytes = prod(d.matrix_size, dtype = float) * dtype(element_type).itemsize
+    self.memory_mapped = (d.element_type != float16 and
+                          nbytes >= MEMORY_MAP_MIN_BYTES)
   
   # ---------------------------------------------------------------------------
   #
   def read_matrix(self, ijk_origin, ijk_size, ijk_step, progress):
 
+    if self.memory_mapped:
+      m = self.mrc_data.memory_mapped_matrix(ijk_origin, ijk_size, ijk_step)
+      if m is not None:
+        return m
+      self.memory_mapped = False        # Byte swapped or unaligned data.
+
     m = self.mrc_data.read_matrix(ijk_origin, ijk_size, ijk_step, progress)
 
     from numpy import float16, float32
@@ -55,6 +72,15 @@ class MRCGrid(GridData):
 
     return m
 
+  # ---------------------------------------------------------------------------
+  # Memory mapped arrays use no memory beyond the operating system file cache
+  # so they are not added to the data cache, which would evict other data.
+  #
+  def cache_data(self, m, origin, size, step):
+
+    if not self.memory_mapped:
+      GridData.cache_data(self, m, origin, size, step)
+
   # ---------------------------------------------------------------------------
   # MRC format does not support unsigned 8-bit integers although it is
   # sometimes used for such data with data type incorrectly specified as
@@ -64,7 +90,7 @@ class MRCGrid(GridData):
 
     from numpy import int8, uint8, dtype
     if self.mrc_data.element_type == int8:
-      self.mrc_data.element_type = uint8
+      self.mrc_data.set_element_type(uint8)
       self.value_type = dtype(uint8)
       self.clear_cache()
       self.values_changed()
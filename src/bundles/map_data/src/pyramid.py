@@ -0,0 +1,147 @@
+# vim: set expandtab shiftwidth=4 softtabstop=4:
+
+# === UCSF ChimeraX Copyright ===
+# Copyright 2022 Regents of the University of California. All rights reserved.
+# The ChimeraX application is provided pursuant to the ChimeraX license
+# agreement, which covers academic and commercial uses. For more details, see
+# <http://www.rbvi.ucsf.edu/chimerax/docs/licensing.html>
+#
+# This particular file is part of the ChimeraX library. You can also
+# redistribute and/or modify it under the terms of the GNU Lesser General
+# Public License version 2.1 as published by the Free Software Foundation.
+# For more details, see
+# <https://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>
+#
+# THIS SOFTWARE IS PROVIDED "AS IS" WITHOUT WARRANTY OF ANY KIND, EITHER
+# EXPRESSED OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+# OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. ADDITIONAL LIABILITY
+# LIMITATIONS ARE DESCRIBED IN THE GNU LESSER GENERAL PUBLIC LICENSE
+# VERSION 2.1
+#
+# This notice must be embedded in or attached to all copies, including partial
+# copies, of the software or any revisions or derivations thereof.
+# === UCSF ChimeraX Copyright ===
+
+# -----------------------------------------------------------------------------
+# Create a multiresolution pyramid of 2x averaged copies of grid data to
+# allow fast display of large maps at coarse step sizes.  The levels are
+# added to a SubsampledGrid which picks the level matching the display step.
+#
+
+# -----------------------------------------------------------------------------
+#
+def multiresolution_grid(grid_data, min_size = 64, cache_path = None,
+                         slab_planes = 64, progress = None):
+  '''
+  Supported API.  Return a SubsampledGrid with 2x, 4x, 8x, ... averaged
+  copies of grid_data, the coarsest level having no axis larger than
+  min_size.  The full resolution data is read once in slabs of slab_planes
+  z planes.  If cache_path is given the levels are saved to that directory
+  and later calls memory map the saved levels instead of recomputing them.
+  '''
+  levels = None
+  if cache_path is not None:
+    levels = _read_level_cache(cache_path, grid_data, min_size)
+  if levels is None:
+    levels = _compute_levels(grid_data, min_size, slab_planes, progress)
+    if cache_path is not None:
+      _write_level_cache(cache_path, levels)
+
+  from .subsample import SubsampledGrid
+  sg = SubsampledGrid(grid_data)
+  g = grid_data
+  from .arraygrid import ArrayGridData
+  for cell_size, a in levels:
+    step = tuple(s*cell_size for s in g.step)
+    lg = ArrayGridData(a, g.origin, step, g.cell_angles, g.rotation,
+                       symmetries = g.symmetries, name = g.name)
+    lg.writable = False
+    sg.add_subsamples(lg, (cell_size, cell_size, cell_size))
+
+  return sg
+
+# -----------------------------------------------------------------------------
+#
+def _level_sizes(size, min_size):
+
+  sizes = []
+  cell_size = 1
+  while max(size) > min_size:
+    size = tuple((s+1)//2 for s in size)
+    cell_size *= 2
+    sizes.append((cell_size, size))
+  return sizes
+
+# -----------------------------------------------------------------------------
+#
+def _compute_levels(grid_data, min_size, slab_planes, progress):
+
+  level_sizes = _level_sizes(grid_data.size, min_size)
+  if len(level_sizes) == 0:
+    return []
+
+  from chimerax.map._map import downsample_average
+  from .arrays import _thread_count
+  threads = _thread_count()
+  from numpy import empty
+
+  # Read full resolution data in slabs with an even number of planes.
+  g = grid_data
+  isz, jsz, ksz = g.size
+  planes = max(2, slab_planes - slab_planes % 2)
+  cell_size, size = level_sizes[0]
+  a = empty(tuple(reversed(size)), g.value_type)
+  for k0 in range(0, ksz, planes):
+    nk = min(planes, ksz - k0)
+    m = g.read_matrix((0,0,k0), (isz,jsz,nk), (1,1,1), progress)
+    downsample_average(m, a[k0//2:k0//2+(nk+1)//2], threads = threads)
+  levels = [(cell_size, a)]
+
+  for cell_size, size in level_sizes[1:]:
+    prev = levels[-1][1]
+    a = empty(tuple(reversed(size)), g.value_type)
+    downsample_average(prev, a, threads = threads)
+    levels.append((cell_size, a))
+
+  return levels
+
+# -----------------------------------------------------------------------------
+#
+def _level_path(cache_path, cell_size):
+  from os.path import join
+  return join(cache_path, 'level_%d.npy' % cell_size)
+
+# -----------------------------------------------------------------------------
+# Return memory mapped levels if all levels are cached with the expected
+# size and value type and are newer than the grid data file.
+#
+def _read_level_cache(cache_path, grid_data, min_size):
+
+  from os.path import isfile, getmtime
+  g = grid_data
+  data_time = getmtime(g.path) if isinstance(g.path, str) and isfile(g.path) else None
+  from numpy import load
+  levels = []
+  for cell_size, size in _level_sizes(g.size, min_size):
+    path = _level_path(cache_path, cell_size)
+    if not isfile(path) or (data_time is not None and getmtime(path) < data_time):
+      return None
+    try:
+      a = load(path, mmap_mode = 'r')
+    except (OSError, ValueError):
+      return None
+    if a.shape != tuple(reversed(size)) or a.dtype != g.value_type:
+      return None
+    levels.append((cell_size, a))
+
+  return levels
+
+# -----------------------------------------------------------------------------
+#
+def _write_level_cache(cache_path, levels):
+
+  import os
+  os.makedirs(cache_path, exist_ok = True)
+  from numpy import save
+  for cell_size, a in levels:
+    save(_level_path(cache_path, cell_size), a)
@@ -105,6 +105,27 @@ def read_full_array(path, byte_offset, size, type, byte_swap,
 
     return a
 
+# -----------------------------------------------------------------------------
+# Return a read-only memory map of an array in a binary file with indices in
+# reverse order of size (zyx).  File pages are only read when array elements
+# are accessed.  Returns None if the array can't be used directly by C++
+# routines because it needs byte swapping or is not aligned.
+#
+def memory_mapped_array(path, byte_offset, size, type, byte_swap):
+
+    from numpy import dtype, memmap
+    vtype = dtype(type)
+    if byte_swap or byte_offset % vtype.itemsize != 0:
+        return None
+
+    shape = tuple(reversed(size))
+    try:
+        m = memmap(path, vtype, mode = 'r', offset = byte_offset, shape = shape)
+    except (OSError, ValueError):
+        return None
+
+    return m
+
 # -----------------------------------------------------------------------------
 # Read ascii float values on as many lines as needed to get count values.
 #
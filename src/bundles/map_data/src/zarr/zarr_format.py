@@ -0,0 +1,358 @@
+# vim: set expandtab shiftwidth=4 softtabstop=4:
+
+# === UCSF ChimeraX Copyright ===
+# Copyright 2022 Regents of the University of California. All rights reserved.
+# The ChimeraX application is provided pursuant to the ChimeraX license
+# agreement, which covers academic and commercial uses. For more details, see
+# <http://www.rbvi.ucsf.edu/chimerax/docs/licensing.html>
+#
+# This particular file is part of the ChimeraX library. You can also
+# redistribute and/or modify it under the terms of the GNU Lesser General
+# Public License version 2.1 as published by the Free Software Foundation.
+# For more details, see
+# <https://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>
+#
+# THIS SOFTWARE IS PROVIDED "AS IS" WITHOUT WARRANTY OF ANY KIND, EITHER
+# EXPRESSED OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+# OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. ADDITIONAL LIABILITY
+# LIMITATIONS ARE DESCRIBED IN THE GNU LESSER GENERAL PUBLIC LICENSE
+# VERSION 2.1
+#
+# This notice must be embedded in or attached to all copies, including partial
+# copies, of the software or any revisions or derivations thereof.
+# === UCSF ChimeraX Copyright ===
+
+# -----------------------------------------------------------------------------
+# Read Zarr version 2 arrays and OME-Zarr multiscale images.
+#
+# A Zarr array is a directory with a .zarray JSON header and one file per
+# chunk, each compressed separately.  Reading a subregion with a step only
+# reads the chunks containing grid points of the subsampled region, and the
+# chunks are read and decompressed in parallel threads.  The decompressors,
+# zlib and the zstd, blosc and lz4 codecs of the imagecodecs package, are C
+# libraries that release the Python global interpreter lock.
+#
+class Zarr_Array:
+
+  def __init__(self, path):
+
+    self.path = path
+
+    from os.path import join
+    h = _read_json(join(path, '.zarray'))
+    if h.get('zarr_format') != 2:
+      raise SyntaxError('Zarr array %s has format version %s, only version 2 is supported'
+                        % (path, h.get('zarr_format')))
+
+    self.shape = tuple(h['shape'])
+    self.chunks = tuple(h['chunks'])
+    from numpy import dtype
+    self.dtype = dt = dtype(h['dtype'])
+    if dt.fields is not None or dt.kind not in 'biuf':
+      raise SyntaxError('Zarr array %s has unsupported value type %s' % (path, h['dtype']))
+    self.order = h.get('order', 'C')
+    self.fill_value = _fill_value(h.get('fill_value'))
+    self.dimension_separator = h.get('dimension_separator', '.')
+    if h.get('filters'):
+      ids = ', '.join(f.get('id', '?') for f in h['filters'])
+      raise SyntaxError('Zarr array %s uses unsupported filters %s' % (path, ids))
+    self._decode = _decoder(h.get('compressor'), path)
+
+  # ---------------------------------------------------------------------------
+  # Read a subregion of the last three axes (z,y,x) into a numpy array m with
+  # index order z,y,x.  Leading axes, for example time and channel, are fixed
+  # at the given index values.
+  #
+  def read_matrix(self, index, ijk_origin, ijk_size, ijk_step, m, progress = None,
+                  threads = None):
+
+    nl = len(self.shape) - 3
+    index = tuple(index)
+    cshape = self.chunks
+    lead_chunk = tuple(i // c for i,c in zip(index, cshape[:nl]))
+    lead_offset = tuple(i % c for i,c in zip(index, cshape[:nl]))
+
+    # For each axis, the chunks that hold grid points of the subsampled region,
+    # as (chunk index, slice in chunk, slice in m).
+    axis_chunks = []
+    for a in (2,1,0):
+      o, s, st = ijk_origin[a], ijk_size[a], ijk_step[a]
+      c = cshape[nl+2-a]
+      last = o + ((s-1)//st)*st
+      achunks = []
+      for ci in range(o//c, last//c + 1):
+        c0 = ci*c
+        first = o + ((max(0, c0 - o) + st - 1)//st)*st
+        if first >= c0 + c or first > last:
+          continue	# Step skips this chunk.
+        end = min(c0 + c, last + 1)
+        mstart = (first - o)//st
+        mend = mstart + (end - first + st - 1)//st
+        achunks.append((ci, slice(first - c0, end - c0, st), slice(mstart, mend)))
+      axis_chunks.append(achunks)
+
+    jobs = [(lead_chunk + (zc[0], yc[0], xc[0]),
+             lead_offset + (zc[1], yc[1], xc[1]),
+             (zc[2], yc[2], xc[2]))
+            for zc in axis_chunks[0] for yc in axis_chunks[1] for xc in axis_chunks[2]]
+
+    def read_chunk(job, m = m):
+      chunk_index, chunk_slice, mslice = job
+      c = self.read_chunk(chunk_index)
+      if c is None:
+        m[mslice] = self.fill_value
+      else:
+        m[mslice] = c[chunk_slice]
+
+    if threads is None:
+      import os
+      threads = os.cpu_count() or 1
+    threads = min(threads, len(jobs))
+    if threads <= 1:
+      for job in jobs:
+        read_chunk(job)
+      return m
+
+    from concurrent.futures import ThreadPoolExecutor, as_completed
+    with ThreadPoolExecutor(max_workers = threads) as e:
+      futures = [e.submit(read_chunk, job) for job in jobs]
+      for count, f in enumerate(as_completed(futures)):
+        f.result()	# Raise errors from the thread
+        if progress:
+          progress.fraction(count / len(jobs))
+    if progress:
+      progress.done()
+
+    return m
+
+  # ---------------------------------------------------------------------------
+  # Return a numpy array for the chunk, or None if it is not stored, meaning
+  # all values are the fill value.
+  #
+  def read_chunk(self, chunk_index):
+
+    key = self.dimension_separator.join(str(i) for i in chunk_index)
+    from os.path import join
+    try:
+      with open(join(self.path, key), 'rb') as f:
+        data = f.read()
+    except FileNotFoundError:
+      return None
+
+    if self._decode is not None:
+      data = self._decode(data)
+
+    from numpy import frombuffer
+    c = frombuffer(data, self.dtype).reshape(self.chunks, order = self.order)
+    return c
+
+# -----------------------------------------------------------------------------
+# A 3D image in a Zarr array, with index values for any leading axes.
+#
+class Zarr_Image:
+
+  def __init__(self, name, array, index = (),
+               origin = (0,0,0), step = (1,1,1), time = None, channel = None,
+               default_color = None):
+
+    self.name = name
+    self.array = array
+    self.index = tuple(index)
+    self.size = tuple(reversed(array.shape[-3:]))
+    self.value_type = array.dtype.newbyteorder('=')
+    self.origin = origin
+    self.step = step
+    self.cell_angles = (90,90,90)
+    self.rotation = ((1,0,0),(0,1,0),(0,0,1))
+    self.symmetries = ()
+    self.time = time
+    self.channel = channel
+    self.default_color = default_color
+    self.subsamples = []	# List of (cell_size, data_size, array)
+
+# -----------------------------------------------------------------------------
+# Find the images in a Zarr array, OME-Zarr image or Zarr group directory.
+#
+def zarr_images(path, array_name = None):
+
+  from os.path import join, isfile, basename, normpath
+  path = normpath(path)
+  if array_name is not None:
+    path = join(path, array_name)
+
+  name = basename(path)
+  for suffix in ('.ome.zarr', '.zarr'):
+    if name.endswith(suffix):
+      name = name[:-len(suffix)]
+
+  if isfile(join(path, '.zarray')):
+    a = Zarr_Array(path)
+    _check_3d(a)
+    return [Zarr_Image(name, a, index = (0,) * (len(a.shape) - 3))]
+
+  attrs_path = join(path, '.zattrs')
+  attrs = _read_json(attrs_path) if isfile(attrs_path) else {}
+  if 'multiscales' in attrs:
+    return _ome_images(path, name, attrs)
+
+  # Zarr group, use all 3D arrays and images in subdirectories.
+  images = []
+  import os
+  for dir_path, dir_names, file_names in os.walk(path):
+    dir_names.sort()
+    if '.zarray' in file_names or '.zattrs' in file_names:
+      if dir_path == path:
+        continue
+      rel = os.path.relpath(dir_path, path)
+      try:
+        images.extend(zarr_images(path, rel))
+      except SyntaxError:
+        pass	# Not a 3D array
+      dir_names[:] = []	# Subdirectories are part of this array or image
+  if len(images) == 0:
+    raise SyntaxError('No 3D arrays found in Zarr directory %s' % path)
+  return images
+
+# -----------------------------------------------------------------------------
+# OME-Zarr version 0.1 to 0.4 multiscale images.  Coarser resolution levels
+# are added as subsamples.
+#
+def _ome_images(path, name, attrs):
+
+  ms = attrs['multiscales'][0]
+  datasets = ms['datasets']
+  from os.path import join
+  levels = [Zarr_Array(join(path, ds['path'])) for ds in datasets]
+  a0 = levels[0]
+  ndim = len(a0.shape)
+
+  axes = ms.get('axes')
+  if axes is None:
+    axes = ['t','c','z','y','x'][-ndim:]
+  axes = [(ax['name'] if isinstance(ax, dict) else ax).lower() for ax in axes]
+  if len(axes) != ndim or axes[-3:] != ['z','y','x']:
+    raise SyntaxError('OME-Zarr image %s axes %s do not end with z,y,x'
+                      % (path, ','.join(axes)))
+
+  scale, translation = _ome_scale_translation(datasets[0], ms, ndim)
+  step = tuple(reversed(scale[-3:]))
+  origin = tuple(reversed(translation[-3:]))
+
+  colors = [_ome_channel_color(ch) for ch in attrs.get('omero', {}).get('channels', [])]
+
+  lead = axes[:-3]
+  lead_sizes = a0.shape[:-3]
+  from itertools import product
+  tc = 't' in lead and lead_sizes[lead.index('t')] > 1
+  cc = 'c' in lead and lead_sizes[lead.index('c')] > 1
+  images = []
+  for index in product(*[range(s) for s in lead_sizes]):
+    t = index[lead.index('t')] if 't' in lead else None
+    c = index[lead.index('c')] if 'c' in lead else None
+    iname = name
+    if cc:
+      iname += ' channel %d' % c
+    if tc:
+      iname += ' time %d' % t
+    color = colors[c] if c is not None and c < len(colors) else None
+    i = Zarr_Image(iname, a0, index, origin = origin, step = step,
+                   time = t, channel = c, default_color = color)
+    for a in levels[1:]:
+      if len(a.shape) != ndim or a.shape[:-3] != a0.shape[:-3]:
+        continue
+      data_size = tuple(reversed(a.shape[-3:]))
+      cell_size = tuple(max(1, int(round(s0/s))) for s0,s in zip(i.size, data_size))
+      i.subsamples.append((cell_size, data_size, a))
+    images.append(i)
+
+  return images
+
+# -----------------------------------------------------------------------------
+#
+def _ome_scale_translation(dataset, multiscale, ndim):
+
+  scale = [1.0] * ndim
+  translation = [0.0] * ndim
+  for transforms in (dataset.get('coordinateTransformations', []),
+                     multiscale.get('coordinateTransformations', [])):
+    for t in transforms:
+      if t.get('type') == 'scale' and 'scale' in t:
+        scale = [a*b for a,b in zip(scale, t['scale'])]
+        translation = [a*b for a,b in zip(translation, t['scale'])]
+      elif t.get('type') == 'translation' and 'translation' in t:
+        translation = [a+b for a,b in zip(translation, t['translation'])]
+  return scale, translation
+
+# -----------------------------------------------------------------------------
+#
+def _ome_channel_color(channel):
+
+  color = channel.get('color')
+  if not isinstance(color, str) or len(color) != 6:
+    return None
+  try:
+    rgb = [int(color[i:i+2], 16)/255 for i in (0,2,4)]
+  except ValueError:
+    return None
+  return tuple(rgb) + (1,)
+
+# -----------------------------------------------------------------------------
+#
+def _check_3d(array):
+
+  if len(array.shape) < 3:
+    raise SyntaxError('Zarr array %s has %d dimensions, need at least 3'
+                      % (array.path, len(array.shape)))
+
+# -----------------------------------------------------------------------------
+#
+def _read_json(path):
+
+  import json
+  with open(path, 'r') as f:
+    return json.load(f)
+
+# -----------------------------------------------------------------------------
+#
+def _fill_value(value):
+
+  if value is None:
+    return 0
+  if isinstance(value, str):
+    return float(value)	# 'NaN', 'Infinity' or '-Infinity'
+  return value
+
+# -----------------------------------------------------------------------------
+# Return a function to decompress a chunk for a numcodecs compressor
+# description.
+#
+def _decoder(compressor, path):
+
+  if compressor is None:
+    return None
+
+  cid = compressor.get('id')
+  if cid in ('zlib', 'gzip'):
+    import zlib
+    wbits = 15 if cid == 'zlib' else 31
+    return lambda data: zlib.decompress(data, wbits)
+  elif cid == 'bz2':
+    import bz2
+    return bz2.decompress
+  elif cid == 'lzma':
+    import lzma
+    return lzma.decompress
+
+  decoders = {'zstd': 'zstd_decode', 'blosc': 'blosc_decode', 'lz4': 'lz4_decode'}
+  if cid not in decoders:
+    raise SyntaxError('Zarr array %s uses unsupported compression %s' % (path, cid))
+  try:
+    import imagecodecs
+  except ImportError:
+    raise SyntaxError('Reading Zarr array %s with %s compression requires the imagecodecs package'
+                      % (path, cid))
+  decode = getattr(imagecodecs, decoders[cid])
+  if cid == 'lz4':
+    # Numcodecs lz4 puts the uncompressed size before the data.
+    return lambda data: decode(data, header = True)
+  return decode
@@ -0,0 +1,94 @@
+# vim: set expandtab shiftwidth=4 softtabstop=4:
+
+# === UCSF ChimeraX Copyright ===
+# Copyright 2022 Regents of the University of California. All rights reserved.
+# The ChimeraX application is provided pursuant to the ChimeraX license
+# agreement, which covers academic and commercial uses. For more details, see
+# <http://www.rbvi.ucsf.edu/chimerax/docs/licensing.html>
+#
+# This particular file is part of the ChimeraX library. You can also
+# redistribute and/or modify it under the terms of the GNU Lesser General
+# Public License version 2.1 as published by the Free Software Foundation.
+# For more details, see
+# <https://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>
+#
+# THIS SOFTWARE IS PROVIDED "AS IS" WITHOUT WARRANTY OF ANY KIND, EITHER
+# EXPRESSED OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+# OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. ADDITIONAL LIABILITY
+# LIMITATIONS ARE DESCRIBED IN THE GNU LESSER GENERAL PUBLIC LICENSE
+# VERSION 2.1
+#
+# This notice must be embedded in or attached to all copies, including partial
+# copies, of the software or any revisions or derivations thereof.
+# === UCSF ChimeraX Copyright ===
+
+# -----------------------------------------------------------------------------
+# Wrap Zarr image data as grid data for displaying.
+#
+from .. import GridData
+
+class ZarrGrid(GridData):
+
+  # Attribute names for constructor grid settings.
+  attributes = ('size', 'value_type', 'origin', 'step', 'cell_angles',
+                'rotation', 'symmetries', 'default_color', 'time', 'channel')
+
+  def __init__(self, path, zarr_image, array, **grid_settings):
+
+    self.zarr_image = zarr_image
+    self.array = array
+
+    grid_id = zarr_image.name + ' ' + ','.join('%d' % i for i in zarr_image.index)
+    GridData.__init__(self, path = path, file_type = 'zarr', grid_id = grid_id,
+                      name = zarr_image.name, **grid_settings)
+
+  # ---------------------------------------------------------------------------
+  #
+  def read_matrix(self, ijk_origin, ijk_size, ijk_step, progress):
+
+    from ..readarray import allocate_array
+    m = allocate_array(ijk_size, self.value_type, ijk_step, progress)
+    self.array.read_matrix(self.zarr_image.index, ijk_origin, ijk_size, ijk_step,
+                           m, progress)
+    return m
+
+# -----------------------------------------------------------------------------
+#
+def read_zarr_map(path, array_name = None):
+
+  from .zarr_format import zarr_images
+  images = zarr_images(path, array_name)
+
+  glist = []
+  for i in images:
+    gsettings = {attr:getattr(i,attr) for attr in ZarrGrid.attributes}
+    g = ZarrGrid(path, i, i.array, **gsettings)
+    if i.subsamples:
+      g = add_subsamples(path, i, g)
+    glist.append(g)
+
+  # Mark as volume series if several times of same size.
+  for c in set(g.channel for g in glist):
+    series = [g for g in glist if g.channel == c and g.time is not None]
+    if len(series) > 1 and len(set(tuple(g.size) for g in series)) == 1:
+      for g in series:
+        g.series_index = g.time
+
+  return glist
+
+# -----------------------------------------------------------------------------
+# Add coarser resolution levels as subsample grids.
+#
+def add_subsamples(path, zarr_image, g):
+
+  from ..subsample import SubsampledGrid
+  g = SubsampledGrid(g)
+  i = zarr_image
+  for cell_size, data_size, array in i.subsamples:
+    step = tuple(s*c for s,c in zip(i.step, cell_size))
+    gsettings = {attr:getattr(i,attr) for attr in ZarrGrid.attributes}
+    gsettings.update({'size':data_size, 'step':step})
+    sg = ZarrGrid(path, i, array, **gsettings)
+    g.add_subsamples(sg, cell_size)
+
+  return g
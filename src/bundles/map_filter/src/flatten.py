@@ -70,7 +70,9 @@ def flatten_matrix(m, method = 'multiply linear',
   if task:
     task.updateStatus('computing moments')
   from chimerax.map import moments, affine_scale
-  v2, v1, v0 = moments(mfit)
+  import os
+  threads = os.cpu_count() or 1
+  v2, v1, v0 = moments(mfit, threads = threads)
 
   if method == 'multiply linear':
     # Multiply by affine function to make resulting first moments of map zero.
@@ -92,7 +94,7 @@ def flatten_matrix(m, method = 'multiply linear',
   
   if task:
     task.updateStatus('scaling data')
-  affine_scale(m, f[0], f[1:4], invert)
+  affine_scale(m, f[0], f[1:4], invert, threads = threads)
 
   return u
 
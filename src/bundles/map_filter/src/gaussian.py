@@ -67,6 +67,10 @@ def gaussian_convolution(data, ijk_sdev, value_type = None,
 
   from numpy import array, float32, float64, multiply, divide, swapaxes
   vt = value_type if value_type == float32 or value_type == float64 else float32
+
+  if vt == float32 and not cyclic and not invert:
+    c = gaussian_filter(data, ijk_sdev, cutoff)
+    return c if value_type == vt else c.astype(value_type)
   c = array(data, vt)
 
   from numpy.fft import rfft, irfft
@@ -106,6 +110,25 @@ def gaussian_convolution(data, ijk_sdev, value_type = None,
 
   return c
 
+# -----------------------------------------------------------------------------
+# Convolve in real-space one axis at a time with C++ code, giving a float32
+# array without the complex Fourier transform arrays.  Wide Gaussians use a
+# recursive filter whose cost does not depend on the width.
+#
+recursive_filter_min_sdev = 10
+
+def gaussian_filter(data, ijk_sdev, cutoff = 5, result = None):
+
+  if result is None:
+    from numpy import empty, float32
+    result = empty(data.shape, float32)
+  recursive = max(ijk_sdev) >= recursive_filter_min_sdev
+  from os import cpu_count
+  from chimerax.map import gaussian_filter_array
+  gaussian_filter_array(data, ijk_sdev, result, cutoff = cutoff,
+                        recursive = recursive, threads = cpu_count() or 1)
+  return result
+
 # -----------------------------------------------------------------------------
 #
 def gaussian(sdev, size, value_type):
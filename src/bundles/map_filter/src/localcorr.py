@@ -58,8 +58,10 @@ def local_correlation_matrix(m1, m2, window_size, subtract_mean):
     if not m2.flags['C_CONTIGUOUS']:
         m2 = m2.copy()
 
+    from os import cpu_count
+    threads = cpu_count() or 1
     from chimerax.map import local_correlation
-    local_correlation(m1, m2, window_size, subtract_mean, mc)
+    local_correlation(m1, m2, window_size, subtract_mean, mc, threads = threads)
     return mc
 
 # -----------------------------------------------------------------------------
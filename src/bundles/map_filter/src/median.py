@@ -38,7 +38,8 @@ def median_grid(volume, bin_size = 3, iterations = 1,
   vm = v.region_matrix(region)
   m = vm
   for i in range(iterations):
-    m = median_array(m, bin_size)
+    # After the first iteration filter in place.
+    m = median_array(m, bin_size, result = (None if m is vm else m))
 
   from chimerax.map_data import ArrayGridData
   d = v.data
@@ -49,9 +50,26 @@ def median_grid(volume, bin_size = 3, iterations = 1,
   return mg
 
 # -----------------------------------------------------------------------------
-# Volume border of result is set to zero.  Bin size must be odd.
+# Volume border of result is set to zero.  Bin size must be odd.  The result
+# array can be the input array to filter in place.
 #
-def median_array(m, bin_size=3):
+def median_array(m, bin_size=3, result=None):
+
+  if isinstance(bin_size, int):
+    bin_size = (bin_size, bin_size, bin_size)
+
+  if result is None:
+    from numpy import empty
+    result = empty(m.shape, m.dtype)
+  from os import cpu_count
+  from chimerax.map import median_filter_array
+  median_filter_array(m, bin_size, result, threads = cpu_count() or 1)
+  return result
+
+# -----------------------------------------------------------------------------
+# Slow.  Numpy version of median_array().
+#
+def median_array_numpy(m, bin_size=3):
 
   if isinstance(bin_size, int):
     bin_size = (bin_size, bin_size, bin_size)
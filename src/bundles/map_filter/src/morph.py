@@ -233,11 +233,12 @@ def linear_combination(f1, v1, f2, v2, v, subregion, step):
   m1 = v1.matrix(step = step, subregion = subregion)
   m2 = v2.matrix(step = step, subregion = subregion)
   if (m.flags.contiguous and m1.flags.contiguous and m2.flags.contiguous and
-      m1.dtype == m.dtype and m2.dtype == m.dtype):
+      m1.dtype == m.dtype):
     # Optimize calculation of linear combination of matrices.
     # C++ routine is 7x faster (.1 vs .7 sec) than numpy on 256^3 matrix.
     from chimerax.map import linear_combination
-    linear_combination(f1, m1, f2, m2, m)
+    import os
+    linear_combination(f1, m1, f2, m2, m, threads = os.cpu_count() or 1)
   else:
     m[:,:,:] = f1*m1[:,:,:] + f2*m2[:,:,:]
 
@@ -192,19 +192,43 @@ def locate_maximum(points, point_weights, data_array, xyz_to_ijk_transform,
                                % (step, shift, angle)):
                 break
 
-    # Record statistics of optimization.
-    shift, angle = move_tf.shift_and_angle(rc)
+    stats = fit_statistics(points, point_weights, data_array,
+                           xyz_to_ijk_transform, move_tf, rc, step,
+                           syminv = syminv, values = values)
+    return move_tf, stats
+
+# -----------------------------------------------------------------------------
+# Record statistics of optimization.
+#
+def fit_statistics(points, point_weights, data_array, xyz_to_ijk_transform,
+                   move_tf, rotation_center, steps, syminv = [], values = None):
+
+    shift, angle = move_tf.shift_and_angle(rotation_center)
     axis, axis_point, angle, axis_shift = move_tf.axis_center_angle_shift()
     xyz_to_ijk_tf = xyz_to_ijk_transform * move_tf
     stats = {'shift': shift, 'axis': axis, 'axis point': axis_point,
-             'angle': angle, 'axis shift': axis_shift, 'steps': step,
-             'points': np, 'transform': move_tf}
+             'angle': angle, 'axis shift': axis_shift, 'steps': steps,
+             'points': len(points), 'transform': move_tf,
+             'symmetries': len(syminv)}
+
+    if len(syminv) == 0:
+        # Compute all statistics in one pass over the points.
+        from chimerax.map_data import interpolate_fit_statistics
+        amv, npts, olap, cor, corm = \
+            interpolate_fit_statistics(points, xyz_to_ijk_tf, data_array,
+                                       weights = point_weights)
+        stats['average map value'] = amv
+        stats['points in map'] = npts
+        if not point_weights is None:
+            stats['overlap'] = olap
+            stats['correlation'] = cor
+            stats['correlation about mean'] = corm
+        return stats
 
     amv, npts = average_map_value(points, xyz_to_ijk_tf, data_array,
                                   syminv = syminv, values = values)
     stats['average map value'] = amv
     stats['points in map'] = npts      # Excludes out-of-bounds points
-    stats['symmetries'] = len(symmetries)
     if not point_weights is None:
         map_values = volume_values(points, xyz_to_ijk_tf, data_array,
                                    syminv=syminv, values=values)
@@ -212,8 +236,44 @@ def locate_maximum(points, point_weights, data_array, xyz_to_ijk_transform,
         stats['overlap'] = olap
         stats['correlation'] = cor
         stats['correlation about mean'] = corm
-                
-    return move_tf, stats
+
+    return stats
+
+# -----------------------------------------------------------------------------
+# Optimize many starting placements at once in C++ threads.  Same as calling
+# locate_maximum() for each transform in xyz_to_ijk_transforms without
+# symmetries.  Returns a list of (move_tf, stats) pairs.
+#
+def locate_maxima(points, point_weights, data_array, xyz_to_ijk_transforms,
+                  max_steps = 2000, ijk_step_size_min = 0.01, ijk_step_size_max = 0.5,
+                  optimize_translation = True, optimize_rotation = True,
+                  metric = 'sum product'):
+
+    from numpy import array, float64
+    tfs = array([tf.matrix for tf in xyz_to_ijk_transforms], float64)
+    if len(tfs) == 0:
+        return []
+
+    import os
+    threads = os.cpu_count() or 1
+    from chimerax.map import _map
+    move_tfs, steps, scores = \
+        _map.locate_maxima(points, point_weights, data_array, tfs,
+                           max_steps, ijk_step_size_min, ijk_step_size_max,
+                           optimize_translation, optimize_rotation, metric,
+                           threads = threads)
+
+    from numpy import sum
+    rc = sum(points, axis=0, dtype=float64) / len(points)
+    from chimerax.geometry import Place
+    fits = []
+    for tf, mtf, step in zip(xyz_to_ijk_transforms, move_tfs, steps):
+        move_tf = Place(mtf)
+        stats = fit_statistics(points, point_weights, data_array, tf,
+                               move_tf, rc, int(step))
+        fits.append((move_tf, stats))
+
+    return fits
     
 # -----------------------------------------------------------------------------
 #
@@ -64,45 +64,56 @@ def fit_search(models, points, point_weights, volume, n,
     from chimerax.geometry import bins
     b = bins.Binned_Transforms(angle_tolerance*pi/180, shift_tolerance, center)
     fo = {}
-    from .fitmap import locate_maximum
-    for i in range(n):
+    from .fitmap import locate_maximum, locate_maxima
+    opt_args = (max_steps, ijk_step_size_min, ijk_step_size_max,
+                optimize_translation, optimize_rotation, metric)
+    # Optimize batches of starting placements in parallel threads.
+    import os
+    batch_size = 4 * (os.cpu_count() or 1)
+    i = 0
+    while i < n:
         if request_stop_cb and request_stop_cb('Fit %d of %d' % (i+1,n)):
             break
-        shift = ((random_translation(bounds) if radius is None
-                  else random_translation_step(center, radius)) if shifts
-                  else translation(center))
-        rot = random_rotation() if rotations else identity()
-        tf = shift * rot * ctf
-        optimize = True
-        max_opt = 2
-        while optimize and max_opt > 0:
-            p_to_ijk_tf = xyz_to_ijk_tf * tf
-            move_tf, stats = \
-              locate_maximum(points, point_weights, data_array, p_to_ijk_tf,
-                             max_steps, ijk_step_size_min, ijk_step_size_max,
-                             optimize_translation, optimize_rotation,
-                             metric, request_stop_cb = None)
+        start_tfs = []
+        for j in range(min(batch_size, n-i)):
+            shift = ((random_translation(bounds) if radius is None
+                      else random_translation_step(center, radius)) if shifts
+                      else translation(center))
+            rot = random_rotation() if rotations else identity()
+            start_tfs.append(shift * rot * ctf)
+        i += len(start_tfs)
+        fits = locate_maxima(points, point_weights, data_array,
+                             [xyz_to_ijk_tf * tf for tf in start_tfs], *opt_args)
+        for tf, (move_tf, stats) in zip(start_tfs, fits):
             ptf = tf * move_tf
-            optimize = False
-            max_opt -= 1
             if asymmetric_unit:
                 atf = unique_symmetry_position(ptf, center, asym_center,
                                                volume.data.symmetries)
                 if not atf is ptf:
                     ptf = tf = atf
-                    optimize = not b.close_transforms(ptf)
-        close = b.close_transforms(ptf)
-        if len(close) == 0:
-            transforms = [ptf * mtv for mtv in mtv_list]
-            stats['hits'] = 1
-            f = Fit(models, transforms, volume, stats)
-            f.ptf = ptf
-            flist.append(f)
-            b.add_transform(ptf)
-            fo[id(ptf)] = f
-        else:
-            s = fo[id(close[0])].stats
-            s['hits'] += 1
+                    if not b.close_transforms(ptf):
+                        # Optimize again from the asymmetric unit position.
+                        p_to_ijk_tf = xyz_to_ijk_tf * tf
+                        move_tf, stats = \
+                          locate_maximum(points, point_weights, data_array, p_to_ijk_tf,
+                                         *opt_args, request_stop_cb = None)
+                        ptf = tf * move_tf
+                        atf = unique_symmetry_position(ptf, center, asym_center,
+                                                       volume.data.symmetries)
+                        if not atf is ptf:
+                            ptf = atf
+            close = b.close_transforms(ptf)
+            if len(close) == 0:
+                transforms = [ptf * mtv for mtv in mtv_list]
+                stats['hits'] = 1
+                f = Fit(models, transforms, volume, stats)
+                f.ptf = ptf
+                flist.append(f)
+                b.add_transform(ptf)
+                fo[id(ptf)] = f
+            else:
+                s = fo[id(close[0])].stats
+                s['hits'] += 1
 
     # Filter out solutions with too many points outside volume contour.
     fflist = [f for f in flist if (in_contour(f.ptf, points, volume, f.stats)
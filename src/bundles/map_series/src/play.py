@@ -33,7 +33,8 @@ class Play_Series:
                preceding_marker_frames = 0, following_marker_frames = 0,
                color_range = None,
                normalize_thresholds = False,
-               rendering_cache_size = 1):
+               rendering_cache_size = 1,
+               prefetch_frames = 0, prefetch_memory = 1024):
 
     self.series = series
     self.session = session
@@ -62,6 +63,16 @@ class Play_Series:
     self.rendered_times = []       # For limiting cached renderings
     self.rendered_times_table = {}
 
+    # Read and contour upcoming maps in a thread, memory limit in Mbytes.
+    # Surfaces are not computed ahead when thresholds are normalized since
+    # that needs the map values.
+    if prefetch_frames > 0:
+      from .prefetch import Series_Prefetch
+      self._prefetch = Series_Prefetch(prefetch_frames, prefetch_memory * 2**20,
+                                       contour = not normalize_thresholds)
+    else:
+      self._prefetch = None
+
     self._model_close_handler = session.triggers.add_handler('remove models', self._models_closed)
 
   # ---------------------------------------------------------------------------
@@ -79,6 +90,8 @@ class Play_Series:
     sopen = [s for s in ser if s not in mset]
     if len(sopen) < len(ser):
       self.series = sopen
+      if self._prefetch:
+        self._prefetch.remove_series([s for s in ser if s in mset])
       if len(sopen) == 0:
         self.stop()
 
@@ -111,6 +124,8 @@ class Play_Series:
     if h:
       self.session.triggers.remove_handler(self.handler)
       self.play_handler = None
+    if self._prefetch:
+      self._prefetch.clear()
 
   # ---------------------------------------------------------------------------
   #
@@ -129,28 +144,50 @@ class Play_Series:
     if len(tslist) == 0:
       return
 
+    tn, self.step = self._next_time(t, self.step)
+    if tn is None:
+      self.stop()       # Reached the end or the beginning
+      return
+
+    self.change_time(tn)
+
+  # ---------------------------------------------------------------------------
+  # Return the time after t and the new step, or None at the end of play.
+  #
+  def _next_time(self, t, step):
+
     ts, te = self.time_range[:2]
     nt = te-ts+1
-    if nt == 0:
-      return	# Series has no maps
+    if nt <= 0:
+      return None, step	# Series has no maps
     if self.play_direction == 'oscillate':
-      if self.step > 0:
+      if step > 0:
         if t == te:
-          self.step = -1
+          step = -1
       elif t == ts:
-        self.step = 1
+        step = 1
         if not self.loop:
-          self.stop()
-          return
+          return None, step
 
-    tn = t + self.step
+    tn = t + step
     if self.loop:
       tn = ts + (tn-ts)%nt
     elif (tn-ts) % nt != (tn-ts):
-      self.stop()       # Reached the end or the beginning
-      return
+      return None, step
+    return tn, step
 
-    self.change_time(tn)
+  # ---------------------------------------------------------------------------
+  #
+  def _upcoming_times(self, t, count):
+
+    times = []
+    step = self.step
+    for i in range(count):
+      t, step = self._next_time(t, step)
+      if t is None or t in times:
+        break
+      times.append(t)
+    return times
 
   # ---------------------------------------------------------------------------
   #
@@ -189,7 +226,10 @@ class Play_Series:
     tslist = [ts for ts in tslist
               if t < ts.number_of_times() and not ts.is_volume_closed(t)]
 
+    pf = self._prefetch
     for ts in tslist:
+      if pf:
+        pf.wait(ts, t)
       t0 = self.update_rendering_settings(ts, t)
       self.show_time(ts, t)
       if ts.last_shown_time != t:
@@ -198,6 +238,12 @@ class Play_Series:
         self.unshow_time(ts, t0)
       ts.last_shown_time = t
 
+    if pf and self.play_handler:
+      upcoming = self._upcoming_times(t, pf.frames)
+      for ts in tslist:
+        nt = ts.number_of_times()
+        pf.prefetch(ts, t, [tu for tu in upcoming if tu < nt])
+
     if tslist:
       self.update_marker_display()
       self.update_color_zone()
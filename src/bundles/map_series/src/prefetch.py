@@ -0,0 +1,240 @@
+# vim: set expandtab shiftwidth=4 softtabstop=4:
+
+# === UCSF ChimeraX Copyright ===
+# Copyright 2022 Regents of the University of California. All rights reserved.
+# The ChimeraX application is provided pursuant to the ChimeraX license
+# agreement, which covers academic and commercial uses. For more details, see
+# <http://www.rbvi.ucsf.edu/chimerax/docs/licensing.html>
+#
+# This particular file is part of the ChimeraX library. You can also
+# redistribute and/or modify it under the terms of the GNU Lesser General
+# Public License version 2.1 as published by the Free Software Foundation.
+# For more details, see
+# <https://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>
+#
+# THIS SOFTWARE IS PROVIDED "AS IS" WITHOUT WARRANTY OF ANY KIND, EITHER
+# EXPRESSED OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+# OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. ADDITIONAL LIABILITY
+# LIMITATIONS ARE DESCRIBED IN THE GNU LESSER GENERAL PUBLIC LICENSE
+# VERSION 2.1
+#
+# This notice must be embedded in or attached to all copies, including partial
+# copies, of the software or any revisions or derivations thereof.
+# === UCSF ChimeraX Copyright ===
+
+# -----------------------------------------------------------------------------
+# Read and contour the next maps of a series in a background thread while the
+# current map is shown, so playing a series does not pause at each frame to
+# read a file and compute its surfaces.  File reading and the C++ contouring
+# release the Python global interpreter lock, so this runs alongside drawing.
+#
+# Maps are read into the volume data cache and the surfaces are held by each
+# VolumeSurface until shown.  Frames ahead are limited by count and by the
+# bytes of their matrices and surfaces.
+#
+class Series_Prefetch:
+
+  def __init__(self, frames = 2, memory_limit = 2**30, contour = True):
+
+    self.frames = frames		# Number of frames to read ahead
+    self.memory_limit = memory_limit	# Bytes
+    self.contour = contour		# Whether to compute surfaces ahead
+    self._executor = None
+    self._frames = {}			# (series, time) -> Prefetched_Frame
+    self._can_prefetch = {}		# series -> bool
+
+  # ---------------------------------------------------------------------------
+  # Wait for a frame about to be shown to finish reading.
+  #
+  def wait(self, series, time):
+
+    f = self._frames.get((series, time))
+    if f:
+      f.wait()
+
+  # ---------------------------------------------------------------------------
+  # Start reading the given upcoming times after showing a time.
+  # Frames that are no longer upcoming are released.
+  #
+  def prefetch(self, series, time, upcoming_times):
+
+    if not self._series_can_prefetch(series):
+      return
+
+    keep = set((series, t) for t in upcoming_times)
+    keep.add((series, time))
+    frames = self._frames
+    for key in tuple(frames.keys()):
+      if key[0] is series and key not in keep:
+        frames[key].cancel()
+        del frames[key]
+
+    for t in upcoming_times[:self.frames]:
+      if (series, t) in frames or series.is_volume_closed(t):
+        continue
+      f = Prefetched_Frame(series, t, time, self.contour)
+      if self.memory_use() + f.size > self.memory_limit:
+        break
+      frames[(series, t)] = f
+      f.start(self._thread_executor())
+
+  # ---------------------------------------------------------------------------
+  #
+  def memory_use(self):
+
+    for f in self._frames.values():
+      if f.done():
+        f.wait()	# Update size from estimate
+    return sum(f.size for f in self._frames.values())
+
+  # ---------------------------------------------------------------------------
+  # Release frames of series no longer played.
+  #
+  def remove_series(self, series):
+
+    sset = set(series)
+    frames = self._frames
+    for key in tuple(frames.keys()):
+      if key[0] in sset:
+        frames[key].cancel()
+        del frames[key]
+    for s in sset:
+      self._can_prefetch.pop(s, None)
+
+  # ---------------------------------------------------------------------------
+  #
+  def clear(self):
+
+    for f in self._frames.values():
+      f.cancel()
+    self._frames.clear()
+    e = self._executor
+    if e:
+      e.shutdown(wait = False, cancel_futures = True)
+      self._executor = None
+
+  # ---------------------------------------------------------------------------
+  # A single thread reads files one at a time.  The contouring C++ code
+  # itself uses multiple threads.
+  #
+  def _thread_executor(self):
+
+    if self._executor is None:
+      from concurrent.futures import ThreadPoolExecutor
+      self._executor = ThreadPoolExecutor(max_workers = 1,
+                                          thread_name_prefix = 'map series prefetch')
+    return self._executor
+
+  # ---------------------------------------------------------------------------
+  # File readers are not thread-safe, so only read in a thread when each map
+  # of the series has its own file.  Maps from one multi-time file could be
+  # read in the background and the main thread at the same time.
+  #
+  def _series_can_prefetch(self, series):
+
+    cp = self._can_prefetch
+    if series not in cp:
+      paths = [_path_key(v.data) for v in series.maps if v is not None]
+      cp[series] = (None not in paths and len(set(paths)) == len(paths))
+    return cp[series]
+
+# -----------------------------------------------------------------------------
+#
+def _path_key(data):
+
+  path = getattr(data, 'path', None)
+  if path is None or path == '':
+    return None
+  return tuple(path) if isinstance(path, (list, tuple)) else path
+
+# -----------------------------------------------------------------------------
+# Map settings are copied from the shown time and the matrix region and
+# contour settings are recorded on the main thread.  The thread reads the
+# matrix and computes surfaces for those settings.
+#
+class Prefetched_Frame:
+
+  def __init__(self, series, time, shown_time, contour = True):
+
+    self.series = series
+    self.time = time
+
+    series.copy_display_parameters(shown_time, time)
+    self._volume = v = series.maps[time]
+    self._region = v.step_aligned_region(v.region)
+    if contour and v.surface_shown:
+      ro = v.rendering_options
+      self._surfaces = [(s, s.contour_settings(ro), ro) for s in v.surfaces if s.display]
+    else:
+      self._surfaces = []
+
+    # Estimate of bytes used until reading finishes.
+    from numpy import prod
+    origin, size, step = self._region
+    msize = [(a+b-1)//b for a,b in zip(size, step)]
+    self.size = int(prod(msize)) * v.data.value_type.itemsize
+
+    self._matrix = None		# Keep matrix in data cache until used
+    self._future = None
+
+  # ---------------------------------------------------------------------------
+  #
+  def start(self, executor):
+
+    self._future = executor.submit(self._read_and_contour, self._volume.data,
+                                   self._region, self._surfaces)
+
+  # ---------------------------------------------------------------------------
+  # Runs in the prefetch thread.
+  #
+  @staticmethod
+  def _read_and_contour(data, region, surfaces):
+
+    origin, size, step = region
+    m = data.matrix(origin, size, step)
+    size = m.nbytes
+    for s, contour_settings, rendering_options in surfaces:
+      size += s.prefetch_geometry(m, contour_settings, rendering_options)
+    return m, size
+
+  # ---------------------------------------------------------------------------
+  #
+  def done(self):
+
+    f = self._future
+    return f is not None and f.done()
+
+  # ---------------------------------------------------------------------------
+  #
+  def wait(self):
+
+    f = self._future
+    if f is None:
+      return
+    self._future = None
+    try:
+      self._matrix, self.size = f.result()
+    except Exception:
+      # Reading or contouring failed, or was cancelled.  The map is read
+      # normally when shown, reporting any error.
+      pass
+
+  # ---------------------------------------------------------------------------
+  #
+  def cancel(self):
+
+    f = self._future
+    self._future = None
+    self._matrix = None
+    if f is not None and not f.cancel():
+      # Already running, release its surfaces when it finishes.
+      f.add_done_callback(lambda f: self._release_surfaces())
+    else:
+      self._release_surfaces()
+
+  # ---------------------------------------------------------------------------
+  #
+  def _release_surfaces(self):
+
+    for s, contour_settings, rendering_options in self._surfaces:
+      s._prefetched_geometry = None
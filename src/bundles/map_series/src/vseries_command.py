@@ -82,6 +82,8 @@ def register_vseries_command(logger):
                                    ('following_marker_frames', IntArg),
                                    ('color_range', FloatArg),
                                    ('cache_frames', IntArg),
+                                   ('prefetch_frames', IntArg),
+                                   ('prefetch_memory', FloatArg),
                                    ('jump_to', IntArg),
                                    ('range', IntRangeArg),
                                    ('start_time', IntArg),],
@@ -101,7 +103,7 @@ def register_vseries_command(logger):
 def vseries_play(session, series, direction = 'forward', loop = False, max_frame_rate = None, pause_frames = 0,
             jump_to = None, range = None, start_time = None, normalize = False, markers = None,
             preceding_marker_frames = 0, following_marker_frames = 0,
-            color_range = None, cache_frames = 1):
+            color_range = None, cache_frames = 1, prefetch_frames = 0, prefetch_memory = 1024):
     '''Show a sequence of maps from a volume series.'''
     if len(series) == 0:
         from chimerax.core.errors import UserError
@@ -118,7 +120,9 @@ def vseries_play(session, series, direction = 'forward', loop = False, max_frame
                          preceding_marker_frames = preceding_marker_frames,
                          following_marker_frames = following_marker_frames,
                          color_range = color_range,
-                         rendering_cache_size = cache_frames)
+                         rendering_cache_size = cache_frames,
+                         prefetch_frames = prefetch_frames,
+                         prefetch_memory = prefetch_memory)
     if not jump_to is None:
         p.change_time(jump_to)
     else:
@@ -17,8 +17,11 @@
 
 #include <math.h>			// use ceil(), floor()
 
+#include <vector>			// use std::vector
+
 #include <arrays/pythonarray.h>		// use parse_*_array()
 #include <arrays/rcarray.h>		// use call_template_function()
+#include <arrays/threadpool.h>		// use Thread_Pool::thread_count(), run()
 
 // ---------------------------------------------------------------------------
 //
@@ -31,6 +34,29 @@ inline int imin(int a, int b)
 inline int imax(int a, int b)
   { return (a > b ? a : b); }
 
+// ---------------------------------------------------------------------------
+// Small surfaces and volumes are computed with one thread.
+//
+const int MIN_THREAD_TRIANGLES = 10000;
+const int64_t MIN_THREAD_ELEMENTS = (1 << 20);
+
+// ---------------------------------------------------------------------------
+// Divide a range 0 to n among shared pool threads, calling f(begin, end)
+// in each thread.
+//
+template <class Range_Function>
+static void thread_ranges(int64_t n, int64_t elements, int threads, Range_Function f)
+{
+  int64_t nt = (elements >= MIN_THREAD_ELEMENTS ?
+		Thread_Pool::thread_count(n, 1, imax(threads, 1)) : 1);
+  if (nt <= 1)
+    {
+      f(0, n);
+      return;
+    }
+  Thread_Pool::run(nt, [&](int t) { f((t*n)/nt, ((t+1)*n)/nt); });
+}
+
 // ---------------------------------------------------------------------------
 // Compute z surface intercepts (depths) at a grid of xy positions for
 // a surface defined by triangles.  Record only the depths greater
@@ -45,29 +71,16 @@ inline int imax(int a, int b)
 // if they are displaced by an infinitesimal in the plus x or y
 // direction.
 //
-static bool surface_z_depth(const FArray &varray, const IArray &tarray,
-			    FArray &depth, IArray &tnum,
-			    const FArray *beyond, const IArray *beyond_tnum,
-			    int toffset)
+// Multiple threads each handle a band of depth array rows (y values) and
+// loop over all triangles in order, so each depth value is set exactly as
+// with a single thread.
+//
+static bool surface_z_depth_rows(const int *ta, int nt, const float *va,
+				 const int64_t dsize[2], float *da, int *tn,
+				 const float *ba, const int *bt, int toffset,
+				 int sband0, int sband1)
 {
-  int64_t dsize[2] = {depth.size(1),depth.size(0)};		// x and y size
-
   bool set = false;
-
-  int nt = tarray.size(0);
-  const IArray tc = tarray.contiguous_array();
-  const int *ta = tc.values();
-  const FArray vc = varray.contiguous_array();
-  const float *va = vc.values();
-  float *da = depth.values();
-  int *tn = tnum.values();
-  FArray bc;
-  const float *ba = (beyond ?
-		     (bc = beyond->contiguous_array(), bc.values()) : NULL);
-  IArray btc;
-  const int *bt = (beyond_tnum ?
-		   (btc = beyond_tnum->contiguous_array(),btc.values()) : NULL);
-
   double tv[3][3];
   for (int t = 0 ; t < nt ; ++t)
     {
@@ -79,6 +92,9 @@ static bool surface_z_depth(const FArray &varray, const IArray &tarray,
 	}
       // p denotes primary axis, s denotes secondary axis.
       const int p = 0, s = 1;
+      if ((tv[0][s] < sband0 && tv[1][s] < sband0 && tv[2][s] < sband0) ||
+	  (tv[0][s] > sband1 && tv[1][s] > sband1 && tv[2][s] > sband1))
+	continue;		// Triangle outside this thread's rows.
       int ipmin = arg_min(tv[0][p], tv[1][p], tv[2][p]);
       int ipmax = arg_max(tv[0][p], tv[1][p], tv[2][p]);
       if (ipmin == ipmax)
@@ -123,8 +139,8 @@ static bool surface_z_depth(const FArray &varray, const IArray &tarray,
 	  // Casts to double to avoid extra (80-bit) register precision.
 	  if (static_cast<double>(sminc) == static_cast<double>(smin))
 	    sminc += 1;		// Offset coincident intercept.
-	  int si0 = imax(0, (int)sminc);
-	  int si1 = imin(dsize[s]-1, (int)smaxf);
+	  int si0 = imax(sband0, (int)sminc);
+	  int si1 = imin(sband1-1, (int)smaxf);
 	  for (int si = si0 ; si <= si1 ; ++si)
 	    {
 	      double fs = (ssep == 0 ? 0.5 : (si - smin) / ssep);
@@ -148,19 +164,62 @@ static bool surface_z_depth(const FArray &varray, const IArray &tarray,
   return set;
 }
 
+// ----------------------------------------------------------------------------
+//
+static bool surface_z_depth(const FArray &varray, const IArray &tarray,
+			    FArray &depth, IArray &tnum,
+			    const FArray *beyond, const IArray *beyond_tnum,
+			    int toffset, int threads)
+{
+  int64_t dsize[2] = {depth.size(1),depth.size(0)};		// x and y size
+
+  int nt = tarray.size(0);
+  const IArray tc = tarray.contiguous_array();
+  const int *ta = tc.values();
+  const FArray vc = varray.contiguous_array();
+  const float *va = vc.values();
+  float *da = depth.values();
+  int *tn = tnum.values();
+  FArray bc;
+  const float *ba = (beyond ?
+		     (bc = beyond->contiguous_array(), bc.values()) : NULL);
+  IArray btc;
+  const int *bt = (beyond_tnum ?
+		   (btc = beyond_tnum->contiguous_array(),btc.values()) : NULL);
+
+  int ysize = dsize[1];
+  int nthreads = (nt >= MIN_THREAD_TRIANGLES ?
+		  Thread_Pool::thread_count(ysize, 1, imax(threads, 1)) : 1);
+  if (nthreads <= 1)
+    return surface_z_depth_rows(ta, nt, va, dsize, da, tn, ba, bt, toffset,
+				0, ysize);
+
+  std::vector<char> tset(nthreads, 0);
+  Thread_Pool::run(nthreads, [&](int t) {
+      int sband0 = (t*(int64_t)ysize)/nthreads, sband1 = ((t+1)*(int64_t)ysize)/nthreads;
+      tset[t] = surface_z_depth_rows(ta, nt, va, dsize, da, tn, ba, bt, toffset,
+				     sband0, sband1);
+    });
+  bool set = false;
+  for (int t = 0 ; t < nthreads ; ++t)
+    if (tset[t])
+      set = true;
+  return set;
+}
+
 // ----------------------------------------------------------------------------
 //
 extern "C" PyObject *py_surface_z_depth(PyObject *, PyObject *args,
 					PyObject *keywds)
 {
-  int toffset = 0;
+  int toffset = 0, threads = 1;
   FArray varray, depth, beyond;
   IArray tarray, tnum, beyond_tnum;
   const char *kwlist[] = {"vertices", "triangles", "depth", "triangle_number",
 		    "beyond", "beyond_triangle_number",
-		    "triangle_number_offset", NULL};
+		    "triangle_number_offset", "threads", NULL};
   if (!PyArg_ParseTupleAndKeywords(args, keywds,
-				   const_cast<char *>("O&O&O&O&|O&O&i"),
+				   const_cast<char *>("O&O&O&O&|O&O&ii"),
 				   const_cast<char **>(kwlist),
 				   parse_float_n3_array, &varray,
 				   parse_int_n3_array, &tarray,
@@ -168,7 +227,7 @@ extern "C" PyObject *py_surface_z_depth(PyObject *, PyObject *args,
                                    parse_writable_int_2d_array, &tnum,
 				   parse_float_2d_array, &beyond,
                                    parse_int_2d_array, &beyond_tnum,
-                                   &toffset))
+                                   &toffset, &threads))
     return NULL;
 
   if (!depth.is_contiguous() || !tnum.is_contiguous())
@@ -192,8 +251,11 @@ extern "C" PyObject *py_surface_z_depth(PyObject *, PyObject *args,
       return NULL;
     }
 
-  bool set = surface_z_depth(varray, tarray, depth, tnum,
-			     beyondp, beyond_tnump, toffset);
+  bool set;
+  Py_BEGIN_ALLOW_THREADS
+  set = surface_z_depth(varray, tarray, depth, tnum,
+			beyondp, beyond_tnump, toffset, threads);
+  Py_END_ALLOW_THREADS
 
   return python_bool(set);
 }
@@ -204,7 +266,7 @@ template <class T>
 void fill_slab(const FArray &depth, const FArray &depth2,
 	       float mijk_to_dijk[3][4],
 	       Reference_Counted_Array::Array<T> mvol,
-	       float depth_limit)
+	       float depth_limit, int threads)
 {
   int ksize = mvol.size(0), jsize = mvol.size(1), isize = mvol.size(2);
   int djsize = depth.size(0), disize = depth.size(1);
@@ -214,7 +276,9 @@ void fill_slab(const FArray &depth, const FArray &depth2,
   int64_t ms0 = mvol.stride(0), ms1 = mvol.stride(1), ms2 = mvol.stride(2);
   T *mv = mvol.values();
   float (*t)[4]  = mijk_to_dijk;
-  for (int k = 0 ; k < ksize ; ++k)
+  auto fill_planes = [&](int64_t k0, int64_t k1)
+    {
+  for (int k = k0 ; k < k1 ; ++k)
     for (int j = 0 ; j < jsize ; ++j)
       for (int i = 0 ; i < isize ; ++i)
 	{
@@ -234,6 +298,8 @@ void fill_slab(const FArray &depth, const FArray &depth2,
 		mv[k*ms0+j*ms1+i*ms2] = 1;
 	    }
 	}
+    };
+  thread_ranges(ksize, mvol.size(), threads, fill_planes);
 }
 
 // -----------------------------------------------------------------------------
@@ -241,18 +307,19 @@ void fill_slab(const FArray &depth, const FArray &depth2,
 extern "C" PyObject *py_fill_slab(PyObject *, PyObject *args, PyObject *keywds)
 {
   float mijk_to_dijk[3][4], depth_limit;
+  int threads = 1;
   FArray depth, depth2;
   Numeric_Array mvol;
   const char *kwlist[] = {"depth", "depth2", "mijk_to_dijk", "mvol",
-			  "depth_limit", NULL};
+			  "depth_limit", "threads", NULL};
   if (!PyArg_ParseTupleAndKeywords(args, keywds,
-				   const_cast<char *>("O&O&O&O&f"),
+				   const_cast<char *>("O&O&O&O&f|i"),
 				   const_cast<char **>(kwlist),
 				   parse_float_2d_array, &depth,
                                    parse_float_2d_array, &depth2,
 				   parse_float_3x4_array, &mijk_to_dijk,
 				   parse_3d_array, &mvol,
-                                   &depth_limit))
+                                   &depth_limit, &threads))
     return NULL;
 
   if (depth.size(0) != depth2.size(0) || depth.size(1) != depth2.size(1))
@@ -261,60 +328,117 @@ extern "C" PyObject *py_fill_slab(PyObject *, PyObject *args, PyObject *keywds)
       return NULL;
     }
 
+  Py_BEGIN_ALLOW_THREADS
   call_template_function(fill_slab, mvol.value_type(),
-			 (depth, depth2, mijk_to_dijk, mvol, depth_limit));
+			 (depth, depth2, mijk_to_dijk, mvol, depth_limit, threads));
+  Py_END_ALLOW_THREADS
 
   return python_none();
 }
 
 // -----------------------------------------------------------------------------
+// One dimensional city block distance pass along lines of n elements
+// spaced by stride, with distances capped at dmax.  A forward and backward
+// sweep gives the minimum over the line of d[j] + |i-j|.
 //
-template <class T>
-void pad_mask(Reference_Counted_Array::Array<T> mvol, int iter)
+template <class D>
+static void distance_line(D *d, int64_t n, int64_t stride, D dmax)
 {
-  int ksize = mvol.size(0), jsize = mvol.size(1), isize = mvol.size(2);
-  int ms0 = mvol.stride(0), ms1 = mvol.stride(1), ms2 = mvol.stride(2);
+  for (int64_t i = 1, p = stride ; i < n ; ++i, p += stride)
+    if (d[p-stride] < dmax && d[p-stride]+1 < d[p])
+      d[p] = d[p-stride]+1;
+  for (int64_t i = n-2, p = (n-2)*stride ; i >= 0 ; --i, p -= stride)
+    if (d[p+stride] < dmax && d[p+stride]+1 < d[p])
+      d[p] = d[p+stride]+1;
+}
+
+// -----------------------------------------------------------------------------
+// City block distance is the sum of axis distances, so the 3d distance
+// transform is three passes of the 1d transform, one along each axis.
+// Each pass costs O(N) independent of the pad width.
+//
+template <class T, class D>
+static void pad_mask_distance(Reference_Counted_Array::Array<T> &mvol, int iter,
+			      int threads)
+{
+  int64_t ksize = mvol.size(0), jsize = mvol.size(1), isize = mvol.size(2);
+  int64_t ms0 = mvol.stride(0), ms1 = mvol.stride(1), ms2 = mvol.stride(2);
+  int64_t n = ksize*jsize*isize;
   T *mv = mvol.values();
-  T b = 1, bn = 2;
-  for (int r = 0 ; r < iter ; ++r)
-    {
-      for (int k = 0, p = 0 ; k < ksize ; ++k, p += ms0 - jsize*ms1)
-	for (int j = 0 ; j < jsize ; ++j, p += ms1 - isize*ms2)
-	    for (int i = 0 ; i < isize ; ++i, p += ms2)
-	      if (mv[p] == b)
-		{
-		  if (i > 0 && mv[p-ms2] == 0) mv[p-ms2] = bn;
-		  if (i+1 < isize && mv[p+ms2] == 0) mv[p+ms2] = bn;
-		  if (j > 0 && mv[p-ms1] == 0) mv[p-ms1] = bn;
-		  if (j+1 < jsize && mv[p+ms1] == 0) mv[p+ms1] = bn;
-		  if (k > 0 && mv[p-ms0] == 0) mv[p-ms0] = bn;
-		  if (k+1 < ksize && mv[p+ms0] == 0) mv[p+ms0] = bn;
-		}
-      b += 1;
-      bn += 1;
-    }
+  D dmax = static_cast<D>(iter + 1);
+  std::vector<D> dist(n);
+  D *d = dist.data();
+  int64_t js = isize, ks = jsize*isize;
+
+  thread_ranges(ksize, n, threads, [&](int64_t k0, int64_t k1) {
+      for (int64_t k = k0 ; k < k1 ; ++k)
+	for (int64_t j = 0 ; j < jsize ; ++j)
+	  {
+	    const T *mrow = mv + k*ms0 + j*ms1;
+	    D *drow = d + k*ks + j*js;
+	    for (int64_t i = 0 ; i < isize ; ++i)
+	      drow[i] = (mrow[i*ms2] >= 1 ? 0 : dmax);
+	    distance_line(drow, isize, 1, dmax);
+	  }
+      for (int64_t k = k0 ; k < k1 ; ++k)
+	for (int64_t i = 0 ; i < isize ; ++i)
+	  distance_line(d + k*ks + i, jsize, js, dmax);
+    });
+
+  thread_ranges(jsize, n, threads, [&](int64_t j0, int64_t j1) {
+      for (int64_t j = j0 ; j < j1 ; ++j)
+	for (int64_t i = 0 ; i < isize ; ++i)
+	  distance_line(d + j*js + i, ksize, ks, dmax);
+    });
+
+  thread_ranges(ksize, n, threads, [&](int64_t k0, int64_t k1) {
+      for (int64_t k = k0 ; k < k1 ; ++k)
+	for (int64_t j = 0 ; j < jsize ; ++j)
+	  {
+	    T *mrow = mv + k*ms0 + j*ms1;
+	    const D *drow = d + k*ks + j*js;
+	    for (int64_t i = 0 ; i < isize ; ++i)
+	      if (drow[i] < dmax && mrow[i*ms2] == 0)
+		mrow[i*ms2] = 1;
+	      else if (mrow[i*ms2] >= 1)
+		mrow[i*ms2] = 1;
+	  }
+    });
+}
 
-  for (int k = 0, p = 0 ; k < ksize ; ++k, p += ms0 - jsize*ms1)
-    for (int j = 0 ; j < jsize ; ++j, p += ms1 - isize*ms2)
-      for (int i = 0 ; i < isize ; ++i, p += ms2)
-	if (mv[p] >= 1)
-	      mv[p] = 1;
+// -----------------------------------------------------------------------------
+// Set zero mask values within iter layers of 6-connected neighbor steps
+// of mask values >= 1 to 1, and set mask values >= 1 to 1.
+//
+template <class T>
+void pad_mask(Reference_Counted_Array::Array<T> mvol, int iter, int threads)
+{
+  if (iter < 0)
+    iter = 0;
+  if (iter < 255)
+    pad_mask_distance<T,unsigned char>(mvol, iter, threads);
+  else if (iter < 65535)
+    pad_mask_distance<T,unsigned short>(mvol, iter, threads);
+  else
+    pad_mask_distance<T,unsigned int>(mvol, iter, threads);
 }
 
 // -----------------------------------------------------------------------------
 //
 extern "C" PyObject *py_pad_mask(PyObject *, PyObject *args, PyObject *keywds)
 {
-  int iter = 1;
+  int iter = 1, threads = 1;
   Numeric_Array mvol;
-  const char *kwlist[] = {"volume", "iterations", NULL};
-  if (!PyArg_ParseTupleAndKeywords(args, keywds, const_cast<char *>("O&|i"),
+  const char *kwlist[] = {"volume", "iterations", "threads", NULL};
+  if (!PyArg_ParseTupleAndKeywords(args, keywds, const_cast<char *>("O&|ii"),
 				   const_cast<char **>(kwlist),
 				   parse_3d_array, &mvol,
-                                   &iter))
+                                   &iter, &threads))
     return NULL;
 
-  call_template_function(pad_mask, mvol.value_type(), (mvol, iter));
+  Py_BEGIN_ALLOW_THREADS
+  call_template_function(pad_mask, mvol.value_type(), (mvol, iter, threads));
+  Py_END_ALLOW_THREADS
 
   return python_none();
 }
@@ -75,9 +75,12 @@ def surfaces_z_depth(surfaces, depth, triangle_num,
   toffset = 0
   beyond_kw = {k:v for k,v in (('beyond', beyond), ('beyond_triangle_number', beyond_triangle_num)) if v is not None}
   from .mask_cpp import surface_z_depth
+  import os
+  threads = os.cpu_count() or 1
   for varray, tarray in surfaces:
     if surface_z_depth(varray, tarray, depth, triangle_num,
-                       triangle_number_offset = toffset, **beyond_kw):
+                       triangle_number_offset = toffset, threads = threads,
+                       **beyond_kw):
       set = True
     toffset += len(tarray)
   return set
@@ -106,7 +109,8 @@ def masked_volume(volume, surfaces,
   # Extend mask boundary by n voxels
   if extend:
     from .mask_cpp import pad_mask
-    pad_mask(mvol, extend)
+    import os
+    pad_mask(mvol, extend, threads = os.cpu_count() or 1)
 
   # Multiply ones mask times volume.
   mvol *= vol
@@ -229,6 +233,8 @@ def project_and_mask(zsurf, size, mvol, mijk_to_dijk, sandwich, fill_overlap):
     dlimit = 2*max_depth
   zsurfs = [[s] for s in zsurf] if fill_overlap else [zsurf]
   from .mask_cpp import fill_slab
+  import os
+  threads = os.cpu_count() or 1
   for zs in zsurfs:
     beyond = beyond_tnum = None
     max_layers = 200
@@ -241,7 +247,8 @@ def project_and_mask(zsurf, size, mvol, mijk_to_dijk, sandwich, fill_overlap):
       depth2.fill(max_depth)
       tnum2.fill(-1)
       surfaces_z_depth(zs, depth2, tnum2, depth, tnum)
-      fill_slab(depth, depth2, mijk_to_dijk.matrix, mvol, dlimit)
+      fill_slab(depth, depth2, mijk_to_dijk.matrix, mvol, dlimit,
+                threads = threads)
       beyond = depth2
       beyond_tnum = tnum2
 
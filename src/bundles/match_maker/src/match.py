@@ -34,21 +34,8 @@ default_ss_matrix = defaults['ss_scores']
 
 from chimerax.core.errors import UserError, LimitationError
 
-# called recursively, so any changes to calling signature need to happen
-# in recursive call too...
-def align(session, ref, match, matrix_name, algorithm, gap_open, gap_extend, dssp_cache,
-                    ss_matrix=defaults["ss_scores"],
-                    ss_fraction=defaults["ss_mixture"],
-                    gap_open_helix=defaults["helix_open"],
-                    gap_open_strand=defaults["strand_open"],
-                    gap_open_other=defaults["other_open"],
-                    compute_ss=defaults["compute_ss"],
-                    keep_computed_ss=defaults['overwrite_ss']):
-    from chimerax import sim_matrices
-    similarity_matrix = sim_matrices.matrix(matrix_name, session.logger)
-    ssf = ss_fraction
-    ssm = ss_matrix
-    if ssf is not None and ssf is not False and compute_ss:
+def _compute_needed_ss(ref, match, dssp_cache, ss_fraction, compute_ss, keep_computed_ss):
+    if ss_fraction is not None and ss_fraction is not False and compute_ss:
         need_compute = []
         if ref.structure not in dssp_cache:
             for r in ref.residues:
@@ -73,15 +60,57 @@ def align(session, ref, match, matrix_name, algorithm, gap_open, gap_extend, dss
                 if not keep_computed_ss and keep_computed_ss is not None:
                     s.ss_change_notify = False
                 dssp.compute_ss(s)
+
+def _nw_kw(similarity_matrix, gap_open, gap_extend, ss_matrix, ss_fraction, gap_open_helix,
+        gap_open_strand, gap_open_other):
+    return dict(score_gap=-gap_extend, score_gap_open=0-gap_open,
+        similarity_matrix=similarity_matrix, ss_matrix=ss_matrix, ss_fraction=ss_fraction,
+        gap_open_helix=-gap_open_helix, gap_open_strand=-gap_open_strand,
+        gap_open_other=-gap_open_other)
+
+def nw_align_many(session, seq_pairs, matrix_name, gap_open, gap_extend, dssp_cache,
+                    ss_matrix=defaults["ss_scores"],
+                    ss_fraction=defaults["ss_mixture"],
+                    gap_open_helix=defaults["helix_open"],
+                    gap_open_strand=defaults["strand_open"],
+                    gap_open_other=defaults["other_open"],
+                    compute_ss=defaults["compute_ss"],
+                    keep_computed_ss=defaults['overwrite_ss']):
+    """Needleman-Wunsch align many (ref, match) sequence pairs in parallel.
+       Returns results to pass to align() as its 'nw_result' argument, one per pair.
+    """
+    from chimerax import sim_matrices
+    similarity_matrix = sim_matrices.matrix(matrix_name, session.logger)
+    for ref, match in seq_pairs:
+        _compute_needed_ss(ref, match, dssp_cache, ss_fraction, compute_ss, keep_computed_ss)
+    from chimerax.alignment_algs import NeedlemanWunsch
+    return NeedlemanWunsch.nw_many(seq_pairs, return_seqs=True,
+        **_nw_kw(similarity_matrix, gap_open, gap_extend, ss_matrix, ss_fraction,
+        gap_open_helix, gap_open_strand, gap_open_other))
+
+# called recursively, so any changes to calling signature need to happen
+# in recursive call too...
+def align(session, ref, match, matrix_name, algorithm, gap_open, gap_extend, dssp_cache,
+                    ss_matrix=defaults["ss_scores"],
+                    ss_fraction=defaults["ss_mixture"],
+                    gap_open_helix=defaults["helix_open"],
+                    gap_open_strand=defaults["strand_open"],
+                    gap_open_other=defaults["other_open"],
+                    compute_ss=defaults["compute_ss"],
+                    keep_computed_ss=defaults['overwrite_ss'], nw_result=None):
+    # 'nw_result' is a result from nw_align_many() to use instead of aligning here
+    from chimerax import sim_matrices
+    similarity_matrix = sim_matrices.matrix(matrix_name, session.logger)
+    ssf = ss_fraction
+    ssm = ss_matrix
+    _compute_needed_ss(ref, match, dssp_cache, ss_fraction, compute_ss, keep_computed_ss)
     if algorithm == "nw":
-        from chimerax.alignment_algs import NeedlemanWunsch
-        score, seqs = NeedlemanWunsch.nw(ref, match,
-            score_gap=-gap_extend, score_gap_open=0-gap_open,
-            similarity_matrix=similarity_matrix, return_seqs=True,
-            ss_matrix=ss_matrix, ss_fraction=ss_fraction,
-            gap_open_helix=-gap_open_helix,
-            gap_open_strand=-gap_open_strand,
-            gap_open_other=-gap_open_other)
+        if nw_result is None:
+            from chimerax.alignment_algs import NeedlemanWunsch
+            nw_result = NeedlemanWunsch.nw(ref, match, return_seqs=True,
+                **_nw_kw(similarity_matrix, gap_open, gap_extend, ss_matrix, ss_fraction,
+                gap_open_helix, gap_open_strand, gap_open_other))
+        score, seqs = nw_result
         gapped_ref, gapped_match = seqs
     elif algorithm =="sw":
         def ss_let(r):
@@ -351,9 +380,14 @@ def match(session, chain_pairing, match_items, matrix, alg, gap_open, gap_extend
                         " %s compatible with %s similarity"
                         " matrix" % (match, matrix))
                 seqs = check_domain_matching(seqs, md_res)
-                for seq in seqs:
+                if alg == "nw":
+                    nw_results = nw_align_many(session, [(ref, seq) for seq in seqs], matrix,
+                        gap_open, gap_extend, dssp_cache, **align_kw)
+                else:
+                    nw_results = [None] * len(seqs)
+                for seq, nw_result in zip(seqs, nw_results):
                     score, s1, s2 = align(session, ref, seq, matrix, alg,
-                            gap_open, gap_extend, dssp_cache, **align_kw)
+                            gap_open, gap_extend, dssp_cache, nw_result=nw_result, **align_kw)
                     if best_score is None or score > best_score:
                         best_score = score
                         pairing = (score, s1, s2)
@@ -401,13 +435,19 @@ def match(session, chain_pairing, match_items, matrix, alg, gap_open, gap_extend
 
             for match, match_data in matches_data:
                 best_score = None
-                for mseq in match_data:
-                    for rseq in ref_data:
-                        score, s1, s2 = align(session, rseq, mseq,
-                            matrix, alg, gap_open, gap_extend, dssp_cache, **align_kw)
-                        if best_score is None or score > best_score:
-                            best_score = score
-                            pairing = (score,s1,s2)
+                seq_pairs = [(rseq, mseq) for mseq in match_data for rseq in ref_data]
+                if alg == "nw":
+                    nw_results = nw_align_many(session, seq_pairs, matrix, gap_open, gap_extend,
+                        dssp_cache, **align_kw)
+                else:
+                    nw_results = [None] * len(seq_pairs)
+                for (rseq, mseq), nw_result in zip(seq_pairs, nw_results):
+                    score, s1, s2 = align(session, rseq, mseq,
+                        matrix, alg, gap_open, gap_extend, dssp_cache, nw_result=nw_result,
+                        **align_kw)
+                    if best_score is None or score > best_score:
+                        best_score = score
+                        pairing = (score,s1,s2)
                 if best_score is None:
                     raise LimitationError(small_mol_err_msg)
                 pairings[match]= [pairing]
@@ -0,0 +1,455 @@
+/* include Python.h first, so that 64-bit file support is picked up & defined properly
+   before include stdio.h */
+
+#include <Python.h>
+#define NPY_NO_DEPRECATED_API NPY_1_7_API_VERSION
+#include <numpy/arrayobject.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <vector>
+#include <thread>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define PY_STUPID (char*)
+
+#define ERROR_RETURN(msg) { sprintf(error_string, msg); PyErr_SetString(PyExc_ValueError, error_string); return NULL; }
+#define ERROR_RETURN2(msg, arg1) { sprintf(error_string, msg, arg1); PyErr_SetString(PyExc_ValueError, error_string); return NULL; }
+#define ERROR_RETURN3(msg, arg1, arg2) { sprintf(error_string, msg, arg1, arg2); PyErr_SetString(PyExc_ValueError, error_string); return NULL; }
+
+// Read-only memory map of a whole file.  Frames are decoded straight from the
+// mapped pages, so threads share one map and nothing is copied through stdio.
+class Mapped_File
+{
+public:
+	Mapped_File(const char *path);
+	~Mapped_File();
+	bool mapped() const { return data != NULL; }
+	const unsigned char *data;
+	int64_t size;
+private:
+#ifdef _WIN32
+	HANDLE file, mapping;
+#else
+	int fd;
+#endif
+};
+
+#ifdef _WIN32
+Mapped_File::Mapped_File(const char *path) : data(NULL), size(0), mapping(NULL)
+{
+	file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+			   FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return;
+	LARGE_INTEGER s;
+	if (!GetFileSizeEx(file, &s) || s.QuadPart == 0)
+		return;
+	size = s.QuadPart;
+	mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mapping != NULL)
+		data = (const unsigned char *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+}
+
+Mapped_File::~Mapped_File()
+{
+	if (data)
+		UnmapViewOfFile(data);
+	if (mapping)
+		CloseHandle(mapping);
+	if (file != INVALID_HANDLE_VALUE)
+		CloseHandle(file);
+}
+#else
+Mapped_File::Mapped_File(const char *path) : data(NULL), size(0)
+{
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return;
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size == 0)
+		return;
+	size = st.st_size;
+	void *m = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (m != MAP_FAILED)
+		data = (const unsigned char *)m;
+}
+
+Mapped_File::~Mapped_File()
+{
+	if (data)
+		munmap((void *)data, size);
+	if (fd >= 0)
+		close(fd);
+}
+#endif
+
+// Layout of a DCD file found from its header.  Frames after the first have a
+// fixed size, so the offset of any frame is computed without scanning.
+struct DCD_Layout
+{
+	bool byte_swap;
+	int int_size;			// 4, or 8 for files with 64-bit header integers
+	int64_t num_atoms;
+	int64_t num_fixed;		// Atoms only given in the first frame
+	std::vector<int32_t> free_atoms;	// 0-based indices of atoms in each later frame
+	bool has_cell;			// CHARMM/NAMD unit cell record before each frame
+	int64_t istart, nsavc;
+	double delta;
+	int64_t first_frame;		// File offset
+	int64_t first_frame_size, frame_size;
+	int64_t num_frames;
+
+	int64_t frame_offset(int64_t f) const
+	  { return (f == 0 ? first_frame : first_frame + first_frame_size + (f-1) * frame_size); }
+	int64_t frame_atoms(int64_t f) const
+	  { return (f == 0 || num_fixed == 0 ? num_atoms : num_atoms - num_fixed); }
+};
+
+static inline uint32_t
+swap4(uint32_t v)
+{
+	return ((v >> 24) | ((v >> 8) & 0xff00) | ((v << 8) & 0xff0000) | (v << 24));
+}
+
+static inline int32_t
+get_int32(const unsigned char *p, bool swap)
+{
+	uint32_t v;
+	memcpy(&v, p, 4);
+	return (int32_t)(swap ? swap4(v) : v);
+}
+
+static inline int64_t
+get_int(const unsigned char *p, int size, bool swap)
+{
+	if (size == 4)
+		return get_int32(p, swap);
+	uint64_t v;
+	memcpy(&v, p, 8);
+	if (swap)
+		v = ((uint64_t)swap4((uint32_t)v) << 32) | swap4((uint32_t)(v >> 32));
+	return (int64_t)v;
+}
+
+static inline double
+get_double(const unsigned char *p, int size, bool swap)
+{
+	if (size == 4) {
+		uint32_t v = (uint32_t)get_int32(p, swap);
+		float f;
+		memcpy(&f, &v, 4);
+		return f;
+	}
+	int64_t v = get_int(p, 8, swap);
+	double d;
+	memcpy(&d, &v, 8);
+	return d;
+}
+
+// Parse the header, returning an error message or NULL.  The field layout
+// follows the VMD dcdplugin and the MDTools reader.
+static const char *
+parse_header(const Mapped_File &mf, DCD_Layout &dcd)
+{
+	const unsigned char *d = mf.data;
+	int64_t size = mf.size, p = 0;
+	if (size < 8)
+		return "file too short for DCD header";
+	int32_t rec = get_int32(d, false);
+	dcd.byte_swap = false;
+	if (rec != 84 && rec != 164) {
+		rec = get_int32(d, true);
+		if (rec != 84 && rec != 164)
+			return "not a DCD file, bad first record length";
+		dcd.byte_swap = true;
+	}
+	bool sw = dcd.byte_swap;
+	int is = dcd.int_size = (rec == 84 ? 4 : 8);
+	if (size < 4 + rec + 4 + 8 || memcmp(d + 4, "CORD", 4) != 0)
+		return "not a DCD coordinate file";
+	const unsigned char *h = d + 8;		// 20 header words after "CORD"
+	dcd.istart = get_int(h + is, is, sw);
+	dcd.nsavc = get_int(h + 2*is, is, sw);
+	dcd.num_fixed = get_int(h + 8*is, is, sw);
+	dcd.delta = get_double(h + 9*is, is, sw);
+	int64_t namd_flag = get_int(h + 10*is, is, sw);
+	dcd.has_cell = (namd_flag == 1);
+	p = 4 + rec;
+	if (get_int32(d + p, sw) != rec)
+		return "bad DCD header record end";
+	p += 4;
+
+	// Title record
+	int32_t tsize = get_int32(d + p, sw);
+	if (tsize < 4 || (tsize - 4) % 80 != 0 || p + 8 + tsize > size)
+		return "bad DCD title record";
+	if (get_int32(d + p + 4 + tsize, sw) != tsize)
+		return "bad DCD title record end";
+	p += 8 + tsize;
+
+	// Atom count record
+	if (p + 8 + is > size || get_int32(d + p, sw) != is || get_int32(d + p + 4 + is, sw) != is)
+		return "bad DCD atom count record";
+	dcd.num_atoms = get_int(d + p + 4, is, sw);
+	p += 8 + is;
+	if (dcd.num_atoms <= 0 || dcd.num_fixed < 0 || dcd.num_fixed >= dcd.num_atoms)
+		return "bad DCD atom count";
+
+	// Free atom indices when some atoms are fixed
+	dcd.free_atoms.clear();
+	if (dcd.num_fixed > 0) {
+		int64_t nfree = dcd.num_atoms - dcd.num_fixed;
+		if (p + 8 + nfree * is > size || get_int32(d + p, sw) != nfree * is)
+			return "bad DCD free atom record";
+		dcd.free_atoms.resize(nfree);
+		for (int64_t i = 0; i < nfree; ++i) {
+			int64_t a = get_int(d + p + 4 + i * is, is, sw) - 1;
+			if (a < 0 || a >= dcd.num_atoms)
+				return "DCD free atom index out of range";
+			dcd.free_atoms[i] = (int32_t)a;
+		}
+		p += 4 + nfree * is;
+		if (get_int32(d + p, sw) != nfree * is)
+			return "bad DCD free atom record end";
+		p += 4;
+	}
+
+	int64_t cell = (dcd.has_cell ? 56 : 0);
+	dcd.first_frame = p;
+	dcd.first_frame_size = cell + 3 * (8 + 4 * dcd.num_atoms);
+	dcd.frame_size = cell + 3 * (8 + 4 * dcd.frame_atoms(1));
+	if (size < p + dcd.first_frame_size)
+		dcd.num_frames = 0;
+	else
+		dcd.num_frames = 1 + (size - p - dcd.first_frame_size) / dcd.frame_size;
+	return NULL;
+}
+
+// Decode one axis record of n floats into every third value of xyz, or
+// into the listed atoms if atoms is not NULL.
+static bool
+decode_axis(const unsigned char *r, int64_t n, bool swap, const int32_t *atoms, float *xyz)
+{
+	if (get_int32(r, swap) != 4 * n || get_int32(r + 4 + 4 * n, swap) != 4 * n)
+		return false;
+	const unsigned char *v = r + 4;
+	for (int64_t i = 0; i < n; ++i, v += 4) {
+		uint32_t u;
+		memcpy(&u, v, 4);
+		if (swap)
+			u = swap4(u);
+		float x;
+		memcpy(&x, &u, 4);
+		xyz[3 * (atoms ? atoms[i] : i)] = x;
+	}
+	return true;
+}
+
+// Decode frames keeping only the subset atoms.  Frames with fixed atoms start
+// from a copy of the first frame.  Returns the index of the first bad frame,
+// or -1 if all frames are good.
+static int64_t
+read_frames(const Mapped_File &mf, const DCD_Layout &dcd, const int64_t *frames, int64_t nframes,
+	    const int32_t *subset, int64_t nsub, const float *first_frame, float *coords)
+{
+	int64_t n = dcd.num_atoms;
+	bool direct = (subset == NULL);
+	std::vector<float> xyz(direct ? 0 : 3 * n);
+	int64_t cell = (dcd.has_cell ? 56 : 0);
+	for (int64_t fi = 0; fi < nframes; ++fi) {
+		int64_t f = frames[fi];
+		float *c = coords + 3 * nsub * fi;
+		float *x = (direct ? c : xyz.data());
+		int64_t o = dcd.frame_offset(f), na = dcd.frame_atoms(f);
+		if (f < 0 || f >= dcd.num_frames || o + cell + 3 * (8 + 4 * na) > mf.size)
+			return f;
+		const unsigned char *r = mf.data + o;
+		if (cell && (get_int32(r, dcd.byte_swap) != 48 || get_int32(r + 52, dcd.byte_swap) != 48))
+			return f;
+		r += cell;
+		const int32_t *atoms = NULL;
+		if (na < n) {
+			memcpy(x, first_frame, 3 * n * sizeof(float));
+			atoms = dcd.free_atoms.data();
+		}
+		for (int a = 0; a < 3; ++a, r += 8 + 4 * na)
+			if (!decode_axis(r, na, dcd.byte_swap, atoms, x + a))
+				return f;
+		if (!direct)
+			for (int64_t i = 0; i < nsub; ++i, c += 3) {
+				const float *xi = x + 3 * subset[i];
+				c[0] = xi[0]; c[1] = xi[1]; c[2] = xi[2];
+			}
+	}
+	return -1;
+}
+
+static bool
+check_array(PyObject *a, int type, int ndim, const char *name, char *error_string)
+{
+	if (!PyArray_Check(a) || PyArray_TYPE((PyArrayObject *)a) != type
+	    || PyArray_NDIM((PyArrayObject *)a) != ndim
+	    || !PyArray_IS_C_CONTIGUOUS((PyArrayObject *)a)) {
+		sprintf(error_string, "%s must be a contiguous %dD numpy array of type %s",
+			name, ndim, (type == NPY_INT64 ? "int64" : (type == NPY_INT32 ? "int32" : "float32")));
+		PyErr_SetString(PyExc_TypeError, error_string);
+		return false;
+	}
+	return true;
+}
+
+static PyObject *
+dcd_header(PyObject *, PyObject *args)
+{
+	char error_string[256];
+
+	char *file_name;
+	if (!PyArg_ParseTuple(args, PY_STUPID "s", &file_name))
+		return NULL;
+
+	Mapped_File mf(file_name);
+	if (!mf.mapped())
+		ERROR_RETURN2("Could not open DCD file %.200s", file_name);
+	DCD_Layout dcd;
+	const char *error = parse_header(mf, dcd);
+	if (error)
+		ERROR_RETURN3("%s: %.200s", error, file_name);
+
+	npy_intp nfree = dcd.free_atoms.size();
+	PyObject *free_array = PyArray_SimpleNew(1, &nfree, NPY_INT32);
+	if (free_array == NULL)
+		return NULL;
+	if (nfree > 0)
+		memcpy(PyArray_DATA((PyArrayObject *)free_array), dcd.free_atoms.data(), nfree * sizeof(int32_t));
+
+	return Py_BuildValue(PY_STUPID "{s:L,s:L,s:N,s:O,s:O,s:L,s:L,s:d,s:L,s:L,s:L}",
+			     "num_atoms", (long long)dcd.num_atoms,
+			     "num_frames", (long long)dcd.num_frames,
+			     "free_atoms", free_array,
+			     "has_cell", (dcd.has_cell ? Py_True : Py_False),
+			     "byte_swap", (dcd.byte_swap ? Py_True : Py_False),
+			     "istart", (long long)dcd.istart,
+			     "nsavc", (long long)dcd.nsavc,
+			     "delta", dcd.delta,
+			     "first_frame_offset", (long long)dcd.first_frame,
+			     "first_frame_size", (long long)dcd.first_frame_size,
+			     "frame_size", (long long)dcd.frame_size);
+}
+
+static PyObject *
+read_dcd_frames(PyObject *, PyObject *args, PyObject *keywds)
+{
+	char error_string[256];
+
+	char *file_name;
+	int threads = 1;
+	PyObject *py_frames, *py_subset, *py_coords;
+	const char *kwlist[] = {"path", "frames", "atom_subset", "coords", "threads", NULL};
+	if (!PyArg_ParseTupleAndKeywords(args, keywds, PY_STUPID "sOOO|i", (char **)kwlist,
+					 &file_name, &py_frames, &py_subset, &py_coords, &threads))
+		return NULL;
+
+	if (!check_array(py_frames, NPY_INT64, 1, "frames", error_string) ||
+	    !check_array(py_coords, NPY_FLOAT, 3, "coords", error_string) ||
+	    (py_subset != Py_None && !check_array(py_subset, NPY_INT32, 1, "atom_subset", error_string)))
+		return NULL;
+
+	Mapped_File mf(file_name);
+	if (!mf.mapped())
+		ERROR_RETURN2("Could not open DCD file %.200s", file_name);
+	DCD_Layout dcd;
+	const char *error = parse_header(mf, dcd);
+	if (error)
+		ERROR_RETURN3("%s: %.200s", error, file_name);
+
+	PyArrayObject *coords = (PyArrayObject *)py_coords;
+	npy_intp nframes = PyArray_DIM((PyArrayObject *)py_frames, 0);
+	npy_intp nsub = (py_subset == Py_None ? dcd.num_atoms : PyArray_DIM((PyArrayObject *)py_subset, 0));
+	if (PyArray_DIM(coords, 0) != nframes || PyArray_DIM(coords, 1) != nsub || PyArray_DIM(coords, 2) != 3)
+		ERROR_RETURN("coords array must have size (frames, atoms, 3)");
+	if (!PyArray_ISWRITEABLE(coords))
+		ERROR_RETURN("coords array is read-only");
+	const int32_t *subset = NULL;
+	if (py_subset != Py_None) {
+		subset = (const int32_t *)PyArray_DATA((PyArrayObject *)py_subset);
+		for (npy_intp i = 0; i < nsub; ++i)
+			if (subset[i] < 0 || subset[i] >= dcd.num_atoms)
+				ERROR_RETURN("atom_subset index out of range");
+	}
+	const int64_t *frames = (const int64_t *)PyArray_DATA((PyArrayObject *)py_frames);
+	float *c = (float *)PyArray_DATA(coords);
+
+	int64_t bad_frame = -1;
+	Py_BEGIN_ALLOW_THREADS
+	// Frames with fixed atoms take the fixed positions from the first frame.
+	std::vector<float> first;
+	if (dcd.num_fixed > 0) {
+		first.resize(3 * dcd.num_atoms);
+		int64_t f0 = 0;
+		bad_frame = read_frames(mf, dcd, &f0, 1, NULL, dcd.num_atoms, NULL, first.data());
+	}
+
+	// Decode frames in parallel, each thread reading a contiguous range of frames.
+	if (threads > nframes)
+		threads = (nframes > 0 ? nframes : 1);
+	if (bad_frame < 0 && threads <= 1)
+		bad_frame = read_frames(mf, dcd, frames, nframes, subset, nsub, first.data(), c);
+	else if (bad_frame < 0) {
+		std::vector<std::thread> workers;
+		std::vector<int64_t> results(threads);
+		for (int t = 0; t < threads; ++t) {
+			npy_intp f0 = (nframes * t) / threads, f1 = (nframes * (t+1)) / threads;
+			workers.push_back(std::thread([=, &mf, &dcd, &first, &results] {
+				results[t] = read_frames(mf, dcd, frames + f0, f1 - f0, subset, nsub,
+							 first.data(), c + 3 * nsub * f0);
+			}));
+		}
+		for (auto &w: workers)
+			w.join();
+		for (auto r: results)
+			if (r >= 0 && bad_frame < 0)
+				bad_frame = r;
+	}
+	Py_END_ALLOW_THREADS
+	if (bad_frame >= 0)
+		ERROR_RETURN3("DCD frame %lld is truncated or corrupt: %.200s", (long long)bad_frame + 1, file_name);
+
+	Py_INCREF(Py_None);
+	return Py_None;
+}
+
+static PyMethodDef Methods[] =
+{
+	{PY_STUPID "dcd_header", dcd_header, METH_VARARGS, NULL},
+	{PY_STUPID "read_dcd_frames", (PyCFunction)read_dcd_frames,
+	 METH_VARARGS|METH_KEYWORDS, NULL},
+	{nullptr, nullptr, 0, nullptr}
+};
+
+static struct PyModuleDef dcd_def =
+{
+	PyModuleDef_HEAD_INIT,
+	"_dcd",
+	"Read CHARMM/NAMD DCD coordinates",
+	-1,
+	Methods,
+	nullptr,
+	nullptr,
+	nullptr,
+	nullptr
+};
+
+PyMODINIT_FUNC
+PyInit__dcd(void)
+{
+	import_array();
+	return PyModule_Create(&dcd_def);
+}
@@ -5,11 +5,13 @@
 #define NPY_NO_DEPRECATED_API NPY_1_7_API_VERSION
 #include <numpy/arrayobject.h>
 #include <stdio.h>
+#include <string.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <stdarg.h>
 #include <vector>
 #include <iostream>
+#include <thread>
 extern "C" {
 #include "xdrfile_xtc.h"
 #include "xdrfile_trr.h"
@@ -141,10 +143,233 @@ readTrrFile(PyObject *, PyObject *args)
 }
 
 
+#define XTC_MAGIC 1995
+
+// Find the byte offset of each XTC frame reading only the frame headers and
+// skipping over the compressed coordinates.  A truncated last frame is omitted.
+static int
+xtc_frame_offsets(XDRFILE *xd, int num_atoms, std::vector<long long> &offsets)
+{
+	if (xdr_seek(xd, 0, SEEK_END) != 0)
+		return exdrNR;
+	long long file_size = xdr_tell(xd);
+	xdr_seek(xd, 0, SEEK_SET);
+	while (true) {
+		long long pos = xdr_tell(xd);
+		int header[3];	// magic, natoms, step
+		if (xdrfile_read_int(header, 3, xd) != 3)
+			break;
+		if (header[0] != XTC_MAGIC)
+			return exdrMAGIC;
+		if (header[1] != num_atoms)
+			return exdrINT;
+		// time, 3x3 box, coordinate count, then raw floats for 9 or fewer atoms
+		// or precision, int bounds, small index and compressed byte count.
+		long long skip = 4 + 36 + 4;
+		if (num_atoms <= 9)
+			skip += 12 * (long long)num_atoms;
+		else {
+			skip += 4 + 24 + 4;
+			if (xdr_seek(xd, skip, SEEK_CUR) != 0)
+				break;
+			int nbytes;
+			if (xdrfile_read_int(&nbytes, 1, xd) != 1)
+				break;
+			skip = (nbytes + 3) & ~3;
+		}
+		if (xdr_seek(xd, skip, SEEK_CUR) != 0 || xdr_tell(xd) > file_size)
+			break;
+		offsets.push_back(pos);
+	}
+	return exdrOK;
+}
+
+// TRR frames are not compressed, so read them in sequence to find offsets.
+static int
+trr_frame_offsets(XDRFILE *xd, int num_atoms, std::vector<long long> &offsets)
+{
+	int step;
+	float time, lambda;
+	matrix box;
+	while (true) {
+		long long pos = xdr_tell(xd);
+		// trr doesn't return proper end-of-file status
+		if (read_trr(xd, num_atoms, &step, &time, &lambda, box, NULL, NULL, NULL) != exdrOK)
+			break;
+		offsets.push_back(pos);
+	}
+	return exdrOK;
+}
+
+static PyObject *
+trajectory_frame_offsets(PyObject *, PyObject *args)
+{
+	char error_string[256];
+
+	char *file_name;
+	int is_xtc;
+	if (!PyArg_ParseTuple(args, PY_STUPID "sp", &file_name, &is_xtc))
+		return NULL;
+
+	int num_atoms, status;
+	const char *format = (is_xtc ? "xtc" : "trr");
+	if (is_xtc)
+		status = read_xtc_natoms(file_name, &num_atoms);
+	else
+		status = read_trr_natoms(file_name, &num_atoms);
+	if (status != exdrOK)
+		ERROR_RETURN3("read_%s_natoms failure; return code %d", format, status);
+
+	XDRFILE *xd = xdrfile_open(file_name, "r");
+	if (xd == NULL)
+		ERROR_RETURN("xdrfile_open failure");
+	std::vector<long long> offsets;
+	Py_BEGIN_ALLOW_THREADS
+	if (is_xtc)
+		status = xtc_frame_offsets(xd, num_atoms, offsets);
+	else
+		status = trr_frame_offsets(xd, num_atoms, offsets);
+	Py_END_ALLOW_THREADS
+	xdrfile_close(xd);
+	if (status != exdrOK)
+		ERROR_RETURN3("%s frame index failure; return code %d", format, status);
+
+	npy_intp n = offsets.size();
+	PyObject *offset_array = PyArray_SimpleNew(1, &n, NPY_INT64);
+	if (offset_array == NULL)
+		return NULL;
+	npy_int64 *o = (npy_int64 *)PyArray_DATA((PyArrayObject *)offset_array);
+	for (npy_intp i = 0; i < n; ++i)
+		o[i] = offsets[i];
+
+	return Py_BuildValue(PY_STUPID "iN", num_atoms, offset_array);
+}
+
+// Decode frames at the given offsets keeping only the subset atoms.
+static int
+read_frames(const char *file_name, bool is_xtc, int num_atoms, const npy_int64 *offsets,
+	    npy_intp nframes, const npy_int32 *subset, npy_intp nsub, float *coords)
+{
+	XDRFILE *xd = xdrfile_open(file_name, "r");
+	if (xd == NULL)
+		return exdrFILENOTFOUND;
+	std::vector<float> crds(3 * (size_t)num_atoms);
+	rvec *x = (rvec *)crds.data();
+	int step, status = exdrOK;
+	float time, precision, lambda;
+	matrix box;
+	for (npy_intp f = 0; f < nframes; ++f) {
+		if (xdr_seek(xd, offsets[f], SEEK_SET) != 0) {
+			status = exdrNR;
+			break;
+		}
+		if (is_xtc)
+			status = read_xtc(xd, num_atoms, &step, &time, box, x, &precision);
+		else
+			status = read_trr(xd, num_atoms, &step, &time, &lambda, box, x, NULL, NULL);
+		if (status != exdrOK)
+			break;
+		float *c = coords + 3 * nsub * f;
+		if (subset == NULL)
+			memcpy(c, x, 3 * nsub * sizeof(float));
+		else
+			for (npy_intp i = 0; i < nsub; ++i, c += 3) {
+				float *xi = x[subset[i]];
+				c[0] = xi[0]; c[1] = xi[1]; c[2] = xi[2];
+			}
+	}
+	xdrfile_close(xd);
+	return status;
+}
+
+static bool
+check_array(PyObject *a, int type, int ndim, const char *name, char *error_string)
+{
+	if (!PyArray_Check(a) || PyArray_TYPE((PyArrayObject *)a) != type
+	    || PyArray_NDIM((PyArrayObject *)a) != ndim
+	    || !PyArray_IS_C_CONTIGUOUS((PyArrayObject *)a)) {
+		sprintf(error_string, "%s must be a contiguous %dD numpy array of type %s",
+			name, ndim, (type == NPY_INT64 ? "int64" : (type == NPY_INT32 ? "int32" : "float32")));
+		PyErr_SetString(PyExc_TypeError, error_string);
+		return false;
+	}
+	return true;
+}
+
+static PyObject *
+read_trajectory_frames(PyObject *, PyObject *args, PyObject *keywds)
+{
+	char error_string[256];
+
+	char *file_name;
+	int is_xtc, num_atoms, threads = 1;
+	PyObject *py_offsets, *py_subset, *py_coords;
+	const char *kwlist[] = {"path", "is_xtc", "num_atoms", "frame_offsets", "atom_subset",
+				"coords", "threads", NULL};
+	if (!PyArg_ParseTupleAndKeywords(args, keywds, PY_STUPID "spiOOO|i", (char **)kwlist,
+					 &file_name, &is_xtc, &num_atoms, &py_offsets, &py_subset,
+					 &py_coords, &threads))
+		return NULL;
+
+	if (!check_array(py_offsets, NPY_INT64, 1, "frame_offsets", error_string) ||
+	    !check_array(py_coords, NPY_FLOAT, 3, "coords", error_string) ||
+	    (py_subset != Py_None && !check_array(py_subset, NPY_INT32, 1, "atom_subset", error_string)))
+		return NULL;
+	PyArrayObject *coords = (PyArrayObject *)py_coords;
+	npy_intp nframes = PyArray_DIM((PyArrayObject *)py_offsets, 0);
+	npy_intp nsub = (py_subset == Py_None ? num_atoms : PyArray_DIM((PyArrayObject *)py_subset, 0));
+	if (PyArray_DIM(coords, 0) != nframes || PyArray_DIM(coords, 1) != nsub || PyArray_DIM(coords, 2) != 3)
+		ERROR_RETURN("coords array must have size (frames, atoms, 3)");
+	if (!PyArray_ISWRITEABLE(coords))
+		ERROR_RETURN("coords array is read-only");
+	const npy_int32 *subset = NULL;
+	if (py_subset != Py_None) {
+		subset = (const npy_int32 *)PyArray_DATA((PyArrayObject *)py_subset);
+		for (npy_intp i = 0; i < nsub; ++i)
+			if (subset[i] < 0 || subset[i] >= num_atoms)
+				ERROR_RETURN("atom_subset index out of range");
+	}
+	const npy_int64 *offsets = (const npy_int64 *)PyArray_DATA((PyArrayObject *)py_offsets);
+	float *c = (float *)PyArray_DATA(coords);
+
+	// Decode frames in parallel, each thread reading a contiguous range of frames.
+	int status = exdrOK;
+	Py_BEGIN_ALLOW_THREADS
+	if (threads > nframes)
+		threads = (nframes > 0 ? nframes : 1);
+	if (threads <= 1)
+		status = read_frames(file_name, is_xtc, num_atoms, offsets, nframes, subset, nsub, c);
+	else {
+		std::vector<std::thread> workers;
+		std::vector<int> results(threads);
+		for (int t = 0; t < threads; ++t) {
+			npy_intp f0 = (nframes * t) / threads, f1 = (nframes * (t+1)) / threads;
+			workers.push_back(std::thread([=, &results] {
+				results[t] = read_frames(file_name, is_xtc, num_atoms, offsets + f0, f1 - f0,
+							 subset, nsub, c + 3 * nsub * f0);
+			}));
+		}
+		for (auto &w: workers)
+			w.join();
+		for (auto r: results)
+			if (r != exdrOK)
+				status = r;
+	}
+	Py_END_ALLOW_THREADS
+	if (status != exdrOK)
+		ERROR_RETURN3("read_%s failure; return code %d", (is_xtc ? "xtc" : "trr"), status);
+
+	Py_INCREF(Py_None);
+	return Py_None;
+}
+
 static PyMethodDef Methods[] =
 {
 	{PY_STUPID "read_xtc_file", readXtcFile, METH_VARARGS, NULL},
 	{PY_STUPID "read_trr_file", readTrrFile, METH_VARARGS, NULL},
+	{PY_STUPID "trajectory_frame_offsets", trajectory_frame_offsets, METH_VARARGS, NULL},
+	{PY_STUPID "read_trajectory_frames", (PyCFunction)read_trajectory_frames,
+	 METH_VARARGS|METH_KEYWORDS, NULL},
 	{nullptr, nullptr, 0, nullptr}
 };
 
@@ -0,0 +1,82 @@
+# vim: set expandtab shiftwidth=4 softtabstop=4:
+
+# === UCSF ChimeraX Copyright ===
+# Copyright 2022 Regents of the University of California. All rights reserved.
+# The ChimeraX application is provided pursuant to the ChimeraX license
+# agreement, which covers academic and commercial uses. For more details, see
+# <http://www.rbvi.ucsf.edu/chimerax/docs/licensing.html>
+#
+# This particular file is part of the ChimeraX library. You can also
+# redistribute and/or modify it under the terms of the GNU Lesser General
+# Public License version 2.1 as published by the Free Software Foundation.
+# For more details, see
+# <https://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>
+#
+# THIS SOFTWARE IS PROVIDED "AS IS" WITHOUT WARRANTY OF ANY KIND, EITHER
+# EXPRESSED OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+# OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. ADDITIONAL LIABILITY
+# LIMITATIONS ARE DESCRIBED IN THE GNU LESSER GENERAL PUBLIC LICENSE
+# VERSION 2.1
+#
+# This notice must be embedded in or attached to all copies, including partial
+# copies, of the software or any revisions or derivations thereof.
+# === UCSF ChimeraX Copyright ===
+
+
+class DCDTrajectory:
+    '''
+    Read frames of a CHARMM, NAMD or X-PLOR DCD trajectory on demand.  All
+    frames after the first have the same size, so the header gives the offset
+    of every frame and no index needs to be built.  Frames are decoded in C++
+    from a memory map of the file.
+    '''
+
+    def __init__(self, path):
+        self.path = path
+        from ._dcd import dcd_header
+        h = dcd_header(path)
+        self.num_atoms = h['num_atoms']
+        self.num_frames = h['num_frames']
+        self.free_atoms = h['free_atoms']	# Atoms in each frame after the first, if some are fixed
+        self.has_cell = h['has_cell']
+        self.byte_swap = h['byte_swap']
+        self.timestep = h['delta']
+        self._first_frame_offset = h['first_frame_offset']
+        self._first_frame_size = h['first_frame_size']
+        self._frame_size = h['frame_size']
+
+    @property
+    def num_fixed(self):
+        return 0 if len(self.free_atoms) == 0 else self.num_atoms - len(self.free_atoms)
+
+    def frame_offsets(self, start = 0, stop = None, step = 1):
+        '''File offsets of frames range(start, stop, step), only valid with no fixed atoms.'''
+        from numpy import arange, int64
+        f = arange(self.num_frames, dtype = int64)[start:stop:step]
+        return self._first_frame_offset + f * self._frame_size
+
+    def axis_offsets(self):
+        '''Offset of the x, y and z float32 values from the start of a frame.'''
+        # Each axis is a Fortran record: 4 byte length, n values, 4 byte length.
+        c = 56 if self.has_cell else 0
+        n = self.num_atoms
+        return (c + 4, c + 12 + 4*n, c + 20 + 8*n)
+
+    def read_frames(self, start = 0, stop = None, step = 1, atom_subset = None, coords = None):
+        '''
+        Return a float32 array of size (frames, atoms, 3) with coordinates in
+        Angstroms for frames range(start, stop, step).  Only the atoms with
+        indices in atom_subset are returned if it is given.  Frames are decoded
+        in parallel directly into the coords array if it is given.
+        '''
+        from numpy import arange, empty, float32, int32, int64, ascontiguousarray
+        frames = arange(self.num_frames, dtype = int64)[start:stop:step]
+        if atom_subset is not None:
+            atom_subset = ascontiguousarray(atom_subset, int32)
+        natoms = self.num_atoms if atom_subset is None else len(atom_subset)
+        if coords is None:
+            coords = empty((len(frames), natoms, 3), float32)
+        from ._dcd import read_dcd_frames
+        import os
+        read_dcd_frames(self.path, frames, atom_subset, coords, threads = os.cpu_count() or 1)
+        return coords
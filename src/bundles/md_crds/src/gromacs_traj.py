@@ -0,0 +1,101 @@
+# vim: set expandtab shiftwidth=4 softtabstop=4:
+
+# === UCSF ChimeraX Copyright ===
+# Copyright 2022 Regents of the University of California. All rights reserved.
+# The ChimeraX application is provided pursuant to the ChimeraX license
+# agreement, which covers academic and commercial uses. For more details, see
+# <http://www.rbvi.ucsf.edu/chimerax/docs/licensing.html>
+#
+# This particular file is part of the ChimeraX library. You can also
+# redistribute and/or modify it under the terms of the GNU Lesser General
+# Public License version 2.1 as published by the Free Software Foundation.
+# For more details, see
+# <https://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>
+#
+# THIS SOFTWARE IS PROVIDED "AS IS" WITHOUT WARRANTY OF ANY KIND, EITHER
+# EXPRESSED OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+# OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. ADDITIONAL LIABILITY
+# LIMITATIONS ARE DESCRIBED IN THE GNU LESSER GENERAL PUBLIC LICENSE
+# VERSION 2.1
+#
+# This notice must be embedded in or attached to all copies, including partial
+# copies, of the software or any revisions or derivations thereof.
+# === UCSF ChimeraX Copyright ===
+
+
+class GromacsTrajectory:
+    '''
+    Read frames of a Gromacs xtc or trr trajectory on demand.  A frame index
+    giving the byte offset of each frame is built the first time a file is
+    opened and saved beside the trajectory file so later opens are fast.
+    '''
+
+    INDEX_VERSION = 1
+
+    def __init__(self, path, format_name):
+        if format_name not in ("xtc", "trr"):
+            raise ValueError("Unknown Gromacs trajectory format: %s" % format_name)
+        self.path = path
+        self.format_name = format_name
+        self.num_atoms, self.frame_offsets = self._frame_index()
+
+    @property
+    def num_frames(self):
+        return len(self.frame_offsets)
+
+    def read_frames(self, start = 0, stop = None, step = 1, atom_subset = None, coords = None):
+        '''
+        Return a float32 array of size (frames, atoms, 3) with coordinates in
+        nanometers for frames range(start, stop, step).  Only the atoms with
+        indices in atom_subset are returned if it is given.  Frames are decoded
+        in parallel directly into the coords array if it is given.
+        '''
+        from numpy import empty, float32, int32, ascontiguousarray
+        offsets = ascontiguousarray(self.frame_offsets[start:stop:step])
+        if atom_subset is not None:
+            atom_subset = ascontiguousarray(atom_subset, int32)
+        natoms = self.num_atoms if atom_subset is None else len(atom_subset)
+        if coords is None:
+            coords = empty((len(offsets), natoms, 3), float32)
+        from ._gromacs import read_trajectory_frames
+        import os
+        read_trajectory_frames(self.path, self.format_name == "xtc", self.num_atoms,
+                               offsets, atom_subset, coords, threads = os.cpu_count() or 1)
+        return coords
+
+    def _frame_index(self):
+        index = self._read_cached_index()
+        if index is None:
+            from ._gromacs import trajectory_frame_offsets
+            index = trajectory_frame_offsets(self.path, self.format_name == "xtc")
+            self._write_cached_index(*index)
+        return index
+
+    @property
+    def _index_path(self):
+        return self.path + '.cxindex.npy'
+
+    def _file_stamp(self):
+        import os
+        st = os.stat(self.path)
+        return (self.INDEX_VERSION, st.st_size, st.st_mtime_ns)
+
+    def _read_cached_index(self):
+        # Header values are index version, file size, file modification time, atom count.
+        from numpy import load
+        try:
+            a = load(self._index_path)
+        except (OSError, ValueError):
+            return None
+        if len(a) < 4 or tuple(a[:3]) != self._file_stamp():
+            return None
+        return int(a[3]), a[4:]
+
+    def _write_cached_index(self, num_atoms, offsets):
+        from numpy import concatenate, array, int64, save
+        a = concatenate((array(self._file_stamp() + (num_atoms,), int64), offsets))
+        try:
+            with open(self._index_path, 'wb') as f:
+                save(f, a)
+        except OSError:
+            pass        # Can't write beside trajectory, e.g. read-only directory.
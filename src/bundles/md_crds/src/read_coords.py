@@ -26,24 +26,19 @@ from chimerax.core.errors import UserError
 
 def read_coords(session, file_name, model, format_name, *, replace=True, start=1, step=1, end=None):
     from numpy import array, float64
-    if format_name == "xtc":
-        from ._gromacs import read_xtc_file
-        session.logger.status("Reading Gromacs xtc coordinates", blank_after=0)
-        num_atoms, coords_list = read_xtc_file(file_name)
-        coords = array(coords_list, dtype=float64)
-        coords *= 10.0
-        session.logger.status("Finished reading Gromacs xtc coordinates")
-    elif format_name == "trr":
-        from ._gromacs import read_trr_file
-        session.logger.status("Reading Gromacs trr coordinates", blank_after=0)
-        num_atoms, coords_list = read_trr_file(file_name)
-        coords = array(coords_list, dtype=float64)
-        coords *= 10.0
-        session.logger.status("Finished reading Gromacs trr coordinates")
+    if format_name in ("xtc", "trr"):
+        session.logger.status("Reading Gromacs %s coordinates" % format_name, blank_after=0)
+        num_frames = _set_model_gromacs_coordinates(session, model, file_name, format_name,
+            replace, start, step, end)
+        session.logger.status("Finished reading Gromacs %s coordinates" % format_name)
+        return num_frames
     elif format_name == "dcd":
-        from .dcd.MDToolsMarch97.md_DCD import DCD
+        from .dcd_traj import DCDTrajectory
         session.logger.status("Reading DCD coordinates", blank_after=0)
-        dcd = DCD(file_name)
+        try:
+            dcd = DCDTrajectory(file_name)
+        except ValueError as e:
+            raise UserError(str(e))
         num_frames = _set_model_dcd_coordinates(session, model, dcd, replace, start, step, end)
         session.logger.status("Finished reading DCD coordinates")
         return num_frames
@@ -78,23 +73,63 @@ def process_limit_args(session, start, step, end, num_coords):
         session.logger.info("start: %d, step: %d, end %d" % (start+1, step, end))
     return start, step, end
 
+# Frames are decoded and added to the model in chunks of about this size.
+GROMACS_CHUNK_BYTES = 2**28
+DCD_CHUNK_BYTES = 2**28
+
+def _set_model_gromacs_coordinates(session, model, file_name, format_name, replace, start, step, end):
+    '''Read only the requested xtc or trr frames, adding them to the model in chunks.'''
+    from .gromacs_traj import GromacsTrajectory
+    traj = GromacsTrajectory(file_name, format_name)
+    num_atoms = traj.num_atoms
+    if model.num_atoms != num_atoms:
+        raise UserError("Specified structure has %d atoms"
+            " whereas the coordinates are for %d atoms" % (model.num_atoms, num_atoms))
+    start, step, end = process_limit_args(session, start, step, end, traj.num_frames)
+    frames = range(start, end, step)
+    chunk = max(1, GROMACS_CHUNK_BYTES // (24 * max(1, num_atoms)))
+    from numpy import float64
+    for i in range(0, len(frames), chunk):
+        f = frames[i:i+chunk]
+        coords = traj.read_frames(f.start, f.stop, f.step).astype(float64)
+        coords *= 10.0      # nanometers to Angstroms
+        model.add_coordsets(coords, replace=(replace and i == 0))
+    return len(frames)
+
 def _set_model_dcd_coordinates(session, model, dcd, replace, start, step, end):
-    '''Read DCD coordinates and add to model efficiently when there are thousands of frames.'''
-    num_atoms = dcd.numatoms
+    '''Read only the requested DCD frames, adding them to the model in chunks.'''
+    num_atoms = dcd.num_atoms
     if model.num_atoms != num_atoms:
-        from chimerax.core.errors import UserError
         raise UserError("Specified structure has %d atoms"
             " whereas the coordinates are for %d atoms" % (model.num_atoms, num_atoms))
-    start, step, end = process_limit_args(session, start, step, end, dcd.numframes)
-    if replace:
-        model.remove_coordsets()
-        base = 1
-    else:
+    start, step, end = process_limit_args(session, start, step, end, dcd.num_frames)
+    if _read_dcd_lazily(dcd, start, step, end):
+        return _set_model_dcd_trajectory(model, dcd, replace, start, step, end)
+    frames = range(start, end, step)
+    chunk = max(1, DCD_CHUNK_BYTES // (24 * max(1, num_atoms)))
+    from numpy import float64
+    for i in range(0, len(frames), chunk):
+        f = frames[i:i+chunk]
+        coords = dcd.read_frames(f.start, f.stop, f.step).astype(float64)
+        model.add_coordsets(coords, replace=(replace and i == 0))
+    return len(frames)
+
+# Read frames from the file as they are used when the trajectory is this large.
+LAZY_TRAJECTORY_MIN_BYTES = 2**31
+
+def _read_dcd_lazily(dcd, start, step, end):
+    num_frames = len(range(start, end, step))
+    return dcd.num_fixed == 0 and num_frames * dcd.num_atoms * 24 >= LAZY_TRAJECTORY_MIN_BYTES
+
+def _set_model_dcd_trajectory(model, dcd, replace, start, step, end):
+    '''Add DCD frames as coordinate sets that read the file when first used.'''
+    frame_offsets = dcd.frame_offsets(start, end, step)
+    if not replace:
         base = max(model.coordset_ids) + 1
-    from numpy import asarray, float64
-    num_frames = 0
-    for i in range(start, end, step):
-        model.add_coordset(base+num_frames, asarray(dcd[i], float64, order = 'C'))
-        num_frames += 1
-    model.active_coordset_id = base
-    return num_frames
+    from numpy import float32
+    model.add_trajectory_coordsets(dcd.path, frame_offsets, dcd.num_atoms, dcd.axis_offsets(), 4,
+                                   value_type = float32, byte_swap = dcd.byte_swap,
+                                   replace = replace)
+    if not replace:
+        model.active_coordset_id = base
+    return len(frame_offsets)
@@ -34,71 +34,74 @@
 
 #include <math.h>			// use sqrtf(), expf()
 #include <string.h>			// use strcmp()
+#include <vector>			// use std::vector
 
 #include <arrays/pythonarray.h>		// use array_from_python()
 #include <arrays/rcarray.h>		// use FArray, IArray
+#include <arrays/threadpool.h>		// use Thread_Pool::thread_count(), run()
 
 inline int max(int a, int b) { return (a < b ? b : a); }
 inline int min(int a, int b) { return (a < b ? a : b); }
 
+enum Lipophilicity_Method { Fauchere, Brasseur, Buckingham, Dubost, Type5, Unknown };
+
 // ----------------------------------------------------------------------------
+// Grid index bounds of the points within max_dist of each atom.
 //
-static void lipophilicity_sum(const FArray &xyz, const FArray &fi,
-			      float origin[3], float spacing, float max_dist, float nexp,
-			      const char *method,  FArray &pot)
+class Atom_Box
+{
+public:
+  float x, y, z, f;
+  int imin, imax, jmin, jmax, kmin, kmax;
+};
+
+// ----------------------------------------------------------------------------
+// Add contributions of the atoms to grid planes k0 to k1-1.  Each grid point
+// sums atoms in the same order however the planes are divided among threads.
+//
+static void lipophilicity_sum_planes(const std::vector<Atom_Box> &boxes, int k0, int k1,
+				     float origin[3], float spacing, float max_dist, float nexp,
+				     Lipophilicity_Method method, FArray &pot)
 {
   float x0 = origin[0], y0 = origin[1], z0 = origin[2];
-  int na = xyz.size(0);
-  long xs0 = xyz.stride(0), xs1 = xyz.stride(1);
-  const float *xyza = xyz.values();
-  int nz = pot.size(0), ny = pot.size(1), nx = pot.size(2);
   long ps0 = pot.stride(0), ps1 = pot.stride(1), ps2 = pot.stride(2);
   float *pa = pot.values();
-  long fs0 = fi.stride(0);
-  const float *fa = fi.values();
-  int md = int(ceil(max_dist / spacing));
-  bool fauchere = (strcmp(method, "fauchere") == 0);
-  bool brasseur = (strcmp(method, "brasseur") == 0);
-  bool buckingham = (strcmp(method, "buckingham") == 0);
-  bool dubost = (strcmp(method, "dubost") == 0);
-  bool type5 = (strcmp(method, "type5") == 0);
-  for (int a = 0 ; a < na ; ++a)
+  float max_dist2 = max_dist * max_dist;
+  for (auto &b : boxes)
     {
-      const float *xa = xyza + xs0*a;
-      float ax = *xa, ay = xa[xs1], az = xa[2*xs1];
-      float f = 100 * fa[fs0*a];
-      float i0 = (ax-x0)/spacing, j0 = (ay-y0)/spacing, k0 = (az-z0)/spacing;
-      int kmin = max(0,int(floor(k0-md))), kmax = min(nz-1,int(ceil(k0+md)));
-      int jmin = max(0,int(floor(j0-md))), jmax = min(ny-1,int(ceil(j0+md)));
-      int imin = max(0,int(floor(i0-md))), imax = min(nx-1,int(ceil(i0+md)));
+      int kmin = max(k0, b.kmin), kmax = min(k1-1, b.kmax);
+      float ax = b.x, ay = b.y, az = b.z, f = b.f;
       for (int k = kmin ; k <= kmax ; ++k)
 	{
 	  float gz = z0 + k * spacing;
-	  for (int j = jmin ; j <= jmax ; ++j)
+	  float dz = az-gz;
+	  for (int j = b.jmin ; j <= b.jmax ; ++j)
 	    {
 	      float gy = y0 + j * spacing;
-	      for (int i = imin ; i <= imax ; ++i)
+	      float dy = ay-gy;
+	      float dyz2 = dy*dy + dz*dz;
+	      if (dyz2 > max_dist2)
+		continue;
+	      float *prow = pa + ps0*k + ps1*j;
+	      for (int i = b.imin ; i <= b.imax ; ++i)
 		{
 		  // Evaluation of the distance between the grid point and each atoms
 		  float gx = x0 + i * spacing;
-		  float dx = ax-gx, dy = ay-gy, dz = az-gz;
-		  float d = sqrtf(dx*dx + dy*dy + dz*dz);
+		  float dx = ax-gx;
+		  float d = sqrtf(dx*dx + dyz2);
 		  if (d <= max_dist)
 		    {
 		      float p;
-		      if (fauchere)
-			p = expf(-d);
-		      else if (brasseur)
-			p = expf(-d/3.1);
-		      else if (buckingham)
-			p = 1.0/pow(d,nexp);
-		      else if (dubost)
-			p = 1.0/(1+d);
-		      else if (type5)
-			p = expf(-sqrtf(d));
-		      else
-			p = 0;
-		      pa[ps0*k+ps1*j+ps2*i] += f*p;
+		      switch (method)
+			{
+			case Fauchere:	 p = expf(-d); break;
+			case Brasseur:	 p = expf(-d/3.1); break;
+			case Buckingham: p = 1.0/pow(d,nexp); break;
+			case Dubost:	 p = 1.0/(1+d); break;
+			case Type5:	 p = expf(-sqrtf(d)); break;
+			default:	 p = 0;
+			}
+		      prow[ps2*i] += f*p;
 		    }
 		}
 	    }
@@ -106,6 +109,62 @@ static void lipophilicity_sum(const FArray &xyz, const FArray &fi,
     }
 }
 
+// ----------------------------------------------------------------------------
+//
+static void lipophilicity_sum(const FArray &xyz, const FArray &fi,
+			      float origin[3], float spacing, float max_dist, float nexp,
+			      const char *method, int num_threads, FArray &pot)
+{
+  float x0 = origin[0], y0 = origin[1], z0 = origin[2];
+  int na = xyz.size(0);
+  long xs0 = xyz.stride(0), xs1 = xyz.stride(1);
+  const float *xyza = xyz.values();
+  int nz = pot.size(0), ny = pot.size(1), nx = pot.size(2);
+  long fs0 = fi.stride(0);
+  const float *fa = fi.values();
+  int md = int(ceil(max_dist / spacing));
+  Lipophilicity_Method m = Unknown;
+  if (strcmp(method, "fauchere") == 0)
+    m = Fauchere;
+  else if (strcmp(method, "brasseur") == 0)
+    m = Brasseur;
+  else if (strcmp(method, "buckingham") == 0)
+    m = Buckingham;
+  else if (strcmp(method, "dubost") == 0)
+    m = Dubost;
+  else if (strcmp(method, "type5") == 0)
+    m = Type5;
+
+  // Keep atoms whose neighborhood overlaps the grid.
+  std::vector<Atom_Box> boxes;
+  boxes.reserve(na);
+  for (int a = 0 ; a < na ; ++a)
+    {
+      const float *xa = xyza + xs0*a;
+      Atom_Box b;
+      b.x = *xa; b.y = xa[xs1]; b.z = xa[2*xs1];
+      b.f = 100 * fa[fs0*a];
+      float i0 = (b.x-x0)/spacing, j0 = (b.y-y0)/spacing, k0 = (b.z-z0)/spacing;
+      b.kmin = max(0,int(floor(k0-md))); b.kmax = min(nz-1,int(ceil(k0+md)));
+      b.jmin = max(0,int(floor(j0-md))); b.jmax = min(ny-1,int(ceil(j0+md)));
+      b.imin = max(0,int(floor(i0-md))); b.imax = min(nx-1,int(ceil(i0+md)));
+      if (b.kmin <= b.kmax && b.jmin <= b.jmax && b.imin <= b.imax)
+	boxes.push_back(b);
+    }
+
+  // Divide z planes among threads so no two threads write the same grid point.
+  num_threads = Thread_Pool::thread_count(nz, 1, max(1, num_threads));
+  if (num_threads == 1)
+    {
+      lipophilicity_sum_planes(boxes, 0, nz, origin, spacing, max_dist, nexp, m, pot);
+      return;
+    }
+  Thread_Pool::run(num_threads, [&](int t) {
+      int k0 = (int)(((long)nz * t) / num_threads), k1 = (int)(((long)nz * (t+1)) / num_threads);
+      lipophilicity_sum_planes(boxes, k0, k1, origin, spacing, max_dist, nexp, m, pot);
+    });
+}
+
 // ----------------------------------------------------------------------------
 //
 extern "C" PyObject *
@@ -114,8 +173,10 @@ mlp_sum(PyObject *, PyObject *args, PyObject *keywds)
   FArray xyz, fi, pot;
   float origin[3], spacing, max_dist, nexp;
   const char *method;
-  const char *kwlist[] = {"xyz", "fi", "origin", "spacing", "max_dist", "method", "nexp", "pot", NULL};
-  if (!PyArg_ParseTupleAndKeywords(args, keywds, const_cast<char *>("O&O&O&ffsfO&"),
+  int num_threads = 1;
+  const char *kwlist[] = {"xyz", "fi", "origin", "spacing", "max_dist", "method", "nexp", "pot",
+			  "num_threads", NULL};
+  if (!PyArg_ParseTupleAndKeywords(args, keywds, const_cast<char *>("O&O&O&ffsfO&|i"),
 				   (char **)kwlist,
 				   parse_float_n3_array, &xyz,
 				   parse_float_n_array, &fi,
@@ -124,16 +185,18 @@ mlp_sum(PyObject *, PyObject *args, PyObject *keywds)
 				   &max_dist,
 				   &method,
 				   &nexp,
-				   parse_writable_float_3d_array, &pot))
+				   parse_writable_float_3d_array, &pot,
+				   &num_threads))
     return NULL;
 
   if (xyz.size(0) != fi.size(0))
     return PyErr_Format(PyExc_ValueError, "Xyz and fi arrays have different sizes %d and %d",
 			xyz.size(0), fi.size(0));
 
+  Py_BEGIN_ALLOW_THREADS
+  lipophilicity_sum(xyz, fi, origin, spacing, max_dist, nexp, method, num_threads, pot);
+  Py_END_ALLOW_THREADS
 
-  lipophilicity_sum(xyz, fi, origin, spacing, max_dist, nexp, method, pot);
-  
   return python_none();
 }
 
@@ -142,9 +205,10 @@ mlp_sum(PyObject *, PyObject *args, PyObject *keywds)
 static PyMethodDef mlp_methods[] = {
   {const_cast<char*>("mlp_sum"), (PyCFunction)mlp_sum,
    METH_VARARGS|METH_KEYWORDS,
-   "mlp_sum(xyz, fi, origin, spacing, method, nexp, pot)\n"
+   "mlp_sum(xyz, fi, origin, spacing, max_dist, method, nexp, pot, num_threads = 1)\n"
    "\n"
    "Sum lipophilicity values for atoms over a grid.\n"
+   "Grid z planes are divided among num_threads threads.\n"
    "Implemented in C++.\n"
   },
   {NULL, NULL, 0, NULL}
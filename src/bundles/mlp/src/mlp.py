@@ -415,7 +415,8 @@ def calculatefimap(atoms, method, spacing, max_dist, nexp):
     # Make sure _mlp can runtime link shared library libarrays.
     import chimerax.arrays
     from ._mlp import mlp_sum
-    mlp_sum(xyz, fi, origin, spacing, max_dist, method, nexp, pot)
+    from os import cpu_count
+    mlp_sum(xyz, fi, origin, spacing, max_dist, method, nexp, pot, num_threads = cpu_count() or 1)
                  
     return pot, bounds
 
@@ -116,6 +116,56 @@ _mmcif_extract_CIF_tables(PyObject*, PyObject* _args)
 
 static const char _mmcifextract_CIF_tables_doc[] = "extract_CIF_tables(filename: str, categories: list of str) -> object";
 
+static PyObject*
+_mmcif_extract_CIF_tables_from_text(PyObject*, PyObject* _args)
+{
+	PyObject* _ptArg1;
+	PyObject* _ptArg2;
+	if (!PyArg_ParseTuple(_args, "OO:extract_CIF_tables_from_text", &_ptArg1, &_ptArg2))
+		return NULL;
+	try {
+		if (!PyUnicode_Check(_ptArg1))
+			throw std::invalid_argument("argument 1 should be a str");
+		Py_ssize_t size;
+		const char *data = PyUnicode_AsUTF8AndSize(_ptArg1, &size);
+		std::string cppArg1(data, size);
+		std::vector<std::string> cppArg2;
+		if (!sequence_to_vector_string(_ptArg2, &cppArg2))
+			throw std::invalid_argument("argument 2 should be a sequence of str");
+		PyObject* _result = extract_CIF_tables_from_text(cppArg1, cppArg2);
+		return _result;
+	} catch (...) {
+		_mmcifError();
+	}
+	return NULL;
+}
+
+static const char _mmcifextract_CIF_tables_from_text_doc[] = "extract_CIF_tables_from_text(text: str, categories: list of str) -> object";
+
+static PyObject*
+_mmcif_extract_CIF_tables_files(PyObject*, PyObject* _args)
+{
+	PyObject* _ptArg1;
+	PyObject* _ptArg2;
+	if (!PyArg_ParseTuple(_args, "OO:extract_CIF_tables_files", &_ptArg1, &_ptArg2))
+		return NULL;
+	try {
+		std::vector<std::string> cppArg1;
+		if (!sequence_to_vector_string(_ptArg1, &cppArg1))
+			throw std::invalid_argument("argument 1 should be a sequence of str");
+		std::vector<std::string> cppArg2;
+		if (!sequence_to_vector_string(_ptArg2, &cppArg2))
+			throw std::invalid_argument("argument 2 should be a sequence of str");
+		PyObject* _result = extract_CIF_tables_files(cppArg1, cppArg2);
+		return _result;
+	} catch (...) {
+		_mmcifError();
+	}
+	return NULL;
+}
+
+static const char _mmcifextract_CIF_tables_files_doc[] = "extract_CIF_tables_files(filenames: list of str, categories: list of str) -> tuple";
+
 static PyObject *
 _mmcif_load_mmCIF_templates(PyObject*, PyObject* _ptArg)
 {
@@ -135,6 +185,25 @@ _mmcif_load_mmCIF_templates(PyObject*, PyObject* _ptArg)
 
 static const char _mmcifload_mmCIF_templates_doc[] = "load_mmCIF_templates(filename: str)";
 
+static PyObject *
+_mmcif_index_mmCIF_templates(PyObject*, PyObject* _ptArg)
+{
+	try {
+		if (!PyUnicode_Check(_ptArg))
+			throw std::invalid_argument("argument 1 should be a str");
+		Py_ssize_t size;
+		const char *data = PyUnicode_AsUTF8AndSize(_ptArg, &size);
+		std::string cppArg1(data, size);
+		index_mmCIF_templates(cppArg1.c_str());
+		return (Py_INCREF(Py_None), Py_None);
+	} catch (...) {
+		_mmcifError();
+	}
+	return NULL;
+}
+
+static const char _mmcifindex_mmCIF_templates_doc[] = "index_mmCIF_templates(filename: str)";
+
 static PyObject*
 _mmcif_parse_mmCIF_buffer(PyObject*, PyObject* _args, PyObject* _keywds)
 {
@@ -280,6 +349,38 @@ _mmcif_parse_mmCIF_file(PyObject*, PyObject* _args, PyObject* _keywds)
 	return NULL;
 }
 
+static PyObject*
+_mmcif_parse_mmCIF_files(PyObject*, PyObject* _args)
+{
+	PyObject* _ptArg1;
+	PyObject* _ptArg2;
+	PyObject* _ptArg3;
+	int _ptArg4;
+	int _ptArg5;
+	int _ptArg6;
+	if (!PyArg_ParseTuple(_args, "OOOiii:parse_mmCIF_files", &_ptArg1, &_ptArg2, &_ptArg3, &_ptArg4, &_ptArg5, &_ptArg6))
+		return NULL;
+	try {
+		std::vector<std::string> cppArg1;
+		if (!sequence_to_vector_string(_ptArg1, &cppArg1))
+			throw std::invalid_argument("argument 1 should be a sequence of str");
+		std::vector<std::string> cppArg2;
+		if (!sequence_to_vector_string(_ptArg2, &cppArg2))
+			throw std::invalid_argument("argument 2 should be a sequence of str");
+		PyObject* cppArg3 = _ptArg3;
+		bool cppArg4(_ptArg4);
+		bool cppArg5(_ptArg5);
+		bool cppArg6(_ptArg6);
+		PyObject* _result = parse_mmCIF_files(cppArg1, cppArg2, cppArg3, cppArg4, cppArg5, cppArg6);
+		return _result;
+	} catch (...) {
+		_mmcifError();
+	}
+	return NULL;
+}
+
+static const char _mmcifparse_mmCIF_files_doc[] = "parse_mmCIF_files(filenames: list of str, extra_categories: list of str, logger: object, coordsets: bool, atomic: bool, ignore_styling: bool) -> list";
+
 static const char _mmcifparse_mmCIF_file_doc[] = "parse_mmCIF_file(filename: str, logger: object, coordsets: bool, atomic: bool) -> object\n\
 parse_mmCIF_file(filename: str, extra_categories: list of str, logger: object, coordsets: bool, atomic: bool) -> object";
 
@@ -300,6 +401,20 @@ _mmcif_set_Python_locate_function(PyObject*, PyObject* _ptArg)
 
 static const char _mmcifset_Python_locate_function_doc[] = "set_Python_locate_function(function: object)";
 
+static PyObject*
+_mmcif_set_Python_locate_many_function(PyObject*, PyObject* _ptArg)
+{
+	try {
+		set_Python_locate_many_function(_ptArg);
+		return (Py_INCREF(Py_None), Py_None);
+	} catch (...) {
+		_mmcifError();
+	}
+	return NULL;
+}
+
+static const char _mmcifset_Python_locate_many_function_doc[] = "set_Python_locate_many_function(function: object)";
+
 static PyObject*
 _mmcif_find_template_residue(PyObject*, PyObject* _ptArg)
 {
@@ -399,6 +514,91 @@ _mmcif_non_standard_bonds(PyObject*, PyObject* _args)
 	return NULL;
 }
 
+static const char _mmcifwrite_cif_table_doc[] = "write_cif_table(file: object, name: str, tags: list of str, values: list, fixed_width: bool)";
+
+static PyObject*
+_mmcif_write_cif_table(PyObject*, PyObject* _args)
+{
+	PyObject* file;
+	const char* name;
+	PyObject* tags;
+	PyObject* values;
+	int fixed_width = false;
+	if (!PyArg_ParseTuple(_args, "OsOO|p:write_cif_table", &file, &name, &tags, &values, &fixed_width))
+		return NULL;
+	try {
+		std::vector<std::string> cpp_tags;
+		if (!sequence_to_vector_string(tags, &cpp_tags))
+			throw std::invalid_argument("argument 3 should be a sequence of str");
+		write_cif_table(file, name, cpp_tags, values, fixed_width);
+		Py_RETURN_NONE;
+	} catch (...) {
+		_mmcifError();
+	}
+	return NULL;
+}
+
+// Data and count of a 1-dimensional numpy array, or NULL with
+// an exception set if it is not contiguous with the given type
+static void*
+array_data(PyObject* obj, int type, const char* what, size_t* count, int ndim = 1)
+{
+	if (!PyArray_Check(obj) || PyArray_NDIM((PyArrayObject*) obj) != ndim
+			|| PyArray_TYPE((PyArrayObject*) obj) != type
+			|| !PyArray_IS_C_CONTIGUOUS((PyArrayObject*) obj)) {
+		PyErr_Format(PyExc_ValueError, "%s should be a contiguous %d-dimensional array of the right type", what, ndim);
+		return NULL;
+	}
+	*count = PyArray_DIMS((PyArrayObject*) obj)[0];
+	return PyArray_DATA((PyArrayObject*) obj);
+}
+
+static const char _mmcifwrite_atom_site_doc[] = "write_atom_site(file: object, residues: Residues, residue_values: list, coordsets: int32 array, xforms: float64 Nx3x4 array, xform_indices: int32 array, selected_only: bool, displayed_only: bool, fixed_width: bool)";
+
+static PyObject*
+_mmcif_write_atom_site(PyObject*, PyObject* _args)
+{
+	static bool need_init = true;
+
+	if (need_init) {
+		import_array();
+		need_init = false;
+	}
+	PyObject *file, *residues, *residue_values, *coordsets, *xforms, *xform_indices;
+	int selected_only, displayed_only, fixed_width;
+	if (!PyArg_ParseTuple(_args, "OOOOOOppp:write_atom_site", &file, &residues,
+			&residue_values, &coordsets, &xforms, &xform_indices,
+			&selected_only, &displayed_only, &fixed_width))
+		return NULL;
+	PyObject* pointers = PyObject_GetAttrString(residues, "_pointers");
+	if (pointers == NULL)
+		return NULL;
+	try {
+		size_t num_residues, num_cs, num_xforms, num_xi;
+		auto res = static_cast<const Residue**>(array_data(pointers, NPY_UINTP, "Residues _pointers", &num_residues));
+		auto cs = static_cast<const int*>(array_data(coordsets, NPY_INT32, "coordsets", &num_cs));
+		auto xf = static_cast<const double*>(array_data(xforms, NPY_FLOAT64, "xforms", &num_xforms, 3));
+		auto xi = static_cast<const int*>(array_data(xform_indices, NPY_INT32, "xform_indices", &num_xi));
+		if (res == NULL || cs == NULL || xf == NULL || xi == NULL) {
+			Py_DECREF(pointers);
+			return NULL;
+		}
+		if (num_cs != num_residues || num_xi != num_residues)
+			throw std::invalid_argument("need a coordset and transform index for each residue");
+		if (num_xforms > 0 && (PyArray_DIMS((PyArrayObject*) xforms)[1] != 3
+				|| PyArray_DIMS((PyArrayObject*) xforms)[2] != 4))
+			throw std::invalid_argument("xforms should be an N by 3 by 4 array");
+		write_atom_site(file, res, num_residues, residue_values, cs, xf, num_xforms, xi,
+			selected_only, displayed_only, fixed_width);
+		Py_DECREF(pointers);
+		Py_RETURN_NONE;
+	} catch (...) {
+		Py_DECREF(pointers);
+		_mmcifError();
+	}
+	return NULL;
+}
+
 static const char _mmcifnon_standard_bonds_doc[] = "non_standard_bonds(bonds: Bonds, selected_only: bool, displayed_only: bool) -> tuple[disulfide, covalent]";
 
 static PyObject*
@@ -530,10 +730,22 @@ PyMethodDef _mmcifMethods[] = {
 		"extract_CIF_tables", (PyCFunction) _mmcif_extract_CIF_tables,
 		METH_VARARGS, _mmcifextract_CIF_tables_doc
 	},
+	{
+		"extract_CIF_tables_from_text", (PyCFunction) _mmcif_extract_CIF_tables_from_text,
+		METH_VARARGS, _mmcifextract_CIF_tables_from_text_doc
+	},
+	{
+		"extract_CIF_tables_files", (PyCFunction) _mmcif_extract_CIF_tables_files,
+		METH_VARARGS, _mmcifextract_CIF_tables_files_doc
+	},
 	{
 		"load_mmCIF_templates", (PyCFunction) _mmcif_load_mmCIF_templates,
 		METH_O, _mmcifload_mmCIF_templates_doc
 	},
+	{
+		"index_mmCIF_templates", (PyCFunction) _mmcif_index_mmCIF_templates,
+		METH_O, _mmcifindex_mmCIF_templates_doc
+	},
 	{
 		"parse_mmCIF_buffer", (PyCFunction) _mmcif_parse_mmCIF_buffer,
 		METH_VARARGS | METH_KEYWORDS, _mmcifparse_mmCIF_buffer_doc
@@ -542,10 +754,18 @@ PyMethodDef _mmcifMethods[] = {
 		"parse_mmCIF_file", (PyCFunction) _mmcif_parse_mmCIF_file,
 		METH_VARARGS | METH_KEYWORDS, _mmcifparse_mmCIF_file_doc
 	},
+	{
+		"parse_mmCIF_files", (PyCFunction) _mmcif_parse_mmCIF_files,
+		METH_VARARGS, _mmcifparse_mmCIF_files_doc
+	},
 	{
 		"set_Python_locate_function", (PyCFunction) _mmcif_set_Python_locate_function,
 		METH_O, _mmcifset_Python_locate_function_doc
 	},
+	{
+		"set_Python_locate_many_function", (PyCFunction) _mmcif_set_Python_locate_many_function,
+		METH_O, _mmcifset_Python_locate_many_function_doc
+	},
 	{
 		"find_template_residue", (PyCFunction) _mmcif_find_template_residue,
 		METH_O, _mmciffind_template_residue_doc
@@ -558,6 +778,14 @@ PyMethodDef _mmcifMethods[] = {
 		"non_standard_bonds", (PyCFunction) _mmcif_non_standard_bonds,
 		METH_VARARGS, _mmcifnon_standard_bonds_doc
 	},
+	{
+		"write_cif_table", (PyCFunction) _mmcif_write_cif_table,
+		METH_VARARGS, _mmcifwrite_cif_table_doc
+	},
+	{
+		"write_atom_site", (PyCFunction) _mmcif_write_atom_site,
+		METH_VARARGS, _mmcifwrite_atom_site_doc
+	},
 	{
 		"parse_coreCIF_buffer", (PyCFunction) _mmcif_parse_coreCIF_buffer,
 		METH_VARARGS | METH_KEYWORDS, _mmcifparse_coreCIF_buffer_doc
@@ -36,7 +36,9 @@
 #include <pdb/connect.h>
 #include <atomstruct/tmpl/restmpl.h>
 #include <logger/logger.h>
+#include <ioutil/gzstream.h>
 #include <arrays/pythonarray.h>	// Use python_voidp_array()
+#include <arrays/trace.h>	// Use TRACE_SCOPE
 #include <readcif.h>
 #include <float.h>
 #include <fcntl.h>
@@ -48,6 +50,11 @@
 #include <algorithm>
 #include <unordered_map>
 #include <set>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <future>
+#include <fstream>
 #include <cstddef>
 
 #undef CLOCK_PROFILING
@@ -112,14 +119,14 @@ static const bool Required = true;  // column is required
 inline void
 canonicalize_atom_name(AtomName* aname, bool* asterisks_translated)
 {
-    for (size_t i = aname->length(); i > 0; ) {
-        --i;
-        // use prime instead of asterisk
-        if ((*aname)[i] == '*') {
-            (*aname)[i] = '\'';
-            *asterisks_translated = true;
-        }
-    }
+    // names are interned, so make a new one instead of editing in place
+    if (aname->find('*') == AtomName::npos)
+        return;
+    // use prime instead of asterisk
+    std::string name = *aname;
+    std::replace(name.begin(), name.end(), '*', '\'');
+    *aname = name;
+    *asterisks_translated = true;
 }
 
 Atom* closest_atom_by_template(tmpl::Atom* ta, const tmpl::Residue* tr, const Residue* r)
@@ -714,6 +721,7 @@ ExtractMolecule::finished_parse()
 {
     if (molecules.empty())
         return;
+    TRACE_SCOPE_ITEMS("mmcif.finished_parse", molecules.size());
 
     if (my_templates) {
         // small optimization (1% for 3j3q)
@@ -732,6 +740,19 @@ ExtractMolecule::finished_parse()
         }
     }
 
+    {
+        // resolve all of the missing templates together
+        std::set<ResName> names;
+        for (auto& mi: molecules) {
+            for (auto r: mi.second->residues()) {
+                if (my_templates && my_templates->find_residue(r->name()) != nullptr)
+                    continue;
+                names.insert(r->name());
+            }
+        }
+        find_template_residues(std::vector<ResName>(names.begin(), names.end()));
+    }
+
     for (auto& mi: molecules) {
         auto model_num = mi.first;
         auto mol = mi.second;
@@ -913,7 +934,7 @@ ExtractMolecule::finished_parse()
         }
 
         if (found_missing_poly_seq && !no_polymer && model_num == first_model_num)
-            logger::warning(_logger, "Missing or incomplete <a='https://mmcif.wwpdb.org/dictionaries/mmcif_std.dic/Categories/entity_poly_seq.html'>sequence information</a>.  Inferred polymer connectivity.", true);
+            logger::html_warning(_logger, "Missing or incomplete <a='https://mmcif.wwpdb.org/dictionaries/mmcif_std.dic/Categories/entity_poly_seq.html'>sequence information</a>.  Inferred polymer connectivity.");
         if (has_metal)
             pdb_connect::find_and_add_metal_coordination_bonds(mol);
         if (found_missing_poly_seq)
@@ -1029,6 +1050,17 @@ ExtractMolecule::parse_generic_category()
     colinfo.push_back(category);
     colinfo.insert(colinfo.end(), colnames.begin(), colnames.end());
     generic_tables[category_ci] = colinfo;
+    if (multiple_rows()) {
+        // Keep tables as unparsed text until they are first asked for,
+        // see get_mmcif_tables_from_metadata() and extract_CIF_tables_from_text()
+        string text = category_text();
+        if (!text.empty()) {
+            generic_tables.erase(category_ci + " data");
+            generic_tables[category_ci + " text"] = { std::move(text) };
+            return;
+        }
+    }
+    generic_tables.erase(category_ci + " text");
     StringVector data = parse_whole_category();
     generic_tables[category_ci + " data"].swap(data);
 }
@@ -1259,30 +1291,50 @@ ExtractMolecule::parse_audit_syntax()
 void
 ExtractMolecule::parse_atom_site()
 {
+    TRACE_SCOPE("mmcif.parse_atom_site");
     // x, y, z are not required by mmCIF, but are by us
 
-    readcif::CIFFile::ParseValues pv;
-    pv.reserve(20);
-
-    string entity_id;             // label_entity_id
-    ChainID chain_id;             // label_asym_id
-    ChainID auth_chain_id;        // auth_asym_id
-    long position;                // label_seq_id
-    long auth_position = INT_MAX; // auth_seq_id
-    char ins_code = ' ';          // pdbx_PDB_ins_code
-    char alt_id = '\0';           // label_alt_id
-    AtomName atom_name;           // label_atom_id
+    // the values of one row, so rows can be parsed on several threads
+    struct AtomSiteValues {
+        string entity_id;             // label_entity_id
+        ChainID chain_id;             // label_asym_id
+        ChainID auth_chain_id;        // auth_asym_id
+        long position;                // label_seq_id
+        long auth_position = INT_MAX; // auth_seq_id
+        char ins_code = ' ';          // pdbx_PDB_ins_code
+        char alt_id = '\0';           // label_alt_id
+        AtomName atom_name;           // label_atom_id
 #if 0
-    AtomName auth_atom_name;      // auth_atom_id
+        AtomName auth_atom_name;      // auth_atom_id
 #endif
-    ResName residue_name;         // label_comp_id
-    ResName auth_residue_name;    // auth_comp_id
-    char symbol[3];               // type_symbol
-    long serial_num = 0;          // id
-    double x, y, z;               // Cartn_[xyz]
-    double occupancy = DBL_MAX;   // occupancy
-    double b_factor = DBL_MAX;    // B_iso_or_equiv
-    int model_num = 0;            // pdbx_PDB_model_num
+        ResName residue_name;         // label_comp_id
+        ResName auth_residue_name;    // auth_comp_id
+        char symbol[3];               // type_symbol
+        long serial_num = 0;          // id
+        double x, y, z;               // Cartn_[xyz]
+        double occupancy = DBL_MAX;   // occupancy
+        double b_factor = DBL_MAX;    // B_iso_or_equiv
+        int model_num = 0;            // pdbx_PDB_model_num
+    };
+    AtomSiteValues cur;
+    string& entity_id = cur.entity_id;
+    ChainID& chain_id = cur.chain_id;
+    ChainID& auth_chain_id = cur.auth_chain_id;
+    long& position = cur.position;
+    long& auth_position = cur.auth_position;
+    char& ins_code = cur.ins_code;
+    char& alt_id = cur.alt_id;
+    AtomName& atom_name = cur.atom_name;
+    ResName& residue_name = cur.residue_name;
+    ResName& auth_residue_name = cur.auth_residue_name;
+    char (&symbol)[3] = cur.symbol;
+    long& serial_num = cur.serial_num;
+    double& x = cur.x;
+    double& y = cur.y;
+    double& z = cur.z;
+    double& occupancy = cur.occupancy;
+    double& b_factor = cur.b_factor;
+    int& model_num = cur.model_num;
     long user_position;           // auth_position if given else position
 
     if (guess_fixed_width_categories)
@@ -1299,135 +1351,184 @@ ExtractMolecule::parse_atom_site()
         throw std::runtime_error("is a small molecule (coreCIF) file");
     }
 
-    try {
+    auto add_columns = [this] (readcif::CIFFile::ParseValues& pv, AtomSiteValues& v) {
         pv.emplace_back(get_column("id"),
-            [&] (const char* start) {
-                serial_num = readcif::str_to_int(start);
+            [&v] (const char* start) {
+                v.serial_num = readcif::str_to_int(start);
             });
 
         pv.emplace_back(get_column("label_entity_id"),
-            [&] (const char* start, const char* end) {
-                entity_id = string(start, end - start);
-                if (entity_id.size() == 1 && (*start == '.' || *start == '?'))
-                    entity_id.clear();
+            [&v] (const char* start, const char* end) {
+                v.entity_id.assign(start, end - start);
+                if (v.entity_id.size() == 1 && (*start == '.' || *start == '?'))
+                    v.entity_id.clear();
             });
 
         pv.emplace_back(get_column("label_asym_id", Required),
-            [&] (const char* start, const char* end) {
-                chain_id = ChainID(start, end - start);
-                if (chain_id.size() == 1 && (*start == '.' || *start == '?'))
-                    chain_id = ChainID(" ");
+            [&v] (const char* start, const char* end) {
+                v.chain_id = ChainID(start, end - start);
+                if (v.chain_id.size() == 1 && (*start == '.' || *start == '?'))
+                    v.chain_id = " ";
             });
         pv.emplace_back(get_column("auth_asym_id"),
-            [&] (const char* start, const char* end) {
-                auth_chain_id = ChainID(start, end - start);
-                if (auth_chain_id.size() == 1 && (*start == '.' || *start == '?'))
-                    auth_chain_id = ChainID(" ");
+            [&v] (const char* start, const char* end) {
+                v.auth_chain_id = ChainID(start, end - start);
+                if (v.auth_chain_id.size() == 1 && (*start == '.' || *start == '?'))
+                    v.auth_chain_id = " ";
             });
         pv.emplace_back(get_column("pdbx_PDB_ins_code"),
-            [&] (const char* start, const char* end) {
+            [&v] (const char* start, const char* end) {
                 if (end == start + 1 && (*start == '.' || *start == '?'))
-                    ins_code = ' ';
+                    v.ins_code = ' ';
                 else {
                     // TODO: check if more than one character
-                    ins_code = *start;
+                    v.ins_code = *start;
                 }
             });
         pv.emplace_back(get_column("label_seq_id", Required),
-            [&] (const char* start) {
-                position = readcif::str_to_int(start);
+            [&v] (const char* start) {
+                v.position = readcif::str_to_int(start);
             });
         pv.emplace_back(get_column("auth_seq_id"),
-            [&] (const char* start) {
+            [&v] (const char* start) {
                 if (*start == '.' || *start == '?')
-                    auth_position = INT_MAX;
+                    v.auth_position = INT_MAX;
                 else
-                    auth_position = readcif::str_to_int(start);
+                    v.auth_position = readcif::str_to_int(start);
             });
 
         pv.emplace_back(get_column("label_alt_id"),
-            [&] (const char* start, const char* end) {
+            [&v] (const char* start, const char* end) {
                 if (end == start + 1
                 && (*start == '.' || *start == '?' || *start == ' '))
-                    alt_id = '\0';
+                    v.alt_id = '\0';
                 else {
                     // TODO: what about more than one character?
-                    alt_id = *start;
+                    v.alt_id = *start;
                 }
             });
         pv.emplace_back(get_column("type_symbol", Required),
-            [&] (const char* start) {
-                symbol[0] = *start;
-                symbol[1] = *(start + 1);
-                if (readcif::is_whitespace(symbol[1]))
-                    symbol[1] = '\0';
+            [&v] (const char* start) {
+                v.symbol[0] = *start;
+                v.symbol[1] = *(start + 1);
+                if (readcif::is_whitespace(v.symbol[1]))
+                    v.symbol[1] = '\0';
                 else
-                    symbol[2] = '\0';
+                    v.symbol[2] = '\0';
             });
         pv.emplace_back(get_column("label_atom_id", Required),
-            [&] (const char* start, const char* end) {
+            [&v] (const char* start, const char* end) {
                 // deal with Coot's braindead leading and trailing
                 // spaces in atom names
                 while (isspace(*start))
                     ++start;
                 while (end > start && isspace(*(end - 1)))
                     --end;
-                atom_name = AtomName(start, end - start);
+                v.atom_name = AtomName(start, end - start);
             });
 #if 0
         pv.emplace_back(get_column("auth_atom_id"),
-            [&] (const char* start, const char* end) {
-                auth_atom_name = AtomName(start, end - start);
+            [&v] (const char* start, const char* end) {
+                v.auth_atom_name.assign(start, end - start);
                 if (auth_atoms_name.size() == 1 && (*start == '.' || *start == '?'))
-                    auth_atom_name.clear();
+                    v.auth_atom_name.clear();
             });
 #endif
         pv.emplace_back(get_column("label_comp_id", Required),
-            [&] (const char* start, const char* end) {
-                residue_name = ResName(start, end - start);
+            [&v] (const char* start, const char* end) {
+                v.residue_name = ResName(start, end - start);
             });
         pv.emplace_back(get_column("auth_comp_id"),
-            [&] (const char* start, const char* end) {
-                auth_residue_name = ResName(start, end - start);
-                if (auth_residue_name.size() == 1 && (*start == '.' || *start == '?'))
-                    auth_residue_name.clear();
+            [&v] (const char* start, const char* end) {
+                v.auth_residue_name = ResName(start, end - start);
+                if (v.auth_residue_name.size() == 1 && (*start == '.' || *start == '?'))
+                    v.auth_residue_name.clear();
             });
         // x, y, z are not required by mmCIF, but are by us
         pv.emplace_back(get_column("Cartn_x", Required),
-            [&] (const char* start) {
-                x = readcif::str_to_float(start);
+            [&v] (const char* start) {
+                v.x = readcif::str_to_float(start);
             });
         pv.emplace_back(get_column("Cartn_y", Required),
-            [&] (const char* start) {
-                y = readcif::str_to_float(start);
+            [&v] (const char* start) {
+                v.y = readcif::str_to_float(start);
             });
         pv.emplace_back(get_column("Cartn_z", Required),
-            [&] (const char* start) {
-                z = readcif::str_to_float(start);
+            [&v] (const char* start) {
+                v.z = readcif::str_to_float(start);
             });
         pv.emplace_back(get_column("occupancy"),
-            [&] (const char* start) {
+            [&v] (const char* start) {
                 if (*start == '?')
-                    occupancy = DBL_MAX;
+                    v.occupancy = DBL_MAX;
                 else
-                    occupancy = readcif::str_to_float(start);
+                    v.occupancy = readcif::str_to_float(start);
             });
         pv.emplace_back(get_column("B_iso_or_equiv"),
-            [&] (const char* start) {
+            [&v] (const char* start) {
                 if (*start == '?')
-                    b_factor = DBL_MAX;
+                    v.b_factor = DBL_MAX;
                 else
-                    b_factor = readcif::str_to_float(start);
+                    v.b_factor = readcif::str_to_float(start);
             });
         pv.emplace_back(get_column("pdbx_PDB_model_num"),
-            [&] (const char* start) {
-                model_num = readcif::str_to_int(start);
+            [&v] (const char* start) {
+                v.model_num = readcif::str_to_int(start);
             });
+    };
+    readcif::CIFFile::ParseValues pv;
+    pv.reserve(20);
+    try {
+        add_columns(pv, cur);
     } catch (std::runtime_error& e) {
         logger::warning(_logger, "Skipping atom_site category: ", e.what());
         return;
     }
 
+    // Fixed width rows are tokenized on several threads into per-chunk
+    // buffers, a batch at a time, and the buffered rows are then replayed
+    // in file order, so the structure is built exactly as if serially.
+    const size_t ROWS_PER_THREAD = 16384;
+    int num_threads = std::min(std::thread::hardware_concurrency(), 8u);
+    bool threaded = num_threads > 1;
+    std::vector<readcif::CIFFile::ParseValues> chunk_pv;
+    std::vector<AtomSiteValues> chunk_values;
+    std::vector<std::vector<AtomSiteValues>> chunk_rows;
+    if (threaded) {
+        chunk_pv.resize(num_threads);
+        chunk_values.resize(num_threads);
+        chunk_rows.resize(num_threads);
+        for (int i = 0; i < num_threads; ++i) {
+            chunk_pv[i].reserve(20);
+            add_columns(chunk_pv[i], chunk_values[i]);
+            chunk_rows[i].reserve(ROWS_PER_THREAD);
+        }
+    }
+    size_t chunk = 0, chunk_row = 0;
+    auto next_row = [&] () -> bool {
+        while (threaded) {
+            while (chunk < chunk_rows.size() && chunk_row == chunk_rows[chunk].size()) {
+                ++chunk;
+                chunk_row = 0;
+            }
+            if (chunk < chunk_rows.size()) {
+                cur = std::move(chunk_rows[chunk][chunk_row++]);
+                return true;
+            }
+            for (auto& rows: chunk_rows)
+                rows.clear();
+            chunk = chunk_row = 0;
+            long num_rows = parse_rows_threaded(num_threads, num_threads * ROWS_PER_THREAD,
+                [&] (int i) -> readcif::CIFFile::ParseValues& { return chunk_pv[i]; },
+                [&] (int i) { chunk_rows[i].push_back(chunk_values[i]); });
+            if (num_rows == 0)
+                return false;
+            if (num_rows < 0)
+                threaded = false;
+        }
+        return parse_row(pv);
+    };
+
     long atom_serial = 0;
     Residue* cur_residue = nullptr;
     Structure* mol = nullptr;
@@ -1440,14 +1541,47 @@ ExtractMolecule::parse_atom_site()
     ResName cur_comp_id;
     bool missing_seq_id_warning = false;
     bool missing_entity_id_warning = false;
+    // type_symbol has few distinct values, so look each up once
+    std::unordered_map<int, const Element*> elements;
+    // Trajectory models usually list the same atoms in the same order as
+    // the first model.  Such rows are checked against a signature of the
+    // first model row for the atom with the next coordinate index and the
+    // coordinates appended straight to the coordinate set, skipping the
+    // residue and atom lookups.  At the first row that differs the rest of
+    // that model is matched by name.
+    std::vector<uint64_t> first_model_rows;  // row signatures by atom index
+    bool record_rows = coordsets, same_rows = coordsets, fast_model = false;
+    auto row_signature = [&cur] () -> uint64_t {
+        uint64_t h = 14695981039346656037ULL;  // FNV-1a
+        auto add = [&h] (const char* s, size_t n) {
+            for (size_t i = 0; i < n; ++i) {
+                h ^= (unsigned char) s[i];
+                h *= 1099511628211ULL;
+            }
+            h ^= 0xff;  // field separator
+            h *= 1099511628211ULL;
+        };
+        add(cur.entity_id.data(), cur.entity_id.size());
+        add(cur.chain_id.data(), cur.chain_id.size());
+        add(cur.residue_name.data(), cur.residue_name.size());
+        add(cur.atom_name.data(), cur.atom_name.size());
+        add((const char*) &cur.position, sizeof cur.position);
+        add((const char*) &cur.auth_position, sizeof cur.auth_position);
+        add(&cur.ins_code, 1);
+        return h;
+    };
     for (;;) {
-        if (!parse_row(pv))
+        if (!next_row())
             break;
         if (model_num != cur_model_num) {
             if (first_model_num == INT_MAX)
                 first_model_num = model_num;
             cur_model_num = model_num;
             cur_residue = nullptr;
+            if (model_num != first_model_num) {
+                record_rows = false;
+                fast_model = same_rows && !first_model_rows.empty();
+            }
             if (!coordsets) {
                 if (molecules.find(cur_model_num) != molecules.end()) {
                     logger::warning(_logger, "Previously completed PDB model ", cur_model_num,
@@ -1493,6 +1627,27 @@ ExtractMolecule::parse_atom_site()
             }
         }
 
+        if (fast_model) {
+            CoordSet *cs = mol->active_coord_set();
+            size_t index = cs->coords_size();
+            if (alt_id == '\0' && index < first_model_rows.size()
+            && !std::isnan(x) && !std::isnan(y) && !std::isnan(z)
+            && first_model_rows[index] == row_signature()) {
+                Atom *a = mol->atoms()[index];
+                cs->add_coord(Coord(x, y, z));
+                if (b_factor != DBL_MAX)
+                    cs->set_bfactor(a, b_factor);
+                if (occupancy != DBL_MAX)
+                    cs->set_occupancy(a, occupancy);
+                if (serial_num)
+                    atom_lookup[serial_num] = {a, alt_id};
+                continue;
+            }
+            fast_model = false;
+            cur_residue = nullptr;
+        }
+        uint64_t signature = record_rows ? row_signature() : 0;
+
         bool missing_entity_id = entity_id.empty();
         if (missing_entity_id)
             entity_id = chain_id;  // no entity_id, use chain id
@@ -1610,8 +1765,11 @@ ExtractMolecule::parse_atom_site()
                 make_new_atom = false;
         }
         if (make_new_atom) {
-            const Element& elem = Element::get_element(symbol);
-            a = mol->new_atom(atom_name.c_str(), elem);
+            int symbol_key = (unsigned char) symbol[0] << 8 | (unsigned char) symbol[1];
+            auto ei = elements.find(symbol_key);
+            if (ei == elements.end())
+                ei = elements.emplace(symbol_key, &Element::get_element(symbol)).first;
+            a = mol->new_atom(atom_name.c_str(), *ei->second);
             cur_residue->add_atom(a);
             if (alt_id)
                 a->set_alt_loc(alt_id, true);
@@ -1620,7 +1778,12 @@ ExtractMolecule::parse_atom_site()
             else
                 ++atom_serial;
             a->set_serial_number(atom_serial);
+            if (record_rows && !alt_id)
+                first_model_rows.push_back(signature);
         }
+        if (record_rows && (alt_id || first_model_rows.size() != mol->atoms().size()))
+            // alternate locations don't have one row per coordinate
+            same_rows = record_rows = false;
         Coord c(x, y, z);
         a->set_coord(c);
         if (b_factor != DBL_MAX)
@@ -2676,6 +2839,19 @@ ExtractMolecule::parse_entity_poly_seq()
     }
 }
 
+// parse a file that may be gzipped; readcif needs the whole file in memory,
+// so a gzipped file is decompressed first
+static void
+parse_cif_file(readcif::CIFFile &cif, const char *filename)
+{
+    if (!ioutil::is_gzip_file(filename)) {
+        cif.parse_file(filename);
+        return;
+    }
+    std::string contents = ioutil::read_gzip_file(filename);
+    cif.parse(contents.c_str());
+}
+
 static PyObject*
 structure_pointers(ExtractMolecule &e)
 {
@@ -2702,8 +2878,9 @@ parse_mmCIF_file(const char *filename, PyObject* logger, bool coordsets, bool at
 #ifdef CLOCK_PROFILING
     ClockProfile p("parse_mmCIF_file");
 #endif
+    logger::BufferedLog log_buffer(logger);
     ExtractMolecule extract(logger, StringVector(), coordsets, atomic, ignore_styling);
-    extract.parse_file(filename);
+    parse_cif_file(extract, filename);
     return structure_pointers(extract);
 }
 
@@ -2714,17 +2891,78 @@ parse_mmCIF_file(const char *filename, const StringVector& generic_categories,
 #ifdef CLOCK_PROFILING
     ClockProfile p("parse_mmCIF_file2");
 #endif
+    logger::BufferedLog log_buffer(logger);
     ExtractMolecule extract(logger, generic_categories, coordsets, atomic, ignore_styling);
-    extract.parse_file(filename);
+    parse_cif_file(extract, filename);
     return structure_pointers(extract);
 }
 
+static void
+prefetch_file(const string& filename)
+{
+    // read and discard, so the file is in the OS file cache when parsed
+    std::ifstream in(filename, std::ios::binary);
+    static const std::streamsize BUF_SIZE = 1 << 16;
+    std::vector<char> buf(BUF_SIZE);
+    while (in.read(buf.data(), BUF_SIZE))
+        continue;
+}
+
+PyObject*
+parse_mmCIF_files(const StringVector& filenames, const StringVector& generic_categories,
+                  PyObject* logger, bool coordsets, bool atomic, bool ignore_styling)
+{
+#ifdef CLOCK_PROFILING
+    ClockProfile p("parse_mmCIF_files");
+#endif
+    // Worker threads read files a few ahead of the one being parsed, so
+    // reading overlaps parsing.  Parsing stays on this thread because it
+    // logs and finds residue templates through Python.
+    size_t num_files = filenames.size();
+    size_t ahead = std::max(2u, std::thread::hardware_concurrency());
+    std::vector<std::future<void>> prefetched(num_files);
+    for (size_t i = 0; i < std::min(ahead, num_files); ++i)
+        prefetched[i] = std::async(std::launch::async, prefetch_file, filenames[i]);
+
+    PyObject* results = PyList_New(num_files);
+    if (!results)
+        throw std::runtime_error("Python Error");
+    for (size_t i = 0; i < num_files; ++i) {
+        if (i + ahead < num_files)
+            prefetched[i + ahead] = std::async(std::launch::async, prefetch_file,
+                                               filenames[i + ahead]);
+        prefetched[i].wait();
+        // A file that fails to parse gets its error message instead of
+        // structures, so the other files' structures are still returned.
+        PyObject* result;
+        try {
+            logger::BufferedLog log_buffer(logger);
+            ExtractMolecule extract(logger, generic_categories, coordsets, atomic, ignore_styling);
+            parse_cif_file(extract, filenames[i].c_str());
+            result = structure_pointers(extract);
+        } catch (std::exception& e) {
+            if (PyErr_Occurred()) {
+                Py_DECREF(results);
+                throw;
+            }
+            result = PyUnicode_DecodeUTF8(e.what(), strlen(e.what()), "replace");
+        }
+        if (!result) {
+            Py_DECREF(results);
+            throw std::runtime_error("Python Error");
+        }
+        PyList_SET_ITEM(results, i, result);
+    }
+    return results;
+}
+
 PyObject*
 parse_mmCIF_buffer(const unsigned char *whole_file, PyObject* logger, bool coordsets, bool atomic, bool ignore_styling)
 {
 #ifdef CLOCK_PROFILING
     ClockProfile p("parse_mmCIF_buffer");
 #endif
+    logger::BufferedLog log_buffer(logger);
     ExtractMolecule extract(logger, StringVector(), coordsets, atomic, ignore_styling);
     extract.parse(reinterpret_cast<const char *>(whole_file));
     return structure_pointers(extract);
@@ -2737,6 +2975,7 @@ parse_mmCIF_buffer(const unsigned char *whole_file,
 #ifdef CLOCK_PROFILING
     ClockProfile p("parse_mmCIF_buffer2");
 #endif
+    logger::BufferedLog log_buffer(logger);
     ExtractMolecule extract(logger, generic_categories, coordsets, atomic, ignore_styling);
     extract.parse(reinterpret_cast<const char *>(whole_file));
     return structure_pointers(extract);
@@ -2887,7 +3126,7 @@ extract_CIF_tables(const char* filename,
 #endif
     ExtractTables extract(categories, all_data_blocks);
     try {
-        extract.parse_file(filename);
+        parse_cif_file(extract, filename);
     } catch (ExtractTables::Done&) {
         // normal early termination
     }
@@ -2902,6 +3141,283 @@ extract_CIF_tables(const char* filename,
     }
 }
 
+PyObject*
+extract_CIF_tables_from_text(const std::string& text,
+                     const std::vector<std::string> &categories)
+{
+    // text saved by ExtractMolecule::parse_generic_category() has no data block
+    string buffer("data_metadata\n");
+    buffer += text;
+    ExtractTables extract(categories, false);
+    try {
+        extract.parse(buffer.c_str());
+    } catch (ExtractTables::Done&) {
+        // normal early termination
+    }
+    if (extract.data == nullptr)
+        Py_RETURN_NONE;
+    return extract.data;
+}
+
+// Categories of one file kept as columns of strings without using Python,
+// so many files can be read on separate threads
+struct ExtractColumns: public readcif::CIFFile
+{
+    struct Done: std::exception {};
+    struct Table {
+        StringVector tags;
+        std::vector<StringVector> columns;
+    };
+    ExtractColumns(const StringVector& categories);
+    virtual void data_block(const string& name);
+    void parse_category();
+
+    std::map<string, Table> tables;
+    size_t num_categories;
+};
+
+ExtractColumns::ExtractColumns(const StringVector& categories):
+    num_categories(categories.size())
+{
+    for (auto& c: categories) {
+        register_category(c,
+            [this] () {
+                parse_category();
+            });
+    }
+}
+
+void
+ExtractColumns::data_block(const string& /*name*/)
+{
+    // only the first data block with categories in it
+    if (!tables.empty())
+        throw Done();
+}
+
+void
+ExtractColumns::parse_category()
+{
+    Table& t = tables[category()];
+    t.tags = colnames();
+    size_t num_colnames = t.tags.size();
+    t.columns.assign(num_colnames, StringVector());
+    size_t i = 0;
+    parse_whole_category(
+        [&] (const char* start, const char* end) {
+            t.columns[i].emplace_back(start, end - start);
+            if (++i == num_colnames)
+                i = 0;
+        });
+    // skip the rest of the file once all of the categories are found
+    if (tables.size() == num_categories)
+        throw Done();
+}
+
+static PyObject*
+string_list(const StringVector& strings)
+{
+    PyObject* list = PyList_New(strings.size());
+    if (!list)
+        return nullptr;
+    for (size_t i = 0; i < strings.size(); ++i) {
+        auto& s = strings[i];
+        PyObject* o = PyUnicode_DecodeUTF8(s.data(), s.size(), "replace");
+        if (!o) {
+            Py_DECREF(list);
+            return nullptr;
+        }
+        PyList_SET_ITEM(list, i, o);
+    }
+    return list;
+}
+
+// Combine a category from all of the files into one table: a tuple of tags,
+// a list of columns, each a list of str, and an int32 array of the index of
+// the file each row came from.  Tags missing from some files get "?" values.
+static PyObject*
+combined_table(const string& category, const std::vector<ExtractColumns*>& files)
+{
+    StringVector tags;
+    std::map<string, size_t> tag_index;
+    size_t num_rows = 0;
+    for (auto f: files) {
+        auto ti = f->tables.find(category);
+        if (ti == f->tables.end())
+            continue;
+        auto& t = ti->second;
+        for (auto& tag: t.tags) {
+            if (tag_index.emplace(tag, tags.size()).second)
+                tags.push_back(tag);
+        }
+        if (!t.columns.empty())
+            num_rows += t.columns[0].size();
+    }
+    if (tags.empty())
+        return nullptr;
+
+    std::vector<StringVector> columns(tags.size());
+    for (auto& c: columns)
+        c.reserve(num_rows);
+    int* file_index;
+    PyObject* file_array = python_int_array(num_rows, &file_index);
+    if (!file_array)
+        throw std::runtime_error("Python Error");
+    for (size_t fi = 0; fi < files.size(); ++fi) {
+        auto ti = files[fi]->tables.find(category);
+        if (ti == files[fi]->tables.end())
+            continue;
+        auto& t = ti->second;
+        size_t rows = t.columns.empty() ? 0 : t.columns[0].size();
+        std::vector<bool> found(tags.size(), false);
+        for (size_t c = 0; c < t.tags.size(); ++c) {
+            size_t ci = tag_index[t.tags[c]];
+            found[ci] = true;
+            auto& column = columns[ci];
+            // a short last row leaves fewer values in later columns
+            column.insert(column.end(), t.columns[c].begin(), t.columns[c].end());
+            column.resize(column.size() + rows - t.columns[c].size(), "?");
+        }
+        for (size_t ci = 0; ci < tags.size(); ++ci)
+            if (!found[ci])
+                columns[ci].resize(columns[ci].size() + rows, "?");
+        for (size_t r = 0; r < rows; ++r)
+            *file_index++ = fi;
+    }
+
+    PyObject* table = PyTuple_New(3);
+    if (!table) {
+        Py_DECREF(file_array);
+        throw std::runtime_error("Python Error");
+    }
+    PyTuple_SET_ITEM(table, 2, file_array);
+    PyObject* py_tags = PyTuple_New(tags.size());
+    if (!py_tags) {
+        Py_DECREF(table);
+        throw std::runtime_error("Python Error");
+    }
+    PyTuple_SET_ITEM(table, 0, py_tags);
+    for (size_t i = 0; i < tags.size(); ++i) {
+        PyObject* o = PyUnicode_DecodeUTF8(tags[i].data(), tags[i].size(), "replace");
+        if (!o) {
+            Py_DECREF(table);
+            throw std::runtime_error("Python Error");
+        }
+        PyTuple_SET_ITEM(py_tags, i, o);
+    }
+    PyObject* py_columns = PyList_New(columns.size());
+    if (!py_columns) {
+        Py_DECREF(table);
+        throw std::runtime_error("Python Error");
+    }
+    PyTuple_SET_ITEM(table, 1, py_columns);
+    for (size_t i = 0; i < columns.size(); ++i) {
+        PyObject* o = string_list(columns[i]);
+        if (!o) {
+            Py_DECREF(table);
+            throw std::runtime_error("Python Error");
+        }
+        PyList_SET_ITEM(py_columns, i, o);
+        StringVector().swap(columns[i]);
+    }
+    return table;
+}
+
+PyObject*
+extract_CIF_tables_files(const StringVector& filenames,
+                         const StringVector& categories)
+{
+#ifdef CLOCK_PROFILING
+    ClockProfile p("extract_CIF_tables_files");
+#endif
+    // Files are parsed on worker threads without the Python global
+    // interpreter lock, each taking the next unparsed file, and the tables
+    // are converted to Python objects afterwards.
+    size_t num_files = filenames.size();
+    std::vector<std::unique_ptr<ExtractColumns>> extracts(num_files);
+    StringVector errors(num_files);
+    std::atomic<size_t> next_file(0);
+    auto parse_files = [&] () {
+        for (size_t i = next_file++; i < num_files; i = next_file++) {
+            try {
+                extracts[i].reset(new ExtractColumns(categories));
+                try {
+                    parse_cif_file(*extracts[i], filenames[i].c_str());
+                } catch (ExtractColumns::Done&) {
+                    // normal early termination
+                }
+            } catch (std::exception& e) {
+                errors[i] = e.what();
+                if (errors[i].empty())
+                    errors[i] = "unknown error";
+                extracts[i].reset();
+            }
+        }
+    };
+    size_t num_threads = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()),
+                                          num_files);
+    Py_BEGIN_ALLOW_THREADS
+    std::vector<std::thread> threads;
+    for (size_t t = 1; t < num_threads; ++t)
+        threads.emplace_back(parse_files);
+    parse_files();
+    for (auto& t: threads)
+        t.join();
+    Py_END_ALLOW_THREADS
+
+    std::vector<ExtractColumns*> files(num_files);
+    ExtractColumns empty(StringVector{});
+    for (size_t i = 0; i < num_files; ++i)
+        files[i] = extracts[i] ? extracts[i].get() : &empty;
+
+    PyObject* tables = PyDict_New();
+    if (!tables)
+        throw std::runtime_error("Python Error");
+    PyObject* error_dict = PyDict_New();
+    if (!error_dict) {
+        Py_DECREF(tables);
+        throw std::runtime_error("Python Error");
+    }
+    try {
+        for (auto& category: categories) {
+            PyObject* table = combined_table(category, files);
+            if (table == nullptr)
+                continue;
+            int status = PyDict_SetItemString(tables, category.c_str(), table);
+            Py_DECREF(table);
+            if (status < 0)
+                throw std::runtime_error("Python Error");
+            // release the strings once converted
+            for (auto f: files)
+                f->tables.erase(category);
+        }
+        for (size_t i = 0; i < num_files; ++i) {
+            if (errors[i].empty())
+                continue;
+            PyObject* key = PyLong_FromSize_t(i);
+            PyObject* msg = PyUnicode_DecodeUTF8(errors[i].data(), errors[i].size(), "replace");
+            int status = (key && msg) ? PyDict_SetItem(error_dict, key, msg) : -1;
+            Py_XDECREF(key);
+            Py_XDECREF(msg);
+            if (status < 0)
+                throw std::runtime_error("Python Error");
+        }
+    } catch (...) {
+        Py_DECREF(tables);
+        Py_DECREF(error_dict);
+        throw;
+    }
+    PyObject* result = PyTuple_New(2);
+    if (!result) {
+        Py_DECREF(tables);
+        Py_DECREF(error_dict);
+        throw std::runtime_error("Python Error");
+    }
+    PyTuple_SET_ITEM(result, 0, tables);
+    PyTuple_SET_ITEM(result, 1, error_dict);
+    return result;
+}
+
 void
 non_standard_bonds(const Bond **bonds, size_t num_bonds, bool selected_only, bool displayed_only, Bonds& disulfide, Bonds& covalent)
 {
@@ -2972,37 +3488,17 @@ whitespace(Py_UCS4 ch)
     return std::end(whitespace) != std::find(std::begin(whitespace), std::end(whitespace), ch);
 }
 
-PyObject*
-quote_value(PyObject* value, int max_len)
-{
-    // Return CIF 1.1 data value version of string
-    // max_len is for mimicing the output from the PDB (see #2230)
-    PyObject* str = PyObject_Str(value);
-    if (!str)
-        return NULL;
-
-    if (PyBool_Check(value) || PyLong_Check(value) || PyFloat_Check(value))
-        return str;
+namespace {
 
-#ifdef Py_LIMITED_API
-    Py_ssize_t len = PyUnicode_GetLength(str);
-#else
-    Py_ssize_t len = PyUnicode_GET_LENGTH(str);
-#endif
-    if (len == 0) {
-        Py_DECREF(str);
-        return PyUnicode_FromString("''");
-    }
+enum Quoting { QUOTE_NONE, QUOTE_SINGLE, QUOTE_DOUBLE, QUOTE_TEXT_FIELD };
 
-    Py_UCS4 ch;
-#ifdef Py_LIMITED_API
-    Py_UCS4* data = PyUnicode_AsUCS4Copy(str);
-# define PyUnicode_READ(kind, data, index) data[index]
-#else
-    int kind = PyUnicode_KIND(str);
-    void* data = PyUnicode_DATA(str);
-#endif
-    ch = PyUnicode_READ(kind, data, 0);
+// How a CIF 1.1 data value has to be quoted, given a function
+// returning its len characters
+template <class Char>
+Quoting
+quoting(Char char_at, Py_ssize_t len, int max_len)
+{
+    Py_UCS4 ch = char_at(0);
     bool sing_quote = ch == '\'';
     bool dbl_quote = ch == '"';
     bool line_break = ch == '\n';
@@ -3010,79 +3506,79 @@ quote_value(PyObject* value, int max_len)
 
     if (!(special || sing_quote || dbl_quote || line_break)) {
         // check for conflict with reserved words
-        if (PyUnicode_READ(kind, data, len - 1) == '_') {
+        if (char_at(len - 1) == '_') {
             // check if a reserved word: "data_", "loop_", "save_", "stop_", or "global_"
             if (len == 5 && (ch == 'd' || ch == 'D')) {
                 // check if starts with "data_"
-                ch = PyUnicode_READ(kind, data, 1);
+                ch = char_at(1);
                 if (ch == 'a' || ch == 'A') {
-                    ch = PyUnicode_READ(kind, data, 2);
+                    ch = char_at(2);
                     if (ch == 't' || ch == 'T') {
-                        ch = PyUnicode_READ(kind, data, 3);
+                        ch = char_at(3);
                         special = (ch == 'a' || ch == 'A');
                     }
                 }
             } else if (len == 5 && (ch == 'l' || ch == 'L')) {
                 // check if "loop_"
-                ch = PyUnicode_READ(kind, data, 1);
+                ch = char_at(1);
                 if (ch == 'o' || ch == 'O') {
-                    ch = PyUnicode_READ(kind, data, 2);
+                    ch = char_at(2);
                     if (ch == 'o' || ch == 'O') {
-                        ch = PyUnicode_READ(kind, data, 3);
+                        ch = char_at(3);
                         special = (ch == 'p' || ch == 'P');
                     }
                 }
             } else if (len == 5 && (ch == 's' || ch == 'S')) {
                 // check if "stop_" or "save_"
-                ch = PyUnicode_READ(kind, data, 1);
+                ch = char_at(1);
                 if (ch == 't' || ch == 'T') {
-                    ch = PyUnicode_READ(kind, data, 2);
+                    ch = char_at(2);
                     if (ch == 'o' || ch == 'O') {
-                        ch = PyUnicode_READ(kind, data, 3);
+                        ch = char_at(3);
                         special = (ch == 'p' || ch == 'P');
                     }
                 } else if (ch == 'a' || ch == 'A') {
-                    ch = PyUnicode_READ(kind, data, 2);
+                    ch = char_at(2);
                     if (ch == 'v' || ch == 'V') {
-                        ch = PyUnicode_READ(kind, data, 3);
+                        ch = char_at(3);
                         special = (ch == 'e' || ch == 'E');
                     }
                 }
             } else if (len == 7 && (ch == 'g' || ch == 'G')) {
                 // check if "global_"
-                ch = PyUnicode_READ(kind, data, 1);
+                ch = char_at(1);
                 if (ch == 'l' || ch == 'L') {
-                    ch = PyUnicode_READ(kind, data, 2);
+                    ch = char_at(2);
                     if (ch == 'o' || ch == 'O') {
-                        ch = PyUnicode_READ(kind, data, 3);
+                        ch = char_at(3);
                         if (ch == 'b' || ch == 'B') {
-                            ch = PyUnicode_READ(kind, data, 4);
+                            ch = char_at(4);
                             if (ch == 'a' || ch == 'A') {
-                                ch = PyUnicode_READ(kind, data, 5);
+                                ch = char_at(5);
                                 special = (ch == 'l' || ch == 'L');
                             }
                         }
                     }
                 }
             }
-        } else if (len > 5 && PyUnicode_READ(kind, data, 4) == '_') {
+        } else if (len > 5 && char_at(4) == '_') {
             if (ch == 'd' || ch == 'D') {
                 // check if starts with "data_"
-                ch = PyUnicode_READ(kind, data, 1);
+                ch = char_at(1);
                 if (ch == 'a' || ch == 'A') {
-                    ch = PyUnicode_READ(kind, data, 2);
+                    ch = char_at(2);
                     if (ch == 't' || ch == 'T') {
-                        ch = PyUnicode_READ(kind, data, 3);
+                        ch = char_at(3);
                         special = (ch == 'a' || ch == 'A');
                     }
                 }
             } else if (ch == 's' || ch == 'S') {
                 // check if starts with "save_"
-                ch = PyUnicode_READ(kind, data, 1);
+                ch = char_at(1);
                 if (ch == 'a' || ch == 'A') {
-                    ch = PyUnicode_READ(kind, data, 2);
+                    ch = char_at(2);
                     if (ch == 'v' || ch == 'V') {
-                        ch = PyUnicode_READ(kind, data, 3);
+                        ch = char_at(3);
                         special = (ch == 'e' || ch == 'E');
                     }
                 }
@@ -3091,16 +3587,16 @@ quote_value(PyObject* value, int max_len)
     }
 
     for (auto i = 1; i < len; ++i) {
-        ch = PyUnicode_READ(kind, data, i);
+        ch = char_at(i);
         if (i < len - 1) {
             if (ch == '"') {
-                if (whitespace(PyUnicode_READ(kind, data, i + 1)))
+                if (whitespace(char_at(i + 1)))
                     dbl_quote = true;
                 else
                     special = true;
                 continue;
             } else if (ch == '\'') {
-                if (whitespace(PyUnicode_READ(kind, data, i + 1)))
+                if (whitespace(char_at(i + 1)))
                     sing_quote = true;
                 else
                     special = true;
@@ -3114,15 +3610,57 @@ quote_value(PyObject* value, int max_len)
                 special = true;
         }
     }
+    if (line_break || (sing_quote && dbl_quote) || (max_len && len > max_len))
+        return QUOTE_TEXT_FIELD;
+    if (dbl_quote)
+        return QUOTE_SINGLE;
+    if (sing_quote || special)
+        return QUOTE_DOUBLE;
+    return QUOTE_NONE;
+}
+
+} // namespace
+
+PyObject*
+quote_value(PyObject* value, int max_len)
+{
+    // Return CIF 1.1 data value version of string
+    // max_len is for mimicing the output from the PDB (see #2230)
+    PyObject* str = PyObject_Str(value);
+    if (!str)
+        return NULL;
+
+    if (PyBool_Check(value) || PyLong_Check(value) || PyFloat_Check(value))
+        return str;
+
+#ifdef Py_LIMITED_API
+    Py_ssize_t len = PyUnicode_GetLength(str);
+#else
+    Py_ssize_t len = PyUnicode_GET_LENGTH(str);
+#endif
+    if (len == 0) {
+        Py_DECREF(str);
+        return PyUnicode_FromString("''");
+    }
+
+#ifdef Py_LIMITED_API
+    Py_UCS4* data = PyUnicode_AsUCS4Copy(str);
+    auto char_at = [data](Py_ssize_t i) { return data[i]; };
+#else
+    int kind = PyUnicode_KIND(str);
+    void* data = PyUnicode_DATA(str);
+    auto char_at = [kind, data](Py_ssize_t i) { return PyUnicode_READ(kind, data, i); };
+#endif
+    Quoting q = quoting(char_at, len, max_len);
 #ifdef Py_LIMITED_API
     PyMem_Free(data);
 #endif
     PyObject* result;
-    if (line_break || (sing_quote && dbl_quote) || (max_len && len > max_len))
+    if (q == QUOTE_TEXT_FIELD)
         result = PyUnicode_FromFormat("\n;%U\n;\n", str);
-    else if (dbl_quote)
+    else if (q == QUOTE_SINGLE)
         result = PyUnicode_FromFormat("'%U'", str);
-    else if (sing_quote || special)
+    else if (q == QUOTE_DOUBLE)
         result = PyUnicode_FromFormat("\"%U\"", str);
     else
         return str;
@@ -3130,4 +3668,23 @@ quote_value(PyObject* value, int max_len)
     return result;
 }
 
+std::string
+quote_string(const std::string& value, int max_len)
+{
+    // Same as quote_value() for strings of ASCII characters
+    Py_ssize_t len = value.size();
+    if (len == 0)
+        return "''";
+    const char* data = value.data();
+    Quoting q = quoting([data](Py_ssize_t i) { return Py_UCS4((unsigned char) data[i]); },
+                        len, max_len);
+    if (q == QUOTE_TEXT_FIELD)
+        return "\n;" + value + "\n;\n";
+    if (q == QUOTE_SINGLE)
+        return "'" + value + "'";
+    if (q == QUOTE_DOUBLE)
+        return "\"" + value + "\"";
+    return value;
+}
+
 } // namespace mmcif
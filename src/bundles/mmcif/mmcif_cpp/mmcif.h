@@ -38,12 +38,14 @@ namespace tmpl {
 
 namespace atomstruct {
     class Bond;
+    class Residue;
 }
 
 namespace mmcif {
 
 using atomstruct::ResName;
 using atomstruct::Bond;
+using atomstruct::Residue;
 
 PyObject*   parse_mmCIF_file(const char* filename, PyObject* logger,
                              bool coordsets, bool atomic, bool ignore_styling);
@@ -52,17 +54,42 @@ PyObject*   parse_mmCIF_file(const char* filename,
                              PyObject* logger, bool coordsets, bool atomic, bool ignore_styling);
 PyObject*   parse_mmCIF_buffer(const unsigned char* buffer, PyObject* logger,
                                bool coordsets, bool atomic, bool ignore_styling);
+// Returns a list with, for each file, its structure pointers, or a string
+// with the error message if it could not be parsed.
+PyObject*   parse_mmCIF_files(const std::vector<std::string> &filenames,
+                             const std::vector<std::string> &extra_categories,
+                             PyObject* logger, bool coordsets, bool atomic, bool ignore_styling);
 PyObject*   parse_mmCIF_buffer(const unsigned char* buffer,
                              const std::vector<std::string> &extra_categories,
                              PyObject* logger, bool coordsets, bool atomic, bool ignore_styling);
 void        load_mmCIF_templates(const char* filename);
+void        index_mmCIF_templates(const char* filename);
 void        set_Python_locate_function(PyObject* function);
+void        set_Python_locate_many_function(PyObject* function);
 
 PyObject*   extract_CIF_tables(const char* filename,
                                const std::vector<std::string> &categories,
                                bool all_data_blocks);
+PyObject*   extract_CIF_tables_from_text(const std::string& text,
+                               const std::vector<std::string> &categories);
+PyObject*   extract_CIF_tables_files(const std::vector<std::string> &filenames,
+                               const std::vector<std::string> &categories);
 
 PyObject*   quote_value(PyObject* value, int max_len=60);
+std::string quote_string(const std::string& value, int max_len=60);
+// Write a category as CIFTable.print() does, through the write method of a
+// Python file object, formatting the rows on several threads
+void        write_cif_table(PyObject* file, const std::string& name,
+                            const std::vector<std::string>& tags, PyObject* values,
+                            bool fixed_width);
+// Write the atom_site and atom_site_anisotrop categories for the atoms of
+// the residues, given 9 values for each residue (see writer.cpp), their
+// coordinate set indices (-1 for the active one) and 3 by 4 transforms
+// (index -1 for none)
+void        write_atom_site(PyObject* file, const Residue** residues, size_t num_residues,
+                            PyObject* residue_values, const int* coordsets,
+                            const double* xforms, int num_xforms, const int* xform_indices,
+                            bool selected_only, bool displayed_only, bool fixed_width);
 typedef std::vector<const Bond*> Bonds;
 void        non_standard_bonds(const Bond** bonds, size_t num_bonds, bool selected_only, bool displayed_only, Bonds& disulfide, Bonds& covalent);
 
@@ -72,6 +99,11 @@ const tmpl::Residue*
 typedef std::function<std::string (const ResName& residue_type)>
             LocateFunc;
 void        set_locate_template_function(LocateFunc func);
+// Load the templates for all of the names, so missing ones can be located together
+void        find_template_residues(const std::vector<ResName>& names);
+typedef std::function<std::vector<std::string> (const std::vector<ResName>& residue_types)>
+            LocateManyFunc;
+void        set_locate_templates_function(LocateManyFunc func);
 #endif
 
 }  // namespace mmcif
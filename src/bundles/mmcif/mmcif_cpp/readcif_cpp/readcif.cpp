@@ -46,6 +46,8 @@
 #include <iostream>
 #include <algorithm>
 #include <sstream>
+#include <exception>
+#include <thread>
 #ifdef _WIN32
 # define UNICODE
 # include <windows.h>
@@ -94,6 +96,18 @@ is_not_eol(char c)
 #endif
 }
 
+// Return the end of the line that s is in.  The C library's search is
+// vectorized, unlike a character at a time loop.
+inline const char*
+find_eol(const char* s)
+{
+#ifdef CR_IS_EOL
+	return s + strcspn(s, "\n\r");
+#else
+	return s + strcspn(s, "\n");
+#endif
+}
+
 #define STRNEQ_P1(name, buf, len) (strncmp((name) + 1, (buf) + 1, (len) - 1) == 0)
 #ifndef CASE_INSENSITIVE
 #define ICASEEQN_P1(name, buf, len) STRNEQ_P1(name, buf, len)
@@ -587,6 +601,7 @@ CIFFile::internal_parse(bool one_table)
 				seen.insert(current_category);
 				first_row = true;
 				in_loop = true;
+				loop_start = loop_pos;
 				ParseCategory& pf = (cii != categories.end()) ? cii->second.func : unregistered;
 				pf();
 				first_row = false;
@@ -799,6 +814,7 @@ CIFFile::internal_reset_parse()
 	current_colnames_cp.clear();
 	values.clear();
 	in_loop = false;
+	loop_start = nullptr;
 	first_row = false;
 	columns.clear();
 	seen.clear();
@@ -860,8 +876,7 @@ again:
 		if (save_values)
 			current_value_tmp.clear();
 		for (;;) {
-			for (e = pos; is_not_eol(*e); ++e)
-				continue;
+			e = find_eol(pos);
 			if (save_values)
 				current_value_tmp += string(pos, e - pos);
 			pos = e;
@@ -890,8 +905,7 @@ again:
 		return;
 	}
 	case '#':
-		for (++pos; is_not_eol(*pos); ++pos)
-			continue;
+		pos = find_eol(pos + 1);
 #ifdef CR_IS_EOL
 		if (*pos == '\r')
 			++pos;
@@ -1019,8 +1033,7 @@ CIFFile::stylized_next_keyword(bool tag_okay)
 	// In a stylized PDBx/mmCIF file, all keywords are lowercase,
 	// the tags are mixed case, and all are at the beginning of a line.
 	for (;;) {
-		for (; is_not_eol(*pos); ++pos)
-			continue;
+		pos = find_eol(pos);
 		if (!*pos) {
 			current_token = T_EOI;
 			return;
@@ -1037,8 +1050,7 @@ CIFFile::stylized_next_keyword(bool tag_okay)
 				continue;
 			++pos;
 			for (;;) {
-				for (; is_not_eol(*pos); ++pos)
-					continue;
+				pos = find_eol(pos);
 #ifdef CR_IS_EOL
 				if (*pos == '\r' && *(pos + 1) == '\n')
 					++pos;
@@ -1360,6 +1372,148 @@ CIFFile::parse_row(ParseValues& pv)
 	return true;
 }
 
+long
+CIFFile::parse_rows_threaded(int num_threads, size_t max_rows,
+				ChunkValues chunk_values, RowDone row_done)
+{
+#ifndef FIXED_LENGTH_ROWS
+	return -1;
+#else
+	if (current_category.empty())
+		// not category or exhausted values
+		throw error("no values available");
+	if (current_colnames.empty())
+		return 0;
+	if (!values.empty())
+		return -1;
+	if (first_row) {
+		// Leave first_row set, so parse_row() still sorts its
+		// ParseValues if it is used after all.  The column offsets
+		// are the same for every row, so this can be repeated.
+		bool fixed = use_fixed_width_columns.count(current_category);
+		if (!fixed || !stylized || current_token != T_VALUE)
+			return -1;
+		columns = find_column_offsets();
+	}
+	if (columns.empty())
+		return -1;
+	if (current_token != T_VALUE) {
+		current_colnames.clear();
+		current_colnames_cp.clear();
+		return 0;
+	}
+	const char* start = current_value_start;
+	if (is_not_whitespace(*(start - 1)))
+		--start;	// must have had a leading quote
+	if (is_not_eol(*(start - 1)))
+		return -1;	// isn't at start of line, so not stylized
+
+	// Find the rows in this batch.  Every row is exactly row_len
+	// characters followed by a newline, anything else ends the batch
+	// and is left to the regular tokenizer.
+	const size_t row_len = columns.back();
+	const char* end = start;
+	size_t num_rows = 0;
+	for (; num_rows < max_rows; ++num_rows) {
+		char c = *end;
+		if (c == '\0' || c == '#' || c == '_' || c == ';'
+		|| is_whitespace(c))
+			break;
+		if ((c == 'd' && strncmp(end, "data_", 5) == 0)
+		|| (c == 'l' && strncmp(end, "loop_", 5) == 0)
+		|| (c == 's' && (strncmp(end, "save_", 5) == 0
+				|| strncmp(end, "stop_", 5) == 0))
+		|| (c == 'g' && strncmp(end, "global_", 7) == 0))
+			break;
+		const char* eol = static_cast<const char*>(
+					memchr(end, '\n', row_len + 1));
+		if (eol != end + row_len)
+			break;
+		end = eol + 1;
+	}
+	if (num_rows == 0)
+		return -1;
+
+	for (int i = 0; i < num_threads; ++i) {
+		ParseValues& pv = chunk_values(i);
+		std::sort(pv.begin(), pv.end(),
+			[](const ParseColumn& a, const ParseColumn& b) -> bool {
+				return a.column < b.column;
+			});
+	}
+	const auto& cols = columns;
+	auto parse_chunk = [&](int chunk, const char* first, const char* last) {
+		ParseValues& pv = chunk_values(chunk);
+		auto pvb = pv.begin(), pve = pv.end();
+		while (pvb != pve && pvb->column < 0)
+			++pvb;
+		for (const char* row = first; row != last; row += row_len + 1) {
+			for (auto pvi = pvb; pvi != pve; ++pvi) {
+				// same value extraction as parse_row()
+				const char* value_start = row + cols[pvi->column];
+				const char* value_end = row + cols[pvi->column + 1];
+				if (*value_start == '\''
+				|| *value_start == '"') {
+					// strip leading and trailng quotes
+					--value_end;
+					while (*value_end != *value_start)
+						--value_end;
+					++value_start;
+				} else if (pvi->need_end) {
+					// strip trailing whitespace
+					--value_end;
+					while (*value_end == ' '
+					|| is_whitespace(*value_end))
+						--value_end;
+					++value_end;
+				}
+				if (pvi->need_end)
+					pvi->func2(value_start, value_end);
+				else
+					pvi->func1(value_start);
+			}
+			row_done(chunk);
+		}
+	};
+
+	// not worth starting threads for a small number of rows
+	const size_t min_rows_per_chunk = 4096;
+	size_t num_chunks = std::min<size_t>(std::max(num_threads, 1),
+				std::max<size_t>(1, num_rows / min_rows_per_chunk));
+	if (num_chunks == 1)
+		parse_chunk(0, start, end);
+	else {
+		size_t rows_per_chunk = (num_rows + num_chunks - 1) / num_chunks;
+		std::vector<std::thread> threads;
+		std::vector<std::exception_ptr> errors(num_chunks);
+		threads.reserve(num_chunks);
+		for (size_t i = 0; i < num_chunks; ++i) {
+			size_t row0 = std::min(num_rows, i * rows_per_chunk);
+			size_t row1 = std::min(num_rows, row0 + rows_per_chunk);
+			const char* first = start + row0 * (row_len + 1);
+			const char* last = start + row1 * (row_len + 1);
+			threads.emplace_back([&parse_chunk, &errors, i, first, last] {
+				try {
+					parse_chunk(i, first, last);
+				} catch (...) {
+					errors[i] = std::current_exception();
+				}
+			});
+		}
+		for (auto& t: threads)
+			t.join();
+		for (auto& e: errors)
+			if (e)
+				std::rethrow_exception(e);
+	}
+
+	pos = end;
+	lineno += num_rows;
+	next_token();
+	return num_rows;
+#endif
+}
+
 StringVector
 CIFFile::parse_whole_category()
 {
@@ -1391,6 +1545,34 @@ CIFFile::parse_whole_category()
 	return values;
 }
 
+string
+CIFFile::category_text()
+{
+	if (current_category.empty())
+		// not category or exhausted values
+		throw error("no values available");
+	if (!in_loop || !values.empty())
+		return string();	// parse values normally
+	if (current_colnames.empty() || current_token != T_VALUE) {
+		current_colnames.clear();
+		current_colnames_cp.clear();
+		return string();
+	}
+
+	// values are only scanned, so don't copy them
+	const char* end = pos;
+	save_values = false;
+	while (current_token == T_VALUE) {
+		end = pos;
+		next_token();
+	}
+	save_values = true;
+
+	current_colnames.clear();
+	current_colnames_cp.clear();
+	return string(loop_start, end - loop_start);
+}
+
 void
 CIFFile::parse_whole_category(ParseValue2 func)
 {
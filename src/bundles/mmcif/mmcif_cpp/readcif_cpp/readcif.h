@@ -76,6 +76,33 @@ is_not_whitespace(char c)
 // atof when inlined within a parser. 
 inline double str_to_float(const char* s)
 {
+    // Fast path for plain decimals, such as coordinates, that gives the
+    // same result as the general case below.
+    static const double neg_powers[] = {
+        1e0, 1e-1, 1e-2, 1e-3, 1e-4, 1e-5, 1e-6, 1e-7, 1e-8, 1e-9
+    };
+    {
+        const char* p = s;
+        bool neg = *p == '-';
+        if (neg)
+            ++p;
+        long long iv = 0;
+        const char* digits = p;
+        for (; *p >= '0' && *p <= '9'; ++p)
+            iv = iv * 10 + (*p - '0');
+        if (p != digits && *p == '.') {
+            const char* frac = ++p;
+            for (; *p >= '0' && *p <= '9'; ++p)
+                iv = iv * 10 + (*p - '0');
+            int decimals = p - frac;
+            if (decimals <= 9 && p - digits <= 18 && *p != 'e' && *p != 'E'
+            && *p != '.' && *p != '-' && *p != '+') {
+                double fv = iv * neg_powers[decimals];
+                return (neg ? -fv : fv);
+            }
+        }
+    }
+
     bool saw_digit = false;
     bool saw_decimal = false;
     bool saw_exp = false;
@@ -243,12 +270,32 @@ public:
     // no more data in table.
     bool parse_row(ParseValues& pv);
 
+    // Threaded alternative to parse_row() for big tables with fixed
+    // width columns.  Up to max_rows of the remaining rows are split
+    // into line-aligned chunks, one per thread.  chunk_values(i) gives
+    // the ParseValues for chunk i; those functions, and row_done(i) after
+    // each row, are called on chunk i's thread, and within a chunk, rows
+    // are in file order.  Returns the number of rows parsed (zero when
+    // the table is exhausted), or -1 if the next row isn't suitable for
+    // threaded parsing, in which case parse_row() should be used instead.
+    typedef std::function<ParseValues& (int chunk)> ChunkValues;
+    typedef std::function<void (int chunk)> RowDone;
+    long parse_rows_threaded(int num_threads, size_t max_rows,
+                ChunkValues chunk_values, RowDone row_done);
+
     // Return complete contents of a category as a vector of strings.
     StringVector parse_whole_category();
 
     // Tokenize complete contents of category and Call func for each item in it
     void parse_whole_category(ParseValue2 func);
 
+    // For a category given as a loop, skip its values without saving
+    // them and return the unparsed text from the loop_ keyword through
+    // the last value, so it can be parsed later if needed.  Returns an
+    // empty string for loops without values, and for tag-value
+    // categories, whose values should be parsed as usual instead.
+    std::string category_text();
+
     // Return current category.
     const std::string& category() const;
 
@@ -317,6 +364,7 @@ private:
     StringVector    current_colnames_cp;   // case-preserved colnames
     StringVector    values;
     bool        in_loop;
+    const char* loop_start;     // start of current loop_ keyword
     bool        first_row;
     std::vector<int> columns;   // for stylized files
     std::unordered_set<std::string> use_fixed_width_columns;
@@ -47,6 +47,8 @@
 #include <sys/stat.h>
 #include <algorithm>
 #include <sstream>
+#include <fstream>
+#include <unordered_map>
 
 #undef LEAVING_ATOMS
 
@@ -78,6 +80,19 @@ static const bool Required = true;  // column is required
 
 tmpl::Molecule* templates;
 LocateFunc  locate_func;
+LocateManyFunc  locate_many_func;
+
+// Data blocks of an indexed template file, such as components.cif, that
+// are parsed when their residue is first needed
+struct TemplateBlock {
+    std::streamoff  offset;
+    std::streamoff  length;
+};
+string  template_index_filename;
+std::unordered_map<ResName, TemplateBlock>  template_index;
+
+static bool
+load_indexed_template(const ResName& name);
 
 const tmpl::Residue*
 find_template_residue(const ResName& name, bool start, bool stop)
@@ -89,6 +104,8 @@ find_template_residue(const ResName& name, bool start, bool stop)
         templates = new tmpl::Molecule();
     else
         tr = templates->find_residue(name);
+    if (tr == nullptr && load_indexed_template(name))
+        tr = templates->find_residue(name);
     if (tr == nullptr) {
         if (locate_func == nullptr)
             return nullptr;
@@ -520,12 +537,131 @@ load_mmCIF_templates(const char* filename)
 #endif
 }
 
+static void
+parse_template_buffer(const char* buffer)
+{
+    ExtractTemplate extract;
+    try {
+        extract.parse(buffer);
+    } catch (std::exception& e) {
+        std::cerr << "Loading template failed: " << e.what() << '\n';
+    }
+}
+
+void
+index_mmCIF_templates(const char* filename)
+{
+    // Record where each data block starts instead of parsing the whole
+    // file.  The index is saved next to the file, and reused while it is
+    // newer than the file and the file size matches.
+    std::ifstream in(filename, std::ios::binary);
+    if (!in)
+        throw std::runtime_error(string("Unable to open template file: ") + filename);
+    in.seekg(0, std::ios::end);
+    std::streamoff file_size = in.tellg();
+    in.seekg(0);
+
+    std::unordered_map<ResName, TemplateBlock> index;
+    string index_filename = string(filename) + ".index";
+    struct stat file_info, index_info;
+    if (stat(filename, &file_info) == 0 && stat(index_filename.c_str(), &index_info) == 0
+    && index_info.st_mtime >= file_info.st_mtime) {
+        std::ifstream saved(index_filename);
+        string magic;
+        std::streamoff saved_size;
+        if (saved >> magic >> saved_size && magic == "template-index"
+        && saved_size == file_size) {
+            string name;
+            TemplateBlock block;
+            while (saved >> name >> block.offset >> block.length)
+                index[name] = block;
+        }
+    }
+    if (index.empty()) {
+        string line;
+        std::streamoff offset = 0;
+        ResName name;
+        std::streamoff start = 0;
+        while (std::getline(in, line)) {
+            if (line.compare(0, 5, "data_") == 0) {
+                if (!name.empty())
+                    index[name] = { start, offset - start };
+                size_t end = line.size();
+                while (end > 5 && isspace(line[end - 1]))
+                    --end;
+                name = line.substr(5, end - 5);
+                start = offset;
+            }
+            offset += line.size() + 1;
+        }
+        if (!name.empty())
+            index[name] = { start, file_size - start };
+        std::ofstream saved(index_filename);
+        if (saved) {
+            saved << "template-index " << file_size << '\n';
+            for (auto& i: index)
+                saved << i.first << ' ' << i.second.offset << ' ' << i.second.length << '\n';
+        }
+    }
+    template_index_filename = filename;
+    template_index.swap(index);
+}
+
+static bool
+load_indexed_template(const ResName& name)
+{
+    auto i = template_index.find(name);
+    if (i == template_index.end())
+        return false;
+    TemplateBlock block = i->second;
+    template_index.erase(i);    // only try once
+    std::ifstream in(template_index_filename, std::ios::binary);
+    if (!in)
+        return false;
+    string buffer(block.length, '\0');
+    in.seekg(block.offset);
+    if (!in.read(&buffer[0], block.length))
+        return false;
+    if (templates == nullptr)
+        templates = new tmpl::Molecule();
+    parse_template_buffer(buffer.c_str());
+    return true;
+}
+
+void
+find_template_residues(const std::vector<ResName>& names)
+{
+    // Resolve many templates at once, so that the ones that are not
+    // already available can be located together, e.g., fetched concurrently
+    if (templates == nullptr)
+        templates = new tmpl::Molecule();
+    std::vector<ResName> missing;
+    for (auto& name: names) {
+        if (name.empty() || templates->find_residue(name) != nullptr
+        || load_indexed_template(name))
+            continue;
+        missing.push_back(name);
+    }
+    if (missing.size() < 2 || locate_many_func == nullptr)
+        return;     // find_template_residue will locate them one at a time
+    for (auto& filename: locate_many_func(missing)) {
+        if (!filename.empty())
+            load_mmCIF_templates(filename.c_str());
+    }
+}
+
 void
 set_locate_template_function(LocateFunc function)
 {
     locate_func = function;
 }
 
+void
+set_locate_templates_function(LocateManyFunc function)
+{
+    locate_many_func = function;
+}
+
 void
 set_Python_locate_function(PyObject* function)
 {
@@ -565,4 +701,56 @@ set_Python_locate_function(PyObject* function)
     };
 }
 
+void
+set_Python_locate_many_function(PyObject* function)
+{
+    static PyObject* save_reference_to_function = nullptr;
+
+    if (function == nullptr || function == Py_None) {
+        locate_many_func = nullptr;
+        return;
+    }
+    if (!PyCallable_Check(function))
+        throw std::logic_error("function must be a callable object");
+
+    if (locate_many_func != nullptr)
+        Py_DECREF(save_reference_to_function);
+    Py_INCREF(function);
+    save_reference_to_function = function;
+
+    locate_many_func = [function] (const std::vector<ResName>& names) -> StringVector {
+        PyObject* names_arg = PyList_New(names.size());
+        if (names_arg == nullptr)
+            throw std::runtime_error("Python Error");
+        for (size_t i = 0; i < names.size(); ++i) {
+            PyObject* name = PyUnicode_DecodeUTF8(names[i].data(), names[i].size(), "replace");
+            if (name == nullptr) {
+                Py_DECREF(names_arg);
+                throw std::runtime_error("Python Error");
+            }
+            PyList_SET_ITEM(names_arg, i, name);
+        }
+        PyObject* result = PyObject_CallFunction(function, "O", names_arg);
+        Py_DECREF(names_arg);
+        if (result == nullptr)
+            throw std::runtime_error("Python Error");
+        StringVector filenames;
+        PyObject* seq = PySequence_Fast(result, "locate function should return a sequence");
+        Py_DECREF(result);
+        if (seq == nullptr)
+            throw std::runtime_error("Python Error");
+        Py_ssize_t size = PySequence_Fast_GET_SIZE(seq);
+        PyObject** items = PySequence_Fast_ITEMS(seq);
+        for (Py_ssize_t i = 0; i < size; ++i) {
+            if (!PyUnicode_Check(items[i]))
+                continue;   // None for templates that weren't found
+            Py_ssize_t len;
+            const char *data = PyUnicode_AsUTF8AndSize(items[i], &len);
+            filenames.emplace_back(data, len);
+        }
+        Py_DECREF(seq);
+        return filenames;
+    };
+}
+
 } // namespace mmcif
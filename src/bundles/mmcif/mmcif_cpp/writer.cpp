@@ -0,0 +1,431 @@
+// vi: set expandtab ts=4 sw=4:
+
+/*
+ * === UCSF ChimeraX Copyright ===
+ * Copyright 2022 Regents of the University of California. All rights reserved.
+ * The ChimeraX application is provided pursuant to the ChimeraX license
+ * agreement, which covers academic and commercial uses. For more details, see
+ * <http://www.rbvi.ucsf.edu/chimerax/docs/licensing.html>
+ *
+ * This particular file is part of the ChimeraX library. You can also
+ * redistribute and/or modify it under the terms of the GNU Lesser General
+ * Public License version 2.1 as published by the Free Software Foundation.
+ * For more details, see
+ * <https://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESSED OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. ADDITIONAL LIABILITY
+ * LIMITATIONS ARE DESCRIBED IN THE GNU LESSER GENERAL PUBLIC LICENSE
+ * VERSION 2.1
+ *
+ * This notice must be embedded in or attached to all copies, including partial
+ * copies, of the software or any revisions or derivations thereof.
+ * === UCSF ChimeraX Copyright ===
+ */
+
+
+// Native writing of CIF tables.  Values are converted to strings while
+// holding the Python global interpreter lock, and the rows are then formatted
+// on several threads and written in blocks through the write method of the
+// Python file object, so the output streams to whatever the file is (a plain
+// or gzip file) without the whole table in memory.
+
+#include "_mmcif.h"
+#include "mmcif.h"
+#include <atomstruct/Atom.h>
+#include <atomstruct/CoordSet.h>
+#include <atomstruct/Residue.h>
+#include <atomstruct/Structure.h>
+#include <element/Element.h>
+#include <arrays/threadpool.h>	// Use Thread_Pool::parallel_for
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+
+using std::string;
+using std::vector;
+
+using atomstruct::Atom;
+using atomstruct::Coord;
+using atomstruct::CoordSet;
+using atomstruct::Residue;
+
+namespace mmcif {
+
+namespace {
+
+// Rows formatted in each block of output, per thread
+const size_t BLOCK_ROWS = 16384;
+
+inline void
+append_int(string& out, long long value)
+{
+    char buf[24];
+    auto result = std::to_chars(buf, buf + sizeof buf, value);
+    out.append(buf, result.ptr - buf);
+}
+
+// Append value as printf("%.<decimals>f") formats it.  Integer arithmetic
+// is used unless the value is too large, or too close to halfway between
+// two outputs, for it to round exactly.
+void
+append_fixed(string& out, double value, int decimals)
+{
+    static const double scale[] = { 1, 10, 100, 1000, 10000 };
+    static const long long iscale[] = { 1, 10, 100, 1000, 10000 };
+    double s = std::fabs(value) * scale[decimals];
+    double whole = std::floor(s);
+    double frac = s - whole;
+    if (!(s < 1e9) || std::fabs(frac - 0.5) < 1e-6) {
+        char buf[512];
+        int n = std::snprintf(buf, sizeof buf, "%.*f", decimals, value);
+        out.append(buf, std::min(n, (int) sizeof buf - 1));
+        return;
+    }
+    long long n = (long long) whole + (frac > 0.5);
+    if (std::signbit(value))
+        out += '-';
+    append_int(out, n / iscale[decimals]);
+    if (decimals == 0)
+        return;
+    out += '.';
+    long long f = n % iscale[decimals];
+    char digits[4];
+    for (int i = decimals - 1; i >= 0; --i, f /= 10)
+        digits[i] = '0' + f % 10;
+    out.append(digits, decimals);
+}
+
+// Characters in UTF-8 text, for column widths
+inline size_t
+text_width(const string& s)
+{
+    size_t n = 0;
+    for (unsigned char c: s)
+        n += (c & 0xC0) != 0x80;
+    return n;
+}
+
+string
+utf8_string(PyObject* str)
+{
+    Py_ssize_t size;
+    const char* data = PyUnicode_AsUTF8AndSize(str, &size);
+    if (data == nullptr)
+        throw std::runtime_error("Python Error");
+    return string(data, size);
+}
+
+void
+file_write(PyObject* write, const string& text)
+{
+    PyObject* str = PyUnicode_DecodeUTF8(text.data(), text.size(), "replace");
+    if (str == nullptr)
+        throw std::runtime_error("Python Error");
+    PyObject* result = PyObject_CallFunctionObjArgs(write, str, nullptr);
+    Py_DECREF(str);
+    if (result == nullptr)
+        throw std::runtime_error("Python Error");
+    Py_DECREF(result);
+}
+
+// Quoted values of a sequence of Python objects
+vector<string>
+quoted_values(PyObject* values)
+{
+    PyObject* seq = PySequence_Fast(values, "values should be a sequence");
+    if (seq == nullptr)
+        throw std::runtime_error("Python Error");
+    vector<string> quoted;
+    Py_ssize_t n = PySequence_Fast_GET_SIZE(seq);
+    quoted.reserve(n);
+    try {
+        for (Py_ssize_t i = 0; i < n; ++i) {
+            PyObject* q = quote_value(PySequence_Fast_GET_ITEM(seq, i));
+            if (q == nullptr)
+                throw std::runtime_error("Python Error");
+            quoted.push_back(utf8_string(q));
+            Py_DECREF(q);
+        }
+    } catch (...) {
+        Py_DECREF(seq);
+        throw;
+    }
+    Py_DECREF(seq);
+    return quoted;
+}
+
+// Fills in the cells of a row, which must not use Python
+typedef std::function<void (size_t row, vector<string>& cells)> Row_Cells;
+
+// Write a table as CIFTable.print() does.  Called holding the global
+// interpreter lock, which is released while rows are formatted.
+void
+write_table(PyObject* file, const string& name, const vector<string>& tags,
+    size_t num_rows, const Row_Cells& row_cells, bool fixed_width)
+{
+    size_t n = tags.size();
+    if (n == 0 || num_rows == 0)
+        return;
+    PyObject* write = PyObject_GetAttrString(file, "write");
+    if (write == nullptr)
+        throw std::runtime_error("Python Error");
+    try {
+        vector<string> cells(n);
+        string text;
+        if (num_rows == 1) {
+            row_cells(0, cells);
+            for (size_t c = 0; c < n; ++c)
+                text += '_' + name + '.' + tags[c] + ' ' + cells[c] + '\n';
+            text += "#\n";
+            file_write(write, text);
+            Py_DECREF(write);
+            return;
+        }
+        text = "loop_\n";
+        for (auto& t: tags)
+            text += '_' + name + '.' + t + '\n';
+        file_write(write, text);
+
+        // fixed width columns are not possible if a value is a text field
+        vector<size_t> widths(n, 0);
+        bool bad_fixed_width = false;
+        std::exception_ptr error;
+        std::mutex mutex;
+        if (fixed_width) {
+            Py_BEGIN_ALLOW_THREADS
+            Thread_Pool::parallel_for(num_rows, [&](int64_t r0, int64_t r1) {
+                vector<string> cells(n);
+                vector<size_t> w(n, 0);
+                bool bad = false;
+                try {
+                    for (int64_t r = r0; r < r1; ++r) {
+                        row_cells(r, cells);
+                        for (size_t c = 0; c < n; ++c) {
+                            w[c] = std::max(w[c], text_width(cells[c]));
+                            bad = bad || cells[c][0] == '\n';
+                        }
+                    }
+                } catch (...) {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    error = std::current_exception();
+                    return;
+                }
+                std::lock_guard<std::mutex> lock(mutex);
+                for (size_t c = 0; c < n; ++c)
+                    widths[c] = std::max(widths[c], w[c]);
+                bad_fixed_width = bad_fixed_width || bad;
+            }, BLOCK_ROWS);
+            Py_END_ALLOW_THREADS
+            if (error)
+                std::rethrow_exception(error);
+            fixed_width = !bad_fixed_width;
+        }
+
+        auto format_rows = [&](size_t r0, size_t r1, string& out) {
+            vector<string> cells(n);
+            for (size_t r = r0; r < r1; ++r) {
+                row_cells(r, cells);
+                if (fixed_width) {
+                    for (size_t c = 0; c < n; ++c) {
+                        out += cells[c];
+                        out.append(widths[c] - text_width(cells[c]) + 1, ' ');
+                    }
+                } else if (r == 0 && bad_fixed_width) {
+                    // first row is broken up into multiple lines
+                    out += cells[0];
+                    out += '\n';
+                    for (size_t c = 1; c < n; ++c) {
+                        if (c > 1)
+                            out += ' ';
+                        out += cells[c];
+                    }
+                } else {
+                    for (size_t c = 0; c < n; ++c) {
+                        if (c > 0)
+                            out += ' ';
+                        out += cells[c];
+                    }
+                }
+                out += '\n';
+            }
+        };
+        size_t num_blocks = (num_rows + BLOCK_ROWS - 1) / BLOCK_ROWS;
+        size_t blocks_per_write = std::max(Thread_Pool::max_threads(), 1);
+        vector<string> blocks(blocks_per_write);
+        for (size_t b0 = 0; b0 < num_blocks; b0 += blocks_per_write) {
+            size_t nb = std::min(blocks_per_write, num_blocks - b0);
+            Py_BEGIN_ALLOW_THREADS
+            Thread_Pool::parallel_for(nb, [&](int64_t i0, int64_t i1) {
+                for (int64_t i = i0; i < i1; ++i) {
+                    size_t r0 = (b0 + i) * BLOCK_ROWS;
+                    blocks[i].clear();
+                    try {
+                        format_rows(r0, std::min(num_rows, r0 + BLOCK_ROWS), blocks[i]);
+                    } catch (...) {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        error = std::current_exception();
+                    }
+                }
+            });
+            Py_END_ALLOW_THREADS
+            if (error)
+                std::rethrow_exception(error);
+            for (size_t i = 0; i < nb; ++i)
+                file_write(write, blocks[i]);
+        }
+        file_write(write, "#\n");  // PDBx/mmCIF style
+    } catch (...) {
+        Py_DECREF(write);
+        throw;
+    }
+    Py_DECREF(write);
+}
+
+// One row of atom_site: an atom at one of its alternate locations
+struct Site_Row
+{
+    size_t residue;
+    const Atom* atom;
+    char alt_loc;	// ' ' if the atom has none
+};
+
+inline string
+alt_loc_value(char alt_loc)
+{
+    return alt_loc == ' ' ? string(".") : quote_string(string(1, alt_loc));
+}
+
+} // namespace
+
+void
+write_cif_table(PyObject* file, const string& name, const vector<string>& tags,
+    PyObject* values, bool fixed_width)
+{
+    size_t n = tags.size();
+    vector<string> quoted = quoted_values(values);
+    if (n == 0)
+        return;
+    if (quoted.size() % n != 0)
+        throw std::invalid_argument("number of values is not a multiple of the number of tags");
+    write_table(file, name, tags, quoted.size() / n, [&](size_t r, vector<string>& cells) {
+        for (size_t c = 0; c < n; ++c)
+            cells[c] = quoted[r * n + c];
+    }, fixed_width);
+}
+
+void
+write_atom_site(PyObject* file, const Residue** residues, size_t num_residues,
+    PyObject* residue_values, const int* coordsets, const double* xforms, int num_xforms,
+    const int* xform_indices, bool selected_only, bool displayed_only, bool fixed_width)
+{
+    // per residue: group_PDB, label_comp_id, label_asym_id, label_entity_id,
+    // label_seq_id, auth_asym_id, auth_seq_id, pdbx_PDB_ins_code, pdbx_PDB_model_num
+    const size_t RV = 9;
+    vector<string> rv = quoted_values(residue_values);
+    if (rv.size() != RV * num_residues)
+        throw std::invalid_argument("need 9 values for each residue");
+    vector<const CoordSet*> residue_cs(num_residues);
+    for (size_t i = 0; i < num_residues; ++i) {
+        auto s = residues[i]->structure();
+        int cs = coordsets[i];
+        if (cs >= (int) s->coord_sets().size())
+            throw std::out_of_range("coordinate set index out of range");
+        residue_cs[i] = cs < 0 ? s->active_coord_set() : s->coord_sets()[cs];
+        if (residue_cs[i] == nullptr)
+            throw std::logic_error("no active coordinate set");
+        if (xform_indices[i] >= num_xforms)
+            throw std::out_of_range("transform index out of range");
+    }
+
+    // rows have consecutive serial numbers starting at 1
+    vector<Site_Row> rows;
+    vector<size_t> aniso_rows;
+    for (size_t i = 0; i < num_residues; ++i) {
+        for (auto a: residues[i]->atoms()) {
+            if (selected_only && !a->selected())
+                continue;
+            if (displayed_only && !a->display())
+                continue;
+            auto alt_locs = a->alt_locs();
+            if (alt_locs.empty())
+                alt_locs.insert(' ');
+            for (auto alt_loc: alt_locs) {
+                if (a->aniso_u(alt_loc) != nullptr && a->aniso_u(alt_loc)->size() > 0)
+                    aniso_rows.push_back(rows.size());
+                rows.push_back(Site_Row{i, a, alt_loc});
+            }
+        }
+    }
+
+    vector<string> tags = {
+        "group_PDB", "id", "type_symbol", "label_atom_id", "label_alt_id",
+        "label_comp_id", "label_asym_id", "label_entity_id", "label_seq_id",
+        "Cartn_x", "Cartn_y", "Cartn_z",
+        "auth_asym_id", "auth_seq_id", "pdbx_PDB_ins_code",
+        "occupancy", "B_iso_or_equiv", "pdbx_PDB_model_num"
+    };
+    write_table(file, "atom_site", tags, rows.size(), [&](size_t r, vector<string>& cells) {
+        const Site_Row& row = rows[r];
+        const Atom* a = row.atom;
+        const string* res = &rv[RV * row.residue];
+        const CoordSet* cs = residue_cs[row.residue];
+        Coord xyz = row.alt_loc == ' ' ? a->coord(cs) : a->coord(row.alt_loc);
+        float occupancy = row.alt_loc == ' ' ? cs->get_occupancy(a) : a->occupancy(row.alt_loc);
+        float bfactor = row.alt_loc == ' ' ? cs->get_bfactor(a) : a->bfactor(row.alt_loc);
+        int xi = xform_indices[row.residue];
+        if (xi >= 0) {
+            const double* m = xforms + 12 * xi;
+            Coord p = xyz;
+            for (int k = 0; k < 3; ++k)
+                xyz[k] = m[4*k] * p[0] + m[4*k+1] * p[1] + m[4*k+2] * p[2] + m[4*k+3];
+        }
+        cells[0] = res[0];
+        cells[1].clear();
+        append_int(cells[1], r + 1);
+        cells[2] = quote_string(a->element().name());
+        cells[3] = quote_string(a->name());
+        cells[4] = alt_loc_value(row.alt_loc);
+        for (size_t k = 1; k < 5; ++k)
+            cells[4 + k] = res[k];
+        for (int k = 0; k < 3; ++k) {
+            cells[9 + k].clear();
+            append_fixed(cells[9 + k], xyz[k], 3);
+        }
+        for (size_t k = 5; k < 8; ++k)
+            cells[7 + k] = res[k];
+        cells[15].clear();
+        append_fixed(cells[15], occupancy, 2);
+        cells[16].clear();
+        append_fixed(cells[16], bfactor, 2);
+        cells[17] = res[8];
+    }, fixed_width);
+
+    vector<string> aniso_tags = {
+        "id", "type_symbol",
+        "U[1][1]", "U[2][2]", "U[3][3]",
+        "U[1][2]", "U[1][3]", "U[2][3]",
+    };
+    // stored as u11, u12, u13, u22, u23, u33
+    static const int u6_order[] = { 0, 3, 5, 1, 2, 4 };
+    write_table(file, "atom_site_anisotrop", aniso_tags, aniso_rows.size(),
+            [&](size_t r, vector<string>& cells) {
+        size_t site = aniso_rows[r];
+        const Atom* a = rows[site].atom;
+        const vector<float>& u = *a->aniso_u(rows[site].alt_loc);
+        cells[0].clear();
+        append_int(cells[0], site + 1);
+        cells[1] = quote_string(a->element().name());
+        for (int k = 0; k < 6; ++k) {
+            cells[2 + k].clear();
+            append_fixed(cells[2 + k], u[u6_order[k]], 4);
+        }
+    }, fixed_width);
+}
+
+} // namespace mmcif
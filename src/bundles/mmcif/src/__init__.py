@@ -27,10 +27,10 @@ import chimerax.atomic_lib  # noqa
 import chimerax.pdb_lib  # noqa
 
 from .mmcif import (  # noqa
-    get_cif_tables, get_mmcif_tables, get_mmcif_tables_from_metadata,
-    open_mmcif, fetch_mmcif, citations,
+    get_cif_tables, get_cif_tables_from_files, get_mmcif_tables, get_mmcif_tables_from_metadata,
+    open_mmcif, open_mmcif_files, fetch_mmcif, citations,
     TableMissingFieldsError, CIFTable,
-    find_template_residue, load_mmCIF_templates,
+    find_template_residue, load_mmCIF_templates, index_mmCIF_templates,
     add_citation, add_software,
 )
 from .corecif import (  # noqa
@@ -59,6 +59,7 @@ class _mmCIFioAPI(BundleAPI):
                         return {
                             'atomic': BoolArg,
                             'auto_style': BoolArg,
+                            'cache': BoolArg,
                             'combine_sym_atoms': BoolArg,
                             'coordsets': BoolArg,
                             'log_info': BoolArg,
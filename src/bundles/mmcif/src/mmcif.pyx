@@ -84,12 +84,14 @@ def _initialize(session):
         _mmcif.load_mmCIF_templates(std_residues)
     _mmcif.set_Python_locate_function(
         lambda name, session=session: _get_template(session, name))
+    _mmcif.set_Python_locate_many_function(
+        lambda names, session=session: _get_templates(session, names))
 
 
 def open_mmcif(session, path, file_name=None, auto_style=True, coordsets=False, atomic=True,
                max_models=None, log_info=True, extra_categories=(), combine_sym_atoms=True,
-               slider=True, ignore_styling=False):
-    # mmCIF parsing requires an uncompressed file
+               slider=True, ignore_styling=False, cache=False):
+    # mmCIF parsing requires an uncompressed or gzipped file
 
     if not _initialized:
         _initialize(session)
@@ -97,6 +99,16 @@ def open_mmcif(session, path, file_name=None, auto_style=True, coordsets=False,
     from . import _mmcif
     categories = _additional_categories + tuple(extra_categories)
     log = session.logger if log_info else None
+    if cache:
+        # Reuse the parsed structures saved when this file was last opened.
+        from . import snapshot_cache
+        options = (categories, coordsets, atomic, ignore_styling)
+        key, models = snapshot_cache.cached_structures(
+            session, path, options, _structure_class(atomic), _model_name(path, file_name),
+            auto_style, log_info)
+        if models is not None:
+            return _finish_models(session, path, file_name, models, coordsets, max_models,
+                                  log_info, combine_sym_atoms, slider)
     try:
         pointers = _mmcif.parse_mmCIF_file(path, categories, log, coordsets, atomic, ignore_styling)
     except _mmcif.error as e:
@@ -119,20 +131,83 @@ def open_mmcif(session, path, file_name=None, auto_style=True, coordsets=False,
                 session, path, file_name=file_name,
                 auto_style=auto_style, coordsets=coordsets, atomic=atomic,
                 max_models=max_models, log_info=log_info, extra_categories=extra_categories,
-                combine_sym_atoms=combine_sym_atoms, slider=slider, ignore_styling=True
+                combine_sym_atoms=combine_sym_atoms, slider=slider, ignore_styling=True,
+                cache=cache
             )
         raise UserError('mmCIF parsing error: %s' % e)
 
-    if file_name is None:
-        from os.path import basename
-        file_name = basename(path)
+    if not cache:
+        return _make_models(session, path, file_name, pointers, auto_style, coordsets, atomic,
+                            max_models, log_info, combine_sym_atoms, slider)
+    models = _structures(session, path, file_name, pointers, auto_style, atomic, log_info)
+    snapshot_cache.cache_structures(session, key, models)
+    return _finish_models(session, path, file_name, models, coordsets, max_models, log_info,
+                          combine_sym_atoms, slider)
+
+
+def open_mmcif_files(session, paths, auto_style=True, coordsets=False, atomic=True,
+                     max_models=None, log_info=True, extra_categories=(),
+                     combine_sym_atoms=True, slider=True, ignore_styling=False):
+    """Open many mmCIF files in one call.  Reading the files overlaps
+    parsing them.  Returns a list of (models, status) tuples, one per path,
+    as open_mmcif() would.  Files that can not be parsed as mmCIF are
+    retried like open_mmcif() does, so they may raise UserError.
+    """
+    if not _initialized:
+        _initialize(session)
+
+    from . import _mmcif
+    categories = _additional_categories + tuple(extra_categories)
+    log = session.logger if log_info else None
+    results = _mmcif.parse_mmCIF_files(list(paths), categories, log, coordsets, atomic,
+                                       ignore_styling)
+    opened = []
+    for path, pointers in zip(paths, results):
+        if isinstance(pointers, str):
+            opened.append(open_mmcif(
+                session, path, auto_style=auto_style, coordsets=coordsets, atomic=atomic,
+                max_models=max_models, log_info=log_info, extra_categories=extra_categories,
+                combine_sym_atoms=combine_sym_atoms, slider=slider,
+                ignore_styling=ignore_styling))
+        else:
+            opened.append(_make_models(session, path, None, pointers, auto_style, coordsets,
+                                       atomic, max_models, log_info, combine_sym_atoms, slider))
+    return opened
+
+
+def _make_models(session, path, file_name, pointers, auto_style, coordsets, atomic,
+                 max_models, log_info, combine_sym_atoms, slider):
+    models = _structures(session, path, file_name, pointers, auto_style, atomic, log_info)
+    return _finish_models(session, path, file_name, models, coordsets, max_models, log_info,
+                          combine_sym_atoms, slider)
+
+
+def _structure_class(atomic):
     if atomic:
         from chimerax.atomic.structure import AtomicStructure as StructureClass
     else:
         from chimerax.atomic.structure import Structure as StructureClass
-    models = [StructureClass(session, name=file_name, c_pointer=p, auto_style=auto_style, log_info=log_info)
-              for p in pointers]
+    return StructureClass
+
+
+def _model_name(path, file_name):
+    if file_name is None:
+        from os.path import basename
+        file_name = basename(path)
+    return file_name
+
+
+def _structures(session, path, file_name, pointers, auto_style, atomic, log_info):
+    StructureClass = _structure_class(atomic)
+    file_name = _model_name(path, file_name)
+    return [StructureClass(session, name=file_name, c_pointer=p, auto_style=auto_style,
+                           log_info=log_info) for p in pointers]
 
+
+def _finish_models(session, path, file_name, models, coordsets, max_models, log_info,
+                   combine_sym_atoms, slider):
+    log = session.logger if log_info else None
+    file_name = _model_name(path, file_name)
     if max_models is not None:
         for m in models[max_models:]:
             m.delete()
@@ -480,6 +555,54 @@ def _get_template(session, name):
         return None
 
 
+def _get_templates(session, names):
+    """Get several Chemical Component Dictionary (CCD) entries at once
+
+    Entries that are not cached are fetched concurrently.  Returns a list of
+    filenames, with None for entries that could not be fetched."""
+    from os import path, makedirs
+    from chimerax.core.fetch import cache_directories, retrieve_url
+    from urllib.parse import quote as url_quote
+    cache_dirs = cache_directories()
+    filenames = [None] * len(names)
+    missing = []
+    for i, name in enumerate(names):
+        if not name.isprintable():
+            continue
+        for d in cache_dirs:
+            filename = path.join(d, 'CCD', '%s.cif' % name)
+            if path.exists(filename):
+                filenames[i] = filename
+                break
+        else:
+            missing.append(i)
+    if not missing:
+        return filenames
+
+    dirname = path.join(cache_dirs[0], 'CCD')
+    makedirs(dirname, exist_ok=True)
+
+    def fetch(name):
+        url_path = url_quote(f"pub/pdb/refdata/chem_comp/{name[-1]}/{name}/{name}.cif")
+        url = f"https://files.wwpdb.org/{url_path}"
+        filename = path.join(dirname, '%s.cif' % name)
+        try:
+            # no logger, status messages can't be shown from other threads
+            retrieve_url(url, filename, name='CCD %s' % name)
+        except Exception:
+            return None
+        return filename
+
+    session.logger.status(f"Fetching {len(missing)} CCD entries")
+    from concurrent.futures import ThreadPoolExecutor
+    with ThreadPoolExecutor(max_workers=min(8, len(missing))) as executor:
+        fetched = executor.map(fetch, [names[i] for i in missing])
+        for i, filename in zip(missing, fetched):
+            filenames[i] = filename
+    session.logger.status("")
+    return filenames
+
+
 def find_template_residue(session, name):
     """Supported API. Lookup mmCIF component template residue.
 
@@ -498,6 +621,17 @@ def load_mmCIF_templates(filename):
     _mmcif.load_mmCIF_templates(filename)
 
 
+def index_mmCIF_templates(filename):
+    """Supported API. Use mmCIF component templates from given file
+
+    Like load_mmCIF_templates, but only the locations of the templates are
+    read, and templates are parsed when first needed.  The locations are
+    saved in filename.index, if possible, and reused while the file does
+    not change.  Useful for large files, like components.cif from the PDB."""
+    from . import _mmcif
+    _mmcif.index_mmCIF_templates(filename)
+
+
 # def quote(value, max_len=60):
 #     """Return CIF 1.1 data value version of string"""
 #     # max_len is for mimicing the output from the PDB (see #2230)
@@ -878,6 +1012,34 @@ def get_cif_tables(filename, table_names, *, all_data_blocks=False):
     return result
 
 
+def get_cif_tables_from_files(filenames, table_names):
+    """Supported API. Extract CIF tables from many files at once
+
+    The files are parsed on several threads, and only the given tables,
+    from the first data block with any of them, are read.
+
+    Parameters
+    ----------
+    filenames : list of str
+        The names of the files.
+    table_names : list of str
+        A list of CIF category names.
+
+    Returns
+    -------
+        tuple of two dictionaries
+            The first maps each table name found in any file to a tuple of
+            the table's tags, a list of columns, each a list of str with one
+            value per row, and an int32 numpy array of the index of the file
+            each row came from.  Rows of all files are combined in file order,
+            and tags missing from a file have '?' values in its rows.
+            The second maps the index of each file that could not be read to
+            its error message.
+    """
+    from . import _mmcif
+    return _mmcif.extract_CIF_tables_files(list(filenames), list(table_names))
+
+
 def get_mmcif_tables_from_metadata(obj, table_names, *, metadata=None):
     """Supported API. Extract mmCIF tables from previously read metadata
 
@@ -903,6 +1065,8 @@ def get_mmcif_tables_from_metadata(obj, table_names, *, metadata=None):
     tlist = []
     for n in table_names:
         n = n.casefold()
+        if n in metadata and (n + ' data') not in metadata and metadata.get(n + ' text'):
+            _parse_metadata_text(obj, metadata, n)
         if n not in metadata or (n + ' data') not in metadata:
             tlist.append(None)
         else:
@@ -912,6 +1076,20 @@ def get_mmcif_tables_from_metadata(obj, table_names, *, metadata=None):
     return tlist
 
 
+def _parse_metadata_text(obj, metadata, name):
+    # Tables given as loops are kept as unparsed text when the file is read,
+    # and parsed the first time they are asked for.
+    from . import _mmcif
+    data = _mmcif.extract_CIF_tables_from_text(metadata[name + ' text'][0], [name])
+    values = [] if data is None or name not in data else data[name][1]
+    metadata[name + ' data'] = values
+    metadata[name + ' text'] = []
+    from chimerax.atomic.structure import Structure as StructureClass
+    if isinstance(obj, StructureClass):
+        obj.set_metadata_entry(name + ' data', values)
+        obj.set_metadata_entry(name + ' text', [])
+
+
 class TableMissingFieldsError(ValueError):
     """Supported API. Required field is missing"""
     pass
@@ -1143,49 +1321,14 @@ cdef class CIFTable:
         fixed width columns (e.g., there is a newline in a string field),
         then the first row is broken up into multiple lines.
         """
-        cdef int n, bad_fixed_width, first, i
-        if len(self._data) == 0:
+        if len(self._data) == 0 or len(self._tags) == 0:
             return
-        n = len(self._tags)
-        if n == 0:
-            return
-        assert len(self._data) % n == 0
+        assert len(self._data) % len(self._tags) == 0
         if file is None:
             file = sys.stdout
-        if n == len(self._data):
-            for t, v in zip(self._tags, self._data):
-                print(f'_{self.table_name}.{t}', quote(v), file=file)
-        else:
-            print('loop_', file=file)
-            for t in self._tags:
-                print(f'_{self.table_name}.{t}', file=file)
-            data = [quote(x) for x in self._data]
-            if not fixed_width:
-                for i in range(0, len(self._data), n):
-                    print(' '.join(data[i:i + n]), file=file)
-            else:
-                bad_fixed_width = False
-                columns = [data[i::n] for i in range(n)]
-                try:
-                    widths = [max(len(f) if f[0] != '\n' else sys.maxsize for f in c) for c in columns]
-                except Exception:
-                    bad_fixed_width = True
-                else:
-                    bad_fixed_width = sys.maxsize in widths
-                if bad_fixed_width:
-                    first = True
-                    for i in range(0, len(data), n):
-                        if first:
-                            first = False
-                            print(' '.join(data[i:i + 1]), file=file)
-                            print(' '.join(data[i + 1:i + n]), file=file)
-                        else:
-                            print(' '.join(data[i:i + n]), file=file)
-                else:
-                    fmt = ''.join(['%%-%ds ' % w for w in widths])
-                    for i in range(0, len(data), n):
-                        print(fmt % tuple(data[i:i + n]), file=file)
-        print('#', file=file)  # PDBx/mmCIF style
+        # rows are quoted and formatted in C++ on several threads
+        from ._mmcif import write_cif_table
+        write_cif_table(file, self.table_name, self._tags, self._data, fixed_width)
 
 
 # TODO: @deprecated(version='1.1', reason='Use get_cif_tables() instead')
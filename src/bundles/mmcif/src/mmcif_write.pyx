@@ -95,6 +95,16 @@ def _same_chains(chain0, chain1):
     return c0 == c1
 
 
+def _open_output(path):
+    # Tables are streamed to the file as they are formatted, so a compressed
+    # file is written without holding the uncompressed text in memory.
+    from chimerax.io.compression import get_compression_type, handle_compression
+    compression = get_compression_type(path, None)
+    if compression:
+        return handle_compression(compression, path, mode='wt', encoding='utf-8', newline='\r\n')
+    return open(path, 'w', encoding='utf-8', newline='\r\n')
+
+
 def write_mmcif(session, path, *, models=None, rel_model=None, selected_only=False, displayed_only=False, fixed_width=True, best_guess=False, all_coordsets=False, computed_sheets=False):
     from chimerax.atomic import Structure
     if models is None:
@@ -130,7 +140,7 @@ def write_mmcif(session, path, *, models=None, rel_model=None, selected_only=Fal
         for m in models:
             used_data_names = set()
             file_name = path.replace("[ID]", m.id_string).replace("[NAME]", m.name)
-            with open(file_name, 'w', encoding='utf-8', newline='\r\n') as f:
+            with _open_output(file_name) as f:
                 f.write(MMCIF_PREAMBLE)
                 save_structure(session, f, [m], [xforms[m]], used_data_names, selected_only, displayed_only, fixed_width, best_guess, all_coordsets, computed_sheets)
         return
@@ -157,7 +167,7 @@ def write_mmcif(session, path, *, models=None, rel_model=None, selected_only=Fal
         is_ensemble[g] = all(_same_chains(chains, m.chains) for m in models[1:])
 
     used_data_names = set()
-    with open(path, 'w', encoding='utf-8', newline='\r\n') as f:
+    with _open_output(path) as f:
         f.write(MMCIF_PREAMBLE)
         for g, models in grouped.items():
             if is_ensemble[g]:
@@ -524,26 +534,16 @@ def save_structure(session, file, models, xforms, used_data_names, selected_only
     atom_type.print(file, fixed_width=fixed_width)
     del atom_type_data, atom_type
 
-    atom_site_data = []
-    atom_site = mmcif.CIFTable("atom_site", [
-        'group_PDB', 'id', 'type_symbol', 'label_atom_id', 'label_alt_id',
-        'label_comp_id', 'label_asym_id', 'label_entity_id', 'label_seq_id',
-        'Cartn_x', 'Cartn_y', 'Cartn_z',
-        'auth_asym_id', 'auth_seq_id', 'pdbx_PDB_ins_code',
-        'occupancy', 'B_iso_or_equiv', 'pdbx_PDB_model_num'
-    ], atom_site_data)
-    atom_site_anisotrop_data = []
-    atom_site_anisotrop = mmcif.CIFTable("atom_site_anisotrop", [
-        'id', 'type_symbol',
-        'U[1][1]', 'U[2][2]', 'U[3][3]',
-        'U[1][2]', 'U[1][3]', 'U[2][3]',
-    ], atom_site_anisotrop_data)
-    serial_num = 0
-
-    def atom_site_residue(residue, seq_id, asym_id, entity_id, model_num, xform):
-        nonlocal serial_num, residue_info, atom_site_data, atom_site_anisotrop_data
+    # atom_site and atom_site_anisotrop rows are formatted in C++ from the
+    # structures' atoms, given these values for each residue in output order
+    site_residues = []
+    site_residue_values = []
+    site_coordsets = []
+    site_xform_indices = []
+    site_xforms = []
+
+    def atom_site_residue(residue, seq_id, asym_id, entity_id, model_num, xform_index, cs_index):
         residue_info[residue] = (asym_id, seq_id)
-        atoms = residue.atoms
         rname = residue.name
         cid = residue.chain_id
         if cid == ' ':
@@ -556,37 +556,18 @@ def save_structure(session, file, models, xforms, used_data_names, selected_only
             group = 'ATOM'
         else:
             group = 'HETATM'
-        for atom in atoms:
-            if restricted:
-                if selected_only and not atom.selected:
-                    continue
-                if displayed_only and not atom.display:
-                    continue
-            elem = atom.element.name
-            aname = atom.name
-            original_alt_loc = atom.alt_loc
-            for alt_loc in atom.alt_locs or '.':
-                if alt_loc != '.':
-                    atom.set_alt_loc(alt_loc, False)
-                coord = atom.coord
-                if xform is not None:
-                    coord = xform * coord
-                xyz = ['%.3f' % f for f in coord]
-                occ = "%.2f" % atom.occupancy
-                bfact = "%.2f" % atom.bfactor
-                serial_num += 1
-                atom_site_data.append((
-                    group, serial_num, elem, aname, alt_loc, rname, asym_id,
-                    entity_id, seq_id, *xyz, cid, rnum, rins, occ, bfact,
-                    model_num))
-                u6 = atom.aniso_u6
-                if u6 is not None and len(u6) > 0:
-                    u6 = ['%.4f' % f for f in u6]
-                    atom_site_anisotrop_data.append((serial_num, elem, u6))
-            if alt_loc != '.':
-                atom.set_alt_loc(original_alt_loc, False)
-
-    def do_atom_site_model(m, xform, model_num):
+        site_residues.append(residue)
+        site_residue_values.extend((
+            group, rname, asym_id, entity_id, seq_id, cid, rnum, rins, model_num))
+        site_coordsets.append(cs_index)
+        site_xform_indices.append(xform_index)
+
+    def do_atom_site_model(m, xform, model_num, cs_index=-1):
+        if xform is None:
+            xform_index = -1
+        else:
+            xform_index = len(site_xforms)
+            site_xforms.append(xform.matrix)
         residues = m.residues
         het_residues = residues.filter(residues.polymer_types == Residue.PT_NONE)
         for c in m.chains:
@@ -596,31 +577,34 @@ def save_structure(session, file, models, xforms, used_data_names, selected_only
             for seq_id, r in zip(range(1, sys.maxsize), c.residues):
                 if r is None:
                     continue
-                atom_site_residue(r, seq_id, asym_id, entity_id, model_num, xform)
+                atom_site_residue(r, seq_id, asym_id, entity_id, model_num, xform_index, cs_index)
             chain_het = het_residues.filter(het_residues.chain_ids == chain_id)
             het_residues -= chain_het
             for r in chain_het:
                 asym_id, entity_id = het_asym_info[(chain_id, r.name)]
-                atom_site_residue(r, '.', asym_id, entity_id, model_num, xform)
+                atom_site_residue(r, '.', asym_id, entity_id, model_num, xform_index, cs_index)
         info = [(r, het_asym_info[(r.chain_id, r.name)]) for r in het_residues]
         for r, (asym_id, entity_id) in sorted(info, key=lambda x: _chain_id_ordinal(x[1][0])):
             #asym_id, entity_id = het_asym_info[r.mmcif_chain_id]
-            atom_site_residue(r, '.', asym_id, entity_id, model_num, xform)
+            atom_site_residue(r, '.', asym_id, entity_id, model_num, xform_index, cs_index)
         del info
 
     if all_coordsets and len(models) == 1 and best_m.num_coordsets > 1:
         xform = xforms[0]
         for model_num in range(1, best_m.num_coordsets + 1):
-            do_atom_site_model(best_m, xform, model_num)
+            do_atom_site_model(best_m, xform, model_num, model_num - 1)
     else:
         for m, xform, model_num in zip(models, xforms, range(1, sys.maxsize)):
             do_atom_site_model(m, xform, model_num)
 
-    atom_site_data[:] = flattened(atom_site_data)
-    atom_site.print(file, fixed_width=fixed_width)
-    atom_site_anisotrop_data[:] = flattened(atom_site_anisotrop_data)
-    atom_site_anisotrop.print(file, fixed_width=fixed_width)
-    # del atom_site_data, atom_site, atom_site_anisotrop_data, atom_site_anisotrop  # not in cython
+    import numpy
+    from chimerax.atomic import Residues
+    from ._mmcif import write_atom_site
+    xform_array = numpy.array(site_xforms, numpy.float64).reshape((len(site_xforms), 3, 4))
+    write_atom_site(file, Residues(site_residues), site_residue_values,
+        numpy.array(site_coordsets, numpy.int32), xform_array,
+        numpy.array(site_xform_indices, numpy.int32),
+        selected_only, displayed_only, fixed_width)
 
     struct_conn_data = []
     struct_conn = mmcif.CIFTable("struct_conn", [
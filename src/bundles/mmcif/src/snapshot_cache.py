@@ -0,0 +1,150 @@
+# vim: set expandtab shiftwidth=4 softtabstop=4:
+
+# === UCSF ChimeraX Copyright ===
+# Copyright 2022 Regents of the University of California. All rights reserved.
+# The ChimeraX application is provided pursuant to the ChimeraX license
+# agreement, which covers academic and commercial uses. For more details, see
+# <http://www.rbvi.ucsf.edu/chimerax/docs/licensing.html>
+#
+# This particular file is part of the ChimeraX library. You can also
+# redistribute and/or modify it under the terms of the GNU Lesser General
+# Public License version 2.1 as published by the Free Software Foundation.
+# For more details, see
+# <https://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>
+#
+# THIS SOFTWARE IS PROVIDED "AS IS" WITHOUT WARRANTY OF ANY KIND, EITHER
+# EXPRESSED OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+# OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. ADDITIONAL LIABILITY
+# LIMITATIONS ARE DESCRIBED IN THE GNU LESSER GENERAL PUBLIC LICENSE
+# VERSION 2.1
+#
+# This notice must be embedded in or attached to all copies, including partial
+# copies, of the software or any revisions or derivations thereof.
+# === UCSF ChimeraX Copyright ===
+
+"""
+snapshot_cache: reuse parsed mmCIF structures
+=============================================
+
+Opening an mmCIF file with the cache option saves the structures made by
+the parser, after connecting residues with templates, in a binary snapshot
+file in the user cache directory.  Opening the same file contents with the
+same options again restores the structures from the memory-mapped snapshot
+instead of parsing the text.  Snapshots are keyed by a hash of the file
+contents, the parse options and the ChimeraX version, and the least
+recently used ones are removed when the cache grows too large.
+"""
+
+CACHE_SIZE_LIMIT = 4 * 2**30    # bytes
+_SUFFIX = '.cxsnap'
+
+
+def cache_directory():
+    from chimerax import app_dirs
+    import os
+    return os.path.join(app_dirs.user_cache_dir, 'mmcif_snapshots')
+
+
+def cache_key(path, options):
+    import hashlib
+    from chimerax.core import buildinfo
+    h = hashlib.sha256()
+    with open(path, 'rb') as f:
+        for block in iter(lambda: f.read(2**20), b''):
+            h.update(block)
+    h.update(repr((options, buildinfo.version)).encode('utf-8'))
+    return h.hexdigest()
+
+
+def cached_structures(session, path, options, structure_class, name, auto_style, log_info):
+    '''
+    Return the cache key for a file and a list of structures restored from
+    its cached snapshot, or None for the structures if not cached.
+    '''
+    import os
+    key = cache_key(path, options)
+    cpath = os.path.join(cache_directory(), key + _SUFFIX)
+    if not os.path.exists(cpath):
+        return key, None
+
+    from chimerax.atomic.snapshot import read_snapshot, restore_structure
+    models = []
+    try:
+        header = read_snapshot(cpath)
+        if header['info'].get('key') != key:
+            raise ValueError('cache key mismatch')
+        for state in header['structures']:
+            s = structure_class(session, name=name, auto_style=auto_style, log_info=log_info)
+            models.append(s)
+            restore_structure(s, state)
+    except Exception as e:
+        # Unreadable snapshots are parsed again and replaced.
+        for s in models:
+            s.delete()
+        session.logger.info('Ignoring mmCIF cache file %s: %s' % (cpath, e))
+        _remove(cpath)
+        return key, None
+
+    os.utime(cpath)     # Record use for removing least recently used
+    return key, models
+
+
+def cache_structures(session, key, structures):
+    '''Save parsed structures in the cache.'''
+    if not structures:
+        return
+    import os
+    import tempfile
+    directory = cache_directory()
+    try:
+        os.makedirs(directory, exist_ok=True)
+        # Write to a temporary file and rename so other processes never
+        # read a partly written snapshot.
+        fd, tpath = tempfile.mkstemp(suffix='.tmp', dir=directory)
+        os.close(fd)
+        try:
+            from chimerax.atomic.snapshot import write_snapshot
+            write_snapshot(tpath, structures, info={'key': key})
+            os.replace(tpath, os.path.join(directory, key + _SUFFIX))
+        finally:
+            _remove(tpath)
+    except Exception as e:
+        session.logger.info('Could not write mmCIF cache file: %s' % e)
+        return
+    _limit_cache_size(directory, CACHE_SIZE_LIMIT)
+
+
+def clear_cache():
+    import os
+    directory = cache_directory()
+    if os.path.isdir(directory):
+        for filename in os.listdir(directory):
+            if filename.endswith(_SUFFIX):
+                _remove(os.path.join(directory, filename))
+
+
+def _limit_cache_size(directory, size_limit):
+    import os
+    files = []
+    for filename in os.listdir(directory):
+        if filename.endswith(_SUFFIX):
+            p = os.path.join(directory, filename)
+            try:
+                st = os.stat(p)
+            except OSError:
+                continue
+            files.append((st.st_mtime, st.st_size, p))
+    total = sum(size for mtime, size, p in files)
+    for mtime, size, p in sorted(files):
+        if total <= size_limit:
+            break
+        _remove(p)
+        total -= size
+
+
+def _remove(path):
+    import os
+    try:
+        os.remove(path)
+    except OSError:
+        pass
@@ -26,6 +26,7 @@
 
 #include <Python.h>
 #include <map>
+#include <set>
 #include <vector>
 #include <fstream>
 
@@ -49,6 +50,7 @@
 namespace {
 
 using std::map;
+using std::set;
 using std::string;
 using std::vector;
 
@@ -95,8 +97,22 @@ structure_pointers(const Models& models)
 const char HELIX[] = "helix";
 const char STRAND[] = "strand";
 
+// Advance the group and atom indices past a chain that isn't wanted
+void
+skip_chain(const mmtf::StructureData& data, int32_t chain_index, int32_t* group_index,
+    int32_t* atom_index)
+{
+    const auto chain_group_count = data.groupsPerChain[chain_index];
+    for (auto _chain_group = 0; _chain_group < chain_group_count; ++_chain_group) {
+        *group_index += 1;
+        *atom_index += data.groupList[data.groupTypeList[*group_index]].atomNameList.size();
+    }
+}
+
+// Empty model_indices or chain_names means all of them
 Models
-extract_data(const mmtf::StructureData& data, PyObject* _logger, bool coordset)
+extract_data(const mmtf::StructureData& data, PyObject* _logger, bool coordset,
+    const set<int>& model_indices, const set<string>& chain_names)
 {
     // Data structure traversal based on example given at
     // https://github.com/rcsb/mmtf/blob/v1.0/spec.md#traversal
@@ -144,6 +160,9 @@ extract_data(const mmtf::StructureData& data, PyObject* _logger, bool coordset)
         }
     }
 
+    // elements of each group type's atoms, looked up when the group type is first used
+    vector<vector<const Element*>> group_elements(group_count);
+
     // compute which entity corresponds to a chain
     vector<int> per_chain_entity_index(data.numChains, -1);
     const auto entity_count = data.entityList.size();
@@ -156,11 +175,16 @@ extract_data(const mmtf::StructureData& data, PyObject* _logger, bool coordset)
     // Traverse data and contruct structures
     const auto model_count = data.numModels;
     for (size_t model_index = 0; model_index < model_count; ++model_index) {
+        const size_t model_chain_count = data.chainsPerModel[model_index];
+        if (!model_indices.empty() && model_indices.count(model_index) == 0) {
+            for (size_t _model_chain = 0; _model_chain < model_chain_count; ++_model_chain)
+                skip_chain(data, ++chain_index, &group_index, &atom_index);
+            continue;
+        }
         auto m = new AtomicStructure(_logger);
         models.push_back(m);
         // traverse chains
         map<string, string> chain_descriptions;
-        const size_t model_chain_count = data.chainsPerModel[model_index];
         for (size_t _model_chain = 0; _model_chain < model_chain_count; ++_model_chain) {
             chain_index += 1;
             string chain_id = data.chainIdList[chain_index];
@@ -169,6 +193,10 @@ extract_data(const mmtf::StructureData& data, PyObject* _logger, bool coordset)
                 chain_name = data.chainNameList[chain_index];
             else
                 chain_name = chain_id;
+            if (!chain_names.empty() && chain_names.count(chain_name) == 0) {
+                skip_chain(data, chain_index, &group_index, &atom_index);
+                continue;
+            }
             int entity_index = per_chain_entity_index[chain_index];
             auto& entity = data.entityList[entity_index];
             bool is_polymer;
@@ -205,6 +233,11 @@ extract_data(const mmtf::StructureData& data, PyObject* _logger, bool coordset)
                 auto group_type = data.groupTypeList[group_index];
                 auto& group = data.groupList[group_type];
                 const auto& atom_name_list = group.atomNameList;
+                auto& elements = group_elements[group_type];
+                if (elements.empty()) {
+                    for (auto& atom_element: group.elementList)
+                        elements.push_back(&Element::get_element(atom_element.c_str()));
+                }
 
                 int8_t sec_struct;
                 int sequence_index;
@@ -231,7 +264,6 @@ extract_data(const mmtf::StructureData& data, PyObject* _logger, bool coordset)
                 }
 
                 const string& group_name = group.groupName;
-                const auto& element_list = group.elementList;
                 const auto& bond_atom_list = group.bondAtomList;
                 // formal_charge_list = group.formalChargeList;  // TODO
                 // bond_order_list = group.bondOrderList;        // TODO
@@ -289,16 +321,16 @@ extract_data(const mmtf::StructureData& data, PyObject* _logger, bool coordset)
                     if (has_alt_loc_list)
                         alt_loc = data.altLocList[atom_index];
                     auto& atom_name = atom_name_list[i];
-                    auto& atom_element = element_list[i];
                     // formal_charge = formal_charge_list[i];        // TODO
 
                     Atom* a;
-                    if (group_alt_atoms.find(atom_name) != group_alt_atoms.end()) {
-                        a = group_alt_atoms[atom_name];
+                    map<string, Atom*>::iterator alt_i;
+                    if (!group_alt_atoms.empty()
+                    && (alt_i = group_alt_atoms.find(atom_name)) != group_alt_atoms.end()) {
+                        a = alt_i->second;
                         a->set_alt_loc(alt_loc, true);
                     } else {
-                        const Element& e = Element::get_element(atom_element.c_str());
-                        atoms[atom_index] = a = m->new_atom(atom_name.c_str(), e);
+                        atoms[atom_index] = a = m->new_atom(atom_name.c_str(), *elements[i]);
                         r->add_atom(a);
                         if (has_alt_loc_list && alt_loc != '\x00') {
                             a->set_alt_loc(alt_loc, true);
@@ -409,14 +441,49 @@ parse_MMTF_file(PyObject *, PyObject *args, PyObject *keywds)
     const char *filename;
     PyObject* _logger;
     int coordsets;
-    const char *kwlist[] = {"filename", "logger", "coordsets", NULL};
-    if (!PyArg_ParseTupleAndKeywords(args, keywds, const_cast<char *>("O&Op"),
+    PyObject* py_models = Py_None;
+    PyObject* py_chains = Py_None;
+    const char *kwlist[] = {"filename", "logger", "coordsets", "models", "chains", NULL};
+    if (!PyArg_ParseTupleAndKeywords(args, keywds, const_cast<char *>("O&Op|OO"),
                                      (char **) kwlist,
                                      PyUnicode_FSConverter, &tmp,
-                                     &_logger, &coordsets))
+                                     &_logger, &coordsets, &py_models, &py_chains))
         return NULL;
     filename = PyBytes_AS_STRING(tmp);
 
+    set<int> model_indices;
+    set<string> chain_names;
+    if (py_models != Py_None || py_chains != Py_None) {
+        PyObject* seq;
+        if (py_models != Py_None) {
+            seq = PySequence_Fast(py_models, "models should be a sequence of model indices");
+            if (seq == NULL) {
+                Py_DECREF(tmp);
+                return NULL;
+            }
+            for (Py_ssize_t i = 0; i < PySequence_Fast_GET_SIZE(seq); ++i)
+                model_indices.insert(PyLong_AsLong(PySequence_Fast_GET_ITEM(seq, i)));
+            Py_DECREF(seq);
+        }
+        if (py_chains != Py_None) {
+            seq = PySequence_Fast(py_chains, "chains should be a sequence of chain identifiers");
+            if (seq == NULL) {
+                Py_DECREF(tmp);
+                return NULL;
+            }
+            for (Py_ssize_t i = 0; i < PySequence_Fast_GET_SIZE(seq); ++i) {
+                const char* name = PyUnicode_AsUTF8(PySequence_Fast_GET_ITEM(seq, i));
+                if (name != NULL)
+                    chain_names.insert(name);
+            }
+            Py_DECREF(seq);
+        }
+        if (PyErr_Occurred()) {
+            Py_DECREF(tmp);
+            return NULL;
+        }
+    }
+
 #ifdef REPORT_TIME
     clock_t start_t = clock();
 #endif
@@ -434,7 +501,7 @@ parse_MMTF_file(PyObject *, PyObject *args, PyObject *keywds)
     std::cerr << "Load MMTF file " << (end_t - start_t) / (float)CLOCKS_PER_SEC << " seconds\n";
     start_t = clock();
 #endif
-    Models models = extract_data(data, _logger, coordsets);
+    Models models = extract_data(data, _logger, coordsets, model_indices, chain_names);
 #ifdef REPORT_TIME
     end_t = clock();
     std::cerr << "Convert to ChimeraX objects " << (end_t - start_t) / (float)CLOCKS_PER_SEC << " seconds\n";
@@ -447,9 +514,10 @@ parse_MMTF_file(PyObject *, PyObject *args, PyObject *keywds)
 static PyMethodDef mmtf_methods[] = {
   {const_cast<char*>("parse_MMTF_file"), (PyCFunction)parse_MMTF_file,
    METH_VARARGS|METH_KEYWORDS,
-   "parse_MMTF_file(filename, logger, coordsets)\n"
+   "parse_MMTF_file(filename, logger, coordsets, models=None, chains=None)\n"
    "\n"
    "Parse MMTF file into atomic structures\n"
+   "Optionally only the given model indices (starting at 0) and chains.\n"
    "Implemented in C++.\n"
   },
   {NULL, NULL, 0, NULL}
@@ -47,10 +47,12 @@ class _MyAPI(BundleAPI):
 
                 @property
                 def open_args(self):
-                    from chimerax.core.commands import BoolArg
+                    from chimerax.core.commands import BoolArg, ListOf, PositiveIntArg, StringArg
                     return {
                         'auto_style': BoolArg,
-                        'coordsets': BoolArg
+                        'coordsets': BoolArg,
+                        'models': ListOf(PositiveIntArg),
+                        'chains': ListOf(StringArg),
                     }
         else:
             from chimerax.open_command import FetcherInfo
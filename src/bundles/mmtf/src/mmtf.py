@@ -46,10 +46,13 @@ def fetch_mmtf(session, pdb_id, ignore_cache=False, **kw):
     session.logger.status("Opening MMTF %s" % (pdb_id,))
     return session.open_command.open_data(filename, format='mmtf', name=pdb_id, **kw)
 
-def open_mmtf(session, filename, name, auto_style=True, coordsets=False):
+def open_mmtf(session, filename, name, auto_style=True, coordsets=False, models=None,
+              chains=None):
     """Create atomic structures from MMTF file
 
     :param filename: either the name of a file or a file-like object
+    :param models: model numbers, starting at 1, to read; default all
+    :param chains: chain identifiers to read; default all
     """
 
     if hasattr(filename, 'name'):
@@ -57,7 +60,9 @@ def open_mmtf(session, filename, name, auto_style=True, coordsets=False):
         filename = filename.name
 
     from . import _mmtf
-    pointers = _mmtf.parse_MMTF_file(filename, session.logger, coordsets)
+    if models is not None:
+        models = [n - 1 for n in models]
+    pointers = _mmtf.parse_MMTF_file(filename, session.logger, coordsets, models, chains)
 
     from chimerax.atomic.structure import AtomicStructure
     models = [AtomicStructure(session, name=name, c_pointer=p, auto_style=auto_style) for p in pointers]
@@ -24,7 +24,10 @@
 
 #include <Python.h>			// use PyObject
 #include <math.h>	// use sqrt()
+#include <string.h>	// use memcpy()
+#include <vector>	// use std::vector
 #include <arrays/pythonarray.h>		// use parse_double_3_array()
+#include <arrays/threadpool.h>		// use Thread_Pool::parallel_for()
 
 #ifndef M_PI
 // M_PI is not part of ANSI C and Windows does not define it
@@ -158,37 +161,66 @@ static void dihedral_point(double *n1, double *n2, double *n3, double dist, doub
     dp[a] = xc*x[a] + yc*y[a] + zc*v12[a] + n1[a];
 }
 
-// Every 4 indices in array i define a dihedral.
-static void interp_dihedrals(const IArray &i, const DArray &coords0, const DArray &coords1,
-			     double f, DArray &coords)
+// Bond length, angle and dihedral of the first atom of a dihedral at the
+// start of the motion and their changes over the motion.  These do not
+// depend on the frame so they are computed once for all frames.
+class Dihedral_Motion
+{
+public:
+  double length, dlength, angle, dangle, dihed, ddihed;
+};
+
+// Every 4 indices in array ia define a dihedral.
+static void dihedral_motions(const int *ia, long n, double *ca0, double *ca1,
+			     Dihedral_Motion *dm)
+{
+  // Dihedrals are independent here so they are divided among threads.
+  Thread_Pool::parallel_for(n/4, [&](int64_t d0, int64_t d1) {
+      for (int64_t d = d0 ; d < d1 ; ++d)
+	{
+	  const int *id = ia + 4*d;
+	  int i0 = 3*id[0], i1 = 3*id[1], i2 = 3*id[2], i3 = 3*id[3];
+	  double *c00 = &ca0[i0], *c01 = &ca0[i1], *c02 = &ca0[i2], *c03 = &ca0[i3];
+	  double *c10 = &ca1[i0], *c11 = &ca1[i1], *c12 = &ca1[i2], *c13 = &ca1[i3];
+	  Dihedral_Motion &m = dm[d];
+	  m.length = distance(c00, c01);
+	  m.angle = angle(c00, c01, c02);
+	  m.dihed = dihedral(c00, c01, c02, c03);
+	  m.dlength = distance(c10, c11) - m.length;
+	  m.dangle = angle(c10, c11, c12) - m.angle;
+	  double ddihed = dihedral(c10, c11, c12, c13) - m.dihed;
+	  if (ddihed > 180)
+	    ddihed -= 360;
+	  else if (ddihed < -180)
+	    ddihed += 360;
+	  m.ddihed = ddihed;
+	}
+    }, 1024);
+}
+
+// Dihedrals are placed in order since the first atom of a dihedral can
+// be one of the last three atoms of a later dihedral.
+static void place_dihedrals(const int *ia, long n, const Dihedral_Motion *dm,
+			    double f, double *ca)
 {
-  long n = i.size();
-  int *ia = i.values();
-  double *ca0 = coords0.values(), *ca1 = coords1.values(), *ca = coords.values();
   for (long j = 0 ; j < n ; j += 4)
     {
-      int i0 = 3*ia[j], i1 = 3*ia[j+1], i2 = 3*ia[j+2], i3 = 3*ia[j+3];
-      double *c00 = &ca0[i0], *c01 = &ca0[i1], *c02 = &ca0[i2], *c03 = &ca0[i3];
-      double *c10 = &ca1[i0], *c11 = &ca1[i1], *c12 = &ca1[i2], *c13 = &ca1[i3];
-      double *c0 = &ca[i0], *c1 = &ca[i1], *c2 = &ca[i2], *c3 = &ca[i3];
-      double length0 = distance(c00, c01);
-      double angle0 = angle(c00, c01, c02);
-      double dihed0 = dihedral(c00, c01, c02, c03);
-      double length1 = distance(c10, c11);
-      double angle1 = angle(c10, c11, c12);
-      double dihed1 = dihedral(c10, c11, c12, c13);
-      double length = length0 + (length1 - length0) * f;
-      double angle = angle0 + (angle1 - angle0) * f;
-      double ddihed = dihed1 - dihed0;
-      if (ddihed > 180)
-	ddihed -= 360;
-      else if (ddihed < -180)
-	ddihed += 360;
-      double dihed = dihed0 + ddihed * f;
-      dihedral_point(c1, c2, c3, length, angle, dihed, c0);
+      const Dihedral_Motion &m = dm[j/4];
+      double *c0 = &ca[3*ia[j]], *c1 = &ca[3*ia[j+1]], *c2 = &ca[3*ia[j+2]], *c3 = &ca[3*ia[j+3]];
+      dihedral_point(c1, c2, c3, m.length + m.dlength * f, m.angle + m.dangle * f,
+		     m.dihed + m.ddihed * f, c0);
     }
 }
 
+static void interp_dihedrals(const IArray &i, const DArray &coords0, const DArray &coords1,
+			     double f, DArray &coords)
+{
+  long n = i.size();
+  std::vector<Dihedral_Motion> dm(n/4);
+  dihedral_motions(i.values(), n, coords0.values(), coords1.values(), dm.data());
+  place_dihedrals(i.values(), n, dm.data(), f, coords.values());
+}
+
 // ----------------------------------------------------------------------------
 //
 extern "C" PyObject *
@@ -212,24 +244,24 @@ interpolate_dihedrals(PyObject *, PyObject *args, PyObject *keywds)
       return NULL;
     }
 
+  Py_BEGIN_ALLOW_THREADS
   interp_dihedrals(i, coords0, coords1, f, coords);
+  Py_END_ALLOW_THREADS
   
   return python_none();
 }
 
 // ----------------------------------------------------------------------------
 //
-static void interp_linear(const IArray &i, const DArray &coords0, const DArray &coords1,
-			  double f, DArray &coords)
+static void interp_linear(const int *ia, long n, const double *ca0, const double *ca1,
+			  double f, double *ca)
 {
-  long n = i.size();
-  int *ia = i.values();
   double f0 = 1-f;
-  double *ca0 = coords0.values(), *ca1 = coords1.values(), *ca = coords.values();
   for (long j = 0 ; j < n ; ++j)
     {
       int i3 = 3*ia[j];
-      double *ca0i = ca0+i3, *ca1i = ca1+i3, *cai = ca+i3;
+      const double *ca0i = ca0+i3, *ca1i = ca1+i3;
+      double *cai = ca+i3;
       for (int a = 0 ; a < 3 ; ++a)
 	cai[a] = ca0i[a]*f0 + ca1i[a]*f;
     }
@@ -258,15 +290,16 @@ interpolate_linear(PyObject *, PyObject *args, PyObject *keywds)
       return NULL;
     }
 
-  interp_linear(i, coords0, coords1, f, coords);
+  interp_linear(i.values(), i.size(), coords0.values(), coords1.values(), f, coords.values());
   
   return python_none();
 }
 
 // ----------------------------------------------------------------------------
 //
-static void  rigid_motion(DArray &coords, const IArray &i,
-                          double *axis, double angle, double *center, double *shift, double f)
+static void  rigid_motion(double *crd, const int *ia, long n,
+                          const double *axis, double angle, const double *center,
+                          const double *shift, double f)
 {
   double arad = f * angle * M_PI / 180.0;
   double sa = sin(arad), ca = cos(arad);
@@ -287,9 +320,6 @@ static void  rigid_motion(DArray &coords, const IArray &i,
   double rcz = r20*cx + r21*cy + r22*cz;
   double sx = cx - rcx + f*shift[0], sy = cy - rcy + f*shift[1], sz = cz - rcz + f*shift[2];
 
-  long n = i.size();
-  int *ia = i.values();
-  double *crd = coords.values();
   for (long j = 0 ; j < n ; ++j)
     {
       double *ci = crd + 3*ia[j];
@@ -325,11 +355,108 @@ apply_rigid_motion(PyObject *, PyObject *args, PyObject *keywds)
       return NULL;
     }
 
-  rigid_motion(coords, i, axis, angle, center, shift, f);
+  rigid_motion(coords.values(), i.values(), i.size(), axis, angle, center, shift, f);
   
   return python_none();
 }
 
+// ----------------------------------------------------------------------------
+// Compute all frames of one morph segment.  Each frame starts from coords0,
+// interpolates residue conformations with dihedral motions relative to
+// coords1, then applies the rigid motion of each group of residues.  Frames
+// are independent so they are computed in parallel.
+//
+extern "C" PyObject *
+interpolate_frames(PyObject *, PyObject *args, PyObject *keywds)
+{
+  DArray coords0, coords1, fractions, axes, angles, centers, shifts;
+  IArray linear, dihedrals, motion_atoms, motion_sizes;
+  Numeric_Array coordsets;
+  const char *kwlist[] = {"coords0", "coords1", "fractions", "linear", "dihedrals",
+			  "motion_atoms", "motion_sizes", "axes", "angles", "centers", "shifts",
+			  "coordsets", NULL};
+  if (!PyArg_ParseTupleAndKeywords(args, keywds, const_cast<char *>("O&O&O&O&O&O&O&O&O&O&O&O&"),
+				   (char **)kwlist,
+				   parse_double_n3_array, &coords0,
+				   parse_double_n3_array, &coords1,
+				   parse_double_n_array, &fractions,
+				   parse_int_n_array, &linear,
+				   parse_int_n_array, &dihedrals,
+				   parse_int_n_array, &motion_atoms,
+				   parse_int_n_array, &motion_sizes,
+				   parse_double_n3_array, &axes,
+				   parse_double_n_array, &angles,
+				   parse_double_n3_array, &centers,
+				   parse_double_n3_array, &shifts,
+				   parse_writable_3d_array, &coordsets))
+    return NULL;
+  if (!coords0.is_contiguous() || !coords1.is_contiguous() || !linear.is_contiguous() ||
+      !dihedrals.is_contiguous() || !motion_atoms.is_contiguous() || !coordsets.is_contiguous())
+    {
+      PyErr_SetString(PyExc_TypeError, "Arrays must be contiguous");
+      return NULL;
+    }
+  long nc = coords0.size(0), nf = fractions.size(0), nm = motion_sizes.size(0);
+  if (coords1.size(0) != nc)
+    return PyErr_Format(PyExc_ValueError, "Start and end coordinates have different sizes %s and %s",
+			coords0.size_string(0).c_str(), coords1.size_string(0).c_str());
+  if (coordsets.value_type() != Numeric_Array::Double || coordsets.size(0) != nf ||
+      coordsets.size(1) != nc || coordsets.size(2) != 3)
+    return PyErr_Format(PyExc_ValueError, "Coordsets array must be float64 of size %ld by %ld by 3",
+			nf, nc);
+  if (dihedrals.size() % 4 != 0)
+    {
+      PyErr_SetString(PyExc_ValueError, "Dihedral atom indices must be a multiple of 4");
+      return NULL;
+    }
+  if (axes.size(0) != nm || angles.size(0) != nm || centers.size(0) != nm || shifts.size(0) != nm)
+    {
+      PyErr_SetString(PyExc_ValueError, "Rigid motion parameter arrays must have the same length");
+      return NULL;
+    }
+  long na = 0;
+  const int *ms = motion_sizes.values();
+  for (long m = 0 ; m < nm ; ++m)
+    na += ms[m*motion_sizes.stride(0)];
+  if (na != motion_atoms.size())
+    {
+      PyErr_SetString(PyExc_ValueError, "Rigid motion sizes do not sum to number of motion atoms");
+      return NULL;
+    }
+
+  Py_BEGIN_ALLOW_THREADS
+  DArray ax = axes.contiguous_array(), an = angles.contiguous_array();
+  DArray ce = centers.contiguous_array(), sh = shifts.contiguous_array();
+  IArray sz = motion_sizes.contiguous_array();
+  DArray fr = fractions.contiguous_array();
+  std::vector<long> motion_start(nm+1, 0);
+  for (long m = 0 ; m < nm ; ++m)
+    motion_start[m+1] = motion_start[m] + sz.values()[m];
+
+  long nd = dihedrals.size();
+  std::vector<Dihedral_Motion> dm(nd/4);
+  double *ca0 = coords0.values();
+  dihedral_motions(dihedrals.values(), nd, ca0, coords1.values(), dm.data());
+
+  double *cs = static_cast<double *>(coordsets.values());
+  const double *f = fr.values();
+  Thread_Pool::parallel_for(nf, [&](int64_t f0, int64_t f1) {
+      for (int64_t t = f0 ; t < f1 ; ++t)
+	{
+	  double *ca = cs + 3*nc*t;
+	  memcpy(ca, ca0, 3*nc*sizeof(double));
+	  interp_linear(linear.values(), linear.size(), ca0, coords1.values(), f[t], ca);
+	  place_dihedrals(dihedrals.values(), nd, dm.data(), f[t], ca);
+	  for (long m = 0 ; m < nm ; ++m)
+	    rigid_motion(ca, motion_atoms.values() + motion_start[m], motion_start[m+1] - motion_start[m],
+			 ax.values() + 3*m, an.values()[m], ce.values() + 3*m, sh.values() + 3*m, f[t]);
+	}
+    });
+  Py_END_ALLOW_THREADS
+
+  return python_none();
+}
+
 // ----------------------------------------------------------------------------
 //
 static PyMethodDef morph_methods[] = {
@@ -351,6 +478,18 @@ static PyMethodDef morph_methods[] = {
    "\n"
    "Implemented in C++.\n"
   },
+  {const_cast<char*>("interpolate_frames"), (PyCFunction)interpolate_frames,
+   METH_VARARGS|METH_KEYWORDS,
+   "interpolate_frames(coords0, coords1, fractions, linear, dihedrals,\n"
+   "                   motion_atoms, motion_sizes, axes, angles, centers, shifts, coordsets)\n"
+   "\n"
+   "Compute all frames of a morph segment into the N by M by 3 float64 coordsets\n"
+   "array, one frame for each fraction, in parallel.  Each frame is coords0 with\n"
+   "linear and dihedral residue interpolation toward coords1 followed by the rigid\n"
+   "motion (axis, angle, center, shift) of each group of motion_atoms, the groups\n"
+   "having motion_sizes atoms.\n"
+   "Implemented in C++.\n"
+  },
   {NULL, NULL, 0, NULL}
 };
 
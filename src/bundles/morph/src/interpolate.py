@@ -26,31 +26,30 @@ def interpolate(coordset0, coordset1, segment_interpolator, residue_interpolator
         '''
 
         # Calculate interpolated coordinates for each frame.
-        coordsets = []
         rateFunction = RateMap[rate_method]
         rate = rateFunction(frames)  # Compute fractional steps controlling speed of motion.
 
         c1s = coordset1.copy()
         segment_interpolator.reverse_motion(c1s)
 
-        for i, f in enumerate(rate):
-                coordset = coordset0.copy()
-                # Interpolate residue conformations
-                t0 = time()
-                residue_interpolator.interpolate(coordset0, c1s, f, coordset)
-                t1 = time()
-                global rst
-                rst += t1-t0
-
-                # Interplate segment motions
-                segment_interpolator.interpolate(f, coordset)
-
-                coordsets.append(coordset)
-                if log and (i+1)%100 == 0:
-                        log.status("Trajectory frame %d generated" % (i+1))
+        # Interpolate residue conformations and segment motions for all
+        # frames in one C++ call that computes frames in parallel.
+        from numpy import array, empty, float64
+        frame_coords = empty((len(rate)+1,) + coordset0.shape, float64)
+        t0 = time()
+        from .morph_cpp import interpolate_frames
+        interpolate_frames(coordset0, c1s, array(rate, float64),
+                           residue_interpolator.cartesian_atom_indices,
+                           residue_interpolator.dihedral_atom_indices,
+                           *segment_interpolator.motion_arrays(),
+                           frame_coords[:len(rate)])
+        t1 = time()
+        global rst
+        rst += t1-t0
 
         # Add last frame with coordinates equal to final position.
-        coordsets.append(coordset1.copy())
+        frame_coords[len(rate)] = coordset1
+        coordsets = list(frame_coords)
 
         return coordsets
 
@@ -161,6 +160,25 @@ class SegmentInterpolator:
                         xform.inverse().transform_points(ca, in_place = True)
                         coordset[atom_indices] = ca
 
+        def motion_arrays(self):
+                """
+                Rigid motion parameters as arrays for interpolate_frames():
+                concatenated atom indices, atoms per segment, and the axis,
+                angle, center and shift of each segment.
+                """
+                from numpy import array, concatenate, empty, int32, float64
+                params = self.motion_parameters
+                if len(params) == 0:
+                        return (empty((0,), int32), empty((0,), int32), empty((0,3), float64),
+                                empty((0,), float64), empty((0,3), float64), empty((0,3), float64))
+                atoms = concatenate([p[0] for p in params]).astype(int32, copy = False)
+                sizes = array([len(p[0]) for p in params], int32)
+                axes = array([p[1] for p in params], float64)
+                angles = array([p[2] for p in params], float64)
+                centers = array([p[3] for p in params], float64)
+                shifts = array([p[4] for p in params], float64)
+                return atoms, sizes, axes, angles, centers, shifts
+
         def interpolate(self, f, coordset):
                 global rit
                 t0 = time()
@@ -186,8 +186,8 @@ def provider_open(session, names, format=None, from_database=None, ignore_cache=
             in_file_history = opener_info.in_file_history
             provider_info = mgr.provider_info(data_format)
             if provider_info.batch:
-                paths = [_get_path(mgr, fi.file_name, provider_info.check_path)
-                    for fi in file_infos]
+                paths = [_get_path(mgr, fi.file_name, provider_info.check_path,
+                    gzip_okay=provider_info.gzip_okay) for fi in file_infos]
                 models, status = collated_open(session, None, paths, data_format, _add_models, log_errors,
                 opener_info.open, (session, paths, name), provider_kw)
                 if status:
@@ -206,7 +206,8 @@ def provider_open(session, names, format=None, from_database=None, ignore_cache=
             else:
                 for fi in file_infos:
                     if provider_info.want_path:
-                        data = _get_path(mgr, fi.file_name, provider_info.check_path)
+                        data = _get_path(mgr, fi.file_name, provider_info.check_path,
+                            gzip_okay=provider_info.gzip_okay)
                     else:
                         data = _get_stream(mgr, fi.file_name, data_format.encoding)
                     try:
@@ -252,7 +253,8 @@ def provider_open(session, names, format=None, from_database=None, ignore_cache=
             in_file_history = opener_info.in_file_history
             provider_info = mgr.provider_info(fi.data_format)
             if provider_info.want_path:
-                data = _get_path(mgr, fi.file_name, provider_info.check_path)
+                data = _get_path(mgr, fi.file_name, provider_info.check_path,
+                    gzip_okay=provider_info.gzip_okay)
             else:
                 data = _get_stream(mgr, fi.file_name, fi.data_format.encoding)
             models, status = collated_open(session, None, [data], fi.data_format, _add_models, log_errors,
@@ -332,7 +334,7 @@ def _fetch_info(mgr, database_name, default_format_name):
     return (provider_info.bundle_info.run_provider(mgr.session, database_name, mgr),
         default_format_name, provider_info.pregrouped_structures, provider_info.group_multiple_models)
 
-def _get_path(mgr, file_name, check_path, check_compression=True):
+def _get_path(mgr, file_name, check_path, check_compression=True, gzip_okay=False):
     from os.path import expanduser, expandvars, exists
     expanded = expanduser(expandvars(file_name))
     from chimerax.io import file_system_file_name
@@ -341,7 +343,8 @@ def _get_path(mgr, file_name, check_path, check_compression=True):
 
     if check_compression:
         from chimerax import io
-        if io.remove_compression_suffix(expanded) != expanded:
+        if io.remove_compression_suffix(expanded) != expanded and not (gzip_okay
+                and expanded.endswith('.gz')):
             raise UserError("File reader requires uncompressed file; '%s' is compressed"
                 % file_name)
     return expanded
@@ -30,11 +30,12 @@ class OpenerNotInstalledError(NoOpenerError):
 
 class OpenerProviderInfo:
     def __init__(self, bundle_info, name, want_path, check_path, batch, pregrouped_structures,
-            group_multiple_models):
+            group_multiple_models, gzip_okay):
         self.bundle_info = bundle_info
         self.name = name
         self.want_path = want_path
         self.check_path = check_path
+        self.gzip_okay = gzip_okay
         self.batch = batch
         self.pregrouped_structures = pregrouped_structures
         self.group_multiple_models = group_multiple_models
@@ -65,7 +66,7 @@ class OpenManager(ProviderManager):
 
     def add_provider(self, bundle_info, name, *, type="open", want_path=False, check_path=True,
             batch=False, format_name=None, is_default=True, synopsis=None, example_ids=None,
-            pregrouped_structures=False, group_multiple_models=True, **kw):
+            pregrouped_structures=False, group_multiple_models=True, gzip_okay=False, **kw):
         logger = self.session.logger
         self._ui_names[name.lower()] = ui_name = name
         name = name.lower()
@@ -78,6 +79,7 @@ class OpenManager(ProviderManager):
             "pregrouped_structures")
         group_multiple_models = bool_cvt(group_multiple_models, ui_name, bundle_name,
             "group_multiple_models")
+        gzip_okay = bool_cvt(gzip_okay, ui_name, bundle_name, "gzip_okay")
         if batch or not check_path:
             want_path = True
         type_description = "Open-command" if type == "open" else type.capitalize()
@@ -98,7 +100,7 @@ class OpenManager(ProviderManager):
                     " %s bundle" % (data_format.name, _readable_bundle_name(
                     self._openers[data_format].bundle_info), bundle_name))
             self._openers[data_format] = OpenerProviderInfo(bundle_info, ui_name, want_path,
-                check_path, batch, pregrouped_structures, group_multiple_models)
+                check_path, batch, pregrouped_structures, group_multiple_models, gzip_okay)
         elif type == "fetch":
             if not name:
                 raise ValueError("Database fetch in bundle %s has empty name" % bundle_name)
@@ -492,6 +492,9 @@ public:
         setlocale(LC_ALL, "C");
     }
     static int  sprintf(char *, const char *, ...);
+    // ATOM/HETATM record without format string interpretation
+    static int  sprintf_atom(char *, const char *record_name, int serial_width,
+                    const Atom_ &);
     static void reset_state();
 
     inline bool operator==(const PDB &r) const {
@@ -56,15 +56,13 @@ PDB::c_str(void) const
         break;
 
     case ATOM:
+        // same as sprintf() with
+        //   "ATOM  %5d %-4s%c%-4s%c%4d%c   %8.3f%8.3f%8.3f%6.2f%6.2f      %-4s%2s%-.2s"
+        // (or "ATOM %6d ..." without hybrid-36), but much faster
         if (_h36)
-            fmt = "ATOM  %5d %-4s%c%-4s%c%4d%c   %8.3f%8.3f%8.3f%6.2f%6.2f      %-4s%2s%-.2s";
+            count = sprintf_atom(buf, "ATOM  ", 5, atom);
         else
-            fmt = "ATOM %6d %-4s%c%-4s%c%4d%c   %8.3f%8.3f%8.3f%6.2f%6.2f      %-4s%2s%-.2s";
-        count = sprintf(buf, fmt,
-            atom.serial, atom.name, atom.alt_loc, atom.res.name,
-            atom.res.chain_id, atom.res.seq_num, atom.res.i_code,
-            atom.xyz[0], atom.xyz[1], atom.xyz[2], atom.occupancy,
-            atom.temp_factor, atom.seg_id, atom.element, atom.charge);
+            count = sprintf_atom(buf, "ATOM ", 6, atom);
         break;
 
         case ATOMQR: 
@@ -201,13 +199,7 @@ PDB::c_str(void) const
         break;
 
     case HETATM:
-        count = sprintf(buf,
-"HETATM%5d %-4s%c%-4s%c%4d%c   %8.3f%8.3f%8.3f%6.2f%6.2f      %-4s%2s%-.2s",
-            hetatm.serial, hetatm.name, hetatm.alt_loc,
-            hetatm.res.name, hetatm.res.chain_id, hetatm.res.seq_num,
-            hetatm.res.i_code, hetatm.xyz[0], hetatm.xyz[1],
-            hetatm.xyz[2], hetatm.occupancy, hetatm.temp_factor,
-            hetatm.seg_id, hetatm.element, hetatm.charge);
+        count = sprintf_atom(buf, "HETATM", 5, hetatm);
         break;
 
     case HETNAM:
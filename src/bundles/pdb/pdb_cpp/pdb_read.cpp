@@ -31,6 +31,141 @@
 
 namespace pdb {
 
+//
+//  Column-fixed decoding of ATOM/HETATM records.  Equivalent to the
+//  sscanf formats used below for well-formed records, but without
+//  interpreting a format string.  Any field that isn't plainly formatted
+//  makes it give up so that the general code decides what to do.
+//
+
+// end of the line, as pdb_sscanf sees it
+static int
+line_length(const char *buf)
+{
+    int len = 0;
+    while (buf[len] != '\0' && buf[len] != '\n' && buf[len] != '\r')
+        ++len;
+    return len;
+}
+
+static bool
+atom_int_field(const char *buf, int len, int start, int width, int *value)
+{
+    int end = start + width < len ? start + width : len;
+    int i = start;
+    while (i < end && buf[i] == ' ')
+        ++i;
+    while (end > i && buf[end-1] == ' ')
+        --end;
+    bool neg = i < end && buf[i] == '-';
+    if (neg)
+        ++i;
+    else if (i == end) {
+        *value = 0;
+        return true;
+    }
+    if (i == end)
+        return false;
+    int v = 0;
+    for (; i < end; ++i) {
+        if (buf[i] < '0' || buf[i] > '9')
+            return false;   // e.g. hybrid-36
+        v = v * 10 + (buf[i] - '0');
+    }
+    *value = neg ? -v : v;
+    return true;
+}
+
+static bool
+atom_real_field(const char *buf, int len, int start, int width, PDB::Real *value)
+{
+    static const double powers_of_ten[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8 };
+    int end = start + width < len ? start + width : len;
+    int i = start;
+    while (i < end && buf[i] == ' ')
+        ++i;
+    while (end > i && buf[end-1] == ' ')
+        --end;
+    if (i == end) {
+        *value = 0.0;
+        return true;
+    }
+    bool neg = buf[i] == '-';
+    if (neg)
+        ++i;
+    // the mantissa and power of ten are exact, so the division is
+    // correctly rounded, giving the same value as strtod
+    long long mantissa = 0;
+    int num_digits = 0, frac_digits = -1;
+    for (; i < end; ++i) {
+        char c = buf[i];
+        if (c >= '0' && c <= '9') {
+            mantissa = mantissa * 10 + (c - '0');
+            ++num_digits;
+            if (frac_digits >= 0)
+                ++frac_digits;
+        } else if (c == '.' && frac_digits < 0)
+            frac_digits = 0;
+        else
+            return false;
+    }
+    if (num_digits == 0 || frac_digits > 8)
+        return false;
+    double v = (double)mantissa;
+    if (frac_digits > 0)
+        v /= powers_of_ten[frac_digits];
+    *value = neg ? -v : v;
+    return true;
+}
+
+// like the 's' (strip) and 'S' formats
+static void
+atom_string_field(const char *buf, int len, int start, int width, char *value, bool strip)
+{
+    int end = start + width < len ? start + width : len;
+    int n = 0;
+    for (int i = start; i < end; ++i)
+        value[n++] = buf[i];
+    value[n] = '\0';
+    if (strip)
+        while (n > 0 && isspace(value[n-1]))
+            value[--n] = '\0';
+}
+
+static char
+atom_char_field(const char *buf, int len, int pos)
+{
+    return pos < len ? buf[pos] : ' ';
+}
+
+// "%6 %5d %4s%c%4S%c%4d%c   %8f%8f%8f%6f%6f%6 %4s%2s%2s"
+static bool
+fast_parse_atom(const char *buf, int len, bool extended, PDB::Atom_ *atom)
+{
+    if ((len > 11 && buf[11] != ' ') || (len > 27 && strncmp(buf+27, "   ", len < 30 ? len - 27 : 3) != 0))
+        return false;
+    if (!atom_int_field(buf, len, 6, 5, &atom->serial)
+    || !atom_int_field(buf, len, 22, 4, &atom->res.seq_num))
+        return false;
+    for (int i = 0; i < 3; ++i)
+        if (!atom_real_field(buf, len, 30 + 8 * i, 8, &atom->xyz[i]))
+            return false;
+    if (!atom_real_field(buf, len, 54, 6, &atom->occupancy)
+    || !atom_real_field(buf, len, 60, 6, &atom->temp_factor))
+        return false;
+    atom_string_field(buf, len, 12, 4, atom->name, true);
+    atom->alt_loc = atom_char_field(buf, len, 16);
+    atom_string_field(buf, len, 17, 4, atom->res.name, false);
+    atom->res.chain_id = atom_char_field(buf, len, 21);
+    atom->res.i_code = atom_char_field(buf, len, 26);
+    if (extended) {
+        atom_string_field(buf, len, 72, 4, atom->seg_id, true);
+        atom_string_field(buf, len, 76, 2, atom->element, true);
+        atom_string_field(buf, len, 78, 2, atom->charge, true);
+    }
+    return true;
+}
+
 PDB::PDB(const char *buf)
 {
     set_standard_locale();
@@ -67,8 +202,17 @@ void PDB::parse_line(const char *buf)
     case ATOM9:
     case ATOM:
     case HETATM: {
+        bool extended = input_version == 2 && strlen(buf) >= 73;
+        if (fast_parse_atom(buf, line_length(buf), extended, &atom)) {
+            if (r_type != HETATM) {
+                atom.serial += 100000 * (r_type - ATOM);
+                r_type = ATOM;
+            }
+            atom_serial_number = atom.serial;
+            break;
+        }
         // '73' in order to pick up element column if provided
-        fmt = (input_version == 2 && strlen(buf) >= 73)
+        fmt = extended
             ? "%6 %5d %4s%c%4S%c%4d%c   %8f%8f%8f%6f%6f%6 %4s%2s%2s"
             : "%6 %5d %4s%c%4S%c%4d%c   %8f%8f%8f%6f%6f";
         if (0 <= sscanf(buf, fmt,
@@ -461,4 +461,35 @@ PDB::sprintf(char *outbuf, const char *fmt, ...)
 	return p - outbuf;
 }
 
+int
+PDB::sprintf_atom(char *outbuf, const char *record_name, int serial_width,
+							const Atom_ &atom)
+{
+	char	*p = outbuf;
+
+	for (const char *s = record_name; *s; ++s)
+		*p++ = *s;
+	p = outint(atom.serial, serial_width, 10, ' ', 'a', false, p, '0', _h36);
+	*p++ = ' ';
+	p = outstr((char *) atom.name, 4, -1, ' ', true, p);
+	*p++ = atom.alt_loc == '\0' ? ' ' : atom.alt_loc;
+	p = outstr((char *) atom.res.name, 4, -1, ' ', true, p);
+	*p++ = atom.res.chain_id == '\0' ? ' ' : atom.res.chain_id;
+	p = outint(atom.res.seq_num, 4, 10, ' ', 'a', false, p, '0', _h36);
+	*p++ = atom.res.i_code == '\0' ? ' ' : atom.res.i_code;
+	for (int i = 0; i < 3; ++i)
+		*p++ = ' ';
+	for (int i = 0; i < 3; ++i)
+		p = outfloat(atom.xyz[i], 8, 3, false, p, '0');
+	p = outfloat(atom.occupancy, 6, 2, false, p, '0');
+	p = outfloat(atom.temp_factor, 6, 2, false, p, '0');
+	for (int i = 0; i < 6; ++i)
+		*p++ = ' ';
+	p = outstr((char *) atom.seg_id, 4, -1, ' ', true, p);
+	p = outstr((char *) atom.element, 2, -1, ' ', false, p);
+	p = outstr((char *) atom.charge, -1, 2, ' ', true, p);
+	*p = '\0';
+	return p - outbuf;
+}
+
 } // namespace pdb
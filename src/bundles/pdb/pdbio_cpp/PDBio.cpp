@@ -28,14 +28,17 @@
 #include <cctype>
 #include <cmath> // abs
 #include <fstream>
+#include <memory>
 #include <set>
 #include <sstream>
-#include <stdio.h>  // fgets
+#include <stdio.h>  // fread
+#include <string.h>  // memchr
 #include <unordered_map>
 
 #include "Python.h"
 
 #include <arrays/pythonarray.h>	// Use python_voidp_array(), array_from_python()
+#include <arrays/trace.h>	// Use TRACE_TIMER
 #include <atomstruct/Atom.h>
 #include <atomstruct/AtomicStructure.h>
 #include <atomstruct/Bond.h>
@@ -45,6 +48,7 @@
 #include <atomstruct/Sequence.h>
 #include <atomstruct/destruct.h>
 #include <atomstruct/tmpl/residues.h>
+#include <ioutil/gzstream.h>
 #include <logger/logger.h>
 #include "pdb/connect.h"
 #include <pdb/PDB.h>
@@ -92,32 +96,37 @@ static std::set<ResName> standard_polymeric_res_names = {
 static void
 canonicalize_atom_name(AtomName& aname, bool *asterisks_translated)
 {
-    for (int i = aname.length(); i > 0; ) {
+    // names are interned, so edit a copy
+    std::string name = aname;
+    for (int i = name.length(); i > 0; ) {
         --i;
         // strip embedded blanks
-        if (aname[i] == ' ') {
-            aname.replace(i, 1, "");
+        if (name[i] == ' ') {
+            name.replace(i, 1, "");
             continue;
         }
         // use prime instead of asterisk
-        if (aname[i] == '*') {
-            aname[i] = '\'';
+        if (name[i] == '*') {
+            name[i] = '\'';
             *asterisks_translated = true;
         }
     }
+    aname = name;
 }
 
 static void
 canonicalize_res_name(ResName& rname)
 {
-    for (int i = rname.length(); i > 0; ) {
+    std::string name = rname;
+    for (int i = name.length(); i > 0; ) {
         --i;
-        if (rname[i] == ' ') {
-            rname.replace(i, 1, "");
+        if (name[i] == ' ') {
+            name.replace(i, 1, "");
             continue;
         }
-        rname[i] = toupper(rname[i]);
+        name[i] = toupper(name[i]);
     }
+    rname = name;
 }
 
 void set_res_name_and_chain_id(Residue* res, PDB::ResidueName& out_rn, char* out_cid,
@@ -234,7 +243,7 @@ push_link(Atom *a1, Atom *a2, Real length, std::vector<std::string>& links)
         strncpy(lrec.link.res[0].name, a1->residue()->name().c_str(), 3);
         lrec.link.res[0].chain_id = a1->residue()->chain_id().c_str()[0];
     } else {
-        auto res_name = a1->residue()->name();
+        std::string res_name = a1->residue()->name();
         auto chain_id = a1->residue()->chain_id();
         res_name[3] = chain_id[0];
         strncpy(lrec.link.res[0].name, res_name.c_str(), 4);
@@ -246,7 +255,7 @@ push_link(Atom *a1, Atom *a2, Real length, std::vector<std::string>& links)
         strncpy(lrec.link.res[1].name, a2->residue()->name().c_str(), 3);
         lrec.link.res[1].chain_id = a2->residue()->chain_id().c_str()[0];
     } else {
-        auto res_name = a2->residue()->name();
+        std::string res_name = a2->residue()->name();
         auto chain_id = a2->residue()->chain_id();
         res_name[3] = chain_id[0];
         strncpy(lrec.link.res[1].name, res_name.c_str(), 4);
@@ -300,7 +309,7 @@ compile_links_ssbonds(const Structure* s, std::vector<std::string>& links, std::
                 strncpy(srec.ssbond.res[0].name, r1->name().c_str(), 3);
                 srec.ssbond.res[0].chain_id = r1->chain_id()[0];
             } else {
-                auto res_name = r1->name();
+                std::string res_name = r1->name();
                 auto chain_id = r1->chain_id();
                 res_name[3] = chain_id[0];
                 strncpy(srec.ssbond.res[0].name, res_name.c_str(), 4);
@@ -312,7 +321,7 @@ compile_links_ssbonds(const Structure* s, std::vector<std::string>& links, std::
                 strncpy(srec.ssbond.res[1].name, r2->name().c_str(), 3);
                 srec.ssbond.res[1].chain_id = r2->chain_id()[0];
             } else {
-                auto res_name = r2->name();
+                std::string res_name = r2->name();
                 auto chain_id = r2->chain_id();
                 res_name[3] = chain_id[0];
                 strncpy(srec.ssbond.res[1].name, res_name.c_str(), 4);
@@ -411,11 +420,11 @@ push_seqres(Chain *chain, size_t start_index, int record_num, std::vector<std::s
                     }
                 }
                 if (is_rna) {
-                    ResName rna_name;
+                    std::string rna_name;
                     rna_name.append(1, seq_char);
                     strcpy(sr_rec.seqres.res_name[i], rna_name.c_str());
                 } else {
-                    ResName dna_name("D");
+                    std::string dna_name("D");
                     dna_name.append(1, seq_char);
                     strcpy(sr_rec.seqres.res_name[i], dna_name.c_str());
                 }
@@ -470,7 +479,12 @@ public:
     }
     void write_text(const char* text) {
         PyObject* py_text = PyUnicode_FromString(text);
+        if (py_text == nullptr) {
+            _good = false;
+            return;
+        }
         auto result = PyObject_CallFunctionObjArgs(_string_io_write, py_text, nullptr);
+        Py_DECREF(py_text);
         if (result == nullptr)
             _good = false;
         else
@@ -482,54 +496,68 @@ public:
     StringIOStream& operator<<(char c) { write_char(c); return *this; }
 };
 
+// Output is collected into large blocks before being handed to the stream,
+// so that writing to a Python file object is one call per block rather than
+// two per record
 class StreamDispatcher
 {
+    static const size_t BLOCK_SIZE = 1 << 20;
     bool _use_fstream;
     std::ofstream* _fstream;
     StringIOStream* _io_stream;
+    std::string _buffer;
+    void _check_size() {
+        if (_buffer.size() >= BLOCK_SIZE)
+            flush();
+    }
 public:
     StreamDispatcher(std::ofstream* fstream) {
         _use_fstream = true;
         _fstream = fstream;
+        _buffer.reserve(BLOCK_SIZE + PDB::BUF_LEN);
     }
     StreamDispatcher(StringIOStream* io_stream) {
         _use_fstream = false;
         _io_stream = io_stream;
+        _buffer.reserve(BLOCK_SIZE + PDB::BUF_LEN);
     }
     ~StreamDispatcher() {
+        flush();
         if (_use_fstream)
             delete _fstream;
         else
             delete _io_stream;
     }
+    // call before checking bad()
+    void flush() {
+        if (_buffer.empty())
+            return;
+        if (_use_fstream)
+            _fstream->write(_buffer.data(), _buffer.size());
+        else
+            _io_stream->write_text(_buffer.c_str());
+        _buffer.clear();
+    }
     bool bad() const { return _use_fstream ? _fstream->bad() : _io_stream->bad(); }
     bool good() const { return _use_fstream ? _fstream->good() : _io_stream->good(); }
     StreamDispatcher& operator<<(const char* text) {
-        if (_use_fstream)
-            *_fstream << text;
-        else
-            *_io_stream << text;
+        _buffer += text;
+        _check_size();
         return *this;
     }
     StreamDispatcher& operator<<(const PDB& p) {
-        if (_use_fstream)
-            *_fstream << p;
-        else
-            *_io_stream << p;
+        _buffer += p.c_str();
+        _check_size();
         return *this;
     }
     StreamDispatcher& operator<<(const std::string& s) {
-        if (_use_fstream)
-            *_fstream << s;
-        else
-            *_io_stream << s;
+        _buffer += s;
+        _check_size();
         return *this;
     }
     StreamDispatcher& operator<<(char c) {
-        if (_use_fstream)
-            *_fstream << c;
-        else
-            *_io_stream << c;
+        _buffer += c;
+        _check_size();
         return *this;
     }
 };
@@ -538,10 +566,10 @@ void correct_chain_ids(std::vector<Residue*>& chain_residues, unsigned char seco
     bool *two_let_chains)
 {
     for (auto r: chain_residues) {
-        auto name = r->name();
+        std::string name = r->name();
         name.pop_back();
         r->set_name(name);
-        auto cid = r->chain_id();
+        std::string cid = r->chain_id();
         cid.insert(0, 1, second_chain_id_let);
         r->set_chain_id(cid);
     }
@@ -592,6 +620,7 @@ read_one_structure(std::pair<const char *, PyObject *> (*read_func)(void *),
     std::vector<Residue*> chain_residues;
     bool        second_chain_let_okay = true;
     std::map<std::string, decltype(let)> modres_mappings;
+    TRACE_TIMER(trace_timer, "pdb.read_one_structure");
 #ifdef CLOCK_PROFILING
 clock_t     start_t, end_t;
 start_t = clock();
@@ -621,15 +650,20 @@ start_t = clock();
         *line_num += 1;
         // allow for initial Unicode byte-order marker
         std::string line(char_line);
+        Py_XDECREF(read_vals.second);
         if (*line_num == 1 && line.size() >= 3 && line[0] == '\xEF'
         && line[1] == '\xBB' && line[2] == '\xBF') {
             line.erase(0, 3);
         }
 
-        // extra set of parens on next line to disambiguate from function decl
-        std::istringstream is((line));
-        Py_XDECREF(read_vals.second);
-        is >> record;
+        // parse in place rather than through operator>>, which makes
+        // a stream and a temporary record (and switches locales) per line;
+        // like getline(), drop the newline and limit the length
+        if (!line.empty() && line.back() == '\n')
+            line.pop_back();
+        if (line.size() >= 4 * PDB::BUF_LEN)
+            line.resize(4 * PDB::BUF_LEN - 1);
+        record.parse_line(line.c_str());
 
 #ifdef CLOCK_PROFILING
 end_t = clock();
@@ -650,7 +684,7 @@ start_t = end_t;
                 return nullptr;
             }
             logger::warning(py_logger, "Ignored bad PDB record found on line ",
-                *line_num, '\n', is.str());
+                *line_num, '\n', line);
             break;
 
         case PDB::HEADER:
@@ -920,6 +954,17 @@ start_t = end_t;
             canonicalize_atom_name(aname, &as->asterisks_translated);
             Coord c(record.atom.xyz);
             if (in_model > 1) {
+                // later models usually list the same atoms in the same
+                // order, so first try the atom for the next coordinate
+                unsigned int index = as->active_coord_set()->coords_size();
+                if (index < as->atoms().size()) {
+                    Atom *a = as->atoms()[index];
+                    if (a->residue() == cur_residue && a->name() == aname
+                    && a->coord_index() == index) {
+                        a->set_coord(c);
+                        break;
+                    }
+                }
                 Atom *a = cur_residue->find_atom(aname);
                 if (a == nullptr) {
                     logger::error(py_logger, "Atom ", aname, " not in first"
@@ -1170,6 +1215,7 @@ cum_loop_postswitch_t += end_t - start_t;
     *reached_end = true;
 
 finished:
+    trace_timer.set_items(as->atoms().size());
 #ifdef CLOCK_PROFILING
 start_t = clock();
 #endif
@@ -1274,8 +1320,8 @@ assign_secondary_structure(Structure *as, const std::vector<PDB> &ss, PyObject *
         auto chain_id = ChainID({init->chain_id});
         ResName name = init->name;
         if (two_let_chains && name.size() == 4) {
-            chain_id.insert(chain_id.begin(), name[3]);
-            name.pop_back();
+            chain_id = name[3] + chain_id;
+            name = name.substr(0, 3);
         }
         Residue *init_res = as->find_residue(chain_id, init->seq_num,
             init->i_code, name);
@@ -1287,8 +1333,8 @@ assign_secondary_structure(Structure *as, const std::vector<PDB> &ss, PyObject *
         chain_id = ChainID({end->chain_id});
         name = end->name;
         if (two_let_chains && name.size() == 4) {
-            chain_id.insert(chain_id.begin(), name[3]);
-            name.pop_back();
+            chain_id = name[3] + chain_id;
+            name = name.substr(0, 3);
         }
         Residue *end_res = as->find_residue(chain_id, end->seq_num,
             end->i_code, name);
@@ -1415,8 +1461,8 @@ static Residue*
 pdb_res_to_chimera_res(Structure* as, PDB::Residue& pdb_res)
 {
     ResName rname = pdb_res.name;
-    auto orig_rname = rname;
-    ChainID cid({pdb_res.chain_id});
+    std::string orig_rname = rname;
+    std::string cid(1, pdb_res.chain_id);
     canonicalize_res_name(rname);
     auto res = as->find_residue(cid, pdb_res.seq_num, pdb_res.i_code, rname);
     if (res != nullptr || orig_rname.size() < 4)
@@ -1424,8 +1470,9 @@ pdb_res_to_chimera_res(Structure* as, PDB::Residue& pdb_res)
     // try two-letter chain ID
     cid.insert(cid.begin(), orig_rname[3]);
     orig_rname.pop_back();
-    canonicalize_res_name(orig_rname);
-    return as->find_residue(cid, pdb_res.seq_num, pdb_res.i_code, orig_rname);
+    rname = orig_rname;
+    canonicalize_res_name(rname);
+    return as->find_residue(cid, pdb_res.seq_num, pdb_res.i_code, rname);
 }
 
 static Atom*
@@ -1484,28 +1531,97 @@ link_up(PDB& link_ssbond, Structure *as, PyObject *py_logger)
     }
 }
 
-static std::pair<const char *, PyObject *>
-read_no_fileno(void *py_file)
-{
-    const char *line;
-    PyObject *py_line = PyFile_GetLine((PyObject *)py_file, 0);
-    if (PyErr_Occurred() != nullptr)
-        return std::pair<const char*, PyObject *>(line, Py_None);
-    if (PyBytes_Check(py_line)) {
-        line = PyBytes_AS_STRING(py_line);
-    } else {
-        line = PyUnicode_AsUTF8(py_line);
+// Reads the input in large blocks and hands out one line at a time, so that
+// Python file objects (e.g. decompression streams) take one call per block
+// rather than one per line.  Gzipped files are decompressed natively on
+// another thread while the lines already read are parsed.
+struct BlockReader {
+    static const size_t  BLOCK_SIZE = 1 << 20;
+    FILE  *f = nullptr;
+    std::unique_ptr<ioutil::gzip_reader>  gz;
+    PyObject  *py_file = nullptr;
+    std::string  buffer;
+    size_t  pos = 0;
+    bool  at_eof = false;
+    std::string  line;
+
+    // append the next block to the buffer; false at end of input or on error
+    bool  fill() {
+        if (at_eof)
+            return false;
+        if (pos > 0) {
+            buffer.erase(0, pos);
+            pos = 0;
+        }
+        if (f != nullptr) {
+            size_t size = buffer.size();
+            buffer.resize(size + BLOCK_SIZE);
+            size_t num_read = fread(&buffer[size], 1, BLOCK_SIZE, f);
+            buffer.resize(size + num_read);
+            if (num_read == 0)
+                at_eof = true;
+            return num_read > 0;
+        }
+        if (gz) {
+            bool more;
+            try {
+                more = gz->read(buffer);
+            } catch (std::exception &e) {
+                PyErr_SetString(PyExc_IOError, e.what());
+                more = false;
+            }
+            if (!more)
+                at_eof = true;
+            return more;
+        }
+        PyObject *block = PyObject_CallMethod(py_file, "read", "n", (Py_ssize_t)BLOCK_SIZE);
+        if (block == nullptr) {
+            at_eof = true;
+            return false;
+        }
+        const char *data;
+        Py_ssize_t size;
+        if (PyBytes_Check(block)) {
+            data = PyBytes_AS_STRING(block);
+            size = PyBytes_GET_SIZE(block);
+        } else {
+            data = PyUnicode_AsUTF8AndSize(block, &size);
+            if (data == nullptr) {
+                Py_DECREF(block);
+                at_eof = true;
+                return false;
+            }
+        }
+        buffer.append(data, size);
+        Py_DECREF(block);
+        if (size == 0)
+            at_eof = true;
+        return size > 0;
+    }
+    // next line, including its newline; empty at end of input
+    const char  *next_line() {
+        while (true) {
+            const char *start = buffer.data() + pos;
+            const char *nl = static_cast<const char *>(memchr(start, '\n', buffer.size() - pos));
+            if (nl != nullptr) {
+                line.assign(start, nl - start + 1);
+                pos += nl - start + 1;
+                return line.c_str();
+            }
+            if (!fill())
+                break;
+        }
+        // last line might not have a newline
+        line.assign(buffer, pos, std::string::npos);
+        pos = buffer.size();
+        return line.c_str();
     }
-    return std::pair<const char*, PyObject *>(line, py_line);
-}
+};
 
-static char read_fileno_buffer[1024];
 static std::pair<const char *, PyObject *>
-read_fileno(void *f)
+read_block(void *reader)
 {
-    if (fgets(read_fileno_buffer, 1024, (FILE *)f) == nullptr)
-        read_fileno_buffer[0] = '\0';
-    return std::pair<const char *, PyObject *>(read_fileno_buffer, nullptr);
+    return std::pair<const char *, PyObject *>(static_cast<BlockReader *>(reader)->next_line(), nullptr);
 }
 
 static PyObject *
@@ -1529,13 +1645,16 @@ read_pdb(PyObject *pdb_file, PyObject *py_logger, bool explode, bool atomic, boo
     bool per_model_conects = false;
     int line_num = 0;
     bool eof;
-    std::pair<const char *, PyObject *> (*read_func)(void *);
-    void *input;
+    std::pair<const char *, PyObject *> (*read_func)(void *) = read_block;
+    BlockReader reader;
+    void *input = &reader;
     std::vector<Structure *> *structs = new std::vector<Structure *>();
 #ifdef CLOCK_PROFILING
 clock_t start_t, end_t;
 #endif
     auto notifications_off = atomstruct::DestructionNotificationsOff();
+    // send warnings about the file to the logger once it is read
+    logger::BufferedLog log_buffer(py_logger);
     PyObject *http_mod = PyImport_ImportModule("http.client");
     if (http_mod == nullptr)
         return nullptr;
@@ -1552,6 +1671,20 @@ clock_t start_t, end_t;
     auto fcs = PyObject_GetAttrString(pdb_file, "from_compressed_source");
     bool is_inst = (fcs != nullptr && PyBool_Check(fcs) && fcs == Py_True) || 
         PyObject_IsInstance(pdb_file, http_conn) == 1;
+    if (fcs == Py_True) {
+        // decompress gzipped files natively
+        PyObject *path = PyObject_GetAttrString(pdb_file, "compressed_path");
+        const char *cpath = (path != nullptr && PyUnicode_Check(path)) ? PyUnicode_AsUTF8(path) : nullptr;
+        if (cpath != nullptr && ioutil::is_gzip_file(cpath)) {
+            try {
+                reader.gz.reset(new ioutil::gzip_reader(cpath));
+            } catch (std::exception &) {
+                // read through the Python stream instead
+            }
+        }
+        Py_XDECREF(path);
+        PyErr_Clear();
+    }
     int fd;
     if (is_inst)
         // due to buffering issues, cannot handle a socket like it 
@@ -1559,9 +1692,10 @@ clock_t start_t, end_t;
         fd = -1;
     else
         fd = PyObject_AsFileDescriptor(pdb_file);
-    if (fd == -1) {
-        read_func = read_no_fileno;
-        input = pdb_file;
+    if (reader.gz) {
+        PyErr_Clear();
+    } else if (fd == -1) {
+        reader.py_file = pdb_file;
         PyErr_Clear();
         PyObject *io_mod = PyImport_ImportModule("io");
         if (io_mod == nullptr)
@@ -1581,8 +1715,7 @@ clock_t start_t, end_t;
             return nullptr;
         }
     } else {
-        read_func = read_fileno;
-        input = fdopen(fd, "r");
+        reader.f = fdopen(fd, "r");
     }
     while (true) {
 #ifdef CLOCK_PROFILING
@@ -1668,6 +1801,7 @@ start_t = end_t;
         if (!reached_end)
             continue;
 
+        TRACE_SCOPE_ITEMS("pdb.connect_structures", file_structs.size());
         per_model_conects = false;
         for (std::vector<Structure *>::iterator fsi = file_structs.begin();
         fsi != file_structs.end(); ++fsi) {
@@ -2446,6 +2580,7 @@ write_pdb_file(PyObject *, PyObject *args)
     write_pdb(structures, *out_stream, (bool)selected_only, (bool)displayed_only, xforms,
         (bool)all_coordsets, (bool)pqr, (bool)h36, poly_res_names, py_logger);
 
+    out_stream->flush();
     if (out_stream->bad()) {
         PyErr_SetString(PyExc_ValueError, "Problem writing output PDB file");
         delete out_stream;
@@ -25,8 +25,15 @@
  */
 
 #include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <exception>
 #include <map>
 #include <stdlib.h>
+#include <thread>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
 
 #define PDB_CONNECT_EXPORT
 #include "connect.h"
@@ -64,13 +71,125 @@ bonded_dist(Atom* a, Atom* b)
     return dist_sq;
 }
 
+namespace {
+
+// AtomGrid:
+//    Cell list of some of a residue's atoms, so that large residues don't
+// need all-pairs distance checks.  Lookups report atom indices in
+// ascending order, so results match a linear scan of the atoms.
+class AtomGrid {
+    const Residue::Atoms&  _atoms;
+    float  _cell_size;
+    int  _min[3], _max[3];
+    std::unordered_map<std::int64_t, std::vector<size_t>>  _cells;
+
+    void  _cell(const Coord& c, int* ijk) const {
+        for (int i = 0; i < 3; ++i)
+            ijk[i] = (int)std::floor(c[i] / _cell_size);
+    }
+    static std::int64_t  _key(int i, int j, int k) {
+        return (((std::int64_t)i & 0x1fffff) << 42) | (((std::int64_t)j & 0x1fffff) << 21)
+            | ((std::int64_t)k & 0x1fffff);
+    }
+    const std::vector<size_t>*  _find(int i, int j, int k) const {
+        auto ci = _cells.find(_key(i, j, k));
+        return ci == _cells.end() ? nullptr : &ci->second;
+    }
+public:
+    AtomGrid(const Residue::Atoms& atoms, const std::vector<size_t>& indices, float cell_size):
+            _atoms(atoms), _cell_size(cell_size) {
+        for (int i = 0; i < 3; ++i) {
+            _min[i] = INT32_MAX;
+            _max[i] = INT32_MIN;
+        }
+        for (auto index: indices) {
+            int ijk[3];
+            _cell(atoms[index]->coord(), ijk);
+            for (int i = 0; i < 3; ++i) {
+                _min[i] = std::min(_min[i], ijk[i]);
+                _max[i] = std::max(_max[i], ijk[i]);
+            }
+            _cells[_key(ijk[0], ijk[1], ijk[2])].push_back(index);
+        }
+    }
+    // atoms in the cells next to the coordinate's cell, in ascending order
+    void  near(const Coord& c, std::vector<size_t>* result) const {
+        int ijk[3];
+        _cell(c, ijk);
+        result->clear();
+        for (int i = ijk[0] - 1; i <= ijk[0] + 1; ++i)
+            for (int j = ijk[1] - 1; j <= ijk[1] + 1; ++j)
+                for (int k = ijk[2] - 1; k <= ijk[2] + 1; ++k)
+                    if (auto cell = _find(i, j, k))
+                        result->insert(result->end(), cell->begin(), cell->end());
+        std::sort(result->begin(), result->end());
+    }
+    // closest accepted atom, the lowest index one among equally close atoms
+    template <class Accept>
+    Atom*  closest(const Coord& c, Accept accept, float* ret_dist_sq) const {
+        if (_cells.empty()) {
+            if (ret_dist_sq)
+                *ret_dist_sq = 0.0;
+            return nullptr;
+        }
+        int ijk[3];
+        _cell(c, ijk);
+        int max_ring = 0;
+        for (int i = 0; i < 3; ++i)
+            max_ring = std::max(max_ring, std::max(_max[i] - ijk[i], ijk[i] - _min[i]));
+        Atom* closest = nullptr;
+        size_t closest_index = 0;
+        float dist_sq = 0.0;
+        for (int ring = 0; ring <= max_ring; ++ring) {
+            // atoms beyond this ring are at least (ring - 1) cells away;
+            // keep one cell of slack for rounding
+            if (closest != nullptr && ring > 2) {
+                float bound = (ring - 2) * _cell_size;
+                if (bound * bound > dist_sq)
+                    break;
+            }
+            for (int i = ijk[0] - ring; i <= ijk[0] + ring; ++i)
+                for (int j = ijk[1] - ring; j <= ijk[1] + ring; ++j)
+                    for (int k = ijk[2] - ring; k <= ijk[2] + ring; ++k) {
+                        if (std::abs(i - ijk[0]) != ring && std::abs(j - ijk[1]) != ring
+                        && std::abs(k - ijk[2]) != ring)
+                            continue;   // inner ring, already searched
+                        auto cell = _find(i, j, k);
+                        if (cell == nullptr)
+                            continue;
+                        for (auto index: *cell) {
+                            Atom* oa = _atoms[index];
+                            if (!accept(oa))
+                                continue;
+                            float new_dist_sq = c.sqdistance(oa->coord());
+                            if (closest != nullptr && (new_dist_sq > dist_sq
+                            || (new_dist_sq == dist_sq && index > closest_index)))
+                                continue;
+                            closest = oa;
+                            closest_index = index;
+                            dist_sq = new_dist_sq;
+                        }
+                    }
+        }
+        if (ret_dist_sq)
+            *ret_dist_sq = dist_sq;
+        return closest;
+    }
+};
+
+// residues at least this big get cell lists
+const size_t GRID_MIN_ATOMS = 64;
+
+}  // namespace
+
 // connect_atom_by_distance:
 //    Connect an atom to a residue by distance criteria.  Don't connect a
 // hydrogen or lone pair more than once, nor connect to one that's already
-// bonded.
+// bonded.  If 'candidates' is given, only those atoms (indices into
+// 'atoms', in ascending order) are considered.
 static void
-connect_atom_by_distance(Atom* a, const Residue::Atoms& atoms,
-    Residue::Atoms::const_iterator& a_it, std::set<Atom *>* conect_atoms)
+connect_atom_by_distance(Atom* a, const Residue::Atoms& atoms, size_t a_index,
+    std::set<Atom *>* conect_atoms, const std::vector<size_t>* candidates = nullptr)
 {
     float short_dist = 0.0;
     Atom *close_atom = NULL;
@@ -78,14 +197,15 @@ connect_atom_by_distance(Atom* a, const Residue::Atoms& atoms,
     bool H_or_LP = a->element() <= Element::H;
     if (H_or_LP && !a->bonds().empty())
         return;
-    Residue::Atoms::const_iterator end = atoms.end();
-    for (Residue::Atoms::const_iterator ai = atoms.begin(); ai != end; ++ai)
+    size_t num_candidates = candidates ? candidates->size() : atoms.size();
+    for (size_t ci = 0; ci < num_candidates; ++ci)
     {
-        Atom *oa = *ai;
+        size_t i = candidates ? (*candidates)[ci] : ci;
+        Atom *oa = atoms[i];
         if (a == oa || a->connects_to(oa)
         || (oa->element() <= Element::H && (H_or_LP || !oa->bonds().empty())))
             continue;
-        if (ai < a_it && conect_atoms && conect_atoms->find(oa) == conect_atoms->end())
+        if (i < a_index && conect_atoms && conect_atoms->find(oa) == conect_atoms->end())
             // already checked
             continue;
         float dist = bonded_dist(a, oa);
@@ -106,7 +226,8 @@ connect_atom_by_distance(Atom* a, const Residue::Atoms& atoms,
 }
 
 // connect_residue_by_distance:
-//    Connect atoms in residue by distance.  This is an n-squared algorithm.
+//    Connect atoms in residue by distance.  This is an n-squared algorithm
+//    for small residues; large ones use a cell list.
 //    Takes into account alternate atom locations.  'conect_atoms' are
 //    atoms whose connectivity is already known.
 void
@@ -114,60 +235,180 @@ connect_residue_by_distance(Residue* r, std::set<Atom *>* conect_atoms)
 {
     // connect up atoms in residue by distance
     const Residue::Atoms &atoms = r->atoms();
-    for (Residue::Atoms::const_iterator ai = atoms.begin(); ai != atoms.end(); ++ai) {
-        Atom *a = *ai;
-        if (conect_atoms && conect_atoms->find(a) != conect_atoms->end()) {
-            // connectivity specified in a CONECT record, skip
-            continue;
+    if (atoms.size() < GRID_MIN_ATOMS) {
+        for (size_t i = 0; i < atoms.size(); ++i) {
+            Atom *a = atoms[i];
+            if (conect_atoms && conect_atoms->find(a) != conect_atoms->end()) {
+                // connectivity specified in a CONECT record, skip
+                continue;
+            }
+            connect_atom_by_distance(a, atoms, i, conect_atoms);
         }
-        connect_atom_by_distance(a, atoms, ai, conect_atoms);
+        return;
+    }
+
+    // no atoms farther apart than the longest possible bond need to be checked
+    float max_radius = 0.0;
+    std::vector<size_t> indices(atoms.size());
+    for (size_t i = 0; i < atoms.size(); ++i) {
+        indices[i] = i;
+        max_radius = std::max(max_radius, Element::bond_radius(atoms[i]->element()));
+    }
+    AtomGrid grid(atoms, indices, std::max(2 * max_radius + 0.5f, 1.0f));
+    std::vector<size_t> candidates;
+    for (size_t i = 0; i < atoms.size(); ++i) {
+        Atom *a = atoms[i];
+        if (conect_atoms && conect_atoms->find(a) != conect_atoms->end())
+            continue;
+        grid.near(a->coord(), &candidates);
+        connect_atom_by_distance(a, atoms, i, conect_atoms, &candidates);
     }
 }
 
-// connect_residue_by_template:
-//    Connect bonds in residue according to the given template.  Takes into
-//    acount alternate atom locations.
-static void
-connect_residue_by_template(Residue* r, const tmpl::Residue* tr,
-                        std::set<Atom *>* conect_atoms)
+typedef std::vector<std::pair<Atom*, Atom*>> AtomPairs;
+
+// find_template_bonds:
+//    Find the atom pairs to bond in a residue according to the given
+//    template, without changing the structure so that residues can be
+//    done on several threads.  Returns whether some atoms not specified
+//    by CONECT records are not in the template.
+static bool
+find_template_bonds(const Residue* r, const tmpl::Residue* tr,
+                    const std::set<Atom *>* conect_atoms, AtomPairs& pairs)
 {
     // foreach atom in residue
-    //    connect up like atom in template
+    //    pair up like atom in template
     bool some_connectivity_unknown = false;
-    std::set<Atom *> known_connectivity;
-    const Residue::Atoms &atoms = r->atoms();
-    for (Residue::Atoms::const_iterator ai = atoms.begin(); ai != atoms.end(); ++ai) {
-        Atom *a = *ai;
+    for (auto a: r->atoms()) {
         if (conect_atoms->find(a) != conect_atoms->end()) {
             // connectivity specified in a CONECT record, skip
-            known_connectivity.insert(a);
             continue;
         }
         tmpl::Atom *ta = tr->find_atom(a->name());
         if (ta == NULL) {
             some_connectivity_unknown = true;
             continue;
-         }
-        // non-template atoms will be able to connect to known atoms;
-        // avoid rechecking known atoms though...
-        known_connectivity.insert(a);
-
+        }
         for(auto tmpl_nb: ta->neighbors()) {
             Atom *b = r->find_atom(tmpl_nb->name());
-            if (b == NULL)
-                continue;
-            if (!a->connects_to(b)) {
-                (void) a->structure()->new_bond(a, b);
-            }
+            if (b != NULL)
+                pairs.emplace_back(a, b);
         }
     }
+    return some_connectivity_unknown;
+}
+
+// connect_residue_by_template:
+//    Connect bonds in residue according to the given template and the atom
+//    pairs found for it by find_template_bonds().  Takes into acount
+//    alternate atom locations.
+static void
+connect_residue_by_template(Residue* r, const tmpl::Residue* tr,
+                        std::set<Atom *>* conect_atoms,
+                        const std::pair<Atom*, Atom*>* pairs, size_t num_pairs,
+                        bool some_connectivity_unknown)
+{
+    for (size_t i = 0; i < num_pairs; ++i)
+        add_bond(pairs[i].first, pairs[i].second);
     // For each atom that wasn't connected (i.e. not in template),
     // connect it by distance
     if (!some_connectivity_unknown)
         return;
+    // non-template atoms will be able to connect to known atoms;
+    // avoid rechecking known atoms though...
+    std::set<Atom *> known_connectivity;
+    for (auto a: r->atoms())
+        if (conect_atoms->find(a) != conect_atoms->end()
+        || tr->find_atom(a->name()) != NULL)
+            known_connectivity.insert(a);
     connect_residue_by_distance(r, &known_connectivity);
 }
 
+// TemplateBonds:
+//    Template atom pairs of blocks of residues found on several threads.
+//    Templates are looked up beforehand, once for each distinct residue
+//    name and chain position.  The bonds are then added on the calling thread in residue
+//    order, interleaved with the bonds between residues as before.
+class TemplateBonds {
+public:
+    TemplateBonds(const Structure::Residues& residues,
+            const std::vector<const tmpl::Residue *>& templates,
+            std::set<Atom *>* conect_atoms):
+        _residues(residues), _templates(templates), _conect_atoms(conect_atoms) {}
+    // Residues must be connected in order.
+    void  connect_residue(size_t i);
+private:
+    static const size_t  BLOCK_SIZE = 100000;	// Residues, limits memory use
+    struct ResidueBonds {
+        const AtomPairs*  pairs;
+        size_t  begin, end;
+        bool  some_connectivity_unknown;
+    };
+    void  _find_block(size_t begin);
+
+    const Structure::Residues&  _residues;
+    const std::vector<const tmpl::Residue *>&  _templates;
+    std::set<Atom *>*  _conect_atoms;
+    size_t  _block_begin = 0, _block_end = 0;
+    std::vector<AtomPairs>  _thread_pairs;
+    std::vector<ResidueBonds>  _block_bonds;
+};
+
+void
+TemplateBonds::connect_residue(size_t i)
+{
+    if (i < _block_begin || i >= _block_end)
+        _find_block(i);
+    auto& rb = _block_bonds[i - _block_begin];
+    const std::pair<Atom*, Atom*>* pairs = rb.pairs->data() + rb.begin;
+    connect_residue_by_template(_residues[i], _templates[i], _conect_atoms,
+        pairs, rb.end - rb.begin, rb.some_connectivity_unknown);
+}
+
+void
+TemplateBonds::_find_block(size_t begin)
+{
+    size_t end = std::min(begin + BLOCK_SIZE, _residues.size());
+    size_t nres = end - begin;
+    size_t num_threads = std::min((size_t)std::thread::hardware_concurrency(),
+        nres / 1000 + 1);
+    if (num_threads < 1)
+        num_threads = 1;
+    _thread_pairs.clear();
+    _thread_pairs.resize(num_threads);
+    _block_bonds.resize(nres);
+    std::vector<std::exception_ptr> exceptions(num_threads);
+    auto find_pairs = [&](size_t t) {
+        try {
+            size_t tbegin = begin + nres * t / num_threads;
+            size_t tend = begin + nres * (t + 1) / num_threads;
+            auto& pairs = _thread_pairs[t];
+            for (size_t i = tbegin; i < tend; ++i) {
+                auto& rb = _block_bonds[i - begin];
+                rb.pairs = &pairs;
+                rb.begin = pairs.size();
+                const tmpl::Residue* tr = _templates[i];
+                rb.some_connectivity_unknown = (tr != NULL
+                    && find_template_bonds(_residues[i], tr, _conect_atoms, pairs));
+                rb.end = pairs.size();
+            }
+        } catch (...) {
+            exceptions[t] = std::current_exception();
+        }
+    };
+    std::vector<std::thread> threads;
+    for (size_t t = 1; t < num_threads; ++t)
+        threads.emplace_back(find_pairs, t);
+    find_pairs(0);
+    for (auto& th: threads)
+        th.join();
+    for (auto& e: exceptions)
+        if (e)
+            std::rethrow_exception(e);
+    _block_begin = begin;
+    _block_end = end;
+}
+
 static std::map<Element::AS, unsigned long>  _saturationMap = {
     {Element::H, 1},
     {Element::O, 2}
@@ -251,6 +492,49 @@ find_nearest_pair(Residue* from, Residue* to, Atom** ret_from_atom,
     float    dist_sq = 0.0;
 
     const Residue::Atoms &atoms = from->atoms();
+    const Residue::Atoms &to_atoms = to->atoms();
+    if (atoms.size() >= GRID_MIN_ATOMS && to_atoms.size() >= GRID_MIN_ATOMS) {
+        // same as the find_closest() loop below, but the candidate atoms
+        // are found once and looked up through a cell list
+        std::vector<size_t> indices;
+        for (size_t i = 0; i < to_atoms.size(); ++i) {
+            Atom *oa = to_atoms[i];
+            if (oa->element().number() != 1 && !saturated(oa))
+                indices.push_back(i);
+        }
+        // about a few atoms per cell
+        Coord lo = to_atoms[0]->coord(), hi = lo;
+        for (auto oa: to_atoms)
+            for (int i = 0; i < 3; ++i) {
+                lo[i] = std::min(lo[i], oa->coord()[i]);
+                hi[i] = std::max(hi[i], oa->coord()[i]);
+            }
+        float volume = std::max((hi[0]-lo[0]) * (hi[1]-lo[1]) * (hi[2]-lo[2]), 1.0);
+        float cell_size = std::max((float)std::cbrt(4 * volume / to_atoms.size()), 1.0f);
+        AtomGrid grid(to_atoms, indices, cell_size);
+        for (auto a: atoms) {
+            if (saturated(a) || a->element().number() == 1)
+                continue;
+            float new_dist_sq;
+            Atom *b = grid.closest(a->coord(), [a, to](Atom* oa) {
+                return !(a->residue() == to && a->name() == oa->name());
+            }, &new_dist_sq);
+            if (b == NULL)
+                continue;
+            if (fsave == NULL || new_dist_sq < dist_sq) {
+                fsave = a;
+                tsave = b;
+                dist_sq = new_dist_sq;
+            }
+        }
+        if (ret_from_atom)
+            *ret_from_atom = fsave;
+        if (ret_to_atom)
+            *ret_to_atom = tsave;
+        if (ret_dist_sq)
+            *ret_dist_sq = dist_sq;
+        return;
+    }
     for (Residue::Atoms::const_iterator ai = atoms.begin(); ai != atoms.end();
     ++ai) {
         float    new_dist_sq;
@@ -455,9 +739,28 @@ connect_structure(Structure* as, std::vector<Residue *>* start_residues,
     // start/end residues much more efficient to search as a map...
     std::set<Residue*> sres_map(start_residues->begin(), start_residues->end());
     std::set<Residue*> eres_map(end_residues->begin(), end_residues->end());
-    for (Structure::Residues::const_iterator ri = as->residues().begin();
-    ri != as->residues().end(); ++ri) {
-        Residue *r = *ri;
+    // Look up templates here, usually only a few distinct ones, so the
+    // template atom pairs can be found on several threads.
+    const Structure::Residues& residues = as->residues();
+    std::vector<const tmpl::Residue *> templates(residues.size(), nullptr);
+    std::map<std::tuple<ResName, bool, bool>, const tmpl::Residue *> template_cache;
+    for (size_t i = 0; i < residues.size(); ++i) {
+        Residue *r = residues[i];
+        if (mod_res->find(MolResId(r)) != mod_res->end())
+            // residue in MODRES record;
+            // don't try to use template connectivity
+            continue;
+        auto key = std::make_tuple(r->name(), sres_map.find(r) != sres_map.end(),
+            eres_map.find(r) != eres_map.end());
+        auto ti = template_cache.find(key);
+        if (ti == template_cache.end())
+            ti = template_cache.emplace(key, tmpl::find_template_residue(r->name(),
+                std::get<1>(key), std::get<2>(key))).first;
+        templates[i] = ti->second;
+    }
+    TemplateBonds template_bonds(residues, templates, conect_atoms);
+    for (size_t ri = 0; ri < residues.size(); ++ri) {
+        Residue *r = residues[ri];
 
         if (!first_res)
             first_res = r;
@@ -504,17 +807,9 @@ connect_structure(Structure* as, std::vector<Residue *>* start_residues,
                     break;
             }
         }
-        const tmpl::Residue *tr;
-        if (is_mod_res)
-            // residue in MODRES record;
-            // don't try to use template connectivity
-            tr = NULL;
-        else
-            tr = tmpl::find_template_residue(r->name(),
-                sres_map.find(r) != sres_map.end(),
-                eres_map.find(r) != eres_map.end());
+        const tmpl::Residue *tr = templates[ri];
         if (tr != NULL) {
-            connect_residue_by_template(r, tr, conect_atoms);
+            template_bonds.connect_residue(ri);
             // if PDB uses non-standard (or old standard) hydrogen names
             // then there may be "floating" hydrogens.  Check for that.
             for (auto a: r->atoms()) {
@@ -25,20 +25,57 @@
  */
 
 // ----------------------------------------------------------------------------
-// Pack triangles in Stereo Lithography (STL) file format.
+// Denoise depth video frames.
 //
 #include <Python.h>			// use PyObject
 
+#include <cstdint>			// use std::int64_t
 //include <iostream>			// use std::cerr for debugging
 
 #include <arrays/pythonarray.h>		// use array_from_python()
 #include <arrays/rcarray.h>		// use FArray, IArray
+#include <arrays/threadpool.h>		// use Thread_Pool::parallel_for
 
 static bool check_array_value_type(Numeric_Array &a, const char* name, Numeric_Array::Value_Type type);
 static bool check_array_size(Numeric_Array &a, const char* name, int s0, int s1);
 static bool check_array_size(Numeric_Array &a, const char* name, int s0, int s1, int s2);
 static bool check_array_contiguous(Numeric_Array &a, const char* name);
-static bool color_changed(unsigned char *c1, unsigned char *c2, int max_color_diff);
+static bool color_changed(const unsigned char *c1, const unsigned char *c2, int max_color_diff);
+
+// Image rows denoised per thread pool task.
+static const int64_t rows_per_chunk = 16;
+
+// ----------------------------------------------------------------------------
+// Pixels are independent so rows can be denoised in any order.
+//
+static void denoise_pixels(int64_t i0, int64_t i1, const unsigned short *d, const unsigned char *c,
+			   unsigned short *ad, float ave_weight, unsigned short *md,
+			   unsigned char *mdc, unsigned char *lc, int max_color_diff)
+{
+  float f0 = ave_weight, f1 = 1-ave_weight;
+  for (int64_t i = i0, ci = 3*i0 ; i < i1 ; ++i, ci += 3)
+    {
+      unsigned short dv = d[i];
+      if (dv >= md[i])
+	{
+	  md[i] = dv;
+	  for (int cc = 0 ; cc < 3 ; ++cc)
+	    mdc[ci+cc] = c[ci+cc];
+	}
+      if (dv == 0)
+	{
+	  // Depth 0 indicates unknown depth
+	  if (!color_changed(c+ci, mdc+ci, max_color_diff))
+	    ad[i] = md[i];  // use max depth since color matches.
+	}
+      else if (color_changed(c+ci, lc+ci, max_color_diff))
+	ad[i] = dv;	// Update depth immediately if color changed
+      else
+	ad[i] = (unsigned short)(f0*dv + f1*ad[i]);  // Use average depth if color did not change
+      for (int cc = 0 ; cc < 3 ; ++cc)
+	lc[cc+ci] = c[cc+ci];
+    }
+}
 
 // ----------------------------------------------------------------------------
 //
@@ -66,24 +103,24 @@ denoise_depth(PyObject *, PyObject *args, PyObject *keywds)
   if (!check_array_value_type(depth_image, "depth_image", Numeric_Array::Unsigned_Short_Int) ||
       !check_array_value_type(color_image, "color_image", Numeric_Array::Unsigned_Char) ||
       !check_array_value_type(ave_depth, "ave_depth", Numeric_Array::Unsigned_Short_Int) ||
-      !check_array_value_type(ave_depth, "max_depth", Numeric_Array::Unsigned_Short_Int) ||
-      !check_array_value_type(last_color, "max_depth_color", Numeric_Array::Unsigned_Char) ||
+      !check_array_value_type(max_depth, "max_depth", Numeric_Array::Unsigned_Short_Int) ||
+      !check_array_value_type(max_depth_color, "max_depth_color", Numeric_Array::Unsigned_Char) ||
       !check_array_value_type(last_color, "last_color", Numeric_Array::Unsigned_Char))
     return NULL;
 
   int s0 = depth_image.size(0), s1 = depth_image.size(1);
   if (!check_array_size(color_image, "color_image", s0, s1, 3) ||
       !check_array_size(ave_depth, "ave_depth", s0, s1) ||
-      !check_array_size(ave_depth, "max_depth", s0, s1) ||
-      !check_array_size(last_color, "max_depth_color", s0, s1, 3) ||
+      !check_array_size(max_depth, "max_depth", s0, s1) ||
+      !check_array_size(max_depth_color, "max_depth_color", s0, s1, 3) ||
       !check_array_size(last_color, "last_color", s0, s1, 3))
     return NULL;
 
   if (!check_array_contiguous(depth_image, "depth_image") ||
       !check_array_contiguous(color_image, "color_image") ||
       !check_array_contiguous(ave_depth, "ave_depth") ||
-      !check_array_contiguous(ave_depth, "max_depth") ||
-      !check_array_contiguous(last_color, "max_depth_color") ||
+      !check_array_contiguous(max_depth, "max_depth") ||
+      !check_array_contiguous(max_depth_color, "max_depth_color") ||
       !check_array_contiguous(last_color, "last_color"))
     return NULL;
 
@@ -94,38 +131,19 @@ denoise_depth(PyObject *, PyObject *args, PyObject *keywds)
   unsigned char *lc = static_cast<unsigned char *>(last_color.values());
   unsigned char *mdc = static_cast<unsigned char *>(max_depth_color.values());
   
-  int i = 0, ci = 0;
-  float f0 = ave_weight, f1 = 1-ave_weight;
-  for (int i0 = 0 ; i0 < s0 ; ++i0)
-    for (int i1 = 0 ; i1 < s1 ; ++i1, ++i, ci += 3)
-      {
-	unsigned short dv = d[i];
-	if (dv >= md[i])
-	  {
-	    md[i] = dv;
-	    for (int cc = 0 ; cc < 3 ; ++cc)
-	      mdc[ci+cc] = c[ci+cc];
-	  }
-	if (dv == 0)
-	  {
-	    // Depth 0 indicates unknown depth
-	    if (!color_changed(c+ci, mdc+ci, max_color_diff))
-	      ad[i] = md[i];  // use max depth since color matches.
-	  }
-	else if (color_changed(c+ci, lc+ci, max_color_diff))
-	  ad[i] = dv;	// Update depth immediately if color changed
-	else
-	  ad[i] = (unsigned short)(f0*dv + f1*ad[i]);  // Use average depth if color did not change
-	for (int cc = 0 ; cc < 3 ; ++cc)
-	  lc[cc+ci] = c[cc+ci];
-      }
+  int64_t w = s1;
+  Py_BEGIN_ALLOW_THREADS
+  Thread_Pool::parallel_for(s0, [=](int64_t r0, int64_t r1) {
+      denoise_pixels(r0*w, r1*w, d, c, ad, ave_weight, md, mdc, lc, max_color_diff);
+    }, rows_per_chunk);
+  Py_END_ALLOW_THREADS
   
   return python_none();
 }
 
 // ----------------------------------------------------------------------------
 //
-static bool color_changed(unsigned char *c1, unsigned char *c2, int max_color_diff)
+static bool color_changed(const unsigned char *c1, const unsigned char *c2, int max_color_diff)
 {
   for (int cc = 0 ; cc < 3 ; ++cc)
     {
@@ -43,15 +43,16 @@ def cmd_renumber(session, residues, *, relative=True, start=None, seq_start=None
         raise UserError("Cannot specify both 'start' and seqStart' keywords")
 
     # verify no conflicts before making actual changes
-    s_proposed_changes = {}
-    s_changed_residues = {}
+    from chimerax.atomic import Residues, concatenate
+    from numpy import arange, concatenate as concat_arrays
     change_info = []
     for s, s_residues in residues.by_structure:
-        s_proposed_changes[s] = proposed_changes = set()
-        s_changed_residues[s] = changed_residues = set()
+        s_changed = []
+        s_numbers = []
+        s_insertion_codes = []
         chain_ids = s_residues.unique_chain_ids
         for cid in chain_ids:
-            chain_residues = sorted(s_residues[s_residues.chain_ids == cid])
+            chain_residues = Residues(sorted(s_residues[s_residues.chain_ids == cid]))
             if seq_numbering:
                 for r in chain_residues:
                     if r.chain:
@@ -63,32 +64,27 @@ def cmd_renumber(session, residues, *, relative=True, start=None, seq_start=None
                 seq_offset = 0
             if relative:
                 offset = (start_number + seq_offset) - chain_residues[0].number
+                s_numbers.append(chain_residues.numbers + offset)
+                s_insertion_codes.extend(chain_residues.insertion_codes)
             else:
-                from itertools import count
-                counter = count(start_number + seq_offset)
-            for r in chain_residues:
-                if relative:
-                    new_number = r.number + offset
-                    new_insertion_code = r.insertion_code
-                else:
-                    new_number = next(counter)
-                    new_insertion_code = ''
-                proposed_changes.add((cid, new_number, new_insertion_code))
-                changed_residues.add(r)
-                if r.number != new_number or r.insertion_code != new_insertion_code:
-                    change_info.append((r, new_number, new_insertion_code))
-        # check for conflicts
-        for r in s.residues:
-            if r in changed_residues:
-                continue
-            if (r.chain_id, r.number, r.insertion_code) in proposed_changes:
-                from chimerax.core.errors import UserError
-                raise UserError("Proposed renumbering conflicts with existing residue %s" % r)
-    # apply changes
-    for r, number, insertion_code in change_info:
-        r.number = number
-        r.insertion_code = insertion_code
-    session.logger.info("%d residues renumbered" % len(change_info))
+                s_numbers.append(arange(len(chain_residues)) + start_number + seq_offset)
+                s_insertion_codes.extend([''] * len(chain_residues))
+            s_changed.append(chain_residues)
+        s_changed = concatenate(s_changed)
+        s_numbers = concat_arrays(s_numbers)
+        # check for conflicts in C++, for all structures before changing any
+        try:
+            s.set_residue_numbers(s_changed, s_numbers, s_insertion_codes, check_only=True)
+        except ValueError as e:
+            raise UserError(str(e))
+        change_info.append((s, s_changed, s_numbers, s_insertion_codes))
+    # apply changes, one bulk update per structure
+    num_changed = 0
+    for s, s_changed, numbers, insertion_codes in change_info:
+        num_changed += ((s_changed.numbers != numbers)
+            | (s_changed.insertion_codes != insertion_codes)).sum()
+        s.set_residue_numbers(s_changed, numbers, insertion_codes)
+    session.logger.info("%d residues renumbered" % num_changed)
 
 def register_command(command_name, logger):
     from chimerax.core.commands import CmdDesc, register, BoolArg, Or, EmptyArg, IntArg
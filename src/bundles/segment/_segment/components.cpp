@@ -0,0 +1,115 @@
+// ----------------------------------------------------------------------------
+// Label connected regions above a threshold with union-find over blocks
+// of planes.
+//
+#include <algorithm>		// use std::min()
+#include <cstdint>		// use uint32_t
+#include <vector>		// use std::vector
+
+#include <arrays/threadpool.h>	// use Thread_Pool::parallel_for
+
+#include "components.h"
+
+namespace Segment_Map
+{
+
+// Union-find forest over grid point indices.  Each parent has a smaller
+// grid index than its child so the root is the first point of a region.
+class Grid_Union_Find
+{
+public:
+  static const uint32_t none = 0xffffffff;
+  Grid_Union_Find(int64_t size) : parent(size, none) {}
+  uint32_t find(uint32_t i)
+  {
+    while (parent[i] != i)
+      {
+	parent[i] = parent[parent[i]];	// Path halving
+	i = parent[i];
+      }
+    return i;
+  }
+  void join(uint32_t i, uint32_t j)
+  {
+    uint32_t ri = find(i), rj = find(j);
+    if (ri < rj)
+      parent[rj] = ri;
+    else if (rj < ri)
+      parent[ri] = rj;
+  }
+  std::vector<uint32_t> parent;
+};
+
+// ----------------------------------------------------------------------------
+// Join points above threshold with their neighbors at lower index within
+// planes i0start to i0end-1.
+//
+template <class T>
+void join_block(const T *data, const int64_t *sizes, float threshold,
+		int64_t i0start, int64_t i0end, Grid_Union_Find &uf)
+{
+  int64_t s1 = sizes[1], s2 = sizes[2];
+  int64_t st0 = s1*s2, st1 = s2;
+  uint32_t none = Grid_Union_Find::none;
+  std::vector<uint32_t> &p = uf.parent;
+  for (int64_t i0 = i0start ; i0 < i0end ; ++i0)
+    for (int64_t i1 = 0 ; i1 < s1 ; ++i1)
+      for (int64_t i2 = 0 ; i2 < s2 ; ++i2)
+	{
+	  int64_t i = i0*st0 + i1*st1 + i2;
+	  if (data[i] < threshold)
+	    continue;
+	  p[i] = i;
+	  if (i2 > 0 && p[i-1] != none)
+	    uf.join(i-1, i);
+	  if (i1 > 0 && p[i-st1] != none)
+	    uf.join(i-st1, i);
+	  if (i0 > i0start && p[i-st0] != none)
+	    uf.join(i-st0, i);
+	}
+}
+
+// ----------------------------------------------------------------------------
+//
+template <class T>
+Index connected_regions(const T *data, const int64_t *data_size,
+			float threshold, Index *region_map)
+{
+  int64_t s0 = data_size[0], s1 = data_size[1], s2 = data_size[2];
+  int64_t st0 = s1*s2, size = s0*st0;
+  Grid_Union_Find uf(size);
+
+  // Label blocks of planes in parallel.  Each block only touches
+  // its own grid points.
+  int64_t block_planes = std::max((int64_t)1, ((int64_t)1 << 20) / std::max(st0, (int64_t)1));
+  int64_t nblocks = (s0 + block_planes - 1) / block_planes;
+  Thread_Pool::parallel_for(nblocks, [&](int64_t b0, int64_t b1) {
+      for (int64_t b = b0 ; b < b1 ; ++b)
+	join_block(data, data_size, threshold, b*block_planes,
+		   std::min(s0, (b+1)*block_planes), uf);
+    });
+
+  // Join regions across the faces between blocks.
+  uint32_t none = Grid_Union_Find::none;
+  std::vector<uint32_t> &p = uf.parent;
+  for (int64_t b = 1 ; b < nblocks ; ++b)
+    {
+      int64_t i0 = b*block_planes * st0;
+      for (int64_t i = i0 ; i < i0 + st0 ; ++i)
+	if (p[i] != none && p[i-st0] != none)
+	  uf.join(i-st0, i);
+    }
+
+  // Parents always have smaller grid index, so in one pass in index order
+  // each point's parent already has its final region number.
+  Index count = 0;
+  for (int64_t i = 0 ; i < size ; ++i)
+    {
+      uint32_t pi = p[i];
+      region_map[i] = (pi == none ? 0 : (pi == i ? ++count : region_map[pi]));
+    }
+
+  return count;
+}
+
+} // end of namespace Segment_Map
@@ -0,0 +1,28 @@
+// ----------------------------------------------------------------------------
+// Routines for calculationg segmentations of volume data.
+//
+#ifndef COMPONENTS_HEADER_INCLUDED
+#define COMPONENTS_HEADER_INCLUDED
+
+#include "region_map.h"		// use Index
+
+namespace Segment_Map
+{
+
+//
+// Label the connected regions of grid points with data value at or above
+// threshold, using the same 6 neighbor connectivity as flood_fill().
+// Blocks of planes are labeled in parallel and joined across block faces.
+// Region map values are 1 to the number of regions, numbered in order of
+// the first grid point of each region, and 0 below threshold.  Returns the
+// number of regions.
+//
+template <class T>
+Index connected_regions(const T *data, const int64_t *data_size,
+			float threshold, Index *region_map);
+
+} // end of namespace Segment_Map
+
+#include "components.cpp"	// template implementation
+
+#endif
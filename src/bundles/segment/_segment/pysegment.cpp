@@ -11,6 +11,7 @@
 #include <arrays/rcarray.h>		// use FArray, IArray
 
 #include "bin.h"			// use bin_sums()
+#include "components.h"			// use connected_regions()
 #include "region_map.h"			// use region_grid_indices(), Index
 #include "watershed.h"			// Use watershed_regions()
 
@@ -53,7 +54,9 @@ void watershed_reg(const Array<T> &data, float threshold, Index *region_map, Ind
 {
   Array<T> dc = data.contiguous_array();
   T *d = dc.values();
+  Py_BEGIN_ALLOW_THREADS
   *rcount = watershed_regions(d, data.sizes(), threshold, region_map);
+  Py_END_ALLOW_THREADS
 }
 
 // ----------------------------------------------------------------------------
@@ -89,6 +92,68 @@ extern "C"  PyObject *watershed_regions(PyObject *, PyObject *args, PyObject *ke
   return PyLong_FromLong(rcount);
 }
 
+// ----------------------------------------------------------------------------
+// Region_Map must be contiguous array.
+//
+template <class T>
+void connected_reg(const Array<T> &data, float threshold, Index *region_map, Index *rcount)
+{
+  Array<T> dc = data.contiguous_array();
+  T *d = dc.values();
+  Py_BEGIN_ALLOW_THREADS
+  *rcount = connected_regions(d, data.sizes(), threshold, region_map);
+  Py_END_ALLOW_THREADS
+}
+
+// ----------------------------------------------------------------------------
+//
+extern "C"  PyObject *connected_regions(PyObject *, PyObject *args, PyObject *keywds)
+{
+  PyObject *py_data, *py_region_map;
+  float threshold;
+  const char *kwlist[] = {"data", "threshold", "region_map", NULL};
+  if (!PyArg_ParseTupleAndKeywords(args, keywds, const_cast<char *>("OfO"),
+				   (char **)kwlist, &py_data, &threshold,
+				   &py_region_map))
+    return NULL;
+
+  Numeric_Array data;
+  if (!parse_map(py_data, &data))
+    return NULL;
+
+  Array<unsigned int> region_map;
+  if (!parse_region_map(py_region_map, region_map))
+    return NULL;
+  if (!region_map.is_contiguous())
+    {
+      PyErr_SetString(PyExc_TypeError, "region_map array must be contiguous");
+      return NULL;
+    }
+  for (int a = 0 ; a < 3 ; ++a)
+    if (region_map.size(a) != data.size(a))
+      {
+	PyErr_SetString(PyExc_TypeError, "region_map and data array sizes differ");
+	return NULL;
+      }
+  if (data.size() >= 0xffffffff)
+    {
+      PyErr_SetString(PyExc_ValueError, "connected_regions() requires fewer than 2^32 grid points");
+      return NULL;
+    }
+
+  Index rcount;
+  call_template_function(connected_reg, data.value_type(),
+  			 (data, threshold, region_map.values(), &rcount));
+
+  int *bounds;
+  PyObject *bpy = python_int_array(rcount+1, 7, &bounds);
+  Py_BEGIN_ALLOW_THREADS
+  region_bounds(region_map.values(), region_map.sizes(), rcount, bounds);
+  Py_END_ALLOW_THREADS
+
+  return python_tuple(PyLong_FromLong(rcount), bpy);
+}
+
 // ----------------------------------------------------------------------------
 //
 static PyObject *region_map_region_indices(const Array<Index> &region_map)
@@ -354,6 +419,89 @@ extern "C" PyObject *region_maxima(PyObject *, PyObject *args, PyObject *keywds)
   return t;
 }
 
+// ----------------------------------------------------------------------------
+//
+template <class T>
+void region_stats(Array<Index> &region_map, const Array<T> &data, Index rmax,
+		  int *bounds, Contacts &contacts, int *max_points, float *max_values)
+{
+  Array<T> dc = data.contiguous_array();
+  T *d = dc.values();
+  Py_BEGIN_ALLOW_THREADS
+  region_statistics(region_map.values(), region_map.sizes(), rmax, d, bounds, &contacts,
+		    max_points, max_values);
+  Py_END_ALLOW_THREADS
+}
+
+// ----------------------------------------------------------------------------
+//
+extern "C" PyObject *region_statistics(PyObject *, PyObject *args, PyObject *keywds)
+{
+  PyObject *py_region_map, *py_data = Py_None;
+  const char *kwlist[] = {"region_map", "data", NULL};
+  if (!PyArg_ParseTupleAndKeywords(args, keywds, const_cast<char *>("O|O"),
+				   (char **) kwlist, &py_region_map, &py_data))
+    return NULL;
+
+  Array<unsigned int> region_map;
+  if (!parse_region_map(py_region_map, region_map))
+    return NULL;
+
+  Numeric_Array data;
+  if (py_data != Py_None && !parse_map(py_data, &data))
+    return NULL;
+
+  Array<Index> mc = region_map.contiguous_array();
+  Index *m = mc.values();
+  Index rmax;
+  Py_BEGIN_ALLOW_THREADS
+  rmax = largest_value(m, region_map.sizes());
+  Py_END_ALLOW_THREADS
+  int *bounds;
+  PyObject *bpy = python_int_array(rmax+1, 7, &bounds);
+
+  Contacts contacts;
+  PyObject *pts = NULL, *vals = NULL;
+  if (py_data == Py_None)
+    {
+      Py_BEGIN_ALLOW_THREADS
+      region_statistics(m, region_map.sizes(), rmax, (const float *)NULL, bounds, &contacts,
+			NULL, NULL);
+      Py_END_ALLOW_THREADS
+    }
+  else
+    {
+      int *max_points;
+      pts = python_int_array(rmax, 3, &max_points);
+      float *max_values;
+      vals = python_float_array(rmax, &max_values);
+      call_template_function(region_stats, data.value_type(),
+			     (mc, data, rmax, bounds, contacts, max_points, max_values));
+    }
+
+  size_t nc = contacts.size();
+  int *con;
+  PyObject *cpy = python_int_array(nc, 3, &con);
+  float *cf = NULL;
+  PyObject *cfpy = (py_data == Py_None ? python_none() : python_float_array(nc, 2, &cf));
+  for (size_t c = 0 ; c < nc ; ++c)
+    {
+      Contact &cc = contacts[c];
+      con[3*c] = cc.region1;
+      con[3*c+1] = cc.region2;
+      con[3*c+2] = cc.ncontact;
+      if (cf)
+	{
+	  cf[2*c] = cc.data_max;
+	  cf[2*c+1] = cc.data_sum;
+	}
+    }
+
+  PyObject *t = python_tuple(bpy, cpy, cfpy,
+			     (pts ? pts : python_none()), (vals ? vals : python_none()));
+  return t;
+}
+
 // ----------------------------------------------------------------------------
 // Returns number of regions found.  If data array is not contiguous it will be copied.
 //
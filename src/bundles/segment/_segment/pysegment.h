@@ -40,6 +40,16 @@ extern "C"
 //
 PyObject *watershed_regions(PyObject *, PyObject *args, PyObject *keywds);
 
+// ----------------------------------------------------------------------------
+// Label connected regions of grid points at or above threshold, putting
+// region numbers in region map array and returning the number of regions and
+// region bounds as from region_bounds().
+//
+//   connected_regions(T *data, float threshold, uint32 *region_map)
+//     -> (uint32 region_count, (n+1) x 7 int numpy array)
+//
+PyObject *connected_regions(PyObject *, PyObject *args, PyObject *keywds);
+
 // ----------------------------------------------------------------------------
 // Compute the integer grid indices for each region.
 //
@@ -105,6 +115,20 @@ PyObject *region_points(PyObject *, PyObject *args, PyObject *keywds);
 //     -> (n x 3 numpy int array, length n numpy float array)
 //
 PyObject *region_maxima(PyObject *, PyObject *args, PyObject *keywds);
+
+// ----------------------------------------------------------------------------
+// Compute region bounds, region contacts and, if data is given, interface
+// values and region maxima in a single pass over the region map, the same
+// values as region_bounds(), interface_values() (or region_contacts()) and
+// region_maxima().  Returns a tuple (bounds, contacts, contact_values,
+// max_points, max_values) where contact_values, max_points and max_values
+// are None if no data is given.
+//
+//   region_statistics(uint32 *region_map, T *data = None)
+//     -> (n x 7 int array, nc x 3 int array, nc x 2 float array,
+//         (n-1) x 3 int array, length n-1 float array)
+//
+PyObject *region_statistics(PyObject *, PyObject *args, PyObject *keywds);
   
 // ----------------------------------------------------------------------------
 // Find the local maxima in a 3d data array starting from specified grid points
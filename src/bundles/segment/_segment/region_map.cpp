@@ -1,15 +1,110 @@
 // ----------------------------------------------------------------------------
 //
-#include <utility>		// use std::pair<>
-#include <map>			// use std::map<>
+#include <algorithm>		// use std::min(), std::stable_sort()
+#include <cstdint>		// use uint64_t
+
+#include <arrays/threadpool.h>	// use Thread_Pool::thread_count(), run()
 
 #include "region_map.h"		// use Index
 
 namespace Segment_Map
 {
 
-typedef std::pair<Index, Index> Region_Pair;
-typedef std::map<Region_Pair, Contact> Contact_Map;
+// ----------------------------------------------------------------------------
+//
+inline int thread_count(int64_t work, int64_t min_per_thread)
+{
+  return Thread_Pool::thread_count(work, min_per_thread);
+}
+
+// ----------------------------------------------------------------------------
+// Run f(t) for t = 0 to nt-1 in shared pool threads.  The calling thread does t = 0.
+//
+template <class F>
+void run_threads(int nt, F f)
+{
+  Thread_Pool::run(nt, f);
+}
+
+// ----------------------------------------------------------------------------
+// Accumulate contact counts for region pairs.  Neighboring grid points usually
+// touch the same pair of regions so a new record is only made when the pair
+// changes, and records are merged by sorting when the list has doubled in size.
+//
+class Contact_Accumulator
+{
+public:
+  Contact_Accumulator() : ncompact(0) {}
+  void add(Index r1, Index r2, float d1, float d2)
+  {
+    uint64_t pair = (r1 < r2 ? ((uint64_t)r1 << 32) | r2 : ((uint64_t)r2 << 32) | r1);
+    if (counts.empty() || counts.back().pair != pair)
+      {
+	if (counts.size() >= 2*ncompact + 65536)
+	  compact();
+	counts.push_back(Pair_Count(pair));
+      }
+    Pair_Count &c = counts.back();
+    c.ncontact += 1;
+    c.data_sum += d1 + d2;
+    float d = (d1 > d2 ? d1 : d2);
+    if (d > c.data_max)
+      c.data_max = d;
+  }
+  // Merging keeps sums in the order contacts were added.
+  void merge(const Contact_Accumulator &ca)
+  {
+    counts.insert(counts.end(), ca.counts.begin(), ca.counts.end());
+    compact();
+  }
+  // Contacts are ordered by region pair.
+  void contacts(Contacts &contacts)
+  {
+    compact();
+    contacts.reserve(contacts.size() + counts.size());
+    for (auto &pc: counts)
+      {
+	Contact c;
+	c.region1 = (Index)(pc.pair >> 32);
+	c.region2 = (Index)(pc.pair & 0xffffffff);
+	c.ncontact = pc.ncontact;
+	c.data_max = pc.data_max;
+	c.data_sum = pc.data_sum;
+	contacts.push_back(c);
+      }
+  }
+private:
+  class Pair_Count
+  {
+  public:
+    Pair_Count(uint64_t pair) : pair(pair), ncontact(0), data_max(-1e37), data_sum(0) {}
+    uint64_t pair;
+    unsigned int ncontact;
+    float data_max, data_sum;
+  };
+  std::vector<Pair_Count> counts;
+  size_t ncompact;
+
+  void compact()
+  {
+    std::stable_sort(counts.begin(), counts.end(),
+		     [](const Pair_Count &a, const Pair_Count &b) { return a.pair < b.pair; });
+    size_t n = 0;
+    for (size_t i = 0 ; i < counts.size() ; ++i)
+      if (n > 0 && counts[n-1].pair == counts[i].pair)
+	{
+	  Pair_Count &c = counts[n-1], &ci = counts[i];
+	  c.ncontact += ci.ncontact;
+	  c.data_sum += ci.data_sum;
+	  if (ci.data_max > c.data_max)
+	    c.data_max = ci.data_max;
+	}
+      else
+	counts[n++] = counts[i];
+    counts.erase(counts.begin() + n, counts.end());
+    ncompact = n;
+  }
+};
 
 // ----------------------------------------------------------------------------
 //
@@ -39,35 +134,8 @@ void region_sizes(Index *region_map, const int64_t *region_map_size, Index rmax,
 //
 void region_bounds(Index *region_map, const int64_t *region_map_size, Index rmax, int *bounds)
 {
-  int64_t s0 = region_map_size[0], s1 = region_map_size[1], s2 = region_map_size[2];
-  int64_t st0 = s1*s2, st1 = s2;
-
-  int *b = bounds;
-  for (Index r = 0 ; r <= rmax ; ++r, b += 7)
-    {
-      b[0] = region_map_size[2];
-      b[1] = region_map_size[1];
-      b[2] = region_map_size[0];
-      b[3] = b[4] = b[5] = b[6] = 0;
-    }
-  for (int i0 = 0 ; i0 < s0 ; ++i0)
-    for (int i1 = 0 ; i1 < s1 ; ++i1)
-      for (int i2 = 0 ; i2 < s2 ; ++i2)
-	{
-	  int64_t i = i0*st0 + i1*st1 + i2;
-	  Index r = region_map[i];
-	  if (r <= rmax)
-	    {
-	      int *br = bounds + 7*r;
-	      if (i2 < br[0]) br[0] = i2;
-	      if (i1 < br[1]) br[1] = i1;
-	      if (i0 < br[2]) br[2] = i0;
-	      if (i2 > br[3]) br[3] = i2;
-	      if (i1 > br[4]) br[4] = i1;
-	      if (i0 > br[5]) br[5] = i0;
-	      br[6] += 1;
-	    }
-	}
+  region_statistics(region_map, region_map_size, rmax, (const float *)NULL,
+		    bounds, NULL, NULL, NULL);
 }
 
 // ----------------------------------------------------------------------------
@@ -139,126 +207,175 @@ void region_grid_indices(Index *region_map, const int64_t *region_map_size, int
 
 // ----------------------------------------------------------------------------
 //
-static Contact &add_contact(Index r1, Index r2, Contact_Map &rpmap)
+void region_contacts(Index *region_map, const int64_t *region_map_size, Contacts &contacts)
 {
-  Region_Pair rp = (r1 < r2 ? Region_Pair(r1,r2) : Region_Pair(r2,r1));
-  Contact &c = rpmap[rp];
-  c.region1 = rp.first;
-  c.region2 = rp.second;
-  c.ncontact += 1;
-  return c;
+  region_statistics(region_map, region_map_size, 0, (const float *)NULL,
+		    NULL, &contacts, NULL, NULL);
 }
 
 // ----------------------------------------------------------------------------
 //
-void region_contacts(Index *region_map, const int64_t *region_map_size, Contacts &contacts)
+template <class T>
+void interface_values(Index *region_map, const int64_t *region_map_size, 
+		      const T *data, Contacts &contacts)
 {
-  int64_t s0 = region_map_size[0], s1 = region_map_size[1], s2 = region_map_size[2];
-  int64_t st0 = s1*s2, st1 = s2;
-
-  Contact_Map rpmap;
-  Index r1, r2;
-  for (int i0 = 0 ; i0 < s0 ; ++i0)
-    for (int i1 = 0 ; i1 < s1 ; ++i1)
-      for (int i2 = 0 ; i2 < s2 ; ++i2)
-	{
-	  int64_t i = i0*st0 + i1*st1 + i2;
-	  r1 = region_map[i];
-	  if (r1 > 0)
-	    {
-	      if (i2+1 < s2 && (r2 = region_map[i+1]) > 0 && r2 != r1)
-		add_contact(r1, r2, rpmap);
-	      if (i1+1 < s1 && (r2 = region_map[i+st1]) > 0 && r2 != r1)
-		add_contact(r1, r2, rpmap);
-	      if (i0+1 < s0 && (r2 = region_map[i+st0]) > 0 && r2 != r1)
-		add_contact(r1, r2, rpmap);
-	    }
-	}
-
-  for (Contact_Map::iterator c = rpmap.begin() ; c != rpmap.end() ; ++c)
-    contacts.push_back(c->second);
+  region_statistics(region_map, region_map_size, 0, data, NULL, &contacts, NULL, NULL);
 }
 
 // ----------------------------------------------------------------------------
 //
-static Contact &add_contact(Index r1, Index r2, float d1, float d2,
-			    Contact_Map &rpmap)
+template <class T>
+void region_maxima(Index *region_map, const int64_t *region_map_size, const T *data,
+		   Index nmax, int *max_points, float *max_values)
 {
-  Region_Pair rp = (r1 < r2 ? Region_Pair(r1,r2) : Region_Pair(r2,r1));
-  Contact &c = rpmap[rp];
-  c.region1 = rp.first;
-  c.region2 = rp.second;
-  c.ncontact += 1;
-  c.data_sum += d1 + d2;
-  float d = (d1 > d2 ? d1 : d2);
-  if (d > c.data_max)
-    c.data_max = d;
-  return c;
+  region_statistics(region_map, region_map_size, nmax, data, NULL, NULL,
+		    max_points, max_values);
 }
 
 // ----------------------------------------------------------------------------
+// Statistics for planes i0start to i0end.  Bounds, maxima and contacts are
+// only computed if their arrays are not NULL, and need data for maxima.
 //
 template <class T>
-void interface_values(Index *region_map, const int64_t *region_map_size, 
-		      const T *data, Contacts &contacts)
+void slab_statistics(Index *region_map, const int64_t *region_map_size,
+		     int i0start, int i0end, Index rmax, const T *data, int *bounds,
+		     Contact_Accumulator *contacts, int *max_points, float *max_values)
 {
   int64_t s0 = region_map_size[0], s1 = region_map_size[1], s2 = region_map_size[2];
   int64_t st0 = s1*s2, st1 = s2;
 
-  Contact_Map rpmap;
+  if (bounds)
+    {
+      int *b = bounds;
+      for (Index r = 0 ; r <= rmax ; ++r, b += 7)
+	{
+	  b[0] = region_map_size[2];
+	  b[1] = region_map_size[1];
+	  b[2] = region_map_size[0];
+	  b[3] = b[4] = b[5] = b[6] = 0;
+	}
+    }
+  if (max_values)
+    for (Index p = 0 ; p < rmax ; ++p)
+      max_values[p] = -1e37;
+
   Index r1, r2;
-  float d;
-  for (int i0 = 0 ; i0 < s0 ; ++i0)
+  float d = 0;
+  for (int i0 = i0start ; i0 < i0end ; ++i0)
     for (int i1 = 0 ; i1 < s1 ; ++i1)
       for (int i2 = 0 ; i2 < s2 ; ++i2)
 	{
 	  int64_t i = i0*st0 + i1*st1 + i2;
 	  r1 = region_map[i];
-	  if (r1 > 0)
+	  if (bounds && r1 <= rmax)
+	    {
+	      int *br = bounds + 7*r1;
+	      if (i2 < br[0]) br[0] = i2;
+	      if (i1 < br[1]) br[1] = i1;
+	      if (i0 < br[2]) br[2] = i0;
+	      if (i2 > br[3]) br[3] = i2;
+	      if (i1 > br[4]) br[4] = i1;
+	      if (i0 > br[5]) br[5] = i0;
+	      br[6] += 1;
+	    }
+	  if (r1 == 0)
+	    continue;
+	  if (data)
+	    d = data[i];
+	  if (max_values && r1 <= rmax && d > max_values[r1-1])
+	    {
+	      max_values[r1-1] = d;
+	      int *p = &max_points[3*(int64_t)(r1-1)];
+	      p[0] = i2; p[1] = i1; p[2] = i0;
+	    }
+	  if (contacts)
 	    {
-	      d = data[i];
 	      if (i2+1 < s2 && (r2 = region_map[i+1]) > 0 && r2 != r1)
-		add_contact(r1, r2, d, (float)data[i+1], rpmap);
+		contacts->add(r1, r2, d, (data ? (float)data[i+1] : 0));
 	      if (i1+1 < s1 && (r2 = region_map[i+st1]) > 0 && r2 != r1)
-		add_contact(r1, r2, d, (float)data[i+st1], rpmap);
+		contacts->add(r1, r2, d, (data ? (float)data[i+st1] : 0));
 	      if (i0+1 < s0 && (r2 = region_map[i+st0]) > 0 && r2 != r1)
-		add_contact(r1, r2, d, (float)data[i+st0], rpmap);
+		contacts->add(r1, r2, d, (data ? (float)data[i+st0] : 0));
 	    }
 	}
-
-  for (Contact_Map::iterator c = rpmap.begin() ; c != rpmap.end() ; ++c)
-    contacts.push_back(c->second);
 }
 
 // ----------------------------------------------------------------------------
+// Compute region bounds, region pair contacts and region maxima in one pass.
+// Slabs of planes are done in parallel, each with its own bounds, maxima and
+// contacts which are then combined.  Maxima use the first grid point in scan
+// order attaining the maximum value as when computed serially.
 //
 template <class T>
-void region_maxima(Index *region_map, const int64_t *region_map_size, const T *data,
-		   Index nmax, int *max_points, float *max_values)
+void region_statistics(Index *region_map, const int64_t *region_map_size, Index rmax,
+		       const T *data, int *bounds, Contacts *contacts,
+		       int *max_points, float *max_values)
 {
-  int64_t s0 = region_map_size[0], s1 = region_map_size[1], s2 = region_map_size[2];
-  int64_t st0 = s1*s2, st1 = s2;
+  if (data == NULL)
+    max_points = NULL, max_values = NULL;
 
-  for (Index p = 0 ; p < nmax ; ++p)
-    max_values[p] = -1e37;
+  int s0 = region_map_size[0];
+  int64_t size = (int64_t)region_map_size[0] * region_map_size[1] * region_map_size[2];
+  int64_t per_region = ((bounds || max_values) ? 8*(int64_t)rmax : 0);
+  int nt = std::min(thread_count(size, std::max((int64_t)1000000, per_region)), s0);
+  if (nt < 1)
+    nt = 1;
 
-  for (int i0 = 0 ; i0 < s0 ; ++i0)
-    for (int i1 = 0 ; i1 < s1 ; ++i1)
-      for (int i2 = 0 ; i2 < s2 ; ++i2)
+  std::vector<std::vector<int> > tbounds(nt), tmax_points(nt);
+  std::vector<std::vector<float> > tmax_values(nt);
+  std::vector<Contact_Accumulator> tcontacts(nt);
+  run_threads(nt, [&](int t) {
+      int *b = bounds, *mp = max_points;
+      float *mv = max_values;
+      if (t > 0)
 	{
-	  int64_t i = i0*st0 + i1*st1 + i2;
-	  Index r1 = region_map[i];
-	  if (r1 > 0 && r1 <= nmax)
+	  if (bounds)
+	    { tbounds[t].resize(7*((int64_t)rmax+1)); b = tbounds[t].data(); }
+	  if (max_values)
 	    {
-	      float d = data[i];
-	      if (d > max_values[r1-1])
-		{
-		  max_values[r1-1] = d;
-		  int *p = &max_points[3*(int64_t)(r1-1)];
-		  p[0] = i2; p[1] = i1; p[2] = i0;
-		}
+	      tmax_points[t].resize(3*(int64_t)rmax); mp = tmax_points[t].data();
+	      tmax_values[t].resize(rmax); mv = tmax_values[t].data();
 	    }
 	}
+      int i0start = (int)(((int64_t)s0*t)/nt), i0end = (int)(((int64_t)s0*(t+1))/nt);
+      slab_statistics(region_map, region_map_size, i0start, i0end, rmax, data, b,
+		      (contacts ? &tcontacts[t] : NULL), mp, mv);
+    });
+
+  for (int t = 1 ; t < nt ; ++t)
+    {
+      if (bounds)
+	{
+	  const int *tb = tbounds[t].data();
+	  int *b = bounds;
+	  for (Index r = 0 ; r <= rmax ; ++r, b += 7, tb += 7)
+	    if (tb[6] > 0)
+	      {
+		for (int a = 0 ; a < 3 ; ++a)
+		  {
+		    if (tb[a] < b[a]) b[a] = tb[a];
+		    if (tb[a+3] > b[a+3]) b[a+3] = tb[a+3];
+		  }
+		b[6] += tb[6];
+	      }
+	}
+      if (max_values)
+	{
+	  const float *tv = tmax_values[t].data();
+	  const int *tp = tmax_points[t].data();
+	  for (Index r = 0 ; r < rmax ; ++r)
+	    if (tv[r] > max_values[r])
+	      {
+		max_values[r] = tv[r];
+		for (int a = 0 ; a < 3 ; ++a)
+		  max_points[3*(int64_t)r+a] = tp[3*(int64_t)r+a];
+	      }
+	}
+      if (contacts)
+	tcontacts[0].merge(tcontacts[t]);
+    }
+  if (contacts)
+    tcontacts[0].contacts(*contacts);
 }
 
 } // end of namespace Segment_Map
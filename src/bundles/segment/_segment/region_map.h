@@ -43,6 +43,19 @@ template <class T>
 void region_maxima(Index *region_map, const int64_t *region_map_size, const T *data,
 		   Index nmax, int *max_points, float *max_values);
 
+//
+// Compute any of region bounds (rmax+1 rows of 7 values), region contacts and
+// region maxima (rmax rows, needs data) in a single pass over the region map.
+// Arguments that are NULL are not computed.
+//
+template <class T>
+void region_statistics(Index *region_map, const int64_t *region_map_size, Index rmax,
+		       const T *data, int *bounds, Contacts *contacts,
+		       int *max_points, float *max_values);
+
+inline int thread_count(int64_t work, int64_t min_per_thread);
+template <class F> void run_threads(int nt, F f);
+
 } // end of namespace Segment_Map
 
 #include "region_map.cpp"		// Need template definitions
@@ -62,6 +62,33 @@ region_count : uint32
 )"
   },
   
+  {const_cast<char*>("connected_regions"),
+   (PyCFunction)connected_regions,
+   METH_VARARGS|METH_KEYWORDS,
+   R"(
+connected_regions(data, threshold, region_map)
+
+Label connected regions of grid points with data value at or above threshold,
+using 6 neighbor connectivity, with a single parallel pass over the map
+instead of repeated flood fills.  Region numbers start at 1 in order of the
+first grid point of each region, and points below threshold are 0.  Also
+returns the bounds and point counts for each region as from region_bounds().
+Implemented in C++.
+
+Parameters
+----------
+data : 3D array, any scalar type
+threshold : float
+region_map : 3d array, uint32
+  This array will be filled in with region index values for each connected region.
+
+Returns
+-------
+region_count : uint32
+bounds : region_count+1 x 7 array of int
+)"
+  },
+  
   {const_cast<char*>("region_index_lists"),
    (PyCFunction)region_index_lists,
    METH_VARARGS|METH_KEYWORDS,
@@ -217,6 +244,35 @@ max_values : length n array of float
 )"
   },
   
+  {const_cast<char*>("region_statistics"),
+   (PyCFunction)region_statistics,
+   METH_VARARGS|METH_KEYWORDS,
+   R"(
+region_statistics(region_map, data = None)
+
+Compute region bounds, region contacts and, if data is given, interface
+values and region maxima in a single pass over the region map, the same
+values as region_bounds(), interface_values() (or region_contacts()) and
+region_maxima().  Returns a tuple (bounds, contacts, contact_values,
+max_points, max_values) where contact_values, max_points and max_values
+are None if no data is given.
+Implemented in C++.
+
+Parameters
+----------
+region_map : 3d array, uint32
+data : 3d array, any scalar type, or None
+
+Returns
+-------
+bounds : n x 7 array of int
+contacts : nc x 3 array of int
+contact_values : nc x 2 array of float, or None
+max_points : n-1 x 3 array of int, or None
+max_values : length n-1 array of float, or None
+)"
+  },
+  
   {const_cast<char*>("find_local_maxima"),
    (PyCFunction)find_local_maxima,
    METH_VARARGS|METH_KEYWORDS,
@@ -302,12 +358,14 @@ triangles : m x 3 array of int
    (PyCFunction)segmentation_surfaces,
    METH_VARARGS|METH_KEYWORDS,
    R"(
-segmentation_surfaces(region_map [, groups])
+segmentation_surfaces(region_map [, groups, packed])
 
 Calculate surface vertices and triangles for several regions of region_map.
 The region map must have integer values.  A surfce is made for each region
 integer value.  If the groups array is given it maps region index values to
-group index values and a surface is made for each group index.
+group index values and a surface is made for each group index.  All regions
+are found in one pass over the region map and their surfaces are computed
+in parallel threads.
 Implemented in C++.
 
 Parameters
@@ -315,10 +373,16 @@ Parameters
 region_map : 3d array, uint32
 groups : 1d array of int
   This array maps the region index to a surface id allowing multiple regions to form one surface.
+packed : bool
+  Return all surfaces in single arrays instead of a list of surfaces.
 
 Returns
 -------
 surfaces : list of 3-tuples (int index, vertices n x 3 array of float, triangles m x 3 array of int)
+  If packed is true returns 5-tuple (ids, vertices, triangles, vertex_counts, triangle_counts)
+  with 1d int arrays of surface ids and vertex and triangle counts for each surface.
+  The triangles index the combined vertex array, and each surface's vertices and
+  triangles follow those of the previous surface.
 )"
   },
 
@@ -29,13 +29,15 @@
 //
 #include <math.h>		// use sqrt()
 #include <Python.h>			// use PyObject
-#include <map>
+#include <algorithm>			// use std::stable_sort, std::inplace_merge
+#include <atomic>			// use std::atomic
 #include <vector>
 
 #include <iostream>			// use std:cerr for debugging
 
 #include <arrays/pythonarray.h>		// use array_from_python()
 #include <arrays/rcarray.h>		// use call_template_function()
+#include <arrays/threadpool.h>		// use Thread_Pool::thread_count(), run()
 
 // ----------------------------------------------------------------------------
 // A cube has 8 vertices and 12 edges.  These are numbered 0 to 7 and
@@ -786,8 +788,16 @@ public:
   unsigned char neighbors, boundary;  // 6 bits for -x,+x,-y,+y,-z,+z directions surface cut or box boundary.
 };
 
-typedef std::vector<Region_Point> Region_Points;
-typedef std::map<Region_Id, Region_Points> Points_Per_Region;
+typedef std::pair<Region_Id, Region_Point> Region_Id_Point;
+typedef std::vector<Region_Id_Point> Region_Points;	// Sorted by region id
+
+// ----------------------------------------------------------------------------
+// Number of threads for a task, at most one per min_per_thread work units.
+//
+inline int thread_count(int64_t work, int64_t min_per_thread)
+{
+  return Thread_Pool::thread_count(work, min_per_thread);
+}
 
 // ----------------------------------------------------------------------------
 //
@@ -828,10 +838,14 @@ private:
   void make_triangles(Grid_Cell_List &gp0, Index k2, Region_Id region_id);
 
   // Methods for computing multiple surfaces.
-  void find_region_group_points(Points_Per_Region &region_points);
-  void find_region_points(Points_Per_Region &region_points);
+  void find_region_points(Region_Points &region_points);
+  void find_region_group_points(Index k2_start, Index k2_end, Region_Points &region_points);
+  void find_region_points(Index k2_start, Index k2_end, Region_Points &region_points);
+  void compute_region_surface(const Region_Id_Point *p, const Region_Id_Point *pend,
+			      Grid_Cell_List &gcp0, Grid_Cell_List &gcp1);
   void mark_point_edge_cuts(const Region_Point &rp, Grid_Cell_List &gp0, Grid_Cell_List &gp1);
   void new_surface(int region_id);
+  void set_surface(Region_Surface &s) { vxyz = &s.vertices; tvi = &s.triangles; }
 
   void add_vertex_axis_0(Index k0, Index k1, Index k2, float x0,
 			 Grid_Cell_List &gp0, Grid_Cell_List &gp1);
@@ -896,50 +910,86 @@ void CSurface<Data_Type>::compute_surface()
 }
 
 // ----------------------------------------------------------------------------
+// All region boundary points are found in one sweep of the grid, split into
+// slabs of z planes over threads.  Then the regions are divided among threads
+// each with its own grid cell lists, writing into separate surfaces.
 //
 template <class Data_Type>
 void CSurface<Data_Type>::compute_surfaces()
 {
-  Region_Surfaces surfs;
-  Points_Per_Region region_points;
-  if (inside.all() && inside.groups())
-    find_region_group_points(region_points);
-  else
-    find_region_points(region_points);
+  Region_Points region_points;
+  find_region_points(region_points);
   //  std::cerr << "find_region_points() " <<  time << std::endl;
-  Grid_Cell_List gcp0(size[0]-1, size[1]-1), gcp1(size[0]-1, size[1]-1);
-  for (auto rp = region_points.begin() ; rp != region_points.end() ; ++rp)
+
+  // Index of first point for each region.
+  std::vector<size_t> rstart;
+  size_t np = region_points.size();
+  for (size_t i = 0 ; i < np ; ++i)
+    if (i == 0 || region_points[i].first != region_points[i-1].first)
+      rstart.push_back(i);
+  size_t nr = rstart.size();
+  rstart.push_back(np);
+
+  surfs.clear();
+  surfs.reserve(nr);
+  for (size_t r = 0 ; r < nr ; ++r)
+    surfs.push_back(Region_Surface(region_points[rstart[r]].first));
+
+  const Region_Id_Point *points = region_points.data();
+  std::atomic<size_t> next_region(0);
+  auto compute = [&]() {
+    CSurface<Data_Type> cs(grid, size, stride, inside, cap_faces);
+    Grid_Cell_List gcp0(size[0]-1, size[1]-1), gcp1(size[0]-1, size[1]-1);
+    for (size_t r = next_region++ ; r < nr ; r = next_region++)
+      {
+	cs.set_surface(surfs[r]);
+	cs.compute_region_surface(points + rstart[r], points + rstart[r+1], gcp0, gcp1);
+      }
+  };
+
+  int nt = std::min(thread_count(np, 10000), static_cast<int>(std::min(nr, (size_t)1024)));
+  Thread_Pool::run(nt, [&](int) { compute(); });
+}
+
+// ----------------------------------------------------------------------------
+// Boundary points for one region in the order they were found by scanning.
+//
+template <class Data_Type>
+void CSurface<Data_Type>::compute_region_surface(const Region_Id_Point *p,
+						 const Region_Id_Point *pend,
+						 Grid_Cell_List &gcp0,
+						 Grid_Cell_List &gcp1)
+{
+  if (p == pend)
+    return;
+  Region_Id rid = p->first;
+  Index i2 = 0;
+  Grid_Cell_List *gp0 = &gcp0, *gp1 = &gcp1;
+  for ( ; p != pend ; ++p)
     {
-      Region_Id rid = rp->first;
-      new_surface(rid);
-      Region_Points &rpoints = rp->second;
-      Index i2 = 0;
-      Grid_Cell_List *gp0 = &gcp0, *gp1 = &gcp1;
-      for (auto p = rpoints.begin() ; p != rpoints.end() ; ++p)
-	{
-	  if (p->i2 > i2)
-	    {
-	      if (i2 > 0)
-		make_triangles(*gp0, i2, rid);	// Create triangles for cell plane.
-	      gp0->finished_plane();
-	      if (p->i2 > i2+1)
-		gp1->finished_plane();
-	      i2 = p->i2;
-	      gp0 = (i2%2 ? &gcp1 : &gcp0);
-	      gp1 = (i2%2 ? &gcp0 : &gcp1);
-	    }
-	  mark_point_edge_cuts(*p, *gp0, *gp1);
-	}
-      if (i2 > 0)
+      const Region_Point &rp = p->second;
+      if (rp.i2 > i2)
 	{
-	  // Create triangles for last planes
-	  make_triangles(*gp0, i2, rid);	
-	  if (i2+1 < size[2])
-	    make_triangles(*gp1, i2+1, rid);
+	  if (i2 > 0)
+	    make_triangles(*gp0, i2, rid);	// Create triangles for cell plane.
+	  gp0->finished_plane();
+	  if (rp.i2 > i2+1)
+	    gp1->finished_plane();
+	  i2 = rp.i2;
+	  gp0 = (i2%2 ? &gcp1 : &gcp0);
+	  gp1 = (i2%2 ? &gcp0 : &gcp1);
 	}
-      gp0->finished_plane();
-      gp1->finished_plane();
+      mark_point_edge_cuts(rp, *gp0, *gp1);
     }
+  if (i2 > 0)
+    {
+      // Create triangles for last planes
+      make_triangles(*gp0, i2, rid);	
+      if (i2+1 < size[2])
+	make_triangles(*gp1, i2+1, rid);
+    }
+  gp0->finished_plane();
+  gp1->finished_plane();
 }
 
 // ----------------------------------------------------------------------------
@@ -948,25 +998,62 @@ template <class Data_Type>
 void CSurface<Data_Type>::new_surface(int region_id)
 {
   surfs.push_back(Region_Surface(region_id));
-  Region_Surface &s = surfs[surfs.size()-1];
-  vxyz = &s.vertices;
-  tvi = &s.triangles;
+  set_surface(surfs[surfs.size()-1]);
+}
+
+// ----------------------------------------------------------------------------
+// Find boundary points of all regions, grouped by region id and in scan order
+// within each region.  Each thread scans a slab of z planes and sorts its
+// points by region, then the sorted slabs are merged in slab order.
+//
+template <class Data_Type>
+void CSurface<Data_Type>::find_region_points(Region_Points &region_points)
+{
+  int nt = std::min(thread_count((int64_t)size[0]*size[1]*size[2], 1000000),
+		    static_cast<int>(size[2]));
+  std::vector<Region_Points> slab_points(nt);
+  auto find_points = [this, nt, &slab_points](int t) {
+    Index k2_start = (Index)(((int64_t)size[2]*t)/nt), k2_end = (Index)(((int64_t)size[2]*(t+1))/nt);
+    Region_Points &points = slab_points[t];
+    if (inside.all() && inside.groups())
+      find_region_group_points(k2_start, k2_end, points);
+    else
+      find_region_points(k2_start, k2_end, points);
+    std::stable_sort(points.begin(), points.end(),
+		     [](const Region_Id_Point &a, const Region_Id_Point &b)
+		     { return a.first < b.first; });
+  };
+  Thread_Pool::run(nt, find_points);
+
+  size_t np = 0;
+  for (int t = 0 ; t < nt ; ++t)
+    np += slab_points[t].size();
+  region_points.clear();
+  region_points.reserve(np);
+  for (int t = 0 ; t < nt ; ++t)
+    {
+      size_t mid = region_points.size();
+      region_points.insert(region_points.end(), slab_points[t].begin(), slab_points[t].end());
+      Region_Points().swap(slab_points[t]);
+      std::inplace_merge(region_points.begin(), region_points.begin() + mid, region_points.end(),
+			 [](const Region_Id_Point &a, const Region_Id_Point &b)
+			 { return a.first < b.first; });
+    }
 }
 
 // ----------------------------------------------------------------------------
 //
 template <class Data_Type>
-void CSurface<Data_Type>::find_region_group_points(Points_Per_Region &region_points)
+void CSurface<Data_Type>::find_region_group_points(Index k2_start, Index k2_end,
+						   Region_Points &region_points)
 {
   // Optimize group id array lookup.
   // The inside() method is 15% slower even when inlined.
 
   Index k0_size = size[0], k1_size = size[1], k2_size = size[2];
   Stride step0 = stride[0], step1 = stride[1], step2 = stride[2];
-  Region_Points *rpoints;
-  Region_Id last_region_id = -1;
   const int *group_ids = inside.groups();
-  for (Index k2 = 0 ; k2 < k2_size ; ++k2)
+  for (Index k2 = k2_start ; k2 < k2_end ; ++k2)
 	for (Index k1 = 0 ; k1 < k1_size ; ++k1)
 	  {
 	    const Data_Type *g = grid + step2*(Stride)k2 + step1*(Stride)k1;
@@ -986,15 +1073,7 @@ void CSurface<Data_Type>::find_region_group_points(Points_Per_Region &region_poi
 				   (!(b & 16) && group_ids[(int)*(g-step2)] != region_id ? 16 : 0) |
 				   (!(b & 32) && group_ids[(int)g[step2]] != region_id ? 32 : 0));
 		    if (b || n)
-		      {
-			if (region_id != last_region_id)
-			  {
-			    // Use last region lookup when possible to avoid time consuming map lookup.
-			    rpoints = &region_points[region_id];
-			    last_region_id = region_id;
-			  }
-			rpoints->push_back(Region_Point(k0,k1,k2,n,b));
-		      }
+		      region_points.push_back(Region_Id_Point(region_id, Region_Point(k0,k1,k2,n,b)));
 		  }
 	      }
 	  }
@@ -1003,15 +1082,14 @@ void CSurface<Data_Type>::find_region_group_points(Points_Per_Region &region_poi
 // ----------------------------------------------------------------------------
 //
 template <class Data_Type>
-void CSurface<Data_Type>::find_region_points(Points_Per_Region &region_points)
+void CSurface<Data_Type>::find_region_points(Index k2_start, Index k2_end,
+					     Region_Points &region_points)
 {
   //  auto begin = std::chrono::high_resolution_clock::now();
   Index k0_size = size[0], k1_size = size[1], k2_size = size[2];
   Stride step0 = stride[0], step1 = stride[1], step2 = stride[2];
-  Region_Points *rpoints;
-  Region_Id last_region_id = -1;
 
-  for (Index k2 = 0 ; k2 < k2_size ; ++k2)
+  for (Index k2 = k2_start ; k2 < k2_end ; ++k2)
     for (Index k1 = 0 ; k1 < k1_size ; ++k1)
 	  {
 	    const Data_Type *g = grid + step2*(Stride)k2 + step1*(Stride)k1;
@@ -1030,15 +1108,7 @@ void CSurface<Data_Type>::find_region_points(Points_Per_Region &region_points)
 				       (!(b & 16) && inside(*(g-step2)) != region_id ? 16 : 0) |
 				       (!(b & 32) && inside(g[step2]) != region_id ? 32 : 0));
 		    if (b || n)
-		      {
-			if (region_id != last_region_id)
-			  {
-			    // Use last region lookup when possible to avoid time consuming map lookup.
-			    rpoints = &region_points[region_id];
-			    last_region_id = region_id;
-			  }
-			rpoints->push_back(Region_Point(k0,k1,k2,n,b));
-		      }
+		      region_points.push_back(Region_Id_Point(region_id, Region_Point(k0,k1,k2,n,b)));
 		  }
 	      }
 	  }
@@ -1527,6 +1597,44 @@ static PyObject *python_surface(const Region_Surface &surf, bool include_id = fa
   return py_surf;
 }
 
+// ----------------------------------------------------------------------------
+// All surfaces in single arrays.  Triangles index the combined vertex array.
+//
+static PyObject *python_packed_surfaces(const Region_Surfaces &surfs)
+{
+  size_t ns = surfs.size(), nv = 0, nt = 0;
+  for (size_t i = 0 ; i < ns ; ++i)
+    {
+      nv += surfs[i].vertices.size()/3;
+      nt += surfs[i].triangles.size()/3;
+    }
+
+  int *ids, *vcounts, *tcounts, *tvi;
+  float *vxyz;
+  PyObject *py_ids = python_int_array(ns, &ids);
+  PyObject *vertex_xyz = python_float_array(nv, 3, &vxyz);
+  PyObject *tv_indices = python_int_array(nt, 3, &tvi);
+  PyObject *vertex_counts = python_int_array(ns, &vcounts);
+  PyObject *triangle_counts = python_int_array(ns, &tcounts);
+
+  Index voffset = 0;
+  for (size_t i = 0 ; i < ns ; ++i)
+    {
+      const Region_Surface &s = surfs[i];
+      ids[i] = s.region_id;
+      size_t nv3 = s.vertices.size(), nt3 = s.triangles.size();
+      for (size_t j = 0 ; j < nv3 ; ++j)
+	*vxyz++ = s.vertices[j];
+      for (size_t j = 0 ; j < nt3 ; ++j)
+	*tvi++ = s.triangles[j] + voffset;
+      vcounts[i] = nv3/3;
+      tcounts[i] = nt3/3;
+      voffset += nv3/3;
+    }
+
+  return python_tuple(py_ids, vertex_xyz, tv_indices, vertex_counts, triangle_counts);
+}
+
 // ----------------------------------------------------------------------------
 //
 extern "C" PyObject *
@@ -1584,11 +1692,13 @@ segmentation_surfaces(PyObject *, PyObject *args, PyObject *keywds)
 {
   Numeric_Array region_map;
   IArray groups;
-  const char *kwlist[] = {"region_map", "groups", NULL};
-  if (!PyArg_ParseTupleAndKeywords(args, keywds, const_cast<char *>("O&|O&"),
+  int packed = 0;
+  const char *kwlist[] = {"region_map", "groups", "packed", NULL};
+  if (!PyArg_ParseTupleAndKeywords(args, keywds, const_cast<char *>("O&|O&p"),
 				   (char **)kwlist,
 				   parse_3d_array, &region_map,
-				   parse_int_n_array, &groups))
+				   parse_int_n_array, &groups,
+				   &packed))
     return NULL;
 
   if (groups.dimension() == 1 && !groups.is_contiguous())
@@ -1609,11 +1719,18 @@ segmentation_surfaces(PyObject *, PyObject *args, PyObject *keywds)
       Py_END_ALLOW_THREADS
 
       const Region_Surfaces &surfaces = cs->surfaces();
-      size_t ns = surfaces.size();
-      surfs = PyTuple_New(ns);
-      for (size_t i = 0 ; i < ns ; ++i)
-	PyTuple_SetItem(surfs, i, python_surface(surfaces[i], true));
+      if (packed)
+	surfs = python_packed_surfaces(surfaces);
+      else
+	{
+	  size_t ns = surfaces.size();
+	  surfs = PyTuple_New(ns);
+	  for (size_t i = 0 ; i < ns ; ++i)
+	    PyTuple_SetItem(surfs, i, python_surface(surfaces[i], true));
+	}
+      Py_BEGIN_ALLOW_THREADS
       delete cs;
+      Py_END_ALLOW_THREADS
     }
   catch (std::bad_alloc&)
     {
@@ -22,6 +22,8 @@ extern "C" PyObject *segmentation_surface(PyObject *, PyObject *args, PyObject *
 // group index values and a surface is made for each group index.
 //
 // segmentation_surfaces(region_map[, groups]) -> list of (region_or_group_id, vertices, triangles)
+// segmentation_surfaces(region_map[, groups], packed = True)
+//   -> (region_or_group_ids, vertices, triangles, vertex_counts, triangle_counts)
 //
 extern "C" PyObject *segmentation_surfaces(PyObject *, PyObject *args, PyObject *keywds);
 
@@ -2,24 +2,30 @@
 // Find regions consisting of grid points which reach the same local maximum
 // following a steepest ascent walk.
 //
+#include <algorithm>		// use std::min()
+#include <vector>		// use std::vector
+
 #include "watershed.h"
 
 namespace Segment_Map
 {
 
 // ----------------------------------------------------------------------------
-// Returns number of regions found.
-// Arrays are 3-dimensional, last axis varies fastest.
+// Set region_map to index of highest of 26 neighbors for planes i0start to i0end.
 //
 template <class T>
-Index watershed_regions(const T *data, const int64_t *sizes,
-			float threshold, Index *region_map)
+void steepest_neighbors(const T *data, const int64_t *sizes, float threshold,
+			int i0start, int i0end, Index *region_map)
 {
   int s0 = sizes[0], s1 = sizes[1], s2 = sizes[2];
-  Index st0 = s1*s2, st1 = s2, s = s0*s1*s2;
+  Index st0 = s1*s2, st1 = s2;
+
+  for (int i0 = i0start ; i0 < i0end ; ++i0)
 
-  // Set region_map to index of highest of 26 neighbors.
-  for (int i0 = 0 ; i0 < s0 ; ++i0)
+// ----------------------------------------------------------------------------
+// Returns number of regions found.
+// Arrays are 3-dimensional, last axis varies fastest.
+//
     {
       int j0min = (i0 > 0 ? -1 : 0), j0max = (i0+1 < s0 ? 1 : 0);
       for (int i1 = 0 ; i1 < s1 ; ++i1)
@@ -49,18 +55,87 @@ Index watershed_regions(const T *data, const int64_t *sizes,
 	    }
 	}
     }
-  // TODO: Handle plateaus by reconnecting neighbor chains.
+}
 
-  // Collapse index chains.
-  for (Index i = 0 ; i < s ; ++i)
+// ----------------------------------------------------------------------------
+// Collapse index chains for grid points from index i0 to i1, stopping when a
+// chain leaves that range.  The points are then left pointing to a maximum, or
+// to the first point outside the range.
+//
+inline void collapse_chains(Index i0, Index i1, Index *region_map)
+{
+  for (Index i = i0 ; i < i1 ; ++i)
     if (region_map[i] > 0)
       {
 	Index ni = i;
-	while (region_map[ni] != ni)
+	while (ni >= i0 && ni < i1 && region_map[ni] != ni)
 	  ni = region_map[ni];
 	for (Index ci = i, cni ; (cni = region_map[ci]) != ni ; ci = cni)
 	  region_map[ci] = ni;
       }
+}
+
+// ----------------------------------------------------------------------------
+// Returns number of regions found.
+// Arrays are 3-dimensional, last axis varies fastest.
+//
+// The steepest ascent neighbors and the chain collapsing are computed in
+// parallel for slabs of planes.  Chains that leave a slab must step into
+// the first or last plane of an adjacent slab (or to grid point 0 which
+// marks a point below threshold), so those boundary planes are fully
+// collapsed serially, then each slab points its other chains through them.
+//
+template <class T>
+Index watershed_regions(const T *data, const int64_t *sizes,
+			float threshold, Index *region_map)
+{
+  int s0 = sizes[0], s1 = sizes[1], s2 = sizes[2];
+  Index st0 = s1*s2, s = s0*s1*s2;
+
+  int nt = std::min(thread_count((int64_t)s0*s1*s2, 1000000), s0/8);
+  if (nt < 1)
+    nt = 1;
+  std::vector<int> slab_start(nt+1);
+  for (int t = 0 ; t <= nt ; ++t)
+    slab_start[t] = (int)(((int64_t)s0*t)/nt);
+
+  run_threads(nt, [&](int t) {
+      Index i0 = slab_start[t]*st0, i1 = slab_start[t+1]*st0;
+      steepest_neighbors(data, sizes, threshold, slab_start[t], slab_start[t+1], region_map);
+      // TODO: Handle plateaus by reconnecting neighbor chains.
+      collapse_chains(i0, i1, region_map);
+    });
+
+  if (nt > 1)
+    {
+      // Collapse chains starting in the first and last plane of each slab.
+      for (int t = 0 ; t < nt ; ++t)
+	for (int p = 0 ; p < 2 ; ++p)
+	  {
+	    Index pi = (p == 0 ? slab_start[t] : slab_start[t+1]-1)*st0;
+	    for (Index i = pi ; i < pi + st0 ; ++i)
+	      if (region_map[i] > 0)
+		{
+		  Index ni = i;
+		  while (region_map[ni] != ni)
+		    ni = region_map[ni];
+		  region_map[i] = ni;
+		}
+	    if (slab_start[t+1]-1 == slab_start[t])
+	      break;
+	  }
+
+      // Point chains leaving a slab to the maximum reached by the boundary plane.
+      run_threads(nt, [&](int t) {
+	  Index i0 = slab_start[t]*st0, i1 = slab_start[t+1]*st0;
+	  for (Index i = i0 + st0 ; i + st0 < i1 ; ++i)
+	    {
+	      Index ni = region_map[i];
+	      if (ni > 0 && (ni < i0 || ni >= i1))
+		region_map[i] = region_map[ni];
+	    }
+	});
+    }
 
   // Renumber regions starting from 1.
   // This is a somewhat tricky algorithm that avoids using a flag bit.
@@ -82,6 +82,18 @@
 #     -> (n x 3 numpy int array, length n numpy float array)
 #
 # ----------------------------------------------------------------------------
+# Compute region bounds, region contacts and, if data is given, interface
+# values and region maxima in a single pass over the region map, the same
+# values as region_bounds(), interface_values() (or region_contacts()) and
+# region_maxima().  Returns a tuple (bounds, contacts, contact_values,
+# max_points, max_values) where contact_values, max_points and max_values
+# are None if no data is given.
+#
+#   region_statistics(uint32 *region_map, T *data = None)
+#     -> (n x 7 int array, nc x 3 int array, nc x 2 float array,
+#         (n-1) x 3 int array, length n-1 float array)
+#
+# ----------------------------------------------------------------------------
 # Find the local maxima in a 3d data array starting from specified grid points
 # by travelling a steepest ascent path.  The starting points array (numpy nx3 int)
 # is modified to have the grid point position of the maxima for each starting
@@ -108,6 +120,7 @@ import chimerax.arrays
 
 from ._segment import watershed_regions, region_index_lists, region_contacts, region_bounds
 from ._segment import region_point_count, region_points, region_maxima, interface_values
+from ._segment import region_statistics
 from ._segment import find_local_maxima, crosssection_midpoints
 
 # ----------------------------------------------------------------------------
@@ -124,6 +137,8 @@ from ._segment import find_local_maxima, crosssection_midpoints
 # group index values and a surface is made for each group index.
 #
 # segmentation_surfaces(region_map[, groups]) -> list of (id, vertices, triangles)
+# segmentation_surfaces(region_map[, groups], packed = True)
+#   -> (ids, vertices, triangles, vertex_counts, triangle_counts)
 #
 from ._segment import segmentation_surface, segmentation_surfaces
 
@@ -380,20 +380,28 @@ def calculate_segmentation_surfaces(seg, where = None, each = None,
     group, attribute_name = _which_segments(seg, conditions)
     matrix = seg.matrix(step = step, subregion = region)
     from . import segmentation_surfaces
-    surfs = segmentation_surfaces(matrix, group)
+    ids, vertices, triangles, vcounts, tcounts = segmentation_surfaces(matrix, group, packed = True)
 
     # Transform vertices from index to scene units and compute normals.
     geom = []
     tf = seg.matrix_indices_to_xyz_transform(step = step, subregion = region)
-    for region_id, va, ta in surfs:
-        tf.transform_points(va, in_place = True)
+    tf.transform_points(vertices, in_place = True)
+    voffset = toffset = 0
+    for region_id, nv, nt in zip(ids, vcounts, tcounts):
+        region_id = int(region_id)
+        va = vertices[voffset:voffset+nv]
+        ta = triangles[toffset:toffset+nt]
+        ta -= voffset
+        voffset += nv
+        toffset += nt
         from chimerax.surface import calculate_vertex_normals
         na = calculate_vertex_normals(va, ta)
         if smooth:
             sf, si = smoothing_factor, smoothing_iterations
-            from chimerax.surface import smooth_vertex_positions
-            smooth_vertex_positions(va, ta, sf, si)
-            smooth_vertex_positions(na, ta, sf, si)
+            from chimerax.surface import smooth_vertex_positions, vertex_adjacency
+            adj = vertex_adjacency(ta, len(va))
+            smooth_vertex_positions(va, ta, sf, si, adjacency = adj)
+            smooth_vertex_positions(na, ta, sf, si, adjacency = adj)
         geom.append((region_id, va, na, ta))
 
     # Determine surface coloring.
@@ -201,7 +201,7 @@ class Alignment(State):
         if not keep_intrinsic:
             self.intrinsic = False
         from chimerax.atomic import Sequence, Chain, StructureSeq, AtomicStructure, \
-            SeqMatchMap, estimate_assoc_params, StructAssocError, try_assoc
+            SeqMatchMap, estimate_assoc_params, StructAssocError, try_assoc, best_assocs
         from .settings import settings
         status = self.session.logger.status
         reeval = False
@@ -272,6 +272,8 @@ class Alignment(State):
                 new_match_maps.append(best_match_map)
                 nonlocal associated
                 associated = True
+            batch = []
+            bogus = False
             for sseq in sseqs:
                 if len(sseq) < min_length:
                     continue
@@ -283,7 +285,8 @@ class Alignment(State):
                     if len(segments) > 10 and len(segments[0]) == 1 \
                     and segments.count(segments[0]) == len(segments):
                         # some kind of bogus structure (e.g. from SAXS)
-                        return
+                        bogus = True
+                        break
 
                 if est_len >= len(forw_aseqs[-1].ungapped()):
                     # structure sequence longer than alignment sequence;
@@ -309,12 +312,16 @@ class Alignment(State):
                     aseqs = forw_aseqs
                 best_errors = best_match_map = None
                 max_errors = len(sseq) // settings.assoc_error_rate
-                if reeval:
-                    aseqs = []
-                    for chain in self.associations.keys():
-                        if chain.structure == struct:
-                            aseqs.append(self.associations[chain])
-                    aseqs.append(seq)
+                if not reeval:
+                    # matching doesn't depend on the associations made along the way,
+                    # so match all the chains together (in parallel) below
+                    batch.append((sseq, aseqs, (est_len, segments, gaps), max_errors))
+                    continue
+                aseqs = []
+                for chain in self.associations.keys():
+                    if chain.structure == struct:
+                        aseqs.append(self.associations[chain])
+                aseqs.append(seq)
                 for aseq in aseqs:
                     if best_errors:
                         try_errors = best_errors - 1
@@ -350,6 +357,17 @@ class Alignment(State):
 
                 if best_match_map:
                     do_assoc()
+            if batch:
+                batch_sseqs, batch_aseqs, batch_params, batch_errors = zip(*batch)
+                for sseq, assoc in zip(batch_sseqs,
+                        best_assocs(batch_sseqs, batch_aseqs, batch_params, batch_errors)):
+                    if assoc is None:
+                        continue
+                    best_match_map, best_errors = assoc
+                    if best_match_map:
+                        do_assoc()
+            if bogus:
+                return
             if not associated and force:
                 # nothing matched built-in criteria, use Needleman-Wunsch
                 best_errors = None
@@ -64,21 +64,36 @@ def align(session, atoms, to_atoms = None, move = None, each = None,
 
     If 'log_info' is True, report RMSD and pruned atoms to the log.
     """
-    if each == 'chain':
-        groups = atoms.by_chain
+    if cutoff_distance is not None and cutoff_distance <= 0.0:
+        raise UserError("Distance cutoff must be positive")
+
+    log = session.logger if log_info else None
+    if each in ('chain', 'structure'):
+        if each == 'chain':
+            groups = [gatoms for s,cid,gatoms in atoms.by_chain]
+            if move is None:
+                move = 'chains'
+        else:
+            groups = [gatoms for s,gatoms in atoms.by_structure]
         if move is None:
-            move = 'chains'
-        for s,cid,gatoms in groups:
-            align(session, gatoms, to_atoms, move=move, match_chain_ids=match_chain_ids,
-                  match_numbering=match_numbering, match_atom_names=match_atom_names,
-                  sequence=sequence, report_matrix=report_matrix)
-        return
-    elif each == 'structure':
-        groups = atoms.by_structure
-        for s,gatoms in groups:
-            align(session, gatoms, to_atoms, move=move, match_chain_ids=match_chain_ids,
-                  match_numbering=match_numbering, match_atom_names=match_atom_names,
-                  sequence=sequence, report_matrix=report_matrix)
+            move = 'structures'
+        if _group_moves_disjoint(each, move, len(groups)):
+            pairs = [_paired_atoms(gatoms, to_atoms, match_chain_ids, match_numbering,
+                                   match_atom_names, sequence, log) for gatoms in groups]
+            xyz_pairs = [(patoms.scene_coords, pto_atoms.scene_coords) for patoms, pto_atoms in pairs]
+            results = _align_point_sets(xyz_pairs, cutoff_distance)
+            for gatoms, (patoms, pto_atoms), result in zip(groups, pairs, results):
+                _apply_alignment(result, patoms, pto_atoms, cutoff_distance,
+                                 gatoms, to_atoms, move, log, report_matrix)
+        else:
+            # Groups move the same models or atoms, so each group is fit
+            # from the coordinates left by moving the previous one.
+            for gatoms in groups:
+                patoms, pto_atoms = _paired_atoms(gatoms, to_atoms, match_chain_ids,
+                                                  match_numbering, match_atom_names,
+                                                  sequence, log)
+                align_atoms(patoms, pto_atoms, pto_atoms.scene_coords, cutoff_distance,
+                            gatoms, to_atoms, move, log, report_matrix)
         return
     elif each == 'coordset':
         us = atoms.unique_structures
@@ -92,7 +107,30 @@ def align(session, atoms, to_atoms = None, move = None, each = None,
     if move is None:
         move = 'structures'
 
-    log = session.logger if log_info else None
+    patoms, pto_atoms = _paired_atoms(atoms, to_atoms, match_chain_ids, match_numbering,
+                                      match_atom_names, sequence, log)
+
+    xyz_to = pto_atoms.scene_coords
+    if each == 'coordset':
+        cs = cset_mol.active_coordset_id
+        cs_ids = cset_mol.coordset_ids
+        xyz_pairs = []
+        for id in cs_ids:
+            cset_mol.active_coordset_id = id
+            xyz_pairs.append((patoms.scene_coords, xyz_to))
+        results = _align_point_sets(xyz_pairs, cutoff_distance)
+        for id, result in zip(cs_ids, results):
+            cset_mol.active_coordset_id = id
+            _apply_alignment(result, patoms, pto_atoms, cutoff_distance,
+                             atoms, to_atoms, move, log, report_matrix)
+        cset_mol.active_coordset_id = cs
+        return
+
+    return align_atoms(patoms, pto_atoms, xyz_to, cutoff_distance,
+                       atoms, to_atoms, move, log, report_matrix)
+
+def _paired_atoms(atoms, to_atoms, match_chain_ids, match_numbering, match_atom_names,
+                  sequence, log):
     if sequence is None:
         patoms, pto_atoms = paired_atoms(atoms, to_atoms, match_chain_ids,
                                          match_numbering, match_atom_names)
@@ -107,42 +145,56 @@ def align(session, atoms, to_atoms = None, move = None, each = None,
         raise UserError('Must align equal numbers of atoms, got %d and %d' % (npa, npta))
     elif npa == 0:
         raise UserError('No atoms paired for alignment')
-
-    xyz_to = pto_atoms.scene_coords
-    if each == 'coordset':
-        cs = cset_mol.active_coordset_id
-        for id in cset_mol.coordset_ids:
-            cset_mol.active_coordset_id = id
-            align_atoms(patoms, pto_atoms, xyz_to, cutoff_distance,
-                        atoms, to_atoms, move, log, report_matrix)
-        cset_mol.active_coordset_id = cs
-        return
-
-    return align_atoms(patoms, pto_atoms, xyz_to, cutoff_distance,
-                       atoms, to_atoms, move, log, report_matrix)
+    return patoms, pto_atoms
+
+def _group_moves_disjoint(each, move, num_groups):
+    # Whether moving one chain or structure group leaves the atoms of the other
+    # groups in place, so all groups can be fit from the starting coordinates.
+    if num_groups <= 1 or move is False:
+        return True
+    if move is True:
+        move = 'structures'
+    if not isinstance(move, str):
+        return False	# Explicit Atoms collection moved for every group
+    if move == 'nothing':
+        return True
+    if each == 'structure':
+        return move in ('structures', 'structure atoms', 'chains', 'residues', 'atoms')
+    return move in ('chains', 'residues', 'atoms')
+
+def _align_point_sets(xyz_pairs, cutoff_distance):
+    # Superpose and prune all groups in parallel threads in C++.
+    from chimerax.geometry import iterative_align_point_sets
+    return iterative_align_point_sets([xyz for xyz, ref_xyz in xyz_pairs],
+                                      [ref_xyz for xyz, ref_xyz in xyz_pairs],
+                                      cutoff_distance)
 
 def align_atoms(patoms, pto_atoms, xyz_to, cutoff_distance,
                 atoms, to_atoms, move, log, report_matrix):
 
-    xyz_from = patoms.scene_coords
+    if cutoff_distance is not None and cutoff_distance <= 0.0:
+        raise UserError("Distance cutoff must be positive")
+    from chimerax.geometry import iterative_align_points
+    result = iterative_align_points(patoms.scene_coords, xyz_to, cutoff_distance)
+    return _apply_alignment(result, patoms, pto_atoms, cutoff_distance,
+                            atoms, to_atoms, move, log, report_matrix)
+
+def _apply_alignment(result, patoms, pto_atoms, cutoff_distance,
+                     atoms, to_atoms, move, log, report_matrix):
+
+    if result is None:
+        raise IterationError("Alignment failed;"
+            " pruning distances > %g left less than 3 atom pairs" % cutoff_distance)
+    tf, rmsd, indices, full_rmsd = result
+    from chimerax.geometry import Place
+    tf = Place(tf)
     if cutoff_distance is None:
-        from chimerax.geometry import align_points
-        tf, rmsd = align_points(xyz_from, xyz_to)
-        full_rmsd = rmsd
         matched_patoms, matched_pto_atoms = patoms, pto_atoms
         msg = 'RMSD between %d atom pairs is %.3f angstroms' % (len(patoms), rmsd)
     else:
-        if cutoff_distance <= 0.0:
-            raise UserError("Distance cutoff must be positive")
-        tf, rmsd, indices = align_and_prune(xyz_from, xyz_to, cutoff_distance)
-        np = len(indices)
-        dxyz = tf*xyz_from - xyz_to
-        d2 = (dxyz*dxyz).sum(axis=1)
-        import math
-        full_rmsd = math.sqrt(d2.sum() / len(d2))
         matched_patoms, matched_pto_atoms = patoms[indices], pto_atoms[indices]
         msg = 'RMSD between %d pruned atom pairs is %.3f angstroms;' \
-            ' (across all %d pairs: %.3f)' % (np, rmsd, len(patoms), full_rmsd)
+            ' (across all %d pairs: %.3f)' % (len(indices), rmsd, len(patoms), full_rmsd)
 
     if report_matrix and log:
         log.info(matrix_text(tf, atoms.structures[0]))
@@ -156,31 +208,15 @@ def align_atoms(patoms, pto_atoms, xyz_to, cutoff_distance,
 
 def align_and_prune(xyz, ref_xyz, cutoff_distance, indices = None):
 
-    import numpy
-    if indices is None:
-        indices = numpy.arange(len(xyz))
-    axyz, ref_axyz = xyz[indices], ref_xyz[indices]
-    from chimerax.geometry import align_points
-    p, rms = align_points(axyz, ref_axyz)
-    dxyz = p*axyz - ref_axyz
-    d2 = (dxyz*dxyz).sum(axis=1)
-    cutoff2 = cutoff_distance * cutoff_distance
-    i = d2.argsort()
-    if d2[i[-1]] <= cutoff2:
-        return p, rms, indices
-
-    # cull 10% or...
-    index1 = int(len(d2) * 0.9)
-    # cull half the long pairings
-    index2 = int(((d2 <= cutoff2).sum() + len(d2)) / 2)
-    # whichever is fewer
-    index = max(index1, index2)
-    survivors = indices[i[:index]]
-
-    if len(survivors) < 3:
+    if indices is not None:
+        xyz, ref_xyz = xyz[indices], ref_xyz[indices]
+    from chimerax.geometry import iterative_align_points, Place
+    result = iterative_align_points(xyz, ref_xyz, cutoff_distance)
+    if result is None:
         raise IterationError("Alignment failed;"
             " pruning distances > %g left less than 3 atom pairs" % cutoff_distance)
-    return align_and_prune(xyz, ref_xyz, cutoff_distance, survivors)
+    tf, rms, kept, full_rms = result
+    return Place(tf), rms, (kept if indices is None else indices[kept])
 
 def paired_atoms(atoms, to_atoms, match_chain_ids, match_numbering, match_atom_names):
     # TODO: return summary string of all dropped atoms.
@@ -309,7 +309,8 @@ class CoordinateSetPlayer:
       compute_ss = False
     if compute_ss:
       from . import dssp
-      dssp.compute_ss(m.session, m)
+      # Backbone moves little between frames so reuse the hbond search.
+      dssp.compute_ss(m.session, m, reuse_tolerance = 1.0)
     else:
       if self.steady_atoms:
         self.hold_steady(last_cs)
@@ -26,7 +26,8 @@
 # Compute/assign secondary structure using Kabsch and Sander algorithm
 #
 def compute_ss(session, structures=None, *,
-        min_helix_len=3, min_strand_len=3, energy_cutoff=-0.5, report=False):
+        min_helix_len=3, min_strand_len=3, energy_cutoff=-0.5, report=False,
+        reuse_tolerance=0):
 
     from chimerax.atomic import Structure
     from chimerax.dssp import compute_ss
@@ -46,7 +47,8 @@ def compute_ss(session, structures=None, *,
         ss_types = residues.ss_types
         ss_ids = residues.ss_ids
         compute_ss(struct, energy_cutoff=energy_cutoff, min_helix_len=min_helix_len,
-                   min_strand_len=min_strand_len, report=report)
+                   min_strand_len=min_strand_len, report=report,
+                   reuse_tolerance=reuse_tolerance)
         undo_state.add(residues, "ss_types", ss_types, residues.ss_types)
         undo_state.add(residues, "ss_ids", ss_ids, residues.ss_ids)
 
@@ -86,7 +86,8 @@ def graphics_quality(session, quality = None, subdivision = None,
                      atom_triangles = None, bond_triangles = None,
                      total_atom_triangles = None, total_bond_triangles = None,
                      bond_sides = None, pseudobond_sides = None,
-                     ribbon_divisions = None, ribbon_sides = None, color_depth = None):
+                     ribbon_divisions = None, ribbon_sides = None, color_depth = None,
+                     atom_impostors = None):
     '''
     Set graphics quality parameters.
 
@@ -123,6 +124,10 @@ def graphics_quality(session, quality = None, subdivision = None,
         Number of bits per color channel (red, green, blue, alpha) in framebuffer.
         If 16 is specified then offscreen rendering is used since it is not easy or
         possible to switch on-screen framebuffer depth.
+    atom_impostors : bool
+        Whether to draw atom spheres as squares facing the camera with the sphere
+        computed per pixel in the shader instead of triangulated spheres.  Spheres
+        are exactly round and drawing millions of atoms is faster.
     '''
     from chimerax.atomic import structure_graphics_updater
     gu = structure_graphics_updater(session)
@@ -185,6 +190,9 @@ def graphics_quality(session, quality = None, subdivision = None,
         r.offscreen.enabled = (color_depth == 16)
         v.redraw_needed = True
         change = True
+    if atom_impostors is not None:
+        lod.atom_sphere_impostors = atom_impostors
+        change = True
 
     if change:
         gu.update_level_of_detail()
@@ -197,6 +205,8 @@ def graphics_quality(session, quality = None, subdivision = None,
             dmin, dmax = min(div), max(div)
             drange = '%d-%d' % (dmin, dmax) if dmin < dmax else '%d' % dmin
             msg += ', ribbon divisions %s' % drange
+        if lod.atom_sphere_impostors:
+            msg += ', atom impostors'
         session.logger.status(msg, log = True)
 
 def graphics_silhouettes(session, enable=None, width=None, color=None, depth_jump=None):
@@ -311,6 +321,7 @@ def register_command(logger):
                  ('ribbon_divisions', IntOrDefaultArg),
                  ('ribbon_sides', IntArg),
                  ('color_depth', IntArg),
+                 ('atom_impostors', BoolArg),
                  ],
         hidden = ['subdivision'], # Deprecated in favor of quality
         synopsis='Set graphics quality parameters'
@@ -25,7 +25,7 @@
 def set(session, bg_color=None,
         silhouettes=None, silhouette_width=None, silhouette_color=None, silhouette_depth_jump=None,
         selection_color=None, selection_width=None,
-        subdivision=None, max_frame_rate = None):
+        subdivision=None, max_frame_rate = None, max_threads = None):
     '''Set global parameters.  With no options reports the current settings.
 
     Parameters
@@ -51,6 +51,9 @@ def set(session, bg_color=None,
     max_frame_rate : float
         Maximum frames per second to render graphics.  The default frame rate is 60 frames per second.
         A slower rate is sometimes useful when making movies to preview at the slower movie playback rate.
+    max_threads : int
+        Most threads that parallel calculations (e.g. electrostatics, H-bonds, clashes) use together.
+        Zero restores the default of one thread per core.
     '''
     had_arg = False
     view = session.main_view
@@ -78,13 +81,19 @@ def set(session, bg_color=None,
         had_arg = True
         from .graphics import graphics_rate
         graphics_rate(session, max_frame_rate = max_frame_rate)
+    if max_threads is not None:
+        had_arg = True
+        from chimerax.arrays import set_max_threads
+        set_max_threads(max_threads)
 
     if not had_arg:
         from chimerax import atomic
+        from chimerax.arrays import max_threads as max_threads_in_use
         lod = atomic.level_of_detail(session)
         msg = '\n'.join(('Current settings:',
                          '  Background color: %d,%d,%d' % tuple(100*r for r in view.background_color[:3]),
-                         '  Subdivision: %.3g'  % lod.quality))
+                         '  Subdivision: %.3g'  % lod.quality,
+                         '  Maximum threads: %d' % max_threads_in_use()))
         session.logger.info(msg)
 
 def xset(session, setting):
@@ -95,7 +104,8 @@ def xset(session, setting):
     view.redraw_needed = True
 
 def register_command(logger):
-    from chimerax.core.commands import CmdDesc, register, ColorArg, BoolArg, FloatArg, EnumOf
+    from chimerax.core.commands import CmdDesc, register, ColorArg, BoolArg, FloatArg, EnumOf, \
+        NonNegativeIntArg
     desc = CmdDesc(
         keyword=[('bg_color', ColorArg),
                  ('silhouettes', BoolArg),
@@ -105,7 +115,8 @@ def register_command(logger):
                  ('selection_color', ColorArg),
                  ('selection_width', FloatArg),
                  ('subdivision', FloatArg),
-                 ('max_frame_rate', FloatArg)],
+                 ('max_frame_rate', FloatArg),
+                 ('max_threads', NonNegativeIntArg)],
         hidden = ['silhouettes', 'silhouette_width',
                   'silhouette_color', 'silhouette_depth_jump',
                   'selection_color', 'selection_width',
@@ -599,10 +599,9 @@ def _contacting_transforms(structures, transforms, distance):
     from chimerax.geometry import identity, find_close_points_sets, Places
     ident = identity().matrix.astype(float32)
     orig_points = [(points, ident)]
-    tfnear = Places([tf for tf in transforms if
-                     len(find_close_points_sets(orig_points,
-                                                [(points, tf.matrix.astype(float32))],
-                                                distance)[0][0]) > 0])
+    copies = [(points, tf.matrix.astype(float32)) for tf in transforms]
+    i1, i2 = find_close_points_sets(orig_points, copies, distance)
+    tfnear = Places([tf for tf, i in zip(transforms, i2) if len(i) > 0])
     return tfnear
 
 # -----------------------------------------------------------------------------
@@ -0,0 +1,98 @@
+# vim: set expandtab shiftwidth=4 softtabstop=4:
+
+# === UCSF ChimeraX Copyright ===
+# Copyright 2022 Regents of the University of California. All rights reserved.
+# The ChimeraX application is provided pursuant to the ChimeraX license
+# agreement, which covers academic and commercial uses. For more details, see
+# <http://www.rbvi.ucsf.edu/chimerax/docs/licensing.html>
+#
+# This particular file is part of the ChimeraX library. You can also
+# redistribute and/or modify it under the terms of the GNU Lesser General
+# Public License version 2.1 as published by the Free Software Foundation.
+# For more details, see
+# <https://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>
+#
+# THIS SOFTWARE IS PROVIDED "AS IS" WITHOUT WARRANTY OF ANY KIND, EITHER
+# EXPRESSED OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+# OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. ADDITIONAL LIABILITY
+# LIMITATIONS ARE DESCRIBED IN THE GNU LESSER GENERAL PUBLIC LICENSE
+# VERSION 2.1
+#
+# This notice must be embedded in or attached to all copies, including partial
+# copies, of the software or any revisions or derivations thereof.
+# === UCSF ChimeraX Copyright ===
+
+
+def trace(session, action = 'report', file = None, timeline = False, reset = False):
+    '''
+    Time the C++ kernels used for reading files, computing surfaces, ribbons,
+    areas, atom types and bulk attribute access, to see where time goes in a
+    released build.  Tracing can also be turned on at startup by setting the
+    CHIMERAX_TRACE environment variable.
+
+    Parameters
+    ----------
+    action : "on", "off", "report", "reset" or "save"
+      Turn timing on or off, log the times collected so far, zero them, or
+      save the timeline to a file.
+    file : string
+      Chrome trace JSON file to save the timeline to, for viewing with
+      Perfetto or chrome://tracing.
+    timeline : bool
+      With "on", also record a timeline of each kernel call, thread pool
+      job, trigger activation and graphics draw.
+    reset : bool
+      Zero the times after reporting them.
+    '''
+    from chimerax import arrays
+    log = session.logger
+    from chimerax.core.triggerset import set_timeline_span
+    if action == 'on':
+        arrays.set_trace(True)
+        if timeline:
+            arrays.set_trace_events(True)
+            set_timeline_span(arrays.trace_span)
+        log.info('C++ kernel tracing on' + (' with timeline' if timeline else ''))
+    elif action == 'off':
+        arrays.set_trace(False)
+        arrays.set_trace_events(False)
+        set_timeline_span(None)
+        log.info('C++ kernel tracing off')
+    elif action == 'reset':
+        arrays.reset_trace()
+    elif action == 'save':
+        if file is None:
+            from chimerax.core.errors import UserError
+            raise UserError('trace save requires a file name')
+        count, dropped = arrays.save_chrome_trace(file)
+        msg = 'Saved %d timeline events to %s' % (count, file)
+        if dropped:
+            msg += ', %d events dropped after the buffer filled' % dropped
+        log.info(msg)
+    elif action == 'report':
+        _report_counters(session, arrays.trace_counters(), arrays.trace_enabled())
+        if reset:
+            arrays.reset_trace()
+
+def _report_counters(session, counters, enabled):
+    log = session.logger
+    if len(counters) == 0:
+        msg = 'No C++ kernel times recorded'
+        if not enabled:
+            msg += ', use "trace on" to start tracing'
+        log.info(msg)
+        return
+    lines = ['%-40s %8s %10s %10s %12s' % ('Kernel', 'Calls', 'Seconds', 'ms/call', 'Items')]
+    for name, calls, seconds, items in counters:
+        lines.append('%-40s %8d %10.4g %10.4g %12d'
+                     % (name, calls, seconds, 1000 * seconds / calls, items))
+    log.info('<pre>%s</pre>' % '\n'.join(lines), is_html = True)
+
+def register_command(logger):
+    from chimerax.core.commands import CmdDesc, register, EnumOf, BoolArg, SaveFileNameArg
+    desc = CmdDesc(optional=[('action', EnumOf(('on', 'off', 'report', 'reset', 'save'))),
+                             ('file', SaveFileNameArg)],
+                   keyword=[('timeline', BoolArg),
+                            ('reset', BoolArg)],
+                   synopsis='time C++ kernels')
+    register('trace', desc, trace, logger=logger)
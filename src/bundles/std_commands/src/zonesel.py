@@ -94,24 +94,27 @@ def surfaces(models, exclude_molecular_surfaces = False):
 def zone_items(na, ns, range, fa, fs, extend = False, residues = False):
     # TODO: Use double precision coordinates and transforms.
     from numpy import float32
-    naxyz = na.scene_coords.astype(float32)
     # TODO: Only consider masked geometry.  Handle surface instances.
-    nsxyz = [(s.vertices.astype(float32), p.matrix) for s in ns for p in s.get_scene_positions()]
-    from chimerax.geometry import Place
-    im = Place().matrix
-    nxyz = [(naxyz,im)] + nsxyz
-    faxyz = fa.scene_coords.astype(float32)
-    fsxyz = [(s.vertices.astype(float32), p.matrix) for s in fs for p in s.get_scene_positions()]
-    fxyz = [(faxyz,im)] + fsxyz
-
-    from chimerax.geometry import find_close_points_sets
-    i1, i2 = find_close_points_sets(nxyz, fxyz, range)
-
-    sel = []
-    from numpy import take, compress
-    sa = fa.filter(i2[0])
-
-    ss = set(fs for fs,i in zip(fs,i2[1:]) if len(i) > 0)
+    nsxyz = [(s.vertices.astype(float32), p) for s in ns for p in s.get_scene_positions()]
+
+    # Target atoms are found with the cell list each structure keeps.
+    from numpy import concatenate
+    nxyz = concatenate([na.scene_coords] + [p * xyz for xyz, p in nsxyz])
+    from chimerax.atomic import zone_masks, concatenate as concatenate_atoms, Atoms
+    fstructs = fa.unique_structures
+    masks = zone_masks(fstructs, nxyz, range)
+    zatoms = concatenate_atoms([s.atoms.filter(amask) for s, (amask, rmask) in zip(fstructs, masks)],
+                               Atoms)
+    sa = fa.intersect(zatoms)
+
+    ss = set()
+    if fs:
+        from chimerax.geometry import Place, find_close_points_sets
+        im = Place().matrix
+        nxyz_sets = [(na.scene_coords.astype(float32), im)] + [(xyz, p.matrix) for xyz, p in nsxyz]
+        fsxyz = [(s.vertices.astype(float32), p.matrix) for s in fs for p in s.get_scene_positions()]
+        i1, i2 = find_close_points_sets(nxyz_sets, fsxyz, range)
+        ss = set(s for s,i in zip(fs,i2) if len(i) > 0)
     if extend:
         sa = sa.merge(na)
         ss.update(ns)
@@ -30,24 +30,39 @@
 #define PY_SSIZE_T_CLEAN 1		// Use Py_ssize_t for parsing y# format
 #include <Python.h>			// use PyObject
 
+#include <algorithm>			// use std::min
 #include <cstdint>			// use std::int64_t
 //include <iostream>			// use std::cerr for debugging
-#include <map>				// use std::map
+#include <unordered_map>		// use std::unordered_map
 #include <vector>			// use std::vector
 
+#include <errno.h>			// use errno
 #include <math.h>			// use sqrtf()
 #include <string.h>			// use memcpy()
+#ifdef _WIN32
+# include <io.h>			// use _write()
+#else
+# include <unistd.h>			// use write()
+#endif
 
 #include <arrays/pythonarray.h>		// use array_from_python()
 #include <arrays/rcarray.h>		// use FArray, IArray
+#include <arrays/threadpool.h>		// use Thread_Pool::parallel_for
 
 using std::int64_t;
 
+// Triangles packed per thread pool task, and written per write() call.
+static const int64_t pack_chunk_size = 16384;
+static const int64_t write_chunk_size = 1 << 20;
+
 // ----------------------------------------------------------------------------
+// Pack triangles tstart to tend-1 into data, which holds tend-tstart
+// triangles of 50 bytes.  Vertices are transformed by the 3 by 4 matrix tf
+// if it is not null.
 //
-static void pack_triangles(const FArray &va, const IArray &ta, unsigned char *data)
+static void pack_triangles(const FArray &va, const IArray &ta, const double *tf,
+			   int64_t tstart, int64_t tend, unsigned char *data)
 {
-  int64_t nt = ta.size(0);
   int64_t t0 = ta.stride(0), t1 = ta.stride(1);
   int *tv = ta.values();
   int *tv0 = tv, *tv1 = tv + t1, *tv2 = tv + 2*t1;
@@ -55,7 +70,7 @@ static void pack_triangles(const FArray &va, const IArray &ta, unsigned char *da
   float *vv = va.values();
   float *vv0 = vv, *vv1 = vv + vs1, *vv2 = vv + 2*vs1;
   float f[12];
-  for (int64_t t = 0 ; t < nt ; ++t)
+  for (int64_t t = tstart ; t < tend ; ++t)
     {
       // Get 3 triangle vertices
       int64_t ti = t*t0;
@@ -64,6 +79,22 @@ static void pack_triangles(const FArray &va, const IArray &ta, unsigned char *da
       float v0x = vv0[v0i], v0y = vv1[v0i], v0z = vv2[v0i];
       float v1x = vv0[v1i], v1y = vv1[v1i], v1z = vv2[v1i];
       float v2x = vv0[v2i], v2y = vv1[v2i], v2z = vv2[v2i];
+      if (tf)
+	{
+	  float x, y, z;
+	  x = v0x; y = v0y; z = v0z;
+	  v0x = tf[0]*x + tf[1]*y + tf[2]*z + tf[3];
+	  v0y = tf[4]*x + tf[5]*y + tf[6]*z + tf[7];
+	  v0z = tf[8]*x + tf[9]*y + tf[10]*z + tf[11];
+	  x = v1x; y = v1y; z = v1z;
+	  v1x = tf[0]*x + tf[1]*y + tf[2]*z + tf[3];
+	  v1y = tf[4]*x + tf[5]*y + tf[6]*z + tf[7];
+	  v1z = tf[8]*x + tf[9]*y + tf[10]*z + tf[11];
+	  x = v2x; y = v2y; z = v2z;
+	  v2x = tf[0]*x + tf[1]*y + tf[2]*z + tf[3];
+	  v2y = tf[4]*x + tf[5]*y + tf[6]*z + tf[7];
+	  v2z = tf[8]*x + tf[9]*y + tf[10]*z + tf[11];
+	}
 
       // Compute triangle normal.
       float e10x = v1x-v0x, e10y = v1y-v0y, e10z = v1z-v0z;
@@ -78,7 +109,7 @@ static void pack_triangles(const FArray &va, const IArray &ta, unsigned char *da
       f[3] = v0x; f[4] = v0y; f[5] = v0z;
       f[6] = v1x; f[7] = v1y; f[8] = v1z;
       f[9] = v2x; f[10] = v2y; f[11] = v2z;
-      unsigned char *d = data + t*50;
+      unsigned char *d = data + (t-tstart)*50;
       memcpy(d, static_cast<void*>(&f[0]), 48);
       d[48] = d[49] = 0;
     }
@@ -89,7 +120,7 @@ static void pack_triangles(const FArray &va, const IArray &ta, unsigned char *da
   if (!little_endian)
     {
       unsigned short *s = (unsigned short *)(data);
-      for (int64_t t = 0 ; t < nt ; ++t)
+      for (int64_t t = 0 ; t < tend-tstart ; ++t)
 	{
 	  unsigned short *d = s + t*25;
 	  for (int i = 0 ; i < 25 ; i += 2)
@@ -102,6 +133,34 @@ static void pack_triangles(const FArray &va, const IArray &ta, unsigned char *da
     }
 }
 
+// ----------------------------------------------------------------------------
+// Pack all triangles into data, in chunks on the thread pool.
+//
+static void pack_triangles_threaded(const FArray &va, const IArray &ta, const double *tf,
+				    int64_t tstart, int64_t tend, unsigned char *data)
+{
+  Thread_Pool::parallel_for(tend - tstart, [&](int64_t i0, int64_t i1) {
+      pack_triangles(va, ta, tf, tstart + i0, tstart + i1, data + 50*i0);
+    }, pack_chunk_size);
+}
+
+// ----------------------------------------------------------------------------
+//
+static bool check_triangle_indices(const IArray &ta, int64_t nv)
+{
+  int64_t n = 3*ta.size(0);
+  IArray tc = ta.contiguous_array();
+  const int *tv = tc.values();
+  for (int64_t i = 0 ; i < n ; ++i)
+    if (tv[i] < 0 || tv[i] >= nv)
+      {
+	PyErr_Format(PyExc_ValueError, "Triangle vertex index %d out of range 0-%ld",
+		     tv[i], (long)nv-1);
+	return false;
+      }
+  return true;
+}
+
 // ----------------------------------------------------------------------------
 //
 extern "C" PyObject *
@@ -119,12 +178,124 @@ stl_pack(PyObject *, PyObject *args, PyObject *keywds)
   int64_t nt = tarray.size(0);
   unsigned char *data;
   PyObject *a = python_uint8_array(nt, 50, &data);	// 50 bytes per triangle.
+  if (a == NULL)
+    return NULL;
 
-  pack_triangles(varray, tarray, data);
+  Py_BEGIN_ALLOW_THREADS
+  pack_triangles_threaded(varray, tarray, NULL, 0, nt, data);
+  Py_END_ALLOW_THREADS
   
   return a;
 }
 
+// ----------------------------------------------------------------------------
+//
+static bool write_bytes(int fd, const unsigned char *data, int64_t nbytes)
+{
+  while (nbytes > 0)
+    {
+#ifdef _WIN32
+      int n = _write(fd, data, static_cast<unsigned int>(nbytes));
+#else
+      int64_t n = write(fd, data, nbytes);
+#endif
+      if (n < 0)
+	{
+	  if (errno == EINTR)
+	    continue;
+	  return false;
+	}
+      data += n;
+      nbytes -= n;
+    }
+  return true;
+}
+
+// ----------------------------------------------------------------------------
+//
+class STL_Piece
+{
+public:
+  FArray vertices;
+  IArray triangles;
+  DArray positions;
+};
+
+static bool parse_pieces(PyObject *geometry, std::vector<STL_Piece> &pieces)
+{
+  PyObject *seq = PySequence_Fast(geometry, "stl_write(): geometry must be a sequence");
+  if (seq == NULL)
+    return false;
+  Py_ssize_t n = PySequence_Fast_GET_SIZE(seq);
+  pieces.resize(n);
+  bool ok = true;
+  for (Py_ssize_t i = 0 ; i < n && ok ; ++i)
+    {
+      PyObject *vtp = PySequence_Fast_GET_ITEM(seq, i);
+      PyObject *va, *ta, *pa;
+      STL_Piece &p = pieces[i];
+      if (!PyArg_ParseTuple(vtp, "OOO", &va, &ta, &pa) ||
+	  !parse_float_n3_array(va, &p.vertices) ||
+	  !parse_int_n3_array(ta, &p.triangles) ||
+	  !parse_contiguous_double_n34_array(pa, &p.positions))
+	{
+	  if (!PyErr_Occurred())
+	    PyErr_SetString(PyExc_TypeError,
+			    "stl_write(): geometry items must be (vertices, triangles, positions)");
+	  ok = false;
+	}
+      else
+	{
+	  ok = check_triangle_indices(p.triangles, p.vertices.size(0));
+	}
+    }
+  Py_DECREF(seq);
+  return ok;
+}
+
+// ----------------------------------------------------------------------------
+//
+extern "C" PyObject *
+stl_write(PyObject *, PyObject *args, PyObject *keywds)
+{
+  int fd;
+  PyObject *geometry;
+  const char *kwlist[] = {"file_descriptor", "geometry", NULL};
+  if (!PyArg_ParseTupleAndKeywords(args, keywds, const_cast<char *>("iO"),
+				   (char **)kwlist,
+				   &fd, &geometry))
+    return NULL;
+
+  std::vector<STL_Piece> pieces;
+  if (!parse_pieces(geometry, pieces))
+    return NULL;
+
+  int64_t ntri = 0;
+  bool ok = true;
+  Py_BEGIN_ALLOW_THREADS
+  std::vector<unsigned char> buffer;
+  for (auto &p: pieces)
+    {
+      int64_t nt = p.triangles.size(0), np = p.positions.size(0);
+      const double *tf = p.positions.values();
+      for (int64_t i = 0 ; i < np && ok ; ++i, tf += 12)
+	for (int64_t t = 0 ; t < nt && ok ; t += write_chunk_size)
+	  {
+	    int64_t tend = std::min(nt, t + write_chunk_size);
+	    buffer.resize(50*(tend-t));
+	    pack_triangles_threaded(p.vertices, p.triangles, tf, t, tend, buffer.data());
+	    ok = write_bytes(fd, buffer.data(), 50*(tend-t));
+	    ntri += tend - t;
+	  }
+    }
+  Py_END_ALLOW_THREADS
+
+  if (!ok)
+    return PyErr_SetFromErrno(PyExc_OSError);
+
+  return PyLong_FromLongLong(ntri);
+}
+
 // ----------------------------------------------------------------------------
 //
 class Vertex
@@ -132,8 +303,25 @@ class Vertex
 public:
   float x,y,z;
   Vertex() {};
-  bool operator<(const Vertex &v) const
-    { return (x < v.x || (x == v.x && (y < v.y || (y == v.y && z < v.z)))); }
+  bool operator==(const Vertex &v) const
+    { return x == v.x && y == v.y && z == v.z; }
+  size_t hash() const
+    {
+      // Positive and negative zero compare equal so must hash the same.
+      float c[3] = {x == 0 ? 0.0f : x, y == 0 ? 0.0f : y, z == 0 ? 0.0f : z};
+      uint32_t b[3];
+      memcpy(&b[0], &c[0], 12);
+      uint64_t h = b[0];
+      h = h * 0x9E3779B97F4A7C15ull ^ b[1];
+      h = h * 0x9E3779B97F4A7C15ull ^ b[2];
+      return static_cast<size_t>(h ^ (h >> 29));
+    }
+};
+
+class Vertex_Hash
+{
+public:
+  size_t operator()(const Vertex &v) const { return v.hash(); }
 };
 
 // -----------------------------------------------------------------------------
@@ -141,40 +329,56 @@ public:
 // followed three float32 vertices, followed by two "attribute bytes"
 // sometimes used to hold color information, but ignored by this reader.
 //
+// Identical vertices are merged and numbered in order of first use.  The
+// triangle corners are divided by vertex hash among threads, each finding the
+// first corner with each of its vertices, and a single pass over the corners
+// then numbers the vertices in the same order a sequential reader would.
+//
 static void unpack(const char *geom, int64_t ntri,
 		   int *tri, std::vector<float> &v, std::vector<float> &n)
 {
-  // Find unique vertices and record triangle vertex indices.
-  std::map<Vertex,int> vertices; // Map unique vertices to index.
-  float tv[12];
-  Vertex vxyz;
-  int64_t vi;
-  for (int64_t t = 0 ; t < ntri ; ++t)
-    {
-      memcpy(&tv[0], geom + t*50 + 12, 36);
-      for (int c = 0 ; c < 3 ; ++c)
+  int64_t nc = 3*ntri;	// Triangle corners
+  std::vector<Vertex> corners(nc);
+  std::vector<uint32_t> hashes(nc);
+  Thread_Pool::parallel_for(ntri, [&](int64_t t0, int64_t t1) {
+      for (int64_t t = t0 ; t < t1 ; ++t)
 	{
-	  float *tc = tv + 3*c;
-	  vxyz.x = tc[0];
-	  vxyz.y = tc[1];
-	  vxyz.z = tc[2];
-	  auto vit = vertices.find(vxyz);
-	  if (vit == vertices.end())
-	    {
-	      vi = vertices.size();
-	      vertices[vxyz] = vi;
-	      v.push_back(vxyz.x);
-	      v.push_back(vxyz.y);
-	      v.push_back(vxyz.z);
-	      n.push_back(0);
-	      n.push_back(0);
-	      n.push_back(0);
-	    }
-	  else
-	    vi = vit->second;
-	  tri[3*t+c] = vi;
+	  Vertex *c = &corners[3*t];
+	  memcpy(c, geom + t*50 + 12, 36);
+	  for (int i = 0 ; i < 3 ; ++i)
+	    hashes[3*t+i] = static_cast<uint32_t>(c[i].hash());
 	}
-    }
+    }, pack_chunk_size);
+
+  // Set tri to the index of the first corner with the same vertex.
+  int nbuckets = 4 * Thread_Pool::thread_count(nc, pack_chunk_size);
+  std::vector<std::vector<int>> buckets(nbuckets);
+  for (int64_t c = 0 ; c < nc ; ++c)
+    buckets[hashes[c] % nbuckets].push_back(c);
+  Thread_Pool::parallel_for(nbuckets, [&](int64_t b0, int64_t b1) {
+      std::unordered_map<Vertex,int,Vertex_Hash> first;
+      for (int64_t b = b0 ; b < b1 ; ++b)
+	{
+	  first.clear();
+	  for (int c: buckets[b])
+	    tri[c] = first.emplace(corners[c], c).first->second;
+	}
+    });
+
+  // Number vertices in order of first use.
+  int64_t vi = 0;
+  for (int64_t c = 0 ; c < nc ; ++c)
+    if (tri[c] == c)
+      {
+	tri[c] = vi++;
+	const Vertex &vxyz = corners[c];
+	v.push_back(vxyz.x);
+	v.push_back(vxyz.y);
+	v.push_back(vxyz.z);
+      }
+    else
+      tri[c] = tri[tri[c]];
+  n.resize(v.size(), 0);
 
   // Compute vertex normals as average of triangle normals.
   float nxyz[3];
@@ -191,13 +395,17 @@ static void unpack(const char *geom, int64_t ntri,
 
   // Normalize normals.
   int64_t nv = v.size() / 3;
-  for (vi = 0 ; vi < nv ; ++vi)
-    {
-      float nx = n[3*vi], ny = n[3*vi+1], nz = n[3*vi+2];
-      float nn = sqrtf(nx*nx + ny*ny + nz*nz);
-      if (nn > 0)
-	{ n[3*vi] = nx/nn; n[3*vi+1] = ny/nn; n[3*vi+2] = nz/nn; }
-    }
+  float *nn3 = n.data();
+  Thread_Pool::parallel_for(nv, [=](int64_t v0, int64_t v1) {
+      for (int64_t vi = v0 ; vi < v1 ; ++vi)
+	{
+	  float *nv = nn3 + 3*vi;
+	  float nx = nv[0], ny = nv[1], nz = nv[2];
+	  float nn = sqrtf(nx*nx + ny*ny + nz*nz);
+	  if (nn > 0)
+	    { nv[0] = nx/nn; nv[1] = ny/nn; nv[2] = nz/nn; }
+	}
+    }, pack_chunk_size);
 }
 
 // ----------------------------------------------------------------------------
@@ -216,8 +424,12 @@ stl_unpack(PyObject *, PyObject *args, PyObject *keywds)
   int64_t ntri = nbytes / 50;
   int *tri;
   PyObject *tpy = python_int_array(ntri, 3, &tri);
+  if (tpy == NULL)
+    return NULL;
   std::vector<float> v, n;
+  Py_BEGIN_ALLOW_THREADS
   unpack(data, ntri, tri, v, n);
+  Py_END_ALLOW_THREADS
   int64_t nv = v.size() / 3;
   PyObject *vpy = c_array_to_python(v, nv, 3);
   PyObject *npy = c_array_to_python(n, nv, 3);
@@ -235,6 +447,18 @@ static PyMethodDef stl_methods[] = {
    "Compute the STL (Stereo Lithography) file format packing of specified triangles.\n"
    "Implemented in C++.\n"
   },
+  {const_cast<char*>("stl_write"), (PyCFunction)stl_write,
+   METH_VARARGS|METH_KEYWORDS,
+   "stl_write(file_descriptor, geometry)\n"
+   "\n"
+   "Write STL (Stereo Lithography) triangle data to an open file descriptor,\n"
+   "packing a chunk at a time so the whole packed file is never held in memory.\n"
+   "Geometry is a sequence of (vertices, triangles, positions) where positions\n"
+   "is an N by 3 by 4 float64 array of instance placements applied to the\n"
+   "vertices.  The 80 byte comment and triangle count header are not written.\n"
+   "Returns the number of triangles written.\n"
+   "Implemented in C++.\n"
+  },
   {const_cast<char*>("stl_unpack"), (PyCFunction)stl_unpack,
    METH_VARARGS|METH_KEYWORDS,
    "stl_unpack(data)\n"
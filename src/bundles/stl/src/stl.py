@@ -304,10 +304,8 @@ def write_stl(session, filename, models):
             pos = d.get_scene_positions(displayed_only = True)
             if len(pos) > 0:
                 geom.append((va, ta, pos))
-    from chimerax.surface import combine_geometry_vtp
-    va, ta = combine_geometry_vtp(geom)
-    from .stl_cpp import stl_pack
-    stl_geom = stl_pack(va, ta)
+    # Instances are placed while packing so combined copies are not made.
+    geom_arrays = [(va, ta, pos.array()) for va, ta, pos in geom]
     
     # Write 80 character comment.
     from chimerax import app_dirs as ad
@@ -319,12 +317,14 @@ def write_stl(session, filename, models):
     file.write(comment.encode('utf-8'))
 
     # Write number of triangles
-    tc = len(ta)
+    tc = sum(len(ta)*len(pos) for va, ta, pos in geom)
     from numpy import uint32
     file.write(binary_string(tc, uint32))
 
-    # Write triangles.
-    file.write(stl_geom)
+    # Write triangles packed a chunk at a time directly to the file.
+    file.flush()
+    from .stl_cpp import stl_write
+    stl_write(file.fileno(), geom_arrays)
     file.close()
 
 # -----------------------------------------------------------------------------
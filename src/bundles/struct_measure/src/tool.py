@@ -322,6 +322,7 @@ class StructMeasureTool(ToolInstance):
         button_layout.addWidget(save_info_button)
         table_layout.addLayout(button_layout)
         self._angle_info = []
+        self._angle_keys = {}	# atoms per angle -> (table rows, text keys)
 
         from .settings import get_settings
         settings = get_settings(self.session, "angles")
@@ -596,6 +597,8 @@ class StructMeasureTool(ToolInstance):
 
     def _set_angle_decimal_places(self, decimal_places):
         self._angle_fmt = "%%.%df\N{DEGREE SIGN}" % decimal_places
+        self._angle_decimal_places = decimal_places
+        self._angle_keys = {}
         self._update_angles()
 
     def _set_help(self, index):
@@ -639,11 +642,29 @@ class StructMeasureTool(ToolInstance):
                 death_row.append(i)
                 continue
             next_angle_info.append(angle_info)
-            self.angle_table.item(i, 4).setText(self._angle_text(atoms))
         self._angle_info = next_angle_info
         for row in reversed(death_row):
             self.angle_table.removeRow(row)
 
+        # Measure all angles, then all torsions, in one call and only reset
+        # the table text that changed.
+        from chimerax.atomic import concatenate
+        for group_size in (3, 4):
+            rows = [i for i, (atoms, n) in enumerate(self._angle_info) if n == group_size]
+            if not rows:
+                self._angle_keys.pop(group_size, None)
+                continue
+            atoms = concatenate([self._angle_info[i][0] for i in rows])
+            prev_rows, prev_keys = self._angle_keys.get(group_size, (None, None))
+            if prev_rows != rows:
+                prev_keys = None
+            values, keys, changed = atoms.measurement_text_changes(group_size,
+                self._angle_decimal_places, prev_keys)
+            self._angle_keys[group_size] = (rows, keys)
+            for row, value, value_changed in zip(rows, values, changed):
+                if value_changed:
+                    self.angle_table.item(row, 4).setText(self._angle_fmt % value)
+
 class AngstromOption(FloatOption):
     def __init__(self, *args, **kw):
         kw['right_text'] = "\N{ANGSTROM SIGN}"
@@ -26,6 +26,7 @@
 // Compute the loops resulting from a plane intersected with a surface.
 //
 //#include <iostream>			// use std::cerr for debugging
+#include <algorithm>			// use std::lower_bound, std::sort
 #include <map>				// use std::map
 #include <vector>			// use std::vector
 
@@ -54,18 +55,32 @@ class Index_Pair : public std::pair<int, int>
 typedef std::map<Index_Pair, Index_Pair> Edge_Map;
 
 // ----------------------------------------------------------------------------
+// Signed distance of vertices from plane computed from vertex heights along
+// the plane normal.
 //
-static void side_of_plane(float plane_normal[3], float plane_offset,
-			  const FArray &varray, std::vector<float> &side);
-static void calculate_plane_edges(const IArray &tarray,
-				  const std::vector<float> &side,
-				  Edge_Map &edges);
-static void calculate_loops(Edge_Map &edges, const FArray &varray,
-			    const std::vector<float> &side,
+class Plane_Side
+{
+ public:
+  Plane_Side(const float *height, float plane_offset)
+    : height(height), offset(plane_offset) {}
+  float operator[](int i) const { return height[i] - offset; }
+ private:
+  const float *height;
+  float offset;
+};
+
+// ----------------------------------------------------------------------------
+//
+static void vertex_heights(const float plane_normal[3], const FArray &varray,
+			   std::vector<float> &height);
+static void calculate_plane_edges(const int *t, int64_t m, const int *tsubset,
+				  const Plane_Side &side, Edge_Map &edges);
+static void calculate_loops(Edge_Map &edges, const float *v,
+			    const Plane_Side &side,
 			    Vertices &points, Loops &loops);
 static void add_plane_point(const Index_Pair &e0,
-			    const std::vector<float> &side,
-			    float *v, Vertices &points);
+			    const Plane_Side &side,
+			    const float *v, Vertices &points);
 
 // ----------------------------------------------------------------------------
 // Loops are formed by a consecutive sequence of vertex indices.
@@ -76,48 +91,111 @@ void calculate_border(float plane_normal[3], float plane_offset,
 		      Vertices &border_vertices, Loops &loops)
 {
   // Find which side of plane each surface vertex lies on.
-  std::vector<float> side;
-  side_of_plane(plane_normal, plane_offset, varray, side);
+  std::vector<float> height;
+  vertex_heights(plane_normal, varray, height);
+  Plane_Side side(height.data(), plane_offset);
 
   // Find surface triangles that intersect plane and record planar edges.
   Edge_Map edges;
-  calculate_plane_edges(tarray, side, edges);
+  IArray ctarray = tarray.contiguous_array();
+  calculate_plane_edges(ctarray.values(), tarray.size(0), NULL, side, edges);
 
   // Calculate loops in plane and xyz vertex positions in plane.
-  calculate_loops(edges, varray, side, border_vertices, loops);
+  FArray cvarray = varray.contiguous_array();
+  calculate_loops(edges, cvarray.values(), side, border_vertices, loops);
+}
+
+// ----------------------------------------------------------------------------
+// Triangles that can intersect the plane at a given offset are those whose
+// lowest vertex height is below the offset by no more than the largest
+// triangle height range.
+//
+Border_Cache::Border_Cache(const float plane_normal[3],
+			   const FArray &varray, const IArray &tarray)
+  : varray(varray.contiguous_array()), tarray(tarray.contiguous_array()), max_span(0)
+{
+  for (int a = 0 ; a < 3 ; ++a)
+    normal[a] = plane_normal[a];
+  vertex_heights(normal, this->varray, height);
+
+  int64_t m = tarray.size(0);
+  const int *t = this->tarray.values();
+  const float *h = height.data();
+  tlow.reserve(m);
+  for (int64_t k = 0 ; k < m ; ++k)
+    {
+      int i0 = t[3*k], i1 = t[3*k+1], i2 = t[3*k+2];
+      if (i0 == i1 || i0 == i2 || i1 == i2)
+	continue;	// Degenerate triangles are ignored.
+      float h0 = h[i0], h1 = h[i1], h2 = h[i2];
+      float hmin = std::min(h0, std::min(h1, h2)), hmax = std::max(h0, std::max(h1, h2));
+      if (hmax - hmin > max_span)
+	max_span = hmax - hmin;
+      tlow.push_back(std::make_pair(hmin, static_cast<int>(k)));
+    }
+  std::sort(tlow.begin(), tlow.end());
 }
 
 // ----------------------------------------------------------------------------
-// Calculate which side of plane each point is on.
 //
-static void side_of_plane(float plane_normal[3], float plane_offset,
-			  const FArray &varray, std::vector<float> &side)
+bool Border_Cache::has_normal(const float plane_normal[3]) const
+{
+  return (plane_normal[0] == normal[0] && plane_normal[1] == normal[1] &&
+	  plane_normal[2] == normal[2]);
+}
+
+// ----------------------------------------------------------------------------
+// Same result as calculate_border() for the cached surface and plane normal.
+//
+void Border_Cache::calculate_border(float plane_offset, Vertices &border_vertices,
+				    Loops &loops) const
+{
+  // Band of triangles with lowest vertex near below plane, in triangle order
+  // so the edge map is built exactly as by calculate_border().
+  double low = plane_offset - static_cast<double>(max_span) * (1 + 1e-6);
+  auto lt = [](const std::pair<float,int> &a, double h) { return a.first < h; };
+  auto b0 = std::lower_bound(tlow.begin(), tlow.end(), low, lt);
+  auto b1 = std::lower_bound(b0, tlow.end(), static_cast<double>(plane_offset), lt);
+  std::vector<int> band;
+  band.reserve(b1 - b0);
+  for (auto b = b0 ; b != b1 ; ++b)
+    band.push_back(b->second);
+  std::sort(band.begin(), band.end());
+
+  Plane_Side side(height.data(), plane_offset);
+  Edge_Map edges;
+  calculate_plane_edges(tarray.values(), band.size(), band.data(), side, edges);
+  calculate_loops(edges, varray.values(), side, border_vertices, loops);
+}
+
+// ----------------------------------------------------------------------------
+// Calculate the height of each point along the plane normal.
+//
+static void vertex_heights(const float plane_normal[3], const FArray &varray,
+			   std::vector<float> &height)
 {
   int64_t n = varray.size(0);
-  side.assign(n, 0.0);
+  height.assign(n, 0.0);
   FArray cvarray = varray.contiguous_array();
   float *v = cvarray.values();
   float nx = plane_normal[0], ny = plane_normal[1], nz = plane_normal[2];
   for (int64_t k = 0 ; k < n ; ++k)
     {
       int64_t k3 = 3 * k;
-      side[k] = nx * v[k3] + ny * v[k3+1] + nz * v[k3+2] - plane_offset;
+      height[k] = nx * v[k3] + ny * v[k3+1] + nz * v[k3+2];
     }
 }
 
 // ----------------------------------------------------------------------------
-// Calculate which side of plane each point is on.
+// Find the triangle edges crossing the plane, for m triangles, or for the
+// subset of m triangle indices if tsubset is not NULL.
 //
-static void calculate_plane_edges(const IArray &tarray,
-				  const std::vector<float> &side,
-				  Edge_Map &edges)
+static void calculate_plane_edges(const int *t, int64_t m, const int *tsubset,
+				  const Plane_Side &side, Edge_Map &edges)
 {
-  int64_t m = tarray.size(0);
-  IArray ctarray = tarray.contiguous_array();
-  int *t = ctarray.values();
-  for (int64_t k = 0 ; k < m ; ++k)
+  for (int64_t i = 0 ; i < m ; ++i)
     {
-      int64_t k3 = 3 * k;
+      int64_t k3 = 3 * (tsubset ? tsubset[i] : i);
       int i0 = t[k3], i1 = t[k3+1], i2 = t[k3+2];
       if (i0 == i1 || i0 == i2 || i1 == i2)
 	// Ignore degenerate triangles to avoid more than 2 triangles sharing an edge.
@@ -148,14 +226,11 @@ static void calculate_plane_edges(const IArray &tarray,
 // ----------------------------------------------------------------------------
 // Calculate loops in plane and xyz vertex positions in plane.
 //
-static void calculate_loops(Edge_Map &edges, const FArray &varray,
-			    const std::vector<float> &side,
+static void calculate_loops(Edge_Map &edges, const float *v,
+			    const Plane_Side &side,
 			    std::vector<float> &points,
 			    std::vector<Loop> &loops)
 {
-  FArray cvarray = varray.contiguous_array();
-  float *v = cvarray.values();
-
   //  int nc = 0;
   int start = 0, next = 0;
   while (edges.size() > 0)
@@ -200,13 +275,13 @@ static void calculate_loops(Edge_Map &edges, const FArray &varray,
 // Compute the intersection point of a surface triangle edge with the plane.
 //
 static void add_plane_point(const Index_Pair &e0,
-			    const std::vector<float> &side,
-			    float *v, std::vector<float> &points)
+			    const Plane_Side &side,
+			    const float *v, std::vector<float> &points)
 {
   int i0 = e0.first, i1 = e0.second;
   float s0 = side[i0], s1 = side[i1];
   float f0 = s1 / (s1 - s0), f1 = -s0 / (s1 - s0);
-  float *v0 = &(v[3*i0]), *v1 = &(v[3*i1]);
+  const float *v0 = &(v[3*i0]), *v1 = &(v[3*i1]);
   float x = f0 * v0[0] + f1 * v1[0];
   float y = f0 * v0[1] + f1 * v1[1];
   float z = f0 * v0[2] + f1 * v1[2];
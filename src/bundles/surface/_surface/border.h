@@ -45,6 +45,27 @@ void calculate_border(float plane_normal[3], float plane_offset,
 		      const FArray &varray, const IArray &tarray, /* Surface */
 		      Vertices &border_vertices, Loops &loops);
 
+// Vertex heights along a fixed plane normal and triangles sorted by lowest
+// vertex height, so borders at many plane offsets only examine the band of
+// triangles near the plane.
+class Border_Cache
+{
+ public:
+  Border_Cache(const float plane_normal[3],
+	       const FArray &varray, const IArray &tarray); /* Surface */
+  bool has_normal(const float plane_normal[3]) const;
+  void calculate_border(float plane_offset,
+			Vertices &border_vertices, Loops &loops) const;
+
+ private:
+  float normal[3];
+  FArray varray;		// Contiguous copies
+  IArray tarray;
+  std::vector<float> height;	// Vertex height along normal
+  std::vector<std::pair<float,int> > tlow;	// (lowest height, triangle)
+  float max_span;		// Largest triangle height range
+};
+
 }	// end of namespace Cap_Calculation
 
 #endif
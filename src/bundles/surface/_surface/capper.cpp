@@ -54,8 +54,50 @@ void compute_cap(float plane_normal[3], float plane_offset,
 		      cap_vertex_positions, cap_triangle_vertex_indices);
 }
 
+// ----------------------------------------------------------------------------
+//
+static void compute_cap(float plane_normal[3], float plane_offset,
+			const Border_Cache &cache,
+			Vertices &cap_vertex_positions,
+			Triangles &cap_triangle_vertex_indices)
+{
+  Loops loops;
+  cache.calculate_border(plane_offset, cap_vertex_positions, loops);
+  triangulate_polygon(loops, plane_normal,
+		      cap_vertex_positions, cap_triangle_vertex_indices);
+}
+
 }	// end of namespace Cap_Calculation
 
+// ----------------------------------------------------------------------------
+//
+static void delete_border_cache(PyObject *capsule)
+{
+  delete static_cast<Cap_Calculation::Border_Cache *>(PyCapsule_GetPointer(capsule, "Border_Cache"));
+}
+
+// ----------------------------------------------------------------------------
+//
+extern "C" PyObject *cap_cache(PyObject *, PyObject *args, PyObject *keywds)
+{
+  float normal[3];
+  FArray varray;
+  IArray tarray;
+  const char *kwlist[] = {"normal", "vertices", "triangles", NULL};
+  if (!PyArg_ParseTupleAndKeywords(args, keywds,
+				   const_cast<char *>("O&O&O&"), (char **)kwlist,
+				   parse_float_3_array, normal,
+				   parse_float_n3_array, &varray,
+				   parse_int_n3_array, &tarray))
+    return NULL;
+
+  Cap_Calculation::Border_Cache *cache;
+  Py_BEGIN_ALLOW_THREADS
+  cache = new Cap_Calculation::Border_Cache(normal, varray, tarray);
+  Py_END_ALLOW_THREADS
+  return PyCapsule_New(cache, "Border_Cache", delete_border_cache);
+}
+
 // ----------------------------------------------------------------------------
 //
 extern "C" PyObject *compute_cap(PyObject *, PyObject *args, PyObject *keywds)
@@ -63,18 +105,38 @@ extern "C" PyObject *compute_cap(PyObject *, PyObject *args, PyObject *keywds)
   float normal[3], c;
   FArray varray;
   IArray tarray;
-  const char *kwlist[] = {"normal", "offset", "vertices", "triangles", NULL};
+  PyObject *py_cache = NULL;
+  const char *kwlist[] = {"normal", "offset", "vertices", "triangles", "cache", NULL};
   if (!PyArg_ParseTupleAndKeywords(args, keywds,
-				   const_cast<char *>("O&fO&O&"), (char **)kwlist,
+				   const_cast<char *>("O&fO&O&|O"), (char **)kwlist,
 				   parse_float_3_array, normal, &c,
 				   parse_float_n3_array, &varray,
-				   parse_int_n3_array, &tarray))
+				   parse_int_n3_array, &tarray,
+				   &py_cache))
     return NULL;
 
+  Cap_Calculation::Border_Cache *cache = NULL;
+  if (py_cache != NULL && py_cache != Py_None)
+    {
+      cache = static_cast<Cap_Calculation::Border_Cache *>(PyCapsule_GetPointer(py_cache, "Border_Cache"));
+      if (cache == NULL)
+	return NULL;
+      if (!cache->has_normal(normal))
+	{
+	  PyErr_SetString(PyExc_ValueError, "compute_cap: cache was made for a different plane normal");
+	  return NULL;
+	}
+    }
+
   std::vector<float> cap_vertex_xyz;
   std::vector<int> cap_tv_indices;
-  Cap_Calculation::compute_cap(normal, c, varray, tarray,
-			       cap_vertex_xyz, cap_tv_indices);
+  Py_BEGIN_ALLOW_THREADS
+  if (cache)
+    Cap_Calculation::compute_cap(normal, c, *cache, cap_vertex_xyz, cap_tv_indices);
+  else
+    Cap_Calculation::compute_cap(normal, c, varray, tarray,
+				 cap_vertex_xyz, cap_tv_indices);
+  Py_END_ALLOW_THREADS
 
   float *vxyz = (cap_vertex_xyz.size() == 0 ? NULL : &cap_vertex_xyz.front());
   int *ti = (cap_tv_indices.size() == 0 ? NULL : &cap_tv_indices.front());
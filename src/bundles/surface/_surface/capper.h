@@ -35,7 +35,12 @@
 extern "C"
 {
 // void compute_cap(plane_normal, plane_offset, varray, tarray) -> cap_varray, cap_tarray
+// Optional cache from cap_cache() for the same surface and normal avoids
+// examining triangles far from the plane.
 PyObject *compute_cap(PyObject *, PyObject *args, PyObject *keywds);
+
+// PyObject *cap_cache(plane_normal, varray, tarray) -> capsule
+PyObject *cap_cache(PyObject *, PyObject *args, PyObject *keywds);
 }
 
 #endif
@@ -28,6 +28,7 @@
 //
 //#include <iostream>		// use std::cerr for debugging
 #include <algorithm>		// use std::sort
+#include <atomic>		// use std::atomic
 #include <set>			// use std::set
 #include <utility>		// use std::pair
 #include <vector>		// use std::vector
@@ -36,6 +37,7 @@
 
 #include <arrays/pythonarray.h>	// use array_from_python()
 #include <arrays/rcarray.h>	// use IArray
+#include <arrays/threadpool.h>	// use Thread_Pool::thread_count(), run()
 
 static void connected_triangles(const IArray &tarray, int tindex,
 				std::vector<int> &tlist);
@@ -58,7 +60,9 @@ extern "C" PyObject *connected_triangles(PyObject *, PyObject *args, PyObject *k
     return NULL;
 
   std::vector<int> tlist;
+  Py_BEGIN_ALLOW_THREADS
   connected_triangles(tarray, tindex, tlist);
+  Py_END_ALLOW_THREADS
   int *ti = (tlist.size() == 0 ? NULL : &tlist.front());
   PyObject *py_tlist = c_array_to_python(ti, tlist.size());
   return py_tlist;
@@ -79,7 +83,9 @@ extern "C" PyObject *triangle_vertices(PyObject *, PyObject *args, PyObject *key
   IArray ta = tarray.contiguous_array();
   IArray tl = tlist.contiguous_array();
   std::vector<int> vlist;
+  Py_BEGIN_ALLOW_THREADS
   triangle_vertices(ta.values(), tl.values(), tl.size(), vlist);
+  Py_END_ALLOW_THREADS
   int *vi = (vlist.size() == 0 ? NULL : &vlist.front());
   PyObject *py_vlist = c_array_to_python(vi, vlist.size());
   return py_vlist;
@@ -258,14 +264,196 @@ extern "C" PyObject *connected_pieces(PyObject *, PyObject *args, PyObject *keyw
 				   parse_int_n3_array, &tarray))
     return NULL;
 
-  Surface_Pieces sp(tarray);
-  int pc = static_cast<int>(sp.pieces.size());
+  Surface_Pieces *sp;
+  Py_BEGIN_ALLOW_THREADS
+  sp = new Surface_Pieces(tarray);
+  Py_END_ALLOW_THREADS
+  int pc = static_cast<int>(sp->pieces.size());
   PyObject *plist = PyTuple_New(pc);
   for (int c = 0 ; c < pc ; ++c)
     {
-      PyObject *vt = python_tuple(python_array(*sp.pieces[c].first),
-				  python_array(*sp.pieces[c].second));
+      PyObject *vt = python_tuple(python_array(*sp->pieces[c].first),
+				  python_array(*sp->pieces[c].second));
       PyTuple_SetItem(plist, c, vt);
     }
+  delete sp;
   return plist;
 }
+
+// ----------------------------------------------------------------------------
+// Union-find forest over vertex indices that many threads can join at once.
+// Each root is the lowest vertex index in its set because a root is always
+// linked under a lower root.  Links are made with compare and exchange so no
+// locks are needed.
+//
+class Vertex_Sets
+{
+public:
+  Vertex_Sets(int nv) : parent(nv)
+    {
+      for (int v = 0 ; v < nv ; ++v)
+	parent[v].store(v, std::memory_order_relaxed);
+    }
+  int root(int v)
+    {
+      while (true)
+	{
+	  int p = parent[v].load(std::memory_order_relaxed);
+	  if (p == v)
+	    return v;
+	  int gp = parent[p].load(std::memory_order_relaxed);
+	  if (gp != p)
+	    parent[v].compare_exchange_weak(p, gp, std::memory_order_relaxed);	// Path halving
+	  v = gp;
+	}
+    }
+  void join(int v1, int v2)
+    {
+      while (true)
+	{
+	  v1 = root(v1);
+	  v2 = root(v2);
+	  if (v1 == v2)
+	    return;
+	  if (v1 < v2)
+	    std::swap(v1, v2);
+	  // Another thread may have linked v1 since it was found to be a root.
+	  int expected = v1;
+	  if (parent[v1].compare_exchange_strong(expected, v2, std::memory_order_relaxed))
+	    return;
+	}
+    }
+private:
+  std::vector<std::atomic<int> > parent;
+};
+
+// ----------------------------------------------------------------------------
+//
+static int triangle_thread_count(int tc)
+{
+  // Threads are not worth using for small surfaces.
+  return Thread_Pool::thread_count(tc, 100000);
+}
+
+// ----------------------------------------------------------------------------
+// Label each triangle with the connected piece it belongs to, numbering pieces
+// in order of their first triangle.  Triangles are joined on shared pool threads.  Returns
+// the number of pieces.
+//
+static int triangle_piece_labels(const IArray &tarray, int *tpiece, std::vector<int> &tcount)
+{
+  int tc = tarray.size(0);
+  if (tc == 0)
+    return 0;
+  int64_t s0 = tarray.stride(0), s1 = tarray.stride(1);
+  const int *tv = tarray.values();
+  int vc = maximum_triangle_vertex_index(tarray) + 1;
+  Vertex_Sets sets(vc);
+
+  int nt = triangle_thread_count(tc);
+  auto join_triangles = [&](int t0, int t1) {
+    for (int t = t0 ; t < t1 ; ++t)
+      {
+	const int *tt = tv + s0*t;
+	sets.join(tt[0], tt[s1]);
+	sets.join(tt[0], tt[2*s1]);
+      }
+  };
+  Thread_Pool::run(nt, [&](int i) {
+      join_triangles((int64_t)tc*i/nt, (int64_t)tc*(i+1)/nt);
+    });
+
+  std::vector<int> root_piece(vc, -1);
+  int pc = 0;
+  for (int t = 0 ; t < tc ; ++t)
+    {
+      int r = sets.root(tv[s0*t]);
+      int p = root_piece[r];
+      if (p < 0)
+	{
+	  p = root_piece[r] = pc++;
+	  tcount.push_back(0);
+	}
+      tpiece[t] = p;
+      tcount[p] += 1;
+    }
+  return pc;
+}
+
+// ----------------------------------------------------------------------------
+// Bounding box of the vertices of each piece, pieces given by triangle labels.
+//
+static void piece_bounds(const FArray &varray, const IArray &tarray, const int *tpiece,
+			 int pc, float *bounds)
+{
+  for (int p = 0 ; p < pc ; ++p)
+    {
+      float *b = bounds + 6*p;
+      b[0] = b[1] = b[2] = 1e30f;
+      b[3] = b[4] = b[5] = -1e30f;
+    }
+  int tc = tarray.size(0);
+  int64_t s0 = tarray.stride(0), s1 = tarray.stride(1);
+  const int *tv = tarray.values();
+  int64_t vs0 = varray.stride(0), vs1 = varray.stride(1);
+  const float *va = varray.values();
+  for (int t = 0 ; t < tc ; ++t)
+    {
+      float *b = bounds + 6*tpiece[t];
+      for (int c = 0 ; c < 3 ; ++c)
+	{
+	  const float *xyz = va + vs0*tv[s0*t+c*s1];
+	  for (int a = 0 ; a < 3 ; ++a)
+	    {
+	      float x = xyz[a*vs1];
+	      b[a] = std::min(b[a], x);
+	      b[a+3] = std::max(b[a+3], x);
+	    }
+	}
+    }
+}
+
+// ----------------------------------------------------------------------------
+//
+extern "C" PyObject *triangle_pieces(PyObject *, PyObject *args, PyObject *keywds)
+{
+  IArray tarray;
+  FArray varray;
+  const char *kwlist[] = {"triangles", "vertices", NULL};
+  if (!PyArg_ParseTupleAndKeywords(args, keywds,
+				   const_cast<char *>("O&|O&"), (char **)kwlist,
+				   parse_int_n3_array, &tarray,
+				   parse_float_n3_array, &varray))
+    return NULL;
+
+  int tc = tarray.size(0);
+  bool have_vertices = (varray.dimension() == 2);
+  if (have_vertices && tc > 0 && maximum_triangle_vertex_index(tarray) >= varray.size(0))
+    {
+      PyErr_SetString(PyExc_ValueError, "triangle_pieces(): triangles refer to vertex index beyond end of vertex array");
+      return NULL;
+    }
+
+  int *tpiece;
+  PyObject *py_tpiece = python_int_array(tc, &tpiece);
+  std::vector<int> tcount;
+  int pc;
+  Py_BEGIN_ALLOW_THREADS
+  pc = triangle_piece_labels(tarray, tpiece, tcount);
+  Py_END_ALLOW_THREADS
+
+  PyObject *py_tcount = c_array_to_python(tcount.data(), pc);
+  PyObject *py_bounds;
+  if (have_vertices)
+    {
+      float *bounds;
+      py_bounds = python_float_array(pc, 2, 3, &bounds);
+      Py_BEGIN_ALLOW_THREADS
+      piece_bounds(varray, tarray, tpiece, pc, bounds);
+      Py_END_ALLOW_THREADS
+    }
+  else
+    py_bounds = python_none();
+
+  return python_tuple(py_tpiece, py_tcount, py_bounds);
+}
@@ -52,6 +52,14 @@ PyObject *triangle_vertices(PyObject *s, PyObject *args, PyObject *keywds);
 //
 // Args: triangle_array (N by 3 int)
 PyObject *connected_pieces(PyObject *s, PyObject *args, PyObject *keywds);
+
+//
+// Return the connected piece number for each triangle, the number of
+// triangles in each piece, and if vertices are given the bounding box of
+// each piece.  Pieces are numbered in order of their first triangle.
+//
+// Args: triangle_array (N by 3 int), vertex_array (M by 3 float, optional)
+PyObject *triangle_pieces(PyObject *s, PyObject *args, PyObject *keywds);
 }
 
 #endif
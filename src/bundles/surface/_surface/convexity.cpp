@@ -26,6 +26,7 @@
 
 // ----------------------------------------------------------------------------
 //
+#include <algorithm>		// use std::sort, std::min
 #include <iostream>		// use std::cerr for debugging
 #include <map>			// use std::map
 #include <utility>		// use std::pair
@@ -36,18 +37,24 @@
 
 #include <arrays/pythonarray.h>	// use parse_*()
 #include <arrays/rcarray.h>	// use IArray, FArray, DArray
+#include <arrays/threadpool.h>	// use Thread_Pool::thread_count(), run()
 
-typedef std::pair<int, int> Edge;
-typedef std::vector<int> TriangleIndices;
-typedef std::map<Edge, TriangleIndices> EdgeTriangles;
-typedef std::vector<int> VertexIndices;
-typedef std::vector<VertexIndices> VertexNeighbors;
+// An edge oriented as in the first triangle using it, with the first two
+// triangles using it.
+class EdgeTriangles
+{
+public:
+  int v1, v2;
+  int t1, t2;
+  int count;	// Number of triangles using this edge.
+};
+typedef std::vector<EdgeTriangles> Edges;	// Sorted by v1, then v2.
 
 static void convexity(const FArray &varray, const IArray &tarray, int smoothing_iterations, DArray &cvalues);
 static double bend_angle(float *n1, float *n2, float *e);
 static FArray triangle_normals(const FArray &varray, const IArray &tarray);
-static void edge_triangles(const IArray &tarray, EdgeTriangles &et);
-static void smooth_surface_values(const FArray &varray, EdgeTriangles &edges,
+static void edge_triangles(const IArray &tarray, Edges &et);
+static void smooth_surface_values(const FArray &varray, const Edges &edges,
 				  DArray &values, int smoothing_iterationsy);
 static int *unique_vertices(FArray varray);
 static IArray nondegenerate_triangles(IArray tarray, int *vmap);
@@ -84,6 +91,7 @@ extern "C" PyObject *vertex_convexity(PyObject *, PyObject *args, PyObject *keyw
 
   //convexity(varray, tarray, smoothing_iterations, carray);
 
+  Py_BEGIN_ALLOW_THREADS
   int *vmap = unique_vertices(varray);
   if (vmap == NULL)
     convexity(varray, tarray, smoothing_iterations, carray);
@@ -100,6 +108,7 @@ extern "C" PyObject *vertex_convexity(PyObject *, PyObject *args, PyObject *keyw
 	ca[i*cs0] = ca[vmap[i]*cs0];
       delete [] vmap;
     }
+  Py_END_ALLOW_THREADS
 
   return result;
 }
@@ -111,7 +120,7 @@ static void convexity(const FArray &varray, const IArray &tarray, int smoothing_
 {
   FArray tnormals = triangle_normals(varray, tarray);
   float *tn = tnormals.values();
-  EdgeTriangles et;
+  Edges et;
   edge_triangles(tarray, et);
 
   float *va = varray.values();
@@ -120,14 +129,12 @@ static void convexity(const FArray &varray, const IArray &tarray, int smoothing_
   int64_t cs0 = cvalues.stride(0);
   float e[3];
   // Cone angle is sphere area which equals n*pi - sum of bend angles of spherical polygon.
-  for (auto eti = et.begin() ; eti != et.end() ; ++eti)
+  for (auto &ed: et)
     {
-      TriangleIndices &tri = eti->second;
-      if (tri.size() != 2)
+      if (ed.count != 2)
 	continue;
-      int t1 = tri[0], t2 = tri[1];
-      const Edge &ed = eti->first;
-      int v1 = ed.first, v2 = ed.second;
+      int t1 = ed.t1, t2 = ed.t2;
+      int v1 = ed.v1, v2 = ed.v2;
       for (int i = 0 ; i < 3 ; ++i)
 	e[i] = va[vs0*v2+vs1*i]-va[vs0*v1+vs1*i];
       double a = bend_angle(tn+3*t1, tn+3*t2, e);
@@ -192,11 +199,21 @@ static FArray triangle_normals(const FArray &varray, const IArray &tarray)
 
 // ----------------------------------------------------------------------------
 //
-static void edge_triangles(const IArray &tarray, EdgeTriangles &et)
+static void edge_triangles(const IArray &tarray, Edges &et)
 {
   int *ta = tarray.values();
   int64_t ts0 = tarray.stride(0), ts1 = tarray.stride(1);
   int nt = tarray.size(0);
+
+  // Sort triangle edges so uses of an edge are together in triangle order.
+  class Edge_Use
+  {
+  public:
+    uint64_t key;	// Lower vertex index in high 32 bits.
+    int64_t order;	// 3 * triangle + edge
+    int va, vb;
+  };
+  std::vector<Edge_Use> uses(3*static_cast<int64_t>(nt));
   int v[3];
   for (int t = 0 ; t < nt ; ++t)
     {
@@ -204,53 +221,94 @@ static void edge_triangles(const IArray &tarray, EdgeTriangles &et)
       for (int e = 0 ; e < 3 ; ++e)
 	{
 	  int va = v[e], vb = v[(e+1)%3];
-	  Edge eba(vb, va);
-	  EdgeTriangles::iterator ei = et.find(eba);
-	  if (ei != et.end())
-	    ei->second.push_back(t);
-	  else
-	    {
-	      Edge eab(va,vb);
-	      et[eab].push_back(t);
-	    }
+	  uint64_t vmin = (va < vb ? va : vb), vmax = (va < vb ? vb : va);
+	  Edge_Use &u = uses[3*t+e];
+	  u.key = (vmin << 32) | vmax;
+	  u.order = 3*t+e;
+	  u.va = va;
+	  u.vb = vb;
 	}
     }
+  std::sort(uses.begin(), uses.end(), [](const Edge_Use &u1, const Edge_Use &u2)
+	    { return u1.key < u2.key || (u1.key == u2.key && u1.order < u2.order); });
+
+  et.clear();
+  int64_t nu = uses.size();
+  for (int64_t i = 0 ; i < nu ; )
+    {
+      const Edge_Use &u = uses[i];
+      EdgeTriangles ed;
+      ed.v1 = u.va; ed.v2 = u.vb;
+      ed.t1 = u.order/3;
+      ed.t2 = -1;
+      int64_t j = i+1;
+      for ( ; j < nu && uses[j].key == u.key ; ++j)
+	if (j == i+1)
+	  ed.t2 = uses[j].order/3;
+      ed.count = j-i;
+      et.push_back(ed);
+      i = j;
+    }
+  // Order edges by first then second vertex of their orientation.
+  std::sort(et.begin(), et.end(), [](const EdgeTriangles &e1, const EdgeTriangles &e2)
+	    { return e1.v1 < e2.v1 || (e1.v1 == e2.v1 && e1.v2 < e2.v2); });
 }
  
 // ----------------------------------------------------------------------------
+// Average values over each vertex and its edge neighbors.  Vertex neighbors
+// are kept in compressed row form and each iteration uses only the previous
+// iteration values so vertex ranges are averaged on separate threads.
 //
-static void smooth_surface_values(const FArray &varray, EdgeTriangles &edges,
+static void smooth_surface_values(const FArray &varray, const Edges &edges,
 				  DArray &values, int smoothing_iterations)
 {
   int nv = varray.size(0);
-  VertexNeighbors vn(nv);
+  std::vector<int64_t> start(nv+1, 1);
+  start[0] = 0;
+  for (auto &e: edges)
+    {
+      start[e.v1+1] += 1;
+      start[e.v2+1] += 1;
+    }
+  for (int i = 0 ; i < nv ; ++i)
+    start[i+1] += start[i];
+  std::vector<int> neighbors(start[nv]);
+  std::vector<int64_t> fill(start.begin(), start.end()-1);
   for (int i = 0 ; i < nv ; ++i)
-    vn[i].push_back(i);
-  for (auto eti = edges.begin() ; eti != edges.end() ; ++eti)
+    neighbors[fill[i]++] = i;
+  for (auto &e: edges)
     {
-      const Edge &e = eti->first;
-      int va = e.first, vb = e.second;
-      vn[va].push_back(vb);
-      vn[vb].push_back(va);
+      neighbors[fill[e.v1]++] = e.v2;
+      neighbors[fill[e.v2]++] = e.v1;
     }
 
-  double *vals = values.values();
+  std::vector<double> vals(nv), values2(nv);
+  double *va = values.values();
   int64_t vs0 = values.stride(0);
-  double *values2 = new double [nv];
+  for (int i = 0 ; i < nv ; ++i)
+    vals[i] = va[vs0*i];
+
+  auto average_range = [&](int i0, int i1) {
+    for (int i = i0 ; i < i1 ; ++i)
+      {
+	int64_t j0 = start[i], j1 = start[i+1];
+	double vsum = 0;
+	for (int64_t j = j0 ; j < j1 ; ++j)
+	  vsum += vals[neighbors[j]];
+	values2[i] = vsum / (j1 - j0);
+      }
+  };
+  int nt = Thread_Pool::thread_count(nv, 100000);
   for (int r = 0 ; r < smoothing_iterations ; ++r)
     {
-      for (int i = 0 ; i < nv ; ++i)
-	{
-	  VertexIndices &vi = vn[i];
-	  size_t nvi = vi.size();
-	  double vsum = 0;
-	  for (size_t j = 0 ; j < nvi ; ++j)
-	    vsum += vals[vs0*vi[j]];
-	  values2[i] = vsum / nvi;
-	}
-      for (int i = 0 ; i < nv ; ++i)
-        vals[vs0*i] = values2[i];
+      Thread_Pool::run(nt, [&](int t) {
+	  average_range((int64_t)nv*t/nt, (int64_t)nv*(t+1)/nt);
+	});
+      vals.swap(values2);
     }
+
+  for (int i = 0 ; i < nv ; ++i)
+    va[vs0*i] = vals[i];
 }
  
 // ----------------------------------------------------------------------------
@@ -24,36 +24,55 @@
  * === UCSF ChimeraX Copyright ===
  */
 
-// ----------------------------------------------------------------------------
-//
 #include <Python.h>			// use PyObject
 
 #include <math.h>			// use sqrt()
 
-#include <map>				// use std::map
-#include <set>				// use std::set
+#include <algorithm>			// use std::sort, std::lower_bound
+#include <atomic>			// use std::atomic
 #include <utility>			// use std::pair
 #include <vector>			// use std::vector
 
 #include <arrays/pythonarray.h>		// use array_from_python()
 #include <arrays/rcarray.h>		// use FArray, IArray
+#include <arrays/threadpool.h>		// use Thread_Pool::thread_count(), run()
 
 typedef std::pair<int,int> Edge;
-typedef std::set<Edge> Edge_Set;
+typedef std::vector<Edge> Edge_List;	// Sorted directed edges.
 typedef std::vector<int> Vertex_Loop;
 typedef std::vector<Vertex_Loop> Vertex_Loops;
 
-static float enclosed_volume(FArray &varray, const IArray &tarray,
-			     int *hole_count);
-static float tetrahedron_signed_volume(float v0[3], float v1[3], float v2[3],
-				       float v3[3]);
-static Edge_Set *boundary_edge_set(const IArray &tarray);
-static Vertex_Loops *boundary_loops(const IArray &tarray);
-static float cap_volume(float *v, const Vertex_Loops &vloops);
-static void loop_center(float *v, const Vertex_Loop &vloop, float center[3]);
-static float surface_area(FArray &varray, const IArray &tarray,
-			  float *areas = NULL);
-static float triangle_area(float v0[3], float v1[3], float v2[3]);
+static float enclosed_volume(const float *v, const int *tv, int64_t m,
+			     int *hole_count, bool threaded = true);
+static float tetrahedron_signed_volume(const float v0[3], const float v1[3],
+				       const float v2[3], const float v3[3]);
+static Edge_List *boundary_edge_list(const int *tv, int64_t m);
+static Vertex_Loops *boundary_loops(const Edge_List &edges);
+static float cap_volume(const float *v, const Vertex_Loops &vloops);
+static void loop_center(const float *v, const Vertex_Loop &vloop, float center[3]);
+static float surface_area(const float *v, const int *tv, int64_t m,
+			  float *areas = NULL, bool threaded = true);
+static float triangle_area(const float v0[3], const float v1[3], const float v2[3]);
+
+// ----------------------------------------------------------------------------
+// Sum f(i0,i1) over chunks of [0,n) computed in parallel.  Partial sums are
+// added in chunk order so the result does not depend on thread timing.
+//
+template <class F>
+static double threaded_sum(int64_t n, bool threaded, F f)
+{
+  int64_t nt = (threaded ? Thread_Pool::thread_count(n, 100000) : 1);
+  if (nt <= 1)
+    return f(0, n);
+
+  std::vector<double> sums(nt, 0);
+  Thread_Pool::run(nt, [&](int t) { sums[t] = f(n*t/nt, n*(t+1)/nt); });
+
+  double sum = 0;
+  for (int64_t t = 0 ; t < nt ; ++t)
+    sum += sums[t];
+  return sum;
+}
 
 // ----------------------------------------------------------------------------
 //
@@ -68,35 +87,38 @@ extern "C" PyObject *enclosed_volume(PyObject *, PyObject *args, PyObject *keywd
 				   parse_int_n3_array, &tarray))
     return NULL;
 
+  FArray vc = varray.contiguous_array();
+  IArray tc = tarray.contiguous_array();
   int hole_count;
-  float vol = enclosed_volume(varray, tarray, &hole_count);
+  float vol;
+  Py_BEGIN_ALLOW_THREADS
+  vol = enclosed_volume(vc.values(), tc.values(), tarray.size(0), &hole_count);
+  Py_END_ALLOW_THREADS
   PyObject *vh = python_tuple(PyFloat_FromDouble(vol), PyLong_FromLong(hole_count));
   return vh;
 }
 
 // ----------------------------------------------------------------------------
 //
-static float enclosed_volume(FArray &varray, const IArray &tarray,
-			     int *hole_count)
+static float enclosed_volume(const float *v, const int *tv, int64_t m,
+			     int *hole_count, bool threaded)
 {
-  Vertex_Loops *vloops = boundary_loops(tarray);
+  Edge_List *edges = boundary_edge_list(tv, m);
+  Vertex_Loops *vloops = boundary_loops(*edges);
+  delete edges;
   if (vloops == NULL)
     { *hole_count = 0; return -1.0; }
   *hole_count = static_cast<int>(vloops->size());
 
-  FArray vc = varray.contiguous_array();
-  float *v = vc.values();
-
-  IArray tc = tarray.contiguous_array();
-  int m = tarray.size(0);
-  int *tv = tc.values();
-
-  float volume = 0;
-  for (int t = 0 ; t < m ; ++t)
-    {
-      int i0 = tv[3*t], i1 = tv[3*t+1], i2 = tv[3*t+2];
-      volume += tetrahedron_signed_volume(v, v+3*i0, v+3*i1, v+3*i2);
-    }
+  float volume = threaded_sum(m, threaded, [v,tv](int64_t t0, int64_t t1) {
+      double vol = 0;
+      for (int64_t t = t0 ; t < t1 ; ++t)
+	{
+	  int i0 = tv[3*t], i1 = tv[3*t+1], i2 = tv[3*t+2];
+	  vol += tetrahedron_signed_volume(v, v+3*i0, v+3*i1, v+3*i2);
+	}
+      return vol;
+    });
 
   volume += cap_volume(v, *vloops);
   delete vloops;
@@ -109,8 +131,8 @@ static float enclosed_volume(FArray &varray, const IArray &tarray,
 
 // ----------------------------------------------------------------------------
 //
-static float tetrahedron_signed_volume(float v0[3], float v1[3], float v2[3],
-				       float v3[3])
+static float tetrahedron_signed_volume(const float v0[3], const float v1[3],
+				       const float v2[3], const float v3[3])
 {
 
   float e1x = v1[0]-v0[0], e1y = v1[1]-v0[1], e1z = v1[2]-v0[2];
@@ -123,61 +145,112 @@ static float tetrahedron_signed_volume(float v0[3], float v1[3], float v2[3],
 }
 
 // ----------------------------------------------------------------------------
+// Directed edges not cancelled by an oppositely directed edge.  Edge uses are
+// bucketed by lower vertex index then sorted within each bucket, keeping
+// triangle order for each edge, and each edge's uses are replayed as if added
+// to a set, removing an edge when its reverse is already present.  Returned
+// edges are sorted.
 //
-static Edge_Set *boundary_edge_set(const IArray &tarray)
+static Edge_List *boundary_edge_list(const int *tv, int64_t m)
 {
-  IArray tc = tarray.contiguous_array();
-  int m = tarray.size(0);
-  int *tv = tc.values();
+  Edge_List *edges = new Edge_List;
+  if (m == 0)
+    return edges;
+
+  int vmax = 0;
+  for (int64_t e = 0 ; e < 3*m ; ++e)
+    if (tv[e] > vmax)
+      vmax = tv[e];
+
+  std::vector<int64_t> bstart(vmax+2, 0);
+  for (int64_t e = 0 ; e < 3*m ; ++e)
+    {
+      int i0 = tv[e], i1 = tv[e%3 == 2 ? e-2 : e+1];
+      bstart[(i0 < i1 ? i0 : i1) + 1] += 1;
+    }
+  for (int v = 0 ; v <= vmax ; ++v)
+    bstart[v+1] += bstart[v];
+
+  // Edge uses as higher vertex index and triangle edge index.
+  std::vector<int64_t> bfill(bstart.begin(), bstart.end()-1);
+  std::vector<std::pair<int,int64_t> > uses(3*m);
+  for (int64_t e = 0 ; e < 3*m ; ++e)
+    {
+      int i0 = tv[e], i1 = tv[e%3 == 2 ? e-2 : e+1];
+      if (i0 < i1)
+	uses[bfill[i0]++] = std::make_pair(i1, e);
+      else
+	uses[bfill[i1]++] = std::make_pair(i0, e);
+    }
 
-  Edge_Set *eset = new Edge_Set;
-  Edge_Set::iterator ei;
-  for (int t = 0 ; t < m ; ++t)
+  for (int vlow = 0 ; vlow <= vmax ; ++vlow)
     {
-      int i0 = tv[3*t], i1 = tv[3*t+1], i2 = tv[3*t+2];
-      if ((ei = eset->find(Edge(i1,i0))) != eset->end()) eset->erase(ei);
-      else eset->insert(Edge(i0,i1));
-      if ((ei = eset->find(Edge(i2,i1))) != eset->end()) eset->erase(ei);
-      else eset->insert(Edge(i1,i2));
-      if ((ei = eset->find(Edge(i0,i2))) != eset->end()) eset->erase(ei);
-      else eset->insert(Edge(i2,i0));
+      int64_t b0 = bstart[vlow], b1 = bstart[vlow+1];
+      std::sort(uses.begin() + b0, uses.begin() + b1);
+      for (int64_t u = b0, ue ; u < b1 ; u = ue)
+	{
+	  int vhigh = uses[u].first;
+	  for (ue = u+1 ; ue < b1 && uses[ue].first == vhigh ; ++ue) ;
+	  bool up = false, down = false;	// Have edge low to high, high to low.
+	  for (int64_t k = u ; k < ue ; ++k)
+	    {
+	      if (vlow == vhigh)
+		up = !up;
+	      else if (tv[uses[k].second] == vlow)
+		{ if (down) down = false; else up = true; }
+	      else
+		{ if (up) up = false; else down = true; }
+	    }
+	  if (up)
+	    edges->push_back(Edge(vlow,vhigh));
+	  if (down)
+	    edges->push_back(Edge(vhigh,vlow));
+	}
     }
-  return eset;
+  std::sort(edges->begin(), edges->end());
+
+  return edges;
 }
 
 // ----------------------------------------------------------------------------
-// Returns NULL if surface is not oriented.
 //
-static Vertex_Loops *boundary_loops(const IArray &tarray)
+static bool has_edge(const Edge_List &edges, const Edge &e)
 {
-  Edge_Set *eset = boundary_edge_set(tarray);
+  return std::binary_search(edges.begin(), edges.end(), e);
+}
 
-  // Map one vertex to next along directed boundary.
-  std::map<int,int> vmap;
-  for (Edge_Set::iterator ei = eset->begin() ; ei != eset->end() ; ++ei)
-    {
-      if (vmap.find(ei->first) == vmap.end())
-	vmap[ei->first] = ei->second;
-      else
-	{ delete eset; return NULL; }
-    }
-  delete eset;
+// ----------------------------------------------------------------------------
+// Returns NULL if surface is not oriented.
+//
+static Vertex_Loops *boundary_loops(const Edge_List &edges)
+{
+  // Each vertex must start only one directed boundary edge.
+  int64_t ne = edges.size();
+  for (int64_t e = 1 ; e < ne ; ++e)
+    if (edges[e].first == edges[e-1].first)
+      return NULL;
 
   // Record boundary loops.
   Vertex_Loops *vloops = new std::vector<Vertex_Loop>;
-  while (!vmap.empty())
+  std::vector<bool> used(ne, false);
+  for (int64_t e0 = 0 ; e0 < ne ; ++e0)
     {
-      std::map<int,int>::iterator vmi = vmap.begin();
+      if (used[e0])
+	continue;
       Vertex_Loop vloop;
+      int64_t e = e0;
       while (true)
 	{
-	  vloop.push_back(vmi->first);
-	  int v = vmi->second;
-	  vmap.erase(vmi);
+	  vloop.push_back(edges[e].first);
+	  used[e] = true;
+	  int v = edges[e].second;
 	  if (v == vloop[0])
 	    break;
-	  vmi = vmap.find(v);
-	  if (vmi == vmap.end())
+	  Edge_List::const_iterator ei = std::lower_bound(edges.begin(), edges.end(),
+							   Edge(v, 0), [](const Edge &a, const Edge &b)
+							   { return a.first < b.first; });
+	  e = ei - edges.begin();
+	  if (ei == edges.end() || ei->first != v || used[e])
 	    { delete vloops; return NULL; }
 	}
       vloops->push_back(vloop);
@@ -185,29 +258,32 @@ static Vertex_Loops *boundary_loops(const IArray &tarray)
   return vloops;
 }
 
-
 // ----------------------------------------------------------------------------
-// Returns NULL if surface is not oriented.
 //
 static void boundary_edge_mask(const IArray &tarray, unsigned char *edge_mask)
 {
-  Edge_Set *eset = boundary_edge_set(tarray);
-  int64_t s0 = tarray.stride(0), s1 = tarray.stride(1);
-  int n = tarray.size(0);
-  int *ta = tarray.values();
+  IArray tc = tarray.contiguous_array();
+  int64_t n = tarray.size(0);
+  int *ta = tc.values();
+  Edge_List *edges = boundary_edge_list(ta, n);
+  const Edge_List &el = *edges;
   int *t = ta;
-  for (int i = 0 ; i < n ; ++i, t += s0)
+  for (int64_t i = 0 ; i < n ; ++i, t += 3)
     {
       int emask = 0;
-      int v0 = t[0], v1 = t[s1], v2 = t[2*s1];
-      if (eset->find(Edge(v0,v1)) != eset->end() || eset->find(Edge(v1,v0)) != eset->end())
-	emask |= 0x1;
-      if (eset->find(Edge(v1,v2)) != eset->end() || eset->find(Edge(v2,v1)) != eset->end())
-	emask |= 0x2;
-      if (eset->find(Edge(v2,v0)) != eset->end() || eset->find(Edge(v0,v2)) != eset->end())
-	emask |= 0x4;
+      int v0 = t[0], v1 = t[1], v2 = t[2];
+      if (!el.empty())
+	{
+	  if (has_edge(el, Edge(v0,v1)) || has_edge(el, Edge(v1,v0)))
+	    emask |= 0x1;
+	  if (has_edge(el, Edge(v1,v2)) || has_edge(el, Edge(v2,v1)))
+	    emask |= 0x2;
+	  if (has_edge(el, Edge(v2,v0)) || has_edge(el, Edge(v0,v2)))
+	    emask |= 0x4;
+	}
       edge_mask[i] = emask;
     }
+  delete edges;
 }
 
 // ----------------------------------------------------------------------------
@@ -224,13 +300,15 @@ extern "C" PyObject *boundary_edge_mask(PyObject *, PyObject *args, PyObject *ke
   int n = tarray.size(0);
   unsigned char *emask;
   PyObject *edge_mask = python_uint8_array(n, &emask);
+  Py_BEGIN_ALLOW_THREADS
   boundary_edge_mask(tarray, emask);
+  Py_END_ALLOW_THREADS
   return edge_mask;
 }
 
 // ----------------------------------------------------------------------------
 //
-static float cap_volume(float *v, const Vertex_Loops &vloops)
+static float cap_volume(const float *v, const Vertex_Loops &vloops)
 {
   float volume = 0;
   for (Vertex_Loops::const_iterator li = vloops.begin() ; li != vloops.end() ; ++li)
@@ -253,7 +331,7 @@ static float cap_volume(float *v, const Vertex_Loops &vloops)
 
 // ----------------------------------------------------------------------------
 //
-static void loop_center(float *v, const Vertex_Loop &vloop, float center[3])
+static void loop_center(const float *v, const Vertex_Loop &vloop, float center[3])
 {
   center[0] = center[1] = center[2] = 0;
   int n = static_cast<int>(vloop.size());
@@ -279,7 +357,12 @@ extern "C" PyObject *surface_area(PyObject *, PyObject *args, PyObject *keywds)
 				   parse_int_n3_array, &tarray))
     return NULL;
 
-  float area = surface_area(varray, tarray);
+  FArray vc = varray.contiguous_array();
+  IArray tc = tarray.contiguous_array();
+  float area;
+  Py_BEGIN_ALLOW_THREADS
+  area = surface_area(vc.values(), tc.values(), tarray.size(0));
+  Py_END_ALLOW_THREADS
   PyObject *py_area = PyFloat_FromDouble(area);
   return py_area;
 }
@@ -324,25 +407,24 @@ extern "C" PyObject *vertex_areas(PyObject *, PyObject *args, PyObject *keywds)
 	}
     }
 
-  surface_area(varray, tarray, areas.values());
+  FArray vc = varray.contiguous_array();
+  IArray tc = tarray.contiguous_array();
+  Py_BEGIN_ALLOW_THREADS
+  surface_area(vc.values(), tc.values(), tarray.size(0), areas.values());
+  Py_END_ALLOW_THREADS
   PyObject *py_areas = array_python_source(areas, !make_areas);
   return py_areas;
 }
 
 // ----------------------------------------------------------------------------
+// Accumulating vertex areas is done serially.
 //
-static float surface_area(FArray &varray, const IArray &tarray, float *areas)
+static float surface_area(const float *v, const int *tv, int64_t m, float *areas,
+			  bool threaded)
 {
-  FArray vc = varray.contiguous_array();
-  float *v = vc.values();
-
-  IArray tc = tarray.contiguous_array();
-  int m = tarray.size(0);
-  int *tv = tc.values();
-
   float area = 0;
   if (areas)
-    for (int t = 0 ; t < m ; ++t)
+    for (int64_t t = 0 ; t < m ; ++t)
       {
 	int i0 = tv[3*t], i1 = tv[3*t+1], i2 = tv[3*t+2];
 	float a = triangle_area(v+3*i0, v+3*i1, v+3*i2);
@@ -352,18 +434,22 @@ static float surface_area(FArray &varray, const IArray &tarray, float *areas)
 	areas[i2] += a/3.0;
       }
   else
-    for (int t = 0 ; t < m ; ++t)
-      {
-	int i0 = tv[3*t], i1 = tv[3*t+1], i2 = tv[3*t+2];
-	area += triangle_area(v+3*i0, v+3*i1, v+3*i2);
-      }
+    area = threaded_sum(m, threaded, [v,tv](int64_t t0, int64_t t1) {
+	double a = 0;
+	for (int64_t t = t0 ; t < t1 ; ++t)
+	  {
+	    int i0 = tv[3*t], i1 = tv[3*t+1], i2 = tv[3*t+2];
+	    a += triangle_area(v+3*i0, v+3*i1, v+3*i2);
+	  }
+	return a;
+      });
 
   return area;
 }
 
 // ----------------------------------------------------------------------------
 //
-static float triangle_area(float v0[3], float v1[3], float v2[3])
+static float triangle_area(const float v0[3], const float v1[3], const float v2[3])
 {
   float x1 = v1[0]-v0[0], y1 = v1[1]-v0[1], z1 = v1[2]-v0[2];
   float x2 = v2[0]-v0[0], y2 = v2[1]-v0[1], z2 = v2[2]-v0[2];
@@ -373,6 +459,86 @@ static float triangle_area(float v0[3], float v1[3], float v2[3])
   return area;
 }
 
+// ----------------------------------------------------------------------------
+// Volume, hole count and area for each of many surfaces.  Surfaces are
+// handed out to threads one at a time, and a single surface is instead
+// split over threads.
+//
+static void volumes_and_areas(const std::vector<FArray> &varrays,
+			      const std::vector<IArray> &tarrays,
+			      float *volumes, float *areas, int *hole_counts)
+{
+  int64_t ns = varrays.size();
+  if (ns == 1)
+    {
+      const float *v = varrays[0].values();
+      const int *tv = tarrays[0].values();
+      int64_t m = tarrays[0].size(0);
+      volumes[0] = enclosed_volume(v, tv, m, &hole_counts[0]);
+      areas[0] = surface_area(v, tv, m);
+      return;
+    }
+
+  std::atomic<int64_t> next(0);
+  auto measure = [&]() {
+    for (int64_t s = next++ ; s < ns ; s = next++)
+      {
+	const float *v = varrays[s].values();
+	const int *tv = tarrays[s].values();
+	int64_t m = tarrays[s].size(0);
+	volumes[s] = enclosed_volume(v, tv, m, &hole_counts[s], false);
+	areas[s] = surface_area(v, tv, m, NULL, false);
+      }
+  };
+
+  Thread_Pool::run(Thread_Pool::thread_count(ns), [&](int) { measure(); });
+}
+
+// ----------------------------------------------------------------------------
+//
+extern "C" PyObject *enclosed_volumes_and_areas(PyObject *, PyObject *args, PyObject *keywds)
+{
+  PyObject *surfaces;
+  const char *kwlist[] = {"surfaces", NULL};
+  if (!PyArg_ParseTupleAndKeywords(args, keywds,
+				   const_cast<char *>("O"), (char **)kwlist,
+				   &surfaces))
+    return NULL;
+
+  PyObject *seq = PySequence_Fast(surfaces, "enclosed_volumes_and_areas: surfaces must be a sequence");
+  if (seq == NULL)
+    return NULL;
+  Py_ssize_t ns = PySequence_Fast_GET_SIZE(seq);
+  std::vector<FArray> varrays(ns);
+  std::vector<IArray> tarrays(ns);
+  for (Py_ssize_t s = 0 ; s < ns ; ++s)
+    {
+      PyObject *vt = PySequence_Fast_GET_ITEM(seq, s);
+      FArray varray;
+      IArray tarray;
+      if (!PyArg_ParseTuple(vt, const_cast<char *>("O&O&;enclosed_volumes_and_areas: surfaces "
+						   "must be (vertices, triangles) pairs"),
+			    parse_float_n3_array, &varray,
+			    parse_int_n3_array, &tarray))
+	{ Py_DECREF(seq); return NULL; }
+      varrays[s] = varray.contiguous_array();
+      tarrays[s] = tarray.contiguous_array();
+    }
+  Py_DECREF(seq);
+
+  float *vol, *area;
+  int *holes;
+  PyObject *py_vol = python_float_array(ns, &vol);
+  PyObject *py_area = python_float_array(ns, &area);
+  PyObject *py_holes = python_int_array(ns, &holes);
+
+  Py_BEGIN_ALLOW_THREADS
+  volumes_and_areas(varrays, tarrays, vol, area, holes);
+  Py_END_ALLOW_THREADS
+
+  return python_tuple(py_vol, py_area, py_holes);
+}
+
 // ----------------------------------------------------------------------------
 //
 extern "C" PyObject *boundary_edges(PyObject *, PyObject *args, PyObject *keywds)
@@ -384,17 +550,21 @@ extern "C" PyObject *boundary_edges(PyObject *, PyObject *args, PyObject *keywds
 				   parse_int_n3_array, &tarray))
     return NULL;
 
-  Edge_Set *eset = boundary_edge_set(tarray);
+  IArray tc = tarray.contiguous_array();
+  Edge_List *edges;
+  Py_BEGIN_ALLOW_THREADS
+  edges = boundary_edge_list(tc.values(), tarray.size(0));
+  Py_END_ALLOW_THREADS
   int *ea, e = 0;
-  PyObject *edges = python_int_array(static_cast<int>(eset->size()), 2, &ea);
-  for (Edge_Set::iterator ei = eset->begin() ; ei != eset->end() ; ++ei)
+  PyObject *py_edges = python_int_array(static_cast<int>(edges->size()), 2, &ea);
+  for (Edge_List::iterator ei = edges->begin() ; ei != edges->end() ; ++ei)
     {
       ea[e++] = ei->first;
       ea[e++] = ei->second;
     }
-  delete eset;
+  delete edges;
 
-  return edges;
+  return py_edges;
 }
 
 // ----------------------------------------------------------------------------
@@ -408,7 +578,19 @@ extern "C" PyObject *boundary_loops(PyObject *, PyObject *args, PyObject *keywds
 				   parse_int_n3_array, &tarray))
     return NULL;
 
-  Vertex_Loops *vloops = boundary_loops(tarray);
+  IArray tc = tarray.contiguous_array();
+  Vertex_Loops *vloops;
+  Py_BEGIN_ALLOW_THREADS
+  Edge_List *edges = boundary_edge_list(tc.values(), tarray.size(0));
+  vloops = boundary_loops(*edges);
+  delete edges;
+  Py_END_ALLOW_THREADS
+  if (vloops == NULL)
+    {
+      PyErr_SetString(PyExc_ValueError,
+		      "boundary_loops: boundary edges traversed in opposing directions");
+      return NULL;
+    }
   PyObject *loopy = PyTuple_New(vloops->size());
   int l = 0;
   for (Vertex_Loops::iterator vi = vloops->begin() ;
@@ -43,6 +43,11 @@ PyObject *enclosed_volume(PyObject *s, PyObject *args, PyObject *keywds);
 // float surface_area(PyObject *vertex_array, PyObject *triangle_array);
 PyObject *surface_area(PyObject *s, PyObject *args, PyObject *keywds);
 
+// Enclosed volume, area and hole count of each of many surfaces computed in parallel.
+// Volume is -1 for surfaces with boundary edges traversed in opposing directions.
+// (volumes, areas, hole_counts) enclosed_volumes_and_areas(PyObject *surfaces)
+PyObject *enclosed_volumes_and_areas(PyObject *s, PyObject *args, PyObject *keywds);
+
 // Accumulate 1/3 triangle area to each vertex.
 // PyObject *vertex_areas(PyObject *vertex_array, PyObject *triangle_array, PyObject *areas = NULL);
 PyObject *vertex_areas(PyObject *s, PyObject *args, PyObject *keywds);
@@ -124,7 +124,10 @@ extern "C" PyObject *calculate_vertex_normals(PyObject *, PyObject *args, PyObje
 				   parse_int_n3_array, &ta))
     return NULL;
 
-  FArray na = calculate_vertex_normals(va, ta);
+  FArray na;
+  Py_BEGIN_ALLOW_THREADS
+  na = calculate_vertex_normals(va, ta);
+  Py_END_ALLOW_THREADS
   PyObject *normals = c_array_to_python(na.values(), na.size(0), na.size(1));
   return normals;
 }
@@ -142,7 +145,9 @@ extern "C" PyObject *invert_vertex_normals(PyObject *, PyObject *args, PyObject
 				   parse_writable_int_n3_array, &ta))
     return NULL;
 
+  Py_BEGIN_ALLOW_THREADS
   invert_vertex_normals(na, ta);
+  Py_END_ALLOW_THREADS
 
   return python_none();
 }
@@ -25,9 +25,14 @@
 #include <map>		// use std::map
 #include <iostream>
 #include <math.h>			// use sqrt()
+#include <string.h>			// use memcpy()
+#include <algorithm>			// use std::sort, std::inplace_merge
+#include <cstdint>			// use uint32_t, uint64_t
+#include <vector>			// use std::vector
 
 #include <arrays/pythonarray.h>		// use python_float_array
 #include <arrays/rcarray.h>		// use FArray, IArray
+#include <arrays/threadpool.h>		// use Thread_Pool::thread_count(), run()
 
 typedef std::vector<float> Vertices;
 typedef std::vector<float> Normals;
@@ -40,6 +45,22 @@ typedef std::map<Edge,int> Edge_Map;
 #define min(a,b) (a<b ? a : b)
 #define max(a,b) (a>b ? a : b)
 
+// ----------------------------------------------------------------------------
+// Number of pieces to split n items into so each thread gets at least
+// min_per_thread items, using at most Thread_Pool::max_threads() threads.
+//
+static int chunk_count(int64_t n, int64_t min_per_thread)
+{
+  return Thread_Pool::thread_count(n, min_per_thread);
+}
+
+// Call f(chunk, start, end) for each of nc ranges of n items on shared pool threads.
+template <class F>
+static void run_chunks(int64_t n, int nc, F f)
+{
+  Thread_Pool::run(nc, [&](int c) { f(c, n*c/nc, n*(c+1)/nc); });
+}
+
 inline void add_vertex(Vertices &v, float x, float y, float z)
 {
   v.push_back(x);
@@ -184,38 +205,118 @@ inline int split_edge(int v0, int v1, int a0, int a1,
   return va.size() - 1;
 }
 
-inline void add_split_point(int v0, int v1, int a0, int a1,
-			    float *aa, int as0, int as1, float *ra, int rs0,
-			    Vertices &v, Normals &n, Atoms &va, VertexMap &vm,
-			    Edge_Map &edge_splits)
+// An edge that needs a split point with the atoms of its lower and higher vertex.
+class Split_Edge
+{
+public:
+  Split_Edge(int vmin, int vmax, int amin, int amax, int64_t order)
+    : vmin(vmin), vmax(vmax), amin(amin), amax(amax), order(order) {}
+  uint64_t key() const
+    { return (static_cast<uint64_t>(static_cast<uint32_t>(vmin)) << 32) | static_cast<uint32_t>(vmax); }
+  int vmin, vmax, amin, amax;
+  int64_t order;	// Position in triangle edge order of first use.
+};
+
+inline void add_split_edge(int v0, int v1, int a0, int a1, int64_t order,
+			   const Edge_Map &edge_splits, std::vector<Split_Edge> &edges)
 {
   int vmin = min(v0,v1), vmax = max(v0,v1);
   int amin = (v0 < v1 ? a0 : a1), amax = (v0 < v1 ? a1 : a0);
-  Edge e(vmin,vmax);
-  if (edge_splits.find(e) == edge_splits.end())
-    edge_splits[e] = split_edge(vmin, vmax, amin, amax, aa, as0, as1, ra, rs0, v, n, va, vm);
+  if (edge_splits.empty() || edge_splits.find(Edge(vmin,vmax)) == edge_splits.end())
+    edges.push_back(Split_Edge(vmin, vmax, amin, amax, order));
 }
 
+// ----------------------------------------------------------------------------
+// Add a vertex at the split point of every edge joining vertices assigned
+// to different atoms that is not already split.  New vertices are numbered
+// in the order the edges are first used by the triangles.  Finding the edges
+// and computing split points is done on threads.  Only adding new edges to
+// the map is serial and the edges are added in sorted order so that is fast.
+//
 static void compute_edge_split_points(Vertices &v, Normals &n, Atoms &va, VertexMap &vm, const Triangles &t,
 				      const FArray &a, const FArray &r, Edge_Map &edge_splits)
 {
-  int nt = t.size()/3;
+  int64_t nt = t.size()/3;
   // Get pointers and strides for geometry
   float *aa = a.values();
   int64_t as0 = a.stride(0), as1 = a.stride(1);
   float *ra = (r.dimension() == 1 ? r.values() : NULL);
   int64_t rs0 = (r.dimension() == 1 ? r.stride(0) : 0);
-  for (int ti = 0 ; ti < nt ; ++ti)
+
+  // Find edges needing split points.
+  int nc = chunk_count(nt, 100000);
+  std::vector<std::vector<Split_Edge> > chunk_edges(nc);
+  run_chunks(nt, nc, [&](int c, int64_t t0, int64_t t1) {
+      std::vector<Split_Edge> &edges = chunk_edges[c];
+      for (int64_t ti = t0 ; ti < t1 ; ++ti)
+	{
+	  int v0 = t[3*ti], v1 = t[3*ti+1], v2 = t[3*ti+2];
+	  int a0 = va[v0], a1 = va[v1], a2 = va[v2];
+	  if (a0 != a1)
+	    add_split_edge(v0, v1, a0, a1, 3*ti, edge_splits, edges);
+	  if (a1 != a2)
+	    add_split_edge(v1, v2, a1, a2, 3*ti+1, edge_splits, edges);
+	  if (a2 != a0)
+	    add_split_edge(v2, v0, a2, a0, 3*ti+2, edge_splits, edges);
+	}
+    });
+  std::vector<Split_Edge> edges;
+  for (auto &ce: chunk_edges)
     {
-      int v0 = t[3*ti], v1 = t[3*ti+1], v2 = t[3*ti+2];
-      int a0 = va[v0], a1 = va[v1], a2 = va[v2];
-      if (a0 != a1)
-	add_split_point(v0, v1, a0, a1, aa, as0, as1, ra, rs0, v, n, va, vm, edge_splits);
-      if (a1 != a2)
-	add_split_point(v1, v2, a1, a2, aa, as0, as1, ra, rs0, v, n, va, vm, edge_splits);
-      if (a2 != a0)
-	add_split_point(v2, v0, a2, a0, aa, as0, as1, ra, rs0, v, n, va, vm, edge_splits);
+      edges.insert(edges.end(), ce.begin(), ce.end());
+      std::vector<Split_Edge>().swap(ce);
     }
+  if (edges.empty())
+    return;
+
+  // Keep the first use of each edge.
+  std::sort(edges.begin(), edges.end(), [](const Split_Edge &e1, const Split_Edge &e2)
+	    { return e1.key() < e2.key() || (e1.key() == e2.key() && e1.order < e2.order); });
+  edges.erase(std::unique(edges.begin(), edges.end(), [](const Split_Edge &e1, const Split_Edge &e2)
+			  { return e1.key() == e2.key(); }), edges.end());
+
+  // Number new vertices in order of first use.
+  int64_t ne = edges.size();
+  std::vector<int64_t> first_use(ne);
+  for (int64_t e = 0 ; e < ne ; ++e)
+    first_use[e] = e;
+  std::sort(first_use.begin(), first_use.end(), [&](int64_t e1, int64_t e2)
+	    { return edges[e1].order < edges[e2].order; });
+  int64_t nv0 = v.size()/3;
+  std::vector<int> edge_vertex(ne);
+  for (int64_t k = 0 ; k < ne ; ++k)
+    edge_vertex[first_use[k]] = nv0 + k;
+
+  Edge_Map::iterator hint = edge_splits.end();
+  for (int64_t e = 0 ; e < ne ; ++e)
+    hint = edge_splits.insert(hint, Edge_Map::value_type(Edge(edges[e].vmin, edges[e].vmax), edge_vertex[e]));
+
+  // Compute split vertex positions, normals and atom assignments.
+  v.resize(3*(nv0+ne));
+  n.resize(3*(nv0+ne));
+  va.resize(nv0+ne);
+  vm.resize(nv0+ne);
+  run_chunks(ne, chunk_count(ne, 100000), [&](int, int64_t e0, int64_t e1) {
+      for (int64_t e = e0 ; e < e1 ; ++e)
+	{
+	  const Split_Edge &se = edges[e];
+	  int v0 = se.vmin, v1 = se.vmax, ev = edge_vertex[e];
+	  float x, y, z, f1;
+	  split_point(v0, v1, se.amin, se.amax, aa, as0, as1, ra, rs0, v, true, &x, &y, &z, &f1);
+	  v[3*ev] = x; v[3*ev+1] = y; v[3*ev+2] = z;
+	  // Normal at split position
+	  float f0 = 1-f1;
+	  float nx = f0*n[3*v0] + f1*n[3*v1];
+	  float ny = f0*n[3*v0+1] + f1*n[3*v1+1];
+	  float nz = f0*n[3*v0+2] + f1*n[3*v1+2];
+	  float n2 = sqrt(nx*nx + ny*ny + nz*nz);
+	  if (n2 > 0)
+	    { nx /= n2; ny /= n2 ; nz /= n2; }
+	  n[3*ev] = nx; n[3*ev+1] = ny; n[3*ev+2] = nz;
+	  va[ev] = se.amin;
+	  vm[ev] = ev;
+	}
+    });
 }
 
 // Split a triangle along a single cut line, dividing it into 3 new triangles.
@@ -696,6 +797,10 @@ static void convert_arrays_to_vectors(const FArray &vs, const FArray &ns,
 
   // Copy vertices and normals to vectors.
   int nv = vs.size(0);
+  v.reserve(3*nv);
+  n.reserve(3*nv);
+  va.reserve(nv);
+  vm.reserve(nv);
   for (int i = 0 ; i < nv ; ++i)
     {
       add_vertex(v, vsa[i*vs0], vsa[i*vs0+vs1], vsa[i*vs0+2*vs1]);
@@ -803,37 +908,72 @@ extern "C" PyObject *sharp_edge_patches(PyObject *, PyObject *args, PyObject *ke
   return r;
 }
 
-class Vertex
+// Vertex coordinates as unsigned integers that sort in the same order as the
+// floating point values, with the vertex index to break ties.
+class Vertex_Key
 {
+  uint32_t x, y, z;
 public:
-  Vertex(float x, float y, float z): x(x), y(y), z(z) {}
-  bool operator<(const Vertex &v) const
-  { return x < v.x || (x == v.x && (y < v.y || (y == v.y && z < v.z))); }
+  Vertex_Key() {}
+  Vertex_Key(float x, float y, float z, int index)
+    : x(sort_bits(x)), y(sort_bits(y)), z(sort_bits(z)), index(index) {}
+  bool operator<(const Vertex_Key &v) const
+  { return x < v.x || (x == v.x && (y < v.y || (y == v.y && (z < v.z || (z == v.z && index < v.index))))); }
+  bool same_point(const Vertex_Key &v) const
+  { return x == v.x && y == v.y && z == v.z; }
+  int index;
 private:
-  float x,y,z;
+  static uint32_t sort_bits(float f)
+  {
+    if (f == 0)
+      f = 0;	// Treat -0 and 0 as the same point.
+    uint32_t b;
+    memcpy(&b, &f, sizeof(b));
+    return (b & 0x80000000u) ? ~b : (b | 0x80000000u);
+  }
 };
 
 // ----------------------------------------------------------------------------
-// This code is slow, 8 seconds for 16 million vertices, late 2012 iMac.
-// stl::unordered_map is twice as fast in tests, but that is still slow.
+// Map each vertex to the lowest index vertex at exactly the same position.
+// Vertices are sorted by position, pieces sorted on shared pool threads then
+// merged, and runs of identical positions all map to the first vertex of the
+// run.  Even on one thread this is 4 times faster than inserting into a map.
 //
 static void unique_vertices(const FArray &vertices, int *vmap)
 {
-  std::map<Vertex,int> vm;
-  int nv = vertices.size(0);
+  int64_t nv = vertices.size(0);
   int64_t vs0 = vertices.stride(0), vs1 = vertices.stride(1);
   const float *va = vertices.values();
-  for (int v = 0 ; v < nv ; ++v)
+  std::vector<Vertex_Key> keys(nv);
+  int nc = chunk_count(nv, 100000);
+  std::vector<int64_t> bounds(nc+1);
+  for (int c = 0 ; c <= nc ; ++c)
+    bounds[c] = nv*c/nc;
+  run_chunks(nv, nc, [&](int /*c*/, int64_t v0, int64_t v1) {
+      for (int64_t v = v0 ; v < v1 ; ++v)
+	keys[v] = Vertex_Key(va[vs0*v], va[vs0*v+vs1], va[vs0*v+2*vs1], static_cast<int>(v));
+      std::sort(keys.begin()+v0, keys.begin()+v1);
+    });
+
+  // Merge sorted pieces pairwise.
+  for (int width = 1 ; width < nc ; width *= 2)
     {
-      Vertex p(va[vs0*v], va[vs0*v+vs1], va[vs0*v+2*vs1]);
-      std::map<Vertex,int>::iterator vi = vm.find(p);
-      if (vi == vm.end())
-	{
-	  vm[p] = v;
-	  vmap[v] = v;
-	}
-      else
-	vmap[v] = vi->second;
+      int nm = (nc - width + 2*width - 1) / (2*width);	// Merges at this width.
+      auto kb = keys.begin();
+      Thread_Pool::run(nm, [&](int m) {
+	  int c = 2*width*m;
+	  int64_t b0 = bounds[c], b1 = bounds[c+width], b2 = bounds[min(c+2*width, nc)];
+	  std::inplace_merge(kb+b0, kb+b1, kb+b2);
+	});
+    }
+
+  for (int64_t k = 0 ; k < nv ; )
+    {
+      int first = keys[k].index;
+      int64_t e = k;
+      for ( ; e < nv && keys[e].same_point(keys[k]) ; ++e)
+	vmap[keys[e].index] = first;
+      k = e;
     }
 }
 
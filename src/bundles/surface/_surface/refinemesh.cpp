@@ -1081,9 +1081,11 @@ extern "C" PyObject *refine_mesh(PyObject *, PyObject *args)
   Cap_Calculation::Index rvsize, *rt, rtsize;
   Cap_Calculation::Real *rv;
 
+  Py_BEGIN_ALLOW_THREADS
   Cap_Calculation::refine_mesh(vvalues, vsize, tvalues, tsize,
 			       subdivision_factor,
 			       &rv, &rvsize, &rt, &rtsize);
+  Py_END_ALLOW_THREADS
 
   PyObject *rvarray = c_array_to_python(rv, rvsize, 3);
   PyObject *rtarray = c_array_to_python(rt, rtsize, 3);
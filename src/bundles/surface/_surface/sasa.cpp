@@ -28,11 +28,17 @@
 
 #include <math.h>		// use M_PI, sqrt, cos, atan2, ...
 
+#include <algorithm>		// use std::min, std::sort
+#include <atomic>		// use std::atomic
 #include <iostream>		// use std::cerr for debugging
+#include <map>			// use std::map
 #include <vector>		// use std::vector
 
+#include <arrays/progress.h>	// use Progress_Reporter, Python_Progress
 #include <arrays/pythonarray.h>	// use parse_double_n3_array, ...
 #include <arrays/rcarray.h>	// use DArray
+#include <arrays/threadpool.h>	// use Thread_Pool::thread_count(), run()
+#include <arrays/trace.h>	// use TRACE_SCOPE_ITEMS()
 
 #ifndef M_PI
 // not defined on Windows
@@ -111,9 +117,43 @@ public:
   Index_List in_region, near_region;
 };
 
-static int surface_area_of_spheres(double *centers, int n, double *radii, double *areas);
+// Regions kept between area calculations for spheres that move little, for
+// instance trajectory frames.  Regions are made with radii increased by the
+// padding so they remain valid until some sphere moves more than the padding.
+class Sphere_Regions
+{
+public:
+  Sphere_Regions(double padding) : padding(padding) {}
+  const std::vector<Region_Spheres> &regions(double *centers, int n, double *radii);
+private:
+  double padding;
+  std::vector<double> centers, radii;
+  std::vector<Region_Spheres> rspheres;
+  bool valid(double *centers, int n, double *radii) const;
+};
+
+static int surface_area_of_spheres(double *centers, int n, double *radii, double *areas,
+				   Sphere_Regions *sregions = NULL, Progress_Reporter *progress = NULL);
 static void find_sphere_regions(double *centers, int n, double *radii, unsigned int max_size,
 				std::vector<Region_Spheres> &rspheres);
+static int region_areas(const std::vector<Region_Spheres> *rspheres, std::atomic<int> *next,
+			double *centers, double *radii, double *areas,
+			Progress_Reporter *progress, std::atomic<bool> *stop);
+static int thread_count(int nr);
+
+// Area of a sphere buried by spheres of one other group, in addition to
+// what its own group buries.
+class Group_Burial
+{
+public:
+  int sphere, group;
+  double buried_area;
+  bool operator<(const Group_Burial &b) const
+    { return sphere < b.sphere || (sphere == b.sphere && group < b.group); }
+};
+typedef std::vector<Group_Burial> Group_Burials;
+static void buried_areas_of_sphere_groups(double *centers, int n, double *radii, int *groups,
+					  double *areas, Group_Burials &burials);
 static void subdivide_region(const Region_Spheres &rs, double *centers, double *radii,
 			     unsigned int max_size, std::vector<Region_Spheres> &rspheres);
 static bool buried_sphere_area(int i, const Index_List &iclose,
@@ -196,26 +236,58 @@ private:
   int *c;
 };
 
-// Returns count of how many spheres calculation succeeded for.
+// Returns count of how many spheres calculation succeeded for, or -1 if
+// stopped by the progress reporter.
 // If calculation fails for a sphere the area for that sphere is set to -1.
-static int surface_area_of_spheres(double *centers, int n, double *radii, double *areas)
+static int surface_area_of_spheres(double *centers, int n, double *radii, double *areas,
+				   Sphere_Regions *sregions, Progress_Reporter *progress)
 {
   // Find spheres that intersect other spheres quickly by partitioning spheres into boxes.
   int max_spheres_in_region = 100;
   std::vector<Region_Spheres> rspheres;
-  find_sphere_regions(centers, n, radii, max_spheres_in_region, rspheres);
+  if (sregions == NULL)
+    find_sphere_regions(centers, n, radii, max_spheres_in_region, rspheres);
+  const std::vector<Region_Spheres> &rs = (sregions ? sregions->regions(centers, n, radii) : rspheres);
+
+  // Spheres in a box are independent of other boxes so boxes are handed
+  // out to threads, the next box going to the first thread that is free.
+  // Only the calling thread, t = 0, reports progress.
+  std::atomic<int> next(0);
+  std::atomic<bool> stop(false);
+  int nt = thread_count(rs.size());
+  std::vector<int> counts(nt, 0);
+  Thread_Pool::run(nt, [&](int t) {
+      counts[t] = region_areas(&rs, &next, centers, radii, areas,
+			       (t == 0 ? progress : NULL), &stop);
+    });
+  if (stop)
+    return -1;
+
   int c = 0;
-  int nr = rspheres.size();
+  for (auto ct: counts)
+    c += ct;
+  return c;
+}
 
-  // Parallelize loop over boxes containing sphere using OpenMP.
-#pragma omp parallel shared(nr,rspheres,centers,radii,areas,c)
-  {
-    // Have each thread handle 100 boxes.
-#pragma omp for schedule(dynamic,100)
-  for (int r = 0 ; r < nr ; ++r)	// Loop over boxes of spheres.
+// Compute areas for spheres in boxes taken in turn until none are left
+// or the progress reporter asks to stop.
+static int region_areas(const std::vector<Region_Spheres> *rspheres, std::atomic<int> *next,
+			double *centers, double *radii, double *areas,
+			Progress_Reporter *progress, std::atomic<bool> *stop)
+{
+  const int regions_per_report = 16;
+  int c = 0, done = 0;
+  int nr = rspheres->size();
+  for (int r = (*next)++ ; r < nr && !*stop ; r = (*next)++)	// Loop over boxes of spheres.
     {
-      Region_Spheres &rs = rspheres[r];
-      Index_List &ir = rs.in_region;
+      if (progress && ++done % regions_per_report == 0
+	  && !progress->report(static_cast<float>(r) / nr))
+	{
+	  *stop = true;
+	  break;
+	}
+      const Region_Spheres &rs = (*rspheres)[r];
+      const Index_List &ir = rs.in_region;
       int nir = ir.size();
       for (int j = 0 ; j < nir ; ++j)	// For each sphere in box compute area.
 	{
@@ -231,10 +303,130 @@ static int surface_area_of_spheres(double *centers, int n, double *radii, double
 	    areas[i] = -1;	// Calculation failed.
 	}
     }
-  }
   return c;
 }
 
+// Compute areas of spheres in each group of spheres alone, and the areas
+// buried by each other group that touches a sphere.  One box subdivision
+// finds nearby spheres for all groups, and the area with an added group is
+// only computed for spheres that group touches, so for many groups this is
+// much faster than area calculations for every group and group pair.  If
+// a calculation fails the area is set to -1 and a burial is not reported.
+static void buried_areas_of_sphere_groups(double *centers, int n, double *radii, int *groups,
+					  double *areas, Group_Burials &burials)
+{
+  int max_spheres_in_region = 100;
+  std::vector<Region_Spheres> rspheres;
+  find_sphere_regions(centers, n, radii, max_spheres_in_region, rspheres);
+  int nr = rspheres.size();
+  std::vector<Group_Burials> rburials(nr);
+
+  std::atomic<int> next(0);
+  auto region_burials = [&]() {
+    Index_List same;
+    std::map<int, Index_List> other;
+    for (int r = next++ ; r < nr ; r = next++)	// Loop over boxes of spheres.
+      {
+	const Region_Spheres &rs = rspheres[r];
+	const Index_List &ir = rs.in_region, &near = rs.near_region;
+	int nir = ir.size(), nn = near.size();
+	for (int j = 0 ; j < nir ; ++j)
+	  {
+	    // Separate nearby spheres into own group and other touching groups.
+	    int i = ir[j], gi = groups[i];
+	    double *ci = centers + 3*i, ri = radii[i];
+	    same.clear();
+	    other.clear();
+	    for (int k = 0 ; k < nn ; ++k)
+	      {
+		int nk = near[k];
+		if (groups[nk] == gi)
+		  same.push_back(nk);
+		else
+		  {
+		    double *ck = centers + 3*nk, rik = ri + radii[nk];
+		    double dx = ck[0]-ci[0], dy = ck[1]-ci[1], dz = ck[2]-ci[2];
+		    if (dx*dx + dy*dy + dz*dz < rik*rik)
+		      other[groups[nk]].push_back(nk);
+		  }
+	      }
+	    double ba, full_area = 4*M_PI*ri*ri;
+	    if (!buried_sphere_area(i, same, centers, radii, &ba))
+	      {
+		areas[i] = -1;	// Calculation failed.
+		continue;
+	      }
+	    areas[i] = full_area - ba;
+
+	    // Area buried by own group and one other group.
+	    int nsame = same.size();
+	    for (auto &go: other)
+	      {
+		same.resize(nsame);
+		same.insert(same.end(), go.second.begin(), go.second.end());
+		double ba2;
+		if (buried_sphere_area(i, same, centers, radii, &ba2))
+		  {
+		    Group_Burial b;
+		    b.sphere = i;
+		    b.group = go.first;
+		    b.buried_area = areas[i] - (full_area - ba2);
+		    rburials[r].push_back(b);
+		  }
+	      }
+	  }
+      }
+  };
+  Thread_Pool::run(thread_count(nr), [&](int) { region_burials(); });
+
+  for (auto &rb: rburials)
+    burials.insert(burials.end(), rb.begin(), rb.end());
+  std::sort(burials.begin(), burials.end());
+}
+
+// Use up to Thread_Pool::max_threads() threads but not more threads than boxes.
+static int thread_count(int nr)
+{
+  return Thread_Pool::thread_count(nr);
+}
+
+// Return regions for the current centers, recomputing them if the radii
+// changed or some sphere moved more than the padding since they were made.
+const std::vector<Region_Spheres> &Sphere_Regions::regions(double *centers, int n, double *radii)
+{
+  if (!valid(centers, n, radii))
+    {
+      this->centers.assign(centers, centers + 3*n);
+      this->radii.assign(radii, radii + n);
+      std::vector<double> pradii(n);
+      for (int i = 0 ; i < n ; ++i)
+	pradii[i] = radii[i] + padding;
+      rspheres.clear();
+      int max_spheres_in_region = 100;
+      find_sphere_regions(centers, n, pradii.data(), max_spheres_in_region, rspheres);
+    }
+  return rspheres;
+}
+
+bool Sphere_Regions::valid(double *centers, int n, double *radii) const
+{
+  if (static_cast<int>(this->radii.size()) != n || rspheres.empty())
+    return false;
+  for (int i = 0 ; i < n ; ++i)
+    if (radii[i] != this->radii[i])
+      return false;
+  double p2 = padding*padding;
+  for (int i = 0 ; i < 3*n ; i += 3)
+    {
+      double dx = centers[i] - this->centers[i];
+      double dy = centers[i+1] - this->centers[i+1];
+      double dz = centers[i+2] - this->centers[i+2];
+      if (dx*dx + dy*dy + dz*dz > p2)
+	return false;
+    }
+  return true;
+}
+
 // Subdivide bounding boxes to group nearby spheres.
 static void find_sphere_regions(double *centers, int n, double *radii, unsigned int max_size,
 				std::vector<Region_Spheres> &rspheres)
@@ -704,46 +896,46 @@ static void estimate_surface_area_of_spheres(double *centers, int n, double *rad
   for (int k = 0 ; k < np ; ++k)
     wsum += point_weights[k];
 
-  // Parallelize loop over boxes containing sphere using OpenMP.
-#pragma omp parallel shared(nr,rspheres,centers,radii,sphere_points,np,point_weights,wsum,areas)
-  {
-  double *pbuf = new double [3*np];
-  int *ibuf = new int[np];
-  // Have each thread handle 100 boxes. 
-#pragma omp for schedule(dynamic,100)
-  for (int r = 0 ; r < nr ; ++r)	// Loop over boxes of spheres.
-    {
-      Region_Spheres &rs = rspheres[r];
-      Index_List &ir = rs.in_region;
-      int nir = ir.size();
-      for (int j = 0 ; j < nir ; ++j)	// For each sphere in box compute area.
-	{
-	  int i = ir[j];
-	  double ba = estimate_buried_sphere_area(i, rs.near_region, centers, radii,
-						  sphere_points, np, point_weights, wsum,
-						  pbuf, ibuf);
-	  double r = radii[i];
-	  areas[i] = 4*M_PI*r*r - ba;
-	}
-    }
-  delete [] ibuf;
-  delete [] pbuf;
-  }
+  // Boxes are handed out to threads, the next box going to the first thread that is free.
+  std::atomic<int> next(0);
+  auto estimate_areas = [&]() {
+    std::vector<double> pbuf(3*np);
+    std::vector<int> ibuf(np);
+    for (int r = next++ ; r < nr ; r = next++)	// Loop over boxes of spheres.
+      {
+	Region_Spheres &rs = rspheres[r];
+	Index_List &ir = rs.in_region;
+	int nir = ir.size();
+	for (int j = 0 ; j < nir ; ++j)	// For each sphere in box compute area.
+	  {
+	    int i = ir[j];
+	    double ba = estimate_buried_sphere_area(i, rs.near_region, centers, radii,
+						    sphere_points, np, point_weights, wsum,
+						    pbuf.data(), ibuf.data());
+	    double r = radii[i];
+	    areas[i] = 4*M_PI*r*r - ba;
+	  }
+      }
+  };
+  Thread_Pool::run(thread_count(nr), [&](int) { estimate_areas(); });
 }
 
 // Calculate area for sphere i buried by spheres iclose.
 // Use points on unit sphere and point weights (areas) and see how many points are inside other spheres.
 // pbuf and ibuf are buffers to hold points recentered and scaled to sphere i, and to mark which points
-// were in other spheres.
+// were in other spheres.  The points are held as separate x, y, z arrays and every point is tested
+// against each intersecting sphere without branches so the compiler can vectorize the loop.
 static double estimate_buried_sphere_area(int i, const Index_List &iclose, double *centers, double *radii,
 					  double *points, int np, double *weights, double wsum,
 					  double *pbuf, int *ibuf)
 {
   double *c = centers + 3*i, r = radii[i];
+  double *px = pbuf, *py = pbuf + np, *pz = pbuf + 2*np;
   for (int j = 0 ; j < np ; ++j)
     {
-      for (int a = 0 ; a < 3 ; ++a)
-	pbuf[3*j+a] = r*points[3*j+a] + c[a];
+      px[j] = r*points[3*j] + c[0];
+      py[j] = r*points[3*j+1] + c[1];
+      pz[j] = r*points[3*j+2] + c[2];
       ibuf[j] = 0;
     }
 
@@ -769,21 +961,16 @@ static double estimate_buried_sphere_area(int i, const Index_List &iclose, doubl
 	    return 4*M_PI*r*r;	// Rest are entirely buried.
 	}
       double r2 = rj*rj;
-      for (int k = 0 ; k < np ; ++k)
-	if (!ibuf[k])
-	  {
-	    double *p = pbuf+3*k;
-	    double dx = p[0]-c0, dy = p[1]-c1, dz = p[2]-c2;
-	    double d2 = dx*dx + dy*dy + dz*dz;
-	    if (d2 <= r2)
-	      ibuf[k] = 1;
-	  }
+      for (int p = 0 ; p < np ; ++p)
+	{
+	  double dx = px[p]-c0, dy = py[p]-c1, dz = pz[p]-c2;
+	  ibuf[p] |= (dx*dx + dy*dy + dz*dz <= r2);
+	}
     }
 
   double isum = 0;
   for (int k = 0 ; k < np ; ++k)
-    if (ibuf[k])
-      isum += weights[k];
+    isum += ibuf[k] * weights[k];
 
   double a = 4*M_PI*r*r*isum/wsum;
 
@@ -794,14 +981,25 @@ static double estimate_buried_sphere_area(int i, const Index_List &iclose, doubl
 extern "C" PyObject *surface_area_of_spheres(PyObject *, PyObject *args, PyObject *keywds)
 {
   DArray centers, radii, areas;
-  const char *kwlist[] = {"centers", "radii", "areas", NULL};
+  PyObject *py_regions = Py_None;
+  Python_Progress progress;
+  const char *kwlist[] = {"centers", "radii", "areas", "regions", "progress", NULL};
   if (!PyArg_ParseTupleAndKeywords(args, keywds,
-				   const_cast<char *>("O&O&|O&"), (char **)kwlist,
+				   const_cast<char *>("O&O&|O&OO&"), (char **)kwlist,
 				   parse_double_n3_array, &centers,
 				   parse_double_n_array, &radii,
-				   parse_writable_double_n_array, &areas))
+				   parse_writable_double_n_array, &areas,
+				   &py_regions, parse_progress, &progress))
     return NULL;
 
+  Sphere_Regions *sregions = NULL;
+  if (py_regions != Py_None)
+    {
+      sregions = static_cast<Sphere_Regions *>(PyCapsule_GetPointer(py_regions, "Sphere_Regions"));
+      if (sregions == NULL)
+	return NULL;
+    }
+
   DArray ca = centers.contiguous_array();
   DArray ra = radii.contiguous_array();
   bool alloc_areas = (areas.dimension() == 0);
@@ -822,14 +1020,88 @@ extern "C" PyObject *surface_area_of_spheres(PyObject *, PyObject *args, PyObjec
     }
 
   // Returned sphere area of -1 means calculation failed for that sphere.
+  int count;
   Py_BEGIN_ALLOW_THREADS
-  surface_area_of_spheres(ca.values(), ca.size(0), ra.values(), areas.values());
+  TRACE_SCOPE_ITEMS("surface.surface_area_of_spheres", n);
+  count = surface_area_of_spheres(ca.values(), ca.size(0), ra.values(), areas.values(), sregions,
+				  progress.reporter());
   Py_END_ALLOW_THREADS
+  if (count < 0)
+    return progress.stopped_error();
 
   PyObject *py_areas = array_python_source(areas, !alloc_areas);
   return py_areas;
 }
 
+// Python wrapper for areas of sphere groups and areas buried between groups.
+extern "C" PyObject *buried_areas_of_sphere_groups(PyObject *, PyObject *args, PyObject *keywds)
+{
+  DArray centers, radii;
+  IArray groups;
+  const char *kwlist[] = {"centers", "radii", "groups", NULL};
+  if (!PyArg_ParseTupleAndKeywords(args, keywds,
+				   const_cast<char *>("O&O&O&"), (char **)kwlist,
+				   parse_double_n3_array, &centers,
+				   parse_double_n_array, &radii,
+				   parse_int_n_array, &groups))
+    return NULL;
+
+  DArray ca = centers.contiguous_array();
+  DArray ra = radii.contiguous_array();
+  IArray ga = groups.contiguous_array();
+  int n = ca.size(0);
+  if (ra.size(0) != n || ga.size(0) != n)
+    {
+      PyErr_SetString(PyExc_TypeError,
+		      "buried_areas_of_sphere_groups: centers, radii and groups arrays must be the same length.");
+      return NULL;
+    }
+
+  double *areas;
+  PyObject *py_areas = python_double_array(n, &areas);
+  Group_Burials burials;
+  Py_BEGIN_ALLOW_THREADS
+  TRACE_SCOPE_ITEMS("surface.buried_areas_of_sphere_groups", n);
+  buried_areas_of_sphere_groups(ca.values(), n, ra.values(), ga.values(), areas, burials);
+  Py_END_ALLOW_THREADS
+
+  int nb = burials.size();
+  int *bsphere, *bgroup;
+  double *barea;
+  PyObject *py_bsphere = python_int_array(nb, &bsphere);
+  PyObject *py_bgroup = python_int_array(nb, &bgroup);
+  PyObject *py_barea = python_double_array(nb, &barea);
+  for (int b = 0 ; b < nb ; ++b)
+    {
+      bsphere[b] = burials[b].sphere;
+      bgroup[b] = burials[b].group;
+      barea[b] = burials[b].buried_area;
+    }
+  return python_tuple(py_areas, py_bsphere, py_bgroup, py_barea);
+}
+
+static void delete_sphere_regions(PyObject *capsule)
+{
+  delete static_cast<Sphere_Regions *>(PyCapsule_GetPointer(capsule, "Sphere_Regions"));
+}
+
+// Python wrapper making regions to reuse for several area calculations.
+extern "C" PyObject *sphere_regions(PyObject *, PyObject *args, PyObject *keywds)
+{
+  double padding;
+  const char *kwlist[] = {"padding", NULL};
+  if (!PyArg_ParseTupleAndKeywords(args, keywds,
+				   const_cast<char *>("d"), (char **)kwlist,
+				   &padding))
+    return NULL;
+  if (padding < 0)
+    {
+      PyErr_SetString(PyExc_ValueError, "sphere_regions: padding must not be negative");
+      return NULL;
+    }
+  return PyCapsule_New(new Sphere_Regions(padding), "Sphere_Regions", delete_sphere_regions);
+}
+
 // Python wrapper for numerical estimate of solvent accessible area calculation.
 extern "C" PyObject *estimate_surface_area_of_spheres(PyObject *, PyObject *args, PyObject *keywds)
 {
@@ -869,9 +1141,11 @@ extern "C" PyObject *estimate_surface_area_of_spheres(PyObject *, PyObject *args
 		      "estimate_surface_area_of_spheres: sphere points and weights arrays must be the same length.");
       return NULL;
     }
+  Py_BEGIN_ALLOW_THREADS
   estimate_surface_area_of_spheres(ca.values(), ca.size(0), ra.values(),
 				   pa.values(), pa.size(0), wa.values(),
 				   areas.values());
+  Py_END_ALLOW_THREADS
   PyObject *py_areas = array_python_source(areas, !alloc_areas);
   return py_areas;
 }
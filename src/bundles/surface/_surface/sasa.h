@@ -35,9 +35,15 @@
 extern "C"
 {
 
-// bool surface_area_of_spheres(centers, radii, areas).  Can fail in degenerate cases returning false.
+// bool surface_area_of_spheres(centers, radii, areas, regions, progress).  Can fail in degenerate cases returning false.
 PyObject *surface_area_of_spheres(PyObject *s, PyObject *args, PyObject *keywds);
 
+// areas, sphere, group, buried = buried_areas_of_sphere_groups(centers, radii, groups)
+PyObject *buried_areas_of_sphere_groups(PyObject *s, PyObject *args, PyObject *keywds);
+
+// regions = sphere_regions(padding) for reuse in surface_area_of_spheres() calls.
+PyObject *sphere_regions(PyObject *s, PyObject *args, PyObject *keywds);
+
 // Use points on unit sphere, count how many are inside other spheres.
 //   estimate_surface_area_of_spheres(centers, radii, sphere_points, point_weights, areas)
 PyObject *estimate_surface_area_of_spheres(PyObject *s, PyObject *args, PyObject *keywds);
@@ -1,12 +1,104 @@
 // ----------------------------------------------------------------------------
 //
 #include <Python.h>			// use PyObject
+#include <vector>			// use std::vector
 
 #include <arrays/pythonarray.h>	// use parse_float_n3_array(), ...
 #include <arrays/rcarray.h>	// use IArray, FArray
+#include <arrays/threadpool.h>	// use Thread_Pool::thread_count(), run()
 
-static void smooth_vertices(FArray &varray, const IArray &tarray,
-			    float smoothing_factor, int smoothing_iterations);
+// ----------------------------------------------------------------------------
+// For each vertex the pairs of other vertices of each triangle using it, in
+// compressed row form.  Made once for a triangulation and used for all
+// smoothing iterations and for smoothing several arrays, such as vertices
+// and normals, with the same triangles.
+//
+class Vertex_Adjacency
+{
+public:
+  Vertex_Adjacency(const IArray &tarray, int64_t vertex_count);
+  int64_t vertex_count, triangle_count;
+  std::vector<int64_t> start;	// Index into pairs for each vertex, size vertex_count+1.
+  std::vector<int> pairs;	// Two vertex indices per vertex triangle.
+};
+
+// ----------------------------------------------------------------------------
+//
+Vertex_Adjacency::Vertex_Adjacency(const IArray &tarray, int64_t vertex_count)
+  : vertex_count(vertex_count), triangle_count(tarray.size(0)), start(vertex_count+1, 0)
+{
+  IArray tc = tarray.contiguous_array();
+  int64_t m = 3*triangle_count;
+  const int *vi = tc.values();
+  for (int64_t t = 0 ; t < m ; ++t)
+    start[vi[t]+1] += 2;
+  for (int64_t k = 0 ; k < vertex_count ; ++k)
+    start[k+1] += start[k];
+
+  // Fill pairs in triangle order so sums match adding triangle by triangle.
+  pairs.resize(start[vertex_count]);
+  std::vector<int64_t> fill(start.begin(), start.end()-1);
+  for (int64_t t = 0 ; t < m ; t += 3)
+    {
+      int i0 = vi[t], i1 = vi[t+1], i2 = vi[t+2];
+      int *p = &pairs[fill[i0]]; p[0] = i1; p[1] = i2; fill[i0] += 2;
+      p = &pairs[fill[i1]]; p[0] = i0; p[1] = i2; fill[i1] += 2;
+      p = &pairs[fill[i2]]; p[0] = i0; p[1] = i1; fill[i2] += 2;
+    }
+}
+
+// ----------------------------------------------------------------------------
+// Each iteration replaces every vertex by a mix of itself and the average of
+// its neighbors using only positions from the previous iteration, so vertex
+// ranges are done on separate threads.
+//
+static void smooth_vertices(FArray &varray, const Vertex_Adjacency &adj,
+			    float smoothing_factor, int smoothing_iterations)
+{
+  int64_t n = varray.size(0);
+  float *va = varray.values();
+  int64_t s0 = varray.stride(0), s1 = varray.stride(1);
+  std::vector<float> xyz(3*n), xyz_new(3*n);
+  for (int64_t k = 0 ; k < n ; ++k)
+    for (int a = 0 ; a < 3 ; ++a)
+      xyz[3*k+a] = va[s0*k+s1*a];
+
+  const int64_t *start = adj.start.data();
+  const int *pairs = adj.pairs.data();
+  float fv = 1 - smoothing_factor, fa = smoothing_factor;
+  auto smooth_range = [&](int64_t k0, int64_t k1) {
+    const float *p = xyz.data();
+    float *pn = xyz_new.data();
+    for (int64_t k = k0 ; k < k1 ; ++k)
+      {
+	int64_t e0 = start[k], e1 = start[k+1];
+	int count = static_cast<int>(e1 - e0);
+	for (int a = 0 ; a < 3 ; ++a)
+	  {
+	    float v = p[3*k+a];
+	    if (count)
+	      {
+		float an = 0;
+		for (int64_t e = e0 ; e < e1 ; e += 2)
+		  an += p[3*pairs[e]+a] + p[3*pairs[e+1]+a];
+		v = fv * v + fa * an / count;
+	      }
+	    pn[3*k+a] = v;
+	  }
+      }
+  };
+
+  int64_t nt = Thread_Pool::thread_count(n, 100000);
+  for (int iter = 0 ; iter < smoothing_iterations ; ++iter)
+    {
+      Thread_Pool::run(nt, [&](int t) { smooth_range(n*t/nt, n*(t+1)/nt); });
+      xyz.swap(xyz_new);
+    }
+
+  for (int64_t k = 0 ; k < n ; ++k)
+    for (int a = 0 ; a < 3 ; ++a)
+      va[s0*k+s1*a] = xyz[3*k+a];
+}
 
 // ----------------------------------------------------------------------------
 //
@@ -16,70 +108,77 @@ extern "C" PyObject *smooth_vertex_positions(PyObject *, PyObject *args, PyObjec
   IArray tarray;
   float smoothing_factor;
   int smoothing_iterations;
-  const char *kwlist[] = {"vertices", "triangles", "smoothing_factor", "smoothing_iterations", NULL};
+  PyObject *py_adjacency = Py_None;
+  const char *kwlist[] = {"vertices", "triangles", "smoothing_factor", "smoothing_iterations",
+			  "adjacency", NULL};
   if (!PyArg_ParseTupleAndKeywords(args, keywds,
-				   const_cast<char *>("O&O&fi"), (char **)kwlist,
+				   const_cast<char *>("O&O&fi|O"), (char **)kwlist,
 				   parse_float_n3_array, &varray,
 				   parse_int_n3_array, &tarray,
 				   &smoothing_factor,
-				   &smoothing_iterations))
+				   &smoothing_iterations,
+				   &py_adjacency))
     return NULL;
 
-  smooth_vertices(varray, tarray, smoothing_factor, smoothing_iterations);
+  Vertex_Adjacency *adj = NULL;
+  if (py_adjacency != Py_None)
+    {
+      adj = static_cast<Vertex_Adjacency *>(PyCapsule_GetPointer(py_adjacency, "Vertex_Adjacency"));
+      if (adj == NULL)
+	return NULL;
+      if (adj->vertex_count != varray.size(0) || adj->triangle_count != tarray.size(0))
+	{
+	  PyErr_SetString(PyExc_ValueError,
+			  "smooth_vertex_positions(): adjacency was made for a different number of vertices or triangles");
+	  return NULL;
+	}
+    }
+
+  Py_BEGIN_ALLOW_THREADS
+  if (adj)
+    smooth_vertices(varray, *adj, smoothing_factor, smoothing_iterations);
+  else
+    smooth_vertices(varray, Vertex_Adjacency(tarray, varray.size(0)),
+		    smoothing_factor, smoothing_iterations);
+  Py_END_ALLOW_THREADS
+
   return python_none();
 }
 
 // ----------------------------------------------------------------------------
 //
-static void smooth_vertices(FArray &varray, const IArray &tarray,
-			    float smoothing_factor, int smoothing_iterations)
+static void delete_vertex_adjacency(PyObject *capsule)
 {
-  int64_t n = varray.size(0);
-  IArray counts(1, &n);
-  counts.set(0);
-  int *c = counts.values();
+  delete static_cast<Vertex_Adjacency *>(PyCapsule_GetPointer(capsule, "Vertex_Adjacency"));
+}
 
-  IArray tc = tarray.contiguous_array();
-  int m = tarray.size();
-  int *vi = tc.values();
-  for (int t = 0 ; t < m ; ++t)
-    c[vi[t]] += 2;
+// ----------------------------------------------------------------------------
+//
+extern "C" PyObject *vertex_adjacency(PyObject *, PyObject *args, PyObject *keywds)
+{
+  IArray tarray;
+  int vertex_count;
+  const char *kwlist[] = {"triangles", "vertex_count", NULL};
+  if (!PyArg_ParseTupleAndKeywords(args, keywds,
+				   const_cast<char *>("O&i"), (char **)kwlist,
+				   parse_int_n3_array, &tarray,
+				   &vertex_count))
+    return NULL;
 
-  FArray ave_neighbors(2, varray.sizes());
-  float *an = ave_neighbors.values();
-  float *va = varray.values();
-  int s0 = varray.stride(0), s1 = varray.stride(1);
-  float fv = 1 - smoothing_factor, fa = smoothing_factor;
-  for (int iter = 0 ; iter < smoothing_iterations ; ++iter)
-    {
-      ave_neighbors.set(0);
-      for (int t = 0 ; t < m ; t += 3)
-	{
-	  int i0 = vi[t], i1 = vi[t+1], i2 = vi[t+2];
-	  int v0 = s0*i0, v1 = s0*i1, v2 = s0*i2;
-	  int n0 = 3*i0, n1 = 3*i1, n2 = 3*i2;
-	  for (int a = 0 ; a < 3 ; ++a)
-	    {
-	      int s1a = s1*a;
-	      float va0 = va[v0+s1a], va1 = va[v1+s1a], va2 = va[v2+s1a];
-	      an[n0+a] += va1 + va2;
-	      an[n1+a] += va0 + va2;
-	      an[n2+a] += va0 + va1;
-	    }
-	}
+  IArray tc = tarray.contiguous_array();
+  int64_t m = tc.size();
+  const int *vi = tc.values();
+  for (int64_t t = 0 ; t < m ; ++t)
+    if (vi[t] < 0 || vi[t] >= vertex_count)
+      {
+	PyErr_Format(PyExc_ValueError, "vertex_adjacency(): triangle vertex index %d out of range 0-%d",
+		     vi[t], vertex_count-1);
+	return NULL;
+      }
 
-      for (int k = 0 ; k < n ; ++k)
-	{
-	  int count = c[k];
-	  if (count)
-	    {
-	      int s0k = s0*k, k3 = 3*k;
-	      for (int a = 0 ; a < 3 ; ++a)
-		{
-		  int v = s0k + a*s1;
-		  va[v] = fv * va[v] + fa * an[k3+a] / count;
-		}
-	    }
-	}
-    }
+  Vertex_Adjacency *adj;
+  Py_BEGIN_ALLOW_THREADS
+  adj = new Vertex_Adjacency(tc, vertex_count);
+  Py_END_ALLOW_THREADS
+  return PyCapsule_New(adj, "Vertex_Adjacency", delete_vertex_adjacency);
 }
@@ -39,9 +39,18 @@ extern "C"
 // The vertex array is xyz points (n by 3, NumPy C float).
 // The triangle array is triples of indices into the vertex array.
 //
-// Args: vertex_array, triangle_array, float smoothing_factor, int smoothing_iterations
+// Args: vertex_array, triangle_array, float smoothing_factor, int smoothing_iterations,
+//       adjacency (optional, from vertex_adjacency())
 //
 PyObject *smooth_vertex_positions(PyObject *, PyObject *args, PyObject *keywds);
+
+//
+// Make a record of the triangles using each vertex which can be passed to
+// several smooth_vertex_positions() calls with the same triangles.
+//
+// Args: triangle_array, int vertex_count
+//
+PyObject *vertex_adjacency(PyObject *, PyObject *args, PyObject *keywds);
 }
 
 #endif
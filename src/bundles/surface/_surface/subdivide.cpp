@@ -34,12 +34,16 @@
 #include <Python.h>			// use PyObject
 
 //#include <iostream>			// use std::cerr for debugging
+#include <algorithm>			// use std::sort()
+#include <cstdint>			// use uint64_t
 #include <set>				// use std::set<>
+#include <vector>			// use std::vector
 
 #include <math.h>			// use sqrt()
 
 #include <arrays/pythonarray.h>		// use array_from_python()
 #include <arrays/rcarray.h>		// use FArray, IArray
+#include <arrays/threadpool.h>		// use Thread_Pool::thread_count(), run()
 
 typedef std::vector<int> Indices;
 
@@ -95,12 +99,15 @@ public:
 // ----------------------------------------------------------------------------
 //
 static PyObject *python_geometry(PyObject *v, PyObject *t, PyObject *n);
-static void find_edges(const IArray &tc, std::set<Edge> &eset);
-static void subdivided_vertices(const FArray &varray, std::set<Edge> &eset,
+static int64_t split_edges(const IArray &triangles, const FArray &varray, float edge_length,
+			   std::vector<int> &edge_vertex, std::vector<uint64_t> &edges);
+static void subdivided_vertices(const FArray &varray, const std::vector<uint64_t> &edges,
 				float *varray2);
 static void interpolated_vertex(float *v1, float *v2, float frac, float *vf);
-static void subdivided_triangles(const IArray &tc, std::set<Edge> &eset,
-				 int *tarray2);
+static int64_t subdivided_triangle_offsets(const std::vector<int> &edge_vertex,
+					   std::vector<int64_t> &toffset);
+static void subdivided_triangles(const IArray &triangles, const std::vector<int> &edge_vertex,
+				 const std::vector<int64_t> &toffset, int *tarray2);
 static void normalize_normals(float *na, int nv);
 static void point_vector(const FArray &varray, std::vector<float> &va);
 static void subdivide_triangle(int i1, int i2, int i3, float elength,
@@ -119,12 +126,14 @@ subdivide_triangles(PyObject *, PyObject *args, PyObject *keywds)
 {
   FArray varray, narray;
   IArray tarray;
-  const char *kwlist[] = {"vertices", "triangles", "normals", NULL};
-  if (!PyArg_ParseTupleAndKeywords(args, keywds, const_cast<char *>("O&O&|O&"),
+  float edge_length = 0;
+  const char *kwlist[] = {"vertices", "triangles", "normals", "edge_length", NULL};
+  if (!PyArg_ParseTupleAndKeywords(args, keywds, const_cast<char *>("O&O&|O&f"),
 				   (char **)kwlist,
 				   parse_float_n3_array, &varray,
 				   parse_int_n3_array, &tarray,
-				   parse_float_n3_array, &narray))
+				   parse_float_n3_array, &narray,
+				   &edge_length))
     return NULL;
   if (narray.dimension() == 2 && narray.size(0) != varray.size(0))
     {
@@ -133,31 +142,40 @@ subdivide_triangles(PyObject *, PyObject *args, PyObject *keywds)
       return NULL;
     }
 
-  // Record all unique edges, so one midpoint is created just once
-  // for edges that occur in 2 or more triangles.
-  std::set<Edge> eset;  
-  find_edges(tarray, eset);
+  // Find unique edges to split, so one midpoint is created just once
+  // for edges that occur in 2 or more triangles, and count the new triangles.
+  std::vector<int> edge_vertex;
+  std::vector<uint64_t> edges;
+  std::vector<int64_t> toffset;
+  int64_t nv, nt;
+  Py_BEGIN_ALLOW_THREADS
+  nv = varray.size(0) + split_edges(tarray, varray, edge_length, edge_vertex, edges);
+  nt = subdivided_triangle_offsets(edge_vertex, toffset);
+  Py_END_ALLOW_THREADS
 
   // Make new vertex array including mid-points.
-  int nv = varray.size(0) + eset.size();
   float *va2;
   PyObject *varray2 = python_float_array(nv, 3, &va2);
-  subdivided_vertices(varray, eset, va2);
 
   // Make new triangle array.
-  int *ta2, nt = 4*tarray.size(0);
+  int *ta2;
   PyObject *tarray2 = python_int_array(nt, 3, &ta2);
-  subdivided_triangles(tarray, eset, ta2);
 
   // Make new normals array including mid-points.
   PyObject *narray2 = NULL;
+  float *na2 = NULL;
   if (narray.dimension() == 2)
+    narray2 = python_float_array(nv, 3, &na2);
+
+  Py_BEGIN_ALLOW_THREADS
+  subdivided_vertices(varray, edges, va2);
+  subdivided_triangles(tarray, edge_vertex, toffset, ta2);
+  if (na2)
     {
-      float *na2;
-      narray2 = python_float_array(nv, 3, &na2);
-      subdivided_vertices(narray, eset, na2);
+      subdivided_vertices(narray, edges, na2);
       normalize_normals(na2, nv);
     }
+  Py_END_ALLOW_THREADS
 
   return python_geometry(varray2, tarray2, narray2);
 }
@@ -170,45 +188,100 @@ static PyObject *python_geometry(PyObject *v, PyObject *t, PyObject *n)
 }
 
 // ----------------------------------------------------------------------------
+// Call f(start, end) for ranges of n items on shared pool threads if there
+// are enough items to make threads worthwhile.
 //
-static void find_edges(const IArray &triangles, std::set<Edge> &eset)
+template <class F>
+static void split_over_threads(int64_t n, F f)
 {
-  Edge e;
-  int *ta = triangles.values();
-  int s0 = triangles.stride(0), s1 = triangles.stride(1);
-  int tcount = triangles.size(0);
-  for (int t = 0 ; t < tcount ; ++t)
+  int64_t nt = Thread_Pool::thread_count(n, 100000);
+  Thread_Pool::run(nt, [&](int t) { f(n*t/nt, n*(t+1)/nt); });
+}
+
+// ----------------------------------------------------------------------------
+//
+inline uint64_t edge_key(int v1, int v2)
+{
+  uint64_t vmin = (v1 < v2 ? v1 : v2), vmax = (v1 < v2 ? v2 : v1);
+  return (vmin << 32) | vmax;
+}
+
+// ----------------------------------------------------------------------------
+// Find the edges to split, all edges if edge_length is not positive, otherwise
+// those longer than edge_length.  Returns the number of split edges, sets the
+// new mid-point vertex index, or -1 if not split, for each triangle edge
+// 3*t+e (edge e goes from triangle vertex e to e+1), and lists the split edges
+// in the order of their new vertices, sorted by lower then higher vertex index.
+//
+static int64_t split_edges(const IArray &triangles, const FArray &varray, float edge_length,
+			   std::vector<int> &edge_vertex, std::vector<uint64_t> &edges)
+{
+  int64_t tcount = triangles.size(0);
+  const int *ta = triangles.values();
+  int64_t s0 = triangles.stride(0), s1 = triangles.stride(1);
+
+  // Sort edge uses, each being the key and triangle edge index.
+  std::vector<std::pair<uint64_t,int64_t> > uses(3*tcount);
+  split_over_threads(tcount, [&](int64_t t0, int64_t t1) {
+      for (int64_t t = t0 ; t < t1 ; ++t)
+	{
+	  int v1 = ta[s0*t], v2 = ta[s0*t+s1], v3 = ta[s0*t+2*s1];
+	  uses[3*t] = std::make_pair(edge_key(v1,v2), 3*t);
+	  uses[3*t+1] = std::make_pair(edge_key(v2,v3), 3*t+1);
+	  uses[3*t+2] = std::make_pair(edge_key(v3,v1), 3*t+2);
+	}
+    });
+  std::sort(uses.begin(), uses.end());
+
+  const float *va = varray.values();
+  int64_t vs0 = varray.stride(0), vs1 = varray.stride(1);
+  float elength2 = edge_length*edge_length;
+  int nv = varray.size(0);
+  edge_vertex.resize(3*tcount);
+  edges.clear();
+  int64_t nu = uses.size();
+  for (int64_t u = 0 ; u < nu ; )
     {
-      int v1 = ta[s0*t], v2 = ta[s0*t+s1], v3 = ta[s0*t+2*s1];
-      e.set_endpoints(v1, v2);
-      eset.insert(e);
-      e.set_endpoints(v2, v3);
-      eset.insert(e);
-      e.set_endpoints(v3, v1);
-      eset.insert(e);
+      uint64_t key = uses[u].first;
+      bool split = true;
+      if (edge_length > 0)
+	{
+	  const float *p1 = va + vs0*(key >> 32), *p2 = va + vs0*(key & 0xffffffff);
+	  float dx = p1[0]-p2[0], dy = p1[vs1]-p2[vs1], dz = p1[2*vs1]-p2[2*vs1];
+	  split = (dx*dx + dy*dy + dz*dz > elength2);
+	}
+      int ev = -1;
+      if (split)
+	{
+	  ev = nv + edges.size();
+	  edges.push_back(key);
+	}
+      for ( ; u < nu && uses[u].first == key ; ++u)
+	edge_vertex[uses[u].second] = ev;
     }
+  return edges.size();
 }
 
 // ----------------------------------------------------------------------------
 //
-static void subdivided_vertices(const FArray &varray, std::set<Edge> &eset,
+static void subdivided_vertices(const FArray &varray, const std::vector<uint64_t> &edges,
 				float *varray2)
 {
   FArray vc = varray.contiguous_array();
   float *vfrom = vc.values();
-  int vsz = vc.size();
-  for (int k = 0 ; k < vsz ; ++k)
+  int64_t vsz = vc.size();
+  for (int64_t k = 0 ; k < vsz ; ++k)
     varray2[k] = vfrom[k];			// Copy original vertices.
 
   // Compute mid-points
-  int vi = vc.size(0);
-  for (std::set<Edge>::iterator ei = eset.begin() ; ei != eset.end() ; ++ei)
-  {
-    interpolated_vertex(vfrom+3*(*ei).vindex1, vfrom+3*(*ei).vindex2, 0.5,
-			&(varray2[3*vi]));
-    (*ei).ev1 = vi;
-    vi += 1;
-  }
+  float *vmid = varray2 + vsz;
+  split_over_threads(edges.size(), [&](int64_t e0, int64_t e1) {
+      for (int64_t e = e0 ; e < e1 ; ++e)
+	{
+	  uint64_t key = edges[e];
+	  interpolated_vertex(vfrom+3*(key >> 32), vfrom+3*(key & 0xffffffff), 0.5, vmid+3*e);
+	}
+    });
 }
 
 // ----------------------------------------------------------------------------
@@ -221,28 +294,80 @@ static void interpolated_vertex(float *v1, float *v2, float frac, float *vf)
 }
 
 // ----------------------------------------------------------------------------
+// A triangle with k split edges becomes k+1 triangles.  Compute the index of
+// the first new triangle for each triangle so they can be filled in parallel.
+// Returns the new triangle count.
 //
-static void subdivided_triangles(const IArray &tc, std::set<Edge> &eset,
-				 int *tarray2)
+static int64_t subdivided_triangle_offsets(const std::vector<int> &edge_vertex,
+					   std::vector<int64_t> &toffset)
 {
-  int tcount = tc.size(0);
-  int *tcv = tc.values();
-  Edge e;
-  for (int t = 0 ; t < tcount ; ++t)
+  int64_t tcount = edge_vertex.size()/3;
+  toffset.resize(tcount);
+  int64_t nt = 0;
+  for (int64_t t = 0 ; t < tcount ; ++t)
     {
-      int v1 = tcv[3*t], v2 = tcv[3*t+1], v3 = tcv[3*t+2];
-      e.set_endpoints(v1, v2);
-      int v12 = eset.find(e)->ev1;
-      e.set_endpoints(v2, v3);
-      int v23 = eset.find(e)->ev1;
-      e.set_endpoints(v3, v1);
-      int v31 = eset.find(e)->ev1;
-      int *ts = &(tarray2[12*t]);
-      ts[0] = v1; ts[1] = v12; ts[2] = v31;
-      ts[3] = v2; ts[4] = v23; ts[5] = v12;
-      ts[6] = v3; ts[7] = v31; ts[8] = v23;
-      ts[9] = v12; ts[10] = v23; ts[11] = v31;
+      toffset[t] = nt;
+      const int *ev = &edge_vertex[3*t];
+      nt += 1 + (ev[0] >= 0) + (ev[1] >= 0) + (ev[2] >= 0);
     }
+  return nt;
+}
+
+// ----------------------------------------------------------------------------
+//
+inline void set_triangle(int *t, int v1, int v2, int v3)
+{
+  t[0] = v1; t[1] = v2; t[2] = v3;
+}
+
+// ----------------------------------------------------------------------------
+// Triangles with one or two split edges are divided without making new
+// vertices on the unsplit edges, so neighbor triangles still share edges.
+//
+static void subdivided_triangles(const IArray &triangles, const std::vector<int> &edge_vertex,
+				 const std::vector<int64_t> &toffset, int *tarray2)
+{
+  int64_t tcount = triangles.size(0);
+  const int *ta = triangles.values();
+  int64_t s0 = triangles.stride(0), s1 = triangles.stride(1);
+  split_over_threads(tcount, [&](int64_t t0, int64_t t1) {
+      for (int64_t t = t0 ; t < t1 ; ++t)
+	{
+	  int v[3] = {ta[s0*t], ta[s0*t+s1], ta[s0*t+2*s1]};
+	  const int *ev = &edge_vertex[3*t];
+	  int *ts = tarray2 + 3*toffset[t];
+	  int ns = (ev[0] >= 0) + (ev[1] >= 0) + (ev[2] >= 0);
+	  if (ns == 3)
+	    {
+	      int v1 = v[0], v2 = v[1], v3 = v[2];
+	      int v12 = ev[0], v23 = ev[1], v31 = ev[2];
+	      ts[0] = v1; ts[1] = v12; ts[2] = v31;
+	      ts[3] = v2; ts[4] = v23; ts[5] = v12;
+	      ts[6] = v3; ts[7] = v31; ts[8] = v23;
+	      ts[9] = v12; ts[10] = v23; ts[11] = v31;
+	    }
+	  else if (ns == 0)
+	    set_triangle(ts, v[0], v[1], v[2]);
+	  else if (ns == 1)
+	    {
+	      // Rotate so edge a-b is split.
+	      int e = (ev[0] >= 0 ? 0 : (ev[1] >= 0 ? 1 : 2));
+	      int a = v[e], b = v[(e+1)%3], c = v[(e+2)%3], m = ev[e];
+	      set_triangle(ts, a, m, c);
+	      set_triangle(ts+3, m, b, c);
+	    }
+	  else
+	    {
+	      // Rotate so edge c-a is not split.
+	      int e = (ev[0] < 0 ? 1 : (ev[1] < 0 ? 2 : 0));
+	      int a = v[e], b = v[(e+1)%3], c = v[(e+2)%3];
+	      int mab = ev[e], mbc = ev[(e+1)%3];
+	      set_triangle(ts, b, mbc, mab);
+	      set_triangle(ts+3, a, mab, mbc);
+	      set_triangle(ts+6, a, mbc, c);
+	    }
+	}
+    });
 }
 
 // ----------------------------------------------------------------------------
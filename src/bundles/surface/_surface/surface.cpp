@@ -39,6 +39,7 @@
 #include "subdivide.h"			// use subdivide_triangles
 #include "triangulate.h"		// use triangulate_polygon
 #include "tube.h"			// use tube_geometry
+#include "zonecolor.h"			// use zone_color_index, zone_color_vertices
 
 namespace Surface_Cpp
 {
@@ -52,9 +53,12 @@ static struct PyMethodDef surface_cpp_methods[] =
    (PyCFunction)compute_cap,
    METH_VARARGS|METH_KEYWORDS,
 R"(
-compute_cap(plane_normal, plane_offset, varray, tarray)
+compute_cap(plane_normal, plane_offset, varray, tarray, cache = None)
 
 Compute the portion of a plane inside a given surface.
+An optional cache from cap_cache() made for the same surface and
+plane normal makes repeated caps at different offsets faster by
+only examining the triangles near the plane.
 Implemented in C++.
 
 Returns
@@ -64,6 +68,24 @@ cap_triangles : m by 3 array of int
 )"
   },
 
+// ----------------------------------------------------------------------------
+  {const_cast<char*>("cap_cache"),
+   (PyCFunction)cap_cache,
+   METH_VARARGS|METH_KEYWORDS,
+R"(
+cap_cache(plane_normal, varray, tarray)
+
+Record vertex heights along the plane normal and triangles sorted by
+height for computing caps at many plane offsets with compute_cap().
+The arrays must not be modified while the cache is used.
+Implemented in C++.
+
+Returns
+-------
+cache : opaque object
+)"
+  },
+
 // ----------------------------------------------------------------------------  
   /* connected.h */
   {const_cast<char*>("connected_triangles"),
@@ -114,6 +136,27 @@ Implemented in C++.
 )"
   },
 
+// ----------------------------------------------------------------------------
+  {const_cast<char*>("triangle_pieces"),
+   (PyCFunction)triangle_pieces,
+   METH_VARARGS|METH_KEYWORDS,
+R"(
+triangle_pieces(triangles, vertices = None)
+
+Label each triangle with the connected piece it belongs to.  Pieces are
+numbered in order of their first triangle.  Vertices connected by any
+sequence of triangle edges are considered connected.  This is much faster
+than connected_pieces() for surfaces with many pieces and uses threads.
+Implemented in C++.
+
+Returns
+-------
+triangle_piece : 1d array of int, piece number for each triangle
+triangle_counts : 1d array of int, number of triangles in each piece
+bounds : p by 2 by 3 array of float, min and max xyz of each piece, or None if no vertices given
+)"
+  },
+
 // ----------------------------------------------------------------------------
   /* convexity.h */
   {const_cast<char*>("vertex_convexity"),
@@ -169,6 +212,26 @@ area : float
 )"
   },
 
+// ----------------------------------------------------------------------------
+  {const_cast<char*>("enclosed_volumes_and_areas"),
+   (PyCFunction)enclosed_volumes_and_areas,
+   METH_VARARGS|METH_KEYWORDS,
+R"(
+enclosed_volumes_and_areas(surfaces)
+
+Enclosed volume, surface area and hole count for each of a sequence of
+(vertices, triangles) pairs.  Surfaces are measured in parallel threads.
+Volume is -1 if a surface has boundary edges traversed in opposing directions.
+Implemented in C++.
+
+Returns
+-------
+volumes : 1d array of float
+areas : 1d array of float
+hole_counts : 1d array of int
+)"
+  },
+
 // ----------------------------------------------------------------------------
   {const_cast<char*>("vertex_areas"),
    (PyCFunction)vertex_areas,
@@ -319,11 +382,50 @@ ref_triangles : n by 3 array of int
    (PyCFunction)surface_area_of_spheres,
    METH_VARARGS|METH_KEYWORDS,
 R"(
-surface_area_of_spheres(centers, radii, areas)
+surface_area_of_spheres(centers, radii, areas, regions, progress)
 
 Compute surface area of union of solid sphere.
 Third argument areas contains areas contributed by each sphere
 Can fail in degenerate cases giving area -1 for spheres with failed area calculation.
+Optional regions from sphere_regions() keeps the grouping of nearby spheres
+between calls, for instance for trajectory frames with small motions.
+Optional progress is a callback given the fraction done, or a
+chimerax.arrays.ProgressToken; cancelling the token raises ComputationCancelled.
+Uses multiple threads.
+Implemented in C++.
+)"
+  },
+
+// ----------------------------------------------------------------------------    
+  {const_cast<char*>("buried_areas_of_sphere_groups"),
+   (PyCFunction)buried_areas_of_sphere_groups,
+   METH_VARARGS|METH_KEYWORDS,
+R"(
+buried_areas_of_sphere_groups(centers, radii, groups) -> areas, sphere, group, buried
+
+Compute exposed area of each sphere with only spheres of its own group
+present, and the additional area of each sphere buried by each other group
+touching it.  Groups is an integer array assigning each sphere to a group.
+Returns the per sphere areas and three parallel arrays listing sphere index,
+other group and buried area, ordered by sphere then group.  Area between
+groups g and h is half the sum of burials of g spheres by h and h spheres
+by g.  Failed area calculations give area -1 and no burials for that sphere.
+Uses multiple threads.
+Implemented in C++.
+)"
+  },
+
+// ----------------------------------------------------------------------------    
+  {const_cast<char*>("sphere_regions"),
+   (PyCFunction)sphere_regions,
+   METH_VARARGS|METH_KEYWORDS,
+R"(
+sphere_regions(padding)
+
+Make a record of nearby spheres to pass to surface_area_of_spheres() calls.
+Nearby spheres are recomputed only when the number of spheres or radii
+change or some sphere moves more than the padding distance.  Larger padding
+means fewer recomputations but more sphere pairs tested.
 Implemented in C++.
 )"
   },
@@ -348,10 +450,26 @@ Implemented in C++.
    (PyCFunction)smooth_vertex_positions,
    METH_VARARGS|METH_KEYWORDS,
 R"(
-smooth_vertex_positions(vertices, triangles, smoothing_factor, smoothing_iterations)
+smooth_vertex_positions(vertices, triangles, smoothing_factor, smoothing_iterations, adjacency = None)
 
 Move surface vertices towards the average of neighboring vertices
 to give the surface a smoother appearance.  Modifies vertices numpy array.
+Optional adjacency from vertex_adjacency() avoids recomputing which triangles
+use each vertex when smoothing several arrays with the same triangles.
+Uses multiple threads.
+Implemented in C++.
+)"
+  },
+
+// ----------------------------------------------------------------------------
+  {const_cast<char*>("vertex_adjacency"),
+   (PyCFunction)vertex_adjacency,
+   METH_VARARGS|METH_KEYWORDS,
+R"(
+vertex_adjacency(triangles, vertex_count)
+
+Make a record of the triangles using each vertex to pass to
+smooth_vertex_positions() calls with the same triangles.
 Implemented in C++.
 )"
   },
@@ -362,9 +480,13 @@ Implemented in C++.
    (PyCFunction)subdivide_triangles,
    METH_VARARGS|METH_KEYWORDS,
 R"(
-subdivide_triangles(vertices, triangles, normals)
+subdivide_triangles(vertices, triangles, normals, edge_length = 0)
 
 Divide each triangle into 4 triangles placing new vertices at edge midpoints.
+If edge_length is positive only edges longer than that length are split,
+triangles with one or two split edges being divided into 2 or 3 triangles,
+so refinement can be limited to large triangles, for instance those larger
+than a pixel.  Uses multiple threads.
 Implemented in C++.
 
 Returns
@@ -468,6 +590,72 @@ Implemented in C++.
 Returns
 -------
 triangle_mask : 1d array of uint8
+)"
+  },
+
+// ----------------------------------------------------------------------------    
+  {const_cast<char*>("tubes_geometry"),
+   (PyCFunction)tubes_geometry,
+   METH_VARARGS|METH_KEYWORDS,
+R"(
+tubes_geometry(paths, tangents, offsets, cross_section, cross_section_normals, colors = None, tube_mask = None)
+
+Calculates surface geometry for many tubes with the same cross section in one
+set of arrays, as made by tube_geometry() for each path.  Paths and tangents
+are the concatenated n by 3 float arrays for all paths, and tube k uses points
+offsets[k] through offsets[k+1]-1, so offsets has one more entry than the
+number of tubes.  Optional colors (n by 4 uint8) give a color for each path
+point and optional tube_mask (uint8 per tube) gives which tubes are shown.
+Tubes are computed in parallel.
+Implemented in C++.
+
+Returns
+-------
+vertices : n by 3 array of float
+normals : n by 3 array of float
+triangles : m by 3 array of int
+vertex_colors : n by 4 array of uint8, or None if colors not given
+triangle_mask : 1d array of bool, or None if tube_mask not given
+)"
+  },
+
+// ----------------------------------------------------------------------------    
+  /* zonecolor.h */
+  {const_cast<char*>("zone_color_index"),
+   (PyCFunction)zone_color_index,
+   METH_VARARGS|METH_KEYWORDS,
+R"(
+zone_color_index(points, point_colors, distance)
+
+Bin points with RGBA colors for coloring surface vertices by the nearest
+point within distance using zone_color_vertices().  The index remembers
+the nearest points found for the last vertices colored so that coloring
+a slightly changed surface only looks up the vertices that moved.
+Points is an N by 3 float array and point_colors an N by 4 uint8 array.
+Implemented in C++.
+
+Returns
+-------
+index : capsule
+)"
+  },
+
+// ----------------------------------------------------------------------------    
+  {const_cast<char*>("zone_color_vertices"),
+   (PyCFunction)zone_color_vertices,
+   METH_VARARGS|METH_KEYWORDS,
+R"(
+zone_color_vertices(index, vertices, colors)
+
+Color vertices by the nearest point of a zone_color_index() within its distance.
+Vertices with no point within the distance get the given colors, an N by 4
+uint8 array.
+Implemented in C++.
+
+Returns
+-------
+vertex_colors : n by 4 array of uint8
+nearest_point : 1d array of int, -1 for vertices with no point in range
 )"
   },
 
@@ -28,9 +28,11 @@
 //
 #include <Python.h>			// use PyObject
 #include <math.h>			// use sqrt()
+#include <vector>			// use std::vector
 
 #include <arrays/pythonarray.h>		// use array_from_python()
 #include <arrays/rcarray.h>		// use FArray, IArray
+#include <arrays/threadpool.h>		// use Thread_Pool::thread_count(), run()
 
 static void vector_rotation(float *v1, float *v2, float *r);
 static void transform(float *points, int m, float *rot, float *offset, float *result);
@@ -90,7 +92,7 @@ static void vector_rotation(float *v1, float *v2, float *r)
       float an = sqrt(ax*ax + ay*ay);
       if (an == 0) az = 1;
       else        { ax /= an; ay /= an; }
-      r[0] = 2*ax*ax-1; r[1] = 2*ax*ay; r[1] = 2*ax*az;
+      r[0] = 2*ax*ax-1; r[1] = 2*ax*ay; r[2] = 2*ax*az;
       r[3] = 2*ax*ay; r[4] = 2*ay*ay-1; r[5] = 2*ay*az;
       r[6] = 2*ax*az; r[7] = 2*ay*az; r[8] = 2*az*az-1;
       return;
@@ -378,3 +380,182 @@ PyObject *tube_triangle_mask(PyObject *, PyObject *args, PyObject *keywds)
 
   return r;
 }
+
+// -----------------------------------------------------------------------------
+// Vertex and triangle counts for a tube with end caps.
+//
+inline int64_t tube_vertex_count(int64_t n, int64_t m)
+{ return (n+2)*m; }
+inline int64_t tube_triangle_count(int64_t n, int64_t m)
+{ return 2*(n-1)*m + 2*(m-2); }
+
+// -----------------------------------------------------------------------------
+// Make many tubes with the same cross-section into one set of arrays.  Tube k
+// uses path points offsets[k] through offsets[k+1]-1.  Tubes are handed out to
+// threads, each writing its own part of the preallocated arrays.
+//
+static void tubes(float *path, float *tangents, const int *offsets, int ntubes,
+		  float *cross_section, float *cross_section_normals, int m,
+		  const int64_t *voffsets, const int64_t *toffsets,
+		  float *vertices, float *normals, int *triangles)
+{
+  auto make_tubes = [&](int k0, int k1) {
+    for (int k = k0 ; k < k1 ; ++k)
+      {
+	int p0 = offsets[k], n = offsets[k+1] - p0;
+	int64_t v0 = voffsets[k], t0 = toffsets[k];
+	tube(path + 3*p0, tangents + 3*p0, n, cross_section, cross_section_normals, m,
+	     true, vertices + 3*v0, normals + 3*v0, triangles + 3*t0);
+	int *ta = triangles + 3*t0;
+	int64_t nt3 = 3*(toffsets[k+1] - t0);
+	for (int64_t i = 0 ; i < nt3 ; ++i)
+	  ta[i] += v0;
+      }
+  };
+
+  int nt = Thread_Pool::thread_count(toffsets[ntubes], 100000);
+  if (nt <= 1)
+    make_tubes(0, ntubes);
+  else
+    {
+      // Split by triangle count since tubes can have very different lengths.
+      std::vector<int> kstart(nt+1, ntubes);
+      kstart[0] = 0;
+      for (int k = 0, i = 1 ; k < ntubes && i < nt ; ++k)
+	if (toffsets[k] >= toffsets[ntubes]*i/nt)
+	  kstart[i++] = k;
+      Thread_Pool::run(nt, [&](int i) { make_tubes(kstart[i], kstart[i+1]); });
+    }
+}
+
+// -----------------------------------------------------------------------------
+//
+extern "C"
+PyObject *tubes_geometry(PyObject *, PyObject *args, PyObject *keywds)
+{
+  FArray path, tangents, cross_section, cross_section_normals;
+  IArray offsets;
+  BArray colors, tube_mask;
+  const char *kwlist[] = {"paths", "tangents", "offsets", "cross_section", "cross_section_normals",
+			  "colors", "tube_mask", NULL};
+  if (!PyArg_ParseTupleAndKeywords(args, keywds, const_cast<char *>("O&O&O&O&O&|O&O&"),
+				   (char **)kwlist,
+				   parse_float_n3_array, &path,
+				   parse_float_n3_array, &tangents,
+				   parse_int_n_array, &offsets,
+				   parse_float_n3_array, &cross_section,
+				   parse_float_n3_array, &cross_section_normals,
+				   parse_uint8_n4_array, &colors,
+				   parse_uint8_n_array, &tube_mask))
+    return NULL;
+
+  int n = path.size(0);
+  if (tangents.size(0) != n)
+    {
+      PyErr_SetString(PyExc_ValueError,
+		      "tubes_geometry(): path and tangent arrays have differing size");
+      return NULL;
+    }
+  int m = cross_section.size(0);
+  if (cross_section_normals.size(0) != m)
+    {
+      PyErr_SetString(PyExc_ValueError,
+		      "tubes_geometry(): cross section and cross section normals "
+		      "arrays have differing size");
+      return NULL;
+    }
+  if (m < 3)
+    {
+      PyErr_SetString(PyExc_ValueError, "tubes_geometry(): cross section must have at least 3 points");
+      return NULL;
+    }
+  IArray oc = offsets.contiguous_array();
+  const int *oa = oc.values();
+  int ntubes = oc.size(0) - 1;
+  if (ntubes < 0 || oa[0] != 0 || oa[ntubes] != n)
+    {
+      PyErr_SetString(PyExc_ValueError,
+		      "tubes_geometry(): offsets must start with 0 and end with the number of path points");
+      return NULL;
+    }
+  for (int k = 0 ; k < ntubes ; ++k)
+    if (oa[k+1] <= oa[k])
+      {
+	PyErr_Format(PyExc_ValueError, "tubes_geometry(): tube %d has no path points", k);
+	return NULL;
+      }
+  if (colors.dimension() == 2 && colors.size(0) != n)
+    {
+      PyErr_SetString(PyExc_ValueError,
+		      "tubes_geometry(): colors array must have one color per path point");
+      return NULL;
+    }
+  if (tube_mask.dimension() == 1 && tube_mask.size(0) != ntubes)
+    {
+      PyErr_SetString(PyExc_ValueError,
+		      "tubes_geometry(): tube mask must have one value per tube");
+      return NULL;
+    }
+
+  std::vector<int64_t> voffsets(ntubes+1), toffsets(ntubes+1);
+  voffsets[0] = toffsets[0] = 0;
+  for (int k = 0 ; k < ntubes ; ++k)
+    {
+      int nk = oa[k+1] - oa[k];
+      voffsets[k+1] = voffsets[k] + tube_vertex_count(nk, m);
+      toffsets[k+1] = toffsets[k] + tube_triangle_count(nk, m);
+    }
+  int64_t nv = voffsets[ntubes], ntri = toffsets[ntubes];
+
+  FArray pc = path.contiguous_array(), tc = tangents.contiguous_array();
+  FArray csc = cross_section.contiguous_array(), cnc = cross_section_normals.contiguous_array();
+  float *vertices, *normals;
+  int *triangles;
+  PyObject *vertices_py = python_float_array(nv, 3, &vertices);
+  PyObject *normals_py = python_float_array(nv, 3, &normals);
+  PyObject *triangles_py = python_int_array(ntri, 3, &triangles);
+
+  unsigned int *vcolors = NULL;
+  PyObject *colors_py = NULL;
+  if (colors.dimension() == 2)
+    {
+      unsigned char *vc;
+      colors_py = python_uint8_array(nv, 4, &vc);
+      vcolors = reinterpret_cast<unsigned int *>(vc);
+    }
+  unsigned char *tmask = NULL;
+  PyObject *tmask_py = NULL;
+  if (tube_mask.dimension() == 1)
+    tmask_py = python_bool_array(ntri, &tmask);
+
+  Py_BEGIN_ALLOW_THREADS
+  tubes(pc.values(), tc.values(), oa, ntubes, csc.values(), cnc.values(), m,
+	voffsets.data(), toffsets.data(), vertices, normals, triangles);
+  if (vcolors)
+    {
+      // Each cross-section gets the color of its path point, caps the color of the end points.
+      BArray cc = colors.contiguous_array();
+      const unsigned int *ca = reinterpret_cast<const unsigned int *>(cc.values());
+      for (int k = 0 ; k < ntubes ; ++k)
+	{
+	  unsigned int *vck = vcolors + voffsets[k];
+	  int p0 = oa[k], p1 = oa[k+1];
+	  std::fill(vck, vck + m, ca[p0]);
+	  for (int p = p0 ; p < p1 ; ++p)
+	    std::fill(vck + (p-p0+1)*m, vck + (p-p0+2)*m, ca[p]);
+	  std::fill(vck + (p1-p0+1)*m, vck + (p1-p0+2)*m, ca[p1-1]);
+	}
+    }
+  if (tmask)
+    {
+      BArray mc = tube_mask.contiguous_array();
+      const unsigned char *ma = mc.values();
+      for (int k = 0 ; k < ntubes ; ++k)
+	std::fill(tmask + toffsets[k], tmask + toffsets[k+1], (ma[k] ? 1 : 0));
+    }
+  Py_END_ALLOW_THREADS
+
+  return python_tuple(vertices_py, normals_py, triangles_py,
+		      (colors_py ? colors_py : python_none()),
+		      (tmask_py ? tmask_py : python_none()));
+}
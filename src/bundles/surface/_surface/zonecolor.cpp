@@ -0,0 +1,307 @@
+/*
+ * === UCSF ChimeraX Copyright ===
+ * Copyright 2022 Regents of the University of California. All rights reserved.
+ * The ChimeraX application is provided pursuant to the ChimeraX license
+ * agreement, which covers academic and commercial uses. For more details, see
+ * <http://www.rbvi.ucsf.edu/chimerax/docs/licensing.html>
+ *
+ * This particular file is part of the ChimeraX library. You can also
+ * redistribute and/or modify it under the terms of the GNU Lesser General
+ * Public License version 2.1 as published by the Free Software Foundation.
+ * For more details, see
+ * <https://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESSED OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. ADDITIONAL LIABILITY
+ * LIMITATIONS ARE DESCRIBED IN THE GNU LESSER GENERAL PUBLIC LICENSE
+ * VERSION 2.1
+ *
+ * This notice must be embedded in or attached to all copies, including partial
+ * copies, of the software or any revisions or derivations thereof.
+ * === UCSF ChimeraX Copyright ===
+ */
+
+// ----------------------------------------------------------------------------
+
+// ----------------------------------------------------------------------------
+// Color surface vertices by the nearest of a set of points within a distance.
+// The points are binned once into cubes of the zone distance.  The nearest
+// point found for each vertex is kept so that when the surface changes only
+// vertices that moved are looked up again.  Surface updates that recompute a
+// few contour planes or patches leave the other vertices at the same
+// positions at the start and end of the vertex array, so vertices are
+// compared from both ends.
+//
+#include <Python.h>			// use PyObject
+#include <algorithm>			// use std::min
+#include <cmath>			// use std::floor
+#include <cstring>			// use memcpy
+#include <unordered_map>		// use std::unordered_map
+#include <vector>			// use std::vector
+
+#include <arrays/pythonarray.h>		// use parse_float_n3_array(), ...
+#include <arrays/rcarray.h>		// use FArray, BArray
+#include <arrays/threadpool.h>		// use Thread_Pool::thread_count(), run()
+
+#include "zonecolor.h"
+
+// ----------------------------------------------------------------------------
+//
+class Zone_Color
+{
+public:
+  Zone_Color(const FArray &points, const BArray &colors, float distance);
+
+  // Fill nearest point index for each vertex, -1 if none within distance.
+  void nearest_points(const float *vxyz, int64_t n, int *nearest);
+  const unsigned char *point_color(int p) const { return &colors[4*p]; }
+  int64_t point_count() const { return xyz.size()/3; }
+
+private:
+  int nearest_point(const float *v) const;
+  void find_nearest(const float *vxyz, int64_t v0, int64_t v1, int *nearest) const;
+  int64_t bin_key(int64_t i, int64_t j, int64_t k) const
+    { return (i*bins_y + j)*bins_z + k; }
+
+  std::vector<float> xyz;
+  std::vector<unsigned char> colors;
+  float distance, xyz_min[3];
+  int64_t bins_y, bins_z;
+  std::unordered_map<int64_t, std::pair<int,int> > bins;	// key -> start, count in bin_points
+  std::vector<int> bin_points;
+
+  // Last vertices colored and their nearest points.
+  std::vector<float> last_vertices;
+  std::vector<int> last_nearest;
+};
+
+// ----------------------------------------------------------------------------
+//
+Zone_Color::Zone_Color(const FArray &points, const BArray &point_colors, float distance)
+  : distance(distance)
+{
+  int64_t np = points.size(0);
+  FArray pc = points.contiguous_array();
+  xyz.assign(pc.values(), pc.values() + 3*np);
+  BArray cc = point_colors.contiguous_array();
+  colors.assign(cc.values(), cc.values() + 4*np);
+
+  float xyz_max[3];
+  for (int a = 0 ; a < 3 ; ++a)
+    xyz_min[a] = xyz_max[a] = (np > 0 ? xyz[a] : 0);
+  for (int64_t p = 0 ; p < np ; ++p)
+    for (int a = 0 ; a < 3 ; ++a)
+      {
+	float x = xyz[3*p+a];
+	if (x < xyz_min[a]) xyz_min[a] = x;
+	else if (x > xyz_max[a]) xyz_max[a] = x;
+      }
+  // Bins outside the point bounds are never looked up so bin counts only
+  // need to cover the points.
+  bins_y = static_cast<int64_t>((xyz_max[1]-xyz_min[1])/distance) + 1;
+  bins_z = static_cast<int64_t>((xyz_max[2]-xyz_min[2])/distance) + 1;
+
+  std::vector<int64_t> keys(np);
+  for (int64_t p = 0 ; p < np ; ++p)
+    {
+      const float *x = &xyz[3*p];
+      keys[p] = bin_key(static_cast<int64_t>((x[0]-xyz_min[0])/distance),
+			static_cast<int64_t>((x[1]-xyz_min[1])/distance),
+			static_cast<int64_t>((x[2]-xyz_min[2])/distance));
+      bins[keys[p]].second += 1;
+    }
+  int start = 0;
+  for (auto &b: bins)
+    {
+      b.second.first = start;
+      start += b.second.second;
+      b.second.second = 0;
+    }
+  bin_points.resize(np);
+  for (int64_t p = 0 ; p < np ; ++p)
+    {
+      std::pair<int,int> &b = bins[keys[p]];
+      bin_points[b.first + b.second++] = p;
+    }
+}
+
+// ----------------------------------------------------------------------------
+// Nearest point within distance, lowest index on ties, or -1.
+//
+int Zone_Color::nearest_point(const float *v) const
+{
+  int64_t b[3];
+  for (int a = 0 ; a < 3 ; ++a)
+    b[a] = static_cast<int64_t>(std::floor((v[a]-xyz_min[a])/distance));
+  float d2min = distance*distance;
+  int nearest = -1;
+  for (int64_t i = b[0]-1 ; i <= b[0]+1 ; ++i)
+    for (int64_t j = b[1]-1 ; j <= b[1]+1 ; ++j)
+      {
+	if (i < 0 || j < 0 || j >= bins_y)
+	  continue;
+	for (int64_t k = b[2]-1 ; k <= b[2]+1 ; ++k)
+	  {
+	    if (k < 0 || k >= bins_z)
+	      continue;
+	    auto bi = bins.find(bin_key(i,j,k));
+	    if (bi == bins.end())
+	      continue;
+	    const int *bp = &bin_points[bi->second.first];
+	    for (int c = 0 ; c < bi->second.second ; ++c)
+	      {
+		int p = bp[c];
+		const float *x = &xyz[3*p];
+		float dx = v[0]-x[0], dy = v[1]-x[1], dz = v[2]-x[2];
+		float d2 = dx*dx + dy*dy + dz*dz;
+		if (d2 < d2min || (d2 == d2min && p < nearest))
+		  {
+		    d2min = d2;
+		    nearest = p;
+		  }
+	      }
+	  }
+      }
+  return nearest;
+}
+
+// ----------------------------------------------------------------------------
+//
+void Zone_Color::find_nearest(const float *vxyz, int64_t v0, int64_t v1, int *nearest) const
+{
+  int64_t n = v1 - v0;
+  auto find_range = [&](int64_t r0, int64_t r1)
+  {
+    for (int64_t v = r0 ; v < r1 ; ++v)
+      nearest[v] = nearest_point(vxyz + 3*v);
+  };
+  int nt = Thread_Pool::thread_count(n, 50000);
+  if (nt <= 1)
+    find_range(v0, v1);
+  else
+    Thread_Pool::run(nt, [&](int t) { find_range(v0 + n*t/nt, v0 + n*(t+1)/nt); });
+}
+
+// ----------------------------------------------------------------------------
+//
+void Zone_Color::nearest_points(const float *vxyz, int64_t n, int *nearest)
+{
+  // Reuse nearest points of vertices unchanged at the start and end of the array.
+  int64_t nlast = last_nearest.size();
+  int64_t m = std::min(n, nlast);
+  const float *lv = (nlast > 0 ? &last_vertices[0] : NULL);
+  int64_t start = 0, end = 0;
+  while (start < m && lv[3*start] == vxyz[3*start] && lv[3*start+1] == vxyz[3*start+1]
+	 && lv[3*start+2] == vxyz[3*start+2])
+    start += 1;
+  while (end < m - start)
+    {
+      const float *v = vxyz + 3*(n-1-end), *l = lv + 3*(nlast-1-end);
+      if (v[0] != l[0] || v[1] != l[1] || v[2] != l[2])
+	break;
+      end += 1;
+    }
+
+  if (start > 0)
+    memcpy(nearest, &last_nearest[0], start*sizeof(int));
+  if (end > 0)
+    memcpy(nearest + n - end, &last_nearest[nlast-end], end*sizeof(int));
+  find_nearest(vxyz, start, n - end, nearest);
+
+  last_vertices.assign(vxyz, vxyz + 3*n);
+  last_nearest.assign(nearest, nearest + n);
+}
+
+// ----------------------------------------------------------------------------
+//
+static void delete_zone_color(PyObject *capsule)
+{
+  delete static_cast<Zone_Color *>(PyCapsule_GetPointer(capsule, "Zone_Color"));
+}
+
+// ----------------------------------------------------------------------------
+//
+extern "C" PyObject *zone_color_index(PyObject *, PyObject *args, PyObject *keywds)
+{
+  FArray points;
+  BArray colors;
+  float distance;
+  const char *kwlist[] = {"points", "point_colors", "distance", NULL};
+  if (!PyArg_ParseTupleAndKeywords(args, keywds,
+				   const_cast<char *>("O&O&f"), (char **)kwlist,
+				   parse_float_n3_array, &points,
+				   parse_uint8_n4_array, &colors,
+				   &distance))
+    return NULL;
+
+  if (colors.size(0) != points.size(0))
+    {
+      PyErr_Format(PyExc_ValueError, "zone_color_index: %s points and %s colors differ in number",
+		   points.size_string(0).c_str(), colors.size_string(0).c_str());
+      return NULL;
+    }
+  if (distance <= 0)
+    {
+      PyErr_SetString(PyExc_ValueError, "zone_color_index: distance must be positive");
+      return NULL;
+    }
+
+  Zone_Color *zc;
+  Py_BEGIN_ALLOW_THREADS
+  zc = new Zone_Color(points, colors, distance);
+  Py_END_ALLOW_THREADS
+  return PyCapsule_New(zc, "Zone_Color", delete_zone_color);
+}
+
+// ----------------------------------------------------------------------------
+//
+extern "C" PyObject *zone_color_vertices(PyObject *, PyObject *args, PyObject *keywds)
+{
+  PyObject *py_zone;
+  FArray varray;
+  BArray carray;
+  const char *kwlist[] = {"index", "vertices", "colors", NULL};
+  if (!PyArg_ParseTupleAndKeywords(args, keywds,
+				   const_cast<char *>("OO&O&"), (char **)kwlist,
+				   &py_zone,
+				   parse_float_n3_array, &varray,
+				   parse_uint8_n4_array, &carray))
+    return NULL;
+
+  Zone_Color *zc = static_cast<Zone_Color *>(PyCapsule_GetPointer(py_zone, "Zone_Color"));
+  if (zc == NULL)
+    return NULL;
+  int64_t n = varray.size(0);
+  if (carray.size(0) != n)
+    {
+      PyErr_Format(PyExc_ValueError, "zone_color_vertices: %s colors for %s vertices",
+		   carray.size_string(0).c_str(), varray.size_string(0).c_str());
+      return NULL;
+    }
+
+  unsigned char *rgba;
+  PyObject *py_colors = python_uint8_array(n, 4, &rgba);
+  int *nearest;
+  PyObject *py_nearest = python_int_array(n, &nearest);
+  if (py_colors == NULL || py_nearest == NULL)
+    {
+      Py_XDECREF(py_colors);
+      Py_XDECREF(py_nearest);
+      return NULL;
+    }
+
+  Py_BEGIN_ALLOW_THREADS
+  FArray vc = varray.contiguous_array();
+  zc->nearest_points(vc.values(), n, nearest);
+  BArray cc = carray.contiguous_array();
+  const unsigned char *c = cc.values();
+  for (int64_t v = 0 ; v < n ; ++v)
+    {
+      int p = nearest[v];
+      memcpy(rgba + 4*v, (p >= 0 ? zc->point_color(p) : c + 4*v), 4);
+    }
+  Py_END_ALLOW_THREADS
+
+  return python_tuple(py_colors, py_nearest);
+}
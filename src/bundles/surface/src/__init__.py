@@ -26,20 +26,24 @@ from .sasa import spheres_surface_area
 from .split import split_surfaces
 from .shapes import sphere_geometry, sphere_geometry2, cylinder_geometry, dashed_cylinder_geometry, cone_geometry, box_geometry
 from .area import surface_area, enclosed_volume, surface_volume_and_area
-from .gridsurf import ses_surface_geometry
+from .area import enclosed_volumes_and_areas
+from .gridsurf import ses_surface_geometry, ses_surface_update
 
 # Make sure _surface can runtime link shared library libarrays.
 import chimerax.arrays
 
 from ._surface import subdivide_triangles, vertex_areas
-from ._surface import surface_area_of_spheres, estimate_surface_area_of_spheres
+from ._surface import surface_area_of_spheres, estimate_surface_area_of_spheres, sphere_regions
+from ._surface import buried_areas_of_sphere_groups
 from ._surface import calculate_vertex_normals, invert_vertex_normals
 from ._surface import connected_triangles, triangle_vertices
-from ._surface import sharp_edge_patches, unique_vertex_map, connected_pieces
+from ._surface import sharp_edge_patches, unique_vertex_map, connected_pieces, triangle_pieces
 from ._surface import boundary_edges, compute_cap, triangulate_polygon, refine_mesh, boundary_loops
+from ._surface import cap_cache
 from ._surface import boundary_edge_mask
 from ._surface import vertex_convexity
-from ._surface import smooth_vertex_positions
+from ._surface import zone_color_index, zone_color_vertices
+from ._surface import smooth_vertex_positions, vertex_adjacency
 
 from .dust import largest_blobs_triangle_mask
 from .gaussian import gaussian_surface
@@ -48,6 +48,20 @@ def enclosed_volume(varray, tarray):
         return None, hole_count
     return vol, hole_count
 
+# -----------------------------------------------------------------------------
+#
+def enclosed_volumes_and_areas(vertex_triangle_pairs):
+    '''
+    Return lists of enclosed volumes, surface areas and hole counts for a
+    list of (vertex array, triangle array) surface triangulations computed
+    in parallel.  Volume is None if a surface has boundary edges traversed
+    in opposing directions.
+    '''
+    from ._surface import enclosed_volumes_and_areas
+    vols, areas, hole_counts = enclosed_volumes_and_areas(vertex_triangle_pairs)
+    volumes = [(None if v < 0 else float(v)) for v in vols]
+    return volumes, [float(a) for a in areas], [int(h) for h in hole_counts]
+
 # -----------------------------------------------------------------------------
 # Calculate volume enclosed by a surface and surface area.
 #
@@ -58,18 +72,17 @@ def surface_volume_and_area(model):
     All triangles are used even if the surface is masked or clipped.
     All child models are included.  Only Surface models are included.
     '''
-    volume = holes = area = 0
     from chimerax.core.models import Surface
+    geom = []
     for d in model.all_models():
         if isinstance(d, Surface) and not getattr(d, 'is_clip_cap', False):
             varray = d.vertices
             tarray = d.joined_triangles if hasattr(d, 'joined_triangles') else d.triangles
             if varray is not None and tarray is not None:
-                v, hc = enclosed_volume(varray, tarray)
-                volume += 0 if v is None else v
-                holes += hc
-                area += surface_area(varray, tarray)
-    return volume, area, holes
+                geom.append((varray, tarray))
+    volumes, areas, hole_counts = enclosed_volumes_and_areas(geom)
+    volume = sum(0 if v is None else v for v in volumes)
+    return volume, sum(areas), sum(hole_counts)
 
 # -----------------------------------------------------------------------------
 #
@@ -77,18 +90,23 @@ def measure_volume(session, surfaces, include_masked = True, return_holes = Fals
     vtot = 0
     totholes = 0
     lines = []
+    geom, measured = [], []
     for surf in surfaces:
         va = surf.vertices
         # Use joined triangles for molecular surfaces with sharp edges that use disconnected triangles.
         ta = surf.joined_triangles if hasattr(surf, 'joined_triangles') else surf.triangles
-        if va is None or ta is None:
-            v, nholes = 0, 0
-        else:
+        if va is not None and ta is not None:
             if not include_masked:
                 tmask = surf.triangle_mask
                 if tmask is not None:
                     ta = ta[tmask]
-            v, nholes = enclosed_volume(va, ta)
+            geom.append((va, ta))
+        measured.append(va is not None and ta is not None)
+    # Measure all surfaces in parallel.
+    volumes, areas, hole_counts = enclosed_volumes_and_areas(geom)
+    measures = iter(zip(volumes, hole_counts))
+    for surf, m in zip(surfaces, measured):
+        v, nholes = next(measures) if m else (0, 0)
         if v is None:
             lines.append('Surface %s (#%s) has boundary edges traversed in opposing directions.'
                          '  Cannot determine volume.' % (surf.name, surf.id_string))
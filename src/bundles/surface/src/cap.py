@@ -75,12 +75,12 @@ def compute_cap(drawing, plane, offset, subdivision = 0.0):
     # Handle surfaces with duplicate vertices, such as molecular
     # surfaces with sharp edges between atoms.
     if hasattr(d, 'joined_triangles'):
-        t = d.joined_triangles
+        t = tsource = d.joined_triangles
         if d.triangle_mask is not None and d.triangle_mask.sum() < len(d.triangle_mask):
             # TODO: triangle mask not handled for joined triangles.
             return None, None, None
     else:
-        t = d.triangles
+        t = tsource = d.triangles
         if d.triangle_mask is not None and d.triangle_mask.sum() < len(d.triangle_mask):
             t = t[d.triangle_mask]
 
@@ -94,8 +94,9 @@ def compute_cap(drawing, plane, offset, subdivision = 0.0):
         pnormal = dp.transform_vector(plane.normal)
         from chimerax.geometry import inner_product
         poffset = inner_product(pnormal, dp*plane.plane_point) + offset + getattr(d, 'clip_offset', 0)
+        cache = _cap_cache(d, tsource, t, pnormal)
         from . import compute_cap
-        varray, tarray = compute_cap(-pnormal, -poffset, d.vertices, t)
+        varray, tarray = compute_cap(-pnormal, -poffset, d.vertices, t, cache)
 
     if tarray is None or len(tarray) == 0:
         return None, None, None
@@ -112,6 +113,26 @@ def compute_cap(drawing, plane, offset, subdivision = 0.0):
 
     return varray, narray, tarray
 
+def _cap_cache(drawing, tsource, triangles, pnormal):
+    '''
+    Return cached plane intersection state when a clip plane is moved along its
+    normal, as when dragged with the mouse.  The state is made the second time
+    the same plane normal is seen so that rotating does not make a new one for
+    every frame.  The drawing clears it when its geometry changes.
+    '''
+    d = drawing
+    key = tuple(pnormal)
+    cs = getattr(d, '_cached_cap_state', None)
+    if cs is None or cs[0] != key or cs[1] is not tsource:
+        d._cached_cap_state = (key, tsource, None)
+        return None
+    cache = cs[2]
+    if cache is None:
+        from ._surface import cap_cache
+        cache = cap_cache(-pnormal, d.vertices, triangles)
+        d._cached_cap_state = (key, tsource, cache)
+    return cache
+
 def compute_instances_cap(drawing, triangles, plane, offset):
     d = drawing
     doffset = offset + getattr(d, 'clip_offset', 0)
@@ -63,22 +63,26 @@ def points_and_colors(atoms, bonds, bond_point_spacing = None):
 
 # -----------------------------------------------------------------------------
 #
-def color_surface(surf, points, point_colors, distance, far_color = None):
+# A zone index from zone_color_index() for the same points, colors and
+# distance can be given to reuse its point bins and the nearest points of
+# vertices that have not moved since it last colored this surface.
+#
+def color_surface(surf, points, point_colors, distance, far_color = None,
+                  zone_index = None):
 
     varray = surf.vertices
-    from chimerax.geometry import find_closest_points
-    i1, i2, n1 = find_closest_points(varray, points, distance)
-
     if isinstance(far_color, str) and far_color == 'keep':
         rgba = surf.get_vertex_colors(create = True)
     else:
         from numpy import empty, uint8
         rgba = empty((len(varray),4), uint8)
         rgba[:,:] = (surf.color if far_color is None else far_color)
-        
-    for k in range(len(i1)):
-        rgba[i1[k],:] = point_colors[n1[k]]
-        
+
+    from . import zone_color_index, zone_color_vertices
+    if zone_index is None:
+        zone_index = zone_color_index(points, point_colors, distance)
+    rgba, nearest = zone_color_vertices(zone_index, varray, rgba)
+
     surf.vertex_colors = rgba
     surf.coloring_zone = True
 
@@ -100,6 +104,7 @@ class ZoneColor(State):
         self.distance = distance
         self.sharp_edges = sharp_edges
         self.far_color = far_color
+        self._zone_index = None		# Point bins and last nearest points
         
     def __call__(self):
         self.set_vertex_colors()
@@ -107,8 +112,11 @@ class ZoneColor(State):
     def set_vertex_colors(self):
         surf = self.surface
         if surf.vertices is not None:
+            if self._zone_index is None:
+                from . import zone_color_index
+                self._zone_index = zone_color_index(self.points, self.point_colors, self.distance)
             color_surface(surf, self.points, self.point_colors, self.distance,
-                          far_color = self.far_color)
+                          far_color = self.far_color, zone_index = self._zone_index)
             if self.sharp_edges:
                 color_zone_sharp_edges(surf, self.points, self.point_colors, self.distance,
                                        far_color = self.far_color, replace = True)
@@ -150,8 +158,9 @@ def color_zoning(surface):
 #
 def color_zone_sharp_edges(surface, points, colors, distance, far_color = None,
                            replace = False):
-    # Transform points to surface coordinates
-    surface.scene_position.inverse().transform_points(points, in_place = True)
+    # Transform points to surface coordinates.  Copy so the caller's points,
+    # such as those of a ZoneColor reused on each update, are not changed.
+    points = surface.scene_position.inverse().transform_points(points)
 
     varray, narray, tarray = surface.vertices, surface.normals, surface.triangles
     if hasattr(surface, '_unsharp_geometry'):
@@ -167,8 +176,7 @@ def color_zone_sharp_edges(surface, points, colors, distance, far_color = None,
     from numpy import empty, uint8
     carray = empty((len(varray),4), uint8)
     carray[:,:] = (surface.color if far_color is None or far_color == 'keep' else far_color)
-    for vi,ai in zip(i1, n1):
-        carray[vi,:] = colors[ai]
+    carray[i1] = colors[n1]
 
     va, na, ta, ca = _cut_triangles(ec, varray, narray, tarray, carray)
 
@@ -35,15 +35,18 @@ def combine_geometry_vtp(geom):
     varray = empty((vc,3), float32)
     tarray = empty((tc,3), int32)
 
+    # Transform all copies of a drawing's vertices in one call.
+    from chimerax.geometry import affine_transform_copies
+    from numpy import arange
     v = t = 0
     for va, ta, pos in geom:
         n, nv, nt = len(pos), len(va), len(ta)
-        for p in pos:
-            varray[v:v+nv,:] = va if p.is_identity() else p*va
-            tarray[t:t+nt,:] = ta
-            tarray[t:t+nt,:] += v
-            v += nv
-            t += nt
+        affine_transform_copies(va, pos.array(), varray[v:v+n*nv])
+        copy_triangles = tarray[t:t+n*nt].reshape((n,nt,3))
+        copy_triangles[:] = ta
+        copy_triangles += (v + nv*arange(n, dtype=int32)).reshape((n,1,1))
+        v += n*nv
+        t += n*nt
     
     return varray, tarray
 
@@ -152,6 +152,8 @@ class Blob_Masker:
 
         self.blist = None
         self.tbindex = None
+        self.tbcounts = None
+        self.bbounds = None
         self.tbvalues = {}
         self.tbsizes = None
         self.tbranks = None
@@ -165,7 +167,7 @@ class Blob_Masker:
         from numpy import greater
         tvalues = self.triangle_values(metric)
         if metric.endswith('rank'):
-            r = len(self.blob_list()) - int(limit+1)
+            r = self.blob_count() - int(limit+1)
             greater(tvalues, r, mask)
         else:
             greater(tvalues, limit, mask)
@@ -193,31 +195,36 @@ class Blob_Masker:
 
     def triangle_blob_indices(self):
         if self.tbindex is None:
-            from numpy import empty, intc
-            tbi = empty((self.triangle_count,), intc)
-            for i, (vi, ti) in enumerate(self.blob_list()):
-                tbi.put(ti, i)
-            self.tbindex = tbi
+            from ._surface import triangle_pieces
+            self.tbindex, self.tbcounts, self.bbounds = triangle_pieces(self.tarray, self.varray)
         return self.tbindex
 
+    def blob_count(self):
+        self.triangle_blob_indices()
+        return len(self.tbcounts)
+
     def blob_sizes(self):
         tv = self.tbvalues
         if not 'size' in tv:
-            bsizes = self.blob_values(self.blob_size)
+            bsizes = self.blob_extents()
             tv['size'] = bsizes[self.triangle_blob_indices()]
         return tv['size']
 
-    def blob_size(self, vi, ti):
-        v = self.varray[vi,:]
-        return max(v.max(axis=0) - v.min(axis=0))
+    def blob_extents(self):
+        self.triangle_blob_indices()
+        b = self.bbounds
+        return (b[:,1,:] - b[:,0,:]).max(axis=1)
 
     def blob_ranks(self, metric):
         tv = self.tbvalues
         if not metric in tv:
-            m = {'size rank':self.blob_size,
-                 'area rank':self.blob_area,
-                 'volume rank':self.blob_volume}[metric]
-            border = self.blob_values(m).argsort()
+            if metric == 'size rank':
+                bvalues = self.blob_extents()
+            else:
+                m = {'area rank':self.blob_area,
+                     'volume rank':self.blob_volume}[metric]
+                bvalues = self.blob_values(m)
+            border = bvalues.argsort()
             branks = border.copy()
             from numpy import arange
             branks.put(border, arange(len(border)))
@@ -231,7 +238,7 @@ class Blob_Masker:
             tv['volume'] = bvolumes[self.triangle_blob_indices()]
         return tv['volume']
 
-    def blob_volume(self, vi, ti):
+    def blob_volume(self, ti):
         from .area import enclosed_volume
         t = self.tarray[ti,:]
         vol, holes = enclosed_volume(self.varray, t)
@@ -246,7 +253,7 @@ class Blob_Masker:
             tv['area'] = bareas[self.triangle_blob_indices()]
         return tv['area']
 
-    def blob_area(self, vi, ti):
+    def blob_area(self, ti):
         from .area import surface_area
         t = self.tarray[ti,:]
         area = surface_area(self.varray, t)
@@ -256,14 +263,17 @@ class Blob_Masker:
         blist = self.blob_list()
         from numpy import empty, single as floatc
         bv = empty((len(blist),), floatc)
-        for i, (vi,ti) in enumerate(blist):
-            bv[i] = value_func(vi, ti)
+        for i, ti in enumerate(blist):
+            bv[i] = value_func(ti)
         return bv
 
     def blob_list(self):
+        # Triangle indices for each blob.
         if self.blist is None:
-            from ._surface import connected_pieces
-            self.blist = connected_pieces(self.tarray)
+            tbi = self.triangle_blob_indices()
+            order = tbi.argsort(kind = 'stable')
+            from numpy import split
+            self.blist = split(order, self.tbcounts.cumsum()[:-1])
         return self.blist
 
     def mask_array(self):
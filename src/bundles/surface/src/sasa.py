@@ -478,19 +478,21 @@ def unit_sphere():
     radius = 1
     return (center, radius)
 
-def spheres_surface_area(centers, radii, npoints = 1000):
+def spheres_surface_area(centers, radii, npoints = 1000, progress = None):
     '''
     Return the exposed surface area of a set of possibly intersecting set of spheres.
     An array giving the exposed area for each input sphere is returned.
     The area is computed by an exact method except for round-off errors.
     The calculation can fail in rare cases where 4 spheres intersect at a point
     and area values of -1 are returned for spheres where the calculation fails.
+    Optional progress is a callback or chimerax.arrays.ProgressToken as for
+    _surface.surface_area_of_spheres().
     TODO: The code also computes the areas using numerical approximation, and the
     results compared with the maximum and average discrepancy printed for debugging.
     This code is not needed except for debugging.
     '''
     from . import _surface
-    areas = _surface.surface_area_of_spheres(centers, radii)
+    areas = _surface.surface_area_of_spheres(centers, radii, progress = progress)
     return areas
 
 def report_sphere_area_errors(areas, centers, radii, npoints = 1000, max_err = 0.02):
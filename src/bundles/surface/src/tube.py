@@ -32,6 +32,24 @@ def tube_through_points(path, tangents, radius = 1.0, circle_subdivisions = 15):
     from ._surface import tube_geometry
     return tube_geometry(path, tangents, circle, circle_normals)
 
+# -----------------------------------------------------------------------------
+# Create surface geometry for many tubes in one call.  The paths and tangents
+# for all tubes are concatenated, tube k using points offsets[k] through
+# offsets[k+1]-1.  Returns vertices, normals, triangles, vertex colors if
+# per-point colors are given, and a triangle mask if a per-tube mask is given.
+#
+def tubes_through_points(paths, tangents, offsets, radius = 1.0, circle_subdivisions = 15,
+                         colors = None, tube_mask = None):
+
+    circle = circle_points(circle_subdivisions, radius)
+    circle_normals = circle_points(circle_subdivisions, 1.0)
+    from ._surface import tubes_geometry
+    va, na, ta, vc, tmask = tubes_geometry(paths, tangents, offsets, circle, circle_normals,
+                                           colors = colors, tube_mask = tube_mask)
+    if tmask is not None:
+        tmask = tmask.view(bool)
+    return va, na, ta, vc, tmask
+
 # -----------------------------------------------------------------------------
 # Create tube surface geometry passing through a natural cubic spline through
 # specified points.
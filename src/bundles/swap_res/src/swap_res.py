@@ -92,8 +92,7 @@ def swap_aa(session, residues, res_type, *, bfactor=None, clash_hbond_allowance=
                     map = density
                 else:
                     map = maps[0]
-                for res, by_alt_loc in rotamers.items():
-                    process_volume(session, res, by_alt_loc, map)
+                score_volume(rotamers, map)
                 fetch = lambda r: r.volume_score
                 test = cmp
             elif char == "c":
@@ -104,9 +103,8 @@ def swap_aa(session, residues, res_type, *, bfactor=None, clash_hbond_allowance=
                         clash_hbond_allowance = defaults['clash_hbond_allowance']
                     if clash_overlap_cutoff is None:
                         clash_overlap_cutoff = defaults['clash_threshold']
-                for res, by_alt_loc in rotamers.items():
-                    process_clashes(session, res, by_alt_loc, clash_overlap_cutoff, clash_hbond_allowance,
-                        clash_score_method, False, None, None, ignore_other_models)
+                score_clashes(session, rotamers, clash_overlap_cutoff, clash_hbond_allowance,
+                    clash_score_method, ignore_other_models)
                 fetch = lambda r: r.clash_score
                 test = lambda s1, s2: cmp(s2, s1)  # _lowest_ clash score
             elif char == 'h':
@@ -750,6 +748,9 @@ def process_clashes(session, residue, by_alt_loc, overlap, hbond_allow, score_me
         pbg = session.pb_manager.get_group("clashes", create=False)
         if pbg:
             session.models.close([pbg])
+        score_clashes(session, { residue: by_alt_loc }, overlap, hbond_allow, score_method,
+            ignore_others)
+        return "%2d" if score_method == "num" else "%4.2f"
     from chimerax.atomic import concatenate
     from chimerax.clashes import find_clashes
     CA = residue.find_atom("CA")
@@ -785,6 +786,46 @@ def process_clashes(session, residue, by_alt_loc, overlap, hbond_allow, score_me
         return "%2d"
     return "%4.2f"
 
+def score_clashes(session, rotamers, overlap, hbond_allow, score_method, ignore_others):
+    # set the clash_score of all the rotamers of all the residues ('rotamers' maps residues to
+    # by-alt-loc rotamer lists) with one native scoring pass against all open structures,
+    # giving the same scores as process_clashes()
+    from chimerax.atomic import all_atoms
+    from chimerax.clashes import clash_scores
+    env_atoms = all_atoms(session)
+    def score(rots_info):
+        sets = []
+        replaced = []
+        rots = []
+        for res, res_rots in rots_info:
+            for rot in res_rots:
+                # any clashes of CA/N/CB are already clashes of base residue (and may
+                # mistakenly be thought to clash with "bonded" atoms in nearby residues)
+                ra = rot.atoms
+                sets.append(ra.filter(~numpy.isin(ra.names, ("CA", "N", "CB"))))
+                replaced.append(res)
+                rots.append(rot)
+        scores = clash_scores(env_atoms, sets, replaced, clash_threshold=overlap,
+            hbond_allowance=hbond_allow, count=(score_method == "num"),
+            same_structure=ignore_others)
+        for rot, rot_score in zip(rots, scores):
+            rot.clash_score = int(rot_score) if score_method == "num" else rot_score
+    import numpy
+    # residues with alternate locations change the coordinates of their neighbors as
+    # their alt loc is set, so their rotamers are scored one alt loc at a time
+    no_alt_locs = []
+    for res, by_alt_loc in rotamers.items():
+        CA = res.find_atom("CA")
+        if not CA.alt_locs:
+            no_alt_locs.extend([(res, rots) for rots in by_alt_loc.values()])
+            continue
+        with CA.suppress_alt_loc_change_notifications():
+            for alt_loc, rots in by_alt_loc.items():
+                CA.alt_loc = alt_loc
+                score([(res, rots)])
+    if no_alt_locs:
+        score(no_alt_locs)
+
 def process_hbonds(session, residue, by_alt_loc, draw_hbonds, bond_color, radius, relax,
             dist_slop, angle_slop, two_colors, relax_color, ignore_other_models, *, cache_da=False):
     from chimerax.hbonds import find_hbonds
@@ -839,22 +880,32 @@ def process_hbonds(session, residue, by_alt_loc, draw_hbonds, bond_color, radius
                     pb = pbg.new_pseudobond(d, a)
                     pb.color = color.uint8x4()
 
+def score_volume(rotamers, volume):
+    # set the volume_score of all the rotamers of all the residues ('rotamers' maps residues to
+    # by-alt-loc rotamer lists), interpolating the map at all their side chain atoms at once
+    rots = [rot for by_alt_loc in rotamers.values() for res_rots in by_alt_loc.values()
+        for rot in res_rots]
+    if not rots:
+        return []
+    from chimerax.atomic import concatenate, Atoms, Residue
+    import numpy
+    # 'is_side_chain' only works for actual polymers
+    backbone_names = list(Residue.aa_max_backbone_names)
+    side_chains = []
+    for rot in rots:
+        ra = rot.atoms
+        side_chains.append(ra.filter(~numpy.isin(ra.names, backbone_names)))
+    from chimerax.geometry import Place
+    values = volume.interpolated_values(concatenate(side_chains, Atoms).scene_coords,
+        point_xform=Place())
+    sets = numpy.repeat(numpy.arange(len(rots)), [len(sc) for sc in side_chains])
+    sums = numpy.bincount(sets, weights=values, minlength=len(rots))
+    for rot, total in zip(rots, sums):
+        rot.volume_score = float(total)
+    return list(sums)
+
 def process_volume(session, residue, by_alt_loc, volume):
-    CA = residue.find_atom("CA")
-    alt_locs = CA.alt_locs if CA.alt_locs else [' ']
-    sums = []
-    with CA.suppress_alt_loc_change_notifications():
-        for alt_loc, rotamers in by_alt_loc.items():
-            CA.alt_loc = alt_loc
-            for rot in rotamers:
-                values = volume.interpolated_values(rot.atoms.coords, point_xform=rot.scene_position)
-                total = 0
-                for a, val in zip(rot.atoms, values):
-                    # 'is_side_chain' only works for actual polymers
-                    if a.name not in a.residue.aa_max_backbone_names:
-                        total += val
-                rot.volume_score = total
-                sums.append(total)
+    sums = score_volume({ residue: by_alt_loc }, volume)
     min_sum = min(sums)
     max_sum = max(sums)
     abs_max = max(max_sum, abs(min_sum))
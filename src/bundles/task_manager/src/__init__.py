@@ -21,12 +21,13 @@
 # copies, of the software or any revisions or derivations thereof.
 # === UCSF ChimeraX Copyright ===
 # from chimerax.core
-__version__ = "1.0"
+__version__ = "1.1"
 
 from chimerax.core.commands import register
 from chimerax.core.toolshed import BundleAPI
 from chimerax.core.tools import get_singleton
 from .cmd import *
+from .compute import ComputeTask
 
 
 class _MyAPI(BundleAPI):
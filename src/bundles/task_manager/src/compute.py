@@ -0,0 +1,80 @@
+# vim: set et sw=4 sts=4:
+# === UCSF ChimeraX Copyright ===
+# Copyright 2022 Regents of the University of California. All rights reserved.
+# The ChimeraX application is provided pursuant to the ChimeraX license
+# agreement, which covers academic and commercial uses. For more details, see
+# <http://www.rbvi.ucsf.edu/chimerax/docs/licensing.html>
+#
+# This particular file is part of the ChimeraX library. You can also
+# redistribute and/or modify it under the terms of the GNU Lesser General
+# Public License version 2.1 as published by the Free Software Foundation.
+# For more details, see
+# <https://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>
+#
+# THIS SOFTWARE IS PROVIDED "AS IS" WITHOUT WARRANTY OF ANY KIND, EITHER
+# EXPRESSED OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+# OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. ADDITIONAL LIABILITY
+# LIMITATIONS ARE DESCRIBED IN THE GNU LESSER GENERAL PUBLIC LICENSE
+# VERSION 2.1
+#
+# This notice must be embedded in or attached to all copies, including partial
+# copies, of the software or any revisions or derivations thereof.
+# === UCSF ChimeraX Copyright ===
+from chimerax.core.tasks import Task
+
+
+class ComputeTask(Task):
+    """Run a long C++ computation in a background thread.
+
+    The function is called with keyword argument ``progress`` set to a
+    :py:class:`chimerax.arrays.ProgressToken` that the C++ kernels poll,
+    so the computation shows its progress in the Task Manager and stops
+    early when the task is killed.  Functions that accept a progress callback
+    (for example :py:func:`chimerax.map.molmap.molecule_grid_data` or
+    :py:func:`chimerax.surface.spheres_surface_area`) can be used directly.
+
+    The result is passed to ``on_result`` in the user interface thread when
+    the computation finishes.  Errors other than cancellation are reported
+    in the log.
+    """
+
+    def __init__(self, session, name, function, *args, on_result=None, **kw):
+        super().__init__(session)
+        from chimerax.arrays import ProgressToken
+        self.name = name
+        self.progress = ProgressToken()
+        self._function = function
+        self._args = args
+        self._kw = kw
+        self._on_result = on_result
+        self.result = None
+        self._error = None
+
+    def run(self, *args, **kw):
+        from chimerax.arrays import ComputationCancelled
+        try:
+            self.result = self._function(*self._args, progress=self.progress, **self._kw)
+        except ComputationCancelled:
+            pass
+        except Exception as e:
+            self._error = e
+
+    def terminate(self):
+        self.progress.cancel()
+        super().terminate()
+
+    def exited_normally(self) -> bool:
+        return self._error is None and not self.progress.cancelled
+
+    def on_finish(self):
+        if self._error is not None:
+            self.session.logger.error("%s failed: %s" % (self.name, self._error))
+        elif not self.progress.cancelled and self._on_result is not None:
+            self._on_result(self.result)
+
+    @property
+    def progress_text(self) -> str:
+        return "%.0f%%" % (100 * self.progress.fraction)
+
+    def __str__(self):
+        return self.name
@@ -100,6 +100,7 @@ class TaskManager(ToolInstance):
         self.table.add_column("Start Time", data_fetch=lambda x: x.start_time.strftime("%H:%M:%S%p"))
         self.table.add_column("Runtime", data_fetch=lambda x: self._get_runtime(x.runtime))
         self.table.add_column("Status", data_fetch=lambda x: x.state)
+        self.table.add_column("Progress", data_fetch=lambda x: getattr(x, "progress_text", ""))
         self.table.launch(suppress_resize=True)
         self.control_widget.setVisible(True)
         self.parent.layout().addWidget(self.table)
@@ -91,7 +91,7 @@ class WebCam (Model):
         cap_ses = QMediaCaptureSession()
         self._capture_session = cap_ses
         cap_ses.setCamera(cam)
-        cap_sink = VideoCapture(self._new_frame)
+        cap_sink = VideoCapture(self._new_frame, self._foreground_key)
         self._video_capture = cap_sink
         cap_ses.setVideoSink(cap_sink)
 
@@ -168,8 +168,8 @@ class WebCam (Model):
         # and changes its settings.  ChimeraX ticket #3517
         h,w = rgba_image.shape[:2]
         self.size = (w,h)
-        
-        self._mark_image_foreground(rgba_image)
+
+        # Foreground pixels were given zero alpha while converting the frame.
         
         self._last_image = rgba_image
         
@@ -180,6 +180,14 @@ class WebCam (Model):
             self.texture.reload_texture(rgba_image)
             self.redraw_needed()
 
+    def _foreground_key(self):
+        '''
+        Color, saturation and alpha to mark pixels that should appear in front of models.
+        '''
+        fg = self.foreground_color
+        sat = int(2.55*self.saturation)  # Convert 0-100 scale to 0-255
+        return fg, sat, 0
+
     def _mark_image_foreground(self, rgba_image):
         '''
         Set image alpha values to 0 for pixels that should appear in front of models.
@@ -352,20 +360,28 @@ class VideoCapture(QVideoSink):
                          QVideoFrameFormat.PixelFormat.Format_YUYV,
                          QVideoFrameFormat.PixelFormat.Format_UYVY)
 
-    def __init__(self, new_frame_cb):
+    def __init__(self, new_frame_cb, color_key_cb = None):
         self._rgba_image = None		# Numpy uint8 array of size (h, w, 4)
         self._new_frame_cb = new_frame_cb
+        self._color_key_cb = color_key_cb	# Returns (color, saturation, alpha)
         QVideoSink.__init__(self)
         self.videoFrameChanged.connect(self._got_frame)
 
     def _got_frame(self):
         frame = self.videoFrame()
-        self._rgba_image = _numpy_rgba_array_from_qt_video_frame(frame, self._rgba_image)
+        ckcb = self._color_key_cb
+        color_key = None if ckcb is None else ckcb()
+        self._rgba_image = _numpy_rgba_array_from_qt_video_frame(frame, self._rgba_image,
+                                                                 color_key)
         self._new_frame_cb(self._rgba_image)
 
 # -----------------------------------------------------------------------------
 #
-def _numpy_rgba_array_from_qt_video_frame(frame, rgba_image = None):
+def _numpy_rgba_array_from_qt_video_frame(frame, rgba_image = None, color_key = None):
+    '''
+    If color_key (color, saturation, alpha) is given then pixels matching
+    the color are assigned the alpha value during conversion.
+    '''
     f = frame
     pixel_format = f.pixelFormat()
     if pixel_format not in VideoCapture.supported_formats:
@@ -390,13 +406,13 @@ def _numpy_rgba_array_from_qt_video_frame(frame, rgba_image = None):
     f.map(QVideoFrame.MapMode.ReadOnly)
 
     if pixel_format == QVideoFrameFormat.PixelFormat.Format_ARGB8888:
-        argb8888_frame_to_rgba(f, rgba_image)
+        argb8888_frame_to_rgba(f, rgba_image, color_key)
     elif pixel_format == QVideoFrameFormat.PixelFormat.Format_NV12:
-        nv12_frame_to_rgba(f, rgba_image)
+        nv12_frame_to_rgba(f, rgba_image, color_key)
     elif pixel_format == QVideoFrameFormat.PixelFormat.Format_YUYV:
-        yuyv_frame_to_rgba(f, rgba_image)
+        yuyv_frame_to_rgba(f, rgba_image, color_key)
     elif pixel_format == QVideoFrameFormat.PixelFormat.Format_UYVY:
-        uyvy_frame_to_rgba(f, rgba_image)
+        uyvy_frame_to_rgba(f, rgba_image, color_key)
 
     # Release mapped video frame data.
     f.unmap()
@@ -405,7 +421,7 @@ def _numpy_rgba_array_from_qt_video_frame(frame, rgba_image = None):
 
 # -----------------------------------------------------------------------------
 #
-def argb8888_frame_to_rgba(frame, rgba_image):
+def argb8888_frame_to_rgba(frame, rgba_image, color_key = None):
     '''Convert video frame data to rgba.'''
 #    _check_frame_size(frame, pixel_bits = [32])
     plane = 0
@@ -413,12 +429,12 @@ def argb8888_frame_to_rgba(frame, rgba_image):
     pointer = int(data)		# Convert sip.voidptr to integer to pass to C++ code.
     padded_width = frame.bytesPerLine(plane)//4
     from .webcam_cpp import bgra_to_rgba
-    bgra_to_rgba(pointer, rgba_image, padded_width)
+    bgra_to_rgba(pointer, rgba_image, padded_width, *_color_key_args(color_key))
 #    _bgra_to_rgba(data, rgba_image)
 
 # -----------------------------------------------------------------------------
 #
-def nv12_frame_to_rgba(frame, rgba_image):
+def nv12_frame_to_rgba(frame, rgba_image, color_key = None):
     '''Convert video frame data to rgba.'''
 #    _check_frame_size(frame, pixel_bits = [8,4])
     plane0_data = frame.bits(0)		# sip.voidptr
@@ -427,11 +443,12 @@ def nv12_frame_to_rgba(frame, rgba_image):
     plane1_data = frame.bits(1)
     plane1_pointer = int(plane1_data)
     from .webcam_cpp import nv12_to_rgba
-    nv12_to_rgba(plane0_pointer, plane1_pointer, rgba_image, padded_width)
+    nv12_to_rgba(plane0_pointer, plane1_pointer, rgba_image, padded_width,
+                 *_color_key_args(color_key))
 
 # -----------------------------------------------------------------------------
 #
-def yuyv_frame_to_rgba(frame, rgba_image):
+def yuyv_frame_to_rgba(frame, rgba_image, color_key = None):
     '''Convert video frame data to rgba.'''
 #    _check_frame_size(frame, pixel_bits = [16])
     plane = 0
@@ -439,12 +456,12 @@ def yuyv_frame_to_rgba(frame, rgba_image):
     pointer = int(data)		# Convert sip.voidptr to integer to pass to C++ code.
     padded_width = frame.bytesPerLine(plane)//2
     from .webcam_cpp import yuyv_to_rgba
-    yuyv_to_rgba(pointer, rgba_image, padded_width)
+    yuyv_to_rgba(pointer, rgba_image, padded_width, *_color_key_args(color_key))
 #    _yuyv_data_to_rgba(data, rgba_image)
 
 # -----------------------------------------------------------------------------
 #
-def uyvy_frame_to_rgba(frame, rgba_image):
+def uyvy_frame_to_rgba(frame, rgba_image, color_key = None):
     '''Convert video frame data to rgba.'''
 #    _check_frame_size(frame, pixel_bits = [16])
     plane = 0
@@ -452,7 +469,16 @@ def uyvy_frame_to_rgba(frame, rgba_image):
     pointer = int(data)		# Convert sip.voidptr to integer to pass to C++ code.
     padded_width = frame.bytesPerLine(plane)//2
     from .webcam_cpp import uyvy_to_rgba
-    uyvy_to_rgba(pointer, rgba_image, padded_width)
+    uyvy_to_rgba(pointer, rgba_image, padded_width, *_color_key_args(color_key))
+
+# -----------------------------------------------------------------------------
+#
+def _color_key_args(color_key):
+    if color_key is None:
+        return ()
+    color, saturation, alpha = color_key
+    from numpy import array, uint8
+    return (array(color, uint8), saturation, alpha)
 
 # -----------------------------------------------------------------------------
 #
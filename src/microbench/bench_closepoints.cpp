@@ -0,0 +1,64 @@
+// vi: set expandtab shiftwidth=4 softtabstop=4:
+
+/*
+ * === UCSF ChimeraX Copyright ===
+ * Copyright 2022 Regents of the University of California. All rights reserved.
+ * The ChimeraX application is provided pursuant to the ChimeraX license
+ * agreement, which covers academic and commercial uses. For more details, see
+ * <http://www.rbvi.ucsf.edu/chimerax/docs/licensing.html>
+ *
+ * This particular file is part of the ChimeraX library. You can also
+ * redistribute and/or modify it under the terms of the GNU Lesser General
+ * Public License version 2.1 as published by the Free Software Foundation.
+ * For more details, see
+ * <https://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESSED OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. ADDITIONAL LIABILITY
+ * LIMITATIONS ARE DESCRIBED IN THE GNU LESSER GENERAL PUBLIC LICENSE
+ * VERSION 2.1
+ *
+ * This notice must be embedded in or attached to all copies, including partial
+ * copies, of the software or any revisions or derivations thereof.
+ * === UCSF ChimeraX Copyright ===
+ */
+
+// ----------------------------------------------------------------------------
+// Close point search between two sets of n random atoms at contact distance,
+// the clashes, contacts and zone kernel, with the box and bin methods and a
+// reusable cell index.  The Python wrapper module is compiled in to reach
+// find_close_points() for point arrays.
+//
+#include <vector>		// use std::vector
+
+#include "closepoints.cpp"	// use find_close_points(), Close_Points_Index
+#include "microbench.h"
+
+int main(int argc, char **argv)
+{
+  Microbench::Options opt = Microbench::parse_options(argc, argv, 100000);
+  Index n = opt.size;
+  std::vector<float> xyz1 = Microbench::random_atom_points(n, 1);
+  std::vector<float> xyz2 = Microbench::random_atom_points(n, 2);
+  float d = 4;
+
+  struct { const char *name; Close_Points_Method method; } methods[] =
+    {{"boxes", CP_BOXES}, {"bins", CP_BINS}, {"box bins", CP_BOX_BINS}};
+  for (auto &m: methods)
+    Microbench::run("closepoints", m.name, n, opt, [&]()
+      {
+	Index_List i1, i2;
+	find_close_points(m.method, xyz1.data(), n, xyz2.data(), n, d, NULL, &i1, &i2);
+	return static_cast<double>(i1.size() + i2.size());
+      });
+
+  Close_Points_Index index(xyz2.data(), n, d, NULL);
+  Microbench::run("closepoints", "cell index", n, opt, [&]()
+    {
+      Index_List i1, i2, nearest;
+      index.find_close_points(xyz1.data(), n, d, &i1, &i2, &nearest);
+      return static_cast<double>(i1.size() + i2.size());
+    });
+  return 0;
+}
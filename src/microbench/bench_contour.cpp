@@ -0,0 +1,83 @@
+// vi: set expandtab shiftwidth=4 softtabstop=4:
+
+/*
+ * === UCSF ChimeraX Copyright ===
+ * Copyright 2022 Regents of the University of California. All rights reserved.
+ * The ChimeraX application is provided pursuant to the ChimeraX license
+ * agreement, which covers academic and commercial uses. For more details, see
+ * <http://www.rbvi.ucsf.edu/chimerax/docs/licensing.html>
+ *
+ * This particular file is part of the ChimeraX library. You can also
+ * redistribute and/or modify it under the terms of the GNU Lesser General
+ * Public License version 2.1 as published by the Free Software Foundation.
+ * For more details, see
+ * <https://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESSED OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. ADDITIONAL LIABILITY
+ * LIMITATIONS ARE DESCRIBED IN THE GNU LESSER GENERAL PUBLIC LICENSE
+ * VERSION 2.1
+ *
+ * This notice must be embedded in or attached to all copies, including partial
+ * copies, of the software or any revisions or derivations thereof.
+ * === UCSF ChimeraX Copyright ===
+ */
+
+// ----------------------------------------------------------------------------
+// Contour surface calculation on a gyroid, a smooth field with a surface of
+// many connected pieces running through the whole grid.  Cases are grids of
+// edge n/2, n and 2n, with and without precomputed block bounds.
+//
+#include <math.h>		// use sin(), cos()
+#include <string>		// use std::to_string()
+#include <vector>		// use std::vector
+
+#include "contour.h"		// use Contour_Calculation::surface()
+#include "microbench.h"
+
+using namespace Contour_Calculation;
+
+static std::vector<float> gyroid(AIndex n)
+{
+  std::vector<float> v(n*n*n);
+  float s = 12.0f / n;		// about two periods along each axis
+  for (AIndex k = 0 ; k < n ; ++k)
+    for (AIndex j = 0 ; j < n ; ++j)
+      for (AIndex i = 0 ; i < n ; ++i)
+	v[(k*n + j)*n + i] = (sin(s*i)*cos(s*j) + sin(s*j)*cos(s*k) + sin(s*k)*cos(s*i));
+  return v;
+}
+
+int main(int argc, char **argv)
+{
+  Microbench::Options opt = Microbench::parse_options(argc, argv, 128);
+  for (AIndex n: {opt.size/2, opt.size, 2*opt.size})
+    {
+      std::vector<float> grid = gyroid(n);
+      AIndex size[3] = {n, n, n};
+      GIndex stride[3] = {1, n, n*n};
+      int64_t points = static_cast<int64_t>(n)*n*n;
+      std::string name = "gyroid " + std::to_string(n);
+      Microbench::run("contour", name, points, opt, [&]()
+	{
+	  Contour_Surface *s = surface(grid.data(), size, stride, 0.5f, true, opt.threads);
+	  double tcount = s->triangle_count();
+	  delete s;
+	  return tcount;
+	});
+
+      AIndex block = 8, nb = (n + block - 1) / block;
+      std::vector<float> bounds(2*nb*nb*nb);
+      block_bounds(grid.data(), size, stride, block, bounds.data());
+      Microbench::run("contour", name + " block bounds", points, opt, [&]()
+	{
+	  Contour_Surface *s = surface(grid.data(), size, stride, 0.5f, true, opt.threads,
+				       bounds.data(), block);
+	  double tcount = s->triangle_count();
+	  delete s;
+	  return tcount;
+	});
+    }
+  return 0;
+}
@@ -0,0 +1,76 @@
+// vi: set expandtab shiftwidth=4 softtabstop=4:
+
+/*
+ * === UCSF ChimeraX Copyright ===
+ * Copyright 2022 Regents of the University of California. All rights reserved.
+ * The ChimeraX application is provided pursuant to the ChimeraX license
+ * agreement, which covers academic and commercial uses. For more details, see
+ * <http://www.rbvi.ucsf.edu/chimerax/docs/licensing.html>
+ *
+ * This particular file is part of the ChimeraX library. You can also
+ * redistribute and/or modify it under the terms of the GNU Lesser General
+ * Public License version 2.1 as published by the Free Software Foundation.
+ * For more details, see
+ * <https://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESSED OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. ADDITIONAL LIABILITY
+ * LIMITATIONS ARE DESCRIBED IN THE GNU LESSER GENERAL PUBLIC LICENSE
+ * VERSION 2.1
+ *
+ * This notice must be embedded in or attached to all copies, including partial
+ * copies, of the software or any revisions or derivations thereof.
+ * === UCSF ChimeraX Copyright ===
+ */
+
+// ----------------------------------------------------------------------------
+// Sum of Gaussians on a grid, the molmap kernel, for n random atoms on a
+// 1 Angstrom grid with resolution 5 sdev and 3 sdev cutoff as molmap uses.
+// The Python wrapper module is compiled in to reach the static kernel.
+//
+#include <math.h>		// use ceil()
+#include <vector>		// use std::vector
+
+#include "gaussian.cpp"		// use sum_of_gaussians()
+#include "microbench.h"
+
+int main(int argc, char **argv)
+{
+  Microbench::Options opt = Microbench::parse_options(argc, argv, 100000);
+  int64_t n = opt.size;
+  std::vector<float> xyz = Microbench::random_atom_points(n);
+
+  // Grid point coordinates in grid index units, padded by the cutoff range.
+  float sdev = 5 / (2*sqrt(3.0)), range = 3, pad = range * sdev;
+  float edge = 0;
+  for (auto x: xyz)
+    edge = std::max(edge, x);
+  int64_t gsize = static_cast<int64_t>(ceil(edge + 2*pad)) + 1;
+
+  int64_t csize[2] = {n, 3};
+  FArray centers(2, csize);
+  float *c = centers.values();
+  for (int64_t i = 0 ; i < 3*n ; ++i)
+    c[i] = xyz[i] + pad;
+  int64_t nsize[2] = {n, 3};
+  FArray sdevs(2, nsize);
+  float *s = sdevs.values();
+  for (int64_t i = 0 ; i < 3*n ; ++i)
+    s[i] = sdev;
+  FArray coef(1, &n);
+  float *w = coef.values();
+  for (int64_t i = 0 ; i < n ; ++i)
+    w[i] = 1;
+
+  int64_t msize[3] = {gsize, gsize, gsize};
+  FArray matrix(3, msize);
+  std::string name = "molmap " + std::to_string(n) + " atoms";
+  Microbench::run("gaussian", name, n, opt, [&]()
+    {
+      matrix.set(0);
+      sum_of_gaussians(centers, coef, sdevs, range, matrix, opt.threads);
+      return static_cast<double>(matrix.values()[matrix.size()/2]);
+    });
+  return 0;
+}
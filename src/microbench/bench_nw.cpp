@@ -0,0 +1,76 @@
+// vi: set expandtab shiftwidth=4 softtabstop=4:
+
+/*
+ * === UCSF ChimeraX Copyright ===
+ * Copyright 2022 Regents of the University of California. All rights reserved.
+ * The ChimeraX application is provided pursuant to the ChimeraX license
+ * agreement, which covers academic and commercial uses. For more details, see
+ * <http://www.rbvi.ucsf.edu/chimerax/docs/licensing.html>
+ *
+ * This particular file is part of the ChimeraX library. You can also
+ * redistribute and/or modify it under the terms of the GNU Lesser General
+ * Public License version 2.1 as published by the Free Software Foundation.
+ * For more details, see
+ * <https://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESSED OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. ADDITIONAL LIABILITY
+ * LIMITATIONS ARE DESCRIBED IN THE GNU LESSER GENERAL PUBLIC LICENSE
+ * VERSION 2.1
+ *
+ * This notice must be embedded in or attached to all copies, including partial
+ * copies, of the software or any revisions or derivations thereof.
+ * === UCSF ChimeraX Copyright ===
+ */
+
+// ----------------------------------------------------------------------------
+// Needleman-Wunsch global alignment of random sequences of length n, 2n and
+// 4n with 30% substitutions, the sequence-structure alignment kernel.  Cases
+// are the full matrix and a band.  The Python wrapper module is compiled in
+// to reach the static compute_match().
+//
+#include <string>		// use std::string
+
+#include "nw.cpp"		// use MatchProblem, compute_match()
+#include "microbench.h"
+
+static void setup_problem(MatchProblem &p, std::string &seq1, std::string &seq2, int band)
+{
+  p.rows = seq1.size() + 1;
+  p.cols = seq2.size() + 1;
+  p.eval = new SimpleEvaluator(&seq1[0], &seq2[0], 1, 0);
+  p.gap_open = -12;
+  p.gap_extend = -1;
+  p.ends_are_gaps = false;
+  p.band = band;
+  p.gap_open_1.assign(p.rows, p.gap_open);
+  p.gap_open_2.assign(p.cols, p.gap_open);
+  p.gap_open_1[0] = p.gap_open_2[0] = 0.0;
+  p.has_occ1 = p.has_occ2 = false;
+}
+
+int main(int argc, char **argv)
+{
+  Microbench::Options opt = Microbench::parse_options(argc, argv, 500);
+  for (int64_t n: {opt.size, 2*opt.size, 4*opt.size})
+    {
+      std::string seq1 = Microbench::random_sequence(n);
+      std::string seq2 = Microbench::mutated_sequence(seq1, 0.3);
+      int64_t cells = n*n;
+      for (int band: {0, 50})
+	{
+	  std::string name = std::to_string(n) + " residues";
+	  if (band)
+	    name += " band " + std::to_string(band);
+	  Microbench::run("nw", name, cells, opt, [&]()
+	    {
+	      MatchProblem p;
+	      setup_problem(p, seq1, seq2, band);
+	      compute_match(p);
+	      return p.score;
+	    });
+	}
+    }
+  return 0;
+}
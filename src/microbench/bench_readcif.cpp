@@ -0,0 +1,185 @@
+// vi: set expandtab shiftwidth=4 softtabstop=4:
+
+/*
+ * === UCSF ChimeraX Copyright ===
+ * Copyright 2022 Regents of the University of California. All rights reserved.
+ * The ChimeraX application is provided pursuant to the ChimeraX license
+ * agreement, which covers academic and commercial uses. For more details, see
+ * <http://www.rbvi.ucsf.edu/chimerax/docs/licensing.html>
+ *
+ * This particular file is part of the ChimeraX library. You can also
+ * redistribute and/or modify it under the terms of the GNU Lesser General
+ * Public License version 2.1 as published by the Free Software Foundation.
+ * For more details, see
+ * <https://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESSED OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. ADDITIONAL LIABILITY
+ * LIMITATIONS ARE DESCRIBED IN THE GNU LESSER GENERAL PUBLIC LICENSE
+ * VERSION 2.1
+ *
+ * This notice must be embedded in or attached to all copies, including partial
+ * copies, of the software or any revisions or derivations thereof.
+ * === UCSF ChimeraX Copyright ===
+ */
+
+// ----------------------------------------------------------------------------
+// mmCIF atom_site parsing of a synthetic PDBx/mmCIF file with n atoms, with
+// free-form and fixed width column parsing, one row at a time and threaded.
+// Only the tokenizer and value conversion are timed, no structure is built.
+//
+#include <stdio.h>		// use snprintf()
+#include <string>		// use std::string
+#include <vector>		// use std::vector
+
+#include "readcif.h"		// use readcif::CIFFile
+#include "microbench.h"
+
+// atom_site text with rows padded to fixed width columns.
+static std::string atom_site_text(int64_t n)
+{
+  static const char *atoms[] = {"N", "CA", "C", "O", "CB"};
+  static const char *elements[] = {"N", "C", "C", "O", "C"};
+  std::vector<float> xyz = Microbench::random_atom_points(n);
+  std::string text =
+    "data_bench\n"
+    "loop_\n"
+    "_atom_site.group_PDB\n"
+    "_atom_site.id\n"
+    "_atom_site.type_symbol\n"
+    "_atom_site.label_atom_id\n"
+    "_atom_site.label_comp_id\n"
+    "_atom_site.label_asym_id\n"
+    "_atom_site.label_seq_id\n"
+    "_atom_site.Cartn_x\n"
+    "_atom_site.Cartn_y\n"
+    "_atom_site.Cartn_z\n"
+    "_atom_site.occupancy\n"
+    "_atom_site.B_iso_or_equiv\n"
+    "_atom_site.pdbx_PDB_model_num\n";
+  char line[128];
+  for (int64_t a = 0 ; a < n ; ++a)
+    {
+      int k = a % 5;
+      snprintf(line, sizeof(line),
+	       "ATOM %-8lld %-2s %-4s ALA A %-6lld %9.3f %9.3f %9.3f 1.00 %6.2f 1\n",
+	       (long long)(a+1), elements[k], atoms[k], (long long)(a/5+1),
+	       xyz[3*a], xyz[3*a+1], xyz[3*a+2], 10 + (a % 50) * 0.5);
+      text += line;
+    }
+  text += "#\n";
+  return text;
+}
+
+class Atom_Site_Reader : public readcif::CIFFile
+{
+public:
+  Atom_Site_Reader(int threads, bool fixed_width) :
+    threads(threads), fixed_width(fixed_width)
+  {
+    register_category("atom_site", [this] () { parse_atom_site(); });
+  }
+  double sum = 0;
+protected:
+  // Parsing resets the style settings, so set them per data block,
+  // as mmcif.cpp does after reading audit_conform.
+  void data_block(const std::string &) override
+  {
+    set_PDBx_keywords(true);
+    if (fixed_width)
+      set_PDBx_fixed_width_columns("atom_site");
+  }
+private:
+  int threads;
+  bool fixed_width;
+
+  // Values parsed for one row, as mmcif.cpp does for atom_site.
+  class Row
+  {
+  public:
+    long serial;
+    char element[4], atom_name[8];
+    int seq_id;
+    float xyz[3], occupancy, bfactor;
+  };
+
+  ParseValues row_values(Row &r)
+  {
+    ParseValues pv;
+    pv.reserve(10);
+    pv.emplace_back(get_column("id"), [&r] (const char *start)
+		    { r.serial = readcif::str_to_int(start); });
+    pv.emplace_back(get_column("type_symbol"), [&r] (const char *start, const char *end)
+		    { copy_token(r.element, sizeof(r.element), start, end); });
+    pv.emplace_back(get_column("label_atom_id"), [&r] (const char *start, const char *end)
+		    { copy_token(r.atom_name, sizeof(r.atom_name), start, end); });
+    pv.emplace_back(get_column("label_seq_id"), [&r] (const char *start)
+		    { r.seq_id = readcif::str_to_int(start); });
+    pv.emplace_back(get_column("Cartn_x"), [&r] (const char *start)
+		    { r.xyz[0] = readcif::str_to_float(start); });
+    pv.emplace_back(get_column("Cartn_y"), [&r] (const char *start)
+		    { r.xyz[1] = readcif::str_to_float(start); });
+    pv.emplace_back(get_column("Cartn_z"), [&r] (const char *start)
+		    { r.xyz[2] = readcif::str_to_float(start); });
+    pv.emplace_back(get_column("occupancy"), [&r] (const char *start)
+		    { r.occupancy = readcif::str_to_float(start); });
+    pv.emplace_back(get_column("B_iso_or_equiv"), [&r] (const char *start)
+		    { r.bfactor = readcif::str_to_float(start); });
+    return pv;
+  }
+
+  static void copy_token(char *to, size_t size, const char *start, const char *end)
+  {
+    size_t len = std::min<size_t>(end - start, size - 1);
+    memcpy(to, start, len);
+    to[len] = '\0';
+  }
+
+  static double row_sum(const Row &r)
+  { return r.serial + r.seq_id + r.xyz[0] + r.xyz[1] + r.xyz[2] + r.bfactor + r.atom_name[0]; }
+
+  void parse_atom_site()
+  {
+    Row row;
+    ParseValues pv = row_values(row);
+    if (threads > 1)
+      {
+	std::vector<Row> rows(threads);
+	std::vector<ParseValues> chunk_pv;
+	for (auto &r: rows)
+	  chunk_pv.push_back(row_values(r));
+	std::vector<double> sums(threads, 0);
+	for (;;)
+	  {
+	    long num_rows = parse_rows_threaded(threads, threads * 10000,
+		[&] (int i) -> ParseValues& { return chunk_pv[i]; },
+		[&] (int i) { sums[i] += row_sum(rows[i]); });
+	    if (num_rows <= 0)
+	      break;
+	  }
+	for (auto s: sums)
+	  sum += s;
+      }
+    // Rows not suited to threaded parsing, and all rows when unthreaded.
+    while (parse_row(pv))
+      sum += row_sum(row);
+  }
+};
+
+int main(int argc, char **argv)
+{
+  Microbench::Options opt = Microbench::parse_options(argc, argv, 1000000);
+  std::string text = atom_site_text(opt.size);
+  for (bool fixed_width: {false, true})
+    {
+      std::string name = (fixed_width ? "atom_site fixed width" : "atom_site");
+      Microbench::run("readcif", name, opt.size, opt, [&]()
+	{
+	  Atom_Site_Reader reader(opt.threads, fixed_width);
+	  reader.parse(text.c_str());
+	  return reader.sum;
+	});
+    }
+  return 0;
+}
@@ -0,0 +1,57 @@
+// vi: set expandtab shiftwidth=4 softtabstop=4:
+
+/*
+ * === UCSF ChimeraX Copyright ===
+ * Copyright 2022 Regents of the University of California. All rights reserved.
+ * The ChimeraX application is provided pursuant to the ChimeraX license
+ * agreement, which covers academic and commercial uses. For more details, see
+ * <http://www.rbvi.ucsf.edu/chimerax/docs/licensing.html>
+ *
+ * This particular file is part of the ChimeraX library. You can also
+ * redistribute and/or modify it under the terms of the GNU Lesser General
+ * Public License version 2.1 as published by the Free Software Foundation.
+ * For more details, see
+ * <https://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESSED OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. ADDITIONAL LIABILITY
+ * LIMITATIONS ARE DESCRIBED IN THE GNU LESSER GENERAL PUBLIC LICENSE
+ * VERSION 2.1
+ *
+ * This notice must be embedded in or attached to all copies, including partial
+ * copies, of the software or any revisions or derivations thereof.
+ * === UCSF ChimeraX Copyright ===
+ */
+
+// ----------------------------------------------------------------------------
+// Solvent accessible surface area of n random atoms with radii enlarged by a
+// 1.4 Angstrom probe, the measure sasa kernel.  The Python wrapper module is
+// compiled in to reach the static kernel, which picks its own thread count.
+//
+#include <vector>		// use std::vector
+
+#include "sasa.cpp"		// use surface_area_of_spheres()
+#include "microbench.h"
+
+int main(int argc, char **argv)
+{
+  Microbench::Options opt = Microbench::parse_options(argc, argv, 20000);
+  int n = static_cast<int>(opt.size);
+  std::vector<float> xyz = Microbench::random_atom_points(n);
+  std::vector<float> r = Microbench::random_atom_radii(n);
+  std::vector<double> centers(xyz.begin(), xyz.end()), radii(n), areas(n);
+  for (int i = 0 ; i < n ; ++i)
+    radii[i] = r[i] + 1.4;
+
+  std::string name = std::to_string(n) + " atoms";
+  Microbench::run("sasa", name, n, opt, [&]()
+    {
+      surface_area_of_spheres(centers.data(), n, radii.data(), areas.data());
+      double area = 0;
+      for (auto a: areas)
+	area += a;
+      return area;
+    });
+  return 0;
+}
@@ -0,0 +1,85 @@
+// vi: set expandtab shiftwidth=4 softtabstop=4:
+
+/*
+ * === UCSF ChimeraX Copyright ===
+ * Copyright 2022 Regents of the University of California. All rights reserved.
+ * The ChimeraX application is provided pursuant to the ChimeraX license
+ * agreement, which covers academic and commercial uses. For more details, see
+ * <http://www.rbvi.ucsf.edu/chimerax/docs/licensing.html>
+ *
+ * This particular file is part of the ChimeraX library. You can also
+ * redistribute and/or modify it under the terms of the GNU Lesser General
+ * Public License version 2.1 as published by the Free Software Foundation.
+ * For more details, see
+ * <https://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESSED OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. ADDITIONAL LIABILITY
+ * LIMITATIONS ARE DESCRIBED IN THE GNU LESSER GENERAL PUBLIC LICENSE
+ * VERSION 2.1
+ *
+ * This notice must be embedded in or attached to all copies, including partial
+ * copies, of the software or any revisions or derivations thereof.
+ * === UCSF ChimeraX Copyright ===
+ */
+
+// ----------------------------------------------------------------------------
+// Smith-Waterman local alignment score of a random query of length n against
+// a database of 100 random sequences with 30% substitutions, the blast-like
+// sequence search kernel.  Cases are an integer scoring matrix, scored with
+// integer arithmetic, and a fractional one.  The Python wrapper module is
+// compiled in to reach the static profile scoring.
+//
+#include <string>		// use std::string
+#include <vector>		// use std::vector
+
+#include "sw.cpp"		// use Profile, best_score()
+#include "microbench.h"
+
+// Match and mismatch scores for the 20 amino acid letters.
+static Similarity similarity(double match, double mismatch)
+{
+  static const char *residues = "ACDEFGHIKLMNPQRSTVWY";
+  Similarity m;
+  for (const char *c1 = residues ; *c1 ; ++c1)
+    for (const char *c2 = residues ; *c2 ; ++c2)
+      m[align_algs::Pair(*c1, *c2)] = (*c1 == *c2 ? match : mismatch);
+  return m;
+}
+
+int main(int argc, char **argv)
+{
+  Microbench::Options opt = Microbench::parse_options(argc, argv, 300);
+  int64_t n = opt.size;
+  std::string query = Microbench::random_sequence(n);
+  std::vector<std::string> database;
+  int64_t cells = 0;
+  for (int s = 0 ; s < 100 ; ++s)
+    {
+      database.push_back(Microbench::mutated_sequence(query, 0.3, 10+s));
+      cells += n * database.back().size();
+    }
+
+  struct { const char *name; double match, mismatch; } matrices[] =
+    {{"integer scores", 5, -4}, {"fractional scores", 5.5, -4}};
+  for (auto &m: matrices)
+    {
+      Similarity sim = similarity(m.match, m.mismatch);
+      std::string name = std::to_string(n) + " residues " + m.name;
+      Microbench::run("sw", name, cells, opt, [&]()
+	{
+	  Profile<double> profile;
+	  for (const char *c = "ACDEFGHIKLMNPQRSTVWY" ; *c ; ++c)
+	    add_profile_type(profile, sim, query.c_str(), *c);
+	  Profile<int> int_profile;
+	  bool use_int = integer_profile(profile, n, 10, 1, int_profile);
+	  double total = 0;
+	  for (auto &seq: database)
+	    total += best_score(profile, (use_int ? &int_profile : nullptr), n,
+				seq.c_str(), 10, 1);
+	  return total;
+	});
+    }
+  return 0;
+}
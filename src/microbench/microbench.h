@@ -0,0 +1,161 @@
+// vi: set expandtab shiftwidth=4 softtabstop=4:
+
+/*
+ * === UCSF ChimeraX Copyright ===
+ * Copyright 2022 Regents of the University of California. All rights reserved.
+ * The ChimeraX application is provided pursuant to the ChimeraX license
+ * agreement, which covers academic and commercial uses. For more details, see
+ * <http://www.rbvi.ucsf.edu/chimerax/docs/licensing.html>
+ *
+ * This particular file is part of the ChimeraX library. You can also
+ * redistribute and/or modify it under the terms of the GNU Lesser General
+ * Public License version 2.1 as published by the Free Software Foundation.
+ * For more details, see
+ * <https://www.gnu.org/licenses/old-licenses/lgpl-2.1.html>
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESSED OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. ADDITIONAL LIABILITY
+ * LIMITATIONS ARE DESCRIBED IN THE GNU LESSER GENERAL PUBLIC LICENSE
+ * VERSION 2.1
+ *
+ * This notice must be embedded in or attached to all copies, including partial
+ * copies, of the software or any revisions or derivations thereof.
+ * === UCSF ChimeraX Copyright ===
+ */
+
+// ----------------------------------------------------------------------------
+// Timing harness and synthetic data for the standalone C++ kernel benchmarks.
+// Each benchmark program times kernels called directly, without Python, and
+// prints one JSON object per case so results can be collected by scripts:
+//
+//   {"kernel": "contour", "case": "gyroid 128", "items": 2097152, "threads": 1,
+//    "repeat": 5, "min_seconds": ..., "median_seconds": ..., "items_per_second": ...}
+//
+// Common options are -n size, -r repeat count and -t threads.
+//
+#ifndef MICROBENCH_HEADER_INCLUDED
+#define MICROBENCH_HEADER_INCLUDED
+
+#include <algorithm>		// use std::sort
+#include <chrono>		// use std::chrono::steady_clock
+#include <cmath>		// use std::pow
+#include <cstdint>		// use int64_t
+#include <cstdio>		// use printf
+#include <cstdlib>		// use atoll
+#include <cstring>		// use strcmp
+#include <random>		// use std::mt19937
+#include <string>		// use std::string
+#include <vector>		// use std::vector
+
+namespace Microbench
+{
+
+class Options
+{
+public:
+  int64_t size;
+  int repeat = 5;
+  int threads = 1;
+};
+
+inline Options parse_options(int argc, char **argv, int64_t default_size)
+{
+  Options opt;
+  opt.size = default_size;
+  for (int a = 1 ; a+1 < argc ; a += 2)
+    if (strcmp(argv[a], "-n") == 0)
+      opt.size = atoll(argv[a+1]);
+    else if (strcmp(argv[a], "-r") == 0)
+      opt.repeat = std::max(1, atoi(argv[a+1]));
+    else if (strcmp(argv[a], "-t") == 0)
+      opt.threads = std::max(1, atoi(argv[a+1]));
+    else
+      {
+	fprintf(stderr, "usage: %s [-n size] [-r repeat] [-t threads]\n", argv[0]);
+	exit(1);
+      }
+  return opt;
+}
+
+// ----------------------------------------------------------------------------
+// Run f() repeat times and print the fastest and median times.  The result
+// of f is accumulated in a volatile so the kernel can't be optimized away.
+//
+template <class F>
+void run(const char *kernel, const std::string &name, int64_t items,
+	 const Options &opt, F f)
+{
+  static volatile double sink = 0;
+  std::vector<double> times;
+  for (int r = 0 ; r < opt.repeat ; ++r)
+    {
+      auto t0 = std::chrono::steady_clock::now();
+      sink = sink + f();
+      std::chrono::duration<double> t = std::chrono::steady_clock::now() - t0;
+      times.push_back(t.count());
+    }
+  std::sort(times.begin(), times.end());
+  double tmin = times[0], tmed = times[times.size()/2];
+  printf("{\"kernel\": \"%s\", \"case\": \"%s\", \"items\": %lld, \"threads\": %d,"
+	 " \"repeat\": %d, \"min_seconds\": %.6g, \"median_seconds\": %.6g,"
+	 " \"items_per_second\": %.6g}\n",
+	 kernel, name.c_str(), (long long)items, opt.threads, opt.repeat,
+	 tmin, tmed, (tmin > 0 ? items / tmin : 0.0));
+  fflush(stdout);
+}
+
+// ----------------------------------------------------------------------------
+// Random atom-like points at the density of heavy atoms in a protein,
+// about one per 20 cubic Angstroms, in a cube.  Returns n*3 coordinates.
+//
+inline std::vector<float> random_atom_points(int64_t n, unsigned int seed = 1)
+{
+  float edge = static_cast<float>(std::pow(20.0 * n, 1.0/3));
+  std::mt19937 rng(seed);
+  std::uniform_real_distribution<float> u(0, edge);
+  std::vector<float> xyz(3*n);
+  for (auto &x: xyz)
+    x = u(rng);
+  return xyz;
+}
+
+// Atom radii between 1.5 and 2.0 Angstroms.
+inline std::vector<float> random_atom_radii(int64_t n, unsigned int seed = 2)
+{
+  std::mt19937 rng(seed);
+  std::uniform_real_distribution<float> u(1.5, 2.0);
+  std::vector<float> r(n);
+  for (auto &x: r)
+    x = u(rng);
+  return r;
+}
+
+// Random sequence of the 20 amino acid letters.
+inline std::string random_sequence(int64_t n, unsigned int seed = 3)
+{
+  static const char *residues = "ACDEFGHIKLMNPQRSTVWY";
+  std::mt19937 rng(seed);
+  std::uniform_int_distribution<int> u(0, 19);
+  std::string s(n, 'A');
+  for (auto &c: s)
+    c = residues[u(rng)];
+  return s;
+}
+
+// Copy of a sequence with about the given fraction of residues substituted.
+inline std::string mutated_sequence(const std::string &seq, double fraction,
+				    unsigned int seed = 4)
+{
+  std::string m = seq, r = random_sequence(seq.size(), seed + 1);
+  std::mt19937 rng(seed);
+  std::uniform_real_distribution<double> u(0, 1);
+  for (size_t i = 0 ; i < m.size() ; ++i)
+    if (u(rng) < fraction)
+      m[i] = r[i];
+  return m;
+}
+
+}  // namespace Microbench
+
+#endif
@@ -0,0 +1,35 @@
+import numpy
+
+from chimerax.core.session import Session
+from chimerax.atomic import initialize_atomic, AtomicStructure
+from chimerax.geometry import rotation, translation, iterative_align_points, Place
+from chimerax.std_commands.align import align
+
+CHAIN_XYZ = numpy.array([(0, 0, 0), (3.8, 0, 0), (5.0, 3.6, 0), (4.1, 5.2, 3.1),
+                         (1.2, 6.8, 4.0), (-1.5, 4.9, 6.2)], numpy.float64)
+
+def _two_chain_structure(session, name, moves):
+    s = AtomicStructure(session, name = name)
+    for cid, tf in zip('AB', moves):
+        for i, xyz in enumerate(tf * CHAIN_XYZ):
+            r = s.new_residue('ALA', cid, i + 1)
+            a = s.new_atom('CA', 'C')
+            a.coord = xyz
+            r.add_atom(a)
+    session.models.add([s])
+    return s
+
+def test_align_each_chain_move_structures():
+    session = Session('cx standalone')
+    initialize_atomic(session)
+    m = _two_chain_structure(session, 'mobile', (Place(), translation((20, 0, 0))))
+    # Chains of the reference are placed differently, so each chain has its own fit.
+    ref = _two_chain_structure(session, 'reference',
+                               (rotation((0, 0, 1), 30), rotation((1, 0, 0), 70) * translation((5, 5, 5))))
+    s, cid, last_chain = m.atoms.by_chain[-1]
+    ref_last_chain = ref.atoms.filter(ref.atoms.chain_ids == cid)
+    last_fit = Place(iterative_align_points(last_chain.scene_coords,
+                                            ref_last_chain.scene_coords, None)[0])
+    align(session, m.atoms, to_atoms = ref.atoms, each = 'chain', move = 'structures',
+          match_chain_ids = True, log_info = False)
+    assert numpy.allclose(m.scene_position.matrix, last_fit.matrix, atol = 1e-3)